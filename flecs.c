@@ -97,6 +97,10 @@ typedef struct ecs_c_info_t {
     ecs_vector_t *on_add;       /* Systems ran after adding this component */
     ecs_vector_t *on_remove;    /* Systems ran after removing this component */
     EcsComponentLifecycle lifecycle; /* Component lifecycle callbacks */
+    ecs_sparse_t *sparse;       /* Storage for sparse components */
+    ecs_size_t size;            /* Size of sparse component */
+    ecs_vector_t *fields;       /* Fields of structure of arrays component */
+    bool double_buffered;       /* Keep copy of values from previous frame */
     bool lifecycle_set;
 } ecs_c_info_t;
 
@@ -104,6 +108,7 @@ typedef struct ecs_c_info_t {
 typedef enum ecs_table_eventkind_t {
     EcsTableQueryMatch,
     EcsTableQueryUnmatch,
+    EcsTableQueryFree,
     EcsTableComponentInfo
 } ecs_table_eventkind_t;
 
@@ -135,12 +140,20 @@ typedef struct ecs_sw_column_t {
     ecs_type_t type;      /**< Switch type */
 } ecs_sw_column_t;
 
+/** A bitset column. */
+typedef struct ecs_bs_column_t {
+    ecs_bitset_t data;    /**< Column data */
+} ecs_bs_column_t;
+
 /** Stage-specific component data */
 struct ecs_data_t {
     ecs_vector_t *entities;      /**< Entity identifiers */
     ecs_vector_t *record_ptrs;   /**< Ptrs to records in main entity index */
     ecs_column_t *columns;       /**< Component columns */
     ecs_sw_column_t *sw_columns; /**< Switch columns */
+    ecs_bs_column_t *bs_columns; /**< Bitset columns */
+    ecs_column_t *soa_columns;   /**< Field columns */
+    ecs_column_t *prev_columns;  /**< Component values of previous frame */
     bool marked_dirty;           /**< Was table marked dirty by stage? */  
 };
 
@@ -169,10 +182,15 @@ typedef struct ecs_table_leaf_t {
 #define EcsTableHasUnSet            16384u
 #define EcsTableHasMonitors         32768u
 #define EcsTableHasSwitch           65536u
+#define EcsTableIsGarbage           131072u /**< Table is being collected */
+#define EcsTableHasChildOf          262144u /**< Does the table have EcsChildOf */
+#define EcsTableHasDisabled         524288u /**< Does the table type has DISABLED */
+#define EcsTableHasSoa              1048576u /**< Does the table have field columns */
+#define EcsTableHasPrev             2097152u /**< Does the table have double buffered columns */
 
 /* Composite constants */
 #define EcsTableHasLifecycle        (EcsTableHasCtors | EcsTableHasDtors)
-#define EcsTableIsComplex           (EcsTableHasLifecycle | EcsTableHasSwitch)
+#define EcsTableIsComplex           (EcsTableHasLifecycle | EcsTableHasSwitch | EcsTableHasDisabled | EcsTableHasSoa | EcsTableHasPrev)
 #define EcsTableHasAddActions       (EcsTableHasBase | EcsTableHasSwitch | EcsTableHasCtors | EcsTableHasOnAdd | EcsTableHasOnSet | EcsTableHasMonitors)
 #define EcsTableHasRemoveActions    (EcsTableHasBase | EcsTableHasDtors | EcsTableHasOnRemove | EcsTableHasUnSet | EcsTableHasMonitors)
 
@@ -193,6 +211,22 @@ typedef struct ecs_matched_query_t {
     int32_t matched_table_index;    /**< Table index in the query type */
 } ecs_matched_query_t;
 
+/** Statistics of a component, maintained incrementally by tables. */
+typedef struct ecs_component_stats_t {
+    int32_t tables_count;           /**< Tables that have the component */
+    int32_t entities_count;         /**< Elements in component columns */
+    int32_t used_bytes;             /**< Bytes used by column elements */
+    int32_t allocd_bytes;           /**< Bytes allocated for columns */
+} ecs_component_stats_t;
+
+/** Column values that are accounted for in the component statistics. */
+typedef struct ecs_column_stats_t {
+    ecs_component_stats_t *stats;   /**< Statistics of column component */
+    int32_t count;                  /**< Accounted number of elements */
+    int32_t used_bytes;             /**< Accounted bytes used by elements */
+    int32_t allocd_bytes;           /**< Accounted bytes allocated */
+} ecs_column_stats_t;
+
 /** A table is the Flecs equivalent of an archetype. Tables store all entities
  * with a specific set of components. Tables are automatically created when an
  * entity has a set of components not previously observed before. When a new
@@ -203,6 +237,7 @@ struct ecs_table_t {
 
     ecs_edge_t *lo_edges;            /**< Edges to low entity ids */
     ecs_map_t *hi_edges;             /**< Edges to high entity ids */
+    ecs_table_t *hash_next;          /**< Next table with same type hash */
 
     ecs_data_t *data;                /**< Data storage */
 
@@ -214,13 +249,21 @@ struct ecs_table_t {
     ecs_vector_t *un_set_all;        /**< All OnSet systems */
 
     int32_t *dirty_state;            /**< Keep track of changes in columns */
+    ecs_column_stats_t *column_stats; /**< Column statistics (if tracked) */
     int32_t alloc_count;             /**< Increases when columns are reallocd */
+    int32_t alloc_bytes;             /**< Column memory reported to OS API */
+    int32_t gc_frame;                /**< Frame (+1) since table is empty */
+    ecs_map_t *base_cache;           /**< Refs to components of base entities */
+    uint64_t base_cache_version;     /**< World version base cache is valid for */
     uint32_t id;                     /**< Table id in sparse set */
 
     ecs_flags32_t flags;             /**< Flags for testing table properties */
     int32_t column_count;            /**< Number of data columns in table */
     int32_t sw_column_count;
     int32_t sw_column_offset;
+    int32_t bs_column_count;
+    int32_t bs_column_offset;
+    int32_t soa_column_count;
 };
 
 /* Sparse query column */
@@ -230,12 +273,28 @@ typedef struct ecs_sparse_column_t {
     int32_t signature_column_index;
 } ecs_sparse_column_t;
 
+/* Bitset query column */
+typedef struct ecs_bitset_column_t {
+    int32_t bs_column_index;       /**< Index in bitset columns of table */
+    int32_t signature_column_index;
+} ecs_bitset_column_t;
+
+/* Lookup query column for component with sparse storage */
+typedef struct ecs_lookup_column_t {
+    ecs_sparse_t *sparse;          /**< Storage of the component */
+    int32_t signature_column_index;
+    bool is_not;                   /**< Entity must not have component */
+} ecs_lookup_column_t;
+
 /** Type containing data for a table matched with a query. */
 typedef struct ecs_matched_table_t {
     ecs_iter_table_t data;         /**< Precomputed data for iterators */
     ecs_vector_t *sparse_columns;  /**< Column ids of sparse columns */
+    ecs_vector_t *bitset_columns;  /**< Column ids with disabled bitsets */
+    ecs_vector_t *lookup_columns;  /**< Columns with sparse components */
     int32_t *monitor;              /**< Used to monitor table for changes */
     int32_t rank;                  /**< Rank used to sort tables */
+    bool sort_pending;             /**< Must table be sorted next read epoch */
 } ecs_matched_table_t;
 
 /** Type storing an entity range within a table.
@@ -261,6 +320,9 @@ typedef struct ecs_table_slice_t {
 #define EcsQueryIsOrphaned (512)     /* Is subquery orphaned */
 #define EcsQueryHasOutColumns (1024) /* Does query have out columns */
 #define EcsQueryHasOptional (2048)   /* Does query have optional columns */
+#define EcsQueryHasFromEntity (4096) /* Does query have FromEntity columns */
+#define EcsQueryHasPrev (8192)       /* Does query have [prev] columns */
+#define EcsQuerySortPending (16384u) /* Was sorting postponed for read epoch */
 
 #define EcsQueryNoActivation (EcsQueryMonitor | EcsQueryOnSet | EcsQueryUnSet)
 
@@ -278,8 +340,24 @@ typedef struct ecs_query_event_t {
     ecs_query_eventkind_t kind;
     ecs_table_t *table;
     ecs_query_t *parent_query;
+    ecs_vector_t *tables;       /* Tables affected by a rematch, if known */
+    ecs_vector_t *entities;     /* Watched entities that changed, if known */
 } ecs_query_event_t;
 
+/** Slot of a table in the matched tables of a query */
+typedef struct ecs_query_table_slot_t {
+    int32_t index;              /* Index in tables or empty_tables */
+    bool active;                /* Is table stored in tables (non-empty) */
+} ecs_query_table_slot_t;
+
+/** Range of active tables and table slices of a query with the same rank */
+typedef struct ecs_query_group_t {
+    int32_t first;              /* Index of first table in tables */
+    int32_t count;              /* Number of tables in group */
+    int32_t slice_first;        /* Index of first slice in table_slices */
+    int32_t slice_count;        /* Number of slices in group */
+} ecs_query_group_t;
+
 /** Query that is automatically matched against active tables */
 struct ecs_query_t {
     /* Signature of query */
@@ -292,18 +370,27 @@ struct ecs_query_t {
     ecs_vector_t *tables;
     ecs_vector_t *empty_tables;
 
+    /* Slots of matched tables by table id. Not used by queries with traits, as
+     * these can match the same table more than once. */
+    ecs_map_t *table_slots;
+
     /* Handle to system (optional) */
     ecs_entity_t system;   
 
     /* Used for sorting */
     ecs_entity_t sort_on_component;
     ecs_compare_action_t compare;   
+    ecs_sort_key_kind_t sort_key_kind; /* Sort on key instead of compare */
+    ecs_size_t sort_key_offset;
     ecs_vector_t *table_slices;     
 
     /* Used for table sorting */
     ecs_entity_t rank_on_component;
     ecs_rank_type_action_t group_table;
 
+    /* Ranges of active tables by rank, used to iterate a single group */
+    ecs_map_t *groups;
+
     /* Subqueries */
     ecs_query_t *parent;
     ecs_vector_t *subqueries;
@@ -314,6 +401,7 @@ struct ecs_query_t {
     int32_t cascade_by;         /* Identify CASCADE column */
     int32_t match_count;        /* How often have tables been (un)matched */
     int32_t prev_match_count;   /* Used to track if sorting is needed */
+    ecs_size_t alloc_bytes;     /* Memory reported to OS API */
 };
 
 /** Keep track of how many [in] columns are active for [out] columns of OnDemand
@@ -339,6 +427,8 @@ typedef enum ecs_op_kind_t {
     EcsOpSet,
     EcsOpMut,
     EcsOpModified,
+    EcsOpEnable,
+    EcsOpDisable,
     EcsOpDelete,
     EcsOpClear
 } ecs_op_kind_t;
@@ -390,6 +480,10 @@ struct ecs_stage_t {
     ecs_vector_t *defer_queue;
     ecs_vector_t *defer_merge_queue;
 
+    /* Allocations made by the thread of the stage, merged with the global
+     * counters when the stage is merged */
+    ecs_alloc_tag_stats_t alloc_tags[EcsAllocTagCount];
+
     /* One-shot actions to be executed after the merge */
     ecs_vector_t *post_frame_actions;
 
@@ -414,6 +508,9 @@ typedef struct ecs_store_t {
     /* Table graph */
     ecs_sparse_t *tables;
     ecs_table_t root;
+
+    /* Lookup table for finding tables by type hash */
+    ecs_map_t *table_index;
 } ecs_store_t;
 
 /** Supporting type to store looked up or derived entity data */
@@ -460,6 +557,12 @@ typedef struct ecs_action_elem_t {
     void *ctx;
 } ecs_action_elem_t;
 
+/* Span recorder, implemented by profiler addon */
+typedef struct ecs_profiler_t ecs_profiler_t;
+
+/* Timing wheel, implemented by timer module */
+typedef struct ecs_timer_wheel_t ecs_timer_wheel_t;
+
 /* Alias */
 typedef struct ecs_alias_t {
     char *name;
@@ -475,6 +578,8 @@ struct ecs_world_t {
 
     ecs_c_info_t c_info[ECS_HI_COMPONENT_ID]; /* Component callbacks & triggers */
     ecs_map_t *t_info;                        /* Tag triggers */
+    ecs_vector_t *sparse_components;          /* Components in sparse sets */
+    int32_t double_buffered_count;            /* Double buffered components */
 
     /* Is entity range checking enabled? */
     bool range_check_enabled;
@@ -515,6 +620,7 @@ struct ecs_world_t {
     ecs_map_t *on_activate_components; /* Trigger on activate of [in] column */
     ecs_map_t *on_enable_components;   /* Trigger on enable of [in] column */
     ecs_vector_t *fini_tasks;          /* Tasks to execute on ecs_fini */
+    ecs_timer_wheel_t *timer_wheel;    /* Timing wheel (NULL if no timers) */
 
 
     /* -- Lookup Indices -- */
@@ -538,6 +644,11 @@ struct ecs_world_t {
     /* -- Hierarchy administration -- */
 
     ecs_map_t *child_tables;        /* Child tables per parent entity */
+    ecs_map_t *childof_index;       /* EcsChildOf children per parent entity */
+    ecs_map_t *instance_tables;     /* Instance tables per base entity */
+    ecs_vector_t *watched_changed;  /* Watched entities that changed type */
+    uint64_t base_cache_version;    /* Increases when all base caches are invalid */
+    int32_t table_gc_frames;        /* Frames before empty table is deleted */
     const char *name_prefix;        /* Remove prefix from C names in modules */
 
 
@@ -550,6 +661,7 @@ struct ecs_world_t {
     ecs_os_mutex_t sync_mutex;       /* Mutex for job_cond */
     int32_t workers_running;         /* Number of threads running */
     int32_t workers_waiting;         /* Number of workers waiting on sync */
+    struct ecs_par_job_t *par_job;   /* Parallel query job for workers */
 
 
     /* -- Time management -- */
@@ -562,6 +674,12 @@ struct ecs_world_t {
     /* -- Metrics -- */
 
     ecs_world_info_t stats;
+    ecs_profiler_t *profiler;     /* Span recorder (NULL if not enabled) */
+    bool profiler_fini_set;       /* Is fini action of profiler registered */
+    ecs_vector_t *command_queues; /* Queues with commands from other threads */
+    ecs_vector_t *spatial_indices; /* Spatial indices, freed with world */
+    ecs_map_t *component_stats;   /* Component statistics (NULL if not tracked) */
+    uint64_t frame_span;          /* Start of the span of the current frame */
 
 
     /* -- Settings from command line arguments -- */
@@ -575,6 +693,11 @@ struct ecs_world_t {
     ecs_os_mutex_t mutex;         /* Locks the world if locking enabled */
     ecs_os_mutex_t thr_sync;      /* Used to signal threads at end of frame */
     ecs_os_cond_t thr_cond;       /* Used to signal threads at end of frame */
+    ecs_os_mutex_t read_mutex;    /* Protects read epoch administration */
+    ecs_os_cond_t read_cond;      /* Signals change in readers or epoch */
+    int32_t read_count;           /* Number of threads reading the world */
+    int32_t read_epoch;           /* Incremented when world becomes readable */
+    bool read_enabled;            /* Can other threads read the world */
 
 
     /* -- World state -- */
@@ -583,6 +706,7 @@ struct ecs_world_t {
     bool quit_workers;            /* Signals worker threads to quit */
     bool in_progress;             /* Is world being progressed */
     bool is_merging;              /* Is world currently being merged */
+    bool is_fini;                 /* Is world being deleted */
     bool auto_merge;              /* Are stages auto-merged by ecs_progress */
     bool measure_frame_time;      /* Time spent on each frame */
     bool measure_system_time;     /* Time spent by each system */
@@ -592,6 +716,13 @@ struct ecs_world_t {
 
 #endif
 
+/* Storage class for thread local variables, if supported by the compiler */
+#if defined(_MSC_VER)
+#define ECS_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define ECS_THREAD_LOCAL __thread
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 //// Core bootstrap functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -618,6 +749,15 @@ ecs_type_t ecs_bootstrap_type(
     ecs_set(world, name, EcsName, {.value = &#name[ecs_os_strlen("Ecs")], .symbol = #name});\
     ecs_add_entity(world, name, ECS_CHILDOF | ecs_get_scope(world))
 
+/* Attribute (de)allocation of entity name to allocation tracking */
+#define ecs_track_name_alloc(name)\
+    ecs_os_track_alloc(EcsAllocName, 0, ecs_os_strlen(name) + 1)
+
+#define ecs_track_name_free(name)\
+    do { if (name) {\
+        ecs_os_track_alloc(EcsAllocName, ecs_os_strlen(name) + 1, 0);\
+    } } while (0)
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //// Entity API
@@ -651,6 +791,43 @@ void ecs_run_monitors(
     ecs_vector_t *v_src_monitors);
 
 
+////////////////////////////////////////////////////////////////////////////////
+//// Hierarchy API
+////////////////////////////////////////////////////////////////////////////////
+
+/* Add child to the EcsChildOf index of a parent */
+void ecs_childof_register(
+    ecs_world_t *world,
+    ecs_entity_t parent,
+    ecs_entity_t child);
+
+/* Remove entity in table row from the EcsChildOf index of its parent */
+void ecs_childof_unregister(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t row);
+
+/* Get children in the EcsChildOf index of a parent. The returned vector must
+ * be freed by the caller. */
+ecs_vector_t* ecs_childof_get_children(
+    ecs_world_t *world,
+    ecs_entity_t parent);
+
+/* Delete children that are stored in the EcsChildOf index of a parent */
+void ecs_childof_delete_children(
+    ecs_world_t *world,
+    ecs_entity_t parent);
+
+/* Rebuild the EcsChildOf index from the table data */
+void ecs_childof_index_rebuild(
+    ecs_world_t *world);
+
+/* Free the EcsChildOf index */
+void ecs_childof_index_free(
+    ecs_world_t *world);
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //// World API
 ////////////////////////////////////////////////////////////////////////////////
@@ -664,6 +841,9 @@ void ecs_notify_queries_of_table(
 ecs_stage_t *ecs_get_stage(
     ecs_world_t **world_ptr);
 
+/* Test if the current thread is reading the world with ecs_read_begin */
+bool ecs_is_reader_thread(void);
+
 /* Get component callbacks */
 ecs_c_info_t *ecs_get_c_info(
     ecs_world_t *world,
@@ -674,6 +854,11 @@ ecs_c_info_t * ecs_get_or_create_c_info(
     ecs_world_t *world,
     ecs_entity_t component);
 
+/* Get component callbacks if component has sparse storage */
+ecs_c_info_t * ecs_get_sparse_c_info(
+    ecs_world_t *world,
+    ecs_entity_t component);
+
 void ecs_eval_component_monitors(
     ecs_world_t *world);
 
@@ -686,6 +871,10 @@ void ecs_component_monitor_register(
     ecs_entity_t component,
     ecs_query_t *query);
 
+void ecs_component_monitor_unregister(
+    ecs_component_monitor_t *mon,
+    ecs_query_t *query);
+
 bool ecs_defer_op_begin(
     ecs_world_t *world,
     ecs_stage_t *stage,
@@ -707,6 +896,16 @@ void ecs_measure_system_time(
     ecs_world_t *world,
     bool enable);
 
+/* Maintain component statistics while tables change */
+void ecs_track_component_stats(
+    ecs_world_t *world,
+    bool enable);
+
+/* Get statistics of component, or NULL if not tracked */
+const ecs_component_stats_t* ecs_get_component_stats(
+    ecs_world_t *world,
+    ecs_entity_t component);
+
 void ecs_notify_tables(
     ecs_world_t *world,
     ecs_table_event_t *event);
@@ -749,6 +948,19 @@ void ecs_stage_defer_end(
     ecs_world_t *world,
     ecs_stage_t *stage);    
 
+/* Add new operation to the defer queue of the stage */
+ecs_op_t* ecs_stage_new_defer_op(
+    ecs_stage_t *stage);
+
+/* Record allocations of the current thread in the specified counters. When
+ * NULL, allocations are recorded in the global counters. */
+void ecs_os_set_thread_alloc_tags(
+    ecs_alloc_tag_stats_t *tags);
+
+/* Add counters to the global counters and reset them */
+void ecs_os_merge_alloc_tags(
+    ecs_alloc_tag_stats_t *tags);
+
 /* Delete table from stage */
 void ecs_delete_table(
     ecs_world_t *world,
@@ -768,6 +980,13 @@ bool ecs_defer_modified(
     ecs_entity_t entity,
     ecs_entity_t component);
 
+bool ecs_defer_enable(
+    ecs_world_t *world,
+    ecs_stage_t *stage,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    bool enable);
+
 bool ecs_defer_new(
     ecs_world_t *world,
     ecs_stage_t *stage,
@@ -919,6 +1138,16 @@ ecs_data_t *ecs_table_get_data(
 ecs_data_t *ecs_table_get_or_create_data(
     ecs_table_t *table);
 
+/* Get index of first field column of component column, or -1 if the column
+ * is not stored as a structure of arrays */
+int32_t ecs_table_soa_column_index(
+    ecs_table_t *table,
+    int32_t column);
+
+/* Copy current values of double buffered columns to previous frame buffers */
+void ecs_table_update_prev(
+    ecs_table_t *table);
+
 /* Initialize columns for data */
 ecs_data_t* ecs_init_data(
     ecs_world_t *world,
@@ -1038,6 +1267,28 @@ void ecs_table_free(
     ecs_world_t *world,
     ecs_table_t *table); 
 
+/* Report change in column memory of table to allocation tracking */
+void ecs_table_track_alloc(
+    ecs_table_t *table);
+
+/* Account table columns in component statistics, if they are tracked */
+void ecs_table_register_stats(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove table columns from component statistics */
+void ecs_table_unregister_stats(
+    ecs_table_t *table);
+
+/* Apply changes in column count and size to component statistics */
+void ecs_table_sync_stats(
+    ecs_table_t *table);
+
+/* Get number of bytes allocated for table data */
+ecs_size_t ecs_table_data_alloc_bytes(
+    ecs_table_t *table,
+    ecs_data_t *data);
+
 /* Merge table data */
 void ecs_table_merge_data(
     ecs_world_t *world,
@@ -1065,6 +1316,13 @@ void ecs_table_swap(
     int32_t row_1,
     int32_t row_2);
 
+/* Reorder rows so that row i contains the data of row perm[i] */
+void ecs_table_permute(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    const int32_t *perm);
+
 ecs_table_t *ecs_table_traverse_add(
     ecs_world_t *world,
     ecs_table_t *table,
@@ -1102,6 +1360,41 @@ void ecs_table_notify(
 void ecs_table_clear_edges(
     ecs_table_t *table);
 
+/* Remove table from child tables of its parents */
+void ecs_table_unregister_child(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove table from the index used to find tables by type */
+void ecs_table_index_remove(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove table from instance tables of its base entities */
+void ecs_table_unregister_instance(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove instance table administration of a base entity */
+void ecs_instance_tables_delete(
+    ecs_world_t *world,
+    ecs_entity_t base);
+
+/* Invalidate cached inherited components of tables that inherit from base */
+void ecs_invalidate_base_cache(
+    ecs_world_t *world,
+    ecs_entity_t base);
+
+/* Invalidate cached inherited components of tables that inherit from entities
+ * in the specified table */
+void ecs_table_invalidate_base_cache(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove edges to tables that are flagged as garbage */
+void ecs_table_clear_garbage_edges(
+    ecs_world_t *world);
+
 ////////////////////////////////////////////////////////////////////////////////
 //// Query API
 ////////////////////////////////////////////////////////////////////////////////
@@ -1142,6 +1435,11 @@ void ecs_query_notify(
     ecs_query_t *query,
     ecs_query_event_t *event);
 
+/* Sort tables of queries that were not sorted while other threads could read
+ * the world. Must be called before a read epoch begins. */
+void ecs_query_sort_postponed(
+    ecs_world_t *world);
+
 ////////////////////////////////////////////////////////////////////////////////
 //// Signature API
 ////////////////////////////////////////////////////////////////////////////////
@@ -1169,6 +1467,56 @@ FLECS_EXPORT
 void ecs_increase_timer_resolution(
     bool enable);
 
+////////////////////////////////////////////////////////////////////////////////
+//// Profiler API
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef FLECS_PROFILER
+
+/* Get start timestamp for a span. Returns 0 if the profiler is disabled. */
+uint64_t ecs_profiler_now(
+    ecs_world_t *world);
+
+/* Record span in ring buffer of the thread that owns the stage */
+void ecs_profiler_record(
+    ecs_world_t *world,
+    ecs_stage_t *stage,
+    ecs_span_kind_t kind,
+    ecs_entity_t id,
+    uint64_t start);
+
+/* Make sure there is a ring buffer for each worker thread */
+void ecs_profiler_set_threads(
+    ecs_world_t *world,
+    int32_t threads);
+
+#define ecs_span_begin(world)\
+    ((world)->profiler ? ecs_profiler_now(world) : 0)
+
+#define ecs_span_end(world, stage, kind, id, start)\
+    do {\
+        if (start) { ecs_profiler_record(world, stage, kind, id, start); }\
+    } while (0)
+
+#else
+
+#define ecs_span_begin(world) 0
+#define ecs_span_end(world, stage, kind, id, start) (void)(start)
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//// Command queue API
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef FLECS_COMMAND_QUEUE
+
+/* Apply commands of all command queues to the world */
+void ecs_command_queues_flush(
+    ecs_world_t *world);
+
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 //// Utilities
 ////////////////////////////////////////////////////////////////////////////////
@@ -1686,6 +2034,39 @@ const char* ecs_strerror(
     return "unknown error code";
 }
 
+/* Number of field columns for a component column */
+static
+int32_t soa_field_count(
+    ecs_table_t *table,
+    int32_t column)
+{
+    ecs_c_info_t *c_info;
+    if (!table->c_info || !(c_info = table->c_info[column])) {
+        return 0;
+    }
+
+    return ecs_vector_count(c_info->fields);
+}
+
+int32_t ecs_table_soa_column_index(
+    ecs_table_t *table,
+    int32_t column)
+{
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(column < table->column_count, ECS_INTERNAL_ERROR, NULL);
+
+    if (!table->soa_column_count || !soa_field_count(table, column)) {
+        return -1;
+    }
+
+    int32_t i, result = 0;
+    for (i = 0; i < column; i ++) {
+        result += soa_field_count(table, i);
+    }
+
+    return result;
+}
+
 ecs_data_t* ecs_init_data(
     ecs_world_t *world,
     ecs_table_t *table,
@@ -1693,9 +2074,10 @@ ecs_data_t* ecs_init_data(
 {
     ecs_type_t type = table->type; 
     int32_t i, count = table->column_count, sw_count = table->sw_column_count;
+    int32_t bs_count = table->bs_column_count;
 
     /* Root tables don't have columns */
-    if (!count && !sw_count) {
+    if (!count && !sw_count && !bs_count) {
         result->columns = NULL;
         return result;
     }
@@ -1716,6 +2098,11 @@ ecs_data_t* ecs_init_data(
         for (i = 0; i < count; i ++) {
             ecs_entity_t e = entities[i];
 
+            /* Is the column stored as a structure of arrays? */
+            if (soa_field_count(table, i)) {
+                continue;
+            }
+
             /* Is the column a component? */
             const EcsComponent *component = ecs_component_from_id(world, e);
             if (component) {
@@ -1762,6 +2149,56 @@ ecs_data_t* ecs_init_data(
         }
     }
 
+    if (bs_count) {
+        result->bs_columns = ecs_os_calloc(ECS_SIZEOF(ecs_bs_column_t) * bs_count);
+        for (i = 0; i < bs_count; i ++) {
+            ecs_bitset_init(&result->bs_columns[i].data);
+        }
+    }
+
+    int32_t soa_count = table->soa_column_count;
+    if (soa_count) {
+        result->soa_columns = ecs_os_calloc(ECS_SIZEOF(ecs_column_t) * soa_count);
+
+        int32_t soa_index = 0;
+        for (i = 0; i < count; i ++) {
+            if (!soa_field_count(table, i)) {
+                continue;
+            }
+
+            ecs_vector_each(table->c_info[i]->fields, ecs_field_t, field, {
+                ecs_column_t *column = &result->soa_columns[soa_index ++];
+                ecs_size_t size = field->size;
+
+                /* Fields have no type information, so derive the alignment
+                 * from the largest power of two that divides the size */
+                ecs_size_t alignment = size & -size;
+                if (alignment > 16) {
+                    alignment = 16;
+                }
+
+                column->size = ecs_to_i16(size);
+                column->alignment = ecs_to_i16(alignment);
+            });
+        }
+
+        ecs_assert(soa_index == soa_count, ECS_INTERNAL_ERROR, NULL);
+    }
+
+    /* Double buffered columns have a second column with the same layout. The
+     * array is indexed by column, other columns in the array stay empty. */
+    if (table->flags & EcsTableHasPrev) {
+        result->prev_columns = ecs_os_calloc(ECS_SIZEOF(ecs_column_t) * count);
+
+        for (i = 0; i < count; i ++) {
+            ecs_c_info_t *c_info = table->c_info[i];
+            if (c_info && c_info->double_buffered) {
+                result->prev_columns[i].size = result->columns[i].size;
+                result->prev_columns[i].alignment = result->columns[i].alignment;
+            }
+        }
+    }
+
     return result;
 }
 
@@ -1833,7 +2270,9 @@ void notify_component_info(
         }
 
         /* Reset lifecycle flags before recomputing */
-        table->flags &= ~EcsTableHasLifecycle;
+        ecs_flags32_t had_prev = table->flags & EcsTableHasPrev;
+        table->flags &= ~(EcsTableHasLifecycle | EcsTableHasSoa | EcsTableHasPrev);
+        int32_t soa_column_count = 0;
 
         /* Recompute lifecycle flags */
         ecs_entity_t *array = ecs_vector_first(table_type, ecs_entity_t);
@@ -1852,7 +2291,30 @@ void notify_component_info(
 
             /* Store pointer to c_info for fast access */
             table->c_info[i] = c_info;
-        }        
+
+            if (c_info && c_info->fields && i < table->column_count) {
+                soa_column_count += ecs_vector_count(c_info->fields);
+            }
+
+            if (c_info && c_info->double_buffered && i < table->column_count) {
+                table->flags |= EcsTableHasPrev;
+            }
+        }
+
+        if (soa_column_count) {
+            table->flags |= EcsTableHasSoa;
+        }
+
+        /* If a component got fields or was made double buffered after the 
+         * table was created, the table is empty and can be reinitialized with
+         * the new layout */
+        if (soa_column_count != table->soa_column_count || 
+            had_prev != (table->flags & EcsTableHasPrev)) 
+        {
+            ecs_assert(!ecs_table_count(table), ECS_INTERNAL_ERROR, NULL);
+            ecs_table_clear_data(table, table->data);
+            table->soa_column_count = soa_column_count;
+        }
     }
 }
 
@@ -2064,6 +2526,11 @@ void ecs_table_activate(
     ecs_query_t *query,
     bool activate)
 {
+    /* Table is no longer empty, reset garbage collection counter */
+    if (activate) {
+        table->gc_frame = 0;
+    }
+
     if (query) {
         ecs_query_notify(world, query, &(ecs_query_event_t) {
             .kind = activate ? EcsQueryTableNonEmpty : EcsQueryTableEmpty,
@@ -2158,6 +2625,57 @@ void unregister_query(
     }
 }
 
+/* Remove a query from a list of matched queries. The order of the remaining
+ * elements is preserved, as some lists are sorted. */
+static
+void remove_matched_query(
+    ecs_vector_t **array,
+    ecs_query_t *query)
+{
+    ecs_matched_query_t *elems = ecs_vector_first(*array, ecs_matched_query_t);
+    int32_t i, count = ecs_vector_count(*array), keep = 0;
+    for (i = 0; i < count; i ++) {
+        if (elems[i].query != query) {
+            elems[keep ++] = elems[i];
+        }
+    }
+
+    if (keep != count) {
+        ecs_vector_set_count(array, ecs_matched_query_t, keep);
+    }
+}
+
+/* This function is called when a query is freed. The query is removed from all
+ * lists of the table, including the lists of OnSet and UnSet systems. */
+static
+void free_query(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_query_t *query)
+{
+    (void)world;
+
+    int32_t i, count = ecs_vector_count(table->queries);
+    ecs_query_t **queries = ecs_vector_first(table->queries, ecs_query_t*);
+    for (i = 0; i < count; i ++) {
+        if (queries[i] == query) {
+            ecs_vector_remove_index(table->queries, ecs_query_t*, i);
+            break;
+        }
+    }
+
+    remove_matched_query(&table->monitors, query);
+    remove_matched_query(&table->on_set_all, query);
+    remove_matched_query(&table->on_set_override, query);
+    remove_matched_query(&table->un_set_all, query);
+
+    if (table->on_set) {
+        for (i = 0; i < table->column_count; i ++) {
+            remove_matched_query(&table->on_set[i], query);
+        }
+    }
+}
+
 static
 ecs_data_t* get_data_intern(
     ecs_table_t *table,
@@ -2301,31 +2819,220 @@ void ecs_table_clear_data(
         data->sw_columns = NULL;
     }
 
+    ecs_bs_column_t *bs_columns = data->bs_columns;
+    if (bs_columns) {
+        int32_t c, column_count = table->bs_column_count;
+        for (c = 0; c < column_count; c ++) {
+            ecs_bitset_deinit(&bs_columns[c].data);
+        }
+        ecs_os_free(bs_columns);
+        data->bs_columns = NULL;
+    }
+
+    ecs_column_t *soa_columns = data->soa_columns;
+    if (soa_columns) {
+        int32_t c, column_count = table->soa_column_count;
+        for (c = 0; c < column_count; c ++) {
+            ecs_vector_free(soa_columns[c].data);
+        }
+        ecs_os_free(soa_columns);
+        data->soa_columns = NULL;
+    }
+
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (prev_columns) {
+        int32_t c, column_count = table->column_count;
+        for (c = 0; c < column_count; c ++) {
+            ecs_vector_free(prev_columns[c].data);
+        }
+        ecs_os_free(prev_columns);
+        data->prev_columns = NULL;
+    }
+
     ecs_vector_free(data->entities);
     ecs_vector_free(data->record_ptrs);
 
     data->entities = NULL;
     data->record_ptrs = NULL;
+
+    ecs_table_track_alloc(table);
+    ecs_table_sync_stats(table);
 }
 
-/* Clear columns. Deactivate table in systems if necessary, but do not invoke
- * OnRemove handlers. This is typically used when restoring a table to a
- * previous state. */
-void ecs_table_clear_silent(
-    ecs_world_t * world,
-    ecs_table_t * table)
+ecs_size_t ecs_table_data_alloc_bytes(
+    ecs_table_t *table,
+    ecs_data_t *data)
 {
-    ecs_data_t *data = ecs_table_get_data(table);
-    if (!data) {
-        return;
-    }
+    ecs_size_t result = 
+        ecs_vector_size(data->entities) * ECS_SIZEOF(ecs_entity_t) +
+        ecs_vector_size(data->record_ptrs) * ECS_SIZEOF(ecs_record_t*);
 
-    int32_t count = ecs_vector_count(data->entities);
-    
-    ecs_table_clear_data(table, table->data);
+    ecs_column_t *columns = data->columns;
+    if (columns) {
+        int32_t c, column_count = table->column_count;
+        for (c = 0; c < column_count; c ++) {
+            result += ecs_vector_size(columns[c].data) * columns[c].size;
+        }
 
-    if (count) {
-        ecs_table_activate(world, table, 0, false);
+        /* Tables with switch columns store the case values as columns */
+        if (table->sw_column_count) {
+            column_count = ecs_vector_count(table->type);
+        }
+
+        result += column_count * ECS_SIZEOF(ecs_column_t);
+    }
+
+    ecs_bs_column_t *bs_columns = data->bs_columns;
+    if (bs_columns) {
+        int32_t c, column_count = table->bs_column_count;
+        for (c = 0; c < column_count; c ++) {
+            result += bs_columns[c].data.size / 8;
+        }
+    }
+
+    ecs_column_t *soa_columns = data->soa_columns;
+    if (soa_columns) {
+        int32_t c, column_count = table->soa_column_count;
+        for (c = 0; c < column_count; c ++) {
+            result += ecs_vector_size(soa_columns[c].data) * soa_columns[c].size;
+        }
+
+        result += column_count * ECS_SIZEOF(ecs_column_t);
+    }
+
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (prev_columns) {
+        int32_t c, column_count = table->column_count;
+        for (c = 0; c < column_count; c ++) {
+            result += ecs_vector_size(prev_columns[c].data) * prev_columns[c].size;
+        }
+
+        result += column_count * ECS_SIZEOF(ecs_column_t);
+    }
+
+    return result;
+}
+
+void ecs_table_track_alloc(
+    ecs_table_t *table)
+{
+    ecs_size_t bytes = 0;
+    if (table->data) {
+        bytes = ecs_table_data_alloc_bytes(table, table->data);
+    }
+
+    ecs_os_track_alloc(EcsAllocColumns, table->alloc_bytes, bytes);
+    table->alloc_bytes = bytes;
+}
+
+void ecs_table_register_stats(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    ecs_map_t *component_stats = world->component_stats;
+    int32_t c, column_count = table->column_count;
+    if (!component_stats || !column_count || table->column_stats) {
+        return;
+    }
+
+    ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
+    ecs_column_stats_t *column_stats = ecs_os_calloc(
+        ECS_SIZEOF(ecs_column_stats_t) * column_count);
+
+    for (c = 0; c < column_count; c ++) {
+        ecs_component_stats_t *stats = ecs_map_get_ptr(
+            component_stats, ecs_component_stats_t*, components[c]);
+        if (!stats) {
+            stats = ecs_os_calloc(ECS_SIZEOF(ecs_component_stats_t));
+            ecs_map_set(component_stats, components[c], &stats);
+        }
+
+        stats->tables_count ++;
+        column_stats[c].stats = stats;
+    }
+
+    table->column_stats = column_stats;
+
+    ecs_table_sync_stats(table);
+}
+
+void ecs_table_unregister_stats(
+    ecs_table_t *table)
+{
+    ecs_column_stats_t *column_stats = table->column_stats;
+    if (!column_stats) {
+        return;
+    }
+
+    int32_t c, column_count = table->column_count;
+    for (c = 0; c < column_count; c ++) {
+        ecs_component_stats_t *stats = column_stats[c].stats;
+        stats->tables_count --;
+        stats->entities_count -= column_stats[c].count;
+        stats->used_bytes -= column_stats[c].used_bytes;
+        stats->allocd_bytes -= column_stats[c].allocd_bytes;
+    }
+
+    ecs_os_free(column_stats);
+    table->column_stats = NULL;
+}
+
+void ecs_table_sync_stats(
+    ecs_table_t *table)
+{
+    ecs_column_stats_t *column_stats = table->column_stats;
+    if (!column_stats) {
+        return;
+    }
+
+    ecs_data_t *data = table->data;
+    ecs_column_t *columns = data ? data->columns : NULL;
+
+    /* Only apply the difference with the values that were accounted for the
+     * last time, so that the cost does not depend on the number of tables */
+    int32_t c, column_count = table->column_count;
+    for (c = 0; c < column_count; c ++) {
+        ecs_column_stats_t *cs = &column_stats[c];
+        int32_t count = 0, used_bytes = 0, allocd_bytes = 0;
+
+        if (columns) {
+            ecs_column_t *column = &columns[c];
+            count = ecs_vector_count(column->data);
+            ecs_vector_memory_t(column->data, column->size, column->alignment,
+                &allocd_bytes, &used_bytes);
+        }
+
+        ecs_component_stats_t *stats = cs->stats;
+        stats->entities_count += count - cs->count;
+        stats->used_bytes += used_bytes - cs->used_bytes;
+        stats->allocd_bytes += allocd_bytes - cs->allocd_bytes;
+        cs->count = count;
+        cs->used_bytes = used_bytes;
+        cs->allocd_bytes = allocd_bytes;
+    }
+}
+
+/* Clear columns. Deactivate table in systems if necessary, but do not invoke
+ * OnRemove handlers. This is typically used when restoring a table to a
+ * previous state. */
+void ecs_table_clear_silent(
+    ecs_world_t * world,
+    ecs_table_t * table)
+{
+    ecs_data_t *data = ecs_table_get_data(table);
+    if (!data) {
+        return;
+    }
+
+    int32_t count = ecs_vector_count(data->entities);
+
+    /* Entities in the table could be bases */
+    ecs_table_invalidate_base_cache(world, table);
+    
+    ecs_table_clear_data(table, table->data);
+
+    if (count) {
+        ecs_table_activate(world, table, 0, false);
     }
 }
 
@@ -2341,6 +3048,10 @@ void ecs_table_clear(
         run_remove_actions(
             world, table, data, 0, ecs_table_data_count(data), false);
 
+        /* Entities in the table could be bases, invalidate before the entities
+         * are removed from the entity index */
+        ecs_table_invalidate_base_cache(world, table);
+
         ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
         int32_t i, count = ecs_vector_count(data->entities);
         for(i = 0; i < count; i ++) {
@@ -2377,11 +3088,18 @@ void ecs_table_free(
             world, table, data, 0, ecs_table_data_count(data), false);
     }
 
+    ecs_table_unregister_stats(table);
     ecs_table_clear_data(table, table->data);
     ecs_table_clear_edges(table);
+
+    if (table->lo_edges) {
+        ecs_os_track_alloc(EcsAllocEdges, 
+            ECS_SIZEOF(ecs_edge_t) * ECS_HI_COMPONENT_ID, 0);
+    }
     
     ecs_os_free(table->lo_edges);
     ecs_map_free(table->hi_edges);
+    ecs_map_free(table->base_cache);
     ecs_vector_free(table->queries);
     ecs_vector_free((ecs_vector_t*)table->type);
     ecs_os_free(table->dirty_state);
@@ -2493,6 +3211,168 @@ void move_switch_columns(
     }
 }
 
+static
+void move_bitset_columns(
+    ecs_table_t * new_table, 
+    ecs_data_t * new_data, 
+    int32_t new_index,
+    ecs_table_t * old_table, 
+    ecs_data_t * old_data, 
+    int32_t old_index,
+    int32_t count)
+{
+    int32_t i_old = 0, old_column_count = old_table->bs_column_count;
+    int32_t i_new = 0, new_column_count = new_table->bs_column_count;
+
+    if (!old_column_count || !new_column_count) {
+        return;
+    }
+
+    ecs_bs_column_t *old_columns = old_data->bs_columns;
+    ecs_bs_column_t *new_columns = new_data->bs_columns;
+
+    ecs_type_t new_type = new_table->type;
+    ecs_type_t old_type = old_table->type;
+
+    int32_t offset_new = new_table->bs_column_offset;
+    int32_t offset_old = old_table->bs_column_offset;
+
+    ecs_entity_t *new_components = ecs_vector_first(new_type, ecs_entity_t);
+    ecs_entity_t *old_components = ecs_vector_first(old_type, ecs_entity_t);
+
+    for (; (i_new < new_column_count) && (i_old < old_column_count);) {
+        ecs_entity_t new_component = new_components[i_new + offset_new];
+        ecs_entity_t old_component = old_components[i_old + offset_old];
+
+        if (new_component == old_component) {
+            ecs_bitset_t *old_bs = &old_columns[i_old].data;
+            ecs_bitset_t *new_bs = &new_columns[i_new].data;
+
+            ecs_bitset_ensure(new_bs, new_index + count);
+
+            int i;
+            for (i = 0; i < count; i ++) {
+                bool value = ecs_bitset_get(old_bs, old_index + i);
+                ecs_bitset_set(new_bs, new_index + i, value);
+            }
+        }
+
+        i_new += new_component <= old_component;
+        i_old += new_component >= old_component;
+    }
+}
+
+static
+void move_soa_columns(
+    ecs_table_t * new_table, 
+    ecs_data_t * new_data, 
+    int32_t new_index,
+    ecs_table_t * old_table, 
+    ecs_data_t * old_data, 
+    int32_t old_index,
+    int32_t count)
+{
+    if (!old_table->soa_column_count || !new_table->soa_column_count) {
+        return;
+    }
+
+    ecs_column_t *old_columns = old_data->soa_columns;
+    ecs_column_t *new_columns = new_data->soa_columns;
+
+    ecs_entity_t *new_components = ecs_vector_first(new_table->type, ecs_entity_t);
+    ecs_entity_t *old_components = ecs_vector_first(old_table->type, ecs_entity_t);
+
+    int32_t i_new = 0, new_column_count = new_table->column_count;
+    int32_t i_old = 0, old_column_count = old_table->column_count;
+    int32_t soa_new = 0, soa_old = 0;
+
+    for (; (i_new < new_column_count) && (i_old < old_column_count);) {
+        ecs_entity_t new_component = new_components[i_new];
+        ecs_entity_t old_component = old_components[i_old];
+        int32_t new_fields = soa_field_count(new_table, i_new);
+        int32_t old_fields = soa_field_count(old_table, i_old);
+
+        if (new_component == old_component) {
+            ecs_assert(new_fields == old_fields, ECS_INTERNAL_ERROR, NULL);
+
+            int32_t f;
+            for (f = 0; f < new_fields; f ++) {
+                ecs_column_t *new_column = &new_columns[soa_new + f];
+                ecs_column_t *old_column = &old_columns[soa_old + f];
+                int16_t size = new_column->size;
+                int16_t alignment = new_column->alignment;
+
+                void *dst = ecs_vector_get_t(
+                    new_column->data, size, alignment, new_index);
+                void *src = ecs_vector_get_t(
+                    old_column->data, size, alignment, old_index);
+
+                ecs_assert(dst != NULL, ECS_INTERNAL_ERROR, NULL);
+                ecs_assert(src != NULL, ECS_INTERNAL_ERROR, NULL);
+                ecs_os_memcpy(dst, src, size * count);
+            }
+        }
+
+        if (new_component <= old_component) {
+            soa_new += new_fields;
+            i_new ++;
+        }
+        if (new_component >= old_component) {
+            soa_old += old_fields;
+            i_old ++;
+        }
+    }
+}
+
+static
+void move_prev_columns(
+    ecs_table_t * new_table, 
+    ecs_data_t * new_data, 
+    int32_t new_index,
+    ecs_table_t * old_table, 
+    ecs_data_t * old_data, 
+    int32_t old_index,
+    int32_t count)
+{
+    ecs_column_t *old_columns = old_data->prev_columns;
+    ecs_column_t *new_columns = new_data->prev_columns;
+    if (!old_columns || !new_columns) {
+        return;
+    }
+
+    ecs_entity_t *new_components = ecs_vector_first(new_table->type, ecs_entity_t);
+    ecs_entity_t *old_components = ecs_vector_first(old_table->type, ecs_entity_t);
+
+    int32_t i_new = 0, new_column_count = new_table->column_count;
+    int32_t i_old = 0, old_column_count = old_table->column_count;
+
+    for (; (i_new < new_column_count) && (i_old < old_column_count);) {
+        ecs_entity_t new_component = new_components[i_new];
+        ecs_entity_t old_component = old_components[i_old];
+
+        if (new_component == old_component) {
+            ecs_column_t *new_column = &new_columns[i_new];
+            ecs_column_t *old_column = &old_columns[i_old];
+            int16_t size = new_column->size;
+
+            if (size && old_column->size) {
+                int16_t alignment = new_column->alignment;
+                void *dst = ecs_vector_get_t(
+                    new_column->data, size, alignment, new_index);
+                void *src = ecs_vector_get_t(
+                    old_column->data, size, alignment, old_index);
+
+                ecs_assert(dst != NULL, ECS_INTERNAL_ERROR, NULL);
+                ecs_assert(src != NULL, ECS_INTERNAL_ERROR, NULL);
+                ecs_os_memcpy(dst, src, size * count);
+            }
+        }
+
+        i_new += new_component <= old_component;
+        i_old += new_component >= old_component;
+    }
+}
+
 static
 void ensure_data(
     ecs_world_t * world,
@@ -2505,16 +3385,17 @@ void ensure_data(
 {
     int32_t column_count = table->column_count;
     int32_t sw_column_count = table->sw_column_count;
+    int32_t bs_column_count = table->bs_column_count;
     ecs_column_t *columns = NULL;
     ecs_sw_column_t *sw_columns = NULL;
 
     /* It is possible that the table data was created without content. 
      * Now that data is going to be written to the table, initialize */ 
-    if (column_count | sw_column_count) {
+    if (column_count | sw_column_count | bs_column_count) {
         columns = data->columns;
         sw_columns = data->sw_columns;
 
-        if (!columns && !sw_columns) {
+        if (!columns && !sw_columns && !data->bs_columns) {
             ecs_init_data(world, table, data);
             columns = data->columns;
             sw_columns = data->sw_columns;
@@ -2601,6 +3482,41 @@ void grow_column(
         ECS_INTERNAL_ERROR, NULL);
 }
 
+/* Add elements to double buffered columns. Entities that are added to the
+ * table have no value for the previous frame, so new elements are zero'd. */
+static
+void grow_prev_columns(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_data_t * data,
+    int32_t to_add,
+    int32_t size)
+{
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (!prev_columns) {
+        return;
+    }
+
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+    int32_t i, column_count = table->column_count;
+    for (i = 0; i < column_count; i ++) {
+        ecs_column_t *column = &prev_columns[i];
+        int16_t size_elem = column->size;
+        if (!size_elem) {
+            continue;
+        }
+
+        grow_column(world, entities, column, NULL, to_add, size, false);
+
+        if (to_add) {
+            int32_t count = ecs_vector_count(column->data);
+            void *elem = ecs_vector_get_t(
+                column->data, size_elem, column->alignment, count - to_add);
+            ecs_os_memset(elem, 0, size_elem * to_add);
+        }
+    }
+}
+
 static
 int32_t grow_data(
     ecs_world_t * world,
@@ -2671,6 +3587,22 @@ int32_t grow_data(
         ecs_switch_addn(sw, to_add);
     }
 
+    /* Add elements to each bitset column */
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_addn(&data->bs_columns[i].data, to_add);
+    }
+
+    /* Add elements to each field column */
+    int32_t soa_column_count = table->soa_column_count;
+    for (i = 0; i < soa_column_count; i ++) {
+        grow_column(world, entities, &data->soa_columns[i], NULL, to_add, 
+            size, false);
+    }
+
+    /* Add elements to each double buffered column */
+    grow_prev_columns(world, table, data, to_add, size);
+
     /* If the table is monitored indicate that there has been a change */
     mark_table_dirty(table, 0);
 
@@ -2679,6 +3611,8 @@ int32_t grow_data(
     }
 
     table->alloc_count ++;
+    ecs_table_track_alloc(table);
+    ecs_table_sync_stats(table);
 
     /* Return index of first added entity */
     return cur_count;
@@ -2712,6 +3646,8 @@ int32_t ecs_table_append(
     ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    world->stats.table_append_count_total ++;
+
     /* Get count & size before growing entities array. This tells us whether the
      * arrays will realloc */
     int32_t count = ecs_vector_count(data->entities);
@@ -2731,7 +3667,8 @@ int32_t ecs_table_append(
 
     /* Keep track of alloc count. This allows references to check if cached
      * pointers need to be updated. */  
-    table->alloc_count += (count == size);
+    bool realloc = count == size;
+    table->alloc_count += realloc;
 
     /* Add record ptr to array with record ptrs */
     ecs_record_t **r = ecs_vector_add(&data->record_ptrs, ecs_record_t*);
@@ -2752,6 +3689,10 @@ int32_t ecs_table_append(
     /* Fast path: no switch columns, no lifecycle actions */
     if (!(table->flags & EcsTableIsComplex)) {
         fast_append(columns, column_count);
+        if (realloc) {
+            ecs_table_track_alloc(table);
+        }
+        ecs_table_sync_stats(table);
         return count;
     }
 
@@ -2795,6 +3736,28 @@ int32_t ecs_table_append(
         columns[i + table->sw_column_offset].data = ecs_switch_values(sw);
     }
 
+    /* Add element to each bitset column */
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_addn(&data->bs_columns[i].data, 1);
+    }
+
+    /* Add element to each field column */
+    int32_t soa_column_count = table->soa_column_count;
+    for (i = 0; i < soa_column_count; i ++) {
+        grow_column(world, entities, &data->soa_columns[i], NULL, 1, size, 
+            false);
+    }
+
+    /* Add element to each double buffered column */
+    grow_prev_columns(world, table, data, 1, size);
+
+    if (realloc) {
+        ecs_table_track_alloc(table);
+    }
+
+    ecs_table_sync_stats(table);
+
     return count;
 }
 
@@ -2838,6 +3801,8 @@ void ecs_table_delete(
     ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    world->stats.table_remove_count_total ++;
+
     ecs_vector_t *entity_column = data->entities;
     int32_t count = ecs_vector_count(entity_column);
 
@@ -2896,6 +3861,7 @@ void ecs_table_delete(
         } else {
             fast_delete(columns, column_count, index);
         }
+        ecs_table_sync_stats(table);
         return;
     }
 
@@ -2950,6 +3916,33 @@ void ecs_table_delete(
     for (i = 0; i < sw_column_count; i ++) {
         ecs_switch_remove(sw_columns[i].data, index);
     }
+
+    /* Remove elements from bitset columns */
+    ecs_bs_column_t *bs_columns = data->bs_columns;
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_remove(&bs_columns[i].data, index);
+    }
+
+    /* Move last element of field columns to index */
+    ecs_column_t *soa_columns = data->soa_columns;
+    int32_t soa_column_count = table->soa_column_count;
+    if (index == count) {
+        fast_delete_last(soa_columns, soa_column_count);
+    } else {
+        fast_delete(soa_columns, soa_column_count, index);
+    }
+
+    /* Move last element of double buffered columns to index */
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (prev_columns) {
+        if (index == count) {
+            fast_delete_last(prev_columns, column_count);
+        } else {
+            fast_delete(prev_columns, column_count, index);
+        }
+    }
+    ecs_table_sync_stats(table);
 }
 
 static
@@ -3011,6 +4004,8 @@ void ecs_table_move(
     ecs_assert(new_table != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(old_table != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    world->stats.table_move_count_total ++;
+
     ecs_assert(old_index >= 0, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(new_index >= 0, ECS_INTERNAL_ERROR, NULL);
 
@@ -3025,6 +4020,15 @@ void ecs_table_move(
     move_switch_columns(
         new_table, new_data, new_index, old_table, old_data, old_index, 1);
 
+    move_bitset_columns(
+        new_table, new_data, new_index, old_table, old_data, old_index, 1);
+
+    move_soa_columns(
+        new_table, new_data, new_index, old_table, old_data, old_index, 1);
+
+    move_prev_columns(
+        new_table, new_data, new_index, old_table, old_data, old_index, 1);
+
     bool same_entity = dst_entity == src_entity;
 
     ecs_type_t new_type = new_table->type;
@@ -3124,6 +4128,7 @@ int32_t ecs_table_appendn(
     const ecs_entity_t *ids)
 {
     int32_t cur_count = ecs_table_data_count(data);
+    world->stats.table_append_count_total += to_add;
     return grow_data(world, table, data, to_add, cur_count + to_add, ids);
 }
 
@@ -3146,6 +4151,8 @@ void ecs_table_set_size(
         ecs_sw_column_t *sw_columns;
         ensure_data(world, table, data, &column_count, &sw_column_count, 
             &columns, &sw_columns);
+        ecs_table_track_alloc(table);
+        ecs_table_sync_stats(table);
     }
 }
 
@@ -3225,10 +4232,223 @@ void ecs_table_swap(
         }
     }
 
+    /* Swap bitset columns */
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_swap(&data->bs_columns[i].data, row_1, row_2);
+    }
+
+    /* Swap field columns */
+    int32_t soa_column_count = table->soa_column_count;
+    for (i = 0; i < soa_column_count; i ++) {
+        ecs_column_t *column = &data->soa_columns[i];
+        int16_t size = column->size;
+        void *ptr = ecs_vector_first_t(column->data, size, column->alignment);
+        void *tmp = ecs_os_alloca(size);
+
+        void *el_1 = ECS_OFFSET(ptr, size * row_1);
+        void *el_2 = ECS_OFFSET(ptr, size * row_2);
+
+        ecs_os_memcpy(tmp, el_1, size);
+        ecs_os_memcpy(el_1, el_2, size);
+        ecs_os_memcpy(el_2, tmp, size);
+    }
+
+    /* Swap double buffered columns */
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (prev_columns) {
+        for (i = 0; i < column_count; i ++) {
+            ecs_column_t *column = &prev_columns[i];
+            int16_t size = column->size;
+            if (!size) {
+                continue;
+            }
+
+            void *ptr = ecs_vector_first_t(column->data, size, column->alignment);
+            void *tmp = ecs_os_alloca(size);
+
+            void *el_1 = ECS_OFFSET(ptr, size * row_1);
+            void *el_2 = ECS_OFFSET(ptr, size * row_2);
+
+            ecs_os_memcpy(tmp, el_1, size);
+            ecs_os_memcpy(el_1, el_2, size);
+            ecs_os_memcpy(el_2, tmp, size);
+        }
+    }
+
     /* If the table is monitored indicate that there has been a change */
     mark_table_dirty(table, 0);    
 }
 
+static
+void permute_column(
+    ecs_column_t *column,
+    const int32_t *perm,
+    int32_t count,
+    void *tmp)
+{
+    int16_t size = column->size;
+    if (!size) {
+        return;
+    }
+
+    void *ptr = ecs_vector_first_t(column->data, size, column->alignment);
+
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        ecs_os_memcpy(ECS_OFFSET(tmp, size * i), 
+            ECS_OFFSET(ptr, size * perm[i]), size);
+    }
+
+    ecs_os_memcpy(ptr, tmp, size * count);
+}
+
+void ecs_table_permute(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_data_t * data,
+    const int32_t *perm)
+{
+    (void)world;
+
+    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(perm != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t i, count = ecs_table_data_count(data);
+    if (count < 2) {
+        return;
+    }
+
+    /* Allocate a single buffer that fits each of the columns */
+    int32_t column_count = table->column_count;
+    ecs_column_t *columns = data->columns;
+    ecs_size_t max_size = ECS_SIZEOF(uint64_t);
+    for (i = 0; i < column_count; i ++) {
+        if (columns[i].size > max_size) {
+            max_size = columns[i].size;
+        }
+    }
+
+    int32_t soa_column_count = table->soa_column_count;
+    for (i = 0; i < soa_column_count; i ++) {
+        if (data->soa_columns[i].size > max_size) {
+            max_size = data->soa_columns[i].size;
+        }
+    }
+
+    void *tmp = ecs_os_malloc(max_size * count);
+    ecs_assert(tmp != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    /* Permute entities and update the rows stored in the entity index */
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+    ecs_record_t **record_ptrs = ecs_vector_first(
+        data->record_ptrs, ecs_record_t*);
+
+    ecs_entity_t *tmp_entities = tmp;
+    for (i = 0; i < count; i ++) {
+        tmp_entities[i] = entities[perm[i]];
+    }
+    ecs_os_memcpy(entities, tmp, ECS_SIZEOF(ecs_entity_t) * count);
+
+    ecs_record_t **tmp_records = tmp;
+    for (i = 0; i < count; i ++) {
+        tmp_records[i] = record_ptrs[perm[i]];
+    }
+    ecs_os_memcpy(record_ptrs, tmp, ECS_SIZEOF(ecs_record_t*) * count);
+
+    for (i = 0; i < count; i ++) {
+        ecs_record_t *record = record_ptrs[i];
+        ecs_assert(record != NULL, ECS_INTERNAL_ERROR, NULL);
+        record->row = ecs_row_to_record(i, record->row < 0);
+    }
+
+    /* Permute columns. The values of switch columns are owned by the switch,
+     * which also maintains per-case lists, so they are set one by one. */
+    int32_t sw_offset = table->sw_column_offset;
+    int32_t sw_column_count = table->sw_column_count;
+
+    for (i = 0; i < column_count; i ++) {
+        if (i >= sw_offset && i < sw_offset + sw_column_count) {
+            continue;
+        }
+        permute_column(&columns[i], perm, count, tmp);
+    }
+
+    int32_t j;
+    for (i = 0; i < sw_column_count; i ++) {
+        ecs_switch_t *sw = data->sw_columns[i].data;
+        uint64_t *values = tmp;
+        for (j = 0; j < count; j ++) {
+            values[j] = ecs_switch_get(sw, perm[j]);
+        }
+        for (j = 0; j < count; j ++) {
+            ecs_switch_set(sw, j, values[j]);
+        }
+    }
+
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_t *bs = &data->bs_columns[i].data;
+        bool *values = tmp;
+        for (j = 0; j < count; j ++) {
+            values[j] = ecs_bitset_get(bs, perm[j]);
+        }
+        for (j = 0; j < count; j ++) {
+            ecs_bitset_set(bs, j, values[j]);
+        }
+    }
+
+    for (i = 0; i < soa_column_count; i ++) {
+        permute_column(&data->soa_columns[i], perm, count, tmp);
+    }
+
+    if (data->prev_columns) {
+        for (i = 0; i < column_count; i ++) {
+            permute_column(&data->prev_columns[i], perm, count, tmp);
+        }
+    }
+
+    ecs_os_free(tmp);
+
+    /* If the table is monitored indicate that there has been a change */
+    mark_table_dirty(table, 0);
+}
+
+void ecs_table_update_prev(
+    ecs_table_t * table)
+{
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_data_t *data = table->data;
+    if (!data || !data->prev_columns) {
+        return;
+    }
+
+    ecs_column_t *columns = data->columns;
+    ecs_column_t *prev_columns = data->prev_columns;
+    int32_t i, column_count = table->column_count;
+    int32_t count = ecs_vector_count(data->entities);
+
+    for (i = 0; i < column_count; i ++) {
+        ecs_column_t *column = &prev_columns[i];
+        int16_t size = column->size;
+        if (!size) {
+            continue;
+        }
+
+        /* Resize in case rows were written without going through the table
+         * operations, as is the case for deserialized tables */
+        int16_t alignment = column->alignment;
+        ecs_vector_set_count_t(&column->data, size, alignment, count);
+
+        if (count) {
+            void *dst = ecs_vector_first_t(column->data, size, alignment);
+            void *src = ecs_vector_first_t(columns[i].data, size, alignment);
+            ecs_os_memcpy(dst, src, size * count);
+        }
+    }
+}
+
 static
 void merge_vector(
     ecs_vector_t ** dst_out,
@@ -3375,6 +4595,34 @@ void merge_table_data(
     move_switch_columns(
         new_table, new_data, new_count, old_table, old_data, 0, old_count);
 
+    /* Grow bitset columns, new elements are enabled by default */
+    int32_t b, bs_column_count = new_table->bs_column_count;
+    for (b = 0; b < bs_column_count; b ++) {
+        ecs_bitset_ensure(
+            &new_data->bs_columns[b].data, old_count + new_count);
+    }
+
+    move_bitset_columns(
+        new_table, new_data, new_count, old_table, old_data, 0, old_count);
+
+    /* Grow field columns, new elements are not initialized */
+    int32_t f, soa_column_count = new_table->soa_column_count;
+    for (f = 0; f < soa_column_count; f ++) {
+        ecs_column_t *column = &new_data->soa_columns[f];
+        ecs_vector_set_count_t(&column->data, column->size, column->alignment, 
+            old_count + new_count);
+    }
+
+    move_soa_columns(
+        new_table, new_data, new_count, old_table, old_data, 0, old_count);
+
+    /* Grow double buffered columns, new elements have no previous value */
+    grow_prev_columns(world, new_table, new_data, old_count, 
+        ecs_vector_size(new_data->entities));
+
+    move_prev_columns(
+        new_table, new_data, new_count, old_table, old_data, 0, old_count);
+
     /* Initialize remaining columns */
     for (; i_new < new_component_count; i_new ++) {
         ecs_column_t *column = &new_columns[i_new];
@@ -3493,6 +4741,12 @@ ecs_data_t* ecs_table_merge(
     }
 
     new_table->alloc_count ++;
+    ecs_table_track_alloc(new_table);
+    ecs_table_sync_stats(new_table);
+    if (new_table != old_table) {
+        ecs_table_track_alloc(old_table);
+        ecs_table_sync_stats(old_table);
+    }
 
     if (!new_count && old_count) {
         ecs_table_activate(world, new_table, NULL, true);
@@ -3510,6 +4764,9 @@ void ecs_table_replace_data(
     ecs_data_t *table_data = table->data;
     ecs_assert(!data || data != table_data, ECS_INTERNAL_ERROR, NULL);
 
+    /* Entities in the table could be bases */
+    world->base_cache_version ++;
+
     if (table_data) {
         prev_count = ecs_vector_count(table_data->entities);
         run_remove_actions(
@@ -3520,6 +4777,8 @@ void ecs_table_replace_data(
     if (data) {
         table_data = ecs_table_get_or_create_data(table);
         *table_data = *data;
+        ecs_table_track_alloc(table);
+        ecs_table_sync_stats(table);
     } else {
         return;
     }
@@ -3611,6 +4870,10 @@ void ecs_table_notify(
         unregister_query(
             world, table, event->query);
         break;
+    case EcsTableQueryFree:
+        free_query(
+            world, table, event->query);
+        break;
     case EcsTableComponentInfo:
         notify_component_info(world, table, event->component);
         break;
@@ -3866,6 +5129,7 @@ void run_component_trigger_for_entities(
         for (i = 0; i < trigger_count; i ++) {
             it.system = triggers[i].self;
             it.param = triggers[i].ctx;
+            it.ctx = triggers[i].ctx;
             triggers[i].action(&it);
         }
     }
@@ -4137,6 +5401,144 @@ void instantiate_children(
     }    
 }
 
+/* Fill array with count copies of an element. Each memcpy doubles the number
+ * of initialized elements. */
+static
+void fill_repeated(
+    void * dst,
+    const void * src,
+    ecs_size_t size,
+    int32_t count)
+{
+    ecs_os_memcpy(dst, src, size);
+
+    int32_t filled = 1;
+    while (filled < count) {
+        int32_t n = count - filled;
+        if (n > filled) {
+            n = filled;
+        }
+
+        ecs_os_memcpy(ECS_OFFSET(dst, size * filled), dst, size * n);
+        filled += n;
+    }
+}
+
+/* Instantiate children of a base that store their parent in EcsChildOf. As the
+ * parent is not part of the type, the children of all instances are stored in
+ * the same table, which allows for creating them with a single new_w_data. 
+ * Children are created in child-major order, so that the instances of each
+ * base child occupy a contiguous range of rows. */
+static
+void instantiate_childof_children(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_data_t * data,
+    int32_t row,
+    int32_t count,
+    ecs_table_t * child_table,
+    ecs_entity_t * children,
+    int32_t child_count)
+{
+    ecs_type_t type = child_table->type;
+    ecs_data_t *child_data = ecs_table_get_data(child_table);
+    ecs_assert(child_data != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t column_count = child_table->column_count;
+    ecs_entity_t *type_array = ecs_vector_first(type, ecs_entity_t);
+    int32_t type_count = ecs_vector_count(type);
+    int32_t total = count * child_count;
+
+    ecs_entities_t components = {
+        .array = ecs_os_alloca(ECS_SIZEOF(ecs_entity_t) * (type_count + 1))
+    };
+
+    void **c_info = ecs_os_alloca(ECS_SIZEOF(void*) * (type_count + 1));
+    ecs_os_memset(c_info, 0, ECS_SIZEOF(void*) * (type_count + 1));
+
+    int32_t *child_rows = ecs_os_alloca(ECS_SIZEOF(int32_t) * child_count);
+    int32_t i, j, pos = 0;
+    for (j = 0; j < child_count; j ++) {
+        ecs_record_t *r = ecs_eis_get(world, children[j]);
+        ecs_assert(r != NULL, ECS_INTERNAL_ERROR, NULL);
+        ecs_assert(r->table == child_table, ECS_INTERNAL_ERROR, NULL);
+        bool is_watched;
+        child_rows[j] = ecs_record_to_row(r->row, &is_watched);
+    }
+
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+
+    for (i = 0; i < type_count; i ++) {
+        ecs_entity_t c = type_array[i];
+        
+        /* Make sure instances don't have EcsPrefab */
+        if (c == EcsPrefab) {
+            continue;
+        }
+
+        if (i < column_count) {
+            ecs_column_t *column = &child_data->columns[i];
+            ecs_size_t size = column->size;
+            if (size) {
+                void *src = ecs_vector_first_t(
+                    column->data, size, column->alignment);
+                void *buffer = ecs_os_malloc(size * total);
+                ecs_assert(buffer != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+                /* Component data is copied bitwise into the buffer, which is
+                 * only used as source for new_w_data and freed without
+                 * invoking destructors */
+                for (j = 0; j < child_count; j ++) {
+                    fill_repeated(ECS_OFFSET(buffer, size * j * count), 
+                        ECS_OFFSET(src, size * child_rows[j]), size, count);
+                }
+
+                /* Point children to the instances */
+                if (c == ecs_typeid(EcsChildOf)) {
+                    EcsChildOf *parents = buffer;
+                    for (j = 0; j < child_count; j ++) {
+                        int32_t k;
+                        for (k = 0; k < count; k ++) {
+                            parents[j * count + k].parent = entities[row + k];
+                        }
+                    }
+                }
+
+                c_info[pos] = buffer;
+            }
+        }
+
+        components.array[pos] = c;
+        pos ++;
+    }
+
+    /* If children are added to a prefab, make sure they are prefabs too */
+    if (table->flags & EcsTableIsPrefab) {
+        components.array[pos] = EcsPrefab;
+        pos ++;
+    }
+
+    components.count = pos;
+
+    ecs_table_t *i_table = ecs_table_find_or_create(world, &components);
+    ecs_assert(i_table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t child_row;
+    new_w_data(world, i_table, &components, total, c_info, &child_row);
+
+    for (i = 0; i < pos; i ++) {
+        ecs_os_free(c_info[i]);
+    }
+
+    /* If base children have children themselves, recursively instantiate. All
+     * instances of a base child are instantiated at once. */
+    ecs_data_t *i_data = ecs_table_get_data(i_table);
+    for (j = 0; j < child_count; j ++) {
+        instantiate(world, children[j], i_table, i_data, 
+            child_row + j * count, count);
+    }
+}
+
 static
 void instantiate(
     ecs_world_t * world,
@@ -4156,6 +5558,33 @@ void instantiate(
                 world, base, table, data, row, count, *child_table_ptr);
         });
     }
+
+    /* Instantiate children that store base in EcsChildOf, per child table */
+    ecs_vector_t *children = ecs_childof_get_children(world, base);
+    ecs_entity_t *child_array = ecs_vector_first(children, ecs_entity_t);
+    int32_t i, child_count = ecs_vector_count(children);
+
+    for (i = 0; i < child_count; i ++) {
+        ecs_table_t *child_table = ecs_eis_get(world, child_array[i])->table;
+
+        /* Move children in the same table to the front of the array */
+        int32_t j, table_count = 0;
+        for (j = i; j < child_count; j ++) {
+            ecs_entity_t child = child_array[j];
+            if (ecs_eis_get(world, child)->table == child_table) {
+                child_array[j] = child_array[i + table_count];
+                child_array[i + table_count] = child;
+                table_count ++;
+            }
+        }
+
+        instantiate_childof_children(world, table, data, row, count, 
+            child_table, &child_array[i], table_count);
+        
+        i += table_count - 1;
+    }
+
+    ecs_vector_free(children);
 }
 
 static
@@ -4716,6 +6145,18 @@ void commit(
     * component from, for example, a container. */
     if (info->is_watched) {
         update_component_monitors(world, entity, added, removed);
+
+        /* Keep track of which watched entities changed, so that queries only
+         * have to rematch the tables that depend on them */
+        if (added || removed) {
+            ecs_entity_t *elem = ecs_vector_add(
+                &world->watched_changed, ecs_entity_t);
+            *elem = entity;
+        }
+
+        /* The entity could be a base, so invalidate cached base components
+         * of the tables that inherit from it */
+        ecs_invalidate_base_cache(world, entity);
     }
 
     if ((!src_table || !src_table->type) && world->range_check_enabled) {
@@ -4729,7 +6170,8 @@ void* get_base_component(
     ecs_world_t * world,
     ecs_stage_t * stage,
     ecs_entity_info_t * info,
-    ecs_entity_t component)
+    ecs_entity_t component,
+    ecs_entity_t * base_out)
 {
     ecs_type_t type = info->table->type;
     ecs_entity_t *type_buffer = ecs_vector_first(type, ecs_entity_t);
@@ -4741,9 +6183,11 @@ void* get_base_component(
         ecs_entity_info_t prefab_info;
         if (ecs_get_info(world, prefab, &prefab_info) && prefab_info.table) {
             ptr = get_component(&prefab_info, component);
-            if (!ptr) {
+            if (ptr) {
+                *base_out = prefab;
+            } else {
                 ptr = get_base_component(
-                    world, stage, &prefab_info, component);
+                    world, stage, &prefab_info, component, base_out);
             }
         }
     }
@@ -4751,32 +6195,214 @@ void* get_base_component(
     return ptr;
 }
 
+/* Test if a ref still points to the current location of its entity, without
+ * updating the ref */
 static
-void new(
-    ecs_world_t * world,
-    ecs_entity_t entity,
-    ecs_entities_t * to_add)
+bool ref_is_valid(
+    ecs_ref_t *ref)
 {
-    ecs_entity_info_t info = {0};
-    ecs_table_t *table = ecs_table_traverse_add(
-        world, world->stage.scope_table, to_add, NULL);
-    new_entity(world, entity, &info, table, to_add);
+    ecs_record_t *record = ref->record;
+    ecs_table_t *table = record->table;
+    return table && ref->table == table && ref->row == record->row && 
+        ref->alloc_count == table->alloc_count;
 }
 
+/* Get a component that a table inherits from a base. The table caches a ref
+ * to the base that provides the component, which avoids walking the prefab
+ * chain on every lookup. The cache is discarded when the type of a base 
+ * changes. While worker threads are running or while other threads may read
+ * the world the cache is only read. The read_enabled flag is only written by
+ * the thread that progresses the world, which is the only thread besides the
+ * readers that can get here while it is set. */
 static
-const ecs_entity_t* new_w_data(
+void* get_inherited_component(
     ecs_world_t * world,
-    ecs_table_t * table,
-    ecs_entities_t * component_ids,
-    int32_t count,
-    void ** component_data,
-    int32_t * row_out)
+    ecs_stage_t * stage,
+    ecs_entity_info_t * info,
+    ecs_entity_t component)
 {
-    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(count != 0, ECS_INTERNAL_ERROR, NULL);
-    
-    int32_t sparse_count = ecs_eis_count(world);
+    ecs_table_t *table = info->table;
+    bool readonly = ecs_is_reader_thread() || (world->in_progress && 
+        (ecs_vector_count(world->workers) || world->read_enabled));
+
+    if (table->base_cache_version != world->base_cache_version) {
+        if (!readonly) {
+            if (table->base_cache) {
+                ecs_map_clear(table->base_cache);
+            }
+            table->base_cache_version = world->base_cache_version;
+        }
+    } else {
+        ecs_ref_t *ref = ecs_map_get(table->base_cache, ecs_ref_t, component);
+        if (ref) {
+            if (!ref->entity) {
+                /* None of the bases has the component */
+                return NULL;
+            }
+
+            if (ref_is_valid(ref)) {
+                return (void*)ref->ptr;
+            }
+
+            if (!readonly) {
+                return (void*)ecs_get_ref_w_entity(world, ref, 0, 0);
+            }
+        }
+    }
+
+    ecs_entity_t base = 0;
+    void *ptr = get_base_component(world, stage, info, component, &base);
+
+    if (!readonly) {
+        if (!table->base_cache) {
+            table->base_cache = ecs_map_new(ecs_ref_t, 1);
+        }
+
+        ecs_ref_t ref = {0};
+        if (base) {
+            ecs_get_ref_w_entity(world, &ref, base, component);
+        }
+
+        ecs_map_set(table->base_cache, component, &ref);
+    }
+
+    return ptr;
+}
+
+static
+void* sparse_get_mut(
+    ecs_world_t * world,
+    ecs_entity_t entity,
+    ecs_c_info_t * c_info,
+    bool * is_added)
+{
+    void *ptr = _ecs_sparse_get_sparse(c_info->sparse, 0, entity);
+    bool added = false;
+
+    if (!ptr) {
+        ptr = _ecs_sparse_get_or_create(c_info->sparse, 0, entity);
+        ecs_assert(ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        /* Removing an element increases its generation in the sparse set.
+         * Make sure the element is alive for the current entity id. */
+        ecs_sparse_set_generation(c_info->sparse, entity);
+
+        ecs_xtor_t ctor = c_info->lifecycle.ctor;
+        if (ctor) {
+            ctor(world, c_info->component, &entity, ptr, 
+                ecs_to_size_t(c_info->size), 1, c_info->lifecycle.ctx);
+        }
+
+        added = true;
+    }
+
+    if (is_added) {
+        *is_added = added;
+    }
+
+    return ptr;
+}
+
+static
+void sparse_remove(
+    ecs_world_t * world,
+    ecs_entity_t entity,
+    ecs_c_info_t * c_info)
+{
+    void *ptr = _ecs_sparse_get_sparse(c_info->sparse, 0, entity);
+    if (ptr) {
+        ecs_xtor_t dtor = c_info->lifecycle.dtor;
+        if (dtor) {
+            dtor(world, c_info->component, &entity, ptr, 
+                ecs_to_size_t(c_info->size), 1, c_info->lifecycle.ctx);
+        }
+
+        ecs_sparse_remove(c_info->sparse, entity);
+    }
+}
+
+/* Add or remove components with sparse storage. The components that are stored
+ * in tables are copied to the buffer and returned. */
+static
+ecs_entities_t sparse_add_remove(
+    ecs_world_t * world,
+    ecs_entity_t entity,
+    ecs_entities_t * components,
+    ecs_entity_t * buffer,
+    bool remove)
+{
+    if (!world->sparse_components) {
+        return *components;
+    }
+
+    ecs_assert(components->count < ECS_MAX_ADD_REMOVE, 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_entities_t result = { .array = buffer };
+    int32_t i, count = components->count;
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = components->array[i];
+        ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, e);
+        if (!c_info) {
+            buffer[result.count ++] = e;
+        } else if (remove) {
+            sparse_remove(world, entity, c_info);
+        } else {
+            sparse_get_mut(world, entity, c_info, NULL);
+        }
+    }
+
+    return result;
+}
+
+/* Remove entity from all sparse storages */
+static
+void sparse_clear(
+    ecs_world_t * world,
+    ecs_entity_t entity)
+{
+    ecs_vector_each(world->sparse_components, ecs_entity_t, c_ptr, {
+        sparse_remove(world, entity, ecs_get_c_info(world, *c_ptr));
+    });
+}
+
+static
+void new(
+    ecs_world_t * world,
+    ecs_entity_t entity,
+    ecs_entities_t * to_add)
+{
+    ecs_entity_info_t info = {0};
+    ecs_entity_t buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entities_t components = sparse_add_remove(
+        world, entity, to_add, buffer, false);
+
+    ecs_table_t *table = ecs_table_traverse_add(
+        world, world->stage.scope_table, &components, NULL);
+
+    /* Entity may only have sparse components */
+    if (!table->type) {
+        ecs_eis_set(world, entity, &(ecs_record_t){ 0 });
+        return;
+    }
+
+    new_entity(world, entity, &info, table, &components);
+}
+
+static
+const ecs_entity_t* new_w_data(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entities_t * component_ids,
+    int32_t count,
+    void ** component_data,
+    int32_t * row_out)
+{
+    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(count != 0, ECS_INTERNAL_ERROR, NULL);
+    
+    int32_t sparse_count = ecs_eis_count(world);
     const ecs_entity_t *ids = ecs_sparse_new_ids(world->store.entity_index, count);
     ecs_assert(ids != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_type_t type = table->type;
@@ -4842,7 +6468,8 @@ const ecs_entity_t* new_w_data(
             ecs_c_info_t *cdata = get_c_info(world, c);
             ecs_copy_t copy;
             if (cdata && (copy = cdata->lifecycle.copy)) {
-                ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+                ecs_entity_t *entities = ecs_vector_get(
+                    data->entities, ecs_entity_t, row);
                 copy(world, c, entities, entities, ptr, src_ptr, 
                     ecs_to_size_t(size), count, cdata->lifecycle.ctx);
             } else {
@@ -4885,6 +6512,30 @@ bool has_type(
     }
 
     ecs_world_t *world_arg = world;
+    ecs_get_stage(&world);
+
+    /* Sparse components are not stored in the entity type, so if the type
+     * contains a sparse component, test each component separately */
+    if (world->sparse_components) {
+        bool has_sparse = false;
+        ecs_vector_each(type, ecs_entity_t, c_ptr, {
+            if (ecs_get_sparse_c_info(world, *c_ptr)) {
+                has_sparse = true;
+            }
+        });
+
+        if (has_sparse) {
+            ecs_vector_each(type, ecs_entity_t, c_ptr, {
+                bool has = ecs_has_entity(world_arg, entity, *c_ptr);
+                if (has == match_any) {
+                    return has;
+                }
+            });
+
+            return !match_any;
+        }
+    }
+
     ecs_type_t entity_type = ecs_get_type(world_arg, entity);
 
     return ecs_type_contains(
@@ -4910,13 +6561,20 @@ void add_remove(
     ecs_entities_t added = { .array = add_buffer };
     ecs_entities_t removed = { .array = remove_buffer };
 
+    ecs_entity_t sparse_add_buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entity_t sparse_remove_buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entities_t table_add = sparse_add_remove(
+        world, entity, to_add, sparse_add_buffer, false);
+    ecs_entities_t table_remove = sparse_add_remove(
+        world, entity, to_remove, sparse_remove_buffer, true);
+
     ecs_table_t *src_table = info.table;
 
     ecs_table_t *dst_table = ecs_table_traverse_remove(
-        world, src_table, to_remove, &removed);
+        world, src_table, &table_remove, &removed);
 
     dst_table = ecs_table_traverse_add(
-        world, dst_table, to_add, &added);    
+        world, dst_table, &table_add, &added);    
 
     commit(world, entity, &info, dst_table, &added, &removed);
 }
@@ -4971,6 +6629,10 @@ void add_entities(
         return;
     }
 
+    ecs_entity_t sparse_buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entities_t table_add = sparse_add_remove(
+        world, entity, components, sparse_buffer, false);
+
     ecs_entity_info_t info;
     ecs_get_info(world, entity, &info);
 
@@ -4979,7 +6641,7 @@ void add_entities(
 
     ecs_table_t *src_table = info.table;
     ecs_table_t *dst_table = ecs_table_traverse_add(
-        world, src_table, components, &added);
+        world, src_table, &table_add, &added);
 
     commit(world, entity, &info, dst_table, &added, NULL);
 
@@ -5000,6 +6662,10 @@ void remove_entities(
         return;
     }
 
+    ecs_entity_t sparse_buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entities_t table_remove = sparse_add_remove(
+        world, entity, components, sparse_buffer, true);
+
     ecs_entity_info_t info;
     ecs_get_info(world, entity, &info);
 
@@ -5008,7 +6674,7 @@ void remove_entities(
 
     ecs_table_t *src_table = info.table;
     ecs_table_t *dst_table = ecs_table_traverse_remove(
-        world, src_table, components, &removed);
+        world, src_table, &table_remove, &removed);
 
     commit(world, entity, &info, dst_table, NULL, &removed);
 
@@ -5027,6 +6693,12 @@ void *get_mutable(
     ecs_assert(component != 0, ECS_INVALID_PARAMETER, NULL);
     ecs_assert((component & ECS_COMPONENT_MASK) == component || ECS_HAS_ROLE(component, TRAIT), ECS_INVALID_PARAMETER, NULL);
 
+    ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, component);
+    if (c_info) {
+        ecs_get_info(world, entity, info);
+        return sparse_get_mut(world, entity, c_info, is_added);
+    }
+
     void *dst = NULL;
     if (ecs_get_info(world, entity, info) && info->table) {
         dst = get_component(info, component);
@@ -5061,6 +6733,90 @@ void *get_mutable(
     }
 }
 
+/* Get component info if component is stored as a structure of arrays */
+static
+ecs_c_info_t* get_soa_c_info(
+    ecs_world_t * world,
+    ecs_entity_t component)
+{
+    if (!component || (component & ECS_ROLE_MASK)) {
+        return NULL;
+    }
+
+    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
+    if (c_info && c_info->fields) {
+        return c_info;
+    }
+
+    return NULL;
+}
+
+/* Get pointer to field of component stored as a structure of arrays */
+static
+void* get_soa_field(
+    ecs_entity_info_t * info,
+    ecs_entity_t component,
+    int32_t field)
+{
+    ecs_table_t *table = info->table;
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t column = ecs_type_index_of(table->type, component);
+    if (column == -1) {
+        return NULL;
+    }
+
+    int32_t soa_index = ecs_table_soa_column_index(table, column);
+    ecs_assert(soa_index != -1, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(field >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(field < ecs_vector_count(table->c_info[column]->fields), 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_column_t *soa_column = &info->data->soa_columns[soa_index + field];
+    int16_t size = soa_column->size;
+    void *ptr = ecs_vector_first_t(soa_column->data, size, soa_column->alignment);
+    ecs_assert(ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    return ECS_OFFSET(ptr, info->row * size);
+}
+
+/* Scatter component value to the fields of a structure of arrays component */
+static
+void set_soa_fields(
+    ecs_world_t * world,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    ecs_c_info_t * c_info,
+    ecs_entity_info_t * info,
+    const void * ptr)
+{
+    if (!ecs_get_info(world, entity, info) || !info->table ||
+        ecs_type_index_of(info->table->type, component) == -1)
+    {
+        ecs_entities_t to_add = {
+            .array = &component,
+            .count = 1
+        };
+
+        add_entities_w_info(world, entity, info, &to_add);
+        ecs_get_info(world, entity, info);
+    }
+
+    int32_t i, count = ecs_vector_count(c_info->fields);
+    ecs_field_t *fields = ecs_vector_first(c_info->fields, ecs_field_t);
+    for (i = 0; i < count; i ++) {
+        void *dst = get_soa_field(info, component, i);
+        ecs_assert(dst != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        if (ptr) {
+            ecs_os_memcpy(dst, ECS_OFFSET(ptr, fields[i].offset), 
+                fields[i].size);
+        } else {
+            ecs_os_memset(dst, 0, fields[i].size);
+        }
+    }
+}
+
 /* -- Private functions -- */
 
 int32_t ecs_record_to_row(
@@ -5310,6 +7066,10 @@ void ecs_clear(
         return;
     }
 
+    if (world->sparse_components) {
+        sparse_clear(world, entity);
+    }
+
     ecs_entity_info_t info;
     info.table = NULL;
 
@@ -5363,6 +7123,8 @@ void ecs_delete_children(
     }
 
     ecs_map_remove(world->child_tables, parent);
+
+    ecs_childof_delete_children(world, parent);
 }
 
 void ecs_delete(
@@ -5377,6 +7139,10 @@ void ecs_delete(
         return;
     }
 
+    if (world->sparse_components) {
+        sparse_clear(world, entity);
+    }
+
     ecs_record_t *r = ecs_sparse_remove_get(
         world->store.entity_index, ecs_record_t, entity);
     if (r) {
@@ -5384,11 +7150,17 @@ void ecs_delete(
         set_info_from_record(entity, &info, r);
         if (info.is_watched) {
             ecs_delete_children(world, entity);
+            ecs_invalidate_base_cache(world, entity);
+            ecs_instance_tables_delete(world, entity);
         }
 
         /* If entity has components, remove them */
         ecs_table_t *table = info.table;
         if (table) {
+            if (table->flags & EcsTableHasChildOf) {
+                ecs_childof_unregister(world, table, info.data, info.row);
+            }
+
             ecs_type_t type = table->type;
             ecs_entities_t to_remove = ecs_type_to_entities(type);
             delete_entity(world, table, info.data, info.row, &to_remove);
@@ -5517,6 +7289,11 @@ const void* ecs_get_w_entity(
 
     ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INTERNAL_ERROR, NULL);
 
+    ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, component);
+    if (c_info) {
+        return _ecs_sparse_get_sparse(c_info->sparse, 0, entity);
+    }
+
     bool found = ecs_get_info(world, entity, &info);
     if (found) {
         if (!info.table) {
@@ -5525,8 +7302,11 @@ const void* ecs_get_w_entity(
 
         ptr = get_component(&info, component);
         if (!ptr) {
-            if (component != ecs_typeid(EcsName) && component != EcsPrefab) {
-                ptr = get_base_component(
+            if (component != ecs_typeid(EcsName) && 
+                component != ecs_typeid(EcsChildOf) && 
+                component != EcsPrefab) 
+            {
+                ptr = get_inherited_component(
                     world, stage, &info, component);
             }
         }        
@@ -5535,6 +7315,27 @@ const void* ecs_get_w_entity(
     return ptr;
 }
 
+const void* ecs_get_field_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    int32_t field)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_get_stage(&world);
+
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(get_soa_c_info(world, component) != NULL, 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_entity_info_t info;
+    if (!ecs_get_info(world, entity, &info) || !info.table) {
+        return NULL;
+    }
+
+    return get_soa_field(&info, component, field);
+}
+
 const void* ecs_get_ref_w_entity(
     ecs_world_t * world,
     ecs_ref_t * ref,
@@ -5620,7 +7421,9 @@ void ecs_modified_w_entity(
     }
 
     ecs_entity_info_t info = {0};
-    if (ecs_get_info(world, entity, &info)) {
+    if (!ecs_get_sparse_c_info(world, component) && 
+        ecs_get_info(world, entity, &info)) 
+    {
         ecs_entities_t added = {
             .array = &component,
             .count = 1
@@ -5665,6 +7468,13 @@ ecs_entity_t assign_ptr_w_entity(
 
     ecs_entity_info_t info;
 
+    ecs_c_info_t *soa_info = get_soa_c_info(world, component);
+    if (soa_info) {
+        /* Components with fields have no lifecycle actions */
+        set_soa_fields(world, entity, component, soa_info, &info, ptr);
+        goto done;
+    }
+
     void *dst = get_mutable(world, entity, component, &info, NULL);
 
     /* This can no longer happen since we defer operations */
@@ -5698,11 +7508,15 @@ ecs_entity_t assign_ptr_w_entity(
         memset(dst, 0, size);
     }
 
-    ecs_table_mark_dirty(info.table, component);
+done:
+    /* OnSet systems are not invoked for components with sparse storage */
+    if (!ecs_get_sparse_c_info(world, component)) {
+        ecs_table_mark_dirty(info.table, component);
 
-    if (notify) {
-        ecs_run_set_systems(world, &added, 
-            info.table, info.data, info.row, 1, false);
+        if (notify) {
+            ecs_run_set_systems(world, &added, 
+                info.table, info.data, info.row, 1, false);
+        }
     }
 
     ecs_defer_flush(world, stage);
@@ -5750,39 +7564,134 @@ ecs_entity_t ecs_get_case(
     return ecs_switch_get(sw, info.row);  
 }
 
-bool ecs_has_entity(
+void ecs_enable_component_w_entity(
     ecs_world_t *world,
     ecs_entity_t entity,
-    ecs_entity_t component)
+    ecs_entity_t component,
+    bool enable)
 {
-    if (ECS_HAS_ROLE(component, CASE)) {
-        ecs_entity_info_t info;
-        ecs_table_t *table;
-        if (!ecs_get_info(world, entity, &info) || !(table = info.table)) {
-            return false;
-        }
-
-        int32_t index = ecs_table_switch_from_case(world, table, component);
-        ecs_assert(index < table->sw_column_count, ECS_INTERNAL_ERROR, NULL);
-        
-        ecs_data_t *data = info.data;
-        ecs_switch_t *sw = data->sw_columns[index].data;
-        ecs_entity_t value = ecs_switch_get(sw, info.row);
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component != 0, ECS_INVALID_PARAMETER, NULL);
 
-        return value == (component & ECS_COMPONENT_MASK);
-    } else {
-        ecs_type_t type = ecs_get_type(world, entity);
-        return ecs_type_has_entity(world, type, component);
+    ecs_stage_t *stage = ecs_get_stage(&world);
+    if (ecs_defer_enable(world, stage, entity, component, enable)) {
+        return;
     }
-}
 
-bool ecs_has_type(
-    ecs_world_t *world,
-    ecs_entity_t entity,
-    ecs_type_t type)
-{
-    return has_type(world, entity, type, true, true);
-}
+    ecs_entity_t bs_id = (component & ECS_COMPONENT_MASK) | ECS_DISABLED;
+
+    ecs_entity_info_t info;
+    ecs_get_info(world, entity, &info);
+
+    ecs_table_t *table = info.table;
+    int32_t index = -1;
+    if (table) {
+        index = ecs_type_index_of(table->type, bs_id);
+    }
+
+    if (index == -1) {
+        /* Components are enabled by default, so if the entity doesn't have a
+         * bitset for the component yet, only add it when disabling. */
+        if (enable) {
+            goto done;
+        }
+
+        ecs_entities_t to_add = { .array = &bs_id, .count = 1 };
+        add_entities_w_info(world, entity, &info, &to_add);
+        
+        ecs_get_info(world, entity, &info);
+        table = info.table;
+        index = ecs_type_index_of(table->type, bs_id);
+        ecs_assert(index != -1, ECS_INTERNAL_ERROR, NULL);
+    }
+
+    index -= table->bs_column_offset;
+    ecs_assert(index >= 0, ECS_INTERNAL_ERROR, NULL);
+
+    /* Data cannot be NULL, since entity is stored in the table */
+    ecs_assert(info.data != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_bitset_t *bs = &info.data->bs_columns[index].data;
+    ecs_bitset_set(bs, info.row, enable);
+
+done:
+    ecs_defer_flush(world, stage);
+}
+
+bool ecs_is_component_enabled_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component != 0, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_entity_info_t info;
+    ecs_table_t *table;
+    if (!ecs_get_info(world, entity, &info) || !(table = info.table)) {
+        return false;
+    }
+
+    ecs_entity_t bs_id = (component & ECS_COMPONENT_MASK) | ECS_DISABLED;
+
+    ecs_type_t type = table->type;
+    int32_t index = ecs_type_index_of(type, bs_id);
+    if (index == -1) {
+        /* If table does not have DISABLED column for component, component is
+         * always enabled, if the entity has it */
+        return ecs_has_entity(world, entity, component);
+    }
+
+    index -= table->bs_column_offset;
+    ecs_assert(index >= 0, ECS_INTERNAL_ERROR, NULL);
+
+    /* Data cannot be NULL, since entity is stored in the table */
+    ecs_assert(info.data != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_bitset_t *bs = &info.data->bs_columns[index].data;
+
+    return ecs_bitset_get(bs, info.row);
+}
+
+bool ecs_has_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component)
+{
+    if (ECS_HAS_ROLE(component, CASE)) {
+        ecs_entity_info_t info;
+        ecs_table_t *table;
+        if (!ecs_get_info(world, entity, &info) || !(table = info.table)) {
+            return false;
+        }
+
+        int32_t index = ecs_table_switch_from_case(world, table, component);
+        ecs_assert(index < table->sw_column_count, ECS_INTERNAL_ERROR, NULL);
+        
+        ecs_data_t *data = info.data;
+        ecs_switch_t *sw = data->sw_columns[index].data;
+        ecs_entity_t value = ecs_switch_get(sw, info.row);
+
+        return value == (component & ECS_COMPONENT_MASK);
+    } else {
+        ecs_get_stage(&world);
+        ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, component);
+        if (c_info) {
+            return _ecs_sparse_get_sparse(c_info->sparse, 0, entity) != NULL;
+        }
+
+        ecs_type_t type = ecs_get_type(world, entity);
+        return ecs_type_has_entity(world, type, component);
+    }
+}
+
+bool ecs_has_type(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_type_t type)
+{
+    return has_type(world, entity, type, true, true);
+}
 
 ecs_entity_t ecs_get_parent_w_entity(
     ecs_world_t *world,
@@ -5791,6 +7700,13 @@ ecs_entity_t ecs_get_parent_w_entity(
 {
     ecs_type_t type = ecs_get_type(world, entity);    
     ecs_entity_t parent = ecs_find_in_type(world, type, component, ECS_CHILDOF);
+    if (!parent) {
+        const EcsChildOf *ptr = ecs_get(world, entity, EcsChildOf);
+        if (ptr && (!component || ecs_has_entity(world, ptr->parent, component))) {
+            parent = ptr->parent;
+        }
+    }
+
     return parent;
 }
 
@@ -6011,6 +7927,9 @@ const char* ecs_role_str(
     } else
     if (ECS_HAS_ROLE(entity, OWNED)) {
         return "OWNED";
+    } else
+    if (ECS_HAS_ROLE(entity, DISABLED)) {
+        return "DISABLED";
     } else {
         return "UNKNOWN";
     }
@@ -6054,6 +7973,15 @@ size_t ecs_entity_str(
     return required;
 }
 
+/* Allocations of deferred operations are recorded when the operation is added
+ * to the queue, and freed when the queue is flushed or the op is discarded */
+static
+void track_defer_free(
+    ecs_size_t size)
+{
+    ecs_os_track_alloc(EcsAllocDefer, size, 0);
+}
+
 static
 void flush_bulk_new(
     ecs_world_t * world,
@@ -6086,6 +8014,7 @@ void flush_bulk_new(
     }
 
     if (op->components.count > 1) {
+        track_defer_free(op->components.count * ECS_SIZEOF(ecs_entity_t));
         ecs_os_free(op->components.array);
     }
 
@@ -6100,11 +8029,13 @@ void discard_op(
 
     void *value = op->is._1.value;
     if (value) {
+        track_defer_free(op->is._1.size);
         ecs_os_free(value);
     }
 
     ecs_entity_t *components = op->components.array;
     if (components) {
+        track_defer_free(op->components.count * ECS_SIZEOF(ecs_entity_t));
         ecs_os_free(components);
     }
 }
@@ -6129,6 +8060,42 @@ bool valid_components(
 }
 
 /* Leave safe section. Run all deferred commands. */
+/* Deferred operations are counted when they are flushed, which always happens
+ * on the main thread. This prevents worker threads from having to update
+ * shared counters. */
+static
+void count_defer_op(
+    ecs_world_t *world,
+    ecs_op_t *op)
+{
+    ecs_world_info_t *stats = &world->stats;
+
+    switch(op->kind) {
+    case EcsOpNew:
+    case EcsOpClone:
+    case EcsOpBulkNew:
+        stats->defer_new_count_total ++;
+        break;
+    case EcsOpAdd:
+        stats->defer_add_count_total ++;
+        break;
+    case EcsOpRemove:
+        stats->defer_remove_count_total ++;
+        break;
+    case EcsOpSet:
+    case EcsOpMut:
+    case EcsOpModified:
+    case EcsOpEnable:
+    case EcsOpDisable:
+        stats->defer_set_count_total ++;
+        break;
+    case EcsOpDelete:
+    case EcsOpClear:
+        stats->defer_delete_count_total ++;
+        break;
+    }
+}
+
 void ecs_defer_flush(
     ecs_world_t * world,
     ecs_stage_t * stage)
@@ -6137,6 +8104,7 @@ void ecs_defer_flush(
         ecs_vector_t *defer_queue = stage->defer_queue;
         stage->defer_queue = NULL;
         if (defer_queue) {
+            uint64_t span = ecs_span_begin(world);
             ecs_op_t *ops = ecs_vector_first(defer_queue, ecs_op_t);
             int32_t i, count = ecs_vector_count(defer_queue);
             
@@ -6147,6 +8115,8 @@ void ecs_defer_flush(
                     e = 0;
                 }
 
+                count_defer_op(world, op);
+
                 /* If entity is no longer alive, this could be because the queue
                  * contained both a delete and a subsequent add/remove/set which
                  * should be ignored. */
@@ -6157,6 +8127,8 @@ void ecs_defer_flush(
                     continue;
                 }
 
+                world->stats.defer_flush_count_total ++;
+
                 if (op->components.count == 1) {
                     op->components.array = &op->component;
                 }
@@ -6193,6 +8165,12 @@ void ecs_defer_flush(
                 case EcsOpModified:
                     ecs_modified_w_entity(world, e, op->component);
                     break;
+                case EcsOpEnable:
+                    ecs_enable_component_w_entity(world, e, op->component, true);
+                    break;
+                case EcsOpDisable:
+                    ecs_enable_component_w_entity(world, e, op->component, false);
+                    break;
                 case EcsOpDelete: {
                     ecs_delete(world, e);
                     break;
@@ -6209,25 +8187,38 @@ void ecs_defer_flush(
                 }
 
                 if (op->components.count > 1) {
+                    track_defer_free(
+                        op->components.count * ECS_SIZEOF(ecs_entity_t));
                     ecs_os_free(op->components.array);
                 }
 
                 if (op->is._1.value) {
+                    track_defer_free(op->is._1.size);
                     ecs_os_free(op->is._1.value);
                 }
             };
 
             if (defer_queue != stage->defer_merge_queue) {
+                track_defer_free(
+                    ecs_vector_size(defer_queue) * ECS_SIZEOF(ecs_op_t));
                 ecs_vector_free(defer_queue);
             }
+
+            ecs_span_end(world, stage, EcsSpanDeferFlush, 0, span);
         }
     }
 }
 
-static
-ecs_op_t* new_defer_op(ecs_stage_t *stage) {
+ecs_op_t* ecs_stage_new_defer_op(
+    ecs_stage_t *stage) 
+{
+    ecs_size_t size = ecs_vector_size(stage->defer_queue);
     ecs_op_t *result = ecs_vector_add(&stage->defer_queue, ecs_op_t);
     ecs_os_memset(result, 0, ECS_SIZEOF(ecs_op_t));
+
+    ecs_os_track_alloc(EcsAllocDefer, size * ECS_SIZEOF(ecs_op_t), 
+        ecs_vector_size(stage->defer_queue) * ECS_SIZEOF(ecs_op_t));
+
     return result;
 }
 
@@ -6247,6 +8238,7 @@ void new_defer_component_ids(
     } else if (components_count) {
         ecs_size_t array_size = components_count * ECS_SIZEOF(ecs_entity_t);
         op->components.array = ecs_os_malloc(array_size);
+        ecs_os_track_alloc(EcsAllocDefer, 0, array_size);
         ecs_os_memcpy(op->components.array, components->array, array_size);
         op->components.count = components_count;
     } else {
@@ -6270,7 +8262,7 @@ bool defer_add_remove(
             }
         }
 
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = op_kind;
         op->scope = scope;
         op->is._1.entity = entity;
@@ -6302,7 +8294,7 @@ bool ecs_defer_modified(
 {
     (void)world;
     if (stage->defer) {
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpModified;
         op->component = component;
         op->is._1.entity = entity;
@@ -6314,6 +8306,27 @@ bool ecs_defer_modified(
     return false;
 }
 
+bool ecs_defer_enable(
+    ecs_world_t *world,
+    ecs_stage_t *stage,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    bool enable)
+{
+    (void)world;
+    if (stage->defer) {
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
+        op->kind = enable ? EcsOpEnable : EcsOpDisable;
+        op->component = component;
+        op->is._1.entity = entity;
+        return true;
+    } else {
+        stage->defer ++;
+    }
+    
+    return false;
+}
+
 bool ecs_defer_clone(
     ecs_world_t *world,
     ecs_stage_t *stage,
@@ -6323,7 +8336,7 @@ bool ecs_defer_clone(
 {   
     (void)world;
     if (stage->defer) {
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpClone;
         op->component = src;
         op->is._1.entity = entity;
@@ -6343,7 +8356,7 @@ bool ecs_defer_delete(
 {
     (void)world;
     if (stage->defer) {
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpDelete;
         op->is._1.entity = entity;
         return true;
@@ -6360,7 +8373,7 @@ bool ecs_defer_clear(
 {
     (void)world;
     if (stage->defer) {
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpClear;
         op->is._1.entity = entity;
         return true;
@@ -6425,7 +8438,7 @@ bool ecs_defer_bulk_new(
         }
 
         /* Store data in op */
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpBulkNew;
         op->is._n.entities = ids;
         op->is._n.bulk_data = defer_data;
@@ -6489,12 +8502,13 @@ bool ecs_defer_set(
             size = cptr->size;
         }
 
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = op_kind;
         op->component = component;
         op->is._1.entity = entity;
         op->is._1.size = size;
         op->is._1.value = ecs_os_malloc(size);
+        ecs_os_track_alloc(EcsAllocDefer, 0, size);
 
         if (!value) {
             value = ecs_get_w_entity(world, entity, component);
@@ -6551,7 +8565,9 @@ void ecs_stage_merge(
         ecs_defer_flush(world, stage);
         ecs_vector_clear(stage->defer_merge_queue);
         ecs_assert(stage->defer_queue == NULL, ECS_INVALID_PARAMETER, NULL);
-    }    
+    }
+
+    ecs_os_merge_alloc_tags(stage->alloc_tags);
 }
 
 void ecs_stage_defer_begin(
@@ -6607,8 +8623,12 @@ void ecs_stage_deinit(
     ecs_stage_t *stage)
 {
     (void)world;
+    ecs_os_track_alloc(EcsAllocDefer, ECS_SIZEOF(ecs_op_t) * (
+        ecs_vector_size(stage->defer_queue) + 
+        ecs_vector_size(stage->defer_merge_queue)), 0);
     ecs_vector_free(stage->defer_queue);
     ecs_vector_free(stage->defer_merge_queue);
+    ecs_os_merge_alloc_tags(stage->alloc_tags);
 }
 
 
@@ -7087,9 +9107,10 @@ ecs_vector_t* _ecs_vector_copy(
     return dst;
 }
 
-#define CHUNK_COUNT (4096)
-#define CHUNK(index) ((int32_t)index >> 12)
-#define OFFSET(index) ((int32_t)index & 0xFFF)
+#define CHUNK_SHIFT (12)
+#define CHUNK_COUNT(sparse) (1 << (sparse)->chunk_shift)
+#define CHUNK(sparse, index) ((int32_t)index >> (sparse)->chunk_shift)
+#define OFFSET(sparse, index) ((int32_t)index & (CHUNK_COUNT(sparse) - 1))
 #define DATA(array, size, offset) (ECS_OFFSET(array, size * offset))
 
 typedef struct chunk_t {
@@ -7106,11 +9127,35 @@ struct ecs_sparse_t {
 
     ecs_vector_t *chunks;       /* Chunks with sparse arrays & data */
     ecs_size_t size;            /* Element size */
+    int32_t chunk_shift;        /* Log2 of number of elements per chunk */
     int32_t count;              /* Number of alive entries */
     uint64_t max_id_local;      /* Local max index (if no global is set) */
     uint64_t *max_id;           /* Maximum issued sparse index */
+    ecs_alloc_tag_t alloc_tag;  /* Subsystem to which memory is attributed */
+    ecs_size_t alloc_bytes;     /* Memory reported to OS API, excl. chunks */
 };
 
+static
+ecs_size_t chunk_alloc_bytes(
+    ecs_sparse_t *sparse)
+{
+    return (ECS_SIZEOF(int32_t) + sparse->size) * CHUNK_COUNT(sparse);
+}
+
+/* Report changes in size of the sparse set and its arrays. Chunks are reported
+ * separately when they are allocated and freed. */
+static
+void track_alloc(
+    ecs_sparse_t *sparse)
+{
+    ecs_size_t bytes = ECS_SIZEOF(ecs_sparse_t) +
+        ecs_vector_size(sparse->dense) * ECS_SIZEOF(uint64_t) +
+        ecs_vector_size(sparse->chunks) * ECS_SIZEOF(chunk_t);
+
+    ecs_os_track_alloc(sparse->alloc_tag, sparse->alloc_bytes, bytes);
+    sparse->alloc_bytes = bytes;
+}
+
 static
 chunk_t* chunk_new(
     ecs_sparse_t *sparse,
@@ -7137,23 +9182,31 @@ chunk_t* chunk_new(
      * sparse element has not been paired with a dense element. Use zero
      * as this means we can take advantage of calloc having a possibly better 
      * performance than malloc + memset. */
-    result->sparse = ecs_os_calloc(ECS_SIZEOF(int32_t) * CHUNK_COUNT);
+    result->sparse = ecs_os_calloc(ECS_SIZEOF(int32_t) * CHUNK_COUNT(sparse));
 
     /* Initialize the data array with zero's to guarantee that data is 
      * always initialized. When an entry is removed, data is reset back to
      * zero. Initialize now, as this can take advantage of calloc. */
-    result->data = ecs_os_calloc(sparse->size * CHUNK_COUNT);
+    result->data = ecs_os_calloc(sparse->size * CHUNK_COUNT(sparse));
 
     ecs_assert(result->sparse != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(result->data != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    ecs_os_track_alloc(sparse->alloc_tag, 0, chunk_alloc_bytes(sparse));
+    track_alloc(sparse);
+
     return result;
 }
 
 static
 void chunk_free(
+    ecs_sparse_t *sparse,
     chunk_t *chunk)
 {
+    if (chunk->sparse) {
+        ecs_os_track_alloc(sparse->alloc_tag, chunk_alloc_bytes(sparse), 0);
+    }
+
     ecs_os_free(chunk->sparse);
     ecs_os_free(chunk->data);
 }
@@ -7191,6 +9244,7 @@ void grow_dense(
     ecs_sparse_t *sparse)
 {
     ecs_vector_add(&sparse->dense, uint64_t);
+    track_alloc(sparse);
 }
 
 static
@@ -7205,12 +9259,13 @@ uint64_t strip_generation(
 
 static
 void assign_index(
+    ecs_sparse_t * sparse,
     chunk_t * chunk, 
     uint64_t * dense_array, 
     uint64_t index, 
     int32_t dense)
 {
-    chunk->sparse[OFFSET(index)] = dense;
+    chunk->sparse[OFFSET(sparse, index)] = dense;
     dense_array[dense] = index;
 }
 
@@ -7251,11 +9306,11 @@ uint64_t create_id(
     uint64_t index = inc_id(sparse);
     grow_dense(sparse);
 
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
-    ecs_assert(chunk->sparse[OFFSET(index)] == 0, ECS_INTERNAL_ERROR, NULL);
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
+    ecs_assert(chunk->sparse[OFFSET(sparse, index)] == 0, ECS_INTERNAL_ERROR, NULL);
     
     uint64_t *dense_array = ecs_vector_first(sparse->dense, uint64_t);
-    assign_index(chunk, dense_array, index, dense);
+    assign_index(sparse, chunk, dense_array, index, dense);
     
     return index;
 }
@@ -7286,12 +9341,12 @@ void* try_sparse_any(
 {    
     strip_generation(&index);
 
-    chunk_t *chunk = get_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_chunk(sparse, CHUNK(sparse, index));
     if (!chunk) {
         return NULL;
     }
 
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
     bool in_use = dense && (dense < sparse->count);
     if (!in_use) {
@@ -7307,12 +9362,12 @@ void* try_sparse(
     const ecs_sparse_t *sparse,
     uint64_t index)
 {
-    chunk_t *chunk = get_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_chunk(sparse, CHUNK(sparse, index));
     if (!chunk) {
         return NULL;
     }
 
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
     bool in_use = dense && (dense < sparse->count);
     if (!in_use) {
@@ -7338,8 +9393,8 @@ void* get_sparse(
     uint64_t index)
 {
     strip_generation(&index);
-    chunk_t *chunk = get_chunk(sparse, CHUNK(index));
-    int32_t offset = OFFSET(index);
+    chunk_t *chunk = get_chunk(sparse, CHUNK(sparse, index));
+    int32_t offset = OFFSET(sparse, index);
     
     ecs_assert(chunk != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(dense == chunk->sparse[offset], ECS_INTERNAL_ERROR, NULL);
@@ -7359,9 +9414,9 @@ void swap_dense(
     uint64_t index_a = dense_array[a];
     uint64_t index_b = dense_array[b];
 
-    chunk_t *chunk_b = get_or_create_chunk(sparse, CHUNK(index_b));
-    assign_index(chunk_a, dense_array, index_a, b);
-    assign_index(chunk_b, dense_array, index_b, a);
+    chunk_t *chunk_b = get_or_create_chunk(sparse, CHUNK(sparse, index_b));
+    assign_index(sparse, chunk_a, dense_array, index_a, b);
+    assign_index(sparse, chunk_b, dense_array, index_b, a);
 }
 
 ecs_sparse_t* _ecs_sparse_new(
@@ -7370,6 +9425,7 @@ ecs_sparse_t* _ecs_sparse_new(
     ecs_sparse_t *result = ecs_os_calloc(ECS_SIZEOF(ecs_sparse_t));
     ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
     result->size = size;
+    result->chunk_shift = CHUNK_SHIFT;
     result->max_id_local = UINT64_MAX;
     result->max_id = &result->max_id_local;
 
@@ -7378,6 +9434,8 @@ ecs_sparse_t* _ecs_sparse_new(
     ecs_vector_add(&result->dense, uint64_t);
     result->count = 1;
 
+    track_alloc(result);
+
     return result;
 }
 
@@ -7389,13 +9447,56 @@ void ecs_sparse_set_id_source(
     sparse->max_id = id_source;
 }
 
+void ecs_sparse_set_chunk_size(
+    ecs_sparse_t *sparse,
+    int32_t elem_count)
+{
+    ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(elem_count > 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!(elem_count & (elem_count - 1)), ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(sparse->chunks == NULL, ECS_INVALID_OPERATION, NULL);
+
+    int32_t shift = 0;
+    while ((1 << shift) < elem_count) {
+        shift ++;
+    }
+
+    sparse->chunk_shift = shift;
+}
+
+void ecs_sparse_set_alloc_tag(
+    ecs_sparse_t *sparse,
+    ecs_alloc_tag_t tag)
+{
+    ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(tag < EcsAllocTagCount, ECS_INVALID_PARAMETER, NULL);
+
+    if (tag == sparse->alloc_tag) {
+        return;
+    }
+
+    /* Move memory that was already reported to the new subsystem */
+    ecs_size_t bytes = sparse->alloc_bytes;
+    int32_t i, count = ecs_vector_count(sparse->chunks);
+    chunk_t *chunks = ecs_vector_first(sparse->chunks, chunk_t);
+    for (i = 0; i < count; i ++) {
+        if (chunks[i].sparse) {
+            bytes += chunk_alloc_bytes(sparse);
+        }
+    }
+
+    ecs_os_track_alloc(sparse->alloc_tag, bytes, 0);
+    ecs_os_track_alloc(tag, 0, bytes);
+    sparse->alloc_tag = tag;
+}
+
 void ecs_sparse_clear(
     ecs_sparse_t *sparse)
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
 
     ecs_vector_each(sparse->chunks, chunk_t, chunk, {
-        chunk_free(chunk);
+        chunk_free(sparse, chunk);
     });
 
     ecs_vector_free(sparse->chunks);
@@ -7404,6 +9505,8 @@ void ecs_sparse_clear(
     sparse->chunks = NULL;   
     sparse->count = 1;
     sparse->max_id_local = 0;
+
+    track_alloc(sparse);
 }
 
 void ecs_sparse_free(
@@ -7412,6 +9515,7 @@ void ecs_sparse_free(
     if (sparse) {
         ecs_sparse_clear(sparse);
         ecs_vector_free(sparse->dense);
+        ecs_os_track_alloc(sparse->alloc_tag, sparse->alloc_bytes, 0);
         ecs_os_free(sparse);
     }
 }
@@ -7455,9 +9559,9 @@ void* _ecs_sparse_add(
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
     ecs_assert(!size || size == sparse->size, ECS_INVALID_PARAMETER, NULL);
     uint64_t index = new_index(sparse);
-    chunk_t *chunk = get_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_chunk(sparse, CHUNK(sparse, index));
     ecs_assert(chunk != NULL, ECS_INTERNAL_ERROR, NULL);
-    return DATA(chunk->data, size, OFFSET(index));
+    return DATA(chunk->data, size, OFFSET(sparse, index));
 }
 
 uint64_t ecs_sparse_last_id(
@@ -7478,8 +9582,8 @@ void* _ecs_sparse_get_or_create(
     ecs_assert(ecs_vector_count(sparse->dense) > 0, ECS_INTERNAL_ERROR, NULL);
 
     uint64_t gen = strip_generation(&index);
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
-    int32_t offset = OFFSET(index);
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
 
     if (dense) {
@@ -7517,11 +9621,11 @@ void* _ecs_sparse_get_or_create(
             /* If there are unused elements in the list, move the first unused
              * element to the end of the list */
             uint64_t unused = dense_array[count];
-            chunk_t *unused_chunk = get_or_create_chunk(sparse, CHUNK(unused));
-            assign_index(unused_chunk, dense_array, unused, dense_count);
+            chunk_t *unused_chunk = get_or_create_chunk(sparse, CHUNK(sparse, unused));
+            assign_index(sparse, unused_chunk, dense_array, unused, dense_count);
         }
 
-        assign_index(chunk, dense_array, index, count);
+        assign_index(sparse, chunk, dense_array, index, count);
         dense_array[count] |= gen;
     }
 
@@ -7546,9 +9650,9 @@ void* _ecs_sparse_remove_get(
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
     ecs_assert(!size || size == sparse->size, ECS_INVALID_PARAMETER, NULL);
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
     uint64_t gen = strip_generation(&index);
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
 
     if (dense) {
@@ -7599,11 +9703,11 @@ void ecs_sparse_set_generation(
     uint64_t index)
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
     
     uint64_t index_w_gen = index;
     strip_generation(&index);
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
 
     if (dense) {
@@ -7620,10 +9724,10 @@ bool ecs_sparse_exists(
     uint64_t index)
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
     
     strip_generation(&index);
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
 
     return dense != 0;
@@ -7706,6 +9810,7 @@ void ecs_sparse_set_size(
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
     ecs_vector_set_size(&sparse->dense, uint64_t, elem_count);
+    track_alloc(sparse);
 }
 
 static
@@ -7740,6 +9845,8 @@ ecs_sparse_t* ecs_sparse_copy(
     }
 
     ecs_sparse_t *dst = _ecs_sparse_new(src->size);
+    dst->chunk_shift = src->chunk_shift;
+    ecs_sparse_set_alloc_tag(dst, src->alloc_tag);
     sparse_copy(dst, src);
 
     return dst;
@@ -7831,6 +9938,9 @@ void ecs_table_writer_register_table(
 
     ecs_data_t *data = ecs_table_get_or_create_data(writer->table);
     if (data->entities) {
+        /* Removed entities could be bases */
+        world->base_cache_version ++;
+
         /* Remove any existing entities from entity index */
         ecs_vector_each(data->entities, ecs_entity_t, e_ptr, {
             ecs_eis_delete(world, *e_ptr);
@@ -8096,10 +10206,12 @@ ecs_size_t ecs_table_writer(
             name_ptr->value = writer->name.name;
 
             if (name_ptr->alloc_value) {
+                ecs_track_name_free(name_ptr->alloc_value);
                 ecs_os_free(name_ptr->alloc_value);
             }
 
             name_ptr->alloc_value = writer->name.name;
+            ecs_track_name_alloc(name_ptr->alloc_value);
 
             /* Don't overwrite entity name */
             ecs_name_writer_reset(&writer->name);   
@@ -8504,6 +10616,7 @@ struct ecs_snapshot_t {
     ecs_vector_t *tables;
     ecs_entity_t last_id;
     ecs_filter_t filter;
+    ecs_size_t alloc_bytes;
 };
 
 static
@@ -8565,9 +10678,87 @@ ecs_data_t* duplicate_data(
         }
     }
 
+    /* Copy bitset columns */
+    int32_t bs_column_count = table->bs_column_count;
+    if (bs_column_count) {
+        result->bs_columns = ecs_os_memdup(main_data->bs_columns, 
+            ECS_SIZEOF(ecs_bs_column_t) * bs_column_count);
+
+        for (i = 0; i < bs_column_count; i ++) {
+            ecs_bitset_t *bs = &result->bs_columns[i].data;
+            if (bs->size) {
+                bs->data = ecs_os_memdup(bs->data, bs->size / 8);
+            }
+        }
+    }
+
+    /* Copy field columns */
+    int32_t soa_column_count = table->soa_column_count;
+    if (soa_column_count) {
+        result->soa_columns = ecs_os_memdup(main_data->soa_columns, 
+            ECS_SIZEOF(ecs_column_t) * soa_column_count);
+
+        for (i = 0; i < soa_column_count; i ++) {
+            ecs_column_t *column = &result->soa_columns[i];
+            column->data = ecs_vector_copy_t(
+                column->data, column->size, column->alignment);
+        }
+    }
+
+    /* Copy double buffered columns */
+    if (main_data->prev_columns) {
+        result->prev_columns = ecs_os_memdup(main_data->prev_columns, 
+            ECS_SIZEOF(ecs_column_t) * column_count);
+
+        for (i = 0; i < column_count; i ++) {
+            ecs_column_t *column = &result->prev_columns[i];
+            if (column->size) {
+                column->data = ecs_vector_copy_t(
+                    column->data, column->size, column->alignment);
+            }
+        }
+    }
+
     return result;
 }
 
+static
+void free_data(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_data_t *data)
+{
+    int32_t i, column_count = table->column_count;
+    ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+
+    /* Destruct components that were copied into the snapshot. Columns of
+     * components without a copy action are shallow copies of the table data,
+     * which is still owned by the world. */
+    for (i = 0; i < column_count; i ++) {
+        ecs_entity_t component = components[i];
+        ecs_column_t *column = &data->columns[i];
+        int32_t count = ecs_vector_count(column->data);
+
+        if (component > ECS_HI_COMPONENT_ID || !count) {
+            continue;
+        }
+
+        ecs_c_info_t *cdata = ecs_get_c_info(world, component);
+        ecs_xtor_t dtor;
+        if (cdata && cdata->lifecycle.copy &&
+            (dtor = cdata->lifecycle.dtor))
+        {
+            void *ptr = ecs_vector_first_t(
+                column->data, column->size, column->alignment);
+            dtor(world, component, entities, ptr, ecs_to_size_t(column->size), 
+                count, cdata->lifecycle.ctx);
+        }
+    }
+
+    ecs_table_clear_data(table, data);
+}
+
 static
 ecs_snapshot_t* snapshot_create(
     ecs_world_t *world,
@@ -8585,6 +10776,7 @@ ecs_snapshot_t* snapshot_create(
      * entirely upon snapshote restore. */
     if (!iter && entity_index) {
         result->entity_index = ecs_sparse_copy(entity_index);
+        ecs_sparse_set_alloc_tag(result->entity_index, EcsAllocSnapshot);
         result->tables = ecs_vector_new(ecs_table_leaf_t, 0);
     }
 
@@ -8620,8 +10812,14 @@ ecs_snapshot_t* snapshot_create(
         l->table = t;
         l->type = t->type;
         l->data = duplicate_data(world, t, data);
+        result->alloc_bytes += ECS_SIZEOF(ecs_data_t) + 
+            ecs_table_data_alloc_bytes(t, l->data);
     }
 
+    result->alloc_bytes += ECS_SIZEOF(ecs_snapshot_t) + 
+        ecs_vector_size(result->tables) * ECS_SIZEOF(ecs_table_leaf_t);
+    ecs_os_track_alloc(EcsAllocSnapshot, 0, result->alloc_bytes);
+
     return result;
 }
 
@@ -8666,6 +10864,10 @@ void ecs_snapshot_restore(
 {
     bool is_filtered = true;
 
+    /* Table data is either moved to or merged with the world tables, which 
+     * report their own memory */
+    ecs_os_track_alloc(EcsAllocSnapshot, snapshot->alloc_bytes, 0);
+
     if (snapshot->entity_index) {
         ecs_sparse_restore(world->store.entity_index, snapshot->entity_index);
         ecs_sparse_free(snapshot->entity_index);
@@ -8771,6 +10973,13 @@ void ecs_snapshot_restore(
         }
     }
 
+    /* Table data was restored without invoking component actions, so the
+     * EcsChildOf index has to be rebuilt from the restored data */
+    ecs_childof_index_rebuild(world);
+
+    /* Restored entities could be bases */
+    world->base_cache_version ++;
+
     ecs_vector_free(snapshot->tables);   
 
     ecs_os_free(snapshot);
@@ -8832,12 +11041,13 @@ void ecs_snapshot_free(
     ecs_snapshot_t *snapshot)
 {
     ecs_sparse_free(snapshot->entity_index);
+    ecs_os_track_alloc(EcsAllocSnapshot, snapshot->alloc_bytes, 0);
 
     ecs_table_leaf_t *tables = ecs_vector_first(snapshot->tables, ecs_table_leaf_t);
     int32_t i, count = ecs_vector_count(snapshot->tables);
     for (i = 0; i < count; i ++) {
         ecs_table_leaf_t *leaf = &tables[i];
-        ecs_table_clear_data(leaf->table, leaf->data);
+        free_data(snapshot->world, leaf->table, leaf->data);
         ecs_os_free(leaf->data);
     }    
 
@@ -10020,12359 +12230,17804 @@ void ecs_record_move_to(
 
 #endif
 
-/* -- Private functions -- */
+#ifdef FLECS_PROFILER
 
-ecs_stage_t *ecs_get_stage(
-    ecs_world_t **world_ptr)
-{
-    ecs_world_t *world = *world_ptr;
 
-    ecs_assert(world->magic == ECS_WORLD_MAGIC ||
-               world->magic == ECS_THREAD_MAGIC,
-               ECS_INTERNAL_ERROR,
-               NULL);
+/* Ring buffer with spans for a single thread. Only the thread that owns the
+ * ring buffer writes to it, so spans can be recorded without locking. */
+typedef struct ecs_span_ring_t {
+    ecs_span_t *spans;
+    uint64_t head;              /* Total number of spans written */
+} ecs_span_ring_t;
 
-    if (world->magic == ECS_WORLD_MAGIC) {
-        if (world->in_progress) {
-            return &world->temp_stage;
-        } else {
-            return &world->stage;
-        }
-    } else if (world->magic == ECS_THREAD_MAGIC) {
-        ecs_thread_t *thread = (ecs_thread_t*)world;
-        *world_ptr = thread->world;
-        return thread->stage;
-    }
-    
-    return NULL;
-}
+struct ecs_profiler_t {
+    ecs_time_t start;           /* Time at which the profiler was enabled */
+    int32_t size;               /* Number of spans per ring (power of 2) */
+    int32_t ring_count;         /* Number of rings (main thread + workers) */
+    ecs_span_ring_t *rings;
+};
 
-/* Evaluate component monitor. If a monitored entity changed it will have set a
- * flag in one of the world's component monitors. Queries can register 
- * themselves with component monitors to determine whether they need to rematch
- * with tables. */
 static
-void eval_component_monitor(
-    ecs_world_t *world,
-    ecs_component_monitor_t *mon)
+const char *span_kind_str[] = {
+    [EcsSpanFrame] = "frame",
+    [EcsSpanSystem] = "system",
+    [EcsSpanMerge] = "merge",
+    [EcsSpanSync] = "sync",
+    [EcsSpanDeferFlush] = "defer_flush",
+    [EcsSpanPipelineBuild] = "pipeline_build",
+    [EcsSpanTableCreate] = "table_create"
+};
+
+static
+void init_rings(
+    ecs_profiler_t *profiler,
+    int32_t count)
 {
-    if (!mon->rematch) {
+    if (count <= profiler->ring_count) {
         return;
     }
 
-    ecs_vector_t *eval[ECS_HI_COMPONENT_ID];
-    int32_t eval_count = 0;
+    profiler->rings = ecs_os_realloc(
+        profiler->rings, ECS_SIZEOF(ecs_span_ring_t) * count);
+    ecs_assert(profiler->rings != NULL, ECS_OUT_OF_MEMORY, NULL);
 
     int32_t i;
-    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
-        if (mon->dirty_flags[i]) {
-            eval[eval_count ++] = mon->monitors[i];
-            mon->dirty_flags[i] = 0;
-        }
+    for (i = profiler->ring_count; i < count; i ++) {
+        ecs_span_ring_t *ring = &profiler->rings[i];
+        ring->spans = ecs_os_malloc(ECS_SIZEOF(ecs_span_t) * profiler->size);
+        ecs_assert(ring->spans != NULL, ECS_OUT_OF_MEMORY, NULL);
+        ring->head = 0;
     }
 
-    for (i = 0; i < eval_count; i ++) {
-        ecs_vector_each(eval[i], ecs_query_t*, q_ptr, {
-            ecs_query_notify(world, *q_ptr, &(ecs_query_event_t) {
-                .kind = EcsQueryTableRematch
-            });
-        });
-    }
-    
-    mon->rematch = false;
+    profiler->ring_count = count;
 }
 
-void ecs_component_monitor_mark(
-    ecs_component_monitor_t *mon,
-    ecs_entity_t component)
+static
+void profiler_free(
+    ecs_profiler_t *profiler)
 {
-    /* Only flag if there are actually monitors registered, so that we
-     * don't waste cycles evaluating monitors if there's no interest */
-    if (mon->monitors[component]) {
-        mon->dirty_flags[component] = true;
-        mon->rematch = true;
+    int32_t i;
+    for (i = 0; i < profiler->ring_count; i ++) {
+        ecs_os_free(profiler->rings[i].spans);
     }
+
+    ecs_os_free(profiler->rings);
+    ecs_os_free(profiler);
 }
 
-void ecs_component_monitor_register(
-    ecs_component_monitor_t *mon,
-    ecs_entity_t component,
-    ecs_query_t *query)
+static
+void profiler_fini(
+    ecs_world_t *world,
+    void *ctx)
 {
-    ecs_assert(mon != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(query != NULL, ECS_INTERNAL_ERROR, NULL);
-
-    /* Ignore component ids > ECS_HI_COMPONENT_ID */
-    if(component >= ECS_HI_COMPONENT_ID) {
-        return;
-    }    
+    (void)ctx;
+    if (world->profiler) {
+        profiler_free(world->profiler);
+        world->profiler = NULL;
+    }
+}
 
-    ecs_query_t **q = ecs_vector_add(&mon->monitors[component], ecs_query_t*);
-    *q = query;
+static
+uint64_t time_to_ns(
+    ecs_time_t t)
+{
+    return (uint64_t)t.sec * 1000000000 + t.nanosec;
 }
 
-void ecs_component_monitor_free(
-    ecs_component_monitor_t *mon)
+static
+int32_t ring_count(
+    ecs_span_ring_t *ring,
+    int32_t size)
 {
-    int i;
-    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
-        ecs_vector_free(mon->monitors[i]);
+    if (ring->head > (uint64_t)size) {
+        return size;
+    } else {
+        return (int32_t)ring->head;
     }
 }
 
 static
-void init_store(ecs_world_t *world) {
-    ecs_os_memset(&world->store, 0, ECS_SIZEOF(ecs_store_t));
-    
-    /* Initialize entity index */
-    world->store.entity_index = ecs_sparse_new(ecs_record_t);
-    ecs_sparse_set_id_source(world->store.entity_index, &world->stats.last_id);
-
-    /* Initialize root table */
-    world->store.tables = ecs_sparse_new(ecs_table_t);
-
-    /* Initialize one root table per stage */
-    ecs_init_root_table(world);
+void append_span_name(
+    ecs_world_t *world,
+    ecs_strbuf_t *buf,
+    const ecs_span_t *span)
+{
+    switch(span->kind) {
+    case EcsSpanSystem:
+    case EcsSpanPipelineBuild: {
+        const char *name = NULL;
+        if (ecs_is_alive(world, span->id)) {
+            name = ecs_get_name(world, span->id);
+        }
+        if (name) {
+            ecs_strbuf_appendstr(buf, name);
+        } else {
+            ecs_strbuf_append(buf, "%u", (uint32_t)span->id);
+        }
+        break;
+    }
+    case EcsSpanTableCreate: {
+        ecs_table_t *table = ecs_sparse_get_sparse(
+            world->store.tables, ecs_table_t, span->id);
+        if (table) {
+            char *type_str = ecs_type_str(world, table->type);
+            ecs_strbuf_append(buf, "[%s]", type_str);
+            ecs_os_free(type_str);
+        } else {
+            ecs_strbuf_append(buf, "table %u", (uint32_t)span->id);
+        }
+        break;
+    }
+    default:
+        ecs_strbuf_appendstr(buf, span_kind_str[span->kind]);
+        break;
+    }
 }
 
-static
-void clean_tables(
+/* -- Private functions -- */
+
+uint64_t ecs_profiler_now(
     ecs_world_t *world)
 {
-    int32_t i, count = ecs_sparse_count(world->store.tables);
+    ecs_profiler_t *profiler = world->profiler;
+    if (!profiler) {
+        return 0;
+    }
 
-    for (i = 0; i < count; i ++) {
-        ecs_table_t *t = ecs_sparse_get(world->store.tables, ecs_table_t, i);
-        ecs_table_free(world, t);
+    ecs_time_t t;
+    ecs_os_get_time(&t);
+
+    /* Offset by 1 so that a valid timestamp is never 0 */
+    return time_to_ns(t) - time_to_ns(profiler->start) + 1;
+}
+
+void ecs_profiler_record(
+    ecs_world_t *world,
+    ecs_stage_t *stage,
+    ecs_span_kind_t kind,
+    ecs_entity_t id,
+    uint64_t start)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (!profiler) {
+        return;
     }
 
-    /* Clear the root table */
-    if (count) {
-        ecs_table_reset(world, &world->store.root);
+    /* Stage 0 and 1 are used by the main thread, worker stages start at 2 */
+    int32_t thread = stage->id > 1 ? stage->id - 1 : 0;
+    if (thread >= profiler->ring_count) {
+        return;
     }
+
+    uint64_t now = ecs_profiler_now(world);
+
+    ecs_span_ring_t *ring = &profiler->rings[thread];
+    uint64_t mask = (uint64_t)(profiler->size - 1);
+    ecs_span_t *span = &ring->spans[ring->head & mask];
+    span->kind = kind;
+    span->thread = thread;
+    span->id = id;
+    span->start = start - 1;
+    span->duration = now - start;
+    ring->head ++;
 }
 
-static
-void fini_store(ecs_world_t *world) {
-    clean_tables(world);
-    ecs_sparse_free(world->store.tables);
-    ecs_table_free(world, &world->store.root);
-    ecs_sparse_free(world->store.entity_index);
+void ecs_profiler_set_threads(
+    ecs_world_t *world,
+    int32_t threads)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (profiler) {
+        init_rings(profiler, 1 + threads);
+    }
 }
 
 /* -- Public functions -- */
 
+void ecs_profiler_enable(
+    ecs_world_t *world,
+    int32_t span_count)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(span_count >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
 
-FLECS_EXPORT
-bool ecs_os_has_heap(void);
-
-/** Are threading functions available? */
-FLECS_EXPORT
-bool ecs_os_has_threading(void);
+    if (world->profiler) {
+        profiler_free(world->profiler);
+        world->profiler = NULL;
+    }
 
-/** Are time functions available? */
-FLECS_EXPORT
-bool ecs_os_has_time(void);
+    /* Only register fini action the first time the profiler is enabled */
+    if (span_count && !world->profiler_fini_set) {
+        ecs_atfini(world, profiler_fini, NULL);
+        world->profiler_fini_set = true;
+    }
 
-/** Are logging functions available? */
-FLECS_EXPORT
-bool ecs_os_has_logging(void);
+    if (!span_count) {
+        return;
+    }
 
-/** Are dynamic library functions available? */
-FLECS_EXPORT
-bool ecs_os_has_dl(void);
+    ecs_profiler_t *profiler = ecs_os_calloc(ECS_SIZEOF(ecs_profiler_t));
+    ecs_assert(profiler != NULL, ECS_OUT_OF_MEMORY, NULL);
 
-/** Are module path functions available? */
-FLECS_EXPORT
-bool ecs_os_has_modules(void);
+    profiler->size = 1;
+    while (profiler->size < span_count) {
+        profiler->size *= 2;
+    }
 
+    ecs_os_get_time(&profiler->start);
+    init_rings(profiler, 1 + ecs_vector_count(world->workers));
 
-ecs_world_t *ecs_mini(void) {
-    ecs_os_init();
+    world->profiler = profiler;
+}
 
-    ecs_trace_1("bootstrap");
-    ecs_log_push();
+bool ecs_profiler_is_enabled(
+    ecs_world_t *world)
+{
+    return world->profiler != NULL;
+}
 
-    if (!ecs_os_has_heap()) {
-        ecs_abort(ECS_MISSING_OS_API, NULL);
+void ecs_profiler_clear(
+    ecs_world_t *world)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (profiler) {
+        int32_t i;
+        for (i = 0; i < profiler->ring_count; i ++) {
+            profiler->rings[i].head = 0;
+        }
     }
+}
 
-    if (!ecs_os_has_threading()) {
-        ecs_trace_1("threading not available");
+int32_t ecs_profiler_thread_count(
+    ecs_world_t *world)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (profiler) {
+        return profiler->ring_count;
+    } else {
+        return 0;
     }
+}
 
-    if (!ecs_os_has_time()) {
-        ecs_trace_1("time management not available");
+int32_t ecs_profiler_span_count(
+    ecs_world_t *world,
+    int32_t thread)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (!profiler || thread < 0 || thread >= profiler->ring_count) {
+        return 0;
     }
 
-    ecs_world_t *world = ecs_os_malloc(sizeof(ecs_world_t));
-    ecs_assert(world != NULL, ECS_OUT_OF_MEMORY, NULL);
-
-    world->magic = ECS_WORLD_MAGIC;
-    memset(&world->c_info, 0, sizeof(ecs_c_info_t) * ECS_HI_COMPONENT_ID); 
-
-    world->t_info = ecs_map_new(ecs_c_info_t, 0);  
-    world->fini_actions = NULL; 
+    return ring_count(&profiler->rings[thread], profiler->size);
+}
 
-    world->aliases = NULL;
+const ecs_span_t* ecs_profiler_get_span(
+    ecs_world_t *world,
+    int32_t thread,
+    int32_t index)
+{
+    int32_t count = ecs_profiler_span_count(world, thread);
+    if (index < 0 || index >= count) {
+        return NULL;
+    }
 
-    world->queries = ecs_vector_new(ecs_query_t*, 0);
-    world->fini_tasks = ecs_vector_new(ecs_entity_t, 0);
-    world->child_tables = NULL;
-    world->name_prefix = NULL;
+    ecs_profiler_t *profiler = world->profiler;
+    ecs_span_ring_t *ring = &profiler->rings[thread];
+    uint64_t mask = (uint64_t)(profiler->size - 1);
+    uint64_t first = ring->head - (uint64_t)count;
 
-    memset(&world->component_monitors, 0, sizeof(world->component_monitors));
-    memset(&world->parent_monitors, 0, sizeof(world->parent_monitors));
+    return &ring->spans[(first + (uint64_t)index) & mask];
+}
 
-    world->type_handles = ecs_map_new(ecs_entity_t, 0);
-    world->on_activate_components = ecs_map_new(ecs_on_demand_in_t, 0);
-    world->on_enable_components = ecs_map_new(ecs_on_demand_in_t, 0);
+char* ecs_profiler_to_json(
+    ecs_world_t *world)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
 
-    world->stage_count = 2;
-    world->worker_stages = NULL;
-    world->workers = NULL;
-    world->workers_waiting = 0;
-    world->workers_running = 0;
-    world->valid_schedule = false;
-    world->quit_workers = false;
-    world->in_progress = false;
-    world->is_merging = false;
-    world->auto_merge = true;
-    world->measure_frame_time = false;
-    world->measure_system_time = false;
-    world->should_quit = false;
-    world->locking_enabled = false;
-    world->pipeline = 0;
+    ecs_strbuf_t buf = ECS_STRBUF_INIT;
+    ecs_strbuf_appendstr(&buf, "{\"traceEvents\":[");
+
+    int32_t t, thread_count = ecs_profiler_thread_count(world);
+    for (t = 0; t < thread_count; t ++) {
+        if (t) {
+            ecs_strbuf_appendstr(&buf, ",");
+            ecs_strbuf_append(&buf,
+                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+                "\"args\":{\"name\":\"worker %d\"}}", t, t - 1);
+        } else {
+            ecs_strbuf_appendstr(&buf,
+                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,"
+                "\"args\":{\"name\":\"main\"}}");
+        }
 
-    world->frame_start_time = (ecs_time_t){0, 0};
-    if (ecs_os_has_time()) {
-        ecs_os_get_time(&world->world_start_time);
+        int32_t i, count = ecs_profiler_span_count(world, t);
+        for (i = 0; i < count; i ++) {
+            const ecs_span_t *span = ecs_profiler_get_span(world, t, i);
+            ecs_strbuf_appendstr(&buf, ",{\"name\":\"");
+            append_span_name(world, &buf, span);
+            ecs_strbuf_append(&buf,
+                "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":0,\"tid\":%d}",
+                span_kind_str[span->kind],
+                (double)span->start / 1000.0,
+                (double)span->duration / 1000.0,
+                span->thread);
+        }
     }
 
-    world->stats.target_fps = 0;
-    world->stats.last_id = 0;
+    ecs_strbuf_appendstr(&buf, "]}");
 
-    world->stats.delta_time_raw = 0;
-    world->stats.delta_time = 0;
-    world->stats.time_scale = 1.0;
-    world->stats.frame_time_total = 0;
-    world->stats.sleep_err = 0;
-    world->stats.system_time_total = 0;
-    world->stats.merge_time_total = 0;
-    world->stats.world_time_total = 0;
-    world->stats.frame_count_total = 0;
-    world->stats.merge_count_total = 0;
-    world->stats.systems_ran_frame = 0;
-    world->stats.pipeline_build_count_total = 0;
-    
-    world->range_check_enabled = true;
+    return ecs_strbuf_get(&buf);
+}
 
-    world->fps_sleep = 0;
+#endif
 
-    world->context = NULL;
+#ifdef FLECS_COMMAND_QUEUE
 
-    world->arg_fps = 0;
-    world->arg_threads = 0;
 
-    ecs_stage_init(world, &world->stage);
-    ecs_stage_init(world, &world->temp_stage);
-    init_store(world);
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-    world->stage.world = world;
-    world->temp_stage.world = world;
+/* A slot can be written by the producer that claimed ticket t when its
+ * sequence number is t, and can be read by the world when it is t + 1. 
+ * Tickets are 64 bit unsigned integers so they cannot overflow in practice,
+ * and wrap around without undefined behavior if they do. */
+typedef struct ecs_command_slot_t {
+    uint64_t seq;
+    ecs_op_t op;
+} ecs_command_slot_t;
 
-    ecs_bootstrap(world);
+struct ecs_command_queue_t {
+    ecs_world_t *world;
+    ecs_command_slot_t *slots;
+    uint64_t mask;              /* Number of slots - 1 */
+    uint64_t tail;              /* Next ticket, claimed by producers */
+    uint64_t head;              /* Next ticket to apply, owned by the world */
+};
 
-    ecs_log_pop();
-
-    return world;
+/* The OS API only provides 32 bit atomic increments, and no operations with
+ * acquire/release ordering. The queue relies on the following operations:
+ *  - a load-acquire of a sequence number, so that the command stored in a slot
+ *    is not read before the sequence number that publishes it
+ *  - a store-release of a sequence number, so that the sequence number is not
+ *    published before the command is written (or copied, for the world)
+ *  - a 64 bit fetch-and-increment to claim tickets */
+#if defined(__GNUC__) || defined(__clang__)
+static
+uint64_t command_load_acquire(
+    uint64_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
 }
 
-ecs_world_t *ecs_init(void) {
-    ecs_world_t *world = ecs_mini();
-
-#ifdef FLECS_MODULE_H
-    ecs_trace_1("import builtin modules");
-    ecs_log_push();
-#ifdef FLECS_SYSTEM_H
-    ECS_IMPORT(world, FlecsSystem);
-#endif
-#ifdef FLECS_PIPELINE_H
-    ECS_IMPORT(world, FlecsPipeline);
-#endif
-#ifdef FLECS_TIMER_H
-    ECS_IMPORT(world, FlecsTimer);
-#endif
-    ecs_log_pop();
-#endif
-
-    return world;
+static
+void command_store_release(
+    uint64_t *ptr,
+    uint64_t value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
 }
 
-#define ARG(short, long, action)\
-    if (i < argc) {\
-        if (argv[i][0] == '-') {\
-            if (argv[i][1] == '-') {\
-                if (long && !strcmp(&argv[i][2], long ? long : "")) {\
-                    action;\
-                    parsed = true;\
-                }\
-            } else {\
-                if (short && argv[i][1] == short) {\
-                    action;\
-                    parsed = true;\
-                }\
-            }\
-        }\
-    }
-
-ecs_world_t* ecs_init_w_args(
-    int argc,
-    char *argv[])
+static
+uint64_t command_fetch_inc(
+    uint64_t *ptr)
 {
-    (void)argc;
-    (void)argv;
-    return ecs_init();
+    return __atomic_fetch_add(ptr, 1, __ATOMIC_RELAXED);
 }
 
 static
-void on_demand_in_map_deinit(
-    ecs_map_t *map)
+void command_pause(void)
 {
-    ecs_map_iter_t it = ecs_map_iter(map);
-    ecs_on_demand_in_t *elem;
-
-    while ((elem = ecs_map_next(&it, ecs_on_demand_in_t, NULL))) {
-        ecs_vector_free(elem->systems);
-    }
-
-    ecs_map_free(map);
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
 }
-
+#elif defined(_MSC_VER)
 static
-void ctor_init_zero(
-    ecs_world_t *world,
-    ecs_entity_t component,
-    const ecs_entity_t *entity_ptr,
-    void *ptr,
-    size_t size,
-    int32_t count,
-    void *ctx)
+uint64_t command_load_acquire(
+    uint64_t *ptr)
 {
-    (void)world;
-    (void)component;
-    (void)entity_ptr;
-    (void)ctx;
-    ecs_os_memset(ptr, 0, ecs_from_size_t(size) * count);
+    return (uint64_t)_InterlockedCompareExchange64((volatile __int64*)ptr, 0, 0);
 }
 
-void ecs_notify_tables(
-    ecs_world_t *world,
-    ecs_table_event_t *event)
+static
+void command_store_release(
+    uint64_t *ptr,
+    uint64_t value)
 {
-    ecs_sparse_t *tables = world->store.tables;
-    int32_t i, count = ecs_sparse_count(tables);
-
-    for (i = 0; i < count; i ++) {
-        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
-        ecs_table_notify(world, table, event);
-    }
+    _InterlockedExchange64((volatile __int64*)ptr, (__int64)value);
 }
 
-void ecs_set_component_actions_w_entity(
-    ecs_world_t *world,
-    ecs_entity_t component,
-    EcsComponentLifecycle *lifecycle)
+static
+uint64_t command_fetch_inc(
+    uint64_t *ptr)
 {
-#ifndef NDEBUG
-    const EcsComponent *component_ptr = ecs_get(world, component, EcsComponent);
-
-    /* Cannot register lifecycle actions for things that aren't a component */
-    ecs_assert(component_ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    return (uint64_t)_InterlockedExchangeAdd64((volatile __int64*)ptr, 1);
+}
 
-    /* Cannot register lifecycle actions for components with size 0 */
-    ecs_assert(component_ptr->size != 0, ECS_INVALID_PARAMETER, NULL);
+static
+void command_pause(void)
+{
+#if defined(_M_IX86) || defined(_M_X64)
+    _mm_pause();
+#endif
+}
+#else
+#error "command queue requires atomic operations for this compiler"
 #endif
 
-    ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, component);
-    ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL);
-
-    if (c_info->lifecycle_set) {
-        ecs_assert(c_info->component == component, ECS_INTERNAL_ERROR, NULL);
-        ecs_assert(c_info->lifecycle.ctor == lifecycle->ctor, 
-            ECS_INCONSISTENT_COMPONENT_ACTION, NULL);
-        ecs_assert(c_info->lifecycle.dtor == lifecycle->dtor, 
-            ECS_INCONSISTENT_COMPONENT_ACTION, NULL);
-        ecs_assert(c_info->lifecycle.copy == lifecycle->copy, 
-            ECS_INCONSISTENT_COMPONENT_ACTION, NULL);
-        ecs_assert(c_info->lifecycle.move == lifecycle->move, 
-            ECS_INCONSISTENT_COMPONENT_ACTION, NULL);
-    } else {
-        c_info->component = component;
-        c_info->lifecycle = *lifecycle;
-        c_info->lifecycle_set = true;
+/* Wait until a slot has the expected sequence number. Spin first, as the
+ * world or another producer is typically about to release the slot, then
+ * back off to sleeping with an increasing interval so that a producer that
+ * waits for a full queue does not occupy a core until the next frame. */
+static
+void command_wait(
+    ecs_command_slot_t *slot,
+    uint64_t seq)
+{
+    int32_t spins = 0;
+    int32_t sleep_ns = 1000;
 
-        /* If no constructor is set, invoking any of the other lifecycle actions 
-         * is not safe as they will potentially access uninitialized memory. For 
-         * ease of use, if no constructor is specified, set a default one that 
-         * initializes the component to 0. */
-        if (!lifecycle->ctor && (lifecycle->dtor || lifecycle->copy || lifecycle->move)) {
-            c_info->lifecycle.ctor = ctor_init_zero;   
+    while (command_load_acquire(&slot->seq) != seq) {
+        if (spins < 1024) {
+            command_pause();
+            spins ++;
+        } else {
+            ecs_os_sleep(0, sleep_ns);
+            if (sleep_ns < 1000 * 1000) {
+                sleep_ns *= 2;
+            }
         }
-
-        ecs_notify_tables(world, &(ecs_table_event_t) {
-            .kind = EcsTableComponentInfo,
-            .component = component
-        });
     }
 }
 
-bool ecs_component_has_actions(
-    ecs_world_t *world,
-    ecs_entity_t component)
+static
+void command_queue_free(
+    ecs_command_queue_t *queue)
 {
-    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
-    return (c_info != NULL) && c_info->lifecycle_set;
+    /* Discard commands that were not applied */
+    uint64_t head = queue->head;
+    ecs_command_slot_t *slot;
+    while (command_load_acquire(
+        &(slot = &queue->slots[head & queue->mask])->seq) == head + 1) 
+    {
+        ecs_os_free(slot->op.is._1.value);
+        head ++;
+    }
+
+    ecs_os_free(queue->slots);
+    ecs_os_free(queue);
 }
 
-void ecs_atfini(
+static
+void command_queues_fini(
     ecs_world_t *world,
-    ecs_fini_action_t action,
     void *ctx)
 {
-    ecs_assert(action != NULL, ECS_INTERNAL_ERROR, NULL);
-
-    ecs_action_elem_t *elem = ecs_vector_add(&world->fini_actions, 
-        ecs_action_elem_t);
-    ecs_assert(elem != NULL, ECS_INTERNAL_ERROR, NULL);
+    (void)ctx;
+    ecs_vector_each(world->command_queues, ecs_command_queue_t*, q_ptr, {
+        command_queue_free(*q_ptr);
+    });
 
-    elem->action = action;
-    elem->ctx = ctx;
+    ecs_vector_free(world->command_queues);
+    world->command_queues = NULL;
 }
 
-void ecs_run_post_frame(
-    ecs_world_t *world,
-    ecs_fini_action_t action,
-    void *ctx)
+/* Claim a slot in the queue. If the queue is full, wait until the world has
+ * applied the command that was stored in the slot during the previous lap. */
+static
+ecs_command_slot_t* command_begin(
+    ecs_command_queue_t *queue,
+    ecs_op_kind_t kind,
+    ecs_entity_t entity,
+    ecs_entity_t component)
 {
-    ecs_assert(action != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_stage_t *stage = ecs_get_stage(&world);
+    ecs_assert(queue != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
 
-    ecs_action_elem_t *elem = ecs_vector_add(&stage->post_frame_actions, 
-        ecs_action_elem_t);
-    ecs_assert(elem != NULL, ECS_INTERNAL_ERROR, NULL);
+    uint64_t ticket = command_fetch_inc(&queue->tail);
+    ecs_command_slot_t *slot = &queue->slots[ticket & queue->mask];
 
-    elem->action = action;
-    elem->ctx = ctx;    
+    command_wait(slot, ticket);
+
+    ecs_op_t *op = &slot->op;
+    ecs_os_memset(op, 0, ECS_SIZEOF(ecs_op_t));
+    op->kind = kind;
+    op->is._1.entity = entity;
+
+    if (component) {
+        op->component = component;
+        op->components.count = 1;
+    }
+
+    return slot;
 }
 
-/* Unset data in tables */
+/* Publish the command to the world. Only the producer that claimed the slot
+ * writes the sequence number at this point, so it does not have to be read
+ * atomically. The release store publishes the command with it. */
 static
-void fini_unset_tables(
-    ecs_world_t *world)
+void command_end(
+    ecs_command_slot_t *slot)
 {
-    int32_t i, count = ecs_sparse_count(world->store.tables);
-    for (i = 0; i < count; i ++) {
-        ecs_table_t *table = ecs_sparse_get(world->store.tables, ecs_table_t, i);
-        ecs_table_unset(world, table);
-    }
+    command_store_release(&slot->seq, slot->seq + 1);
 }
 
-/* Invoke fini actions */
-static
-void fini_actions(
+/* -- Private functions -- */
+
+void ecs_command_queues_flush(
     ecs_world_t *world)
 {
-    ecs_vector_each(world->fini_actions, ecs_action_elem_t, elem, {
-        elem->action(world, elem->ctx);
+    ecs_vector_each(world->command_queues, ecs_command_queue_t*, q_ptr, {
+        ecs_command_queue_flush(*q_ptr);
     });
-
-    ecs_vector_free(world->fini_actions);
 }
 
-/* Cleanup component lifecycle callbacks & systems */
-static
-void fini_component_lifecycle(
-    ecs_world_t *world)
+/* -- Public functions -- */
+
+ecs_command_queue_t* ecs_command_queue_new(
+    ecs_world_t *world,
+    int32_t capacity)
 {
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(capacity > 0, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_command_queue_t *result = ecs_os_calloc(
+        ECS_SIZEOF(ecs_command_queue_t));
+    ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    /* At least two slots are needed to tell a full slot from an empty one */
+    int32_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    result->world = world;
+    result->mask = (uint64_t)(size - 1);
+    result->slots = ecs_os_malloc(ECS_SIZEOF(ecs_command_slot_t) * size);
+    ecs_assert(result->slots != NULL, ECS_OUT_OF_MEMORY, NULL);
+
     int32_t i;
-    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
-        ecs_vector_free(world->c_info[i].on_add);
-        ecs_vector_free(world->c_info[i].on_remove);
+    for (i = 0; i < size; i ++) {
+        result->slots[i].seq = (uint64_t)i;
     }
 
-    ecs_map_iter_t it = ecs_map_iter(world->t_info);
-    ecs_c_info_t *c_info;
-    while ((c_info = ecs_map_next(&it, ecs_c_info_t, NULL))) {
-        ecs_vector_free(c_info->on_add);
-        ecs_vector_free(c_info->on_remove);
-    }    
+    /* Only register fini action for the first queue */
+    if (!world->command_queues) {
+        ecs_atfini(world, command_queues_fini, NULL);
+    }
 
-    ecs_map_free(world->t_info);
+    ecs_command_queue_t **elem = ecs_vector_add(
+        &world->command_queues, ecs_command_queue_t*);
+    *elem = result;
+
+    return result;
 }
 
-/* Cleanup queries */
-static
-void fini_queries(
-    ecs_world_t *world)
+void ecs_command_queue_free(
+    ecs_command_queue_t *queue)
 {
-    /* Set world->queries to NULL, so ecs_query_free won't attempt to remove
-     * itself from the vector */
-    ecs_vector_t *query_vec = world->queries;
-    world->queries = NULL;
+    ecs_world_t *world = queue->world;
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-    int32_t i, count = ecs_vector_count(query_vec);
-    ecs_query_t **queries = ecs_vector_first(query_vec, ecs_query_t*);
-    for (i = 0; i < count; i ++) {
-        ecs_query_free(queries[i]);
-    }
+    ecs_vector_each(world->command_queues, ecs_command_queue_t*, q_ptr, {
+        if (*q_ptr == queue) {
+            ecs_vector_remove_index(
+                world->command_queues, ecs_command_queue_t*, q_ptr_i);
+            break;
+        }
+    });
 
-    ecs_vector_free(query_vec);
+    command_queue_free(queue);
 }
 
-/* Cleanup stages */
-static
-void fini_stages(
-    ecs_world_t *world)
+int32_t ecs_command_queue_flush(
+    ecs_command_queue_t *queue)
 {
-    ecs_stage_deinit(world, &world->stage);
-    ecs_stage_deinit(world, &world->temp_stage);
-}
+    ecs_world_t *world = queue->world;
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-/* Cleanup child table admin */
-static
-void fini_child_tables(
-    ecs_world_t *world)
-{
-    ecs_map_iter_t it = ecs_map_iter(world->child_tables);
-    ecs_vector_t *tables;
-    while ((tables = ecs_map_next_ptr(&it, ecs_vector_t*, NULL))) {
-        ecs_vector_free(tables);
-    }
+    ecs_stage_t *stage = &world->stage;
+    uint64_t head = queue->head;
+    int32_t count = 0;
+    ecs_command_slot_t *slot;
 
-    ecs_map_free(world->child_tables);
-}
+    ecs_defer_begin(world);
 
-/* Cleanup aliases */
-static
-void fini_aliases(
-    ecs_world_t *world)
-{
-    int32_t i, count = ecs_vector_count(world->aliases);
-    ecs_alias_t *aliases = ecs_vector_first(world->aliases, ecs_alias_t);
+    while (command_load_acquire(
+        &(slot = &queue->slots[head & queue->mask])->seq) == head + 1) 
+    {
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
+        *op = slot->op;
 
-    for (i = 0; i < count; i ++) {
-        ecs_os_free(aliases[i].name);
+        /* The value is owned by the defer queue from here on */
+        if (op->is._1.value) {
+            ecs_os_track_alloc(EcsAllocDefer, 0, op->is._1.size);
+        }
+
+        /* Release the slot to the producer of the next lap. The release
+         * store guarantees that the producer cannot see the slot as writable
+         * before the command has been copied. */
+        command_store_release(&slot->seq, head + queue->mask + 1);
+
+        head ++;
+        count ++;
     }
 
-    ecs_vector_free(world->aliases);
+    queue->head = head;
+
+    ecs_defer_end(world);
+
+    return count;
 }
 
-/* Cleanup misc structures */
-static
-void fini_misc(
-    ecs_world_t *world)
+void ecs_command_add_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t to_add)
 {
-    on_demand_in_map_deinit(world->on_activate_components);
-    on_demand_in_map_deinit(world->on_enable_components);
-    ecs_map_free(world->type_handles);
-    ecs_vector_free(world->fini_tasks);
-    ecs_component_monitor_free(&world->component_monitors);
-    ecs_component_monitor_free(&world->parent_monitors);
+    command_end(command_begin(queue, EcsOpAdd, entity, to_add));
 }
 
-/* The destroyer of worlds */
-int ecs_fini(
-    ecs_world_t *world)
+void ecs_command_remove_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t to_remove)
 {
-    assert(world->magic == ECS_WORLD_MAGIC);
-    assert(!world->in_progress);
-    assert(!world->is_merging);
+    command_end(command_begin(queue, EcsOpRemove, entity, to_remove));
+}
 
-    fini_unset_tables(world);
+void ecs_command_set_ptr_w_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    size_t size,
+    const void *ptr)
+{
+    ecs_assert(ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(size != 0, ECS_INVALID_PARAMETER, NULL);
 
-    fini_actions(world);    
+    ecs_command_slot_t *slot = command_begin(
+        queue, EcsOpSet, entity, component);
 
-    if (world->locking_enabled) {
-        ecs_os_mutex_free(world->mutex);
-    }
+    ecs_size_t value_size = ecs_from_size_t(size);
+    slot->op.is._1.size = value_size;
+    slot->op.is._1.value = ecs_os_memdup(ptr, value_size);
 
-    fini_stages(world);
+    command_end(slot);
+}
 
-    fini_store(world);
+void ecs_command_delete(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity)
+{
+    command_end(command_begin(queue, EcsOpDelete, entity, 0));
+}
 
-    fini_component_lifecycle(world);
+#endif
 
-    fini_queries(world);
+#ifdef FLECS_SPATIAL
 
-    fini_child_tables(world);
 
-    fini_aliases(world);
+/* Cell coordinates are clamped to this range, so that they can be packed in a
+ * single map key. Entities outside of the range are stored in the edge cells */
+#define SPATIAL_CELL_LIMIT (1 << 20)
+#define SPATIAL_CELL_BITS (21)
 
-    fini_misc(world);
+typedef struct ecs_spatial_point_t {
+    float v[3];
+} ecs_spatial_point_t;
 
-    /* In case the application tries to use the memory of the freed world, this
-     * will trigger an assert */
-    world->magic = 0;
+typedef struct ecs_spatial_cell_t {
+    int32_t coord[3];
+    ecs_vector_t *entities;     /* Entities in cell */
+    ecs_vector_t *points;       /* Positions of entities, same order */
+} ecs_spatial_cell_t;
 
-    ecs_increase_timer_resolution(0);
+/* Location of an entity in the grid */
+typedef struct ecs_spatial_elem_t {
+    uint64_t cell;
+    int32_t index;
+} ecs_spatial_elem_t;
 
-    /* End of the world */
-    ecs_os_free(world);
+struct ecs_spatial_t {
+    ecs_world_t *world;
+    ecs_entity_t component;
+    ecs_size_t offset[3];       /* Offsets of position members */
+    int32_t dim;                /* 2 or 3 */
+    float cell_size;
+    ecs_map_t *cells;           /* Cells by packed coordinates */
+    ecs_map_t *entities;        /* Location of entities in grid */
+    ecs_entity_t on_set;        /* System that inserts or moves entities */
+    ecs_entity_t un_set;        /* System that removes entities */
+    char *expr;                 /* Signature of systems */
+};
 
-    ecs_os_fini(); 
+/* Convert a position to a cell coordinate. Values outside of the range of the
+ * grid, including infinities, are clamped before they are converted to an
+ * integer, as the conversion is undefined for values that don't fit. NaN is
+ * mapped to the lower edge cell, though points with NaN coordinates are not
+ * stored in the index. */
+static
+int32_t spatial_coord(
+    float cell_size,
+    float value)
+{
+    float f = value / cell_size;
+    if (!(f >= (float)-SPATIAL_CELL_LIMIT)) {
+        return -SPATIAL_CELL_LIMIT;
+    }
+    if (f >= (float)(SPATIAL_CELL_LIMIT - 1)) {
+        return SPATIAL_CELL_LIMIT - 1;
+    }
 
-    return 0;
+    int32_t result = (int32_t)f;
+    if ((float)result > f) {
+        result --;
+    }
+
+    return result;
 }
 
-void ecs_dim(
-    ecs_world_t *world,
-    int32_t entity_count)
+static
+uint64_t spatial_key(
+    const int32_t *coord)
 {
-    assert(world->magic == ECS_WORLD_MAGIC);
-    ecs_eis_set_size(world, entity_count + ECS_HI_COMPONENT_ID);
+    uint64_t x = (uint64_t)(coord[0] + SPATIAL_CELL_LIMIT);
+    uint64_t y = (uint64_t)(coord[1] + SPATIAL_CELL_LIMIT);
+    uint64_t z = (uint64_t)(coord[2] + SPATIAL_CELL_LIMIT);
+    return (x << (SPATIAL_CELL_BITS * 2)) | (y << SPATIAL_CELL_BITS) | z;
 }
 
-void ecs_dim_type(
-    ecs_world_t *world,
-    ecs_type_t type,
-    int32_t entity_count)
+static
+void spatial_remove(
+    ecs_spatial_t *index,
+    ecs_entity_t entity)
 {
-    assert(world->magic == ECS_WORLD_MAGIC);
-    if (type) {
-        ecs_table_t *table = ecs_table_from_type(world, type);
-        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
-        
-        ecs_data_t *data = ecs_table_get_or_create_data(table);
-        ecs_table_set_size(world, table, data, entity_count);
+    ecs_spatial_elem_t *elem = ecs_map_get(
+        index->entities, ecs_spatial_elem_t, entity);
+    if (!elem) {
+        return;
     }
-}
 
-void ecs_eval_component_monitors(
-    ecs_world_t *world)
-{
-    eval_component_monitor(world, &world->component_monitors);
-    eval_component_monitor(world, &world->parent_monitors);
-}
+    uint64_t key = elem->cell;
+    int32_t row = elem->index;
 
-void ecs_merge(
-    ecs_world_t *world)
-{
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    assert(world->is_merging == false);
+    ecs_spatial_cell_t *cell = ecs_map_get(
+        index->cells, ecs_spatial_cell_t, key);
+    ecs_assert(cell != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    bool measure_frame_time = world->measure_frame_time;
+    /* The last entity in the cell is moved into the removed element */
+    int32_t count = ecs_vector_remove_index(
+        cell->entities, ecs_entity_t, row);
+    ecs_vector_remove_index(cell->points, ecs_spatial_point_t, row);
 
-    world->is_merging = true;
+    if (row != count) {
+        ecs_entity_t moved = *ecs_vector_get(cell->entities, ecs_entity_t, row);
+        ecs_spatial_elem_t *moved_elem = ecs_map_get(
+            index->entities, ecs_spatial_elem_t, moved);
+        ecs_assert(moved_elem != NULL, ECS_INTERNAL_ERROR, NULL);
+        moved_elem->index = row;
+    }
 
-    ecs_time_t t_start;
-    if (measure_frame_time) {
-        ecs_os_get_time(&t_start);
+    /* Remove empty cells, so that iterating the grid does not visit them */
+    if (!count) {
+        ecs_vector_free(cell->entities);
+        ecs_vector_free(cell->points);
+        ecs_map_remove(index->cells, key);
     }
 
-    ecs_stage_merge(world, &world->temp_stage);
+    ecs_map_remove(index->entities, entity);
+}
 
-    ecs_vector_each(world->worker_stages, ecs_stage_t, stage, {
-        ecs_stage_merge(world, stage);
-    });
+static
+void spatial_update(
+    ecs_spatial_t *index,
+    ecs_entity_t entity,
+    const ecs_spatial_point_t *point)
+{
+    int32_t coord[3] = {0};
+    int32_t i;
+    for (i = 0; i < index->dim; i ++) {
+        /* A point with a NaN coordinate is not in any region. Remove it from
+         * the index, as NaN fails every bounds check of a query. */
+        if (point->v[i] != point->v[i]) {
+            spatial_remove(index, entity);
+            return;
+        }
 
-    world->is_merging = false;
+        coord[i] = spatial_coord(index->cell_size, point->v[i]);
+    }
 
-    ecs_eval_component_monitors(world);
+    uint64_t key = spatial_key(coord);
+    ecs_spatial_cell_t *cell;
 
-    if (measure_frame_time) {
-        world->stats.merge_time_total += (float)ecs_time_measure(&t_start);
+    ecs_spatial_elem_t *elem = ecs_map_get(
+        index->entities, ecs_spatial_elem_t, entity);
+    if (elem) {
+        if (elem->cell == key) {
+            /* Entity did not leave its cell, only update the position */
+            cell = ecs_map_get(index->cells, ecs_spatial_cell_t, key);
+            ecs_assert(cell != NULL, ECS_INTERNAL_ERROR, NULL);
+            *ecs_vector_get(cell->points, ecs_spatial_point_t, elem->index) =
+                *point;
+            return;
+        }
+
+        spatial_remove(index, entity);
     }
 
-    world->stats.merge_count_total ++;
+    cell = ecs_map_get(index->cells, ecs_spatial_cell_t, key);
+    if (!cell) {
+        ecs_spatial_cell_t new_cell = {
+            .coord = {coord[0], coord[1], coord[2]}
+        };
+        ecs_map_set(index->cells, key, &new_cell);
+        cell = ecs_map_get(index->cells, ecs_spatial_cell_t, key);
+    }
+
+    ecs_entity_t *e_ptr = ecs_vector_add(&cell->entities, ecs_entity_t);
+    *e_ptr = entity;
+    ecs_spatial_point_t *p_ptr = ecs_vector_add(
+        &cell->points, ecs_spatial_point_t);
+    *p_ptr = *point;
+
+    ecs_map_set(index->entities, entity, &((ecs_spatial_elem_t){
+        .cell = key,
+        .index = ecs_vector_count(cell->entities) - 1
+    }));
 }
 
-void ecs_set_automerge(
-    ecs_world_t *world,
-    bool auto_merge)
+static
+void spatial_update_column(
+    ecs_spatial_t *index,
+    const ecs_entity_t *entities,
+    void *base,
+    ecs_size_t size,
+    int32_t count)
 {
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    world->auto_merge = auto_merge;
+    int32_t i, d;
+    for (i = 0; i < count; i ++) {
+        void *ptr = ECS_OFFSET(base, size * i);
+        ecs_spatial_point_t point = {{0}};
+        for (d = 0; d < index->dim; d ++) {
+            point.v[d] = *(float*)ECS_OFFSET(ptr, index->offset[d]);
+        }
+
+        spatial_update(index, entities[i], &point);
+    }
 }
 
-void ecs_measure_frame_time(
-    ecs_world_t *world,
-    bool enable)
+/* Insert entities for which the component was set before the index existed */
+static
+void spatial_populate(
+    ecs_spatial_t *index)
 {
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    ecs_assert(ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
+    ecs_world_t *world = index->world;
+    ecs_sparse_t *tables = world->store.tables;
 
-    if (world->stats.target_fps == 0.0 || enable) {
-        world->measure_frame_time = enable;
+    int32_t i, count = ecs_sparse_count(tables);
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        if (table->flags & (EcsTableIsPrefab | EcsTableIsDisabled)) {
+            continue;
+        }
+
+        ecs_data_t *data = ecs_table_get_data(table);
+        int32_t column = ecs_type_index_of(table->type, index->component);
+        if (!data || column == -1 || column >= table->column_count ||
+            !ecs_table_data_count(data))
+        {
+            continue;
+        }
+
+        ecs_column_t *c = &data->columns[column];
+        spatial_update_column(index,
+            ecs_vector_first(data->entities, ecs_entity_t),
+            ecs_vector_first_t(c->data, c->size, c->alignment),
+            c->size, ecs_table_data_count(data));
     }
 }
 
-void ecs_measure_system_time(
-    ecs_world_t *world,
-    bool enable)
+/* Insert or move entities for which the component is set or modified */
+static
+void SpatialSet(
+    ecs_iter_t *it)
 {
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    ecs_assert(ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
-    world->measure_system_time = enable;
+    ecs_spatial_t *index = it->ctx;
+    spatial_update_column(index, it->entities, ecs_column_w_size(it, 0, 1),
+        ecs_from_size_t(ecs_column_size(it, 1)), it->count);
 }
 
-/* Increase timer resolution based on target fps */
-static void set_timer_resolution(float fps)
+/* Remove entities for which the component is removed or deleted */
+static
+void SpatialUnSet(
+    ecs_iter_t *it)
 {
-    if(fps >= 60.0f) ecs_increase_timer_resolution(1);
-    else ecs_increase_timer_resolution(0);
+    ecs_spatial_t *index = it->ctx;
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        spatial_remove(index, it->entities[i]);
+    }
 }
 
-void ecs_set_target_fps(
+static
+ecs_entity_t spatial_new_system(
     ecs_world_t *world,
-    float fps)
+    ecs_spatial_t *index,
+    ecs_entity_t kind,
+    ecs_iter_action_t action)
 {
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    ecs_assert(ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
-
-    if (!world->arg_fps) {
-        ecs_measure_frame_time(world, true);
-        world->stats.target_fps = fps;
-        set_timer_resolution(fps);
-    }
+    ecs_entity_t result = ecs_new(world, 0);
+    ecs_set(world, result, EcsContext, {index});
+    return ecs_new_system(world, result, NULL, kind, index->expr, action);
 }
 
-void* ecs_get_context(
-    ecs_world_t *world)
+static
+void spatial_clear(
+    ecs_spatial_t *index)
 {
-    ecs_get_stage(&world);
-    return world->context;
+    ecs_map_each(index->cells, ecs_spatial_cell_t, key, cell, {
+        ecs_vector_free(cell->entities);
+        ecs_vector_free(cell->points);
+    });
+
+    ecs_map_free(index->cells);
+    ecs_map_free(index->entities);
+    index->cells = NULL;
+    index->entities = NULL;
 }
 
-void ecs_set_context(
-    ecs_world_t *world,
-    void *context)
+static
+void spatial_free(
+    ecs_spatial_t *index)
 {
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    world->context = context;
+    spatial_clear(index);
+    ecs_os_free(index->expr);
+    ecs_os_free(index);
 }
 
-void ecs_set_entity_range(
+static
+void spatial_indices_fini(
     ecs_world_t *world,
-    ecs_entity_t id_start,
-    ecs_entity_t id_end)
+    void *ctx)
 {
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    ecs_assert(!id_end || id_end > id_start, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(!id_end || id_end > world->stats.last_id, ECS_INVALID_PARAMETER, NULL);
-
-    if (world->stats.last_id < id_start) {
-        world->stats.last_id = id_start - 1;
-    }
+    (void)ctx;
+    ecs_vector_each(world->spatial_indices, ecs_spatial_t*, i_ptr, {
+        spatial_free(*i_ptr);
+    });
 
-    world->stats.min_id = id_start;
-    world->stats.max_id = id_end;
+    ecs_vector_free(world->spatial_indices);
+    world->spatial_indices = NULL;
 }
 
-bool ecs_enable_range_check(
-    ecs_world_t *world,
-    bool enable)
+/* Find the next cell in the queried range that is not empty */
+static
+ecs_spatial_cell_t* spatial_next_cell(
+    ecs_spatial_iter_t *it)
 {
-    bool old_value = world->range_check_enabled;
-    world->range_check_enabled = enable;
-    return old_value;
-}
+    ecs_spatial_t *index = it->index;
+    ecs_spatial_cell_t *cell;
 
-int32_t ecs_get_thread_index(
-    ecs_world_t *world)
-{
-    if (world->magic == ECS_THREAD_MAGIC) {
-        ecs_thread_t *thr = (ecs_thread_t*)world;
-        return thr->index;
-    } else if (world->magic == ECS_WORLD_MAGIC) {
-        return 0;
-    } else {
-        ecs_abort(ECS_INTERNAL_ERROR, NULL);
+    if (it->walk_cells) {
+        ecs_map_key_t key;
+        while ((cell = ecs_map_next(
+            &it->cells_iter, ecs_spatial_cell_t, &key)))
+        {
+            int32_t d;
+            for (d = 0; d < 3; d ++) {
+                if (cell->coord[d] < it->cell_min[d] ||
+                    cell->coord[d] > it->cell_max[d])
+                {
+                    break;
+                }
+            }
+
+            if (d == 3) {
+                return cell;
+            }
+        }
+
+        return NULL;
     }
-}
 
-int32_t ecs_get_threads(
-    ecs_world_t *world)
-{
-    return ecs_vector_count(world->workers);
-}
+    int32_t *cur = it->cell;
+    while (cur[2] <= it->cell_max[2]) {
+        uint64_t key = spatial_key(cur);
 
-bool ecs_enable_locking(
-    ecs_world_t *world,
-    bool enable)
-{
-    if (enable) {
-        if (!world->locking_enabled) {
-            world->mutex = ecs_os_mutex_new();
-            world->thr_sync = ecs_os_mutex_new();
-            world->thr_cond = ecs_os_cond_new();
+        if (++ cur[0] > it->cell_max[0]) {
+            cur[0] = it->cell_min[0];
+            if (++ cur[1] > it->cell_max[1]) {
+                cur[1] = it->cell_min[1];
+                cur[2] ++;
+            }
         }
-    } else {
-        if (world->locking_enabled) {
-            ecs_os_mutex_free(world->mutex);
-            ecs_os_mutex_free(world->thr_sync);
-            ecs_os_cond_free(world->thr_cond);
+
+        cell = ecs_map_get(index->cells, ecs_spatial_cell_t, key);
+        if (cell) {
+            return cell;
         }
     }
 
-    bool old = world->locking_enabled;
-    world->locking_enabled = enable;
-    return old;
+    return NULL;
 }
 
-void ecs_lock(
-    ecs_world_t *world)
+/* Test if all points in a cell are in the queried region. Edge cells contain
+ * points outside of their bounds, and are always filtered. */
+static
+bool spatial_cell_inside(
+    const ecs_spatial_iter_t *it,
+    const ecs_spatial_cell_t *cell)
 {
-    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
-    ecs_os_mutex_lock(world->mutex);
-}
+    float cell_size = it->index->cell_size;
+    float dist_sq = 0;
 
-void ecs_unlock(
-    ecs_world_t *world)
-{
-    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
-    ecs_os_mutex_unlock(world->mutex);
-}
+    int32_t d;
+    for (d = 0; d < it->index->dim; d ++) {
+        int32_t coord = cell->coord[d];
+        if (coord == -SPATIAL_CELL_LIMIT || coord == SPATIAL_CELL_LIMIT - 1) {
+            return false;
+        }
 
-void ecs_begin_wait(
-    ecs_world_t *world)
-{
-    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
-    ecs_os_mutex_lock(world->thr_sync);
-    ecs_os_cond_wait(world->thr_cond, world->thr_sync);
-}
+        float lo = (float)coord * cell_size;
+        float hi = (float)(coord + 1) * cell_size;
 
-void ecs_end_wait(
-    ecs_world_t *world)
-{
-    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
-    ecs_os_mutex_unlock(world->thr_sync);
+        if (it->radius > 0) {
+            float d_lo = lo - it->center[d], d_hi = hi - it->center[d];
+            d_lo *= d_lo;
+            d_hi *= d_hi;
+            dist_sq += d_lo > d_hi ? d_lo : d_hi;
+        } else if (lo <= it->min[d] || hi >= it->max[d]) {
+            return false;
+        }
+    }
+
+    return it->radius == 0 || dist_sq < it->radius * it->radius;
 }
 
-ecs_c_info_t * ecs_get_c_info(
-    ecs_world_t *world,
-    ecs_entity_t component)
+static
+bool spatial_point_inside(
+    const ecs_spatial_iter_t *it,
+    const ecs_spatial_point_t *point)
 {
-    ecs_assert(component != 0, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(!(component & ECS_ROLE_MASK), ECS_INTERNAL_ERROR, NULL);
+    float dist_sq = 0;
 
-    if (component < ECS_HI_COMPONENT_ID) {
-        ecs_c_info_t *c_info = &world->c_info[component];
-        if (c_info->component) {
-            ecs_assert(c_info->component == component, ECS_INTERNAL_ERROR, NULL);
-            return c_info;
-        } else {
-            return NULL;
+    int32_t d;
+    for (d = 0; d < it->index->dim; d ++) {
+        float v = point->v[d];
+        if (v < it->min[d] || v > it->max[d]) {
+            return false;
         }
-    } else {
-        return ecs_map_get(world->t_info, ecs_c_info_t, component);
-    }
-}
 
-ecs_c_info_t * ecs_get_or_create_c_info(
-    ecs_world_t *world,
-    ecs_entity_t component)
-{    
-    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
-    if (!c_info) {
-        if (component < ECS_HI_COMPONENT_ID) {
-            c_info = &world->c_info[component];
-            ecs_assert(c_info->component == 0, ECS_INTERNAL_ERROR, NULL);
-            c_info->component = component;
-        } else {
-            ecs_c_info_t t_info = { 0 };
-            ecs_map_set(world->t_info, component, &t_info);
-            c_info = ecs_map_get(world->t_info, ecs_c_info_t, component);
-            ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL); 
+        if (it->radius > 0) {
+            float delta = v - it->center[d];
+            dist_sq += delta * delta;
         }
     }
 
-    return c_info;
+    return it->radius == 0 || dist_sq <= it->radius * it->radius;
 }
 
-bool ecs_staging_begin(
-    ecs_world_t *world)
+static
+ecs_spatial_iter_t spatial_iter(
+    ecs_spatial_t *index,
+    const float *min,
+    const float *max)
 {
-    bool in_progress = world->in_progress;
-    world->in_progress = true;
-    return in_progress;
-}
+    ecs_assert(index != NULL, ECS_INVALID_PARAMETER, NULL);
 
-void ecs_staging_end(
-    ecs_world_t *world)
-{
-    ecs_assert(world->in_progress == true, ECS_INVALID_OPERATION, NULL);
+    ecs_spatial_iter_t it = {
+        .index = index
+    };
 
-    world->in_progress = false;
-    if (world->auto_merge) {
-        ecs_merge(world);
-    }
-}
+    /* Number of cells that overlap with the region */
+    double cell_count = 1;
 
-static
-double insert_sleep(
-    ecs_world_t *world,
-    ecs_time_t *stop)
-{
-    ecs_time_t start = *stop;
-    double delta_time = ecs_time_measure(stop);
+    int32_t d;
+    for (d = 0; d < index->dim; d ++) {
+        ecs_assert(min[d] <= max[d], ECS_INVALID_PARAMETER, NULL);
+        it.min[d] = min[d];
+        it.max[d] = max[d];
+        it.cell_min[d] = spatial_coord(index->cell_size, min[d]);
+        it.cell_max[d] = spatial_coord(index->cell_size, max[d]);
+        cell_count *= (double)(it.cell_max[d] - it.cell_min[d] + 1);
+    }
 
-    if (world->stats.target_fps == 0) {
-        return delta_time;
+    /* If the region is large compared to the number of occupied cells, it is
+     * cheaper to visit all cells than to look up each cell in the region */
+    if (cell_count > (double)ecs_map_count(index->cells)) {
+        it.walk_cells = true;
+        it.cells_iter = ecs_map_iter(index->cells);
+    } else {
+        it.cell[0] = it.cell_min[0];
+        it.cell[1] = it.cell_min[1];
+        it.cell[2] = it.cell_min[2];
     }
 
-    double target_delta_time = (1.0 / world->stats.target_fps);
-    double world_sleep_err = 
-        world->stats.sleep_err / (double)world->stats.frame_count_total;
+    return it;
+}
 
-    /* Calculate the time we need to sleep by taking the measured delta from the
-     * previous frame, and subtracting it from target_delta_time. */
-    double sleep = target_delta_time - delta_time;
+/* -- Public functions -- */
 
-    /* Pick a sleep interval that is 20 times lower than the time one frame
-     * should take. This means that this function at most iterates 20 times in
-     * a busy loop */
-    double sleep_time = target_delta_time / 20;
+ecs_spatial_t* ecs_spatial_new_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    ecs_size_t x_offset,
+    ecs_size_t y_offset,
+    ecs_size_t z_offset,
+    float cell_size)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(cell_size > 0, ECS_INVALID_PARAMETER, NULL);
 
-    /* Measure at least two frames before interpreting sleep error */
-    if (world->stats.frame_count_total > 1) {
-        /* If the ratio between the sleep error and the sleep time is too high,
-         * just do a busy loop */
-        if (world_sleep_err / sleep_time > 0.1) {
-            sleep_time = 0;
-        } 
-    }
+    const EcsComponent *cptr = ecs_get(world, component, EcsComponent);
+    ecs_assert(cptr != NULL, ECS_INVALID_COMPONENT_ID, NULL);
+    ecs_assert(x_offset >= 0 && x_offset + ECS_SIZEOF(float) <= cptr->size,
+        ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(y_offset >= 0 && y_offset + ECS_SIZEOF(float) <= cptr->size,
+        ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(z_offset + ECS_SIZEOF(float) <= cptr->size,
+        ECS_INVALID_PARAMETER, NULL);
+    (void)cptr;
 
-    /* If the time we need to sleep is large enough to warrant a sleep, sleep */
-    if (sleep > (sleep_time - world_sleep_err)) {
-        if (sleep_time > sleep) {
-            /* Make sure we don't sleep longer than we should */
-            sleep_time = sleep;
-        }
+    /* Positions are read from table columns */
+    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
+    ecs_assert(!c_info || (!c_info->sparse && !c_info->fields),
+        ECS_INVALID_COMPONENT_ID, NULL);
+    (void)c_info;
 
-        double sleep_err = 0;
-        int32_t iterations = 0;
+    char *path = ecs_get_fullpath(world, component);
+    ecs_assert(path != NULL, ECS_INVALID_COMPONENT_ID, NULL);
 
-        do {
-            /* Only call sleep when sleep_time is not 0. On some platforms, even
-             * a sleep with a timeout of 0 can cause stutter. */
-            if (sleep_time != 0) {
-                ecs_sleepf(sleep_time);
-            }
+    ecs_strbuf_t buf = ECS_STRBUF_INIT;
+    ecs_strbuf_append(&buf, "OWNED:%s", path);
+    ecs_os_free(path);
 
-            ecs_time_t now = start;
-            double prev_delta_time = delta_time;
-            delta_time = ecs_time_measure(&now);
+    ecs_spatial_t *result = ecs_os_calloc(ECS_SIZEOF(ecs_spatial_t));
+    ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
 
-            /* Measure the error of the sleep by taking the difference between 
-             * the time we expected to sleep, and the measured time. This 
-             * assumes that a sleep is less accurate than a high resolution 
-             * timer which should be true in most cases. */
-            sleep_err = delta_time - prev_delta_time - sleep_time;
-            iterations ++;
-        } while ((target_delta_time - delta_time) > (sleep_time - world_sleep_err));
+    result->world = world;
+    result->component = component;
+    result->offset[0] = x_offset;
+    result->offset[1] = y_offset;
+    result->offset[2] = z_offset;
+    result->dim = z_offset < 0 ? 2 : 3;
+    result->cell_size = cell_size;
+    result->cells = ecs_map_new(ecs_spatial_cell_t, 0);
+    result->entities = ecs_map_new(ecs_spatial_elem_t, 0);
+    result->expr = ecs_strbuf_get(&buf);
 
-        /* Add sleep error measurement to sleep error, with a bias towards the
-         * latest measured values. */
-        world->stats.sleep_err = (float)
-            (world_sleep_err * 0.9 + sleep_err * 0.1) * 
-                (float)world->stats.frame_count_total;
+    /* Only register fini action for the first index */
+    if (!world->spatial_indices) {
+        ecs_atfini(world, spatial_indices_fini, NULL);
     }
 
-    /*  Make last minute corrections if due to a larger clock error delta_time
-     * is still more than 5% away from the target. The 5% buffer is to account
-     * for the fact that measuring the time also takes time. */
-    while (delta_time < target_delta_time * 0.95) {
-        ecs_time_t now = start;
-        delta_time = ecs_time_measure(&now);
-    }
+    ecs_spatial_t **elem = ecs_vector_add(
+        &world->spatial_indices, ecs_spatial_t*);
+    *elem = result;
 
-    return delta_time;
+    result->on_set = spatial_new_system(world, result, EcsOnSet, SpatialSet);
+    result->un_set = spatial_new_system(
+        world, result, EcsUnSet, SpatialUnSet);
+
+    spatial_populate(result);
+
+    return result;
 }
 
-static
-float start_measure_frame(
-    ecs_world_t *world,
-    float user_delta_time)
+void ecs_spatial_free(
+    ecs_spatial_t *index)
 {
-    double delta_time = 0;
-
-    if (world->measure_frame_time || (user_delta_time == 0)) {
-        ecs_time_t t = world->frame_start_time;
-        do {
-            if (world->frame_start_time.sec) {
-                delta_time = insert_sleep(world, &t);
+    ecs_assert(index != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!index->world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-                ecs_time_measure(&t);
-            } else {
-                ecs_time_measure(&t);
-                if (world->stats.target_fps != 0) {
-                    delta_time = 1.0 / world->stats.target_fps;
-                } else {
-                    delta_time = 1.0 / 60.0; /* Best guess */
-                }
-            }
-        
-        /* Keep trying while delta_time is zero */
-        } while (delta_time == 0);
+    /* Delete the systems that update the index, so that they are no longer
+     * invoked when the component is set or removed */
+    ecs_world_t *world = index->world;
+    ecs_delete(world, index->on_set);
+    ecs_delete(world, index->un_set);
 
-        world->frame_start_time = t;  
+    ecs_vector_each(world->spatial_indices, ecs_spatial_t*, i_ptr, {
+        if (*i_ptr == index) {
+            ecs_vector_remove_index(
+                world->spatial_indices, ecs_spatial_t*, i_ptr_i);
+            break;
+        }
+    });
 
-        /* Keep track of total time passed in world */
-        world->stats.world_time_total_raw += (float)delta_time;
-    }
+    spatial_free(index);
+}
 
-    return (float)delta_time;
+int32_t ecs_spatial_count(
+    const ecs_spatial_t *index)
+{
+    ecs_assert(index != NULL, ECS_INVALID_PARAMETER, NULL);
+    return ecs_map_count(index->entities);
 }
 
-static
-void stop_measure_frame(
-    ecs_world_t* world)
+ecs_spatial_iter_t ecs_spatial_box(
+    ecs_spatial_t *index,
+    const float *min,
+    const float *max)
 {
-    if (world->measure_frame_time) {
-        ecs_time_t t = world->frame_start_time;
-        world->stats.frame_time_total += (float)ecs_time_measure(&t);
-    }
+    ecs_assert(min != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(max != NULL, ECS_INVALID_PARAMETER, NULL);
+    return spatial_iter(index, min, max);
 }
 
-float ecs_frame_begin(
-    ecs_world_t *world,
-    float user_delta_time)
+ecs_spatial_iter_t ecs_spatial_radius(
+    ecs_spatial_t *index,
+    const float *center,
+    float radius)
 {
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    ecs_assert(world->in_progress == false, ECS_INVALID_OPERATION, NULL);
+    ecs_assert(index != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(center != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(radius > 0, ECS_INVALID_PARAMETER, NULL);
 
-    ecs_assert(user_delta_time != 0 || ecs_os_has_time(), ECS_MISSING_OS_API, "get_time");
+    float min[3] = {0}, max[3] = {0};
+    int32_t d;
+    for (d = 0; d < index->dim; d ++) {
+        min[d] = center[d] - radius;
+        max[d] = center[d] + radius;
+    }
 
-    if (world->locking_enabled) {
-        ecs_lock(world);
+    ecs_spatial_iter_t it = spatial_iter(index, min, max);
+    for (d = 0; d < index->dim; d ++) {
+        it.center[d] = center[d];
     }
+    it.radius = radius;
 
-    /* Start measuring total frame time */
-    float delta_time = start_measure_frame(world, user_delta_time);
-    if (user_delta_time == 0) {
-        user_delta_time = delta_time;
-    }  
-
-    world->stats.delta_time_raw = user_delta_time;
-    world->stats.delta_time = user_delta_time * world->stats.time_scale;
-
-    /* Keep track of total scaled time passed in world */
-    world->stats.world_time_total += world->stats.delta_time;
-
-    return user_delta_time;
+    return it;
 }
 
-void ecs_frame_end(
-    ecs_world_t *world)
+bool ecs_spatial_next(
+    ecs_spatial_iter_t *it)
 {
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    ecs_assert(world->in_progress == false, ECS_INVALID_OPERATION, NULL);
+    ecs_assert(it != NULL, ECS_INVALID_PARAMETER, NULL);
 
-    world->stats.frame_count_total ++;   
+    ecs_spatial_cell_t *cell;
+    while ((cell = spatial_next_cell(it))) {
+        /* Cells that are entirely in the region are returned without testing
+         * the individual entities */
+        if (spatial_cell_inside(it, cell)) {
+            it->entities = ecs_vector_first(cell->entities, ecs_entity_t);
+            it->count = ecs_vector_count(cell->entities);
+            return true;
+        }
 
-    ecs_stage_merge_post_frame(world, &world->temp_stage);
+        ecs_entity_t *entities = ecs_vector_first(
+            cell->entities, ecs_entity_t);
+        ecs_spatial_point_t *points = ecs_vector_first(
+            cell->points, ecs_spatial_point_t);
 
-    ecs_vector_each(world->worker_stages, ecs_stage_t, stage, {
-        ecs_stage_merge_post_frame(world, stage);
-    });        
+        ecs_vector_clear(it->buffer);
 
-    if (world->locking_enabled) {
-        ecs_unlock(world);
+        int32_t i, count = ecs_vector_count(cell->entities);
+        for (i = 0; i < count; i ++) {
+            if (spatial_point_inside(it, &points[i])) {
+                ecs_entity_t *e_ptr = ecs_vector_add(
+                    &it->buffer, ecs_entity_t);
+                *e_ptr = entities[i];
+            }
+        }
 
-        ecs_os_mutex_lock(world->thr_sync);
-        ecs_os_cond_broadcast(world->thr_cond);
-        ecs_os_mutex_unlock(world->thr_sync);
+        if (ecs_vector_count(it->buffer)) {
+            it->entities = ecs_vector_first(it->buffer, ecs_entity_t);
+            it->count = ecs_vector_count(it->buffer);
+            return true;
+        }
     }
 
-    stop_measure_frame(world);
+    ecs_spatial_iter_fini(it);
+
+    return false;
 }
 
-const ecs_world_info_t* ecs_get_world_info(
-    ecs_world_t *world)
+void ecs_spatial_iter_fini(
+    ecs_spatial_iter_t *it)
 {
-    return &world->stats;
+    ecs_assert(it != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_vector_free(it->buffer);
+    it->buffer = NULL;
+    it->entities = NULL;
+    it->count = 0;
 }
 
-void ecs_notify_queries(
-    ecs_world_t *world,
-    ecs_query_event_t *event)
+#endif
+
+/* -- Private functions -- */
+
+ecs_stage_t *ecs_get_stage(
+    ecs_world_t **world_ptr)
 {
-    int32_t i, count = ecs_vector_count(world->queries);
-    ecs_query_t **queries = ecs_vector_first(world->queries, ecs_query_t*);
+    ecs_world_t *world = *world_ptr;
 
-    for (i = 0; i < count; i ++) {
-        ecs_query_notify(world, queries[i], event);
-    }    
+    ecs_assert(world->magic == ECS_WORLD_MAGIC ||
+               world->magic == ECS_THREAD_MAGIC,
+               ECS_INTERNAL_ERROR,
+               NULL);
+
+    if (world->magic == ECS_WORLD_MAGIC) {
+        if (world->in_progress) {
+            return &world->temp_stage;
+        } else {
+            return &world->stage;
+        }
+    } else if (world->magic == ECS_THREAD_MAGIC) {
+        ecs_thread_t *thread = (ecs_thread_t*)world;
+        *world_ptr = thread->world;
+        return thread->stage;
+    }
+    
+    return NULL;
 }
 
-void ecs_delete_table(
+/* Evaluate component monitor. If a monitored entity changed it will have set a
+ * flag in one of the world's component monitors. Queries can register 
+ * themselves with component monitors to determine whether they need to rematch
+ * with tables. */
+static
+void eval_component_monitor(
     ecs_world_t *world,
-    ecs_table_t *table)
+    ecs_component_monitor_t *mon,
+    ecs_vector_t *tables,
+    ecs_vector_t *changed)
 {
-    /* Notify queries that table is to be removed */
-    ecs_notify_queries(
-        world, &(ecs_query_event_t){
-            .kind = EcsQueryTableUnmatch,
-            .table = table
-        });
+    if (!mon->rematch) {
+        return;
+    }
 
-    uint32_t id = table->id;
+    world->stats.monitor_eval_count_total ++;
 
-    /* Free resources associated with table */
-    ecs_table_free(world, table);
+    ecs_vector_t *eval[ECS_HI_COMPONENT_ID];
+    int32_t eval_count = 0;
 
-    /* Remove table from sparse set */
-    ecs_assert(id != 0, ECS_INTERNAL_ERROR, NULL);
-    ecs_sparse_remove(world->store.tables, id);
+    int32_t i;
+    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
+        if (mon->dirty_flags[i]) {
+            eval[eval_count ++] = mon->monitors[i];
+            mon->dirty_flags[i] = 0;
+        }
+    }
 
-    /* Don't do generations as we want table ids to remain 32 bit */
-    ecs_sparse_set_generation(world->store.tables, id);
+    for (i = 0; i < eval_count; i ++) {
+        ecs_vector_each(eval[i], ecs_query_t*, q_ptr, {
+            ecs_query_notify(world, *q_ptr, &(ecs_query_event_t) {
+                .kind = EcsQueryTableRematch,
+                .tables = tables,
+                .entities = changed
+            });
+        });
+    }
+    
+    mon->rematch = false;
 }
 
-static
-ecs_switch_header_t *get_header(
-    const ecs_switch_t *sw,
-    uint64_t value)
+void ecs_component_monitor_mark(
+    ecs_component_monitor_t *mon,
+    ecs_entity_t component)
 {
-    if (value == 0) {
-        return NULL;
+    /* Only flag if there are actually monitors registered, so that we
+     * don't waste cycles evaluating monitors if there's no interest */
+    if (mon->monitors[component]) {
+        mon->dirty_flags[component] = true;
+        mon->rematch = true;
     }
+}
 
-    ecs_assert(value >= sw->min, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(value <= sw->max, ECS_INTERNAL_ERROR, NULL);
+void ecs_component_monitor_register(
+    ecs_component_monitor_t *mon,
+    ecs_entity_t component,
+    ecs_query_t *query)
+{
+    ecs_assert(mon != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(query != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    uint64_t index = value - sw->min;
+    /* Ignore component ids > ECS_HI_COMPONENT_ID */
+    if(component >= ECS_HI_COMPONENT_ID) {
+        return;
+    }    
 
-    return &sw->headers[index];
+    ecs_query_t **q = ecs_vector_add(&mon->monitors[component], ecs_query_t*);
+    *q = query;
 }
 
-static
-void remove_node(
-    ecs_switch_header_t *hdr,
-    ecs_switch_node_t *nodes,
-    ecs_switch_node_t *node,
-    int32_t element)
-{    
-    /* The node is currently assigned to a value */
-    if (hdr->element == element) {
-        ecs_assert(node->prev == -1, ECS_INVALID_PARAMETER, NULL);
-        /* If this is the first node, update the header */
-        hdr->element = node->next;
-    } else {
-        /* If this is not the first node, update the previous node */
-        ecs_assert(node->prev != -1, ECS_INVALID_PARAMETER, NULL);
-        ecs_switch_node_t *prev_node = &nodes[node->prev];
-        prev_node->next = node->next;
-    }
+void ecs_component_monitor_unregister(
+    ecs_component_monitor_t *mon,
+    ecs_query_t *query)
+{
+    ecs_assert(mon != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(query != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    int32_t next = node->next;
-    if (next != -1) {
-        ecs_assert(next >= 0, ECS_INVALID_PARAMETER, NULL);
-        /* If this is not the last node, update the next node */
-        ecs_switch_node_t *next_node = &nodes[next];
-        next_node->prev = node->prev;
+    int i;
+    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
+        ecs_vector_t *monitors = mon->monitors[i];
+        ecs_vector_each(monitors, ecs_query_t*, q_ptr, {
+            if (*q_ptr == query) {
+                ecs_vector_remove_index(monitors, ecs_query_t*, q_ptr_i);
+                break;
+            }
+        });
     }
-
-    /* Decrease count of current header */
-    hdr->count --;
-    ecs_assert(hdr->count >= 0, ECS_INTERNAL_ERROR, NULL);
 }
 
-ecs_switch_t* ecs_switch_new(
-    uint64_t min, 
-    uint64_t max,
-    int32_t elements)
+void ecs_component_monitor_free(
+    ecs_component_monitor_t *mon)
 {
-    ecs_assert(min != max, ECS_INVALID_PARAMETER, NULL);
+    int i;
+    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
+        ecs_vector_free(mon->monitors[i]);
+    }
+}
 
-    /* Min must be larger than 0, as 0 is an invalid entity id, and should
-     * therefore never occur as case id */
-    ecs_assert(min > 0, ECS_INVALID_PARAMETER, NULL);
+static
+void init_store(ecs_world_t *world) {
+    ecs_os_memset(&world->store, 0, ECS_SIZEOF(ecs_store_t));
+    
+    /* Initialize entity index */
+    world->store.entity_index = ecs_sparse_new(ecs_record_t);
+    ecs_sparse_set_alloc_tag(world->store.entity_index, EcsAllocEntityIndex);
+    ecs_sparse_set_id_source(world->store.entity_index, &world->stats.last_id);
 
-    ecs_switch_t *result = ecs_os_malloc(ECS_SIZEOF(ecs_switch_t));
-    result->min = min;
-    result->max = max;
+    /* Initialize root table */
+    world->store.tables = ecs_sparse_new(ecs_table_t);
 
-    int32_t count = (int32_t)(max - min) + 1;
-    result->headers = ecs_os_calloc(ECS_SIZEOF(ecs_switch_header_t) * count);
-    result->nodes = ecs_vector_new(ecs_switch_node_t, elements);
-    result->values = ecs_vector_new(uint64_t, elements);
+    /* Initialize one root table per stage */
+    ecs_init_root_table(world);
+}
+
+static
+void clean_tables(
+    ecs_world_t *world)
+{
+    int32_t i, count = ecs_sparse_count(world->store.tables);
 
-    int64_t i;
     for (i = 0; i < count; i ++) {
-        result->headers[i].element = -1;
-        result->headers[i].count = 0;
+        ecs_table_t *t = ecs_sparse_get(world->store.tables, ecs_table_t, i);
+        ecs_table_free(world, t);
     }
 
-    ecs_switch_node_t *nodes = ecs_vector_first(
-        result->nodes, ecs_switch_node_t);
-    uint64_t *values = ecs_vector_first(
-        result->values, uint64_t);        
-
-    for (i = 0; i < elements; i ++) {
-        nodes[i].prev = -1;
-        nodes[i].next = -1;
-        values[i] = 0;
+    /* Clear the root table */
+    if (count) {
+        ecs_table_reset(world, &world->store.root);
     }
+}
 
-    return result;
+static
+void fini_store(ecs_world_t *world) {
+    ecs_track_component_stats(world, false);
+    clean_tables(world);
+    ecs_sparse_free(world->store.tables);
+    ecs_map_free(world->store.table_index);
+    ecs_table_free(world, &world->store.root);
+    ecs_sparse_free(world->store.entity_index);
 }
 
-void ecs_switch_free(
-    ecs_switch_t *sw)
-{
-    ecs_os_free(sw->headers);
-    ecs_vector_free(sw->nodes);
-    ecs_vector_free(sw->values);
-    ecs_os_free(sw);
-}
+/* -- Public functions -- */
 
-void ecs_switch_add(
-    ecs_switch_t *sw)
-{
-    ecs_switch_node_t *node = ecs_vector_add(&sw->nodes, ecs_switch_node_t);
-    uint64_t *value = ecs_vector_add(&sw->values, uint64_t);
-    node->prev = -1;
-    node->next = -1;
-    *value = 0;
-}
 
-void ecs_switch_set_count(
-    ecs_switch_t *sw,
-    int32_t count)
-{
-    int32_t old_count = ecs_vector_count(sw->nodes);
-    if (old_count == count) {
-        return;
-    }
+FLECS_EXPORT
+bool ecs_os_has_heap(void);
 
-    ecs_vector_set_count(&sw->nodes, ecs_switch_node_t, count);
-    ecs_vector_set_count(&sw->values, uint64_t, count);
+/** Are threading functions available? */
+FLECS_EXPORT
+bool ecs_os_has_threading(void);
 
-    ecs_switch_node_t *nodes = ecs_vector_first(sw->nodes, ecs_switch_node_t);
-    uint64_t *values = ecs_vector_first(sw->values, uint64_t);
+/** Are time functions available? */
+FLECS_EXPORT
+bool ecs_os_has_time(void);
 
-    int32_t i;
-    for (i = old_count; i < count; i ++) {
-        ecs_switch_node_t *node = &nodes[i];
-        node->prev = -1;
-        node->next = -1;
-        values[i] = 0;
-    }
-}
+/** Are logging functions available? */
+FLECS_EXPORT
+bool ecs_os_has_logging(void);
 
-void ecs_switch_set_min_count(
-    ecs_switch_t *sw,
-    int32_t count)
-{
-    int32_t old_count = ecs_vector_count(sw->nodes);
-    if (old_count >= count) {
-        return;
-    }
+/** Are dynamic library functions available? */
+FLECS_EXPORT
+bool ecs_os_has_dl(void);
 
-    ecs_switch_set_count(sw, count);
-}
+/** Are module path functions available? */
+FLECS_EXPORT
+bool ecs_os_has_modules(void);
 
-void ecs_switch_addn(
-    ecs_switch_t *sw,
-    int32_t count)
-{
-    int32_t old_count = ecs_vector_count(sw->nodes);
-    ecs_switch_set_count(sw, old_count + count);
-}
 
-void ecs_switch_set(
-    ecs_switch_t *sw,
-    int32_t element,
-    uint64_t value)
-{
-    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element < ecs_vector_count(sw->nodes), ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element < ecs_vector_count(sw->values), ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element >= 0, ECS_INVALID_PARAMETER, NULL);
+ecs_world_t *ecs_mini(void) {
+    ecs_os_init();
 
-    uint64_t *values = ecs_vector_first(sw->values, uint64_t);
-    uint64_t cur_value = values[element];
+    ecs_trace_1("bootstrap");
+    ecs_log_push();
 
-    /* If the node is already assigned to the value, nothing to be done */
-    if (cur_value == value) {
-        return;
+    if (!ecs_os_has_heap()) {
+        ecs_abort(ECS_MISSING_OS_API, NULL);
     }
 
-    ecs_switch_node_t *nodes = ecs_vector_first(sw->nodes, ecs_switch_node_t);
-    ecs_switch_node_t *node = &nodes[element];
-
-    ecs_switch_header_t *cur_hdr = get_header(sw, cur_value);
-    ecs_switch_header_t *dst_hdr = get_header(sw, value);
-
-    if (cur_hdr) {
-        remove_node(cur_hdr, nodes, node, element);
+    if (!ecs_os_has_threading()) {
+        ecs_trace_1("threading not available");
     }
 
-    /* Now update the node itself by adding it as the first node of dst */
-    node->next = dst_hdr->element;
-    node->prev = -1;
-    values[element] = value;
-
-    /* Also update the dst header */
-    int32_t first = dst_hdr->element;
-    if (first != -1) {
-        ecs_assert(first >= 0, ECS_INTERNAL_ERROR, NULL);
-        ecs_switch_node_t *first_node = &nodes[first];
-        first_node->prev = element;
+    if (!ecs_os_has_time()) {
+        ecs_trace_1("time management not available");
     }
 
-    dst_hdr->element = element;
-    dst_hdr->count ++;
-}
-
-void ecs_switch_remove(
-    ecs_switch_t *sw,
-    int32_t element)
-{
-    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element < ecs_vector_count(sw->nodes), ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_world_t *world = ecs_os_malloc(sizeof(ecs_world_t));
+    ecs_assert(world != NULL, ECS_OUT_OF_MEMORY, NULL);
 
-    uint64_t *values = ecs_vector_first(sw->values, uint64_t);
-    uint64_t value = values[element];
-    ecs_switch_node_t *nodes = ecs_vector_first(sw->nodes, ecs_switch_node_t);
-    ecs_switch_node_t *node = &nodes[element];
+    world->magic = ECS_WORLD_MAGIC;
+    memset(&world->c_info, 0, sizeof(ecs_c_info_t) * ECS_HI_COMPONENT_ID); 
 
-    /* If node is currently assigned to a case, remove it from the list */
-    if (value != 0) {
-        ecs_switch_header_t *hdr = get_header(sw, value);
-        ecs_assert(hdr != NULL, ECS_INTERNAL_ERROR, NULL);
-        remove_node(hdr, nodes, node, element);
-    }
+    world->t_info = ecs_map_new(ecs_c_info_t, 0);  
+    world->fini_actions = NULL; 
 
-    /* Remove element from arrays */
-    ecs_vector_remove_index(sw->nodes, ecs_switch_node_t, element);
-    ecs_vector_remove_index(sw->values, uint64_t, element);
+    world->aliases = NULL;
 
-    if (ecs_vector_count(sw->nodes)) {
-        int32_t prev = node->prev;
-        if (prev != -1) {
-            ecs_assert(prev >= 0, ECS_INVALID_PARAMETER, NULL);
-            nodes[prev].next = element;
-        } else {
-            ecs_switch_header_t *hdr = get_header(sw, values[element]);
-            if (hdr && hdr->element != -1) {
-                ecs_assert(hdr->element == ecs_vector_count(sw->nodes), 
-                    ECS_INTERNAL_ERROR, NULL);
-                hdr->element = element;
-            }             
-        }
-    }
-}
+    world->queries = ecs_vector_new(ecs_query_t*, 0);
+    world->fini_tasks = ecs_vector_new(ecs_entity_t, 0);
+    world->timer_wheel = NULL;
+    world->child_tables = NULL;
+    world->childof_index = NULL;
+    world->instance_tables = NULL;
+    world->watched_changed = NULL;
+    world->name_prefix = NULL;
 
-uint64_t ecs_switch_get(
-    const ecs_switch_t *sw,
-    int32_t element)
-{
-    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element < ecs_vector_count(sw->nodes), ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element < ecs_vector_count(sw->values), ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element >= 0, ECS_INVALID_PARAMETER, NULL);
+    memset(&world->component_monitors, 0, sizeof(world->component_monitors));
+    memset(&world->parent_monitors, 0, sizeof(world->parent_monitors));
 
-    uint64_t *values = ecs_vector_first(sw->values, uint64_t);
-    return values[element];
-}
+    world->type_handles = ecs_map_new(ecs_entity_t, 0);
+    world->on_activate_components = ecs_map_new(ecs_on_demand_in_t, 0);
+    world->on_enable_components = ecs_map_new(ecs_on_demand_in_t, 0);
 
-ecs_vector_t* ecs_switch_values(
-    const ecs_switch_t *sw)
-{
-    return sw->values;
-}
+    world->stage_count = 2;
+    world->worker_stages = NULL;
+    world->workers = NULL;
+    world->workers_waiting = 0;
+    world->workers_running = 0;
+    world->valid_schedule = false;
+    world->quit_workers = false;
+    world->in_progress = false;
+    world->is_merging = false;
+    world->auto_merge = true;
+    world->measure_frame_time = false;
+    world->measure_system_time = false;
+    world->should_quit = false;
+    world->locking_enabled = false;
+    world->pipeline = 0;
 
-int32_t ecs_switch_case_count(
-    const ecs_switch_t *sw,
-    uint64_t value)
-{
-    ecs_switch_header_t *hdr = get_header(sw, value);
-    if (!hdr) {
-        return 0;
+    world->frame_start_time = (ecs_time_t){0, 0};
+    if (ecs_os_has_time()) {
+        ecs_os_get_time(&world->world_start_time);
     }
 
-    return hdr->count;
-}
+    world->stats.target_fps = 0;
+    world->stats.last_id = 0;
 
-int32_t ecs_switch_first(
-    const ecs_switch_t *sw,
-    uint64_t value)
-{
-    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(value <= sw->max, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(value >= sw->min, ECS_INVALID_PARAMETER, NULL);
+    world->stats.delta_time_raw = 0;
+    world->stats.delta_time = 0;
+    world->stats.time_scale = 1.0;
+    world->stats.frame_time_total = 0;
+    world->stats.sleep_err = 0;
+    world->stats.system_time_total = 0;
+    world->stats.merge_time_total = 0;
+    world->stats.world_time_total = 0;
+    world->stats.frame_count_total = 0;
+    world->stats.merge_count_total = 0;
+    world->stats.systems_ran_frame = 0;
+    world->stats.pipeline_build_count_total = 0;
+    world->stats.table_create_count_total = 0;
+    world->stats.table_delete_count_total = 0;
+    world->stats.table_move_count_total = 0;
+    world->stats.table_append_count_total = 0;
+    world->stats.table_remove_count_total = 0;
+    world->stats.defer_new_count_total = 0;
+    world->stats.defer_add_count_total = 0;
+    world->stats.defer_remove_count_total = 0;
+    world->stats.defer_set_count_total = 0;
+    world->stats.defer_delete_count_total = 0;
+    world->stats.defer_flush_count_total = 0;
+    world->stats.rematch_count_total = 0;
+    world->stats.monitor_eval_count_total = 0;
+    
+    world->range_check_enabled = true;
 
-    ecs_switch_header_t *hdr = get_header(sw, value);
-    ecs_assert(hdr != NULL, ECS_INVALID_PARAMETER, NULL);
+    world->fps_sleep = 0;
 
-    return hdr->element;
-}
+    world->context = NULL;
 
-int32_t ecs_switch_next(
-    const ecs_switch_t *sw,
-    int32_t element)
-{
-    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element < ecs_vector_count(sw->nodes), ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(element >= 0, ECS_INVALID_PARAMETER, NULL);
+    world->arg_fps = 0;
+    world->arg_threads = 0;
 
-    ecs_switch_node_t *nodes = ecs_vector_first(
-        sw->nodes, ecs_switch_node_t);
+    world->profiler = NULL;
+    world->profiler_fini_set = false;
+    world->frame_span = 0;
+    world->table_gc_frames = 0;
+    world->par_job = NULL;
+    world->base_cache_version = 0;
+    world->sparse_components = NULL;
+    world->read_count = 0;
+    world->read_epoch = 0;
+    world->read_enabled = false;
+    world->command_queues = NULL;
+    world->double_buffered_count = 0;
+    world->spatial_indices = NULL;
+    world->component_stats = NULL;
 
-    return nodes[element].next;
-}
+    ecs_stage_init(world, &world->stage);
+    ecs_stage_init(world, &world->temp_stage);
+    init_store(world);
 
+    world->stage.world = world;
+    world->temp_stage.world = world;
 
-ecs_iter_t ecs_filter_iter(
-    ecs_world_t *world,
-    const ecs_filter_t *filter)
-{
-    ecs_filter_iter_t iter = {
-        .filter = filter ? *filter : (ecs_filter_t){0},
-        .tables = world->store.tables,
-        .index = 0
-    };
-
-    return (ecs_iter_t){
-        .world = world,
-        .iter.filter = iter
-    };
-}
+    ecs_bootstrap(world);
 
-bool ecs_filter_next(
-    ecs_iter_t *it)
-{
-    ecs_filter_iter_t *iter = &it->iter.filter;
-    ecs_sparse_t *tables = iter->tables;
-    int32_t count = ecs_sparse_count(tables);
-    int32_t i;
+    ecs_log_pop();
 
-    for (i = iter->index; i < count; i ++) {
-        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
-        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
-        
-        ecs_data_t *data = ecs_table_get_data(table);
+    return world;
+}
 
-        if (!data) {
-            continue;
-        }
+ecs_world_t *ecs_init(void) {
+    ecs_world_t *world = ecs_mini();
 
-        if (!ecs_table_match_filter(it->world, table, &iter->filter)) {
-            continue;
-        }
+#ifdef FLECS_MODULE_H
+    ecs_trace_1("import builtin modules");
+    ecs_log_push();
+#ifdef FLECS_SYSTEM_H
+    ECS_IMPORT(world, FlecsSystem);
+#endif
+#ifdef FLECS_PIPELINE_H
+    ECS_IMPORT(world, FlecsPipeline);
+#endif
+#ifdef FLECS_TIMER_H
+    ECS_IMPORT(world, FlecsTimer);
+#endif
+    ecs_log_pop();
+#endif
 
-        iter->table.table = table;
-        it->table = &iter->table;
-        it->table_columns = data->columns;
-        it->count = ecs_table_count(table);
-        it->entities = ecs_vector_first(data->entities, ecs_entity_t);
-        iter->index = i + 1;
+    return world;
+}
 
-        return true;
+#define ARG(short, long, action)\
+    if (i < argc) {\
+        if (argv[i][0] == '-') {\
+            if (argv[i][1] == '-') {\
+                if (long && !strcmp(&argv[i][2], long ? long : "")) {\
+                    action;\
+                    parsed = true;\
+                }\
+            } else {\
+                if (short && argv[i][1] == short) {\
+                    action;\
+                    parsed = true;\
+                }\
+            }\
+        }\
     }
 
-    return false;
-}
-
-/* Add an extra element to the buffer */
-static
-void ecs_strbuf_grow(
-    ecs_strbuf_t *b)
+ecs_world_t* ecs_init_w_args(
+    int argc,
+    char *argv[])
 {
-    /* Allocate new element */
-    ecs_strbuf_element_embedded *e = ecs_os_malloc(sizeof(ecs_strbuf_element_embedded));
-    b->size += b->current->pos;
-    b->current->next = (ecs_strbuf_element*)e;
-    b->current = (ecs_strbuf_element*)e;
-    b->elementCount ++;
-    e->super.buffer_embedded = true;
-    e->super.buf = e->buf;
-    e->super.pos = 0;
-    e->super.next = NULL;
+    (void)argc;
+    (void)argv;
+    return ecs_init();
 }
 
-/* Add an extra dynamic element */
 static
-void ecs_strbuf_grow_str(
-    ecs_strbuf_t *b,
-    char *str,
-    char *alloc_str,
-    int32_t size)
+void on_demand_in_map_deinit(
+    ecs_map_t *map)
 {
-    /* Allocate new element */
-    ecs_strbuf_element_str *e = ecs_os_malloc(sizeof(ecs_strbuf_element_str));
-    b->size += b->current->pos;
-    b->current->next = (ecs_strbuf_element*)e;
-    b->current = (ecs_strbuf_element*)e;
-    b->elementCount ++;
-    e->super.buffer_embedded = false;
-    e->super.pos = size ? size : (int32_t)ecs_os_strlen(str);
-    e->super.next = NULL;
-    e->super.buf = str;
-    e->alloc_str = alloc_str;
-}
+    ecs_map_iter_t it = ecs_map_iter(map);
+    ecs_on_demand_in_t *elem;
 
-static
-char* ecs_strbuf_ptr(
-    ecs_strbuf_t *b)
-{
-    if (b->buf) {
-        return &b->buf[b->current->pos];
-    } else {
-        return &b->current->buf[b->current->pos];
+    while ((elem = ecs_map_next(&it, ecs_on_demand_in_t, NULL))) {
+        ecs_vector_free(elem->systems);
     }
-}
 
-/* Compute the amount of space left in the current element */
-static
-int32_t ecs_strbuf_memLeftInCurrentElement(
-    ecs_strbuf_t *b)
-{
-    if (b->current->buffer_embedded) {
-        return ECS_STRBUF_ELEMENT_SIZE - b->current->pos;
-    } else {
-        return 0;
-    }
+    ecs_map_free(map);
 }
 
-/* Compute the amount of space left */
 static
-int32_t ecs_strbuf_memLeft(
-    ecs_strbuf_t *b)
+void ctor_init_zero(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    const ecs_entity_t *entity_ptr,
+    void *ptr,
+    size_t size,
+    int32_t count,
+    void *ctx)
 {
-    if (b->max) {
-        return b->max - b->size - b->current->pos;
-    } else {
-        return INT_MAX;
-    }
+    (void)world;
+    (void)component;
+    (void)entity_ptr;
+    (void)ctx;
+    ecs_os_memset(ptr, 0, ecs_from_size_t(size) * count);
 }
 
-static
-void ecs_strbuf_init(
-    ecs_strbuf_t *b)
+void ecs_notify_tables(
+    ecs_world_t *world,
+    ecs_table_event_t *event)
 {
-    /* Initialize buffer structure only once */
-    if (!b->elementCount) {
-        b->size = 0;
-        b->firstElement.super.next = NULL;
-        b->firstElement.super.pos = 0;
-        b->firstElement.super.buffer_embedded = true;
-        b->firstElement.super.buf = b->firstElement.buf;
-        b->elementCount ++;
-        b->current = (ecs_strbuf_element*)&b->firstElement;
+    ecs_sparse_t *tables = world->store.tables;
+    int32_t i, count = ecs_sparse_count(tables);
+
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        ecs_table_notify(world, table, event);
     }
 }
 
-/* Quick custom function to copy a maxium number of characters and
- * simultaneously determine length of source string. */
-static
-int32_t fast_strncpy(
-    char * dst,
-    const char * src,
-    int n_cpy,
-    int n)
+void ecs_set_component_actions_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    EcsComponentLifecycle *lifecycle)
 {
-    ecs_assert(n_cpy >= 0, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(n >= 0, ECS_INTERNAL_ERROR, NULL);
+#ifndef NDEBUG
+    const EcsComponent *component_ptr = ecs_get(world, component, EcsComponent);
 
-    const char *ptr, *orig = src;
-    char ch;
+    /* Cannot register lifecycle actions for things that aren't a component */
+    ecs_assert(component_ptr != NULL, ECS_INVALID_PARAMETER, NULL);
 
-    for (ptr = src; (ptr - orig < n) && (ch = *ptr); ptr ++) {
-        if (ptr - orig < n_cpy) {
-            *dst = ch;
-            dst ++;
-        }
-    }
+    /* Cannot register lifecycle actions for components with size 0 */
+    ecs_assert(component_ptr->size != 0, ECS_INVALID_PARAMETER, NULL);
+#endif
 
-    ecs_assert(ptr - orig < INT32_MAX, ECS_INTERNAL_ERROR, NULL);
+    ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, component);
+    ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    return (int32_t)(ptr - orig);
-}
+    /* Components with fields cannot have lifecycle actions */
+    ecs_assert(c_info->fields == NULL, ECS_INVALID_PARAMETER, NULL);
 
-/* Append a format string to a buffer */
-static
-bool ecs_strbuf_vappend_intern(
-    ecs_strbuf_t *b,
-    const char* str,
-    va_list args)
-{
-    bool result = true;
-    va_list arg_cpy;
+    /* Double buffered components are copied with memcpy */
+    ecs_assert(!c_info->double_buffered, ECS_INVALID_PARAMETER, NULL);
 
-    if (!str) {
-        return result;
-    }
+    if (c_info->lifecycle_set) {
+        ecs_assert(c_info->component == component, ECS_INTERNAL_ERROR, NULL);
+        ecs_assert(c_info->lifecycle.ctor == lifecycle->ctor, 
+            ECS_INCONSISTENT_COMPONENT_ACTION, NULL);
+        ecs_assert(c_info->lifecycle.dtor == lifecycle->dtor, 
+            ECS_INCONSISTENT_COMPONENT_ACTION, NULL);
+        ecs_assert(c_info->lifecycle.copy == lifecycle->copy, 
+            ECS_INCONSISTENT_COMPONENT_ACTION, NULL);
+        ecs_assert(c_info->lifecycle.move == lifecycle->move, 
+            ECS_INCONSISTENT_COMPONENT_ACTION, NULL);
+    } else {
+        c_info->component = component;
+        c_info->lifecycle = *lifecycle;
+        c_info->lifecycle_set = true;
 
-    ecs_strbuf_init(b);
+        /* If no constructor is set, invoking any of the other lifecycle actions 
+         * is not safe as they will potentially access uninitialized memory. For 
+         * ease of use, if no constructor is specified, set a default one that 
+         * initializes the component to 0. */
+        if (!lifecycle->ctor && (lifecycle->dtor || lifecycle->copy || lifecycle->move)) {
+            c_info->lifecycle.ctor = ctor_init_zero;   
+        }
 
-    int32_t memLeftInElement = ecs_strbuf_memLeftInCurrentElement(b);
-    int32_t memLeft = ecs_strbuf_memLeft(b);
-
-    if (!memLeft) {
-        return false;
+        ecs_notify_tables(world, &(ecs_table_event_t) {
+            .kind = EcsTableComponentInfo,
+            .component = component
+        });
     }
+}
 
-    /* Compute the memory required to add the string to the buffer. If user
-     * provided buffer, use space left in buffer, otherwise use space left in
-     * current element. */
-    int32_t max_copy = b->buf ? memLeft : memLeftInElement;
-    int32_t memRequired;
+void ecs_set_component_sparse_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-    va_copy(arg_cpy, args);
-    memRequired = vsnprintf(
-        ecs_strbuf_ptr(b), (size_t)(max_copy + 1), str, args);
+    const EcsComponent *component_ptr = ecs_get(world, component, EcsComponent);
 
-    if (memRequired <= memLeftInElement) {
-        /* Element was large enough to fit string */
-        b->current->pos += memRequired;
-    } else if ((memRequired - memLeftInElement) < memLeft) {
-        /* If string is a format string, a new buffer of size memRequired is
-         * needed to re-evaluate the format string and only use the part that
-         * wasn't already copied to the previous element */
-        if (memRequired <= ECS_STRBUF_ELEMENT_SIZE) {
-            /* Resulting string fits in standard-size buffer. Note that the
-             * entire string needs to fit, not just the remainder, as the
-             * format string cannot be partially evaluated */
-            ecs_strbuf_grow(b);
+    /* Only components with data can be stored in a sparse set */
+    ecs_assert(component_ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component_ptr->size != 0, ECS_INVALID_PARAMETER, NULL);
 
-            /* Copy entire string to new buffer */
-            ecs_os_vsprintf(ecs_strbuf_ptr(b), str, arg_cpy);
+    /* Entities that already have the component are stored in tables */
+    ecs_assert(ecs_count_entity(world, component) == 0, 
+        ECS_INVALID_PARAMETER, NULL);
 
-            /* Ignore the part of the string that was copied into the
-             * previous buffer. The string copied into the new buffer could
-             * be memmoved so that only the remainder is left, but that is
-             * most likely more expensive than just keeping the entire
-             * string. */
+    ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, component);
+    ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL);
 
-            /* Update position in buffer */
-            b->current->pos += memRequired;
-        } else {
-            /* Resulting string does not fit in standard-size buffer.
-             * Allocate a new buffer that can hold the entire string. */
-            char *dst = ecs_os_malloc(memRequired + 1);
-            ecs_os_vsprintf(dst, str, arg_cpy);
-            ecs_strbuf_grow_str(b, dst, dst, memRequired);
-        }
-    } else {
-        /* Buffer max has been reached */
-        result = false;
-    }
+    /* Components with fields are stored in tables */
+    ecs_assert(c_info->fields == NULL, ECS_INVALID_PARAMETER, NULL);
 
-    va_end(arg_cpy);
+    /* Double buffered components are stored in tables */
+    ecs_assert(!c_info->double_buffered, ECS_INVALID_PARAMETER, NULL);
 
-    return result;
+    if (!c_info->sparse) {
+        c_info->sparse = _ecs_sparse_new(component_ptr->size);
+        c_info->size = component_ptr->size;
+        c_info->component = component;
+
+        ecs_entity_t *elem = ecs_vector_add(
+            &world->sparse_components, ecs_entity_t);
+        *elem = component;
+    }
 }
 
-static
-bool ecs_strbuf_append_intern(
-    ecs_strbuf_t *b,
-    const char* str,
-    int n)
+void ecs_set_component_fields_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    const ecs_field_t *fields,
+    int32_t count)
 {
-    bool result = true;
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(fields != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(count > 0, ECS_INVALID_PARAMETER, NULL);
 
-    if (!str) {
-        return result;
-    }
+    const EcsComponent *component_ptr = ecs_get(world, component, EcsComponent);
 
-    ecs_strbuf_init(b);
+    /* Only components with data can be split up in fields */
+    ecs_assert(component_ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component_ptr->size != 0, ECS_INVALID_PARAMETER, NULL);
 
-    int32_t memLeftInElement = ecs_strbuf_memLeftInCurrentElement(b);
-    int32_t memLeft = ecs_strbuf_memLeft(b);
+    /* Entities that already have the component store it as a single value */
+    ecs_assert(ecs_count_entity(world, component) == 0, 
+        ECS_INVALID_PARAMETER, NULL);
 
-    if (memLeft <= 0) {
-        return false;
+    ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, component);
+    ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* Fields are copied with memcpy, and are not stored in a sparse set */
+    ecs_assert(!c_info->lifecycle_set, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(c_info->sparse == NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!c_info->double_buffered, ECS_INVALID_PARAMETER, NULL);
+
+    if (c_info->fields) {
+        return;
     }
 
-    /* Compute the memory required to add the string to the buffer. If user
-     * provided buffer, use space left in buffer, otherwise use space left in
-     * current element. */
-    int32_t max_copy = b->buf ? memLeft : memLeftInElement;
-    int32_t memRequired;
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        ecs_assert(fields[i].offset >= 0, ECS_INVALID_PARAMETER, NULL);
+        ecs_assert(fields[i].size > 0, ECS_INVALID_PARAMETER, NULL);
+        ecs_assert(fields[i].offset + fields[i].size <= component_ptr->size, 
+            ECS_INVALID_PARAMETER, NULL);
+    }
 
-    if (n < 0) n = INT_MAX;
+    c_info->component = component;
+    c_info->fields = ecs_vector_new(ecs_field_t, count);
+    ecs_field_t *elem = ecs_vector_addn(&c_info->fields, ecs_field_t, count);
+    ecs_os_memcpy(elem, fields, ECS_SIZEOF(ecs_field_t) * count);
 
-    memRequired = fast_strncpy(ecs_strbuf_ptr(b), str, max_copy, n);
+    /* Empty tables with the component may already exist */
+    ecs_notify_tables(world, &(ecs_table_event_t) {
+        .kind = EcsTableComponentInfo,
+        .component = component
+    });
+}
 
-    if (memRequired <= memLeftInElement) {
-        /* Element was large enough to fit string */
-        b->current->pos += memRequired;
-    } else if ((memRequired - memLeftInElement) < memLeft) {
-        /* Element was not large enough, but buffer still has space */
-        b->current->pos += memLeftInElement;
-        memRequired -= memLeftInElement;
+void ecs_set_component_double_buffered_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-        /* Current element was too small, copy remainder into new element */
-        if (memRequired < ECS_STRBUF_ELEMENT_SIZE) {
-            /* A standard-size buffer is large enough for the new string */
-            ecs_strbuf_grow(b);
+    const EcsComponent *component_ptr = ecs_get(world, component, EcsComponent);
 
-            /* Copy the remainder to the new buffer */
-            if (n) {
-                /* If a max number of characters to write is set, only a
-                    * subset of the string should be copied to the buffer */
-                ecs_os_strncpy(
-                    ecs_strbuf_ptr(b),
-                    str + memLeftInElement,
-                    (size_t)memRequired);
-            } else {
-                ecs_os_strcpy(ecs_strbuf_ptr(b), str + memLeftInElement);
-            }
+    /* Only components with data can be double buffered */
+    ecs_assert(component_ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component_ptr->size != 0, ECS_INVALID_PARAMETER, NULL);
 
-            /* Update to number of characters copied to new buffer */
-            b->current->pos += memRequired;
-        } else {
-            char *remainder = ecs_os_strdup(str + memLeftInElement);
-            ecs_strbuf_grow_str(b, remainder, remainder, memRequired);
-        }
-    } else {
-        /* Buffer max has been reached */
-        result = false;
+    /* Entities that already have the component have no second buffer */
+    ecs_assert(ecs_count_entity(world, component) == 0, 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, component);
+    ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* Values are copied with memcpy, and must be stored in a table column */
+    ecs_assert(!c_info->lifecycle_set, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(c_info->sparse == NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(c_info->fields == NULL, ECS_INVALID_PARAMETER, NULL);
+
+    if (c_info->double_buffered) {
+        return;
     }
 
-    return result;
+    c_info->component = component;
+    c_info->double_buffered = true;
+    world->double_buffered_count ++;
+
+    /* Empty tables with the component may already exist */
+    ecs_notify_tables(world, &(ecs_table_event_t) {
+        .kind = EcsTableComponentInfo,
+        .component = component
+    });
 }
 
-bool ecs_strbuf_vappend(
-    ecs_strbuf_t *b,
-    const char* fmt,
-    va_list args)
+bool ecs_component_has_actions(
+    ecs_world_t *world,
+    ecs_entity_t component)
 {
-    bool result = ecs_strbuf_vappend_intern(
-        b, fmt, args
-    );
-
-    return result;
+    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
+    return (c_info != NULL) && c_info->lifecycle_set;
 }
 
-bool ecs_strbuf_append(
-    ecs_strbuf_t *b,
-    const char* fmt,
-    ...)
+void ecs_atfini(
+    ecs_world_t *world,
+    ecs_fini_action_t action,
+    void *ctx)
 {
-    va_list args;
-    va_start(args, fmt);
-    bool result = ecs_strbuf_vappend_intern(
-        b, fmt, args
-    );
-    va_end(args);
+    ecs_assert(action != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    return result;
+    ecs_action_elem_t *elem = ecs_vector_add(&world->fini_actions, 
+        ecs_action_elem_t);
+    ecs_assert(elem != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    elem->action = action;
+    elem->ctx = ctx;
 }
 
-bool ecs_strbuf_appendstrn(
-    ecs_strbuf_t *b,
-    const char* str,
-    int32_t len)
+void ecs_run_post_frame(
+    ecs_world_t *world,
+    ecs_fini_action_t action,
+    void *ctx)
 {
-    return ecs_strbuf_append_intern(
-        b, str, len
-    );
+    ecs_assert(action != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_stage_t *stage = ecs_get_stage(&world);
+
+    ecs_action_elem_t *elem = ecs_vector_add(&stage->post_frame_actions, 
+        ecs_action_elem_t);
+    ecs_assert(elem != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    elem->action = action;
+    elem->ctx = ctx;    
 }
 
-bool ecs_strbuf_appendstr_zerocpy(
-    ecs_strbuf_t *b,
-    char* str)
+/* Unset data in tables */
+static
+void fini_unset_tables(
+    ecs_world_t *world)
 {
-    ecs_strbuf_init(b);
-    ecs_strbuf_grow_str(b, str, str, 0);
-    return true;
+    int32_t i, count = ecs_sparse_count(world->store.tables);
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(world->store.tables, ecs_table_t, i);
+        ecs_table_unset(world, table);
+    }
 }
 
-bool ecs_strbuf_appendstr_zerocpy_const(
-    ecs_strbuf_t *b,
-    const char* str)
+/* Destruct components in sparse storage */
+static
+void fini_unset_sparse(
+    ecs_world_t *world)
 {
-    /* Removes const modifier, but logic prevents changing / delete string */
-    ecs_strbuf_init(b);
-    ecs_strbuf_grow_str(b, (char*)str, NULL, 0);
-    return true;
+    ecs_vector_each(world->sparse_components, ecs_entity_t, c_ptr, {
+        ecs_c_info_t *c_info = ecs_get_c_info(world, *c_ptr);
+        ecs_xtor_t dtor = c_info->lifecycle.dtor;
+        int32_t i, count = ecs_sparse_count(c_info->sparse);
+        if (dtor && count) {
+            const uint64_t *ids = ecs_sparse_ids(c_info->sparse);
+            for (i = 0; i < count; i ++) {
+                void *ptr = _ecs_sparse_get(c_info->sparse, 0, i);
+                dtor(world, *c_ptr, &ids[i], ptr, 
+                    ecs_to_size_t(c_info->size), 1, c_info->lifecycle.ctx);
+            }
+        }
+    });
 }
 
-bool ecs_strbuf_appendstr(
-    ecs_strbuf_t *b,
-    const char* str)
+/* Invoke fini actions */
+static
+void fini_actions(
+    ecs_world_t *world)
 {
-    return ecs_strbuf_append_intern(
-        b, str, -1
-    );
+    ecs_vector_each(world->fini_actions, ecs_action_elem_t, elem, {
+        elem->action(world, elem->ctx);
+    });
+
+    ecs_vector_free(world->fini_actions);
 }
 
-bool ecs_strbuf_mergebuff(
-    ecs_strbuf_t *dst_buffer,
-    ecs_strbuf_t *src_buffer)
+/* Cleanup component lifecycle callbacks & systems */
+static
+void fini_component_lifecycle(
+    ecs_world_t *world)
 {
-    if (src_buffer->elementCount) {
-        if (src_buffer->buf) {
-            return ecs_strbuf_appendstr(dst_buffer, src_buffer->buf);
-        } else {
-            ecs_strbuf_element *e = (ecs_strbuf_element*)&src_buffer->firstElement;
-
-            /* Copy first element as it is inlined in the src buffer */
-            ecs_strbuf_appendstrn(dst_buffer, e->buf, e->pos);
+    int32_t i;
+    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
+        ecs_vector_free(world->c_info[i].on_add);
+        ecs_vector_free(world->c_info[i].on_remove);
+        ecs_sparse_free(world->c_info[i].sparse);
+        ecs_vector_free(world->c_info[i].fields);
+    }
 
-            while ((e = e->next)) {
-                dst_buffer->current->next = ecs_os_malloc(sizeof(ecs_strbuf_element));
-                *dst_buffer->current->next = *e;
-            }
-        }
+    ecs_map_iter_t it = ecs_map_iter(world->t_info);
+    ecs_c_info_t *c_info;
+    while ((c_info = ecs_map_next(&it, ecs_c_info_t, NULL))) {
+        ecs_vector_free(c_info->on_add);
+        ecs_vector_free(c_info->on_remove);
+        ecs_sparse_free(c_info->sparse);
+        ecs_vector_free(c_info->fields);
+    }    
 
-        *src_buffer = ECS_STRBUF_INIT;
-    }
+    ecs_vector_free(world->sparse_components);
 
-    return true;
+    ecs_map_free(world->t_info);
 }
 
-char* ecs_strbuf_get(ecs_strbuf_t *b) {
-    char* result = NULL;
-
-    if (b->elementCount) {
-        if (b->buf) {
-            b->buf[b->current->pos] = '\0';
-            result = ecs_os_strdup(b->buf);
-        } else {
-            void *next = NULL;
-            int32_t len = b->size + b->current->pos + 1;
+/* Cleanup queries */
+static
+void fini_queries(
+    ecs_world_t *world)
+{
+    /* Set world->queries to NULL, so ecs_query_free won't attempt to remove
+     * itself from the vector */
+    ecs_vector_t *query_vec = world->queries;
+    world->queries = NULL;
 
-            ecs_strbuf_element *e = (ecs_strbuf_element*)&b->firstElement;
+    int32_t i, count = ecs_vector_count(query_vec);
+    ecs_query_t **queries = ecs_vector_first(query_vec, ecs_query_t*);
+    for (i = 0; i < count; i ++) {
+        ecs_query_free(queries[i]);
+    }
 
-            result = ecs_os_malloc(len);
-            char* ptr = result;
+    ecs_vector_free(query_vec);
+}
 
-            do {
-                ecs_os_memcpy(ptr, e->buf, e->pos);
-                ptr += e->pos;
-                next = e->next;
-                if (e != &b->firstElement.super) {
-                    if (!e->buffer_embedded) {
-                        ecs_os_free(((ecs_strbuf_element_str*)e)->alloc_str);
-                    }
-                    ecs_os_free(e);
-                }
-            } while ((e = next));
+/* Cleanup stages */
+static
+void fini_stages(
+    ecs_world_t *world)
+{
+    ecs_stage_deinit(world, &world->stage);
+    ecs_stage_deinit(world, &world->temp_stage);
+}
 
-            result[len - 1] = '\0';
-        }
-    } else {
-        result = NULL;
+/* Cleanup child table admin */
+static
+void fini_child_tables(
+    ecs_world_t *world)
+{
+    ecs_map_iter_t it = ecs_map_iter(world->child_tables);
+    ecs_vector_t *tables;
+    while ((tables = ecs_map_next_ptr(&it, ecs_vector_t*, NULL))) {
+        ecs_vector_free(tables);
     }
 
-    b->elementCount = 0;
+    ecs_map_free(world->child_tables);
+    ecs_childof_index_free(world);
 
-    return result;
-}
+    if (world->instance_tables) {
+        it = ecs_map_iter(world->instance_tables);
+        while ((tables = ecs_map_next_ptr(&it, ecs_vector_t*, NULL))) {
+            ecs_vector_free(tables);
+        }
 
-void ecs_strbuf_reset(ecs_strbuf_t *b) {
-    if (b->elementCount && !b->buf) {
-        void *next = NULL;
-        ecs_strbuf_element *e = (ecs_strbuf_element*)&b->firstElement;
-        do {
-            next = e->next;
-            if (e != (ecs_strbuf_element*)&b->firstElement) {
-                ecs_os_free(e);
-            }
-        } while ((e = next));
+        ecs_map_free(world->instance_tables);
     }
 
-    *b = ECS_STRBUF_INIT;
+    ecs_vector_free(world->watched_changed);
 }
 
-void ecs_strbuf_list_push(
-    ecs_strbuf_t *buffer,
-    const char *list_open,
-    const char *separator)
+/* Cleanup aliases */
+static
+void fini_aliases(
+    ecs_world_t *world)
 {
-    buffer->list_sp ++;
-    buffer->list_stack[buffer->list_sp].count = 0;
-    buffer->list_stack[buffer->list_sp].separator = separator;
+    int32_t i, count = ecs_vector_count(world->aliases);
+    ecs_alias_t *aliases = ecs_vector_first(world->aliases, ecs_alias_t);
 
-    if (list_open) {
-        ecs_strbuf_appendstr(buffer, list_open);
+    for (i = 0; i < count; i ++) {
+        ecs_os_free(aliases[i].name);
     }
+
+    ecs_vector_free(world->aliases);
 }
 
-void ecs_strbuf_list_pop(
-    ecs_strbuf_t *buffer,
-    const char *list_close)
+/* Cleanup misc structures */
+static
+void fini_misc(
+    ecs_world_t *world)
 {
-    buffer->list_sp --;
-    
-    if (list_close) {
-        ecs_strbuf_appendstr(buffer, list_close);
-    }
+    on_demand_in_map_deinit(world->on_activate_components);
+    on_demand_in_map_deinit(world->on_enable_components);
+    ecs_map_free(world->type_handles);
+    ecs_vector_free(world->fini_tasks);
+    ecs_component_monitor_free(&world->component_monitors);
+    ecs_component_monitor_free(&world->parent_monitors);
 }
 
-void ecs_strbuf_list_next(
-    ecs_strbuf_t *buffer)
+/* The destroyer of worlds */
+int ecs_fini(
+    ecs_world_t *world)
 {
-    int32_t list_sp = buffer->list_sp;
-    if (buffer->list_stack[list_sp].count != 0) {
-        ecs_strbuf_appendstr(buffer, buffer->list_stack[list_sp].separator);
+    assert(world->magic == ECS_WORLD_MAGIC);
+    assert(!world->in_progress);
+    assert(!world->is_merging);
+
+    world->is_fini = true;
+
+    fini_unset_tables(world);
+
+    fini_unset_sparse(world);
+
+    fini_actions(world);    
+
+    if (world->locking_enabled) {
+        ecs_os_mutex_free(world->mutex);
+        ecs_os_mutex_free(world->thr_sync);
+        ecs_os_cond_free(world->thr_cond);
+        ecs_os_mutex_free(world->read_mutex);
+        ecs_os_cond_free(world->read_cond);
     }
-    buffer->list_stack[list_sp].count ++;
-}
 
-bool ecs_strbuf_list_append(
-    ecs_strbuf_t *buffer,
-    const char *fmt,
-    ...)
-{
-    ecs_strbuf_list_next(buffer);
+    fini_stages(world);
 
-    va_list args;
-    va_start(args, fmt);
-    bool result = ecs_strbuf_vappend_intern(
-        buffer, fmt, args
-    );
-    va_end(args);
+    fini_store(world);
 
-    return result;
-}
+    fini_component_lifecycle(world);
 
-bool ecs_strbuf_list_appendstr(
-    ecs_strbuf_t *buffer,
-    const char *str)
-{
-    ecs_strbuf_list_next(buffer);
-    return ecs_strbuf_appendstr(buffer, str);
-}
+    fini_queries(world);
 
-#define ECS_ANNOTATION_LENGTH_MAX (16)
+    fini_child_tables(world);
 
-#define TOK_SOURCE ':'
-#define TOK_AND ','
-#define TOK_OR "||"
-#define TOK_NOT '!'
-#define TOK_OPTIONAL '?'
-#define TOK_ROLE '|'
-#define TOK_TRAIT '>'
-#define TOK_FOR "FOR"
-#define TOK_NAME_SEP '.'
-#define TOK_ANNOTATE_OPEN '['
-#define TOK_ANNOTATE_CLOSE ']'
-#define TOK_WILDCARD '*'
-#define TOK_SINGLETON '$'
+    fini_aliases(world);
 
-#define TOK_ANY "ANY"
-#define TOK_OWNED "OWNED"
-#define TOK_SHARED "SHARED"
-#define TOK_SYSTEM "SYSTEM"
-#define TOK_PARENT "PARENT"
-#define TOK_CASCADE "CASCADE"
+    fini_misc(world);
 
-#define TOK_ROLE_CHILDOF "CHILDOF"
-#define TOK_ROLE_INSTANCEOF "INSTANCEOF"
-#define TOK_ROLE_TRAIT "TRAIT"
-#define TOK_ROLE_AND "AND"
-#define TOK_ROLE_OR "OR"
-#define TOK_ROLE_XOR "XOR"
-#define TOK_ROLE_NOT "NOT"
-#define TOK_ROLE_SWITCH "SWITCH"
-#define TOK_ROLE_CASE "CASE"
+    /* In case the application tries to use the memory of the freed world, this
+     * will trigger an assert */
+    world->magic = 0;
 
-#define TOK_IN "in"
-#define TOK_OUT "out"
-#define TOK_INOUT "inout"
+    ecs_increase_timer_resolution(0);
 
-#define ECS_MAX_TOKEN_SIZE (256)
+    /* End of the world */
+    ecs_os_free(world);
 
-typedef char ecs_token_t[ECS_MAX_TOKEN_SIZE];
+    ecs_os_fini(); 
 
-/** Skip spaces when parsing signature */
-static
-const char *skip_space(
-    const char *ptr)
-{
-    while (isspace(*ptr)) {
-        ptr ++;
-    }
-    return ptr;
+    return 0;
 }
 
-int entity_compare(
-    const void *ptr1,
-    const void *ptr2)
+void ecs_dim(
+    ecs_world_t *world,
+    int32_t entity_count)
 {
-    ecs_entity_t e1 = *(ecs_entity_t*)ptr1;
-    ecs_entity_t e2 = *(ecs_entity_t*)ptr2;
-    return (e1 > e2) - (e1 < e2);
+    assert(world->magic == ECS_WORLD_MAGIC);
+    ecs_eis_set_size(world, entity_count + ECS_HI_COMPONENT_ID);
 }
 
-static
-void vec_add_entity(
-    ecs_vector_t **vec,
-    ecs_entity_t entity)
+void ecs_dim_type(
+    ecs_world_t *world,
+    ecs_type_t type,
+    int32_t entity_count)
 {
-    ecs_entity_t *e = ecs_vector_add(vec, ecs_entity_t);
-    *e = entity;
-
-    /* Keep array sorted so that we can use it in type compare operations */
-    ecs_vector_sort(*vec, ecs_entity_t, entity_compare);
+    assert(world->magic == ECS_WORLD_MAGIC);
+    if (type) {
+        ecs_table_t *table = ecs_table_from_type(world, type);
+        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+        
+        ecs_data_t *data = ecs_table_get_or_create_data(table);
+        ecs_table_set_size(world, table, data, entity_count);
+    }
 }
 
-
-/* -- Private functions -- */
-
+/* Index the entities that have dependent tables (parents and bases) by the
+ * table they are stored in */
 static
-bool valid_identifier_char(
-    char ch)
+void index_watched_by_table(
+    ecs_world_t *world,
+    ecs_map_t *dependents,
+    ecs_map_t *index)
 {
-    if (ch && (isalpha(ch) || isdigit(ch) || ch == '_' || ch == '.' || 
-        ch == TOK_SINGLETON || ch == TOK_WILDCARD)) 
-    {
-        return true;
+    if (!dependents) {
+        return;
     }
 
-    return false;
+    ecs_map_iter_t it = ecs_map_iter(dependents);
+    ecs_map_key_t key;
+    while (ecs_map_next(&it, ecs_vector_t*, &key)) {
+        if (!key) {
+            /* Root tables */
+            continue;
+        }
+
+        ecs_record_t *r = ecs_eis_get(world, key);
+        if (!r || !r->table) {
+            continue;
+        }
+
+        ecs_vector_t *entities = ecs_map_get_ptr(
+            index, ecs_vector_t*, r->table->id);
+        ecs_entity_t *elem = ecs_vector_add(&entities, ecs_entity_t);
+        *elem = key;
+        ecs_map_set(index, r->table->id, &entities);
+    }
 }
 
 static
-bool valid_operator_char(
-    char ch)
+void add_watched_dependent(
+    ecs_table_t *table,
+    ecs_map_t *visited,
+    ecs_map_t *index,
+    ecs_vector_t **tables,
+    ecs_vector_t **entities)
 {
-    if (ch == TOK_OPTIONAL || ch == TOK_NOT) {
-        return true;
+    if (ecs_map_get(visited, bool, table->id)) {
+        return;
     }
 
-    return false;
+    ecs_map_set(visited, table->id, &(bool){true});
+
+    ecs_table_t **elem = ecs_vector_add(tables, ecs_table_t*);
+    *elem = table;
+
+    /* Parents and bases in the table can change the tables of their children
+     * and instances in turn */
+    ecs_vector_t *watched = ecs_map_get_ptr(index, ecs_vector_t*, table->id);
+    ecs_vector_each(watched, ecs_entity_t, e_ptr, {
+        ecs_entity_t *e = ecs_vector_add(entities, ecs_entity_t);
+        *e = *e_ptr;
+    });
 }
 
 static
-const char* parse_identifier(
-    const char *name,
-    const char *sig,
-    int64_t column,
-    const char *ptr,
-    char *token_out)
+void add_watched_dependents(
+    ecs_vector_t *dependents,
+    ecs_map_t *visited,
+    ecs_map_t *index,
+    ecs_vector_t **tables,
+    ecs_vector_t **entities)
 {
-    ptr = skip_space(ptr);
+    ecs_vector_each(dependents, ecs_table_t*, table_ptr, {
+        add_watched_dependent(*table_ptr, visited, index, tables, entities);
+    });
+}
 
-    char *tptr = token_out, ch = ptr[0];
+/* Find the tables that depend on the watched entities that changed. These are
+ * the tables that have the entity as parent or as base, and recursively the
+ * tables that depend on parents and bases in those tables. */
+static
+ecs_vector_t* collect_watched_tables(
+    ecs_world_t *world,
+    ecs_vector_t *changed)
+{
+    ecs_vector_t *result = ecs_vector_new(ecs_table_t*, 0);
+    ecs_vector_t *entities = ecs_vector_copy(changed, ecs_entity_t);
+    ecs_map_t *visited = ecs_map_new(bool, 0);
+    ecs_map_t *visited_entities = ecs_map_new(bool, 0);
 
-    if (!valid_identifier_char(ch)) {
-        ecs_parser_error(name, sig, column, "invalid identifier", ptr);
-        return NULL;
+    /* Find parents and bases per table once, so that visiting a dependent
+     * table does not require testing each of its entities */
+    ecs_map_t *index = ecs_map_new(ecs_vector_t*, 0);
+    if (ecs_vector_count(changed)) {
+        index_watched_by_table(world, world->child_tables, index);
+        index_watched_by_table(world, world->instance_tables, index);
     }
 
-    for (; (ch = *ptr); ptr ++) {
-        if (!valid_identifier_char(ch)) {
-            break;
+    int32_t i;
+    for (i = 0; i < ecs_vector_count(entities); i ++) {
+        ecs_entity_t e = *ecs_vector_get(entities, ecs_entity_t, i);
+        if (ecs_map_get(visited_entities, bool, e)) {
+            continue;
         }
 
-        tptr[0] = ch;
-        tptr ++;
+        ecs_map_set(visited_entities, e, &(bool){true});
+
+        add_watched_dependents(
+            ecs_map_get_ptr(world->child_tables, ecs_vector_t*, e),
+            visited, index, &result, &entities);
+
+        add_watched_dependents(
+            ecs_map_get_ptr(world->instance_tables, ecs_vector_t*, e),
+            visited, index, &result, &entities);
     }
 
-    tptr[0] = '\0';
+    ecs_map_iter_t it = ecs_map_iter(index);
+    ecs_vector_t **v_ptr;
+    while ((v_ptr = ecs_map_next(&it, ecs_vector_t*, NULL))) {
+        ecs_vector_free(*v_ptr);
+    }
 
-    return skip_space(ptr);
+    ecs_map_free(index);
+    ecs_map_free(visited_entities);
+    ecs_map_free(visited);
+    ecs_vector_free(entities);
+
+    return result;
 }
 
-static
-ecs_entity_t parse_role(
-    const char *name,
-    const char *sig,
-    int64_t column,
-    const char *token)
+void ecs_eval_component_monitors(
+    ecs_world_t *world)
 {
-    if        (!ecs_os_strcmp(token, TOK_ROLE_CHILDOF)) {
-        return ECS_CHILDOF;
-    } else if (!ecs_os_strcmp(token, TOK_ROLE_INSTANCEOF)) {
-        return ECS_INSTANCEOF;
-    } else if (!ecs_os_strcmp(token, TOK_ROLE_TRAIT)) {
-        return ECS_TRAIT;            
-    } else if (!ecs_os_strcmp(token, TOK_ROLE_AND)) {
-        return ECS_AND;
-    } else if (!ecs_os_strcmp(token, TOK_ROLE_OR)) {
-        return ECS_OR;
-    } else if (!ecs_os_strcmp(token, TOK_ROLE_XOR)) {
-        return ECS_XOR;
-    } else if (!ecs_os_strcmp(token, TOK_ROLE_NOT)) {
-        return ECS_NOT;
-    } else if (!ecs_os_strcmp(token, TOK_ROLE_SWITCH)) {
-        return ECS_SWITCH;
-    } else if (!ecs_os_strcmp(token, TOK_ROLE_CASE)) {
-        return ECS_CASE;
-    } else if (!ecs_os_strcmp(token, TOK_OWNED)) {
-        return ECS_OWNED;
-    } else {
-        ecs_parser_error(name, sig, column, "invalid role '%s'", token);
-        return 0;
+    ecs_vector_t *changed = world->watched_changed;
+    world->watched_changed = NULL;
+
+    ecs_vector_t *tables = NULL;
+    if (world->component_monitors.rematch || world->parent_monitors.rematch) {
+        tables = collect_watched_tables(world, changed);
     }
+
+    eval_component_monitor(world, &world->component_monitors, tables, changed);
+    eval_component_monitor(world, &world->parent_monitors, tables, changed);
+
+    ecs_vector_free(tables);
+    ecs_vector_free(changed);
 }
 
-static
-ecs_sig_from_kind_t parse_source(
-    const char *token)
+void ecs_merge(
+    ecs_world_t *world)
 {
-    if        (!ecs_os_strcmp(token, TOK_PARENT)) {
-        return EcsFromParent;
-    } else if (!ecs_os_strcmp(token, TOK_SYSTEM)) {
-        return EcsFromSystem;
-    } else if (!ecs_os_strcmp(token, TOK_ANY)) {
-        return EcsFromAny;
-    } else if (!ecs_os_strcmp(token, TOK_OWNED)) {
-        return EcsFromOwned;
-    } else if (!ecs_os_strcmp(token, TOK_SHARED)) {
-        return EcsFromShared;
-    } else if (!ecs_os_strcmp(token, TOK_CASCADE)) {
-        return EcsCascade;  
-    } else {
-        return EcsFromEntity;
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    assert(world->is_merging == false);
+
+    bool measure_frame_time = world->measure_frame_time;
+
+    world->is_merging = true;
+
+    ecs_time_t t_start;
+    if (measure_frame_time) {
+        ecs_os_get_time(&t_start);
     }
-} 
 
-static
-ecs_sig_oper_kind_t parse_operator(
-    char ch)
+    uint64_t span = ecs_span_begin(world);
+
+    ecs_stage_merge(world, &world->temp_stage);
+
+    ecs_vector_each(world->worker_stages, ecs_stage_t, stage, {
+        ecs_stage_merge(world, stage);
+    });
+
+    world->is_merging = false;
+
+    ecs_eval_component_monitors(world);
+
+    if (measure_frame_time) {
+        world->stats.merge_time_total += (float)ecs_time_measure(&t_start);
+    }
+
+    ecs_span_end(world, &world->stage, EcsSpanMerge, 0, span);
+
+    world->stats.merge_count_total ++;
+}
+
+void ecs_set_automerge(
+    ecs_world_t *world,
+    bool auto_merge)
 {
-    if (ch == TOK_OPTIONAL) {
-        return EcsOperOptional;
-    } else if (ch == TOK_NOT) {
-        return EcsOperNot;
-    } else {
-        ecs_abort(ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    world->auto_merge = auto_merge;
+}
+
+void ecs_measure_frame_time(
+    ecs_world_t *world,
+    bool enable)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
+
+    if (world->stats.target_fps == 0.0 || enable) {
+        world->measure_frame_time = enable;
     }
 }
 
-static
-const char* parse_annotation(
-    const char *name,
-    const char *sig,
-    int64_t column,
-    const char *ptr, 
-    ecs_sig_inout_kind_t *inout_kind_out)
+void ecs_measure_system_time(
+    ecs_world_t *world,
+    bool enable)
 {
-    char token[ECS_MAX_TOKEN_SIZE];
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
+    world->measure_system_time = enable;
+}
 
-    ptr = parse_identifier(name, sig, column, ptr, token);
-    if (!ptr) {
-        return NULL;
+void ecs_track_component_stats(
+    ecs_world_t *world,
+    bool enable)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+
+    if (enable == (world->component_stats != NULL)) {
+        return;
     }
 
-    if (!strcmp(token, "in")) {
-        *inout_kind_out = EcsIn;
-    } else
-    if (!strcmp(token, "out")) {
-        *inout_kind_out = EcsOut;
-    } else
-    if (!strcmp(token, "inout")) {
-        *inout_kind_out = EcsInOut;
+    if (enable) {
+        world->component_stats = ecs_map_new(ecs_component_stats_t*, 0);
     }
 
-    ptr = skip_space(ptr);
+    ecs_sparse_t *tables = world->store.tables;
+    int32_t i, count = ecs_sparse_count(tables);
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        if (enable) {
+            ecs_table_register_stats(world, table);
+        } else {
+            ecs_table_unregister_stats(table);
+        }
+    }
 
-    if (ptr[0] != TOK_ANNOTATE_CLOSE) {
-        ecs_parser_error(name, sig, column, "expected ]");
+    if (!enable) {
+        ecs_map_iter_t it = ecs_map_iter(world->component_stats);
+        ecs_component_stats_t *stats;
+        while ((stats = ecs_map_next_ptr(&it, ecs_component_stats_t*, NULL))) {
+            ecs_os_free(stats);
+        }
+
+        ecs_map_free(world->component_stats);
+        world->component_stats = NULL;
+    }
+}
+
+const ecs_component_stats_t* ecs_get_component_stats(
+    ecs_world_t *world,
+    ecs_entity_t component)
+{
+    if (!world->component_stats) {
         return NULL;
     }
 
-    return ptr + 1;
+    return ecs_map_get_ptr(
+        world->component_stats, ecs_component_stats_t*, component);
 }
 
-typedef struct sig_element_t {
-    ecs_entity_t role;
-    ecs_sig_inout_kind_t inout_kind;
-    ecs_sig_from_kind_t from_kind;
-    ecs_sig_oper_kind_t oper_kind;
-    char *trait;
-    char *source;
-    char *component;
-    char *name;
-} sig_element_t;
-
-const char* parse_element(
-    const char *name,
-    const char *sig,
-    sig_element_t *elem_out)
+/* Increase timer resolution based on target fps */
+static void set_timer_resolution(float fps)
 {
-    bool explicit_inout = false;
-    const char *ptr = sig;
-    char token[ECS_MAX_TOKEN_SIZE] = {0};
-    sig_element_t elem = {
-        .inout_kind = EcsInOut,
-        .from_kind = EcsFromOwned,
-        .oper_kind = EcsOperAnd
-    };
+    if(fps >= 60.0f) ecs_increase_timer_resolution(1);
+    else ecs_increase_timer_resolution(0);
+}
 
-    ptr = skip_space(ptr);
+void ecs_set_target_fps(
+    ecs_world_t *world,
+    float fps)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
 
-    /* Inout specifiers always come first */
-    if (ptr[0] == TOK_ANNOTATE_OPEN) {
-        explicit_inout = true;
-        ptr = parse_annotation(name, sig, (ptr - sig), ptr + 1, &elem.inout_kind);
-        if (!ptr) {
-            return NULL;
-        }
-        ptr = skip_space(ptr);
+    if (!world->arg_fps) {
+        ecs_measure_frame_time(world, true);
+        world->stats.target_fps = fps;
+        set_timer_resolution(fps);
     }
+}
 
-    if (valid_operator_char(ptr[0])) {
-        elem.oper_kind = parse_operator(ptr[0]);
-        ptr = skip_space(ptr + 1);
-    }
+void* ecs_get_context(
+    ecs_world_t *world)
+{
+    ecs_get_stage(&world);
+    return world->context;
+}
 
-    /* If next token is the start of an identifier, it could be either a type
-     * role, source or component identifier */
-    if (valid_identifier_char(ptr[0])) {
-        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
-        if (!ptr) {
-            return NULL;
-        }
-        
-        /* Is token a source identifier? */
-        if (ptr[0] == TOK_SOURCE) {
-            ptr ++;
-            goto parse_source;
-        }
+void ecs_set_context(
+    ecs_world_t *world,
+    void *context)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    world->context = context;
+}
 
-        /* Is token a type role? */
-        if (ptr[0] == TOK_ROLE && ptr[1] != TOK_ROLE) {
-            ptr ++;
-            goto parse_role;
-        }
+void ecs_set_entity_range(
+    ecs_world_t *world,
+    ecs_entity_t id_start,
+    ecs_entity_t id_end)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!id_end || id_end > id_start, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!id_end || id_end > world->stats.last_id, ECS_INVALID_PARAMETER, NULL);
 
-        /* Is token a trait? (using shorthand notation) */
-        if (!ecs_os_strncmp(ptr, TOK_FOR, 3)) {
-            elem.role = ECS_TRAIT;
-            ptr += 3;
-            goto parse_trait;
-        }
+    if (world->stats.last_id < id_start) {
+        world->stats.last_id = id_start - 1;
+    }
 
-        /* If it is neither, the next token must be a component */
-        goto parse_component;
+    world->stats.min_id = id_start;
+    world->stats.max_id = id_end;
+}
 
-    /* If next token is the source token, this is an empty source */
-    } else if (ptr[0] == TOK_SOURCE) {
-        goto empty_source;
+bool ecs_enable_range_check(
+    ecs_world_t *world,
+    bool enable)
+{
+    bool old_value = world->range_check_enabled;
+    world->range_check_enabled = enable;
+    return old_value;
+}
 
-    /* Nothing else expected here */
+int32_t ecs_get_thread_index(
+    ecs_world_t *world)
+{
+    if (world->magic == ECS_THREAD_MAGIC) {
+        ecs_thread_t *thr = (ecs_thread_t*)world;
+        return thr->index;
+    } else if (world->magic == ECS_WORLD_MAGIC) {
+        return 0;
     } else {
-        ecs_parser_error(name, sig, (ptr - sig), 
-            "unexpected character '%c'", ptr[0]);
-        return NULL;
+        ecs_abort(ECS_INTERNAL_ERROR, NULL);
     }
+}
 
-empty_source:
-    elem.from_kind = EcsFromEmpty;
-    ptr = skip_space(ptr + 1);
-    if (valid_identifier_char(ptr[0])) {
-        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
-        if (!ptr) {
-            return NULL;
-        }
+int32_t ecs_get_threads(
+    ecs_world_t *world)
+{
+    return ecs_vector_count(world->workers);
+}
 
-        goto parse_component;
+bool ecs_enable_locking(
+    ecs_world_t *world,
+    bool enable)
+{
+    if (enable) {
+        if (!world->locking_enabled) {
+            world->mutex = ecs_os_mutex_new();
+            world->thr_sync = ecs_os_mutex_new();
+            world->thr_cond = ecs_os_cond_new();
+            world->read_mutex = ecs_os_mutex_new();
+            world->read_cond = ecs_os_cond_new();
+        }
     } else {
-        ecs_parser_error(name, sig, (ptr - sig), 
-            "expected identifier after source operator");
-        return NULL;
+        if (world->locking_enabled) {
+            ecs_assert(!world->read_count, ECS_INVALID_OPERATION, NULL);
+            ecs_os_mutex_free(world->mutex);
+            ecs_os_mutex_free(world->thr_sync);
+            ecs_os_cond_free(world->thr_cond);
+            ecs_os_mutex_free(world->read_mutex);
+            ecs_os_cond_free(world->read_cond);
+        }
     }
 
-parse_source:
-    elem.from_kind = parse_source(token);
-    if (elem.from_kind == EcsFromEntity) {
-        elem.source = ecs_os_strdup(token);
-    }
+    bool old = world->locking_enabled;
+    world->locking_enabled = enable;
+    return old;
+}
 
-    ptr = skip_space(ptr);
-    if (valid_identifier_char(ptr[0])) {
-        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
-        if (!ptr) {
-            return NULL;
-        }
+void ecs_lock(
+    ecs_world_t *world)
+{
+    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
+    ecs_os_mutex_lock(world->mutex);
+}
 
-        /* Is the next token a role? */
-        if (ptr[0] == TOK_ROLE && ptr[1] != TOK_ROLE) {
-            ptr++;
-            goto parse_role;
-        }
+void ecs_unlock(
+    ecs_world_t *world)
+{
+    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
+    ecs_os_mutex_unlock(world->mutex);
+}
 
-        /* Is token a trait? (using shorthand notation) */
-        if (!ecs_os_strncmp(ptr, TOK_FOR, 3)) {
-            elem.role = ECS_TRAIT;
-            ptr += 3;
-            goto parse_trait;
-        }        
+void ecs_begin_wait(
+    ecs_world_t *world)
+{
+    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
+    ecs_os_mutex_lock(world->thr_sync);
+    ecs_os_cond_wait(world->thr_cond, world->thr_sync);
+}
 
-        /* If not, it's a component */
-        goto parse_component;
-    } else {
-        ecs_parser_error(name, sig, (ptr - sig), 
-            "expected identifier after source");
-        return NULL;
-    }
+void ecs_end_wait(
+    ecs_world_t *world)
+{
+    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
+    ecs_os_mutex_unlock(world->thr_sync);
+}
 
-parse_role:
-    elem.role = parse_role(name, sig, (ptr - sig), token);
-    if (!elem.role) {
-        return NULL;
-    }
+#ifdef ECS_THREAD_LOCAL
+/* Number of read epochs entered by the current thread. Operations use this to
+ * avoid modifying the world from a reader thread. */
+static ECS_THREAD_LOCAL int32_t ecs_thread_read_count;
+#endif
 
-    ptr = skip_space(ptr);
+bool ecs_is_reader_thread(void)
+{
+#ifdef ECS_THREAD_LOCAL
+    return ecs_thread_read_count != 0;
+#else
+    return false;
+#endif
+}
 
-    /* If next token is the source token, this is an empty source */
-    if (valid_identifier_char(ptr[0])) {
-        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
-        if (!ptr) {
-            return NULL;
-        }
+int32_t ecs_read_begin(
+    ecs_world_t *world)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
 
-        /* Is token a trait? */
-        if (ptr[0] == TOK_TRAIT) {
-            ptr ++;
-            goto parse_trait;
-        }
+#ifdef ECS_THREAD_LOCAL
+    ecs_thread_read_count ++;
+#else
+    /* Readers can only be detected with thread local storage */
+    ecs_abort(ECS_UNSUPPORTED, NULL);
+#endif
 
-        /* If not, it's a component */
-        goto parse_component;
-    } else {
-        ecs_parser_error(name, sig, (ptr - sig), 
-            "expected identifier after role");
-        return NULL;
+    ecs_os_mutex_lock(world->read_mutex);
+    while (!world->read_enabled) {
+        ecs_os_cond_wait(world->read_cond, world->read_mutex);
     }
 
-parse_trait:
-    elem.trait = ecs_os_strdup(token);
+    world->read_count ++;
+    int32_t epoch = world->read_epoch;
+    ecs_os_mutex_unlock(world->read_mutex);
 
-    ptr = skip_space(ptr);
-    if (valid_identifier_char(ptr[0])) {
-        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
-        if (!ptr) {
-            return NULL;
-        }
+    return epoch;
+}
 
-        /* Can only be a component */
-        goto parse_component;
-    } else {
-        ecs_parser_error(name, sig, (ptr - sig), 
-            "expected identifier after trait");
-        return NULL;
-    }
-
-parse_component:
-    elem.component = ecs_os_strdup(token);
-
-    ptr = skip_space(ptr);
-    if (valid_identifier_char(ptr[0])) {
-        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
-        if (!ptr) {
-            return NULL;
-        }
+void ecs_read_end(
+    ecs_world_t *world)
+{
+    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
 
-        /* Can only be a name */
-        goto parse_name;
-    } else {
-        /* If nothing else, parsing of this element is done */
-        goto parse_done;
+    ecs_os_mutex_lock(world->read_mutex);
+    ecs_assert(world->read_count > 0, ECS_INVALID_OPERATION, NULL);
+    if (!(-- world->read_count)) {
+        ecs_os_cond_broadcast(world->read_cond);
     }
+    ecs_os_mutex_unlock(world->read_mutex);
 
-parse_name:
-    elem.name = ecs_os_strdup(token);
-    ptr = skip_space(ptr);
+#ifdef ECS_THREAD_LOCAL
+    ecs_thread_read_count --;
+#endif
+}
 
-parse_done:
-    if (ptr[0] != TOK_AND && ecs_os_strncmp(ptr, TOK_OR, 2) && ptr[0]) {
-        ecs_parser_error(name, sig, (ptr - sig), 
-            "expected end of expression or next element");
-        return NULL;
+/* Start a new read epoch. While the world is staged, the main storage does not
+ * change structurally, which allows other threads to read from it. */
+static
+void read_epoch_begin(
+    ecs_world_t *world)
+{
+    if (world->locking_enabled) {
+        ecs_os_mutex_lock(world->read_mutex);
+        world->read_epoch ++;
+        world->read_enabled = true;
+        ecs_os_cond_broadcast(world->read_cond);
+        ecs_os_mutex_unlock(world->read_mutex);
     }
+}
 
-    if (!ecs_os_strcmp(elem.component, "0")) {
-        if (ptr[0]) {
-            ecs_parser_error(name, sig, (ptr - sig), 
-                "unexpected element after 0"); 
-            return NULL;
+/* End the read epoch, and wait until all readers have released the world
+ * before it is modified by a merge. */
+static
+void read_epoch_end(
+    ecs_world_t *world)
+{
+    if (world->locking_enabled) {
+        ecs_os_mutex_lock(world->read_mutex);
+        world->read_enabled = false;
+        while (world->read_count) {
+            ecs_os_cond_wait(world->read_cond, world->read_mutex);
         }
+        ecs_os_mutex_unlock(world->read_mutex);
+    }
+}
 
-        if (elem.from_kind != EcsFromOwned) {
-            ecs_parser_error(name, sig, (ptr - sig), 
-                "invalid source modifier for 0"); 
+ecs_c_info_t * ecs_get_c_info(
+    ecs_world_t *world,
+    ecs_entity_t component)
+{
+    ecs_assert(component != 0, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(!(component & ECS_ROLE_MASK), ECS_INTERNAL_ERROR, NULL);
+
+    if (component < ECS_HI_COMPONENT_ID) {
+        ecs_c_info_t *c_info = &world->c_info[component];
+        if (c_info->component) {
+            ecs_assert(c_info->component == component, ECS_INTERNAL_ERROR, NULL);
+            return c_info;
+        } else {
             return NULL;
         }
+    } else {
+        return ecs_map_get(world->t_info, ecs_c_info_t, component);
     }
+}
 
-    if (!explicit_inout) {
-        if (elem.from_kind != EcsFromOwned) {
-            elem.inout_kind = EcsIn;
+ecs_c_info_t * ecs_get_or_create_c_info(
+    ecs_world_t *world,
+    ecs_entity_t component)
+{    
+    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
+    if (!c_info) {
+        if (component < ECS_HI_COMPONENT_ID) {
+            c_info = &world->c_info[component];
+            ecs_assert(c_info->component == 0, ECS_INTERNAL_ERROR, NULL);
+            c_info->component = component;
+        } else {
+            ecs_c_info_t t_info = { 0 };
+            ecs_map_set(world->t_info, component, &t_info);
+            c_info = ecs_map_get(world->t_info, ecs_c_info_t, component);
+            ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL); 
         }
     }
 
-    *elem_out = elem;
-
-    return ptr;
+    return c_info;
 }
 
-int ecs_parse_expr(
+ecs_c_info_t * ecs_get_sparse_c_info(
     ecs_world_t *world,
-    const char *name,
-    const char *sig,
-    ecs_parse_action_t action,
-    void *ctx)
+    ecs_entity_t component)
 {
-    sig_element_t elem;
+    if (!world->sparse_components || !component ||
+        (component & ECS_ROLE_MASK))
+    {
+        return NULL;
+    }
 
-    bool is_or = false;
-    const char *ptr = sig;
-    while ((ptr = parse_element(name, ptr, &elem))) {
-        if (is_or) {
-            ecs_assert(elem.oper_kind == EcsOperAnd, ECS_INVALID_SIGNATURE, sig);
-            elem.oper_kind = EcsOperOr;
-        }
+    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
+    if (c_info && c_info->sparse) {
+        return c_info;
+    }
 
-        if (action(world, name, sig, ptr - sig, 
-            elem.from_kind, elem.oper_kind, elem.inout_kind, elem.role,
-            elem.component, elem.source, elem.trait, elem.name, ctx))
-        {
-            if (!name) {
-                return -1;
-            }
+    return NULL;
+}
 
-            ecs_abort(ECS_INVALID_SIGNATURE, sig);
-        }
+bool ecs_staging_begin(
+    ecs_world_t *world)
+{
+    bool in_progress = world->in_progress;
+    world->in_progress = true;
 
-        ecs_os_free(elem.component);
-        ecs_os_free(elem.source);
-        ecs_os_free(elem.trait);
-        ecs_os_free(elem.name);
+    if (!in_progress) {
+        if (world->locking_enabled) {
+            ecs_query_sort_postponed(world);
+        }
 
-        is_or = false;
-        if (!strncmp(ptr, TOK_OR, 2)) {
-            is_or = true;
-            if (elem.from_kind == EcsFromEmpty) {
-                ecs_parser_error(name, sig, ptr - sig, 
-                    "invalid empty source in or expression");
-                return -1;
-            }
+        read_epoch_begin(world);
+    }
 
-            if (elem.from_kind == EcsFromSystem) {
-                ecs_parser_error(name, sig, ptr - sig, 
-                    "invalid system source in or expression");
-                return -1;
-            }
-        }
+    return in_progress;
+}
 
-        if (ptr[0]) {
-            ptr ++;
-            if (is_or) {
-                ptr ++;
-            }
-        }
-        
-        ptr = skip_space(ptr);
+void ecs_staging_end(
+    ecs_world_t *world)
+{
+    ecs_assert(world->in_progress == true, ECS_INVALID_OPERATION, NULL);
 
-        if (!ptr[0]) {
-            break;
-        }
-    }
+    read_epoch_end(world);
 
-    if (!ptr) {
-        if (!name) {
-            return -1;
-        }
-        
-        ecs_abort(ECS_INVALID_SIGNATURE, sig);
+    world->in_progress = false;
+    if (world->auto_merge) {
+        ecs_merge(world);
     }
-
-    return 0;
 }
 
-/** Parse callback that adds component to the components array for a system */
-int ecs_parse_signature_action(
+static
+double insert_sleep(
     ecs_world_t *world,
-    const char *name,
-    const char *expr,
-    int64_t column,
-    ecs_sig_from_kind_t from_kind,
-    ecs_sig_oper_kind_t oper_kind,
-    ecs_sig_inout_kind_t inout_kind,
-    ecs_entity_t role,
-    const char *entity_id,
-    const char *source_id,
-    const char *trait_id,
-    const char *arg_name,
-    void *data)
+    ecs_time_t *stop)
 {
-    ecs_sig_t *sig = data;
-    bool is_singleton = false;
+    ecs_time_t start = *stop;
+    double delta_time = ecs_time_measure(stop);
 
-    ecs_assert(sig != NULL, ECS_INTERNAL_ERROR, NULL);
+    if (world->stats.target_fps == 0) {
+        return delta_time;
+    }
 
-    if (entity_id[0] == '$') {
-        if (from_kind ==  EcsFromEntity) {
-            ecs_parser_error(name, expr, column, 
-                "singleton component '%s' cannot have a source", entity_id);
-        }
+    double target_delta_time = (1.0 / world->stats.target_fps);
+    double world_sleep_err = 
+        world->stats.sleep_err / (double)world->stats.frame_count_total;
 
-        from_kind = EcsFromEntity;
-        is_singleton = true;
-        entity_id ++;
-    }
+    /* Calculate the time we need to sleep by taking the measured delta from the
+     * previous frame, and subtracting it from target_delta_time. */
+    double sleep = target_delta_time - delta_time;
 
-    /* Lookup component handle by string identifier */
-    ecs_entity_t source = 0, component = ecs_lookup_fullpath(world, entity_id);
-    if (!component) {
-        /* "0" is a valid expression used to indicate that a system matches no
-         * components */
-        if (!strcmp(entity_id, "0")) {
-            /* No need to add 0 component to signature */
-            return 0;
-        } else {
-            ecs_parser_error(name, expr, column, 
-                "unresolved component identifier '%s'", entity_id);
-        }
-    }
+    /* Pick a sleep interval that is 20 times lower than the time one frame
+     * should take. This means that this function at most iterates 20 times in
+     * a busy loop */
+    double sleep_time = target_delta_time / 20;
 
-    if (is_singleton) {
-        source = component;
+    /* Measure at least two frames before interpreting sleep error */
+    if (world->stats.frame_count_total > 1) {
+        /* If the ratio between the sleep error and the sleep time is too high,
+         * just do a busy loop */
+        if (world_sleep_err / sleep_time > 0.1) {
+            sleep_time = 0;
+        } 
     }
 
-    /* Lookup trait handle by string identifier */
-    if (trait_id) {
-        ecs_entity_t trait = ecs_lookup_fullpath(world, trait_id);
-        if (!trait) {
-            ecs_parser_error(name, expr, column, 
-                "unresolved trait identifier '%s'", trait_id);
-        } else {
-            component = ecs_entity_t_comb(component, trait);
+    /* If the time we need to sleep is large enough to warrant a sleep, sleep */
+    if (sleep > (sleep_time - world_sleep_err)) {
+        if (sleep_time > sleep) {
+            /* Make sure we don't sleep longer than we should */
+            sleep_time = sleep;
         }
-    }
-
-    component |= role;
 
-    if (!source && from_kind == EcsFromEntity) {
-        source = ecs_lookup_fullpath(world, source_id);
-        if (!source) {
-            ecs_parser_error(name, expr, column, 
-                "unresolved source identifier '%s'", source_id);
-        }
+        double sleep_err = 0;
+        int32_t iterations = 0;
+
+        do {
+            /* Only call sleep when sleep_time is not 0. On some platforms, even
+             * a sleep with a timeout of 0 can cause stutter. */
+            if (sleep_time != 0) {
+                ecs_sleepf(sleep_time);
+            }
+
+            ecs_time_t now = start;
+            double prev_delta_time = delta_time;
+            delta_time = ecs_time_measure(&now);
+
+            /* Measure the error of the sleep by taking the difference between 
+             * the time we expected to sleep, and the measured time. This 
+             * assumes that a sleep is less accurate than a high resolution 
+             * timer which should be true in most cases. */
+            sleep_err = delta_time - prev_delta_time - sleep_time;
+            iterations ++;
+        } while ((target_delta_time - delta_time) > (sleep_time - world_sleep_err));
+
+        /* Add sleep error measurement to sleep error, with a bias towards the
+         * latest measured values. */
+        world->stats.sleep_err = (float)
+            (world_sleep_err * 0.9 + sleep_err * 0.1) * 
+                (float)world->stats.frame_count_total;
     }
 
-    return ecs_sig_add(
-        world, sig, from_kind, oper_kind, inout_kind, component, source, 
-        arg_name);
+    /*  Make last minute corrections if due to a larger clock error delta_time
+     * is still more than 5% away from the target. The 5% buffer is to account
+     * for the fact that measuring the time also takes time. */
+    while (delta_time < target_delta_time * 0.95) {
+        ecs_time_t now = start;
+        delta_time = ecs_time_measure(&now);
+    }
+
+    return delta_time;
 }
 
-void ecs_sig_init(
+static
+float start_measure_frame(
     ecs_world_t *world,
-    const char *name,
-    const char *expr,
-    ecs_sig_t *sig)
+    float user_delta_time)
 {
-    if (expr && ecs_os_strlen(expr)) {
-        sig->expr = ecs_os_strdup(expr);
-    } else {
-        sig->expr = ecs_os_strdup("0");
+    double delta_time = 0;
+
+    if (world->measure_frame_time || (user_delta_time == 0)) {
+        ecs_time_t t = world->frame_start_time;
+        do {
+            if (world->frame_start_time.sec) {
+                delta_time = insert_sleep(world, &t);
+
+                ecs_time_measure(&t);
+            } else {
+                ecs_time_measure(&t);
+                if (world->stats.target_fps != 0) {
+                    delta_time = 1.0 / world->stats.target_fps;
+                } else {
+                    delta_time = 1.0 / 60.0; /* Best guess */
+                }
+            }
+        
+        /* Keep trying while delta_time is zero */
+        } while (delta_time == 0);
+
+        world->frame_start_time = t;  
+
+        /* Keep track of total time passed in world */
+        world->stats.world_time_total_raw += (float)delta_time;
     }
 
-    ecs_parse_expr(world, name, sig->expr, ecs_parse_signature_action, sig);
+    return (float)delta_time;
 }
 
-void ecs_sig_deinit(
-    ecs_sig_t *sig)
-{   
-    ecs_vector_each(sig->columns, ecs_sig_column_t, column, {
-        if (column->oper_kind == EcsOperOr) {
-            ecs_vector_free(column->is.type);
-        }
-        ecs_os_free(column->name);
-    });
-
-    ecs_vector_free(sig->columns);
-    ecs_os_free(sig->expr);
+static
+void stop_measure_frame(
+    ecs_world_t* world)
+{
+    if (world->measure_frame_time) {
+        ecs_time_t t = world->frame_start_time;
+        world->stats.frame_time_total += (float)ecs_time_measure(&t);
+    }
 }
 
-int ecs_sig_add(
+float ecs_frame_begin(
     ecs_world_t *world,
-    ecs_sig_t *sig,
-    ecs_sig_from_kind_t from_kind,
-    ecs_sig_oper_kind_t oper_kind,
-    ecs_sig_inout_kind_t inout_kind,
-    ecs_entity_t component,
-    ecs_entity_t source,
-    const char *arg_name)
+    float user_delta_time)
 {
-    ecs_sig_column_t *elem;
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(world->in_progress == false, ECS_INVALID_OPERATION, NULL);
 
-    /* If component has AND role, all components of specified type must match */
-    if (ECS_HAS_ROLE(component, AND)) {
-        elem = ecs_vector_add(&sig->columns, ecs_sig_column_t);
-        component &= ECS_ENTITY_MASK;
-        const EcsType *type = ecs_get(world, component, EcsType);
-        if (!type) {
-            ecs_parser_error(sig->name, sig->expr, 0, 
-                "AND flag can only be applied to types");
-        }
+    ecs_assert(user_delta_time != 0 || ecs_os_has_time(), ECS_MISSING_OS_API, "get_time");
 
-        elem->is.component = component;
-        elem->from_kind = from_kind;
-        elem->oper_kind = EcsOperAll;
-        elem->inout_kind = inout_kind;
-        elem->source = source;
+    if (world->locking_enabled) {
+        ecs_lock(world);
+    }
 
-    } else 
+    world->frame_span = ecs_span_begin(world);
 
-    /* If component has OR role, add type as OR column */
-    if (ECS_HAS_ROLE(component, OR)) {
-        elem = ecs_vector_add(&sig->columns, ecs_sig_column_t);
-        component &= ECS_ENTITY_MASK;
-        const EcsType *type = ecs_get(world, component, EcsType);
-        if (!type) {
-            ecs_parser_error(sig->name, sig->expr, 0, 
-                "OR flag can only be applied to types");
-        }
+    /* Start measuring total frame time */
+    float delta_time = start_measure_frame(world, user_delta_time);
+    if (user_delta_time == 0) {
+        user_delta_time = delta_time;
+    }  
 
-        elem->is.type = ecs_vector_copy(type->normalized, ecs_entity_t);
-        elem->from_kind = from_kind;
-        elem->oper_kind = EcsOperOr;
-        elem->inout_kind = inout_kind;
-        elem->source = source;
-    } else
+    world->stats.delta_time_raw = user_delta_time;
+    world->stats.delta_time = user_delta_time * world->stats.time_scale;
 
-    /* AND (default) and optional columns are stored the same way */
-    if (oper_kind != EcsOperOr) {
-        elem = ecs_vector_add(&sig->columns, ecs_sig_column_t);
-        elem->from_kind = from_kind;
-        elem->oper_kind = oper_kind;
-        elem->inout_kind = inout_kind;
-        elem->is.component = component;
-        elem->source = source;
+    /* Keep track of total scaled time passed in world */
+    world->stats.world_time_total += world->stats.delta_time;
 
-    /* OR columns store a type id instead of a single component */
-    } else {
-        ecs_assert(inout_kind != EcsOut, ECS_INVALID_SIGNATURE, NULL);
-        elem = ecs_vector_last(sig->columns, ecs_sig_column_t);
+#ifdef FLECS_COMMAND_QUEUE
+    /* Apply commands from other threads before the pipeline runs */
+    ecs_command_queues_flush(world);
+#endif
 
-        if (elem->from_kind != from_kind) {
-            /* Cannot mix FromEntity and FromComponent in OR */
-            ecs_parser_error(sig->name, sig->expr, 0, 
-                "cannot mix source kinds in || expression");
-            goto error;
-        }
+    return user_delta_time;
+}
 
-        if (elem->oper_kind != EcsOperAnd && elem->oper_kind != EcsOperOr) {
-            ecs_parser_error(sig->name, sig->expr, 0, 
-                "cannot mix operators in || expression");
-            goto error;         
-        }
+void ecs_frame_end(
+    ecs_world_t *world)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(world->in_progress == false, ECS_INVALID_OPERATION, NULL);
 
-        if (elem->oper_kind == EcsOperAnd) {
-            ecs_entity_t prev = elem->is.component;
-            elem->is.type = NULL;
-            vec_add_entity(&elem->is.type, prev);
-            vec_add_entity(&elem->is.type, component);
-        } else {
-            vec_add_entity(&elem->is.type, component);
-        }      
+    world->stats.frame_count_total ++;   
 
-        elem->from_kind = from_kind;
-        elem->oper_kind = oper_kind;
+    ecs_stage_merge_post_frame(world, &world->temp_stage);
+
+    ecs_vector_each(world->worker_stages, ecs_stage_t, stage, {
+        ecs_stage_merge_post_frame(world, stage);
+    });        
+
+    /* Values written in this frame become the previous frame values */
+    if (world->double_buffered_count) {
+        ecs_sparse_t *tables = world->store.tables;
+        int32_t i, count = ecs_sparse_count(tables);
+        for (i = 0; i < count; i ++) {
+            ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+            if (table->flags & EcsTableHasPrev) {
+                ecs_table_update_prev(table);
+            }
+        }
     }
 
-    if (arg_name) {
-        elem->name = ecs_os_strdup(arg_name);
-    } else {
-        elem->name = NULL;
+    if (world->table_gc_frames) {
+        ecs_gc(world);
     }
 
-    return 0;
-error:
-    return -1;
-}
+    if (world->locking_enabled) {
+        ecs_unlock(world);
 
-/* Check if system meets constraints of non-table columns */
-bool ecs_sig_check_constraints(
-    ecs_world_t *world,
-    ecs_sig_t *sig)
-{
-    ecs_vector_each(sig->columns, ecs_sig_column_t, elem, {
-        ecs_sig_from_kind_t from_kind = elem->from_kind;
-        ecs_sig_oper_kind_t oper_kind = elem->oper_kind;
+        ecs_os_mutex_lock(world->thr_sync);
+        ecs_os_cond_broadcast(world->thr_cond);
+        ecs_os_mutex_unlock(world->thr_sync);
+    }
 
-        if (from_kind == EcsFromEntity) {
-            ecs_type_t type = ecs_get_type(world, elem->source);
-            if (ecs_type_has_entity(world, type, elem->is.component)) {
-                if (oper_kind == EcsOperNot) {
-                    return false;
-                }
-            } else {
-                if (oper_kind != EcsOperNot) {
-                    return false;
-                }
-            }
-        }
-    });
+    stop_measure_frame(world);
 
-    return true;
+    ecs_span_end(world, &world->stage, EcsSpanFrame, 0, world->frame_span);
+    world->frame_span = 0;
 }
 
-ecs_entity_t ecs_find_entity_in_prefabs(
-    ecs_world_t *world,
-    ecs_entity_t entity,
-    ecs_type_t type,
-    ecs_entity_t component,
-    ecs_entity_t previous)
+const ecs_world_info_t* ecs_get_world_info(
+    ecs_world_t *world)
 {
-    int32_t i, count = ecs_vector_count(type);
-    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
-
-    /* Walk from back to front, as prefabs are always located
-     * at the end of the type. */
-    for (i = count - 1; i >= 0; i --) {
-        ecs_entity_t e = array[i];
-
-        if (ECS_HAS_ROLE(e, INSTANCEOF)) {
-            ecs_entity_t prefab = e & ECS_COMPONENT_MASK;
-            ecs_type_t prefab_type = ecs_get_type(world, prefab);
-
-            if (prefab == previous) {
-                continue;
-            }
+    return &world->stats;
+}
 
-            if (ecs_type_owns_entity(
-                world, prefab_type, component, true)) 
-            {
-                return prefab;
-            } else {
-                prefab = ecs_find_entity_in_prefabs(
-                    world, prefab, prefab_type, component, entity);
-                if (prefab) {
-                    return prefab;
-                }
-            }
-        } else {
-            /* If this is not a prefab, the following entities won't
-                * be prefabs either because the array is sorted, and
-                * the prefab bit is 2^63 which ensures that prefabs are
-                * guaranteed to be the last entities in the type */
-            break;
-        }
-    }
+void ecs_notify_queries(
+    ecs_world_t *world,
+    ecs_query_event_t *event)
+{
+    int32_t i, count = ecs_vector_count(world->queries);
+    ecs_query_t **queries = ecs_vector_first(world->queries, ecs_query_t*);
 
-    return 0;
+    for (i = 0; i < count; i ++) {
+        ecs_query_notify(world, queries[i], event);
+    }    
 }
 
-/* -- Private functions -- */
-
-/* O(n) algorithm to check whether type 1 is equal or superset of type 2 */
-ecs_entity_t ecs_type_contains(
+static
+bool is_scope_table(
     ecs_world_t *world,
-    ecs_type_t type_1,
-    ecs_type_t type_2,
-    bool match_all,
-    bool match_prefab)
+    ecs_table_t *table)
 {
-    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_get_stage(&world);
-    
-    if (!type_1) {
-        return 0;
+    if (world->stage.scope_table == table || 
+        world->temp_stage.scope_table == table) 
+    {
+        return true;
     }
 
-    ecs_assert(type_2 != NULL, ECS_INTERNAL_ERROR, NULL);
-
-    if (type_1 == type_2) {
-        return *(ecs_vector_first(type_1, ecs_entity_t));
-    }
+    ecs_vector_each(world->worker_stages, ecs_stage_t, stage, {
+        if (stage->scope_table == table) {
+            return true;
+        }
+    });
 
-    int32_t i_2, i_1 = 0;
-    ecs_entity_t e1 = 0;
-    ecs_entity_t *t1_array = ecs_vector_first(type_1, ecs_entity_t);
-    ecs_entity_t *t2_array = ecs_vector_first(type_2, ecs_entity_t);
+    return false;
+}
 
-    ecs_assert(t1_array != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(t2_array != NULL, ECS_INTERNAL_ERROR, NULL);
+void ecs_set_table_gc(
+    ecs_world_t *world,
+    int32_t empty_frames)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(empty_frames >= 0, ECS_INVALID_PARAMETER, NULL);
+    world->table_gc_frames = empty_frames;
+}
 
-    int32_t t1_count = ecs_vector_count(type_1);
-    int32_t t2_count = ecs_vector_count(type_2);
+int32_t ecs_gc(
+    ecs_world_t *world)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-    for (i_2 = 0; i_2 < t2_count; i_2 ++) {
-        ecs_entity_t e2 = t2_array[i_2];
+    /* Store frame + 1, so that 0 can be used for tables that are not empty */
+    int32_t frame = world->stats.frame_count_total + 1;
+    ecs_vector_t *garbage = NULL;
 
-        if (i_1 >= t1_count) {
-            return 0;
+    ecs_sparse_t *tables = world->store.tables;
+    int32_t i, count = ecs_sparse_count(tables);
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        if (table->flags & EcsTableHasBuiltins) {
+            continue;
         }
 
-        e1 = t1_array[i_1];
+        if (ecs_table_count(table)) {
+            table->gc_frame = 0;
+            continue;
+        }
 
-        if (e2 > e1) {
-            do {
-                i_1 ++;
-                if (i_1 >= t1_count) {
-                    return 0;
-                }
-                e1 = t1_array[i_1];
-            } while (e2 > e1);
+        if (!table->gc_frame) {
+            table->gc_frame = frame;
         }
 
-        if (e1 != e2) {
-            if (match_prefab && e2 != 
-                ecs_typeid(EcsName) && e2 != 
-                EcsPrefab && e2 != 
-                EcsDisabled) 
-            {
-                if (ecs_find_entity_in_prefabs(world, 0, type_1, e2, 0)) {
-                    e1 = e2;
-                }
-            }
+        if (frame - table->gc_frame < world->table_gc_frames) {
+            continue;
+        }
 
-            if (e1 != e2) {
-                if (match_all) return 0;
-            } else if (!match_all) {
-                return e1;
-            }
-        } else {
-            if (!match_all) return e1;
-            i_1 ++;
-            if (i_1 < t1_count) {
-                e1 = t1_array[i_1];
-            }
+        if (is_scope_table(world, table)) {
+            continue;
         }
+
+        table->flags |= EcsTableIsGarbage;
+        ecs_table_t **elem = ecs_vector_add(&garbage, ecs_table_t*);
+        *elem = table;
     }
 
-    if (match_all) {
-        return e1;
-    } else {
+    if (!garbage) {
         return 0;
     }
-}
 
-/* -- Public API -- */
+    ecs_table_clear_garbage_edges(world);
 
-int32_t ecs_type_index_of(
-    ecs_type_t type,
-    ecs_entity_t entity)
-{
-    ecs_vector_each(type, ecs_entity_t, c_ptr, {
-        if (*c_ptr == entity) {
-            return c_ptr_i; 
-        }
-    });
+    ecs_table_t **buffer = ecs_vector_first(garbage, ecs_table_t*);
+    count = ecs_vector_count(garbage);
+    for (i = 0; i < count; i ++) {
+        ecs_table_unregister_child(world, buffer[i]);
+        ecs_delete_table(world, buffer[i]);
+    }
 
-    return -1;
+    ecs_vector_free(garbage);
+
+    return count;
 }
 
-ecs_type_t ecs_type_merge(
+void ecs_delete_table(
     ecs_world_t *world,
-    ecs_type_t type,
-    ecs_type_t to_add,
-    ecs_type_t to_remove)
+    ecs_table_t *table)
 {
-    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_get_stage(&world);
-    
-    ecs_table_t *table = ecs_table_from_type(world, type);
-    ecs_entities_t add_array = ecs_type_to_entities(to_add);
-    ecs_entities_t remove_array = ecs_type_to_entities(to_remove);
-    
-    table = ecs_table_traverse_remove(
-        world, table, &remove_array, NULL); 
-
-    table = ecs_table_traverse_add(
-        world, table, &add_array, NULL); 
+    /* Notify queries that table is to be removed */
+    ecs_notify_queries(
+        world, &(ecs_query_event_t){
+            .kind = EcsQueryTableUnmatch,
+            .table = table
+        });
 
-    if (!table) {
-        return NULL;
-    } else {
-        return table->type;
-    }
-}
+    uint32_t id = table->id;
 
-ecs_type_t ecs_type_find(
-    ecs_world_t *world,
-    ecs_entity_t *array,
-    int32_t count)
-{
-    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_get_stage(&world);
+    world->stats.table_delete_count_total ++;
 
-    ecs_entities_t entities = {
-        .array = array,
-        .count = count
-    };
+    ecs_table_unregister_instance(world, table);
+    ecs_table_index_remove(world, table);
 
-    ecs_table_t *table = ecs_table_find_or_create(world, &entities);
-    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    /* Free resources associated with table */
+    ecs_table_free(world, table);
 
-    return table->type;
-}
+    /* Remove table from sparse set */
+    ecs_assert(id != 0, ECS_INTERNAL_ERROR, NULL);
+    ecs_sparse_remove(world->store.tables, id);
 
-static
-bool has_trait(
-    ecs_entity_t trait,
-    ecs_entity_t e)
-{
-    return trait == ecs_entity_t_hi(e & ECS_COMPONENT_MASK);
+    /* Don't do generations as we want table ids to remain 32 bit */
+    ecs_sparse_set_generation(world->store.tables, id);
 }
 
 static
-bool has_case(
-    ecs_world_t *world,
-    ecs_entity_t sw_case,
-    ecs_entity_t e)
+ecs_switch_header_t *get_header(
+    const ecs_switch_t *sw,
+    uint64_t value)
 {
-    const EcsType *type_ptr = ecs_get(world, e & ECS_COMPONENT_MASK, EcsType);
-    ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
-    return ecs_type_has_entity(world, type_ptr->normalized, sw_case);
-}
+    if (value == 0) {
+        return NULL;
+    }
 
-static
-int match_entity(
-    ecs_world_t *world,
-    ecs_type_t type,
-    ecs_entity_t e,
-    ecs_entity_t match_with)
-{
-    if (ECS_HAS_ROLE(match_with, TRAIT)) {
-        ecs_entity_t hi = ecs_entity_t_hi(match_with & ECS_COMPONENT_MASK);
-        ecs_entity_t lo = ecs_entity_t_lo(match_with);
+    ecs_assert(value >= sw->min, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(value <= sw->max, ECS_INTERNAL_ERROR, NULL);
 
-        if (lo == EcsWildcard) {
-            ecs_assert(hi != 0, ECS_INTERNAL_ERROR, NULL);
-            
-            if (!ECS_HAS_ROLE(e, TRAIT) || !has_trait(hi, e)) {
-                return 0;
-            }
+    uint64_t index = value - sw->min;
 
-            ecs_entity_t *ids = ecs_vector_first(type, ecs_entity_t);
-            int32_t i, count = ecs_vector_count(type);
+    return &sw->headers[index];
+}
 
-            ecs_entity_t comp = ecs_entity_t_lo(e);
-            for (i = 0; i < count; i ++) {
-                if (comp == ids[i]) {
-                    return 2;
-                }
-            }
-
-            return -1;
-        } else if (!hi) {
-            if (ECS_HAS_ROLE(e, TRAIT) && has_trait(lo, e)) {
-                return 1;
-            }
-        }
-    } else 
-    if (ECS_HAS_ROLE(match_with, CASE)) {
-        ecs_entity_t sw_case = match_with & ECS_COMPONENT_MASK;
-        if (ECS_HAS_ROLE(e, SWITCH) && has_case(world, sw_case, e)) {
-            return 1;
-        } else {
-            return 0;
-        }
+static
+void remove_node(
+    ecs_switch_header_t *hdr,
+    ecs_switch_node_t *nodes,
+    ecs_switch_node_t *node,
+    int32_t element)
+{    
+    /* The node is currently assigned to a value */
+    if (hdr->element == element) {
+        ecs_assert(node->prev == -1, ECS_INVALID_PARAMETER, NULL);
+        /* If this is the first node, update the header */
+        hdr->element = node->next;
+    } else {
+        /* If this is not the first node, update the previous node */
+        ecs_assert(node->prev != -1, ECS_INVALID_PARAMETER, NULL);
+        ecs_switch_node_t *prev_node = &nodes[node->prev];
+        prev_node->next = node->next;
     }
 
-    if (e == match_with) {
-        return 1;
+    int32_t next = node->next;
+    if (next != -1) {
+        ecs_assert(next >= 0, ECS_INVALID_PARAMETER, NULL);
+        /* If this is not the last node, update the next node */
+        ecs_switch_node_t *next_node = &nodes[next];
+        next_node->prev = node->prev;
     }
 
-    return 0;
+    /* Decrease count of current header */
+    hdr->count --;
+    ecs_assert(hdr->count >= 0, ECS_INTERNAL_ERROR, NULL);
 }
 
-static
-bool search_type(
-    ecs_world_t *world,
-    ecs_type_t type,
-    ecs_entity_t entity,
-    bool owned)
+ecs_switch_t* ecs_switch_new(
+    uint64_t min, 
+    uint64_t max,
+    int32_t elements)
 {
-    if (!type) {
-        return false;
-    }
+    ecs_assert(min != max, ECS_INVALID_PARAMETER, NULL);
 
-    if (!entity) {
-        return true;
-    }
+    /* Min must be larger than 0, as 0 is an invalid entity id, and should
+     * therefore never occur as case id */
+    ecs_assert(min > 0, ECS_INVALID_PARAMETER, NULL);
 
-    ecs_entity_t *ids = ecs_vector_first(type, ecs_entity_t);
-    int32_t i, count = ecs_vector_count(type);
-    int matched = 0;
+    ecs_switch_t *result = ecs_os_malloc(ECS_SIZEOF(ecs_switch_t));
+    result->min = min;
+    result->max = max;
+
+    int32_t count = (int32_t)(max - min) + 1;
+    result->headers = ecs_os_calloc(ECS_SIZEOF(ecs_switch_header_t) * count);
+    result->nodes = ecs_vector_new(ecs_switch_node_t, elements);
+    result->values = ecs_vector_new(uint64_t, elements);
 
+    int64_t i;
     for (i = 0; i < count; i ++) {
-        int ret = match_entity(world, type, ids[i], entity);
-        switch(ret) {
-        case 0: break;
-        case 1: return true;
-        case -1: return false;
-        case 2: matched ++; break;
-        default: ecs_abort(ECS_INTERNAL_ERROR, NULL);
-        }
+        result->headers[i].element = -1;
+        result->headers[i].count = 0;
     }
 
-    if (!matched && !owned && entity != EcsPrefab && entity != EcsDisabled) {
-        for (i = count - 1; i >= 0; i --) {
-            ecs_entity_t e = ids[i];
-            if (!ECS_HAS_ROLE(e, INSTANCEOF)) {
-                break;
-            }
-
-            ecs_entity_t base = e & ECS_COMPONENT_MASK;
-            ecs_type_t base_type = ecs_get_type(world, base);
+    ecs_switch_node_t *nodes = ecs_vector_first(
+        result->nodes, ecs_switch_node_t);
+    uint64_t *values = ecs_vector_first(
+        result->values, uint64_t);        
 
-            if (search_type(world, base_type, entity, false)) {
-                return true;
-            }
-        }
+    for (i = 0; i < elements; i ++) {
+        nodes[i].prev = -1;
+        nodes[i].next = -1;
+        values[i] = 0;
     }
 
-    return matched != 0;
+    return result;
 }
 
-bool ecs_type_has_entity(
-    ecs_world_t *world,
-    ecs_type_t type,
-    ecs_entity_t entity)
+void ecs_switch_free(
+    ecs_switch_t *sw)
 {
-    return search_type(world, type, entity, false);
+    ecs_os_free(sw->headers);
+    ecs_vector_free(sw->nodes);
+    ecs_vector_free(sw->values);
+    ecs_os_free(sw);
 }
 
-bool ecs_type_owns_entity(
-    ecs_world_t *world,
-    ecs_type_t type,
-    ecs_entity_t entity,
-    bool owned)
+void ecs_switch_add(
+    ecs_switch_t *sw)
 {
-    return search_type(world, type, entity, owned);
+    ecs_switch_node_t *node = ecs_vector_add(&sw->nodes, ecs_switch_node_t);
+    uint64_t *value = ecs_vector_add(&sw->values, uint64_t);
+    node->prev = -1;
+    node->next = -1;
+    *value = 0;
 }
 
-bool ecs_type_has_type(
-    ecs_world_t *world,
-    ecs_type_t type,
-    ecs_type_t has)
+void ecs_switch_set_count(
+    ecs_switch_t *sw,
+    int32_t count)
 {
-    return ecs_type_contains(world, type, has, true, false) != 0;
+    int32_t old_count = ecs_vector_count(sw->nodes);
+    if (old_count == count) {
+        return;
+    }
+
+    ecs_vector_set_count(&sw->nodes, ecs_switch_node_t, count);
+    ecs_vector_set_count(&sw->values, uint64_t, count);
+
+    ecs_switch_node_t *nodes = ecs_vector_first(sw->nodes, ecs_switch_node_t);
+    uint64_t *values = ecs_vector_first(sw->values, uint64_t);
+
+    int32_t i;
+    for (i = old_count; i < count; i ++) {
+        ecs_switch_node_t *node = &nodes[i];
+        node->prev = -1;
+        node->next = -1;
+        values[i] = 0;
+    }
 }
 
-bool ecs_type_owns_type(
-    ecs_world_t *world,
-    ecs_type_t type,
-    ecs_type_t has,
-    bool owned)
+void ecs_switch_set_min_count(
+    ecs_switch_t *sw,
+    int32_t count)
 {
-    return ecs_type_contains(world, type, has, true, !owned) != 0;
+    int32_t old_count = ecs_vector_count(sw->nodes);
+    if (old_count >= count) {
+        return;
+    }
+
+    ecs_switch_set_count(sw, count);
 }
 
-ecs_type_t ecs_type_add(
-    ecs_world_t *world,
-    ecs_type_t type,
-    ecs_entity_t e)
+void ecs_switch_addn(
+    ecs_switch_t *sw,
+    int32_t count)
 {
-    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_get_stage(&world);
-    ecs_table_t *table = ecs_table_from_type(world, type);
+    int32_t old_count = ecs_vector_count(sw->nodes);
+    ecs_switch_set_count(sw, old_count + count);
+}
 
-    ecs_entities_t entities = {
-        .array = &e,
-        .count = 1
-    };
+void ecs_switch_set(
+    ecs_switch_t *sw,
+    int32_t element,
+    uint64_t value)
+{
+    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element < ecs_vector_count(sw->nodes), ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element < ecs_vector_count(sw->values), ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element >= 0, ECS_INVALID_PARAMETER, NULL);
 
-    table = ecs_table_traverse_add(world, table, &entities, NULL);
+    uint64_t *values = ecs_vector_first(sw->values, uint64_t);
+    uint64_t cur_value = values[element];
 
-    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    /* If the node is already assigned to the value, nothing to be done */
+    if (cur_value == value) {
+        return;
+    }
 
-    return table->type;
-}
+    ecs_switch_node_t *nodes = ecs_vector_first(sw->nodes, ecs_switch_node_t);
+    ecs_switch_node_t *node = &nodes[element];
 
-ecs_type_t ecs_type_remove(
-    ecs_world_t *world,
-    ecs_type_t type,
-    ecs_entity_t e)
-{
-    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_get_stage(&world);
-    ecs_table_t *table = ecs_table_from_type(world, type);
+    ecs_switch_header_t *cur_hdr = get_header(sw, cur_value);
+    ecs_switch_header_t *dst_hdr = get_header(sw, value);
 
-    ecs_entities_t entities = {
-        .array = &e,
-        .count = 1
-    };
+    if (cur_hdr) {
+        remove_node(cur_hdr, nodes, node, element);
+    }
 
-    table = ecs_table_traverse_remove(world, table, &entities, NULL);
-    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    /* Now update the node itself by adding it as the first node of dst */
+    node->next = dst_hdr->element;
+    node->prev = -1;
+    values[element] = value;
 
-    return table->type;    
+    /* Also update the dst header */
+    int32_t first = dst_hdr->element;
+    if (first != -1) {
+        ecs_assert(first >= 0, ECS_INTERNAL_ERROR, NULL);
+        ecs_switch_node_t *first_node = &nodes[first];
+        first_node->prev = element;
+    }
+
+    dst_hdr->element = element;
+    dst_hdr->count ++;
 }
 
-char* ecs_type_str(
-    ecs_world_t *world,
-    ecs_type_t type)
+void ecs_switch_remove(
+    ecs_switch_t *sw,
+    int32_t element)
 {
-    if (!type) {
-        return ecs_os_strdup("");
-    }
-
-    ecs_vector_t *chbuf = ecs_vector_new(char, 32);
-    char *dst;
+    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element < ecs_vector_count(sw->nodes), ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element >= 0, ECS_INVALID_PARAMETER, NULL);
 
-    ecs_entity_t *entities = ecs_vector_first(type, ecs_entity_t);
-    int32_t i, count = ecs_vector_count(type);
+    uint64_t *values = ecs_vector_first(sw->values, uint64_t);
+    uint64_t value = values[element];
+    ecs_switch_node_t *nodes = ecs_vector_first(sw->nodes, ecs_switch_node_t);
+    ecs_switch_node_t *node = &nodes[element];
 
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t e = entities[i];
-        char buffer[256];
-        ecs_size_t len;
+    /* If node is currently assigned to a case, remove it from the list */
+    if (value != 0) {
+        ecs_switch_header_t *hdr = get_header(sw, value);
+        ecs_assert(hdr != NULL, ECS_INTERNAL_ERROR, NULL);
+        remove_node(hdr, nodes, node, element);
+    }
 
-        if (i) {
-            *(char*)ecs_vector_add(&chbuf, char) = ',';
-        }
+    /* Remove element from arrays */
+    ecs_vector_remove_index(sw->nodes, ecs_switch_node_t, element);
+    ecs_vector_remove_index(sw->values, uint64_t, element);
 
-        if (e == 1) {
-            ecs_os_strcpy(buffer, "EcsComponent");
-            len = ecs_os_strlen("EcsComponent");
+    if (ecs_vector_count(sw->nodes)) {
+        int32_t prev = node->prev;
+        if (prev != -1) {
+            ecs_assert(prev >= 0, ECS_INVALID_PARAMETER, NULL);
+            nodes[prev].next = element;
         } else {
-            len = ecs_from_size_t(ecs_entity_str(world, e, buffer, 256));
+            ecs_switch_header_t *hdr = get_header(sw, values[element]);
+            if (hdr && hdr->element != -1) {
+                ecs_assert(hdr->element == ecs_vector_count(sw->nodes), 
+                    ECS_INTERNAL_ERROR, NULL);
+                hdr->element = element;
+            }             
         }
-
-        dst = ecs_vector_addn(&chbuf, char, len);
-        ecs_os_memcpy(dst, buffer, len);
     }
-
-    *(char*)ecs_vector_add(&chbuf, char) = '\0';
-
-    char* result = ecs_os_strdup(ecs_vector_first(chbuf, char));
-    ecs_vector_free(chbuf);
-    return result;
 }
 
-ecs_entity_t ecs_type_get_entity_for_xor(
-    ecs_world_t *world,
-    ecs_type_t type,
-    ecs_entity_t xor)
+uint64_t ecs_switch_get(
+    const ecs_switch_t *sw,
+    int32_t element)
 {
-    ecs_assert(
-        ecs_type_owns_entity(world, type, ECS_XOR | xor, true),
-        ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element < ecs_vector_count(sw->nodes), ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element < ecs_vector_count(sw->values), ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element >= 0, ECS_INVALID_PARAMETER, NULL);
 
-    const EcsType *type_ptr = ecs_get(world, xor, EcsType);
-    ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+    uint64_t *values = ecs_vector_first(sw->values, uint64_t);
+    return values[element];
+}
 
-    ecs_type_t xor_type = type_ptr->normalized;
-    ecs_assert(xor_type != NULL, ECS_INTERNAL_ERROR, NULL);
+ecs_vector_t* ecs_switch_values(
+    const ecs_switch_t *sw)
+{
+    return sw->values;
+}
 
-    int32_t i, count = ecs_vector_count(type);
-    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
-    for (i = 0; i < count; i ++) {
-        if (ecs_type_owns_entity(world, xor_type, array[i], true)) {
-            return array[i];
-        }
+int32_t ecs_switch_case_count(
+    const ecs_switch_t *sw,
+    uint64_t value)
+{
+    ecs_switch_header_t *hdr = get_header(sw, value);
+    if (!hdr) {
+        return 0;
     }
 
-    return 0;
+    return hdr->count;
 }
 
-int32_t ecs_type_trait_index_of(
-    ecs_type_t type, 
-    int32_t start_index, 
-    ecs_entity_t trait)
+int32_t ecs_switch_first(
+    const ecs_switch_t *sw,
+    uint64_t value)
 {
-    int32_t i, count = ecs_vector_count(type);
-    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
+    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(value <= sw->max, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(value >= sw->min, ECS_INVALID_PARAMETER, NULL);
 
-    for (i = start_index; i < count; i ++) {
-        ecs_entity_t e = array[i];
-        if (ECS_HAS_ROLE(e, TRAIT)) {
-            e &= ECS_COMPONENT_MASK;
-            if (trait == ecs_entity_t_hi(e)) {
-                return i;
-            }
-        }
-    }
+    ecs_switch_header_t *hdr = get_header(sw, value);
+    ecs_assert(hdr != NULL, ECS_INVALID_PARAMETER, NULL);
 
-    return -1;
+    return hdr->element;
 }
 
-void ecs_os_api_impl(ecs_os_api_t *api);
-
-static bool ecs_os_api_initialized = false;
-static int ecs_os_api_init_count = 0;
+int32_t ecs_switch_next(
+    const ecs_switch_t *sw,
+    int32_t element)
+{
+    ecs_assert(sw != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element < ecs_vector_count(sw->nodes), ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(element >= 0, ECS_INVALID_PARAMETER, NULL);
 
-ecs_os_api_t ecs_os_api;
+    ecs_switch_node_t *nodes = ecs_vector_first(
+        sw->nodes, ecs_switch_node_t);
 
-int64_t ecs_os_api_malloc_count = 0;
-int64_t ecs_os_api_realloc_count = 0;
-int64_t ecs_os_api_calloc_count = 0;
-int64_t ecs_os_api_free_count = 0;
+    return nodes[element].next;
+}
 
-void ecs_os_set_api(
-    ecs_os_api_t *os_api)
+static
+void ensure(
+    ecs_bitset_t *bs,
+    ecs_size_t size)
 {
-    if (!ecs_os_api_initialized) {
-        ecs_os_api = *os_api;
-        ecs_os_api_initialized = true;
+    if (!bs->size) {
+        int32_t new_size = ((size - 1) / 64 + 1) * ECS_SIZEOF(uint64_t);
+        bs->size = ((size - 1) / 64 + 1) * 64;
+        bs->data = ecs_os_calloc(new_size);
+    } else if (size > bs->size) {
+        int32_t prev_size = ((bs->size - 1) / 64 + 1) * ECS_SIZEOF(uint64_t);
+        bs->size = ((size - 1) / 64 + 1) * 64;
+        int32_t new_size = ((size - 1) / 64 + 1) * ECS_SIZEOF(uint64_t);
+        bs->data = ecs_os_realloc(bs->data, new_size);
+        ecs_os_memset(ECS_OFFSET(bs->data, prev_size), 0, new_size - prev_size);
     }
 }
 
-void ecs_os_init(void)
+/* Set bits in range [first, first + count) to true */
+static
+void fill(
+    ecs_bitset_t *bs,
+    int32_t first,
+    int32_t count)
 {
-    if (!ecs_os_api_initialized) {
-        ecs_os_set_api_defaults();
-    }
-    
-    if (!(ecs_os_api_init_count ++)) {
-        if (ecs_os_api.init_) {
-            ecs_os_api.init_();
-        }
+    int32_t i;
+    for (i = first; i < first + count; i ++) {
+        bs->data[i >> 6] |= (uint64_t)1 << ((uint64_t)i & 0x3F);
     }
 }
 
-void ecs_os_fini(void) {
-    if (!--ecs_os_api_init_count) {
-        if (ecs_os_api.fini_) {
-            ecs_os_api.fini_();
-        }
-    }
+void ecs_bitset_init(
+    ecs_bitset_t* bs)
+{
+    bs->size = 0;
+    bs->count = 0;
+    bs->data = NULL;
 }
 
-static
-void ecs_log(const char *fmt, va_list args) {
-    vfprintf(stdout, fmt, args);
-    fprintf(stdout, "\n");
+void ecs_bitset_ensure(
+    ecs_bitset_t *bs,
+    int32_t count)
+{
+    if (count > bs->count) {
+        int32_t prev_count = bs->count;
+        bs->count = count;
+        ensure(bs, count);
+        fill(bs, prev_count, count - prev_count);
+    }
 }
 
-static
-void ecs_log_error(const char *fmt, va_list args) {
-    vfprintf(stderr, fmt, args);
-    fprintf(stderr, "\n");
+void ecs_bitset_deinit(
+    ecs_bitset_t *bs)
+{
+    ecs_os_free(bs->data);
+    bs->data = NULL;
+    bs->size = 0;
+    bs->count = 0;
 }
 
-static
-void ecs_log_debug(const char *fmt, va_list args) {
-    vfprintf(stdout, fmt, args);
-    fprintf(stdout, "\n");
+void ecs_bitset_addn(
+    ecs_bitset_t *bs,
+    int32_t count)
+{
+    int32_t elem = bs->count += count;
+    ensure(bs, elem);
+    fill(bs, elem - count, count);
 }
 
-static
-void ecs_log_warning(const char *fmt, va_list args) {
-    vfprintf(stderr, fmt, args);
-    fprintf(stderr, "\n");
+void ecs_bitset_set(
+    ecs_bitset_t *bs,
+    int32_t elem,
+    bool value)
+{
+    ecs_assert(elem >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(elem < bs->count, ECS_INVALID_PARAMETER, NULL);
+    int32_t hi = elem >> 6;
+    uint64_t lo = (uint64_t)elem & 0x3F;
+    uint64_t v = bs->data[hi];
+    bs->data[hi] = (v & ~((uint64_t)1 << lo)) | ((uint64_t)value << lo);
 }
 
-void ecs_os_dbg(const char *fmt, ...) {
-#ifndef NDEBUG
-    va_list args;
-    va_start(args, fmt);
-    if (ecs_os_api.log_debug_) {
-        ecs_os_api.log_debug_(fmt, args);
-    }
-    va_end(args);
-#else
-    (void)fmt;
-#endif
+bool ecs_bitset_get(
+    const ecs_bitset_t *bs,
+    int32_t elem)
+{
+    ecs_assert(elem >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(elem < bs->count, ECS_INVALID_PARAMETER, NULL);
+    return !!(bs->data[elem >> 6] & ((uint64_t)1 << ((uint64_t)elem & 0x3F)));
 }
 
-void ecs_os_warn(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    if (ecs_os_api.log_warning_) {
-        ecs_os_api.log_warning_(fmt, args);
-    }
-    va_end(args);
+int32_t ecs_bitset_count(
+    const ecs_bitset_t *bs)
+{
+    return bs->count;
 }
 
-void ecs_os_log(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    if (ecs_os_api.log_) {
-        ecs_os_api.log_(fmt, args);
-    }
-    va_end(args);
-}
+void ecs_bitset_remove(
+    ecs_bitset_t *bs,
+    int32_t elem)
+{
+    ecs_assert(elem >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(elem < bs->count, ECS_INVALID_PARAMETER, NULL);
+    int32_t last = bs->count - 1;
+    bool last_value = ecs_bitset_get(bs, last);
+    ecs_bitset_set(bs, elem, last_value);
 
-void ecs_os_err(const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    if (ecs_os_api.log_error_) {
-        ecs_os_api.log_error_(fmt, args);
-    }
-    va_end(args);
+    /* Clear the bit of the removed element, so that bits past the count are
+     * always false. This lets iterators test whole words at a time. */
+    ecs_bitset_set(bs, last, false);
+    bs->count --;
 }
 
-void ecs_os_gettime(ecs_time_t *time)
+void ecs_bitset_swap(
+    ecs_bitset_t *bs,
+    int32_t elem_a,
+    int32_t elem_b)
 {
-    uint64_t now = ecs_os_time_now();
-    uint64_t sec = now / 1000000000;
+    ecs_assert(elem_a >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(elem_b >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(elem_a < bs->count, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(elem_b < bs->count, ECS_INVALID_PARAMETER, NULL);
 
-    assert(sec < UINT32_MAX);
-    assert((now - sec * 1000000000) < UINT32_MAX);
-
-    time->sec = (uint32_t)sec;
-    time->nanosec = (uint32_t)(now - sec * 1000000000);
+    bool a = ecs_bitset_get(bs, elem_a);
+    bool b = ecs_bitset_get(bs, elem_b);
+    ecs_bitset_set(bs, elem_a, b);
+    ecs_bitset_set(bs, elem_b, a);
 }
 
-static
-void* ecs_os_api_malloc(ecs_size_t size) {
-    ecs_os_api_malloc_count ++;
-    ecs_assert(size > 0, ECS_INVALID_PARAMETER, NULL);
-    return malloc((size_t)size);
-}
 
-static
-void* ecs_os_api_calloc(ecs_size_t size) {
-    ecs_os_api_calloc_count ++;
-    ecs_assert(size > 0, ECS_INVALID_PARAMETER, NULL);
-    return calloc(1, (size_t)size);
-}
+ecs_iter_t ecs_filter_iter(
+    ecs_world_t *world,
+    const ecs_filter_t *filter)
+{
+    ecs_filter_iter_t iter = {
+        .filter = filter ? *filter : (ecs_filter_t){0},
+        .tables = world->store.tables,
+        .index = 0
+    };
 
-static
-void* ecs_os_api_realloc(void *ptr, ecs_size_t size) {
-    ecs_assert(size > 0, ECS_INVALID_PARAMETER, NULL);
+    return (ecs_iter_t){
+        .world = world,
+        .iter.filter = iter
+    };
+}
 
-    if (ptr) {
-        ecs_os_api_realloc_count ++;
-    } else {
-        /* If not actually reallocing, treat as malloc */
-        ecs_os_api_malloc_count ++; 
+bool ecs_filter_next(
+    ecs_iter_t *it)
+{
+    ecs_filter_iter_t *iter = &it->iter.filter;
+    ecs_sparse_t *tables = iter->tables;
+    int32_t count = ecs_sparse_count(tables);
+    int32_t i;
+
+    for (i = iter->index; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+        
+        ecs_data_t *data = ecs_table_get_data(table);
+
+        if (!data) {
+            continue;
+        }
+
+        if (!ecs_table_match_filter(it->world, table, &iter->filter)) {
+            continue;
+        }
+
+        iter->table.table = table;
+        it->table = &iter->table;
+        it->table_columns = data->columns;
+        it->count = ecs_table_count(table);
+        it->entities = ecs_vector_first(data->entities, ecs_entity_t);
+        iter->index = i + 1;
+
+        return true;
     }
-    
-    return realloc(ptr, (size_t)size);
+
+    return false;
 }
 
+/* Add an extra element to the buffer */
 static
-void ecs_os_api_free(void *ptr) {
-    if (ptr) {
-        ecs_os_api_free_count ++;
-    }
-    free(ptr);
+void ecs_strbuf_grow(
+    ecs_strbuf_t *b)
+{
+    /* Allocate new element */
+    ecs_strbuf_element_embedded *e = ecs_os_malloc(sizeof(ecs_strbuf_element_embedded));
+    b->size += b->current->pos;
+    b->current->next = (ecs_strbuf_element*)e;
+    b->current = (ecs_strbuf_element*)e;
+    b->elementCount ++;
+    e->super.buffer_embedded = true;
+    e->super.buf = e->buf;
+    e->super.pos = 0;
+    e->super.next = NULL;
 }
 
+/* Add an extra dynamic element */
 static
-char* ecs_os_api_strdup(const char *str) {
-    int len = ecs_os_strlen(str);
-    char *result = ecs_os_malloc(len + 1);
-    ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
-    ecs_os_strcpy(result, str);
-    return result;
+void ecs_strbuf_grow_str(
+    ecs_strbuf_t *b,
+    char *str,
+    char *alloc_str,
+    int32_t size)
+{
+    /* Allocate new element */
+    ecs_strbuf_element_str *e = ecs_os_malloc(sizeof(ecs_strbuf_element_str));
+    b->size += b->current->pos;
+    b->current->next = (ecs_strbuf_element*)e;
+    b->current = (ecs_strbuf_element*)e;
+    b->elementCount ++;
+    e->super.buffer_embedded = false;
+    e->super.pos = size ? size : (int32_t)ecs_os_strlen(str);
+    e->super.next = NULL;
+    e->super.buf = str;
+    e->alloc_str = alloc_str;
 }
 
-/* Replace dots with underscores */
 static
-char *module_file_base(const char *module, char sep) {
-    char *base = ecs_os_strdup(module);
-    ecs_size_t i, len = ecs_os_strlen(base);
-    for (i = 0; i < len; i ++) {
-        if (base[i] == '.') {
-            base[i] = sep;
-        }
+char* ecs_strbuf_ptr(
+    ecs_strbuf_t *b)
+{
+    if (b->buf) {
+        return &b->buf[b->current->pos];
+    } else {
+        return &b->current->buf[b->current->pos];
     }
-
-    return base;
 }
 
+/* Compute the amount of space left in the current element */
 static
-char* ecs_os_api_module_to_dl(const char *module) {
-    ecs_strbuf_t lib = ECS_STRBUF_INIT;
-
-    /* Best guess, use module name with underscores + OS library extension */
-    char *file_base = module_file_base(module, '_');
-
-#if defined(ECS_OS_LINUX)
-    ecs_strbuf_appendstr(&lib, "lib");
-    ecs_strbuf_appendstr(&lib, file_base);
-    ecs_strbuf_appendstr(&lib, ".so");
-#elif defined(ECS_OS_DARWIN)
-    ecs_strbuf_appendstr(&lib, "lib");
-    ecs_strbuf_appendstr(&lib, file_base);
-    ecs_strbuf_appendstr(&lib, ".dylib");
-#elif defined(ECS_OS_WINDOWS)
-    ecs_strbuf_appendstr(&lib, file_base);
-    ecs_strbuf_appendstr(&lib, ".dll");
-#endif
+int32_t ecs_strbuf_memLeftInCurrentElement(
+    ecs_strbuf_t *b)
+{
+    if (b->current->buffer_embedded) {
+        return ECS_STRBUF_ELEMENT_SIZE - b->current->pos;
+    } else {
+        return 0;
+    }
+}
 
-    ecs_os_free(file_base);
+/* Compute the amount of space left */
+static
+int32_t ecs_strbuf_memLeft(
+    ecs_strbuf_t *b)
+{
+    if (b->max) {
+        return b->max - b->size - b->current->pos;
+    } else {
+        return INT_MAX;
+    }
+}
 
-    return ecs_strbuf_get(&lib);
+static
+void ecs_strbuf_init(
+    ecs_strbuf_t *b)
+{
+    /* Initialize buffer structure only once */
+    if (!b->elementCount) {
+        b->size = 0;
+        b->firstElement.super.next = NULL;
+        b->firstElement.super.pos = 0;
+        b->firstElement.super.buffer_embedded = true;
+        b->firstElement.super.buf = b->firstElement.buf;
+        b->elementCount ++;
+        b->current = (ecs_strbuf_element*)&b->firstElement;
+    }
 }
 
+/* Quick custom function to copy a maxium number of characters and
+ * simultaneously determine length of source string. */
 static
-char* ecs_os_api_module_to_etc(const char *module) {
-    ecs_strbuf_t lib = ECS_STRBUF_INIT;
+int32_t fast_strncpy(
+    char * dst,
+    const char * src,
+    int n_cpy,
+    int n)
+{
+    ecs_assert(n_cpy >= 0, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(n >= 0, ECS_INTERNAL_ERROR, NULL);
 
-    /* Best guess, use module name with dashes + /etc */
-    char *file_base = module_file_base(module, '-');
+    const char *ptr, *orig = src;
+    char ch;
 
-    ecs_strbuf_appendstr(&lib, file_base);
-    ecs_strbuf_appendstr(&lib, "/etc");
+    for (ptr = src; (ptr - orig < n) && (ch = *ptr); ptr ++) {
+        if (ptr - orig < n_cpy) {
+            *dst = ch;
+            dst ++;
+        }
+    }
 
-    ecs_os_free(file_base);
+    ecs_assert(ptr - orig < INT32_MAX, ECS_INTERNAL_ERROR, NULL);
 
-    return ecs_strbuf_get(&lib);
+    return (int32_t)(ptr - orig);
 }
 
-void ecs_os_set_api_defaults(void)
+/* Append a format string to a buffer */
+static
+bool ecs_strbuf_vappend_intern(
+    ecs_strbuf_t *b,
+    const char* str,
+    va_list args)
 {
-    /* Don't overwrite if already initialized */
-    if (ecs_os_api_initialized != 0) {
-        return;
-    }
-
-    ecs_os_time_setup();
-    
-    /* Memory management */
-    ecs_os_api.malloc_ = ecs_os_api_malloc;
-    ecs_os_api.free_ = ecs_os_api_free;
-    ecs_os_api.realloc_ = ecs_os_api_realloc;
-    ecs_os_api.calloc_ = ecs_os_api_calloc;
-
-    /* Strings */
-    ecs_os_api.strdup_ = ecs_os_api_strdup;
+    bool result = true;
+    va_list arg_cpy;
 
-    /* Time */
-    ecs_os_api.sleep_ = ecs_os_time_sleep;
-    ecs_os_api.get_time_ = ecs_os_gettime;
+    if (!str) {
+        return result;
+    }
 
-    /* Logging */
-    ecs_os_api.log_ = ecs_log;
-    ecs_os_api.log_error_ = ecs_log_error;
-    ecs_os_api.log_debug_ = ecs_log_debug;
-    ecs_os_api.log_warning_ = ecs_log_warning;
+    ecs_strbuf_init(b);
 
-    /* Modules */
-    if (!ecs_os_api.module_to_dl_) {
-        ecs_os_api.module_to_dl_ = ecs_os_api_module_to_dl;
-    }
+    int32_t memLeftInElement = ecs_strbuf_memLeftInCurrentElement(b);
+    int32_t memLeft = ecs_strbuf_memLeft(b);
 
-    if (!ecs_os_api.module_to_etc_) {
-        ecs_os_api.module_to_etc_ = ecs_os_api_module_to_etc;
+    if (!memLeft) {
+        return false;
     }
 
-    ecs_os_api.abort_ = abort;
-}
+    /* Compute the memory required to add the string to the buffer. If user
+     * provided buffer, use space left in buffer, otherwise use space left in
+     * current element. */
+    int32_t max_copy = b->buf ? memLeft : memLeftInElement;
+    int32_t memRequired;
 
-bool ecs_os_has_heap(void) {
-    return 
-        (ecs_os_api.malloc_ != NULL) &&
-        (ecs_os_api.calloc_ != NULL) &&
-        (ecs_os_api.realloc_ != NULL) &&
-        (ecs_os_api.free_ != NULL);
-}
+    va_copy(arg_cpy, args);
+    memRequired = vsnprintf(
+        ecs_strbuf_ptr(b), (size_t)(max_copy + 1), str, args);
 
-bool ecs_os_has_threading(void) {
-    return
-        (ecs_os_api.mutex_new_ != NULL) &&
-        (ecs_os_api.mutex_free_ != NULL) &&
-        (ecs_os_api.mutex_lock_ != NULL) &&
-        (ecs_os_api.mutex_unlock_ != NULL) &&
-        (ecs_os_api.cond_new_ != NULL) &&
-        (ecs_os_api.cond_free_ != NULL) &&
-        (ecs_os_api.cond_wait_ != NULL) &&
-        (ecs_os_api.cond_signal_ != NULL) &&
-        (ecs_os_api.cond_broadcast_ != NULL) &&
-        (ecs_os_api.thread_new_ != NULL) &&
-        (ecs_os_api.thread_join_ != NULL);   
-}
-
-bool ecs_os_has_time(void) {
-    return 
-        (ecs_os_api.get_time_ != NULL) &&
-        (ecs_os_api.sleep_ != NULL);
-}
+    if (memRequired <= memLeftInElement) {
+        /* Element was large enough to fit string */
+        b->current->pos += memRequired;
+    } else if ((memRequired - memLeftInElement) < memLeft) {
+        /* If string is a format string, a new buffer of size memRequired is
+         * needed to re-evaluate the format string and only use the part that
+         * wasn't already copied to the previous element */
+        if (memRequired <= ECS_STRBUF_ELEMENT_SIZE) {
+            /* Resulting string fits in standard-size buffer. Note that the
+             * entire string needs to fit, not just the remainder, as the
+             * format string cannot be partially evaluated */
+            ecs_strbuf_grow(b);
 
-bool ecs_os_has_logging(void) {
-    return 
-        (ecs_os_api.log_ != NULL) &&
-        (ecs_os_api.log_error_ != NULL) &&
-        (ecs_os_api.log_debug_ != NULL) &&
-        (ecs_os_api.log_warning_ != NULL);
-}
+            /* Copy entire string to new buffer */
+            ecs_os_vsprintf(ecs_strbuf_ptr(b), str, arg_cpy);
 
-bool ecs_os_has_dl(void) {
-    return 
-        (ecs_os_api.dlopen_ != NULL) &&
-        (ecs_os_api.dlproc_ != NULL) &&
-        (ecs_os_api.dlclose_ != NULL);  
-}
+            /* Ignore the part of the string that was copied into the
+             * previous buffer. The string copied into the new buffer could
+             * be memmoved so that only the remainder is left, but that is
+             * most likely more expensive than just keeping the entire
+             * string. */
 
-bool ecs_os_has_modules(void) {
-    return 
-        (ecs_os_api.module_to_dl_ != NULL) &&
-        (ecs_os_api.module_to_etc_ != NULL);
-}
+            /* Update position in buffer */
+            b->current->pos += memRequired;
+        } else {
+            /* Resulting string does not fit in standard-size buffer.
+             * Allocate a new buffer that can hold the entire string. */
+            char *dst = ecs_os_malloc(memRequired + 1);
+            ecs_os_vsprintf(dst, str, arg_cpy);
+            ecs_strbuf_grow_str(b, dst, dst, memRequired);
+        }
+    } else {
+        /* Buffer max has been reached */
+        result = false;
+    }
 
-#ifdef FLECS_SYSTEMS_H
-#ifndef FLECS_SYSTEM_PRIVATE_H
-#define FLECS_SYSTEM_PRIVATE_H
+    va_end(arg_cpy);
 
+    return result;
+}
 
-typedef struct EcsSystem {
-    ecs_iter_action_t action;       /* Callback to be invoked for matching it */
-    void *ctx;                      /* Userdata for system */
+static
+bool ecs_strbuf_append_intern(
+    ecs_strbuf_t *b,
+    const char* str,
+    int n)
+{
+    bool result = true;
 
-    ecs_entity_t entity;                  /* Entity id of system, used for ordering */
-    ecs_query_t *query;                   /* System query */
-    ecs_on_demand_out_t *on_demand;       /* Keep track of [out] column refs */
-    ecs_system_status_action_t status_action; /* Status action */
-    void *status_ctx;                     /* User data for status action */    
-    ecs_entity_t tick_source;             /* Tick source associated with system */
-    
-    int32_t invoke_count;                 /* Number of times system is invoked */
-    float time_spent;                     /* Time spent on running system */
-    float time_passed;                    /* Time passed since last invocation */
-} EcsSystem;
+    if (!str) {
+        return result;
+    }
 
-/* Invoked when system becomes active / inactive */
-void ecs_system_activate(
-    ecs_world_t *world,
-    ecs_entity_t system,
-    bool activate,
-    const EcsSystem *system_data);
+    ecs_strbuf_init(b);
 
-/* Internal function to run a system */
-ecs_entity_t ecs_run_intern(
-    ecs_world_t *world,
-    ecs_stage_t *stage,
-    ecs_entity_t system,
-    EcsSystem *system_data,
-    float delta_time,
-    int32_t offset,
-    int32_t limit,
-    const ecs_filter_t *filter,
-    void *param,
-    bool ran_by_app);
+    int32_t memLeftInElement = ecs_strbuf_memLeftInCurrentElement(b);
+    int32_t memLeft = ecs_strbuf_memLeft(b);
 
-#endif
-#endif
+    if (memLeft <= 0) {
+        return false;
+    }
 
-void activate_table(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_table_t *table,
-    bool active);
+    /* Compute the memory required to add the string to the buffer. If user
+     * provided buffer, use space left in buffer, otherwise use space left in
+     * current element. */
+    int32_t max_copy = b->buf ? memLeft : memLeftInElement;
+    int32_t memRequired;
 
-static
-ecs_entity_t components_contains(
-    ecs_world_t *world,
-    ecs_type_t table_type,
-    ecs_type_t type,
-    ecs_entity_t *entity_out,
-    bool match_all)
-{
-    ecs_vector_each(table_type, ecs_entity_t, c_ptr, {
-        ecs_entity_t entity = *c_ptr;
+    if (n < 0) n = INT_MAX;
 
-        if (ECS_HAS_ROLE(entity, CHILDOF)) {
-            entity &= ECS_COMPONENT_MASK;
+    memRequired = fast_strncpy(ecs_strbuf_ptr(b), str, max_copy, n);
 
-            ecs_record_t *record = ecs_eis_get(world, entity);
-            ecs_assert(record != 0, ECS_INTERNAL_ERROR, NULL);
+    if (memRequired <= memLeftInElement) {
+        /* Element was large enough to fit string */
+        b->current->pos += memRequired;
+    } else if ((memRequired - memLeftInElement) < memLeft) {
+        /* Element was not large enough, but buffer still has space */
+        b->current->pos += memLeftInElement;
+        memRequired -= memLeftInElement;
 
-            if (record->table) {
-                ecs_entity_t component = ecs_type_contains(
-                    world, record->table->type, type, match_all, true);
+        /* Current element was too small, copy remainder into new element */
+        if (memRequired < ECS_STRBUF_ELEMENT_SIZE) {
+            /* A standard-size buffer is large enough for the new string */
+            ecs_strbuf_grow(b);
 
-                if (component) {
-                    if (entity_out) *entity_out = entity;
-                    return component;
-                }
+            /* Copy the remainder to the new buffer */
+            if (n) {
+                /* If a max number of characters to write is set, only a
+                    * subset of the string should be copied to the buffer */
+                ecs_os_strncpy(
+                    ecs_strbuf_ptr(b),
+                    str + memLeftInElement,
+                    (size_t)memRequired);
+            } else {
+                ecs_os_strcpy(ecs_strbuf_ptr(b), str + memLeftInElement);
             }
-        }
-    });
-
-    return 0;
-}
 
-/* Get actual entity on which specified component is stored */
-static
-ecs_entity_t get_entity_for_component(
-    ecs_world_t *world,
-    ecs_entity_t entity,
-    ecs_type_t type,
-    ecs_entity_t component)
-{
-    if (entity) {
-        ecs_record_t *record = ecs_eis_get(world, entity);
-        ecs_assert(record != NULL, ECS_INTERNAL_ERROR, NULL);
-        if (record->table) {
-            type = record->table->type;
+            /* Update to number of characters copied to new buffer */
+            b->current->pos += memRequired;
         } else {
-            type = NULL;
+            char *remainder = ecs_os_strdup(str + memLeftInElement);
+            ecs_strbuf_grow_str(b, remainder, remainder, memRequired);
         }
+    } else {
+        /* Buffer max has been reached */
+        result = false;
     }
 
-    ecs_vector_each(type, ecs_entity_t, c_ptr, {
-        if (*c_ptr == component) {
-            return entity;
-        }
-    });
-
-    return ecs_find_entity_in_prefabs(world, entity, type, component, 0);
+    return result;
 }
 
-#ifndef NDEBUG
-static
-ecs_entity_t get_cascade_component(
-    ecs_query_t *query)
+bool ecs_strbuf_vappend(
+    ecs_strbuf_t *b,
+    const char* fmt,
+    va_list args)
 {
-    ecs_sig_column_t *column = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
-    return column[query->cascade_by - 1].is.component;
+    bool result = ecs_strbuf_vappend_intern(
+        b, fmt, args
+    );
+
+    return result;
 }
-#endif
 
-static
-int32_t rank_by_depth(
-    ecs_world_t *world,
-    ecs_entity_t rank_by_component,
-    ecs_type_t type)
+bool ecs_strbuf_append(
+    ecs_strbuf_t *b,
+    const char* fmt,
+    ...)
 {
-    int32_t result = 0;
-    int32_t i, count = ecs_vector_count(type);
-    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
+    va_list args;
+    va_start(args, fmt);
+    bool result = ecs_strbuf_vappend_intern(
+        b, fmt, args
+    );
+    va_end(args);
 
-    for (i = count - 1; i >= 0; i --) {
-        if (ECS_HAS_ROLE(array[i], CHILDOF)) {
-            ecs_type_t c_type = ecs_get_type(world, array[i] & ECS_COMPONENT_MASK);
-            int32_t j, c_count = ecs_vector_count(c_type);
-            ecs_entity_t *c_array = ecs_vector_first(c_type, ecs_entity_t);
+    return result;
+}
 
-            for (j = 0; j < c_count; j ++) {
-                if (c_array[j] == rank_by_component) {
-                    result ++;
-                    result += rank_by_depth(world, rank_by_component, c_type);
-                    break;
-                }
-            }
-
-            if (j != c_count) {
-                break;
-            }
-        } else if (!(array[i] & ECS_ROLE_MASK)) {
-            /* No more parents after this */
-            break;
-        }
-    }
+bool ecs_strbuf_appendstrn(
+    ecs_strbuf_t *b,
+    const char* str,
+    int32_t len)
+{
+    return ecs_strbuf_append_intern(
+        b, str, len
+    );
+}
 
-    return result;
+bool ecs_strbuf_appendstr_zerocpy(
+    ecs_strbuf_t *b,
+    char* str)
+{
+    ecs_strbuf_init(b);
+    ecs_strbuf_grow_str(b, str, str, 0);
+    return true;
 }
 
-static
-int table_compare(
-    const void *t1,
-    const void *t2)
+bool ecs_strbuf_appendstr_zerocpy_const(
+    ecs_strbuf_t *b,
+    const char* str)
 {
-    const ecs_matched_table_t *table_1 = t1;
-    const ecs_matched_table_t *table_2 = t2;
+    /* Removes const modifier, but logic prevents changing / delete string */
+    ecs_strbuf_init(b);
+    ecs_strbuf_grow_str(b, (char*)str, NULL, 0);
+    return true;
+}
 
-    return table_1->rank - table_2->rank;
+bool ecs_strbuf_appendstr(
+    ecs_strbuf_t *b,
+    const char* str)
+{
+    return ecs_strbuf_append_intern(
+        b, str, -1
+    );
 }
 
-static
-void order_ranked_tables(
-    ecs_world_t *world,
-    ecs_query_t *query)
+bool ecs_strbuf_mergebuff(
+    ecs_strbuf_t *dst_buffer,
+    ecs_strbuf_t *src_buffer)
 {
-    if (query->group_table) {
-        ecs_vector_sort(query->tables, ecs_matched_table_t, table_compare);       
-    }
+    if (src_buffer->elementCount) {
+        if (src_buffer->buf) {
+            return ecs_strbuf_appendstr(dst_buffer, src_buffer->buf);
+        } else {
+            ecs_strbuf_element *e = (ecs_strbuf_element*)&src_buffer->firstElement;
 
-    /* Re-register monitors after tables have been reordered. This will update
-     * the table administration with the new matched_table ids, so that when a
-     * monitor is executed we can quickly find the right matched_table. */
-    if (query->flags & EcsQueryMonitor) {
-        ecs_vector_each(query->tables, ecs_matched_table_t, table, {
-            ecs_table_notify(world, table->data.table, &(ecs_table_event_t){
-                .kind = EcsTableQueryMatch,
-                .query = query,
-                .matched_table_index = table_i
-            });
-        });
+            /* Copy first element as it is inlined in the src buffer */
+            ecs_strbuf_appendstrn(dst_buffer, e->buf, e->pos);
+
+            while ((e = e->next)) {
+                dst_buffer->current->next = ecs_os_malloc(sizeof(ecs_strbuf_element));
+                *dst_buffer->current->next = *e;
+            }
+        }
+
+        *src_buffer = ECS_STRBUF_INIT;
     }
 
-    query->match_count ++; 
+    return true;
 }
 
-static
-void group_table(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_matched_table_t *table)
-{
-    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+char* ecs_strbuf_get(ecs_strbuf_t *b) {
+    char* result = NULL;
 
-    if (query->group_table) {
-        ecs_assert(table->data.table != NULL, ECS_INTERNAL_ERROR, NULL);
-        table->rank = query->group_table(
-            world, query->rank_on_component, table->data.table->type);
+    if (b->elementCount) {
+        if (b->buf) {
+            b->buf[b->current->pos] = '\0';
+            result = ecs_os_strdup(b->buf);
+        } else {
+            void *next = NULL;
+            int32_t len = b->size + b->current->pos + 1;
+
+            ecs_strbuf_element *e = (ecs_strbuf_element*)&b->firstElement;
+
+            result = ecs_os_malloc(len);
+            char* ptr = result;
+
+            do {
+                ecs_os_memcpy(ptr, e->buf, e->pos);
+                ptr += e->pos;
+                next = e->next;
+                if (e != &b->firstElement.super) {
+                    if (!e->buffer_embedded) {
+                        ecs_os_free(((ecs_strbuf_element_str*)e)->alloc_str);
+                    }
+                    ecs_os_free(e);
+                }
+            } while ((e = next));
+
+            result[len - 1] = '\0';
+        }
     } else {
-        table->rank = 0;
+        result = NULL;
     }
+
+    b->elementCount = 0;
+
+    return result;
 }
 
-/* Rank all tables of query. Only necessary if a new ranking function was
- * provided or if a monitored entity set the component used for ranking. */
-static
-void group_tables(
-    ecs_world_t *world,
-    ecs_query_t *query)
+void ecs_strbuf_reset(ecs_strbuf_t *b) {
+    if (b->elementCount && !b->buf) {
+        void *next = NULL;
+        ecs_strbuf_element *e = (ecs_strbuf_element*)&b->firstElement;
+        do {
+            next = e->next;
+            if (e != (ecs_strbuf_element*)&b->firstElement) {
+                ecs_os_free(e);
+            }
+        } while ((e = next));
+    }
+
+    *b = ECS_STRBUF_INIT;
+}
+
+void ecs_strbuf_list_push(
+    ecs_strbuf_t *buffer,
+    const char *list_open,
+    const char *separator)
 {
-    if (query->group_table) {
-        ecs_vector_each(query->tables, ecs_matched_table_t, table, {
-            group_table(world, query, table);
-        });
+    buffer->list_sp ++;
+    buffer->list_stack[buffer->list_sp].count = 0;
+    buffer->list_stack[buffer->list_sp].separator = separator;
 
-        ecs_vector_each(query->empty_tables, ecs_matched_table_t, table, {
-            group_table(world, query, table);
-        });              
+    if (list_open) {
+        ecs_strbuf_appendstr(buffer, list_open);
     }
 }
 
-static
-bool has_auto_activation(
-    ecs_query_t *q)
+void ecs_strbuf_list_pop(
+    ecs_strbuf_t *buffer,
+    const char *list_close)
 {
-    /* Only a basic query with no additional features does table activation */
-    return !(q->flags & EcsQueryNoActivation);
+    buffer->list_sp --;
+    
+    if (list_close) {
+        ecs_strbuf_appendstr(buffer, list_close);
+    }
 }
 
-#ifndef NDEBUG
-
-static
-const char* query_name(
-    ecs_world_t *world,
-    ecs_query_t *q)
+void ecs_strbuf_list_next(
+    ecs_strbuf_t *buffer)
 {
-    if (q->system) {
-        return ecs_get_name(world, q->system);
-    } else {
-        return q->sig.expr;
+    int32_t list_sp = buffer->list_sp;
+    if (buffer->list_stack[list_sp].count != 0) {
+        ecs_strbuf_appendstr(buffer, buffer->list_stack[list_sp].separator);
     }
+    buffer->list_stack[list_sp].count ++;
 }
 
-#endif
-
-static
-void get_comp_and_src(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_type_t table_type,
-    ecs_sig_column_t *column,
-    ecs_sig_oper_kind_t op,
-    ecs_sig_from_kind_t from,
-    ecs_entity_t *component_out,
-    ecs_entity_t *entity_out)
+bool ecs_strbuf_list_append(
+    ecs_strbuf_t *buffer,
+    const char *fmt,
+    ...)
 {
-    ecs_entity_t component = 0, entity = 0;
+    ecs_strbuf_list_next(buffer);
 
-    if (op == EcsOperNot) {
-        entity = column->source;
-    }
+    va_list args;
+    va_start(args, fmt);
+    bool result = ecs_strbuf_vappend_intern(
+        buffer, fmt, args
+    );
+    va_end(args);
 
-    /* Column that retrieves data from self or a fixed entity */
-    if (from == EcsFromAny || from == EcsFromEntity || 
-        from == EcsFromOwned || from == EcsFromShared) 
-    {
-        if (op == EcsOperAnd || op == EcsOperNot || op == EcsOperOptional) {
-            component = column->is.component;
-        } else if (op == EcsOperAll) {
-            component = column->is.component & ECS_COMPONENT_MASK;
-        } else if (op == EcsOperOr) {
-            component = ecs_type_contains(
-                world, table_type, column->is.type, 
-                false, true);
-        }
+    return result;
+}
 
-        if (from == EcsFromEntity) {
-            entity = column->source;
-        }
+bool ecs_strbuf_list_appendstr(
+    ecs_strbuf_t *buffer,
+    const char *str)
+{
+    ecs_strbuf_list_next(buffer);
+    return ecs_strbuf_appendstr(buffer, str);
+}
 
-    /* Column that just passes a handle to the system (no data) */
-    } else if (from == EcsFromEmpty) {
-        component = column->is.component;
+#define ECS_ANNOTATION_LENGTH_MAX (16)
 
-    /* Column that retrieves data from a dynamic entity */
-    } else if (from == EcsFromParent || from == EcsCascade) {
-        if (op == EcsOperAnd ||
-            op == EcsOperOptional)
-        {
-            component = column->is.component;
-            entity = ecs_find_in_type(
-                world, table_type, component, ECS_CHILDOF);
+#define TOK_SOURCE ':'
+#define TOK_AND ','
+#define TOK_OR "||"
+#define TOK_NOT '!'
+#define TOK_OPTIONAL '?'
+#define TOK_ROLE '|'
+#define TOK_TRAIT '>'
+#define TOK_FOR "FOR"
+#define TOK_NAME_SEP '.'
+#define TOK_ANNOTATE_OPEN '['
+#define TOK_ANNOTATE_CLOSE ']'
+#define TOK_WILDCARD '*'
+#define TOK_SINGLETON '$'
 
-        } else if (op == EcsOperOr) {
-            component = components_contains(
-                world,
-                table_type,
-                column->is.type,
-                &entity,
-                false);
-        }
+#define TOK_ANY "ANY"
+#define TOK_OWNED "OWNED"
+#define TOK_SHARED "SHARED"
+#define TOK_SYSTEM "SYSTEM"
+#define TOK_PARENT "PARENT"
+#define TOK_CASCADE "CASCADE"
 
-    /* Column that retrieves data from a system */
-    } else if (from == EcsFromSystem) {
-        if (op == EcsOperAnd) {
-            component = column->is.component;
-        }
+#define TOK_ROLE_CHILDOF "CHILDOF"
+#define TOK_ROLE_INSTANCEOF "INSTANCEOF"
+#define TOK_ROLE_TRAIT "TRAIT"
+#define TOK_ROLE_AND "AND"
+#define TOK_ROLE_OR "OR"
+#define TOK_ROLE_XOR "XOR"
+#define TOK_ROLE_NOT "NOT"
+#define TOK_ROLE_SWITCH "SWITCH"
+#define TOK_ROLE_CASE "CASE"
+#define TOK_ROLE_DISABLED "DISABLED"
 
-        entity = query->system;
-    }
+#define TOK_IN "in"
+#define TOK_OUT "out"
+#define TOK_INOUT "inout"
 
-    *component_out = component;
-    *entity_out = entity;
-}
+#define ECS_MAX_TOKEN_SIZE (256)
 
-typedef struct trait_offset_t {
-    int32_t index;
-    int32_t count;
-} trait_offset_t;
+typedef char ecs_token_t[ECS_MAX_TOKEN_SIZE];
 
-/* Get index for specified trait. Take into account that a trait can be matched
- * multiple times per table, by keeping an offset of the last found index */
+/** Skip spaces when parsing signature */
 static
-int32_t get_trait_index(
-    ecs_type_t table_type,
-    ecs_entity_t component,
-    int32_t column_index,
-    trait_offset_t *trait_offsets,
-    int32_t count)
+const char *skip_space(
+    const char *ptr)
 {
-    int32_t result;
-
-    /* The count variable keeps track of the number of times a trait has been
-     * matched with the current table. Compare the count to check if the index
-     * was already resolved for this iteration */
-    if (trait_offsets[column_index].count == count) {
-        /* If it was resolved, return the last stored index. Subtract one as the
-         * index is offset by one, to ensure we're not getting stuck on the same
-         * index. */
-        result = trait_offsets[column_index].index - 1;
-    } else {
-        /* First time for this iteration that the trait index is resolved, look
-         * it up in the type. */
-        result = ecs_type_trait_index_of(table_type, 
-            trait_offsets[column_index].index, component);
-        trait_offsets[column_index].index = result + 1;
-        trait_offsets[column_index].count = count;
+    while (isspace(*ptr)) {
+        ptr ++;
     }
-    
-    return result;
+    return ptr;
 }
 
-static
-int32_t get_component_index(
-    ecs_world_t *world,
-    ecs_table_t *table,
-    ecs_type_t table_type,
-    ecs_entity_t *component_out,
-    int32_t column_index,
-    ecs_sig_oper_kind_t op,
-    trait_offset_t *trait_offsets,
-    int32_t count)
+int entity_compare(
+    const void *ptr1,
+    const void *ptr2)
 {
-    int32_t result = 0;
-    ecs_entity_t component = *component_out;
+    ecs_entity_t e1 = *(ecs_entity_t*)ptr1;
+    ecs_entity_t e2 = *(ecs_entity_t*)ptr2;
+    return (e1 > e2) - (e1 < e2);
+}
 
-    if (component) {
-        /* If requested component is a case, find the corresponding switch to
-         * lookup in the table */
-        if (ECS_HAS_ROLE(component, CASE)) {
-            result = ecs_table_switch_from_case(
-                world, table, component);
-            ecs_assert(result != -1, ECS_INTERNAL_ERROR, NULL);
+static
+void vec_add_entity(
+    ecs_vector_t **vec,
+    ecs_entity_t entity)
+{
+    ecs_entity_t *e = ecs_vector_add(vec, ecs_entity_t);
+    *e = entity;
 
-            result += table->sw_column_offset;
-        } else
-        if (ECS_HAS_ROLE(component, TRAIT)) { 
-            /* If only the lo part of the trait identifier is set, interpret it
-             * as the trait to match. This will match any instance of the trait
-             * on the entity and in a signature looks like "TRAIT | MyTrait". */
-            if (!ecs_entity_t_hi(component & ECS_COMPONENT_MASK)) {
-                ecs_assert(trait_offsets != NULL, 
-                    ECS_INTERNAL_ERROR, NULL);
+    /* Keep array sorted so that we can use it in type compare operations */
+    ecs_vector_sort(*vec, ecs_entity_t, entity_compare);
+}
 
-                /* Strip the TRAIT role */
-                component &= ECS_COMPONENT_MASK;
 
-                /* Get index of trait. Start looking from the last trait index
-                 * as this may not be the first instance of the trait. */
-                result = get_trait_index(
-                    table_type, component, column_index, trait_offsets, count);
-                
-                if (result != -1) {
-                    /* If component of current column is a trait, get the actual 
-                     * trait type for the table, so the system can see which 
-                     * component the trait was applied to */   
-                    ecs_entity_t *trait = ecs_vector_get(
-                        table_type, ecs_entity_t, result);
-                    *component_out = *trait;
+/* -- Private functions -- */
 
-                    /* Check if the trait is a tag or whether it has data */
-                    if (ecs_get(world, component, EcsComponent) == NULL) {
-                        /* If trait has no data associated with it, use the
-                         * component to which the trait has been added */
-                        component = ecs_entity_t_lo(*trait);
-                    }
-                }
-            } else {
-                /* If trait does have the hi part of the identifier set, this is
-                 * a fully qualified trait identifier. In a signature this looks
-                 * like "TRAIT | MyTrait > Comp". */
-                ecs_entity_t lo = ecs_entity_t_lo(component);
-                if (lo == EcsWildcard) {
-                    ecs_assert(trait_offsets != NULL, 
-                        ECS_INTERNAL_ERROR, NULL);
+static
+bool valid_identifier_char(
+    char ch)
+{
+    if (ch && (isalpha(ch) || isdigit(ch) || ch == '_' || ch == '.' || 
+        ch == TOK_SINGLETON || ch == TOK_WILDCARD)) 
+    {
+        return true;
+    }
 
-                    /* Get id for the trait to lookup by taking the trait from
-                     * the high 32 bits, move it to the low 32 bits, and reapply
-                     * the TRAIT mask. */
-                    component = ecs_entity_t_hi(component & ECS_COMPONENT_MASK);
+    return false;
+}
 
-                    /* If the low part of the identifier is the wildcard entity,
-                     * this column is requesting the component to which the 
-                     * trait is applied. First, find the component identifier */
-                    result = get_trait_index(table_type, component, 
-                        column_index, trait_offsets, count);
+static
+bool valid_operator_char(
+    char ch)
+{
+    if (ch == TOK_OPTIONAL || ch == TOK_NOT) {
+        return true;
+    }
 
-                    /* Type must have the trait, otherwise table would not have
-                     * matched */
-                    ecs_assert(result != -1, ECS_INTERNAL_ERROR, NULL);
+    return false;
+}
 
-                    /* Get component id at returned index */
-                    ecs_entity_t *trait = ecs_vector_get(
-                        table_type, ecs_entity_t, result);
-                    ecs_assert(trait != NULL, ECS_INTERNAL_ERROR, NULL);
+static
+const char* parse_identifier(
+    const char *name,
+    const char *sig,
+    int64_t column,
+    const char *ptr,
+    char *token_out)
+{
+    ptr = skip_space(ptr);
 
-                    /* Get the lower part of the trait id. This is the component
-                     * we're looking for. */
-                    component = ecs_entity_t_lo(*trait);
-                    *component_out = component;
+    char *tptr = token_out, ch = ptr[0];
 
-                    /* Now lookup the component as usual */
-                }
+    if (!valid_identifier_char(ch)) {
+        ecs_parser_error(name, sig, column, "invalid identifier", ptr);
+        return NULL;
+    }
 
-                /* If the low part is a regular entity (component), then
-                 * this query exactly matches a single trait instance. In
-                 * this case we can simply do a lookup of the trait 
-                 * identifier in the table type. */
-                result = ecs_type_index_of(table_type, component);
-            }
-        } else {
-            /* Get column index for component */
-            result = ecs_type_index_of(table_type, component);
+    for (; (ch = *ptr); ptr ++) {
+        if (!valid_identifier_char(ch)) {
+            break;
         }
 
-        /* If column is found, add one to the index, as column zero in
-        * a table is reserved for entity id's */
-        if (result != -1) {
-            result ++;
-        }
+        tptr[0] = ch;
+        tptr ++;
+    }
 
-        /* Check if component is a tag. If it is, set table_data to
-        * zero, so that a system won't try to access the data */
-        if (!ECS_HAS_ROLE(component, CASE) && 
-            !ECS_HAS_ROLE(component, SWITCH)) 
-        {
-            component = ecs_component_id_from_id(world, component);
-            const EcsComponent *data = ecs_get(
-                world, component, EcsComponent);
+    tptr[0] = '\0';
 
-            if (!data || !data->size) {
-                result = 0;
-            }
-        }        
+    return skip_space(ptr);
+}
 
-        /* ecs_table_column_offset may return -1 if the component comes
-         * from a prefab. If so, the component will be resolved as a
-         * reference (see below) */           
+static
+ecs_entity_t parse_role(
+    const char *name,
+    const char *sig,
+    int64_t column,
+    const char *token)
+{
+    if        (!ecs_os_strcmp(token, TOK_ROLE_CHILDOF)) {
+        return ECS_CHILDOF;
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_INSTANCEOF)) {
+        return ECS_INSTANCEOF;
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_TRAIT)) {
+        return ECS_TRAIT;            
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_AND)) {
+        return ECS_AND;
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_OR)) {
+        return ECS_OR;
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_XOR)) {
+        return ECS_XOR;
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_NOT)) {
+        return ECS_NOT;
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_SWITCH)) {
+        return ECS_SWITCH;
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_CASE)) {
+        return ECS_CASE;
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_DISABLED)) {
+        return ECS_DISABLED;
+    } else if (!ecs_os_strcmp(token, TOK_OWNED)) {
+        return ECS_OWNED;
+    } else {
+        ecs_parser_error(name, sig, column, "invalid role '%s'", token);
+        return 0;
     }
+}
 
-    if (op == EcsOperAll) {
-        result = 0;
-    } else if (op == EcsOperOptional) {
-        /* If table doesn't have the field, mark it as no data */
-        if (!ecs_type_has_entity(world, table_type, component)) {
-            result = 0;
-        }
+static
+ecs_sig_from_kind_t parse_source(
+    const char *token)
+{
+    if        (!ecs_os_strcmp(token, TOK_PARENT)) {
+        return EcsFromParent;
+    } else if (!ecs_os_strcmp(token, TOK_SYSTEM)) {
+        return EcsFromSystem;
+    } else if (!ecs_os_strcmp(token, TOK_ANY)) {
+        return EcsFromAny;
+    } else if (!ecs_os_strcmp(token, TOK_OWNED)) {
+        return EcsFromOwned;
+    } else if (!ecs_os_strcmp(token, TOK_SHARED)) {
+        return EcsFromShared;
+    } else if (!ecs_os_strcmp(token, TOK_CASCADE)) {
+        return EcsCascade;  
+    } else {
+        return EcsFromEntity;
     }
+} 
 
-    return result;
+static
+ecs_sig_oper_kind_t parse_operator(
+    char ch)
+{
+    if (ch == TOK_OPTIONAL) {
+        return EcsOperOptional;
+    } else if (ch == TOK_NOT) {
+        return EcsOperNot;
+    } else {
+        ecs_abort(ECS_INTERNAL_ERROR, NULL);
+    }
 }
 
 static
-ecs_vector_t* add_ref(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_type_t table_type,
-    ecs_vector_t *references,
-    ecs_entity_t component,
-    ecs_entity_t entity,
-    ecs_sig_from_kind_t from)
+const char* parse_annotation(
+    const char *name,
+    const char *sig,
+    int64_t column,
+    const char *ptr, 
+    ecs_sig_inout_kind_t *inout_kind_out)
 {
-    const EcsComponent *c_info = ecs_get(world, component, EcsComponent);
-    
-    ecs_entity_t e;
-    ecs_ref_t *ref = ecs_vector_add(&references, ecs_ref_t);
+    char token[ECS_MAX_TOKEN_SIZE];
 
-    /* Find the entity for the component */
-    if (from == EcsFromEntity || from == EcsFromEmpty) {
-        e = entity;
-    } else if (from == EcsCascade) {
-        e = entity;
-    } else if (from == EcsFromSystem) {
-        e = entity;
-    } else {
-        e = get_entity_for_component(
-            world, entity, table_type, component);
+    ptr = parse_identifier(name, sig, column, ptr, token);
+    if (!ptr) {
+        return NULL;
     }
 
-    if (from != EcsCascade) {
-        ecs_assert(e != 0, ECS_INTERNAL_ERROR, NULL);
+    if (!strcmp(token, "in")) {
+        *inout_kind_out = EcsIn;
+    } else
+    if (!strcmp(token, "out")) {
+        *inout_kind_out = EcsOut;
+    } else
+    if (!strcmp(token, "inout")) {
+        *inout_kind_out = EcsInOut;
+    } else
+    if (!strcmp(token, "prev")) {
+        *inout_kind_out = EcsInPrev;
     }
-    
-    *ref = (ecs_ref_t){0};
-    ref->entity = e;
-    ref->component = component;
 
-    if (ecs_has(world, component, EcsComponent)) {
-        if (c_info->size && from != EcsFromEmpty) {
-            if (e) {
-                ecs_get_ref_w_entity(
-                    world, ref, e, component);
-                ecs_set_watch(world, e);                     
-            }
+    ptr = skip_space(ptr);
 
-            query->flags |= EcsQueryHasRefs;
-        }
+    if (ptr[0] != TOK_ANNOTATE_CLOSE) {
+        ecs_parser_error(name, sig, column, "expected ]");
+        return NULL;
     }
 
-    return references;
+    return ptr + 1;
 }
 
-static
-ecs_entity_t is_column_trait(
-    ecs_sig_column_t *column)
+typedef struct sig_element_t {
+    ecs_entity_t role;
+    ecs_sig_inout_kind_t inout_kind;
+    ecs_sig_from_kind_t from_kind;
+    ecs_sig_oper_kind_t oper_kind;
+    char *trait;
+    char *source;
+    char *component;
+    char *name;
+} sig_element_t;
+
+const char* parse_element(
+    const char *name,
+    const char *sig,
+    sig_element_t *elem_out)
 {
-    ecs_sig_from_kind_t from_kind = column->from_kind;
-    ecs_sig_oper_kind_t oper_kind = column->oper_kind;
+    bool explicit_inout = false;
+    const char *ptr = sig;
+    char token[ECS_MAX_TOKEN_SIZE] = {0};
+    sig_element_t elem = {
+        .inout_kind = EcsInOut,
+        .from_kind = EcsFromOwned,
+        .oper_kind = EcsOperAnd
+    };
 
-    /* For now traits are only supported on owned columns */
-    if (from_kind == EcsFromOwned && oper_kind == EcsOperAnd) {
-        ecs_entity_t c = column->is.component;
-        if (ECS_HAS_ROLE(c, TRAIT)) {
-            if (!(ecs_entity_t_hi(c & ECS_COMPONENT_MASK))) {
-                return c;
-            } else
-            if (ecs_entity_t_lo(c) == EcsWildcard) {
-                return ecs_entity_t_hi(c & ECS_COMPONENT_MASK);
-            }
+    ptr = skip_space(ptr);
+
+    /* Inout specifiers always come first */
+    if (ptr[0] == TOK_ANNOTATE_OPEN) {
+        explicit_inout = true;
+        ptr = parse_annotation(name, sig, (ptr - sig), ptr + 1, &elem.inout_kind);
+        if (!ptr) {
+            return NULL;
         }
+        ptr = skip_space(ptr);
     }
 
-    return 0;
-}
+    if (valid_operator_char(ptr[0])) {
+        elem.oper_kind = parse_operator(ptr[0]);
+        ptr = skip_space(ptr + 1);
+    }
 
-static
-int32_t type_trait_count(
-    ecs_type_t type,
-    ecs_entity_t trait)
-{
-    int32_t i, count = ecs_vector_count(type);
-    ecs_entity_t *entities = ecs_vector_first(type, ecs_entity_t);
-    int32_t result = 0;
+    /* If next token is the start of an identifier, it could be either a type
+     * role, source or component identifier */
+    if (valid_identifier_char(ptr[0])) {
+        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
+        if (!ptr) {
+            return NULL;
+        }
+        
+        /* Is token a source identifier? */
+        if (ptr[0] == TOK_SOURCE) {
+            ptr ++;
+            goto parse_source;
+        }
 
-    trait &= ECS_COMPONENT_MASK;
+        /* Is token a type role? */
+        if (ptr[0] == TOK_ROLE && ptr[1] != TOK_ROLE) {
+            ptr ++;
+            goto parse_role;
+        }
 
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t e = entities[i];
-        if (ECS_HAS_ROLE(e, TRAIT)) {
-            e &= ECS_COMPONENT_MASK;
-            if (ecs_entity_t_hi(e) == trait) {
-                result ++;
-            }
+        /* Is token a trait? (using shorthand notation) */
+        if (!ecs_os_strncmp(ptr, TOK_FOR, 3)) {
+            elem.role = ECS_TRAIT;
+            ptr += 3;
+            goto parse_trait;
         }
-    }
 
-    return result;
-}
+        /* If it is neither, the next token must be a component */
+        goto parse_component;
 
-/* For each trait that the query subscribes for, count the occurrences in the
- * table. Cardinality of subscribed for traits must be the same as in the table
- * or else the table won't match. */
-static
-int32_t count_traits(
-    ecs_query_t *query,
-    ecs_type_t type)
-{
-    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
-    int32_t i, count = ecs_vector_count(query->sig.columns);
-    int32_t first_count = 0, trait_count = 0;
+    /* If next token is the source token, this is an empty source */
+    } else if (ptr[0] == TOK_SOURCE) {
+        goto empty_source;
 
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t trait = is_column_trait(&columns[i]);
-        if (trait) {
-            trait_count = type_trait_count(type, trait);
-            if (!first_count) {
-                first_count = trait_count;
-            } else {
-                if (first_count != trait_count) {
-                    /* The traits that this query subscribed for occur in the
-                     * table but don't have the same cardinality. Ignore the
-                     * table. This could typically happen for empty tables along
-                     * a path in the table graph. */
-                    return -1;
-                }
-            }
-        }
+    /* Nothing else expected here */
+    } else {
+        ecs_parser_error(name, sig, (ptr - sig), 
+            "unexpected character '%c'", ptr[0]);
+        return NULL;
     }
 
-    return first_count;
-}
+empty_source:
+    elem.from_kind = EcsFromEmpty;
+    ptr = skip_space(ptr + 1);
+    if (valid_identifier_char(ptr[0])) {
+        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
+        if (!ptr) {
+            return NULL;
+        }
 
-static
-ecs_type_t get_column_type(
-    ecs_world_t *world,
-    ecs_sig_oper_kind_t oper_kind,
-    ecs_entity_t component)
-{
-    if (oper_kind == EcsOperAll) {
-        const EcsType *type = ecs_get(world, component, EcsType);
-        ecs_assert(type != NULL, ECS_INVALID_PARAMETER, NULL);
-        return type->normalized;
+        goto parse_component;
     } else {
-        return ecs_type_from_entity(world, component);
-    }    
-}
-
-/** Add table to system, compute offsets for system components in table it */
-static
-void add_table(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_table_t *table)
-{
-    ecs_type_t table_type = NULL;
-    int32_t c, column_count = ecs_vector_count(query->sig.columns);
-
-    if (table) {
-        table_type = table->type;
-    }
-
-    int32_t trait_cur = 0, trait_count = count_traits(query, table_type);
-    
-    /* If the query has traits, we need to account for the fact that a table may
-     * have multiple components to which the trait is applied, which means the
-     * table has to be registered with the query multiple times, with different
-     * table columns. If so, allocate a small array for each trait in which the
-     * last added table index of the trait is stored, so that in the next 
-     * iteration we can start the search from the correct offset type. */
-    trait_offset_t *trait_offsets = NULL;
-    if (trait_count) {
-        trait_offsets = ecs_os_calloc(
-            ECS_SIZEOF(trait_offset_t) * column_count);
+        ecs_parser_error(name, sig, (ptr - sig), 
+            "expected identifier after source operator");
+        return NULL;
     }
 
-    /* From here we recurse */
-    int32_t matched_table_index = 0;
-    ecs_matched_table_t table_data;
-    ecs_vector_t *references = NULL;
-
-add_trait:
-    table_data = (ecs_matched_table_t){ .data.table = table };
-    if (table) {
-        table_type = table->type;
+parse_source:
+    elem.from_kind = parse_source(token);
+    if (elem.from_kind == EcsFromEntity) {
+        elem.source = ecs_os_strdup(token);
     }
 
-    /* If grouping is enabled for query, assign the group rank to the table */
-    group_table(world, query, &table_data);
+    ptr = skip_space(ptr);
+    if (valid_identifier_char(ptr[0])) {
+        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
+        if (!ptr) {
+            return NULL;
+        }
 
-    if (column_count) {
-        /* Array that contains the system column to table column mapping */
-        table_data.data.columns = ecs_os_malloc(ECS_SIZEOF(int32_t) * column_count);
-        ecs_assert(table_data.data.columns != NULL, ECS_OUT_OF_MEMORY, NULL);
+        /* Is the next token a role? */
+        if (ptr[0] == TOK_ROLE && ptr[1] != TOK_ROLE) {
+            ptr++;
+            goto parse_role;
+        }
 
-        /* Store the components of the matched table. In the case of OR expressions,
-        * components may differ per matched table. */
-        table_data.data.components = ecs_os_malloc(ECS_SIZEOF(ecs_entity_t) * column_count);
-        ecs_assert(table_data.data.components != NULL, ECS_OUT_OF_MEMORY, NULL);
+        /* Is token a trait? (using shorthand notation) */
+        if (!ecs_os_strncmp(ptr, TOK_FOR, 3)) {
+            elem.role = ECS_TRAIT;
+            ptr += 3;
+            goto parse_trait;
+        }        
 
-        /* Also cache types, so no lookup is needed while iterating */
-        table_data.data.types = ecs_os_malloc(ECS_SIZEOF(ecs_type_t) * column_count);
-        ecs_assert(table_data.data.types != NULL, ECS_OUT_OF_MEMORY, NULL);        
+        /* If not, it's a component */
+        goto parse_component;
+    } else {
+        ecs_parser_error(name, sig, (ptr - sig), 
+            "expected identifier after source");
+        return NULL;
     }
 
-    /* Walk columns parsed from the system signature */
-    ecs_sig_column_t *columns = ecs_vector_first(
-        query->sig.columns, ecs_sig_column_t);
+parse_role:
+    elem.role = parse_role(name, sig, (ptr - sig), token);
+    if (!elem.role) {
+        return NULL;
+    }
 
-    for (c = 0; c < column_count; c ++) {
-        ecs_sig_column_t *column = &columns[c];
-        ecs_entity_t entity = 0, component = 0;
-        ecs_sig_oper_kind_t op = column->oper_kind;
-        ecs_sig_from_kind_t from = column->from_kind;
+    ptr = skip_space(ptr);
 
-        if (op == EcsOperNot) {
-            from = EcsFromEmpty;
+    /* If next token is the source token, this is an empty source */
+    if (valid_identifier_char(ptr[0])) {
+        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
+        if (!ptr) {
+            return NULL;
         }
 
-        table_data.data.columns[c] = 0;
-
-        /* Get actual component and component source for current column */
-        get_comp_and_src(world, query, table_type, column, op, from, &component, 
-            &entity);
-
-        /* This column does not retrieve data from a static entity (either
-         * EcsFromSystem or EcsFromParent) and is not just a handle */
-        if (!entity && from != EcsFromEmpty) {
-            int32_t index = get_component_index(world, table, table_type, 
-                &component, c, op, trait_offsets, trait_cur + 1);
+        /* Is token a trait? */
+        if (ptr[0] == TOK_TRAIT) {
+            ptr ++;
+            goto parse_trait;
+        }
 
-            if (index == -1) {
-                if (from == EcsFromOwned && op == EcsOperOptional) {
-                    index = 0;
-                }
-            } else {
-                if (from == EcsFromShared && op == EcsOperOptional) {
-                    index = 0;
-                }
-            }
-            
-            table_data.data.columns[c] = index;
+        /* If not, it's a component */
+        goto parse_component;
+    } else {
+        ecs_parser_error(name, sig, (ptr - sig), 
+            "expected identifier after role");
+        return NULL;
+    }
 
-            /* If the column is a case, we should only iterate the entities in
-             * the column for this specific case. Add a sparse column with the
-             * case id so we can find the correct entities when iterating */
-            if (ECS_HAS_ROLE(component, CASE)) {
-                ecs_sparse_column_t *sc = ecs_vector_add(
-                    &table_data.sparse_columns, ecs_sparse_column_t);
-                sc->signature_column_index = c;
-                sc->sw_case = component & ECS_COMPONENT_MASK;
-                sc->sw_column = NULL;
-            }
-        }
+parse_trait:
+    elem.trait = ecs_os_strdup(token);
 
-        /* Check if a the component is a reference. If 'entity' is set, the
-         * component must be resolved from another entity, which is the case
-         * for FromEntity and FromContainer. 
-         * 
-         * If no entity is set but the component is not found in the table, it
-         * must come from a prefab. This is guaranteed, as at this point it is
-         * already validated that the table matches with the system.
-         * 
-         * If the column from is Cascade, there may not be an entity in case the
-         * current table contains root entities. In that case, still add a
-         * reference field. The application can, after the table has matched,
-         * change the set of components, so that this column will turn into a
-         * reference. Having the reference already linked to the system table
-         * makes changing this administation easier when the change happens.
-         */
-        if ((entity || table_data.data.columns[c] == -1 || from == EcsCascade)) {
-            references = add_ref(world, query, table_type, references, 
-                component, entity, from);
-            table_data.data.columns[c] = -ecs_vector_count(references);
+    ptr = skip_space(ptr);
+    if (valid_identifier_char(ptr[0])) {
+        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
+        if (!ptr) {
+            return NULL;
         }
 
-        table_data.data.components[c] = component;
-        table_data.data.types[c] = get_column_type(world, op, component);
+        /* Can only be a component */
+        goto parse_component;
+    } else {
+        ecs_parser_error(name, sig, (ptr - sig), 
+            "expected identifier after trait");
+        return NULL;
     }
 
-    /* Initially always add table to inactive group. If the system is registered
-     * with the table and the table is not empty, the table will send an
-     * activate signal to the system. */
+parse_component:
+    elem.component = ecs_os_strdup(token);
 
-    ecs_matched_table_t *table_elem;
-    if (table && has_auto_activation(query)) {
-        table_elem = ecs_vector_add(&query->empty_tables, 
-            ecs_matched_table_t);
+    ptr = skip_space(ptr);
+    if (valid_identifier_char(ptr[0])) {
+        ptr = parse_identifier(name, sig, (ptr - sig), ptr, token);
+        if (!ptr) {
+            return NULL;
+        }
 
-        #ifndef NDEBUG
-        char *type_expr = ecs_type_str(world, table->type);
-        ecs_trace_2("query #[green]%s#[reset] matched with table #[green][%s]",
-            query_name(world, query), type_expr);
-        ecs_os_free(type_expr);
-        #endif
+        /* Can only be a name */
+        goto parse_name;
     } else {
-        /* If no table is provided to function, this is a system that contains
-         * no columns that require table matching. In this case, the system will
-         * only have one "dummy" table that caches data from the system columns.
-         * Always add this dummy table to the list of active tables, since it
-         * would never get activated otherwise. */
-        table_elem = ecs_vector_add(&query->tables, ecs_matched_table_t);
-
-        /* If query doesn't automatically activates/inactivates tables, we can 
-         * get the count to determine the current table index. */
-        matched_table_index = ecs_vector_count(query->tables) - 1;
-        ecs_assert(matched_table_index >= 0, ECS_INTERNAL_ERROR, NULL);
+        /* If nothing else, parsing of this element is done */
+        goto parse_done;
     }
 
-    if (references) {
-        ecs_size_t ref_size = ECS_SIZEOF(ecs_ref_t) * ecs_vector_count(references);
-        table_data.data.references = ecs_os_malloc(ref_size);
-        ecs_os_memcpy(table_data.data.references, 
-            ecs_vector_first(references, ecs_ref_t), ref_size);
-        ecs_vector_free(references);
-        references = NULL;
+parse_name:
+    elem.name = ecs_os_strdup(token);
+    ptr = skip_space(ptr);
+
+parse_done:
+    if (ptr[0] != TOK_AND && ecs_os_strncmp(ptr, TOK_OR, 2) && ptr[0]) {
+        ecs_parser_error(name, sig, (ptr - sig), 
+            "expected end of expression or next element");
+        return NULL;
     }
 
-    *table_elem = table_data;
+    if (!ecs_os_strcmp(elem.component, "0")) {
+        if (ptr[0]) {
+            ecs_parser_error(name, sig, (ptr - sig), 
+                "unexpected element after 0"); 
+            return NULL;
+        }
 
-    /* Use tail recursion when adding table for multiple traits */
-    trait_cur ++;
-    if (trait_cur < trait_count) {
-        goto add_trait;
+        if (elem.from_kind != EcsFromOwned) {
+            ecs_parser_error(name, sig, (ptr - sig), 
+                "invalid source modifier for 0"); 
+            return NULL;
+        }
     }
 
-    if (table && !(query->flags & EcsQueryIsSubquery)) {
-        ecs_table_notify(world, table, &(ecs_table_event_t){
-            .kind = EcsTableQueryMatch,
-            .query = query,
-            .matched_table_index = matched_table_index
-        });
-    } else if (table && ecs_table_count(table)) {
-        activate_table(world, query, table, true);
+    /* Only owned components have a buffer with previous values */
+    if (elem.inout_kind == EcsInPrev) {
+        if (elem.from_kind != EcsFromOwned || elem.oper_kind == EcsOperNot) {
+            ecs_parser_error(name, sig, (ptr - sig), 
+                "invalid source modifier for [prev]"); 
+            return NULL;
+        }
     }
 
-    if (trait_offsets) {
-        ecs_os_free(trait_offsets);
+    if (!explicit_inout) {
+        if (elem.from_kind != EcsFromOwned) {
+            elem.inout_kind = EcsIn;
+        }
     }
+
+    *elem_out = elem;
+
+    return ptr;
 }
 
-static
-bool match_column(
+int ecs_parse_expr(
     ecs_world_t *world,
-    ecs_type_t type,
-    ecs_sig_from_kind_t from_kind,
-    ecs_entity_t component,
-    ecs_entity_t source,
-    ecs_match_failure_t *failure_info)
+    const char *name,
+    const char *sig,
+    ecs_parse_action_t action,
+    void *ctx)
 {
-    if (from_kind == EcsFromAny) {
-        failure_info->reason = EcsMatchFromSelf;
-        return ecs_type_has_entity(world, type, component);
-        
-    } else if (from_kind == EcsFromOwned) {
-        failure_info->reason = EcsMatchFromOwned;
-        return ecs_type_owns_entity(world, type, component, true);
+    sig_element_t elem;
 
-    } else if (from_kind == EcsFromShared) {
-        failure_info->reason = EcsMatchFromShared;
-        return !ecs_type_owns_entity(world, type, component, true) &&
-            ecs_type_owns_entity(world, type, component, false);
+    bool is_or = false;
+    const char *ptr = sig;
+    while ((ptr = parse_element(name, ptr, &elem))) {
+        if (is_or) {
+            ecs_assert(elem.oper_kind == EcsOperAnd, ECS_INVALID_SIGNATURE, sig);
+            elem.oper_kind = EcsOperOr;
+        }
 
-    } else if (from_kind == EcsFromParent) {
-        failure_info->reason = EcsMatchFromContainer;
-        return ecs_find_in_type(world, type, component, ECS_CHILDOF) != 0;
+        if (action(world, name, sig, ptr - sig, 
+            elem.from_kind, elem.oper_kind, elem.inout_kind, elem.role,
+            elem.component, elem.source, elem.trait, elem.name, ctx))
+        {
+            if (!name) {
+                return -1;
+            }
 
-    } else if (from_kind == EcsFromEntity) {
-        failure_info->reason = EcsMatchFromEntity;
-        ecs_type_t source_type = ecs_get_type(world, source);
-        return ecs_type_has_entity(world, source_type, component);
-    } else {
-        return true;
+            ecs_abort(ECS_INVALID_SIGNATURE, sig);
+        }
+
+        ecs_os_free(elem.component);
+        ecs_os_free(elem.source);
+        ecs_os_free(elem.trait);
+        ecs_os_free(elem.name);
+
+        is_or = false;
+        if (!strncmp(ptr, TOK_OR, 2)) {
+            is_or = true;
+            if (elem.from_kind == EcsFromEmpty) {
+                ecs_parser_error(name, sig, ptr - sig, 
+                    "invalid empty source in or expression");
+                return -1;
+            }
+
+            if (elem.from_kind == EcsFromSystem) {
+                ecs_parser_error(name, sig, ptr - sig, 
+                    "invalid system source in or expression");
+                return -1;
+            }
+        }
+
+        if (ptr[0]) {
+            ptr ++;
+            if (is_or) {
+                ptr ++;
+            }
+        }
+        
+        ptr = skip_space(ptr);
+
+        if (!ptr[0]) {
+            break;
+        }
+    }
+
+    if (!ptr) {
+        if (!name) {
+            return -1;
+        }
+        
+        ecs_abort(ECS_INVALID_SIGNATURE, sig);
     }
+
+    return 0;
 }
 
-/* Match table with system */
-bool ecs_query_match(
+/** Parse callback that adds component to the components array for a system */
+int ecs_parse_signature_action(
     ecs_world_t *world,
-    ecs_table_t *table,
-    ecs_query_t *query,
-    ecs_match_failure_t *failure_info)
+    const char *name,
+    const char *expr,
+    int64_t column,
+    ecs_sig_from_kind_t from_kind,
+    ecs_sig_oper_kind_t oper_kind,
+    ecs_sig_inout_kind_t inout_kind,
+    ecs_entity_t role,
+    const char *entity_id,
+    const char *source_id,
+    const char *trait_id,
+    const char *arg_name,
+    void *data)
 {
-    /* Prevent having to add if not null checks everywhere */
-    ecs_match_failure_t tmp_failure_info;
-    if (!failure_info) {
-        failure_info = &tmp_failure_info;
-    }
+    ecs_sig_t *sig = data;
+    bool is_singleton = false;
 
-    failure_info->reason = EcsMatchOk;
-    failure_info->column = 0;
+    ecs_assert(sig != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    if (!(query->flags & EcsQueryNeedsTables)) {
-        failure_info->reason = EcsMatchSystemIsATask;
-        return false;
+    if (entity_id[0] == '$') {
+        if (from_kind ==  EcsFromEntity) {
+            ecs_parser_error(name, expr, column, 
+                "singleton component '%s' cannot have a source", entity_id);
+        }
+
+        from_kind = EcsFromEntity;
+        is_singleton = true;
+        entity_id ++;
     }
 
-    ecs_type_t type, table_type = table->type;
+    /* Lookup component handle by string identifier */
+    ecs_entity_t source = 0, component = ecs_lookup_fullpath(world, entity_id);
+    if (!component) {
+        /* "0" is a valid expression used to indicate that a system matches no
+         * components */
+        if (!strcmp(entity_id, "0")) {
+            /* No need to add 0 component to signature */
+            return 0;
+        } else {
+            ecs_parser_error(name, expr, column, 
+                "unresolved component identifier '%s'", entity_id);
+        }
+    }
 
-    /* Don't match disabled entities */
-    if (!(query->flags & EcsQueryMatchDisabled) && ecs_type_owns_entity(
-        world, table_type, EcsDisabled, true))
-    {
-        failure_info->reason = EcsMatchEntityIsDisabled;
-        return false;
+    if (is_singleton) {
+        source = component;
     }
 
-    /* Don't match prefab entities */
-    if (!(query->flags & EcsQueryMatchPrefab) && ecs_type_owns_entity(
-        world, table_type, EcsPrefab, true))
-    {
-        failure_info->reason = EcsMatchEntityIsPrefab;
-        return false;
+    /* Lookup trait handle by string identifier */
+    if (trait_id) {
+        ecs_entity_t trait = ecs_lookup_fullpath(world, trait_id);
+        if (!trait) {
+            ecs_parser_error(name, expr, column, 
+                "unresolved trait identifier '%s'", trait_id);
+        } else {
+            component = ecs_entity_t_comb(component, trait);
+        }
     }
 
-    /* Check if trait cardinality matches traits in query, if any */
-    if (count_traits(query, table->type) == -1) {
-        return false;
+    component |= role;
+
+    if (!source && from_kind == EcsFromEntity) {
+        source = ecs_lookup_fullpath(world, source_id);
+        if (!source) {
+            ecs_parser_error(name, expr, column, 
+                "unresolved source identifier '%s'", source_id);
+        }
     }
 
-    int32_t i, column_count = ecs_vector_count(query->sig.columns);
-    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
+    return ecs_sig_add(
+        world, sig, from_kind, oper_kind, inout_kind, component, source, 
+        arg_name);
+}
 
-    for (i = 0; i < column_count; i ++) {
-        ecs_sig_column_t *elem = &columns[i];
-        ecs_sig_from_kind_t from_kind = elem->from_kind;
-        ecs_sig_oper_kind_t oper_kind = elem->oper_kind;
+void ecs_sig_init(
+    ecs_world_t *world,
+    const char *name,
+    const char *expr,
+    ecs_sig_t *sig)
+{
+    if (expr && ecs_os_strlen(expr)) {
+        sig->expr = ecs_os_strdup(expr);
+    } else {
+        sig->expr = ecs_os_strdup("0");
+    }
 
-        failure_info->column = i + 1;
+    ecs_parse_expr(world, name, sig->expr, ecs_parse_signature_action, sig);
+}
 
-        if (oper_kind == EcsOperAnd) {
-            if (!match_column(
-                world, table_type, from_kind, elem->is.component, 
-                elem->source, failure_info)) 
-            {
-                return false;
-            }
-
-        } else if (oper_kind == EcsOperNot) {
-            if (match_column(
-                world, table_type, from_kind, elem->is.component, 
-                elem->source, failure_info)) 
-            {
-                return false;
-            }           
-
-        } else if (oper_kind == EcsOperOr || oper_kind == EcsOperAll) {
-            bool match_all = oper_kind == EcsOperAll;
-            if (match_all) {
-                const EcsType *type_ptr = ecs_get(world, elem->is.component, EcsType);
-                type = type_ptr->normalized;
-            } else {
-                type = elem->is.type;
-            }
-
-            if (from_kind == EcsFromAny) {
-                if (!ecs_type_contains(
-                    world, table_type, type, match_all, true))
-                {
-                    failure_info->reason = EcsMatchOrFromSelf;
-                    return false;
-                }
-            } else if (from_kind == EcsFromOwned) {
-                if (!ecs_type_contains(
-                    world, table_type, type, match_all, false))
-                {
-                    failure_info->reason = EcsMatchOrFromOwned;
-                    return false;
-                }
-            } else if (from_kind == EcsFromShared) {
-                if (ecs_type_contains(
-                        world, table_type, type, match_all, false) ||
-                    !ecs_type_contains(
-                        world, table_type, type, match_all, true))
-                {
-                    failure_info->reason = EcsMatchOrFromShared;
-                    return false;
-                }                                
-            } else if (from_kind == EcsFromParent) {
-                if (!(table->flags & EcsTableHasParent)) {
-                    failure_info->reason = EcsMatchOrFromContainer;
-                    return false;
-                }
-
-                if (!components_contains(
-                    world, table_type, type, NULL, match_all))
-                {
-                    failure_info->reason = EcsMatchOrFromContainer;
-                    return false;
-                }
-            }
+void ecs_sig_deinit(
+    ecs_sig_t *sig)
+{   
+    ecs_vector_each(sig->columns, ecs_sig_column_t, column, {
+        if (column->oper_kind == EcsOperOr) {
+            ecs_vector_free(column->is.type);
         }
-    }
+        ecs_os_free(column->name);
+    });
 
-    return true;
+    ecs_vector_free(sig->columns);
+    ecs_os_free(sig->expr);
 }
 
-/** Match existing tables against system (table is created before system) */
-static
-void match_tables(
+int ecs_sig_add(
     ecs_world_t *world,
-    ecs_query_t *query)
+    ecs_sig_t *sig,
+    ecs_sig_from_kind_t from_kind,
+    ecs_sig_oper_kind_t oper_kind,
+    ecs_sig_inout_kind_t inout_kind,
+    ecs_entity_t component,
+    ecs_entity_t source,
+    const char *arg_name)
 {
-    int32_t i, count = ecs_sparse_count(world->store.tables);
+    ecs_sig_column_t *elem;
 
-    for (i = 0; i < count; i ++) {
-        ecs_table_t *table = ecs_sparse_get(
-            world->store.tables, ecs_table_t, i);
+    /* If component has AND role, all components of specified type must match */
+    if (ECS_HAS_ROLE(component, AND)) {
+        elem = ecs_vector_add(&sig->columns, ecs_sig_column_t);
+        component &= ECS_ENTITY_MASK;
+        const EcsType *type = ecs_get(world, component, EcsType);
+        if (!type) {
+            ecs_parser_error(sig->name, sig->expr, 0, 
+                "AND flag can only be applied to types");
+        }
 
-        if (ecs_query_match(world, table, query, NULL)) {
-            add_table(world, query, table);
+        elem->is.component = component;
+        elem->from_kind = from_kind;
+        elem->oper_kind = EcsOperAll;
+        elem->inout_kind = inout_kind;
+        elem->source = source;
+
+    } else 
+
+    /* If component has OR role, add type as OR column */
+    if (ECS_HAS_ROLE(component, OR)) {
+        elem = ecs_vector_add(&sig->columns, ecs_sig_column_t);
+        component &= ECS_ENTITY_MASK;
+        const EcsType *type = ecs_get(world, component, EcsType);
+        if (!type) {
+            ecs_parser_error(sig->name, sig->expr, 0, 
+                "OR flag can only be applied to types");
         }
-    }
 
-    order_ranked_tables(world, query);
-}
+        elem->is.type = ecs_vector_copy(type->normalized, ecs_entity_t);
+        elem->from_kind = from_kind;
+        elem->oper_kind = EcsOperOr;
+        elem->inout_kind = inout_kind;
+        elem->source = source;
+    } else
 
-/** Get index of table in system's matched tables */
-static
-int32_t get_table_param_index(
-    ecs_table_t *table,
-    ecs_vector_t *tables,
-    int32_t start_index)
-{
-    int32_t i, count = ecs_vector_count(tables);
-    ecs_matched_table_t *table_data = ecs_vector_first(
-        tables, ecs_matched_table_t);
+    /* AND (default) and optional columns are stored the same way */
+    if (oper_kind != EcsOperOr) {
+        elem = ecs_vector_add(&sig->columns, ecs_sig_column_t);
+        elem->from_kind = from_kind;
+        elem->oper_kind = oper_kind;
+        elem->inout_kind = inout_kind;
+        elem->is.component = component;
+        elem->source = source;
 
-    for (i = start_index; i < count; i ++) {
-        if (table_data[i].data.table == table) {
-            break;
+    /* OR columns store a type id instead of a single component */
+    } else {
+        ecs_assert(inout_kind != EcsOut, ECS_INVALID_SIGNATURE, NULL);
+        ecs_assert(inout_kind != EcsInPrev, ECS_INVALID_SIGNATURE, NULL);
+        elem = ecs_vector_last(sig->columns, ecs_sig_column_t);
+
+        if (elem->from_kind != from_kind) {
+            /* Cannot mix FromEntity and FromComponent in OR */
+            ecs_parser_error(sig->name, sig->expr, 0, 
+                "cannot mix source kinds in || expression");
+            goto error;
+        }
+
+        if (elem->oper_kind != EcsOperAnd && elem->oper_kind != EcsOperOr) {
+            ecs_parser_error(sig->name, sig->expr, 0, 
+                "cannot mix operators in || expression");
+            goto error;         
         }
+
+        if (elem->oper_kind == EcsOperAnd) {
+            ecs_entity_t prev = elem->is.component;
+            elem->is.type = NULL;
+            vec_add_entity(&elem->is.type, prev);
+            vec_add_entity(&elem->is.type, component);
+        } else {
+            vec_add_entity(&elem->is.type, component);
+        }      
+
+        elem->from_kind = from_kind;
+        elem->oper_kind = oper_kind;
     }
 
-    return i == count ? -1 : i;
+    if (arg_name) {
+        elem->name = ecs_os_strdup(arg_name);
+    } else {
+        elem->name = NULL;
+    }
+
+    return 0;
+error:
+    return -1;
 }
 
-/** Check if a table was matched with the system */
-static
-int32_t table_matched(
-    ecs_vector_t *tables,
-    ecs_table_t *table)
+/* Check if system meets constraints of non-table columns */
+bool ecs_sig_check_constraints(
+    ecs_world_t *world,
+    ecs_sig_t *sig)
 {
-    int32_t i, count = ecs_vector_count(tables);
-    ecs_matched_table_t *table_data = ecs_vector_first(
-        tables, ecs_matched_table_t);
+    ecs_vector_each(sig->columns, ecs_sig_column_t, elem, {
+        ecs_sig_from_kind_t from_kind = elem->from_kind;
+        ecs_sig_oper_kind_t oper_kind = elem->oper_kind;
 
-    for (i = 0; i < count; i ++) {
-        if (table_data[i].data.table == table) {
-            return i;
+        if (from_kind == EcsFromEntity) {
+            ecs_type_t type = ecs_get_type(world, elem->source);
+            if (ecs_type_has_entity(world, type, elem->is.component)) {
+                if (oper_kind == EcsOperNot) {
+                    return false;
+                }
+            } else {
+                if (oper_kind != EcsOperNot) {
+                    return false;
+                }
+            }
         }
-    }
+    });
 
-    return -1;
+    return true;
 }
 
-static
-void resolve_cascade_container(
+ecs_entity_t ecs_find_entity_in_prefabs(
     ecs_world_t *world,
-    ecs_query_t *query,
-    int32_t table_data_index,
-    ecs_type_t table_type)
+    ecs_entity_t entity,
+    ecs_type_t type,
+    ecs_entity_t component,
+    ecs_entity_t previous)
 {
-    ecs_matched_table_t *table_data = ecs_vector_get(
-        query->tables, ecs_matched_table_t, table_data_index);
-    
-    ecs_assert(table_data->data.references != 0, ECS_INTERNAL_ERROR, NULL);
+    int32_t i, count = ecs_vector_count(type);
+    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
 
-    /* Obtain reference index */
-    int32_t *column_indices = table_data->data.columns;
-    int32_t column = query->cascade_by - 1;
-    int32_t ref_index = -column_indices[column] - 1;
+    /* Walk from back to front, as prefabs are always located
+     * at the end of the type. */
+    for (i = count - 1; i >= 0; i --) {
+        ecs_entity_t e = array[i];
 
-    /* Obtain pointer to the reference data */
-    ecs_ref_t *references = table_data->data.references;
-    ecs_ref_t *ref = &references[ref_index];
-    ecs_assert(ref->component == get_cascade_component(query), 
-        ECS_INTERNAL_ERROR, NULL);
+        if (ECS_HAS_ROLE(e, INSTANCEOF)) {
+            ecs_entity_t prefab = e & ECS_COMPONENT_MASK;
+            ecs_type_t prefab_type = ecs_get_type(world, prefab);
 
-    /* Resolve container entity */
-    ecs_entity_t container = ecs_find_in_type(
-        world, table_type, ref->component, ECS_CHILDOF);    
+            if (prefab == previous) {
+                continue;
+            }
 
-    /* If container was found, update the reference */
-    if (container) {
-        references[ref_index].entity = container;
-        ecs_get_ref_w_entity(
-            world, &references[ref_index], container, 
-            ref->component);
-    } else {
-        references[ref_index].entity = 0;
+            if (ecs_type_owns_entity(
+                world, prefab_type, component, true)) 
+            {
+                return prefab;
+            } else {
+                prefab = ecs_find_entity_in_prefabs(
+                    world, prefab, prefab_type, component, entity);
+                if (prefab) {
+                    return prefab;
+                }
+            }
+        } else {
+            /* If this is not a prefab, the following entities won't
+                * be prefabs either because the array is sorted, and
+                * the prefab bit is 2^63 which ensures that prefabs are
+                * guaranteed to be the last entities in the type */
+            break;
+        }
     }
+
+    return 0;
 }
 
-#define ELEM(ptr, size, index) ECS_OFFSET(ptr, size * index)
+/* -- Private functions -- */
 
-static
-int32_t qsort_partition(
+/* O(n) algorithm to check whether type 1 is equal or superset of type 2 */
+ecs_entity_t ecs_type_contains(
     ecs_world_t *world,
-    ecs_table_t *table,
-    ecs_data_t *data,
-    ecs_entity_t *entities,
-    void *ptr,    
-    int32_t elem_size,
-    int32_t lo,
-    int32_t hi,
-    ecs_compare_action_t compare)
+    ecs_type_t type_1,
+    ecs_type_t type_2,
+    bool match_all,
+    bool match_prefab)
 {
-    int32_t p = (hi + lo) / 2;
-    void *pivot = ELEM(ptr, elem_size, p);
-    ecs_entity_t pivot_e = entities[p];
-    int32_t i = lo - 1, j = hi + 1;
-    void *el;    
+    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_get_stage(&world);
+    
+    if (!type_1) {
+        return 0;
+    }
 
-repeat:
-    {
-        do {
-            i ++;
-            el = ELEM(ptr, elem_size, i);
-        } while ( compare(entities[i], el, pivot_e, pivot) < 0);
+    ecs_assert(type_2 != NULL, ECS_INTERNAL_ERROR, NULL);
 
-        do {
-            j --;
-            el = ELEM(ptr, elem_size, j);
-        } while ( compare(entities[j], el, pivot_e, pivot) > 0);
+    if (type_1 == type_2) {
+        return *(ecs_vector_first(type_1, ecs_entity_t));
+    }
 
-        if (i >= j) {
-            return j;
+    int32_t i_2, i_1 = 0;
+    ecs_entity_t e1 = 0;
+    ecs_entity_t *t1_array = ecs_vector_first(type_1, ecs_entity_t);
+    ecs_entity_t *t2_array = ecs_vector_first(type_2, ecs_entity_t);
+
+    ecs_assert(t1_array != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(t2_array != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t t1_count = ecs_vector_count(type_1);
+    int32_t t2_count = ecs_vector_count(type_2);
+
+    for (i_2 = 0; i_2 < t2_count; i_2 ++) {
+        ecs_entity_t e2 = t2_array[i_2];
+
+        if (i_1 >= t1_count) {
+            return 0;
         }
 
-        ecs_table_swap(world, table, data, i, j);
+        e1 = t1_array[i_1];
 
-        if (p == i) {
-            pivot = ELEM(ptr, elem_size, j);
-            pivot_e = entities[j];
-        } else if (p == j) {
-            pivot = ELEM(ptr, elem_size, i);
-            pivot_e = entities[i];
+        if (e2 > e1) {
+            do {
+                i_1 ++;
+                if (i_1 >= t1_count) {
+                    return 0;
+                }
+                e1 = t1_array[i_1];
+            } while (e2 > e1);
         }
 
-        goto repeat;
+        if (e1 != e2) {
+            if (match_prefab && e2 != 
+                ecs_typeid(EcsName) && e2 != 
+                ecs_typeid(EcsChildOf) && e2 != 
+                EcsPrefab && e2 != 
+                EcsDisabled) 
+            {
+                if (ecs_find_entity_in_prefabs(world, 0, type_1, e2, 0)) {
+                    e1 = e2;
+                }
+            }
+
+            if (e1 != e2) {
+                if (match_all) return 0;
+            } else if (!match_all) {
+                return e1;
+            }
+        } else {
+            if (!match_all) return e1;
+            i_1 ++;
+            if (i_1 < t1_count) {
+                e1 = t1_array[i_1];
+            }
+        }
     }
-}
 
-static
-void qsort_array(
-    ecs_world_t *world,
-    ecs_table_t *table,
-    ecs_data_t *data,
-    ecs_entity_t *entities,
-    void *ptr,
-    int32_t size,
-    int32_t lo,
-    int32_t hi,
-    ecs_compare_action_t compare)
-{   
-    if ((hi - lo) < 1)  {
-        return;
-    }   
+    if (match_all) {
+        return e1;
+    } else {
+        return 0;
+    }
+}
 
-    int32_t p = qsort_partition(
-        world, table, data, entities, ptr, size, lo, hi, compare);
+/* -- Public API -- */
 
-    qsort_array(world, table, data, entities, ptr, size, lo, p, compare);
+int32_t ecs_type_index_of(
+    ecs_type_t type,
+    ecs_entity_t entity)
+{
+    ecs_vector_each(type, ecs_entity_t, c_ptr, {
+        if (*c_ptr == entity) {
+            return c_ptr_i; 
+        }
+    });
 
-    qsort_array(world, table, data, entities, ptr, size, p + 1, hi, compare); 
+    return -1;
 }
 
-static
-void sort_table(
+ecs_type_t ecs_type_merge(
     ecs_world_t *world,
-    ecs_table_t *table,
-    int32_t column_index,
-    ecs_compare_action_t compare)
+    ecs_type_t type,
+    ecs_type_t to_add,
+    ecs_type_t to_remove)
 {
-    ecs_data_t *data = ecs_table_get_data(table);
-    if (!data || !data->entities) {
-        /* Nothing to sort */
-        return;
-    }
-
-    int32_t count = ecs_table_data_count(data);
-    if (count < 2) {
-        return;
-    }
+    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_get_stage(&world);
+    
+    ecs_table_t *table = ecs_table_from_type(world, type);
+    ecs_entities_t add_array = ecs_type_to_entities(to_add);
+    ecs_entities_t remove_array = ecs_type_to_entities(to_remove);
+    
+    table = ecs_table_traverse_remove(
+        world, table, &remove_array, NULL); 
 
-    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+    table = ecs_table_traverse_add(
+        world, table, &add_array, NULL); 
 
-    void *ptr = NULL;
-    int32_t size = 0;
-    if (column_index != -1) {
-        ecs_column_t *column = &data->columns[column_index];
-        size = column->size;
-        ptr = ecs_vector_first_t(column->data, size, column->alignment);
+    if (!table) {
+        return NULL;
+    } else {
+        return table->type;
     }
-
-    qsort_array(world, table, data, entities, ptr, size, 0, count - 1, compare);
 }
 
-/* Helper struct for building sorted table ranges */
-typedef struct sort_helper_t {
-    ecs_matched_table_t *table;
-    ecs_entity_t *entities;
-    void *ptr;
-    int32_t row;
-    int32_t elem_size;
-    int32_t count;
-} sort_helper_t;
-
-static
-void* ptr_from_helper(
-    sort_helper_t *helper)
+ecs_type_t ecs_type_find(
+    ecs_world_t *world,
+    ecs_entity_t *array,
+    int32_t count)
 {
-    ecs_assert(helper->row < helper->count, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(helper->elem_size >= 0, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(helper->row >= 0, ECS_INTERNAL_ERROR, NULL);
-    return ELEM(helper->ptr, helper->elem_size, helper->row);
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_get_stage(&world);
+
+    ecs_entities_t entities = {
+        .array = array,
+        .count = count
+    };
+
+    ecs_table_t *table = ecs_table_find_or_create(world, &entities);
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    return table->type;
 }
 
 static
-ecs_entity_t e_from_helper(
-    sort_helper_t *helper)
+bool has_trait(
+    ecs_entity_t trait,
+    ecs_entity_t e)
 {
-    if (helper->row < helper->count) {
-        return helper->entities[helper->row];
-    } else {
-        return 0;
-    }
+    return trait == ecs_entity_t_hi(e & ECS_COMPONENT_MASK);
 }
 
 static
-void build_sorted_table_range(
-    ecs_query_t *query,
-    int32_t start,
-    int32_t end)
+bool has_case(
+    ecs_world_t *world,
+    ecs_entity_t sw_case,
+    ecs_entity_t e)
 {
-    ecs_entity_t component = query->sort_on_component;
-    ecs_compare_action_t compare = query->compare;
-
-    /* Fetch data from all matched tables */
-    ecs_matched_table_t *tables = ecs_vector_first(query->tables, ecs_matched_table_t);
-    sort_helper_t *helper = ecs_os_malloc((end - start) * ECS_SIZEOF(sort_helper_t));
-
-    int i, to_sort = 0;
-    for (i = start; i < end; i ++) {
-        ecs_matched_table_t *table_data = &tables[i];
-        ecs_table_t *table = table_data->data.table;
-        ecs_data_t *data = ecs_table_get_data(table);
-        ecs_vector_t *entities;
-        if (!data || !(entities = data->entities) || !ecs_table_count(table)) {
-            continue;
-        }
-
-        int32_t index = ecs_type_index_of(table->type, component);
-        if (index != -1) {
-            ecs_column_t *column = &data->columns[index];
-            int16_t size = column->size;
-            int16_t align = column->alignment;
-            helper[to_sort].ptr = ecs_vector_first_t(column->data, size, align);
-            helper[to_sort].elem_size = size;
-        } else {
-            helper[to_sort].ptr = NULL;
-            helper[to_sort].elem_size = 0;
-        }
-
-        helper[to_sort].table = table_data;
-        helper[to_sort].entities = ecs_vector_first(entities, ecs_entity_t);
-        helper[to_sort].row = 0;
-        helper[to_sort].count = ecs_table_count(table);
-        to_sort ++;      
-    }
-
-    ecs_table_slice_t *cur = NULL;
+    const EcsType *type_ptr = ecs_get(world, e & ECS_COMPONENT_MASK, EcsType);
+    ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+    return ecs_type_has_entity(world, type_ptr->normalized, sw_case);
+}
 
-    bool proceed;
-    do {
-        int32_t j, min = 0;
-        proceed = true;
+static
+int match_entity(
+    ecs_world_t *world,
+    ecs_type_t type,
+    ecs_entity_t e,
+    ecs_entity_t match_with)
+{
+    if (ECS_HAS_ROLE(match_with, TRAIT)) {
+        ecs_entity_t hi = ecs_entity_t_hi(match_with & ECS_COMPONENT_MASK);
+        ecs_entity_t lo = ecs_entity_t_lo(match_with);
 
-        ecs_entity_t e1;
-        while (!(e1 = e_from_helper(&helper[min]))) {
-            min ++;
-            if (min == to_sort) {
-                proceed = false;
-                break;
+        if (lo == EcsWildcard) {
+            ecs_assert(hi != 0, ECS_INTERNAL_ERROR, NULL);
+            
+            if (!ECS_HAS_ROLE(e, TRAIT) || !has_trait(hi, e)) {
+                return 0;
             }
-        }
 
-        if (!proceed) {
-            break;
-        }
+            ecs_entity_t *ids = ecs_vector_first(type, ecs_entity_t);
+            int32_t i, count = ecs_vector_count(type);
 
-        for (j = min + 1; j < to_sort; j++) {
-            ecs_entity_t e2 = e_from_helper(&helper[j]);
-            if (!e2) {
-                continue;
+            ecs_entity_t comp = ecs_entity_t_lo(e);
+            for (i = 0; i < count; i ++) {
+                if (comp == ids[i]) {
+                    return 2;
+                }
             }
 
-            void *ptr1 = ptr_from_helper(&helper[min]);
-            void *ptr2 = ptr_from_helper(&helper[j]);
-
-            if (compare(e1, ptr1, e2, ptr2) > 0) {
-                min = j;
+            return -1;
+        } else if (!hi) {
+            if (ECS_HAS_ROLE(e, TRAIT) && has_trait(lo, e)) {
+                return 1;
             }
         }
-
-        sort_helper_t *cur_helper = &helper[min];
-
-        if (!cur || cur->table != cur_helper->table) {
-            cur = ecs_vector_add(&query->table_slices, ecs_table_slice_t);
-            ecs_assert(cur != NULL, ECS_INTERNAL_ERROR, NULL);
-            cur->table = cur_helper->table;
-            cur->start_row = cur_helper->row;
-            cur->count = 1;
+    } else 
+    if (ECS_HAS_ROLE(match_with, CASE)) {
+        ecs_entity_t sw_case = match_with & ECS_COMPONENT_MASK;
+        if (ECS_HAS_ROLE(e, SWITCH) && has_case(world, sw_case, e)) {
+            return 1;
         } else {
-            cur->count ++;
+            return 0;
         }
+    }
 
-        cur_helper->row ++;
-    } while (proceed);
+    if (e == match_with) {
+        return 1;
+    }
 
-    ecs_os_free(helper);
+    return 0;
 }
 
 static
-void build_sorted_tables(
-    ecs_query_t *query)
+bool search_type(
+    ecs_world_t *world,
+    ecs_type_t type,
+    ecs_entity_t entity,
+    bool owned)
 {
-    /* Clean previous sorted tables */
-    ecs_vector_free(query->table_slices);
-    query->table_slices = NULL;
-
-    int32_t i, count = ecs_vector_count(query->tables);
-    ecs_matched_table_t *tables = ecs_vector_first(query->tables, ecs_matched_table_t);
-    ecs_matched_table_t *table = NULL;
-
-    int32_t start = 0, rank = 0;
-    for (i = 0; i < count; i ++) {
-        table = &tables[i];
-        if (rank != table->rank) {
-            if (start != i) {
-                build_sorted_table_range(query, start, i);
-                start = i;
-            }
-            rank = table->rank;
-        }
+    if (!type) {
+        return false;
     }
 
-    if (start != i) {
-        build_sorted_table_range(query, start, i);
+    if (!entity) {
+        return true;
     }
-}
 
-static
-bool tables_dirty(
-    ecs_query_t *query)
-{
-    int32_t i, count = ecs_vector_count(query->tables);
-    ecs_matched_table_t *tables = ecs_vector_first(query->tables, 
-        ecs_matched_table_t);
-    bool is_dirty = false;
+    ecs_entity_t *ids = ecs_vector_first(type, ecs_entity_t);
+    int32_t i, count = ecs_vector_count(type);
+    int matched = 0;
 
     for (i = 0; i < count; i ++) {
-        ecs_matched_table_t *table_data = &tables[i];
-        ecs_table_t *table = table_data->data.table;
-
-        if (!table_data->monitor) {
-            table_data->monitor = ecs_table_get_monitor(table);
-            is_dirty = true;
+        int ret = match_entity(world, type, ids[i], entity);
+        switch(ret) {
+        case 0: break;
+        case 1: return true;
+        case -1: return false;
+        case 2: matched ++; break;
+        default: ecs_abort(ECS_INTERNAL_ERROR, NULL);
         }
+    }
 
-        int32_t *dirty_state = ecs_table_get_dirty_state(table);
-        int32_t t, type_count = table->column_count;
-        for (t = 0; t < type_count + 1; t ++) {
-            is_dirty = is_dirty || (dirty_state[t] != table_data->monitor[t]);
+    if (!matched && !owned && entity != EcsPrefab && entity != EcsDisabled) {
+        for (i = count - 1; i >= 0; i --) {
+            ecs_entity_t e = ids[i];
+            if (!ECS_HAS_ROLE(e, INSTANCEOF)) {
+                break;
+            }
+
+            ecs_entity_t base = e & ECS_COMPONENT_MASK;
+            ecs_type_t base_type = ecs_get_type(world, base);
+
+            if (search_type(world, base_type, entity, false)) {
+                return true;
+            }
         }
     }
 
-    is_dirty = is_dirty || (query->match_count != query->prev_match_count);
-
-    return is_dirty;
+    return matched != 0;
 }
 
-static
-void tables_reset_dirty(
-    ecs_query_t *query)
+bool ecs_type_has_entity(
+    ecs_world_t *world,
+    ecs_type_t type,
+    ecs_entity_t entity)
 {
-    query->prev_match_count = query->match_count;
-
-    int32_t i, count = ecs_vector_count(query->tables);
-    ecs_matched_table_t *tables = ecs_vector_first(
-        query->tables, ecs_matched_table_t);
-
-    for (i = 0; i < count; i ++) {
-        ecs_matched_table_t *table_data = &tables[i];
-        ecs_table_t *table = table_data->data.table;
+    return search_type(world, type, entity, false);
+}
 
-        if (!table_data->monitor) {
-            /* If one table doesn't have a monitor, none of the tables will have
-             * a monitor, so early out. */
-            return;
-        }
+bool ecs_type_owns_entity(
+    ecs_world_t *world,
+    ecs_type_t type,
+    ecs_entity_t entity,
+    bool owned)
+{
+    return search_type(world, type, entity, owned);
+}
 
-        int32_t *dirty_state = ecs_table_get_dirty_state(table);
-        int32_t t, type_count = table->column_count;
-        for (t = 0; t < type_count + 1; t ++) {
-            table_data->monitor[t] = dirty_state[t];
-        }
-    }
+bool ecs_type_has_type(
+    ecs_world_t *world,
+    ecs_type_t type,
+    ecs_type_t has)
+{
+    return ecs_type_contains(world, type, has, true, false) != 0;
 }
 
-static
-void sort_tables(
+bool ecs_type_owns_type(
     ecs_world_t *world,
-    ecs_query_t *query)
+    ecs_type_t type,
+    ecs_type_t has,
+    bool owned)
 {
-    ecs_compare_action_t compare = query->compare;
-    if (!compare) {
-        return;
-    }
-    
-    ecs_entity_t sort_on_component = query->sort_on_component;
+    return ecs_type_contains(world, type, has, true, !owned) != 0;
+}
 
-    /* Iterate over active tables. Don't bother with inactive tables, since
-     * they're empty */
-    int32_t i, count = ecs_vector_count(query->tables);
-    ecs_matched_table_t *tables = ecs_vector_first(
-        query->tables, ecs_matched_table_t);
-    bool tables_sorted = false;
+ecs_type_t ecs_type_add(
+    ecs_world_t *world,
+    ecs_type_t type,
+    ecs_entity_t e)
+{
+    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_get_stage(&world);
+    ecs_table_t *table = ecs_table_from_type(world, type);
 
-    for (i = 0; i < count; i ++) {
-        ecs_matched_table_t *table_data = &tables[i];
-        ecs_table_t *table = table_data->data.table;
+    ecs_entities_t entities = {
+        .array = &e,
+        .count = 1
+    };
 
-        /* If no monitor had been created for the table yet, create it now */
-        bool is_dirty = false;
-        if (!table_data->monitor) {
-            table_data->monitor = ecs_table_get_monitor(table);
+    table = ecs_table_traverse_add(world, table, &entities, NULL);
 
-            /* A new table is always dirty */
-            is_dirty = true;
-        }
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
 
-        int32_t *dirty_state = ecs_table_get_dirty_state(table);
+    return table->type;
+}
+
+ecs_type_t ecs_type_remove(
+    ecs_world_t *world,
+    ecs_type_t type,
+    ecs_entity_t e)
+{
+    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_get_stage(&world);
+    ecs_table_t *table = ecs_table_from_type(world, type);
 
-        is_dirty = is_dirty || (dirty_state[0] != table_data->monitor[0]);
+    ecs_entities_t entities = {
+        .array = &e,
+        .count = 1
+    };
 
-        int32_t index = -1;
-        if (sort_on_component) {
-            /* Get index of sorted component. We only care if the component we're
-            * sorting on has changed or if entities have been added / re(moved) */
-            index = ecs_type_index_of(table->type, sort_on_component);
-            ecs_assert(index != -1, ECS_INVALID_PARAMETER, NULL);
-            ecs_assert(index < ecs_vector_count(table->type), ECS_INTERNAL_ERROR, NULL); 
-            is_dirty = is_dirty || (dirty_state[index + 1] != table_data->monitor[index + 1]);
-        }      
-        
-        /* Check both if entities have moved (element 0) or if the component
-         * we're sorting on has changed (index + 1) */
-        if (is_dirty) {
-            /* Sort the table */
-            sort_table(world, table, index, compare);
-            tables_sorted = true;
-        }
-    }
+    table = ecs_table_traverse_remove(world, table, &entities, NULL);
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    if (tables_sorted || query->match_count != query->prev_match_count) {
-        build_sorted_tables(query);
-        query->match_count ++; /* Increase version if tables changed */
-    }
+    return table->type;    
 }
 
-static
-bool has_refs(
-    ecs_sig_t *sig)
+char* ecs_type_str(
+    ecs_world_t *world,
+    ecs_type_t type)
 {
-    int32_t i, count = ecs_vector_count(sig->columns);
-    ecs_sig_column_t *columns = ecs_vector_first(sig->columns, ecs_sig_column_t);
+    if (!type) {
+        return ecs_os_strdup("");
+    }
+
+    ecs_vector_t *chbuf = ecs_vector_new(char, 32);
+    char *dst;
+
+    ecs_entity_t *entities = ecs_vector_first(type, ecs_entity_t);
+    int32_t i, count = ecs_vector_count(type);
 
     for (i = 0; i < count; i ++) {
-        ecs_sig_from_kind_t from_kind = columns[i].from_kind;
+        ecs_entity_t e = entities[i];
+        char buffer[256];
+        ecs_size_t len;
 
-        if (columns[i].oper_kind == EcsOperNot && from_kind == EcsFromEmpty) {
-            /* Special case: if oper kind is Not and the query contained a
-             * shared expression, the expression is translated to FromId to
-             * prevent resolving the ref */
-            return true;
-        } else if (from_kind != EcsFromAny && from_kind != EcsFromEmpty) {
-            /* If the component is not from the entity being iterated over, and
-             * the column is not just passing an id, it must be a reference to
-             * another entity. */
-            return true;
+        if (i) {
+            *(char*)ecs_vector_add(&chbuf, char) = ',';
         }
+
+        if (e == 1) {
+            ecs_os_strcpy(buffer, "EcsComponent");
+            len = ecs_os_strlen("EcsComponent");
+        } else {
+            len = ecs_from_size_t(ecs_entity_str(world, e, buffer, 256));
+        }
+
+        dst = ecs_vector_addn(&chbuf, char, len);
+        ecs_os_memcpy(dst, buffer, len);
     }
 
-    return false;
+    *(char*)ecs_vector_add(&chbuf, char) = '\0';
+
+    char* result = ecs_os_strdup(ecs_vector_first(chbuf, char));
+    ecs_vector_free(chbuf);
+    return result;
 }
 
-static
-bool has_traits(
-    ecs_sig_t *sig)
+ecs_entity_t ecs_type_get_entity_for_xor(
+    ecs_world_t *world,
+    ecs_type_t type,
+    ecs_entity_t xor)
 {
-    int32_t i, count = ecs_vector_count(sig->columns);
-    ecs_sig_column_t *columns = ecs_vector_first(sig->columns, ecs_sig_column_t);
+    ecs_assert(
+        ecs_type_owns_entity(world, type, ECS_XOR | xor, true),
+        ECS_INVALID_PARAMETER, NULL);
+
+    const EcsType *type_ptr = ecs_get(world, xor, EcsType);
+    ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_type_t xor_type = type_ptr->normalized;
+    ecs_assert(xor_type != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    int32_t i, count = ecs_vector_count(type);
+    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
     for (i = 0; i < count; i ++) {
-        if (is_column_trait(&columns[i])) {
-            return true;
+        if (ecs_type_owns_entity(world, xor_type, array[i], true)) {
+            return array[i];
         }
     }
 
-    return false;    
+    return 0;
 }
 
-static
-void register_monitors(
-    ecs_world_t *world,
-    ecs_query_t *query)
+int32_t ecs_type_trait_index_of(
+    ecs_type_t type, 
+    int32_t start_index, 
+    ecs_entity_t trait)
 {
-    ecs_vector_each(query->sig.columns, ecs_sig_column_t, column, {
-        /* If component is requested with CASCADE source register component as a
-         * parent monitor. Parent monitors keep track of whether an entity moved
-         * in the hierarchy, which potentially requires the query to reorder its
-         * tables. 
-         * Also register a regular component monitor for EcsCascade columns.
-         * This ensures that when the component used in the CASCADE column
-         * is added or removed tables are updated accordingly*/
-        if (column->from_kind == EcsCascade) {
-            if (column->oper_kind != EcsOperOr) {
-                ecs_component_monitor_register(
-                    &world->parent_monitors, column->is.component, query);
-
-                ecs_component_monitor_register(
-                    &world->component_monitors, column->is.component, query);
-            } else {
-                ecs_vector_each(column->is.type, ecs_entity_t, e_ptr, {
-                    ecs_component_monitor_register(
-                        &world->parent_monitors, *e_ptr, query);
-
-                    ecs_component_monitor_register(
-                        &world->component_monitors, *e_ptr, query);
-                });
-            }
+    int32_t i, count = ecs_vector_count(type);
+    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
 
-        /* FromSelf also requires registering a monitor, as FromSelf columns can
-         * be matched with prefabs. The only column kinds that do not require
-         * registering a monitor are FromOwned and FromNothing. */
-        } else if (column->from_kind == EcsFromAny || 
-            column->from_kind == EcsFromShared ||
-            column->from_kind == EcsFromEntity ||
-            column->from_kind == EcsFromParent)
-        {
-            if (column->oper_kind != EcsOperOr) {
-                ecs_component_monitor_register(
-                    &world->component_monitors, column->is.component, query);
-            } else {
-                ecs_vector_each(column->is.type, ecs_entity_t, e_ptr, {
-                    ecs_component_monitor_register(
-                        &world->component_monitors, *e_ptr, query);
-                });
+    for (i = start_index; i < count; i ++) {
+        ecs_entity_t e = array[i];
+        if (ECS_HAS_ROLE(e, TRAIT)) {
+            e &= ECS_COMPONENT_MASK;
+            if (trait == ecs_entity_t_hi(e)) {
+                return i;
             }
         }
-    });
+    }
+
+    return -1;
 }
 
-static
-void process_signature(
-    ecs_world_t *world,
-    ecs_query_t *query)
-{
-    int i, count = ecs_vector_count(query->sig.columns);
-    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
+void ecs_os_api_impl(ecs_os_api_t *api);
 
-    for (i = 0; i < count; i ++) {
-        ecs_sig_column_t *column = &columns[i];
-        ecs_sig_oper_kind_t op = column->oper_kind; 
-        ecs_sig_from_kind_t from = column->from_kind; 
-        ecs_sig_inout_kind_t inout = column->inout_kind;
+static bool ecs_os_api_initialized = false;
+static int ecs_os_api_init_count = 0;
 
-        if (inout != EcsIn) {
-            query->flags |= EcsQueryHasOutColumns;
-        }
+ecs_os_api_t ecs_os_api;
 
-        if (op == EcsOperOptional) {
-            query->flags |= EcsQueryHasOptional;
-        }        
+int64_t ecs_os_api_malloc_count = 0;
+int64_t ecs_os_api_realloc_count = 0;
+int64_t ecs_os_api_calloc_count = 0;
+int64_t ecs_os_api_free_count = 0;
 
-        if (!(query->flags & EcsQueryMatchDisabled)) {
-            if (op == EcsOperOr) {
-                /* If the signature explicitly indicates interest in EcsDisabled,
-                 * signal that disabled entities should be matched. By default,
-                 * disabled entities are not matched. */
-                if (ecs_type_owns_entity(
-                    world, column->is.type, EcsDisabled, true))
-                {
-                    query->flags |= EcsQueryMatchDisabled;
-                }         
-            } else if (op == EcsOperAnd || op == EcsOperOptional) {
-                if (column->is.component == EcsDisabled) {
-                    query->flags |= EcsQueryMatchDisabled;
-                }
-            }
-        }
+ecs_alloc_tag_stats_t ecs_os_api_alloc_tags[EcsAllocTagCount];
 
-        if (!(query->flags & EcsQueryMatchPrefab)) {
-            if (op == EcsOperOr) {
-                /* If the signature explicitly indicates interest in EcsPrefab,
-                * signal that disabled entities should be matched. By default,
-                * prefab entities are not matched. */
-                if (ecs_type_owns_entity(
-                    world, column->is.type, EcsPrefab, true))
-                {
-                    query->flags |= EcsQueryMatchPrefab;
-                }            
-            } else if (op == EcsOperAnd || op == EcsOperOptional) {
-                if (column->is.component == EcsPrefab) {
-                    query->flags |= EcsQueryMatchPrefab;
-                }
-            }
-        }
+/* Worker threads record allocations in the counters of their stage, which are
+ * folded into the global counters when the stage is merged. Without support
+ * for thread local storage all threads write to the global counters. */
+#ifdef ECS_THREAD_LOCAL
+static ECS_THREAD_LOCAL ecs_alloc_tag_stats_t *ecs_os_thread_alloc_tags;
+#endif
 
-        if (from == EcsFromAny || 
-            from == EcsFromOwned ||
-            from == EcsFromShared ||
-            from == EcsFromParent) 
-        {
-            query->flags |= EcsQueryNeedsTables;
-        }
-
-        if (from == EcsCascade) {
-            query->cascade_by = i + 1;
-            query->rank_on_component = column->is.component;
-        }
-
-        if (from == EcsFromEntity) {
-            ecs_assert(column->source != 0, ECS_INTERNAL_ERROR, NULL);
-            ecs_set_watch(world, column->source);
-        }
+void ecs_os_set_api(
+    ecs_os_api_t *os_api)
+{
+    if (!ecs_os_api_initialized) {
+        ecs_os_api = *os_api;
+        ecs_os_api_initialized = true;
     }
+}
 
-    query->flags |= (ecs_flags32_t)(has_refs(&query->sig) * EcsQueryHasRefs);
-    query->flags |= (ecs_flags32_t)(has_traits(&query->sig) * EcsQueryHasTraits);
-
-    if (!(query->flags & EcsQueryIsSubquery)) {
-        register_monitors(world, query);
+void ecs_os_init(void)
+{
+    if (!ecs_os_api_initialized) {
+        ecs_os_set_api_defaults();
+    }
+    
+    if (!(ecs_os_api_init_count ++)) {
+        if (ecs_os_api.init_) {
+            ecs_os_api.init_();
+        }
     }
 }
 
-bool match_table(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_table_t *table)
-{
-    if (ecs_query_match(world, table, query, NULL)) {
-        add_table(world, query, table);
-        return true;
+void ecs_os_fini(void) {
+    if (!--ecs_os_api_init_count) {
+        if (ecs_os_api.fini_) {
+            ecs_os_api.fini_();
+        }
     }
-    return false;
 }
 
-/** Table activation happens when a table was or becomes empty. Deactivated
- * tables are not considered by the system in the main loop. */
-void activate_table(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_table_t *table,
-    bool active)
+void ecs_os_track_alloc(
+    ecs_alloc_tag_t tag,
+    ecs_size_t old_size,
+    ecs_size_t new_size)
 {
-    ecs_vector_t *src_array, *dst_array;
+    ecs_assert(tag < EcsAllocTagCount, ECS_INVALID_PARAMETER, NULL);
 
-    if (active) {
-        src_array = query->empty_tables;
-        dst_array = query->tables;
-    } else {
-        src_array = query->tables;
-        dst_array = query->empty_tables;
+    if (old_size == new_size) {
+        return;
     }
 
-    int32_t i = 0, activated = 0;
-    while ((i = get_table_param_index(table, src_array, i)) != -1) {
-        activated ++;
+    ecs_alloc_tag_stats_t *stats = &ecs_os_api_alloc_tags[tag];
+#ifdef ECS_THREAD_LOCAL
+    if (ecs_os_thread_alloc_tags) {
+        stats = &ecs_os_thread_alloc_tags[tag];
+    }
+#endif
 
-        int32_t src_count = ecs_vector_move_index(
-            &dst_array, src_array, ecs_matched_table_t, i);
+    if (!old_size) {
+        stats->alloc_count ++;
+    } else if (!new_size) {
+        stats->free_count ++;
+    } else {
+        stats->realloc_count ++;
+    }
 
-        if (active) {
-            query->tables = dst_array;
-        } else {
-            query->empty_tables = dst_array;
-        }
+    stats->bytes += new_size - old_size;
+}
 
-        /* Activate system if registered with query */
-#ifdef FLECS_SYSTEMS_H
-        if (query->system) {
-            int32_t dst_count = ecs_vector_count(dst_array);
-            if (active) {
-                if (dst_count == 1) {
-                    ecs_system_activate(world, query->system, true, NULL);
-                }
-            } else if (src_count == 0) {
-                ecs_system_activate(world, query->system, false, NULL);
-            }
-        }
+void ecs_os_set_thread_alloc_tags(
+    ecs_alloc_tag_stats_t *tags)
+{
+#ifdef ECS_THREAD_LOCAL
+    ecs_os_thread_alloc_tags = tags;
 #else
-        (void)src_count;
-#endif        
-    }
+    (void)tags;
+#endif
+}
 
-    if (!activated) {
-        /* Received an activate event for a table we're not matched with. This
-        * can only happen if this is a subquery */
-        ecs_assert((query->flags & EcsQueryIsSubquery) != 0, 
-            ECS_INTERNAL_ERROR, NULL);
-        return;
+void ecs_os_merge_alloc_tags(
+    ecs_alloc_tag_stats_t *tags)
+{
+    int32_t i;
+    for (i = 0; i < EcsAllocTagCount; i ++) {
+        ecs_alloc_tag_stats_t *dst = &ecs_os_api_alloc_tags[i];
+        dst->alloc_count += tags[i].alloc_count;
+        dst->realloc_count += tags[i].realloc_count;
+        dst->free_count += tags[i].free_count;
+        dst->bytes += tags[i].bytes;
     }
 
-    order_ranked_tables(world, query);
+    ecs_os_memset(tags, 0, ECS_SIZEOF(ecs_alloc_tag_stats_t) * EcsAllocTagCount);
 }
 
 static
-void add_subquery(
-    ecs_world_t *world, 
-    ecs_query_t *parent, 
-    ecs_query_t *subquery) 
-{
-    ecs_query_t **elem = ecs_vector_add(&parent->subqueries, ecs_query_t*);
-    *elem = subquery;
+void ecs_log(const char *fmt, va_list args) {
+    vfprintf(stdout, fmt, args);
+    fprintf(stdout, "\n");
+}
 
-    /* Iterate matched tables, match them with subquery */
-    ecs_matched_table_t *tables = ecs_vector_first(parent->tables, ecs_matched_table_t);
-    int32_t i, count = ecs_vector_count(parent->tables);
+static
+void ecs_log_error(const char *fmt, va_list args) {
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+}
 
-    for (i = 0; i < count; i ++) {
-        ecs_matched_table_t *table = &tables[i];
-        match_table(world, subquery, table->data.table);
-        activate_table(world, subquery, table->data.table, true);
+static
+void ecs_log_debug(const char *fmt, va_list args) {
+    vfprintf(stdout, fmt, args);
+    fprintf(stdout, "\n");
+}
+
+static
+void ecs_log_warning(const char *fmt, va_list args) {
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+}
+
+void ecs_os_dbg(const char *fmt, ...) {
+#ifndef NDEBUG
+    va_list args;
+    va_start(args, fmt);
+    if (ecs_os_api.log_debug_) {
+        ecs_os_api.log_debug_(fmt, args);
     }
+    va_end(args);
+#else
+    (void)fmt;
+#endif
+}
 
-    /* Do the same for inactive tables */
-    tables = ecs_vector_first(parent->empty_tables, ecs_matched_table_t);
-    count = ecs_vector_count(parent->empty_tables);
+void ecs_os_warn(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (ecs_os_api.log_warning_) {
+        ecs_os_api.log_warning_(fmt, args);
+    }
+    va_end(args);
+}
 
-    for (i = 0; i < count; i ++) {
-        ecs_matched_table_t *table = &tables[i];
-        match_table(world, subquery, table->data.table);
-    }    
+void ecs_os_log(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (ecs_os_api.log_) {
+        ecs_os_api.log_(fmt, args);
+    }
+    va_end(args);
 }
 
-static
-void notify_subqueries(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_query_event_t *event)
+void ecs_os_err(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (ecs_os_api.log_error_) {
+        ecs_os_api.log_error_(fmt, args);
+    }
+    va_end(args);
+}
+
+void ecs_os_gettime(ecs_time_t *time)
 {
-    if (query->subqueries) {
-        ecs_query_t **queries = ecs_vector_first(query->subqueries, ecs_query_t*);
-        int32_t i, count = ecs_vector_count(query->subqueries);
+    uint64_t now = ecs_os_time_now();
+    uint64_t sec = now / 1000000000;
 
-        ecs_query_event_t sub_event = *event;
-        sub_event.parent_query = query;
+    assert(sec < UINT32_MAX);
+    assert((now - sec * 1000000000) < UINT32_MAX);
 
-        for (i = 0; i < count; i ++) {
-            ecs_query_t *sub = queries[i];
-            ecs_query_notify(world, sub, &sub_event);
-        }
-    }
+    time->sec = (uint32_t)sec;
+    time->nanosec = (uint32_t)(now - sec * 1000000000);
 }
 
 static
-void free_matched_table(
-    ecs_matched_table_t *table)
-{
-    ecs_os_free(table->data.columns);
-    ecs_os_free(table->data.components);
-    ecs_os_free((ecs_vector_t**)table->data.types);
-    ecs_os_free(table->data.references);
-    ecs_os_free(table->sparse_columns);
-    ecs_os_free(table->monitor);
+void* ecs_os_api_malloc(ecs_size_t size) {
+    ecs_os_api_malloc_count ++;
+    ecs_assert(size > 0, ECS_INVALID_PARAMETER, NULL);
+    return malloc((size_t)size);
 }
 
-/* Remove table */
 static
-void remove_table(
-    ecs_vector_t *tables,
-    int32_t index)
-{
-    ecs_matched_table_t *table = ecs_vector_get(
-        tables, ecs_matched_table_t, index);
-    free_matched_table(table);
-    ecs_vector_remove_index(tables, ecs_matched_table_t, index);
+void* ecs_os_api_calloc(ecs_size_t size) {
+    ecs_os_api_calloc_count ++;
+    ecs_assert(size > 0, ECS_INVALID_PARAMETER, NULL);
+    return calloc(1, (size_t)size);
 }
 
 static
-void unmatch_table_w_index(
-    ecs_query_t *query,
-    ecs_table_t *table,
-    int32_t match)
-{
-    /* If table no longer matches, remove it */
-    if (match != -1) {
-        remove_table(query->tables, match);
+void* ecs_os_api_realloc(void *ptr, ecs_size_t size) {
+    ecs_assert(size > 0, ECS_INVALID_PARAMETER, NULL);
+
+    if (ptr) {
+        ecs_os_api_realloc_count ++;
     } else {
-        /* Make sure the table is removed if it was inactive */
-        match = table_matched(
-            query->empty_tables, table);
-        if (match != -1) {
-            remove_table(query->empty_tables, match);
-        }
-    }  
+        /* If not actually reallocing, treat as malloc */
+        ecs_os_api_malloc_count ++; 
+    }
+    
+    return realloc(ptr, (size_t)size);
 }
 
 static
-void unmatch_table(
-    ecs_query_t *query,
-    ecs_table_t *table)
-{
-    unmatch_table_w_index(
-        query, table, table_matched(query->tables, table));       
+void ecs_os_api_free(void *ptr) {
+    if (ptr) {
+        ecs_os_api_free_count ++;
+    }
+    free(ptr);
 }
 
 static
-void rematch_table(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_table_t *table)
-{
-    int32_t match = table_matched(query->tables, table);
-
-    if (ecs_query_match(world, table, query, NULL)) {
-        /* If the table matches, and it is not currently matched, add */
-        if (match == -1) {
-            if (table_matched(query->empty_tables, table) == -1) {
-                add_table(world, query, table);
-            }
-
-        /* If table still matches and has cascade column, reevaluate the
-         * sources of references. This may have changed in case 
-         * components were added/removed to container entities */ 
-        } else if (query->cascade_by) {
-            resolve_cascade_container(
-                world, query, match, table->type);
+char* ecs_os_api_strdup(const char *str) {
+    int len = ecs_os_strlen(str);
+    char *result = ecs_os_malloc(len + 1);
+    ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
+    ecs_os_strcpy(result, str);
+    return result;
+}
 
-        /* If query has optional columns, it is possible that a column that
-         * previously had data no longer has data, or vice versa. Do a full
-         * rematch to make sure data is consistent. */
-        } else if (query->flags & EcsQueryHasOptional) {
-            unmatch_table(query, table);
-            if (!(query->flags & EcsQueryIsSubquery)) {
-                ecs_table_notify(world, table, &(ecs_table_event_t){
-                    .kind = EcsTableQueryUnmatch,
-                    .query = query
-                }); 
-            }
-            add_table(world, query, table);
-        }
-    } else {
-        /* Table no longer matches, remove */
-        if (match != -1) {
-            unmatch_table(query, table);
-            if (!(query->flags & EcsQueryIsSubquery)) {
-                ecs_table_notify(world, table, &(ecs_table_event_t){
-                    .kind = EcsTableQueryUnmatch,
-                    .query = query
-                });
-            }
-            notify_subqueries(world, query, &(ecs_query_event_t){
-                .kind = EcsQueryTableUnmatch,
-                .table = table
-            });
+/* Replace dots with underscores */
+static
+char *module_file_base(const char *module, char sep) {
+    char *base = ecs_os_strdup(module);
+    ecs_size_t i, len = ecs_os_strlen(base);
+    for (i = 0; i < len; i ++) {
+        if (base[i] == '.') {
+            base[i] = sep;
         }
     }
+
+    return base;
 }
 
-/* Rematch system with tables after a change happened to a watched entity */
 static
-void rematch_tables(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_query_t *parent_query)
-{
-    if (parent_query) {
-        ecs_matched_table_t *tables = ecs_vector_first(parent_query->tables, ecs_matched_table_t);
-        int32_t i, count = ecs_vector_count(parent_query->tables);
-        for (i = 0; i < count; i ++) {
-            ecs_table_t *table = tables[i].data.table;
-            rematch_table(world, query, table);
-        }
+char* ecs_os_api_module_to_dl(const char *module) {
+    ecs_strbuf_t lib = ECS_STRBUF_INIT;
 
-        tables = ecs_vector_first(parent_query->empty_tables, ecs_matched_table_t);
-        count = ecs_vector_count(parent_query->empty_tables);
-        for (i = 0; i < count; i ++) {
-            ecs_table_t *table = tables[i].data.table;
-            rematch_table(world, query, table);
-        }        
-    } else {
-        ecs_sparse_t *tables = world->store.tables;
-        int32_t i, count = ecs_sparse_count(tables);
+    /* Best guess, use module name with underscores + OS library extension */
+    char *file_base = module_file_base(module, '_');
 
-        for (i = 0; i < count; i ++) {
-            /* Is the system currently matched with the table? */
-            ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
-            rematch_table(world, query, table);
-        }
-    }
+#if defined(ECS_OS_LINUX)
+    ecs_strbuf_appendstr(&lib, "lib");
+    ecs_strbuf_appendstr(&lib, file_base);
+    ecs_strbuf_appendstr(&lib, ".so");
+#elif defined(ECS_OS_DARWIN)
+    ecs_strbuf_appendstr(&lib, "lib");
+    ecs_strbuf_appendstr(&lib, file_base);
+    ecs_strbuf_appendstr(&lib, ".dylib");
+#elif defined(ECS_OS_WINDOWS)
+    ecs_strbuf_appendstr(&lib, file_base);
+    ecs_strbuf_appendstr(&lib, ".dll");
+#endif
 
-    group_tables(world, query);
-    order_ranked_tables(world, query);
+    ecs_os_free(file_base);
 
-    /* Enable/disable system if constraints are (not) met. If the system is
-     * already dis/enabled this operation has no side effects. */
-    if (query->system) {
-        if (ecs_sig_check_constraints(world, &query->sig)) {
-            ecs_remove_entity(world, query->system, EcsDisabledIntern);
-        } else {
-            ecs_add_entity(world, query->system, EcsDisabledIntern);
-        }
-    }
+    return ecs_strbuf_get(&lib);
 }
 
 static
-void remove_subquery(
-    ecs_query_t *parent, 
-    ecs_query_t *sub)
-{
-    ecs_assert(parent != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(sub != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(parent->subqueries != NULL, ECS_INTERNAL_ERROR, NULL);
+char* ecs_os_api_module_to_etc(const char *module) {
+    ecs_strbuf_t lib = ECS_STRBUF_INIT;
 
-    int32_t i, count = ecs_vector_count(parent->subqueries);
-    ecs_query_t **sq = ecs_vector_first(parent->subqueries, ecs_query_t*);
+    /* Best guess, use module name with dashes + /etc */
+    char *file_base = module_file_base(module, '-');
 
-    for (i = 0; i < count; i ++) {
-        if (sq[i] == sub) {
-            break;
-        }
-    }
+    ecs_strbuf_appendstr(&lib, file_base);
+    ecs_strbuf_appendstr(&lib, "/etc");
 
-    ecs_vector_remove_index(parent->subqueries, ecs_query_t*, i);
-}
+    ecs_os_free(file_base);
 
-/* -- Private API -- */
+    return ecs_strbuf_get(&lib);
+}
 
-void ecs_query_notify(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_query_event_t *event)
+void ecs_os_set_api_defaults(void)
 {
-    bool notify = true;
-
-    switch(event->kind) {
-    case EcsQueryTableMatch:
-        /* Creation of new table */
-        if (match_table(world, query, event->table)) {
-            if (query->subqueries) {
-                notify_subqueries(world, query, event);
-            }
-        }
-        notify = false;
-        break;
-    case EcsQueryTableUnmatch:
-        /* Deletion of table */
-        unmatch_table(query, event->table);
-        break;
-    case EcsQueryTableRematch:
-        /* Rematch tables of query */
-        rematch_tables(world, query, event->parent_query);
-        break;        
-    case EcsQueryTableEmpty:
-        /* Table is empty, deactivate */
-        activate_table(world, query, event->table, false);
-        break;
-    case EcsQueryTableNonEmpty:
-        /* Table is non-empty, activate */
-        activate_table(world, query, event->table, true);
-        break;
-    case EcsQueryOrphan:
-        ecs_assert(query->flags & EcsQueryIsSubquery, ECS_INTERNAL_ERROR, NULL);
-        query->flags |= EcsQueryIsOrphaned;
-        query->parent = NULL;
-        break;
+    /* Don't overwrite if already initialized */
+    if (ecs_os_api_initialized != 0) {
+        return;
     }
 
-    if (notify) {
-        notify_subqueries(world, query, event);
-    }
-}
+    ecs_os_time_setup();
+    
+    /* Memory management */
+    ecs_os_api.malloc_ = ecs_os_api_malloc;
+    ecs_os_api.free_ = ecs_os_api_free;
+    ecs_os_api.realloc_ = ecs_os_api_realloc;
+    ecs_os_api.calloc_ = ecs_os_api_calloc;
 
-/* -- Public API -- */
+    /* Strings */
+    ecs_os_api.strdup_ = ecs_os_api_strdup;
 
-ecs_query_t* ecs_query_new_w_sig_intern(
-    ecs_world_t *world,
-    ecs_entity_t system,
-    ecs_sig_t *sig,
-    bool is_subquery)
-{
-    ecs_query_t *result = ecs_os_calloc(sizeof(ecs_query_t));
-    result->world = world;
-    result->sig = *sig;
-    result->tables = ecs_vector_new(ecs_matched_table_t, 0);
-    result->empty_tables = ecs_vector_new(ecs_matched_table_t, 0);
-    result->system = system;
-    result->prev_match_count = -1;
+    /* Time */
+    ecs_os_api.sleep_ = ecs_os_time_sleep;
+    ecs_os_api.get_time_ = ecs_os_gettime;
 
-    if (is_subquery) {
-        result->flags |= EcsQueryIsSubquery;
-    }
+    /* Logging */
+    ecs_os_api.log_ = ecs_log;
+    ecs_os_api.log_error_ = ecs_log_error;
+    ecs_os_api.log_debug_ = ecs_log_debug;
+    ecs_os_api.log_warning_ = ecs_log_warning;
 
-    process_signature(world, result);
+    /* Modules */
+    if (!ecs_os_api.module_to_dl_) {
+        ecs_os_api.module_to_dl_ = ecs_os_api_module_to_dl;
+    }
 
-    ecs_trace_2("query #[green]%s#[reset] created with expression #[red]%s", 
-        query_name(world, result), result->sig.expr);
+    if (!ecs_os_api.module_to_etc_) {
+        ecs_os_api.module_to_etc_ = ecs_os_api_module_to_etc;
+    }
 
-    ecs_log_push();
+    ecs_os_api.abort_ = abort;
+}
 
-    if (!is_subquery) {
-        /* Register query with world */
-        ecs_query_t **elem = ecs_vector_add(&world->queries, ecs_query_t*);
-        *elem = result;
+bool ecs_os_has_heap(void) {
+    return 
+        (ecs_os_api.malloc_ != NULL) &&
+        (ecs_os_api.calloc_ != NULL) &&
+        (ecs_os_api.realloc_ != NULL) &&
+        (ecs_os_api.free_ != NULL);
+}
 
-        if (result->flags & EcsQueryNeedsTables) {
-            if (ecs_has_entity(world, system, EcsMonitor)) {
-                result->flags |= EcsQueryMonitor;
-            }
-            
-            if (ecs_has_entity(world, system, EcsOnSet)) {
-                result->flags |= EcsQueryOnSet;
-            }
+bool ecs_os_has_threading(void) {
+    return
+        (ecs_os_api.mutex_new_ != NULL) &&
+        (ecs_os_api.mutex_free_ != NULL) &&
+        (ecs_os_api.mutex_lock_ != NULL) &&
+        (ecs_os_api.mutex_unlock_ != NULL) &&
+        (ecs_os_api.cond_new_ != NULL) &&
+        (ecs_os_api.cond_free_ != NULL) &&
+        (ecs_os_api.cond_wait_ != NULL) &&
+        (ecs_os_api.cond_signal_ != NULL) &&
+        (ecs_os_api.cond_broadcast_ != NULL) &&
+        (ecs_os_api.thread_new_ != NULL) &&
+        (ecs_os_api.thread_join_ != NULL);   
+}
 
-            if (ecs_has_entity(world, system, EcsUnSet)) {
-                result->flags |= EcsQueryUnSet;
-            }        
+bool ecs_os_has_time(void) {
+    return 
+        (ecs_os_api.get_time_ != NULL) &&
+        (ecs_os_api.sleep_ != NULL);
+}
 
-            match_tables(world, result);
-        } else {
-            /* Add stub table that resolves references (if any) so everything is
-            * preprocessed when the query is evaluated. */
-            add_table(world, result, NULL);
-        }
-    }
+bool ecs_os_has_logging(void) {
+    return 
+        (ecs_os_api.log_ != NULL) &&
+        (ecs_os_api.log_error_ != NULL) &&
+        (ecs_os_api.log_debug_ != NULL) &&
+        (ecs_os_api.log_warning_ != NULL);
+}
 
-    if (result->cascade_by) {
-        result->group_table = rank_by_depth;
-    }
+bool ecs_os_has_dl(void) {
+    return 
+        (ecs_os_api.dlopen_ != NULL) &&
+        (ecs_os_api.dlproc_ != NULL) &&
+        (ecs_os_api.dlclose_ != NULL);  
+}
 
-    ecs_log_pop();
+bool ecs_os_has_modules(void) {
+    return 
+        (ecs_os_api.module_to_dl_ != NULL) &&
+        (ecs_os_api.module_to_etc_ != NULL);
+}
 
-    /* Make sure application can't try to free sig resources */
-    *sig = (ecs_sig_t){ 0 };
+#ifdef FLECS_SYSTEMS_H
+#ifndef FLECS_SYSTEM_PRIVATE_H
+#define FLECS_SYSTEM_PRIVATE_H
 
-    return result;
-}
 
-ecs_query_t* ecs_query_new_w_sig(
+typedef struct EcsSystem {
+    ecs_iter_action_t action;       /* Callback to be invoked for matching it */
+    void *ctx;                      /* Userdata for system */
+
+    ecs_entity_t entity;                  /* Entity id of system, used for ordering */
+    ecs_query_t *query;                   /* System query */
+    ecs_on_demand_out_t *on_demand;       /* Keep track of [out] column refs */
+    ecs_system_status_action_t status_action; /* Status action */
+    void *status_ctx;                     /* User data for status action */    
+    ecs_entity_t tick_source;             /* Tick source associated with system */
+    
+    int32_t invoke_count;                 /* Number of times system is invoked */
+    float time_spent;                     /* Time spent on running system */
+    float time_passed;                    /* Time passed since last invocation */
+
+    int32_t entity_budget;                /* Max entities per run (0 = no limit) */
+    float time_budget;                    /* Max seconds per run (0 = no limit) */
+    int32_t cursor;                       /* Offset where next run resumes */
+} EcsSystem;
+
+/* Invoked when system becomes active / inactive */
+void ecs_system_activate(
     ecs_world_t *world,
     ecs_entity_t system,
-    ecs_sig_t *sig)
-{
-    return ecs_query_new_w_sig_intern(world, system, sig, false);
-}
+    bool activate,
+    const EcsSystem *system_data);
 
-ecs_query_t* ecs_query_new(
+/* Internal function to run a system */
+ecs_entity_t ecs_run_intern(
     ecs_world_t *world,
-    const char *expr)
-{
-    ecs_sig_t sig = { 0 };
-    ecs_sig_init(world, NULL, expr, &sig);
-    return ecs_query_new_w_sig(world, 0, &sig);
-}
+    ecs_stage_t *stage,
+    ecs_entity_t system,
+    EcsSystem *system_data,
+    float delta_time,
+    int32_t offset,
+    int32_t limit,
+    const ecs_filter_t *filter,
+    void *param,
+    bool ran_by_app);
 
-ecs_query_t* ecs_subquery_new(
+#endif
+#endif
+
+void activate_table(
     ecs_world_t *world,
-    ecs_query_t *parent,
-    const char *expr)
-{
-    ecs_sig_t sig = { 0 };
-    ecs_sig_init(world, NULL, expr, &sig);
-    ecs_query_t *result = ecs_query_new_w_sig_intern(world, 0, &sig, true);
-    result->parent = parent;
-    add_subquery(world, parent, result);
-    return result;
-}
+    ecs_query_t *query,
+    ecs_table_t *table,
+    bool active);
 
-void ecs_query_free(
-    ecs_query_t *query)
+static
+ecs_entity_t components_contains(
+    ecs_world_t *world,
+    ecs_type_t table_type,
+    ecs_type_t type,
+    ecs_entity_t *entity_out,
+    bool match_all)
 {
-    ecs_world_t *world = query->world;
-
-    if ((query->flags & EcsQueryIsSubquery) &&
-        !(query->flags & EcsQueryIsOrphaned))
-    {
-        remove_subquery(query->parent, query);
-    }
-
-    notify_subqueries(world, query, &(ecs_query_event_t){
-        .kind = EcsQueryOrphan
-    });
+    ecs_vector_each(table_type, ecs_entity_t, c_ptr, {
+        ecs_entity_t entity = *c_ptr;
 
-    ecs_vector_each(query->empty_tables, ecs_matched_table_t, table, {
-        free_matched_table(table);
-    });
+        if (ECS_HAS_ROLE(entity, CHILDOF)) {
+            entity &= ECS_COMPONENT_MASK;
 
-    ecs_vector_each(query->tables, ecs_matched_table_t, table, {
-        free_matched_table(table);
-    });
+            ecs_record_t *record = ecs_eis_get(world, entity);
+            ecs_assert(record != 0, ECS_INTERNAL_ERROR, NULL);
 
-    ecs_vector_free(query->subqueries);
-    ecs_vector_free(query->tables);
-    ecs_vector_free(query->empty_tables);
-    ecs_vector_free(query->table_slices);
-    ecs_sig_deinit(&query->sig);
+            if (record->table) {
+                ecs_entity_t component = ecs_type_contains(
+                    world, record->table->type, type, match_all, true);
 
-    /* Find query in vector */
-    if (!(query->flags & EcsQueryIsSubquery) && world->queries) {
-        int32_t index = -1;
-        ecs_vector_each(world->queries, ecs_query_t*, q_ptr, {
-            if (*q_ptr == query) {
-                index = q_ptr_i;
+                if (component) {
+                    if (entity_out) *entity_out = entity;
+                    return component;
+                }
             }
-        });
-
-        ecs_assert(index != -1, ECS_INTERNAL_ERROR, NULL);
-        ecs_vector_remove_index(world->queries, ecs_query_t*, index);
-    }
+        }
+    });
 
-    ecs_os_free(query);
+    return 0;
 }
 
-/* Create query iterator */
-ecs_iter_t ecs_query_iter_page(
-    ecs_query_t *query,
-    int32_t offset,
-    int32_t limit)
+/* Get actual entity on which specified component is stored */
+static
+ecs_entity_t get_entity_for_component(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_type_t type,
+    ecs_entity_t component)
 {
-    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);
-
-    sort_tables(query->world, query);
-
-    tables_reset_dirty(query);
-
-    int32_t table_count;
-    if (query->table_slices) {
-        table_count = ecs_vector_count(query->table_slices);
-    } else {
-        table_count = ecs_vector_count(query->tables);
+    if (entity) {
+        ecs_record_t *record = ecs_eis_get(world, entity);
+        ecs_assert(record != NULL, ECS_INTERNAL_ERROR, NULL);
+        if (record->table) {
+            type = record->table->type;
+        } else {
+            type = NULL;
+        }
     }
 
-    ecs_query_iter_t it = {
-        .query = query,
-        .page_iter = {
-            .offset = offset,
-            .limit = limit,
-            .remaining = limit
-        },
-        .index = 0,
-    };
+    ecs_vector_each(type, ecs_entity_t, c_ptr, {
+        if (*c_ptr == component) {
+            return entity;
+        }
+    });
 
-    return (ecs_iter_t){
-        .world = query->world,
-        .query = query,
-        .column_count = ecs_vector_count(query->sig.columns),
-        .table_count = table_count,
-        .inactive_table_count = ecs_vector_count(query->empty_tables),
-        .iter.query = it
-    };
+    return ecs_find_entity_in_prefabs(world, entity, type, component, 0);
 }
 
-ecs_iter_t ecs_query_iter(
+#ifndef NDEBUG
+static
+ecs_entity_t get_cascade_component(
     ecs_query_t *query)
 {
-    return ecs_query_iter_page(query, 0, 0);
+    ecs_sig_column_t *column = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
+    return column[query->cascade_by - 1].is.component;
 }
+#endif
 
-void ecs_query_set_iter(
+static
+int32_t rank_by_depth(
     ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_iter_t *it,
-    int32_t table_index,
-    int32_t row,
-    int32_t count)
-{
-    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);
-    
-    ecs_matched_table_t *table_data = ecs_vector_get(
-        query->tables, ecs_matched_table_t, table_index);
-    ecs_assert(table_data != NULL, ECS_INTERNAL_ERROR, NULL);
-
-    ecs_table_t *table = table_data->data.table;
-    ecs_data_t *data = ecs_table_get_data(table);
-    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
-    
-    ecs_entity_t *entity_buffer = ecs_vector_first(data->entities, ecs_entity_t);  
-    it->entities = &entity_buffer[row];
-
-    it->world = world;
-    it->query = query;
-    it->column_count = ecs_vector_count(query->sig.columns);
-    it->table_count = 1;
-    it->inactive_table_count = 0;
-    it->table_columns = data->columns;
-    it->table = &table_data->data;
-    it->offset = row;
-    it->count = count;
-    it->total_count = count;
-}
-
-int ecs_page_iter_next(
-    ecs_page_iter_t *it,
-    ecs_page_cursor_t *cur)
+    ecs_entity_t rank_by_component,
+    ecs_type_t type)
 {
-    int32_t offset = it->offset;
-    int32_t limit = it->limit;
-    if (!(offset || limit)) {
-        return cur->count == 0;
-    }
+    int32_t result = 0;
+    int32_t i, count = ecs_vector_count(type);
+    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
 
-    int32_t count = cur->count;
-    int32_t remaining = it->remaining;
+    for (i = count - 1; i >= 0; i --) {
+        if (ECS_HAS_ROLE(array[i], CHILDOF)) {
+            ecs_type_t c_type = ecs_get_type(world, array[i] & ECS_COMPONENT_MASK);
+            int32_t j, c_count = ecs_vector_count(c_type);
+            ecs_entity_t *c_array = ecs_vector_first(c_type, ecs_entity_t);
 
-    if (offset) {
-        if (offset > count) {
-            /* No entities to iterate in current table */
-            it->offset -= count;
-            return 1;
-        } else {
-            cur->first += offset;
-            count = cur->count -= offset;
-            it->offset = 0;
-        }
-    }
+            for (j = 0; j < c_count; j ++) {
+                if (c_array[j] == rank_by_component) {
+                    result ++;
+                    result += rank_by_depth(world, rank_by_component, c_type);
+                    break;
+                }
+            }
 
-    if (remaining) {
-        if (remaining > count) {
-            it->remaining -= count;
-        } else {
-            count = cur->count = remaining;
-            it->remaining = 0;
+            if (j != c_count) {
+                break;
+            }
+        } else if (!(array[i] & ECS_ROLE_MASK)) {
+            /* No more parents after this */
+            break;
         }
-    } else if (limit) {
-        /* Limit hit: no more entities left to iterate */
-        return -1;
     }
 
-    return count == 0;
+    return result;
 }
 
 static
-int find_smallest_column(
-    ecs_table_t *table,
-    ecs_matched_table_t *table_data,
-    ecs_vector_t *sparse_columns)
+int table_compare(
+    const void *t1,
+    const void *t2)
 {
-    ecs_sparse_column_t *sparse_column_array = 
-        ecs_vector_first(sparse_columns, ecs_sparse_column_t);
-    int32_t i, count = ecs_vector_count(sparse_columns);
-    int32_t min = INT_MAX, index = 0;
-
-    for (i = 0; i < count; i ++) {
-        /* The array with sparse queries for the matched table */
-        ecs_sparse_column_t *sparse_column = &sparse_column_array[i];
-
-        /* Pointer to the switch column struct of the table */
-        ecs_sw_column_t *sc = sparse_column->sw_column;
-
-        /* If the sparse column pointer hadn't been retrieved yet, do it now */
-        if (!sc) {
-            /* Get the table column index from the signature column index */
-            int32_t table_column_index = table_data->data.columns[
-                sparse_column->signature_column_index];
-
-            /* Translate the table column index to switch column index */
-            table_column_index -= table->sw_column_offset;
-            ecs_assert(table_column_index >= 1, ECS_INTERNAL_ERROR, NULL);
+    const ecs_matched_table_t *table_1 = t1;
+    const ecs_matched_table_t *table_2 = t2;
 
-            /* Get the sparse column */
-            ecs_data_t *data = ecs_table_get_data(table);
-            sc = sparse_column->sw_column = 
-                &data->sw_columns[table_column_index - 1];
-        }
+    return table_1->rank - table_2->rank;
+}
 
-        /* Find the smallest column */
-        ecs_switch_t *sw = sc->data;
-        int32_t case_count = ecs_switch_case_count(sw, sparse_column->sw_case);
-        if (case_count < min) {
-            min = case_count;
-            index = i + 1;
-        }
+/** Store the index of a matched table in the query table slots, so that the
+ * table can be found without searching the vector of matched tables. */
+static
+void set_table_slot(
+    ecs_query_t *query,
+    ecs_vector_t *tables,
+    int32_t index,
+    bool active)
+{
+    if (!query->table_slots || index >= ecs_vector_count(tables)) {
+        return;
     }
 
-    return index;
+    ecs_matched_table_t *table_data = ecs_vector_get(
+        tables, ecs_matched_table_t, index);
+    ecs_table_t *table = table_data->data.table;
+    if (table) {
+        ecs_query_table_slot_t slot = { .index = index, .active = active };
+        ecs_map_set(query->table_slots, table->id, &slot);
+    }
 }
 
+/** Store the range of active tables for each rank. Tables are sorted by rank,
+ * so tables with the same rank are stored next to each other. */
 static
-int sparse_column_next(
-    ecs_table_t *table,
-    ecs_matched_table_t *matched_table,
-    ecs_vector_t *sparse_columns,
-    ecs_query_iter_t *iter,
-    ecs_page_cursor_t *cur)
+void build_groups(
+    ecs_query_t *query)
 {
-    bool first_iteration = false;
-    int32_t sparse_smallest;
-
-    if (!(sparse_smallest = iter->sparse_smallest)) {
-        sparse_smallest = iter->sparse_smallest = find_smallest_column(
-            table, matched_table, sparse_columns);
-        first_iteration = true;
+    if (!query->groups) {
+        query->groups = ecs_map_new(ecs_query_group_t, 0);
+    } else {
+        ecs_map_clear(query->groups);
     }
 
-    sparse_smallest -= 1;
+    ecs_matched_table_t *tables = ecs_vector_first(
+        query->tables, ecs_matched_table_t);
+    int32_t i, count = ecs_vector_count(query->tables);
+    ecs_query_group_t *group = NULL;
+    int32_t rank = 0;
 
-    ecs_sparse_column_t *columns = ecs_vector_first(
-        sparse_columns, ecs_sparse_column_t);
-    ecs_sparse_column_t *column = &columns[sparse_smallest];
-    ecs_switch_t *sw, *sw_smallest = column->sw_column->data;
-    ecs_entity_t case_smallest = column->sw_case;
+    for (i = 0; i < count; i ++) {
+        if (!group || tables[i].rank != rank) {
+            rank = tables[i].rank;
+            ecs_query_group_t new_group = { .first = i };
+            ecs_map_set(query->groups, (uint32_t)rank, &new_group);
+            group = ecs_map_get(query->groups, ecs_query_group_t, (uint32_t)rank);
+        }
 
-    /* Find next entity to iterate in sparse column */
-    int32_t first;
-    if (first_iteration) {
-        first = ecs_switch_first(sw_smallest, case_smallest);
-    } else {
-        first = ecs_switch_next(sw_smallest, iter->sparse_first);
+        group->count ++;
     }
+}
 
-    if (first == -1) {
-        goto done;
-    }    
+static
+void order_ranked_tables(
+    ecs_world_t *world,
+    ecs_query_t *query)
+{
+    if (query->group_table) {
+        ecs_vector_sort(query->tables, ecs_matched_table_t, table_compare);
 
-    /* Check if entity matches with other sparse columns, if any */
-    int32_t i, count = ecs_vector_count(sparse_columns);
-    do {
+        int32_t i, count = ecs_vector_count(query->tables);
         for (i = 0; i < count; i ++) {
-            if (i == sparse_smallest) {
-                /* Already validated this one */
-                continue;
-            }
-
-            column = &columns[i];
-            sw = column->sw_column->data;
-
-            if (ecs_switch_get(sw, first) != column->sw_case) {
-                first = ecs_switch_next(sw_smallest, first);
-                if (first == -1) {
-                    goto done;
-                }
-            }
+            set_table_slot(query, query->tables, i, true);
         }
-    } while (i != count);
 
-    cur->first = iter->sparse_first = first;
-    cur->count = 1;
+        build_groups(query);
+    }
 
-    return 0;
-done:
-    /* Iterated all elements in the sparse list, we should move to the
-     * next matched table. */
-    iter->sparse_smallest = 0;
-    iter->sparse_first = 0;
+    /* Re-register monitors after tables have been reordered. This will update
+     * the table administration with the new matched_table ids, so that when a
+     * monitor is executed we can quickly find the right matched_table. */
+    if (query->flags & EcsQueryMonitor) {
+        ecs_vector_each(query->tables, ecs_matched_table_t, table, {
+            ecs_table_notify(world, table->data.table, &(ecs_table_event_t){
+                .kind = EcsTableQueryMatch,
+                .query = query,
+                .matched_table_index = table_i
+            });
+        });
+    }
 
-    return -1;
+    query->match_count ++; 
 }
 
 static
-void mark_columns_dirty(
+void group_table(
+    ecs_world_t *world,
     ecs_query_t *query,
-    ecs_matched_table_t *table_data)
+    ecs_matched_table_t *table)
 {
-    ecs_table_t *table = table_data->data.table;
-
-    if (table && table->dirty_state) {
-        int32_t i, count = ecs_vector_count(query->sig.columns);
-        ecs_sig_column_t *columns = ecs_vector_first(
-            query->sig.columns, ecs_sig_column_t);
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
 
-        for (i = 0; i < count; i ++) {
-            if (columns[i].inout_kind != EcsIn) {
-                int32_t table_column = table_data->data.columns[i];
-                if (table_column > 0) {
-                    table->dirty_state[table_column] ++;
-                }
-            }
-        }
+    if (query->group_table) {
+        ecs_assert(table->data.table != NULL, ECS_INTERNAL_ERROR, NULL);
+        table->rank = query->group_table(
+            world, query->rank_on_component, table->data.table->type);
+    } else {
+        table->rank = 0;
     }
 }
 
-/* Return next table */
-bool ecs_query_next(
-    ecs_iter_t *it)
+/* Rank all tables of query. Only necessary if a new ranking function was
+ * provided or if a monitored entity set the component used for ranking. */
+static
+void group_tables(
+    ecs_world_t *world,
+    ecs_query_t *query)
 {
-    ecs_assert(it != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_query_iter_t *iter = &it->iter.query;
-    ecs_page_iter_t *piter = &iter->page_iter;
-    ecs_world_t *world = it->world;
-    ecs_query_t *query = iter->query;
-
-    ecs_get_stage(&world);
-    ecs_table_slice_t *slice = ecs_vector_first(
-        query->table_slices, ecs_table_slice_t);
-    ecs_matched_table_t *tables = ecs_vector_first(
-        query->tables, ecs_matched_table_t);
-
-    ecs_assert(!slice || query->compare, ECS_INTERNAL_ERROR, NULL);
-    
-    ecs_page_cursor_t cur;
-    int32_t table_count = it->table_count;
-    int32_t prev_count = it->total_count;
-
-    int i;
-    for (i = iter->index; i < table_count; i ++) {
-        ecs_matched_table_t *table_data = slice ? slice[i].table : &tables[i];
-        ecs_table_t *table = table_data->data.table;
-        ecs_data_t *data = NULL;
-
-        iter->index = i + 1;
-        
-        if (table) {
-            ecs_vector_t *sparse_columns = table_data->sparse_columns;
-            data = ecs_table_get_data(table);
-            ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
-            it->table_columns = data->columns;
-            
-            if (slice) {
-                cur.first = slice[i].start_row;
-                cur.count = slice[i].count;
-            } else {
-                cur.first = 0;
-                cur.count = ecs_table_count(table);
-            }
-
-            if (cur.count) {
-                if (sparse_columns) {
-                    if (sparse_column_next(table, table_data,
-                        sparse_columns, iter, &cur) == -1)
-                    {
-                        /* No more elements in sparse column */
-                        continue;    
-                    } else {
-                        iter->index = i;
-                    }
-                }
-
-                int ret = ecs_page_iter_next(piter, &cur);
-                if (ret < 0) {
-                    return false;
-                } else if (ret > 0) {
-                    continue;
-                }
-            } else {
-                continue;
-            }
+    if (query->group_table) {
+        ecs_vector_each(query->tables, ecs_matched_table_t, table, {
+            group_table(world, query, table);
+        });
 
-            ecs_entity_t *entity_buffer = ecs_vector_first(
-                data->entities, ecs_entity_t); 
-            it->entities = &entity_buffer[cur.first];
-            it->offset = cur.first;
-            it->count = cur.count;
-            it->total_count = cur.count;
-        }
+        ecs_vector_each(query->empty_tables, ecs_matched_table_t, table, {
+            group_table(world, query, table);
+        });              
+    }
+}
 
-        it->table = &table_data->data;
-        it->frame_offset += prev_count;
+static
+bool has_auto_activation(
+    ecs_query_t *q)
+{
+    /* Only a basic query with no additional features does table activation */
+    return !(q->flags & EcsQueryNoActivation);
+}
 
-        if (query->flags & EcsQueryHasOutColumns) {
-            if (table) {
-                mark_columns_dirty(query, table_data);
-            }
-        }
+#ifndef NDEBUG
 
-        return true;
+static
+const char* query_name(
+    ecs_world_t *world,
+    ecs_query_t *q)
+{
+    if (q->system) {
+        return ecs_get_name(world, q->system);
+    } else {
+        return q->sig.expr;
     }
-
-    return false;
 }
 
-bool ecs_query_next_w_filter(
-    ecs_iter_t *iter,
-    const ecs_filter_t *filter)
+#endif
+
+static
+void get_comp_and_src(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_type_t table_type,
+    ecs_sig_column_t *column,
+    ecs_sig_oper_kind_t op,
+    ecs_sig_from_kind_t from,
+    ecs_entity_t *component_out,
+    ecs_entity_t *entity_out)
 {
-    ecs_table_t *table;
+    ecs_entity_t component = 0, entity = 0;
 
-    do {
-        if (!ecs_query_next(iter)) {
-            return false;
-        }
-        table = iter->table->table;
-    } while (filter && !ecs_table_match_filter(iter->world, table, filter));
-    
-    return true;
-}
+    if (op == EcsOperNot) {
+        entity = column->source;
+    }
 
-bool ecs_query_next_worker(
-    ecs_iter_t *it,
-    int32_t current,
-    int32_t total)
-{
-    int32_t per_worker, first, prev_offset = it->offset;
+    /* Column that retrieves data from self or a fixed entity */
+    if (from == EcsFromAny || from == EcsFromEntity || 
+        from == EcsFromOwned || from == EcsFromShared) 
+    {
+        if (op == EcsOperAnd || op == EcsOperNot || op == EcsOperOptional) {
+            component = column->is.component;
+        } else if (op == EcsOperAll) {
+            component = column->is.component & ECS_COMPONENT_MASK;
+        } else if (op == EcsOperOr) {
+            component = ecs_type_contains(
+                world, table_type, column->is.type, 
+                false, true);
+        }
 
-    do {
-        if (!ecs_query_next(it)) {
-            return false;
+        if (from == EcsFromEntity) {
+            entity = column->source;
         }
 
-        int32_t count = it->count;
-        per_worker = count / total;
-        first = per_worker * current;
+    /* Column that just passes a handle to the system (no data) */
+    } else if (from == EcsFromEmpty) {
+        component = column->is.component;
 
-        count -= per_worker * total;
+    /* Column that retrieves data from a dynamic entity */
+    } else if (from == EcsFromParent || from == EcsCascade) {
+        if (op == EcsOperAnd ||
+            op == EcsOperOptional)
+        {
+            component = column->is.component;
+            entity = ecs_find_in_type(
+                world, table_type, component, ECS_CHILDOF);
 
-        if (count) {
-            if (current < count) {
-                per_worker ++;
-                first += current;
-            } else {
-                first += count;
-            }
+        } else if (op == EcsOperOr) {
+            component = components_contains(
+                world,
+                table_type,
+                column->is.type,
+                &entity,
+                false);
         }
 
-        if (!per_worker && !(it->query->flags & EcsQueryNeedsTables)) {
-            if (current == 0) {
-                return true;
-            } else {
-                return false;
-            }
+    /* Column that retrieves data from a system */
+    } else if (from == EcsFromSystem) {
+        if (op == EcsOperAnd) {
+            component = column->is.component;
         }
-    } while (!per_worker);
 
-    it->frame_offset -= prev_offset;
-    it->count = per_worker;
-    it->offset += first;
-    it->entities = &it->entities[first];
-    it->frame_offset += first;
+        entity = query->system;
+    }
 
-    return true;
+    *component_out = component;
+    *entity_out = entity;
 }
 
-void ecs_query_order_by(
-    ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_entity_t sort_component,
-    ecs_compare_action_t compare)
-{
-    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);    
-    ecs_assert(query->flags & EcsQueryNeedsTables, ECS_INVALID_PARAMETER, NULL);
-
-    query->sort_on_component = sort_component;
-    query->compare = compare;
-
-    ecs_vector_free(query->table_slices);
-    query->table_slices = NULL;
+typedef struct trait_offset_t {
+    int32_t index;
+    int32_t count;
+} trait_offset_t;
 
-    sort_tables(world, query);    
+/* Get index for specified trait. Take into account that a trait can be matched
+ * multiple times per table, by keeping an offset of the last found index */
+static
+int32_t get_trait_index(
+    ecs_type_t table_type,
+    ecs_entity_t component,
+    int32_t column_index,
+    trait_offset_t *trait_offsets,
+    int32_t count)
+{
+    int32_t result;
 
-    if (!query->table_slices) {
-        build_sorted_tables(query);
+    /* The count variable keeps track of the number of times a trait has been
+     * matched with the current table. Compare the count to check if the index
+     * was already resolved for this iteration */
+    if (trait_offsets[column_index].count == count) {
+        /* If it was resolved, return the last stored index. Subtract one as the
+         * index is offset by one, to ensure we're not getting stuck on the same
+         * index. */
+        result = trait_offsets[column_index].index - 1;
+    } else {
+        /* First time for this iteration that the trait index is resolved, look
+         * it up in the type. */
+        result = ecs_type_trait_index_of(table_type, 
+            trait_offsets[column_index].index, component);
+        trait_offsets[column_index].index = result + 1;
+        trait_offsets[column_index].count = count;
     }
+    
+    return result;
 }
 
-void ecs_query_group_by(
+static
+int32_t get_component_index(
     ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_entity_t sort_component,
-    ecs_rank_type_action_t group_table_action)
+    ecs_table_t *table,
+    ecs_type_t table_type,
+    ecs_entity_t *component_out,
+    int32_t column_index,
+    ecs_sig_oper_kind_t op,
+    trait_offset_t *trait_offsets,
+    int32_t count)
 {
-    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);    
-    ecs_assert(query->flags & EcsQueryNeedsTables, ECS_INVALID_PARAMETER, NULL);
+    int32_t result = 0;
+    ecs_entity_t component = *component_out;
 
-    query->rank_on_component = sort_component;
-    query->group_table = group_table_action;
+    if (component) {
+        /* If requested component is a case, find the corresponding switch to
+         * lookup in the table */
+        if (ECS_HAS_ROLE(component, CASE)) {
+            result = ecs_table_switch_from_case(
+                world, table, component);
+            ecs_assert(result != -1, ECS_INTERNAL_ERROR, NULL);
 
-    group_tables(world, query);
+            result += table->sw_column_offset;
+        } else
+        if (ECS_HAS_ROLE(component, TRAIT)) { 
+            /* If only the lo part of the trait identifier is set, interpret it
+             * as the trait to match. This will match any instance of the trait
+             * on the entity and in a signature looks like "TRAIT | MyTrait". */
+            if (!ecs_entity_t_hi(component & ECS_COMPONENT_MASK)) {
+                ecs_assert(trait_offsets != NULL, 
+                    ECS_INTERNAL_ERROR, NULL);
 
-    order_ranked_tables(world, query);
+                /* Strip the TRAIT role */
+                component &= ECS_COMPONENT_MASK;
 
-    build_sorted_tables(query);
-}
+                /* Get index of trait. Start looking from the last trait index
+                 * as this may not be the first instance of the trait. */
+                result = get_trait_index(
+                    table_type, component, column_index, trait_offsets, count);
+                
+                if (result != -1) {
+                    /* If component of current column is a trait, get the actual 
+                     * trait type for the table, so the system can see which 
+                     * component the trait was applied to */   
+                    ecs_entity_t *trait = ecs_vector_get(
+                        table_type, ecs_entity_t, result);
+                    *component_out = *trait;
 
-bool ecs_query_changed(
-    ecs_query_t *query)
-{
-    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);
-    return tables_dirty(query);
-}
+                    /* Check if the trait is a tag or whether it has data */
+                    if (ecs_get(world, component, EcsComponent) == NULL) {
+                        /* If trait has no data associated with it, use the
+                         * component to which the trait has been added */
+                        component = ecs_entity_t_lo(*trait);
+                    }
+                }
+            } else {
+                /* If trait does have the hi part of the identifier set, this is
+                 * a fully qualified trait identifier. In a signature this looks
+                 * like "TRAIT | MyTrait > Comp". */
+                ecs_entity_t lo = ecs_entity_t_lo(component);
+                if (lo == EcsWildcard) {
+                    ecs_assert(trait_offsets != NULL, 
+                        ECS_INTERNAL_ERROR, NULL);
 
-bool ecs_query_orphaned(
-    ecs_query_t *query)
-{
-    return query->flags & EcsQueryIsOrphaned;
-}
+                    /* Get id for the trait to lookup by taking the trait from
+                     * the high 32 bits, move it to the low 32 bits, and reapply
+                     * the TRAIT mask. */
+                    component = ecs_entity_t_hi(component & ECS_COMPONENT_MASK);
 
-ecs_entity_t ecs_component_id_from_id(
-    ecs_world_t *world,
-    ecs_entity_t e)
-{
-    if (ECS_HAS_ROLE(e, TRAIT)) {
-        ecs_entity_t trait = ecs_entity_t_hi(e & ECS_COMPONENT_MASK);
-        if (ecs_has(world, trait, EcsComponent)) {
-            /* This is not a trait tag, trait is the value */
-            return trait;
-        } else {
-            /* This is a trait tag, component is the value */
-            return ecs_entity_t_lo(e);
-        }
-    } else if (e & ECS_ROLE_MASK) {
-        return 0;
-    }
+                    /* If the low part of the identifier is the wildcard entity,
+                     * this column is requesting the component to which the 
+                     * trait is applied. First, find the component identifier */
+                    result = get_trait_index(table_type, component, 
+                        column_index, trait_offsets, count);
 
-    return e;
-}
+                    /* Type must have the trait, otherwise table would not have
+                     * matched */
+                    ecs_assert(result != -1, ECS_INTERNAL_ERROR, NULL);
 
-const EcsComponent* ecs_component_from_id(
-    ecs_world_t *world,
-    ecs_entity_t e)
-{
-    ecs_entity_t trait = 0;
+                    /* Get component id at returned index */
+                    ecs_entity_t *trait = ecs_vector_get(
+                        table_type, ecs_entity_t, result);
+                    ecs_assert(trait != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    /* If this is a trait, get the trait component from the identifier */
-    if (ECS_HAS_ROLE(e, TRAIT)) {
-        trait = e;
-        e = e & ECS_COMPONENT_MASK;
-        e = ecs_entity_t_hi(e);
-    }
+                    /* Get the lower part of the trait id. This is the component
+                     * we're looking for. */
+                    component = ecs_entity_t_lo(*trait);
+                    *component_out = component;
 
-    const EcsComponent *component = ecs_get(world, e, EcsComponent);
-    if (!component && trait) {
-        /* If this is a trait column and the trait is not a component, use
-            * the component type of the component the trait is applied to. */
-        e = ecs_entity_t_lo(trait);
-        component = ecs_get(world, e, EcsComponent);
-    }    
+                    /* Now lookup the component as usual */
+                }
 
-    return component;
-}
+                /* If the low part is a regular entity (component), then
+                 * this query exactly matches a single trait instance. In
+                 * this case we can simply do a lookup of the trait 
+                 * identifier in the table type. */
+                result = ecs_type_index_of(table_type, component);
+            }
+        } else {
+            /* Get column index for component */
+            result = ecs_type_index_of(table_type, component);
+        }
 
-/* Count number of columns with data (excluding tags) */
-static
-int32_t data_column_count(
-    ecs_world_t * world,
-    ecs_table_t * table)
-{
-    int32_t count = 0;
-    ecs_vector_each(table->type, ecs_entity_t, c_ptr, {
-        ecs_entity_t component = *c_ptr;
+        /* If column is found, add one to the index, as column zero in
+        * a table is reserved for entity id's */
+        if (result != -1) {
+            result ++;
+        }
 
-        /* Typically all components will be clustered together at the start of
-         * the type as components are created from a separate id pool, and type
-         * vectors are sorted. 
-         * Explicitly check for EcsComponent and EcsName since the ecs_has check
-         * doesn't work during bootstrap. */
-        if ((component == ecs_typeid(EcsComponent)) || 
-            (component == ecs_typeid(EcsName)) || 
-            ecs_component_from_id(world, component) != NULL) 
+        /* Check if component is a tag. If it is, set table_data to
+        * zero, so that a system won't try to access the data */
+        if (!ECS_HAS_ROLE(component, CASE) && 
+            !ECS_HAS_ROLE(component, SWITCH)) 
         {
-            count = c_ptr_i + 1;
+            component = ecs_component_id_from_id(world, component);
+            const EcsComponent *data = ecs_get(
+                world, component, EcsComponent);
+
+            if (!data || !data->size) {
+                result = 0;
+            }
+        }        
+
+        /* ecs_table_column_offset may return -1 if the component comes
+         * from a prefab. If so, the component will be resolved as a
+         * reference (see below) */           
+    }
+
+    if (op == EcsOperAll) {
+        result = 0;
+    } else if (op == EcsOperOptional) {
+        /* If table doesn't have the field, mark it as no data */
+        if (!ecs_type_has_entity(world, table_type, component)) {
+            result = 0;
         }
-    });
+    }
 
-    return count;
+    return result;
 }
 
-/* Count number of switch columns */
 static
-int32_t switch_column_count(
-    ecs_table_t *table)
+ecs_vector_t* add_ref(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_type_t table_type,
+    ecs_vector_t *references,
+    ecs_entity_t component,
+    ecs_entity_t entity,
+    ecs_sig_from_kind_t from)
 {
-    int32_t count = 0;
-    ecs_vector_each(table->type, ecs_entity_t, c_ptr, {
-        ecs_entity_t component = *c_ptr;
+    const EcsComponent *c_info = ecs_get(world, component, EcsComponent);
+    
+    ecs_entity_t e;
+    ecs_ref_t *ref = ecs_vector_add(&references, ecs_ref_t);
 
-        if (ECS_HAS_ROLE(component, SWITCH)) {
-            if (!count) {
-                table->sw_column_offset = c_ptr_i;
+    /* Find the entity for the component */
+    if (from == EcsFromEntity || from == EcsFromEmpty) {
+        e = entity;
+    } else if (from == EcsCascade) {
+        e = entity;
+    } else if (from == EcsFromSystem) {
+        e = entity;
+    } else {
+        e = get_entity_for_component(
+            world, entity, table_type, component);
+    }
+
+    if (from != EcsCascade) {
+        ecs_assert(e != 0, ECS_INTERNAL_ERROR, NULL);
+    }
+    
+    *ref = (ecs_ref_t){0};
+    ref->entity = e;
+    ref->component = component;
+
+    if (ecs_has(world, component, EcsComponent)) {
+        if (c_info->size && from != EcsFromEmpty) {
+            if (e) {
+                ecs_get_ref_w_entity(
+                    world, ref, e, component);
+                ecs_set_watch(world, e);                     
             }
-            count ++;
+
+            query->flags |= EcsQueryHasRefs;
         }
-    });
+    }
 
-    return count;
+    return references;
 }
 
 static
-ecs_type_t entities_to_type(
-    ecs_entities_t *entities)
+ecs_entity_t is_column_trait(
+    ecs_sig_column_t *column)
 {
-    if (entities->count) {
-        ecs_vector_t *result = NULL;
-        ecs_vector_set_count(&result, ecs_entity_t, entities->count);
-        ecs_entity_t *array = ecs_vector_first(result, ecs_entity_t);
-        ecs_os_memcpy(array, entities->array, ECS_SIZEOF(ecs_entity_t) * entities->count);
-        return result;
-    } else {
-        return NULL;
-    }
-}
-
-static
-void register_child_table(
-    ecs_world_t * world,
-    ecs_table_t * table,
-    ecs_entity_t parent)
-{
-    /* Register child table with parent */
-    ecs_vector_t *child_tables = ecs_map_get_ptr(
-            world->child_tables, ecs_vector_t*, parent);
-    if (!child_tables) {
-        child_tables = ecs_vector_new(ecs_table_t*, 1);
-    }
-    
-    ecs_table_t **el = ecs_vector_add(&child_tables, ecs_table_t*);
-    *el = table;
+    ecs_sig_from_kind_t from_kind = column->from_kind;
+    ecs_sig_oper_kind_t oper_kind = column->oper_kind;
 
-    if (!world->child_tables) {
-        world->child_tables = ecs_map_new(ecs_vector_t*, 1);
+    /* For now traits are only supported on owned columns */
+    if (from_kind == EcsFromOwned && oper_kind == EcsOperAnd) {
+        ecs_entity_t c = column->is.component;
+        if (ECS_HAS_ROLE(c, TRAIT)) {
+            if (!(ecs_entity_t_hi(c & ECS_COMPONENT_MASK))) {
+                return c;
+            } else
+            if (ecs_entity_t_lo(c) == EcsWildcard) {
+                return ecs_entity_t_hi(c & ECS_COMPONENT_MASK);
+            }
+        }
     }
 
-    ecs_map_set(world->child_tables, parent, &child_tables);
+    return 0;
 }
 
 static
-void init_edges(
-    ecs_world_t * world,
-    ecs_table_t * table)
+int32_t type_trait_count(
+    ecs_type_t type,
+    ecs_entity_t trait)
 {
-    ecs_entity_t *entities = ecs_vector_first(table->type, ecs_entity_t);
-    int32_t count = ecs_vector_count(table->type);
+    int32_t i, count = ecs_vector_count(type);
+    ecs_entity_t *entities = ecs_vector_first(type, ecs_entity_t);
+    int32_t result = 0;
 
-    table->lo_edges = ecs_os_calloc(sizeof(ecs_edge_t) * ECS_HI_COMPONENT_ID);
-    table->hi_edges = ecs_map_new(ecs_edge_t, 0);
+    trait &= ECS_COMPONENT_MASK;
 
-    table->lo_edges[0].add = table;
-    
-    /* Make add edges to own components point to self */
-    int32_t i;
     for (i = 0; i < count; i ++) {
         ecs_entity_t e = entities[i];
-
-        if (e >= ECS_HI_COMPONENT_ID) {
-            ecs_edge_t edge = { .add = table };
-
-            if (count == 1) {
-                edge.remove = &world->store.root;
-            }
-
-            ecs_map_set(table->hi_edges, e, &edge);
-        } else {
-            table->lo_edges[e].add = table;
-
-            if (count == 1) {
-                table->lo_edges[e].remove = &world->store.root;
-            } else {
-                table->lo_edges[e].remove = NULL;
+        if (ECS_HAS_ROLE(e, TRAIT)) {
+            e &= ECS_COMPONENT_MASK;
+            if (ecs_entity_t_hi(e) == trait) {
+                result ++;
             }
         }
-
-        /* As we're iterating over the table components, also set the table
-         * flags. These allow us to quickly determine if the table contains
-         * data that needs to be handled in a special way, like prefabs or 
-         * containers */
-        if (e <= EcsLastInternalComponentId) {
-            table->flags |= EcsTableHasBuiltins;
-        }
-
-        if (e == EcsPrefab) {
-            table->flags |= EcsTableIsPrefab;
-            table->flags |= EcsTableIsDisabled;
-        }
-
-        if (e == EcsDisabled) {
-            table->flags |= EcsTableIsDisabled;
-        }
-
-        if (e == ecs_typeid(EcsComponent)) {
-            table->flags |= EcsTableHasComponentData;
-        }
-
-        if (ECS_HAS_ROLE(e, XOR)) {
-            table->flags |= EcsTableHasXor;
-        }
-
-        if (ECS_HAS_ROLE(e, INSTANCEOF)) {
-            table->flags |= EcsTableHasBase;
-        }
-
-        if (ECS_HAS_ROLE(e, SWITCH)) {
-            table->flags |= EcsTableHasSwitch;
-        }
-
-        if (ECS_HAS_ROLE(e, CHILDOF)) {
-            ecs_entity_t parent = e & ECS_COMPONENT_MASK;
-            ecs_assert(!ecs_exists(world, parent) || ecs_is_alive(world, parent), ECS_INTERNAL_ERROR, NULL);
-            table->flags |= EcsTableHasParent;
-            register_child_table(world, table, parent);
-        }
-
-        if (ECS_HAS_ROLE(e, CHILDOF) || ECS_HAS_ROLE(e, INSTANCEOF)) {
-            ecs_set_watch(world, e & ECS_COMPONENT_MASK);
-        }
     }
 
-    /* Register component info flags for all columns */
-    ecs_table_notify(world, table, &(ecs_table_event_t){
-        .kind = EcsTableComponentInfo
-    });
-    
-    /* Register as root table */
-    if (!(table->flags & EcsTableHasParent)) {
-        register_child_table(world, table, 0);
-    }
+    return result;
 }
 
+/* For each trait that the query subscribes for, count the occurrences in the
+ * table. Cardinality of subscribed for traits must be the same as in the table
+ * or else the table won't match. */
 static
-void init_table(
-    ecs_world_t * world,
-    ecs_table_t * table,
-    ecs_entities_t * entities)
+int32_t count_traits(
+    ecs_query_t *query,
+    ecs_type_t type)
 {
-    table->type = entities_to_type(entities);
-    table->c_info = NULL;
-    table->data = NULL;
-    table->flags = 0;
-    table->dirty_state = NULL;
-    table->monitors = NULL;
-    table->on_set = NULL;
-    table->on_set_all = NULL;
-    table->on_set_override = NULL;
-    table->un_set_all = NULL;
-    table->alloc_count = 0;
+    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
+    int32_t i, count = ecs_vector_count(query->sig.columns);
+    int32_t first_count = 0, trait_count = 0;
 
-    table->queries = NULL;
-    table->column_count = data_column_count(world, table);
-    table->sw_column_count = switch_column_count(table);
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t trait = is_column_trait(&columns[i]);
+        if (trait) {
+            trait_count = type_trait_count(type, trait);
+            if (!first_count) {
+                first_count = trait_count;
+            } else {
+                if (first_count != trait_count) {
+                    /* The traits that this query subscribed for occur in the
+                     * table but don't have the same cardinality. Ignore the
+                     * table. This could typically happen for empty tables along
+                     * a path in the table graph. */
+                    return -1;
+                }
+            }
+        }
+    }
 
-    init_edges(world, table);
+    return first_count;
 }
 
 static
-ecs_table_t *create_table(
-    ecs_world_t * world,
-    ecs_entities_t * entities)
+ecs_type_t get_column_type(
+    ecs_world_t *world,
+    ecs_sig_oper_kind_t oper_kind,
+    ecs_entity_t component)
 {
-    ecs_table_t *result = ecs_sparse_add(world->store.tables, ecs_table_t);
-    result->id = ecs_to_u32(ecs_sparse_last_id(world->store.tables));
-
-    ecs_assert(result != NULL, ECS_INTERNAL_ERROR, NULL);
-    init_table(world, result, entities);
-
-#ifndef NDEBUG
-    char *expr = ecs_type_str(world, result->type);
-    ecs_trace_2("table #[green][%s]#[normal] created", expr);
-    ecs_os_free(expr);
-#endif
-    ecs_log_push();
-
-    ecs_notify_queries(world, &(ecs_query_event_t) {
-        .kind = EcsQueryTableMatch,
-        .table = result
-    });
-
-    ecs_log_pop();
-
-    return result;
+    if (oper_kind == EcsOperAll) {
+        const EcsType *type = ecs_get(world, component, EcsType);
+        ecs_assert(type != NULL, ECS_INVALID_PARAMETER, NULL);
+        return type->normalized;
+    } else {
+        return ecs_type_from_entity(world, component);
+    }    
 }
 
+/** Add table to system, compute offsets for system components in table it */
+/* Return storage if column is matched per entity with a sparse component */
 static
-void add_entity_to_type(
-    ecs_type_t type,
-    ecs_entity_t add,
-    ecs_entity_t replace,
-    ecs_entities_t *out)
+ecs_sparse_t* get_lookup_sparse(
+    ecs_world_t *world,
+    ecs_sig_column_t *column)
 {
-    int32_t count = ecs_vector_count(type);
-    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);    
-    bool added = false;
-
-    int32_t i, el = 0;
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t e = array[i];
-        if (e == replace) {
-            continue;
-        }
-
-        if (e > add && !added) {
-            out->array[el ++] = add;
-            added = true;
-        }
-        
-        out->array[el ++] = e;
+    ecs_sig_oper_kind_t op = column->oper_kind;
+    ecs_sig_from_kind_t from = column->from_kind;
 
-        ecs_assert(el <= out->count, ECS_INTERNAL_ERROR, NULL);
+    if (op != EcsOperAnd && op != EcsOperNot && op != EcsOperOptional) {
+        return NULL;
     }
 
-    if (!added) {
-        out->array[el ++] = add;
+    if (from != EcsFromAny && from != EcsFromOwned) {
+        return NULL;
     }
 
-    out->count = el;
+    ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, column->is.component);
+    if (!c_info) {
+        return NULL;
+    }
 
-    ecs_assert(out->count != 0, ECS_INTERNAL_ERROR, NULL);
+    return c_info->sparse;
 }
 
 static
-void remove_entity_from_type(
-    ecs_type_t type,
-    ecs_entity_t remove,
-    ecs_entities_t *out)
-{
-    int32_t count = ecs_vector_count(type);
-    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
+void add_table(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_table_t *table)
+{
+    ecs_type_t table_type = NULL;
+    int32_t c, column_count = ecs_vector_count(query->sig.columns);
 
-    int32_t i, el = 0;
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t e = array[i];
-        if (e != remove) {
-            out->array[el ++] = e;
-            ecs_assert(el <= count, ECS_INTERNAL_ERROR, NULL);
-        }
+    if (table) {
+        table_type = table->type;
     }
 
-    out->count = el;
-}
+    int32_t trait_cur = 0, trait_count = count_traits(query, table_type);
+    
+    /* If the query has traits, we need to account for the fact that a table may
+     * have multiple components to which the trait is applied, which means the
+     * table has to be registered with the query multiple times, with different
+     * table columns. If so, allocate a small array for each trait in which the
+     * last added table index of the trait is stored, so that in the next 
+     * iteration we can start the search from the correct offset type. */
+    trait_offset_t *trait_offsets = NULL;
+    if (trait_count) {
+        trait_offsets = ecs_os_calloc(
+            ECS_SIZEOF(trait_offset_t) * column_count);
+    }
 
-static
-ecs_edge_t* get_edge(
-    ecs_table_t *node,
-    ecs_entity_t e)
-{
-    ecs_edge_t *edge;
+    /* From here we recurse */
+    int32_t matched_table_index = 0;
+    ecs_matched_table_t table_data;
+    ecs_vector_t *references = NULL;
 
-    if (e < ECS_HI_COMPONENT_ID) {
-        edge = &node->lo_edges[e];
-    } else {
-        edge = ecs_map_get(node->hi_edges, ecs_edge_t, e);        
-        if (!edge) {
-            ecs_edge_t new_edge = {0};
-            ecs_map_set(node->hi_edges, e, &new_edge);
-            edge = ecs_map_get(node->hi_edges, ecs_edge_t, e);    
-            ecs_assert(edge != NULL, ECS_INTERNAL_ERROR, NULL);
-        }
+add_trait:
+    table_data = (ecs_matched_table_t){ .data.table = table };
+    if (table) {
+        table_type = table->type;
     }
 
-    return edge;
-}
+    /* If grouping is enabled for query, assign the group rank to the table */
+    group_table(world, query, &table_data);
 
-static
-void create_backlink_after_add(
-    ecs_table_t * next,
-    ecs_table_t * prev,
-    ecs_entity_t add)
-{
-    ecs_edge_t *edge = get_edge(next, add);
-    if (!edge->remove) {
-        edge->remove = prev;
-    }
-}
+    if (column_count) {
+        /* Array that contains the system column to table column mapping */
+        table_data.data.columns = ecs_os_malloc(ECS_SIZEOF(int32_t) * column_count);
+        ecs_assert(table_data.data.columns != NULL, ECS_OUT_OF_MEMORY, NULL);
 
-static
-void create_backlink_after_remove(
-    ecs_table_t * next,
-    ecs_table_t * prev,
-    ecs_entity_t add)
-{
-    ecs_edge_t *edge = get_edge(next, add);
-    if (!edge->add) {
-        edge->add = prev;
+        /* Store the components of the matched table. In the case of OR expressions,
+        * components may differ per matched table. */
+        table_data.data.components = ecs_os_malloc(ECS_SIZEOF(ecs_entity_t) * column_count);
+        ecs_assert(table_data.data.components != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+        /* Also cache types, so no lookup is needed while iterating */
+        table_data.data.types = ecs_os_malloc(ECS_SIZEOF(ecs_type_t) * column_count);
+        ecs_assert(table_data.data.types != NULL, ECS_OUT_OF_MEMORY, NULL);        
     }
-}
 
-static
-ecs_entity_t find_xor_replace(
-    ecs_world_t * world,
-    ecs_table_t * table,
-    ecs_type_t type,
-    ecs_entity_t add)
-{
-    if (table->flags & EcsTableHasXor) {
-        ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
-        int32_t i, type_count = ecs_vector_count(type);
-        ecs_type_t xor_type = NULL;
+    /* Walk columns parsed from the system signature */
+    ecs_sig_column_t *columns = ecs_vector_first(
+        query->sig.columns, ecs_sig_column_t);
 
-        for (i = type_count - 1; i >= 0; i --) {
-            ecs_entity_t e = array[i];
-            if (ECS_HAS_ROLE(e, XOR)) {
-                ecs_entity_t e_type = e & ECS_COMPONENT_MASK;
-                const EcsType *type_ptr = ecs_get(world, e_type, EcsType);
-                ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+    for (c = 0; c < column_count; c ++) {
+        ecs_sig_column_t *column = &columns[c];
+        ecs_entity_t entity = 0, component = 0;
+        ecs_sig_oper_kind_t op = column->oper_kind;
+        ecs_sig_from_kind_t from = column->from_kind;
 
-                if (ecs_type_owns_entity(
-                    world, type_ptr->normalized, add, true)) 
-                {
-                    xor_type = type_ptr->normalized;
-                }
-            } else if (xor_type) {
-                if (ecs_type_owns_entity(world, xor_type, e, true)) {
-                    return e;
-                }
-            }
+        if (op == EcsOperNot) {
+            from = EcsFromEmpty;
         }
-    }
 
-    return 0;
-}
+        table_data.data.columns[c] = 0;
 
-int32_t ecs_table_switch_from_case(
-    ecs_world_t * world,
-    ecs_table_t * table,
-    ecs_entity_t add)
-{
-    ecs_type_t type = table->type;
-    ecs_data_t *data = ecs_table_get_data(table);
-    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
+        /* Components with sparse storage are not stored in the table. Add a
+         * lookup column so that the component is tested for each entity */
+        ecs_sparse_t *sparse = get_lookup_sparse(world, column);
+        if (sparse) {
+            if (op != EcsOperOptional) {
+                ecs_lookup_column_t *lc = ecs_vector_add(
+                    &table_data.lookup_columns, ecs_lookup_column_t);
+                lc->sparse = sparse;
+                lc->signature_column_index = c;
+                lc->is_not = op == EcsOperNot;
+            }
 
-    int32_t i, count = table->sw_column_count;
-    ecs_assert(count != 0, ECS_INTERNAL_ERROR, NULL);
+            component = column->is.component;
+            table_data.data.components[c] = component;
+            table_data.data.types[c] = get_column_type(world, op, component);
+            continue;
+        }
 
-    add = add & ECS_COMPONENT_MASK;
+        /* Get actual component and component source for current column */
+        get_comp_and_src(world, query, table_type, column, op, from, &component, 
+            &entity);
 
-    ecs_sw_column_t *sw_columns = NULL;
+        /* This column does not retrieve data from a static entity (either
+         * EcsFromSystem or EcsFromParent) and is not just a handle */
+        if (!entity && from != EcsFromEmpty) {
+            int32_t index = get_component_index(world, table, table_type, 
+                &component, c, op, trait_offsets, trait_cur + 1);
 
-    if (data && (sw_columns = data->sw_columns)) {
-        /* Fast path, we can get the switch type from the column data */
-        for (i = 0; i < count; i ++) {
-            ecs_type_t sw_type = sw_columns[i].type;
-            if (ecs_type_owns_entity(world, sw_type, add, true)) {
-                return i;
+            if (index == -1) {
+                if (from == EcsFromOwned && op == EcsOperOptional) {
+                    index = 0;
+                }
+            } else {
+                if (from == EcsFromShared && op == EcsOperOptional) {
+                    index = 0;
+                }
             }
-        }
-    } else {
-        /* Slow path, table is empty, so we'll have to get the switch types by
-         * actually inspecting the switch type entities. */
-        for (i = 0; i < count; i ++) {
-            ecs_entity_t e = array[i + table->sw_column_offset];
-            ecs_assert(ECS_HAS_ROLE(e, SWITCH), ECS_INTERNAL_ERROR, NULL);
-            e = e & ECS_COMPONENT_MASK;
+            
+            table_data.data.columns[c] = index;
 
-            const EcsType *type_ptr = ecs_get(world, e, EcsType);
-            ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+            /* If the column is a case, we should only iterate the entities in
+             * the column for this specific case. Add a sparse column with the
+             * case id so we can find the correct entities when iterating */
+            if (ECS_HAS_ROLE(component, CASE)) {
+                ecs_sparse_column_t *sc = ecs_vector_add(
+                    &table_data.sparse_columns, ecs_sparse_column_t);
+                sc->signature_column_index = c;
+                sc->sw_case = component & ECS_COMPONENT_MASK;
+                sc->sw_column = NULL;
+            }
 
-            if (ecs_type_owns_entity(
-                world, type_ptr->normalized, add, true)) 
+            /* If table has a DISABLED bitset for the component, add a bitset
+             * column so that disabled entities are skipped when iterating */
+            if (op == EcsOperAnd && index > 0 && 
+                !(component & ECS_ROLE_MASK) &&
+                table && (table->flags & EcsTableHasDisabled)) 
             {
-                return i;
+                int32_t bs_index = ecs_type_index_of(
+                    table_type, component | ECS_DISABLED);
+                if (bs_index != -1) {
+                    ecs_bitset_column_t *bc = ecs_vector_add(
+                        &table_data.bitset_columns, ecs_bitset_column_t);
+                    bc->bs_column_index = bs_index - table->bs_column_offset;
+                    bc->signature_column_index = c;
+                }
             }
         }
-    }
 
-    /* If a table was not found, this is an invalid switch case */
-    ecs_abort(ECS_INVALID_CASE, NULL);
+        /* Check if a the component is a reference. If 'entity' is set, the
+         * component must be resolved from another entity, which is the case
+         * for FromEntity and FromContainer. 
+         * 
+         * If no entity is set but the component is not found in the table, it
+         * must come from a prefab. This is guaranteed, as at this point it is
+         * already validated that the table matches with the system.
+         * 
+         * If the column from is Cascade, there may not be an entity in case the
+         * current table contains root entities. In that case, still add a
+         * reference field. The application can, after the table has matched,
+         * change the set of components, so that this column will turn into a
+         * reference. Having the reference already linked to the system table
+         * makes changing this administation easier when the change happens.
+         */
+        if ((entity || table_data.data.columns[c] == -1 || from == EcsCascade)) {
+            references = add_ref(world, query, table_type, references, 
+                component, entity, from);
+            table_data.data.columns[c] = -ecs_vector_count(references);
+        }
 
-    return -1;
-}
+        table_data.data.components[c] = component;
+        table_data.data.types[c] = get_column_type(world, op, component);
+    }
 
-static
-ecs_table_t *find_or_create_table_include(
-    ecs_world_t * world,
-    ecs_table_t * node,
-    ecs_entity_t add)
-{
-    /* If table has one or more switches and this is a case, return self */
-    if (ECS_HAS_ROLE(add, CASE)) {
-        ecs_assert((node->flags & EcsTableHasSwitch) != 0, 
-            ECS_INVALID_CASE, NULL);
-        return node;
-    } else {
-        ecs_type_t type = node->type;
-        int32_t count = ecs_vector_count(type);
+    /* Initially always add table to inactive group. If the system is registered
+     * with the table and the table is not empty, the table will send an
+     * activate signal to the system. */
 
-        ecs_entities_t entities = {
-            .array = ecs_os_alloca(ECS_SIZEOF(ecs_entity_t) * (count + 1)),
-            .count = count + 1
-        };
+    ecs_matched_table_t *table_elem;
+    bool table_elem_active;
+    if (table && has_auto_activation(query)) {
+        table_elem = ecs_vector_add(&query->empty_tables, 
+            ecs_matched_table_t);
+        table_elem_active = false;
 
-        /* If table has a XOR column, check if the entity that is being added to
-         * the table is part of the XOR type, and if it is, find the current 
-         * entity in the table type matching the XOR type. This entity must be 
-         * replaced in the new table, to ensure the XOR constraint isn't 
-         * violated. */
-        ecs_entity_t replace = find_xor_replace(world, node, type, add);
-
-        add_entity_to_type(type, add, replace, &entities);
-
-        ecs_table_t *result = ecs_table_find_or_create(world, &entities);
-        
-        if (result != node) {
-            create_backlink_after_add(result, node, add);
-        }
+        #ifndef NDEBUG
+        char *type_expr = ecs_type_str(world, table->type);
+        ecs_trace_2("query #[green]%s#[reset] matched with table #[green][%s]",
+            query_name(world, query), type_expr);
+        ecs_os_free(type_expr);
+        #endif
+    } else {
+        /* If no table is provided to function, this is a system that contains
+         * no columns that require table matching. In this case, the system will
+         * only have one "dummy" table that caches data from the system columns.
+         * Always add this dummy table to the list of active tables, since it
+         * would never get activated otherwise. */
+        table_elem = ecs_vector_add(&query->tables, ecs_matched_table_t);
 
-        return result;
+        /* If query doesn't automatically activates/inactivates tables, we can 
+         * get the count to determine the current table index. */
+        matched_table_index = ecs_vector_count(query->tables) - 1;
+        ecs_assert(matched_table_index >= 0, ECS_INTERNAL_ERROR, NULL);
+        table_elem_active = true;
     }
-}
 
-static
-ecs_table_t *find_or_create_table_exclude(
-    ecs_world_t * world,
-    ecs_table_t * node,
-    ecs_entity_t remove)
-{
-    ecs_type_t type = node->type;
-    int32_t count = ecs_vector_count(type);
+    if (references) {
+        ecs_size_t ref_size = ECS_SIZEOF(ecs_ref_t) * ecs_vector_count(references);
+        table_data.data.references = ecs_os_malloc(ref_size);
+        ecs_os_memcpy(table_data.data.references, 
+            ecs_vector_first(references, ecs_ref_t), ref_size);
+        ecs_vector_free(references);
+        references = NULL;
+    }
 
-    ecs_entities_t entities = {
-        .array = ecs_os_alloca(ECS_SIZEOF(ecs_entity_t) * count),
-        .count = count
-    };
+    *table_elem = table_data;
 
-    remove_entity_from_type(type, remove, &entities);
+    if (table_elem_active) {
+        set_table_slot(query, query->tables, 
+            ecs_vector_count(query->tables) - 1, true);
+    } else {
+        set_table_slot(query, query->empty_tables, 
+            ecs_vector_count(query->empty_tables) - 1, false);
+    }
 
-    ecs_table_t *result = ecs_table_find_or_create(world, &entities);
-    if (!result) {
-        return NULL;
+    /* Use tail recursion when adding table for multiple traits */
+    trait_cur ++;
+    if (trait_cur < trait_count) {
+        goto add_trait;
     }
 
-    if (result != node) {
-        create_backlink_after_remove(result, node, remove);
+    if (table && !(query->flags & EcsQueryIsSubquery)) {
+        ecs_table_notify(world, table, &(ecs_table_event_t){
+            .kind = EcsTableQueryMatch,
+            .query = query,
+            .matched_table_index = matched_table_index
+        });
+    } else if (table && ecs_table_count(table)) {
+        activate_table(world, query, table, true);
     }
 
-    return result;    
+    if (trait_offsets) {
+        ecs_os_free(trait_offsets);
+    }
 }
 
 static
-ecs_table_t* traverse_remove_hi_edges(
-    ecs_world_t * world,
-    ecs_table_t * node,
-    int32_t i,
-    ecs_entities_t * to_remove,
-    ecs_entities_t * removed)
+bool match_column(
+    ecs_world_t *world,
+    ecs_type_t type,
+    ecs_sig_from_kind_t from_kind,
+    ecs_entity_t component,
+    ecs_entity_t source,
+    ecs_match_failure_t *failure_info)
 {
-    int32_t count = to_remove->count;
-    ecs_entity_t *entities = to_remove->array;
+    if (from_kind == EcsFromAny) {
+        failure_info->reason = EcsMatchFromSelf;
+        return ecs_type_has_entity(world, type, component);
+        
+    } else if (from_kind == EcsFromOwned) {
+        failure_info->reason = EcsMatchFromOwned;
+        return ecs_type_owns_entity(world, type, component, true);
 
-    for (; i < count; i ++) {
-        ecs_entity_t e = entities[i];
-        ecs_entity_t next_e = e;
-        ecs_table_t *next;
-        ecs_edge_t *edge;
+    } else if (from_kind == EcsFromShared) {
+        failure_info->reason = EcsMatchFromShared;
+        return !ecs_type_owns_entity(world, type, component, true) &&
+            ecs_type_owns_entity(world, type, component, false);
 
-        edge = get_edge(node, e);
+    } else if (from_kind == EcsFromParent) {
+        failure_info->reason = EcsMatchFromContainer;
+        return ecs_find_in_type(world, type, component, ECS_CHILDOF) != 0;
 
-        next = edge->remove;
+    } else if (from_kind == EcsFromEntity) {
+        failure_info->reason = EcsMatchFromEntity;
+        ecs_type_t source_type = ecs_get_type(world, source);
+        return ecs_type_has_entity(world, source_type, component);
+    } else {
+        return true;
+    }
+}
 
-        if (!next) {
-            next = find_or_create_table_exclude(world, node, next_e);
-            if (!next) {
-                return NULL;
-            }
+/* Match table with system */
+bool ecs_query_match(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_query_t *query,
+    ecs_match_failure_t *failure_info)
+{
+    /* Prevent having to add if not null checks everywhere */
+    ecs_match_failure_t tmp_failure_info;
+    if (!failure_info) {
+        failure_info = &tmp_failure_info;
+    }
 
-            edge->remove = next;
-        }
+    failure_info->reason = EcsMatchOk;
+    failure_info->column = 0;
 
-        if (removed && node != next) removed->array[removed->count ++] = e;
+    if (!(query->flags & EcsQueryNeedsTables)) {
+        failure_info->reason = EcsMatchSystemIsATask;
+        return false;
+    }
 
-        node = next;        
+    ecs_type_t type, table_type = table->type;
+
+    /* Don't match disabled entities */
+    if (!(query->flags & EcsQueryMatchDisabled) && ecs_type_owns_entity(
+        world, table_type, EcsDisabled, true))
+    {
+        failure_info->reason = EcsMatchEntityIsDisabled;
+        return false;
     }
 
-    return node;
-}
+    /* Don't match prefab entities */
+    if (!(query->flags & EcsQueryMatchPrefab) && ecs_type_owns_entity(
+        world, table_type, EcsPrefab, true))
+    {
+        failure_info->reason = EcsMatchEntityIsPrefab;
+        return false;
+    }
 
-ecs_table_t* ecs_table_traverse_remove(
-    ecs_world_t * world,
-    ecs_table_t * node,
-    ecs_entities_t * to_remove,
-    ecs_entities_t * removed)
-{
-    int32_t i, count = to_remove->count;
-    ecs_entity_t *entities = to_remove->array;
-    node = node ? node : &world->store.root;
+    /* Check if trait cardinality matches traits in query, if any */
+    if (count_traits(query, table->type) == -1) {
+        return false;
+    }
 
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t e = entities[i];
+    int32_t i, column_count = ecs_vector_count(query->sig.columns);
+    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
 
-        /* If the array is not a simple component array, use a function that
-         * handles all cases, but is slower */
-        if (e >= ECS_HI_COMPONENT_ID) {
-            return traverse_remove_hi_edges(world, node, i, to_remove, 
-                removed);
+    for (i = 0; i < column_count; i ++) {
+        ecs_sig_column_t *elem = &columns[i];
+        ecs_sig_from_kind_t from_kind = elem->from_kind;
+        ecs_sig_oper_kind_t oper_kind = elem->oper_kind;
+
+        failure_info->column = i + 1;
+
+        /* Sparse components are matched per entity while iterating */
+        if (get_lookup_sparse(world, elem)) {
+            continue;
         }
 
-        ecs_edge_t *edge = &node->lo_edges[e];
-        ecs_table_t *next = edge->remove;
+        if (oper_kind == EcsOperAnd) {
+            if (!match_column(
+                world, table_type, from_kind, elem->is.component, 
+                elem->source, failure_info)) 
+            {
+                return false;
+            }
 
-        if (!next) {
-            if (edge->add == node) {
-                /* Find table with all components of node except 'e' */
-                next = find_or_create_table_exclude(world, node, e);
-                if (!next) {
-                    return NULL;
-                }
+        } else if (oper_kind == EcsOperNot) {
+            if (match_column(
+                world, table_type, from_kind, elem->is.component, 
+                elem->source, failure_info)) 
+            {
+                return false;
+            }           
 
-                edge->remove = next;
+        } else if (oper_kind == EcsOperOr || oper_kind == EcsOperAll) {
+            bool match_all = oper_kind == EcsOperAll;
+            if (match_all) {
+                const EcsType *type_ptr = ecs_get(world, elem->is.component, EcsType);
+                type = type_ptr->normalized;
             } else {
-                /* If the add edge does not point to self, the table
-                    * does not have the entity in to_remove. */
-                continue;
+                type = elem->is.type;
             }
-        }
 
-        if (removed) removed->array[removed->count ++] = e;
+            if (from_kind == EcsFromAny) {
+                if (!ecs_type_contains(
+                    world, table_type, type, match_all, true))
+                {
+                    failure_info->reason = EcsMatchOrFromSelf;
+                    return false;
+                }
+            } else if (from_kind == EcsFromOwned) {
+                if (!ecs_type_contains(
+                    world, table_type, type, match_all, false))
+                {
+                    failure_info->reason = EcsMatchOrFromOwned;
+                    return false;
+                }
+            } else if (from_kind == EcsFromShared) {
+                if (ecs_type_contains(
+                        world, table_type, type, match_all, false) ||
+                    !ecs_type_contains(
+                        world, table_type, type, match_all, true))
+                {
+                    failure_info->reason = EcsMatchOrFromShared;
+                    return false;
+                }                                
+            } else if (from_kind == EcsFromParent) {
+                if (!(table->flags & EcsTableHasParent)) {
+                    failure_info->reason = EcsMatchOrFromContainer;
+                    return false;
+                }
 
-        node = next;
-    }    
-
-    return node;
-}
-
-static
-void find_owned_components(
-    ecs_world_t * world,
-    ecs_table_t * node,
-    ecs_entity_t base,
-    ecs_entities_t * owned)
-{
-    /* If we're adding an INSTANCEOF relationship, check if the base
-     * has OWNED components that need to be added to the instance */
-    ecs_type_t t = ecs_get_type(world, base);
-
-    int i, count = ecs_vector_count(t);
-    ecs_entity_t *entities = ecs_vector_first(t, ecs_entity_t);
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t e = entities[i];
-        if (ECS_HAS_ROLE(e, INSTANCEOF)) {
-            find_owned_components(world, node, e & ECS_COMPONENT_MASK, owned);
-        } else
-        if (ECS_HAS_ROLE(e, OWNED)) {
-            e = e & ECS_COMPONENT_MASK;
-            
-            /* If entity is a type, add each component in the type */
-            const EcsType *t_ptr = ecs_get(world, e, EcsType);
-            if (t_ptr) {
-                ecs_type_t n = t_ptr->normalized;
-                int32_t j, n_count = ecs_vector_count(n);
-                ecs_entity_t *n_entities = ecs_vector_first(n, ecs_entity_t);
-                for (j = 0; j < n_count; j ++) {
-                    owned->array[owned->count ++] = n_entities[j];
+                if (!components_contains(
+                    world, table_type, type, NULL, match_all))
+                {
+                    failure_info->reason = EcsMatchOrFromContainer;
+                    return false;
                 }
-            } else {
-                owned->array[owned->count ++] = e & ECS_COMPONENT_MASK;
             }
         }
     }
+
+    return true;
 }
 
+/** Match existing tables against system (table is created before system) */
 static
-ecs_table_t* traverse_add_hi_edges(
-    ecs_world_t * world,
-    ecs_table_t * node,
-    int32_t i,
-    ecs_entities_t * to_add,
-    ecs_entities_t * added)
+void match_tables(
+    ecs_world_t *world,
+    ecs_query_t *query)
 {
-    int32_t count = to_add->count;
-    ecs_entity_t *entities = to_add->array;
-
-    ecs_entity_t owned_array[ECS_MAX_ADD_REMOVE];
-    ecs_entities_t owned = {
-        .array = owned_array,
-        .count = 0
-    };
-
-    for (; i < count; i ++) {
-        ecs_entity_t e = entities[i];
-        ecs_entity_t next_e = e;
-        ecs_table_t *next;
-        ecs_edge_t *edge;
-
-        edge = get_edge(node, e);
-        next = edge->add;
-
-        if (!next) {
-            next = find_or_create_table_include(world, node, next_e);
-            ecs_assert(next != NULL, ECS_INTERNAL_ERROR, NULL);
-            edge->add = next;
-        }
+    int32_t i, count = ecs_sparse_count(world->store.tables);
 
-        bool has_case = ECS_HAS_ROLE(e, CASE);
-        if (added && (node != next || has_case)) {
-            /* If this is a case, find switch and encode it in added id */
-            if (has_case) {
-                int32_t s_case = ecs_table_switch_from_case(world, node, e);
-                ecs_assert(s_case != -1, ECS_INTERNAL_ERROR, NULL);
-                e = ECS_CASE | ecs_entity_t_comb(e, s_case);
-            }
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(
+            world->store.tables, ecs_table_t, i);
 
-            added->array[added->count ++] = e; 
+        if (ecs_query_match(world, table, query, NULL)) {
+            add_table(world, query, table);
         }
-
-        if ((node != next) && ECS_HAS_ROLE(e, INSTANCEOF)) {
-            find_owned_components(world, next, ECS_COMPONENT_MASK & e, &owned);
-        } 
-
-        node = next;
     }
 
-    /* In case OWNED components were found, add them as well */
-    if (owned.count) {
-        node = ecs_table_traverse_add(world, node, &owned, added);
-    }
-
-    return node;
+    order_ranked_tables(world, query);
 }
 
-ecs_table_t* ecs_table_traverse_add(
-    ecs_world_t * world,
-    ecs_table_t * node,
-    ecs_entities_t * to_add,
-    ecs_entities_t * added)    
+/** Get index of table in system's matched tables */
+static
+int32_t get_table_param_index(
+    ecs_query_t *query,
+    ecs_table_t *table,
+    bool active,
+    int32_t start_index)
 {
-    int32_t i, count = to_add->count;
-    ecs_entity_t *entities = to_add->array;
-    node = node ? node : &world->store.root;
-
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t e = entities[i];
-        ecs_table_t *next;
-
-        /* If the array is not a simple component array, use a function that
-         * handles all cases, but is slower */
-        if (e >= ECS_HI_COMPONENT_ID) {
-            return traverse_add_hi_edges(world, node, i, to_add, added);
+    /* A table can only be matched once if the query has table slots */
+    if (query->table_slots) {
+        ecs_query_table_slot_t *slot = ecs_map_get(
+            query->table_slots, ecs_query_table_slot_t, table->id);
+        if (slot && slot->active == active && slot->index >= start_index) {
+            return slot->index;
         }
+        return -1;
+    }
 
-        /* There should always be an edge for adding */
-        ecs_edge_t *edge = &node->lo_edges[e];
-        next = edge->add;
-
-        if (!next) {
-            next = find_or_create_table_include(world, node, e);
-            ecs_assert(next != NULL, ECS_INTERNAL_ERROR, NULL);
-            edge->add = next;
-        }
+    ecs_vector_t *tables = active ? query->tables : query->empty_tables;
+    int32_t i, count = ecs_vector_count(tables);
+    ecs_matched_table_t *table_data = ecs_vector_first(
+        tables, ecs_matched_table_t);
 
-        if (added && node != next) {
-            added->array[added->count ++] = e;
+    for (i = start_index; i < count; i ++) {
+        if (table_data[i].data.table == table) {
+            break;
         }
-
-        node = next;
     }
 
-    return node;
+    return i == count ? -1 : i;
 }
 
+/** Check if a table was matched with the system */
 static
-int ecs_entity_compare(
-    const void *e1,
-    const void *e2)
+int32_t table_matched(
+    ecs_query_t *query,
+    ecs_table_t *table,
+    bool active)
 {
-    ecs_entity_t v1 = *(ecs_entity_t*)e1;
-    ecs_entity_t v2 = *(ecs_entity_t*)e2;
-    if (v1 < v2) {
-        return -1;
-    } else if (v1 > v2) {
-        return 1;
-    } else {
-        return 0;
-    }
+    return get_table_param_index(query, table, active, 0);
 }
 
 static
-bool ecs_entity_array_is_ordered(
-    ecs_entities_t *entities)
+void resolve_cascade_container(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    int32_t table_data_index,
+    ecs_type_t table_type)
 {
-    ecs_entity_t prev = 0;
-    ecs_entity_t *array = entities->array;
-    int32_t i, count = entities->count;
-
-    for (i = 0; i < count; i ++) {
-        if (!array[i] && !prev) {
-            continue;
-        }
-        if (array[i] <= prev) {
-            return false;
-        }
-        prev = array[i];
-    }    
+    ecs_matched_table_t *table_data = ecs_vector_get(
+        query->tables, ecs_matched_table_t, table_data_index);
+    
+    ecs_assert(table_data->data.references != 0, ECS_INTERNAL_ERROR, NULL);
 
-    return true;
-}
+    /* Obtain reference index */
+    int32_t *column_indices = table_data->data.columns;
+    int32_t column = query->cascade_by - 1;
+    int32_t ref_index = -column_indices[column] - 1;
 
-static
-int32_t ecs_entity_array_dedup(
-    ecs_entity_t *array,
-    int32_t count)
-{
-    int32_t j, k;
-    ecs_entity_t prev = array[0];
+    /* Obtain pointer to the reference data */
+    ecs_ref_t *references = table_data->data.references;
+    ecs_ref_t *ref = &references[ref_index];
+    ecs_assert(ref->component == get_cascade_component(query), 
+        ECS_INTERNAL_ERROR, NULL);
 
-    for (k = j = 1; k < count; j ++, k++) {
-        ecs_entity_t e = array[k];
-        if (e == prev) {
-            k ++;
-        }
+    /* Resolve container entity */
+    ecs_entity_t container = ecs_find_in_type(
+        world, table_type, ref->component, ECS_CHILDOF);    
 
-        array[j] = e;
-        prev = e;
+    /* If container was found, update the reference */
+    if (container) {
+        references[ref_index].entity = container;
+        ecs_get_ref_w_entity(
+            world, &references[ref_index], container, 
+            ref->component);
+    } else {
+        references[ref_index].entity = 0;
     }
-
-    return count - (k - j);
 }
 
-#ifndef NDEBUG
+#define ELEM(ptr, size, index) ECS_OFFSET(ptr, size * index)
 
 static
-int32_t count_occurrences(
-    ecs_world_t * world,
-    ecs_entities_t * entities,
-    ecs_entity_t entity,
-    int32_t constraint_index)    
+int32_t qsort_partition(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    ecs_entity_t *entities,
+    void *ptr,    
+    int32_t elem_size,
+    int32_t lo,
+    int32_t hi,
+    ecs_compare_action_t compare)
 {
-    const EcsType *type_ptr = ecs_get(world, entity, EcsType);
-    ecs_assert(type_ptr != NULL, 
-        ECS_INVALID_PARAMETER, "flag must be applied to type");
+    int32_t p = (hi + lo) / 2;
+    void *pivot = ELEM(ptr, elem_size, p);
+    ecs_entity_t pivot_e = entities[p];
+    int32_t i = lo - 1, j = hi + 1;
+    void *el;    
 
-    ecs_type_t type = type_ptr->normalized;
-    int32_t count = 0;
-    
-    int i;
-    for (i = 0; i < constraint_index; i ++) {
-        ecs_entity_t e = entities->array[i];
-        if (e & ECS_ROLE_MASK) {
-            break;
+repeat:
+    {
+        do {
+            i ++;
+            el = ELEM(ptr, elem_size, i);
+        } while ( compare(entities[i], el, pivot_e, pivot) < 0);
+
+        do {
+            j --;
+            el = ELEM(ptr, elem_size, j);
+        } while ( compare(entities[j], el, pivot_e, pivot) > 0);
+
+        if (i >= j) {
+            return j;
         }
 
-        if (ecs_type_has_entity(world, type, e)) {
-            count ++;
+        ecs_table_swap(world, table, data, i, j);
+
+        if (p == i) {
+            pivot = ELEM(ptr, elem_size, j);
+            pivot_e = entities[j];
+        } else if (p == j) {
+            pivot = ELEM(ptr, elem_size, i);
+            pivot_e = entities[i];
         }
+
+        goto repeat;
     }
+}
 
-    return count;
+static
+void qsort_array(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    ecs_entity_t *entities,
+    void *ptr,
+    int32_t size,
+    int32_t lo,
+    int32_t hi,
+    ecs_compare_action_t compare)
+{   
+    if ((hi - lo) < 1)  {
+        return;
+    }   
+
+    int32_t p = qsort_partition(
+        world, table, data, entities, ptr, size, lo, hi, compare);
+
+    qsort_array(world, table, data, entities, ptr, size, lo, p, compare);
+
+    qsort_array(world, table, data, entities, ptr, size, p + 1, hi, compare); 
 }
 
 static
-void verify_constraints(
-    ecs_world_t * world,
-    ecs_entities_t * entities)
+void sort_table(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    int32_t column_index,
+    ecs_compare_action_t compare)
 {
-    int i, count = entities->count;
-    for (i = count - 1; i >= 0; i --) {
-        ecs_entity_t e = entities->array[i];
-        ecs_entity_t mask = e & ECS_ROLE_MASK;
-        if (!mask || 
-            ((mask != ECS_OR) &&
-             (mask != ECS_XOR) &&
-             (mask != ECS_NOT)))
-        {
-            break;
-        }
+    ecs_data_t *data = ecs_table_get_data(table);
+    if (!data || !data->entities) {
+        /* Nothing to sort */
+        return;
+    }
 
-        ecs_entity_t entity = e & ECS_COMPONENT_MASK;
-        int32_t matches = count_occurrences(world, entities, entity, i);
-        switch(mask) {
-        case ECS_OR:
-            ecs_assert(matches >= 1, ECS_TYPE_CONSTRAINT_VIOLATION, NULL);
-            break;
-        case ECS_XOR:
-            ecs_assert(matches == 1, ECS_TYPE_CONSTRAINT_VIOLATION, NULL);
-            break;
-        case ECS_NOT:
-            ecs_assert(matches == 0, ECS_TYPE_CONSTRAINT_VIOLATION, NULL);    
-            break;
-        }
+    int32_t count = ecs_table_data_count(data);
+    if (count < 2) {
+        return;
+    }
+
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+
+    void *ptr = NULL;
+    int32_t size = 0;
+    if (column_index != -1) {
+        ecs_column_t *column = &data->columns[column_index];
+        size = column->size;
+        ptr = ecs_vector_first_t(column->data, size, column->alignment);
     }
+
+    qsort_array(world, table, data, entities, ptr, size, 0, count - 1, compare);
 }
 
-#endif
+/* Convert a key to an unsigned integer with the same ordering, so that keys of
+ * any kind can be sorted by their bytes */
+static
+uint64_t sort_key_from_ptr(
+    ecs_sort_key_kind_t kind,
+    const void *ptr)
+{
+    switch(kind) {
+    case EcsSortKeyI32: {
+        int32_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(int32_t));
+        return (uint32_t)v ^ 0x80000000u;
+    }
+    case EcsSortKeyU32: {
+        uint32_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(uint32_t));
+        return v;
+    }
+    case EcsSortKeyF32: {
+        /* Negative floats are ordered in reverse, so flip all of their bits */
+        uint32_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(float));
+        return (v & 0x80000000u) ? (uint32_t)~v : (v | 0x80000000u);
+    }
+    case EcsSortKeyI64: {
+        int64_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(int64_t));
+        return (uint64_t)v ^ 0x8000000000000000ull;
+    }
+    case EcsSortKeyU64: {
+        uint64_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(uint64_t));
+        return v;
+    }
+    case EcsSortKeyF64: {
+        uint64_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(double));
+        return (v & 0x8000000000000000ull) ? ~v : (v | 0x8000000000000000ull);
+    }
+    default:
+        ecs_abort(ECS_INTERNAL_ERROR, NULL);
+    }
+
+    return 0;
+}
 
 static
-ecs_table_t *find_or_create(
-    ecs_world_t * world,
-    ecs_entities_t * entities)
-{    
-    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
+int32_t sort_key_size(
+    ecs_sort_key_kind_t kind)
+{
+    switch(kind) {
+    case EcsSortKeyI32:
+    case EcsSortKeyU32:
+    case EcsSortKeyF32:
+        return 4;
+    default:
+        return 8;
+    }
+}
 
-    /* Make sure array is ordered and does not contain duplicates */
-    int32_t type_count = entities->count;
-    ecs_entity_t *ordered = NULL;
+/* Sort table with an LSD radix sort on the key. The sort produces a permutation
+ * which is applied to the table in a single pass, instead of swapping rows. */
+static
+void radix_sort_table(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    int32_t column_index,
+    ecs_sort_key_kind_t kind,
+    ecs_size_t offset)
+{
+    ecs_data_t *data = ecs_table_get_data(table);
+    if (!data || !data->entities) {
+        /* Nothing to sort */
+        return;
+    }
 
-    if (!type_count) {
-        return &world->store.root;
+    int32_t count = ecs_table_data_count(data);
+    if (count < 2) {
+        return;
     }
 
-    if (!ecs_entity_array_is_ordered(entities)) {
-        ecs_size_t size = ECS_SIZEOF(ecs_entity_t) * type_count;
-        ordered = ecs_os_alloca(size);
-        ecs_os_memcpy(ordered, entities->array, size);
-        qsort(ordered, (size_t)type_count, sizeof(ecs_entity_t), ecs_entity_compare);
-        type_count = ecs_entity_array_dedup(ordered, type_count);
-    } else {
-        ordered = entities->array;
-    }    
+    ecs_assert(column_index != -1, ECS_INTERNAL_ERROR, NULL);
+    ecs_column_t *column = &data->columns[column_index];
+    int16_t size = column->size;
+    void *ptr = ecs_vector_first_t(column->data, size, column->alignment);
+    int32_t key_size = sort_key_size(kind);
+    ecs_assert(offset + key_size <= size, ECS_INVALID_PARAMETER, NULL);
 
-    /* Iterate tables, look if a table matches the type */
-    ecs_sparse_t *tables = world->store.tables;
-    int32_t i, count = ecs_sparse_count(tables);
+    uint64_t *keys_buffer = ecs_os_malloc(ECS_SIZEOF(uint64_t) * count * 2);
+    int32_t *perm_buffer = ecs_os_malloc(ECS_SIZEOF(int32_t) * count * 2);
+    ecs_assert(keys_buffer != NULL, ECS_OUT_OF_MEMORY, NULL);
+    ecs_assert(perm_buffer != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    uint64_t *keys = keys_buffer, *keys_tmp = &keys_buffer[count];
+    int32_t *perm = perm_buffer, *perm_tmp = &perm_buffer[count];
+
+    /* Histograms for all digits are computed in the same pass that extracts
+     * the keys */
+    int32_t hist[8][256] = {{0}};
+    bool is_sorted = true;
+
+    int32_t i, b;
     for (i = 0; i < count; i ++) {
-        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
-        ecs_type_t type = table->type;
-        int32_t table_type_count = ecs_vector_count(type);
+        uint64_t key = sort_key_from_ptr(
+            kind, ECS_OFFSET(ptr, size * i + offset));
+        keys[i] = key;
+        perm[i] = i;
 
-        /* If types do not contain same number of entities, table won't match */
-        if (table_type_count != type_count) {
-            continue;
+        if (i && key < keys[i - 1]) {
+            is_sorted = false;
         }
 
-        /* Memcmp the types, as they must match exactly */
-        ecs_entity_t *type_array = ecs_vector_first(type, ecs_entity_t);
-        if (!ecs_os_memcmp(ordered, type_array, type_count * ECS_SIZEOF(ecs_entity_t))) {
-            /* Table found */
-            return table;
+        for (b = 0; b < key_size; b ++) {
+            hist[b][(key >> (b * 8)) & 0xFF] ++;
         }
-    }  
+    }
 
-    ecs_entities_t ordered_entities = {
-        .array = ordered,
-        .count = type_count
-    };
+    /* Don't touch the table if the order did not change */
+    if (!is_sorted) {
+        for (b = 0; b < key_size; b ++) {
+            int32_t shift = b * 8;
+            int32_t *h = hist[b];
 
-#ifndef NDEBUG
-    /* Check for constraint violations */
-    verify_constraints(world, &ordered_entities);
-#endif
+            /* Skip digits that are the same for all keys */
+            if (h[(keys[0] >> shift) & 0xFF] == count) {
+                continue;
+            }
 
-    /* If we get here, the table has not been found. It has to be created. */
-    
-    ecs_table_t *result = create_table(world, &ordered_entities);
+            int32_t d, sum = 0;
+            for (d = 0; d < 256; d ++) {
+                int32_t n = h[d];
+                h[d] = sum;
+                sum += n;
+            }
 
-    ecs_assert(ordered_entities.count == ecs_vector_count(result->type), 
-        ECS_INTERNAL_ERROR, NULL);
+            for (i = 0; i < count; i ++) {
+                int32_t dst = h[(keys[i] >> shift) & 0xFF] ++;
+                keys_tmp[dst] = keys[i];
+                perm_tmp[dst] = perm[i];
+            }
 
-    return result;
+            uint64_t *k = keys; keys = keys_tmp; keys_tmp = k;
+            int32_t *p = perm; perm = perm_tmp; perm_tmp = p;
+        }
+
+        ecs_table_permute(world, table, data, perm);
+    }
+
+    ecs_os_free(keys_buffer);
+    ecs_os_free(perm_buffer);
 }
 
-ecs_table_t* ecs_table_find_or_create(
-    ecs_world_t * world,
-    ecs_entities_t * components)
+/* Compare function used when merging tables sorted by key */
+static
+int compare_sort_key(
+    ecs_query_t *query,
+    ecs_entity_t e1,
+    const void *ptr1,
+    ecs_entity_t e2,
+    const void *ptr2)
 {
-    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(!world->in_progress, ECS_INTERNAL_ERROR, NULL);
+    ecs_compare_action_t compare = query->compare;
+    if (compare) {
+        return compare(e1, (void*)ptr1, e2, (void*)ptr2);
+    }
 
-    return find_or_create(world, components);
+    ecs_sort_key_kind_t kind = query->sort_key_kind;
+    ecs_size_t offset = query->sort_key_offset;
+    uint64_t k1 = sort_key_from_ptr(kind, ECS_OFFSET(ptr1, offset));
+    uint64_t k2 = sort_key_from_ptr(kind, ECS_OFFSET(ptr2, offset));
+    return (k1 > k2) - (k1 < k2);
 }
 
-ecs_table_t* ecs_table_from_type(
-    ecs_world_t *world,
-    ecs_type_t type)
+/* Helper struct for building sorted table ranges */
+typedef struct sort_helper_t {
+    ecs_matched_table_t *table;
+    ecs_entity_t *entities;
+    void *ptr;
+    int32_t row;
+    int32_t elem_size;
+    int32_t count;
+} sort_helper_t;
+
+static
+void* ptr_from_helper(
+    sort_helper_t *helper)
 {
-    ecs_entities_t components = ecs_type_to_entities(type);
-    return ecs_table_find_or_create(
-        world, &components);
+    ecs_assert(helper->row < helper->count, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(helper->elem_size >= 0, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(helper->row >= 0, ECS_INTERNAL_ERROR, NULL);
+    return ELEM(helper->ptr, helper->elem_size, helper->row);
 }
 
-void ecs_init_root_table(
-    ecs_world_t *world)
+static
+ecs_entity_t e_from_helper(
+    sort_helper_t *helper)
 {
-    ecs_entities_t entities = {
-        .array = NULL,
-        .count = 0
-    };
-
-    init_table(world, &world->store.root, &entities);
+    if (helper->row < helper->count) {
+        return helper->entities[helper->row];
+    } else {
+        return 0;
+    }
 }
 
-void ecs_table_clear_edges(
-    ecs_table_t *table)
+static
+void build_sorted_table_range(
+    ecs_query_t *query,
+    int32_t start,
+    int32_t end)
 {
-    uint32_t i;
-    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
-        ecs_edge_t *e = &table->lo_edges[i];
-        ecs_table_t *add = e->add, *remove = e->remove;
-        if (add) {
-            add->lo_edges[i].remove = NULL;
+    ecs_entity_t component = query->sort_on_component;
+
+    /* Fetch data from all matched tables */
+    ecs_matched_table_t *tables = ecs_vector_first(query->tables, ecs_matched_table_t);
+    sort_helper_t *helper = ecs_os_malloc((end - start) * ECS_SIZEOF(sort_helper_t));
+
+    int i, to_sort = 0;
+    for (i = start; i < end; i ++) {
+        ecs_matched_table_t *table_data = &tables[i];
+        ecs_table_t *table = table_data->data.table;
+        ecs_data_t *data = ecs_table_get_data(table);
+        ecs_vector_t *entities;
+        if (!data || !(entities = data->entities) || !ecs_table_count(table)) {
+            continue;
         }
-        if (remove) {
-            remove->lo_edges[i].add = NULL;
+
+        int32_t index = ecs_type_index_of(table->type, component);
+        if (index != -1) {
+            ecs_column_t *column = &data->columns[index];
+            int16_t size = column->size;
+            int16_t align = column->alignment;
+            helper[to_sort].ptr = ecs_vector_first_t(column->data, size, align);
+            helper[to_sort].elem_size = size;
+        } else {
+            helper[to_sort].ptr = NULL;
+            helper[to_sort].elem_size = 0;
         }
+
+        helper[to_sort].table = table_data;
+        helper[to_sort].entities = ecs_vector_first(entities, ecs_entity_t);
+        helper[to_sort].row = 0;
+        helper[to_sort].count = ecs_table_count(table);
+        to_sort ++;      
     }
 
-    ecs_map_iter_t it = ecs_map_iter(table->hi_edges);
-    ecs_edge_t *edge;
-    ecs_map_key_t component;
-    while ((edge = ecs_map_next(&it, ecs_edge_t, &component))) {
-        ecs_table_t *add = edge->add, *remove = edge->remove;
-        if (add) {
-            ecs_edge_t *e = get_edge(add, component);
-            e->remove = NULL;
-            if (!e->add) {
-                ecs_map_remove(add->hi_edges, component);
+    ecs_table_slice_t *cur = NULL;
+
+    bool proceed;
+    do {
+        int32_t j, min = 0;
+        proceed = true;
+
+        ecs_entity_t e1;
+        while (!(e1 = e_from_helper(&helper[min]))) {
+            min ++;
+            if (min == to_sort) {
+                proceed = false;
+                break;
             }
         }
-        if (remove) {
-            ecs_edge_t *e = get_edge(remove, component);
-            e->add = NULL;
-            if (!e->remove) {
-                ecs_map_remove(remove->hi_edges, component);
-            }
+
+        if (!proceed) {
+            break;
         }
-    }
-}
 
-#define LOAD_FACTOR (1.5)
-#define KEY_SIZE (ECS_SIZEOF(ecs_map_key_t))
-#define BUCKET_COUNT (8)
-#define ELEM_SIZE(elem_size) (KEY_SIZE + elem_size)
-#define BUCKET_SIZE(elem_size, offset)\
-    (offset + BUCKET_COUNT * (ELEM_SIZE(elem_size)))
+        for (j = min + 1; j < to_sort; j++) {
+            ecs_entity_t e2 = e_from_helper(&helper[j]);
+            if (!e2) {
+                continue;
+            }
 
-#define NEXT_ELEM(elem, elem_size) \
-    ECS_OFFSET(elem, ELEM_SIZE(elem_size))
+            void *ptr1 = ptr_from_helper(&helper[min]);
+            void *ptr2 = ptr_from_helper(&helper[j]);
 
-#define GET_ELEM(array, elem_size, index) \
-    ECS_OFFSET(array, ELEM_SIZE(elem_size) * index)
+            if (compare_sort_key(query, e1, ptr1, e2, ptr2) > 0) {
+                min = j;
+            }
+        }
 
-#define PAYLOAD_ARRAY(bucket, offset) \
-    ECS_OFFSET(bucket, offset)
+        sort_helper_t *cur_helper = &helper[min];
 
-#define PAYLOAD(elem) \
-    ECS_OFFSET(elem, KEY_SIZE)
+        if (!cur || cur->table != cur_helper->table) {
+            cur = ecs_vector_add(&query->table_slices, ecs_table_slice_t);
+            ecs_assert(cur != NULL, ECS_INTERNAL_ERROR, NULL);
+            cur->table = cur_helper->table;
+            cur->start_row = cur_helper->row;
+            cur->count = 1;
+        } else {
+            cur->count ++;
+        }
 
-struct ecs_bucket_t {
-    int32_t count;
-};
+        cur_helper->row ++;
+    } while (proceed);
 
-struct ecs_map_t {
-    ecs_sparse_t *buckets;
-    int32_t elem_size;
-    int32_t type_elem_size;
-    int32_t bucket_size;
-    int32_t bucket_count;
-    int32_t count;
-    int32_t offset;
-};
+    ecs_os_free(helper);
+}
 
+/* Report change in memory of query and its matched tables */
 static
-int32_t next_pow_of_2(
-    int32_t n)
+void track_query_alloc(
+    ecs_query_t *query)
 {
-    n --;
-    n |= n >> 1;
-    n |= n >> 2;
-    n |= n >> 4;
-    n |= n >> 8;
-    n |= n >> 16;
-    n ++;
+    int32_t column_count = ecs_vector_count(query->sig.columns);
+    int32_t table_count = ecs_vector_count(query->tables) + 
+        ecs_vector_count(query->empty_tables);
 
-    return n;
-}
+    ecs_size_t bytes = ECS_SIZEOF(ecs_query_t) +
+        (ecs_vector_size(query->tables) + 
+            ecs_vector_size(query->empty_tables)) * 
+                ECS_SIZEOF(ecs_matched_table_t) +
+        ecs_vector_size(query->table_slices) * ECS_SIZEOF(ecs_table_slice_t) +
+        table_count * column_count * (ECS_SIZEOF(int32_t) + 
+            ECS_SIZEOF(ecs_entity_t) + ECS_SIZEOF(ecs_type_t));
 
-static
-int32_t get_bucket_count(
-    int32_t element_count)
-{
-    return next_pow_of_2((int32_t)((float)element_count * LOAD_FACTOR));
+    ecs_os_track_alloc(EcsAllocQuery, query->alloc_bytes, bytes);
+    query->alloc_bytes = bytes;
 }
 
+/* Build slices for a range of tables with the same rank, and store the range
+ * of slices in the group so the group can be iterated directly */
 static
-uint64_t get_bucket_id(
-    int32_t bucket_count,
-    ecs_map_key_t key) 
+void build_sorted_group(
+    ecs_query_t *query,
+    int32_t start,
+    int32_t end)
 {
-    ecs_assert(bucket_count > 0, ECS_INTERNAL_ERROR, NULL);
-    uint64_t result = key & ((uint64_t)bucket_count - 1);
-    ecs_assert(result < INT32_MAX, ECS_INTERNAL_ERROR, NULL);
-    return result;
+    int32_t slice_first = ecs_vector_count(query->table_slices);
+    build_sorted_table_range(query, start, end);
+
+    if (query->groups) {
+        ecs_matched_table_t *table = ecs_vector_get(
+            query->tables, ecs_matched_table_t, start);
+        ecs_query_group_t *group = ecs_map_get(
+            query->groups, ecs_query_group_t, (uint32_t)table->rank);
+        if (group) {
+            group->slice_first = slice_first;
+            group->slice_count = 
+                ecs_vector_count(query->table_slices) - slice_first;
+        }
+    }
 }
 
 static
-ecs_bucket_t* find_bucket(
-    const ecs_map_t *map,
-    ecs_map_key_t key)
+void build_sorted_tables(
+    ecs_query_t *query)
 {
-    ecs_sparse_t *buckets = map->buckets;
-    int32_t bucket_count = map->bucket_count;
-    if (!bucket_count) {
-        return NULL;
+    /* Clean previous sorted tables */
+    ecs_vector_free(query->table_slices);
+    query->table_slices = NULL;
+
+    int32_t i, count = ecs_vector_count(query->tables);
+    ecs_matched_table_t *tables = ecs_vector_first(query->tables, ecs_matched_table_t);
+    ecs_matched_table_t *table = NULL;
+
+    int32_t start = 0, rank = 0;
+    for (i = 0; i < count; i ++) {
+        table = &tables[i];
+        if (rank != table->rank) {
+            if (start != i) {
+                build_sorted_group(query, start, i);
+                start = i;
+            }
+            rank = table->rank;
+        }
     }
 
-    uint64_t bucket_id = get_bucket_id(bucket_count, key);
+    if (start != i) {
+        build_sorted_group(query, start, i);
+    }
 
-    return _ecs_sparse_get_sparse(buckets, 0, bucket_id);
+    track_query_alloc(query);
 }
 
 static
-ecs_bucket_t* find_or_create_bucket(
-    ecs_map_t *map,
-    ecs_map_key_t key)
+bool tables_dirty(
+    ecs_query_t *query)
 {
-    ecs_sparse_t *buckets = map->buckets;
-    int32_t bucket_count = map->bucket_count;
+    int32_t i, count = ecs_vector_count(query->tables);
+    ecs_matched_table_t *tables = ecs_vector_first(query->tables, 
+        ecs_matched_table_t);
+    bool is_dirty = false;
 
-    if (!bucket_count) {
-        ecs_sparse_set_size(buckets, 8);
-        bucket_count = 8;
-    }
+    for (i = 0; i < count; i ++) {
+        ecs_matched_table_t *table_data = &tables[i];
+        ecs_table_t *table = table_data->data.table;
 
-    uint64_t bucket_id = get_bucket_id(bucket_count, key);
-    return _ecs_sparse_get_or_create(buckets, 0, bucket_id);    
-}
+        if (!table_data->monitor) {
+            table_data->monitor = ecs_table_get_monitor(table);
+            is_dirty = true;
+        }
 
-static
-void remove_bucket(
-    ecs_map_t *map,
-    ecs_map_key_t key)
-{
-    int32_t bucket_count = map->bucket_count;
-    uint64_t bucket_id = get_bucket_id(bucket_count, key);
-    ecs_sparse_remove(map->buckets, bucket_id);
-    ecs_sparse_set_generation(map->buckets, bucket_id);
-}
+        int32_t *dirty_state = ecs_table_get_dirty_state(table);
+        int32_t t, type_count = table->column_count;
+        for (t = 0; t < type_count + 1; t ++) {
+            is_dirty = is_dirty || (dirty_state[t] != table_data->monitor[t]);
+        }
+    }
 
-static
-int32_t add_to_bucket(
-    ecs_bucket_t *bucket,
-    ecs_size_t elem_size,
-    int32_t offset,
-    ecs_map_key_t key,
-    void *payload)
-{
-    ecs_assert(bucket->count < BUCKET_COUNT, ECS_INTERNAL_ERROR, NULL);
+    is_dirty = is_dirty || (query->match_count != query->prev_match_count);
 
-    void *array = PAYLOAD_ARRAY(bucket, offset);
-    ecs_map_key_t *elem = GET_ELEM(array, elem_size, bucket->count);
-    *elem = key;
-    ecs_os_memcpy(PAYLOAD(elem), payload, elem_size);
-    return ++ bucket->count;
+    return is_dirty;
 }
 
 static
-void remove_from_bucket(
-    ecs_bucket_t *bucket,
-    ecs_map_key_t key,
-    ecs_size_t elem_size,
-    int32_t offset,
-    int32_t index)
+void tables_reset_dirty(
+    ecs_query_t *query)
 {
-    (void)key;
+    query->prev_match_count = query->match_count;
 
-    ecs_assert(bucket->count != 0, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(index < bucket->count, ECS_INTERNAL_ERROR, NULL);
+    int32_t i, count = ecs_vector_count(query->tables);
+    ecs_matched_table_t *tables = ecs_vector_first(
+        query->tables, ecs_matched_table_t);
 
-    bucket->count--;
+    for (i = 0; i < count; i ++) {
+        ecs_matched_table_t *table_data = &tables[i];
+        ecs_table_t *table = table_data->data.table;
 
-    if (index != bucket->count) {
-        void *array = PAYLOAD_ARRAY(bucket, offset);
-        ecs_map_key_t *elem = GET_ELEM(array, elem_size, index);
-        ecs_map_key_t *last_elem = GET_ELEM(array, elem_size, bucket->count);
+        if (!table_data->monitor) {
+            /* If one table doesn't have a monitor, none of the tables will have
+             * a monitor, so early out. */
+            return;
+        }
 
-        ecs_assert(key == *elem, ECS_INTERNAL_ERROR, NULL);
-        ecs_os_memcpy(elem, last_elem, ELEM_SIZE(elem_size));
+        int32_t *dirty_state = ecs_table_get_dirty_state(table);
+        int32_t t, type_count = table->column_count;
+        for (t = 0; t < type_count + 1; t ++) {
+            table_data->monitor[t] = dirty_state[t];
+        }
     }
 }
 
 static
-void rehash(
-    ecs_map_t *map,
-    int32_t bucket_count)
+void sort_tables(
+    ecs_world_t *world,
+    ecs_query_t *query)
 {
-    bool rehash_again;
-
-    ecs_assert(bucket_count != 0, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(bucket_count > map->bucket_count, ECS_INTERNAL_ERROR, NULL);
-
-    do {
-        rehash_again = false;
-
-        ecs_sparse_t *buckets = map->buckets;
-        ecs_size_t elem_size = map->elem_size;
-        int32_t offset = map->offset;
-
-        ecs_sparse_set_size(buckets, bucket_count);
-        map->bucket_count = bucket_count;
-
-        /* Only iterate over old buckets with elements */
-        int32_t b, filled_bucket_count = ecs_sparse_count(buckets);
-        const uint64_t *indices = ecs_sparse_ids(buckets);
+    ecs_compare_action_t compare = query->compare;
+    ecs_sort_key_kind_t sort_key_kind = query->sort_key_kind;
+    if (!compare && !sort_key_kind) {
+        return;
+    }
+    
+    ecs_entity_t sort_on_component = query->sort_on_component;
 
-        /* Iterate backwards as elements could otherwise be moved to existing
-         * buckets which could temporarily cause the number of elements in a
-         * bucket to exceed BUCKET_COUNT. */
-        for (b = filled_bucket_count - 1; b >= 0; b --) {
-            uint64_t bucket_id = indices[b];
-            ecs_bucket_t *bucket = _ecs_sparse_get_sparse(buckets, 0, bucket_id);
-            ecs_assert(bucket != NULL, ECS_INTERNAL_ERROR, NULL);
+    /* Sorting moves rows and updates entity records, which is not safe while
+     * other threads read the world. Remember which tables are dirty, and sort
+     * them when the read epoch has ended. */
+    bool postpone = world->read_enabled;
 
-            int i, count = bucket->count;
-            ecs_map_key_t *array = PAYLOAD_ARRAY(bucket, offset);
+    /* Iterate over active tables. Don't bother with inactive tables, since
+     * they're empty */
+    int32_t i, count = ecs_vector_count(query->tables);
+    ecs_matched_table_t *tables = ecs_vector_first(
+        query->tables, ecs_matched_table_t);
+    bool tables_sorted = false;
 
-            for (i = 0; i < count; i ++) {
-                ecs_map_key_t *elem = GET_ELEM(array, elem_size, i);
-                ecs_map_key_t key = *elem;
-                uint64_t new_bucket_id = get_bucket_id(bucket_count, key);
+    for (i = 0; i < count; i ++) {
+        ecs_matched_table_t *table_data = &tables[i];
+        ecs_table_t *table = table_data->data.table;
 
-                if (new_bucket_id != bucket_id) {
-                    ecs_bucket_t *new_bucket = _ecs_sparse_get_or_create(
-                        buckets, 0, new_bucket_id);
-                    ecs_assert(new_bucket != NULL, ECS_INTERNAL_ERROR, NULL);
+        /* If no monitor had been created for the table yet, create it now */
+        bool is_dirty = false;
+        if (!table_data->monitor) {
+            table_data->monitor = ecs_table_get_monitor(table);
 
-                    indices = ecs_sparse_ids(buckets);
-                    ecs_assert(indices != NULL, ECS_INTERNAL_ERROR, NULL);
+            /* A new table is always dirty */
+            is_dirty = true;
+        }
 
-                    if (add_to_bucket(new_bucket, elem_size, offset, 
-                        key, PAYLOAD(elem)) == BUCKET_COUNT) 
-                    {
-                        rehash_again = true;
-                    }
+        int32_t *dirty_state = ecs_table_get_dirty_state(table);
 
-                    remove_from_bucket(bucket, key, elem_size, offset, i);
+        is_dirty = is_dirty || table_data->sort_pending ||
+            (dirty_state[0] != table_data->monitor[0]);
 
-                    count --;
-                    i --;
-                }
+        int32_t index = -1;
+        if (sort_on_component) {
+            /* Get index of sorted component. We only care if the component we're
+            * sorting on has changed or if entities have been added / re(moved) */
+            index = ecs_type_index_of(table->type, sort_on_component);
+            ecs_assert(index != -1, ECS_INVALID_PARAMETER, NULL);
+            ecs_assert(index < ecs_vector_count(table->type), ECS_INTERNAL_ERROR, NULL); 
+            is_dirty = is_dirty || (dirty_state[index + 1] != table_data->monitor[index + 1]);
+        }      
+        
+        /* Check both if entities have moved (element 0) or if the component
+         * we're sorting on has changed (index + 1) */
+        if (is_dirty && postpone) {
+            table_data->sort_pending = true;
+            query->flags |= EcsQuerySortPending;
+        } else if (is_dirty) {
+            /* Sort the table */
+            if (sort_key_kind) {
+                radix_sort_table(world, table, index, sort_key_kind, 
+                    query->sort_key_offset);
+            } else {
+                sort_table(world, table, index, compare);
             }
+            table_data->sort_pending = false;
+            tables_sorted = true;
         }
+    }
 
-        bucket_count *= 2;        
-    } while (rehash_again);
-}
-
-ecs_map_t* _ecs_map_new(
-    ecs_size_t elem_size,
-    ecs_size_t alignment, 
-    int32_t element_count)
-{
-    ecs_map_t *result = ecs_os_calloc(ECS_SIZEOF(ecs_map_t) * 1);
-    ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
-
-    int32_t bucket_count = get_bucket_count(element_count);
-
-    result->count = 0;
-    result->type_elem_size = elem_size;
+    bool tables_changed = query->match_count != query->prev_match_count;
 
-    if (elem_size < ECS_SIZEOF(ecs_map_key_t)) {
-        result->elem_size = ECS_SIZEOF(ecs_map_key_t);
-    } else {
-        result->elem_size = elem_size;
-    }
-    
-    if (alignment < ECS_SIZEOF(ecs_map_key_t)) {
-        result->offset = ECS_SIZEOF(ecs_map_key_t);
-    } else {
-        result->offset = alignment;
+    if (postpone) {
+        if (tables_changed) {
+            query->flags |= EcsQuerySortPending;
+        }
+        return;
     }
 
-    result->bucket_count = bucket_count;
-    result->buckets = _ecs_sparse_new(BUCKET_SIZE(elem_size, result->offset));
-
-    return result;
-}
+    if (query->flags & EcsQuerySortPending) {
+        query->flags &= ~EcsQuerySortPending;
+        tables_changed = true;
+    }
 
-void ecs_map_free(
-    ecs_map_t *map)
-{
-    if (map) {
-        ecs_sparse_free(map->buckets);
-        ecs_os_free(map);
+    if (tables_sorted || tables_changed) {
+        build_sorted_tables(query);
+        query->match_count ++; /* Increase version if tables changed */
     }
 }
 
-void* _ecs_map_get(
-    const ecs_map_t *map,
-    ecs_size_t elem_size,
-    ecs_map_key_t key)
+static
+bool has_refs(
+    ecs_sig_t *sig)
 {
-    (void)elem_size;
-
-    if (!map) {
-        return NULL;
-    }
-
-    ecs_assert(elem_size == map->type_elem_size, ECS_INVALID_PARAMETER, NULL);
-
-    ecs_bucket_t * bucket = find_bucket(map, key);
-
-    if (!bucket) {
-        return NULL;
-    }
+    int32_t i, count = ecs_vector_count(sig->columns);
+    ecs_sig_column_t *columns = ecs_vector_first(sig->columns, ecs_sig_column_t);
 
-    ecs_map_key_t *elem = PAYLOAD_ARRAY(bucket, map->offset);
+    for (i = 0; i < count; i ++) {
+        ecs_sig_from_kind_t from_kind = columns[i].from_kind;
 
-    uint8_t i = 0;
-    while (i++ < bucket->count) {
-        if (*elem == key) {
-            return PAYLOAD(elem);
+        if (columns[i].oper_kind == EcsOperNot && from_kind == EcsFromEmpty) {
+            /* Special case: if oper kind is Not and the query contained a
+             * shared expression, the expression is translated to FromId to
+             * prevent resolving the ref */
+            return true;
+        } else if (from_kind != EcsFromAny && from_kind != EcsFromEmpty) {
+            /* If the component is not from the entity being iterated over, and
+             * the column is not just passing an id, it must be a reference to
+             * another entity. */
+            return true;
         }
-
-        elem = NEXT_ELEM(elem, map->elem_size);
     }
 
-    return NULL;
+    return false;
 }
 
-void* _ecs_map_get_ptr(
-    const ecs_map_t *map,
-    ecs_map_key_t key)
+static
+bool has_traits(
+    ecs_sig_t *sig)
 {
-    void * ptr_ptr = _ecs_map_get(map, ECS_SIZEOF(void*), key);
+    int32_t i, count = ecs_vector_count(sig->columns);
+    ecs_sig_column_t *columns = ecs_vector_first(sig->columns, ecs_sig_column_t);
 
-    if (ptr_ptr) {
-        return *(void**)ptr_ptr;
-    } else {
-        return NULL;
+    for (i = 0; i < count; i ++) {
+        if (is_column_trait(&columns[i])) {
+            return true;
+        }
     }
+
+    return false;    
 }
 
-void _ecs_map_set(
-    ecs_map_t *map,
-    ecs_size_t elem_size,
-    ecs_map_key_t key,
-    const void *payload)
+static
+void register_monitors(
+    ecs_world_t *world,
+    ecs_query_t *query)
 {
-    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(elem_size == map->type_elem_size, ECS_INVALID_PARAMETER, NULL);
+    ecs_vector_each(query->sig.columns, ecs_sig_column_t, column, {
+        /* If component is requested with CASCADE source register component as a
+         * parent monitor. Parent monitors keep track of whether an entity moved
+         * in the hierarchy, which potentially requires the query to reorder its
+         * tables. 
+         * Also register a regular component monitor for EcsCascade columns.
+         * This ensures that when the component used in the CASCADE column
+         * is added or removed tables are updated accordingly*/
+        if (column->from_kind == EcsCascade) {
+            if (column->oper_kind != EcsOperOr) {
+                ecs_component_monitor_register(
+                    &world->parent_monitors, column->is.component, query);
 
-    ecs_bucket_t * bucket = find_or_create_bucket(map, key);
-    ecs_assert(bucket != NULL, ECS_INTERNAL_ERROR, NULL);
-    
-    int32_t bucket_count = bucket->count;
-    void *array = PAYLOAD_ARRAY(bucket, map->offset);
-    ecs_map_key_t *elem = array, *found = NULL;
+                ecs_component_monitor_register(
+                    &world->component_monitors, column->is.component, query);
+            } else {
+                ecs_vector_each(column->is.type, ecs_entity_t, e_ptr, {
+                    ecs_component_monitor_register(
+                        &world->parent_monitors, *e_ptr, query);
 
-    uint8_t i = 0;
-    while (i++ < bucket_count) {
-        if (*elem == key) {
-            found = elem;
-            break;
-        }
+                    ecs_component_monitor_register(
+                        &world->component_monitors, *e_ptr, query);
+                });
+            }
 
-        elem = NEXT_ELEM(elem, map->elem_size);
-    }
-
-    if (!found) {
-        if (bucket->count == BUCKET_COUNT) {
-            /* Can't fit in current bucket, need to grow the map first */
-            rehash(map, map->bucket_count * 2);
-            _ecs_map_set(map, elem_size, key, payload);
-        } else {
-            ecs_assert(bucket->count < BUCKET_COUNT, ECS_INTERNAL_ERROR, NULL);
-
-            bucket_count = ++bucket->count;
-            int32_t map_count = ++map->count;
-            
-            *elem = key;
-            ecs_os_memcpy(PAYLOAD(elem), payload, elem_size);
-
-            int32_t target_bucket_count = get_bucket_count(map_count);
-            int32_t map_bucket_count = map->bucket_count;
-
-            if (bucket_count == BUCKET_COUNT) {
-                rehash(map, map_bucket_count * 2);
+        /* FromSelf also requires registering a monitor, as FromSelf columns can
+         * be matched with prefabs. The only column kinds that do not require
+         * registering a monitor are FromOwned and FromNothing. */
+        } else if (column->from_kind == EcsFromAny || 
+            column->from_kind == EcsFromShared ||
+            column->from_kind == EcsFromEntity ||
+            column->from_kind == EcsFromParent)
+        {
+            if (column->oper_kind != EcsOperOr) {
+                ecs_component_monitor_register(
+                    &world->component_monitors, column->is.component, query);
             } else {
-                if (target_bucket_count > map_bucket_count) {
-                    rehash(map, target_bucket_count);
-                }
-            }            
+                ecs_vector_each(column->is.type, ecs_entity_t, e_ptr, {
+                    ecs_component_monitor_register(
+                        &world->component_monitors, *e_ptr, query);
+                });
+            }
         }
-    } else {
-        *found = key;
-        ecs_os_memcpy(PAYLOAD(found), payload, elem_size);
-    }
-
-    ecs_assert(map->bucket_count != 0, ECS_INTERNAL_ERROR, NULL);
+    });
 }
 
-void ecs_map_remove(
-    ecs_map_t *map,
-    ecs_map_key_t key)
+static
+void process_signature(
+    ecs_world_t *world,
+    ecs_query_t *query)
 {
-    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+    int i, count = ecs_vector_count(query->sig.columns);
+    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
 
-    ecs_bucket_t * bucket = find_bucket(map, key);
-    if (!bucket) {
-        return;
-    }
-   
-    ecs_size_t elem_size = map->elem_size;
-    void *array = PAYLOAD_ARRAY(bucket, map->offset);
-    ecs_map_key_t *elem = array;
-    int32_t bucket_count = bucket->count;
+    for (i = 0; i < count; i ++) {
+        ecs_sig_column_t *column = &columns[i];
+        ecs_sig_oper_kind_t op = column->oper_kind; 
+        ecs_sig_from_kind_t from = column->from_kind; 
+        ecs_sig_inout_kind_t inout = column->inout_kind;
 
-    if (!bucket_count) {
-        return;
-    }
+        if (inout == EcsInPrev) {
+            query->flags |= EcsQueryHasPrev;
+        } else if (inout != EcsIn) {
+            query->flags |= EcsQueryHasOutColumns;
+        }
 
-    uint8_t i = 0;
-    do {
-        if (*elem == key) {
-            ecs_map_key_t *last_elem = GET_ELEM(array, elem_size, (bucket_count - 1));
-            if (last_elem > elem) {
-                ecs_os_memcpy(elem, last_elem, ELEM_SIZE(elem_size));
+        if (op == EcsOperOptional) {
+            query->flags |= EcsQueryHasOptional;
+        }        
+
+        if (!(query->flags & EcsQueryMatchDisabled)) {
+            if (op == EcsOperOr) {
+                /* If the signature explicitly indicates interest in EcsDisabled,
+                 * signal that disabled entities should be matched. By default,
+                 * disabled entities are not matched. */
+                if (ecs_type_owns_entity(
+                    world, column->is.type, EcsDisabled, true))
+                {
+                    query->flags |= EcsQueryMatchDisabled;
+                }         
+            } else if (op == EcsOperAnd || op == EcsOperOptional) {
+                if (column->is.component == EcsDisabled) {
+                    query->flags |= EcsQueryMatchDisabled;
+                }
             }
+        }
 
-            map->count --;
-            if (!--bucket->count) {
-                remove_bucket(map, key);
+        if (!(query->flags & EcsQueryMatchPrefab)) {
+            if (op == EcsOperOr) {
+                /* If the signature explicitly indicates interest in EcsPrefab,
+                * signal that disabled entities should be matched. By default,
+                * prefab entities are not matched. */
+                if (ecs_type_owns_entity(
+                    world, column->is.type, EcsPrefab, true))
+                {
+                    query->flags |= EcsQueryMatchPrefab;
+                }            
+            } else if (op == EcsOperAnd || op == EcsOperOptional) {
+                if (column->is.component == EcsPrefab) {
+                    query->flags |= EcsQueryMatchPrefab;
+                }
             }
+        }
 
-            break;
+        if (from == EcsFromAny || 
+            from == EcsFromOwned ||
+            from == EcsFromShared ||
+            from == EcsFromParent) 
+        {
+            query->flags |= EcsQueryNeedsTables;
         }
 
-        elem = NEXT_ELEM(elem, elem_size);
-    } while (++i < bucket_count);   
-}
+        if (from == EcsCascade) {
+            query->cascade_by = i + 1;
+            query->rank_on_component = column->is.component;
+        }
 
-int32_t ecs_map_count(
-    const ecs_map_t *map)
-{
-    return map ? map->count : 0;
-}
+        if (from == EcsFromEntity) {
+            ecs_assert(column->source != 0, ECS_INTERNAL_ERROR, NULL);
+            ecs_set_watch(world, column->source);
+            query->flags |= EcsQueryHasFromEntity;
+        }
+    }
 
-int32_t ecs_map_bucket_count(
-    const ecs_map_t *map)
-{
-    return map ? map->bucket_count : 0;
+    query->flags |= (ecs_flags32_t)(has_refs(&query->sig) * EcsQueryHasRefs);
+    query->flags |= (ecs_flags32_t)(has_traits(&query->sig) * EcsQueryHasTraits);
+
+    if (!(query->flags & EcsQueryIsSubquery)) {
+        register_monitors(world, query);
+    }
 }
 
-void ecs_map_clear(
-    ecs_map_t *map)
+bool match_table(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_table_t *table)
 {
-    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_sparse_clear(map->buckets);
-    map->count = 0;
+    if (ecs_query_match(world, table, query, NULL)) {
+        add_table(world, query, table);
+        return true;
+    }
+    return false;
 }
 
-ecs_map_iter_t ecs_map_iter(
-    const ecs_map_t *map)
+/** Table activation happens when a table was or becomes empty. Deactivated
+ * tables are not considered by the system in the main loop. */
+void activate_table(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_table_t *table,
+    bool active)
 {
-    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_vector_t *src_array, *dst_array;
 
-    return (ecs_map_iter_t){
-        .map = map,
-        .bucket = NULL,
-        .bucket_index = 0,
-        .element_index = 0
-    };
-}
+    if (active) {
+        src_array = query->empty_tables;
+        dst_array = query->tables;
+    } else {
+        src_array = query->tables;
+        dst_array = query->empty_tables;
+    }
 
-void* _ecs_map_next(
-    ecs_map_iter_t *iter,
-    ecs_size_t elem_size,
-    ecs_map_key_t *key_out)
-{
-    const ecs_map_t *map = iter->map;
-    
-    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(!elem_size || elem_size == map->type_elem_size, ECS_INVALID_PARAMETER, NULL);
- 
-    ecs_bucket_t *bucket = iter->bucket;
-    int32_t element_index = iter->element_index;
-    elem_size = map->elem_size;
+    int32_t i = 0, activated = 0;
+    while ((i = get_table_param_index(query, table, !active, i)) != -1) {
+        activated ++;
 
-    do {
-        if (!bucket) {
-            int32_t bucket_index = iter->bucket_index;
-            ecs_sparse_t *buckets = map->buckets;
-            if (bucket_index < ecs_sparse_count(buckets)) {
-                bucket = _ecs_sparse_get(buckets, 0, bucket_index);
-                iter->bucket = bucket;
+        int32_t src_count = ecs_vector_move_index(
+            &dst_array, src_array, ecs_matched_table_t, i);
 
-                element_index = 0;
-                iter->element_index = 0;
-            } else {
-                return NULL;
-            }
-        }
+        /* The table is appended to the destination, and the last table of the
+         * source is moved into the slot of the table */
+        set_table_slot(query, dst_array, ecs_vector_count(dst_array) - 1, 
+            active);
+        set_table_slot(query, src_array, i, !active);
 
-        if (element_index < bucket->count) {
-            iter->element_index = element_index + 1;
-            break;
+        if (active) {
+            query->tables = dst_array;
         } else {
-            bucket = NULL;
-            iter->bucket_index ++;
+            query->empty_tables = dst_array;
         }
-    } while (true);
 
-    void *array = PAYLOAD_ARRAY(bucket, map->offset);
-    ecs_map_key_t *elem = GET_ELEM(array, elem_size, element_index);
-    
-    if (key_out) {
-        *key_out = *elem;
+        /* Activate system if registered with query */
+#ifdef FLECS_SYSTEMS_H
+        if (query->system) {
+            int32_t dst_count = ecs_vector_count(dst_array);
+            if (active) {
+                if (dst_count == 1) {
+                    ecs_system_activate(world, query->system, true, NULL);
+                }
+            } else if (src_count == 0) {
+                ecs_system_activate(world, query->system, false, NULL);
+            }
+        }
+#else
+        (void)src_count;
+#endif        
     }
 
-    return PAYLOAD(elem);
-}
-
-void* _ecs_map_next_ptr(
-    ecs_map_iter_t *iter,
-    ecs_map_key_t *key_out)
-{
-    void *result = _ecs_map_next(iter, ECS_SIZEOF(void*), key_out);
-    if (result) {
-        return *(void**)result;
-    } else {
-        return NULL;
+    if (!activated) {
+        /* Received an activate event for a table we're not matched with. This
+        * can only happen if this is a subquery */
+        ecs_assert((query->flags & EcsQueryIsSubquery) != 0, 
+            ECS_INTERNAL_ERROR, NULL);
+        return;
     }
+
+    order_ranked_tables(world, query);
 }
 
-void ecs_map_grow(
-    ecs_map_t *map, 
-    int32_t element_count)
+static
+void add_subquery(
+    ecs_world_t *world, 
+    ecs_query_t *parent, 
+    ecs_query_t *subquery) 
 {
-    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
-    int32_t target_count = map->count + element_count;
-    int32_t bucket_count = get_bucket_count(target_count);
+    ecs_query_t **elem = ecs_vector_add(&parent->subqueries, ecs_query_t*);
+    *elem = subquery;
 
-    if (bucket_count > map->bucket_count) {
-        rehash(map, bucket_count);
+    /* Iterate matched tables, match them with subquery */
+    ecs_matched_table_t *tables = ecs_vector_first(parent->tables, ecs_matched_table_t);
+    int32_t i, count = ecs_vector_count(parent->tables);
+
+    for (i = 0; i < count; i ++) {
+        ecs_matched_table_t *table = &tables[i];
+        match_table(world, subquery, table->data.table);
+        activate_table(world, subquery, table->data.table, true);
     }
-}
 
-void ecs_map_set_size(
-    ecs_map_t *map, 
-    int32_t element_count)
-{    
-    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
-    int32_t bucket_count = get_bucket_count(element_count);
+    /* Do the same for inactive tables */
+    tables = ecs_vector_first(parent->empty_tables, ecs_matched_table_t);
+    count = ecs_vector_count(parent->empty_tables);
 
-    if (bucket_count) {
-        rehash(map, bucket_count);
-    }
+    for (i = 0; i < count; i ++) {
+        ecs_matched_table_t *table = &tables[i];
+        match_table(world, subquery, table->data.table);
+    }    
 }
 
-void ecs_map_memory(
-    ecs_map_t *map, 
-    int32_t *allocd,
-    int32_t *used)
+static
+void notify_subqueries(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_query_event_t *event)
 {
-    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_sparse_memory(map->buckets, allocd, NULL);
+    if (query->subqueries) {
+        ecs_query_t **queries = ecs_vector_first(query->subqueries, ecs_query_t*);
+        int32_t i, count = ecs_vector_count(query->subqueries);
 
-    if (used) {
-        *used = map->count * ELEM_SIZE(map->elem_size);
-    }
-}
+        ecs_query_event_t sub_event = *event;
+        sub_event.parent_query = query;
 
-ecs_map_t* ecs_map_copy(
-    const ecs_map_t *src)
-{
-    if (!src) {
-        return NULL;
+        for (i = 0; i < count; i ++) {
+            ecs_query_t *sub = queries[i];
+            ecs_query_notify(world, sub, &sub_event);
+        }
     }
-    
-    ecs_map_t *dst = ecs_os_memdup(src, ECS_SIZEOF(ecs_map_t));
-    
-    dst->buckets = ecs_sparse_copy(src->buckets);
-
-    return dst;
 }
 
 static
-void* get_owned_column_ptr(
-    const ecs_iter_t *it,
-    ecs_size_t size,
-    int32_t table_column,
-    int32_t row)
+void free_matched_table(
+    ecs_matched_table_t *table)
 {
-    ecs_assert(it->table_columns != NULL, ECS_INTERNAL_ERROR, NULL);
-    (void)size;
-
-    ecs_column_t *column = &((ecs_column_t*)it->table_columns)[table_column - 1];
-    ecs_assert(column->size != 0, ECS_COLUMN_HAS_NO_DATA, NULL);
-    ecs_assert(!size || column->size == size, ECS_COLUMN_TYPE_MISMATCH, NULL);
-    void *buffer = ecs_vector_first_t(column->data, column->size, column->alignment);
-    return ECS_OFFSET(buffer, column->size * (it->offset + row));
+    ecs_os_free(table->data.columns);
+    ecs_os_free(table->data.components);
+    ecs_os_free((ecs_vector_t**)table->data.types);
+    ecs_os_free(table->data.references);
+    ecs_os_free(table->sparse_columns);
+    ecs_vector_free(table->bitset_columns);
+    ecs_vector_free(table->lookup_columns);
+    ecs_os_free(table->monitor);
 }
 
+/* Remove table */
 static
-const void* get_shared_column(
-    const ecs_iter_t *it,
-    ecs_size_t size,
-    int32_t table_column)
+void remove_table(
+    ecs_query_t *query,
+    bool active,
+    int32_t index)
 {
-    ecs_ref_t *refs = it->table->references;
-    ecs_assert(refs != NULL, ECS_INTERNAL_ERROR, NULL);
-    (void)size;
-
-#ifndef NDEBUG
-    if (size) {
-        ecs_entity_t component_id = ecs_component_id_from_id(
-            it->world, refs[-table_column - 1].component);
-
-        const EcsComponent *cdata = ecs_get(
-            it->world, component_id, EcsComponent);
+    ecs_vector_t *tables = active ? query->tables : query->empty_tables;
+    ecs_matched_table_t *table = ecs_vector_get(
+        tables, ecs_matched_table_t, index);
 
-        ecs_assert(cdata != NULL, ECS_INTERNAL_ERROR, NULL);
-        ecs_assert(cdata->size == size, ECS_COLUMN_TYPE_MISMATCH, 
-            ecs_get_name(it->world, it->system));
+    if (query->table_slots) {
+        ecs_map_remove(query->table_slots, table->data.table->id);
     }
-#endif
-
-    ecs_ref_t *ref = &refs[-table_column - 1];
 
-    return (void*)ecs_get_ref_w_entity(
-        it->world, ref, ref->entity, ref->component);
+    free_matched_table(table);
+    ecs_vector_remove_index(tables, ecs_matched_table_t, index);
+    set_table_slot(query, tables, index, active);
 }
 
+/* Remove active table of a ranked query. Unlike remove_table, this preserves
+ * the order of the remaining tables, so that groups remain contiguous without
+ * sorting all tables. Only the tables after the removed table are updated. */
 static
-bool get_table_column(
-    const ecs_iter_t *it,
-    int32_t column,
-    int32_t *table_column_out)
+void remove_ranked_table(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    int32_t index)
 {
-    ecs_assert(column <= it->column_count, ECS_INVALID_PARAMETER, NULL);
-
-    int32_t table_column = 0;
-
-    if (column != 0) {
-        ecs_assert(it->table->columns != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_matched_table_t *tables = ecs_vector_first(
+        query->tables, ecs_matched_table_t);
+    int32_t i, count = ecs_vector_count(query->tables);
+    int32_t rank = tables[index].rank;
 
-        table_column = it->table->columns[column - 1];
-        if (!table_column) {
-            /* column is not set */
-            return false;
-        }
+    if (query->table_slots) {
+        ecs_map_remove(query->table_slots, tables[index].data.table->id);
     }
 
-    *table_column_out = table_column;
-
-    return true;
-}
+    free_matched_table(&tables[index]);
+    ecs_os_memmove(&tables[index], &tables[index + 1],
+        ECS_SIZEOF(ecs_matched_table_t) * (count - index - 1));
+    ecs_vector_remove_last(query->tables);
+    count --;
 
-static
-void* get_column(
-    const ecs_iter_t *it,
-    ecs_size_t size,
-    int32_t column,
-    int32_t row)
-{
-    int32_t table_column;
+    for (i = index; i < count; i ++) {
+        set_table_slot(query, query->tables, i, true);
 
-    if (!column) {
-        return it->entities;
+        /* Update the matched table index registered with monitors */
+        if (query->flags & EcsQueryMonitor) {
+            ecs_table_notify(world, tables[i].data.table, &(ecs_table_event_t){
+                .kind = EcsTableQueryMatch,
+                .query = query,
+                .matched_table_index = i
+            });
+        }
     }
 
-    if (!get_table_column(it, column, &table_column)) {
-        return NULL;
-    }
+    if (query->groups) {
+        ecs_map_iter_t it = ecs_map_iter(query->groups);
+        ecs_query_group_t *group;
+        while ((group = ecs_map_next(&it, ecs_query_group_t, NULL))) {
+            if (group->first > index) {
+                group->first --;
+            }
+        }
 
-    if (table_column < 0) {
-        return (void*)get_shared_column(it, size, table_column);
-    } else {
-        return get_owned_column_ptr(it, size, table_column, row);
+        group = ecs_map_get(query->groups, ecs_query_group_t, (uint32_t)rank);
+        ecs_assert(group != NULL, ECS_INTERNAL_ERROR, NULL);
+        if (!(-- group->count)) {
+            ecs_map_remove(query->groups, (uint32_t)rank);
+        }
     }
-}
-
-
-/* --- Public API --- */
 
-void* ecs_column_w_size(
-    const ecs_iter_t *it,
-    size_t size,
-    int32_t column)
-{
-    return get_column(it, ecs_from_size_t(size), column, 0);
+    query->match_count ++;
 }
 
-void* ecs_element_w_size(
-    const ecs_iter_t *it, 
-    size_t size,
-    int32_t column,
-    int32_t row)
+static
+void unmatch_table_w_index(
+    ecs_query_t *query,
+    ecs_table_t *table,
+    int32_t match)
 {
-    return get_column(it, ecs_from_size_t(size), column, row);
+    /* If table no longer matches, remove it */
+    if (match != -1) {
+        if (query->group_table) {
+            remove_ranked_table(query->world, query, match);
+        } else {
+            remove_table(query, true, match);
+        }
+    } else {
+        /* Make sure the table is removed if it was inactive */
+        match = table_matched(query, table, false);
+        if (match != -1) {
+            remove_table(query, false, match);
+        }
+    }  
 }
 
-bool ecs_is_owned(
-    const ecs_iter_t *it,
-    int32_t column)
+static
+void unmatch_table(
+    ecs_query_t *query,
+    ecs_table_t *table)
 {
-    int32_t table_column;
-
-    if (!get_table_column(it, column, &table_column)) {
-        return true;
-    }
-
-    return table_column >= 0;
+    unmatch_table_w_index(
+        query, table, table_matched(query, table, true));       
 }
 
-bool ecs_is_readonly(
-    const ecs_iter_t *it,
-    int32_t column)
+static
+void rematch_table(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_table_t *table)
 {
-    ecs_query_t *query = it->query;
-
-    /* If this is not a query iterator, readonly is meaningless */
-    ecs_assert(query != NULL, ECS_INVALID_OPERATION, NULL);
+    int32_t match = table_matched(query, table, true);
 
-    ecs_sig_column_t *column_data = ecs_vector_get(
-        it->query->sig.columns, ecs_sig_column_t, column - 1);
+    if (ecs_query_match(world, table, query, NULL)) {
+        /* If the table matches, and it is not currently matched, add */
+        if (match == -1) {
+            if (table_matched(query, table, false) == -1) {
+                add_table(world, query, table);
+            }
 
-    return column_data->inout_kind == EcsIn;
+        /* If table still matches and has cascade column, reevaluate the
+         * sources of references. This may have changed in case 
+         * components were added/removed to container entities */ 
+        } else if (query->cascade_by) {
+            resolve_cascade_container(
+                world, query, match, table->type);
+
+        /* If query has optional columns, it is possible that a column that
+         * previously had data no longer has data, or vice versa. Do a full
+         * rematch to make sure data is consistent. */
+        } else if (query->flags & EcsQueryHasOptional) {
+            unmatch_table(query, table);
+            if (!(query->flags & EcsQueryIsSubquery)) {
+                ecs_table_notify(world, table, &(ecs_table_event_t){
+                    .kind = EcsTableQueryUnmatch,
+                    .query = query
+                }); 
+            }
+            add_table(world, query, table);
+        }
+    } else {
+        /* Table no longer matches, remove */
+        if (match != -1) {
+            unmatch_table(query, table);
+            if (!(query->flags & EcsQueryIsSubquery)) {
+                ecs_table_notify(world, table, &(ecs_table_event_t){
+                    .kind = EcsTableQueryUnmatch,
+                    .query = query
+                });
+            }
+            notify_subqueries(world, query, &(ecs_query_event_t){
+                .kind = EcsQueryTableUnmatch,
+                .table = table
+            });
+        }
+    }
 }
 
-ecs_entity_t ecs_column_source(
-    const ecs_iter_t *it,
-    int32_t index)
+/* Test if one of the entities that changed is the source of a column with an
+ * explicit source. A change to such an entity can change the match of any 
+ * table. If it is not known which entities changed, assume that one did. */
+static
+bool from_entity_changed(
+    ecs_query_t *query,
+    ecs_vector_t *changed)
 {
-    ecs_assert(index <= it->column_count, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(index > 0, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(it->table->columns != NULL, ECS_INTERNAL_ERROR, NULL);
-
-    ecs_iter_table_t *table = it->table;
-    int32_t table_column = table->columns[index - 1];
-    if (table_column >= 0) {
-        return 0;
+    if (!changed) {
+        return true;
     }
 
-    ecs_assert(table->references != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_ref_t *ref = &table->references[-table_column - 1];
-    return ref->entity;
-}
+    ecs_vector_each(query->sig.columns, ecs_sig_column_t, column, {
+        if (column->from_kind != EcsFromEntity) {
+            continue;
+        }
 
-ecs_type_t ecs_column_type(
-    const ecs_iter_t *it,
-    int32_t index)
-{
-    ecs_assert(index <= it->column_count, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(index > 0, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(it->table->types != NULL, ECS_INTERNAL_ERROR, NULL);
-    return it->table->types[index - 1];
-}
+        ecs_vector_each(changed, ecs_entity_t, e_ptr, {
+            if (*e_ptr == column->source) {
+                return true;
+            }
+        });
+    });
 
-ecs_entity_t ecs_column_entity(
-    const ecs_iter_t *it,
-    int32_t index)
-{
-    ecs_assert(index <= it->column_count, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(index > 0, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(it->table->components != NULL, ECS_INTERNAL_ERROR, NULL);
-    return it->table->components[index - 1];
+    return false;
 }
 
-size_t ecs_column_size(
-    const ecs_iter_t *it,
-    int32_t index)
+/* Rematch system with tables after a change happened to a watched entity */
+static
+void rematch_tables(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_query_t *parent_query,
+    ecs_vector_t *affected,
+    ecs_vector_t *changed)
 {
-    ecs_assert(index <= it->column_count, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(index > 0, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(it->table->columns != NULL, ECS_INTERNAL_ERROR, NULL);
-    int32_t table_column = it->table->columns[index - 1];
-    return ecs_table_column_size(it, table_column - 1);
-}
+    world->stats.rematch_count_total ++;
 
-int32_t ecs_column_index_from_name(
-    const ecs_iter_t *it,
-    const char *name)
-{
-    ecs_sig_column_t *column = NULL;
-    if (it->query) {
-        int32_t i, count = ecs_vector_count(it->query->sig.columns);
+    if (parent_query) {
+        ecs_matched_table_t *tables = ecs_vector_first(parent_query->tables, ecs_matched_table_t);
+        int32_t i, count = ecs_vector_count(parent_query->tables);
         for (i = 0; i < count; i ++) {
-            column = ecs_vector_get(
-                it->query->sig.columns, ecs_sig_column_t, i);
-            if (column->name) {
-                if (!strcmp(name, column->name)) {
-                    return i + 1;
-                }
-            }
+            ecs_table_t *table = tables[i].data.table;
+            rematch_table(world, query, table);
+        }
+
+        tables = ecs_vector_first(parent_query->empty_tables, ecs_matched_table_t);
+        count = ecs_vector_count(parent_query->empty_tables);
+        for (i = 0; i < count; i ++) {
+            ecs_table_t *table = tables[i].data.table;
+            rematch_table(world, query, table);
+        }        
+    } else if (affected && (!(query->flags & EcsQueryHasFromEntity) || 
+        !from_entity_changed(query, changed))) 
+    {
+        /* Only tables with the changed entities as parent or base can change
+         * their match. When the source of a column with an explicit source
+         * changed, any table can change its match, so all tables are
+         * evaluated. */
+        ecs_vector_each(affected, ecs_table_t*, table_ptr, {
+            rematch_table(world, query, *table_ptr);
+        });
+    } else {
+        ecs_sparse_t *tables = world->store.tables;
+        int32_t i, count = ecs_sparse_count(tables);
+
+        for (i = 0; i < count; i ++) {
+            /* Is the system currently matched with the table? */
+            ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+            rematch_table(world, query, table);
         }
     }
 
-    return 0;
-}
+    group_tables(world, query);
+    order_ranked_tables(world, query);
 
-ecs_type_t ecs_iter_type(
-    const ecs_iter_t *it)
-{
-    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_table_t *table = it->table->table;
-    return table->type;
+    /* Enable/disable system if constraints are (not) met. If the system is
+     * already dis/enabled this operation has no side effects. */
+    if (query->system) {
+        if (ecs_sig_check_constraints(world, &query->sig)) {
+            ecs_remove_entity(world, query->system, EcsDisabledIntern);
+        } else {
+            ecs_add_entity(world, query->system, EcsDisabledIntern);
+        }
+    }
 }
 
-int32_t ecs_table_component_index(
-    const ecs_iter_t *it,
-    ecs_entity_t component)
+static
+void remove_subquery(
+    ecs_query_t *parent, 
+    ecs_query_t *sub)
 {
-    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(it->table->table != NULL, ECS_INTERNAL_ERROR, NULL);
-    return ecs_type_index_of(it->table->table->type, component);
-}
+    ecs_assert(parent != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(sub != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(parent->subqueries != NULL, ECS_INTERNAL_ERROR, NULL);
 
-void* ecs_table_column(
-    const ecs_iter_t *it,
-    int32_t column_index)
-{
-    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_table_t *table = it->table->table;
-    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(column_index < ecs_vector_count(table->type), 
-        ECS_INVALID_PARAMETER, NULL);
-    
-    if (table->column_count <= column_index) {
-        return NULL;
+    int32_t i, count = ecs_vector_count(parent->subqueries);
+    ecs_query_t **sq = ecs_vector_first(parent->subqueries, ecs_query_t*);
+
+    for (i = 0; i < count; i ++) {
+        if (sq[i] == sub) {
+            break;
+        }
     }
 
-    ecs_column_t *columns = it->table_columns;
-    ecs_column_t *column = &columns[column_index];
-    return ecs_vector_first_t(column->data, column->size, column->alignment);
+    ecs_vector_remove_index(parent->subqueries, ecs_query_t*, i);
 }
 
-size_t ecs_table_column_size(
-    const ecs_iter_t *it,
-    int32_t column_index)
+/* -- Private API -- */
+
+void ecs_query_notify(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_query_event_t *event)
 {
-    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_table_t *table = it->table->table;
-    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(column_index < ecs_vector_count(table->type), 
-        ECS_INVALID_PARAMETER, NULL);
+    bool notify = true;
 
-    if (table->column_count <= column_index) {
-        return 0;
+    switch(event->kind) {
+    case EcsQueryTableMatch:
+        /* Creation of new table */
+        if (match_table(world, query, event->table)) {
+            if (query->subqueries) {
+                notify_subqueries(world, query, event);
+            }
+        }
+        notify = false;
+        break;
+    case EcsQueryTableUnmatch:
+        /* Deletion of table */
+        unmatch_table(query, event->table);
+        break;
+    case EcsQueryTableRematch:
+        /* Rematch tables of query */
+        rematch_tables(world, query, event->parent_query, event->tables, 
+            event->entities);
+        break;        
+    case EcsQueryTableEmpty:
+        /* Table is empty, deactivate */
+        activate_table(world, query, event->table, false);
+        break;
+    case EcsQueryTableNonEmpty:
+        /* Table is non-empty, activate */
+        activate_table(world, query, event->table, true);
+        break;
+    case EcsQueryOrphan:
+        ecs_assert(query->flags & EcsQueryIsSubquery, ECS_INTERNAL_ERROR, NULL);
+        query->flags |= EcsQueryIsOrphaned;
+        query->parent = NULL;
+        break;
     }
 
-    ecs_column_t *columns = it->table_columns;
-    ecs_column_t *column = &columns[column_index];
-    
-    return ecs_to_size_t(column->size);
-}
+    if (notify) {
+        notify_subqueries(world, query, event);
+    }
 
-int8_t ecs_to_i8(
-    int64_t v)
-{
-    ecs_assert(v < INT8_MAX, ECS_INTERNAL_ERROR, NULL);
-    return (int8_t)v;
+    track_query_alloc(query);
 }
 
-int16_t ecs_to_i16(
-    int64_t v)
-{
-    ecs_assert(v < INT16_MAX, ECS_INTERNAL_ERROR, NULL);
-    return (int16_t)v;
-}
+/* -- Public API -- */
 
-uint32_t ecs_to_u32(
-    uint64_t v)
+ecs_query_t* ecs_query_new_w_sig_intern(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    ecs_sig_t *sig,
+    bool is_subquery)
 {
-    ecs_assert(v < UINT32_MAX, ECS_INTERNAL_ERROR, NULL);
-    return (uint32_t)v;    
+    ecs_query_t *result = ecs_os_calloc(sizeof(ecs_query_t));
+    result->world = world;
+    result->sig = *sig;
+    result->tables = ecs_vector_new(ecs_matched_table_t, 0);
+    result->empty_tables = ecs_vector_new(ecs_matched_table_t, 0);
+    result->system = system;
+    result->prev_match_count = -1;
+
+    if (is_subquery) {
+        result->flags |= EcsQueryIsSubquery;
+    }
+
+    process_signature(world, result);
+
+    /* Queries with traits can match the same table more than once, so a table
+     * does not map to a single slot */
+    if (!(result->flags & EcsQueryHasTraits)) {
+        result->table_slots = ecs_map_new(ecs_query_table_slot_t, 0);
+    }
+
+    ecs_trace_2("query #[green]%s#[reset] created with expression #[red]%s", 
+        query_name(world, result), result->sig.expr);
+
+    ecs_log_push();
+
+    if (!is_subquery) {
+        /* Register query with world */
+        ecs_query_t **elem = ecs_vector_add(&world->queries, ecs_query_t*);
+        *elem = result;
+
+        if (result->flags & EcsQueryNeedsTables) {
+            if (ecs_has_entity(world, system, EcsMonitor)) {
+                result->flags |= EcsQueryMonitor;
+            }
+            
+            if (ecs_has_entity(world, system, EcsOnSet)) {
+                result->flags |= EcsQueryOnSet;
+            }
+
+            if (ecs_has_entity(world, system, EcsUnSet)) {
+                result->flags |= EcsQueryUnSet;
+            }        
+
+            match_tables(world, result);
+        } else {
+            /* Add stub table that resolves references (if any) so everything is
+            * preprocessed when the query is evaluated. */
+            add_table(world, result, NULL);
+        }
+    }
+
+    if (result->cascade_by) {
+        result->group_table = rank_by_depth;
+    }
+
+    ecs_log_pop();
+
+    /* Make sure application can't try to free sig resources */
+    *sig = (ecs_sig_t){ 0 };
+
+    track_query_alloc(result);
+
+    return result;
 }
 
-size_t ecs_to_size_t(
-    int64_t size)
+ecs_query_t* ecs_query_new_w_sig(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    ecs_sig_t *sig)
 {
-    ecs_assert(size >= 0, ECS_INTERNAL_ERROR, NULL);
-    return (size_t)size;
+    return ecs_query_new_w_sig_intern(world, system, sig, false);
 }
 
-ecs_size_t ecs_from_size_t(
-    size_t size)
+ecs_query_t* ecs_query_new(
+    ecs_world_t *world,
+    const char *expr)
 {
-   ecs_assert(size < INT32_MAX, ECS_INTERNAL_ERROR, NULL); 
-   return (ecs_size_t)size;
+    ecs_sig_t sig = { 0 };
+    ecs_sig_init(world, NULL, expr, &sig);
+    return ecs_query_new_w_sig(world, 0, &sig);
 }
 
-/** Convert time to double */
-double ecs_time_to_double(
-    ecs_time_t t)
+ecs_query_t* ecs_subquery_new(
+    ecs_world_t *world,
+    ecs_query_t *parent,
+    const char *expr)
 {
-    double result;
-    result = t.sec;
-    return result + (double)t.nanosec / (double)1000000000;
+    ecs_sig_t sig = { 0 };
+    ecs_sig_init(world, NULL, expr, &sig);
+    ecs_query_t *result = ecs_query_new_w_sig_intern(world, 0, &sig, true);
+    result->parent = parent;
+    add_subquery(world, parent, result);
+    return result;
 }
 
-ecs_time_t ecs_time_sub(
-    ecs_time_t t1,
-    ecs_time_t t2)
+void ecs_query_free(
+    ecs_query_t *query)
 {
-    ecs_time_t result;
+    ecs_world_t *world = query->world;
 
-    if (t1.nanosec >= t2.nanosec) {
-        result.nanosec = t1.nanosec - t2.nanosec;
-        result.sec = t1.sec - t2.sec;
-    } else {
-        result.nanosec = t1.nanosec - t2.nanosec + 1000000000;
-        result.sec = t1.sec - t2.sec - 1;
+    if ((query->flags & EcsQueryIsSubquery) &&
+        !(query->flags & EcsQueryIsOrphaned))
+    {
+        remove_subquery(query->parent, query);
     }
 
-    return result;
+    notify_subqueries(world, query, &(ecs_query_event_t){
+        .kind = EcsQueryOrphan
+    });
+
+    /* Remove the query from the tables and monitors it is registered with. When
+     * the world is deleted the tables have already been freed. */
+    if (!(query->flags & EcsQueryIsSubquery) && !world->is_fini) {
+        ecs_table_event_t event = {
+            .kind = EcsTableQueryFree,
+            .query = query
+        };
+
+        ecs_vector_each(query->tables, ecs_matched_table_t, table, {
+            ecs_table_notify(world, table->data.table, &event);
+        });
+
+        ecs_vector_each(query->empty_tables, ecs_matched_table_t, table, {
+            ecs_table_notify(world, table->data.table, &event);
+        });
+
+        ecs_component_monitor_unregister(&world->component_monitors, query);
+        ecs_component_monitor_unregister(&world->parent_monitors, query);
+    }
+
+    ecs_vector_each(query->empty_tables, ecs_matched_table_t, table, {
+        free_matched_table(table);
+    });
+
+    ecs_vector_each(query->tables, ecs_matched_table_t, table, {
+        free_matched_table(table);
+    });
+
+    ecs_vector_free(query->subqueries);
+    ecs_vector_free(query->tables);
+    ecs_vector_free(query->empty_tables);
+    ecs_map_free(query->table_slots);
+    ecs_map_free(query->groups);
+    ecs_vector_free(query->table_slices);
+    ecs_sig_deinit(&query->sig);
+    ecs_os_track_alloc(EcsAllocQuery, query->alloc_bytes, 0);
+
+    /* Find query in vector */
+    if (!(query->flags & EcsQueryIsSubquery) && world->queries) {
+        int32_t index = -1;
+        ecs_vector_each(world->queries, ecs_query_t*, q_ptr, {
+            if (*q_ptr == query) {
+                index = q_ptr_i;
+            }
+        });
+
+        ecs_assert(index != -1, ECS_INTERNAL_ERROR, NULL);
+        ecs_vector_remove_index(world->queries, ecs_query_t*, index);
+    }
+
+    ecs_os_free(query);
 }
 
-void ecs_sleepf(
-    double t)
+/* Create query iterator */
+ecs_iter_t ecs_query_iter_page(
+    ecs_query_t *query,
+    int32_t offset,
+    int32_t limit)
 {
-    if (t > 0) {
-        int sec = (int)t;
-        int nsec = (int)((t - sec) * 1000000000);
-        ecs_os_sleep(sec, nsec);
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);
+
+    /* Threads that read the world while it progresses must not modify the
+     * query, as the query may be iterated by other threads at the same time */
+    if (!ecs_is_reader_thread()) {
+        sort_tables(query->world, query);
+        tables_reset_dirty(query);
+    }
+
+    int32_t table_count;
+    if (query->table_slices) {
+        table_count = ecs_vector_count(query->table_slices);
+    } else {
+        table_count = ecs_vector_count(query->tables);
     }
+
+    ecs_query_iter_t it = {
+        .query = query,
+        .page_iter = {
+            .offset = offset,
+            .limit = limit,
+            .remaining = limit
+        },
+        .index = 0,
+    };
+
+    return (ecs_iter_t){
+        .world = query->world,
+        .query = query,
+        .column_count = ecs_vector_count(query->sig.columns),
+        .table_count = table_count,
+        .inactive_table_count = ecs_vector_count(query->empty_tables),
+        .iter.query = it
+    };
 }
 
-double ecs_time_measure(
-    ecs_time_t *start)
+ecs_iter_t ecs_query_iter(
+    ecs_query_t *query)
 {
-    ecs_time_t stop, temp;
-    ecs_os_get_time(&stop);
-    temp = stop;
-    stop = ecs_time_sub(stop, *start);
-    *start = temp;
-    return ecs_time_to_double(stop);
+    return ecs_query_iter_page(query, 0, 0);
 }
 
-void* ecs_os_memdup(
-    const void *src, 
-    ecs_size_t size) 
+/* Find first table (or slice) with a rank that is not lower than the provided
+ * rank, or if upper is true, with a rank that is higher than the rank. */
+static
+int32_t group_bound(
+    ecs_query_t *query,
+    int32_t rank,
+    bool upper)
 {
-    if (!src) {
-        return NULL;
+    ecs_table_slice_t *slices = ecs_vector_first(
+        query->table_slices, ecs_table_slice_t);
+    ecs_matched_table_t *tables = ecs_vector_first(
+        query->tables, ecs_matched_table_t);
+
+    int32_t lo = 0, hi;
+    if (slices) {
+        hi = ecs_vector_count(query->table_slices);
+    } else {
+        hi = ecs_vector_count(query->tables);
     }
-    
-    void *dst = ecs_os_malloc(size);
-    ecs_assert(dst != NULL, ECS_OUT_OF_MEMORY, NULL);
-    ecs_os_memcpy(dst, src, size);  
-    return dst;  
-}
 
-/*
-    This code was taken from sokol_time.h 
-    
-    zlib/libpng license
-    Copyright (c) 2018 Andre Weissflog
-    This software is provided 'as-is', without any express or implied warranty.
-    In no event will the authors be held liable for any damages arising from the
-    use of this software.
-    Permission is granted to anyone to use this software for any purpose,
-    including commercial applications, and to alter it and redistribute it
-    freely, subject to the following restrictions:
-        1. The origin of this software must not be misrepresented; you must not
-        claim that you wrote the original software. If you use this software in a
-        product, an acknowledgment in the product documentation would be
-        appreciated but is not required.
-        2. Altered source versions must be plainly marked as such, and must not
-        be misrepresented as being the original software.
-        3. This notice may not be removed or altered from any source
-        distribution.
-*/
+    while (lo < hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        ecs_matched_table_t *table = slices ? slices[mid].table : &tables[mid];
+        if (table->rank < rank || (upper && table->rank == rank)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+ecs_iter_t ecs_query_iter_group(
+    ecs_query_t *query,
+    int32_t rank)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(query->group_table != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    /* Obtain the iterator first, as this rebuilds the table slices of a
+     * sorted query, which updates the slice ranges of the groups */
+    ecs_iter_t it = ecs_query_iter(query);
+
+    ecs_query_group_t *group = NULL;
+    if (query->groups) {
+        group = ecs_map_get(query->groups, ecs_query_group_t, (uint32_t)rank);
+    }
+
+    if (!group) {
+        it.table_count = 0;
+    } else if (query->table_slices) {
+        it.iter.query.index = group->slice_first;
+        it.table_count = group->slice_first + group->slice_count;
+    } else {
+        it.iter.query.index = group->first;
+        it.table_count = group->first + group->count;
+    }
+
+    return it;
+}
+
+ecs_iter_t ecs_query_iter_group_range(
+    ecs_query_t *query,
+    int32_t rank_min,
+    int32_t rank_max)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(query->group_table != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(rank_min <= rank_max, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_iter_t it = ecs_query_iter(query);
+
+    /* Tables are sorted by rank, so the range can be found with a search */
+    it.iter.query.index = group_bound(query, rank_min, false);
+    it.table_count = group_bound(query, rank_max, true);
+
+    return it;
+}
+
+void ecs_query_set_iter(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_iter_t *it,
+    int32_t table_index,
+    int32_t row,
+    int32_t count)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);
+    
+    ecs_matched_table_t *table_data = ecs_vector_get(
+        query->tables, ecs_matched_table_t, table_index);
+    ecs_assert(table_data != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_table_t *table = table_data->data.table;
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+    
+    ecs_entity_t *entity_buffer = ecs_vector_first(data->entities, ecs_entity_t);  
+    it->entities = &entity_buffer[row];
+
+    it->world = world;
+    it->query = query;
+    it->column_count = ecs_vector_count(query->sig.columns);
+    it->table_count = 1;
+    it->inactive_table_count = 0;
+    it->table_columns = data->columns;
+    it->table = &table_data->data;
+    it->offset = row;
+    it->count = count;
+    it->total_count = count;
+}
+
+int ecs_page_iter_next(
+    ecs_page_iter_t *it,
+    ecs_page_cursor_t *cur)
+{
+    int32_t offset = it->offset;
+    int32_t limit = it->limit;
+    if (!(offset || limit)) {
+        return cur->count == 0;
+    }
+
+    int32_t count = cur->count;
+    int32_t remaining = it->remaining;
+
+    if (offset) {
+        if (offset > count) {
+            /* No entities to iterate in current table */
+            it->offset -= count;
+            return 1;
+        } else {
+            cur->first += offset;
+            count = cur->count -= offset;
+            it->offset = 0;
+        }
+    }
+
+    if (remaining) {
+        if (remaining > count) {
+            it->remaining -= count;
+        } else {
+            count = cur->count = remaining;
+            it->remaining = 0;
+        }
+    } else if (limit) {
+        /* Limit hit: no more entities left to iterate */
+        return -1;
+    }
+
+    return count == 0;
+}
+
+static
+int find_smallest_column(
+    ecs_table_t *table,
+    ecs_matched_table_t *table_data,
+    ecs_vector_t *sparse_columns)
+{
+    ecs_sparse_column_t *sparse_column_array = 
+        ecs_vector_first(sparse_columns, ecs_sparse_column_t);
+    int32_t i, count = ecs_vector_count(sparse_columns);
+    int32_t min = INT_MAX, index = 0;
+
+    for (i = 0; i < count; i ++) {
+        /* The array with sparse queries for the matched table */
+        ecs_sparse_column_t *sparse_column = &sparse_column_array[i];
+
+        /* Pointer to the switch column struct of the table */
+        ecs_sw_column_t *sc = sparse_column->sw_column;
+
+        /* If the sparse column pointer hadn't been retrieved yet, do it now */
+        if (!sc) {
+            /* Get the table column index from the signature column index */
+            int32_t table_column_index = table_data->data.columns[
+                sparse_column->signature_column_index];
+
+            /* Translate the table column index to switch column index */
+            table_column_index -= table->sw_column_offset;
+            ecs_assert(table_column_index >= 1, ECS_INTERNAL_ERROR, NULL);
+
+            /* Get the sparse column */
+            ecs_data_t *data = ecs_table_get_data(table);
+            sc = sparse_column->sw_column = 
+                &data->sw_columns[table_column_index - 1];
+        }
+
+        /* Find the smallest column */
+        ecs_switch_t *sw = sc->data;
+        int32_t case_count = ecs_switch_case_count(sw, sparse_column->sw_case);
+        if (case_count < min) {
+            min = case_count;
+            index = i + 1;
+        }
+    }
+
+    return index;
+}
+
+static
+int sparse_column_next(
+    ecs_table_t *table,
+    ecs_matched_table_t *matched_table,
+    ecs_vector_t *sparse_columns,
+    ecs_query_iter_t *iter,
+    ecs_page_cursor_t *cur)
+{
+    bool first_iteration = false;
+    int32_t sparse_smallest;
+
+    if (!(sparse_smallest = iter->sparse_smallest)) {
+        sparse_smallest = iter->sparse_smallest = find_smallest_column(
+            table, matched_table, sparse_columns);
+        first_iteration = true;
+    }
+
+    sparse_smallest -= 1;
+
+    ecs_sparse_column_t *columns = ecs_vector_first(
+        sparse_columns, ecs_sparse_column_t);
+    ecs_sparse_column_t *column = &columns[sparse_smallest];
+    ecs_switch_t *sw, *sw_smallest = column->sw_column->data;
+    ecs_entity_t case_smallest = column->sw_case;
+
+    /* Find next entity to iterate in sparse column */
+    int32_t first;
+    if (first_iteration) {
+        first = ecs_switch_first(sw_smallest, case_smallest);
+    } else {
+        first = ecs_switch_next(sw_smallest, iter->sparse_first);
+    }
+
+    if (first == -1) {
+        goto done;
+    }    
+
+    /* Check if entity matches with other sparse columns, if any */
+    int32_t i, count = ecs_vector_count(sparse_columns);
+    do {
+        for (i = 0; i < count; i ++) {
+            if (i == sparse_smallest) {
+                /* Already validated this one */
+                continue;
+            }
+
+            column = &columns[i];
+            sw = column->sw_column->data;
+
+            if (ecs_switch_get(sw, first) != column->sw_case) {
+                first = ecs_switch_next(sw_smallest, first);
+                if (first == -1) {
+                    goto done;
+                }
+            }
+        }
+    } while (i != count);
+
+    cur->first = iter->sparse_first = first;
+    cur->count = 1;
+
+    return 0;
+done:
+    /* Iterated all elements in the sparse list, we should move to the
+     * next matched table. */
+    iter->sparse_smallest = 0;
+    iter->sparse_first = 0;
+
+    return -1;
+}
+
+/* Return index of lowest set bit. Value must not be 0. */
+static
+int32_t lowest_bit(
+    uint64_t value)
+{
+    int32_t result = 0;
+    if (!(value & 0xFFFFFFFF)) { value >>= 32; result += 32; }
+    if (!(value & 0xFFFF)) { value >>= 16; result += 16; }
+    if (!(value & 0xFF)) { value >>= 8; result += 8; }
+    if (!(value & 0xF)) { value >>= 4; result += 4; }
+    if (!(value & 0x3)) { value >>= 2; result += 2; }
+    if (!(value & 0x1)) { result += 1; }
+    return result;
+}
+
+/* Return bits for 64 rows starting at word, for which all bitset columns are
+ * enabled. */
+static
+uint64_t bitset_word(
+    ecs_data_t *data,
+    ecs_bitset_column_t *columns,
+    int32_t count,
+    int32_t word)
+{
+    uint64_t result = ~(uint64_t)0;
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        ecs_bitset_t *bs = &data->bs_columns[columns[i].bs_column_index].data;
+        result &= bs->data[word];
+    }
+    return result;
+}
+
+static
+bool bitset_row_enabled(
+    ecs_table_t *table,
+    ecs_vector_t *bitset_columns,
+    int32_t row)
+{
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_bitset_column_t *columns = ecs_vector_first(
+        bitset_columns, ecs_bitset_column_t);
+    int32_t count = ecs_vector_count(bitset_columns);
+    uint64_t bits = bitset_word(data, columns, count, row >> 6);
+    return (bits >> (row & 0x3F)) & 1;
+}
+
+/* Find next range of rows for which all bitset columns are enabled. Bitsets
+ * are scanned a word (64 rows) at a time, so that words in which all rows are
+ * disabled or enabled are skipped without testing individual bits. */
+static
+int bitset_column_next(
+    ecs_table_t *table,
+    ecs_vector_t *bitset_columns,
+    ecs_query_iter_t *iter,
+    ecs_page_cursor_t *cur)
+{
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_bitset_column_t *columns = ecs_vector_first(
+        bitset_columns, ecs_bitset_column_t);
+    int32_t count = ecs_vector_count(bitset_columns);
+
+    int32_t last = cur->first + cur->count;
+    int32_t row = iter->bitset_first;
+    if (!row) {
+        row = cur->first;
+    }
+
+    /* Find first enabled row */
+    int32_t first = -1;
+    while (row < last) {
+        int32_t word = row >> 6;
+        uint64_t bits = bitset_word(data, columns, count, word);
+        bits &= ~(uint64_t)0 << (row & 0x3F);
+        if (bits) {
+            first = word * 64 + lowest_bit(bits);
+            break;
+        }
+        row = (word + 1) * 64;
+    }
+
+    if (first == -1 || first >= last) {
+        /* No more enabled rows, move to the next matched table. */
+        iter->bitset_first = 0;
+        return -1;
+    }
+
+    /* Find first disabled row after the enabled row */
+    row = first;
+    while (row < last) {
+        int32_t word = row >> 6;
+        uint64_t bits = ~bitset_word(data, columns, count, word);
+        bits &= ~(uint64_t)0 << (row & 0x3F);
+        if (bits) {
+            row = word * 64 + lowest_bit(bits);
+            break;
+        }
+        row = (word + 1) * 64;
+    }
+
+    if (row > last) {
+        row = last;
+    }
+
+    cur->first = first;
+    cur->count = row - first;
+    iter->bitset_first = row;
+
+    return 0;
+}
+
+/* Test if entity in row matches sparse components of lookup columns */
+static
+bool lookup_row_match(
+    ecs_data_t *data,
+    ecs_vector_t *lookup_columns,
+    int32_t row)
+{
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+    ecs_entity_t e = entities[row];
+
+    ecs_lookup_column_t *columns = ecs_vector_first(
+        lookup_columns, ecs_lookup_column_t);
+    int32_t i, count = ecs_vector_count(lookup_columns);
+
+    for (i = 0; i < count; i ++) {
+        bool has = _ecs_sparse_get_sparse(columns[i].sparse, 0, e) != NULL;
+        if (has == columns[i].is_not) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Find next row that matches the lookup columns. Matching rows are returned
+ * one at a time, so that a column of a sparse component can point to the
+ * component of the entity in the sparse set. */
+static
+int lookup_column_next(
+    ecs_table_t *table,
+    ecs_matched_table_t *matched_table,
+    ecs_query_iter_t *iter,
+    ecs_page_cursor_t *cur)
+{
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_vector_t *lookup_columns = matched_table->lookup_columns;
+    ecs_vector_t *bitset_columns = matched_table->bitset_columns;
+
+    int32_t last = cur->first + cur->count;
+    int32_t row = iter->lookup_first;
+    if (!row) {
+        row = cur->first;
+    }
+
+    for (; row < last; row ++) {
+        if (bitset_columns && 
+            !bitset_row_enabled(table, bitset_columns, row)) 
+        {
+            continue;
+        }
+
+        if (lookup_row_match(data, lookup_columns, row)) {
+            cur->first = row;
+            cur->count = 1;
+            iter->lookup_first = row + 1;
+            return 0;
+        }
+    }
+
+    /* No more matching rows, move to the next matched table. */
+    iter->lookup_first = 0;
+
+    return -1;
+}
+
+static
+void mark_columns_dirty(
+    ecs_query_t *query,
+    ecs_matched_table_t *table_data)
+{
+    ecs_table_t *table = table_data->data.table;
+
+    if (table && table->dirty_state) {
+        int32_t i, count = ecs_vector_count(query->sig.columns);
+        ecs_sig_column_t *columns = ecs_vector_first(
+            query->sig.columns, ecs_sig_column_t);
+
+        for (i = 0; i < count; i ++) {
+            ecs_sig_inout_kind_t inout = columns[i].inout_kind;
+            if (inout != EcsIn && inout != EcsInPrev) {
+                int32_t table_column = table_data->data.columns[i];
+                if (table_column > 0) {
+                    table->dirty_state[table_column] ++;
+                }
+            }
+        }
+    }
+}
+
+/* Return next table */
+bool ecs_query_next(
+    ecs_iter_t *it)
+{
+    ecs_assert(it != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_query_iter_t *iter = &it->iter.query;
+    ecs_page_iter_t *piter = &iter->page_iter;
+    ecs_world_t *world = it->world;
+    ecs_query_t *query = iter->query;
+
+    ecs_get_stage(&world);
+    ecs_table_slice_t *slice = ecs_vector_first(
+        query->table_slices, ecs_table_slice_t);
+    ecs_matched_table_t *tables = ecs_vector_first(
+        query->tables, ecs_matched_table_t);
+
+    ecs_assert(!slice || query->compare || query->sort_key_kind, 
+        ECS_INTERNAL_ERROR, NULL);
+    
+    ecs_page_cursor_t cur;
+    int32_t table_count = it->table_count;
+    int32_t prev_count = it->total_count;
+
+    int i;
+    for (i = iter->index; i < table_count; i ++) {
+        ecs_matched_table_t *table_data = slice ? slice[i].table : &tables[i];
+        ecs_table_t *table = table_data->data.table;
+        ecs_data_t *data = NULL;
+
+        iter->index = i + 1;
+        
+        if (table) {
+            ecs_vector_t *sparse_columns = table_data->sparse_columns;
+            ecs_vector_t *bitset_columns = table_data->bitset_columns;
+            ecs_vector_t *lookup_columns = table_data->lookup_columns;
+            data = ecs_table_get_data(table);
+            ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+            it->table_columns = data->columns;
+            
+            if (slice) {
+                cur.first = slice[i].start_row;
+                cur.count = slice[i].count;
+            } else {
+                cur.first = 0;
+                cur.count = ecs_table_count(table);
+            }
+
+            if (cur.count) {
+                if (sparse_columns) {
+                    int ret;
+                    do {
+                        ret = sparse_column_next(table, table_data,
+                            sparse_columns, iter, &cur);
+                    } while (!ret && ((bitset_columns && 
+                        !bitset_row_enabled(table, bitset_columns, cur.first)) ||
+                        (lookup_columns && 
+                        !lookup_row_match(data, lookup_columns, cur.first))));
+
+                    if (ret == -1) {
+                        /* No more elements in sparse column */
+                        continue;    
+                    } else {
+                        iter->index = i;
+                    }
+                } else if (lookup_columns) {
+                    if (lookup_column_next(table, table_data, iter, &cur) == -1)
+                    {
+                        /* No more rows with sparse components */
+                        continue;
+                    } else {
+                        iter->index = i;
+                    }
+                } else if (bitset_columns) {
+                    if (bitset_column_next(table, bitset_columns, iter, 
+                        &cur) == -1) 
+                    {
+                        /* No more enabled rows in bitset columns */
+                        continue;
+                    } else {
+                        iter->index = i;
+                    }
+                }
+
+                int ret = ecs_page_iter_next(piter, &cur);
+                if (ret < 0) {
+                    return false;
+                } else if (ret > 0) {
+                    /* If the table is iterated in multiple ranges, revisit the
+                     * table for the next range */
+                    if (iter->index == i) {
+                        i --;
+                    }
+                    continue;
+                }
+            } else {
+                continue;
+            }
+
+            ecs_entity_t *entity_buffer = ecs_vector_first(
+                data->entities, ecs_entity_t); 
+            it->entities = &entity_buffer[cur.first];
+            it->offset = cur.first;
+            it->count = cur.count;
+            it->total_count = cur.count;
+        }
+
+        it->table = &table_data->data;
+        it->frame_offset += prev_count;
+
+        if (query->flags & EcsQueryHasOutColumns) {
+            if (table && !ecs_is_reader_thread()) {
+                mark_columns_dirty(query, table_data);
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool ecs_query_next_w_filter(
+    ecs_iter_t *iter,
+    const ecs_filter_t *filter)
+{
+    ecs_table_t *table;
+
+    do {
+        if (!ecs_query_next(iter)) {
+            return false;
+        }
+        table = iter->table->table;
+    } while (filter && !ecs_table_match_filter(iter->world, table, filter));
+    
+    return true;
+}
+
+bool ecs_query_next_worker(
+    ecs_iter_t *it,
+    int32_t current,
+    int32_t total)
+{
+    int32_t per_worker, first, prev_offset = it->offset;
+
+    do {
+        if (!ecs_query_next(it)) {
+            return false;
+        }
+
+        int32_t count = it->count;
+        per_worker = count / total;
+        first = per_worker * current;
+
+        count -= per_worker * total;
+
+        if (count) {
+            if (current < count) {
+                per_worker ++;
+                first += current;
+            } else {
+                first += count;
+            }
+        }
+
+        if (!per_worker && !(it->query->flags & EcsQueryNeedsTables)) {
+            if (current == 0) {
+                return true;
+            } else {
+                return false;
+            }
+        }
+    } while (!per_worker);
+
+    it->frame_offset -= prev_offset;
+    it->count = per_worker;
+    it->offset += first;
+    it->entities = &it->entities[first];
+    it->frame_offset += first;
+
+    return true;
+}
+
+void ecs_query_order_by(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_entity_t sort_component,
+    ecs_compare_action_t compare)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);    
+    ecs_assert(query->flags & EcsQueryNeedsTables, ECS_INVALID_PARAMETER, NULL);
+
+    query->sort_on_component = sort_component;
+    query->compare = compare;
+    query->sort_key_kind = EcsSortKeyNone;
+
+    ecs_vector_free(query->table_slices);
+    query->table_slices = NULL;
+
+    sort_tables(world, query);    
+
+    if (!query->table_slices) {
+        build_sorted_tables(query);
+    }
+}
+
+void ecs_query_order_by_key(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_entity_t sort_component,
+    ecs_sort_key_kind_t kind,
+    ecs_size_t offset)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);    
+    ecs_assert(query->flags & EcsQueryNeedsTables, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(sort_component != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(kind != EcsSortKeyNone, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(offset >= 0, ECS_INVALID_PARAMETER, NULL);
+
+    query->sort_on_component = sort_component;
+    query->compare = NULL;
+    query->sort_key_kind = kind;
+    query->sort_key_offset = offset;
+
+    ecs_vector_free(query->table_slices);
+    query->table_slices = NULL;
+
+    sort_tables(world, query);    
+
+    if (!query->table_slices) {
+        build_sorted_tables(query);
+    }
+}
+
+static
+void query_sort_postponed(
+    ecs_world_t *world,
+    ecs_query_t *query)
+{
+    if (query->flags & EcsQuerySortPending) {
+        sort_tables(world, query);
+    }
+
+    ecs_vector_each(query->subqueries, ecs_query_t*, sq, {
+        query_sort_postponed(world, *sq);
+    });
+}
+
+void ecs_query_sort_postponed(
+    ecs_world_t *world)
+{
+    ecs_assert(!world->read_enabled, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_vector_each(world->queries, ecs_query_t*, q_ptr, {
+        query_sort_postponed(world, *q_ptr);
+    });
+}
+
+void ecs_query_group_by(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_entity_t sort_component,
+    ecs_rank_type_action_t group_table_action)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);    
+    ecs_assert(query->flags & EcsQueryNeedsTables, ECS_INVALID_PARAMETER, NULL);
+
+    query->rank_on_component = sort_component;
+    query->group_table = group_table_action;
+
+    group_tables(world, query);
+
+    order_ranked_tables(world, query);
+
+    build_sorted_tables(query);
+}
+
+bool ecs_query_changed(
+    ecs_query_t *query)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);
+    return tables_dirty(query);
+}
+
+bool ecs_query_orphaned(
+    ecs_query_t *query)
+{
+    return query->flags & EcsQueryIsOrphaned;
+}
+
+ecs_entity_t ecs_component_id_from_id(
+    ecs_world_t *world,
+    ecs_entity_t e)
+{
+    if (ECS_HAS_ROLE(e, TRAIT)) {
+        ecs_entity_t trait = ecs_entity_t_hi(e & ECS_COMPONENT_MASK);
+        if (ecs_has(world, trait, EcsComponent)) {
+            /* This is not a trait tag, trait is the value */
+            return trait;
+        } else {
+            /* This is a trait tag, component is the value */
+            return ecs_entity_t_lo(e);
+        }
+    } else if (e & ECS_ROLE_MASK) {
+        return 0;
+    }
+
+    return e;
+}
+
+const EcsComponent* ecs_component_from_id(
+    ecs_world_t *world,
+    ecs_entity_t e)
+{
+    ecs_entity_t trait = 0;
+
+    /* If this is a trait, get the trait component from the identifier */
+    if (ECS_HAS_ROLE(e, TRAIT)) {
+        trait = e;
+        e = e & ECS_COMPONENT_MASK;
+        e = ecs_entity_t_hi(e);
+    }
+
+    const EcsComponent *component = ecs_get(world, e, EcsComponent);
+    if (!component && trait) {
+        /* If this is a trait column and the trait is not a component, use
+            * the component type of the component the trait is applied to. */
+        e = ecs_entity_t_lo(trait);
+        component = ecs_get(world, e, EcsComponent);
+    }    
+
+    return component;
+}
+
+/* Count number of columns with data (excluding tags) */
+static
+int32_t data_column_count(
+    ecs_world_t * world,
+    ecs_table_t * table)
+{
+    int32_t count = 0;
+    ecs_vector_each(table->type, ecs_entity_t, c_ptr, {
+        ecs_entity_t component = *c_ptr;
+
+        /* Typically all components will be clustered together at the start of
+         * the type as components are created from a separate id pool, and type
+         * vectors are sorted. 
+         * Explicitly check for builtin components since the ecs_has check
+         * doesn't work during bootstrap. */
+        if ((component == ecs_typeid(EcsComponent)) || 
+            (component == ecs_typeid(EcsName)) || 
+            (component == ecs_typeid(EcsChildOf)) || 
+            ecs_component_from_id(world, component) != NULL) 
+        {
+            count = c_ptr_i + 1;
+        }
+    });
+
+    return count;
+}
+
+/* Count number of switch columns */
+static
+int32_t switch_column_count(
+    ecs_table_t *table)
+{
+    int32_t count = 0;
+    ecs_vector_each(table->type, ecs_entity_t, c_ptr, {
+        ecs_entity_t component = *c_ptr;
+
+        if (ECS_HAS_ROLE(component, SWITCH)) {
+            if (!count) {
+                table->sw_column_offset = c_ptr_i;
+            }
+            count ++;
+        }
+    });
+
+    return count;
+}
+
+/* Count number of bitset columns */
+static
+int32_t bitset_column_count(
+    ecs_table_t *table)
+{
+    int32_t count = 0;
+    ecs_vector_each(table->type, ecs_entity_t, c_ptr, {
+        ecs_entity_t component = *c_ptr;
+
+        if (ECS_HAS_ROLE(component, DISABLED)) {
+            if (!count) {
+                table->bs_column_offset = c_ptr_i;
+            }
+            count ++;
+        }
+    });
+
+    return count;
+}
+
+static
+ecs_type_t entities_to_type(
+    ecs_entities_t *entities)
+{
+    if (entities->count) {
+        ecs_vector_t *result = NULL;
+        ecs_vector_set_count(&result, ecs_entity_t, entities->count);
+        ecs_entity_t *array = ecs_vector_first(result, ecs_entity_t);
+        ecs_os_memcpy(array, entities->array, ECS_SIZEOF(ecs_entity_t) * entities->count);
+        return result;
+    } else {
+        return NULL;
+    }
+}
+
+static
+void register_child_table(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entity_t parent)
+{
+    /* Register child table with parent */
+    ecs_vector_t *child_tables = ecs_map_get_ptr(
+            world->child_tables, ecs_vector_t*, parent);
+    if (!child_tables) {
+        child_tables = ecs_vector_new(ecs_table_t*, 1);
+    }
+    
+    ecs_table_t **el = ecs_vector_add(&child_tables, ecs_table_t*);
+    *el = table;
+
+    if (!world->child_tables) {
+        world->child_tables = ecs_map_new(ecs_vector_t*, 1);
+    }
+
+    ecs_map_set(world->child_tables, parent, &child_tables);
+}
+
+static
+void unregister_child_table(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entity_t parent)
+{
+    ecs_vector_t *child_tables = ecs_map_get_ptr(
+            world->child_tables, ecs_vector_t*, parent);
+
+    int32_t i, count = ecs_vector_count(child_tables);
+    ecs_table_t **tables = ecs_vector_first(child_tables, ecs_table_t*);
+    for (i = 0; i < count; i ++) {
+        if (tables[i] == table) {
+            break;
+        }
+    }
+
+    ecs_assert(i != count, ECS_INTERNAL_ERROR, NULL);
+    ecs_vector_remove_index(child_tables, ecs_table_t*, i);
+
+    if (!ecs_vector_count(child_tables)) {
+        ecs_vector_free(child_tables);
+        ecs_map_remove(world->child_tables, parent);
+    }
+}
+
+static
+void register_instance_table(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entity_t base)
+{
+    /* Register instance table with base, so that when the base changes only
+     * the tables of its instances need to be rematched */
+    if (!world->instance_tables) {
+        world->instance_tables = ecs_map_new(ecs_vector_t*, 1);
+    }
+
+    ecs_vector_t *instance_tables = ecs_map_get_ptr(
+            world->instance_tables, ecs_vector_t*, base);
+    
+    ecs_table_t **el = ecs_vector_add(&instance_tables, ecs_table_t*);
+    *el = table;
+
+    ecs_map_set(world->instance_tables, base, &instance_tables);
+}
+
+static
+void unregister_instance_table(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entity_t base)
+{
+    ecs_vector_t *instance_tables = ecs_map_get_ptr(
+            world->instance_tables, ecs_vector_t*, base);
+
+    /* Admin of base is removed when the base is deleted */
+    int32_t i, count = ecs_vector_count(instance_tables);
+    ecs_table_t **tables = ecs_vector_first(instance_tables, ecs_table_t*);
+    for (i = 0; i < count; i ++) {
+        if (tables[i] == table) {
+            break;
+        }
+    }
+
+    if (i == count) {
+        return;
+    }
+
+    ecs_vector_remove_index(instance_tables, ecs_table_t*, i);
+
+    if (!ecs_vector_count(instance_tables)) {
+        ecs_vector_free(instance_tables);
+        ecs_map_remove(world->instance_tables, base);
+    }
+}
+
+static
+void init_edges(
+    ecs_world_t * world,
+    ecs_table_t * table)
+{
+    ecs_entity_t *entities = ecs_vector_first(table->type, ecs_entity_t);
+    int32_t count = ecs_vector_count(table->type);
+
+    table->lo_edges = ecs_os_calloc(sizeof(ecs_edge_t) * ECS_HI_COMPONENT_ID);
+    table->hi_edges = ecs_map_new(ecs_edge_t, 0);
+    ecs_os_track_alloc(EcsAllocEdges, 
+        0, ECS_SIZEOF(ecs_edge_t) * ECS_HI_COMPONENT_ID);
+
+    table->lo_edges[0].add = table;
+    
+    /* Make add edges to own components point to self */
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+
+        if (e >= ECS_HI_COMPONENT_ID) {
+            ecs_edge_t edge = { .add = table };
+
+            if (count == 1) {
+                edge.remove = &world->store.root;
+            }
+
+            ecs_map_set(table->hi_edges, e, &edge);
+        } else {
+            table->lo_edges[e].add = table;
+
+            if (count == 1) {
+                table->lo_edges[e].remove = &world->store.root;
+            } else {
+                table->lo_edges[e].remove = NULL;
+            }
+        }
+
+        /* As we're iterating over the table components, also set the table
+         * flags. These allow us to quickly determine if the table contains
+         * data that needs to be handled in a special way, like prefabs or 
+         * containers */
+        if (e <= EcsLastInternalComponentId) {
+            table->flags |= EcsTableHasBuiltins;
+        }
+
+        if (e == EcsPrefab) {
+            table->flags |= EcsTableIsPrefab;
+            table->flags |= EcsTableIsDisabled;
+        }
+
+        if (e == EcsDisabled) {
+            table->flags |= EcsTableIsDisabled;
+        }
+
+        if (e == ecs_typeid(EcsComponent)) {
+            table->flags |= EcsTableHasComponentData;
+        }
+
+        if (e == ecs_typeid(EcsChildOf)) {
+            table->flags |= EcsTableHasChildOf;
+        }
+
+        if (ECS_HAS_ROLE(e, XOR)) {
+            table->flags |= EcsTableHasXor;
+        }
+
+        if (ECS_HAS_ROLE(e, INSTANCEOF)) {
+            table->flags |= EcsTableHasBase;
+            register_instance_table(world, table, e & ECS_COMPONENT_MASK);
+        }
+
+        if (ECS_HAS_ROLE(e, SWITCH)) {
+            table->flags |= EcsTableHasSwitch;
+        }
+
+        if (ECS_HAS_ROLE(e, DISABLED)) {
+            table->flags |= EcsTableHasDisabled;
+        }
+
+        if (ECS_HAS_ROLE(e, CHILDOF)) {
+            ecs_entity_t parent = e & ECS_COMPONENT_MASK;
+            ecs_assert(!ecs_exists(world, parent) || ecs_is_alive(world, parent), ECS_INTERNAL_ERROR, NULL);
+            table->flags |= EcsTableHasParent;
+            register_child_table(world, table, parent);
+        }
+
+        if (ECS_HAS_ROLE(e, CHILDOF) || ECS_HAS_ROLE(e, INSTANCEOF)) {
+            ecs_set_watch(world, e & ECS_COMPONENT_MASK);
+        }
+    }
+
+    /* Register component info flags for all columns */
+    ecs_table_notify(world, table, &(ecs_table_event_t){
+        .kind = EcsTableComponentInfo
+    });
+    
+    /* Register as root table. Tables with EcsChildOf store children, and are
+     * found through the EcsChildOf index of the parent. */
+    if (!(table->flags & (EcsTableHasParent | EcsTableHasChildOf))) {
+        register_child_table(world, table, 0);
+    }
+}
+
+static
+void init_table(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entities_t * entities)
+{
+    table->type = entities_to_type(entities);
+    table->c_info = NULL;
+    table->data = NULL;
+    table->flags = 0;
+    table->dirty_state = NULL;
+    table->column_stats = NULL;
+    table->monitors = NULL;
+    table->on_set = NULL;
+    table->on_set_all = NULL;
+    table->on_set_override = NULL;
+    table->un_set_all = NULL;
+    table->alloc_count = 0;
+    table->alloc_bytes = 0;
+    table->gc_frame = 0;
+
+    table->queries = NULL;
+    table->column_count = data_column_count(world, table);
+    table->sw_column_count = switch_column_count(table);
+    table->bs_column_count = bitset_column_count(table);
+    table->soa_column_count = 0;
+
+    init_edges(world, table);
+
+    ecs_table_register_stats(world, table);
+}
+
+/* Compute hash for an ordered array of entities. The result is used to find
+ * tables by type without visiting all tables in the world. */
+static
+uint64_t hash_entities(
+    const ecs_entity_t *array,
+    int32_t count)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        hash ^= array[i];
+        hash *= 1099511628211ULL;
+    }
+
+    /* Mix in high bits, as the map uses the low bits to select a bucket */
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+static
+void index_table(
+    ecs_world_t * world,
+    ecs_table_t * table)
+{
+    if (!world->store.table_index) {
+        world->store.table_index = ecs_map_new(ecs_table_t*, 0);
+    }
+
+    uint64_t hash = hash_entities(
+        ecs_vector_first(table->type, ecs_entity_t),
+        ecs_vector_count(table->type));
+
+    ecs_table_t **head = ecs_map_get(
+        world->store.table_index, ecs_table_t*, hash);
+    if (head) {
+        table->hash_next = *head;
+        *head = table;
+    } else {
+        table->hash_next = NULL;
+        ecs_map_set(world->store.table_index, hash, &table);
+    }
+}
+
+void ecs_table_index_remove(
+    ecs_world_t * world,
+    ecs_table_t * table)
+{
+    uint64_t hash = hash_entities(
+        ecs_vector_first(table->type, ecs_entity_t),
+        ecs_vector_count(table->type));
+
+    ecs_table_t **head = ecs_map_get(
+        world->store.table_index, ecs_table_t*, hash);
+    ecs_assert(head != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_table_t **ptr = head;
+    while (*ptr != table) {
+        ecs_assert(*ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+        ptr = &(*ptr)->hash_next;
+    }
+
+    *ptr = table->hash_next;
+
+    if (!*head) {
+        ecs_map_remove(world->store.table_index, hash);
+    }
+}
+
+static
+ecs_table_t *create_table(
+    ecs_world_t * world,
+    ecs_entities_t * entities)
+{
+    uint64_t span = ecs_span_begin(world);
+
+    ecs_table_t *result = ecs_sparse_add(world->store.tables, ecs_table_t);
+    result->id = ecs_to_u32(ecs_sparse_last_id(world->store.tables));
+
+    ecs_assert(result != NULL, ECS_INTERNAL_ERROR, NULL);
+    init_table(world, result, entities);
+    index_table(world, result);
+
+    world->stats.table_create_count_total ++;
+
+#ifndef NDEBUG
+    char *expr = ecs_type_str(world, result->type);
+    ecs_trace_2("table #[green][%s]#[normal] created", expr);
+    ecs_os_free(expr);
+#endif
+    ecs_log_push();
+
+    ecs_notify_queries(world, &(ecs_query_event_t) {
+        .kind = EcsQueryTableMatch,
+        .table = result
+    });
+
+    ecs_log_pop();
+
+    /* Only record span when not running on a worker thread, as the main thread
+     * ring buffer may not be written to from multiple threads. */
+    if (!world->in_progress || !ecs_vector_count(world->workers)) {
+        ecs_span_end(world, &world->stage, EcsSpanTableCreate, result->id, span);
+    }
+
+    return result;
+}
+
+static
+void add_entity_to_type(
+    ecs_type_t type,
+    ecs_entity_t add,
+    ecs_entity_t replace,
+    ecs_entities_t *out)
+{
+    int32_t count = ecs_vector_count(type);
+    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);    
+    bool added = false;
+
+    int32_t i, el = 0;
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = array[i];
+        if (e == replace) {
+            continue;
+        }
+
+        if (e > add && !added) {
+            out->array[el ++] = add;
+            added = true;
+        }
+        
+        out->array[el ++] = e;
+
+        ecs_assert(el <= out->count, ECS_INTERNAL_ERROR, NULL);
+    }
+
+    if (!added) {
+        out->array[el ++] = add;
+    }
+
+    out->count = el;
+
+    ecs_assert(out->count != 0, ECS_INTERNAL_ERROR, NULL);
+}
+
+static
+void remove_entity_from_type(
+    ecs_type_t type,
+    ecs_entity_t remove,
+    ecs_entities_t *out)
+{
+    int32_t count = ecs_vector_count(type);
+    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
+
+    int32_t i, el = 0;
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = array[i];
+        if (e != remove) {
+            out->array[el ++] = e;
+            ecs_assert(el <= count, ECS_INTERNAL_ERROR, NULL);
+        }
+    }
+
+    out->count = el;
+}
+
+static
+ecs_edge_t* get_edge(
+    ecs_table_t *node,
+    ecs_entity_t e)
+{
+    ecs_edge_t *edge;
+
+    if (e < ECS_HI_COMPONENT_ID) {
+        edge = &node->lo_edges[e];
+    } else {
+        edge = ecs_map_get(node->hi_edges, ecs_edge_t, e);        
+        if (!edge) {
+            ecs_edge_t new_edge = {0};
+            ecs_map_set(node->hi_edges, e, &new_edge);
+            edge = ecs_map_get(node->hi_edges, ecs_edge_t, e);    
+            ecs_assert(edge != NULL, ECS_INTERNAL_ERROR, NULL);
+        }
+    }
+
+    return edge;
+}
+
+static
+void create_backlink_after_add(
+    ecs_table_t * next,
+    ecs_table_t * prev,
+    ecs_entity_t add)
+{
+    ecs_edge_t *edge = get_edge(next, add);
+    if (!edge->remove) {
+        edge->remove = prev;
+    }
+}
+
+static
+void create_backlink_after_remove(
+    ecs_table_t * next,
+    ecs_table_t * prev,
+    ecs_entity_t add)
+{
+    ecs_edge_t *edge = get_edge(next, add);
+    if (!edge->add) {
+        edge->add = prev;
+    }
+}
+
+static
+ecs_entity_t find_xor_replace(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_type_t type,
+    ecs_entity_t add)
+{
+    if (table->flags & EcsTableHasXor) {
+        ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
+        int32_t i, type_count = ecs_vector_count(type);
+        ecs_type_t xor_type = NULL;
+
+        for (i = type_count - 1; i >= 0; i --) {
+            ecs_entity_t e = array[i];
+            if (ECS_HAS_ROLE(e, XOR)) {
+                ecs_entity_t e_type = e & ECS_COMPONENT_MASK;
+                const EcsType *type_ptr = ecs_get(world, e_type, EcsType);
+                ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+
+                if (ecs_type_owns_entity(
+                    world, type_ptr->normalized, add, true)) 
+                {
+                    xor_type = type_ptr->normalized;
+                }
+            } else if (xor_type) {
+                if (ecs_type_owns_entity(world, xor_type, e, true)) {
+                    return e;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int32_t ecs_table_switch_from_case(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entity_t add)
+{
+    ecs_type_t type = table->type;
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_entity_t *array = ecs_vector_first(type, ecs_entity_t);
+
+    int32_t i, count = table->sw_column_count;
+    ecs_assert(count != 0, ECS_INTERNAL_ERROR, NULL);
+
+    add = add & ECS_COMPONENT_MASK;
+
+    ecs_sw_column_t *sw_columns = NULL;
+
+    if (data && (sw_columns = data->sw_columns)) {
+        /* Fast path, we can get the switch type from the column data */
+        for (i = 0; i < count; i ++) {
+            ecs_type_t sw_type = sw_columns[i].type;
+            if (ecs_type_owns_entity(world, sw_type, add, true)) {
+                return i;
+            }
+        }
+    } else {
+        /* Slow path, table is empty, so we'll have to get the switch types by
+         * actually inspecting the switch type entities. */
+        for (i = 0; i < count; i ++) {
+            ecs_entity_t e = array[i + table->sw_column_offset];
+            ecs_assert(ECS_HAS_ROLE(e, SWITCH), ECS_INTERNAL_ERROR, NULL);
+            e = e & ECS_COMPONENT_MASK;
+
+            const EcsType *type_ptr = ecs_get(world, e, EcsType);
+            ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+
+            if (ecs_type_owns_entity(
+                world, type_ptr->normalized, add, true)) 
+            {
+                return i;
+            }
+        }
+    }
+
+    /* If a table was not found, this is an invalid switch case */
+    ecs_abort(ECS_INVALID_CASE, NULL);
+
+    return -1;
+}
+
+static
+ecs_table_t *find_or_create_table_include(
+    ecs_world_t * world,
+    ecs_table_t * node,
+    ecs_entity_t add)
+{
+    /* If table has one or more switches and this is a case, return self */
+    if (ECS_HAS_ROLE(add, CASE)) {
+        ecs_assert((node->flags & EcsTableHasSwitch) != 0, 
+            ECS_INVALID_CASE, NULL);
+        return node;
+    } else {
+        ecs_type_t type = node->type;
+        int32_t count = ecs_vector_count(type);
+
+        ecs_entities_t entities = {
+            .array = ecs_os_alloca(ECS_SIZEOF(ecs_entity_t) * (count + 1)),
+            .count = count + 1
+        };
+
+        /* If table has a XOR column, check if the entity that is being added to
+         * the table is part of the XOR type, and if it is, find the current 
+         * entity in the table type matching the XOR type. This entity must be 
+         * replaced in the new table, to ensure the XOR constraint isn't 
+         * violated. */
+        ecs_entity_t replace = find_xor_replace(world, node, type, add);
+
+        add_entity_to_type(type, add, replace, &entities);
+
+        ecs_table_t *result = ecs_table_find_or_create(world, &entities);
+        
+        if (result != node) {
+            create_backlink_after_add(result, node, add);
+        }
+
+        return result;
+    }
+}
+
+static
+ecs_table_t *find_or_create_table_exclude(
+    ecs_world_t * world,
+    ecs_table_t * node,
+    ecs_entity_t remove)
+{
+    ecs_type_t type = node->type;
+    int32_t count = ecs_vector_count(type);
+
+    ecs_entities_t entities = {
+        .array = ecs_os_alloca(ECS_SIZEOF(ecs_entity_t) * count),
+        .count = count
+    };
+
+    remove_entity_from_type(type, remove, &entities);
+
+    ecs_table_t *result = ecs_table_find_or_create(world, &entities);
+    if (!result) {
+        return NULL;
+    }
+
+    if (result != node) {
+        create_backlink_after_remove(result, node, remove);
+    }
+
+    return result;    
+}
+
+static
+ecs_table_t* traverse_remove_hi_edges(
+    ecs_world_t * world,
+    ecs_table_t * node,
+    int32_t i,
+    ecs_entities_t * to_remove,
+    ecs_entities_t * removed)
+{
+    int32_t count = to_remove->count;
+    ecs_entity_t *entities = to_remove->array;
+
+    for (; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+        ecs_entity_t next_e = e;
+        ecs_table_t *next;
+        ecs_edge_t *edge;
+
+        edge = get_edge(node, e);
+
+        next = edge->remove;
+
+        if (!next) {
+            next = find_or_create_table_exclude(world, node, next_e);
+            if (!next) {
+                return NULL;
+            }
+
+            edge->remove = next;
+        }
+
+        if (removed && node != next) removed->array[removed->count ++] = e;
+
+        node = next;        
+    }
+
+    return node;
+}
+
+ecs_table_t* ecs_table_traverse_remove(
+    ecs_world_t * world,
+    ecs_table_t * node,
+    ecs_entities_t * to_remove,
+    ecs_entities_t * removed)
+{
+    int32_t i, count = to_remove->count;
+    ecs_entity_t *entities = to_remove->array;
+    node = node ? node : &world->store.root;
+
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+
+        /* If the array is not a simple component array, use a function that
+         * handles all cases, but is slower */
+        if (e >= ECS_HI_COMPONENT_ID) {
+            return traverse_remove_hi_edges(world, node, i, to_remove, 
+                removed);
+        }
+
+        ecs_edge_t *edge = &node->lo_edges[e];
+        ecs_table_t *next = edge->remove;
+
+        if (!next) {
+            if (edge->add == node) {
+                /* Find table with all components of node except 'e' */
+                next = find_or_create_table_exclude(world, node, e);
+                if (!next) {
+                    return NULL;
+                }
+
+                edge->remove = next;
+            } else {
+                /* If the add edge does not point to self, the table
+                    * does not have the entity in to_remove. */
+                continue;
+            }
+        }
+
+        if (removed) removed->array[removed->count ++] = e;
+
+        node = next;
+    }    
+
+    return node;
+}
+
+static
+void find_owned_components(
+    ecs_world_t * world,
+    ecs_table_t * node,
+    ecs_entity_t base,
+    ecs_entities_t * owned)
+{
+    /* If we're adding an INSTANCEOF relationship, check if the base
+     * has OWNED components that need to be added to the instance */
+    ecs_type_t t = ecs_get_type(world, base);
+
+    int i, count = ecs_vector_count(t);
+    ecs_entity_t *entities = ecs_vector_first(t, ecs_entity_t);
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+        if (ECS_HAS_ROLE(e, INSTANCEOF)) {
+            find_owned_components(world, node, e & ECS_COMPONENT_MASK, owned);
+        } else
+        if (ECS_HAS_ROLE(e, OWNED)) {
+            e = e & ECS_COMPONENT_MASK;
+            
+            /* If entity is a type, add each component in the type */
+            const EcsType *t_ptr = ecs_get(world, e, EcsType);
+            if (t_ptr) {
+                ecs_type_t n = t_ptr->normalized;
+                int32_t j, n_count = ecs_vector_count(n);
+                ecs_entity_t *n_entities = ecs_vector_first(n, ecs_entity_t);
+                for (j = 0; j < n_count; j ++) {
+                    owned->array[owned->count ++] = n_entities[j];
+                }
+            } else {
+                owned->array[owned->count ++] = e & ECS_COMPONENT_MASK;
+            }
+        }
+    }
+}
+
+static
+ecs_table_t* traverse_add_hi_edges(
+    ecs_world_t * world,
+    ecs_table_t * node,
+    int32_t i,
+    ecs_entities_t * to_add,
+    ecs_entities_t * added)
+{
+    int32_t count = to_add->count;
+    ecs_entity_t *entities = to_add->array;
+
+    ecs_entity_t owned_array[ECS_MAX_ADD_REMOVE];
+    ecs_entities_t owned = {
+        .array = owned_array,
+        .count = 0
+    };
+
+    for (; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+        ecs_entity_t next_e = e;
+        ecs_table_t *next;
+        ecs_edge_t *edge;
+
+        edge = get_edge(node, e);
+        next = edge->add;
+
+        if (!next) {
+            next = find_or_create_table_include(world, node, next_e);
+            ecs_assert(next != NULL, ECS_INTERNAL_ERROR, NULL);
+            edge->add = next;
+        }
+
+        bool has_case = ECS_HAS_ROLE(e, CASE);
+        if (added && (node != next || has_case)) {
+            /* If this is a case, find switch and encode it in added id */
+            if (has_case) {
+                int32_t s_case = ecs_table_switch_from_case(world, node, e);
+                ecs_assert(s_case != -1, ECS_INTERNAL_ERROR, NULL);
+                e = ECS_CASE | ecs_entity_t_comb(e, s_case);
+            }
+
+            added->array[added->count ++] = e; 
+        }
+
+        if ((node != next) && ECS_HAS_ROLE(e, INSTANCEOF)) {
+            find_owned_components(world, next, ECS_COMPONENT_MASK & e, &owned);
+        } 
+
+        node = next;
+    }
+
+    /* In case OWNED components were found, add them as well */
+    if (owned.count) {
+        node = ecs_table_traverse_add(world, node, &owned, added);
+    }
+
+    return node;
+}
+
+ecs_table_t* ecs_table_traverse_add(
+    ecs_world_t * world,
+    ecs_table_t * node,
+    ecs_entities_t * to_add,
+    ecs_entities_t * added)    
+{
+    int32_t i, count = to_add->count;
+    ecs_entity_t *entities = to_add->array;
+    node = node ? node : &world->store.root;
+
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+        ecs_table_t *next;
+
+        /* If the array is not a simple component array, use a function that
+         * handles all cases, but is slower */
+        if (e >= ECS_HI_COMPONENT_ID) {
+            return traverse_add_hi_edges(world, node, i, to_add, added);
+        }
+
+        /* There should always be an edge for adding */
+        ecs_edge_t *edge = &node->lo_edges[e];
+        next = edge->add;
+
+        if (!next) {
+            next = find_or_create_table_include(world, node, e);
+            ecs_assert(next != NULL, ECS_INTERNAL_ERROR, NULL);
+            edge->add = next;
+        }
+
+        if (added && node != next) {
+            added->array[added->count ++] = e;
+        }
+
+        node = next;
+    }
+
+    return node;
+}
+
+static
+int ecs_entity_compare(
+    const void *e1,
+    const void *e2)
+{
+    ecs_entity_t v1 = *(ecs_entity_t*)e1;
+    ecs_entity_t v2 = *(ecs_entity_t*)e2;
+    if (v1 < v2) {
+        return -1;
+    } else if (v1 > v2) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+static
+bool ecs_entity_array_is_ordered(
+    ecs_entities_t *entities)
+{
+    ecs_entity_t prev = 0;
+    ecs_entity_t *array = entities->array;
+    int32_t i, count = entities->count;
+
+    for (i = 0; i < count; i ++) {
+        if (!array[i] && !prev) {
+            continue;
+        }
+        if (array[i] <= prev) {
+            return false;
+        }
+        prev = array[i];
+    }    
+
+    return true;
+}
+
+static
+int32_t ecs_entity_array_dedup(
+    ecs_entity_t *array,
+    int32_t count)
+{
+    int32_t j, k;
+    ecs_entity_t prev = array[0];
+
+    for (k = j = 1; k < count; j ++, k++) {
+        ecs_entity_t e = array[k];
+        if (e == prev) {
+            k ++;
+        }
+
+        array[j] = e;
+        prev = e;
+    }
+
+    return count - (k - j);
+}
+
+#ifndef NDEBUG
+
+static
+int32_t count_occurrences(
+    ecs_world_t * world,
+    ecs_entities_t * entities,
+    ecs_entity_t entity,
+    int32_t constraint_index)    
+{
+    const EcsType *type_ptr = ecs_get(world, entity, EcsType);
+    ecs_assert(type_ptr != NULL, 
+        ECS_INVALID_PARAMETER, "flag must be applied to type");
+
+    ecs_type_t type = type_ptr->normalized;
+    int32_t count = 0;
+    
+    int i;
+    for (i = 0; i < constraint_index; i ++) {
+        ecs_entity_t e = entities->array[i];
+        if (e & ECS_ROLE_MASK) {
+            break;
+        }
+
+        if (ecs_type_has_entity(world, type, e)) {
+            count ++;
+        }
+    }
+
+    return count;
+}
+
+static
+void verify_constraints(
+    ecs_world_t * world,
+    ecs_entities_t * entities)
+{
+    int i, count = entities->count;
+    for (i = count - 1; i >= 0; i --) {
+        ecs_entity_t e = entities->array[i];
+        ecs_entity_t mask = e & ECS_ROLE_MASK;
+        if (!mask || 
+            ((mask != ECS_OR) &&
+             (mask != ECS_XOR) &&
+             (mask != ECS_NOT)))
+        {
+            break;
+        }
+
+        ecs_entity_t entity = e & ECS_COMPONENT_MASK;
+        int32_t matches = count_occurrences(world, entities, entity, i);
+        switch(mask) {
+        case ECS_OR:
+            ecs_assert(matches >= 1, ECS_TYPE_CONSTRAINT_VIOLATION, NULL);
+            break;
+        case ECS_XOR:
+            ecs_assert(matches == 1, ECS_TYPE_CONSTRAINT_VIOLATION, NULL);
+            break;
+        case ECS_NOT:
+            ecs_assert(matches == 0, ECS_TYPE_CONSTRAINT_VIOLATION, NULL);    
+            break;
+        }
+    }
+}
+
+#endif
+
+static
+ecs_table_t *find_or_create(
+    ecs_world_t * world,
+    ecs_entities_t * entities)
+{    
+    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* Make sure array is ordered and does not contain duplicates */
+    int32_t type_count = entities->count;
+    ecs_entity_t *ordered = NULL;
+
+    if (!type_count) {
+        return &world->store.root;
+    }
+
+    if (!ecs_entity_array_is_ordered(entities)) {
+        ecs_size_t size = ECS_SIZEOF(ecs_entity_t) * type_count;
+        ordered = ecs_os_alloca(size);
+        ecs_os_memcpy(ordered, entities->array, size);
+        qsort(ordered, (size_t)type_count, sizeof(ecs_entity_t), ecs_entity_compare);
+        type_count = ecs_entity_array_dedup(ordered, type_count);
+    } else {
+        ordered = entities->array;
+    }    
+
+    /* Look for a table with the same type hash that matches the type */
+    ecs_table_t **head = ecs_map_get(world->store.table_index, ecs_table_t*,
+        hash_entities(ordered, type_count));
+    ecs_table_t *table = head ? *head : NULL;
+    for (; table; table = table->hash_next) {
+        ecs_type_t type = table->type;
+        int32_t table_type_count = ecs_vector_count(type);
+
+        /* If types do not contain same number of entities, table won't match */
+        if (table_type_count != type_count) {
+            continue;
+        }
+
+        /* Memcmp the types, as they must match exactly */
+        ecs_entity_t *type_array = ecs_vector_first(type, ecs_entity_t);
+        if (!ecs_os_memcmp(ordered, type_array, type_count * ECS_SIZEOF(ecs_entity_t))) {
+            /* Table found */
+            return table;
+        }
+    }  
+
+    ecs_entities_t ordered_entities = {
+        .array = ordered,
+        .count = type_count
+    };
+
+#ifndef NDEBUG
+    /* Check for constraint violations */
+    verify_constraints(world, &ordered_entities);
+#endif
+
+    /* If we get here, the table has not been found. It has to be created. */
+    
+    ecs_table_t *result = create_table(world, &ordered_entities);
+
+    ecs_assert(ordered_entities.count == ecs_vector_count(result->type), 
+        ECS_INTERNAL_ERROR, NULL);
+
+    return result;
+}
+
+ecs_table_t* ecs_table_find_or_create(
+    ecs_world_t * world,
+    ecs_entities_t * components)
+{
+    ecs_assert(world != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(!world->in_progress, ECS_INTERNAL_ERROR, NULL);
+
+    return find_or_create(world, components);
+}
+
+ecs_table_t* ecs_table_from_type(
+    ecs_world_t *world,
+    ecs_type_t type)
+{
+    ecs_entities_t components = ecs_type_to_entities(type);
+    return ecs_table_find_or_create(
+        world, &components);
+}
+
+void ecs_init_root_table(
+    ecs_world_t *world)
+{
+    ecs_entities_t entities = {
+        .array = NULL,
+        .count = 0
+    };
+
+    init_table(world, &world->store.root, &entities);
+}
+
+void ecs_table_unregister_child(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    if (!(table->flags & EcsTableHasParent)) {
+        if (!(table->flags & EcsTableHasChildOf)) {
+            unregister_child_table(world, table, 0);
+        }
+        return;
+    }
+
+    ecs_entity_t *entities = ecs_vector_first(table->type, ecs_entity_t);
+    int32_t i, count = ecs_vector_count(table->type);
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+        if (ECS_HAS_ROLE(e, CHILDOF)) {
+            unregister_child_table(world, table, e & ECS_COMPONENT_MASK);
+        }
+    }
+}
+
+void ecs_table_unregister_instance(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    if (!(table->flags & EcsTableHasBase)) {
+        return;
+    }
+
+    ecs_entity_t *entities = ecs_vector_first(table->type, ecs_entity_t);
+    int32_t i, count = ecs_vector_count(table->type);
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+        if (ECS_HAS_ROLE(e, INSTANCEOF)) {
+            unregister_instance_table(world, table, e & ECS_COMPONENT_MASK);
+        }
+    }
+}
+
+void ecs_instance_tables_delete(
+    ecs_world_t *world,
+    ecs_entity_t base)
+{
+    ecs_vector_t *instance_tables = ecs_map_get_ptr(
+            world->instance_tables, ecs_vector_t*, base);
+    if (instance_tables) {
+        ecs_vector_free(instance_tables);
+        ecs_map_remove(world->instance_tables, base);
+    }
+}
+
+static
+void invalidate_bases_in_table(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    ecs_map_iter_t it = ecs_map_iter(world->instance_tables);
+    ecs_map_key_t key;
+    while (ecs_map_next_ptr(&it, ecs_vector_t*, &key)) {
+        ecs_record_t *r = ecs_eis_get(world, key);
+        if (r && r->table == table) {
+            ecs_invalidate_base_cache(world, key);
+        }
+    }
+}
+
+void ecs_invalidate_base_cache(
+    ecs_world_t *world,
+    ecs_entity_t base)
+{
+    ecs_vector_t *instance_tables = ecs_map_get_ptr(
+            world->instance_tables, ecs_vector_t*, base);
+
+    ecs_vector_each(instance_tables, ecs_table_t*, t_ptr, {
+        ecs_table_t *table = *t_ptr;
+        if (table->base_cache) {
+            ecs_map_clear(table->base_cache);
+        }
+
+        /* Instances that are bases themselves pass on the change */
+        invalidate_bases_in_table(world, table);
+    });
+}
+
+void ecs_table_invalidate_base_cache(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    if (world->instance_tables) {
+        invalidate_bases_in_table(world, table);
+    }
+}
+
+static
+ecs_table_t* live_edge(
+    ecs_table_t *table)
+{
+    if (table && (table->flags & EcsTableIsGarbage)) {
+        return NULL;
+    } else {
+        return table;
+    }
+}
+
+static
+void clear_garbage_edges(
+    ecs_table_t *table)
+{
+    uint32_t i;
+    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
+        ecs_edge_t *e = &table->lo_edges[i];
+        e->add = live_edge(e->add);
+        e->remove = live_edge(e->remove);
+    }
+
+    ecs_map_iter_t it = ecs_map_iter(table->hi_edges);
+    ecs_edge_t *e;
+    while ((e = ecs_map_next(&it, ecs_edge_t, NULL))) {
+        e->add = live_edge(e->add);
+        e->remove = live_edge(e->remove);
+    }
+}
+
+void ecs_table_clear_garbage_edges(
+    ecs_world_t *world)
+{
+    /* Edges are not always symmetric, so a table that is about to be deleted
+     * may be referenced by tables that it does not reference itself. Visit all
+     * tables to make sure no edge points to a deleted table. */
+    clear_garbage_edges(&world->store.root);
+
+    int32_t i, count = ecs_sparse_count(world->store.tables);
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(world->store.tables, ecs_table_t, i);
+        clear_garbage_edges(table);
+    }
+}
+
+void ecs_table_clear_edges(
+    ecs_table_t *table)
+{
+    uint32_t i;
+    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
+        ecs_edge_t *e = &table->lo_edges[i];
+        ecs_table_t *add = e->add, *remove = e->remove;
+        if (add) {
+            add->lo_edges[i].remove = NULL;
+        }
+        if (remove) {
+            remove->lo_edges[i].add = NULL;
+        }
+    }
+
+    ecs_map_iter_t it = ecs_map_iter(table->hi_edges);
+    ecs_edge_t *edge;
+    ecs_map_key_t component;
+    while ((edge = ecs_map_next(&it, ecs_edge_t, &component))) {
+        ecs_table_t *add = edge->add, *remove = edge->remove;
+        if (add) {
+            ecs_edge_t *e = get_edge(add, component);
+            e->remove = NULL;
+            if (!e->add) {
+                ecs_map_remove(add->hi_edges, component);
+            }
+        }
+        if (remove) {
+            ecs_edge_t *e = get_edge(remove, component);
+            e->add = NULL;
+            if (!e->remove) {
+                ecs_map_remove(remove->hi_edges, component);
+            }
+        }
+    }
+}
+
+#define LOAD_FACTOR (1.5)
+#define KEY_SIZE (ECS_SIZEOF(ecs_map_key_t))
+#define BUCKET_COUNT (8)
+#define BUCKET_CHUNK_COUNT (64)
+#define ELEM_SIZE(elem_size) (KEY_SIZE + elem_size)
+#define BUCKET_SIZE(elem_size, offset)\
+    (offset + BUCKET_COUNT * (ELEM_SIZE(elem_size)))
+
+#define NEXT_ELEM(elem, elem_size) \
+    ECS_OFFSET(elem, ELEM_SIZE(elem_size))
+
+#define GET_ELEM(array, elem_size, index) \
+    ECS_OFFSET(array, ELEM_SIZE(elem_size) * index)
+
+#define PAYLOAD_ARRAY(bucket, offset) \
+    ECS_OFFSET(bucket, offset)
+
+#define PAYLOAD(elem) \
+    ECS_OFFSET(elem, KEY_SIZE)
+
+struct ecs_bucket_t {
+    int32_t count;
+};
+
+struct ecs_map_t {
+    ecs_sparse_t *buckets;
+    int32_t elem_size;
+    int32_t type_elem_size;
+    int32_t bucket_size;
+    int32_t bucket_count;
+    int32_t count;
+    int32_t offset;
+};
+
+static
+int32_t next_pow_of_2(
+    int32_t n)
+{
+    n --;
+    n |= n >> 1;
+    n |= n >> 2;
+    n |= n >> 4;
+    n |= n >> 8;
+    n |= n >> 16;
+    n ++;
+
+    return n;
+}
+
+static
+int32_t get_bucket_count(
+    int32_t element_count)
+{
+    return next_pow_of_2((int32_t)((float)element_count * LOAD_FACTOR));
+}
+
+static
+uint64_t get_bucket_id(
+    int32_t bucket_count,
+    ecs_map_key_t key) 
+{
+    ecs_assert(bucket_count > 0, ECS_INTERNAL_ERROR, NULL);
+    uint64_t result = key & ((uint64_t)bucket_count - 1);
+    ecs_assert(result < INT32_MAX, ECS_INTERNAL_ERROR, NULL);
+    return result;
+}
+
+static
+ecs_bucket_t* find_bucket(
+    const ecs_map_t *map,
+    ecs_map_key_t key)
+{
+    ecs_sparse_t *buckets = map->buckets;
+    int32_t bucket_count = map->bucket_count;
+    if (!bucket_count) {
+        return NULL;
+    }
+
+    uint64_t bucket_id = get_bucket_id(bucket_count, key);
+
+    return _ecs_sparse_get_sparse(buckets, 0, bucket_id);
+}
+
+static
+ecs_bucket_t* find_or_create_bucket(
+    ecs_map_t *map,
+    ecs_map_key_t key)
+{
+    ecs_sparse_t *buckets = map->buckets;
+    int32_t bucket_count = map->bucket_count;
+
+    if (!bucket_count) {
+        ecs_sparse_set_size(buckets, 8);
+        bucket_count = 8;
+    }
+
+    uint64_t bucket_id = get_bucket_id(bucket_count, key);
+    return _ecs_sparse_get_or_create(buckets, 0, bucket_id);    
+}
+
+static
+void remove_bucket(
+    ecs_map_t *map,
+    ecs_map_key_t key)
+{
+    int32_t bucket_count = map->bucket_count;
+    uint64_t bucket_id = get_bucket_id(bucket_count, key);
+    ecs_sparse_remove(map->buckets, bucket_id);
+    ecs_sparse_set_generation(map->buckets, bucket_id);
+}
+
+static
+int32_t add_to_bucket(
+    ecs_bucket_t *bucket,
+    ecs_size_t elem_size,
+    int32_t offset,
+    ecs_map_key_t key,
+    void *payload)
+{
+    ecs_assert(bucket->count < BUCKET_COUNT, ECS_INTERNAL_ERROR, NULL);
+
+    void *array = PAYLOAD_ARRAY(bucket, offset);
+    ecs_map_key_t *elem = GET_ELEM(array, elem_size, bucket->count);
+    *elem = key;
+    ecs_os_memcpy(PAYLOAD(elem), payload, elem_size);
+    return ++ bucket->count;
+}
+
+static
+void remove_from_bucket(
+    ecs_bucket_t *bucket,
+    ecs_map_key_t key,
+    ecs_size_t elem_size,
+    int32_t offset,
+    int32_t index)
+{
+    (void)key;
+
+    ecs_assert(bucket->count != 0, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(index < bucket->count, ECS_INTERNAL_ERROR, NULL);
+
+    bucket->count--;
+
+    if (index != bucket->count) {
+        void *array = PAYLOAD_ARRAY(bucket, offset);
+        ecs_map_key_t *elem = GET_ELEM(array, elem_size, index);
+        ecs_map_key_t *last_elem = GET_ELEM(array, elem_size, bucket->count);
+
+        ecs_assert(key == *elem, ECS_INTERNAL_ERROR, NULL);
+        ecs_os_memcpy(elem, last_elem, ELEM_SIZE(elem_size));
+    }
+}
+
+static
+void rehash(
+    ecs_map_t *map,
+    int32_t bucket_count)
+{
+    bool rehash_again;
+
+    ecs_assert(bucket_count != 0, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(bucket_count > map->bucket_count, ECS_INTERNAL_ERROR, NULL);
+
+    do {
+        rehash_again = false;
+
+        ecs_sparse_t *buckets = map->buckets;
+        ecs_size_t elem_size = map->elem_size;
+        int32_t offset = map->offset;
+
+        ecs_sparse_set_size(buckets, bucket_count);
+        map->bucket_count = bucket_count;
+
+        /* Only iterate over old buckets with elements */
+        int32_t b, filled_bucket_count = ecs_sparse_count(buckets);
+        const uint64_t *indices = ecs_sparse_ids(buckets);
+
+        /* Iterate backwards as elements could otherwise be moved to existing
+         * buckets which could temporarily cause the number of elements in a
+         * bucket to exceed BUCKET_COUNT. */
+        for (b = filled_bucket_count - 1; b >= 0; b --) {
+            uint64_t bucket_id = indices[b];
+            ecs_bucket_t *bucket = _ecs_sparse_get_sparse(buckets, 0, bucket_id);
+            ecs_assert(bucket != NULL, ECS_INTERNAL_ERROR, NULL);
+
+            int i, count = bucket->count;
+            ecs_map_key_t *array = PAYLOAD_ARRAY(bucket, offset);
+
+            for (i = 0; i < count; i ++) {
+                ecs_map_key_t *elem = GET_ELEM(array, elem_size, i);
+                ecs_map_key_t key = *elem;
+                uint64_t new_bucket_id = get_bucket_id(bucket_count, key);
+
+                if (new_bucket_id != bucket_id) {
+                    ecs_bucket_t *new_bucket = _ecs_sparse_get_or_create(
+                        buckets, 0, new_bucket_id);
+                    ecs_assert(new_bucket != NULL, ECS_INTERNAL_ERROR, NULL);
+
+                    indices = ecs_sparse_ids(buckets);
+                    ecs_assert(indices != NULL, ECS_INTERNAL_ERROR, NULL);
+
+                    if (add_to_bucket(new_bucket, elem_size, offset, 
+                        key, PAYLOAD(elem)) == BUCKET_COUNT) 
+                    {
+                        rehash_again = true;
+                    }
+
+                    remove_from_bucket(bucket, key, elem_size, offset, i);
+
+                    count --;
+                    i --;
+                }
+            }
+        }
+
+        bucket_count *= 2;        
+    } while (rehash_again);
+}
+
+ecs_map_t* _ecs_map_new(
+    ecs_size_t elem_size,
+    ecs_size_t alignment, 
+    int32_t element_count)
+{
+    ecs_map_t *result = ecs_os_calloc(ECS_SIZEOF(ecs_map_t) * 1);
+    ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    int32_t bucket_count = get_bucket_count(element_count);
+
+    result->count = 0;
+    result->type_elem_size = elem_size;
+
+    if (elem_size < ECS_SIZEOF(ecs_map_key_t)) {
+        result->elem_size = ECS_SIZEOF(ecs_map_key_t);
+    } else {
+        result->elem_size = elem_size;
+    }
+    
+    if (alignment < ECS_SIZEOF(ecs_map_key_t)) {
+        result->offset = ECS_SIZEOF(ecs_map_key_t);
+    } else {
+        result->offset = alignment;
+    }
+
+    result->bucket_count = bucket_count;
+    result->buckets = _ecs_sparse_new(BUCKET_SIZE(elem_size, result->offset));
+
+    /* Bucket ids are lower than the bucket count, so most maps only use the
+     * first buckets of a chunk. Keep chunks small to reduce the cost of
+     * creating maps. */
+    ecs_sparse_set_chunk_size(result->buckets, BUCKET_CHUNK_COUNT);
+    ecs_sparse_set_alloc_tag(result->buckets, EcsAllocMap);
+    ecs_os_track_alloc(EcsAllocMap, 0, ECS_SIZEOF(ecs_map_t));
+
+    return result;
+}
+
+void ecs_map_free(
+    ecs_map_t *map)
+{
+    if (map) {
+        ecs_sparse_free(map->buckets);
+        ecs_os_track_alloc(EcsAllocMap, ECS_SIZEOF(ecs_map_t), 0);
+        ecs_os_free(map);
+    }
+}
+
+void* _ecs_map_get(
+    const ecs_map_t *map,
+    ecs_size_t elem_size,
+    ecs_map_key_t key)
+{
+    (void)elem_size;
+
+    if (!map) {
+        return NULL;
+    }
+
+    ecs_assert(elem_size == map->type_elem_size, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_bucket_t * bucket = find_bucket(map, key);
+
+    if (!bucket) {
+        return NULL;
+    }
+
+    ecs_map_key_t *elem = PAYLOAD_ARRAY(bucket, map->offset);
+
+    uint8_t i = 0;
+    while (i++ < bucket->count) {
+        if (*elem == key) {
+            return PAYLOAD(elem);
+        }
+
+        elem = NEXT_ELEM(elem, map->elem_size);
+    }
+
+    return NULL;
+}
+
+void* _ecs_map_get_ptr(
+    const ecs_map_t *map,
+    ecs_map_key_t key)
+{
+    void * ptr_ptr = _ecs_map_get(map, ECS_SIZEOF(void*), key);
+
+    if (ptr_ptr) {
+        return *(void**)ptr_ptr;
+    } else {
+        return NULL;
+    }
+}
+
+void _ecs_map_set(
+    ecs_map_t *map,
+    ecs_size_t elem_size,
+    ecs_map_key_t key,
+    const void *payload)
+{
+    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(elem_size == map->type_elem_size, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_bucket_t * bucket = find_or_create_bucket(map, key);
+    ecs_assert(bucket != NULL, ECS_INTERNAL_ERROR, NULL);
+    
+    int32_t bucket_count = bucket->count;
+    void *array = PAYLOAD_ARRAY(bucket, map->offset);
+    ecs_map_key_t *elem = array, *found = NULL;
+
+    uint8_t i = 0;
+    while (i++ < bucket_count) {
+        if (*elem == key) {
+            found = elem;
+            break;
+        }
+
+        elem = NEXT_ELEM(elem, map->elem_size);
+    }
+
+    if (!found) {
+        if (bucket->count == BUCKET_COUNT) {
+            /* Can't fit in current bucket, need to grow the map first */
+            rehash(map, map->bucket_count * 2);
+            _ecs_map_set(map, elem_size, key, payload);
+        } else {
+            ecs_assert(bucket->count < BUCKET_COUNT, ECS_INTERNAL_ERROR, NULL);
+
+            bucket_count = ++bucket->count;
+            int32_t map_count = ++map->count;
+            
+            *elem = key;
+            ecs_os_memcpy(PAYLOAD(elem), payload, elem_size);
+
+            int32_t target_bucket_count = get_bucket_count(map_count);
+            int32_t map_bucket_count = map->bucket_count;
+
+            if (bucket_count == BUCKET_COUNT) {
+                rehash(map, map_bucket_count * 2);
+            } else {
+                if (target_bucket_count > map_bucket_count) {
+                    rehash(map, target_bucket_count);
+                }
+            }            
+        }
+    } else {
+        *found = key;
+        ecs_os_memcpy(PAYLOAD(found), payload, elem_size);
+    }
+
+    ecs_assert(map->bucket_count != 0, ECS_INTERNAL_ERROR, NULL);
+}
+
+void ecs_map_remove(
+    ecs_map_t *map,
+    ecs_map_key_t key)
+{
+    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_bucket_t * bucket = find_bucket(map, key);
+    if (!bucket) {
+        return;
+    }
+   
+    ecs_size_t elem_size = map->elem_size;
+    void *array = PAYLOAD_ARRAY(bucket, map->offset);
+    ecs_map_key_t *elem = array;
+    int32_t bucket_count = bucket->count;
+
+    if (!bucket_count) {
+        return;
+    }
+
+    uint8_t i = 0;
+    do {
+        if (*elem == key) {
+            ecs_map_key_t *last_elem = GET_ELEM(array, elem_size, (bucket_count - 1));
+            if (last_elem > elem) {
+                ecs_os_memcpy(elem, last_elem, ELEM_SIZE(elem_size));
+            }
+
+            map->count --;
+            if (!--bucket->count) {
+                remove_bucket(map, key);
+            }
+
+            break;
+        }
+
+        elem = NEXT_ELEM(elem, elem_size);
+    } while (++i < bucket_count);   
+}
+
+int32_t ecs_map_count(
+    const ecs_map_t *map)
+{
+    return map ? map->count : 0;
+}
+
+int32_t ecs_map_bucket_count(
+    const ecs_map_t *map)
+{
+    return map ? map->bucket_count : 0;
+}
+
+void ecs_map_clear(
+    ecs_map_t *map)
+{
+    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_sparse_clear(map->buckets);
+    map->count = 0;
+}
+
+ecs_map_iter_t ecs_map_iter(
+    const ecs_map_t *map)
+{
+    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    return (ecs_map_iter_t){
+        .map = map,
+        .bucket = NULL,
+        .bucket_index = 0,
+        .element_index = 0
+    };
+}
+
+void* _ecs_map_next(
+    ecs_map_iter_t *iter,
+    ecs_size_t elem_size,
+    ecs_map_key_t *key_out)
+{
+    const ecs_map_t *map = iter->map;
+    
+    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!elem_size || elem_size == map->type_elem_size, ECS_INVALID_PARAMETER, NULL);
+ 
+    ecs_bucket_t *bucket = iter->bucket;
+    int32_t element_index = iter->element_index;
+    elem_size = map->elem_size;
+
+    do {
+        if (!bucket) {
+            int32_t bucket_index = iter->bucket_index;
+            ecs_sparse_t *buckets = map->buckets;
+            if (bucket_index < ecs_sparse_count(buckets)) {
+                bucket = _ecs_sparse_get(buckets, 0, bucket_index);
+                iter->bucket = bucket;
+
+                element_index = 0;
+                iter->element_index = 0;
+            } else {
+                return NULL;
+            }
+        }
+
+        if (element_index < bucket->count) {
+            iter->element_index = element_index + 1;
+            break;
+        } else {
+            bucket = NULL;
+            iter->bucket_index ++;
+        }
+    } while (true);
+
+    void *array = PAYLOAD_ARRAY(bucket, map->offset);
+    ecs_map_key_t *elem = GET_ELEM(array, elem_size, element_index);
+    
+    if (key_out) {
+        *key_out = *elem;
+    }
+
+    return PAYLOAD(elem);
+}
+
+void* _ecs_map_next_ptr(
+    ecs_map_iter_t *iter,
+    ecs_map_key_t *key_out)
+{
+    void *result = _ecs_map_next(iter, ECS_SIZEOF(void*), key_out);
+    if (result) {
+        return *(void**)result;
+    } else {
+        return NULL;
+    }
+}
+
+void ecs_map_grow(
+    ecs_map_t *map, 
+    int32_t element_count)
+{
+    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+    int32_t target_count = map->count + element_count;
+    int32_t bucket_count = get_bucket_count(target_count);
+
+    if (bucket_count > map->bucket_count) {
+        rehash(map, bucket_count);
+    }
+}
+
+void ecs_map_set_size(
+    ecs_map_t *map, 
+    int32_t element_count)
+{    
+    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+    int32_t bucket_count = get_bucket_count(element_count);
+
+    if (bucket_count) {
+        rehash(map, bucket_count);
+    }
+}
+
+void ecs_map_memory(
+    ecs_map_t *map, 
+    int32_t *allocd,
+    int32_t *used)
+{
+    ecs_assert(map != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_sparse_memory(map->buckets, allocd, NULL);
+
+    if (used) {
+        *used = map->count * ELEM_SIZE(map->elem_size);
+    }
+}
+
+ecs_map_t* ecs_map_copy(
+    const ecs_map_t *src)
+{
+    if (!src) {
+        return NULL;
+    }
+    
+    ecs_map_t *dst = ecs_os_memdup(src, ECS_SIZEOF(ecs_map_t));
+    
+    dst->buckets = ecs_sparse_copy(src->buckets);
+    ecs_os_track_alloc(EcsAllocMap, 0, ECS_SIZEOF(ecs_map_t));
+
+    return dst;
+}
+
+static
+void* get_owned_column_ptr(
+    const ecs_iter_t *it,
+    ecs_size_t size,
+    int32_t table_column,
+    int32_t row)
+{
+    ecs_assert(it->table_columns != NULL, ECS_INTERNAL_ERROR, NULL);
+    (void)size;
+
+    ecs_column_t *column = &((ecs_column_t*)it->table_columns)[table_column - 1];
+    ecs_assert(column->size != 0, ECS_COLUMN_HAS_NO_DATA, NULL);
+    ecs_assert(!size || column->size == size, ECS_COLUMN_TYPE_MISMATCH, NULL);
+    void *buffer = ecs_vector_first_t(column->data, column->size, column->alignment);
+    return ECS_OFFSET(buffer, column->size * (it->offset + row));
+}
+
+static
+void* get_prev_column_ptr(
+    const ecs_iter_t *it,
+    ecs_size_t size,
+    int32_t table_column,
+    int32_t row)
+{
+    ecs_data_t *data = ecs_table_get_data(it->table->table);
+    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+    (void)size;
+
+    /* The component must be double buffered to be read with [prev] */
+    ecs_assert(data->prev_columns != NULL, ECS_COLUMN_HAS_NO_DATA, NULL);
+
+    ecs_column_t *column = &data->prev_columns[table_column - 1];
+    ecs_assert(column->size != 0, ECS_COLUMN_HAS_NO_DATA, NULL);
+    ecs_assert(!size || column->size == size, ECS_COLUMN_TYPE_MISMATCH, NULL);
+    void *buffer = ecs_vector_first_t(column->data, column->size, column->alignment);
+    return ECS_OFFSET(buffer, column->size * (it->offset + row));
+}
+
+static
+const void* get_shared_column(
+    const ecs_iter_t *it,
+    ecs_size_t size,
+    int32_t table_column)
+{
+    ecs_ref_t *refs = it->table->references;
+    ecs_assert(refs != NULL, ECS_INTERNAL_ERROR, NULL);
+    (void)size;
+
+#ifndef NDEBUG
+    if (size) {
+        ecs_entity_t component_id = ecs_component_id_from_id(
+            it->world, refs[-table_column - 1].component);
+
+        const EcsComponent *cdata = ecs_get(
+            it->world, component_id, EcsComponent);
+
+        ecs_assert(cdata != NULL, ECS_INTERNAL_ERROR, NULL);
+        ecs_assert(cdata->size == size, ECS_COLUMN_TYPE_MISMATCH, 
+            ecs_get_name(it->world, it->system));
+    }
+#endif
+
+    ecs_ref_t *ref = &refs[-table_column - 1];
+
+    /* Refs are cached in the query, which is shared between reader threads.
+     * Resolve into a local copy so that readers don't write to the query. */
+    if (ecs_is_reader_thread()) {
+        ecs_ref_t local = *ref;
+        return (void*)ecs_get_ref_w_entity(
+            it->world, &local, local.entity, local.component);
+    }
+
+    return (void*)ecs_get_ref_w_entity(
+        it->world, ref, ref->entity, ref->component);
+}
+
+static
+void* get_lookup_column(
+    const ecs_iter_t *it,
+    ecs_size_t size,
+    int32_t column,
+    int32_t row)
+{
+    ecs_entity_t *components = it->table->components;
+    if (!components || !it->entities) {
+        return NULL;
+    }
+
+    ecs_world_t *world = it->world;
+    ecs_get_stage(&world);
+
+    ecs_c_info_t *c_info = ecs_get_sparse_c_info(
+        world, components[column - 1]);
+    if (!c_info) {
+        return NULL;
+    }
+
+    ecs_assert(!size || c_info->size == size, ECS_COLUMN_TYPE_MISMATCH, NULL);
+    (void)size;
+
+    return _ecs_sparse_get_sparse(c_info->sparse, 0, it->entities[row]);
+}
+
+static
+bool get_table_column(
+    const ecs_iter_t *it,
+    int32_t column,
+    int32_t *table_column_out)
+{
+    ecs_assert(column <= it->column_count, ECS_INVALID_PARAMETER, NULL);
+
+    int32_t table_column = 0;
+
+    if (column != 0) {
+        ecs_assert(it->table->columns != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        table_column = it->table->columns[column - 1];
+        if (!table_column) {
+            /* column is not set */
+            return false;
+        }
+    }
+
+    *table_column_out = table_column;
+
+    return true;
+}
+
+static
+void* get_column(
+    const ecs_iter_t *it,
+    ecs_size_t size,
+    int32_t column,
+    int32_t row)
+{
+    int32_t table_column;
+
+    if (!column) {
+        return it->entities;
+    }
+
+    if (!get_table_column(it, column, &table_column)) {
+        /* Column may be a component with sparse storage */
+        return get_lookup_column(it, size, column, row);
+    }
+
+    if (table_column < 0) {
+        return (void*)get_shared_column(it, size, table_column);
+    }
+
+    ecs_query_t *query = it->query;
+    if (query && (query->flags & EcsQueryHasPrev)) {
+        ecs_sig_column_t *column_data = ecs_vector_get(
+            query->sig.columns, ecs_sig_column_t, column - 1);
+        if (column_data->inout_kind == EcsInPrev) {
+            return get_prev_column_ptr(it, size, table_column, row);
+        }
+    }
+
+    return get_owned_column_ptr(it, size, table_column, row);
+}
+
+
+/* --- Public API --- */
+
+void* ecs_column_w_size(
+    const ecs_iter_t *it,
+    size_t size,
+    int32_t column)
+{
+    return get_column(it, ecs_from_size_t(size), column, 0);
+}
+
+void* ecs_element_w_size(
+    const ecs_iter_t *it, 
+    size_t size,
+    int32_t column,
+    int32_t row)
+{
+    return get_column(it, ecs_from_size_t(size), column, row);
+}
+
+void* ecs_column_field_w_size(
+    const ecs_iter_t *it,
+    size_t size,
+    int32_t column,
+    int32_t field)
+{
+    ecs_assert(column > 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(field >= 0, ECS_INVALID_PARAMETER, NULL);
+
+    int32_t table_column;
+    if (!get_table_column(it, column, &table_column)) {
+        return NULL;
+    }
+
+    /* Fields can only be accessed as arrays for owned components */
+    ecs_assert(table_column > 0, ECS_COLUMN_IS_SHARED, NULL);
+
+    ecs_table_t *table = it->table->table;
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t soa_index = ecs_table_soa_column_index(table, table_column - 1);
+    ecs_assert(soa_index != -1, ECS_COLUMN_HAS_NO_DATA, NULL);
+    ecs_assert(field < ecs_vector_count(table->c_info[table_column - 1]->fields), 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_column_t *soa_column = &data->soa_columns[soa_index + field];
+    ecs_assert(!size || soa_column->size == ecs_from_size_t(size), 
+        ECS_COLUMN_TYPE_MISMATCH, NULL);
+    (void)size;
+
+    void *buffer = ecs_vector_first_t(
+        soa_column->data, soa_column->size, soa_column->alignment);
+    return ECS_OFFSET(buffer, soa_column->size * it->offset);
+}
+
+bool ecs_is_owned(
+    const ecs_iter_t *it,
+    int32_t column)
+{
+    int32_t table_column;
+
+    if (!get_table_column(it, column, &table_column)) {
+        return true;
+    }
+
+    return table_column >= 0;
+}
+
+bool ecs_is_readonly(
+    const ecs_iter_t *it,
+    int32_t column)
+{
+    ecs_query_t *query = it->query;
+
+    /* If this is not a query iterator, readonly is meaningless */
+    ecs_assert(query != NULL, ECS_INVALID_OPERATION, NULL);
+
+    ecs_sig_column_t *column_data = ecs_vector_get(
+        it->query->sig.columns, ecs_sig_column_t, column - 1);
+
+    ecs_sig_inout_kind_t inout = column_data->inout_kind;
+    return inout == EcsIn || inout == EcsInPrev;
+}
+
+ecs_entity_t ecs_column_source(
+    const ecs_iter_t *it,
+    int32_t index)
+{
+    ecs_assert(index <= it->column_count, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(index > 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(it->table->columns != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_iter_table_t *table = it->table;
+    int32_t table_column = table->columns[index - 1];
+    if (table_column >= 0) {
+        return 0;
+    }
+
+    ecs_assert(table->references != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_ref_t *ref = &table->references[-table_column - 1];
+    return ref->entity;
+}
+
+ecs_type_t ecs_column_type(
+    const ecs_iter_t *it,
+    int32_t index)
+{
+    ecs_assert(index <= it->column_count, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(index > 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(it->table->types != NULL, ECS_INTERNAL_ERROR, NULL);
+    return it->table->types[index - 1];
+}
+
+ecs_entity_t ecs_column_entity(
+    const ecs_iter_t *it,
+    int32_t index)
+{
+    ecs_assert(index <= it->column_count, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(index > 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(it->table->components != NULL, ECS_INTERNAL_ERROR, NULL);
+    return it->table->components[index - 1];
+}
+
+size_t ecs_column_size(
+    const ecs_iter_t *it,
+    int32_t index)
+{
+    ecs_assert(index <= it->column_count, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(index > 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(it->table->columns != NULL, ECS_INTERNAL_ERROR, NULL);
+    int32_t table_column = it->table->columns[index - 1];
+    return ecs_table_column_size(it, table_column - 1);
+}
+
+int32_t ecs_column_index_from_name(
+    const ecs_iter_t *it,
+    const char *name)
+{
+    ecs_sig_column_t *column = NULL;
+    if (it->query) {
+        int32_t i, count = ecs_vector_count(it->query->sig.columns);
+        for (i = 0; i < count; i ++) {
+            column = ecs_vector_get(
+                it->query->sig.columns, ecs_sig_column_t, i);
+            if (column->name) {
+                if (!strcmp(name, column->name)) {
+                    return i + 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+ecs_type_t ecs_iter_type(
+    const ecs_iter_t *it)
+{
+    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_table_t *table = it->table->table;
+    return table->type;
+}
+
+int32_t ecs_table_component_index(
+    const ecs_iter_t *it,
+    ecs_entity_t component)
+{
+    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(it->table->table != NULL, ECS_INTERNAL_ERROR, NULL);
+    return ecs_type_index_of(it->table->table->type, component);
+}
+
+void* ecs_table_column(
+    const ecs_iter_t *it,
+    int32_t column_index)
+{
+    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_table_t *table = it->table->table;
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(column_index < ecs_vector_count(table->type), 
+        ECS_INVALID_PARAMETER, NULL);
+    
+    if (table->column_count <= column_index) {
+        return NULL;
+    }
+
+    ecs_column_t *columns = it->table_columns;
+    ecs_column_t *column = &columns[column_index];
+    return ecs_vector_first_t(column->data, column->size, column->alignment);
+}
+
+void* ecs_table_column_w_offset(
+    const ecs_iter_t *it,
+    int32_t column_index)
+{
+    void *first = ecs_table_column(it, column_index);
+    if (!first) {
+        return NULL;
+    }
+
+    ecs_column_t *columns = it->table_columns;
+    ecs_column_t *column = &columns[column_index];
+    return ECS_OFFSET(first, column->size * it->offset);
+}
+
+size_t ecs_table_column_size(
+    const ecs_iter_t *it,
+    int32_t column_index)
+{
+    ecs_assert(it->table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_table_t *table = it->table->table;
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(column_index < ecs_vector_count(table->type), 
+        ECS_INVALID_PARAMETER, NULL);
+
+    if (table->column_count <= column_index) {
+        return 0;
+    }
+
+    ecs_column_t *columns = it->table_columns;
+    ecs_column_t *column = &columns[column_index];
+    
+    return ecs_to_size_t(column->size);
+}
+
+int8_t ecs_to_i8(
+    int64_t v)
+{
+    ecs_assert(v < INT8_MAX, ECS_INTERNAL_ERROR, NULL);
+    return (int8_t)v;
+}
+
+int16_t ecs_to_i16(
+    int64_t v)
+{
+    ecs_assert(v < INT16_MAX, ECS_INTERNAL_ERROR, NULL);
+    return (int16_t)v;
+}
+
+uint32_t ecs_to_u32(
+    uint64_t v)
+{
+    ecs_assert(v < UINT32_MAX, ECS_INTERNAL_ERROR, NULL);
+    return (uint32_t)v;    
+}
+
+size_t ecs_to_size_t(
+    int64_t size)
+{
+    ecs_assert(size >= 0, ECS_INTERNAL_ERROR, NULL);
+    return (size_t)size;
+}
+
+ecs_size_t ecs_from_size_t(
+    size_t size)
+{
+   ecs_assert(size < INT32_MAX, ECS_INTERNAL_ERROR, NULL); 
+   return (ecs_size_t)size;
+}
+
+/** Convert time to double */
+double ecs_time_to_double(
+    ecs_time_t t)
+{
+    double result;
+    result = t.sec;
+    return result + (double)t.nanosec / (double)1000000000;
+}
+
+ecs_time_t ecs_time_sub(
+    ecs_time_t t1,
+    ecs_time_t t2)
+{
+    ecs_time_t result;
+
+    if (t1.nanosec >= t2.nanosec) {
+        result.nanosec = t1.nanosec - t2.nanosec;
+        result.sec = t1.sec - t2.sec;
+    } else {
+        result.nanosec = t1.nanosec - t2.nanosec + 1000000000;
+        result.sec = t1.sec - t2.sec - 1;
+    }
+
+    return result;
+}
+
+void ecs_sleepf(
+    double t)
+{
+    if (t > 0) {
+        int sec = (int)t;
+        int nsec = (int)((t - sec) * 1000000000);
+        ecs_os_sleep(sec, nsec);
+    }
+}
+
+double ecs_time_measure(
+    ecs_time_t *start)
+{
+    ecs_time_t stop, temp;
+    ecs_os_get_time(&stop);
+    temp = stop;
+    stop = ecs_time_sub(stop, *start);
+    *start = temp;
+    return ecs_time_to_double(stop);
+}
+
+void* ecs_os_memdup(
+    const void *src, 
+    ecs_size_t size) 
+{
+    if (!src) {
+        return NULL;
+    }
+    
+    void *dst = ecs_os_malloc(size);
+    ecs_assert(dst != NULL, ECS_OUT_OF_MEMORY, NULL);
+    ecs_os_memcpy(dst, src, size);  
+    return dst;  
+}
+
+/*
+    This code was taken from sokol_time.h 
+    
+    zlib/libpng license
+    Copyright (c) 2018 Andre Weissflog
+    This software is provided 'as-is', without any express or implied warranty.
+    In no event will the authors be held liable for any damages arising from the
+    use of this software.
+    Permission is granted to anyone to use this software for any purpose,
+    including commercial applications, and to alter it and redistribute it
+    freely, subject to the following restrictions:
+        1. The origin of this software must not be misrepresented; you must not
+        claim that you wrote the original software. If you use this software in a
+        product, an acknowledgment in the product documentation would be
+        appreciated but is not required.
+        2. Altered source versions must be plainly marked as such, and must not
+        be misrepresented as being the original software.
+        3. This notice may not be removed or altered from any source
+        distribution.
+*/
 
 
 static int ecs_os_time_initialized;
 
-#if defined(_WIN32)
-#ifndef WIN32_LEAN_AND_MEAN
-#define WIN32_LEAN_AND_MEAN
-#endif
-#include <windows.h>
-static double _ecs_os_time_win_freq;
-static LARGE_INTEGER _ecs_os_time_win_start;
-#elif defined(__APPLE__) && defined(__MACH__)
-#include <mach/mach_time.h>
-static mach_timebase_info_data_t _ecs_os_time_osx_timebase;
-static uint64_t _ecs_os_time_osx_start;
-#else /* anything else, this will need more care for non-Linux platforms */
-#include <time.h>
-static uint64_t _ecs_os_time_posix_start;
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+static double _ecs_os_time_win_freq;
+static LARGE_INTEGER _ecs_os_time_win_start;
+#elif defined(__APPLE__) && defined(__MACH__)
+#include <mach/mach_time.h>
+static mach_timebase_info_data_t _ecs_os_time_osx_timebase;
+static uint64_t _ecs_os_time_osx_start;
+#else /* anything else, this will need more care for non-Linux platforms */
+#include <time.h>
+static uint64_t _ecs_os_time_posix_start;
+#endif
+
+/* prevent 64-bit overflow when computing relative timestamp
+    see https://gist.github.com/jspohr/3dc4f00033d79ec5bdaf67bc46c813e3
+*/
+#if defined(_WIN32) || (defined(__APPLE__) && defined(__MACH__))
+int64_t int64_muldiv(int64_t value, int64_t numer, int64_t denom) {
+    int64_t q = value / denom;
+    int64_t r = value % denom;
+    return q * numer + r * numer / denom;
+}
+#endif
+
+void ecs_os_time_setup(void) {
+    if ( ecs_os_time_initialized) {
+        return;
+    }
+    
+    ecs_os_time_initialized = 1;
+    #if defined(_WIN32)
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        QueryPerformanceCounter(&_ecs_os_time_win_start);
+        _ecs_os_time_win_freq = (double)freq.QuadPart / 1000000000.0;
+    #elif defined(__APPLE__) && defined(__MACH__)
+        mach_timebase_info(&_ecs_os_time_osx_timebase);
+        _ecs_os_time_osx_start = mach_absolute_time();
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        _ecs_os_time_posix_start = (uint64_t)ts.tv_sec*1000000000 + (uint64_t)ts.tv_nsec; 
+    #endif
+}
+
+uint64_t ecs_os_time_now(void) {
+    ecs_assert(ecs_os_time_initialized != 0, ECS_INTERNAL_ERROR, NULL);
+
+    uint64_t now;
+
+    #if defined(_WIN32)
+        LARGE_INTEGER qpc_t;
+        QueryPerformanceCounter(&qpc_t);
+        now = (uint64_t)(qpc_t.QuadPart / _ecs_os_time_win_freq);
+    #elif defined(__APPLE__) && defined(__MACH__)
+        now = mach_absolute_time();
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        now = ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+    #endif
+
+    return now;
+}
+
+void ecs_os_time_sleep(
+    int32_t sec, 
+    int32_t nanosec) 
+{
+#ifndef _WIN32
+    struct timespec sleepTime;
+    ecs_assert(sec >= 0, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(nanosec >= 0, ECS_INTERNAL_ERROR, NULL);
+
+    sleepTime.tv_sec = sec;
+    sleepTime.tv_nsec = nanosec;
+    if (nanosleep(&sleepTime, NULL)) {
+        ecs_os_err("nanosleep failed");
+    }
+#else
+    HANDLE timer;
+    LARGE_INTEGER ft;
+
+    ft.QuadPart = -((int64_t)sec * 10000000 + (int64_t)nanosec / 100);
+
+    timer = CreateWaitableTimer(NULL, TRUE, NULL);
+    SetWaitableTimer(timer, &ft, 0, NULL, NULL, 0);
+    WaitForSingleObject(timer, INFINITE);
+    CloseHandle(timer);
+#endif
+}
+
+
+#if defined(_WIN32)
+
+static ULONG win32_current_resolution;
+
+void ecs_increase_timer_resolution(bool enable)
+{
+    HMODULE hntdll = GetModuleHandle((LPCTSTR)"ntdll.dll");
+    if (!hntdll) {
+        return;
+    }
+
+    LONG (__stdcall *pNtSetTimerResolution)(
+        ULONG desired, BOOLEAN set, ULONG * current);
+
+    pNtSetTimerResolution = (LONG(__stdcall*)(ULONG, BOOLEAN, ULONG*))
+        GetProcAddress(hntdll, "NtSetTimerResolution");
+
+    if(!pNtSetTimerResolution) {
+        return;
+    }
+
+    ULONG current, resolution = 10000; /* 1 ms */
+
+    if (!enable && win32_current_resolution) {
+        pNtSetTimerResolution(win32_current_resolution, 0, &current);
+        win32_current_resolution = 0;
+        return;
+    } else if (!enable) {
+        return;
+    }
+
+    if (resolution == win32_current_resolution) {
+        return;
+    }
+
+    if (win32_current_resolution) {
+        pNtSetTimerResolution(win32_current_resolution, 0, &current);
+    }
+
+    if (pNtSetTimerResolution(resolution, 1, &current)) {
+        /* Try setting a lower resolution */
+        resolution *= 2;
+        if(pNtSetTimerResolution(resolution, 1, &current)) return;
+    }
+
+    win32_current_resolution = resolution;
+}
+
+#else
+void ecs_increase_timer_resolution(bool enable)
+{
+    (void)enable;
+    return;
+}
+#endif
+
+#ifdef FLECS_PIPELINE
+
+#ifndef FLECS_PIPELINE_PRIVATE_H
+#define FLECS_PIPELINE_PRIVATE_H
+
+
+/** Instruction data for pipeline.
+ * This type is the element type of the flat program of a pipeline. The program
+ * contains the active systems of the pipeline in the order in which they are
+ * ran, and a sync point for every merge. Threads walk the program directly,
+ * without iterating the pipeline query. */
+typedef struct ecs_pipeline_op_t {
+    ecs_entity_t system;        /**< System to run, 0 for a sync point */
+    EcsSystem *system_data;     /**< System data of system */
+} ecs_pipeline_op_t;
+
+/** Row chunk of a parallel query job. */
+typedef struct ecs_par_chunk_t {
+    ecs_iter_table_t *table;    /**< Matched table */
+    void *table_columns;        /**< Table component data */
+    ecs_entity_t *entities;     /**< Entities of the chunk */
+    int32_t offset;             /**< Offset of the chunk in the table */
+    int32_t count;              /**< Number of entities in the chunk */
+    int32_t frame_offset;       /**< Offset relative to start of iteration */
+} ecs_par_chunk_t;
+
+/** Parallel query job.
+ * Chunks are claimed by the main thread and worker threads with an atomic
+ * increment, until all chunks have been processed. */
+typedef struct ecs_par_job_t {
+    ecs_iter_t it;              /**< Iterator template shared by all chunks */
+    ecs_iter_action_t action;   /**< Action invoked for each chunk */
+    ecs_vector_t *chunks;       /**< Row chunks (ecs_par_chunk_t) */
+    int32_t next_chunk;         /**< Number of claimed chunks */
+} ecs_par_job_t;
+
+////////////////////////////////////////////////////////////////////////////////
+//// Pipeline API
+////////////////////////////////////////////////////////////////////////////////
+
+int32_t ecs_pipeline_update(
+    ecs_world_t *world,
+    ecs_entity_t pipeline);
+
+int32_t ecs_pipeline_begin(
+    ecs_world_t *world,
+    ecs_entity_t pipeline);
+
+void ecs_pipeline_end(
+    ecs_world_t *world);
+
+void ecs_pipeline_progress(
+    ecs_world_t *world,
+    ecs_entity_t pipeline,
+    float delta_time);
+
+
+////////////////////////////////////////////////////////////////////////////////
+//// Worker API
+////////////////////////////////////////////////////////////////////////////////
+
+void ecs_worker_begin(
+    ecs_world_t *world);
+
+bool ecs_worker_sync(
+    ecs_world_t *world);
+
+void ecs_worker_end(
+    ecs_world_t *world);
+
+void ecs_workers_progress(
+    ecs_world_t *world);
+
+#endif
+
+/* Invoke action of parallel query job for a single chunk */
+static
+void par_chunk_run(
+    ecs_par_job_t *job,
+    ecs_iter_t *it,
+    int32_t index)
+{
+    ecs_par_chunk_t *chunk = ecs_vector_get(
+        job->chunks, ecs_par_chunk_t, index);
+    it->table = chunk->table;
+    it->table_columns = chunk->table_columns;
+    it->entities = chunk->entities;
+    it->offset = chunk->offset;
+    it->count = chunk->count;
+    it->total_count = chunk->count;
+    it->frame_offset = chunk->frame_offset;
+    job->action(it);
+}
+
+/* Process chunks of parallel query job until no chunks are left. When the job
+ * is shared with worker threads, chunks are claimed with an atomic increment */
+static
+void par_job_run(
+    ecs_world_t *world,
+    ecs_par_job_t *job,
+    bool shared)
+{
+    ecs_iter_t it = job->it;
+    it.world = world;
+
+    ecs_defer_begin(world);
+
+    int32_t i, count = ecs_vector_count(job->chunks);
+    if (shared) {
+        while ((i = ecs_os_ainc(&job->next_chunk) - 1) < count) {
+            par_chunk_run(job, &it, i);
+        }
+    } else {
+        for (i = 0; i < count; i ++) {
+            par_chunk_run(job, &it, i);
+        }
+    }
+
+    ecs_defer_end(world);
+}
+
+/* Split query results into chunks of at most chunk_size entities */
+static
+void par_job_init(
+    ecs_par_job_t *job,
+    ecs_query_t *query,
+    int32_t chunk_size)
+{
+    ecs_iter_t it = ecs_query_iter(query);
+
+    while (ecs_query_next(&it)) {
+        int32_t offset = 0;
+        do {
+            int32_t count = it.count - offset;
+            if (count > chunk_size) {
+                count = chunk_size;
+            }
+
+            ecs_par_chunk_t *chunk = ecs_vector_add(
+                &job->chunks, ecs_par_chunk_t);
+            chunk->table = it.table;
+            chunk->table_columns = it.table_columns;
+            chunk->entities = it.entities ? &it.entities[offset] : NULL;
+            chunk->offset = it.offset + offset;
+            chunk->count = count;
+            chunk->frame_offset = it.frame_offset + offset;
+
+            offset += count;
+        } while (offset < it.count);
+    }
+
+    job->it = it;
+}
+
+/* Synchronize worker threads */
+static
+void sync_worker(
+    ecs_world_t *world)
+{
+    int32_t thread_count = ecs_vector_count(world->workers);
+
+    /* Signal that thread is waiting */
+    ecs_os_mutex_lock(world->sync_mutex);
+    if (++ world->workers_waiting == thread_count) {
+        /* Only signal main thread when all threads are waiting */
+        ecs_os_cond_signal(world->sync_cond);
+    }
+
+    /* Wait until main thread signals that thread can continue */
+    ecs_os_cond_wait(world->worker_cond, world->sync_mutex);
+    ecs_os_mutex_unlock(world->sync_mutex);
+}
+
+/* Worker thread */
+static
+void* worker(void *arg) {
+    ecs_thread_t *thread = arg;
+    ecs_world_t *world = thread->world;
+
+    /* Record allocations of the thread in its stage until it is merged */
+    ecs_os_set_thread_alloc_tags(thread->stage->alloc_tags);
+
+    /* Start worker thread, increase counter so main thread knows how many
+     * workers are ready */
+    ecs_os_mutex_lock(world->sync_mutex);
+    world->workers_running ++;
+
+    if (!world->quit_workers) {
+        ecs_os_cond_wait(world->worker_cond, world->sync_mutex);
+    }
+
+    ecs_os_mutex_unlock(world->sync_mutex);
+
+    while (!world->quit_workers) {
+        /* If the workers were woken up for a parallel query job, process
+         * chunks until the job is done and wait for the next signal */
+        ecs_par_job_t *job = world->par_job;
+        if (job) {
+            par_job_run((ecs_world_t*)thread, job, true);
+            sync_worker(world);
+            continue;
+        }
+
+        ecs_entity_t old_scope = ecs_set_scope((ecs_world_t*)thread, 0);
+        ecs_pipeline_progress(
+            (ecs_world_t*)thread, 
+            world->pipeline, 
+            world->stats.delta_time);
+        ecs_set_scope((ecs_world_t*)thread, old_scope);
+    }
+
+    ecs_os_mutex_lock(world->sync_mutex);
+    world->workers_running --;
+    ecs_os_mutex_unlock(world->sync_mutex);
+
+    return NULL;
+}
+
+/* Start threads */
+static
+void start_workers(
+    ecs_world_t *world,
+    int32_t threads)
+{
+    ecs_assert(world->workers == NULL, ECS_INTERNAL_ERROR, NULL);
+
+    world->workers = ecs_vector_new(ecs_thread_t, threads);
+    world->worker_stages = ecs_vector_new(ecs_stage_t, threads);
+
+    int32_t i;
+    for (i = 0; i < threads; i ++) {
+        ecs_thread_t *thread =
+            ecs_vector_add(&world->workers, ecs_thread_t);
+
+        thread->magic = ECS_THREAD_MAGIC;
+        thread->world = world;
+        thread->thread = 0;
+        thread->index = i;
+
+        thread->stage = ecs_vector_add(&world->worker_stages, ecs_stage_t);
+        ecs_stage_init(world, thread->stage);
+        thread->stage->id = 2 + i; /* 0 and 1 are reserved for main and temp */
+        thread->stage->world = (ecs_world_t*)thread;
+
+        thread->thread = ecs_os_thread_new(worker, thread);
+        ecs_assert(thread->thread != 0, ECS_THREAD_ERROR, NULL);
+    }
+}
+
+/* Wait until all workers are running */
+static
+void wait_for_workers(
+    ecs_world_t *world)
+{
+    int32_t thread_count = ecs_vector_count(world->workers);
+    bool wait = true;
+
+    do {
+        ecs_os_mutex_lock(world->sync_mutex);
+        if (world->workers_running == thread_count) {
+            wait = false;
+        }
+        ecs_os_mutex_unlock(world->sync_mutex);
+    } while (wait);
+}
+
+/* Wait until all threads are waiting on sync point */
+static
+void wait_for_sync(
+    ecs_world_t *world)
+{
+    int32_t thread_count = ecs_vector_count(world->workers);
+
+    ecs_os_mutex_lock(world->sync_mutex);
+    if (world->workers_waiting != thread_count) {
+        ecs_os_cond_wait(world->sync_cond, world->sync_mutex);
+    }
+    
+    /* We should have been signalled unless all workers are waiting on sync */
+    ecs_assert(world->workers_waiting == thread_count, 
+        ECS_INTERNAL_ERROR, NULL);
+
+    ecs_os_mutex_unlock(world->sync_mutex);
+}
+
+/* Signal workers that they can start/resume work */
+static
+void signal_workers(
+    ecs_world_t *world)
+{
+    ecs_os_mutex_lock(world->sync_mutex);
+    ecs_os_cond_broadcast(world->worker_cond);
+    ecs_os_mutex_unlock(world->sync_mutex);
+}
+
+/** Stop worker threads */
+static
+void ecs_stop_threads(
+    ecs_world_t *world)
+{
+    world->quit_workers = true;
+    signal_workers(world);
+
+    ecs_vector_each(world->workers, ecs_thread_t, thr, {
+        ecs_os_thread_join(thr->thread);
+        ecs_stage_deinit(world, thr->stage);
+    });
+
+    ecs_vector_free(world->workers);
+    ecs_vector_free(world->worker_stages);
+    world->worker_stages = NULL;
+    world->workers = NULL;
+    world->quit_workers = false;
+    
+    ecs_assert(world->workers_running == 0, ECS_INTERNAL_ERROR, NULL);
+}
+
+/* -- Private functions -- */
+
+void ecs_worker_begin(
+    ecs_world_t *world)
+{
+    if (world->magic == ECS_WORLD_MAGIC) {
+        ecs_staging_begin(world);
+    }
+}
+
+bool ecs_worker_sync(
+    ecs_world_t *world)
+{
+    int32_t build_count = world->stats.pipeline_build_count_total;
+
+    int32_t thread_count = ecs_vector_count(world->workers);
+    if (!thread_count) {
+        ecs_staging_end(world);
+
+        ecs_pipeline_update(world, world->pipeline);
+
+        ecs_staging_begin(world);
+    } else {
+        sync_worker(world);
+    }
+
+    return world->stats.pipeline_build_count_total != build_count;
+}
+
+void ecs_worker_end(
+    ecs_world_t *world)
+{
+    int32_t thread_count = ecs_vector_count(world->workers);
+    if (!thread_count) {
+        ecs_staging_end(world);
+    } else {
+        sync_worker(world);
+    }
+}
+
+void ecs_workers_progress(
+    ecs_world_t *world)
+{
+    ecs_entity_t pipeline = world->pipeline;
+    int32_t thread_count = ecs_vector_count(world->workers);
+
+    ecs_time_t start = {0};
+    if (world->measure_frame_time) {
+        ecs_time_measure(&start);
+    }
+
+    world->stats.systems_ran_frame = 0;
+
+    if (thread_count <= 1) {
+        ecs_pipeline_begin(world, pipeline);
+        ecs_entity_t old_scope = ecs_set_scope(world, 0);
+        ecs_pipeline_progress(world, pipeline, world->stats.delta_time);
+        ecs_set_scope(world, old_scope);
+        ecs_pipeline_end(world);
+    } else {
+        int32_t i, sync_count = ecs_pipeline_begin(world, pipeline);
+
+        /* Make sure workers are running and ready */
+        wait_for_workers(world);
+
+        /* Synchronize n times for each op in the pipeline */
+        for (i = 0; i < sync_count; i ++) {
+            ecs_staging_begin(world);
+
+            /* Signal workers that they should start running systems */
+            world->workers_waiting = 0;
+            signal_workers(world);
+
+            /* Wait until all workers are waiting on sync point */
+            uint64_t span = ecs_span_begin(world);
+            wait_for_sync(world);
+            ecs_span_end(world, &world->stage, EcsSpanSync, 0, span);
+
+            /* Merge */
+            ecs_staging_end(world);
+
+            int32_t update_count;
+            if ((update_count = ecs_pipeline_update(world, pipeline))) {
+                /* The number of operations in the pipeline could have changed
+                 * as result of the merge */
+                sync_count = update_count;
+            }
+        }
+
+        ecs_pipeline_end(world);
+    }
+
+    if (world->measure_frame_time) {
+        world->stats.system_time_total += (float)ecs_time_measure(&start);
+    }    
+}
+
+
+/* -- Public functions -- */
+
+void ecs_query_par_iter(
+    ecs_query_t *query,
+    ecs_iter_action_t action,
+    int32_t chunk_size,
+    void *param)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(action != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(chunk_size > 0, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_world_t *world = query->world;
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+
+    ecs_par_job_t job = { .action = action };
+    par_job_init(&job, query, chunk_size);
+    job.it.param = param;
+
+    /* Operations that modify the world are deferred while the job runs, and
+     * merged once all chunks have been processed */
+    ecs_staging_begin(world);
+
+    int32_t thread_count = ecs_vector_count(world->workers);
+    if (thread_count > 1) {
+        wait_for_workers(world);
+
+        world->par_job = &job;
+        world->workers_waiting = 0;
+        signal_workers(world);
+
+        /* The main thread processes chunks together with the workers */
+        par_job_run(world, &job, true);
+
+        wait_for_sync(world);
+        world->par_job = NULL;
+    } else {
+        par_job_run(world, &job, false);
+    }
+
+    ecs_staging_end(world);
+
+    ecs_vector_free(job.chunks);
+}
+
+void ecs_set_threads(
+    ecs_world_t *world,
+    int32_t threads)
+{
+    ecs_assert(ecs_os_has_threading(), ECS_MISSING_OS_API, NULL);
+
+    int32_t thread_count = ecs_vector_count(world->workers);
+
+    if (!world->arg_threads && thread_count != threads) {
+        /* Stop existing threads */
+        if (ecs_vector_count(world->workers)) {
+            ecs_stop_threads(world);
+            ecs_os_cond_free(world->worker_cond);
+            ecs_os_cond_free(world->sync_cond);
+            ecs_os_mutex_free(world->sync_mutex);
+        }
+
+        /* Start threads if number of threads > 1 */
+        if (threads > 1) {
+            world->worker_cond = ecs_os_cond_new();
+            world->sync_cond = ecs_os_cond_new();
+            world->sync_mutex = ecs_os_mutex_new();
+            world->stage_count = 2 + threads;
+#ifdef FLECS_PROFILER
+            /* Make sure there is a ring buffer for each worker before the
+             * workers start recording spans */
+            ecs_profiler_set_threads(world, threads);
 #endif
+            start_workers(world, threads);
+        }
 
-/* prevent 64-bit overflow when computing relative timestamp
-    see https://gist.github.com/jspohr/3dc4f00033d79ec5bdaf67bc46c813e3
-*/
-#if defined(_WIN32) || (defined(__APPLE__) && defined(__MACH__))
-int64_t int64_muldiv(int64_t value, int64_t numer, int64_t denom) {
-    int64_t q = value / denom;
-    int64_t r = value % denom;
-    return q * numer + r * numer / denom;
+        /* Iterate tables, make sure the ecs_data_t arrays are large enough */
+        ecs_sparse_each(world->store.tables, ecs_table_t, table, {
+            ecs_table_get_data(table);
+        });
+    }
 }
+
 #endif
 
-void ecs_os_time_setup(void) {
-    if ( ecs_os_time_initialized) {
-        return;
+#ifdef FLECS_PIPELINE
+
+
+ECS_TYPE_DECL(EcsPipelineQuery);
+
+typedef struct EcsPipelineQuery {
+    ecs_query_t *query;
+    ecs_query_t *build_query;
+    int32_t match_count;
+    ecs_vector_t *program;
+    int32_t sync_count;
+} EcsPipelineQuery;
+
+ECS_CTOR(EcsPipelineQuery, ptr, {
+    memset(ptr, 0, _size);
+})
+
+ECS_DTOR(EcsPipelineQuery, ptr, {
+    ecs_vector_free(ptr->program);
+})
+
+static
+int compare_entity(
+    ecs_entity_t e1, 
+    void *ptr1, 
+    ecs_entity_t e2, 
+    void *ptr2) 
+{
+    (void)ptr1;
+    (void)ptr2;
+    return (e1 > e2) - (e1 < e2);
+}
+
+static
+int rank_phase(
+    ecs_world_t *world,
+    ecs_entity_t rank_component,
+    ecs_type_t type) 
+{
+    const EcsType *pipeline_type = ecs_get(world, rank_component, EcsType);
+    ecs_assert(pipeline_type != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* Find tag in system that belongs to pipeline */
+    ecs_entity_t *sys_comps = ecs_vector_first(type, ecs_entity_t);
+    int32_t c, t, count = ecs_vector_count(type);
+
+    ecs_entity_t *tags = ecs_vector_first(pipeline_type->normalized, ecs_entity_t);
+    int32_t tag_count = ecs_vector_count(pipeline_type->normalized);
+
+    ecs_entity_t result = 0;
+
+    for (c = 0; c < count; c ++) {
+        ecs_entity_t comp = sys_comps[c];
+        for (t = 0; t < tag_count; t ++) {
+            if (comp == tags[t]) {
+                result = comp;
+                break;
+            }
+        }
+        if (result) {
+            break;
+        }
     }
-    
-    ecs_os_time_initialized = 1;
-    #if defined(_WIN32)
-        LARGE_INTEGER freq;
-        QueryPerformanceFrequency(&freq);
-        QueryPerformanceCounter(&_ecs_os_time_win_start);
-        _ecs_os_time_win_freq = (double)freq.QuadPart / 1000000000.0;
-    #elif defined(__APPLE__) && defined(__MACH__)
-        mach_timebase_info(&_ecs_os_time_osx_timebase);
-        _ecs_os_time_osx_start = mach_absolute_time();
-    #else
-        struct timespec ts;
-        clock_gettime(CLOCK_MONOTONIC, &ts);
-        _ecs_os_time_posix_start = (uint64_t)ts.tv_sec*1000000000 + (uint64_t)ts.tv_nsec; 
-    #endif
+
+    ecs_assert(result != 0, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(result < INT_MAX, ECS_INTERNAL_ERROR, NULL);
+
+    return (int)result;
 }
 
-uint64_t ecs_os_time_now(void) {
-    ecs_assert(ecs_os_time_initialized != 0, ECS_INTERNAL_ERROR, NULL);
+typedef enum ComponentWriteState {
+    NotWritten = 0,
+    WriteToMain,
+    WriteToStage
+} ComponentWriteState;
 
-    uint64_t now;
+typedef struct write_state_t {
+    ecs_map_t *components;
+    bool wildcard;
+} write_state_t;
 
-    #if defined(_WIN32)
-        LARGE_INTEGER qpc_t;
-        QueryPerformanceCounter(&qpc_t);
-        now = (uint64_t)(qpc_t.QuadPart / _ecs_os_time_win_freq);
-    #elif defined(__APPLE__) && defined(__MACH__)
-        now = mach_absolute_time();
-    #else
-        struct timespec ts;
-        clock_gettime(CLOCK_MONOTONIC, &ts);
-        now = ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
-    #endif
+static
+int32_t get_write_state(
+    ecs_map_t *write_state,
+    ecs_entity_t component)
+{
+    int32_t *ptr = ecs_map_get(write_state, int32_t, component);
+    if (ptr) {
+        return *ptr;
+    } else {
+        return 0;
+    }
+}
+
+static
+void set_write_state(
+    write_state_t *write_state,
+    ecs_entity_t component,
+    int32_t value)
+{
+    if (component == EcsWildcard) {
+        ecs_assert(value == WriteToStage, ECS_INTERNAL_ERROR, NULL);
+        write_state->wildcard = true;
+    } else {
+        ecs_map_set(write_state->components, component, &value);
+    }
+}
+
+static
+void reset_write_state(
+    write_state_t *write_state)
+{
+    ecs_map_clear(write_state->components);
+    write_state->wildcard = false;
+}
+
+static
+bool check_column_component(
+    ecs_sig_column_t *column,
+    bool is_active,
+    ecs_entity_t component,
+    write_state_t *write_state)    
+{
+    int32_t state = get_write_state(write_state->components, component);
+
+    /* Values of the previous frame are not modified while the frame is running,
+     * so reading them never requires a merge */
+    if (column->inout_kind == EcsInPrev) {
+        return false;
+    }
+
+    if ((column->from_kind == EcsFromAny || column->from_kind == EcsFromOwned) 
+      && column->oper_kind != EcsOperNot) 
+    {
+        switch(column->inout_kind) {
+        case EcsInOut:
+        case EcsIn:
+            if (state == WriteToStage) {
+                return true;
+            } else if (write_state->wildcard) {
+                return true;
+            }
+            // fall through
+        case EcsOut:
+            if (is_active && column->inout_kind != EcsIn) {
+                set_write_state(write_state, component, WriteToMain);
+            }
+            break;
+        default:
+            break;
+        };
+    } else if (column->from_kind == EcsFromEmpty || 
+               column->oper_kind == EcsOperNot) 
+    {
+        switch(column->inout_kind) {
+        case EcsInOut:
+        case EcsOut:
+            if (is_active) {
+                set_write_state(write_state, component, WriteToStage);
+            }
+            break;
+        default:
+            break;
+        };
+    }
 
-    return now;
+    return false;
 }
 
-void ecs_os_time_sleep(
-    int32_t sec, 
-    int32_t nanosec) 
+static
+bool check_column(
+    ecs_sig_column_t *column,
+    bool is_active,
+    write_state_t *write_state)
 {
-#ifndef _WIN32
-    struct timespec sleepTime;
-    ecs_assert(sec >= 0, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(nanosec >= 0, ECS_INTERNAL_ERROR, NULL);
-
-    sleepTime.tv_sec = sec;
-    sleepTime.tv_nsec = nanosec;
-    if (nanosleep(&sleepTime, NULL)) {
-        ecs_os_err("nanosleep failed");
-    }
-#else
-    HANDLE timer;
-    LARGE_INTEGER ft;
-
-    ft.QuadPart = -((int64_t)sec * 10000000 + (int64_t)nanosec / 100);
+    if (column->oper_kind != EcsOperOr) {
+        return check_column_component(
+            column, is_active, column->is.component, write_state);
+    }  
 
-    timer = CreateWaitableTimer(NULL, TRUE, NULL);
-    SetWaitableTimer(timer, &ft, 0, NULL, NULL, 0);
-    WaitForSingleObject(timer, INFINITE);
-    CloseHandle(timer);
-#endif
+    return false;
 }
 
-
-#if defined(_WIN32)
-
-static ULONG win32_current_resolution;
-
-void ecs_increase_timer_resolution(bool enable)
+static
+bool build_pipeline(
+    ecs_world_t *world,
+    ecs_entity_t pipeline,
+    EcsPipelineQuery *pq)
 {
-    HMODULE hntdll = GetModuleHandle((LPCTSTR)"ntdll.dll");
-    if (!hntdll) {
-        return;
-    }
-
-    LONG (__stdcall *pNtSetTimerResolution)(
-        ULONG desired, BOOLEAN set, ULONG * current);
-
-    pNtSetTimerResolution = (LONG(__stdcall*)(ULONG, BOOLEAN, ULONG*))
-        GetProcAddress(hntdll, "NtSetTimerResolution");
-
-    if(!pNtSetTimerResolution) {
-        return;
-    }
+    (void)pipeline;
 
-    ULONG current, resolution = 10000; /* 1 ms */
+    ecs_query_iter(pq->query);
 
-    if (!enable && win32_current_resolution) {
-        pNtSetTimerResolution(win32_current_resolution, 0, &current);
-        win32_current_resolution = 0;
-        return;
-    } else if (!enable) {
-        return;
+    if (pq->match_count == pq->query->match_count) {
+        /* No need to rebuild the pipeline */
+        return false;
     }
 
-    if (resolution == win32_current_resolution) {
-        return;
-    }
+    ecs_trace_2("rebuilding pipeline #[green]%s", 
+        ecs_get_name(world, pipeline));
 
-    if (win32_current_resolution) {
-        pNtSetTimerResolution(win32_current_resolution, 0, &current);
-    }
+    world->stats.pipeline_build_count_total ++;
 
-    if (pNtSetTimerResolution(resolution, 1, &current)) {
-        /* Try setting a lower resolution */
-        resolution *= 2;
-        if(pNtSetTimerResolution(resolution, 1, &current)) return;
-    }
+    uint64_t span = ecs_span_begin(world);
 
-    win32_current_resolution = resolution;
-}
+    write_state_t ws = {
+        .components = ecs_map_new(int32_t, ECS_HI_COMPONENT_ID),
+        .wildcard = false
+    };
 
-#else
-void ecs_increase_timer_resolution(bool enable)
-{
-    (void)enable;
-    return;
-}
-#endif
+    ecs_vector_t *program = NULL;
+    int32_t sync_count = 0;
+    bool system_since_merge = false;
+    ecs_query_t *query = pq->build_query;
 
-#ifdef FLECS_PIPELINE
+    if (pq->program) {
+        ecs_vector_free(pq->program);
+    }
 
-#ifndef FLECS_PIPELINE_PRIVATE_H
-#define FLECS_PIPELINE_PRIVATE_H
+    /* Iterate systems in pipeline, add ops for running / merging */
+    ecs_iter_t it = ecs_query_iter(query);
+    while (ecs_query_next(&it)) {
+        EcsSystem *sys = ecs_column(&it, EcsSystem, 1);        
 
+        int i;
+        for (i = 0; i < it.count; i ++) {            
+            ecs_query_t *q = sys[i].query;
+            if (!q) {
+                continue;
+            }
 
-/** Instruction data for pipeline.
- * This type is the element type in the "ops" vector of a pipeline and contains
- * information about the set of systems that need to be ran before a merge. */
-typedef struct ecs_pipeline_op_t {
-    int32_t count;              /**< Number of systems to run before merge */
-} ecs_pipeline_op_t;
+            bool needs_merge = false;
+            bool is_active = !ecs_has_entity(
+                world, it.entities[i], EcsInactive);
 
-////////////////////////////////////////////////////////////////////////////////
-//// Pipeline API
-////////////////////////////////////////////////////////////////////////////////
+            ecs_vector_each(q->sig.columns, ecs_sig_column_t, column, {
+                needs_merge |= check_column(column, is_active, &ws);
+            });
 
-int32_t ecs_pipeline_update(
-    ecs_world_t *world,
-    ecs_entity_t pipeline);
+            if (needs_merge) {
+                /* After merge all components will be merged, so reset state */
+                reset_write_state(&ws);
 
-int32_t ecs_pipeline_begin(
-    ecs_world_t *world,
-    ecs_entity_t pipeline);
+                /* Also insert sync points after inactive systems, as they may
+                 * become active after a merge earlier in the same frame */
+                if (system_since_merge) {
+                    ecs_pipeline_op_t *op = ecs_vector_add(
+                        &program, ecs_pipeline_op_t);
+                    op->system = 0;
+                    op->system_data = NULL;
+                    sync_count ++;
+                    system_since_merge = false;
+                }
 
-void ecs_pipeline_end(
-    ecs_world_t *world);
+                /* Re-evaluate columns to set write flags if system is active.
+                 * If system is inactive, it can't write anything and so it
+                 * should not insert unnecessary merges.  */
+                needs_merge = false;
+                if (is_active) {
+                    ecs_vector_each(q->sig.columns, ecs_sig_column_t, column, {
+                        needs_merge |= check_column(column, true, &ws);
+                    });
+                }
 
-void ecs_pipeline_progress(
-    ecs_world_t *world,
-    ecs_entity_t pipeline,
-    float delta_time);
+                /* The component states were just reset, so if we conclude that
+                 * another merge is needed something is wrong. */
+                ecs_assert(needs_merge == false, ECS_INTERNAL_ERROR, NULL);        
+            }
 
+            /* Inactive systems are not added to the program, so that threads
+             * don't have to test for them while running the pipeline. */
+            if (is_active) {
+                ecs_pipeline_op_t *op = ecs_vector_add(
+                    &program, ecs_pipeline_op_t);
+                op->system = it.entities[i];
+                op->system_data = &sys[i];
+            }
 
-////////////////////////////////////////////////////////////////////////////////
-//// Worker API
-////////////////////////////////////////////////////////////////////////////////
+            system_since_merge = true;
+        }
+    }
 
-void ecs_worker_begin(
-    ecs_world_t *world);
+    ecs_map_free(ws.components);
 
-bool ecs_worker_sync(
-    ecs_world_t *world);
+    /* Every thread synchronizes once more after the last system */
+    if (system_since_merge) {
+        sync_count ++;
+    }
 
-void ecs_worker_end(
-    ecs_world_t *world);
+    /* Force sort of query as this could increase the match_count */
+    pq->match_count = pq->query->match_count;
+    pq->program = program;
+    pq->sync_count = sync_count;
 
-void ecs_workers_progress(
-    ecs_world_t *world);
+    ecs_span_end(world, &world->stage, EcsSpanPipelineBuild, pipeline, span);
 
-#endif
+    return true;
+}
 
-/* Worker thread */
+/* Find the position in a (rebuilt) program after a sync point. If a system ran
+ * before the sync point, the position is the sync point after that system. If
+ * no system ran yet, the position is the sync point with the provided index. */
 static
-void* worker(void *arg) {
-    ecs_thread_t *thread = arg;
-    ecs_world_t *world = thread->world;
-
-    /* Start worker thread, increase counter so main thread knows how many
-     * workers are ready */
-    ecs_os_mutex_lock(world->sync_mutex);
-    world->workers_running ++;
+int32_t program_find(
+    const EcsPipelineQuery *pq,
+    ecs_entity_t system,
+    int32_t sync_index)
+{
+    ecs_pipeline_op_t *ops = ecs_vector_first(pq->program, ecs_pipeline_op_t);
+    int32_t i, count = ecs_vector_count(pq->program);
 
-    if (!world->quit_workers) {
-        ecs_os_cond_wait(world->worker_cond, world->sync_mutex);
+    for (i = 0; i < count; i ++) {
+        if (system) {
+            if (ops[i].system == system) {
+                if (i + 1 < count && !ops[i + 1].system) {
+                    i ++;
+                }
+                return i;
+            }
+        } else if (!ops[i].system) {
+            if (!sync_index) {
+                return i;
+            }
+            sync_index --;
+        }
     }
 
-    ecs_os_mutex_unlock(world->sync_mutex);
-
-    while (!world->quit_workers) {
-        ecs_entity_t old_scope = ecs_set_scope((ecs_world_t*)thread, 0);
-        ecs_pipeline_progress(
-            (ecs_world_t*)thread, 
-            world->pipeline, 
-            world->stats.delta_time);
-        ecs_set_scope((ecs_world_t*)thread, old_scope);
+    /* The rebuilt program has fewer sync points, continue at the end */
+    if (!system) {
+        return count;
     }
 
-    ecs_os_mutex_lock(world->sync_mutex);
-    world->workers_running --;
-    ecs_os_mutex_unlock(world->sync_mutex);
+    ecs_abort(ECS_UNSUPPORTED, NULL);
 
-    return NULL;
+    return -1;
 }
 
-/* Start threads */
-static
-void start_workers(
+int32_t ecs_pipeline_update(
     ecs_world_t *world,
-    int32_t threads)
+    ecs_entity_t pipeline)
 {
-    ecs_assert(world->workers == NULL, ECS_INTERNAL_ERROR, NULL);
+    EcsPipelineQuery *pq = ecs_get_mut(world, pipeline, EcsPipelineQuery, NULL);
+    ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(pq->query != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    world->workers = ecs_vector_new(ecs_thread_t, threads);
-    world->worker_stages = ecs_vector_new(ecs_stage_t, threads);
+    if (build_pipeline(world, pipeline, pq)) {
+        return pq->sync_count;
+    } else {
+        return 0;
+    }
+}
 
-    int32_t i;
-    for (i = 0; i < threads; i ++) {
-        ecs_thread_t *thread =
-            ecs_vector_add(&world->workers, ecs_thread_t);
+int32_t ecs_pipeline_begin(
+    ecs_world_t *world,
+    ecs_entity_t pipeline)
+{
+    ecs_assert(!world->in_progress, ECS_INTERNAL_ERROR, NULL);
 
-        thread->magic = ECS_THREAD_MAGIC;
-        thread->world = world;
-        thread->thread = 0;
-        thread->index = i;
+    ecs_eval_component_monitors(world);
+
+    EcsPipelineQuery *pq = ecs_get_mut(
+        world, pipeline, EcsPipelineQuery, NULL);
+    ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(pq->query != NULL, ECS_INTERNAL_ERROR, NULL);
 
-        thread->stage = ecs_vector_add(&world->worker_stages, ecs_stage_t);
-        ecs_stage_init(world, thread->stage);
-        thread->stage->id = 2 + i; /* 0 and 1 are reserved for main and temp */
-        thread->stage->world = (ecs_world_t*)thread;
+    build_pipeline(world, pipeline, pq);
 
-        thread->thread = ecs_os_thread_new(worker, thread);
-        ecs_assert(thread->thread != 0, ECS_THREAD_ERROR, NULL);
-    }
+    return pq->sync_count;
 }
 
-/* Wait until all workers are running */
-static
-void wait_for_workers(
+void ecs_pipeline_end(
     ecs_world_t *world)
 {
-    int32_t thread_count = ecs_vector_count(world->workers);
-    bool wait = true;
-
-    do {
-        ecs_os_mutex_lock(world->sync_mutex);
-        if (world->workers_running == thread_count) {
-            wait = false;
-        }
-        ecs_os_mutex_unlock(world->sync_mutex);
-    } while (wait);
+    (void)world;
 }
 
-/* Synchronize worker threads */
-static
-void sync_worker(
-    ecs_world_t *world)
+void ecs_pipeline_progress(
+    ecs_world_t *world,
+    ecs_entity_t pipeline,
+    float delta_time)
 {
-    int32_t thread_count = ecs_vector_count(world->workers);
+    const EcsPipelineQuery *pq = ecs_get(world, pipeline, EcsPipelineQuery);
+    ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(pq->query != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    /* Signal that thread is waiting */
-    ecs_os_mutex_lock(world->sync_mutex);
-    if (++ world->workers_waiting == thread_count) {
-        /* Only signal main thread when all threads are waiting */
-        ecs_os_cond_signal(world->sync_cond);
-    }
+    ecs_worker_begin(world);
+    ecs_stage_t *stage = ecs_get_stage(&world);
 
-    /* Wait until main thread signals that thread can continue */
-    ecs_os_cond_wait(world->worker_cond, world->sync_mutex);
-    ecs_os_mutex_unlock(world->sync_mutex);
-}
+    ecs_pipeline_op_t *ops = ecs_vector_first(pq->program, ecs_pipeline_op_t);
+    int32_t i, count = ecs_vector_count(pq->program);
+    ecs_entity_t last_system = 0;
+    int32_t sync_index = 0;
 
-/* Wait until all threads are waiting on sync point */
-static
-void wait_for_sync(
-    ecs_world_t *world)
-{
-    int32_t thread_count = ecs_vector_count(world->workers);
+    for (i = 0; i < count; i ++) {
+        ecs_pipeline_op_t *op = &ops[i];
+        ecs_entity_t system = op->system;
 
-    ecs_os_mutex_lock(world->sync_mutex);
-    if (world->workers_waiting != thread_count) {
-        ecs_os_cond_wait(world->sync_cond, world->sync_mutex);
+        if (system) {
+            ecs_run_intern(world, stage, system, op->system_data, delta_time, 
+                0, 0, NULL, NULL, false);
+
+            world->stats.systems_ran_frame ++;
+            last_system = system;
+        } else {
+            /* If the set of matched systems changed as a result of the merge,
+             * the program has been rebuilt, and we have to move to our current
+             * position in the new program. This should happen infrequently. */
+            if (ecs_worker_sync(world)) {
+                ops = ecs_vector_first(pq->program, ecs_pipeline_op_t);
+                count = ecs_vector_count(pq->program);
+                i = program_find(pq, last_system, sync_index);
+            }
+            sync_index ++;
+        }
     }
-    
-    /* We should have been signalled unless all workers are waiting on sync */
-    ecs_assert(world->workers_waiting == thread_count, 
-        ECS_INTERNAL_ERROR, NULL);
 
-    ecs_os_mutex_unlock(world->sync_mutex);
+    ecs_worker_end(world);
 }
 
-/* Signal workers that they can start/resume work */
 static
-void signal_workers(
-    ecs_world_t *world)
+void add_pipeline_tags_to_sig(
+    ecs_world_t *world,
+    ecs_sig_t *sig,
+    ecs_type_t type)
 {
-    ecs_os_mutex_lock(world->sync_mutex);
-    ecs_os_cond_broadcast(world->worker_cond);
-    ecs_os_mutex_unlock(world->sync_mutex);
+    (void)world;
+    
+    int32_t i, count = ecs_vector_count(type);
+    ecs_entity_t *entities = ecs_vector_first(type, ecs_entity_t);
+
+    for (i = 0; i < count; i ++) {
+        if (!i) {
+            ecs_sig_add(world, sig, EcsFromAny, EcsOperAnd, EcsIn, entities[i], 
+                0, NULL);
+        } else {
+            ecs_sig_add(world, sig, EcsFromAny, EcsOperOr, EcsIn, entities[i], 
+                0, NULL);
+        }
+    }
 }
 
-/** Stop worker threads */
-static
-void ecs_stop_threads(
-    ecs_world_t *world)
+static 
+void EcsOnAddPipeline(
+    ecs_iter_t *it)
 {
-    world->quit_workers = true;
-    signal_workers(world);
+    ecs_world_t *world = it->world;
+    ecs_entity_t *entities = it->entities;
 
-    ecs_vector_each(world->workers, ecs_thread_t, thr, {
-        ecs_os_thread_join(thr->thread);
-        ecs_stage_deinit(world, thr->stage);
-    });
+    int32_t i;
+    for (i = it->count - 1; i >= 0; i --) {
+        ecs_entity_t pipeline = entities[i];
+        ecs_sig_t sig = { 0 };
 
-    ecs_vector_free(world->workers);
-    ecs_vector_free(world->worker_stages);
-    world->worker_stages = NULL;
-    world->workers = NULL;
-    world->quit_workers = false;
-    
-    ecs_assert(world->workers_running == 0, ECS_INTERNAL_ERROR, NULL);
-}
+        const EcsType *type_ptr = ecs_get(world, pipeline, EcsType);
+        ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+        
+#ifndef NDEBUG
+        char *str = ecs_type_str(world, type_ptr->normalized);
+        ecs_trace_1("pipeline #[green]%s#[normal] created with #[red][%s]",
+            ecs_get_name(world, pipeline), str);
+        ecs_os_free(str);
+#endif
+        ecs_log_push();
 
-/* -- Private functions -- */
+        /* Build signature for pipeline quey that matches EcsSystems, has the
+         * pipeline as a XOR column, and ignores systems with EcsInactive and
+         * EcsDisabledIntern. Note that EcsDisabled is automatically ignored by
+         * the regular query matching */
+        ecs_sig_add(world, &sig, EcsFromAny, EcsOperAnd, EcsIn, 
+            ecs_typeid(EcsSystem), 0, NULL);
+        ecs_sig_add(world, &sig, EcsFromAny, EcsOperNot, EcsIn, EcsInactive, 0, NULL);
+        ecs_sig_add(world, &sig, EcsFromAny, EcsOperNot, EcsIn, 
+            EcsDisabledIntern, 0, NULL);
+        add_pipeline_tags_to_sig(world, &sig, type_ptr->normalized);
 
-void ecs_worker_begin(
-    ecs_world_t *world)
-{
-    if (world->magic == ECS_WORLD_MAGIC) {
-        ecs_staging_begin(world);
+        /* Create the query. Sort the query by system id and phase */
+        ecs_query_t *query = ecs_query_new_w_sig(world, 0, &sig);
+        ecs_query_order_by(world, query, 0, compare_entity);
+        ecs_query_group_by(world, query, pipeline, rank_phase);
+
+        /* Build signature for pipeline build query. The build query includes
+         * systems that are inactive, as an inactive system may become active as
+         * a result of another system, and as a result the correct merge 
+         * operations need to be put in place. */
+        ecs_sig_add(world, &sig, EcsFromAny, EcsOperAnd, EcsIn, 
+            ecs_typeid(EcsSystem), 0, NULL);
+        ecs_sig_add(world, &sig, EcsFromAny, EcsOperNot, EcsIn, 
+            EcsDisabledIntern, 0, NULL);
+        add_pipeline_tags_to_sig(world, &sig, type_ptr->normalized);
+
+        /* Use the same sorting functions for the build query */
+        ecs_query_t *build_query = ecs_query_new_w_sig(world, 0, &sig);
+        ecs_query_order_by(world, build_query, 0, compare_entity);
+        ecs_query_group_by(world, build_query, pipeline, rank_phase);       
+
+        EcsPipelineQuery *pq = ecs_get_mut(
+            world, pipeline, EcsPipelineQuery, NULL);
+        ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        pq->query = query;
+        pq->build_query = build_query;
+        pq->match_count = -1;
+        pq->program = NULL;
+
+        ecs_log_pop();
     }
 }
 
-bool ecs_worker_sync(
-    ecs_world_t *world)
+/* -- Public API -- */
+
+bool ecs_progress(
+    ecs_world_t *world,
+    float user_delta_time)
 {
-    int32_t build_count = world->stats.pipeline_build_count_total;
+    ecs_frame_begin(world, user_delta_time);
 
-    int32_t thread_count = ecs_vector_count(world->workers);
-    if (!thread_count) {
-        ecs_staging_end(world);
+    ecs_workers_progress(world);
 
-        ecs_pipeline_update(world, world->pipeline);
+    ecs_frame_end(world);
 
-        ecs_staging_begin(world);
-    } else {
-        sync_worker(world);
-    }
+    return !world->should_quit;
+}
 
-    return world->stats.pipeline_build_count_total != build_count;
+void ecs_set_time_scale(
+    ecs_world_t *world,
+    float scale)
+{
+    world->stats.time_scale = scale;
 }
 
-void ecs_worker_end(
+void ecs_reset_clock(
     ecs_world_t *world)
 {
-    int32_t thread_count = ecs_vector_count(world->workers);
-    if (!thread_count) {
-        ecs_staging_end(world);
-    } else {
-        sync_worker(world);
-    }
+    world->stats.world_time_total = 0;
+    world->stats.world_time_total_raw = 0;
 }
 
-void ecs_workers_progress(
+void ecs_quit(
     ecs_world_t *world)
 {
-    ecs_entity_t pipeline = world->pipeline;
-    int32_t thread_count = ecs_vector_count(world->workers);
-
-    ecs_time_t start = {0};
-    if (world->measure_frame_time) {
-        ecs_time_measure(&start);
-    }
-
-    world->stats.systems_ran_frame = 0;
-
-    if (thread_count <= 1) {
-        ecs_pipeline_begin(world, pipeline);
-        ecs_entity_t old_scope = ecs_set_scope(world, 0);
-        ecs_pipeline_progress(world, pipeline, world->stats.delta_time);
-        ecs_set_scope(world, old_scope);
-        ecs_pipeline_end(world);
-    } else {
-        int32_t i, sync_count = ecs_pipeline_begin(world, pipeline);
-
-        /* Make sure workers are running and ready */
-        wait_for_workers(world);
+    ecs_get_stage(&world);
+    world->should_quit = true;
+}
 
-        /* Synchronize n times for each op in the pipeline */
-        for (i = 0; i < sync_count; i ++) {
-            ecs_staging_begin(world);
+void ecs_deactivate_systems(
+    ecs_world_t *world)
+{
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-            /* Signal workers that they should start running systems */
-            world->workers_waiting = 0;
-            signal_workers(world);
+    ecs_entity_t pipeline = world->pipeline;
+    const EcsPipelineQuery *pq = ecs_get( world, pipeline, EcsPipelineQuery);
+    ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
 
-            /* Wait until all workers are waiting on sync point */
-            wait_for_sync(world);
+    /* Iterate over all systems, add EcsInvalid tag if queries aren't matched
+     * with any tables */
+    ecs_iter_t it = ecs_query_iter(pq->build_query);
 
-            /* Merge */
-            ecs_staging_end(world);
+    /* Make sure that we defer adding the inactive tags until after iterating
+     * the query */
+    ecs_defer_none(world, &world->stage);
 
-            int32_t update_count;
-            if ((update_count = ecs_pipeline_update(world, pipeline))) {
-                /* The number of operations in the pipeline could have changed
-                 * as result of the merge */
-                sync_count = update_count;
+    while( ecs_query_next(&it)) {
+        EcsSystem *sys = ecs_column(&it, EcsSystem, 1);
+
+        int32_t i;
+        for (i = 0; i < it.count; i ++) {
+            ecs_query_t *query = sys[i].query;
+            if (query) {
+                if (!ecs_vector_count(query->tables)) {
+                    ecs_add_entity(world, it.entities[i], EcsInactive);
+                }
             }
         }
-
-        ecs_pipeline_end(world);
     }
 
-    if (world->measure_frame_time) {
-        world->stats.system_time_total += (float)ecs_time_measure(&start);
-    }    
+    ecs_defer_flush(world, &world->stage);
 }
 
-
-/* -- Public functions -- */
-
-void ecs_set_threads(
+void ecs_set_pipeline(
     ecs_world_t *world,
-    int32_t threads)
+    ecs_entity_t pipeline)
 {
-    ecs_assert(ecs_os_has_threading(), ECS_MISSING_OS_API, NULL);
-
-    int32_t thread_count = ecs_vector_count(world->workers);
-
-    if (!world->arg_threads && thread_count != threads) {
-        /* Stop existing threads */
-        if (ecs_vector_count(world->workers)) {
-            ecs_stop_threads(world);
-            ecs_os_cond_free(world->worker_cond);
-            ecs_os_cond_free(world->sync_cond);
-            ecs_os_mutex_free(world->sync_mutex);
-        }
-
-        /* Start threads if number of threads > 1 */
-        if (threads > 1) {
-            world->worker_cond = ecs_os_cond_new();
-            world->sync_cond = ecs_os_cond_new();
-            world->sync_mutex = ecs_os_mutex_new();
-            world->stage_count = 2 + threads;
-            start_workers(world, threads);
-        }
+    ecs_assert( ecs_get(world, pipeline, EcsPipelineQuery) != NULL, 
+        ECS_INVALID_PARAMETER, NULL);
 
-        /* Iterate tables, make sure the ecs_data_t arrays are large enough */
-        ecs_sparse_each(world->store.tables, ecs_table_t, table, {
-            ecs_table_get_data(table);
-        });
-    }
+    world->pipeline = pipeline;
 }
 
-#endif
-
-#ifdef FLECS_PIPELINE
+ecs_entity_t ecs_get_pipeline(
+    ecs_world_t *world)
+{
+    return world->pipeline;
+}
 
+ecs_entity_t ecs_new_pipeline(
+    ecs_world_t *world,
+    ecs_entity_t e,
+    const char *name,
+    const char *expr)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
 
-ECS_TYPE_DECL(EcsPipelineQuery);
+    ecs_entity_t result = ecs_new_type(world, e, name, expr);
+    ecs_assert(ecs_get(world, result, EcsType) != NULL, 
+        ECS_INTERNAL_ERROR, NULL);
 
-typedef struct EcsPipelineQuery {
-    ecs_query_t *query;
-    ecs_query_t *build_query;
-    int32_t match_count;
-    ecs_vector_t *ops;
-} EcsPipelineQuery;
+    ecs_add_entity(world, result, EcsPipeline);
 
-ECS_CTOR(EcsPipelineQuery, ptr, {
-    memset(ptr, 0, _size);
-})
+    return result;
+}
 
-ECS_DTOR(EcsPipelineQuery, ptr, {
-    ecs_vector_free(ptr->ops);
-})
+/* -- Module implementation -- */
 
 static
-int compare_entity(
-    ecs_entity_t e1, 
-    void *ptr1, 
-    ecs_entity_t e2, 
-    void *ptr2) 
+void FlecsPipelineFini(
+    ecs_world_t *world,
+    void *ctx)
 {
-    (void)ptr1;
-    (void)ptr2;
-    return (e1 > e2) - (e1 < e2);
+    (void)ctx;
+    if (world->workers) {
+        ecs_set_threads(world, 0);
+    }
 }
 
-static
-int rank_phase(
-    ecs_world_t *world,
-    ecs_entity_t rank_component,
-    ecs_type_t type) 
+void FlecsPipelineImport(
+    ecs_world_t *world)
 {
-    const EcsType *pipeline_type = ecs_get(world, rank_component, EcsType);
-    ecs_assert(pipeline_type != NULL, ECS_INTERNAL_ERROR, NULL);
+    ECS_MODULE(world, FlecsPipeline);
 
-    /* Find tag in system that belongs to pipeline */
-    ecs_entity_t *sys_comps = ecs_vector_first(type, ecs_entity_t);
-    int32_t c, t, count = ecs_vector_count(type);
+    ECS_IMPORT(world, FlecsSystem);
 
-    ecs_entity_t *tags = ecs_vector_first(pipeline_type->normalized, ecs_entity_t);
-    int32_t tag_count = ecs_vector_count(pipeline_type->normalized);
+    ecs_set_name_prefix(world, "Ecs");
 
-    ecs_entity_t result = 0;
+    ecs_bootstrap_tag(world, EcsPipeline);
+    ecs_bootstrap_component(world, EcsPipelineQuery);
 
-    for (c = 0; c < count; c ++) {
-        ecs_entity_t comp = sys_comps[c];
-        for (t = 0; t < tag_count; t ++) {
-            if (comp == tags[t]) {
-                result = comp;
-                break;
-            }
-        }
-        if (result) {
-            break;
-        }
-    }
+    /* Phases of the builtin pipeline are regular entities. Names are set so
+     * they can be resolved by type expressions. */
+    ecs_bootstrap_tag(world, EcsPreFrame);
+    ecs_bootstrap_tag(world, EcsOnLoad);
+    ecs_bootstrap_tag(world, EcsPostLoad);
+    ecs_bootstrap_tag(world, EcsPreUpdate);
+    ecs_bootstrap_tag(world, EcsOnUpdate);
+    ecs_bootstrap_tag(world, EcsOnValidate);
+    ecs_bootstrap_tag(world, EcsPostUpdate);
+    ecs_bootstrap_tag(world, EcsPreStore);
+    ecs_bootstrap_tag(world, EcsOnStore);
+    ecs_bootstrap_tag(world, EcsPostFrame);
 
-    ecs_assert(result != 0, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(result < INT_MAX, ECS_INTERNAL_ERROR, NULL);
+    ECS_TYPE_IMPL(EcsPipelineQuery);
 
-    return (int)result;
+    /* Set ctor and dtor for PipelineQuery */
+    ecs_set(world, ecs_typeid(EcsPipelineQuery), EcsComponentLifecycle, {
+        .ctor = ecs_ctor(EcsPipelineQuery),
+        .dtor = ecs_dtor(EcsPipelineQuery)
+    });
+
+    /* When the Pipeline tag is added a pipeline will be created */
+    ECS_TRIGGER(world, EcsOnAddPipeline, EcsOnAdd, Pipeline);
+
+    /* Create the builtin pipeline */
+    world->pipeline = ecs_new_pipeline(world, 0, "BuiltinPipeline",
+        "PreFrame, OnLoad, PostLoad, PreUpdate, OnUpdate,"
+        " OnValidate, PostUpdate, PreStore, OnStore, PostFrame");
+
+    /* Cleanup thread administration when world is destroyed */
+    ecs_atfini(world, FlecsPipelineFini, NULL);
 }
 
-typedef enum ComponentWriteState {
-    NotWritten = 0,
-    WriteToMain,
-    WriteToStage
-} ComponentWriteState;
+#endif
 
-typedef struct write_state_t {
-    ecs_map_t *components;
-    bool wildcard;
-} write_state_t;
+#ifdef FLECS_TIMER
+
+
+ecs_type_t ecs_type(EcsTimer);
+ecs_type_t ecs_type(EcsRateFilter);
+
+/* A hierarchical timing wheel has multiple levels of slots. Level 0 has one
+ * slot per step, and each next level has slots that span all slots of the level
+ * below it. When the slots of a level wrap around, the timers in the next slot
+ * of the level above are moved down. */
+#define ECS_TIMER_WHEEL_BITS (6)
+#define ECS_TIMER_WHEEL_SLOTS (1 << ECS_TIMER_WHEEL_BITS)
+#define ECS_TIMER_WHEEL_MASK (ECS_TIMER_WHEEL_SLOTS - 1)
+#define ECS_TIMER_WHEEL_LEVELS (4)
+#define ECS_TIMER_WHEEL_RANGE\
+    ((uint64_t)1 << (ECS_TIMER_WHEEL_BITS * ECS_TIMER_WHEEL_LEVELS))
+
+/* Timer in a slot of the wheel */
+typedef struct ecs_timer_entry_t {
+    ecs_entity_t timer;
+    uint64_t expire;        /* Step at which the timer fires */
+} ecs_timer_entry_t;
+
+/* Current schedule of a timer. Entries in the wheel that do not match the
+ * schedule are stale, and are ignored when their slot is processed. */
+typedef struct ecs_timer_schedule_t {
+    uint64_t expire;        /* Step at which the timer fires */
+    double start;           /* Time at which the timer was (re)started */
+} ecs_timer_schedule_t;
+
+struct ecs_timer_wheel_t {
+    ecs_vector_t *slots[ECS_TIMER_WHEEL_LEVELS][ECS_TIMER_WHEEL_SLOTS];
+    ecs_map_t *schedule;    /* Map with ecs_timer_schedule_t per timer */
+    ecs_vector_t *fired;    /* Timers that ticked in the last frame */
+    ecs_vector_t *scratch;  /* Cached vector for processing slots */
+    ecs_entity_t module;    /* Module entity, has tag when wheel is enabled */
+    ecs_entity_t tag;       /* Tag that activates the system of the wheel */
+    uint64_t step;          /* Current step */
+    double time;            /* Time processed by the wheel */
+    float resolution;       /* Duration of a step (0 if wheel is disabled) */
+};
 
 static
-int32_t get_write_state(
-    ecs_map_t *write_state,
-    ecs_entity_t component)
+uint64_t timer_wheel_steps(
+    ecs_timer_wheel_t *wheel,
+    float delay)
 {
-    int32_t *ptr = ecs_map_get(write_state, int32_t, component);
-    if (ptr) {
-        return *ptr;
-    } else {
-        return 0;
+    uint64_t steps = (uint64_t)(delay / wheel->resolution);
+    if ((float)steps * wheel->resolution < delay) {
+        steps ++;
     }
-}
 
-static
-void set_write_state(
-    write_state_t *write_state,
-    ecs_entity_t component,
-    int32_t value)
-{
-    if (component == EcsWildcard) {
-        ecs_assert(value == WriteToStage, ECS_INTERNAL_ERROR, NULL);
-        write_state->wildcard = true;
-    } else {
-        ecs_map_set(write_state->components, component, &value);
+    if (!steps) {
+        steps = 1;
     }
-}
 
-static
-void reset_write_state(
-    write_state_t *write_state)
-{
-    ecs_map_clear(write_state->components);
-    write_state->wildcard = false;
+    return steps;
 }
 
 static
-bool check_column_component(
-    ecs_sig_column_t *column,
-    bool is_active,
-    ecs_entity_t component,
-    write_state_t *write_state)    
+void timer_wheel_insert(
+    ecs_timer_wheel_t *wheel,
+    ecs_entity_t timer,
+    uint64_t expire)
 {
-    int32_t state = get_write_state(write_state->components, component);
-
-    if ((column->from_kind == EcsFromAny || column->from_kind == EcsFromOwned) 
-      && column->oper_kind != EcsOperNot) 
-    {
-        switch(column->inout_kind) {
-        case EcsInOut:
-        case EcsIn:
-            if (state == WriteToStage) {
-                return true;
-            } else if (write_state->wildcard) {
-                return true;
-            }
-            // fall through
-        case EcsOut:
-            if (is_active && column->inout_kind != EcsIn) {
-                set_write_state(write_state, component, WriteToMain);
-            }
-        };
-    } else if (column->from_kind == EcsFromEmpty || 
-               column->oper_kind == EcsOperNot) 
-    {
-        switch(column->inout_kind) {
-        case EcsInOut:
-        case EcsOut:
-            if (is_active) {
-                set_write_state(write_state, component, WriteToStage);
-            }
-            break;
-        default:
-            break;
-        };
+    uint64_t delta = expire - wheel->step;
+
+    /* Timers beyond the range of the wheel are stored in the last slot that
+     * can be reached, and are inserted again when that slot is moved down. */
+    if (delta >= ECS_TIMER_WHEEL_RANGE) {
+        delta = ECS_TIMER_WHEEL_RANGE - 1;
     }
 
-    return false;
+    int32_t level = 0;
+    while (delta >> (ECS_TIMER_WHEEL_BITS * (level + 1))) {
+        level ++;
+    }
+
+    uint64_t at = wheel->step + delta;
+    int32_t slot = (int32_t)(
+        (at >> (ECS_TIMER_WHEEL_BITS * level)) & ECS_TIMER_WHEEL_MASK);
+
+    ecs_timer_entry_t *entry = ecs_vector_add(
+        &wheel->slots[level][slot], ecs_timer_entry_t);
+    entry->timer = timer;
+    entry->expire = expire;
 }
 
 static
-bool check_column(
-    ecs_sig_column_t *column,
-    bool is_active,
-    write_state_t *write_state)
+void timer_wheel_schedule(
+    ecs_timer_wheel_t *wheel,
+    ecs_entity_t timer,
+    float delay,
+    double start)
 {
-    if (column->oper_kind != EcsOperOr) {
-        return check_column_component(
-            column, is_active, column->is.component, write_state);
-    }  
+    ecs_timer_schedule_t schedule = {
+        .expire = wheel->step + timer_wheel_steps(wheel, delay),
+        .start = start
+    };
 
-    return false;
+    ecs_map_set(wheel->schedule, timer, &schedule);
+    timer_wheel_insert(wheel, timer, schedule.expire);
 }
 
 static
-bool build_pipeline(
+void timer_wheel_fire(
     ecs_world_t *world,
-    ecs_entity_t pipeline,
-    EcsPipelineQuery *pq)
+    ecs_timer_wheel_t *wheel,
+    ecs_timer_entry_t *entry)
 {
-    (void)pipeline;
+    ecs_entity_t e = entry->timer;
+    ecs_timer_schedule_t *schedule = ecs_map_get(
+        wheel->schedule, ecs_timer_schedule_t, e);
+    if (!schedule || schedule->expire != entry->expire) {
+        return;
+    }
 
-    ecs_query_iter(pq->query);
+    /* Write to the storage directly, so that firing a timer does not trigger
+     * OnSet systems, which would schedule the timer again. */
+    EcsTimer *timer = (EcsTimer*)ecs_get(world, e, EcsTimer);
+    if (!timer || !timer->active) {
+        ecs_map_remove(wheel->schedule, e);
+        return;
+    }
 
-    if (pq->match_count == pq->query->match_count) {
-        /* No need to rebuild the pipeline */
-        return false;
+    float time_elapsed = (float)(wheel->time - schedule->start);
+
+    EcsTickSource *tick_source = (EcsTickSource*)ecs_get(
+        world, e, EcsTickSource);
+    if (tick_source) {
+        tick_source->tick = true;
+        tick_source->time_elapsed = time_elapsed;
+
+        ecs_entity_t *elem = ecs_vector_add(&wheel->fired, ecs_entity_t);
+        *elem = e;
     }
 
-    ecs_trace_2("rebuilding pipeline #[green]%s", 
-        ecs_get_name(world, pipeline));
+    timer->time = 0;
 
-    world->stats.pipeline_build_count_total ++;
+    if (timer->single_shot) {
+        timer->active = false;
+        ecs_map_remove(wheel->schedule, e);
+    } else {
+        /* Reschedule from the step the timer expired, so it doesn't drift */
+        schedule->expire = entry->expire + 
+            timer_wheel_steps(wheel, timer->timeout);
+        schedule->start = wheel->time;
+        timer_wheel_insert(wheel, e, schedule->expire);
+    }
+}
 
-    write_state_t ws = {
-        .components = ecs_map_new(int32_t, ECS_HI_COMPONENT_ID),
-        .wildcard = false
-    };
+/* Take entries from slot, so timers can be inserted while processing */
+static
+ecs_vector_t* timer_wheel_take_slot(
+    ecs_timer_wheel_t *wheel,
+    int32_t level,
+    int32_t slot)
+{
+    ecs_vector_t *entries = wheel->slots[level][slot];
+    wheel->slots[level][slot] = wheel->scratch;
+    wheel->scratch = NULL;
+    return entries;
+}
 
-    ecs_pipeline_op_t *op = NULL;
-    ecs_vector_t *ops = NULL;
-    ecs_query_t *query = pq->build_query;
+static
+void timer_wheel_release_slot(
+    ecs_timer_wheel_t *wheel,
+    ecs_vector_t *entries)
+{
+    ecs_vector_clear(entries);
+    if (!wheel->scratch) {
+        wheel->scratch = entries;
+    } else {
+        ecs_vector_free(entries);
+    }
+}
+
+static
+void timer_wheel_step(
+    ecs_world_t *world,
+    ecs_timer_wheel_t *wheel)
+{
+    uint64_t step = ++ wheel->step;
+
+    /* Move timers of higher levels down when the level below wraps around */
+    int32_t level;
+    for (level = 1; level < ECS_TIMER_WHEEL_LEVELS; level ++) {
+        if (step & (((uint64_t)1 << (ECS_TIMER_WHEEL_BITS * level)) - 1)) {
+            break;
+        }
+
+        int32_t slot = (int32_t)(
+            (step >> (ECS_TIMER_WHEEL_BITS * level)) & ECS_TIMER_WHEEL_MASK);
+        ecs_vector_t *entries = timer_wheel_take_slot(wheel, level, slot);
+
+        ecs_vector_each(entries, ecs_timer_entry_t, entry, {
+            timer_wheel_insert(wheel, entry->timer, entry->expire);
+        });
 
-    if (pq->ops) {
-        ecs_vector_free(pq->ops);
+        timer_wheel_release_slot(wheel, entries);
     }
 
-    /* Iterate systems in pipeline, add ops for running / merging */
-    ecs_iter_t it = ecs_query_iter(query);
-    while (ecs_query_next(&it)) {
-        EcsSystem *sys = ecs_column(&it, EcsSystem, 1);        
+    int32_t slot = (int32_t)(step & ECS_TIMER_WHEEL_MASK);
+    ecs_vector_t *entries = timer_wheel_take_slot(wheel, 0, slot);
 
-        int i;
-        for (i = 0; i < it.count; i ++) {            
-            ecs_query_t *q = sys[i].query;
-            if (!q) {
-                continue;
-            }
+    ecs_vector_each(entries, ecs_timer_entry_t, entry, {
+        if (entry->expire == step) {
+            timer_wheel_fire(world, wheel, entry);
+        } else {
+            /* Timer was clamped to the range of the wheel */
+            timer_wheel_insert(wheel, entry->timer, entry->expire);
+        }
+    });
 
-            bool needs_merge = false;
-            bool is_active = !ecs_has_entity(
-                world, it.entities[i], EcsInactive);
+    timer_wheel_release_slot(wheel, entries);
+}
 
-            ecs_vector_each(q->sig.columns, ecs_sig_column_t, column, {
-                needs_merge |= check_column(column, is_active, &ws);
-            });
+static
+void timer_wheel_free(
+    ecs_world_t *world,
+    void *ctx)
+{
+    ecs_timer_wheel_t *wheel = ctx;
 
-            if (needs_merge) {
-                /* After merge all components will be merged, so reset state */
-                reset_write_state(&ws);
-                op = NULL;
+    int32_t level, slot;
+    for (level = 0; level < ECS_TIMER_WHEEL_LEVELS; level ++) {
+        for (slot = 0; slot < ECS_TIMER_WHEEL_SLOTS; slot ++) {
+            ecs_vector_free(wheel->slots[level][slot]);
+        }
+    }
 
-                /* Re-evaluate columns to set write flags if system is active.
-                 * If system is inactive, it can't write anything and so it
-                 * should not insert unnecessary merges.  */
-                needs_merge = false;
-                if (is_active) {
-                    ecs_vector_each(q->sig.columns, ecs_sig_column_t, column, {
-                        needs_merge |= check_column(column, true, &ws);
-                    });
-                }
+    ecs_map_free(wheel->schedule);
+    ecs_vector_free(wheel->fired);
+    ecs_vector_free(wheel->scratch);
+    ecs_os_free(wheel);
 
-                /* The component states were just reset, so if we conclude that
-                 * another merge is needed something is wrong. */
-                ecs_assert(needs_merge == false, ECS_INTERNAL_ERROR, NULL);        
-            }
+    world->timer_wheel = NULL;
+}
+
+static
+void AddTickSource(ecs_iter_t *it) {
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_set(it->world, it->entities[i], EcsTickSource, {0});
+    }
+}
+
+static
+void ProgressTimers(ecs_iter_t *it) {
+    EcsTimer *timer = ecs_column(it, EcsTimer, 1);
+    EcsTickSource *tick_source = ecs_column(it, EcsTickSource, 2);
+
+    ecs_assert(timer != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* The system is not disabled when the timing wheel is enabled, so that the
+     * pipeline keeps the merge that makes new tick sources visible. */
+    ecs_timer_wheel_t *wheel = it->world->timer_wheel;
+    if (wheel && wheel->resolution) {
+        return;
+    }
+
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        tick_source[i].tick = false;
+
+        if (!timer[i].active) {
+            continue;
+        }
 
-            if (!op) {
-                op = ecs_vector_add(&ops, ecs_pipeline_op_t);
-                op->count = 0;
+        float time_elapsed = timer[i].time + it->world->stats.delta_time_raw;
+        float timeout = timer[i].timeout;
+        
+        if (time_elapsed >= timeout) {
+            float t = time_elapsed - timeout;
+            if (t > timeout) {
+                t = 0;
             }
 
-            /* Don't increase count for inactive systems, as they are ignored by
-             * the query used to run the pipeline. */
-            if (is_active) {
-                op->count ++;
+            timer[i].time = t; /* Initialize with remainder */            
+            tick_source[i].tick = true;
+            tick_source[i].time_elapsed = time_elapsed;
+
+            if (timer[i].single_shot) {
+                timer[i].active = false;
             }
+        } else {
+            timer[i].time = time_elapsed;
+        }  
+    }
+}
+
+static
+void ProgressTimerWheel(ecs_iter_t *it) {
+    ecs_world_t *world = it->world;
+    ecs_timer_wheel_t *wheel = world->timer_wheel;
+    if (!wheel || !wheel->resolution) {
+        return;
+    }
+
+    /* Reset tick sources of timers that fired in the last frame */
+    ecs_vector_each(wheel->fired, ecs_entity_t, e, {
+        EcsTickSource *tick_source = (EcsTickSource*)ecs_get(
+            world, *e, EcsTickSource);
+        if (tick_source) {
+            tick_source->tick = false;
         }
+    });
+
+    ecs_vector_clear(wheel->fired);
+
+    wheel->time += (double)world->stats.delta_time_raw;
+
+    uint64_t target = (uint64_t)(wheel->time / (double)wheel->resolution);
+    while (wheel->step < target) {
+        timer_wheel_step(world, wheel);
     }
+}
 
-    ecs_map_free(ws.components);
+static
+void ScheduleTimers(ecs_iter_t *it) {
+    ecs_timer_wheel_t *wheel = it->world->timer_wheel;
+    if (!wheel || !wheel->resolution) {
+        return;
+    }
 
-    /* Force sort of query as this could increase the match_count */
-    pq->match_count = pq->query->match_count;
-    pq->ops = ops;
+    EcsTimer *timer = ecs_column(it, EcsTimer, 1);
 
-    return true;
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_entity_t e = it->entities[i];
+        if (timer[i].active) {
+            timer_wheel_schedule(wheel, e, timer[i].timeout - timer[i].time,
+                wheel->time - (double)timer[i].time);
+        } else {
+            ecs_map_remove(wheel->schedule, e);
+        }
+    }
 }
 
 static
-int32_t iter_reset(
-    const EcsPipelineQuery *pq,
-    ecs_iter_t *iter_out,
-    ecs_pipeline_op_t **op_out,
-    ecs_entity_t move_to)
-{
-    ecs_pipeline_op_t *op = ecs_vector_first(pq->ops, ecs_pipeline_op_t);
-    int32_t ran_since_merge = 0;
+void ProgressRateFilters(ecs_iter_t *it) {
+    EcsRateFilter *filter = ecs_column(it, EcsRateFilter, 1);
+    EcsTickSource *tick_dst = ecs_column(it, EcsTickSource, 2);
 
-    ecs_iter_t it = ecs_query_iter(pq->query);
-    while (ecs_query_next(&it)) {
-        int32_t i;
-        for(i = 0; i < it.count; i ++) {
-            ecs_entity_t e = it.entities[i];
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_entity_t src = filter[i].src;
+        bool inc = false;
 
-            ran_since_merge ++;
-            if (ran_since_merge == op->count) {
-                ran_since_merge = 0;
-                op ++;
+        filter[i].time_elapsed += it->delta_time;
+
+        if (src) {
+            /* Cache the location of the source, so that resolving a chain
+             * of rate filters does not require an entity index lookup */
+            ecs_ref_t *ref = &filter[i].src_ref;
+            if (ref->entity != src) {
+                *ref = (ecs_ref_t){ 0 };
             }
 
-            if (e == move_to) {
-                *iter_out = it;
-                *op_out = op;
-                return i;
+            const EcsTickSource *tick_src = ecs_get_ref(
+                it->world, ref, src, EcsTickSource);
+            if (tick_src) {
+                inc = tick_src->tick;
             }
+        } else {
+            inc = true;
+        }
+
+        if (inc) {
+            filter[i].tick_count ++;
+            bool triggered = !(filter[i].tick_count % filter[i].rate);
+            tick_dst[i].tick = triggered;
+            tick_dst[i].time_elapsed = filter[i].time_elapsed;
+
+            if (triggered) {
+                filter[i].time_elapsed = 0;
+            }            
+        } else {
+            tick_dst[i].tick = false;
         }
     }
+}
 
-    ecs_abort(ECS_UNSUPPORTED, NULL);
+ecs_entity_t ecs_set_timeout(
+    ecs_world_t *world,
+    ecs_entity_t timer,
+    float timeout)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    timer = ecs_set(world, timer, EcsTimer, {
+        .timeout = timeout,
+        .single_shot = true,
+        .active = true
+    });
+
+    EcsSystem *system_data = ecs_get_mut(world, timer, EcsSystem, NULL);
+    if (system_data) {
+        system_data->tick_source = timer;
+    }
+
+    return timer;
+}
+
+float ecs_get_timeout(
+    ecs_world_t *world,
+    ecs_entity_t timer)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(timer != 0, ECS_INVALID_PARAMETER, NULL);
+
+    EcsTimer *value = ecs_get_mut(world, timer, EcsTimer, NULL);
+    if (value) {
+        return value->timeout;
+    } else {
+        return 0;
+    }
+}
+
+ecs_entity_t ecs_set_interval(
+    ecs_world_t *world,
+    ecs_entity_t timer,
+    float interval)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    timer = ecs_set(world, timer, EcsTimer, {
+        .timeout = interval,
+        .active = true
+    });
+
+    EcsSystem *system_data = ecs_get_mut(world, timer, EcsSystem, NULL);
+    if (system_data) {
+        system_data->tick_source = timer;
+    }  
 
-    return -1;
+    return timer;  
 }
 
-int32_t ecs_pipeline_update(
+float ecs_get_interval(
     ecs_world_t *world,
-    ecs_entity_t pipeline)
+    ecs_entity_t timer)
 {
-    EcsPipelineQuery *pq = ecs_get_mut(world, pipeline, EcsPipelineQuery, NULL);
-    ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(pq->query != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
 
-    if (build_pipeline(world, pipeline, pq)) {
-        return ecs_vector_count(pq->ops);
+    if (!timer) {
+        return 0;
+    }
+
+    EcsTimer *value = ecs_get_mut(world, timer, EcsTimer, NULL);
+    if (value) {
+        return value->timeout;
     } else {
         return 0;
     }
 }
 
-int32_t ecs_pipeline_begin(
+void ecs_start_timer(
     ecs_world_t *world,
-    ecs_entity_t pipeline)
+    ecs_entity_t timer)
 {
-    ecs_assert(!world->in_progress, ECS_INTERNAL_ERROR, NULL);
-
-    ecs_eval_component_monitors(world);
-
-    EcsPipelineQuery *pq = ecs_get_mut(
-        world, pipeline, EcsPipelineQuery, NULL);
-    ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(pq->query != NULL, ECS_INTERNAL_ERROR, NULL);
+    EcsTimer *ptr = ecs_get_mut(world, timer, EcsTimer, NULL);
+    ecs_assert(ptr != NULL, ECS_INVALID_PARAMETER, NULL);
 
-    build_pipeline(world, pipeline, pq);
+    ptr->active = true;
+    ptr->time = 0;
 
-    return ecs_vector_count(pq->ops);
+    ecs_modified(world, timer, EcsTimer);
 }
 
-void ecs_pipeline_end(
-    ecs_world_t *world)
+void ecs_stop_timer(
+    ecs_world_t *world,
+    ecs_entity_t timer)
 {
-    (void)world;
+    EcsTimer *ptr = ecs_get_mut(world, timer, EcsTimer, NULL);
+    ecs_assert(ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    ptr->active = false;
+
+    ecs_modified(world, timer, EcsTimer);
 }
 
-void ecs_pipeline_progress(
+void ecs_enable_timer_wheel(
     ecs_world_t *world,
-    ecs_entity_t pipeline,
-    float delta_time)
+    float resolution)
 {
-    const EcsPipelineQuery *pq = ecs_get(world, pipeline, EcsPipelineQuery);
-    ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(pq->query != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(resolution > 0, ECS_INVALID_PARAMETER, NULL);
 
-    ecs_vector_t *ops = pq->ops;
-    ecs_pipeline_op_t *op = ecs_vector_first(ops, ecs_pipeline_op_t);
-    ecs_pipeline_op_t *op_last = ecs_vector_last(ops, ecs_pipeline_op_t);
-    int32_t ran_since_merge = 0;
+    ecs_timer_wheel_t *wheel = world->timer_wheel;
+    ecs_assert(wheel != NULL, ECS_INVALID_OPERATION, NULL);
+    ecs_assert(!wheel->resolution, ECS_INVALID_OPERATION, NULL);
 
-    ecs_worker_begin(world);
-    ecs_stage_t *stage = ecs_get_stage(&world);
-    
-    ecs_iter_t it = ecs_query_iter(pq->query);
-    while (ecs_query_next(&it)) {
-        EcsSystem *sys = ecs_column(&it, EcsSystem, 1);
+    wheel->resolution = resolution;
+    ecs_add_entity(world, wheel->module, wheel->tag);
 
-        int32_t i;
-        for(i = 0; i < it.count; i ++) {
-            ecs_entity_t e = it.entities[i];
-            
-            ecs_run_intern(world, stage, e, &sys[i], delta_time, 0, 0, 
-                NULL, NULL, false);
+    /* Schedule existing timers, and reset ticks from the last frame */
+    ecs_iter_t it = ecs_filter_iter(world, &(ecs_filter_t){
+        .include = ecs_type_from_entity(world, ecs_typeid(EcsTimer))
+    });
 
-            ran_since_merge ++;
-            world->stats.systems_ran_frame ++;
+    while (ecs_filter_next(&it)) {
+        ecs_type_t type = ecs_iter_type(&it);
+        EcsTimer *timer = ecs_table_column(&it, 
+            ecs_type_index_of(type, ecs_typeid(EcsTimer)));
+        int32_t tick_column = ecs_type_index_of(
+            type, ecs_typeid(EcsTickSource));
+        EcsTickSource *tick_source = NULL;
+        if (tick_column != -1) {
+            tick_source = ecs_table_column(&it, tick_column);
+        }
 
-            if (op != op_last && ran_since_merge == op->count) {
-                ran_since_merge = 0;
-                op++;
-
-                /* If the set of matched systems changed as a result of the
-                 * merge, we have to reset the iterator and move it to our
-                 * current position (system). If there are a lot of systems
-                 * in the pipeline this can be an expensive operation, but
-                 * should happen infrequently. */
-                if (ecs_worker_sync(world)) {
-                    i = iter_reset(pq, &it, &op, e);
-                    op_last = ecs_vector_last(pq->ops, ecs_pipeline_op_t);
-                    sys = ecs_column(&it, EcsSystem, 1);
-                }
+        int32_t i;
+        for (i = 0; i < it.count; i ++) {
+            if (tick_source) {
+                tick_source[i].tick = false;
+            }
+
+            if (timer[i].active) {
+                timer_wheel_schedule(wheel, it.entities[i], 
+                    timer[i].timeout - timer[i].time, 
+                    wheel->time - (double)timer[i].time);
             }
         }
     }
-
-    ecs_worker_end(world);
 }
 
-static
-void add_pipeline_tags_to_sig(
+ecs_entity_t ecs_set_rate_filter(
     ecs_world_t *world,
-    ecs_sig_t *sig,
-    ecs_type_t type)
+    ecs_entity_t filter,
+    int32_t rate,
+    ecs_entity_t source)
 {
-    (void)world;
-    
-    int32_t i, count = ecs_vector_count(type);
-    ecs_entity_t *entities = ecs_vector_first(type, ecs_entity_t);
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
 
-    for (i = 0; i < count; i ++) {
-        if (!i) {
-            ecs_sig_add(world, sig, EcsFromAny, EcsOperAnd, EcsIn, entities[i], 
-                0, NULL);
-        } else {
-            ecs_sig_add(world, sig, EcsFromAny, EcsOperOr, EcsIn, entities[i], 
-                0, NULL);
-        }
-    }
+    filter = ecs_set(world, filter, EcsRateFilter, {
+        .rate = rate,
+        .src = source
+    });
+
+    EcsSystem *system_data = ecs_get_mut(world, filter, EcsSystem, NULL);
+    if (system_data) {
+        system_data->tick_source = filter;
+    }  
+
+    return filter;     
 }
 
-static 
-void EcsOnAddPipeline(
-    ecs_iter_t *it)
+void ecs_set_tick_source(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    ecs_entity_t tick_source)
 {
-    ecs_world_t *world = it->world;
-    ecs_entity_t *entities = it->entities;
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(system != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(tick_source != 0, ECS_INVALID_PARAMETER, NULL);
 
-    int32_t i;
-    for (i = it->count - 1; i >= 0; i --) {
-        ecs_entity_t pipeline = entities[i];
-        ecs_sig_t sig = { 0 };
+    EcsSystem *system_data = ecs_get_mut(world, system, EcsSystem, NULL);
+    ecs_assert(system_data != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    system_data->tick_source = tick_source;
+}
+
+void FlecsTimerImport(
+    ecs_world_t *world)
+{    
+    ECS_MODULE(world, FlecsTimer);
+
+    ECS_IMPORT(world, FlecsPipeline);
+
+    ecs_set_name_prefix(world, "Ecs");
+
+    ecs_bootstrap_component(world, EcsTimer);
+    ecs_bootstrap_component(world, EcsRateFilter);
+
+    /* Add EcsTickSource to timers and rate filters */
+    ECS_SYSTEM(world, AddTickSource, EcsPreFrame, [in] Timer || RateFilter, [out] !flecs.system.TickSource);
+
+    /* Timer handling */
+    ECS_SYSTEM(world, ProgressTimers, EcsPreFrame, Timer, flecs.system.TickSource);
+
+    /* Timing wheel handling. The system that advances the wheel matches the
+     * module entity, which only has the TimerWheel tag when the wheel is
+     * enabled. This keeps the system inactive until then. */
+    ECS_TAG(world, TimerWheel);
+    ECS_SYSTEM(world, ProgressTimerWheel, EcsPreFrame, [in] TimerWheel);
+    ECS_SYSTEM(world, ScheduleTimers, EcsOnSet, Timer);
+
+    ecs_timer_wheel_t *wheel = ecs_os_calloc(ECS_SIZEOF(ecs_timer_wheel_t));
+    wheel->schedule = ecs_map_new(ecs_timer_schedule_t, 0);
+    wheel->module = ecs_typeid(FlecsTimer);
+    wheel->tag = TimerWheel;
+    world->timer_wheel = wheel;
+    ecs_atfini(world, timer_wheel_free, wheel);
+
+    /* Rate filter handling */
+    ECS_SYSTEM(world, ProgressRateFilters, EcsPreFrame, [in] RateFilter, [out] flecs.system.TickSource);
+}
 
-        const EcsType *type_ptr = ecs_get(world, pipeline, EcsType);
-        ecs_assert(type_ptr != NULL, ECS_INTERNAL_ERROR, NULL);
-        
-#ifndef NDEBUG
-        char *str = ecs_type_str(world, type_ptr->normalized);
-        ecs_trace_1("pipeline #[green]%s#[normal] created with #[red][%s]",
-            ecs_get_name(world, pipeline), str);
-        ecs_os_free(str);
 #endif
-        ecs_log_push();
 
-        /* Build signature for pipeline quey that matches EcsSystems, has the
-         * pipeline as a XOR column, and ignores systems with EcsInactive and
-         * EcsDisabledIntern. Note that EcsDisabled is automatically ignored by
-         * the regular query matching */
-        ecs_sig_add(world, &sig, EcsFromAny, EcsOperAnd, EcsIn, 
-            ecs_typeid(EcsSystem), 0, NULL);
-        ecs_sig_add(world, &sig, EcsFromAny, EcsOperNot, EcsIn, EcsInactive, 0, NULL);
-        ecs_sig_add(world, &sig, EcsFromAny, EcsOperNot, EcsIn, 
-            EcsDisabledIntern, 0, NULL);
-        add_pipeline_tags_to_sig(world, &sig, type_ptr->normalized);
+#ifdef FLECS_STATS
 
-        /* Create the query. Sort the query by system id and phase */
-        ecs_query_t *query = ecs_query_new_w_sig(world, 0, &sig);
-        ecs_query_order_by(world, query, 0, compare_entity);
-        ecs_query_group_by(world, query, pipeline, rank_phase);
 
-        /* Build signature for pipeline build query. The build query includes
-         * systems that are inactive, as an inactive system may become active as
-         * a result of another system, and as a result the correct merge 
-         * operations need to be put in place. */
-        ecs_sig_add(world, &sig, EcsFromAny, EcsOperAnd, EcsIn, 
-            ecs_typeid(EcsSystem), 0, NULL);
-        ecs_sig_add(world, &sig, EcsFromAny, EcsOperNot, EcsIn, 
-            EcsDisabledIntern, 0, NULL);
-        add_pipeline_tags_to_sig(world, &sig, type_ptr->normalized);
+typedef struct EcsTablePtr {
+    ecs_table_t *table;
+} EcsTablePtr;
 
-        /* Use the same sorting functions for the build query */
-        ecs_query_t *build_query = ecs_query_new_w_sig(world, 0, &sig);
-        ecs_query_order_by(world, build_query, 0, compare_entity);
-        ecs_query_group_by(world, build_query, pipeline, rank_phase);       
+/* -- Systems that add components on interest */
 
-        EcsPipelineQuery *pq = ecs_get_mut(
-            world, pipeline, EcsPipelineQuery, NULL);
-        ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
+static
+void StatsAddWorldStats(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, EcsWorldStats, 1);
 
-        pq->query = query;
-        pq->build_query = build_query;
-        pq->match_count = -1;
-        pq->ops = NULL;
+    ecs_set(it->world, EcsWorld, EcsWorldStats, {0});
+}
 
-        ecs_log_pop();
-    }
+static
+void StatsAddAllocStats(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, EcsAllocStats, 1);
+
+    ecs_set(it->world, EcsWorld, EcsAllocStats, {0});
 }
 
-/* -- Public API -- */
+static
+void StatsAddMemoryStats(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, EcsMemoryStats, 1);
 
-bool ecs_progress(
-    ecs_world_t *world,
-    float user_delta_time)
-{
-    ecs_frame_begin(world, user_delta_time);
+    ecs_set(it->world, EcsWorld, EcsMemoryStats, {0});
+}
 
-    ecs_workers_progress(world);
+static
+void StatsAddSystemStats(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, EcsSystemStats, 2);
+    
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_set(it->world, it->entities[i], EcsSystemStats, {0});
+    }
+}
 
-    ecs_frame_end(world);
+static
+void StatsAddColSystemMemoryStats(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, EcsSystemMemoryStats, 2);
+    
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_set(it->world, it->entities[i], EcsSystemMemoryStats, {0});
+    }
+}
 
-    return !world->should_quit;
+static
+void StatsAddComponentStats(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, EcsComponentStats, 2);
+    
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_set(it->world, it->entities[i], EcsComponentStats, {0});
+    }
+}
+
+static
+void StatsAddTableStats(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, EcsTableStats, 2);
+    
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_set(it->world, it->entities[i], EcsTableStats, {0});
+    }
 }
 
-void ecs_set_time_scale(
-    ecs_world_t *world,
-    float scale)
-{
-    world->stats.time_scale = scale;
+static
+void StatsAddTypeStats(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, EcsTypeStats, 2);
+    
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_set(it->world, it->entities[i], EcsTypeStats, {0});
+    }
 }
 
-void ecs_reset_clock(
-    ecs_world_t *world)
+/* -- Latency statistics -- */
+
+/* Find first sample in sorted array that is not smaller than value */
+static
+int32_t find_sample(
+    const float *sorted,
+    int32_t count,
+    float value)
 {
-    world->stats.world_time_total = 0;
-    world->stats.world_time_total_raw = 0;
+    int32_t lo = 0, hi = count;
+    while (lo < hi) {
+        int32_t mid = (lo + hi) / 2;
+        if (sorted[mid] < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
 }
 
-void ecs_quit(
-    ecs_world_t *world)
+static
+float get_percentile(
+    float *sorted,
+    int32_t count,
+    int32_t percentile)
 {
-    ecs_get_stage(&world);
-    world->should_quit = true;
+    /* Nearest rank */
+    int32_t rank = (percentile * count + 99) / 100;
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
 }
 
-void ecs_deactivate_systems(
-    ecs_world_t *world)
+static
+int32_t get_histogram_bucket(
+    float sample)
 {
-    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
-
-    ecs_entity_t pipeline = world->pipeline;
-    const EcsPipelineQuery *pq = ecs_get( world, pipeline, EcsPipelineQuery);
-    ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
-
-    /* Iterate over all systems, add EcsInvalid tag if queries aren't matched
-     * with any tables */
-    ecs_iter_t it = ecs_query_iter(pq->build_query);
-
-    /* Make sure that we defer adding the inactive tags until after iterating
-     * the query */
-    ecs_defer_none(world, &world->stage);
-
-    while( ecs_query_next(&it)) {
-        EcsSystem *sys = ecs_column(&it, EcsSystem, 1);
+    float us = sample * 1000000.0f;
+    float threshold = 1.0f;
+    int32_t bucket = 0;
 
-        int32_t i;
-        for (i = 0; i < it.count; i ++) {
-            ecs_query_t *query = sys[i].query;
-            if (query) {
-                if (!ecs_vector_count(query->tables)) {
-                    ecs_add_entity(world, it.entities[i], EcsInactive);
-                }
-            }
-        }
+    while (us >= threshold && bucket < (ECS_STAT_HISTOGRAM_BUCKETS - 1)) {
+        threshold *= 2.0f;
+        bucket ++;
     }
 
-    ecs_defer_flush(world, &world->stage);
+    return bucket;
 }
 
-void ecs_set_pipeline(
-    ecs_world_t *world,
-    ecs_entity_t pipeline)
+static
+void record_latency(
+    ecs_latency_stat_t *stat,
+    float sample)
 {
-    ecs_assert( ecs_get(world, pipeline, EcsPipelineQuery) != NULL, 
-        ECS_INVALID_PARAMETER, NULL);
+    /* Also rejects NaN, which would break the order of the sorted samples */
+    if (!(sample >= 0)) {
+        sample = 0;
+    }
 
-    world->pipeline = pipeline;
-}
+    /* Keep the sorted samples and histogram up to date as samples enter and
+     * leave the window, so that recording a sample is O(window size). */
+    float *sorted = stat->sorted;
+    int32_t i, count = stat->samples_count;
 
-ecs_entity_t ecs_get_pipeline(
-    ecs_world_t *world)
-{
-    return world->pipeline;
-}
+    if (count == ECS_STAT_WINDOW_SIZE) {
+        float evicted = stat->window[stat->window_index];
+        stat->histogram[get_histogram_bucket(evicted)] --;
 
-ecs_entity_t ecs_new_pipeline(
-    ecs_world_t *world,
-    ecs_entity_t e,
-    const char *name,
-    const char *expr)
-{
-    assert(world->magic == ECS_WORLD_MAGIC);
+        i = find_sample(sorted, count, evicted);
+        ecs_assert(i < count, ECS_INTERNAL_ERROR, NULL);
+        count --;
+        memmove(&sorted[i], &sorted[i + 1],
+            ecs_to_size_t(count - i) * sizeof(float));
+    }
 
-    ecs_entity_t result = ecs_new_type(world, e, name, expr);
-    ecs_assert(ecs_get(world, result, EcsType) != NULL, 
-        ECS_INTERNAL_ERROR, NULL);
+    stat->window[stat->window_index] = sample;
+    stat->window_index = (stat->window_index + 1) % ECS_STAT_WINDOW_SIZE;
+    stat->histogram[get_histogram_bucket(sample)] ++;
 
-    ecs_add_entity(world, result, EcsPipeline);
+    i = find_sample(sorted, count, sample);
+    memmove(&sorted[i + 1], &sorted[i],
+        ecs_to_size_t(count - i) * sizeof(float));
+    sorted[i] = sample;
+    stat->samples_count = ++ count;
 
-    return result;
+    stat->p50_seconds = get_percentile(sorted, count, 50);
+    stat->p95_seconds = get_percentile(sorted, count, 95);
+    stat->p99_seconds = get_percentile(sorted, count, 99);
+    stat->max_seconds = sorted[count - 1];
 }
 
-/* -- Module implementation -- */
+/* -- Systems that collect metrics on interest -- */
 
 static
-void FlecsPipelineFini(
-    ecs_world_t *world,
+void StatsCollectWorldStats_StatusAction(
+    ecs_world_t *world, 
+    ecs_entity_t system,
+    ecs_system_status_t status, 
     void *ctx)
 {
+    (void)system;
     (void)ctx;
-    if (world->workers) {
-        ecs_set_threads(world, 0);
+
+    if (status == EcsSystemActivated) {
+        ecs_measure_frame_time(world, true);
+    } else if (status == EcsSystemDeactivated) {
+        ecs_measure_frame_time(world, false);
     }
 }
 
-void FlecsPipelineImport(
-    ecs_world_t *world)
-{
-    ECS_MODULE(world, FlecsPipeline);
+static
+void StatsCollectWorldStats(ecs_iter_t *it) {
+    ECS_COLUMN(it, EcsWorldStats, stats, 1);
 
-    ECS_IMPORT(world, FlecsSystem);
+    ecs_world_t *world = it->world;
 
-    ecs_set_name_prefix(world, "Ecs");
+    /* If a frame was processed since the last time stats were collected, add
+     * the time spent since then to the latency windows. Skip the first time
+     * stats are collected, as time was not measured before that. */
+    if (stats->frame_count_total &&
+        world->stats.frame_count_total > stats->frame_count_total)
+    {
+        record_latency(&stats->frame_latency, (float)(
+            world->stats.frame_time_total - stats->frame_seconds_total));
+        record_latency(&stats->system_latency, (float)(
+            world->stats.system_time_total - stats->system_seconds_total));
+        record_latency(&stats->merge_latency, (float)(
+            world->stats.merge_time_total - stats->merge_seconds_total));
+    }
 
-    ecs_bootstrap_tag(world, EcsPipeline);
-    ecs_bootstrap_component(world, EcsPipelineQuery);
+    stats->entities_count = ecs_eis_count(world);
+    stats->components_count = ecs_count(world, EcsComponent);
+    stats->col_systems_count = ecs_count(world, EcsSystem);
+    stats->tables_count = ecs_sparse_count(world->store.tables);
+    stats->threads_count = ecs_vector_count(world->workers);
+    
+    stats->frame_seconds_total = world->stats.frame_time_total;
+    stats->system_seconds_total = world->stats.system_time_total;
+    stats->merge_seconds_total = world->stats.merge_time_total;
+    stats->world_seconds_total = world->stats.world_time_total;
+    stats->target_fps_hz = world->stats.target_fps;
+    stats->frame_count_total = world->stats.frame_count_total;
 
-    /* Phases of the builtin pipeline are regular entities. Names are set so
-     * they can be resolved by type expressions. */
-    ecs_bootstrap_tag(world, EcsPreFrame);
-    ecs_bootstrap_tag(world, EcsOnLoad);
-    ecs_bootstrap_tag(world, EcsPostLoad);
-    ecs_bootstrap_tag(world, EcsPreUpdate);
-    ecs_bootstrap_tag(world, EcsOnUpdate);
-    ecs_bootstrap_tag(world, EcsOnValidate);
-    ecs_bootstrap_tag(world, EcsPostUpdate);
-    ecs_bootstrap_tag(world, EcsPreStore);
-    ecs_bootstrap_tag(world, EcsOnStore);
-    ecs_bootstrap_tag(world, EcsPostFrame);
+    stats->table_create_count_total = world->stats.table_create_count_total;
+    stats->table_delete_count_total = world->stats.table_delete_count_total;
+    stats->table_move_count_total = world->stats.table_move_count_total;
+    stats->table_append_count_total = world->stats.table_append_count_total;
+    stats->table_remove_count_total = world->stats.table_remove_count_total;
+    stats->defer_new_count_total = world->stats.defer_new_count_total;
+    stats->defer_add_count_total = world->stats.defer_add_count_total;
+    stats->defer_remove_count_total = world->stats.defer_remove_count_total;
+    stats->defer_set_count_total = world->stats.defer_set_count_total;
+    stats->defer_delete_count_total = world->stats.defer_delete_count_total;
+    stats->defer_flush_count_total = world->stats.defer_flush_count_total;
+    stats->rematch_count_total = world->stats.rematch_count_total;
+    stats->monitor_eval_count_total = world->stats.monitor_eval_count_total;
+}
 
-    ECS_TYPE_IMPL(EcsPipelineQuery);
+static
+void StatsCollectAllocStats(ecs_iter_t *it) {
+    ECS_COLUMN(it, EcsAllocStats, stats, 1);
 
-    /* Set ctor and dtor for PipelineQuery */
-    ecs_set(world, ecs_typeid(EcsPipelineQuery), EcsComponentLifecycle, {
-        .ctor = ecs_ctor(EcsPipelineQuery),
-        .dtor = ecs_dtor(EcsPipelineQuery)
-    });
+    /* Rates can only be computed once previous totals have been collected */
+    bool has_prev = stats->malloc_count_total != 0;
+    float delta_time = it->delta_time;
 
-    /* When the Pipeline tag is added a pipeline will be created */
-    ECS_TRIGGER(world, EcsOnAddPipeline, EcsOnAdd, Pipeline);
+    stats->malloc_count_total = ecs_os_api_malloc_count;
+    stats->calloc_count_total = ecs_os_api_calloc_count;
+    stats->realloc_count_total = ecs_os_api_realloc_count;
+    stats->free_count_total = ecs_os_api_free_count;
 
-    /* Create the builtin pipeline */
-    world->pipeline = ecs_new_pipeline(world, 0, "BuiltinPipeline",
-        "PreFrame, OnLoad, PostLoad, PreUpdate, OnUpdate,"
-        " OnValidate, PostUpdate, PreStore, OnStore, PostFrame");
+    int32_t i;
+    for (i = 0; i < EcsAllocTagCount; i ++) {
+        ecs_alloc_tag_stats_t *src = &ecs_os_api_alloc_tags[i];
+        ecs_alloc_tag_stat_t *dst = &stats->tags[i];
 
-    /* Cleanup thread administration when world is destroyed */
-    ecs_atfini(world, FlecsPipelineFini, NULL);
+        if (has_prev && delta_time > 0) {
+            dst->alloc_rate = 
+                (float)(src->alloc_count - dst->alloc_count_total) / delta_time;
+            dst->free_rate = 
+                (float)(src->free_count - dst->free_count_total) / delta_time;
+        }
+
+        dst->allocd_bytes = src->bytes;
+        dst->alloc_count_total = src->alloc_count;
+        dst->realloc_count_total = src->realloc_count;
+        dst->free_count_total = src->free_count;
+    }
 }
 
-#endif
+static
+void StatsCollectColSystemMemoryTotals(ecs_iter_t *it) {
+    ECS_COLUMN(it, EcsSystemMemoryStats, stats, 1);
 
-#ifdef FLECS_TIMER
+    ecs_memory_stat_t *stat = it->param;
 
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        stat->allocd_bytes += 
+            stats[i].base_memory_bytes +
+            stats[i].columns_memory.allocd_bytes +
+            stats[i].active_tables_memory.allocd_bytes +
+            stats[i].inactive_tables_memory.allocd_bytes +
+            stats[i].jobs_memory.allocd_bytes +
+            stats[i].other_memory_bytes;
 
-ecs_type_t ecs_type(EcsTimer);
-ecs_type_t ecs_type(EcsRateFilter);
+        stat->used_bytes += 
+            stats[i].base_memory_bytes +
+            stats[i].columns_memory.used_bytes +
+            stats[i].active_tables_memory.used_bytes +
+            stats[i].inactive_tables_memory.used_bytes +
+            stats[i].jobs_memory.used_bytes +
+            stats[i].other_memory_bytes;            
+    }
+}
 
 static
-void AddTickSource(ecs_iter_t *it) {
+void StatsCollectTableMemoryTotals(ecs_iter_t *it) {
+    ECS_COLUMN(it, EcsTableStats, stats, 1);
+
+    EcsMemoryStats *world_stats = it->param;
+
     int32_t i;
     for (i = 0; i < it->count; i ++) {
-        ecs_set(it->world, it->entities[i], EcsTickSource, {0});
+        world_stats->components_memory.used_bytes += stats[i].component_memory.used_bytes;
+        world_stats->components_memory.allocd_bytes += stats[i].component_memory.allocd_bytes;
+
+        world_stats->entities_memory.used_bytes += stats[i].entity_memory.used_bytes;
+        world_stats->entities_memory.allocd_bytes += stats[i].entity_memory.allocd_bytes;
+
+        world_stats->tables_memory.used_bytes += stats[i].other_memory_bytes;
+        world_stats->tables_memory.allocd_bytes += stats[i].other_memory_bytes; 
     }
 }
 
 static
-void ProgressTimers(ecs_iter_t *it) {
-    EcsTimer *timer = ecs_column(it, EcsTimer, 1);
-    EcsTickSource *tick_source = ecs_column(it, EcsTickSource, 2);
+void compute_world_memory(
+    ecs_world_t *world,
+    EcsMemoryStats *stats)
+{
+    stats->world_memory.used_bytes = 
+    stats->world_memory.allocd_bytes = ECS_SIZEOF(ecs_world_t);
 
-    ecs_assert(timer != NULL, ECS_INTERNAL_ERROR, NULL);
+    /* Add memory spent on worker threads to world memory */
+    ecs_vector_memory(world->workers, ecs_thread_t,
+        &stats->world_memory.allocd_bytes, &stats->world_memory.used_bytes);
 
-    int i;
-    for (i = 0; i < it->count; i ++) {
-        tick_source[i].tick = false;
+    /* Add memory spent on on demand lookup structures to system memory */
+    ecs_map_memory(world->on_enable_components, 
+        &stats->systems_memory.allocd_bytes, &stats->systems_memory.used_bytes);        
+    ecs_map_memory(world->on_activate_components,
+        &stats->systems_memory.allocd_bytes, &stats->systems_memory.used_bytes);     
 
-        if (!timer[i].active) {
-            continue;
-        }
+    ecs_vector_memory(world->fini_tasks, ecs_entity_t,
+        &stats->systems_memory.allocd_bytes, &stats->systems_memory.used_bytes);
 
-        float time_elapsed = timer[i].time + it->world->stats.delta_time_raw;
-        float timeout = timer[i].timeout;
-        
-        if (time_elapsed >= timeout) {
-            float t = time_elapsed - timeout;
-            if (t > timeout) {
-                t = 0;
-            }
+    /* Add table array to table memory */
+    ecs_sparse_memory(world->store.tables,
+        &stats->tables_memory.allocd_bytes, &stats->tables_memory.used_bytes);
 
-            timer[i].time = t; /* Initialize with remainder */            
-            tick_source[i].tick = true;
-            tick_source[i].time_elapsed = time_elapsed;
+    /* Add misc lookup indices to world memory */
+    ecs_map_memory(world->type_handles, 
+        &stats->world_memory.allocd_bytes, &stats->world_memory.used_bytes);   
+
+    stats->stages_memory = (ecs_memory_stat_t){0};
+    
+    /* Compute memory used in temporary stage */
+    stats->stages_memory.used_bytes += ECS_SIZEOF(ecs_stage_t);
+    stats->stages_memory.allocd_bytes += ECS_SIZEOF(ecs_stage_t);    
 
-            if (timer[i].single_shot) {
-                timer[i].active = false;
-            }
-        } else {
-            timer[i].time = time_elapsed;
-        }  
-    }
+    /* Add memory used / allocated by worker_stages array */
+    ecs_vector_memory(world->worker_stages, ecs_stage_t,
+        &stats->stages_memory.allocd_bytes, &stats->stages_memory.used_bytes);
 }
 
 static
-void ProgressRateFilters(ecs_iter_t *it) {
-    EcsRateFilter *filter = ecs_column(it, EcsRateFilter, 1);
-    EcsTickSource *tick_dst = ecs_column(it, EcsTickSource, 2);
+void StatsCollectMemoryStats(ecs_iter_t *it) {
+    ECS_COLUMN(it, EcsMemoryStats, stats, 1);
+    ECS_COLUMN_ENTITY(it, StatsCollectColSystemMemoryTotals, 2);
+    ECS_COLUMN_ENTITY(it, StatsCollectTableMemoryTotals, 3);
 
-    int i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_entity_t src = filter[i].src;
-        bool inc = false;
+    ecs_world_t *world = it->world;
 
-        filter[i].time_elapsed += it->delta_time;
+    /* Compute entity memory (entity index) */
+    stats->entities_memory = (ecs_memory_stat_t){0};
+    
+    ecs_eis_memory(world, 
+        &stats->entities_memory.allocd_bytes, 
+        &stats->entities_memory.used_bytes);
+    
+    /* Compute entity (entity columns), component and table memory */
+    stats->components_memory = (ecs_memory_stat_t){0};
+    stats->tables_memory = (ecs_memory_stat_t){0};
+    ecs_run(world, StatsCollectTableMemoryTotals, 0, stats);
 
-        if (src) {
-            const EcsTickSource *tick_src = ecs_get(it->world, src, EcsTickSource);
-            if (tick_src) {
-                inc = tick_src->tick;
-            }
-        } else {
-            inc = true;
-        }
+    /* Compute system memory */
+    stats->systems_memory = (ecs_memory_stat_t){0};
+    ecs_run(world, StatsCollectColSystemMemoryTotals, 0, &stats->systems_memory);
 
-        if (inc) {
-            filter[i].tick_count ++;
-            bool triggered = !(filter[i].tick_count % filter[i].rate);
-            tick_dst[i].tick = triggered;
-            tick_dst[i].time_elapsed = filter[i].time_elapsed;
+    /* Compute world memory */
+    compute_world_memory(world, stats);
 
-            if (triggered) {
-                filter[i].time_elapsed = 0;
-            }            
-        } else {
-            tick_dst[i].tick = false;
-        }
-    }
+    /* Add everything up to compute total memory */
+    stats->total_memory.used_bytes =
+        stats->entities_memory.used_bytes +
+        stats->components_memory.used_bytes +
+        stats->tables_memory.used_bytes +
+        stats->types_memory.used_bytes +
+        stats->stages_memory.used_bytes +
+        stats->systems_memory.used_bytes;
+
+    stats->total_memory.allocd_bytes =
+        stats->entities_memory.allocd_bytes +
+        stats->components_memory.allocd_bytes +
+        stats->tables_memory.allocd_bytes +
+        stats->types_memory.allocd_bytes +
+        stats->stages_memory.allocd_bytes +
+        stats->systems_memory.allocd_bytes;        
 }
 
-ecs_entity_t ecs_set_timeout(
-    ecs_world_t *world,
-    ecs_entity_t timer,
-    float timeout)
+static
+void StatsCollectSystemStats_StatusAction(
+    ecs_world_t *world, 
+    ecs_entity_t system,
+    ecs_system_status_t status, 
+    void *ctx)
 {
-    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
-
-    timer = ecs_set(world, timer, EcsTimer, {
-        .timeout = timeout,
-        .single_shot = true,
-        .active = true
-    });
+    (void)system;
+    (void)ctx;
 
-    EcsSystem *system_data = ecs_get_mut(world, timer, EcsSystem, NULL);
-    if (system_data) {
-        system_data->tick_source = timer;
+    if (status == EcsSystemActivated) {
+        ecs_measure_system_time(world, true);
+    } else if (status == EcsSystemDeactivated) {
+        ecs_measure_system_time(world, false);
     }
+}
 
-    return timer;
+static
+int32_t system_tables_matched(EcsSystem *system) {
+    return ecs_vector_count(system->query->tables) +
+           ecs_vector_count(system->query->empty_tables);
 }
 
-float ecs_get_timeout(
-    ecs_world_t *world,
-    ecs_entity_t timer)
-{
-    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(timer != 0, ECS_INVALID_PARAMETER, NULL);
+static
+int32_t system_entities_matched(EcsSystem *system) {
+    ecs_matched_table_t *tables = ecs_vector_first(system->query->tables, ecs_matched_table_t);
+    int32_t i, total = 0, count = ecs_vector_count(system->query->tables);
 
-    EcsTimer *value = ecs_get_mut(world, timer, EcsTimer, NULL);
-    if (value) {
-        return value->timeout;
-    } else {
-        return 0;
+    for (i = 0; i < count; i ++) {
+        if (tables[i].data.table) {
+            total += ecs_table_count(tables[i].data.table);
+        }
     }
-}
-
-ecs_entity_t ecs_set_interval(
-    ecs_world_t *world,
-    ecs_entity_t timer,
-    float interval)
-{
-    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
 
-    timer = ecs_set(world, timer, EcsTimer, {
-        .timeout = interval,
-        .active = true
-    });
+    return total;
+}
 
-    EcsSystem *system_data = ecs_get_mut(world, timer, EcsSystem, NULL);
-    if (system_data) {
-        system_data->tick_source = timer;
-    }  
+static
+void StatsCollectSystemStats(ecs_iter_t *it) {
+    EcsSystem *system = ecs_column(it, EcsSystem, 1);
+    ECS_COLUMN(it, EcsSystemStats, stats, 2);
 
-    return timer;  
-}
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_entity_t entity = it->entities[i];
 
-float ecs_get_interval(
-    ecs_world_t *world,
-    ecs_entity_t timer)
-{
-    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+        stats[i].entity = entity;
+        stats[i].name = ecs_get_name(it->world, entity);
+        stats[i].signature = system[i].query->sig.expr;
+        stats[i].phase = 0;
+        stats[i].tables_matched_count = system_tables_matched(&system[i]);
+        stats[i].entities_matched_count = system_entities_matched(&system[i]);
+        stats[i].period_seconds = ecs_get_interval(it->world, system[i].tick_source);
 
-    if (!timer) {
-        return 0;
-    }
+        /* Only add sample to latency window if system ran since the last time
+         * stats were collected, and stats were collected before */
+        if (stats[i].invoke_count_total &&
+            system[i].invoke_count > stats[i].invoke_count_total)
+        {
+            record_latency(&stats[i].latency, 
+                system[i].time_spent - stats[i].seconds_total);
+        }
 
-    EcsTimer *value = ecs_get_mut(world, timer, EcsTimer, NULL);
-    if (value) {
-        return value->timeout;
-    } else {
-        return 0;
+        stats[i].seconds_total = system[i].time_spent;
+        stats[i].invoke_count_total = system[i].invoke_count;
+        stats[i].is_enabled = !ecs_has_entity(it->world, entity, EcsDisabled);
+        stats[i].is_active = ecs_vector_count(system[i].query->tables) != 0;
+        stats[i].is_hidden = ecs_has_entity(it->world, entity, EcsHidden);
     }
 }
 
-void ecs_start_timer(
-    ecs_world_t *world,
-    ecs_entity_t timer)
+static
+void collect_system_table_metrics(
+    EcsSystem *system,
+    ecs_vector_t *tables,
+    ecs_memory_stat_t *stat)
 {
-    EcsTimer *ptr = ecs_get_mut(world, timer, EcsTimer, NULL);
-    ecs_assert(ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    int32_t column_count = ecs_vector_count(system->query->sig.columns);
 
-    ptr->active = true;
-    ptr->time = 0;
-}
+    ecs_vector_memory(tables, ecs_matched_table_t, 
+        &stat->allocd_bytes, &stat->used_bytes);
 
-void ecs_stop_timer(
-    ecs_world_t *world,
-    ecs_entity_t timer)
-{
-    EcsTimer *ptr = ecs_get_mut(world, timer, EcsTimer, NULL);
-    ecs_assert(ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    int32_t count = ecs_vector_count(tables);
 
-    ptr->active = false;
+    /* The 'column' member in ecs_matched_table_t */
+    stat->allocd_bytes += (ECS_SIZEOF(int32_t) * column_count) * count;
+    stat->used_bytes += (ECS_SIZEOF(int32_t) * column_count) * count;
+
+    /* The 'components' member of ecs_matched_table_t */
+    stat->allocd_bytes += (ECS_SIZEOF(ecs_entity_t) * column_count) * count;
+    stat->used_bytes += (ECS_SIZEOF(ecs_entity_t) * column_count) * count;
 }
 
-ecs_entity_t ecs_set_rate_filter(
-    ecs_world_t *world,
-    ecs_entity_t filter,
-    int32_t rate,
-    ecs_entity_t source)
-{
-    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+static
+void StatsCollectColSystemMemoryStats(ecs_iter_t *it) {
+    EcsSystem *system = ecs_column(it, EcsSystem, 1);
+    ECS_COLUMN(it, EcsSystemMemoryStats, stats, 2);
 
-    filter = ecs_set(world, filter, EcsRateFilter, {
-        .rate = rate,
-        .src = source
-    });
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        stats[i].base_memory_bytes = ECS_SIZEOF(EcsSystem);
+        stats[i].columns_memory = (ecs_memory_stat_t){0};
+        stats[i].active_tables_memory = (ecs_memory_stat_t){0};
+        stats[i].inactive_tables_memory = (ecs_memory_stat_t){0};
+        stats[i].jobs_memory = (ecs_memory_stat_t){0};
+        stats[i].other_memory_bytes = 0;
+        
+        ecs_vector_memory(system->query->sig.columns, ecs_sig_column_t, 
+            &stats[i].columns_memory.allocd_bytes, 
+            &stats[i].columns_memory.used_bytes);
 
-    EcsSystem *system_data = ecs_get_mut(world, filter, EcsSystem, NULL);
-    if (system_data) {
-        system_data->tick_source = filter;
-    }  
+        collect_system_table_metrics(system, system->query->tables, 
+            &stats[i].active_tables_memory);
 
-    return filter;     
+        collect_system_table_metrics(system, system->query->empty_tables, 
+            &stats[i].inactive_tables_memory);            
+
+        if (system->on_demand) {
+            stats[i].other_memory_bytes += ECS_SIZEOF(ecs_on_demand_out_t);
+        }
+    }
 }
 
-void ecs_set_tick_source(
+static
+void StatsCollectComponentStats_StatusAction(
     ecs_world_t *world,
     ecs_entity_t system,
-    ecs_entity_t tick_source)
+    ecs_system_status_t status,
+    void *ctx)
 {
-    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(system != 0, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(tick_source != 0, ECS_INVALID_PARAMETER, NULL);
-
-    EcsSystem *system_data = ecs_get_mut(world, system, EcsSystem, NULL);
-    ecs_assert(system_data != NULL, ECS_INVALID_PARAMETER, NULL);
+    (void)system;
+    (void)ctx;
 
-    system_data->tick_source = tick_source;
+    /* Tables maintain component statistics while the system is enabled, so
+     * that collecting them does not require walking all tables */
+    if (status == EcsSystemEnabled) {
+        ecs_track_component_stats(world, true);
+    } else if (status == EcsSystemDisabled) {
+        ecs_track_component_stats(world, false);
+    }
 }
 
-void FlecsTimerImport(
-    ecs_world_t *world)
-{    
-    ECS_MODULE(world, FlecsTimer);
-
-    ECS_IMPORT(world, FlecsPipeline);
-
-    ecs_set_name_prefix(world, "Ecs");
-
-    ecs_bootstrap_component(world, EcsTimer);
-    ecs_bootstrap_component(world, EcsRateFilter);
+static
+void StatsCollectComponentStats(ecs_iter_t *it) {
+    EcsComponent *component = ecs_column(it, EcsComponent, 1);
+    ECS_COLUMN(it, EcsComponentStats, stats, 2);
 
-    /* Add EcsTickSource to timers and rate filters */
-    ECS_SYSTEM(world, AddTickSource, EcsPreFrame, [in] Timer || RateFilter, [out] !flecs.system.TickSource);
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_entity_t entity = it->entities[i];
 
-    /* Timer handling */
-    ECS_SYSTEM(world, ProgressTimers, EcsPreFrame, Timer, flecs.system.TickSource);
+        stats[i].entity = entity;
+        stats[i].name = ecs_get_name(it->world, entity);
+        stats[i].size_bytes = component[i].size;
+        stats[i].tables_count = 0;
+        stats[i].entities_count = 0;
+        stats[i].memory = (ecs_memory_stat_t){0};
 
-    /* Rate filter handling */
-    ECS_SYSTEM(world, ProgressRateFilters, EcsPreFrame, [in] RateFilter, [out] flecs.system.TickSource);
+        const ecs_component_stats_t *cs = ecs_get_component_stats(
+            it->world, entity);
+        if (cs) {
+            stats[i].tables_count = cs->tables_count;
+            stats[i].entities_count = cs->entities_count;
+            stats[i].memory.used_bytes = cs->used_bytes;
+            stats[i].memory.allocd_bytes = cs->allocd_bytes;
+        }
+    }
 }
 
-#endif
-
-#ifdef FLECS_STATS
+static
+void StatsCollectTableStats_StatusAction(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    ecs_system_status_t status,
+    void *ctx)
+{
+    /* The context is the component id and not its type, so that it remains
+     * valid for worlds that are created from this world as a template */
+    ecs_entity_t ecs_typeid(EcsTablePtr) = (ecs_entity_t)(uintptr_t)ctx;
+    ecs_type_t ecs_type(EcsTablePtr) = ecs_type_from_entity(
+        world, ecs_typeid(EcsTablePtr));
 
+    (void)system;
 
-typedef struct EcsTablePtr {
-    ecs_table_t *table;
-} EcsTablePtr;
+    if (status == EcsSystemEnabled) {
+        /* Create an entity for every table */
+        ecs_sparse_t *tables = world->store.tables;
+        int32_t i, count = ecs_sparse_count(tables);
 
-/* -- Systems that add components on interest */
+        for (i = 0; i < count; i ++) {
+            ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+            ecs_set(world, 0, EcsTablePtr, {table});
+        }
+    } else if (status == EcsSystemDisabled) {
+        /* Delete all entities with EcsTable tag */
+        ecs_bulk_delete(world, &(ecs_filter_t){
+            .include = ecs_type(EcsTablePtr),
+            .include_kind = EcsMatchAny
+        });
+    }
+}
 
 static
-void StatsAddWorldStats(ecs_iter_t *it) {
-    ECS_COLUMN_COMPONENT(it, EcsWorldStats, 1);
+void collect_table_data_memory(
+    ecs_table_t *table,
+    EcsTableStats *stats)
+{
+    int32_t c, count = table->column_count;
+    ecs_data_t *data = ecs_table_get_data(table);
 
-    ecs_set(it->world, EcsWorld, EcsWorldStats, {0});
-}
+    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_column_t *columns = data->columns;
+    ecs_assert(columns != NULL, ECS_INTERNAL_ERROR, NULL);
 
-static
-void StatsAddAllocStats(ecs_iter_t *it) {
-    ECS_COLUMN_COMPONENT(it, EcsAllocStats, 1);
+    stats->entity_memory = (ecs_memory_stat_t){0};
 
-    ecs_set(it->world, EcsWorld, EcsAllocStats, {0});
-}
+    ecs_vector_memory(data->entities, ecs_entity_t, 
+        &stats->entity_memory.allocd_bytes, 
+        &stats->entity_memory.used_bytes);
 
-static
-void StatsAddMemoryStats(ecs_iter_t *it) {
-    ECS_COLUMN_COMPONENT(it, EcsMemoryStats, 1);
+    stats->component_memory = (ecs_memory_stat_t){0};
 
-    ecs_set(it->world, EcsWorld, EcsMemoryStats, {0});
+    for (c = 0; c < count; c ++) {
+        ecs_column_t *column = &columns[c];
+        ecs_vector_memory_t(column->data, column->size, column->alignment,
+            &stats->component_memory.allocd_bytes, 
+            &stats->component_memory.used_bytes);
+    }
 }
 
 static
-void StatsAddSystemStats(ecs_iter_t *it) {
-    ECS_COLUMN_COMPONENT(it, EcsSystemStats, 2);
-    
+void StatsCollectTableStats(ecs_iter_t *it) {
+    ECS_COLUMN(it, EcsTablePtr, table_ptr, 1);
+    ECS_COLUMN(it, EcsTableStats, stats, 2);
+
     int32_t i;
     for (i = 0; i < it->count; i ++) {
-        ecs_set(it->world, it->entities[i], EcsSystemStats, {0});
+        ecs_table_t *table = table_ptr[i].table;
+        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+        ecs_data_t *data = ecs_table_get_data(table);
+        ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+        ecs_column_t *columns = data->columns;
+        ecs_assert(columns != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        ecs_type_t type = table->type;
+        stats[i].type = table->type;
+        stats[i].columns_count = ecs_vector_count(type);
+        stats[i].rows_count = ecs_vector_count(columns[0].data);
+        stats[i].systems_matched_count = ecs_vector_count(table->queries);
+        stats[i].other_memory_bytes = 
+            ECS_SIZEOF(ecs_column_t) + ecs_vector_count(type) +
+            ECS_SIZEOF(ecs_entity_t) * ecs_vector_count(table->queries);
+
+        collect_table_data_memory(table, &stats[i]);
     }
 }
 
+/* Type instance counts are not maintained incrementally. A table matches a
+ * type if it has the type's components, including components inherited from
+ * a base, which can change after the table is created. Instances are counted
+ * by matching all tables each time stats are collected. */
 static
-void StatsAddColSystemMemoryStats(ecs_iter_t *it) {
-    ECS_COLUMN_COMPONENT(it, EcsSystemMemoryStats, 2);
-    
+void StatsCollectTypeStats(ecs_iter_t *it) {
+    EcsType *type_component = ecs_column(it, EcsType, 1);
+    ECS_COLUMN(it, EcsTypeStats, stats, 2);
+
+    ecs_world_t *world = it->world;
+
     int32_t i;
     for (i = 0; i < it->count; i ++) {
-        ecs_set(it->world, it->entities[i], EcsSystemMemoryStats, {0});
+        stats[i].name = ecs_get_name(world, it->entities[i]);
+        stats[i].entity = it->entities[i];
+        stats[i].type = type_component[i].type;
+        stats[i].normalized_type = type_component[i].normalized;
+        stats[i].is_hidden = ecs_has_entity(world, it->entities[i], EcsHidden);
+        stats[i].entities_count = 0;
+        stats[i].entities_childof_count = 0;
+        stats[i].entities_instanceof_count = 0;
+        stats[i].components_count = 0;
+        stats[i].col_systems_count = 0;
+        stats[i].row_systems_count = 0;
+        stats[i].enabled_systems_count = 0;
+        stats[i].active_systems_count = 0;
+        stats[i].instance_count = ecs_count_type(world, type_component[i].normalized);
+
+        int32_t j, count = ecs_vector_count(type_component[i].normalized);
+        ecs_entity_t *entities = ecs_vector_first(type_component[i].normalized, ecs_entity_t);
+        for (j = 0; j < count; j ++) {
+            ecs_entity_t e = entities[j];
+            bool has_flags = false;
+            
+            if (ECS_HAS_ROLE(e, CHILDOF)) {
+                stats[i].entities_childof_count ++;
+                has_flags = true;
+            }
+            if (ECS_HAS_ROLE(e, INSTANCEOF)) {
+                stats[i].entities_instanceof_count ++;
+                has_flags = true;
+            }
+            if (!has_flags) {
+                if (ecs_has(world, e, EcsComponent)) {
+                    stats[i].components_count ++;
+                } else
+                if (ecs_has(world, e, EcsSystem)) {
+                    stats[i].col_systems_count ++;
+                    if (!ecs_has_entity(world, e, EcsDisabled)) {
+                        stats[i].enabled_systems_count ++;
+                    }
+
+                    const EcsSystem *ptr = ecs_get(world, e, EcsSystem);
+                    if (ecs_vector_count(ptr->query->tables)) {
+                        stats[i].active_systems_count ++;
+                    }
+                } else {
+                    stats[i].entities_count ++;
+                }
+            }
+        }
     }
 }
 
-static
-void StatsAddComponentStats(ecs_iter_t *it) {
-    ECS_COLUMN_COMPONENT(it, EcsComponentStats, 2);
-    
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_set(it->world, it->entities[i], EcsComponentStats, {0});
-    }
-}
+/* -- Module import function -- */
+
+void FlecsStatsImport(
+    ecs_world_t *world)
+{    
+    ECS_MODULE(world, FlecsStats);
+
+    ECS_IMPORT(world, FlecsPipeline);
+
+    ecs_set_name_prefix(world, "Ecs");
+
+    ECS_COMPONENT(world, EcsAllocStats);
+    ECS_COMPONENT(world, EcsWorldStats);
+    ECS_COMPONENT(world, EcsMemoryStats);
+    ECS_COMPONENT(world, EcsSystemStats);
+    ECS_COMPONENT(world, EcsSystemMemoryStats);
+    ECS_COMPONENT(world, EcsRowSystemMemoryStats);
+    ECS_COMPONENT(world, EcsComponentStats);
+    ECS_COMPONENT(world, EcsTableStats);
+    ECS_COMPONENT(world, EcsTablePtr);
+    ECS_COMPONENT(world, EcsTypeStats);
+    
+    ECS_ENTITY(world, EcsStatsSkipCollect, 0);
+
+    /* -- Helper systems -- */
+
+    ECS_SYSTEM(world, StatsCollectColSystemMemoryTotals, 0, 
+        [in] EcsSystemMemoryStats,
+        [out] World:EcsMemoryStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+
+    ECS_SYSTEM(world, StatsCollectTableMemoryTotals, 0, 
+        [in] EcsTableStats,
+        [out] World:EcsMemoryStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+
+    /* -- Component creation systems -- */
+
+    ECS_SYSTEM(world, StatsAddWorldStats, EcsOnStore, [out] !World:EcsWorldStats, 
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+
+    ECS_SYSTEM(world, StatsAddAllocStats, EcsOnStore, [out] !World:EcsAllocStats, 
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+
+    ECS_SYSTEM(world, StatsAddMemoryStats, EcsPostLoad, [out] !World:EcsMemoryStats, 
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+
+    ECS_SYSTEM(world, StatsAddSystemStats, EcsOnStore,
+        flecs.system.EcsSystem, [out] !EcsSystemStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden, 
+        SYSTEM:EcsStatsSkipCollect, !EcsStatsSkipCollect);
+
+    ECS_SYSTEM(world, StatsAddColSystemMemoryStats, EcsOnStore,
+        flecs.system.EcsSystem, [out] !EcsSystemMemoryStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden, 
+        SYSTEM:EcsStatsSkipCollect, !EcsStatsSkipCollect);
+
+    ECS_SYSTEM(world, StatsAddComponentStats, EcsOnStore,
+        EcsComponent, [out] !EcsComponentStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+
+    ECS_SYSTEM(world, StatsAddTableStats, EcsOnStore,
+        EcsTablePtr, [out] !EcsTableStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
 
-static
-void StatsAddTableStats(ecs_iter_t *it) {
-    ECS_COLUMN_COMPONENT(it, EcsTableStats, 2);
-    
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_set(it->world, it->entities[i], EcsTableStats, {0});
-    }
-}
+    ECS_SYSTEM(world, StatsAddTypeStats, EcsOnStore,
+        EcsType, [out] !EcsTypeStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
 
-static
-void StatsAddTypeStats(ecs_iter_t *it) {
-    ECS_COLUMN_COMPONENT(it, EcsTypeStats, 2);
-    
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_set(it->world, it->entities[i], EcsTypeStats, {0});
-    }
-}
+    /* -- Metrics collection systems -- */
 
-/* -- Systems that collect metrics on interest -- */
+    ECS_SYSTEM(world, StatsCollectWorldStats, EcsPostLoad,
+        [out] EcsWorldStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
 
-static
-void StatsCollectWorldStats_StatusAction(
-    ecs_world_t *world, 
-    ecs_entity_t system,
-    ecs_system_status_t status, 
-    void *ctx)
-{
-    (void)system;
-    (void)ctx;
+    /* This handler enables frame time monitoring when system is activated */
+    ecs_set_system_status_action(
+        world, StatsCollectWorldStats, StatsCollectWorldStats_StatusAction, NULL);
 
-    if (status == EcsSystemActivated) {
-        ecs_measure_frame_time(world, true);
-    } else if (status == EcsSystemDeactivated) {
-        ecs_measure_frame_time(world, false);
-    }
-}
+    ECS_SYSTEM(world, StatsCollectAllocStats, EcsPostLoad,
+        [out] EcsAllocStats, 
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
 
-static
-void StatsCollectWorldStats(ecs_iter_t *it) {
-    ECS_COLUMN(it, EcsWorldStats, stats, 1);
+    ECS_SYSTEM(world, StatsCollectMemoryStats, EcsPostLoad,
+        [out] EcsMemoryStats,
+        :StatsCollectColSystemMemoryTotals,
+        :StatsCollectTableMemoryTotals,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);      
 
-    ecs_world_t *world = it->world;
+    ECS_SYSTEM(world, StatsCollectSystemStats, EcsPostLoad,
+        flecs.system.EcsSystem, [out] EcsSystemStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
 
-    stats->entities_count = ecs_eis_count(world);
-    stats->components_count = ecs_count(world, EcsComponent);
-    stats->col_systems_count = ecs_count(world, EcsSystem);
-    stats->tables_count = ecs_sparse_count(world->store.tables);
-    stats->threads_count = ecs_vector_count(world->workers);
-    
-    stats->frame_seconds_total = world->stats.frame_time_total;
-    stats->system_seconds_total = world->stats.system_time_total;
-    stats->merge_seconds_total = world->stats.merge_time_total;
-    stats->world_seconds_total = world->stats.world_time_total;
-    stats->target_fps_hz = world->stats.target_fps;
-    stats->frame_count_total = world->stats.frame_count_total;
-}
+    /* This handler enables system time monitoring when system is activated */
+    ecs_set_system_status_action(
+        world, StatsCollectSystemStats, StatsCollectSystemStats_StatusAction, NULL);
 
-static
-void StatsCollectAllocStats(ecs_iter_t *it) {
-    ECS_COLUMN(it, EcsAllocStats, stats, 1);
+    ECS_SYSTEM(world, StatsCollectColSystemMemoryStats, EcsPostLoad,
+        flecs.system.EcsSystem, [out] EcsSystemMemoryStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
 
-    stats->malloc_count_total = ecs_os_api_malloc_count;
-    stats->calloc_count_total = ecs_os_api_calloc_count;
-    stats->realloc_count_total = ecs_os_api_realloc_count;
-    stats->free_count_total = ecs_os_api_free_count;
-}
+    ECS_SYSTEM(world, StatsCollectComponentStats, EcsPostLoad,
+        EcsComponent, [out] EcsComponentStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
 
-static
-void StatsCollectColSystemMemoryTotals(ecs_iter_t *it) {
-    ECS_COLUMN(it, EcsSystemMemoryStats, stats, 1);
+    /* This handler enables tracking of component stats when system is enabled */
+    ecs_set_system_status_action(
+        world, StatsCollectComponentStats, 
+        StatsCollectComponentStats_StatusAction, NULL);
 
-    ecs_memory_stat_t *stat = it->param;
+    ECS_SYSTEM(world, StatsCollectTableStats, EcsPostLoad,
+        EcsTablePtr, [out] EcsTableStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
 
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        stat->allocd_bytes += 
-            stats[i].base_memory_bytes +
-            stats[i].columns_memory.allocd_bytes +
-            stats[i].active_tables_memory.allocd_bytes +
-            stats[i].inactive_tables_memory.allocd_bytes +
-            stats[i].jobs_memory.allocd_bytes +
-            stats[i].other_memory_bytes;
+    /* This handler creates entities for tables when system is enabled */
+    ecs_set_system_status_action(
+        world, StatsCollectTableStats, StatsCollectTableStats_StatusAction, 
+        (void*)(uintptr_t)ecs_typeid(EcsTablePtr));
 
-        stat->used_bytes += 
-            stats[i].base_memory_bytes +
-            stats[i].columns_memory.used_bytes +
-            stats[i].active_tables_memory.used_bytes +
-            stats[i].inactive_tables_memory.used_bytes +
-            stats[i].jobs_memory.used_bytes +
-            stats[i].other_memory_bytes;            
-    }
+    ECS_SYSTEM(world, StatsCollectTypeStats, EcsPostLoad,
+        EcsType, [out] EcsTypeStats,
+        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+
+    /* Export components to module */
+    ECS_EXPORT_COMPONENT(EcsAllocStats);
+    ECS_EXPORT_COMPONENT(EcsWorldStats);
+    ECS_EXPORT_COMPONENT(EcsMemoryStats);
+    ECS_EXPORT_COMPONENT(EcsSystemStats);
+    ECS_EXPORT_COMPONENT(EcsSystemMemoryStats);
+    ECS_EXPORT_COMPONENT(EcsComponentStats);
+    ECS_EXPORT_COMPONENT(EcsTableStats);
+    ECS_EXPORT_COMPONENT(EcsTablePtr);
+    ECS_EXPORT_COMPONENT(EcsTypeStats);
 }
 
-static
-void StatsCollectTableMemoryTotals(ecs_iter_t *it) {
-    ECS_COLUMN(it, EcsTableStats, stats, 1);
+#endif
 
-    EcsMemoryStats *world_stats = it->param;
+#ifdef FLECS_SYSTEM
 
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        world_stats->components_memory.used_bytes += stats[i].component_memory.used_bytes;
-        world_stats->components_memory.allocd_bytes += stats[i].component_memory.allocd_bytes;
 
-        world_stats->entities_memory.used_bytes += stats[i].entity_memory.used_bytes;
-        world_stats->entities_memory.allocd_bytes += stats[i].entity_memory.allocd_bytes;
+/* Global type variables */
+ECS_TYPE_DECL(EcsComponentLifecycle);
+ECS_TYPE_DECL(EcsTrigger);
+ECS_TYPE_DECL(EcsSystem);
+ECS_TYPE_DECL(EcsTickSource);
+ECS_TYPE_DECL(EcsSignatureExpr);
+ECS_TYPE_DECL(EcsSignature);
+ECS_TYPE_DECL(EcsQuery);
+ECS_TYPE_DECL(EcsIterAction);
+ECS_TYPE_DECL(EcsContext);
 
-        world_stats->tables_memory.used_bytes += stats[i].other_memory_bytes;
-        world_stats->tables_memory.allocd_bytes += stats[i].other_memory_bytes; 
+static
+ecs_on_demand_in_t* get_in_component(
+    ecs_map_t *component_map,
+    ecs_entity_t component)
+{
+    ecs_on_demand_in_t *in = ecs_map_get(
+        component_map, ecs_on_demand_in_t, component);
+    if (!in) {
+        ecs_on_demand_in_t in_value = {0};
+        ecs_map_set(component_map, component, &in_value);
+        in = ecs_map_get(component_map, ecs_on_demand_in_t, component);
+        ecs_assert(in != NULL, ECS_INTERNAL_ERROR, NULL);
     }
+
+    return in;
 }
 
 static
-void compute_world_memory(
+void activate_in_columns(
     ecs_world_t *world,
-    EcsMemoryStats *stats)
+    ecs_query_t *query,
+    ecs_map_t *component_map,
+    bool activate)
 {
-    stats->world_memory.used_bytes = 
-    stats->world_memory.allocd_bytes = ECS_SIZEOF(ecs_world_t);
+    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
+    int32_t i, count = ecs_vector_count(query->sig.columns);
 
-    /* Add memory spent on worker threads to world memory */
-    ecs_vector_memory(world->workers, ecs_thread_t,
-        &stats->world_memory.allocd_bytes, &stats->world_memory.used_bytes);
+    for (i = 0; i < count; i ++) {
+        if (columns[i].inout_kind == EcsIn) {
+            ecs_on_demand_in_t *in = get_in_component(
+                component_map, columns[i].is.component);
+            ecs_assert(in != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    /* Add memory spent on on demand lookup structures to system memory */
-    ecs_map_memory(world->on_enable_components, 
-        &stats->systems_memory.allocd_bytes, &stats->systems_memory.used_bytes);        
-    ecs_map_memory(world->on_activate_components,
-        &stats->systems_memory.allocd_bytes, &stats->systems_memory.used_bytes);     
+            in->count += activate ? 1 : -1;
 
-    ecs_vector_memory(world->fini_tasks, ecs_entity_t,
-        &stats->systems_memory.allocd_bytes, &stats->systems_memory.used_bytes);
+            ecs_assert(in->count >= 0, ECS_INTERNAL_ERROR, NULL);
 
-    /* Add table array to table memory */
-    ecs_sparse_memory(world->store.tables,
-        &stats->tables_memory.allocd_bytes, &stats->tables_memory.used_bytes);
+            /* If this is the first system that registers the in component, walk
+             * over all already registered systems to enable them */
+            if (in->systems && 
+               ((activate && in->count == 1) || 
+                (!activate && !in->count))) 
+            {
+                ecs_on_demand_out_t **out = ecs_vector_first(
+                    in->systems, ecs_on_demand_out_t*);
+                int32_t s, in_count = ecs_vector_count(in->systems);
 
-    /* Add misc lookup indices to world memory */
-    ecs_map_memory(world->type_handles, 
-        &stats->world_memory.allocd_bytes, &stats->world_memory.used_bytes);   
+                for (s = 0; s < in_count; s ++) {
+                    /* Increase the count of the system with the out params */
+                    out[s]->count += activate ? 1 : -1;
+                    
+                    /* If this is the first out column that is requested from
+                     * the OnDemand system, enable it */
+                    if (activate && out[s]->count == 1) {
+                        ecs_remove_entity(world, out[s]->system, EcsDisabledIntern);
+                    } else if (!activate && !out[s]->count) {
+                        ecs_add_entity(world, out[s]->system, EcsDisabledIntern);             
+                    }
+                }
+            }
+        }
+    }    
+}
 
-    stats->stages_memory = (ecs_memory_stat_t){0};
-    
-    /* Compute memory used in temporary stage */
-    stats->stages_memory.used_bytes += ECS_SIZEOF(ecs_stage_t);
-    stats->stages_memory.allocd_bytes += ECS_SIZEOF(ecs_stage_t);    
+static
+void register_out_column(
+    ecs_map_t *component_map,
+    ecs_entity_t component,
+    ecs_on_demand_out_t *on_demand_out)
+{
+    ecs_on_demand_in_t *in = get_in_component(component_map, component);
+    ecs_assert(in != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    /* Add memory used / allocated by worker_stages array */
-    ecs_vector_memory(world->worker_stages, ecs_stage_t,
-        &stats->stages_memory.allocd_bytes, &stats->stages_memory.used_bytes);
+    on_demand_out->count += in->count;
+    ecs_on_demand_out_t **elem = ecs_vector_add(&in->systems, ecs_on_demand_out_t*);
+    *elem = on_demand_out;
 }
 
 static
-void StatsCollectMemoryStats(ecs_iter_t *it) {
-    ECS_COLUMN(it, EcsMemoryStats, stats, 1);
-    ECS_COLUMN_ENTITY(it, StatsCollectColSystemMemoryTotals, 2);
-    ECS_COLUMN_ENTITY(it, StatsCollectTableMemoryTotals, 3);
+void register_out_columns(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    EcsSystem *system_data)
+{
+    ecs_query_t *query = system_data->query;
+    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
+    int32_t i, out_count = 0, count = ecs_vector_count(query->sig.columns);
 
-    ecs_world_t *world = it->world;
+    for (i = 0; i < count; i ++) {
+        if (columns[i].inout_kind == EcsOut) {
+            if (!system_data->on_demand) {
+                system_data->on_demand = ecs_os_malloc(sizeof(ecs_on_demand_out_t));
+                ecs_assert(system_data->on_demand != NULL, ECS_OUT_OF_MEMORY, NULL);
 
-    /* Compute entity memory (entity index) */
-    stats->entities_memory = (ecs_memory_stat_t){0};
-    
-    ecs_eis_memory(world, 
-        &stats->entities_memory.allocd_bytes, 
-        &stats->entities_memory.used_bytes);
-    
-    /* Compute entity (entity columns), component and table memory */
-    stats->components_memory = (ecs_memory_stat_t){0};
-    stats->tables_memory = (ecs_memory_stat_t){0};
-    ecs_run(world, StatsCollectTableMemoryTotals, 0, stats);
+                system_data->on_demand->system = system;
+                system_data->on_demand->count = 0;
+            }
 
-    /* Compute system memory */
-    stats->systems_memory = (ecs_memory_stat_t){0};
-    ecs_run(world, StatsCollectColSystemMemoryTotals, 0, &stats->systems_memory);
+            /* If column operator is NOT and the inout kind is [out], the system
+             * explicitly states that it will create the component (it is not
+             * there, yet it is an out column). In this case it doesn't make
+             * sense to wait until [in] columns get activated (matched with
+             * entities) since the component is not there yet. Therefore add it
+             * to the on_enable_components list, so this system will be enabled
+             * when a [in] column is enabled, rather than activated */
+            ecs_map_t *component_map;
+            if (columns[i].oper_kind == EcsOperNot) {
+                component_map = world->on_enable_components;
+            } else {
+                component_map = world->on_activate_components;
+            }
 
-    /* Compute world memory */
-    compute_world_memory(world, stats);
+            register_out_column(
+                component_map, columns[i].is.component, 
+                system_data->on_demand);
 
-    /* Add everything up to compute total memory */
-    stats->total_memory.used_bytes =
-        stats->entities_memory.used_bytes +
-        stats->components_memory.used_bytes +
-        stats->tables_memory.used_bytes +
-        stats->types_memory.used_bytes +
-        stats->stages_memory.used_bytes +
-        stats->systems_memory.used_bytes;
+            out_count ++;
+        }
+    }
 
-    stats->total_memory.allocd_bytes =
-        stats->entities_memory.allocd_bytes +
-        stats->components_memory.allocd_bytes +
-        stats->tables_memory.allocd_bytes +
-        stats->types_memory.allocd_bytes +
-        stats->stages_memory.allocd_bytes +
-        stats->systems_memory.allocd_bytes;        
+    /* If there are no out columns in the on-demand system, the system will
+     * never be enabled */
+    ecs_assert(out_count != 0, ECS_NO_OUT_COLUMNS, ecs_get_name(world, system));
 }
 
 static
-void StatsCollectSystemStats_StatusAction(
-    ecs_world_t *world, 
+void invoke_status_action(
+    ecs_world_t *world,
     ecs_entity_t system,
-    ecs_system_status_t status, 
-    void *ctx)
+    const EcsSystem *system_data,
+    ecs_system_status_t status)
 {
-    (void)system;
-    (void)ctx;
-
-    if (status == EcsSystemActivated) {
-        ecs_measure_system_time(world, true);
-    } else if (status == EcsSystemDeactivated) {
-        ecs_measure_system_time(world, false);
+    ecs_system_status_action_t action = system_data->status_action;
+    if (action) {
+        action(world, system, status, system_data->status_ctx);
     }
 }
 
-static
-int32_t system_tables_matched(EcsSystem *system) {
-    return ecs_vector_count(system->query->tables) +
-           ecs_vector_count(system->query->empty_tables);
-}
+/* Invoked when system becomes active or inactive */
+void ecs_system_activate(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    bool activate,
+    const EcsSystem *system_data)
+{
+    ecs_assert(!world->in_progress, ECS_INTERNAL_ERROR, NULL);
 
-static
-int32_t system_entities_matched(EcsSystem *system) {
-    ecs_matched_table_t *tables = ecs_vector_first(system->query->tables, ecs_matched_table_t);
-    int32_t i, total = 0, count = ecs_vector_count(system->query->tables);
+    if (activate) {
+        ecs_remove_entity(world, system, EcsInactive);
+    }
 
-    for (i = 0; i < count; i ++) {
-        if (tables[i].data.table) {
-            total += ecs_table_count(tables[i].data.table);
-        }
+    if (!system_data) {
+        system_data = ecs_get(world, system, EcsSystem);
+    }
+    if (!system_data || !system_data->query) {
+        return;
     }
 
-    return total;
+    /* If system contains in columns, signal that they are now in use */
+    activate_in_columns(
+        world, system_data->query, world->on_activate_components, activate);
+
+    /* Invoke system status action */
+    invoke_status_action(world, system, system_data, 
+        activate ? EcsSystemActivated : EcsSystemDeactivated);
+
+    ecs_trace_2("system #[green]%s#[reset] %s", 
+        ecs_get_name(world, system), 
+        activate ? "activated" : "deactivated");
 }
 
-static
-void StatsCollectSystemStats(ecs_iter_t *it) {
-    EcsSystem *system = ecs_column(it, EcsSystem, 1);
-    ECS_COLUMN(it, EcsSystemStats, stats, 2);
+/* Actually enable or disable system */
+void ecs_enable_system(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    EcsSystem *system_data,
+    bool enabled)
+{
+    ecs_assert(!world->in_progress, ECS_INTERNAL_ERROR, NULL);
 
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_entity_t entity = it->entities[i];
+    ecs_query_t *query = system_data->query;
+    if (!query) {
+        return;
+    }
 
-        stats[i].entity = entity;
-        stats[i].name = ecs_get_name(it->world, entity);
-        stats[i].signature = system[i].query->sig.expr;
-        stats[i].phase = 0;
-        stats[i].tables_matched_count = system_tables_matched(&system[i]);
-        stats[i].entities_matched_count = system_entities_matched(&system[i]);
-        stats[i].period_seconds = ecs_get_interval(it->world, system[i].tick_source);
-        stats[i].seconds_total = system[i].time_spent;
-        stats[i].invoke_count_total = system[i].invoke_count;
-        stats[i].is_enabled = !ecs_has_entity(it->world, entity, EcsDisabled);
-        stats[i].is_active = ecs_vector_count(system[i].query->tables) != 0;
-        stats[i].is_hidden = ecs_has_entity(it->world, entity, EcsHidden);
+    if (ecs_vector_count(query->tables)) {
+        /* Only (de)activate system if it has non-empty tables. */
+        ecs_system_activate(world, system, enabled, system_data);
+        system_data = ecs_get_mut(world, system, EcsSystem, NULL);
     }
+
+    /* Enable/disable systems that trigger on [in] enablement */
+    activate_in_columns(
+        world, 
+        query, 
+        world->on_enable_components, 
+        enabled);
+    
+    /* Invoke action for enable/disable status */
+    invoke_status_action(
+        world, system, system_data,
+        enabled ? EcsSystemEnabled : EcsSystemDisabled);
 }
 
-static
-void collect_system_table_metrics(
-    EcsSystem *system,
-    ecs_vector_t *tables,
-    ecs_memory_stat_t *stat)
+void ecs_init_system(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    ecs_iter_action_t action,
+    ecs_query_t *query,
+    void *ctx)
 {
-    int32_t column_count = ecs_vector_count(system->query->sig.columns);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-    ecs_vector_memory(tables, ecs_matched_table_t, 
-        &stat->allocd_bytes, &stat->used_bytes);
+    /* Add & initialize the EcsSystem component */
+    bool is_added = false;
+    EcsSystem *sptr = ecs_get_mut(world, system, EcsSystem, &is_added);
+    ecs_assert(sptr != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    int32_t count = ecs_vector_count(tables);
+    if (!is_added) {
+        ecs_assert(sptr->query == query, ECS_INVALID_PARAMETER, NULL);
+    } else {
+        memset(sptr, 0, sizeof(EcsSystem));
+        sptr->query = query;
+        sptr->entity = system;
+        sptr->tick_source = 0;
+        sptr->time_spent = 0;
+    }
 
-    /* The 'column' member in ecs_matched_table_t */
-    stat->allocd_bytes += (ECS_SIZEOF(int32_t) * column_count) * count;
-    stat->used_bytes += (ECS_SIZEOF(int32_t) * column_count) * count;
+    /* Sanity check to make sure creating the query didn't add any additional
+     * tags or components to the system */
+    sptr->action = action;
+    sptr->ctx = ctx;
 
-    /* The 'components' member of ecs_matched_table_t */
-    stat->allocd_bytes += (ECS_SIZEOF(ecs_entity_t) * column_count) * count;
-    stat->used_bytes += (ECS_SIZEOF(ecs_entity_t) * column_count) * count;
-}
+    /* Only run this code when the system is created for the first time */
+    if (is_added) {
+        /* If tables have been matched with this system it is active, and we
+         * should activate the in-columns, if any. This will ensure that any
+         * OnDemand systems get enabled. */
+        if (ecs_vector_count(query->tables)) {
+            ecs_system_activate(world, system, true, sptr);
+        } else {
+            /* If system isn't matched with any tables, mark it as inactive. This
+             * causes it to be ignored by the main loop. When the system matches
+             * with a table it will be activated. */
+            ecs_add_entity(world, system, EcsInactive);
+        }
 
-static
-void StatsCollectColSystemMemoryStats(ecs_iter_t *it) {
-    EcsSystem *system = ecs_column(it, EcsSystem, 1);
-    ECS_COLUMN(it, EcsSystemMemoryStats, stats, 2);
+        /* If system is enabled, trigger enable components */
+        activate_in_columns(world, query, world->on_enable_components, true);
 
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        stats[i].base_memory_bytes = ECS_SIZEOF(EcsSystem);
-        stats[i].columns_memory = (ecs_memory_stat_t){0};
-        stats[i].active_tables_memory = (ecs_memory_stat_t){0};
-        stats[i].inactive_tables_memory = (ecs_memory_stat_t){0};
-        stats[i].jobs_memory = (ecs_memory_stat_t){0};
-        stats[i].other_memory_bytes = 0;
-        
-        ecs_vector_memory(system->query->sig.columns, ecs_sig_column_t, 
-            &stats[i].columns_memory.allocd_bytes, 
-            &stats[i].columns_memory.used_bytes);
+        /* Check if all non-table column constraints are met. If not, disable
+         * system (system will be enabled once constraints are met) */
+        if (!ecs_sig_check_constraints(world, &query->sig)) {
+            ecs_add_entity(world, system, EcsDisabledIntern);
+        }
 
-        collect_system_table_metrics(system, system->query->tables, 
-            &stats[i].active_tables_memory);
+        /* If the query has a OnDemand system tag, register its [out] columns */
+        if (ecs_has_entity(world, system, EcsOnDemand)) {
+            register_out_columns(world, system, sptr);
+            ecs_assert(sptr->on_demand != NULL, ECS_INTERNAL_ERROR, NULL);
 
-        collect_system_table_metrics(system, system->query->empty_tables, 
-            &stats[i].inactive_tables_memory);            
+            /* If there are no systems currently interested in any of the [out]
+             * columns of the on demand system, disable it */
+            if (!sptr->on_demand->count) {
+                ecs_add_entity(world, system, EcsDisabledIntern);
+            }        
+        }
 
-        if (system->on_demand) {
-            stats[i].other_memory_bytes += ECS_SIZEOF(ecs_on_demand_out_t);
+        /* Check if system has out columns */
+        int32_t i, count = ecs_vector_count(query->sig.columns);
+        ecs_sig_column_t *columns = ecs_vector_first(
+                query->sig.columns, ecs_sig_column_t);
+        
+        for (i = 0; i < count; i ++) {
+            if (columns[i].inout_kind != EcsIn) {
+                break;
+            }
         }
     }
-}
-
-static
-void StatsCollectComponentStats(ecs_iter_t *it) {
-    EcsComponent *component = ecs_column(it, EcsComponent, 1);
-    ECS_COLUMN(it, EcsComponentStats, stats, 2);
 
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_entity_t entity = it->entities[i];
+    ecs_trace_1("system #[green]%s#[reset] created with #[red]%s", 
+        ecs_get_name(world, system), query->sig.expr);
+}
 
-        stats[i].entity = entity;
-        stats[i].name = ecs_get_name(it->world, entity);
-        stats[i].size_bytes = component[i].size;
-        
-        /* Reset values */
-        stats[i].tables_count = 0;
-        stats[i].entities_count = 0;
-        stats[i].memory = (ecs_memory_stat_t){0};
 
-        /* Walk tables to collect memory and entity stats per component */
-        ecs_sparse_t *tables = it->world->store.tables;
-        int32_t t, count = ecs_sparse_count(it->world->store.tables);
+void ecs_col_system_free(
+    EcsSystem *system_data)
+{
+    ecs_query_free(system_data->query);
+}
 
-        for (t = 0; t < count; t ++) {
-            ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, t);
-            ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
-            int32_t c, c_count = table->column_count;
+/* -- Public API -- */
 
-            /* Iterate over table columns until component is found */
-            ecs_data_t *data = ecs_table_get_data(table);
-            ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
-            ecs_column_t *columns = data->columns;
-            ecs_assert(columns != NULL, ECS_INTERNAL_ERROR, NULL);
+void ecs_enable(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    bool enabled)
+{
+    assert(world->magic == ECS_WORLD_MAGIC);
 
-            for (c = 0; c < c_count; c ++) {
-                if (components[c] == entity) {
-                    ecs_vector_t *column = columns[c].data;
-                    stats[i].tables_count ++;
-                    stats[i].entities_count += ecs_vector_count(column);
-                    ecs_vector_memory_t(column, columns[c].size, columns[c].alignment, 
-                        &stats[i].memory.allocd_bytes, 
-                        &stats[i].memory.used_bytes);
-                    break;
-                }
-            }
+    const EcsType *type_ptr = ecs_get( world, entity, EcsType);
+    if (type_ptr) {
+        /* If entity is a type, disable all entities in the type */
+        ecs_vector_each(type_ptr->normalized, ecs_entity_t, e, {
+            ecs_enable(world, *e, enabled);
+        });
+    } else {
+        if (enabled) {
+            ecs_remove_entity(world, entity, EcsDisabled);
+        } else {
+            ecs_add_entity(world, entity, EcsDisabled);
         }
     }
 }
 
-static
-void StatsCollectTableStats_StatusAction(
+void ecs_set_system_status_action(
     ecs_world_t *world,
     ecs_entity_t system,
-    ecs_system_status_t status,
-    void *ctx)
+    ecs_system_status_action_t action,
+    const void *ctx)
 {
-    ecs_type_t ecs_type(EcsTablePtr) = ctx;
-    ecs_entity_t ecs_typeid(EcsTablePtr) = ecs_type_to_entity(world, ecs_type(EcsTablePtr));
+    EcsSystem *system_data = ecs_get_mut(world, system, EcsSystem, NULL);
+    ecs_assert(system_data != NULL, ECS_INVALID_PARAMETER, NULL);
 
-    (void)system;
+    system_data->status_action = action;
+    system_data->status_ctx = (void*)ctx;
 
-    if (status == EcsSystemEnabled) {
-        /* Create an entity for every table */
-        ecs_sparse_t *tables = world->store.tables;
-        int32_t i, count = ecs_sparse_count(tables);
+    if (!ecs_has_entity(world, system, EcsDisabled)) {
+        /* If system is already enabled, generate enable status. The API 
+         * should guarantee that it exactly matches enable-disable 
+         * notifications and activate-deactivate notifications. */
+        invoke_status_action(world, system, system_data, EcsSystemEnabled);
 
-        for (i = 0; i < count; i ++) {
-            ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
-            ecs_set(world, 0, EcsTablePtr, {table});
+        /* If column system has active (non-empty) tables, also generate the
+         * activate status. */
+        if (ecs_vector_count(system_data->query->tables)) {
+            invoke_status_action(
+                world, system, system_data, EcsSystemActivated);
         }
-    } else if (status == EcsSystemDisabled) {
-        /* Delete all entities with EcsTable tag */
-        ecs_bulk_delete(world, &(ecs_filter_t){
-            .include = ecs_type(EcsTablePtr),
-            .include_kind = EcsMatchAny
-        });
     }
 }
 
-static
-void collect_table_data_memory(
-    ecs_table_t *table,
-    EcsTableStats *stats)
+void ecs_set_system_budget(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    int32_t entity_budget,
+    float time_budget)
 {
-    int32_t c, count = table->column_count;
-    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_assert(entity_budget >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(time_budget >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(time_budget == 0 || ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
 
-    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_column_t *columns = data->columns;
-    ecs_assert(columns != NULL, ECS_INTERNAL_ERROR, NULL);
+    EcsSystem *system_data = ecs_get_mut(world, system, EcsSystem, NULL);
+    ecs_assert(system_data != NULL, ECS_INVALID_PARAMETER, NULL);
 
-    stats->entity_memory = (ecs_memory_stat_t){0};
+    system_data->entity_budget = entity_budget;
+    system_data->time_budget = time_budget;
+    system_data->cursor = 0;
+}
 
-    ecs_vector_memory(data->entities, ecs_entity_t, 
-        &stats->entity_memory.allocd_bytes, 
-        &stats->entity_memory.used_bytes);
+/* Invoke system for batches until its budget is exhausted */
+static
+bool run_batches(
+    EcsSystem *system_data,
+    ecs_iter_t *it,
+    const ecs_filter_t *filter,
+    ecs_time_t *time_start,
+    int32_t *processed)
+{
+    ecs_iter_action_t action = system_data->action;
+    int32_t entity_budget = system_data->entity_budget;
+    float time_budget = system_data->time_budget;
 
-    stats->component_memory = (ecs_memory_stat_t){0};
+    while (ecs_query_next_w_filter(it, filter)) {
+        bool exhausted = false;
+        if (entity_budget && (*processed + it->count) >= entity_budget) {
+            it->count = entity_budget - *processed;
+            exhausted = true;
+        }
 
-    for (c = 0; c < count; c ++) {
-        ecs_column_t *column = &columns[c];
-        ecs_vector_memory_t(column->data, columns->size, columns->alignment,
-            &stats->component_memory.allocd_bytes, 
-            &stats->component_memory.used_bytes);
+        action(it);
+        (*processed) += it->count;
+
+        if (time_budget > 0) {
+            ecs_time_t t = *time_start;
+            if (ecs_time_measure(&t) >= time_budget) {
+                exhausted = true;
+            }
+        }
+
+        if (exhausted) {
+            return true;
+        }
     }
+
+    return false;
 }
 
+/* Run system with a budget, and store where the next run should resume */
 static
-void StatsCollectTableStats(ecs_iter_t *it) {
-    ECS_COLUMN(it, EcsTablePtr, table_ptr, 1);
-    ECS_COLUMN(it, EcsTableStats, stats, 2);
+void run_budgeted(
+    EcsSystem *system_data,
+    ecs_iter_t *it,
+    const ecs_filter_t *filter)
+{
+    ecs_time_t time_start = {0};
+    if (system_data->time_budget > 0) {
+        ecs_os_get_time(&time_start);
+    }
 
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_table_t *table = table_ptr[i].table;
-        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
-        ecs_data_t *data = ecs_table_get_data(table);
-        ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
-        ecs_column_t *columns = data->columns;
-        ecs_assert(columns != NULL, ECS_INTERNAL_ERROR, NULL);
+    int32_t offset = system_data->cursor, processed = 0;
+    bool exhausted = run_batches(
+        system_data, it, filter, &time_start, &processed);
 
-        ecs_type_t type = table->type;
-        stats[i].type = table->type;
-        stats[i].columns_count = ecs_vector_count(type);
-        stats[i].rows_count = ecs_vector_count(columns[0].data);
-        stats[i].systems_matched_count = ecs_vector_count(table->queries);
-        stats[i].other_memory_bytes = 
-            ECS_SIZEOF(ecs_column_t) + ecs_vector_count(type) +
-            ECS_SIZEOF(ecs_entity_t) * ecs_vector_count(table->queries);
+    /* If the previous run stopped at the last entity there is nothing left to
+     * do, so start over instead of running the system for no entities */
+    if (!processed && offset) {
+        offset = 0;
+        it->iter = ecs_query_iter(system_data->query).iter;
+        it->frame_offset = 0;
+        it->total_count = 0;
+        exhausted = run_batches(
+            system_data, it, filter, &time_start, &processed);
+    }
 
-        collect_table_data_memory(table, &stats[i]);
+    if (exhausted) {
+        system_data->cursor = offset + processed;
+    } else {
+        system_data->cursor = 0;
     }
 }
 
-static
-void StatsCollectTypeStats(ecs_iter_t *it) {
-    EcsType *type_component = ecs_column(it, EcsType, 1);
-    ECS_COLUMN(it, EcsTypeStats, stats, 2);
+ecs_entity_t ecs_run_intern(
+    ecs_world_t *world,
+    ecs_stage_t *stage,
+    ecs_entity_t system,
+    EcsSystem *system_data,
+    float delta_time,
+    int32_t offset,
+    int32_t limit,
+    const ecs_filter_t *filter,
+    void *param,
+    bool ran_by_app) 
+{
+    if (!param) {
+        param = system_data->ctx;
+    }
 
-    ecs_world_t *world = it->world;
+    float time_elapsed = delta_time;
+    ecs_entity_t tick_source = system_data->tick_source;
 
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        stats[i].name = ecs_get_name(world, it->entities[i]);
-        stats[i].entity = it->entities[i];
-        stats[i].type = type_component[i].type;
-        stats[i].normalized_type = type_component[i].normalized;
-        stats[i].is_hidden = ecs_has_entity(world, it->entities[i], EcsHidden);
-        stats[i].entities_count = 0;
-        stats[i].entities_childof_count = 0;
-        stats[i].entities_instanceof_count = 0;
-        stats[i].components_count = 0;
-        stats[i].col_systems_count = 0;
-        stats[i].row_systems_count = 0;
-        stats[i].enabled_systems_count = 0;
-        stats[i].active_systems_count = 0;
-        stats[i].instance_count = ecs_count_type(world, type_component[i].normalized);
+    if (tick_source) {
+        const EcsTickSource *tick = ecs_get(
+            world, tick_source, EcsTickSource);
 
-        int32_t j, count = ecs_vector_count(type_component[i].normalized);
-        ecs_entity_t *entities = ecs_vector_first(type_component[i].normalized, ecs_entity_t);
-        for (j = 0; j < count; j ++) {
-            ecs_entity_t e = entities[j];
-            bool has_flags = false;
-            
-            if (ECS_HAS_ROLE(e, CHILDOF)) {
-                stats[i].entities_childof_count ++;
-                has_flags = true;
-            }
-            if (ECS_HAS_ROLE(e, INSTANCEOF)) {
-                stats[i].entities_instanceof_count ++;
-                has_flags = true;
-            }
-            if (!has_flags) {
-                if (ecs_has(world, e, EcsComponent)) {
-                    stats[i].components_count ++;
-                } else
-                if (ecs_has(world, e, EcsSystem)) {
-                    stats[i].col_systems_count ++;
-                    if (!ecs_has_entity(world, e, EcsDisabled)) {
-                        stats[i].enabled_systems_count ++;
-                    }
+        if (tick) {
+            time_elapsed = tick->time_elapsed;
 
-                    const EcsSystem *ptr = ecs_get(world, e, EcsSystem);
-                    if (ecs_vector_count(ptr->query->tables)) {
-                        stats[i].active_systems_count ++;
-                    }
-                } else {
-                    stats[i].entities_count ++;
-                }
+            /* If timer hasn't fired we shouldn't run the system */
+            if (!tick->tick) {
+                return 0;
             }
+        } else {
+            /* If a timer has been set but the timer entity does not have the
+             * EcsTimer component, don't run the system. This can be the result
+             * of a single-shot timer that has fired already. Not resetting the
+             * timer field of the system will ensure that the system won't be
+             * ran after the timer has fired. */
+            return 0;
         }
     }
-}
 
-/* -- Module import function -- */
+    ecs_time_t time_start;
+    bool measure_time = world->measure_system_time;
+    if (measure_time) {
+        ecs_os_get_time(&time_start);
+    }
 
-void FlecsStatsImport(
-    ecs_world_t *world)
-{    
-    ECS_MODULE(world, FlecsStats);
+    uint64_t span = ecs_span_begin(world);
 
-    ECS_IMPORT(world, FlecsPipeline);
+#ifndef NDEBUG
+    stage->system = system;
+    stage->system_columns = system_data->query->sig.columns;
+#endif
+    
+    bool defer = false;
+    if (!stage->defer) {
+        ecs_defer_begin(stage->world);
+        defer = true;
+    }
 
-    ecs_set_name_prefix(world, "Ecs");
+    /* Systems with a budget resume where the previous run stopped */
+    bool budgeted = !ran_by_app && world == stage->world && 
+        (system_data->entity_budget || system_data->time_budget > 0);
+    if (budgeted) {
+        offset = system_data->cursor;
+    }
 
-    ECS_COMPONENT(world, EcsAllocStats);
-    ECS_COMPONENT(world, EcsWorldStats);
-    ECS_COMPONENT(world, EcsMemoryStats);
-    ECS_COMPONENT(world, EcsSystemStats);
-    ECS_COMPONENT(world, EcsSystemMemoryStats);
-    ECS_COMPONENT(world, EcsRowSystemMemoryStats);
-    ECS_COMPONENT(world, EcsComponentStats);
-    ECS_COMPONENT(world, EcsTableStats);
-    ECS_COMPONENT(world, EcsTablePtr);
-    ECS_COMPONENT(world, EcsTypeStats);
+    /* Prepare the query iterator */
+    ecs_iter_t it = ecs_query_iter_page(system_data->query, offset, limit);
+    it.world = stage->world;
+    it.system = system;
+    it.delta_time = delta_time;
+    it.delta_system_time = time_elapsed;
+    it.world_time = world->stats.world_time_total;
+    it.frame_offset = offset;
     
-    ECS_ENTITY(world, EcsStatsSkipCollect, 0);
-
-    /* -- Helper systems -- */
+    /* Set param if provided, otherwise use system context */
+    if (param) {
+        it.param = param;
+    } else {
+        it.param = system_data->ctx;
+    }
 
-    ECS_SYSTEM(world, StatsCollectColSystemMemoryTotals, 0, 
-        [in] EcsSystemMemoryStats,
-        [out] World:EcsMemoryStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    it.ctx = system_data->ctx;
 
-    ECS_SYSTEM(world, StatsCollectTableMemoryTotals, 0, 
-        [in] EcsTableStats,
-        [out] World:EcsMemoryStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    ecs_iter_action_t action = system_data->action;
 
-    /* -- Component creation systems -- */
+    /* If no filter is provided, just iterate tables & invoke action */
+    if (budgeted) {
+        run_budgeted(system_data, &it, filter);
+    } else if (ran_by_app || world == stage->world) {
+        while (ecs_query_next_w_filter(&it, filter)) {
+            action(&it);
+        }
+    } else {
+        ecs_thread_t *thread = (ecs_thread_t*)stage->world;
+        int32_t total = ecs_vector_count(world->workers);
+        int32_t current = thread->index;
 
-    ECS_SYSTEM(world, StatsAddWorldStats, EcsOnStore, [out] !World:EcsWorldStats, 
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+        while (ecs_query_next_worker(&it, current, total)) {
+            action(&it);               
+        }
+    }
 
-    ECS_SYSTEM(world, StatsAddAllocStats, EcsOnStore, [out] !World:EcsAllocStats, 
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    if (defer) {
+        ecs_defer_end(stage->world);
+    }
 
-    ECS_SYSTEM(world, StatsAddMemoryStats, EcsPostLoad, [out] !World:EcsMemoryStats, 
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    if (measure_time) {
+        system_data->time_spent += (float)ecs_time_measure(&time_start);
+    }
 
-    ECS_SYSTEM(world, StatsAddSystemStats, EcsOnStore,
-        flecs.system.EcsSystem, [out] !EcsSystemStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden, 
-        SYSTEM:EcsStatsSkipCollect, !EcsStatsSkipCollect);
+    ecs_span_end(world, stage, EcsSpanSystem, system, span);
 
-    ECS_SYSTEM(world, StatsAddColSystemMemoryStats, EcsOnStore,
-        flecs.system.EcsSystem, [out] !EcsSystemMemoryStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden, 
-        SYSTEM:EcsStatsSkipCollect, !EcsStatsSkipCollect);
+#ifndef NDEBUG
+    stage->system = 0;
+    stage->system_columns = NULL;
+#endif
 
-    ECS_SYSTEM(world, StatsAddComponentStats, EcsOnStore,
-        EcsComponent, [out] !EcsComponentStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    system_data->invoke_count ++;
 
-    ECS_SYSTEM(world, StatsAddTableStats, EcsOnStore,
-        EcsTablePtr, [out] !EcsTableStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    return it.interrupted_by;
+}
 
-    ECS_SYSTEM(world, StatsAddTypeStats, EcsOnStore,
-        EcsType, [out] !EcsTypeStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+/* -- Public API -- */
 
-    /* -- Metrics collection systems -- */
+ecs_entity_t ecs_run_w_filter(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    float delta_time,
+    int32_t offset,
+    int32_t limit,
+    const ecs_filter_t *filter,
+    void *param)
+{
+    ecs_stage_t *stage = ecs_get_stage(&world);
+    bool in_progress = ecs_staging_begin(world);
 
-    ECS_SYSTEM(world, StatsCollectWorldStats, EcsPostLoad,
-        [out] EcsWorldStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    EcsSystem *system_data = (EcsSystem*)ecs_get(
+        world, system, EcsSystem);
+    assert(system_data != NULL);
 
-    /* This handler enables frame time monitoring when system is activated */
-    ecs_set_system_status_action(
-        world, StatsCollectWorldStats, StatsCollectWorldStats_StatusAction, NULL);
+    ecs_entity_t interrupted_by = ecs_run_intern(
+        world, stage, system, system_data, delta_time, offset, limit, 
+        filter, param, true);
 
-    ECS_SYSTEM(world, StatsCollectAllocStats, EcsPostLoad,
-        [out] EcsAllocStats, 
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    /* If world wasn't in progress when we entered this function, we need to
+     * merge and reset the in_progress value */
+    if (!in_progress) {
+        ecs_staging_end(world);
+    }
 
-    ECS_SYSTEM(world, StatsCollectMemoryStats, EcsPostLoad,
-        [out] EcsMemoryStats,
-        :StatsCollectColSystemMemoryTotals,
-        :StatsCollectTableMemoryTotals,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);      
+    return interrupted_by;
+}
 
-    ECS_SYSTEM(world, StatsCollectSystemStats, EcsPostLoad,
-        flecs.system.EcsSystem, [out] EcsSystemStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+ecs_entity_t ecs_run(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    float delta_time,
+    void *param)
+{
+    return ecs_run_w_filter(world, system, delta_time, 0, 0, NULL, param);
+}
 
-    /* This handler enables system time monitoring when system is activated */
-    ecs_set_system_status_action(
-        world, StatsCollectSystemStats, StatsCollectSystemStats_StatusAction, NULL);
+void ecs_run_monitor(
+    ecs_world_t *world,
+    ecs_matched_query_t *monitor,
+    ecs_entities_t *components,
+    int32_t row,
+    int32_t count,
+    ecs_entity_t *entities)
+{
+    ecs_query_t *query = monitor->query;
+    ecs_assert(query != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    ECS_SYSTEM(world, StatsCollectColSystemMemoryStats, EcsPostLoad,
-        flecs.system.EcsSystem, [out] EcsSystemMemoryStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    ecs_entity_t system = query->system;
+    const EcsSystem *system_data = ecs_get(world, system, EcsSystem);
+    ecs_assert(system_data != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    ECS_SYSTEM(world, StatsCollectComponentStats, EcsPostLoad,
-        EcsComponent, [out] EcsComponentStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    if (!system_data->action) {
+        return;
+    }
 
-    ECS_SYSTEM(world, StatsCollectTableStats, EcsPostLoad,
-        EcsTablePtr, [out] EcsTableStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    ecs_iter_t it = {0};
+    ecs_query_set_iter( world, query, &it, 
+        monitor->matched_table_index, row, count);
 
-    /* This handler creates entities for tables when system is enabled */
-    ecs_set_system_status_action(
-        world, StatsCollectTableStats, StatsCollectTableStats_StatusAction, 
-        ecs_type(EcsTablePtr));
+    it.world = world;
+    it.triggered_by = components;
+    it.param = system_data->ctx;
+    it.ctx = system_data->ctx;
 
-    ECS_SYSTEM(world, StatsCollectTypeStats, EcsPostLoad,
-        EcsType, [out] EcsTypeStats,
-        SYSTEM:EcsOnDemand, SYSTEM:Hidden);
+    if (entities) {
+        it.entities = entities;
+    }
 
-    /* Export components to module */
-    ECS_EXPORT_COMPONENT(EcsAllocStats);
-    ECS_EXPORT_COMPONENT(EcsWorldStats);
-    ECS_EXPORT_COMPONENT(EcsMemoryStats);
-    ECS_EXPORT_COMPONENT(EcsSystemStats);
-    ECS_EXPORT_COMPONENT(EcsSystemMemoryStats);
-    ECS_EXPORT_COMPONENT(EcsComponentStats);
-    ECS_EXPORT_COMPONENT(EcsTableStats);
-    ECS_EXPORT_COMPONENT(EcsTablePtr);
-    ECS_EXPORT_COMPONENT(EcsTypeStats);
+    it.system = system;
+    system_data->action(&it);
 }
 
-#endif
-
-#ifdef FLECS_SYSTEM
-
-
-/* Global type variables */
-ECS_TYPE_DECL(EcsComponentLifecycle);
-ECS_TYPE_DECL(EcsTrigger);
-ECS_TYPE_DECL(EcsSystem);
-ECS_TYPE_DECL(EcsTickSource);
-ECS_TYPE_DECL(EcsSignatureExpr);
-ECS_TYPE_DECL(EcsSignature);
-ECS_TYPE_DECL(EcsQuery);
-ECS_TYPE_DECL(EcsIterAction);
-ECS_TYPE_DECL(EcsContext);
-
+/* Generic constructor to initialize a component to 0 */
 static
-ecs_on_demand_in_t* get_in_component(
-    ecs_map_t *component_map,
-    ecs_entity_t component)
+void sys_ctor_init_zero(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    const ecs_entity_t *entities,
+    void *ptr,
+    size_t size,
+    int32_t count,
+    void *ctx)
 {
-    ecs_on_demand_in_t *in = ecs_map_get(
-        component_map, ecs_on_demand_in_t, component);
-    if (!in) {
-        ecs_on_demand_in_t in_value = {0};
-        ecs_map_set(component_map, component, &in_value);
-        in = ecs_map_get(component_map, ecs_on_demand_in_t, component);
-        ecs_assert(in != NULL, ECS_INTERNAL_ERROR, NULL);
-    }
-
-    return in;
+    (void)world;
+    (void)component;
+    (void)entities;
+    (void)ctx;
+    memset(ptr, 0, size * (size_t)count);
 }
 
+/* System destructor */
 static
-void activate_in_columns(
+void ecs_colsystem_dtor(
     ecs_world_t *world,
-    ecs_query_t *query,
-    ecs_map_t *component_map,
-    bool activate)
+    ecs_entity_t component,
+    const ecs_entity_t *entities,
+    void *ptr,
+    size_t size,
+    int32_t count,
+    void *ctx)
 {
-    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
-    int32_t i, count = ecs_vector_count(query->sig.columns);
+    (void)component;
+    (void)ctx;
+    (void)size;
+
+    EcsSystem *system_data = ptr;
 
+    int i;
     for (i = 0; i < count; i ++) {
-        if (columns[i].inout_kind == EcsIn) {
-            ecs_on_demand_in_t *in = get_in_component(
-                component_map, columns[i].is.component);
-            ecs_assert(in != NULL, ECS_INTERNAL_ERROR, NULL);
+        EcsSystem *cur = &system_data[i];
+        ecs_entity_t e = entities[i];
 
-            in->count += activate ? 1 : -1;
+        /* Invoke Deactivated action for active systems */
+        if (cur->query && ecs_vector_count(cur->query->tables)) {
+            invoke_status_action(world, e, ptr, EcsSystemDeactivated);
+        }
 
-            ecs_assert(in->count >= 0, ECS_INTERNAL_ERROR, NULL);
+        /* Invoke Disabled action for enabled systems */
+        if (!ecs_has_entity(world, e, EcsDisabled) && 
+            !ecs_has_entity(world, e, EcsDisabledIntern)) 
+        {
+            invoke_status_action(world, e, ptr, EcsSystemDisabled);
+        }           
 
-            /* If this is the first system that registers the in component, walk
-             * over all already registered systems to enable them */
-            if (in->systems && 
-               ((activate && in->count == 1) || 
-                (!activate && !in->count))) 
-            {
-                ecs_on_demand_out_t **out = ecs_vector_first(
-                    in->systems, ecs_on_demand_out_t*);
-                int32_t s, in_count = ecs_vector_count(in->systems);
+        ecs_os_free(cur->on_demand);
 
-                for (s = 0; s < in_count; s ++) {
-                    /* Increase the count of the system with the out params */
-                    out[s]->count += activate ? 1 : -1;
-                    
-                    /* If this is the first out column that is requested from
-                     * the OnDemand system, enable it */
-                    if (activate && out[s]->count == 1) {
-                        ecs_remove_entity(world, out[s]->system, EcsDisabledIntern);
-                    } else if (!activate && !out[s]->count) {
-                        ecs_add_entity(world, out[s]->system, EcsDisabledIntern);             
-                    }
-                }
-            }
+        /* Free the query of a deleted system, so that it is no longer invoked
+         * for the tables it matched. When the world is deleted, queries are
+         * freed after the tables. */
+        if (cur->query && !world->is_fini) {
+            ecs_col_system_free(cur);
+            cur->query = NULL;
         }
-    }    
+    }
 }
 
+/* Register a trigger for a component */
 static
-void register_out_column(
-    ecs_map_t *component_map,
-    ecs_entity_t component,
-    ecs_on_demand_out_t *on_demand_out)
+EcsTrigger* trigger_find_or_create(
+    ecs_vector_t **triggers,
+    ecs_entity_t entity)
 {
-    ecs_on_demand_in_t *in = get_in_component(component_map, component);
-    ecs_assert(in != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_vector_each(*triggers, EcsTrigger, trigger, {
+        if (trigger->self == entity) {
+            return trigger;
+        }
+    });
 
-    on_demand_out->count += in->count;
-    ecs_on_demand_out_t **elem = ecs_vector_add(&in->systems, ecs_on_demand_out_t*);
-    *elem = on_demand_out;
+    EcsTrigger *result = ecs_vector_add(triggers, EcsTrigger);
+    return result;
 }
 
 static
-void register_out_columns(
+void trigger_set(
     ecs_world_t *world,
-    ecs_entity_t system,
-    EcsSystem *system_data)
+    const ecs_entity_t *entities,
+    EcsTrigger *ct,
+    int32_t count)
 {
-    ecs_query_t *query = system_data->query;
-    ecs_sig_column_t *columns = ecs_vector_first(query->sig.columns, ecs_sig_column_t);
-    int32_t i, out_count = 0, count = ecs_vector_count(query->sig.columns);
+    EcsTrigger *el = NULL;
 
+    int i;
     for (i = 0; i < count; i ++) {
-        if (columns[i].inout_kind == EcsOut) {
-            if (!system_data->on_demand) {
-                system_data->on_demand = ecs_os_malloc(sizeof(ecs_on_demand_out_t));
-                ecs_assert(system_data->on_demand != NULL, ECS_OUT_OF_MEMORY, NULL);
+        ecs_entity_t c = ct[i].component;
+        ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, c);
 
-                system_data->on_demand->system = system;
-                system_data->on_demand->count = 0;
-            }
+        switch(ct[i].kind) {
+        case EcsOnAdd:
+            el = trigger_find_or_create(&c_info->on_add, entities[i]);
+            break;
+        case EcsOnRemove:
+            el = trigger_find_or_create(&c_info->on_remove, entities[i]);
+            break;
+        default:
+            ecs_abort(ECS_INVALID_PARAMETER, NULL);
+            break;
+        }
+        
+        ecs_assert(el != NULL, ECS_INTERNAL_ERROR, NULL);
 
-            /* If column operator is NOT and the inout kind is [out], the system
-             * explicitly states that it will create the component (it is not
-             * there, yet it is an out column). In this case it doesn't make
-             * sense to wait until [in] columns get activated (matched with
-             * entities) since the component is not there yet. Therefore add it
-             * to the on_enable_components list, so this system will be enabled
-             * when a [in] column is enabled, rather than activated */
-            ecs_map_t *component_map;
-            if (columns[i].oper_kind == EcsOperNot) {
-                component_map = world->on_enable_components;
-            } else {
-                component_map = world->on_activate_components;
-            }
+        *el = ct[i];
+        el->self = entities[i];
 
-            register_out_column(
-                component_map, columns[i].is.component, 
-                system_data->on_demand);
+        ecs_notify_tables(world, &(ecs_table_event_t) {
+            .kind = EcsTableComponentInfo,
+            .component = c
+        });        
 
-            out_count ++;
-        }
+        ecs_trace_1("trigger #[green]%s#[normal] created for component #[red]%s",
+            ct[i].kind == EcsOnAdd
+                ? "OnAdd"
+                : "OnRemove", ecs_get_name(world, c));
     }
+}
 
-    /* If there are no out columns in the on-demand system, the system will
-     * never be enabled */
-    ecs_assert(out_count != 0, ECS_NO_OUT_COLUMNS, ecs_get_name(world, system));
+static
+void OnSetTrigger(
+    ecs_iter_t *it)
+{
+    EcsTrigger *ct = ecs_column(it, EcsTrigger, 1);
+    
+    trigger_set(it->world, it->entities, ct, it->count);
 }
 
 static
-void invoke_status_action(
-    ecs_world_t *world,
-    ecs_entity_t system,
-    const EcsSystem *system_data,
-    ecs_system_status_t status)
+void OnSetTriggerCtx(
+    ecs_iter_t *it)
 {
-    ecs_system_status_action_t action = system_data->status_action;
-    if (action) {
-        action(world, system, status, system_data->status_ctx);
+    EcsTrigger *ct = ecs_column(it, EcsTrigger, 1);
+    EcsContext *ctx = ecs_column(it, EcsContext, 2);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ct[i].ctx = (void*)ctx[i].ctx;
     }
+
+    trigger_set(it->world, it->entities, ct, it->count);    
 }
 
-/* Invoked when system becomes active or inactive */
-void ecs_system_activate(
-    ecs_world_t *world,
-    ecs_entity_t system,
-    bool activate,
-    const EcsSystem *system_data)
+/* System that registers component lifecycle callbacks */
+static
+void OnSetComponentLifecycle(
+    ecs_iter_t *it)
 {
-    ecs_assert(!world->in_progress, ECS_INTERNAL_ERROR, NULL);
+    EcsComponentLifecycle *cl = ecs_column(it, EcsComponentLifecycle, 1);
+    ecs_world_t *world = it->world;
 
-    if (activate) {
-        ecs_remove_entity(world, system, EcsInactive);
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_entity_t e = it->entities[i];
+        ecs_set_component_actions_w_entity(world, e, &cl[i]);   
     }
+}
 
-    if (!system_data) {
-        system_data = ecs_get(world, system, EcsSystem);
+/* Disable system when EcsDisabled is added */
+static 
+void DisableSystem(
+    ecs_iter_t *it)
+{
+    EcsSystem *system_data = ecs_column(it, EcsSystem, 1);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_enable_system(
+            it->world, it->entities[i], &system_data[i], false);
     }
-    if (!system_data || !system_data->query) {
-        return;
+}
+
+/* Enable system when EcsDisabled is removed */
+static
+void EnableSystem(
+    ecs_iter_t *it)
+{
+    EcsSystem *system_data = ecs_column(it, EcsSystem, 1);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_enable_system(
+            it->world, it->entities[i], &system_data[i], true);
+    }
+}
+
+/* Parse a signature expression into the ecs_sig_t data structure */
+static
+void CreateSignature(
+    ecs_iter_t *it) 
+{
+    ecs_world_t *world = it->world;
+    ecs_entity_t *entities = it->entities;
+
+    EcsSignatureExpr *signature = ecs_column(it, EcsSignatureExpr, 1);
+    
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_entity_t e = entities[i];
+        const char *name = ecs_get_name(world, e);
+
+        /* Parse the signature and add the result to the entity */
+        EcsSignature sig = {0};
+        ecs_sig_init(world, name, signature[0].expr, &sig.signature);
+        ecs_set_ptr(world, e, EcsSignature, &sig);
+
+        /* If sig has FromSystem columns, add components to the entity */
+        ecs_vector_each(sig.signature.columns, ecs_sig_column_t, column, {
+            if (column->from_kind == EcsFromSystem) {
+                ecs_add_entity(world, e, column->is.component);
+            }
+        });    
     }
+}
 
-    /* If system contains in columns, signal that they are now in use */
-    activate_in_columns(
-        world, system_data->query, world->on_activate_components, activate);
+/* Create a query from a signature */
+static
+void CreateQuery(
+    ecs_iter_t *it) 
+{
+    ecs_world_t *world = it->world;
+    ecs_entity_t *entities = it->entities;
 
-    /* Invoke system status action */
-    invoke_status_action(world, system, system_data, 
-        activate ? EcsSystemActivated : EcsSystemDeactivated);
+    EcsSignature *signature = ecs_column(it, EcsSignature, 1);
+    
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_entity_t e = entities[i];
 
-    ecs_trace_2("system #[green]%s#[reset] %s", 
-        ecs_get_name(world, system), 
-        activate ? "activated" : "deactivated");
+        if (!ecs_has(world, e, EcsQuery)) {
+            EcsQuery query = {0};
+            query.query = ecs_query_new_w_sig(world, e, &signature[i].signature);
+            ecs_set_ptr(world, e, EcsQuery, &query);
+        }
+    }
 }
 
-/* Actually enable or disable system */
-void ecs_enable_system(
-    ecs_world_t *world,
-    ecs_entity_t system,
-    EcsSystem *system_data,
-    bool enabled)
+/* Create a system from a query and an action */
+static
+void CreateSystem(
+    ecs_iter_t *it)
 {
-    ecs_assert(!world->in_progress, ECS_INTERNAL_ERROR, NULL);
+    ecs_world_t *world = it->world;
+    ecs_entity_t *entities = it->entities;
 
-    ecs_query_t *query = system_data->query;
-    if (!query) {
-        return;
-    }
+    EcsQuery *query = ecs_column(it, EcsQuery, 1);
+    EcsIterAction *action = ecs_column(it, EcsIterAction, 2);
+    EcsContext *ctx = ecs_column(it, EcsContext, 3);
+    
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_entity_t e = entities[i];
+        void *ctx_ptr = NULL;
+        if (ctx) {
+            ctx_ptr = (void*)ctx[i].ctx;
+        }
 
-    if (ecs_vector_count(query->tables)) {
-        /* Only (de)activate system if it has non-empty tables. */
-        ecs_system_activate(world, system, enabled, system_data);
-        system_data = ecs_get_mut(world, system, EcsSystem, NULL);
+        ecs_init_system(world, e, action[i].action, query[i].query, ctx_ptr);
     }
+}
 
-    /* Enable/disable systems that trigger on [in] enablement */
-    activate_in_columns(
-        world, 
-        query, 
-        world->on_enable_components, 
-        enabled);
-    
-    /* Invoke action for enable/disable status */
-    invoke_status_action(
-        world, system, system_data,
-        enabled ? EcsSystemEnabled : EcsSystemDisabled);
+static
+void bootstrap_set_system(
+    ecs_world_t *world,
+    const char *name,
+    const char *expr,
+    ecs_iter_action_t action)
+{
+    ecs_sig_t sig = {0};
+    ecs_entity_t sys = ecs_set(world, 0, EcsName, {.value = name});
+    ecs_add_entity(world, sys, EcsOnSet);
+    ecs_sig_init(world, name, expr, &sig);
+    ecs_query_t *query = ecs_query_new_w_sig(world, sys, &sig);
+    ecs_init_system(world, sys, action, query, NULL);
 }
 
-void ecs_init_system(
+ecs_entity_t ecs_new_system(
     ecs_world_t *world,
-    ecs_entity_t system,
-    ecs_iter_action_t action,
-    ecs_query_t *query,
-    void *ctx)
+    ecs_entity_t e,
+    const char *name,
+    ecs_entity_t tag,
+    const char *signature,
+    ecs_iter_action_t action)
 {
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
     ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-    /* Add & initialize the EcsSystem component */
-    bool is_added = false;
-    EcsSystem *sptr = ecs_get_mut(world, system, EcsSystem, &is_added);
-    ecs_assert(sptr != NULL, ECS_INTERNAL_ERROR, NULL);
-
-    if (!is_added) {
-        ecs_assert(sptr->query == query, ECS_INVALID_PARAMETER, NULL);
-    } else {
-        memset(sptr, 0, sizeof(EcsSystem));
-        sptr->query = query;
-        sptr->entity = system;
-        sptr->tick_source = 0;
-        sptr->time_spent = 0;
+    ecs_entity_t result = ecs_lookup_w_id(world, e, name);
+    if (!result) {
+        result = ecs_new_entity(world, 0, name, NULL);
     }
 
-    /* Sanity check to make sure creating the query didn't add any additional
-     * tags or components to the system */
-    sptr->action = action;
-    sptr->ctx = ctx;
+    if (tag) {
+        ecs_add_entity(world, result, tag);
+    }
 
-    /* Only run this code when the system is created for the first time */
-    if (is_added) {
-        /* If tables have been matched with this system it is active, and we
-         * should activate the in-columns, if any. This will ensure that any
-         * OnDemand systems get enabled. */
-        if (ecs_vector_count(query->tables)) {
-            ecs_system_activate(world, system, true, sptr);
+    bool added = false;
+    EcsSignatureExpr *expr = ecs_get_mut(world, result, EcsSignatureExpr, &added);
+    if (added) {
+        expr->expr = signature;
+    } else {
+        if (!expr->expr || !signature) {
+            if (expr->expr != signature) {
+                if (expr->expr && !strcmp(expr->expr, "0")) {
+                    /* Ok */
+                } else if (signature && !strcmp(signature, "0")) {
+                    /* Ok */
+                } else {
+                    ecs_abort(ECS_ALREADY_DEFINED, NULL);
+                }
+            }
         } else {
-            /* If system isn't matched with any tables, mark it as inactive. This
-             * causes it to be ignored by the main loop. When the system matches
-             * with a table it will be activated. */
-            ecs_add_entity(world, system, EcsInactive);
-        }
-
-        /* If system is enabled, trigger enable components */
-        activate_in_columns(world, query, world->on_enable_components, true);
-
-        /* Check if all non-table column constraints are met. If not, disable
-         * system (system will be enabled once constraints are met) */
-        if (!ecs_sig_check_constraints(world, &query->sig)) {
-            ecs_add_entity(world, system, EcsDisabledIntern);
-        }
-
-        /* If the query has a OnDemand system tag, register its [out] columns */
-        if (ecs_has_entity(world, system, EcsOnDemand)) {
-            register_out_columns(world, system, sptr);
-            ecs_assert(sptr->on_demand != NULL, ECS_INTERNAL_ERROR, NULL);
-
-            /* If there are no systems currently interested in any of the [out]
-             * columns of the on demand system, disable it */
-            if (!sptr->on_demand->count) {
-                ecs_add_entity(world, system, EcsDisabledIntern);
-            }        
-        }
-
-        /* Check if system has out columns */
-        int32_t i, count = ecs_vector_count(query->sig.columns);
-        ecs_sig_column_t *columns = ecs_vector_first(
-                query->sig.columns, ecs_sig_column_t);
-        
-        for (i = 0; i < count; i ++) {
-            if (columns[i].inout_kind != EcsIn) {
-                break;
+            if (strcmp(expr->expr, signature)) {
+                ecs_abort(ECS_ALREADY_DEFINED, name);
             }
         }
     }
 
-    ecs_trace_1("system #[green]%s#[reset] created with #[red]%s", 
-        ecs_get_name(world, system), query->sig.expr);
-}
+    ecs_modified(world, result, EcsSignatureExpr);
 
+    ecs_set(world, result, EcsIterAction, {action});
 
-void ecs_col_system_free(
-    EcsSystem *system_data)
-{
-    ecs_query_free(system_data->query);
+    return result;
 }
 
-/* -- Public API -- */
-
-void ecs_enable(
+ecs_entity_t ecs_new_trigger(
     ecs_world_t *world,
-    ecs_entity_t entity,
-    bool enabled)
+    ecs_entity_t e,
+    const char *name,
+    ecs_entity_t kind,
+    const char *component_name,
+    ecs_iter_action_t action)
 {
     assert(world->magic == ECS_WORLD_MAGIC);
 
-    const EcsType *type_ptr = ecs_get( world, entity, EcsType);
-    if (type_ptr) {
-        /* If entity is a type, disable all entities in the type */
-        ecs_vector_each(type_ptr->normalized, ecs_entity_t, e, {
-            ecs_enable(world, *e, enabled);
-        });
-    } else {
-        if (enabled) {
-            ecs_remove_entity(world, entity, EcsDisabled);
-        } else {
-            ecs_add_entity(world, entity, EcsDisabled);
-        }
-    }
-}
+    ecs_entity_t component = ecs_lookup_fullpath(world, component_name);
+    ecs_assert(component != 0, ECS_INVALID_COMPONENT_ID, component_name);
 
-void ecs_set_system_status_action(
-    ecs_world_t *world,
-    ecs_entity_t system,
-    ecs_system_status_action_t action,
-    const void *ctx)
-{
-    EcsSystem *system_data = ecs_get_mut(world, system, EcsSystem, NULL);
-    ecs_assert(system_data != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_entity_t result = ecs_lookup_w_id(world, e, name);
+    if (!result) {
+        result = ecs_new_entity(world, 0, name, NULL);
+    }
 
-    system_data->status_action = action;
-    system_data->status_ctx = (void*)ctx;
+    bool added = false;
+    EcsTrigger *trigger = ecs_get_mut(world, result, EcsTrigger, &added);
+    if (added) {
+        trigger->kind = kind;
+        trigger->action = action;
+        trigger->component = component;
+        trigger->ctx = NULL;
+    } else {
+        if (trigger->kind != kind) {
+            ecs_abort(ECS_ALREADY_DEFINED, name);
+        }
 
-    if (!ecs_has_entity(world, system, EcsDisabled)) {
-        /* If system is already enabled, generate enable status. The API 
-         * should guarantee that it exactly matches enable-disable 
-         * notifications and activate-deactivate notifications. */
-        invoke_status_action(world, system, system_data, EcsSystemEnabled);
+        if (trigger->component != component) {
+            ecs_abort(ECS_ALREADY_DEFINED, name);
+        }
 
-        /* If column system has active (non-empty) tables, also generate the
-         * activate status. */
-        if (ecs_vector_count(system_data->query->tables)) {
-            invoke_status_action(
-                world, system, system_data, EcsSystemActivated);
+        if (trigger->action != action) {
+            trigger->action = action;
         }
     }
+    
+    ecs_modified(world, result, EcsTrigger);
+
+    return result;
 }
 
-ecs_entity_t ecs_run_intern(
-    ecs_world_t *world,
-    ecs_stage_t *stage,
-    ecs_entity_t system,
-    EcsSystem *system_data,
-    float delta_time,
-    int32_t offset,
-    int32_t limit,
-    const ecs_filter_t *filter,
-    void *param,
-    bool ran_by_app) 
+void FlecsSystemImport(
+    ecs_world_t *world)
 {
-    if (!param) {
-        param = system_data->ctx;
-    }
+    ECS_MODULE(world, FlecsSystem);
 
-    float time_elapsed = delta_time;
-    ecs_entity_t tick_source = system_data->tick_source;
+    ecs_set_name_prefix(world, "Ecs");
 
-    if (tick_source) {
-        const EcsTickSource *tick = ecs_get(
-            world, tick_source, EcsTickSource);
+    ecs_bootstrap_component(world, EcsComponentLifecycle);
+    ecs_bootstrap_component(world, EcsTrigger);
+    ecs_bootstrap_component(world, EcsSystem);
+    ecs_bootstrap_component(world, EcsTickSource);
+    ecs_bootstrap_component(world, EcsSignatureExpr);
+    ecs_bootstrap_component(world, EcsSignature);
+    ecs_bootstrap_component(world, EcsQuery);
+    ecs_bootstrap_component(world, EcsIterAction);
+    ecs_bootstrap_component(world, EcsContext);
 
-        if (tick) {
-            time_elapsed = tick->time_elapsed;
+    ecs_bootstrap_tag(world, EcsOnAdd);
+    ecs_bootstrap_tag(world, EcsOnRemove);
+    ecs_bootstrap_tag(world, EcsOnSet);
+    ecs_bootstrap_tag(world, EcsUnSet);
 
-            /* If timer hasn't fired we shouldn't run the system */
-            if (!tick->tick) {
-                return 0;
-            }
-        } else {
-            /* If a timer has been set but the timer entity does not have the
-             * EcsTimer component, don't run the system. This can be the result
-             * of a single-shot timer that has fired already. Not resetting the
-             * timer field of the system will ensure that the system won't be
-             * ran after the timer has fired. */
-            return 0;
-        }
-    }
+    ecs_bootstrap_tag(world, EcsDisabledIntern);
+    ecs_bootstrap_tag(world, EcsInactive);
 
-    ecs_time_t time_start;
-    bool measure_time = world->measure_system_time;
-    if (measure_time) {
-        ecs_os_get_time(&time_start);
-    }
+    /* Put EcsOnDemand and EcsMonitor in flecs.core so they can be looked up
+     * without using the flecs.systems prefix */
+    ecs_entity_t old_scope = ecs_set_scope(world, EcsFlecsCore);
+    ecs_bootstrap_tag(world, EcsOnDemand);
+    ecs_bootstrap_tag(world, EcsMonitor);
+    ecs_set_scope(world, old_scope);
 
-#ifndef NDEBUG
-    stage->system = system;
-    stage->system_columns = system_data->query->sig.columns;
-#endif
-    
-    bool defer = false;
-    if (!stage->defer) {
-        ecs_defer_begin(stage->world);
-        defer = true;
-    }
+    ECS_TYPE_IMPL(EcsComponentLifecycle);
+    ECS_TYPE_IMPL(EcsTrigger);
+    ECS_TYPE_IMPL(EcsSystem);
+    ECS_TYPE_IMPL(EcsTickSource);
+    ECS_TYPE_IMPL(EcsSignatureExpr);
+    ECS_TYPE_IMPL(EcsSignature);
+    ECS_TYPE_IMPL(EcsQuery);
+    ECS_TYPE_IMPL(EcsIterAction);
+    ECS_TYPE_IMPL(EcsContext);
 
-    /* Prepare the query iterator */
-    ecs_iter_t it = ecs_query_iter_page(system_data->query, offset, limit);
-    it.world = stage->world;
-    it.system = system;
-    it.delta_time = delta_time;
-    it.delta_system_time = time_elapsed;
-    it.world_time = world->stats.world_time_total;
-    it.frame_offset = offset;
-    
-    /* Set param if provided, otherwise use system context */
-    if (param) {
-        it.param = param;
-    } else {
-        it.param = system_data->ctx;
-    }
+    /* Bootstrap ctor and dtor for EcsSystem */
+    ecs_set_component_actions_w_entity(world, ecs_typeid(EcsSystem), 
+        &(EcsComponentLifecycle) {
+            .ctor = sys_ctor_init_zero,
+            .dtor = ecs_colsystem_dtor
+        });
 
-    ecs_iter_action_t action = system_data->action;
+    /* Create systems necessary to create systems */
+    bootstrap_set_system(world, "CreateSignature", "SignatureExpr", CreateSignature);
+    bootstrap_set_system(world, "CreateQuery", "Signature, IterAction", CreateQuery);
+    bootstrap_set_system(world, "CreateSystem", "Query, IterAction, ?Context", CreateSystem);
 
-    /* If no filter is provided, just iterate tables & invoke action */
-    if (ran_by_app || world == stage->world) {
-        while (ecs_query_next_w_filter(&it, filter)) {
-            action(&it);
-        }
-    } else {
-        ecs_thread_t *thread = (ecs_thread_t*)stage->world;
-        int32_t total = ecs_vector_count(world->workers);
-        int32_t current = thread->index;
+    /* From here we can create systems */
 
-        while (ecs_query_next_worker(&it, current, total)) {
-            action(&it);               
-        }
-    }
+    /* Register OnSet system for EcsComponentLifecycle */
+    ECS_SYSTEM(world, OnSetComponentLifecycle, EcsOnSet, ComponentLifecycle, SYSTEM:Hidden);
 
-    if (defer) {
-        ecs_defer_end(stage->world);
-    }
+    /* Register OnSet system for triggers */
+    ECS_SYSTEM(world, OnSetTrigger, EcsOnSet, Trigger, SYSTEM:Hidden);
 
-    if (measure_time) {
-        system_data->time_spent += (float)ecs_time_measure(&time_start);
-    }
+    /* System that sets ctx for a trigger */
+    ECS_SYSTEM(world, OnSetTriggerCtx, EcsOnSet, Trigger, Context, SYSTEM:Hidden);
+
+    /* Monitors that trigger when a system is enabled or disabled */
+    ECS_SYSTEM(world, DisableSystem, EcsMonitor, System, Disabled || DisabledIntern, SYSTEM:Hidden);
+    ECS_SYSTEM(world, EnableSystem, EcsMonitor, System, !Disabled, !DisabledIntern, SYSTEM:Hidden);
+}
 
-#ifndef NDEBUG
-    stage->system = 0;
-    stage->system_columns = NULL;
 #endif
 
-    system_data->invoke_count ++;
 
-    return it.interrupted_by;
-}
+#ifdef FLECS_SYSTEM
+#ifdef FLECS_DBG
 
-/* -- Public API -- */
 
-ecs_entity_t ecs_run_w_filter(
+int ecs_dbg_system(
     ecs_world_t *world,
     ecs_entity_t system,
-    float delta_time,
-    int32_t offset,
-    int32_t limit,
-    const ecs_filter_t *filter,
-    void *param)
+    ecs_dbg_system_t *dbg_out)
 {
-    ecs_stage_t *stage = ecs_get_stage(&world);
-    bool in_progress = ecs_staging_begin(world);
+    const EcsSystem *system_data = ecs_get(world, system, EcsSystem);
+    if (!system_data) {
+        return -1;
+    }
 
-    EcsSystem *system_data = (EcsSystem*)ecs_get(
-        world, system, EcsSystem);
-    assert(system_data != NULL);
+    *dbg_out = (ecs_dbg_system_t){.system = system};
+    dbg_out->active_table_count = ecs_vector_count(system_data->query->tables);
+    dbg_out->inactive_table_count = ecs_vector_count(system_data->query->empty_tables);
+    dbg_out->enabled = !ecs_has_entity(world, system, EcsDisabled);
 
-    ecs_entity_t interrupted_by = ecs_run_intern(
-        world, stage, system, system_data, delta_time, offset, limit, 
-        filter, param, true);
+    ecs_vector_each(system_data->query->tables, ecs_matched_table_t, mt, {
+        ecs_table_t *table = mt->data.table;
+        if (table) {
+            dbg_out->entities_matched_count += ecs_table_count(table);
+        }        
+    });
 
-    /* If world wasn't in progress when we entered this function, we need to
-     * merge and reset the in_progress value */
-    if (!in_progress) {
-        ecs_staging_end(world);
-    }
+    /* Inactive tables are inactive because they are empty, so no need to 
+     * iterate them */
 
-    return interrupted_by;
+    return 0;
 }
 
-ecs_entity_t ecs_run(
+bool ecs_dbg_match_entity(
     ecs_world_t *world,
+    ecs_entity_t entity,
     ecs_entity_t system,
-    float delta_time,
-    void *param)
+    ecs_match_failure_t *failure_info_out)
 {
-    return ecs_run_w_filter(world, system, delta_time, 0, 0, NULL, param);
+    ecs_dbg_entity_t dbg;
+    ecs_dbg_entity(world, entity, &dbg);
+
+    const EcsSystem *system_data = ecs_get(world, system, EcsSystem);
+    if (!system_data) {
+        failure_info_out->reason = EcsMatchNotASystem;
+        failure_info_out->column = -1;
+        return false;
+    }
+
+    return ecs_query_match(
+        world, dbg.table, system_data->query, failure_info_out);
 }
 
-void ecs_run_monitor(
+
+ecs_table_t* ecs_dbg_active_table(
     ecs_world_t *world,
-    ecs_matched_query_t *monitor,
-    ecs_entities_t *components,
-    int32_t row,
-    int32_t count,
-    ecs_entity_t *entities)
+    ecs_dbg_system_t *dbg,
+    int32_t index)
 {
-    ecs_query_t *query = monitor->query;
-    ecs_assert(query != NULL, ECS_INTERNAL_ERROR, NULL);
+    (void)world;
 
-    ecs_entity_t system = query->system;
+    EcsSystem *system_data = dbg->system_data;
+    ecs_matched_table_t *table = ecs_vector_get(
+        system_data->query->tables, ecs_matched_table_t, index);
+    if (!table) {
+        return NULL;
+    }
+    
+    return table->data.table;
+}
+
+ecs_table_t* ecs_dbg_inactive_table(
+    ecs_world_t *world,
+    ecs_dbg_system_t *dbg,
+    int32_t index)
+{
+    (void)world;
+
+    EcsSystem *system_data = dbg->system_data;
+    ecs_matched_table_t *table = ecs_vector_get(
+        system_data->query->empty_tables, ecs_matched_table_t, index);
+    if (!table) {
+        return NULL;
+    }
+    
+    return table->data.table;
+}
+
+ecs_type_t ecs_dbg_get_column_type(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    int32_t column_index)
+{
     const EcsSystem *system_data = ecs_get(world, system, EcsSystem);
-    ecs_assert(system_data != NULL, ECS_INTERNAL_ERROR, NULL);
-
-    if (!system_data->action) {
-        return;
+    if (!system_data) {
+        return NULL;
     }
+    
+    ecs_sig_column_t *columns = ecs_vector_first(
+        system_data->query->sig.columns, ecs_sig_column_t);
+    int32_t count = ecs_vector_count(system_data->query->sig.columns);
 
-    ecs_iter_t it = {0};
-    ecs_query_set_iter( world, query, &it, 
-        monitor->matched_table_index, row, count);
+    if (count < column_index) {
+        return NULL;
+    }
 
-    it.world = world;
-    it.triggered_by = components;
-    it.param = system_data->ctx;
+    ecs_sig_column_t *column = &columns[column_index - 1];
+    ecs_sig_oper_kind_t oper_kind = column->oper_kind;
+    ecs_type_t result;
 
-    if (entities) {
-        it.entities = entities;
+    switch(oper_kind) {
+    case EcsOperOr:
+        result = column->is.type;
+        break;
+    default:
+        result = ecs_type_from_entity(world, column->is.component);
+        break;
     }
-
-    it.system = system;
-    system_data->action(&it);
+    
+    return result;
 }
 
-/* Generic constructor to initialize a component to 0 */
-static
-void sys_ctor_init_zero(
-    ecs_world_t *world,
-    ecs_entity_t component,
-    const ecs_entity_t *entities,
-    void *ptr,
-    size_t size,
-    int32_t count,
-    void *ctx)
-{
-    (void)world;
-    (void)component;
-    (void)entities;
-    (void)ctx;
-    memset(ptr, 0, size * (size_t)count);
-}
+#endif
+#endif
 
-/* System destructor */
+/** Parse callback that adds type to type identifier for ecs_new_type */
 static
-void ecs_colsystem_dtor(
+int parse_type_action(
     ecs_world_t *world,
-    ecs_entity_t component,
-    const ecs_entity_t *entities,
-    void *ptr,
-    size_t size,
-    int32_t count,
-    void *ctx)
+    const char *name,
+    const char *sig,
+    int64_t column,
+    ecs_sig_from_kind_t from_kind,
+    ecs_sig_oper_kind_t oper_kind,
+    ecs_sig_inout_kind_t inout_kind,
+    ecs_entity_t role,
+    const char *entity_id,
+    const char *source_id,
+    const char *trait_id,
+    const char *arg_name,
+    void *data)
 {
-    (void)component;
-    (void)ctx;
-    (void)size;
+    ecs_vector_t **array = data;
+    (void)source_id;
+    (void)inout_kind;
+    
+    if (arg_name) {
+        ecs_parser_error(name, sig, column, 
+            "column names not supported in type expression");
+        return -1;
+    }
 
-    EcsSystem *system_data = ptr;
+    if (strcmp(entity_id, "0")) {
+        ecs_entity_t entity = 0;
 
-    int i;
-    for (i = 0; i < count; i ++) {
-        EcsSystem *cur = &system_data[i];
-        ecs_entity_t e = entities[i];
+        if (from_kind != EcsFromOwned) {
+            if (!name) {
+                return -1;
+            }
 
-        /* Invoke Deactivated action for active systems */
-        if (cur->query && ecs_vector_count(cur->query->tables)) {
-            invoke_status_action(world, e, ptr, EcsSystemDeactivated);
+            ecs_parser_error(name, sig, column, 
+                "source modifiers not supported for type expressions");
+            return -1;
         }
 
-        /* Invoke Disabled action for enabled systems */
-        if (!ecs_has_entity(world, e, EcsDisabled) && 
-            !ecs_has_entity(world, e, EcsDisabledIntern)) 
-        {
-            invoke_status_action(world, e, ptr, EcsSystemDisabled);
-        }           
+        entity = ecs_lookup_fullpath(world, entity_id);
+        if (!entity) {
+            if (!name) {
+                return -1;
+            }
 
-        ecs_os_free(cur->on_demand);
+            ecs_parser_error(name, sig, column, 
+                "unresolved identifier '%s'", entity_id);
+            return -1;
+        }
+
+        if (trait_id) {
+            ecs_entity_t trait = ecs_lookup_fullpath(world, trait_id);
+            if (!trait) {
+                ecs_parser_error(name, sig, column, 
+                    "unresolved trait identifier '%s'", trait_id);
+                return -1;
+            }
+
+            entity = ecs_entity_t_comb(entity, trait);
+        }        
+
+        if (oper_kind == EcsOperAnd) {
+            ecs_entity_t* e_ptr = ecs_vector_add(array, ecs_entity_t);
+            *e_ptr = entity | role;
+        } else {
+            if (!name) {
+                return -1;
+            }
+
+            /* Only AND and OR operators are supported for type expressions */
+            ecs_parser_error(name, sig, column, 
+                "invalid operator for type expression");
+            return -1;
+        }
     }
+
+    return 0;
 }
 
-/* Register a trigger for a component */
 static
-EcsTrigger* trigger_find_or_create(
-    ecs_vector_t **triggers,
-    ecs_entity_t entity)
+ecs_table_t* table_from_vec(
+    ecs_world_t *world,
+    ecs_vector_t *vec)
 {
-    ecs_vector_each(*triggers, EcsTrigger, trigger, {
-        if (trigger->self == entity) {
-            return trigger;
-        }
-    });
+    ecs_entity_t *array = ecs_vector_first(vec, ecs_entity_t);
+    int32_t count = ecs_vector_count(vec);
 
-    EcsTrigger *result = ecs_vector_add(triggers, EcsTrigger);
-    return result;
+    ecs_entities_t entities = {
+        .array = array,
+        .count = count
+    };
+
+    return ecs_table_find_or_create(world, &entities);
 }
 
 static
-void trigger_set(
+EcsType type_from_vec(
     ecs_world_t *world,
-    const ecs_entity_t *entities,
-    EcsTrigger *ct,
-    int32_t count)
+    ecs_vector_t *vec)
 {
-    EcsTrigger *el = NULL;
-
-    int i;
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t c = ct[i].component;
-        ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, c);
+    EcsType result = {0, 0};
+    ecs_table_t *table = table_from_vec(world, vec);
+    if (!table) {
+        return result;
+    }    
 
-        switch(ct[i].kind) {
-        case EcsOnAdd:
-            el = trigger_find_or_create(&c_info->on_add, entities[i]);
-            break;
-        case EcsOnRemove:
-            el = trigger_find_or_create(&c_info->on_remove, entities[i]);
-            break;
-        default:
-            ecs_abort(ECS_INVALID_PARAMETER, NULL);
-            break;
-        }
-        
-        ecs_assert(el != NULL, ECS_INTERNAL_ERROR, NULL);
+    result.type = table->type;
 
-        *el = ct[i];
-        el->self = entities[i];
+    /* Create normalized type. A normalized type resolves all elements with an
+     * AND flag and appends them to the resulting type, where the default type
+     * maintains the original type hierarchy. */
+    ecs_vector_t *normalized = NULL;
 
-        ecs_notify_tables(world, &(ecs_table_event_t) {
-            .kind = EcsTableComponentInfo,
-            .component = c
-        });        
+    ecs_entity_t *array = ecs_vector_first(vec, ecs_entity_t);
+    int32_t i, count = ecs_vector_count(vec);
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = array[i];
+        if (ECS_HAS_ROLE(e, AND)) {
+            ecs_entity_t entity = e & ECS_COMPONENT_MASK;
+            const EcsType *type_ptr = ecs_get(world, entity, EcsType);
+            ecs_assert(type_ptr != NULL, ECS_INVALID_PARAMETER, 
+                "flag must be applied to type");
 
-        ecs_trace_1("trigger #[green]%s#[normal] created for component #[red]%s",
-            ct[i].kind == EcsOnAdd
-                ? "OnAdd"
-                : "OnRemove", ecs_get_name(world, c));
+            ecs_vector_each(type_ptr->normalized, ecs_entity_t, c_ptr, {
+                ecs_entity_t *el = ecs_vector_add(&normalized, ecs_entity_t);
+                *el = *c_ptr;
+            })
+        }       
     }
-}
-
-static
-void OnSetTrigger(
-    ecs_iter_t *it)
-{
-    EcsTrigger *ct = ecs_column(it, EcsTrigger, 1);
-    
-    trigger_set(it->world, it->entities, ct, it->count);
-}
 
-static
-void OnSetTriggerCtx(
-    ecs_iter_t *it)
-{
-    EcsTrigger *ct = ecs_column(it, EcsTrigger, 1);
-    EcsContext *ctx = ecs_column(it, EcsContext, 2);
+    /* Only get normalized type if it's different from the type */
+    if (normalized) {
+        ecs_entities_t normalized_array = ecs_type_to_entities(normalized);
+        ecs_table_t *norm_table = ecs_table_traverse_add(
+            world, table, &normalized_array, NULL);
 
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ct[i].ctx = (void*)ctx[i].ctx;
+        result.normalized = norm_table->type;
+
+        ecs_vector_free(normalized);
+    } else {
+        result.normalized = result.type;
     }
 
-    trigger_set(it->world, it->entities, ct, it->count);    
+    return result;
 }
 
-/* System that registers component lifecycle callbacks */
 static
-void OnSetComponentLifecycle(
-    ecs_iter_t *it)
+EcsType type_from_expr(
+    ecs_world_t *world,
+    const char *name,
+    const char *expr)
 {
-    EcsComponentLifecycle *cl = ecs_column(it, EcsComponentLifecycle, 1);
-    ecs_world_t *world = it->world;
-
-    int i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_entity_t e = it->entities[i];
-        ecs_set_component_actions_w_entity(world, e, &cl[i]);   
+    if (expr) {
+        ecs_vector_t *vec = ecs_vector_new(ecs_entity_t, 1);
+        ecs_parse_expr(world, name, expr, parse_type_action, &vec);
+        EcsType result = type_from_vec(world, vec);
+        ecs_vector_free(vec);
+        return result;
+    } else {
+        return (EcsType){0, 0};
     }
 }
 
-/* Disable system when EcsDisabled is added */
-static 
-void DisableSystem(
-    ecs_iter_t *it)
+/* If a name prefix is set with ecs_set_name_prefix, check if the entity name
+ * has the prefix, and if so remove it. This enables using prefixed names in C
+ * for components / systems while storing a canonical / language independent 
+ * identifier. */
+const char* ecs_name_from_symbol(
+    ecs_world_t *world,
+    const char *type_name)
 {
-    EcsSystem *system_data = ecs_column(it, EcsSystem, 1);
-
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_enable_system(
-            it->world, it->entities[i], &system_data[i], false);
+    const char *prefix = world->name_prefix;
+    if (type_name && prefix) {
+        ecs_size_t len = ecs_os_strlen(prefix);
+        if (!ecs_os_strncmp(type_name, prefix, len) && 
+           (isupper(type_name[len]) || type_name[len] == '_')) 
+        {
+            if (type_name[len] == '_') {
+                return type_name + len + 1;
+            } else {
+                return type_name + len;
+            }
+        }
     }
+
+    return type_name;
 }
 
-/* Enable system when EcsDisabled is removed */
-static
-void EnableSystem(
-    ecs_iter_t *it)
+void ecs_set_symbol(
+    ecs_world_t *world,
+    ecs_entity_t e,
+    const char *name)
 {
-    EcsSystem *system_data = ecs_column(it, EcsSystem, 1);
+    const char *e_name = ecs_name_from_symbol(world, name);
 
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_enable_system(
-            it->world, it->entities[i], &system_data[i], true);
-    }
+    ecs_set(world, e, EcsName, { 
+        .value = e_name, 
+        .symbol = name 
+    });
 }
 
-/* Parse a signature expression into the ecs_sig_t data structure */
-static
-void CreateSignature(
-    ecs_iter_t *it) 
+ecs_entity_t ecs_lookup_w_id(
+    ecs_world_t *world,
+    ecs_entity_t e,
+    const char *name)
 {
-    ecs_world_t *world = it->world;
-    ecs_entity_t *entities = it->entities;
-
-    EcsSignatureExpr *signature = ecs_column(it, EcsSignatureExpr, 1);
+    if (e) {
+        if (name) {
+            /* Make sure name is the same */
+            const char *existing = ecs_get_name(world, e);
+            if (existing && strcmp(existing, name)) {
+                ecs_abort(ECS_INCONSISTENT_NAME, name);
+            }
+            if (!existing) {
+                ecs_set_symbol(world, e, name);
+            }
+        }
+    }
     
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_entity_t e = entities[i];
-        const char *name = ecs_get_name(world, e);
-
-        /* Parse the signature and add the result to the entity */
-        EcsSignature sig = {0};
-        ecs_sig_init(world, name, signature[0].expr, &sig.signature);
-        ecs_set_ptr(world, e, EcsSignature, &sig);
+    ecs_entity_t result = e;
+    if (!result) {
+        if (!name) {
+            /* If neither an id nor name is specified, return 0 */
+            return 0;
+        }
 
-        /* If sig has FromSystem columns, add components to the entity */
-        ecs_vector_each(sig.signature.columns, ecs_sig_column_t, column, {
-            if (column->from_kind == EcsFromSystem) {
-                ecs_add_entity(world, e, column->is.component);
-            }
-        });    
+        result = ecs_lookup(world, name);
     }
+    
+    return result;
 }
 
-/* Create a query from a signature */
-static
-void CreateQuery(
-    ecs_iter_t *it) 
-{
-    ecs_world_t *world = it->world;
-    ecs_entity_t *entities = it->entities;
+/* -- Public functions -- */
 
-    EcsSignature *signature = ecs_column(it, EcsSignature, 1);
-    
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_entity_t e = entities[i];
+ecs_type_t ecs_type_from_str(
+    ecs_world_t *world,
+    const char *expr)
+{
+    EcsType type = type_from_expr(world, NULL, expr);
+    return type.normalized;
+}
 
-        if (!ecs_has(world, e, EcsQuery)) {
-            EcsQuery query = {0};
-            query.query = ecs_query_new_w_sig(world, e, &signature[i].signature);
-            ecs_set_ptr(world, e, EcsQuery, &query);
-        }
+ecs_table_t* ecs_table_from_str(
+    ecs_world_t *world,
+    const char *expr)
+{
+    if (expr) {
+        ecs_vector_t *vec = ecs_vector_new(ecs_entity_t, 1);
+        ecs_parse_expr(world, NULL, expr, parse_type_action, &vec);
+        ecs_table_t *result = table_from_vec(world, vec);
+        ecs_vector_free(vec);
+        return result;
+    } else {
+        return NULL;
     }
 }
 
-/* Create a system from a query and an action */
-static
-void CreateSystem(
-    ecs_iter_t *it)
+ecs_entity_t ecs_new_entity(
+    ecs_world_t *world,
+    ecs_entity_t e,
+    const char *name,
+    const char *expr)
 {
-    ecs_world_t *world = it->world;
-    ecs_entity_t *entities = it->entities;
-
-    EcsQuery *query = ecs_column(it, EcsQuery, 1);
-    EcsIterAction *action = ecs_column(it, EcsIterAction, 2);
-    EcsContext *ctx = ecs_column(it, EcsContext, 3);
+    ecs_entity_t result = ecs_lookup_w_id(world, e, name);
+    if (!result) {
+        result = ecs_new(world, 0);
+        ecs_set_symbol(world, result, name);
+    }
     
-    int32_t i;
-    for (i = 0; i < it->count; i ++) {
-        ecs_entity_t e = entities[i];
-        void *ctx_ptr = NULL;
-        if (ctx) {
-            ctx_ptr = (void*)ctx[i].ctx;
-        }
+    EcsType type = type_from_expr(world, name, expr);
+    ecs_add_type(world, result, type.normalized);
 
-        ecs_init_system(world, e, action[i].action, query[i].query, ctx_ptr);
-    }
+    return result;
 }
 
-static
-void bootstrap_set_system(
+ecs_entity_t ecs_new_prefab(
     ecs_world_t *world,
+    ecs_entity_t e,
     const char *name,
-    const char *expr,
-    ecs_iter_action_t action)
+    const char *expr)
 {
-    ecs_sig_t sig = {0};
-    ecs_entity_t sys = ecs_set(world, 0, EcsName, {.value = name});
-    ecs_add_entity(world, sys, EcsOnSet);
-    ecs_sig_init(world, name, expr, &sig);
-    ecs_query_t *query = ecs_query_new_w_sig(world, sys, &sig);
-    ecs_init_system(world, sys, action, query, NULL);
+    ecs_entity_t result = ecs_lookup_w_id(world, e, name);
+    if (!result) {
+        result = ecs_new(world, 0);
+        ecs_set_symbol(world, result, name);
+    }
+
+    ecs_add_entity(world, result, EcsPrefab);
+
+    EcsType type = type_from_expr(world, name, expr);
+    ecs_add_type(world, result, type.normalized);
+
+    return result;
 }
 
-ecs_entity_t ecs_new_system(
+ecs_entity_t ecs_new_component(
     ecs_world_t *world,
     ecs_entity_t e,
     const char *name,
-    ecs_entity_t tag,
-    const char *signature,
-    ecs_iter_action_t action)
+    size_t size,
+    size_t alignment)
 {
-    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
-    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    assert(world->magic == ECS_WORLD_MAGIC);
+    bool in_progress = world->in_progress;
+
+    /* If world is in progress component may be registered, but only when not
+     * in multithreading mode. */
+    if (in_progress) {
+        ecs_assert(ecs_vector_count(world->workers) < 1, 
+            ECS_INVALID_WHILE_ITERATING, NULL);
+
+        /* Component creation should not be deferred */
+        ecs_defer_end(world);
+        world->in_progress = false;
+    }
 
     ecs_entity_t result = ecs_lookup_w_id(world, e, name);
     if (!result) {
-        result = ecs_new_entity(world, 0, name, NULL);
+        result = ecs_new_component_id(world);
+        ecs_set_symbol(world, result, name);
     }
 
-    if (tag) {
-        ecs_add_entity(world, result, tag);
+    /* ecs_new_component_id does not add the scope, so add it explicitly */
+    ecs_entity_t scope = world->stage.scope;
+    if (scope) {
+        ecs_add_entity(world, result, ECS_CHILDOF | scope);
     }
 
     bool added = false;
-    EcsSignatureExpr *expr = ecs_get_mut(world, result, EcsSignatureExpr, &added);
+    EcsComponent *ptr = ecs_get_mut(world, result, EcsComponent, &added);
+
     if (added) {
-        expr->expr = signature;
+        ptr->size = ecs_from_size_t(size);
+        ptr->alignment = ecs_from_size_t(alignment);
     } else {
-        if (!expr->expr || !signature) {
-            if (expr->expr != signature) {
-                if (expr->expr && !strcmp(expr->expr, "0")) {
-                    /* Ok */
-                } else if (signature && !strcmp(signature, "0")) {
-                    /* Ok */
-                } else {
-                    ecs_abort(ECS_ALREADY_DEFINED, NULL);
-                }
-            }
-        } else {
-            if (strcmp(expr->expr, signature)) {
-                ecs_abort(ECS_ALREADY_DEFINED, name);
-            }
+        if (ptr->size != ecs_from_size_t(size)) {
+            ecs_abort(ECS_INVALID_COMPONENT_SIZE, name);
+        }
+        if (ptr->alignment != ecs_from_size_t(alignment)) {
+            ecs_abort(ECS_INVALID_COMPONENT_SIZE, name);
         }
     }
 
-    ecs_modified(world, result, EcsSignatureExpr);
+    ecs_modified(world, result, EcsComponent);
 
-    ecs_set(world, result, EcsIterAction, {action});
+    if (e > world->stats.last_component_id && e < ECS_HI_COMPONENT_ID) {
+        world->stats.last_component_id = e + 1;
+    }
+
+    if (in_progress) {
+        world->in_progress = true;
+        ecs_defer_begin(world);
+    }
 
     return result;
 }
 
-ecs_entity_t ecs_new_trigger(
+ecs_entity_t ecs_new_type(
     ecs_world_t *world,
     ecs_entity_t e,
     const char *name,
-    ecs_entity_t kind,
-    const char *component_name,
-    ecs_iter_action_t action)
+    const char *expr)
 {
     assert(world->magic == ECS_WORLD_MAGIC);
 
-    ecs_entity_t component = ecs_lookup_fullpath(world, component_name);
-    ecs_assert(component != 0, ECS_INVALID_COMPONENT_ID, component_name);
-
     ecs_entity_t result = ecs_lookup_w_id(world, e, name);
     if (!result) {
         result = ecs_new_entity(world, 0, name, NULL);
     }
+    
+    EcsType type_parsed = type_from_expr(world, name, expr);
 
     bool added = false;
-    EcsTrigger *trigger = ecs_get_mut(world, result, EcsTrigger, &added);
+    EcsType *type = ecs_get_mut(world, result, EcsType, &added);
     if (added) {
-        trigger->kind = kind;
-        trigger->action = action;
-        trigger->component = component;
-        trigger->ctx = NULL;
+        type->type = type_parsed.type;
+        type->normalized = type_parsed.normalized;
     } else {
-        if (trigger->kind != kind) {
+        if (type->type != type_parsed.type) {
             ecs_abort(ECS_ALREADY_DEFINED, name);
         }
 
-        if (trigger->component != component) {
+        if (type->normalized != type_parsed.normalized) {
             ecs_abort(ECS_ALREADY_DEFINED, name);
         }
+    }     
 
-        if (trigger->action != action) {
-            trigger->action = action;
-        }
+    /* This will allow the type to show up in debug tools */
+    ecs_map_set(world->type_handles, (uintptr_t)type_parsed.type, &result);
+
+    return result;
+}
+
+/* Global type variables */
+ecs_type_t ecs_type(EcsComponent);
+ecs_type_t ecs_type(EcsType);
+ecs_type_t ecs_type(EcsName);
+ecs_type_t ecs_type(EcsChildOf);
+ecs_type_t ecs_type(EcsPrefab);
+
+/* Component lifecycle actions for EcsName */
+ECS_CTOR(EcsName, ptr, {
+    ptr->value = NULL;
+    ptr->alloc_value = NULL;
+    ptr->symbol = NULL;
+})
+
+ECS_DTOR(EcsName, ptr, {
+    ecs_track_name_free(ptr->alloc_value);
+    ecs_os_free(ptr->alloc_value);
+    ptr->value = NULL;
+    ptr->alloc_value = NULL;
+    ptr->symbol = NULL;
+})
+
+ECS_COPY(EcsName, dst, src, {
+    if (dst->alloc_value) {
+        ecs_track_name_free(dst->alloc_value);
+        ecs_os_free(dst->alloc_value);
+        dst->alloc_value = NULL;
     }
     
-    ecs_modified(world, result, EcsTrigger);
+    if (src->alloc_value) {
+        dst->alloc_value = ecs_os_strdup(src->alloc_value);
+        dst->value = dst->alloc_value;
+        ecs_track_name_alloc(dst->alloc_value);
+    } else {
+        dst->alloc_value = NULL;
+        dst->value = src->value;
+    }
+    dst->symbol = src->symbol;
+})
+
+ECS_MOVE(EcsName, dst, src, {
+    dst->value = src->value;
+    dst->alloc_value = src->alloc_value;
+    dst->symbol = src->symbol;
+
+    src->value = NULL;
+    src->alloc_value = NULL;
+    src->symbol = NULL;
+})
+
+/* Component lifecycle actions for EcsChildOf. Copying or moving a parent into
+ * an element registers the entity with the child index of the parent. Entries
+ * that become stale when the parent changes are discarded when the index is
+ * read, which keeps the table moves that call these actions cheap. */
+ECS_CTOR(EcsChildOf, ptr, {
+    ptr->parent = 0;
+})
+
+ECS_COPY(EcsChildOf, dst, src, {
+    if (src->parent && src->parent != dst->parent) {
+        ecs_childof_register(world, src->parent, dst_entity);
+    }
+    dst->parent = src->parent;
+})
+
+ECS_MOVE(EcsChildOf, dst, src, {
+    if (src->parent && src->parent != dst->parent) {
+        ecs_childof_register(world, src->parent, dst_entity);
+    }
+    dst->parent = src->parent;
+    src->parent = 0;
+})
+
+
+/* -- Bootstrapping -- */
+
+#define bootstrap_component(world, table, name)\
+    _bootstrap_component(world, table, ecs_typeid(name), #name, sizeof(name),\
+        ECS_ALIGNOF(name))
+
+void _bootstrap_component(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_entity_t entity,
+    const char *id,
+    ecs_size_t size,
+    ecs_size_t alignment)
+{
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_data_t *data = ecs_table_get_or_create_data(table);
+    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_column_t *columns = data->columns;
+    ecs_assert(columns != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* Create record in entity index */
+    ecs_record_t *record = ecs_eis_get_or_create(world, entity);
+    record->table = table;
+
+    /* Insert row into table to store EcsComponent itself */
+    int32_t index = ecs_table_append(world, table, data, entity, record, false);
+    record->row = index + 1;
+
+    /* Set size and id */
+    EcsComponent *c_info = ecs_vector_first(columns[0].data, EcsComponent);
+    EcsName *id_data = ecs_vector_first(columns[1].data, EcsName);
+    
+    c_info[index].size = size;
+    c_info[index].alignment = alignment;
+    id_data[index].value = &id[ecs_os_strlen("Ecs")]; /* Skip prefix */
+    id_data[index].symbol = id;
+    id_data[index].alloc_value = NULL;
+}
+
+/** Create type for component */
+ecs_type_t ecs_bootstrap_type(
+    ecs_world_t *world,
+    ecs_entity_t entity)
+{
+    ecs_table_t *table = ecs_table_find_or_create(world, &(ecs_entities_t){
+        .array = (ecs_entity_t[]){entity},
+        .count = 1
+    });
+
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(table->type != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    return table->type;
+}
+
+/** Bootstrap types for builtin components and tags */
+static
+void bootstrap_types(
+    ecs_world_t *world)
+{
+    ecs_type(EcsComponent) = ecs_bootstrap_type(world, ecs_typeid(EcsComponent));
+    ecs_type(EcsType) = ecs_bootstrap_type(world, ecs_typeid(EcsType));
+    ecs_type(EcsName) = ecs_bootstrap_type(world, ecs_typeid(EcsName));
+    ecs_type(EcsChildOf) = ecs_bootstrap_type(world, ecs_typeid(EcsChildOf));
+}
+
+/** Initialize component table. This table is manually constructed to bootstrap
+ * flecs. After this function has been called, the builtin components can be
+ * created. 
+ * The reason this table is constructed manually is because it requires the size
+ * and alignment of the EcsComponent and EcsName components, which haven't been 
+ * created yet */
+static
+ecs_table_t* bootstrap_component_table(
+    ecs_world_t *world)
+{
+    ecs_entity_t entities[] = {ecs_typeid(EcsComponent), ecs_typeid(EcsName), ECS_CHILDOF | EcsFlecsCore};
+    ecs_entities_t array = {
+        .array = entities,
+        .count = 3
+    };
+
+    ecs_table_t *result = ecs_table_find_or_create(world, &array);
+    ecs_data_t *data = ecs_table_get_or_create_data(result);
+
+    /* Preallocate enough memory for initial components */
+    data->entities = ecs_vector_new(ecs_entity_t, EcsFirstUserComponentId);
+    data->record_ptrs = ecs_vector_new(ecs_record_t*, EcsFirstUserComponentId);
 
+    data->columns = ecs_os_malloc(sizeof(ecs_column_t) * 2);
+    ecs_assert(data->columns != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    data->columns[0].data = ecs_vector_new(EcsComponent, EcsFirstUserComponentId);
+    data->columns[0].size = sizeof(EcsComponent);
+    data->columns[0].alignment = ECS_ALIGNOF(EcsComponent);
+    data->columns[1].data = ecs_vector_new(EcsName, EcsFirstUserComponentId);
+    data->columns[1].size = sizeof(EcsName);
+    data->columns[1].alignment = ECS_ALIGNOF(EcsName);
+
+    result->column_count = 2;
+    
     return result;
 }
 
-void FlecsSystemImport(
+void ecs_bootstrap(
     ecs_world_t *world)
 {
-    ECS_MODULE(world, FlecsSystem);
+    ecs_type(EcsComponent) = NULL;
 
-    ecs_set_name_prefix(world, "Ecs");
+    ecs_trace_1("bootstrap core components");
+    ecs_log_push();
 
-    ecs_bootstrap_component(world, EcsComponentLifecycle);
-    ecs_bootstrap_component(world, EcsTrigger);
-    ecs_bootstrap_component(world, EcsSystem);
-    ecs_bootstrap_component(world, EcsTickSource);
-    ecs_bootstrap_component(world, EcsSignatureExpr);
-    ecs_bootstrap_component(world, EcsSignature);
-    ecs_bootstrap_component(world, EcsQuery);
-    ecs_bootstrap_component(world, EcsIterAction);
-    ecs_bootstrap_component(world, EcsContext);
+    /* Create table that will hold components (EcsComponent, EcsName) */
+    ecs_table_t *table = bootstrap_component_table(world);
+    assert(table != NULL);
+
+    bootstrap_component(world, table, EcsComponent);
+    bootstrap_component(world, table, EcsType);
+    bootstrap_component(world, table, EcsName);
+    bootstrap_component(world, table, EcsChildOf);
+
+    world->stats.last_component_id = EcsFirstUserComponentId;
+    world->stats.last_id = EcsFirstUserEntityId;
+    world->stats.min_id = 0;
+    world->stats.max_id = 0;
+
+    bootstrap_types(world);
+
+    ecs_set_scope(world, EcsFlecsCore);
+
+    ecs_bootstrap_tag(world, EcsModule);
+    ecs_bootstrap_tag(world, EcsPrefab);
+    ecs_bootstrap_tag(world, EcsHidden);
+    ecs_bootstrap_tag(world, EcsDisabled);
 
-    ecs_bootstrap_tag(world, EcsOnAdd);
-    ecs_bootstrap_tag(world, EcsOnRemove);
-    ecs_bootstrap_tag(world, EcsOnSet);
-    ecs_bootstrap_tag(world, EcsUnSet);
+    ecs_set_component_actions(world, EcsName, {
+        .ctor = ecs_ctor(EcsName),
+        .dtor = ecs_dtor(EcsName),
+        .copy = ecs_copy(EcsName),
+        .move = ecs_move(EcsName)
+    });
 
-    ecs_bootstrap_tag(world, EcsDisabledIntern);
-    ecs_bootstrap_tag(world, EcsInactive);
+    ecs_set_component_actions(world, EcsChildOf, {
+        .ctor = ecs_ctor(EcsChildOf),
+        .copy = ecs_copy(EcsChildOf),
+        .move = ecs_move(EcsChildOf)
+    });
 
-    /* Put EcsOnDemand and EcsMonitor in flecs.core so they can be looked up
-     * without using the flecs.systems prefix */
-    ecs_entity_t old_scope = ecs_set_scope(world, EcsFlecsCore);
-    ecs_bootstrap_tag(world, EcsOnDemand);
-    ecs_bootstrap_tag(world, EcsMonitor);
-    ecs_set_scope(world, old_scope);
+    /* Initialize scopes */
+    ecs_set(world, EcsFlecs, EcsName, {.value = "flecs"});
+    ecs_add_entity(world, EcsFlecs, EcsModule);
+    ecs_set(world, EcsFlecsCore, EcsName, {.value = "core"});
+    ecs_add_entity(world, EcsFlecsCore, EcsModule);
+    ecs_add_entity(world, EcsFlecsCore, ECS_CHILDOF | EcsFlecs);
 
-    ECS_TYPE_IMPL(EcsComponentLifecycle);
-    ECS_TYPE_IMPL(EcsTrigger);
-    ECS_TYPE_IMPL(EcsSystem);
-    ECS_TYPE_IMPL(EcsTickSource);
-    ECS_TYPE_IMPL(EcsSignatureExpr);
-    ECS_TYPE_IMPL(EcsSignature);
-    ECS_TYPE_IMPL(EcsQuery);
-    ECS_TYPE_IMPL(EcsIterAction);
-    ECS_TYPE_IMPL(EcsContext);
+    /* Initialize EcsWorld */
+    ecs_set(world, EcsWorld, EcsName, {.value = "World"});
+    ecs_assert(ecs_get_name(world, EcsWorld) != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(ecs_lookup(world, "World") == EcsWorld, ECS_INTERNAL_ERROR, NULL);
+    ecs_add_entity(world, EcsWorld, ECS_CHILDOF | EcsFlecsCore);
 
-    /* Bootstrap ctor and dtor for EcsSystem */
-    ecs_set_component_actions_w_entity(world, ecs_typeid(EcsSystem), 
-        &(EcsComponentLifecycle) {
-            .ctor = sys_ctor_init_zero,
-            .dtor = ecs_colsystem_dtor
-        });
+    /* Initialize EcsSingleton */
+    ecs_set(world, EcsSingleton, EcsName, {.value = "$"});
+    ecs_assert(ecs_get_name(world, EcsSingleton) != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(ecs_lookup(world, "$") == EcsSingleton, ECS_INTERNAL_ERROR, NULL);
+    ecs_add_entity(world, EcsSingleton, ECS_CHILDOF | EcsFlecsCore);
 
-    /* Create systems necessary to create systems */
-    bootstrap_set_system(world, "CreateSignature", "SignatureExpr", CreateSignature);
-    bootstrap_set_system(world, "CreateQuery", "Signature, IterAction", CreateQuery);
-    bootstrap_set_system(world, "CreateSystem", "Query, IterAction, ?Context", CreateSystem);
+    /* Initialize EcsWildcard */
+    ecs_set(world, EcsWildcard, EcsName, {.value = "*"});
+    ecs_assert(ecs_get_name(world, EcsWildcard) != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(ecs_lookup(world, "*") == EcsWildcard, ECS_INTERNAL_ERROR, NULL);
+    ecs_add_entity(world, EcsWildcard, ECS_CHILDOF | EcsFlecsCore);    
 
-    /* From here we can create systems */
+    ecs_set_scope(world, 0);
 
-    /* Register OnSet system for EcsComponentLifecycle */
-    ECS_SYSTEM(world, OnSetComponentLifecycle, EcsOnSet, ComponentLifecycle, SYSTEM:Hidden);
+    ecs_log_pop();
+}
 
-    /* Register OnSet system for triggers */
-    ECS_SYSTEM(world, OnSetTrigger, EcsOnSet, Trigger, SYSTEM:Hidden);
 
-    /* System that sets ctx for a trigger */
-    ECS_SYSTEM(world, OnSetTriggerCtx, EcsOnSet, Trigger, Context, SYSTEM:Hidden);
+/* -- EcsChildOf index -- */
 
-    /* Monitors that trigger when a system is enabled or disabled */
-    ECS_SYSTEM(world, DisableSystem, EcsMonitor, System, Disabled || DisabledIntern, SYSTEM:Hidden);
-    ECS_SYSTEM(world, EnableSystem, EcsMonitor, System, !Disabled, !DisabledIntern, SYSTEM:Hidden);
+static
+ecs_map_t* get_children(
+    ecs_world_t *world,
+    ecs_entity_t parent)
+{
+    return ecs_map_get_ptr(world->childof_index, ecs_map_t*, parent);
 }
 
-#endif
-
+static
+ecs_map_iter_t childof_iter(
+    ecs_world_t *world,
+    ecs_entity_t parent)
+{
+    ecs_map_t *children = get_children(world, parent);
+    if (children) {
+        return ecs_map_iter(children);
+    } else {
+        return (ecs_map_iter_t){ 0 };
+    }
+}
 
-#ifdef FLECS_SYSTEM
-#ifdef FLECS_DBG
+/* Entries in the index are not removed when the parent of a child changes, so
+ * test if the entry is still valid before using it */
+static
+bool is_childof(
+    ecs_world_t *world,
+    ecs_entity_t child,
+    ecs_entity_t parent)
+{
+    if (!ecs_is_alive(world, child)) {
+        return false;
+    }
 
+    const EcsChildOf *ptr = ecs_get(world, child, EcsChildOf);
+    return ptr && ptr->parent == parent;
+}
 
-int ecs_dbg_system(
+static
+int32_t count_children_in_index(
     ecs_world_t *world,
-    ecs_entity_t system,
-    ecs_dbg_system_t *dbg_out)
+    ecs_entity_t parent)
 {
-    const EcsSystem *system_data = ecs_get(world, system, EcsSystem);
-    if (!system_data) {
-        return -1;
+    ecs_map_t *children = get_children(world, parent);
+    if (!children) {
+        return 0;
     }
 
-    *dbg_out = (ecs_dbg_system_t){.system = system};
-    dbg_out->active_table_count = ecs_vector_count(system_data->query->tables);
-    dbg_out->inactive_table_count = ecs_vector_count(system_data->query->empty_tables);
-    dbg_out->enabled = !ecs_has_entity(world, system, EcsDisabled);
+    ecs_vector_t *stale = NULL;
+    int32_t count = 0;
 
-    ecs_vector_each(system_data->query->tables, ecs_matched_table_t, mt, {
-        ecs_table_t *table = mt->data.table;
-        if (table) {
-            dbg_out->entities_matched_count += ecs_table_count(table);
-        }        
-    });
+    ecs_map_iter_t it = ecs_map_iter(children);
+    ecs_map_key_t child;
+    while (ecs_map_next(&it, ecs_entity_t, &child)) {
+        if (is_childof(world, child, parent)) {
+            count ++;
+        } else {
+            ecs_entity_t *el = ecs_vector_add(&stale, ecs_entity_t);
+            *el = child;
+        }
+    }
 
-    /* Inactive tables are inactive because they are empty, so no need to 
-     * iterate them */
+    /* Discard entries of children that moved to another parent. Don't do this
+     * while iterating, as a scope iterator may be iterating the index. */
+    if (!world->in_progress) {
+        ecs_vector_each(stale, ecs_entity_t, e_ptr, {
+            ecs_map_remove(children, *e_ptr);
+        });
+    }
 
-    return 0;
+    ecs_vector_free(stale);
+
+    return count;
 }
 
-bool ecs_dbg_match_entity(
+void ecs_childof_register(
     ecs_world_t *world,
-    ecs_entity_t entity,
-    ecs_entity_t system,
-    ecs_match_failure_t *failure_info_out)
+    ecs_entity_t parent,
+    ecs_entity_t child)
 {
-    ecs_dbg_entity_t dbg;
-    ecs_dbg_entity(world, entity, &dbg);
+    if (!world->childof_index) {
+        world->childof_index = ecs_map_new(ecs_map_t*, 1);
+    }
 
-    const EcsSystem *system_data = ecs_get(world, system, EcsSystem);
-    if (!system_data) {
-        failure_info_out->reason = EcsMatchNotASystem;
-        failure_info_out->column = -1;
-        return false;
+    ecs_map_t *children = get_children(world, parent);
+    if (!children) {
+        children = ecs_map_new(ecs_entity_t, 1);
+        ecs_map_set(world->childof_index, parent, &children);
+
+        /* Ensure children are deleted when the parent is deleted */
+        ecs_set_watch(world, parent);
     }
 
-    return ecs_query_match(
-        world, dbg.table, system_data->query, failure_info_out);
+    ecs_map_set(children, child, &child);
 }
 
-
-ecs_table_t* ecs_dbg_active_table(
+void ecs_childof_unregister(
     ecs_world_t *world,
-    ecs_dbg_system_t *dbg,
-    int32_t index)
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t row)
 {
-    (void)world;
+    int32_t column = ecs_type_index_of(table->type, ecs_typeid(EcsChildOf));
+    ecs_assert(column != -1, ECS_INTERNAL_ERROR, NULL);
 
-    EcsSystem *system_data = dbg->system_data;
-    ecs_matched_table_t *table = ecs_vector_get(
-        system_data->query->tables, ecs_matched_table_t, index);
-    if (!table) {
-        return NULL;
+    EcsChildOf *ptr = ecs_vector_get(
+        data->columns[column].data, EcsChildOf, row);
+    ecs_assert(ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_map_t *children = get_children(world, ptr->parent);
+    if (children) {
+        ecs_entity_t child = *ecs_vector_get(data->entities, ecs_entity_t, row);
+        ecs_map_remove(children, child);
     }
-    
-    return table->data.table;
 }
 
-ecs_table_t* ecs_dbg_inactive_table(
+ecs_vector_t* ecs_childof_get_children(
     ecs_world_t *world,
-    ecs_dbg_system_t *dbg,
-    int32_t index)
+    ecs_entity_t parent)
 {
-    (void)world;
+    ecs_vector_t *result = NULL;
 
-    EcsSystem *system_data = dbg->system_data;
-    ecs_matched_table_t *table = ecs_vector_get(
-        system_data->query->empty_tables, ecs_matched_table_t, index);
-    if (!table) {
-        return NULL;
+    ecs_map_iter_t it = childof_iter(world, parent);
+    if (it.map) {
+        ecs_map_key_t child;
+        while (ecs_map_next(&it, ecs_entity_t, &child)) {
+            if (is_childof(world, child, parent)) {
+                ecs_entity_t *el = ecs_vector_add(&result, ecs_entity_t);
+                *el = child;
+            }
+        }
     }
-    
-    return table->data.table;
+
+    return result;
 }
 
-ecs_type_t ecs_dbg_get_column_type(
+void ecs_childof_delete_children(
     ecs_world_t *world,
-    ecs_entity_t system,
-    int32_t column_index)
+    ecs_entity_t parent)
 {
-    const EcsSystem *system_data = ecs_get(world, system, EcsSystem);
-    if (!system_data) {
-        return NULL;
+    ecs_map_t *children = get_children(world, parent);
+    if (!children) {
+        return;
     }
-    
-    ecs_sig_column_t *columns = ecs_vector_first(
-        system_data->query->sig.columns, ecs_sig_column_t);
-    int32_t count = ecs_vector_count(system_data->query->sig.columns);
 
-    if (count < column_index) {
-        return NULL;
-    }
+    /* Collect children before deleting, as deleting them modifies the index */
+    ecs_vector_t *to_delete = ecs_childof_get_children(world, parent);
 
-    ecs_sig_column_t *column = &columns[column_index - 1];
-    ecs_sig_oper_kind_t oper_kind = column->oper_kind;
-    ecs_type_t result;
+    ecs_map_remove(world->childof_index, parent);
+    ecs_map_free(children);
 
-    switch(oper_kind) {
-    case EcsOperOr:
-        result = column->is.type;
-        break;
-    default:
-        result = ecs_type_from_entity(world, column->is.component);
-        break;
-    }
-    
-    return result;
-}
+    ecs_vector_each(to_delete, ecs_entity_t, e_ptr, {
+        ecs_delete(world, *e_ptr);
+    });
 
-#endif
-#endif
+    ecs_vector_free(to_delete);
+}
 
-/** Parse callback that adds type to type identifier for ecs_new_type */
-static
-int parse_type_action(
-    ecs_world_t *world,
-    const char *name,
-    const char *sig,
-    int64_t column,
-    ecs_sig_from_kind_t from_kind,
-    ecs_sig_oper_kind_t oper_kind,
-    ecs_sig_inout_kind_t inout_kind,
-    ecs_entity_t role,
-    const char *entity_id,
-    const char *source_id,
-    const char *trait_id,
-    const char *arg_name,
-    void *data)
+void ecs_childof_index_rebuild(
+    ecs_world_t *world)
 {
-    ecs_vector_t **array = data;
-    (void)source_id;
-    (void)inout_kind;
-    
-    if (arg_name) {
-        ecs_parser_error(name, sig, column, 
-            "column names not supported in type expression");
-        return -1;
-    }
+    ecs_childof_index_free(world);
 
-    if (strcmp(entity_id, "0")) {
-        ecs_entity_t entity = 0;
+    int32_t t, table_count = ecs_sparse_count(world->store.tables);
+    for (t = 0; t < table_count; t ++) {
+        ecs_table_t *table = ecs_sparse_get(world->store.tables, ecs_table_t, t);
+        if (!(table->flags & EcsTableHasChildOf)) {
+            continue;
+        }
 
-        if (from_kind != EcsFromOwned) {
-            if (!name) {
-                return -1;
-            }
+        ecs_data_t *data = ecs_table_get_data(table);
+        if (!data || !data->columns) {
+            continue;
+        }
 
-            ecs_parser_error(name, sig, column, 
-                "source modifiers not supported for type expressions");
-            return -1;
+        int32_t column = ecs_type_index_of(
+            table->type, ecs_typeid(EcsChildOf));
+        ecs_assert(column != -1, ECS_INTERNAL_ERROR, NULL);
+
+        ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+        EcsChildOf *values = ecs_vector_first(
+            data->columns[column].data, EcsChildOf);
+
+        int32_t i, count = ecs_vector_count(data->entities);
+        for (i = 0; i < count; i ++) {
+            if (values[i].parent) {
+                ecs_childof_register(world, values[i].parent, entities[i]);
+            }
         }
+    }
+}
 
-        entity = ecs_lookup_fullpath(world, entity_id);
-        if (!entity) {
-            if (!name) {
-                return -1;
-            }
+void ecs_childof_index_free(
+    ecs_world_t *world)
+{
+    if (!world->childof_index) {
+        return;
+    }
 
-            ecs_parser_error(name, sig, column, 
-                "unresolved identifier '%s'", entity_id);
-            return -1;
+    ecs_map_iter_t it = ecs_map_iter(world->childof_index);
+    ecs_map_t *children;
+    while ((children = ecs_map_next_ptr(&it, ecs_map_t*, NULL))) {
+        ecs_map_free(children);
+    }
+
+    ecs_map_free(world->childof_index);
+    world->childof_index = NULL;
+}
+
+static
+bool path_append(
+    ecs_world_t *world, 
+    ecs_entity_t parent, 
+    ecs_entity_t child, 
+    ecs_entity_t component,
+    const char *sep,
+    const char *prefix,
+    ecs_strbuf_t *buf)
+{
+    ecs_entity_t cur = ecs_get_parent_w_entity(world, child, component);
+    
+    if (cur) {
+        if (cur != parent && cur != EcsFlecsCore) {
+            path_append(world, parent, cur, component, sep, prefix, buf);
+            ecs_strbuf_appendstr(buf, sep);
         }
+    } else if (prefix) {
+        ecs_strbuf_appendstr(buf, prefix);
+    }
 
-        if (trait_id) {
-            ecs_entity_t trait = ecs_lookup_fullpath(world, trait_id);
-            if (!trait) {
-                ecs_parser_error(name, sig, column, 
-                    "unresolved trait identifier '%s'", trait_id);
-                return -1;
-            }
+    char buff[22];
+    const char *name = ecs_get_name(world, child);
+    if (!name) {
+        ecs_os_sprintf(buff, "%u", (uint32_t)child);
+        name = buff;
+    }
 
-            entity = ecs_entity_t_comb(entity, trait);
-        }        
+    ecs_strbuf_appendstr(buf, name);
 
-        if (oper_kind == EcsOperAnd) {
-            ecs_entity_t* e_ptr = ecs_vector_add(array, ecs_entity_t);
-            *e_ptr = entity | role;
-        } else {
-            if (!name) {
-                return -1;
-            }
+    return cur != 0;
+}
 
-            /* Only AND and OR operators are supported for type expressions */
-            ecs_parser_error(name, sig, column, 
-                "invalid operator for type expression");
-            return -1;
+static
+ecs_entity_t find_as_alias(
+    ecs_world_t *world,
+    const char *name)
+{
+    int32_t i, count = ecs_vector_count(world->aliases);
+    ecs_alias_t *aliases = ecs_vector_first(world->aliases, ecs_alias_t);
+    for (i = 0; i < count; i ++) {
+        if (!strcmp(aliases[i].name, name)) {
+            return aliases[i].entity;
         }
     }
 
     return 0;
 }
 
-static
-ecs_table_t* table_from_vec(
+char* ecs_get_path_w_sep(
     ecs_world_t *world,
-    ecs_vector_t *vec)
+    ecs_entity_t parent,
+    ecs_entity_t child,
+    ecs_entity_t component,
+    const char *sep,
+    const char *prefix)
 {
-    ecs_entity_t *array = ecs_vector_first(vec, ecs_entity_t);
-    int32_t count = ecs_vector_count(vec);
+    ecs_strbuf_t buf = ECS_STRBUF_INIT;
 
-    ecs_entities_t entities = {
-        .array = array,
-        .count = count
-    };
+    if (parent != child) {
+        path_append(world, parent, child, component, sep, prefix, &buf);
+    } else {
+        ecs_strbuf_appendstr(&buf, "");
+    }
 
-    return ecs_table_find_or_create(world, &entities);
+    return ecs_strbuf_get(&buf);
 }
 
 static
-EcsType type_from_vec(
-    ecs_world_t *world,
-    ecs_vector_t *vec)
+bool is_number(
+    const char *name)
 {
-    EcsType result = {0, 0};
-    ecs_table_t *table = table_from_vec(world, vec);
-    if (!table) {
-        return result;
-    }    
+    if (!isdigit(name[0])) {
+        return false;
+    }
 
-    result.type = table->type;
+    ecs_size_t i, s = ecs_os_strlen(name);
+    for (i = 0; i < s; i ++) {
+        if (!isdigit(name[i])) {
+            break;
+        }
+    }
 
-    /* Create normalized type. A normalized type resolves all elements with an
-     * AND flag and appends them to the resulting type, where the default type
-     * maintains the original type hierarchy. */
-    ecs_vector_t *normalized = NULL;
+    return i == s;
+}
 
-    ecs_entity_t *array = ecs_vector_first(vec, ecs_entity_t);
-    int32_t i, count = ecs_vector_count(vec);
-    for (i = 0; i < count; i ++) {
-        ecs_entity_t e = array[i];
-        if (ECS_HAS_ROLE(e, AND)) {
-            ecs_entity_t entity = e & ECS_COMPONENT_MASK;
-            const EcsType *type_ptr = ecs_get(world, entity, EcsType);
-            ecs_assert(type_ptr != NULL, ECS_INVALID_PARAMETER, 
-                "flag must be applied to type");
+static 
+ecs_entity_t name_to_id(
+    const char *name)
+{
+    long int result = atol(name);
+    ecs_assert(result >= 0, ECS_INTERNAL_ERROR, NULL);
+    return (ecs_entity_t)result;
+}
 
-            ecs_vector_each(type_ptr->normalized, ecs_entity_t, c_ptr, {
-                ecs_entity_t *el = ecs_vector_add(&normalized, ecs_entity_t);
-                *el = *c_ptr;
-            })
-        }       
+static
+ecs_entity_t find_child_in_table(
+    ecs_table_t *table,
+    const char *name)
+{
+    /* If table doesn't have EcsName, then don't bother */
+    int32_t name_index = ecs_type_index_of(table->type, ecs_typeid(EcsName));
+    if (name_index == -1) {
+        return 0;
     }
 
-    /* Only get normalized type if it's different from the type */
-    if (normalized) {
-        ecs_entities_t normalized_array = ecs_type_to_entities(normalized);
-        ecs_table_t *norm_table = ecs_table_traverse_add(
-            world, table, &normalized_array, NULL);
+    ecs_data_t *data = ecs_table_get_data(table);
+    if (!data || !data->columns) {
+        return 0;
+    }
 
-        result.normalized = norm_table->type;
+    int32_t i, count = ecs_vector_count(data->entities);
+    if (!count) {
+        return 0;
+    }
 
-        ecs_vector_free(normalized);
-    } else {
-        result.normalized = result.type;
+    if (is_number(name)) {
+        return name_to_id(name);
     }
 
-    return result;
-}
+    ecs_column_t *column = &data->columns[name_index];
+    EcsName *names = ecs_vector_first(column->data, EcsName);
 
-static
-EcsType type_from_expr(
-    ecs_world_t *world,
-    const char *name,
-    const char *expr)
-{
-    if (expr) {
-        ecs_vector_t *vec = ecs_vector_new(ecs_entity_t, 1);
-        ecs_parse_expr(world, name, expr, parse_type_action, &vec);
-        EcsType result = type_from_vec(world, vec);
-        ecs_vector_free(vec);
-        return result;
-    } else {
-        return (EcsType){0, 0};
+    for (i = 0; i < count; i ++) {
+        const char *cur_name = names[i].value;
+        const char *cur_sym = names[i].symbol;
+        if ((cur_name && !strcmp(cur_name, name)) || (cur_sym && !strcmp(cur_sym, name))) {
+            return *ecs_vector_get(data->entities, ecs_entity_t, i);
+        }
     }
+
+    return 0;
 }
 
-/* If a name prefix is set with ecs_set_name_prefix, check if the entity name
- * has the prefix, and if so remove it. This enables using prefixed names in C
- * for components / systems while storing a canonical / language independent 
- * identifier. */
-const char* ecs_name_from_symbol(
+static
+ecs_entity_t find_child(
     ecs_world_t *world,
-    const char *type_name)
+    ecs_entity_t parent,
+    const char *name)
 {
-    const char *prefix = world->name_prefix;
-    if (type_name && prefix) {
-        ecs_size_t len = ecs_os_strlen(prefix);
-        if (!ecs_os_strncmp(type_name, prefix, len) && 
-           (isupper(type_name[len]) || type_name[len] == '_')) 
-        {
-            if (type_name[len] == '_') {
-                return type_name + len + 1;
-            } else {
-                return type_name + len;
-            }
+    (void)parent;
+    
+    ecs_sparse_each(world->store.tables, ecs_table_t, table, {
+        ecs_entity_t result = find_child_in_table(table, name);
+        if (result) {
+            return result;
         }
-    }
+    });    
 
-    return type_name;
+    return 0;
 }
 
-void ecs_set_symbol(
+static
+ecs_entity_t find_child_in_index(
     ecs_world_t *world,
-    ecs_entity_t e,
+    ecs_entity_t parent,
     const char *name)
 {
-    const char *e_name = ecs_name_from_symbol(world, name);
+    ecs_map_iter_t it = childof_iter(world, parent);
+    if (!it.map) {
+        return 0;
+    }
 
-    ecs_set(world, e, EcsName, { 
-        .value = e_name, 
-        .symbol = name 
-    });
+    ecs_entity_t *child_ptr;
+    while ((child_ptr = ecs_map_next(&it, ecs_entity_t, NULL))) {
+        ecs_entity_t child = *child_ptr;
+        if (!is_childof(world, child, parent)) {
+            continue;
+        }
+
+        const EcsName *ptr = ecs_get(world, child, EcsName);
+        if (!ptr) {
+            continue;
+        }
+
+        if ((ptr->value && !strcmp(ptr->value, name)) || 
+            (ptr->symbol && !strcmp(ptr->symbol, name))) 
+        {
+            return child;
+        }
+    }
+
+    return 0;
 }
 
-ecs_entity_t ecs_lookup_w_id(
+ecs_entity_t ecs_lookup_child(
     ecs_world_t *world,
-    ecs_entity_t e,
+    ecs_entity_t parent,
     const char *name)
 {
-    if (e) {
-        if (name) {
-            /* Make sure name is the same */
-            const char *existing = ecs_get_name(world, e);
-            if (existing && strcmp(existing, name)) {
-                ecs_abort(ECS_INCONSISTENT_NAME, name);
-            }
-            if (!existing) {
-                ecs_set_symbol(world, e, name);
+    ecs_entity_t result = 0;
+
+    ecs_vector_t *child_tables = ecs_map_get_ptr(
+        world->child_tables, ecs_vector_t*, parent);
+    
+    if (child_tables) {
+        ecs_vector_each(child_tables, ecs_table_t*, table_ptr, {
+            ecs_table_t *table = *table_ptr;
+            result = find_child_in_table(table, name);
+            if (result) {
+                return result;
             }
-        }
+        });
     }
-    
-    ecs_entity_t result = e;
-    if (!result) {
-        if (!name) {
-            /* If neither an id nor name is specified, return 0 */
-            return 0;
-        }
 
-        result = ecs_lookup(world, name);
+    if (parent) {
+        result = find_child_in_index(world, parent, name);
     }
-    
-    return result;
-}
-
-/* -- Public functions -- */
 
-ecs_type_t ecs_type_from_str(
-    ecs_world_t *world,
-    const char *expr)
-{
-    EcsType type = type_from_expr(world, NULL, expr);
-    return type.normalized;
+    return result;
 }
 
-ecs_table_t* ecs_table_from_str(
+ecs_entity_t ecs_lookup(
     ecs_world_t *world,
-    const char *expr)
-{
-    if (expr) {
-        ecs_vector_t *vec = ecs_vector_new(ecs_entity_t, 1);
-        ecs_parse_expr(world, NULL, expr, parse_type_action, &vec);
-        ecs_table_t *result = table_from_vec(world, vec);
-        ecs_vector_free(vec);
-        return result;
-    } else {
-        return NULL;
+    const char *name)
+{   
+    if (!name) {
+        return 0;
     }
-}
 
-ecs_entity_t ecs_new_entity(
-    ecs_world_t *world,
-    ecs_entity_t e,
-    const char *name,
-    const char *expr)
-{
-    ecs_entity_t result = ecs_lookup_w_id(world, e, name);
-    if (!result) {
-        result = ecs_new(world, 0);
-        ecs_set_symbol(world, result, name);
+    if (is_number(name)) {
+        return name_to_id(name);
     }
-    
-    EcsType type = type_from_expr(world, name, expr);
-    ecs_add_type(world, result, type.normalized);
 
-    return result;
+    ecs_entity_t e = find_as_alias(world, name);
+    if (e) {
+        return e;
+    }    
+    
+    return ecs_lookup_child(world, 0, name);
 }
 
-ecs_entity_t ecs_new_prefab(
+ecs_entity_t ecs_lookup_symbol(
     ecs_world_t *world,
-    ecs_entity_t e,
-    const char *name,
-    const char *expr)
-{
-    ecs_entity_t result = ecs_lookup_w_id(world, e, name);
-    if (!result) {
-        result = ecs_new(world, 0);
-        ecs_set_symbol(world, result, name);
+    const char *name)
+{   
+    if (!name) {
+        return 0;
     }
 
-    ecs_add_entity(world, result, EcsPrefab);
-
-    EcsType type = type_from_expr(world, name, expr);
-    ecs_add_type(world, result, type.normalized);
-
-    return result;
+    if (is_number(name)) {
+        return name_to_id(name);
+    }   
+    
+    return find_child(world, 0, name);
 }
 
-ecs_entity_t ecs_new_component(
-    ecs_world_t *world,
-    ecs_entity_t e,
-    const char *name,
-    size_t size,
-    size_t alignment)
+static
+bool is_sep(
+    const char **ptr,
+    const char *sep)
 {
-    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
-    assert(world->magic == ECS_WORLD_MAGIC);
-    bool in_progress = world->in_progress;
-
-    /* If world is in progress component may be registered, but only when not
-     * in multithreading mode. */
-    if (in_progress) {
-        ecs_assert(ecs_vector_count(world->workers) < 1, 
-            ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_size_t len = ecs_os_strlen(sep);
 
-        /* Component creation should not be deferred */
-        ecs_defer_end(world);
-        world->in_progress = false;
+    if (!ecs_os_strncmp(*ptr, sep, len)) {
+        *ptr += len - 1;
+        return true;
+    } else {
+        return false;
     }
+}
 
-    ecs_entity_t result = ecs_lookup_w_id(world, e, name);
-    if (!result) {
-        result = ecs_new_component_id(world);
-        ecs_set_symbol(world, result, name);
-    }
+static
+const char *path_elem(
+    const char *path,
+    char *buff,
+    const char *sep)
+{
+    const char *ptr;
+    char *bptr, ch;
 
-    /* ecs_new_component_id does not add the scope, so add it explicitly */
-    ecs_entity_t scope = world->stage.scope;
-    if (scope) {
-        ecs_add_entity(world, result, ECS_CHILDOF | scope);
+    for (bptr = buff, ptr = path; (ch = *ptr); ptr ++) {
+        ecs_assert(bptr - buff < ECS_MAX_NAME_LENGTH, ECS_INVALID_PARAMETER, 
+            NULL);
+            
+        if (is_sep(&ptr, sep)) {
+            *bptr = '\0';
+            return ptr + 1;
+        } else {
+            *bptr = ch;
+            bptr ++;
+        }
     }
 
-    bool added = false;
-    EcsComponent *ptr = ecs_get_mut(world, result, EcsComponent, &added);
-
-    if (added) {
-        ptr->size = ecs_from_size_t(size);
-        ptr->alignment = ecs_from_size_t(alignment);
+    if (bptr != buff) {
+        *bptr = '\0';
+        return ptr;
     } else {
-        if (ptr->size != ecs_from_size_t(size)) {
-            ecs_abort(ECS_INVALID_COMPONENT_SIZE, name);
-        }
-        if (ptr->alignment != ecs_from_size_t(alignment)) {
-            ecs_abort(ECS_INVALID_COMPONENT_SIZE, name);
-        }
+        return NULL;
     }
+}
 
-    ecs_modified(world, result, EcsComponent);
+static
+ecs_entity_t get_parent_from_path(
+    ecs_world_t *world,
+    ecs_entity_t parent,
+    const char **path_ptr,
+    const char *prefix)
+{
+    bool start_from_root = false;
+    const char *path = *path_ptr;
 
-    if (e > world->stats.last_component_id && e < ECS_HI_COMPONENT_ID) {
-        world->stats.last_component_id = e + 1;
+    if (prefix) {
+        ecs_size_t len = ecs_os_strlen(prefix);
+        if (!ecs_os_strncmp(path, prefix, len)) {
+            path += len;
+            parent = 0;
+            start_from_root = true;
+        }
     }
 
-    if (in_progress) {
-        world->in_progress = true;
-        ecs_defer_begin(world);
+    if (!start_from_root && !parent) {
+        ecs_stage_t *stage = ecs_get_stage(&world);
+        parent = stage->scope;
     }
 
-    return result;
+    *path_ptr = path;
+
+    return parent;
 }
 
-ecs_entity_t ecs_new_type(
+ecs_entity_t ecs_lookup_path_w_sep(
     ecs_world_t *world,
-    ecs_entity_t e,
-    const char *name,
-    const char *expr)
+    ecs_entity_t parent,
+    const char *path,
+    const char *sep,
+    const char *prefix)
 {
-    assert(world->magic == ECS_WORLD_MAGIC);
-
-    ecs_entity_t result = ecs_lookup_w_id(world, e, name);
-    if (!result) {
-        result = ecs_new_entity(world, 0, name, NULL);
+    if (!path) {
+        return 0;
     }
+
+    ecs_entity_t e = find_as_alias(world, path);
+    if (e) {
+        return e;
+    }      
     
-    EcsType type_parsed = type_from_expr(world, name, expr);
+    char buff[ECS_MAX_NAME_LENGTH];
+    const char *ptr;
+    ecs_entity_t cur;
+    bool core_searched = false;
 
-    bool added = false;
-    EcsType *type = ecs_get_mut(world, result, EcsType, &added);
-    if (added) {
-        type->type = type_parsed.type;
-        type->normalized = type_parsed.normalized;
-    } else {
-        if (type->type != type_parsed.type) {
-            ecs_abort(ECS_ALREADY_DEFINED, name);
-        }
+    if (!sep) {
+        sep = ".";
+    }
+
+    parent = get_parent_from_path(world, parent, &path, prefix);
+
+retry:
+    cur = parent;
+    ptr = path;
 
-        if (type->normalized != type_parsed.normalized) {
-            ecs_abort(ECS_ALREADY_DEFINED, name);
+    while ((ptr = path_elem(ptr, buff, sep))) {
+        cur = ecs_lookup_child(world, cur, buff);
+        if (!cur) {
+            goto tail;
         }
-    }     
+    }
 
-    /* This will allow the type to show up in debug tools */
-    ecs_map_set(world->type_handles, (uintptr_t)type_parsed.type, &result);
+tail:
+    if (!cur) {
+        if (!core_searched) {
+            if (parent) {
+                parent = ecs_get_parent_w_entity(world, parent, 0);
+            } else {
+                parent = EcsFlecsCore;
+                core_searched = true;
+            }
+            goto retry;
+        }
+    }
 
-    return result;
+    return cur;
 }
 
-/* Global type variables */
-ecs_type_t ecs_type(EcsComponent);
-ecs_type_t ecs_type(EcsType);
-ecs_type_t ecs_type(EcsName);
-ecs_type_t ecs_type(EcsPrefab);
+ecs_entity_t ecs_set_scope(
+    ecs_world_t *world,
+    ecs_entity_t scope)
+{
+    ecs_stage_t *stage = ecs_get_stage(&world);
 
-/* Component lifecycle actions for EcsName */
-ECS_CTOR(EcsName, ptr, {
-    ptr->value = NULL;
-    ptr->alloc_value = NULL;
-    ptr->symbol = NULL;
-})
+    ecs_entity_t e = ECS_CHILDOF | scope;
+    ecs_entities_t to_add = {
+        .array = &e,
+        .count = 1
+    };
 
-ECS_DTOR(EcsName, ptr, {
-    ecs_os_free(ptr->alloc_value);
-    ptr->value = NULL;
-    ptr->alloc_value = NULL;
-    ptr->symbol = NULL;
-})
+    ecs_entity_t cur = stage->scope;
+    stage->scope = scope;
 
-ECS_COPY(EcsName, dst, src, {
-    if (dst->alloc_value) {
-        ecs_os_free(dst->alloc_value);
-        dst->alloc_value = NULL;
-    }
-    
-    if (src->alloc_value) {
-        dst->alloc_value = ecs_os_strdup(src->alloc_value);
-        dst->value = dst->alloc_value;
+    if (scope) {
+        stage->scope_table = ecs_table_traverse_add(
+            world, &world->store.root, &to_add, NULL);
     } else {
-        dst->alloc_value = NULL;
-        dst->value = src->value;
+        stage->scope_table = &world->store.root;
     }
-    dst->symbol = src->symbol;
-})
-
-ECS_MOVE(EcsName, dst, src, {
-    dst->value = src->value;
-    dst->alloc_value = src->alloc_value;
-    dst->symbol = src->symbol;
-
-    src->value = NULL;
-    src->alloc_value = NULL;
-    src->symbol = NULL;
-})
-
 
-/* -- Bootstrapping -- */
+    return cur;
+}
 
-#define bootstrap_component(world, table, name)\
-    _bootstrap_component(world, table, ecs_typeid(name), #name, sizeof(name),\
-        ECS_ALIGNOF(name))
+ecs_entity_t ecs_get_scope(
+    ecs_world_t *world)
+{
+    ecs_stage_t *stage = ecs_get_stage(&world);
+    return stage->scope;
+}
 
-void _bootstrap_component(
+void ecs_set_parent(
     ecs_world_t *world,
-    ecs_table_t *table,
     ecs_entity_t entity,
-    const char *id,
-    ecs_size_t size,
-    ecs_size_t alignment)
+    ecs_entity_t parent)
 {
-    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != parent, ECS_INVALID_PARAMETER, NULL);
 
-    ecs_data_t *data = ecs_table_get_or_create_data(table);
-    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+    if (parent) {
+        ecs_set(world, entity, EcsChildOf, { parent });
+    } else {
+        ecs_remove(world, entity, EcsChildOf);
+    }
+}
 
-    ecs_column_t *columns = data->columns;
-    ecs_assert(columns != NULL, ECS_INTERNAL_ERROR, NULL);
+int32_t ecs_get_child_count(
+    ecs_world_t *world,
+    ecs_entity_t entity)
+{
+    int32_t count = 0;
 
-    /* Create record in entity index */
-    ecs_record_t *record = ecs_eis_get_or_create(world, entity);
-    record->table = table;
+    ecs_vector_t *tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, entity);
+    if (tables) {
+        ecs_vector_each(tables, ecs_table_t*, table_ptr, {
+            ecs_table_t *table = *table_ptr;
+            count += ecs_table_count(table);
+        });
+    }
 
-    /* Insert row into table to store EcsComponent itself */
-    int32_t index = ecs_table_append(world, table, data, entity, record, false);
-    record->row = index + 1;
+    if (entity) {
+        count += count_children_in_index(world, entity);
+    }
 
-    /* Set size and id */
-    EcsComponent *c_info = ecs_vector_first(columns[0].data, EcsComponent);
-    EcsName *id_data = ecs_vector_first(columns[1].data, EcsName);
-    
-    c_info[index].size = size;
-    c_info[index].alignment = alignment;
-    id_data[index].value = &id[ecs_os_strlen("Ecs")]; /* Skip prefix */
-    id_data[index].symbol = id;
-    id_data[index].alloc_value = NULL;
+    return count;
 }
 
-/** Create type for component */
-ecs_type_t ecs_bootstrap_type(
+ecs_iter_t ecs_scope_iter(
     ecs_world_t *world,
-    ecs_entity_t entity)
+    ecs_entity_t parent)
 {
-    ecs_table_t *table = ecs_table_find_or_create(world, &(ecs_entities_t){
-        .array = (ecs_entity_t[]){entity},
-        .count = 1
-    });
-
-    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(table->type != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_scope_iter_t iter = {
+        .tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, parent),
+        .index = 0,
+        .parent = parent,
+        .children = childof_iter(world, parent)
+    };
 
-    return table->type;
+    return (ecs_iter_t) {
+        .world = world,
+        .iter.parent = iter
+    };
 }
 
-/** Bootstrap types for builtin components and tags */
-static
-void bootstrap_types(
-    ecs_world_t *world)
+ecs_iter_t ecs_scope_iter_w_filter(
+    ecs_world_t *world,
+    ecs_entity_t parent,
+    ecs_filter_t *filter)
 {
-    ecs_type(EcsComponent) = ecs_bootstrap_type(world, ecs_typeid(EcsComponent));
-    ecs_type(EcsType) = ecs_bootstrap_type(world, ecs_typeid(EcsType));
-    ecs_type(EcsName) = ecs_bootstrap_type(world, ecs_typeid(EcsName));
+    ecs_scope_iter_t iter = {
+        .filter = *filter,
+        .tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, parent),
+        .index = 0,
+        .parent = parent,
+        .children = childof_iter(world, parent)
+    };
+
+    return (ecs_iter_t) {
+        .world = world,
+        .iter.parent = iter,
+        .table_count = ecs_vector_count(iter.tables)
+    };
 }
 
-/** Initialize component table. This table is manually constructed to bootstrap
- * flecs. After this function has been called, the builtin components can be
- * created. 
- * The reason this table is constructed manually is because it requires the size
- * and alignment of the EcsComponent and EcsName components, which haven't been 
- * created yet */
-static
-ecs_table_t* bootstrap_component_table(
-    ecs_world_t *world)
+bool ecs_scope_next(
+    ecs_iter_t *it)
 {
-    ecs_entity_t entities[] = {ecs_typeid(EcsComponent), ecs_typeid(EcsName), ECS_CHILDOF | EcsFlecsCore};
-    ecs_entities_t array = {
-        .array = entities,
-        .count = 3
-    };
+    ecs_scope_iter_t *iter = &it->iter.parent;
+    ecs_vector_t *tables = iter->tables;
+    ecs_filter_t filter = iter->filter;
 
-    ecs_table_t *result = ecs_table_find_or_create(world, &array);
-    ecs_data_t *data = ecs_table_get_or_create_data(result);
+    int32_t count = ecs_vector_count(tables);
+    int32_t i;
 
-    /* Preallocate enough memory for initial components */
-    data->entities = ecs_vector_new(ecs_entity_t, EcsFirstUserComponentId);
-    data->record_ptrs = ecs_vector_new(ecs_record_t*, EcsFirstUserComponentId);
+    for (i = iter->index; i < count; i ++) {
+        ecs_table_t *table = *ecs_vector_get(tables, ecs_table_t*, i);
+        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+        ecs_assert(table->id != 0, ECS_INTERNAL_ERROR, NULL);
+
+        ecs_data_t *data = ecs_table_get_data(table);
+        if (!data) {
+            continue;
+        }
+
+        it->count = ecs_table_count(table);
+        if (!it->count) {
+            continue;
+        }
+
+        if (filter.include || filter.exclude) {
+            if (!ecs_table_match_filter(it->world, table, &filter)) {
+                continue;
+            }
+        }
+
+        iter->table.table = table;
+        it->table = &iter->table;
+        it->table_columns = data->columns;
+        it->count = ecs_table_count(table);
+        it->offset = 0;
+        it->entities = ecs_vector_first(data->entities, ecs_entity_t);
+        iter->index = i + 1;
+
+        return true;
+    }
+
+    iter->index = count;
+
+    /* Return children that store their parent in EcsChildOf one by one, as 
+     * they can be stored in any row of a table shared with other parents */
+    ecs_entity_t *child_ptr;
+    while (iter->children.map && 
+        (child_ptr = ecs_map_next(&iter->children, ecs_entity_t, NULL))) 
+    {
+        ecs_entity_t child = *child_ptr;
+        if (!is_childof(it->world, child, iter->parent)) {
+            continue;
+        }
+
+        ecs_record_t *r = ecs_eis_get(it->world, child);
+        ecs_assert(r != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        ecs_table_t *table = r->table;
+        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        if (filter.include || filter.exclude) {
+            if (!ecs_table_match_filter(it->world, table, &filter)) {
+                continue;
+            }
+        }
+
+        ecs_data_t *data = ecs_table_get_data(table);
+        ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        bool is_watched;
+        int32_t row = ecs_record_to_row(r->row, &is_watched);
 
-    data->columns = ecs_os_malloc(sizeof(ecs_column_t) * 2);
-    ecs_assert(data->columns != NULL, ECS_OUT_OF_MEMORY, NULL);
+        iter->table.table = table;
+        it->table = &iter->table;
+        it->table_columns = data->columns;
+        it->count = 1;
+        it->offset = row;
+        it->entities = ecs_vector_get(data->entities, ecs_entity_t, row);
 
-    data->columns[0].data = ecs_vector_new(EcsComponent, EcsFirstUserComponentId);
-    data->columns[0].size = sizeof(EcsComponent);
-    data->columns[0].alignment = ECS_ALIGNOF(EcsComponent);
-    data->columns[1].data = ecs_vector_new(EcsName, EcsFirstUserComponentId);
-    data->columns[1].size = sizeof(EcsName);
-    data->columns[1].alignment = ECS_ALIGNOF(EcsName);
+        return true;
+    }
 
-    result->column_count = 2;
-    
-    return result;
+    return false;    
 }
 
-void ecs_bootstrap(
-    ecs_world_t *world)
+const char* ecs_set_name_prefix(
+    ecs_world_t *world,
+    const char *prefix)
 {
-    ecs_type(EcsComponent) = NULL;
+    const char *old_prefix = world->name_prefix;
+    world->name_prefix = prefix;
+    return old_prefix;
+}
 
-    ecs_trace_1("bootstrap core components");
-    ecs_log_push();
+ecs_entity_t ecs_add_path_w_sep(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t parent,
+    const char *path,
+    const char *sep,
+    const char *prefix)
+{
+    if (!path) {
+        if (!entity) {
+            entity = ecs_new_id(world);
+        }
 
-    /* Create table that will hold components (EcsComponent, EcsName) */
-    ecs_table_t *table = bootstrap_component_table(world);
-    assert(table != NULL);
+        if (parent) {
+            ecs_add_entity(world, entity, ECS_CHILDOF | entity);
+        }
 
-    bootstrap_component(world, table, EcsComponent);
-    bootstrap_component(world, table, EcsType);
-    bootstrap_component(world, table, EcsName);
+        return entity;
+    }
 
-    world->stats.last_component_id = EcsFirstUserComponentId;
-    world->stats.last_id = EcsFirstUserEntityId;
-    world->stats.min_id = 0;
-    world->stats.max_id = 0;
+    char buff[ECS_MAX_NAME_LENGTH];
+    const char *ptr = path;
 
-    bootstrap_types(world);
+    parent = get_parent_from_path(world, parent, &path, prefix);
 
-    ecs_set_scope(world, EcsFlecsCore);
+    ecs_entity_t cur = parent;
 
-    ecs_bootstrap_tag(world, EcsModule);
-    ecs_bootstrap_tag(world, EcsPrefab);
-    ecs_bootstrap_tag(world, EcsHidden);
-    ecs_bootstrap_tag(world, EcsDisabled);
+    while ((ptr = path_elem(ptr, buff, sep))) {
+        ecs_entity_t e = ecs_lookup_child(world, cur, buff);
+        if (!e) {
+            char *name = ecs_os_strdup(buff);
 
-    ecs_set_component_actions(world, EcsName, {
-        .ctor = ecs_ctor(EcsName),
-        .dtor = ecs_dtor(EcsName),
-        .copy = ecs_copy(EcsName),
-        .move = ecs_move(EcsName)
-    });
+            /* If this is the last entity in the path, use the provided id */
+            if (entity && !path_elem(ptr, buff, sep)) {
+                e = entity;
+            }
+            
+            e = ecs_set(world, e, EcsName, {
+                .value = name,
+                .alloc_value = name
+            });
 
-    /* Initialize scopes */
-    ecs_set(world, EcsFlecs, EcsName, {.value = "flecs"});
-    ecs_add_entity(world, EcsFlecs, EcsModule);
-    ecs_set(world, EcsFlecsCore, EcsName, {.value = "core"});
-    ecs_add_entity(world, EcsFlecsCore, EcsModule);
-    ecs_add_entity(world, EcsFlecsCore, ECS_CHILDOF | EcsFlecs);
+            ecs_os_free(name);
 
-    /* Initialize EcsWorld */
-    ecs_set(world, EcsWorld, EcsName, {.value = "World"});
-    ecs_assert(ecs_get_name(world, EcsWorld) != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(ecs_lookup(world, "World") == EcsWorld, ECS_INTERNAL_ERROR, NULL);
-    ecs_add_entity(world, EcsWorld, ECS_CHILDOF | EcsFlecsCore);
+            if (cur) {
+                ecs_add_entity(world, e, ECS_CHILDOF | cur);
+            }
+        }
 
-    /* Initialize EcsSingleton */
-    ecs_set(world, EcsSingleton, EcsName, {.value = "$"});
-    ecs_assert(ecs_get_name(world, EcsSingleton) != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(ecs_lookup(world, "$") == EcsSingleton, ECS_INTERNAL_ERROR, NULL);
-    ecs_add_entity(world, EcsSingleton, ECS_CHILDOF | EcsFlecsCore);
+        cur = e;
+    }
 
-    /* Initialize EcsWildcard */
-    ecs_set(world, EcsWildcard, EcsName, {.value = "*"});
-    ecs_assert(ecs_get_name(world, EcsWildcard) != NULL, ECS_INTERNAL_ERROR, NULL);
-    ecs_assert(ecs_lookup(world, "*") == EcsWildcard, ECS_INTERNAL_ERROR, NULL);
-    ecs_add_entity(world, EcsWildcard, ECS_CHILDOF | EcsFlecsCore);    
+    return cur;
+}
 
-    ecs_set_scope(world, 0);
+ecs_entity_t ecs_new_from_path_w_sep(
+    ecs_world_t *world,
+    ecs_entity_t parent,
+    const char *path,
+    const char *sep,
+    const char *prefix)
+{
+    return ecs_add_path_w_sep(world, 0, parent, path, sep, prefix);
+}
 
-    ecs_log_pop();
+void ecs_use(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    const char *name)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(name != NULL, ECS_INVALID_PARAMETER, NULL);
+    
+    ecs_stage_t *stage = ecs_get_stage(&world);
+    ecs_assert(stage->scope == 0 , ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(find_as_alias(world, name) == 0, ECS_ALREADY_DEFINED, NULL);
+    (void)stage;
+    
+    ecs_alias_t *al = ecs_vector_add(&world->aliases, ecs_alias_t);
+    al->name = ecs_os_strdup(name);
+    al->entity = entity;
 }
 
+#ifdef FLECS_TEMPLATE
+
+
+#ifdef FLECS_SYSTEM
+#endif
+
+/* State for creating a world from a template. Entities with ids up to the last
+ * ids created by ecs_init exist in both worlds, and are not copied. */
+typedef struct ecs_template_t {
+    ecs_world_t *world;              /* Template */
+    ecs_world_t *dst;                /* New world */
+    ecs_entity_t last_component_id;  /* Last component id created by ecs_init */
+    ecs_entity_t last_id;            /* Last entity id created by ecs_init */
+    ecs_vector_t *ranges;            /* Rows that were copied in bulk */
+} ecs_template_t;
+
+/* Rows that were appended to a table of the new world */
+typedef struct ecs_template_range_t {
+    ecs_table_t *table;
+    int32_t row;
+    int32_t count;
+} ecs_template_range_t;
 
 static
-bool path_append(
-    ecs_world_t *world, 
-    ecs_entity_t parent, 
-    ecs_entity_t child, 
-    ecs_entity_t component,
-    const char *sep,
-    const char *prefix,
-    ecs_strbuf_t *buf)
+bool template_is_bootstrap(
+    ecs_template_t *t,
+    ecs_entity_t e)
 {
-    ecs_type_t type = ecs_get_type(world, child);
-    ecs_entity_t cur = ecs_find_in_type(world, type, component, ECS_CHILDOF);
-    
-    if (cur) {
-        if (cur != parent && cur != EcsFlecsCore) {
-            path_append(world, parent, cur, component, sep, prefix, buf);
-            ecs_strbuf_appendstr(buf, sep);
-        }
-    } else if (prefix) {
-        ecs_strbuf_appendstr(buf, prefix);
+    ecs_entity_t id = ecs_entity_t_lo(e);
+    return id < t->last_component_id ||
+        (id > ECS_HI_COMPONENT_ID && id <= t->last_id);
+}
+
+/* Components that are added by systems when their owner is created */
+static
+bool template_is_derived(
+    ecs_entity_t component)
+{
+    if (component == EcsDisabledIntern || component == EcsInactive) {
+        return true;
     }
 
-    char buff[22];
-    const char *name = ecs_get_name(world, child);
-    if (!name) {
-        ecs_os_sprintf(buff, "%u", (uint32_t)child);
-        name = buff;
+#ifdef FLECS_SYSTEM
+    if (component == ecs_typeid(EcsSystem) ||
+        component == ecs_typeid(EcsSignature) ||
+        component == ecs_typeid(EcsQuery))
+    {
+        return true;
     }
+#endif
 
-    ecs_strbuf_appendstr(buf, name);
+#ifdef FLECS_PIPELINE
+    if (component == ecs_typeid(EcsPipelineQuery)) {
+        return true;
+    }
+#endif
 
-    return cur != 0;
+    return false;
 }
 
+/* Components that can only be added after the values of the entity are set,
+ * like tags that are processed when a system or pipeline is created */
 static
-ecs_entity_t find_as_alias(
-    ecs_world_t *world,
-    const char *name)
+bool template_is_late(
+    ecs_entity_t component)
 {
-    int32_t i, count = ecs_vector_count(world->aliases);
-    ecs_alias_t *aliases = ecs_vector_first(world->aliases, ecs_alias_t);
-    for (i = 0; i < count; i ++) {
-        if (!strcmp(aliases[i].name, name)) {
-            return aliases[i].entity;
-        }
-    }
-
-    return 0;
+    return component == EcsDisabled || component == EcsPipeline ||
+        ECS_HAS_ROLE(component, DISABLED);
 }
 
-char* ecs_get_path_w_sep(
-    ecs_world_t *world,
-    ecs_entity_t parent,
-    ecs_entity_t child,
-    ecs_entity_t component,
-    const char *sep,
-    const char *prefix)
+/* Entities that are owned by systems, triggers or pipelines, and that should
+ * be created after all other entities */
+static
+bool template_is_reactive(
+    ecs_table_t *table)
 {
-    ecs_strbuf_t buf = ECS_STRBUF_INIT;
+    ecs_type_t type = table->type;
 
-    if (parent != child) {
-        path_append(world, parent, child, component, sep, prefix, &buf);
-    } else {
-        ecs_strbuf_appendstr(&buf, "");
+#ifdef FLECS_SYSTEM
+    if (ecs_type_index_of(type, ecs_typeid(EcsSystem)) != -1 ||
+        ecs_type_index_of(type, ecs_typeid(EcsTrigger)) != -1)
+    {
+        return true;
     }
+#endif
 
-    return ecs_strbuf_get(&buf);
+    return ecs_type_index_of(type, EcsPipeline) != -1;
 }
 
+/* Does the column store a value for the component. Columns of ids with a role
+ * can have a size, but do not store a value for the entity. */
 static
-bool is_number(
-    const char *name)
+bool template_has_value(
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t column)
 {
-    if (!isdigit(name[0])) {
+    if (column >= table->column_count || !data->columns[column].size) {
         return false;
     }
 
-    ecs_size_t i, s = ecs_os_strlen(name);
-    for (i = 0; i < s; i ++) {
-        if (!isdigit(name[i])) {
-            break;
-        }
-    }
-
-    return i == s;
+    ecs_entity_t c = ecs_vector_first(table->type, ecs_entity_t)[column];
+    return !(c & ECS_ROLE_MASK) || ECS_HAS_ROLE(c, TRAIT);
 }
 
-static 
-ecs_entity_t name_to_id(
-    const char *name)
+static
+int template_compare_ids(
+    const void *ptr1,
+    const void *ptr2)
 {
-    long int result = atol(name);
-    ecs_assert(result >= 0, ECS_INTERNAL_ERROR, NULL);
-    return (ecs_entity_t)result;
+    uint32_t e1 = ecs_entity_t_lo(*(ecs_entity_t*)ptr1);
+    uint32_t e2 = ecs_entity_t_lo(*(ecs_entity_t*)ptr2);
+    return (e1 > e2) - (e1 < e2);
 }
 
+/* Copy storage settings and lifecycle actions of a component */
 static
-ecs_entity_t find_child_in_table(
-    ecs_table_t *table,
-    const char *name)
-{
-    /* If table doesn't have EcsName, then don't bother */
-    int32_t name_index = ecs_type_index_of(table->type, ecs_typeid(EcsName));
-    if (name_index == -1) {
-        return 0;
+void template_copy_c_info(
+    ecs_template_t *t,
+    ecs_entity_t component)
+{
+    ecs_c_info_t *c_info = ecs_get_c_info(t->world, component);
+    if (!c_info) {
+        return;
     }
 
-    ecs_data_t *data = ecs_table_get_data(table);
-    if (!data || !data->columns) {
-        return 0;
+    if (c_info->fields) {
+        ecs_set_component_fields_w_entity(t->dst, component,
+            ecs_vector_first(c_info->fields, ecs_field_t),
+            ecs_vector_count(c_info->fields));
     }
 
-    int32_t i, count = ecs_vector_count(data->entities);
-    if (!count) {
-        return 0;
+    if (c_info->double_buffered) {
+        ecs_set_component_double_buffered_w_entity(t->dst, component);
     }
 
-    if (is_number(name)) {
-        return name_to_id(name);
+    if (c_info->sparse) {
+        ecs_set_component_sparse_w_entity(t->dst, component);
     }
 
-    ecs_column_t *column = &data->columns[name_index];
-    EcsName *names = ecs_vector_first(column->data, EcsName);
-
-    for (i = 0; i < count; i ++) {
-        const char *cur_name = names[i].value;
-        const char *cur_sym = names[i].symbol;
-        if ((cur_name && !strcmp(cur_name, name)) || (cur_sym && !strcmp(cur_sym, name))) {
-            return *ecs_vector_get(data->entities, ecs_entity_t, i);
-        }
+    /* If actions were set with the EcsComponentLifecycle component, they are
+     * registered when the component is copied */
+    if (c_info->lifecycle_set && !ecs_has_entity(t->world, component,
+        ecs_typeid(EcsComponentLifecycle)))
+    {
+        ecs_set_component_actions_w_entity(
+            t->dst, component, &c_info->lifecycle);
     }
-
-    return 0;
 }
 
+#ifdef FLECS_SYSTEM
 static
-ecs_entity_t find_child(
+void template_free_string(
     ecs_world_t *world,
-    ecs_entity_t parent,
-    const char *name)
+    void *ctx)
 {
-    (void)parent;
-    
-    ecs_sparse_each(world->store.tables, ecs_table_t, table, {
-        ecs_entity_t result = find_child_in_table(table, name);
-        if (result) {
-            return result;
-        }
-    });    
-
-    return 0;
+    (void)world;
+    ecs_os_free(ctx);
 }
 
-ecs_entity_t ecs_lookup_child(
-    ecs_world_t *world,
-    ecs_entity_t parent,
-    const char *name)
+/* Signature expressions are not owned by the template, and may be freed
+ * together with the template, as is the case for the spatial index. The new
+ * world owns a copy that is freed when it is deleted. */
+static
+const char* template_copy_string(
+    ecs_template_t *t,
+    const char *str)
 {
-    ecs_entity_t result = 0;
-
-    ecs_vector_t *child_tables = ecs_map_get_ptr(
-        world->child_tables, ecs_vector_t*, parent);
-    
-    if (child_tables) {
-        ecs_vector_each(child_tables, ecs_table_t*, table_ptr, {
-            ecs_table_t *table = *table_ptr;
-            result = find_child_in_table(table, name);
-            if (result) {
-                return result;
-            }
-        });
+    if (!str) {
+        return NULL;
     }
 
+    char *result = ecs_os_strdup(str);
+    ecs_atfini(t->dst, template_free_string, result);
     return result;
 }
+#endif
 
-ecs_entity_t ecs_lookup(
-    ecs_world_t *world,
-    const char *name)
-{   
-    if (!name) {
-        return 0;
-    }
-
-    if (is_number(name)) {
-        return name_to_id(name);
-    }
-
-    ecs_entity_t e = find_as_alias(world, name);
-    if (e) {
-        return e;
-    }    
-    
-    return ecs_lookup_child(world, 0, name);
-}
-
-ecs_entity_t ecs_lookup_symbol(
-    ecs_world_t *world,
-    const char *name)
-{   
-    if (!name) {
-        return 0;
+static
+ecs_type_t template_copy_type(
+    ecs_template_t *t,
+    ecs_type_t type)
+{
+    if (!type) {
+        return NULL;
     }
 
-    if (is_number(name)) {
-        return name_to_id(name);
-    }   
-    
-    return find_child(world, 0, name);
+    return ecs_table_from_type(t->dst, type)->type;
 }
 
 static
-bool is_sep(
-    const char **ptr,
-    const char *sep)
+void template_copy_value(
+    ecs_template_t *t,
+    ecs_entity_t e,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t row,
+    int32_t column_index)
 {
-    ecs_size_t len = ecs_os_strlen(sep);
+    ecs_entity_t component = ecs_vector_first(
+        table->type, ecs_entity_t)[column_index];
+    ecs_column_t *column = &data->columns[column_index];
+    void *ptr = ecs_vector_get_t(
+        column->data, column->size, column->alignment, row);
+
+    if (component == ecs_typeid(EcsType)) {
+        /* Types are stored by the tables of the world that created them */
+        EcsType *src = ptr;
+        EcsType dst = {
+            .type = template_copy_type(t, src->type),
+            .normalized = template_copy_type(t, src->normalized)
+        };
 
-    if (!ecs_os_strncmp(*ptr, sep, len)) {
-        *ptr += len - 1;
-        return true;
+        ecs_set_ptr(t->dst, e, EcsType, &dst);
+
+        if (ecs_map_get(t->world->type_handles, ecs_entity_t,
+            (uintptr_t)src->type))
+        {
+            ecs_map_set(t->dst->type_handles, (uintptr_t)dst.type, &e);
+        }
+#ifdef FLECS_SYSTEM
+    } else if (component == ecs_typeid(EcsSignatureExpr)) {
+        EcsSignatureExpr *src = ptr;
+        ecs_set(t->dst, e, EcsSignatureExpr, {
+            .expr = template_copy_string(t, src->expr)
+        });
+#endif
     } else {
-        return false;
+        ecs_set_ptr_w_entity(t->dst, e, component,
+            ecs_to_size_t(column->size), ptr);
+    }
+
+    if (component == ecs_typeid(EcsComponent)) {
+        template_copy_c_info(t, e);
     }
 }
 
+/* Values that reference data owned by the template are replaced with values
+ * owned by the new world after the columns of a table are copied */
 static
-const char *path_elem(
-    const char *path,
-    char *buff,
-    const char *sep)
+void template_remap_values(
+    ecs_template_t *t,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t row,
+    int32_t count)
 {
-    const char *ptr;
-    char *bptr, ch;
+    ecs_entity_t *entities = ecs_vector_get(data->entities, ecs_entity_t, row);
+    int32_t i, column;
 
-    for (bptr = buff, ptr = path; (ch = *ptr); ptr ++) {
-        ecs_assert(bptr - buff < ECS_MAX_NAME_LENGTH, ECS_INVALID_PARAMETER, 
-            NULL);
-            
-        if (is_sep(&ptr, sep)) {
-            *bptr = '\0';
-            return ptr + 1;
-        } else {
-            *bptr = ch;
-            bptr ++;
+    column = ecs_type_index_of(table->type, ecs_typeid(EcsType));
+    if (column != -1 && column < table->column_count) {
+        EcsType *types = ecs_vector_get(
+            data->columns[column].data, EcsType, row);
+        for (i = 0; i < count; i ++) {
+            ecs_type_t src_type = types[i].type;
+            types[i].type = template_copy_type(t, src_type);
+            types[i].normalized = template_copy_type(t, types[i].normalized);
+
+            if (ecs_map_get(t->world->type_handles, ecs_entity_t,
+                (uintptr_t)src_type))
+            {
+                ecs_map_set(t->dst->type_handles,
+                    (uintptr_t)types[i].type, &entities[i]);
+            }
         }
     }
 
-    if (bptr != buff) {
-        *bptr = '\0';
-        return ptr;
-    } else {
-        return NULL;
+#ifdef FLECS_SYSTEM
+    column = ecs_type_index_of(table->type, ecs_typeid(EcsSignatureExpr));
+    if (column != -1 && column < table->column_count) {
+        EcsSignatureExpr *exprs = ecs_vector_get(
+            data->columns[column].data, EcsSignatureExpr, row);
+        for (i = 0; i < count; i ++) {
+            exprs[i].expr = template_copy_string(t, exprs[i].expr);
+        }
     }
+#else
+    (void)entities;
+#endif
 }
 
+/* Recreate an entity in the new world by adding its components one by one, so
+ * that systems, triggers and component actions are registered in the same way
+ * as they were for the template. */
 static
-ecs_entity_t get_parent_from_path(
-    ecs_world_t *world,
-    ecs_entity_t parent,
-    const char **path_ptr,
-    const char *prefix)
+void template_copy_entity(
+    ecs_template_t *t,
+    ecs_entity_t e)
 {
-    bool start_from_root = false;
-    const char *path = *path_ptr;
+    ecs_record_t *r = ecs_eis_get(t->world, e);
+    if (!r || !r->table) {
+        return;
+    }
 
-    if (prefix) {
-        ecs_size_t len = ecs_os_strlen(prefix);
-        if (!ecs_os_strncmp(path, prefix, len)) {
-            path += len;
-            parent = 0;
-            start_from_root = true;
+    ecs_table_t *table = r->table;
+    ecs_data_t *data = ecs_table_get_data(table);
+    bool is_watched;
+    int32_t row = ecs_record_to_row(r->row, &is_watched);
+    bool is_bootstrap = template_is_bootstrap(t, e);
+
+    ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
+    int32_t i, count = ecs_vector_count(table->type);
+    int32_t column_count = table->column_count;
+
+    /* Entities that are created by ecs_init only need the components that
+     * were added by the application, like singletons */
+    ecs_type_t dst_type = NULL;
+    if (is_bootstrap) {
+        dst_type = ecs_get_type(t->dst, e);
+    }
+
+    /* Names in signatures are resolved relative to the scope of the entity */
+    ecs_entity_t scope = 0;
+    for (i = 0; i < count; i ++) {
+        if (ECS_HAS_ROLE(components[i], CHILDOF)) {
+            scope = components[i] & ECS_COMPONENT_MASK;
+            break;
         }
     }
 
-    if (!start_from_root && !parent) {
-        ecs_stage_t *stage = ecs_get_stage(&world);
-        parent = stage->scope;
+    ecs_entity_t old_scope = ecs_set_scope(t->dst, scope);
+
+    /* Add tags first, so they are present when a system is created */
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t c = components[i];
+        if (template_is_derived(c) || template_is_late(c)) {
+            continue;
+        }
+
+        if (template_has_value(table, data, i)) {
+            continue;
+        }
+
+        if (dst_type && ecs_type_index_of(dst_type, c) != -1) {
+            continue;
+        }
+
+        ecs_add_entity(t->dst, e, c);
+
+        if (ECS_HAS_ROLE(c, SWITCH)) {
+            ecs_add_entity(t->dst, e, ECS_CASE |
+                ecs_get_case(t->world, e, c & ECS_COMPONENT_MASK));
+        }
     }
 
-    *path_ptr = path;
+    /* The context is passed to a system when it is created, so it must be set
+     * before the system action */
+    int32_t ctx_column = -1;
+#ifdef FLECS_SYSTEM
+    ctx_column = ecs_type_index_of(table->type, ecs_typeid(EcsContext));
+    if (ctx_column != -1 && !(dst_type &&
+        ecs_type_index_of(dst_type, ecs_typeid(EcsContext)) != -1))
+    {
+        template_copy_value(t, e, table, data, row, ctx_column);
+    }
+#endif
 
-    return parent;
+    for (i = 0; i < column_count; i ++) {
+        ecs_entity_t c = components[i];
+        if (i == ctx_column || !template_has_value(table, data, i)) {
+            continue;
+        }
+
+        if (template_is_derived(c)) {
+            continue;
+        }
+
+        if (dst_type && ecs_type_index_of(dst_type, c) != -1) {
+            continue;
+        }
+
+        template_copy_value(t, e, table, data, row, i);
+    }
+
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t c = components[i];
+        if (!template_is_late(c)) {
+            continue;
+        }
+
+        if (dst_type && ecs_type_index_of(dst_type, c) != -1) {
+            continue;
+        }
+
+        if (ECS_HAS_ROLE(c, DISABLED)) {
+            c &= ECS_COMPONENT_MASK;
+            ecs_enable_component_w_entity(t->dst, e, c,
+                ecs_is_component_enabled_w_entity(t->world, e, c));
+        } else {
+            ecs_add_entity(t->dst, e, c);
+        }
+    }
+
+    ecs_set_scope(t->dst, old_scope);
 }
 
-ecs_entity_t ecs_lookup_path_w_sep(
-    ecs_world_t *world,
-    ecs_entity_t parent,
-    const char *path,
-    const char *sep,
-    const char *prefix)
+/* Copy a range of rows of a table to the new world without invoking systems.
+ * OnSet systems are invoked for the range after all entities are copied. */
+static
+void template_copy_rows(
+    ecs_template_t *t,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t first,
+    int32_t count)
 {
-    if (!path) {
-        return 0;
-    }
+    int32_t i, r;
+    ecs_entity_t *entities = ecs_vector_get(
+        data->entities, ecs_entity_t, first);
+    ecs_record_t **records = ecs_vector_get(
+        data->record_ptrs, ecs_record_t*, first);
 
-    ecs_entity_t e = find_as_alias(world, path);
-    if (e) {
-        return e;
-    }      
-    
-    char buff[ECS_MAX_NAME_LENGTH];
-    const char *ptr;
-    ecs_entity_t cur;
-    bool core_searched = false;
+    ecs_table_t *dst_table = ecs_table_from_type(t->dst, table->type);
+    ecs_data_t *dst_data = ecs_table_get_or_create_data(dst_table);
+    int32_t row = ecs_table_appendn(t->dst, dst_table, dst_data, count, entities);
+    ecs_entity_t *dst_entities = ecs_vector_get(
+        dst_data->entities, ecs_entity_t, row);
+
+    /* Copy component columns. Tables are matched with the same component
+     * storage, as component info is copied before tables are created. */
+    ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
+    for (i = 0; i < table->column_count; i ++) {
+        ecs_column_t *column = &data->columns[i];
+        ecs_column_t *dst_column = &dst_data->columns[i];
+        int16_t size = column->size;
+        int16_t alignment = column->alignment;
+        if (!template_has_value(table, data, i)) {
+            continue;
+        }
 
-    if (!sep) {
-        sep = ".";
-    }
+        ecs_assert(dst_column->size == size, ECS_INTERNAL_ERROR, NULL);
 
-    parent = get_parent_from_path(world, parent, &path, prefix);
+        void *src_ptr = ecs_vector_get_t(column->data, size, alignment, first);
+        void *dst_ptr = ecs_vector_get_t(dst_column->data, size, alignment, row);
 
-retry:
-    cur = parent;
-    ptr = path;
+        ecs_c_info_t *c_info = ecs_get_c_info(t->dst, components[i]);
+        ecs_copy_t copy;
+        if (c_info && (copy = c_info->lifecycle.copy)) {
+            copy(t->dst, components[i], dst_entities, entities, dst_ptr,
+                src_ptr, ecs_to_size_t(size), count, c_info->lifecycle.ctx);
+        } else {
+            ecs_os_memcpy(dst_ptr, src_ptr, size * count);
+        }
 
-    while ((ptr = path_elem(ptr, buff, sep))) {
-        cur = ecs_lookup_child(world, cur, buff);
-        if (!cur) {
-            goto tail;
+        if (data->prev_columns && dst_data->prev_columns) {
+            column = &data->prev_columns[i];
+            dst_column = &dst_data->prev_columns[i];
+            ecs_os_memcpy(
+                ecs_vector_get_t(dst_column->data, size, alignment, row),
+                ecs_vector_get_t(column->data, size, alignment, first),
+                size * count);
         }
     }
 
-tail:
-    if (!cur) {
-        if (!core_searched) {
-            if (parent) {
-                parent = ecs_get_parent_w_entity(world, parent, 0);
-            } else {
-                parent = EcsFlecsCore;
-                core_searched = true;
-            }
-            goto retry;
+    for (i = 0; i < table->soa_column_count; i ++) {
+        ecs_column_t *column = &data->soa_columns[i];
+        ecs_column_t *dst_column = &dst_data->soa_columns[i];
+        ecs_os_memcpy(
+            ecs_vector_get_t(dst_column->data,
+                column->size, column->alignment, row),
+            ecs_vector_get_t(column->data,
+                column->size, column->alignment, first),
+            column->size * count);
+    }
+
+    for (i = 0; i < table->sw_column_count; i ++) {
+        ecs_switch_t *sw = data->sw_columns[i].data;
+        ecs_switch_t *dst_sw = dst_data->sw_columns[i].data;
+        for (r = 0; r < count; r ++) {
+            ecs_switch_set(dst_sw, row + r, ecs_switch_get(sw, first + r));
         }
     }
 
-    return cur;
+    for (i = 0; i < table->bs_column_count; i ++) {
+        ecs_bitset_t *bs = &data->bs_columns[i].data;
+        ecs_bitset_t *dst_bs = &dst_data->bs_columns[i].data;
+        for (r = 0; r < count; r ++) {
+            ecs_bitset_set(dst_bs, row + r, ecs_bitset_get(bs, first + r));
+        }
+    }
+
+    template_remap_values(t, dst_table, dst_data, row, count);
+
+    /* Update entity index */
+    ecs_record_t **dst_records = ecs_vector_first(
+        dst_data->record_ptrs, ecs_record_t*);
+    for (r = 0; r < count; r ++) {
+        ecs_record_t *record = ecs_eis_get_or_create(t->dst, entities[r]);
+        record->table = dst_table;
+        record->row = ecs_row_to_record(row + r, records[r]->row < 0);
+        dst_records[row + r] = record;
+    }
+
+    ecs_template_range_t *range = ecs_vector_add(
+        &t->ranges, ecs_template_range_t);
+    range->table = dst_table;
+    range->row = row;
+    range->count = count;
 }
 
-ecs_entity_t ecs_set_scope(
-    ecs_world_t *world,
-    ecs_entity_t scope)
+/* Copy the tables that do not contain builtin components */
+static
+void template_copy_tables(
+    ecs_template_t *t)
 {
-    ecs_stage_t *stage = ecs_get_stage(&world);
+    ecs_sparse_t *tables = t->world->store.tables;
+    int32_t i, count = ecs_sparse_count(tables);
 
-    ecs_entity_t e = ECS_CHILDOF | scope;
-    ecs_entities_t to_add = {
-        .array = &e,
-        .count = 1
-    };
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        if (table->flags & EcsTableHasBuiltins) {
+            continue;
+        }
 
-    ecs_entity_t cur = stage->scope;
-    stage->scope = scope;
+        ecs_data_t *data = ecs_table_get_data(table);
+        int32_t r, row_count = ecs_table_data_count(data);
+        if (!row_count) {
+            continue;
+        }
 
-    if (scope) {
-        stage->scope_table = ecs_table_traverse_add(
-            world, &world->store.root, &to_add, NULL);
-    } else {
-        stage->scope_table = &world->store.root;
+        /* Entities created by ecs_init are already stored in the new world.
+         * Copy the ranges of rows in between them, so that all other entities
+         * are copied the same way. */
+        ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+        int32_t first = 0;
+        for (r = 0; r <= row_count; r ++) {
+            if (r == row_count || template_is_bootstrap(t, entities[r])) {
+                if (r > first) {
+                    template_copy_rows(t, table, data, first, r - first);
+                }
+                first = r + 1;
+            }
+        }
     }
-
-    return cur;
 }
 
-ecs_entity_t ecs_get_scope(
-    ecs_world_t *world)
+/* Copy values of components that are stored in sparse sets */
+static
+void template_copy_sparse(
+    ecs_template_t *t)
 {
-    ecs_stage_t *stage = ecs_get_stage(&world);
-    return stage->scope;
+    ecs_vector_each(t->world->sparse_components, ecs_entity_t, c_ptr, {
+        ecs_c_info_t *c_info = ecs_get_c_info(t->world, *c_ptr);
+        const uint64_t *ids = ecs_sparse_ids(c_info->sparse);
+        int32_t i, count = ecs_sparse_count(c_info->sparse);
+
+        for (i = 0; i < count; i ++) {
+            ecs_set_ptr_w_entity(t->dst, ids[i], *c_ptr,
+                ecs_to_size_t(c_info->size),
+                _ecs_sparse_get(c_info->sparse, 0, i));
+        }
+    });
 }
 
-int32_t ecs_get_child_count(
-    ecs_world_t *world,
-    ecs_entity_t entity)
+#ifdef FLECS_SYSTEM
+/* Copy settings of systems that are not stored in components */
+static
+void template_copy_system(
+    ecs_template_t *t,
+    ecs_entity_t e)
 {
-    ecs_vector_t *tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, entity);
-    if (!tables) {
-        return 0;
-    } else {
-        int32_t count = 0;
-
-        ecs_vector_each(tables, ecs_table_t*, table_ptr, {
-            ecs_table_t *table = *table_ptr;
-            count += ecs_table_count(table);
-        });
-
-        return count;
+    const EcsSystem *src = ecs_get(t->world, e, EcsSystem);
+    if (!src) {
+        return;
     }
-}
 
-ecs_iter_t ecs_scope_iter(
-    ecs_world_t *world,
-    ecs_entity_t parent)
-{
-    ecs_scope_iter_t iter = {
-        .tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, parent),
-        .index = 0
-    };
+    EcsSystem *dst = ecs_get_mut(t->dst, e, EcsSystem, NULL);
+    ecs_assert(dst != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    return (ecs_iter_t) {
-        .world = world,
-        .iter.parent = iter
-    };
+    dst->ctx = src->ctx;
+    dst->status_action = src->status_action;
+    dst->status_ctx = src->status_ctx;
+    dst->tick_source = src->tick_source;
+    dst->entity_budget = src->entity_budget;
+    dst->time_budget = src->time_budget;
 }
+#endif
 
-ecs_iter_t ecs_scope_iter_w_filter(
-    ecs_world_t *world,
-    ecs_entity_t parent,
-    ecs_filter_t *filter)
+ecs_world_t* ecs_init_w_template(
+    ecs_world_t *world)
 {
-    ecs_scope_iter_t iter = {
-        .filter = *filter,
-        .tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, parent),
-        .index = 0
-    };
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
 
-    return (ecs_iter_t) {
+    /* The systems of a spatial index update the index of the template, and
+     * cannot be copied to another world */
+    ecs_assert(!ecs_vector_count(world->spatial_indices),
+        ECS_INVALID_PARAMETER, "template may not have spatial indices");
+
+    ecs_template_t t = {
         .world = world,
-        .iter.parent = iter,
-        .table_count = ecs_vector_count(iter.tables)
+        .dst = ecs_init()
     };
-}
 
-bool ecs_scope_next(
-    ecs_iter_t *it)
-{
-    ecs_scope_iter_t *iter = &it->iter.parent;
-    ecs_vector_t *tables = iter->tables;
-    ecs_filter_t filter = iter->filter;
+    ecs_world_t *dst = t.dst;
+    dst->context = world->context;
+    t.last_component_id = dst->stats.last_component_id;
+    t.last_id = dst->stats.last_id;
 
-    int32_t count = ecs_vector_count(tables);
-    int32_t i;
+    /* The template must have been created with the same builtin modules */
+    ecs_assert(world->stats.last_component_id >= t.last_component_id,
+        ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(world->stats.last_id >= t.last_id,
+        ECS_INVALID_PARAMETER, NULL);
 
-    for (i = iter->index; i < count; i ++) {
-        ecs_table_t *table = *ecs_vector_get(tables, ecs_table_t*, i);
-        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
-        ecs_assert(table->id != 0, ECS_INTERNAL_ERROR, NULL);
+    /* Make all entity ids of the template alive, so entities can be copied
+     * before the entities they refer to */
+    const uint64_t *ids = ecs_sparse_ids(world->store.entity_index);
+    int32_t i, count = ecs_eis_count(world);
+    ecs_vector_t *entities = NULL;
 
-        ecs_data_t *data = ecs_table_get_data(table);
-        if (!data) {
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = ids[i];
+        if (template_is_bootstrap(&t, e)) {
             continue;
         }
 
-        it->count = ecs_table_count(table);
-        if (!it->count) {
-            continue;
-        }
+        ecs_eis_get_or_create(dst, e);
 
-        if (filter.include || filter.exclude) {
-            if (!ecs_table_match_filter(it->world, table, &filter)) {
-                continue;
-            }
+        ecs_record_t *r = ecs_eis_get(world, e);
+        if (r->table && (r->table->flags & EcsTableHasBuiltins)) {
+            ecs_entity_t *elem = ecs_vector_add(&entities, ecs_entity_t);
+            *elem = e;
         }
+    }
 
-        iter->table.table = table;
-        it->table = &iter->table;
-        it->table_columns = data->columns;
-        it->count = ecs_table_count(table);
-        it->entities = ecs_vector_first(data->entities, ecs_entity_t);
-        iter->index = i + 1;
+    /* Copy entities with builtin components in the order they were created, so
+     * that a signature can only refer to entities that are already copied */
+    ecs_vector_sort(entities, ecs_entity_t, template_compare_ids);
+    ecs_entity_t *builtins = ecs_vector_first(entities, ecs_entity_t);
+    int32_t builtin_count = ecs_vector_count(entities);
 
-        return true;
+    /* Copy components and types, as tables depend on them */
+    for (i = 0; i < builtin_count; i ++) {
+        ecs_record_t *r = ecs_eis_get(world, builtins[i]);
+        if (!template_is_reactive(r->table)) {
+            template_copy_entity(&t, builtins[i]);
+        }
     }
 
-    return false;    
-}
-
-const char* ecs_set_name_prefix(
-    ecs_world_t *world,
-    const char *prefix)
-{
-    const char *old_prefix = world->name_prefix;
-    world->name_prefix = prefix;
-    return old_prefix;
-}
+    template_copy_tables(&t);
 
-ecs_entity_t ecs_add_path_w_sep(
-    ecs_world_t *world,
-    ecs_entity_t entity,
-    ecs_entity_t parent,
-    const char *path,
-    const char *sep,
-    const char *prefix)
-{
-    if (!path) {
-        if (!entity) {
-            entity = ecs_new_id(world);
+    /* Copy components that were added to builtin entities, like singletons */
+    ecs_entity_t e;
+    for (e = 1; e <= t.last_id; e ++) {
+        if (e == t.last_component_id) {
+            e = ECS_HI_COMPONENT_ID + 1;
         }
 
-        if (parent) {
-            ecs_add_entity(world, entity, ECS_CHILDOF | entity);
+        if (ecs_eis_is_alive(world, e)) {
+            template_copy_entity(&t, e);
         }
-
-        return entity;
     }
 
-    char buff[ECS_MAX_NAME_LENGTH];
-    const char *ptr = path;
+    /* Copy systems, triggers and pipelines */
+    for (i = 0; i < builtin_count; i ++) {
+        ecs_record_t *r = ecs_eis_get(world, builtins[i]);
+        if (template_is_reactive(r->table)) {
+            template_copy_entity(&t, builtins[i]);
+#ifdef FLECS_SYSTEM
+            template_copy_system(&t, builtins[i]);
+#endif
+        }
+    }
 
-    parent = get_parent_from_path(world, parent, &path, prefix);
+    ecs_vector_free(entities);
 
-    ecs_entity_t cur = parent;
+    template_copy_sparse(&t);
 
-    while ((ptr = path_elem(ptr, buff, sep))) {
-        ecs_entity_t e = ecs_lookup_child(world, cur, buff);
-        if (!e) {
-            char *name = ecs_os_strdup(buff);
+    /* Run OnSet systems for the entities that were copied in bulk */
+    ecs_vector_each(t.ranges, ecs_template_range_t, range, {
+        ecs_table_t *table = range->table;
+        ecs_entities_t components = ecs_type_to_entities(table->type);
+        ecs_run_set_systems(dst, &components, table, ecs_table_get_data(table),
+            range->row, range->count, true);
+    });
 
-            /* If this is the last entity in the path, use the provided id */
-            if (entity && !path_elem(ptr, buff, sep)) {
-                e = entity;
-            }
-            
-            e = ecs_set(world, e, EcsName, {
-                .value = name,
-                .alloc_value = name
-            });
+    ecs_vector_free(t.ranges);
 
-            ecs_os_free(name);
+    /* Copy monitored flags, and generations of entities without components */
+    for (i = 0; i < count; i ++) {
+        e = ids[i];
+        if (template_is_bootstrap(&t, e)) {
+            continue;
+        }
 
-            if (cur) {
-                ecs_add_entity(world, e, ECS_CHILDOF | cur);
-            }
+        ecs_record_t *r = ecs_eis_get(world, e);
+        ecs_record_t *dst_r = ecs_eis_get_or_create(dst, e);
+        if (r->row < 0 && dst_r->row > 0) {
+            dst_r->row = -dst_r->row;
         }
+    }
 
-        cur = e;
+    ecs_vector_each(world->aliases, ecs_alias_t, al, {
+        ecs_use(dst, al->entity, al->name);
+    });
+
+#ifdef FLECS_PIPELINE
+    if (!template_is_bootstrap(&t, world->pipeline)) {
+        ecs_set_pipeline(dst, world->pipeline);
     }
+#endif
 
-    return cur;
-}
+    dst->range_check_enabled = world->range_check_enabled;
+    dst->stats.last_component_id = world->stats.last_component_id;
+    if (world->stats.last_id > dst->stats.last_id) {
+        dst->stats.last_id = world->stats.last_id;
+    }
+    dst->stats.min_id = world->stats.min_id;
+    dst->stats.max_id = world->stats.max_id;
+    dst->stats.target_fps = world->stats.target_fps;
+    dst->stats.time_scale = world->stats.time_scale;
 
-ecs_entity_t ecs_new_from_path_w_sep(
-    ecs_world_t *world,
-    ecs_entity_t parent,
-    const char *path,
-    const char *sep,
-    const char *prefix)
-{
-    return ecs_add_path_w_sep(world, 0, parent, path, sep, prefix);
-}
+    /* Table data was copied without invoking component actions, so the
+     * EcsChildOf index has to be rebuilt from the copied data */
+    ecs_childof_index_rebuild(dst);
 
-void ecs_use(
-    ecs_world_t *world,
-    ecs_entity_t entity,
-    const char *name)
-{
-    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(name != NULL, ECS_INVALID_PARAMETER, NULL);
-    
-    ecs_stage_t *stage = ecs_get_stage(&world);
-    ecs_assert(stage->scope == 0 , ECS_INVALID_PARAMETER, NULL);
-    ecs_assert(find_as_alias(world, name) == 0, ECS_ALREADY_DEFINED, NULL);
-    (void)stage;
-    
-    ecs_alias_t *al = ecs_vector_add(&world->aliases, ecs_alias_t);
-    al->name = ecs_os_strdup(name);
-    al->entity = entity;
+    /* Copied entities could be bases */
+    dst->base_cache_version ++;
+
+    return dst;
 }
+
+#endif
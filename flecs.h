@@ -27,6 +27,10 @@
 #define FLECS_READER_WRITER
 #define FLECS_SNAPSHOT
 #define FLECS_DIRECT_ACCESS
+#define FLECS_PROFILER
+#define FLECS_COMMAND_QUEUE
+#define FLECS_SPATIAL
+#define FLECS_TEMPLATE
 #endif
 
 /**
@@ -50,6 +54,7 @@
 #include <stdio.h>
 #include <limits.h>
 #include <string.h>
+#include <stddef.h>
 
 /* Non-standard but required. If not provided by platform, add manually. */
 #include <stdint.h>
@@ -128,6 +133,7 @@ typedef uint64_t ecs_flags64_t;
 /* Keep unsigned integers out of the codebase as they do more harm than good */
 typedef int32_t ecs_size_t;
 #define ECS_SIZEOF(T) (ecs_size_t)sizeof(T)
+#define ECS_OFFSETOF(T, member) (ecs_size_t)offsetof(T, member)
 
 /* Use alignof in C++, or a trick in C. */
 #ifdef __cplusplus
@@ -161,6 +167,7 @@ typedef int32_t ecs_size_t;
 #define FLECS__EEcsComponentLifecycle (2)
 #define FLECS__EEcsType (3)
 #define FLECS__EEcsName (6)
+#define FLECS__EEcsChildOf (16)
 
 /** System module component ids */
 #define FLECS__EEcsTrigger (4)
@@ -335,770 +342,761 @@ typedef int32_t ecs_size_t;
 #endif
 
 #endif
-#ifndef FLECS_VECTOR_H
-#define FLECS_VECTOR_H
-
+#ifndef FLECS_OS_API_H
+#define FLECS_OS_API_H
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+#include <stdarg.h>
 
-/* Public, so we can do compile-time offset calculation */
-struct ecs_vector_t {
-    int32_t count;
-    int32_t size;
-    
-#ifndef NDEBUG
-    int64_t elem_size;
+#if defined(_MSC_VER) || defined(__MINGW32__)
+#include <malloc.h>
+#elif defined(__FreeBSD__)
+#include <stdlib.h>
+#else
+#include <alloca.h>
 #endif
-};
-
-#define ECS_VECTOR_U(size, alignment) size, ECS_MAX(ECS_SIZEOF(ecs_vector_t), alignment)
-#define ECS_VECTOR_T(T) ECS_VECTOR_U(ECS_SIZEOF(T), ECS_ALIGNOF(T))
 
-/* Macro's for creating vector on stack */
-#ifndef NDEBUG
-#define ECS_VECTOR_VALUE(T, elem_count)\
-{\
-    .elem_size = (int32_t)(ECS_SIZEOF(T)),\
-    .count = elem_count,\
-    .size = elem_count\
-}
+#if defined(_WIN32)
+#define ECS_OS_WINDOWS
+#elif defined(__linux__)
+#define ECS_OS_LINUX
+#elif defined(__APPLE__) && defined(__MACH__)
+#define ECS_OS_DARWIN
 #else
-#define ECS_VECTOR_VALUE(T, elem_count)\
-{\
-    .count = elem_count,\
-    .size = elem_count\
-}
+/* Unknown OS */
 #endif
 
-#define ECS_VECTOR_DECL(name, T, elem_count)\
-struct {\
-    union {\
-        ecs_vector_t vector;\
-        uint64_t align;\
-    } header;\
-    T array[elem_count];\
-} __##name##_value = {\
-    .header.vector = ECS_VECTOR_VALUE(T, elem_count)\
-};\
-const ecs_vector_t *name = (ecs_vector_t*)&__##name##_value
+#ifdef __cplusplus
+extern "C" {
+#endif
 
-#define ECS_VECTOR_IMPL(name, T, elems, elem_count)\
-ecs_os_memcpy(__##name##_value.array, elems, sizeof(T) * elem_count)
+typedef struct ecs_time_t {
+    uint32_t sec;
+    uint32_t nanosec;
+} ecs_time_t;
 
-#define ECS_VECTOR_STACK(name, T, elems, elem_count)\
-ECS_VECTOR_DECL(name, T, elem_count);\
-ECS_VECTOR_IMPL(name, T, elems, elem_count)
+/* Allocation counters (not thread safe) */
+extern int64_t ecs_os_api_malloc_count;
+extern int64_t ecs_os_api_realloc_count;
+extern int64_t ecs_os_api_calloc_count;
+extern int64_t ecs_os_api_free_count;
 
-typedef struct ecs_vector_t ecs_vector_t;
+/* Subsystems to which allocated memory is attributed */
+typedef enum ecs_alloc_tag_t {
+    EcsAllocOther,
+    EcsAllocColumns,            /* Table columns, entity and record arrays */
+    EcsAllocEdges,              /* Table graph edge arrays */
+    EcsAllocEntityIndex,        /* Entity index */
+    EcsAllocDefer,              /* Queues with deferred operations */
+    EcsAllocQuery,              /* Queries and their matched tables */
+    EcsAllocMap,                /* Maps */
+    EcsAllocName,               /* Entity names */
+    EcsAllocSnapshot,           /* Snapshots */
+    EcsAllocTagCount
+} ecs_alloc_tag_t;
+
+/* Allocation counters per subsystem. Counters of worker threads are added to
+ * the global counters when the worker stage is merged. Allocations made from
+ * threads not managed by flecs are not synchronized. */
+typedef struct ecs_alloc_tag_stats_t {
+    int64_t alloc_count;        /* Number of allocations */
+    int64_t realloc_count;      /* Number of reallocations */
+    int64_t free_count;         /* Number of frees */
+    int64_t bytes;              /* Bytes currently allocated */
+} ecs_alloc_tag_stats_t;
+
+extern ecs_alloc_tag_stats_t ecs_os_api_alloc_tags[EcsAllocTagCount];
 
-typedef int (*ecs_comparator_t)(
-    const void* p1,
-    const void *p2);
+/* Use handle types that _at least_ can store pointers */
+typedef uintptr_t ecs_os_thread_t;
+typedef uintptr_t ecs_os_cond_t;
+typedef uintptr_t ecs_os_mutex_t;
+typedef uintptr_t ecs_os_dl_t;
 
-FLECS_EXPORT
-ecs_vector_t* _ecs_vector_new(
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t elem_count);
+/* Generic function pointer type */
+typedef void (*ecs_os_proc_t)(void);
 
-#define ecs_vector_new(T, elem_count) \
-    _ecs_vector_new(ECS_VECTOR_T(T), elem_count)
+/* OS API init */
+typedef 
+void (*ecs_os_api_init_t)(void);
 
-#define ecs_vector_new_t(size, alignment, elem_count) \
-    _ecs_vector_new(ECS_VECTOR_U(size, alignment), elem_count)    
+/* OS API deinit */
+typedef 
+void (*ecs_os_api_fini_t)(void);
 
-FLECS_EXPORT
-ecs_vector_t* _ecs_vector_from_array(
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t elem_count,
-    void *array);
+/* Memory management */
+typedef 
+void* (*ecs_os_api_malloc_t)(
+    ecs_size_t size);
 
-#define ecs_vector_from_array(T, elem_count, array)\
-    _ecs_vector_from_array(ECS_VECTOR_T(T), elem_count, array)
+typedef 
+void (*ecs_os_api_free_t)(
+    void *ptr);
 
-FLECS_EXPORT
-void _ecs_vector_zero(
-    ecs_vector_t *vector,
-    ecs_size_t elem_size,
-    int16_t offset);
+typedef
+void* (*ecs_os_api_realloc_t)(
+    void *ptr, 
+    ecs_size_t size);
 
-#define ecs_vector_zero(vector, T) \
-    _ecs_vector_zero(vector, ECS_VECTOR_T(T))
+typedef
+void* (*ecs_os_api_calloc_t)(
+    ecs_size_t size);
 
-FLECS_EXPORT
-void ecs_vector_free(
-    ecs_vector_t *vector);
+typedef
+char* (*ecs_os_api_strdup_t)(
+    const char *str);
 
-FLECS_EXPORT
-void ecs_vector_clear(
-    ecs_vector_t *vector);
+/* Threads */
+typedef
+void* (*ecs_os_thread_callback_t)(
+    void*);
 
-FLECS_EXPORT
-void ecs_vector_assert_size(
-    ecs_vector_t* vector_inout,
-    ecs_size_t elem_size);
+typedef
+ecs_os_thread_t (*ecs_os_api_thread_new_t)(
+    ecs_os_thread_callback_t callback,
+    void *param);
 
-FLECS_EXPORT
-void ecs_vector_assert_alignment(
-    ecs_vector_t* vector,
-    ecs_size_t elem_alignment);    
+typedef
+void* (*ecs_os_api_thread_join_t)(
+    ecs_os_thread_t thread);
 
-FLECS_EXPORT
-void* _ecs_vector_add(
-    ecs_vector_t **array_inout,
-    ecs_size_t elem_size,
-    int16_t offset);
 
-#define ecs_vector_add(vector, T) \
-    ((T*)_ecs_vector_add(vector, ECS_VECTOR_T(T)))
+/* Atomic increment / decrement */
+typedef
+int (*ecs_os_api_ainc_t)(
+    int32_t *value);
 
-#define ecs_vector_add_t(vector, size, alignment) \
-    _ecs_vector_add(vector, ECS_VECTOR_U(size, alignment))
 
-FLECS_EXPORT
-void* _ecs_vector_addn(
-    ecs_vector_t **array_inout,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t elem_count);
+/* Mutex */
+typedef
+ecs_os_mutex_t (*ecs_os_api_mutex_new_t)(
+    void);
 
-#define ecs_vector_addn(vector, T, elem_count) \
-    ((T*)_ecs_vector_addn(vector, ECS_VECTOR_T(T), elem_count))
+typedef
+void (*ecs_os_api_mutex_lock_t)(
+    ecs_os_mutex_t mutex);
 
-#define ecs_vector_addn_t(vector, size, alignment, elem_count) \
-    _ecs_vector_addn(vector, ECS_VECTOR_U(size, alignment), elem_count)
+typedef
+void (*ecs_os_api_mutex_unlock_t)(
+    ecs_os_mutex_t mutex);
 
-FLECS_EXPORT
-void* _ecs_vector_get(
-    const ecs_vector_t *vector,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t index);
+typedef
+void (*ecs_os_api_mutex_free_t)(
+    ecs_os_mutex_t mutex);
 
-#define ecs_vector_get(vector, T, index) \
-    ((T*)_ecs_vector_get(vector, ECS_VECTOR_T(T), index))
+/* Condition variable */
+typedef
+ecs_os_cond_t (*ecs_os_api_cond_new_t)(
+    void);
 
-#define ecs_vector_get_t(vector, size, alignment, index) \
-    _ecs_vector_get(vector, ECS_VECTOR_U(size, alignment), index)
+typedef
+void (*ecs_os_api_cond_free_t)(
+    ecs_os_cond_t cond);
 
-FLECS_EXPORT
-void* _ecs_vector_last(
-    const ecs_vector_t *vector,
-    ecs_size_t elem_size,
-    int16_t offset);
+typedef
+void (*ecs_os_api_cond_signal_t)(
+    ecs_os_cond_t cond);
 
-#define ecs_vector_last(vector, T) \
-    (T*)_ecs_vector_last(vector, ECS_VECTOR_T(T))
+typedef
+void (*ecs_os_api_cond_broadcast_t)(
+    ecs_os_cond_t cond);
 
-FLECS_EXPORT
-int32_t _ecs_vector_set_min_size(
-    ecs_vector_t **array_inout,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t elem_count);
+typedef
+void (*ecs_os_api_cond_wait_t)(
+    ecs_os_cond_t cond,
+    ecs_os_mutex_t mutex);
 
-#define ecs_vector_set_min_size(vector, T, size) \
-    _ecs_vector_set_min_size(vector, ECS_VECTOR_T(T), size)
+typedef 
+void (*ecs_os_api_sleep_t)(
+    int32_t sec,
+    int32_t nanosec);
 
-FLECS_EXPORT
-int32_t _ecs_vector_set_min_count(
-    ecs_vector_t **vector_inout,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t elem_count);
+typedef
+void (*ecs_os_api_get_time_t)(
+    ecs_time_t *time_out);
 
-#define ecs_vector_set_min_count(vector, T, size) \
-    _ecs_vector_set_min_count(vector, ECS_VECTOR_T(T), size)
+/* Logging */
+typedef
+void (*ecs_os_api_log_t)(
+    const char *fmt,
+    va_list args);
 
-FLECS_EXPORT
-void ecs_vector_remove_last(
-    ecs_vector_t *vector);
+/* Application termination */
+typedef
+void (*ecs_os_api_abort_t)(
+    void);
 
-FLECS_EXPORT
-bool _ecs_vector_pop(
-    ecs_vector_t *vector,
-    ecs_size_t elem_size,
-    int16_t offset,
-    void *value);
+/* Dynamic libraries */
+typedef
+ecs_os_dl_t (*ecs_os_api_dlopen_t)(
+    const char *libname);
 
-#define ecs_vector_pop(vector, T, value) \
-    _ecs_vector_pop(vector, ECS_VECTOR_T(T), value)
+typedef
+ecs_os_proc_t (*ecs_os_api_dlproc_t)(
+    ecs_os_dl_t lib,
+    const char *procname);
 
-FLECS_EXPORT
-int32_t _ecs_vector_move_index(
-    ecs_vector_t **dst,
-    ecs_vector_t *src,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t index);
+typedef
+void (*ecs_os_api_dlclose_t)(
+    ecs_os_dl_t lib);
 
-#define ecs_vector_move_index(dst, src, T, index) \
-    _ecs_vector_move_index(dst, src, ECS_VECTOR_T(T), index)
+typedef
+char* (*ecs_os_api_module_to_path_t)(
+    const char *module_id);
 
-FLECS_EXPORT
-int32_t _ecs_vector_remove_index(
-    ecs_vector_t *vector,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t index);
+/* Prefix members of struct with 'ecs_' as some system headers may define 
+ * macro's for functions like "strdup", "log" or "_free" */
 
-#define ecs_vector_remove_index(vector, T, index) \
-    _ecs_vector_remove_index(vector, ECS_VECTOR_T(T), index)
+typedef struct ecs_os_api_t {
+    /* API init / deinit */
+    ecs_os_api_init_t init_;
+    ecs_os_api_fini_t fini_;
 
-#define ecs_vector_remove_index_t(vector, size, alignment, index) \
-    _ecs_vector_remove_index(vector, ECS_VECTOR_U(size, alignment), index)
+    /* Memory management */
+    ecs_os_api_malloc_t malloc_;
+    ecs_os_api_realloc_t realloc_;
+    ecs_os_api_calloc_t calloc_;
+    ecs_os_api_free_t free_;
 
-FLECS_EXPORT
-void _ecs_vector_reclaim(
-    ecs_vector_t **vector,
-    ecs_size_t elem_size,
-    int16_t offset);
+    /* Strings */
+    ecs_os_api_strdup_t strdup_;
 
-#define ecs_vector_reclaim(vector, T)\
-    _ecs_vector_reclaim(vector, ECS_VECTOR_T(T))
+    /* Threads */
+    ecs_os_api_thread_new_t thread_new_;
+    ecs_os_api_thread_join_t thread_join_;
 
-FLECS_EXPORT
-int32_t _ecs_vector_grow(
-    ecs_vector_t **vector,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t elem_count);
+    /* Atomic incremenet / decrement */
+    ecs_os_api_ainc_t ainc_;
+    ecs_os_api_ainc_t adec_;
 
-#define ecs_vector_grow(vector, T, size) \
-    _ecs_vector_grow(vector, ECS_VECTOR_T(T), size)
+    /* Mutex */
+    ecs_os_api_mutex_new_t mutex_new_;
+    ecs_os_api_mutex_free_t mutex_free_;
+    ecs_os_api_mutex_lock_t mutex_lock_;
+    ecs_os_api_mutex_lock_t mutex_unlock_;
 
-FLECS_EXPORT
-int32_t _ecs_vector_set_size(
-    ecs_vector_t **vector,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t elem_count);
+    /* Condition variable */
+    ecs_os_api_cond_new_t cond_new_;
+    ecs_os_api_cond_free_t cond_free_;
+    ecs_os_api_cond_signal_t cond_signal_;
+    ecs_os_api_cond_broadcast_t cond_broadcast_;
+    ecs_os_api_cond_wait_t cond_wait_;
 
-#define ecs_vector_set_size(vector, T, elem_count) \
-    _ecs_vector_set_size(vector, ECS_VECTOR_T(T), elem_count)
+    /* Time */
+    ecs_os_api_sleep_t sleep_;
+    ecs_os_api_get_time_t get_time_;
 
-#define ecs_vector_set_size_t(vector, size, alignment, elem_count) \
-    _ecs_vector_set_size(vector, ECS_VECTOR_U(size, alignment), elem_count)
+    /* Logging */
+    ecs_os_api_log_t log_;
+    ecs_os_api_log_t log_error_;
+    ecs_os_api_log_t log_debug_;
+    ecs_os_api_log_t log_warning_;
 
-FLECS_EXPORT
-int32_t _ecs_vector_set_count(
-    ecs_vector_t **vector,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t elem_count);
+    /* Application termination */
+    ecs_os_api_abort_t abort_;
 
-#define ecs_vector_set_count(vector, T, elem_count) \
-    _ecs_vector_set_count(vector, ECS_VECTOR_T(T), elem_count)
+    /* Dynamic library loading */
+    ecs_os_api_dlopen_t dlopen_;
+    ecs_os_api_dlproc_t dlproc_;
+    ecs_os_api_dlclose_t dlclose_;
 
-#define ecs_vector_set_count_t(vector, size, alignment, elem_count) \
-    _ecs_vector_set_count(vector, ECS_VECTOR_U(size, alignment), elem_count)
+    /* Overridable function that translates from a logical module id to a
+     * shared library filename */
+    ecs_os_api_module_to_path_t module_to_dl_;
+
+    /* Overridable function that translates from a logical module id to a
+     * path that contains module-specif resources or assets */
+    ecs_os_api_module_to_path_t module_to_etc_;    
+} ecs_os_api_t;
 
 FLECS_EXPORT
-int32_t ecs_vector_count(
-    const ecs_vector_t *vector);
+extern ecs_os_api_t ecs_os_api;
 
 FLECS_EXPORT
-int32_t ecs_vector_size(
-    const ecs_vector_t *vector);
+void ecs_os_init(void);
 
 FLECS_EXPORT
-void* _ecs_vector_first(
-    const ecs_vector_t *vector,
-    ecs_size_t elem_size,
-    int16_t offset);
+void ecs_os_fini(void);
 
-#define ecs_vector_first(vector, T) \
-    ((T*)_ecs_vector_first(vector, ECS_VECTOR_T(T)))
+FLECS_EXPORT
+void ecs_os_set_api(
+    ecs_os_api_t *os_api);
 
-#define ecs_vector_first_t(vector, size, alignment) \
-    _ecs_vector_first(vector, ECS_VECTOR_U(size, alignment))
+FLECS_EXPORT
+void ecs_os_set_api_defaults(void);
 
+/* Attribute a change in allocated memory to a subsystem. An old_size of 0 
+ * records an allocation, a new_size of 0 records a free. */
 FLECS_EXPORT
-void _ecs_vector_sort(
-    ecs_vector_t *vector,
-    ecs_size_t elem_size,
-    int16_t offset,
-    ecs_comparator_t compare_action);
+void ecs_os_track_alloc(
+    ecs_alloc_tag_t tag,
+    ecs_size_t old_size,
+    ecs_size_t new_size);
 
-#define ecs_vector_sort(vector, T, compare_action) \
-    _ecs_vector_sort(vector, ECS_VECTOR_T(T), compare_action)
+/* Memory management */
+#define ecs_os_malloc(size) ecs_os_api.malloc_(size);
+#define ecs_os_free(ptr) ecs_os_api.free_(ptr);
+#define ecs_os_realloc(ptr, size) ecs_os_api.realloc_(ptr, size)
+#define ecs_os_calloc(size) ecs_os_api.calloc_(size)
+#if defined(_MSC_VER) || defined(__MINGW32__)
+#define ecs_os_alloca(size) _alloca((size_t)(size))
+#else
+#define ecs_os_alloca(size) alloca((size_t)(size))
+#endif
 
-FLECS_EXPORT
-void _ecs_vector_memory(
-    const ecs_vector_t *vector,
-    ecs_size_t elem_size,
-    int16_t offset,
-    int32_t *allocd,
-    int32_t *used);
+/* Strings */
+#define ecs_os_strdup(str) ecs_os_api.strdup_(str)
+#define ecs_os_strlen(str) (ecs_size_t)strlen(str)
+#define ecs_os_strcmp(str1, str2) strcmp(str1, str2)
+#define ecs_os_strncmp(str1, str2, num) strncmp(str1, str2, (size_t)(num))
+#define ecs_os_memcmp(ptr1, ptr2, num) memcmp(ptr1, ptr2, (size_t)(num))
+#define ecs_os_memcpy(ptr1, ptr2, num) memcpy(ptr1, ptr2, (size_t)(num))
+#define ecs_os_memmove(ptr1, ptr2, num) memmove(ptr1, ptr2, (size_t)(num))
+#define ecs_os_memset(ptr, value, num) memset(ptr, value, (size_t)(num))
 
-#define ecs_vector_memory(vector, T, allocd, used) \
-    _ecs_vector_memory(vector, ECS_VECTOR_T(T), allocd, used)
+#if defined(_MSC_VER)
+#define ecs_os_strcat(str1, str2) strcat_s(str1, INT_MAX, str2)
+#define ecs_os_sprintf(ptr, ...) sprintf_s(ptr, INT_MAX, __VA_ARGS__)
+#define ecs_os_vsprintf(ptr, fmt, args) vsprintf_s(ptr, INT_MAX, fmt, args)
+#define ecs_os_strcpy(str1, str2) strcpy_s(str1, INT_MAX, str2)
+#define ecs_os_strncpy(str1, str2, num) strncpy_s(str1, INT_MAX, str2, (size_t)(num))
+#else
+#define ecs_os_strcat(str1, str2) strcat(str1, str2)
+#define ecs_os_sprintf(ptr, ...) sprintf(ptr, __VA_ARGS__)
+#define ecs_os_vsprintf(ptr, fmt, args) vsprintf(ptr, fmt, args)
+#define ecs_os_strcpy(str1, str2) strcpy(str1, str2)
+#define ecs_os_strncpy(str1, str2, num) strncpy(str1, str2, (size_t)(num))
+#endif
 
-#define ecs_vector_memory_t(vector, size, alignment, allocd, used) \
-    _ecs_vector_memory(vector, ECS_VECTOR_U(size, alignment), allocd, used)
 
-FLECS_EXPORT
-ecs_vector_t* _ecs_vector_copy(
-    const ecs_vector_t *src,
-    ecs_size_t elem_size,
-    int16_t offset);
+/* Threads */
+#define ecs_os_thread_new(callback, param) ecs_os_api.thread_new_(callback, param)
+#define ecs_os_thread_join(thread) ecs_os_api.thread_join_(thread)
 
-#define ecs_vector_copy(src, T) \
-    _ecs_vector_copy(src, ECS_VECTOR_T(T))
+/* Atomic increment / decrement */
+#define ecs_os_ainc(value) ecs_os_api.ainc_(value)
+#define ecs_os_adec(value) ecs_os_api.adec_(value)
 
-#define ecs_vector_copy_t(src, size, alignment) \
-    _ecs_vector_copy(src, ECS_VECTOR_U(size, alignment))
+/* Mutex */
+#define ecs_os_mutex_new() ecs_os_api.mutex_new_()
+#define ecs_os_mutex_free(mutex) ecs_os_api.mutex_free_(mutex)
+#define ecs_os_mutex_lock(mutex) ecs_os_api.mutex_lock_(mutex)
+#define ecs_os_mutex_unlock(mutex) ecs_os_api.mutex_unlock_(mutex)
 
-#ifndef FLECS_LEGACY
-#define ecs_vector_each(vector, T, var, ...)\
-    {\
-        int var##_i, var##_count = ecs_vector_count(vector);\
-        T* var##_array = ecs_vector_first(vector, T);\
-        for (var##_i = 0; var##_i < var##_count; var##_i ++) {\
-            T* var = &var##_array[var##_i];\
-            __VA_ARGS__\
-        }\
-    }
-#endif
-#ifdef __cplusplus
-}
-#endif
+/* Condition variable */
+#define ecs_os_cond_new() ecs_os_api.cond_new_()
+#define ecs_os_cond_free(cond) ecs_os_api.cond_free_(cond)
+#define ecs_os_cond_signal(cond) ecs_os_api.cond_signal_(cond)
+#define ecs_os_cond_broadcast(cond) ecs_os_api.cond_broadcast_(cond)
+#define ecs_os_cond_wait(cond, mutex) ecs_os_api.cond_wait_(cond, mutex)
 
-#ifdef __cplusplus
-#ifndef FLECS_NO_CPP
+/* Time */
+#define ecs_os_sleep(sec, nanosec) ecs_os_api.sleep_(sec, nanosec)
+#define ecs_os_get_time(time_out) ecs_os_api.get_time_(time_out)
 
-#include <iostream>
+/* Logging (use functions to avoid using variadic macro arguments) */
+FLECS_EXPORT
+void ecs_os_log(const char *fmt, ...);
 
-namespace flecs {
+FLECS_EXPORT
+void ecs_os_warn(const char *fmt, ...);
 
-template <typename T>
-class vector_iterator
-{
-public:
-    explicit vector_iterator(T* value, int index) {
-        m_value = value;
-        m_index = index;
-    }
-
-    bool operator!=(vector_iterator const& other) const
-    {
-        return m_index != other.m_index;
-    }
-
-    T const& operator*() const
-    {
-        return m_value[m_index];
-    }
-
-    vector_iterator& operator++()
-    {
-        ++m_index;
-        return *this;
-    }
+FLECS_EXPORT
+void ecs_os_err(const char *fmt, ...);
 
-private:
-    T* m_value;
-    int m_index;
-};
+FLECS_EXPORT
+void ecs_os_dbg(const char *fmt, ...);
 
-template <typename T>
-class vector {
-public:
-    explicit vector(ecs_vector_t *vector) : m_vector( vector ) { }
+/* Application termination */
+#define ecs_os_abort() ecs_os_api.abort_()
 
-    vector(int32_t count = 0) : m_vector( nullptr ) { 
-        if (count) {
-            init(count);
-        }
-    }
+/* Dynamic libraries */
+#define ecs_os_dlopen(libname) ecs_os_api.dlopen_(libname)
+#define ecs_os_dlproc(lib, procname) ecs_os_api.dlproc_(lib, procname)
+#define ecs_os_dlclose(lib) ecs_os_api.dlclose_(lib)
 
-    vector(std::initializer_list<T> elems) : m_vector( nullptr) {
-        init(elems.size());
-        *this = elems;
-    }
+/* Module id translation */
+#define ecs_os_module_to_dl(lib) ecs_os_api.module_to_dl_(lib)
+#define ecs_os_module_to_etc(lib) ecs_os_api.module_to_etc_(lib)
 
-    void operator=(std::initializer_list<T> elems) {
-        for (auto elem : elems) {
-            this->add(elem);
-        }
-    }
+/* Sleep with floating point time */
+FLECS_EXPORT
+void ecs_sleepf(
+    double t);
 
-    T& operator[](size_t index) {
-        return ecs_vector_get(m_vector, T, index)[0];
-    }
+/* Measure time since provided timestamp */
+FLECS_EXPORT
+double ecs_time_measure(
+    ecs_time_t *start);
 
-    vector_iterator<T> begin() {
-        return vector_iterator<T>(
-            ecs_vector_first(m_vector, T), 0);
-    }
+/* Calculate difference between two timestamps */
+FLECS_EXPORT
+ecs_time_t ecs_time_sub(
+    ecs_time_t t1,
+    ecs_time_t t2);
 
-    vector_iterator<T> end() {
-        return vector_iterator<T>(
-            ecs_vector_last(m_vector, T),
-            ecs_vector_count(m_vector));
-    }    
+/* Convert time value to a double */
+FLECS_EXPORT
+double ecs_time_to_double(
+    ecs_time_t t);
 
-    void clear() {
-        ecs_vector_clear(m_vector);
-    }
+FLECS_EXPORT
+void* ecs_os_memdup(
+    const void *src, 
+    ecs_size_t size);
 
-    void add(T& value) {
-        T* elem = ecs_vector_add(&m_vector, T);
-        *elem = value;
-    }
+/** Are heap functions available? */
+FLECS_EXPORT
+bool ecs_os_has_heap(void);
 
-    void add(T&& value) {
-        T* elem = ecs_vector_add(&m_vector, T);
-        *elem = value;
-    }    
+/** Are threading functions available? */
+FLECS_EXPORT
+bool ecs_os_has_threading(void);
 
-    T& get(int32_t index) {
-        return ecs_vector_get(m_vector, T, index);
-    }
+/** Are time functions available? */
+FLECS_EXPORT
+bool ecs_os_has_time(void);
 
-    T& first() {
-        return ecs_vector_first(m_vector, T);
-    }
+/** Are logging functions available? */
+FLECS_EXPORT
+bool ecs_os_has_logging(void);
 
-    T& last() {
-        return ecs_vector_last(m_vector, T);
-    }
+/** Are dynamic library functions available? */
+FLECS_EXPORT
+bool ecs_os_has_dl(void);
 
-    int32_t count() {
-        return ecs_vector_count(m_vector);
-    }
+/** Are module path functions available? */
+FLECS_EXPORT
+bool ecs_os_has_modules(void);
 
-    int32_t size() {
-        return ecs_vector_size(m_vector);
-    }
+#ifdef __cplusplus
+}
+#endif
 
-    ecs_vector_t *ptr() {
-        return m_vector;
-    }
+#endif
+#ifndef FLECS_VECTOR_H
+#define FLECS_VECTOR_H
 
-    void ptr(ecs_vector_t *ptr) {
-        m_vector = ptr;
-    }
 
-private:
-    void init(int32_t count) {
-        m_vector = ecs_vector_new(T, count);
-    }
+#ifdef __cplusplus
+extern "C" {
+#endif
 
-    ecs_vector_t *m_vector;
+/* Public, so we can do compile-time offset calculation */
+struct ecs_vector_t {
+    int32_t count;
+    int32_t size;
+    
+#ifndef NDEBUG
+    int64_t elem_size;
+#endif
 };
 
-}
+#define ECS_VECTOR_U(size, alignment) size, ECS_MAX(ECS_SIZEOF(ecs_vector_t), alignment)
+#define ECS_VECTOR_T(T) ECS_VECTOR_U(ECS_SIZEOF(T), ECS_ALIGNOF(T))
 
-#endif
+/* Macro's for creating vector on stack */
+#ifndef NDEBUG
+#define ECS_VECTOR_VALUE(T, elem_count)\
+{\
+    .elem_size = (int32_t)(ECS_SIZEOF(T)),\
+    .count = elem_count,\
+    .size = elem_count\
+}
+#else
+#define ECS_VECTOR_VALUE(T, elem_count)\
+{\
+    .count = elem_count,\
+    .size = elem_count\
+}
 #endif
 
-#endif
-#ifndef FLECS_SPARSE_H
-#define FLECS_SPARSE_H
+#define ECS_VECTOR_DECL(name, T, elem_count)\
+struct {\
+    union {\
+        ecs_vector_t vector;\
+        uint64_t align;\
+    } header;\
+    T array[elem_count];\
+} __##name##_value = {\
+    .header.vector = ECS_VECTOR_VALUE(T, elem_count)\
+};\
+const ecs_vector_t *name = (ecs_vector_t*)&__##name##_value
 
+#define ECS_VECTOR_IMPL(name, T, elems, elem_count)\
+ecs_os_memcpy(__##name##_value.array, elems, sizeof(T) * elem_count)
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+#define ECS_VECTOR_STACK(name, T, elems, elem_count)\
+ECS_VECTOR_DECL(name, T, elem_count);\
+ECS_VECTOR_IMPL(name, T, elems, elem_count)
 
-typedef struct ecs_sparse_t ecs_sparse_t;
+typedef struct ecs_vector_t ecs_vector_t;
 
-FLECS_EXPORT
-ecs_sparse_t* _ecs_sparse_new(
-    ecs_size_t elem_size);
+typedef int (*ecs_comparator_t)(
+    const void* p1,
+    const void *p2);
 
 FLECS_EXPORT
-void ecs_sparse_set_id_source(
-    ecs_sparse_t *sparse,
-    uint64_t *id_source);
+ecs_vector_t* _ecs_vector_new(
+    ecs_size_t elem_size,
+    int16_t offset,
+    int32_t elem_count);
 
-#define ecs_sparse_new(type)\
-    _ecs_sparse_new(sizeof(type))
+#define ecs_vector_new(T, elem_count) \
+    _ecs_vector_new(ECS_VECTOR_T(T), elem_count)
 
-FLECS_EXPORT
-void ecs_sparse_free(
-    ecs_sparse_t *sparse);
+#define ecs_vector_new_t(size, alignment, elem_count) \
+    _ecs_vector_new(ECS_VECTOR_U(size, alignment), elem_count)    
 
 FLECS_EXPORT
-void ecs_sparse_clear(
-    ecs_sparse_t *sparse);
+ecs_vector_t* _ecs_vector_from_array(
+    ecs_size_t elem_size,
+    int16_t offset,
+    int32_t elem_count,
+    void *array);
+
+#define ecs_vector_from_array(T, elem_count, array)\
+    _ecs_vector_from_array(ECS_VECTOR_T(T), elem_count, array)
 
 FLECS_EXPORT
-void* _ecs_sparse_add(
-    ecs_sparse_t *sparse,
-    ecs_size_t elem_size);
+void _ecs_vector_zero(
+    ecs_vector_t *vector,
+    ecs_size_t elem_size,
+    int16_t offset);
 
-#define ecs_sparse_add(sparse, type)\
-    ((type*)_ecs_sparse_add(sparse, sizeof(type)))
+#define ecs_vector_zero(vector, T) \
+    _ecs_vector_zero(vector, ECS_VECTOR_T(T))
 
 FLECS_EXPORT
-uint64_t ecs_sparse_last_id(
-    ecs_sparse_t *sparse);
+void ecs_vector_free(
+    ecs_vector_t *vector);
 
 FLECS_EXPORT
-uint64_t ecs_sparse_new_id(
-    ecs_sparse_t *sparse);
+void ecs_vector_clear(
+    ecs_vector_t *vector);
 
 FLECS_EXPORT
-const uint64_t* ecs_sparse_new_ids(
-    ecs_sparse_t *sparse,
-    int32_t count);
+void ecs_vector_assert_size(
+    ecs_vector_t* vector_inout,
+    ecs_size_t elem_size);
 
 FLECS_EXPORT
-void ecs_sparse_remove(
-    ecs_sparse_t *sparse,
-    uint64_t index);
+void ecs_vector_assert_alignment(
+    ecs_vector_t* vector,
+    ecs_size_t elem_alignment);    
 
 FLECS_EXPORT
-void* _ecs_sparse_remove_get(
-    ecs_sparse_t *sparse,
+void* _ecs_vector_add(
+    ecs_vector_t **array_inout,
     ecs_size_t elem_size,
-    uint64_t index);    
+    int16_t offset);
 
-#define ecs_sparse_remove_get(sparse, type, index)\
-    ((type*)_ecs_sparse_remove_get(sparse, sizeof(type), index))
+#define ecs_vector_add(vector, T) \
+    ((T*)_ecs_vector_add(vector, ECS_VECTOR_T(T)))
 
-FLECS_EXPORT
-void ecs_sparse_set_generation(
-    ecs_sparse_t *sparse,
-    uint64_t index);    
+#define ecs_vector_add_t(vector, size, alignment) \
+    _ecs_vector_add(vector, ECS_VECTOR_U(size, alignment))
 
 FLECS_EXPORT
-bool ecs_sparse_exists(
-    ecs_sparse_t *sparse,
-    uint64_t index);
+void* _ecs_vector_addn(
+    ecs_vector_t **array_inout,
+    ecs_size_t elem_size,
+    int16_t offset,
+    int32_t elem_count);
+
+#define ecs_vector_addn(vector, T, elem_count) \
+    ((T*)_ecs_vector_addn(vector, ECS_VECTOR_T(T), elem_count))
+
+#define ecs_vector_addn_t(vector, size, alignment, elem_count) \
+    _ecs_vector_addn(vector, ECS_VECTOR_U(size, alignment), elem_count)
 
 FLECS_EXPORT
-void* _ecs_sparse_get(
-    const ecs_sparse_t *sparse,
+void* _ecs_vector_get(
+    const ecs_vector_t *vector,
     ecs_size_t elem_size,
+    int16_t offset,
     int32_t index);
 
-#define ecs_sparse_get(sparse, type, index)\
-    ((type*)_ecs_sparse_get(sparse, sizeof(type), index))
+#define ecs_vector_get(vector, T, index) \
+    ((T*)_ecs_vector_get(vector, ECS_VECTOR_T(T), index))
 
-FLECS_EXPORT
-bool ecs_sparse_is_alive(
-    const ecs_sparse_t *sparse,
-    uint64_t index);
+#define ecs_vector_get_t(vector, size, alignment, index) \
+    _ecs_vector_get(vector, ECS_VECTOR_U(size, alignment), index)
 
 FLECS_EXPORT
-int32_t ecs_sparse_count(
-    const ecs_sparse_t *sparse);
+void* _ecs_vector_last(
+    const ecs_vector_t *vector,
+    ecs_size_t elem_size,
+    int16_t offset);
 
-FLECS_EXPORT
-int32_t ecs_sparse_size(
-    const ecs_sparse_t *sparse);
+#define ecs_vector_last(vector, T) \
+    (T*)_ecs_vector_last(vector, ECS_VECTOR_T(T))
 
 FLECS_EXPORT
-void* _ecs_sparse_get_sparse(
-    const ecs_sparse_t *sparse,
+int32_t _ecs_vector_set_min_size(
+    ecs_vector_t **array_inout,
     ecs_size_t elem_size,
-    uint64_t index);
+    int16_t offset,
+    int32_t elem_count);
 
-#define ecs_sparse_get_sparse(sparse, type, index)\
-    ((type*)_ecs_sparse_get_sparse(sparse, sizeof(type), index))
+#define ecs_vector_set_min_size(vector, T, size) \
+    _ecs_vector_set_min_size(vector, ECS_VECTOR_T(T), size)
 
 FLECS_EXPORT
-void* _ecs_sparse_get_sparse_any(
-    ecs_sparse_t *sparse,
+int32_t _ecs_vector_set_min_count(
+    ecs_vector_t **vector_inout,
     ecs_size_t elem_size,
-    uint64_t index);
+    int16_t offset,
+    int32_t elem_count);
 
-#define ecs_sparse_get_sparse_any(sparse, type, index)\
-    ((type*)_ecs_sparse_get_sparse_any(sparse, sizeof(type), index))
+#define ecs_vector_set_min_count(vector, T, size) \
+    _ecs_vector_set_min_count(vector, ECS_VECTOR_T(T), size)
 
 FLECS_EXPORT
-void* _ecs_sparse_get_or_create(
-    ecs_sparse_t *sparse,
-    ecs_size_t elem_size,
-    uint64_t index);
-
-#define ecs_sparse_get_or_create(sparse, type, index)\
-    ((type*)_ecs_sparse_get_or_create(sparse, sizeof(type), index))
+void ecs_vector_remove_last(
+    ecs_vector_t *vector);
 
 FLECS_EXPORT
-void* _ecs_sparse_set(
-    ecs_sparse_t *sparse,
+bool _ecs_vector_pop(
+    ecs_vector_t *vector,
     ecs_size_t elem_size,
-    uint64_t index,
+    int16_t offset,
     void *value);
 
-#define ecs_sparse_set(sparse, type, index, value)\
-    ((type*)_ecs_sparse_set(sparse, sizeof(type), index, value))
-
-
-FLECS_EXPORT
-const uint64_t* ecs_sparse_ids(
-    const ecs_sparse_t *sparse);
-
-FLECS_EXPORT
-void ecs_sparse_set_size(
-    ecs_sparse_t *sparse,
-    int32_t elem_count);
+#define ecs_vector_pop(vector, T, value) \
+    _ecs_vector_pop(vector, ECS_VECTOR_T(T), value)
 
 FLECS_EXPORT
-ecs_sparse_t* ecs_sparse_copy(
-    const ecs_sparse_t *src);    
+int32_t _ecs_vector_move_index(
+    ecs_vector_t **dst,
+    ecs_vector_t *src,
+    ecs_size_t elem_size,
+    int16_t offset,
+    int32_t index);
 
-FLECS_EXPORT
-void ecs_sparse_restore(
-    ecs_sparse_t *dst,
-    const ecs_sparse_t *src);
+#define ecs_vector_move_index(dst, src, T, index) \
+    _ecs_vector_move_index(dst, src, ECS_VECTOR_T(T), index)
 
 FLECS_EXPORT
-void ecs_sparse_memory(
-    ecs_sparse_t *sparse,
-    int32_t *allocd,
-    int32_t *used);
-
-#ifndef FLECS_LEGACY
-#define ecs_sparse_each(sparse, T, var, ...)\
-    {\
-        int var##_i, var##_count = ecs_sparse_count(sparse);\
-        for (var##_i = 0; var##_i < var##_count; var##_i ++) {\
-            T* var = ecs_sparse_get(sparse, T, var##_i);\
-            __VA_ARGS__\
-        }\
-    }
-#endif
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif
-#ifndef FLECS_MAP_H
-#define FLECS_MAP_H
+int32_t _ecs_vector_remove_index(
+    ecs_vector_t *vector,
+    ecs_size_t elem_size,
+    int16_t offset,
+    int32_t index);
 
+#define ecs_vector_remove_index(vector, T, index) \
+    _ecs_vector_remove_index(vector, ECS_VECTOR_T(T), index)
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+#define ecs_vector_remove_index_t(vector, size, alignment, index) \
+    _ecs_vector_remove_index(vector, ECS_VECTOR_U(size, alignment), index)
 
-typedef struct ecs_map_t ecs_map_t;
-typedef struct ecs_bucket_t ecs_bucket_t;
-typedef uint64_t ecs_map_key_t;
+FLECS_EXPORT
+void _ecs_vector_reclaim(
+    ecs_vector_t **vector,
+    ecs_size_t elem_size,
+    int16_t offset);
 
-typedef struct ecs_map_iter_t {
-    const ecs_map_t *map;
-    ecs_bucket_t *bucket;
-    int32_t bucket_index;
-    int32_t element_index;
-    void *payload;
-} ecs_map_iter_t;
+#define ecs_vector_reclaim(vector, T)\
+    _ecs_vector_reclaim(vector, ECS_VECTOR_T(T))
 
 FLECS_EXPORT
-ecs_map_t * _ecs_map_new(
+int32_t _ecs_vector_grow(
+    ecs_vector_t **vector,
     ecs_size_t elem_size,
-    ecs_size_t alignment, 
+    int16_t offset,
     int32_t elem_count);
 
-#define ecs_map_new(T, elem_count)\
-    _ecs_map_new(sizeof(T), ECS_ALIGNOF(T), elem_count)
+#define ecs_vector_grow(vector, T, size) \
+    _ecs_vector_grow(vector, ECS_VECTOR_T(T), size)
 
 FLECS_EXPORT
-void * _ecs_map_get(
-    const ecs_map_t *map,
+int32_t _ecs_vector_set_size(
+    ecs_vector_t **vector,
     ecs_size_t elem_size,
-    ecs_map_key_t key);
-
-#define ecs_map_get(map, T, key)\
-    (T*)_ecs_map_get(map, sizeof(T), (ecs_map_key_t)key)
+    int16_t offset,
+    int32_t elem_count);
 
-FLECS_EXPORT
-void * _ecs_map_get_ptr(
-    const ecs_map_t *map,
-    ecs_map_key_t key);
+#define ecs_vector_set_size(vector, T, elem_count) \
+    _ecs_vector_set_size(vector, ECS_VECTOR_T(T), elem_count)
 
-#define ecs_map_get_ptr(map, T, key)\
-    (T)_ecs_map_get_ptr(map, key)
+#define ecs_vector_set_size_t(vector, size, alignment, elem_count) \
+    _ecs_vector_set_size(vector, ECS_VECTOR_U(size, alignment), elem_count)
 
 FLECS_EXPORT
-void _ecs_map_set(
-    ecs_map_t *map,
+int32_t _ecs_vector_set_count(
+    ecs_vector_t **vector,
     ecs_size_t elem_size,
-    ecs_map_key_t key,
-    const void *payload);
+    int16_t offset,
+    int32_t elem_count);
 
-#define ecs_map_set(map, key, payload)\
-    _ecs_map_set(map, sizeof(*payload), (ecs_map_key_t)key, payload);
+#define ecs_vector_set_count(vector, T, elem_count) \
+    _ecs_vector_set_count(vector, ECS_VECTOR_T(T), elem_count)
 
-FLECS_EXPORT
-void ecs_map_free(
-    ecs_map_t *map);
+#define ecs_vector_set_count_t(vector, size, alignment, elem_count) \
+    _ecs_vector_set_count(vector, ECS_VECTOR_U(size, alignment), elem_count)
 
 FLECS_EXPORT
-void ecs_map_remove(
-    ecs_map_t *map,
-    ecs_map_key_t key);
+int32_t ecs_vector_count(
+    const ecs_vector_t *vector);
 
 FLECS_EXPORT
-void ecs_map_clear(
-    ecs_map_t *map);
+int32_t ecs_vector_size(
+    const ecs_vector_t *vector);
 
 FLECS_EXPORT
-int32_t ecs_map_count(
-    const ecs_map_t *map);
+void* _ecs_vector_first(
+    const ecs_vector_t *vector,
+    ecs_size_t elem_size,
+    int16_t offset);
 
-FLECS_EXPORT
-int32_t ecs_map_bucket_count(
-    const ecs_map_t *map);
+#define ecs_vector_first(vector, T) \
+    ((T*)_ecs_vector_first(vector, ECS_VECTOR_T(T)))
 
-FLECS_EXPORT
-ecs_map_iter_t ecs_map_iter(
-    const ecs_map_t *map);
+#define ecs_vector_first_t(vector, size, alignment) \
+    _ecs_vector_first(vector, ECS_VECTOR_U(size, alignment))
 
 FLECS_EXPORT
-void* _ecs_map_next(
-    ecs_map_iter_t* iter,
+void _ecs_vector_sort(
+    ecs_vector_t *vector,
     ecs_size_t elem_size,
-    ecs_map_key_t *key);
+    int16_t offset,
+    ecs_comparator_t compare_action);
 
-#define ecs_map_next(iter, T, key) \
-    (T*)_ecs_map_next(iter, sizeof(T), key)
+#define ecs_vector_sort(vector, T, compare_action) \
+    _ecs_vector_sort(vector, ECS_VECTOR_T(T), compare_action)
 
 FLECS_EXPORT
-void* _ecs_map_next_ptr(
-    ecs_map_iter_t* iter,
-    ecs_map_key_t *key);
+void _ecs_vector_memory(
+    const ecs_vector_t *vector,
+    ecs_size_t elem_size,
+    int16_t offset,
+    int32_t *allocd,
+    int32_t *used);
 
-#define ecs_map_next_ptr(iter, T, key) \
-    (T)_ecs_map_next_ptr(iter, key)
+#define ecs_vector_memory(vector, T, allocd, used) \
+    _ecs_vector_memory(vector, ECS_VECTOR_T(T), allocd, used)
 
-FLECS_EXPORT
-void ecs_map_grow(
-    ecs_map_t *map, 
-    int32_t elem_count);
+#define ecs_vector_memory_t(vector, size, alignment, allocd, used) \
+    _ecs_vector_memory(vector, ECS_VECTOR_U(size, alignment), allocd, used)
 
 FLECS_EXPORT
-void ecs_map_set_size(
-    ecs_map_t *map, 
-    int32_t elem_count);
+ecs_vector_t* _ecs_vector_copy(
+    const ecs_vector_t *src,
+    ecs_size_t elem_size,
+    int16_t offset);
 
-FLECS_EXPORT
-void ecs_map_memory(
-    ecs_map_t *map, 
-    int32_t *allocd,
-    int32_t *used);
+#define ecs_vector_copy(src, T) \
+    _ecs_vector_copy(src, ECS_VECTOR_T(T))
 
-FLECS_EXPORT
-ecs_map_t* ecs_map_copy(
-    const ecs_map_t *map);
+#define ecs_vector_copy_t(src, size, alignment) \
+    _ecs_vector_copy(src, ECS_VECTOR_U(size, alignment))
 
 #ifndef FLECS_LEGACY
-#define ecs_map_each(map, T, key, var, ...)\
+#define ecs_vector_each(vector, T, var, ...)\
     {\
-        ecs_map_iter_t it = ecs_map_iter(map);\
-        ecs_map_key_t key;\
-        T* var;\
-        (void)key;\
-        (void)var;\
-        while ((var = ecs_map_next(&it, T, &key))) {\
+        int var##_i, var##_count = ecs_vector_count(vector);\
+        T* var##_array = ecs_vector_first(vector, T);\
+        for (var##_i = 0; var##_i < var##_count; var##_i ++) {\
+            T* var = &var##_array[var##_i];\
             __VA_ARGS__\
         }\
     }
@@ -1114,46 +1112,121 @@ ecs_map_t* ecs_map_copy(
 
 namespace flecs {
 
-template <typename K, typename T>
-class map {
+template <typename T>
+class vector_iterator
+{
 public:
-    map(int32_t count = 0) { 
-        init(count);
+    explicit vector_iterator(T* value, int index) {
+        m_value = value;
+        m_index = index;
     }
 
-    map(std::initializer_list<std::pair<K, T>> elems) {
+    bool operator!=(vector_iterator const& other) const
+    {
+        return m_index != other.m_index;
+    }
+
+    T const& operator*() const
+    {
+        return m_value[m_index];
+    }
+
+    vector_iterator& operator++()
+    {
+        ++m_index;
+        return *this;
+    }
+
+private:
+    T* m_value;
+    int m_index;
+};
+
+template <typename T>
+class vector {
+public:
+    explicit vector(ecs_vector_t *vector) : m_vector( vector ) { }
+
+    vector(int32_t count = 0) : m_vector( nullptr ) { 
+        if (count) {
+            init(count);
+        }
+    }
+
+    vector(std::initializer_list<T> elems) : m_vector( nullptr) {
         init(elems.size());
         *this = elems;
     }
 
-    void operator=(std::initializer_list<std::pair<K, T>> elems) {
+    void operator=(std::initializer_list<T> elems) {
         for (auto elem : elems) {
-            this->set(elem.first, elem.second);
+            this->add(elem);
         }
     }
 
+    T& operator[](size_t index) {
+        return ecs_vector_get(m_vector, T, index)[0];
+    }
+
+    vector_iterator<T> begin() {
+        return vector_iterator<T>(
+            ecs_vector_first(m_vector, T), 0);
+    }
+
+    vector_iterator<T> end() {
+        return vector_iterator<T>(
+            ecs_vector_last(m_vector, T),
+            ecs_vector_count(m_vector));
+    }    
+
     void clear() {
-        ecs_map_clear(m_map);
+        ecs_vector_clear(m_vector);
+    }
+
+    void add(T& value) {
+        T* elem = ecs_vector_add(&m_vector, T);
+        *elem = value;
+    }
+
+    void add(T&& value) {
+        T* elem = ecs_vector_add(&m_vector, T);
+        *elem = value;
+    }    
+
+    T& get(int32_t index) {
+        return ecs_vector_get(m_vector, T, index);
+    }
+
+    T& first() {
+        return ecs_vector_first(m_vector, T);
+    }
+
+    T& last() {
+        return ecs_vector_last(m_vector, T);
     }
 
     int32_t count() {
-        return ecs_map_count(m_map);
+        return ecs_vector_count(m_vector);
     }
 
-    void set(K& key, T& value) {
-        ecs_map_set(m_map, reinterpret_cast<ecs_map_key_t>(key), &value);
+    int32_t size() {
+        return ecs_vector_size(m_vector);
     }
 
-    T& get(K& key) {
-        *(T*)ecs_map_get(m_map, T, reinterpret_cast<ecs_map_key_t>(key));
+    ecs_vector_t *ptr() {
+        return m_vector;
+    }
+
+    void ptr(ecs_vector_t *ptr) {
+        m_vector = ptr;
     }
 
 private:
     void init(int32_t count) {
-        m_map = ecs_map_new(T, count);
+        m_vector = ecs_vector_new(T, count);
     }
 
-    ecs_map_t *m_map;
+    ecs_vector_t *m_vector;
 };
 
 }
@@ -1162,684 +1235,737 @@ private:
 #endif
 
 #endif
-#ifndef FLECS_SWITCH_LIST_H
-#define FLECS_SWITCH_LIST_H
-
+#ifndef FLECS_SPARSE_H
+#define FLECS_SPARSE_H
 
-typedef struct ecs_switch_header_t {
-    int32_t element;
-    int32_t count;
-} ecs_switch_header_t;
 
-typedef struct ecs_switch_node_t {
-    int32_t next;
-    int32_t prev;
-} ecs_switch_node_t;
+#ifdef __cplusplus
+extern "C" {
+#endif
 
-typedef struct ecs_switch_t {
-    uint64_t min;
-    uint64_t max;
-    ecs_switch_header_t *headers;
-    ecs_vector_t *nodes;
-    ecs_vector_t *values;
-} ecs_switch_t;
+typedef struct ecs_sparse_t ecs_sparse_t;
 
 FLECS_EXPORT
-ecs_switch_t* ecs_switch_new(
-    uint64_t min, 
-    uint64_t max,
-    int32_t elements);
+ecs_sparse_t* _ecs_sparse_new(
+    ecs_size_t elem_size);
 
 FLECS_EXPORT
-void ecs_switch_free(
-    ecs_switch_t *sw);
+void ecs_sparse_set_id_source(
+    ecs_sparse_t *sparse,
+    uint64_t *id_source);
 
-FLECS_EXPORT
-void ecs_switch_add(
-    ecs_switch_t *sw);
+#define ecs_sparse_new(type)\
+    _ecs_sparse_new(sizeof(type))
 
+/** Set number of elements per chunk. Must be a power of two, and may only be
+ * set before the first element is added. */
 FLECS_EXPORT
-void ecs_switch_set_count(
-    ecs_switch_t *sw,
-    int32_t count);
+void ecs_sparse_set_chunk_size(
+    ecs_sparse_t *sparse,
+    int32_t elem_count);
 
 FLECS_EXPORT
-void ecs_switch_set_min_count(
-    ecs_switch_t *sw,
-    int32_t count);
+void ecs_sparse_set_alloc_tag(
+    ecs_sparse_t *sparse,
+    ecs_alloc_tag_t tag);
 
 FLECS_EXPORT
-void ecs_switch_addn(
-    ecs_switch_t *sw,
-    int32_t count);    
+void ecs_sparse_free(
+    ecs_sparse_t *sparse);
 
 FLECS_EXPORT
-void ecs_switch_set(
-    ecs_switch_t *sw,
-    int32_t element,
-    uint64_t value);
+void ecs_sparse_clear(
+    ecs_sparse_t *sparse);
 
 FLECS_EXPORT
-void ecs_switch_remove(
-    ecs_switch_t *sw,
-    int32_t element);
+void* _ecs_sparse_add(
+    ecs_sparse_t *sparse,
+    ecs_size_t elem_size);
+
+#define ecs_sparse_add(sparse, type)\
+    ((type*)_ecs_sparse_add(sparse, sizeof(type)))
 
 FLECS_EXPORT
-uint64_t ecs_switch_get(
-    const ecs_switch_t *sw,
-    int32_t element);
+uint64_t ecs_sparse_last_id(
+    ecs_sparse_t *sparse);
 
 FLECS_EXPORT
-ecs_vector_t* ecs_switch_values(
-    const ecs_switch_t *sw);    
+uint64_t ecs_sparse_new_id(
+    ecs_sparse_t *sparse);
 
 FLECS_EXPORT
-int32_t ecs_switch_case_count(
-    const ecs_switch_t *sw,
-    uint64_t value);
+const uint64_t* ecs_sparse_new_ids(
+    ecs_sparse_t *sparse,
+    int32_t count);
 
 FLECS_EXPORT
-int32_t ecs_switch_first(
-    const ecs_switch_t *sw,
-    uint64_t value);
+void ecs_sparse_remove(
+    ecs_sparse_t *sparse,
+    uint64_t index);
 
 FLECS_EXPORT
-int32_t ecs_switch_next(
-    const ecs_switch_t *sw,
-    int32_t elem);
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif
-#ifndef FLECS_STRBUF_H_
-#define FLECS_STRBUF_H_
-
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-#define ECS_STRBUF_INIT (ecs_strbuf_t){0}
-#define ECS_STRBUF_ELEMENT_SIZE (511)
-#define ECS_STRBUF_MAX_LIST_DEPTH (32)
-
-/* A buffer builds up a list of elements which individually can be up to N bytes
- * large. While appending, data is added to these elements. More elements are
- * added on the fly when needed. When an application calls ecs_strbuf_get, all
- * elements are combined in one string and the element administration is freed.
- *
- * This approach prevents reallocs of large blocks of memory, and therefore
- * copying large blocks of memory when appending to a large buffer. A buffer
- * preallocates some memory for the element overhead so that for small strings
- * there is hardly any overhead, while for large strings the overhead is offset
- * by the reduced time spent on copying memory.
- */
-
-typedef struct ecs_strbuf_element {
-    bool buffer_embedded;
-    int32_t pos;
-    char *buf;
-    struct ecs_strbuf_element *next;
-} ecs_strbuf_element;
-
-typedef struct ecs_strbuf_element_embedded {
-    ecs_strbuf_element super;
-    char buf[ECS_STRBUF_ELEMENT_SIZE + 1];
-} ecs_strbuf_element_embedded;
-
-typedef struct ecs_strbuf_element_str {
-    ecs_strbuf_element super;
-    char *alloc_str;
-} ecs_strbuf_element_str;
-
-typedef struct ecs_strbuf_list_elem {
-    int32_t count;
-    const char *separator;
-} ecs_strbuf_list_elem;
-
-typedef struct ecs_strbuf_t {
-    /* When set by an application, append will write to this buffer */
-    char *buf;
-
-    /* The maximum number of characters that may be printed */
-    int32_t max;
+void* _ecs_sparse_remove_get(
+    ecs_sparse_t *sparse,
+    ecs_size_t elem_size,
+    uint64_t index);    
 
-    /* Size of elements minus current element */
-    int32_t size;
+#define ecs_sparse_remove_get(sparse, type, index)\
+    ((type*)_ecs_sparse_remove_get(sparse, sizeof(type), index))
 
-    /* The number of elements in use */
-    int32_t elementCount;
+FLECS_EXPORT
+void ecs_sparse_set_generation(
+    ecs_sparse_t *sparse,
+    uint64_t index);    
 
-    /* Always allocate at least one element */
-    ecs_strbuf_element_embedded firstElement;
+FLECS_EXPORT
+bool ecs_sparse_exists(
+    ecs_sparse_t *sparse,
+    uint64_t index);
 
-    /* The current element being appended to */
-    ecs_strbuf_element *current;
+FLECS_EXPORT
+void* _ecs_sparse_get(
+    const ecs_sparse_t *sparse,
+    ecs_size_t elem_size,
+    int32_t index);
 
-    /* Stack that keeps track of number of list elements, used for conditionally
-     * inserting a separator */
-    ecs_strbuf_list_elem list_stack[ECS_STRBUF_MAX_LIST_DEPTH];
-    int32_t list_sp;
-} ecs_strbuf_t;
+#define ecs_sparse_get(sparse, type, index)\
+    ((type*)_ecs_sparse_get(sparse, sizeof(type), index))
 
-/* Append format string to a buffer.
- * Returns false when max is reached, true when there is still space */
 FLECS_EXPORT
-bool ecs_strbuf_append(
-    ecs_strbuf_t *buffer,
-    const char *fmt,
-    ...);
+bool ecs_sparse_is_alive(
+    const ecs_sparse_t *sparse,
+    uint64_t index);
 
-/* Append format string with argument list to a buffer.
- * Returns false when max is reached, true when there is still space */
 FLECS_EXPORT
-bool ecs_strbuf_vappend(
-    ecs_strbuf_t *buffer,
-    const char *fmt,
-    va_list args);
+int32_t ecs_sparse_count(
+    const ecs_sparse_t *sparse);
 
-/* Append string to buffer.
- * Returns false when max is reached, true when there is still space */
 FLECS_EXPORT
-bool ecs_strbuf_appendstr(
-    ecs_strbuf_t *buffer,
-    const char *str);
+int32_t ecs_sparse_size(
+    const ecs_sparse_t *sparse);
 
-/* Append source buffer to destination buffer.
- * Returns false when max is reached, true when there is still space */
 FLECS_EXPORT
-bool ecs_strbuf_mergebuff(
-    ecs_strbuf_t *dst_buffer,
-    ecs_strbuf_t *src_buffer);
+void* _ecs_sparse_get_sparse(
+    const ecs_sparse_t *sparse,
+    ecs_size_t elem_size,
+    uint64_t index);
 
-/* Append string to buffer, transfer ownership to buffer.
- * Returns false when max is reached, true when there is still space */
-FLECS_EXPORT
-bool ecs_strbuf_appendstr_zerocpy(
-    ecs_strbuf_t *buffer,
-    char *str);
+#define ecs_sparse_get_sparse(sparse, type, index)\
+    ((type*)_ecs_sparse_get_sparse(sparse, sizeof(type), index))
 
-/* Append string to buffer, do not free/modify string.
- * Returns false when max is reached, true when there is still space */
 FLECS_EXPORT
-bool ecs_strbuf_appendstr_zerocpy_const(
-    ecs_strbuf_t *buffer,
-    const char *str);
+void* _ecs_sparse_get_sparse_any(
+    ecs_sparse_t *sparse,
+    ecs_size_t elem_size,
+    uint64_t index);
 
-/* Append n characters to buffer.
- * Returns false when max is reached, true when there is still space */
-FLECS_EXPORT
-bool ecs_strbuf_appendstrn(
-    ecs_strbuf_t *buffer,
-    const char *str,
-    int32_t n);
+#define ecs_sparse_get_sparse_any(sparse, type, index)\
+    ((type*)_ecs_sparse_get_sparse_any(sparse, sizeof(type), index))
 
-/* Return result string (also resets buffer) */
 FLECS_EXPORT
-char *ecs_strbuf_get(
-    ecs_strbuf_t *buffer);
+void* _ecs_sparse_get_or_create(
+    ecs_sparse_t *sparse,
+    ecs_size_t elem_size,
+    uint64_t index);
+
+#define ecs_sparse_get_or_create(sparse, type, index)\
+    ((type*)_ecs_sparse_get_or_create(sparse, sizeof(type), index))
 
-/* Reset buffer without returning a string */
 FLECS_EXPORT
-void ecs_strbuf_reset(
-    ecs_strbuf_t *buffer);
+void* _ecs_sparse_set(
+    ecs_sparse_t *sparse,
+    ecs_size_t elem_size,
+    uint64_t index,
+    void *value);
+
+#define ecs_sparse_set(sparse, type, index, value)\
+    ((type*)_ecs_sparse_set(sparse, sizeof(type), index, value))
+
 
-/* Push a list */
 FLECS_EXPORT
-void ecs_strbuf_list_push(
-    ecs_strbuf_t *buffer,
-    const char *list_open,
-    const char *separator);
+const uint64_t* ecs_sparse_ids(
+    const ecs_sparse_t *sparse);
 
-/* Pop a new list */
 FLECS_EXPORT
-void ecs_strbuf_list_pop(
-    ecs_strbuf_t *buffer,
-    const char *list_close);
+void ecs_sparse_set_size(
+    ecs_sparse_t *sparse,
+    int32_t elem_count);
 
-/* Insert a new element in list */
 FLECS_EXPORT
-void ecs_strbuf_list_next(
-    ecs_strbuf_t *buffer);
+ecs_sparse_t* ecs_sparse_copy(
+    const ecs_sparse_t *src);    
 
-/* Append formatted string as a new element in list */
 FLECS_EXPORT
-bool ecs_strbuf_list_append(
-    ecs_strbuf_t *buffer,
-    const char *fmt,
-    ...);
+void ecs_sparse_restore(
+    ecs_sparse_t *dst,
+    const ecs_sparse_t *src);
 
-/* Append string as a new element in list */
 FLECS_EXPORT
-bool ecs_strbuf_list_appendstr(
-    ecs_strbuf_t *buffer,
-    const char *str);
+void ecs_sparse_memory(
+    ecs_sparse_t *sparse,
+    int32_t *allocd,
+    int32_t *used);
 
-#ifdef __cplusplus
-}
+#ifndef FLECS_LEGACY
+#define ecs_sparse_each(sparse, T, var, ...)\
+    {\
+        int var##_i, var##_count = ecs_sparse_count(sparse);\
+        for (var##_i = 0; var##_i < var##_count; var##_i ++) {\
+            T* var = ecs_sparse_get(sparse, T, var##_i);\
+            __VA_ARGS__\
+        }\
+    }
 #endif
 
+#ifdef __cplusplus
+}
 #endif
-#ifndef FLECS_OS_API_H
-#define FLECS_OS_API_H
-
-#include <stdarg.h>
 
-#if defined(_MSC_VER) || defined(__MINGW32__)
-#include <malloc.h>
-#elif defined(__FreeBSD__)
-#include <stdlib.h>
-#else
-#include <alloca.h>
 #endif
+#ifndef FLECS_MAP_H
+#define FLECS_MAP_H
 
-#if defined(_WIN32)
-#define ECS_OS_WINDOWS
-#elif defined(__linux__)
-#define ECS_OS_LINUX
-#elif defined(__APPLE__) && defined(__MACH__)
-#define ECS_OS_DARWIN
-#else
-/* Unknown OS */
-#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-typedef struct ecs_time_t {
-    uint32_t sec;
-    uint32_t nanosec;
-} ecs_time_t;
+typedef struct ecs_map_t ecs_map_t;
+typedef struct ecs_bucket_t ecs_bucket_t;
+typedef uint64_t ecs_map_key_t;
 
-/* Allocation counters (not thread safe) */
-extern int64_t ecs_os_api_malloc_count;
-extern int64_t ecs_os_api_realloc_count;
-extern int64_t ecs_os_api_calloc_count;
-extern int64_t ecs_os_api_free_count;
-
-/* Use handle types that _at least_ can store pointers */
-typedef uintptr_t ecs_os_thread_t;
-typedef uintptr_t ecs_os_cond_t;
-typedef uintptr_t ecs_os_mutex_t;
-typedef uintptr_t ecs_os_dl_t;
+typedef struct ecs_map_iter_t {
+    const ecs_map_t *map;
+    ecs_bucket_t *bucket;
+    int32_t bucket_index;
+    int32_t element_index;
+    void *payload;
+} ecs_map_iter_t;
 
-/* Generic function pointer type */
-typedef void (*ecs_os_proc_t)(void);
+FLECS_EXPORT
+ecs_map_t * _ecs_map_new(
+    ecs_size_t elem_size,
+    ecs_size_t alignment, 
+    int32_t elem_count);
 
-/* OS API init */
-typedef 
-void (*ecs_os_api_init_t)(void);
+#define ecs_map_new(T, elem_count)\
+    _ecs_map_new(sizeof(T), ECS_ALIGNOF(T), elem_count)
 
-/* OS API deinit */
-typedef 
-void (*ecs_os_api_fini_t)(void);
+FLECS_EXPORT
+void * _ecs_map_get(
+    const ecs_map_t *map,
+    ecs_size_t elem_size,
+    ecs_map_key_t key);
 
-/* Memory management */
-typedef 
-void* (*ecs_os_api_malloc_t)(
-    ecs_size_t size);
+#define ecs_map_get(map, T, key)\
+    (T*)_ecs_map_get(map, sizeof(T), (ecs_map_key_t)key)
 
-typedef 
-void (*ecs_os_api_free_t)(
-    void *ptr);
+FLECS_EXPORT
+void * _ecs_map_get_ptr(
+    const ecs_map_t *map,
+    ecs_map_key_t key);
 
-typedef
-void* (*ecs_os_api_realloc_t)(
-    void *ptr, 
-    ecs_size_t size);
+#define ecs_map_get_ptr(map, T, key)\
+    (T)_ecs_map_get_ptr(map, key)
 
-typedef
-void* (*ecs_os_api_calloc_t)(
-    ecs_size_t size);
+FLECS_EXPORT
+void _ecs_map_set(
+    ecs_map_t *map,
+    ecs_size_t elem_size,
+    ecs_map_key_t key,
+    const void *payload);
 
-typedef
-char* (*ecs_os_api_strdup_t)(
-    const char *str);
+#define ecs_map_set(map, key, payload)\
+    _ecs_map_set(map, sizeof(*payload), (ecs_map_key_t)key, payload);
 
-/* Threads */
-typedef
-void* (*ecs_os_thread_callback_t)(
-    void*);
+FLECS_EXPORT
+void ecs_map_free(
+    ecs_map_t *map);
 
-typedef
-ecs_os_thread_t (*ecs_os_api_thread_new_t)(
-    ecs_os_thread_callback_t callback,
-    void *param);
+FLECS_EXPORT
+void ecs_map_remove(
+    ecs_map_t *map,
+    ecs_map_key_t key);
 
-typedef
-void* (*ecs_os_api_thread_join_t)(
-    ecs_os_thread_t thread);
+FLECS_EXPORT
+void ecs_map_clear(
+    ecs_map_t *map);
 
+FLECS_EXPORT
+int32_t ecs_map_count(
+    const ecs_map_t *map);
 
-/* Atomic increment / decrement */
-typedef
-int (*ecs_os_api_ainc_t)(
-    int32_t *value);
+FLECS_EXPORT
+int32_t ecs_map_bucket_count(
+    const ecs_map_t *map);
 
+FLECS_EXPORT
+ecs_map_iter_t ecs_map_iter(
+    const ecs_map_t *map);
 
-/* Mutex */
-typedef
-ecs_os_mutex_t (*ecs_os_api_mutex_new_t)(
-    void);
+FLECS_EXPORT
+void* _ecs_map_next(
+    ecs_map_iter_t* iter,
+    ecs_size_t elem_size,
+    ecs_map_key_t *key);
 
-typedef
-void (*ecs_os_api_mutex_lock_t)(
-    ecs_os_mutex_t mutex);
+#define ecs_map_next(iter, T, key) \
+    (T*)_ecs_map_next(iter, sizeof(T), key)
 
-typedef
-void (*ecs_os_api_mutex_unlock_t)(
-    ecs_os_mutex_t mutex);
+FLECS_EXPORT
+void* _ecs_map_next_ptr(
+    ecs_map_iter_t* iter,
+    ecs_map_key_t *key);
 
-typedef
-void (*ecs_os_api_mutex_free_t)(
-    ecs_os_mutex_t mutex);
+#define ecs_map_next_ptr(iter, T, key) \
+    (T)_ecs_map_next_ptr(iter, key)
 
-/* Condition variable */
-typedef
-ecs_os_cond_t (*ecs_os_api_cond_new_t)(
-    void);
+FLECS_EXPORT
+void ecs_map_grow(
+    ecs_map_t *map, 
+    int32_t elem_count);
 
-typedef
-void (*ecs_os_api_cond_free_t)(
-    ecs_os_cond_t cond);
+FLECS_EXPORT
+void ecs_map_set_size(
+    ecs_map_t *map, 
+    int32_t elem_count);
 
-typedef
-void (*ecs_os_api_cond_signal_t)(
-    ecs_os_cond_t cond);
+FLECS_EXPORT
+void ecs_map_memory(
+    ecs_map_t *map, 
+    int32_t *allocd,
+    int32_t *used);
 
-typedef
-void (*ecs_os_api_cond_broadcast_t)(
-    ecs_os_cond_t cond);
+FLECS_EXPORT
+ecs_map_t* ecs_map_copy(
+    const ecs_map_t *map);
 
-typedef
-void (*ecs_os_api_cond_wait_t)(
-    ecs_os_cond_t cond,
-    ecs_os_mutex_t mutex);
+#ifndef FLECS_LEGACY
+#define ecs_map_each(map, T, key, var, ...)\
+    {\
+        ecs_map_iter_t it = ecs_map_iter(map);\
+        ecs_map_key_t key;\
+        T* var;\
+        (void)key;\
+        (void)var;\
+        while ((var = ecs_map_next(&it, T, &key))) {\
+            __VA_ARGS__\
+        }\
+    }
+#endif
+#ifdef __cplusplus
+}
+#endif
 
-typedef 
-void (*ecs_os_api_sleep_t)(
-    int32_t sec,
-    int32_t nanosec);
+#ifdef __cplusplus
+#ifndef FLECS_NO_CPP
 
-typedef
-void (*ecs_os_api_get_time_t)(
-    ecs_time_t *time_out);
+#include <iostream>
 
-/* Logging */
-typedef
-void (*ecs_os_api_log_t)(
-    const char *fmt,
-    va_list args);
+namespace flecs {
 
-/* Application termination */
-typedef
-void (*ecs_os_api_abort_t)(
-    void);
+template <typename K, typename T>
+class map {
+public:
+    map(int32_t count = 0) { 
+        init(count);
+    }
 
-/* Dynamic libraries */
-typedef
-ecs_os_dl_t (*ecs_os_api_dlopen_t)(
-    const char *libname);
+    map(std::initializer_list<std::pair<K, T>> elems) {
+        init(elems.size());
+        *this = elems;
+    }
 
-typedef
-ecs_os_proc_t (*ecs_os_api_dlproc_t)(
-    ecs_os_dl_t lib,
-    const char *procname);
+    void operator=(std::initializer_list<std::pair<K, T>> elems) {
+        for (auto elem : elems) {
+            this->set(elem.first, elem.second);
+        }
+    }
 
-typedef
-void (*ecs_os_api_dlclose_t)(
-    ecs_os_dl_t lib);
+    void clear() {
+        ecs_map_clear(m_map);
+    }
 
-typedef
-char* (*ecs_os_api_module_to_path_t)(
-    const char *module_id);
+    int32_t count() {
+        return ecs_map_count(m_map);
+    }
 
-/* Prefix members of struct with 'ecs_' as some system headers may define 
- * macro's for functions like "strdup", "log" or "_free" */
+    void set(K& key, T& value) {
+        ecs_map_set(m_map, reinterpret_cast<ecs_map_key_t>(key), &value);
+    }
 
-typedef struct ecs_os_api_t {
-    /* API init / deinit */
-    ecs_os_api_init_t init_;
-    ecs_os_api_fini_t fini_;
+    T& get(K& key) {
+        *(T*)ecs_map_get(m_map, T, reinterpret_cast<ecs_map_key_t>(key));
+    }
 
-    /* Memory management */
-    ecs_os_api_malloc_t malloc_;
-    ecs_os_api_realloc_t realloc_;
-    ecs_os_api_calloc_t calloc_;
-    ecs_os_api_free_t free_;
+private:
+    void init(int32_t count) {
+        m_map = ecs_map_new(T, count);
+    }
 
-    /* Strings */
-    ecs_os_api_strdup_t strdup_;
-
-    /* Threads */
-    ecs_os_api_thread_new_t thread_new_;
-    ecs_os_api_thread_join_t thread_join_;
-
-    /* Atomic incremenet / decrement */
-    ecs_os_api_ainc_t ainc_;
-    ecs_os_api_ainc_t adec_;
-
-    /* Mutex */
-    ecs_os_api_mutex_new_t mutex_new_;
-    ecs_os_api_mutex_free_t mutex_free_;
-    ecs_os_api_mutex_lock_t mutex_lock_;
-    ecs_os_api_mutex_lock_t mutex_unlock_;
+    ecs_map_t *m_map;
+};
 
-    /* Condition variable */
-    ecs_os_api_cond_new_t cond_new_;
-    ecs_os_api_cond_free_t cond_free_;
-    ecs_os_api_cond_signal_t cond_signal_;
-    ecs_os_api_cond_broadcast_t cond_broadcast_;
-    ecs_os_api_cond_wait_t cond_wait_;
+}
 
-    /* Time */
-    ecs_os_api_sleep_t sleep_;
-    ecs_os_api_get_time_t get_time_;
+#endif
+#endif
 
-    /* Logging */
-    ecs_os_api_log_t log_;
-    ecs_os_api_log_t log_error_;
-    ecs_os_api_log_t log_debug_;
-    ecs_os_api_log_t log_warning_;
+#endif
+#ifndef FLECS_SWITCH_LIST_H
+#define FLECS_SWITCH_LIST_H
 
-    /* Application termination */
-    ecs_os_api_abort_t abort_;
 
-    /* Dynamic library loading */
-    ecs_os_api_dlopen_t dlopen_;
-    ecs_os_api_dlproc_t dlproc_;
-    ecs_os_api_dlclose_t dlclose_;
+typedef struct ecs_switch_header_t {
+    int32_t element;
+    int32_t count;
+} ecs_switch_header_t;
 
-    /* Overridable function that translates from a logical module id to a
-     * shared library filename */
-    ecs_os_api_module_to_path_t module_to_dl_;
+typedef struct ecs_switch_node_t {
+    int32_t next;
+    int32_t prev;
+} ecs_switch_node_t;
 
-    /* Overridable function that translates from a logical module id to a
-     * path that contains module-specif resources or assets */
-    ecs_os_api_module_to_path_t module_to_etc_;    
-} ecs_os_api_t;
+typedef struct ecs_switch_t {
+    uint64_t min;
+    uint64_t max;
+    ecs_switch_header_t *headers;
+    ecs_vector_t *nodes;
+    ecs_vector_t *values;
+} ecs_switch_t;
 
 FLECS_EXPORT
-extern ecs_os_api_t ecs_os_api;
+ecs_switch_t* ecs_switch_new(
+    uint64_t min, 
+    uint64_t max,
+    int32_t elements);
 
 FLECS_EXPORT
-void ecs_os_init(void);
+void ecs_switch_free(
+    ecs_switch_t *sw);
 
 FLECS_EXPORT
-void ecs_os_fini(void);
+void ecs_switch_add(
+    ecs_switch_t *sw);
 
 FLECS_EXPORT
-void ecs_os_set_api(
-    ecs_os_api_t *os_api);
+void ecs_switch_set_count(
+    ecs_switch_t *sw,
+    int32_t count);
 
 FLECS_EXPORT
-void ecs_os_set_api_defaults(void);
-
-/* Memory management */
-#define ecs_os_malloc(size) ecs_os_api.malloc_(size);
-#define ecs_os_free(ptr) ecs_os_api.free_(ptr);
-#define ecs_os_realloc(ptr, size) ecs_os_api.realloc_(ptr, size)
-#define ecs_os_calloc(size) ecs_os_api.calloc_(size)
-#if defined(_MSC_VER) || defined(__MINGW32__)
-#define ecs_os_alloca(size) _alloca((size_t)(size))
-#else
-#define ecs_os_alloca(size) alloca((size_t)(size))
-#endif
-
-/* Strings */
-#define ecs_os_strdup(str) ecs_os_api.strdup_(str)
-#define ecs_os_strlen(str) (ecs_size_t)strlen(str)
-#define ecs_os_strcmp(str1, str2) strcmp(str1, str2)
-#define ecs_os_strncmp(str1, str2, num) strncmp(str1, str2, (size_t)(num))
-#define ecs_os_memcmp(ptr1, ptr2, num) memcmp(ptr1, ptr2, (size_t)(num))
-#define ecs_os_memcpy(ptr1, ptr2, num) memcpy(ptr1, ptr2, (size_t)(num))
-#define ecs_os_memset(ptr, value, num) memset(ptr, value, (size_t)(num))
-
-#if defined(_MSC_VER)
-#define ecs_os_strcat(str1, str2) strcat_s(str1, INT_MAX, str2)
-#define ecs_os_sprintf(ptr, ...) sprintf_s(ptr, INT_MAX, __VA_ARGS__)
-#define ecs_os_vsprintf(ptr, fmt, args) vsprintf_s(ptr, INT_MAX, fmt, args)
-#define ecs_os_strcpy(str1, str2) strcpy_s(str1, INT_MAX, str2)
-#define ecs_os_strncpy(str1, str2, num) strncpy_s(str1, INT_MAX, str2, (size_t)(num))
-#else
-#define ecs_os_strcat(str1, str2) strcat(str1, str2)
-#define ecs_os_sprintf(ptr, ...) sprintf(ptr, __VA_ARGS__)
-#define ecs_os_vsprintf(ptr, fmt, args) vsprintf(ptr, fmt, args)
-#define ecs_os_strcpy(str1, str2) strcpy(str1, str2)
-#define ecs_os_strncpy(str1, str2, num) strncpy(str1, str2, (size_t)(num))
-#endif
-
-
-/* Threads */
-#define ecs_os_thread_new(callback, param) ecs_os_api.thread_new_(callback, param)
-#define ecs_os_thread_join(thread) ecs_os_api.thread_join_(thread)
+void ecs_switch_set_min_count(
+    ecs_switch_t *sw,
+    int32_t count);
 
-/* Atomic increment / decrement */
-#define ecs_os_ainc(value) ecs_os_api.ainc_(value)
-#define ecs_os_adec(value) ecs_os_api.adec_(value)
+FLECS_EXPORT
+void ecs_switch_addn(
+    ecs_switch_t *sw,
+    int32_t count);    
 
-/* Mutex */
-#define ecs_os_mutex_new() ecs_os_api.mutex_new_()
-#define ecs_os_mutex_free(mutex) ecs_os_api.mutex_free_(mutex)
-#define ecs_os_mutex_lock(mutex) ecs_os_api.mutex_lock_(mutex)
-#define ecs_os_mutex_unlock(mutex) ecs_os_api.mutex_unlock_(mutex)
+FLECS_EXPORT
+void ecs_switch_set(
+    ecs_switch_t *sw,
+    int32_t element,
+    uint64_t value);
 
-/* Condition variable */
-#define ecs_os_cond_new() ecs_os_api.cond_new_()
-#define ecs_os_cond_free(cond) ecs_os_api.cond_free_(cond)
-#define ecs_os_cond_signal(cond) ecs_os_api.cond_signal_(cond)
-#define ecs_os_cond_broadcast(cond) ecs_os_api.cond_broadcast_(cond)
-#define ecs_os_cond_wait(cond, mutex) ecs_os_api.cond_wait_(cond, mutex)
+FLECS_EXPORT
+void ecs_switch_remove(
+    ecs_switch_t *sw,
+    int32_t element);
 
-/* Time */
-#define ecs_os_sleep(sec, nanosec) ecs_os_api.sleep_(sec, nanosec)
-#define ecs_os_get_time(time_out) ecs_os_api.get_time_(time_out)
+FLECS_EXPORT
+uint64_t ecs_switch_get(
+    const ecs_switch_t *sw,
+    int32_t element);
 
-/* Logging (use functions to avoid using variadic macro arguments) */
 FLECS_EXPORT
-void ecs_os_log(const char *fmt, ...);
+ecs_vector_t* ecs_switch_values(
+    const ecs_switch_t *sw);    
 
 FLECS_EXPORT
-void ecs_os_warn(const char *fmt, ...);
+int32_t ecs_switch_case_count(
+    const ecs_switch_t *sw,
+    uint64_t value);
 
 FLECS_EXPORT
-void ecs_os_err(const char *fmt, ...);
+int32_t ecs_switch_first(
+    const ecs_switch_t *sw,
+    uint64_t value);
 
 FLECS_EXPORT
-void ecs_os_dbg(const char *fmt, ...);
+int32_t ecs_switch_next(
+    const ecs_switch_t *sw,
+    int32_t elem);
 
-/* Application termination */
-#define ecs_os_abort() ecs_os_api.abort_()
+#ifdef __cplusplus
+extern "C" {
+#endif
 
-/* Dynamic libraries */
-#define ecs_os_dlopen(libname) ecs_os_api.dlopen_(libname)
-#define ecs_os_dlproc(lib, procname) ecs_os_api.dlproc_(lib, procname)
-#define ecs_os_dlclose(lib) ecs_os_api.dlclose_(lib)
+#ifdef __cplusplus
+}
+#endif
 
-/* Module id translation */
-#define ecs_os_module_to_dl(lib) ecs_os_api.module_to_dl_(lib)
-#define ecs_os_module_to_etc(lib) ecs_os_api.module_to_etc_(lib)
+#endif
+#ifndef FLECS_BITSET_H
+#define FLECS_BITSET_H
 
-/* Sleep with floating point time */
-FLECS_EXPORT
-void ecs_sleepf(
-    double t);
 
-/* Measure time since provided timestamp */
-FLECS_EXPORT
-double ecs_time_measure(
-    ecs_time_t *start);
+#ifdef __cplusplus
+extern "C" {
+#endif
 
-/* Calculate difference between two timestamps */
+typedef struct ecs_bitset_t {
+    uint64_t *data;
+    int32_t count;
+    ecs_size_t size;
+} ecs_bitset_t;
+
+/** Initialize bitset. */
 FLECS_EXPORT
-ecs_time_t ecs_time_sub(
-    ecs_time_t t1,
-    ecs_time_t t2);
+void ecs_bitset_init(
+    ecs_bitset_t *bs);
 
-/* Convert time value to a double */
+/** Deinitialize bitset. */
 FLECS_EXPORT
-double ecs_time_to_double(
-    ecs_time_t t);
+void ecs_bitset_deinit(
+    ecs_bitset_t *bs);
 
+/** Add n elements to bitset. New elements are set to true. */
 FLECS_EXPORT
-void* ecs_os_memdup(
-    const void *src, 
-    ecs_size_t size);
+void ecs_bitset_addn(
+    ecs_bitset_t *bs,
+    int32_t count);
 
-/** Are heap functions available? */
+/** Ensure element exists. New elements are set to true. */
 FLECS_EXPORT
-bool ecs_os_has_heap(void);
+void ecs_bitset_ensure(
+    ecs_bitset_t *bs,
+    int32_t count);
 
-/** Are threading functions available? */
+/** Set element. */
 FLECS_EXPORT
-bool ecs_os_has_threading(void);
+void ecs_bitset_set(
+    ecs_bitset_t *bs,
+    int32_t elem,
+    bool value);
 
-/** Are time functions available? */
+/** Get element. */
 FLECS_EXPORT
-bool ecs_os_has_time(void);
+bool ecs_bitset_get(
+    const ecs_bitset_t *bs,
+    int32_t elem);
 
-/** Are logging functions available? */
+/** Return number of elements. */
 FLECS_EXPORT
-bool ecs_os_has_logging(void);
+int32_t ecs_bitset_count(
+    const ecs_bitset_t *bs);
 
-/** Are dynamic library functions available? */
+/** Remove from bitset. The last element is moved into the removed element. */
 FLECS_EXPORT
-bool ecs_os_has_dl(void);
+void ecs_bitset_remove(
+    ecs_bitset_t *bs,
+    int32_t elem);
 
-/** Are module path functions available? */
+/** Swap values in bitset. */
 FLECS_EXPORT
-bool ecs_os_has_modules(void);
+void ecs_bitset_swap(
+    ecs_bitset_t *bs,
+    int32_t elem_a,
+    int32_t elem_b);
 
 #ifdef __cplusplus
 }
 #endif
 
 #endif
+#ifndef FLECS_STRBUF_H_
+#define FLECS_STRBUF_H_
+
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define ECS_STRBUF_INIT (ecs_strbuf_t){0}
+#define ECS_STRBUF_ELEMENT_SIZE (511)
+#define ECS_STRBUF_MAX_LIST_DEPTH (32)
 
-/**
- * @defgroup api_types Basic API types
- * @{
+/* A buffer builds up a list of elements which individually can be up to N bytes
+ * large. While appending, data is added to these elements. More elements are
+ * added on the fly when needed. When an application calls ecs_strbuf_get, all
+ * elements are combined in one string and the element administration is freed.
+ *
+ * This approach prevents reallocs of large blocks of memory, and therefore
+ * copying large blocks of memory when appending to a large buffer. A buffer
+ * preallocates some memory for the element overhead so that for small strings
+ * there is hardly any overhead, while for large strings the overhead is offset
+ * by the reduced time spent on copying memory.
  */
 
-/** An entity identifier. */
-typedef uint64_t ecs_entity_t;
-
-/** A vector containing component identifiers used to describe a type. */
-typedef const ecs_vector_t* ecs_type_t;
-
-/** An ECS world is the container for all ECS data and supporting features. */
+typedef struct ecs_strbuf_element {
+    bool buffer_embedded;
+    int32_t pos;
+    char *buf;
+    struct ecs_strbuf_element *next;
+} ecs_strbuf_element;
+
+typedef struct ecs_strbuf_element_embedded {
+    ecs_strbuf_element super;
+    char buf[ECS_STRBUF_ELEMENT_SIZE + 1];
+} ecs_strbuf_element_embedded;
+
+typedef struct ecs_strbuf_element_str {
+    ecs_strbuf_element super;
+    char *alloc_str;
+} ecs_strbuf_element_str;
+
+typedef struct ecs_strbuf_list_elem {
+    int32_t count;
+    const char *separator;
+} ecs_strbuf_list_elem;
+
+typedef struct ecs_strbuf_t {
+    /* When set by an application, append will write to this buffer */
+    char *buf;
+
+    /* The maximum number of characters that may be printed */
+    int32_t max;
+
+    /* Size of elements minus current element */
+    int32_t size;
+
+    /* The number of elements in use */
+    int32_t elementCount;
+
+    /* Always allocate at least one element */
+    ecs_strbuf_element_embedded firstElement;
+
+    /* The current element being appended to */
+    ecs_strbuf_element *current;
+
+    /* Stack that keeps track of number of list elements, used for conditionally
+     * inserting a separator */
+    ecs_strbuf_list_elem list_stack[ECS_STRBUF_MAX_LIST_DEPTH];
+    int32_t list_sp;
+} ecs_strbuf_t;
+
+/* Append format string to a buffer.
+ * Returns false when max is reached, true when there is still space */
+FLECS_EXPORT
+bool ecs_strbuf_append(
+    ecs_strbuf_t *buffer,
+    const char *fmt,
+    ...);
+
+/* Append format string with argument list to a buffer.
+ * Returns false when max is reached, true when there is still space */
+FLECS_EXPORT
+bool ecs_strbuf_vappend(
+    ecs_strbuf_t *buffer,
+    const char *fmt,
+    va_list args);
+
+/* Append string to buffer.
+ * Returns false when max is reached, true when there is still space */
+FLECS_EXPORT
+bool ecs_strbuf_appendstr(
+    ecs_strbuf_t *buffer,
+    const char *str);
+
+/* Append source buffer to destination buffer.
+ * Returns false when max is reached, true when there is still space */
+FLECS_EXPORT
+bool ecs_strbuf_mergebuff(
+    ecs_strbuf_t *dst_buffer,
+    ecs_strbuf_t *src_buffer);
+
+/* Append string to buffer, transfer ownership to buffer.
+ * Returns false when max is reached, true when there is still space */
+FLECS_EXPORT
+bool ecs_strbuf_appendstr_zerocpy(
+    ecs_strbuf_t *buffer,
+    char *str);
+
+/* Append string to buffer, do not free/modify string.
+ * Returns false when max is reached, true when there is still space */
+FLECS_EXPORT
+bool ecs_strbuf_appendstr_zerocpy_const(
+    ecs_strbuf_t *buffer,
+    const char *str);
+
+/* Append n characters to buffer.
+ * Returns false when max is reached, true when there is still space */
+FLECS_EXPORT
+bool ecs_strbuf_appendstrn(
+    ecs_strbuf_t *buffer,
+    const char *str,
+    int32_t n);
+
+/* Return result string (also resets buffer) */
+FLECS_EXPORT
+char *ecs_strbuf_get(
+    ecs_strbuf_t *buffer);
+
+/* Reset buffer without returning a string */
+FLECS_EXPORT
+void ecs_strbuf_reset(
+    ecs_strbuf_t *buffer);
+
+/* Push a list */
+FLECS_EXPORT
+void ecs_strbuf_list_push(
+    ecs_strbuf_t *buffer,
+    const char *list_open,
+    const char *separator);
+
+/* Pop a new list */
+FLECS_EXPORT
+void ecs_strbuf_list_pop(
+    ecs_strbuf_t *buffer,
+    const char *list_close);
+
+/* Insert a new element in list */
+FLECS_EXPORT
+void ecs_strbuf_list_next(
+    ecs_strbuf_t *buffer);
+
+/* Append formatted string as a new element in list */
+FLECS_EXPORT
+bool ecs_strbuf_list_append(
+    ecs_strbuf_t *buffer,
+    const char *fmt,
+    ...);
+
+/* Append string as a new element in list */
+FLECS_EXPORT
+bool ecs_strbuf_list_appendstr(
+    ecs_strbuf_t *buffer,
+    const char *str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @defgroup api_types Basic API types
+ * @{
+ */
+
+/** An entity identifier. */
+typedef uint64_t ecs_entity_t;
+
+/** A vector containing component identifiers used to describe a type. */
+typedef const ecs_vector_t* ecs_type_t;
+
+/** An ECS world is the container for all ECS data and supporting features. */
 typedef struct ecs_world_t ecs_world_t;
 
 /** A snapshot stores the state of a world in a particular point in time. */
@@ -1870,6 +1996,23 @@ typedef struct ecs_filter_t {
     ecs_match_kind_t exclude_kind;  /**< Match kind for exclude components */
 } ecs_filter_t;
 
+/** Describes a field of a component that is stored as a structure of arrays. */
+typedef struct ecs_field_t {
+    ecs_size_t offset;              /**< Offset of the field in the component */
+    ecs_size_t size;                /**< Size of the field */
+} ecs_field_t;
+
+/** Describes the type of a key that is used to sort a query. */
+typedef enum ecs_sort_key_kind_t {
+    EcsSortKeyNone = 0,
+    EcsSortKeyI32,                  /**< int32_t key */
+    EcsSortKeyU32,                  /**< uint32_t key */
+    EcsSortKeyF32,                  /**< float key */
+    EcsSortKeyI64,                  /**< int64_t key */
+    EcsSortKeyU64,                  /**< uint64_t key */
+    EcsSortKeyF64                   /**< double key */
+} ecs_sort_key_kind_t;
+
 /** Type that contains various statistics of a world. */
 typedef struct ecs_world_info_t {
     ecs_entity_t last_component_id;   /**< Last issued component entity id */
@@ -1892,6 +2035,22 @@ typedef struct ecs_world_info_t {
     int32_t merge_count_total;  /**< Total number of merges */
     int32_t pipeline_build_count_total; /**< Total number of pipeline builds */
     int32_t systems_ran_frame;  /**< Total number of systems ran in last frame */
+
+    int32_t table_create_count_total; /**< Total number of tables created */
+    int32_t table_delete_count_total; /**< Total number of tables deleted */
+    int64_t table_move_count_total;   /**< Total number of entities moved between tables */
+    int64_t table_append_count_total; /**< Total number of rows appended to tables */
+    int64_t table_remove_count_total; /**< Total number of rows removed from tables */
+
+    int64_t defer_new_count_total;    /**< Total number of deferred new/clone operations */
+    int64_t defer_add_count_total;    /**< Total number of deferred add operations */
+    int64_t defer_remove_count_total; /**< Total number of deferred remove operations */
+    int64_t defer_set_count_total;    /**< Total number of deferred set/mut/modified operations */
+    int64_t defer_delete_count_total; /**< Total number of deferred delete/clear operations */
+    int64_t defer_flush_count_total;  /**< Total number of deferred operations executed */
+
+    int32_t rematch_count_total;      /**< Total number of query rematches */
+    int64_t monitor_eval_count_total; /**< Total number of component monitor evaluations */
 } ecs_world_info_t;
 
 /** @} */
@@ -2021,6 +2180,8 @@ typedef struct ecs_scope_iter_t {
     ecs_vector_t *tables;
     int32_t index;
     ecs_iter_table_t table;
+    ecs_entity_t parent;
+    ecs_map_iter_t children;    /* Children that store parent in EcsChildOf */
 } ecs_scope_iter_t;
 
 /** Filter-iterator specific data */
@@ -2038,6 +2199,8 @@ typedef struct ecs_query_iter_t {
     int32_t index;
     int32_t sparse_smallest;
     int32_t sparse_first;
+    int32_t bitset_first;
+    int32_t lookup_first;
 } ecs_query_iter_t;  
 
 /** Query-iterator specific data */
@@ -2068,6 +2231,7 @@ struct ecs_iter_t {
     ecs_entity_t *entities;       /**< Entity identifiers */
 
     void *param;                  /**< User data (EcsContext or param argument) */
+    void *ctx;                    /**< System context (EcsContext) */
     float delta_time;             /**< Time elapsed since last frame */
     float delta_system_time;      /**< Time elapsed since last system invocation */
     float world_time;             /**< Time elapsed since start of simulation */
@@ -2189,7 +2353,8 @@ extern ecs_type_t
     ecs_type(EcsComponent),
     ecs_type(EcsComponentLifecycle),
     ecs_type(EcsType),
-    ecs_type(EcsName);
+    ecs_type(EcsName),
+    ecs_type(EcsChildOf);
 
 /** This allows passing 0 as type to functions that accept types */
 #define FLECS__TNULL 0
@@ -2278,7 +2443,8 @@ bool ecs_component_has_actions(
 typedef enum ecs_sig_inout_kind_t {
     EcsInOut,
     EcsIn,
-    EcsOut
+    EcsOut,
+    EcsInPrev   /* Read value of double buffered component from last frame */
 } ecs_sig_inout_kind_t;
 
 /** Type that is used by systems to indicate where to fetch a component from */
@@ -2692,6 +2858,16 @@ typedef struct EcsName {
     char *alloc_value;     /**< If set, value will be freed on destruction */
 } EcsName;
 
+/** Component that stores the parent of an entity as a value.
+ * Unlike a CHILDOF relationship, the parent is not part of the entity type, so
+ * children of different parents can be stored in the same table. Children are
+ * found through a separate child index, which is used by ecs_scope_iter, 
+ * ecs_get_child_count, ecs_lookup_child and when the parent is deleted. Use
+ * ecs_set_parent to assign the parent. */
+typedef struct EcsChildOf {
+    ecs_entity_t parent;   /**< Parent entity */
+} EcsChildOf;
+
 /** Component information. */
 typedef struct EcsComponent {
     ecs_size_t size;           /**< Component size */
@@ -2789,6 +2965,11 @@ typedef struct EcsTrigger {
 /** Enforce ownership of a component */
 #define ECS_OWNED (ECS_ROLE | ((ecs_entity_t)0x75 << 56))
 
+/** Track whether a component is enabled or disabled per entity. Tables with
+ * DISABLED | Component in their type store a bitset for the component. Queries
+ * skip entities for which the component is disabled. */
+#define ECS_DISABLED (ECS_ROLE | ((ecs_entity_t)0x74 << 56))
+
 /** @} */
 
 /**
@@ -3157,6 +3338,90 @@ void ecs_set_component_actions_w_entity(
     ecs_set_component_actions_w_entity(world, ecs_typeid(component), &(EcsComponentLifecycle)__VA_ARGS__)
 
 #endif
+
+/** Store component in a sparse set instead of in tables.
+ * Components with sparse storage are stored in a sparse set that is indexed by
+ * entity id. Adding or removing a sparse component does not move the entity to
+ * another table, which makes it cheaper to frequently add and remove them.
+ *
+ * Sparse components are not part of the entity type. Queries match them per
+ * entity while iterating, and return entities with a sparse component one at a
+ * time. Triggers and OnSet systems are not invoked for sparse components, and
+ * sparse components are not stored in snapshots.
+ *
+ * This operation must be called before the component is added to entities.
+ *
+ * @param world The world.
+ * @param component The component to store in a sparse set.
+ */
+FLECS_EXPORT
+void ecs_set_component_sparse_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component);
+
+#define ecs_set_component_sparse(world, component)\
+    ecs_set_component_sparse_w_entity(world, ecs_typeid(component))
+
+/** Store component as a structure of arrays.
+ * A component with fields is stored in tables with one array per field, instead
+ * of one array of component values. This lets systems that only access a few
+ * fields of a large component iterate over contiguous memory.
+ *
+ * The fields of a structure of arrays component can be set with ecs_set, and
+ * are accessed with ecs_get_field and ecs_column_field. Because the component
+ * values are not stored contiguously, ecs_get, ecs_get_mut and ecs_column
+ * cannot be used with the component. Memory that is not covered by a field is
+ * not stored. Components with fields cannot have lifecycle actions.
+ *
+ * This operation must be called before the component is added to entities.
+ *
+ * @param world The world.
+ * @param component The component to store as a structure of arrays.
+ * @param fields Array with the fields of the component.
+ * @param count The number of fields.
+ */
+FLECS_EXPORT
+void ecs_set_component_fields_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    const ecs_field_t *fields,
+    int32_t count);
+
+#ifndef FLECS_LEGACY
+#define ECS_FIELD(T, member)\
+    { ECS_OFFSETOF(T, member), ECS_SIZEOF(((T*)0)->member) }
+
+#define ecs_set_component_fields(world, component, ...)\
+    ecs_set_component_fields_w_entity(world, ecs_typeid(component),\
+        (ecs_field_t[])__VA_ARGS__,\
+        (int32_t)(sizeof((ecs_field_t[])__VA_ARGS__) / sizeof(ecs_field_t)))
+#endif
+
+/** Keep a copy of component values from the previous frame.
+ * Tables store a second buffer for a double buffered component. At the end of
+ * ecs_progress, the values of the current frame are copied to this buffer. 
+ * Systems can read the previous frame values by annotating a column with 
+ * [prev], as in "[prev] Position". Because the buffer does not change while
+ * the frame is running, [prev] columns are read-only and never require a merge
+ * or synchronization point in the pipeline.
+ *
+ * Entities that got the component after the end of the last frame have a zero
+ * initialized previous value. Double buffered components cannot have 
+ * lifecycle actions, sparse storage or fields.
+ *
+ * This operation must be called before the component is added to entities.
+ *
+ * @param world The world.
+ * @param component The component to double buffer.
+ */
+FLECS_EXPORT
+void ecs_set_component_double_buffered_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component);
+
+#define ecs_set_component_double_buffered(world, component)\
+    ecs_set_component_double_buffered_w_entity(world, ecs_typeid(component))
+
 /** Set a world context.
  * This operation allows an application to register custom data with a world
  * that can be accessed anywhere where the application has the world object.
@@ -3219,6 +3484,38 @@ void ecs_dim_type(
     ecs_type_t type,
     int32_t entity_count);
 
+/** Enable garbage collection of empty tables.
+ * Tables are created for every combination of components that is added to an
+ * entity, and are by default not deleted until the world is deleted. When 
+ * table garbage collection is enabled, tables that have been empty for at least
+ * the specified number of frames are deleted at the end of a frame. Deleted 
+ * tables are removed from queries and from the table graph, and are recreated
+ * when needed.
+ *
+ * Applications should not enable table garbage collection while they hold
+ * snapshots, as snapshots refer to tables that may be deleted.
+ *
+ * @param world The world.
+ * @param empty_frames Number of frames a table must be empty (0 disables).
+ */
+FLECS_EXPORT
+void ecs_set_table_gc(
+    ecs_world_t *world,
+    int32_t empty_frames);
+
+/** Delete empty tables.
+ * This operation deletes tables that have been empty for the number of frames
+ * configured with ecs_set_table_gc. If table garbage collection is disabled,
+ * all empty tables are deleted. This operation may not be called while the
+ * world is progressing.
+ *
+ * @param world The world.
+ * @return The number of deleted tables.
+ */
+FLECS_EXPORT
+int32_t ecs_gc(
+    ecs_world_t *world);
+
 /** Set a range for issueing new entity ids.
  * This function constrains the entity identifiers returned by ecs_new to the 
  * specified range. This operation can be used to ensure that multiple processes
@@ -3316,6 +3613,56 @@ void ecs_begin_wait(
 void ecs_end_wait(
     ecs_world_t *world);
 
+/** Begin reading the world from a thread that does not run the frame.
+ * When locking is enabled, threads can read the world while it is being
+ * progressed, without waiting for the frame to end. Readers are admitted
+ * while systems run, and are only excluded while the world is merged. If the
+ * world is not readable, this function blocks until the next read epoch.
+ *
+ * A merge waits until all readers have invoked ecs_read_end, so data that is
+ * read by a thread is not moved or freed before the thread releases it.
+ * Readers may use operations that do not modify the world, such as ecs_get
+ * and iterating a query that was created beforehand. Component values can be
+ * written by systems while they are read. Queries that are iterated by readers
+ * should not use ecs_query_order_by, as sorting moves data in the tables.
+ * Sorted queries that are iterated by the thread that progresses the world are
+ * not sorted while the world is readable. Instead, their tables are sorted
+ * before the next read epoch begins, so that entities do not move while they
+ * are read.
+ *
+ * Iterating a query from a reader does not update its change detection state
+ * (see ecs_query_changed), so that readers do not modify the query.
+ *
+ * The world is readable from the start of ecs_progress until the merge at the
+ * end of the frame (or at the first merge point of the pipeline). A reader 
+ * that calls this function while the world is not readable blocks until the
+ * next call to ecs_progress begins a frame. If the world is not progressed, 
+ * the reader blocks indefinitely. Likewise, the merge blocks the thread that
+ * progresses the world until all readers have called ecs_read_end, so readers
+ * should hold on to the world for a short time only.
+ *
+ * Locking must be enabled before this function can be used. This function
+ * must not be called from the thread that progresses the world. It requires 
+ * a compiler that supports thread local storage.
+ *
+ * @param world The world.
+ * @return The read epoch, which is incremented each time the world becomes
+ *         readable.
+ */
+FLECS_EXPORT
+int32_t ecs_read_begin(
+    ecs_world_t *world);
+
+/** Release world after calling ecs_read_begin.
+ * A thread must release the world before the next merge can happen, so that
+ * readers do not stall the thread that progresses the world.
+ *
+ * @param world The world.
+ */
+FLECS_EXPORT
+void ecs_read_end(
+    ecs_world_t *world);
+
 /** Enable or disable tracing.
  * This will enable builtin tracing. For tracing to work, it will have to be
  * compiled in which requires defining one of the following macro's:
@@ -3744,6 +4091,51 @@ ecs_entity_t ecs_get_case(
     ecs_entity_t e,
     ecs_entity_t sw);
 
+/** Enable or disable component.
+ * Enabling or disabling a component does not add or remove a component from an
+ * entity, but prevents it from being matched with queries. This operation can
+ * be useful when a component must be temporarily disabled without destroying
+ * its value.
+ *
+ * The first time a component is disabled for an entity, DISABLED | component
+ * is added to the entity, which moves the entity to a table that stores a
+ * bitset for the component. After that, enabling or disabling the component
+ * only writes a bit, and does not move the entity between tables.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param component The component.
+ * @param enable True to enable the component, false to disable.
+ */
+FLECS_EXPORT
+void ecs_enable_component_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    bool enable);
+
+#define ecs_enable_component(world, entity, T, enable)\
+    ecs_enable_component_w_entity(world, entity, ecs_typeid(T), enable)
+
+/** Test if component is enabled.
+ * Test whether a component is currently enabled or disabled. This operation
+ * will return true when the entity has the component and if it has not been
+ * disabled by ecs_enable_component.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param component The component.
+ * @return True if the component is enabled, otherwise false.
+ */
+FLECS_EXPORT
+bool ecs_is_component_enabled_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component);
+
+#define ecs_is_component_enabled(world, entity, T)\
+    ecs_is_component_enabled_w_entity(world, entity, ecs_typeid(T))
+
 /** @} */
 
 /**
@@ -3824,9 +4216,38 @@ const void* ecs_get_w_entity(
 #define ecs_get(world, entity, component)\
     ((const component*)ecs_get_w_entity(world, entity, ecs_typeid(component)))
 
-/* -- Get cached pointer -- */
-
-/** Get an immutable reference to a component.
+/** Get an immutable pointer to a field of a component.
+ * This operation obtains a const pointer to a field of a component that is
+ * stored as a structure of arrays. See ecs_set_component_fields_w_entity.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param component The entity id of the component.
+ * @param field The index of the field.
+ * @return The field pointer, NULL if the entity does not have the component.
+ */
+FLECS_EXPORT
+const void* ecs_get_field_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    int32_t field);
+
+/** Get an immutable pointer to a field of a component.
+ * Same as ecs_get_field_w_entity, but accepts the typename of a component.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param component The component.
+ * @param field The index of the field.
+ * @return The field pointer, NULL if the entity does not have the component.
+ */
+#define ecs_get_field(world, entity, component, field)\
+    ecs_get_field_w_entity(world, entity, ecs_typeid(component), field)
+
+/* -- Get cached pointer -- */
+
+/** Get an immutable reference to a component.
  * This operation is similar to ecs_get_w_entity but it stores temporary
  * information in a `ecs_ref_t` value which allows subsequent lookups to be
  * faster.
@@ -4153,7 +4574,8 @@ size_t ecs_entity_str(
 /** Get the parent of an entity.
  * This will return a parent of the entity that has the specified component. If
  * the component is 0, the operation will return the first parent that it finds
- * in the entity type (an entity with a CHILDOF role).
+ * in the entity type (an entity with a CHILDOF role). If the entity has no 
+ * CHILDOF parent, the parent stored in EcsChildOf is returned.
  *
  * @param world The world.
  * @param entity The entity.
@@ -4545,6 +4967,11 @@ ecs_iter_t ecs_scope_iter_w_filter(
  * must have been initialized with `ecs_scope_iter`. This operation must be
  * invoked at least once before interpreting the contents of the iterator.
  *
+ * After the child tables of the parent have been iterated, the iterator 
+ * returns the children that store their parent in EcsChildOf. These children
+ * are returned one at a time, where it->offset is the row of the child in its
+ * table. Use ecs_table_column_w_offset to access their component data.
+ *
  * @param it The iterator
  * @return True if more data is available, false if not.
  */
@@ -4568,6 +4995,35 @@ ecs_entity_t ecs_set_scope(
     ecs_world_t *world,
     ecs_entity_t scope);
 
+/** Set the parent of an entity without changing its type.
+ * This operation stores the parent in the EcsChildOf component of the entity
+ * instead of adding a CHILDOF role to the entity type. Children of different
+ * parents that have the same components are therefore stored in the same 
+ * table, which avoids creating a table per parent for hierarchies with many
+ * small families.
+ *
+ * Children are registered with a child index that is used by ecs_scope_iter,
+ * ecs_get_child_count, ecs_lookup_child, ecs_get_path and ecs_delete_children.
+ * When the parent is deleted, its children are deleted as well. Queries cannot
+ * match components of parents with the CONTAINER modifier for these children.
+ *
+ * When a prefab has children that are stored this way, the children of its
+ * instances are also stored with EcsChildOf. Instantiating the prefab for many
+ * entities (for example with ecs_bulk_new_w_entity) then creates the children
+ * of all instances with one bulk insert per child table.
+ *
+ * Passing 0 for the parent removes the EcsChildOf component.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param parent The parent, or 0 to remove the parent.
+ */
+FLECS_EXPORT
+void ecs_set_parent(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t parent);
+
 /** Get the current scope.
  * Get the scope set by ecs_set_scope. If no scope is set, this operation will
  * return 0.
@@ -4807,7 +5263,9 @@ bool ecs_query_next_worker(
  * This enables sorting of entities across matched tables. As a result of this
  * operation, the order of entities in the matched tables may be changed. 
  * Resorting happens when a query iterator is obtained, and only if the table
- * data has changed.
+ * data has changed. If locking is enabled, tables are not resorted while the
+ * world is readable by other threads (see ecs_read_begin), but when the next
+ * frame or merge point begins.
  *
  * If multiple queries that match the same (sub)set of tables specify different 
  * sorting functions, resorting is likely to happen every time an iterator is
@@ -4830,6 +5288,31 @@ void ecs_query_order_by(
     ecs_entity_t component,
     ecs_compare_action_t compare);
 
+/** Sort the output of a query by a key in a component.
+ * This operation is similar to ecs_query_order_by, but instead of a compare
+ * function it accepts the type and offset of a numeric member of the component.
+ * Tables are sorted with a radix sort on the key, which runs in linear time and
+ * moves each row of a table only once. Entities with equal keys keep their
+ * relative order.
+ *
+ * @param world The world.
+ * @param query The query.
+ * @param component The component used to sort.
+ * @param kind The type of the key.
+ * @param offset The offset of the key in the component.
+ */
+FLECS_EXPORT
+void ecs_query_order_by_key(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_entity_t component,
+    ecs_sort_key_kind_t kind,
+    ecs_size_t offset);
+
+#define ecs_query_order_by_member(world, query, T, member, kind)\
+    ecs_query_order_by_key(world, query, ecs_typeid(T), kind,\
+        ECS_OFFSETOF(T, member))
+
 /** Group and sort matched tables.
  * Similar yo ecs_query_order_by, but instead of sorting individual entities, this
  * operation only sorts matched tables. This can be useful of a query needs to
@@ -4856,6 +5339,39 @@ void ecs_query_group_by(
     ecs_entity_t component,
     ecs_rank_type_action_t rank_action);
 
+/** Iterate the tables of a single group.
+ * This operation returns an iterator that only iterates the tables that were
+ * assigned the provided rank by the rank action of ecs_query_group_by. The 
+ * query keeps track of where the tables of each rank are stored, so the cost 
+ * of iterating a group depends only on the size of the group.
+ *
+ * The query must have a rank action. If no tables have the rank, the iterator
+ * does not return any results. The iterator is advanced with ecs_query_next.
+ *
+ * @param query The query to iterate.
+ * @param rank The rank of the tables to iterate.
+ * @return The query iterator.
+ */
+FLECS_EXPORT
+ecs_iter_t ecs_query_iter_group(
+    ecs_query_t *query,
+    int32_t rank);
+
+/** Iterate the tables of a range of groups.
+ * Same as ecs_query_iter_group, but iterates all tables with a rank in the
+ * range [rank_min, rank_max]. Tables are iterated in order of rank.
+ *
+ * @param query The query to iterate.
+ * @param rank_min The lowest rank of the tables to iterate.
+ * @param rank_max The highest rank of the tables to iterate.
+ * @return The query iterator.
+ */
+FLECS_EXPORT
+ecs_iter_t ecs_query_iter_group_range(
+    ecs_query_t *query,
+    int32_t rank_min,
+    int32_t rank_max);
+
 /** Returns whether the query data changed since the last iteration.
  * This operation must be invoked before obtaining the iterator, as this will
  * reset the changed state. The operation will return true after:
@@ -4929,6 +5445,42 @@ void* ecs_column_w_size(
 #define ecs_column(it, type, column)\
     ((type*)ecs_column_w_size(it, sizeof(type), column))
 
+/** Obtain field data.
+ * This operation obtains the array for a single field of a component that is
+ * stored as a structure of arrays. The column must be owned by the iterated
+ * entities. See ecs_set_component_fields_w_entity.
+ *
+ * This operation may return NULL if the column is optional, and the current
+ * table does not have the component.
+ *
+ * The provided size must match the size of the field, otherwise the function
+ * may fail.
+ *
+ * @param it The iterator.
+ * @param size The size of the field.
+ * @param column The index identifying the column in a signature.
+ * @param field The index of the field.
+ * @return A pointer to the field data.
+ */
+FLECS_EXPORT
+void* ecs_column_field_w_size(
+    const ecs_iter_t *it,
+    size_t size,
+    int32_t column,
+    int32_t field);
+
+/** Obtain field data.
+ * Same as ecs_column_field_w_size, but accepts the typename of the field.
+ *
+ * @param it The iterator.
+ * @param type The typename of the field.
+ * @param column The index identifying the column in a signature.
+ * @param field The index of the field.
+ * @return A pointer to the field data.
+ */
+#define ecs_column_field(it, type, column, field)\
+    ((type*)ecs_column_field_w_size(it, sizeof(type), column, field))
+
 /** Get column index by name.
  * This function obtains a column index by name. This function can only be used
  * if a query signature contains names.
@@ -5082,6 +5634,9 @@ ecs_type_t ecs_iter_type(
  * scenario where this would be used is when using a filter iterator, where
  * there is no signature, and thus ecs_column cannot be used.
  *
+ * The returned array starts at the first row of the table, regardless of the
+ * offset of the iterator.
+ *
  * @param it The iterator.
  * @param column The index identifying the column in a table.
  * @return The component array corresponding to the column index.
@@ -5091,6 +5646,21 @@ void* ecs_table_column(
     const ecs_iter_t *it,
     int32_t column);
 
+/** Get component array from table, starting at the iterator offset.
+ * Same as ecs_table_column, except that the returned array starts at the first
+ * entity of the iterator (it->offset), so that element i corresponds with 
+ * it->entities[i]. Use this operation for iterators that do not start at the 
+ * first row of a table, like the scope iterator for EcsChildOf children.
+ *
+ * @param it The iterator.
+ * @param column The index identifying the column in a table.
+ * @return The component array corresponding to the column index.
+ */
+FLECS_EXPORT
+void* ecs_table_column_w_offset(
+    const ecs_iter_t *it,
+    int32_t column);
+
 /** Get the size of a table column.
  *
  * @param it The iterator.
@@ -5592,6 +6162,36 @@ ecs_entity_t ecs_run_w_filter(
     const ecs_filter_t *filter,
     void *param);
 
+/** Set per-frame budget of a system.
+ * A system with a budget processes at most the specified number of entities, 
+ * or stops after the specified time has passed, when it is ran by the 
+ * pipeline. The next time the system runs, it resumes iterating at the entity 
+ * where the previous run stopped. When all matched entities have been 
+ * processed, the system starts again at the first entity. This spreads the work
+ * of expensive systems out over multiple frames.
+ *
+ * The time budget is evaluated after each batch of entities passed to the 
+ * system, so a single table may exceed it. Combine it with an entity budget to
+ * limit the size of a batch. Where the next run resumes is stored as an offset
+ * in the entities matched by the system, so entities may be skipped or visited 
+ * twice in a pass when entities are added or removed in the meantime.
+ *
+ * Budgets are not applied when the system is ran with ecs_run, or when it is
+ * ran on multiple threads. Setting a budget resets the system to the first 
+ * entity. Pass 0 for both budgets to remove the budget.
+ *
+ * @param world The world.
+ * @param system The system for which to set the budget.
+ * @param entity_budget The maximum number of entities per run, or 0.
+ * @param time_budget The maximum time in seconds per run, or 0.
+ */
+FLECS_EXPORT
+void ecs_set_system_budget(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    int32_t entity_budget,
+    float time_budget);
+
 /** System status change callback */
 typedef enum ecs_system_status_t {
     EcsSystemStatusNone = 0,
@@ -5860,6 +6460,33 @@ FLECS_EXPORT
 int32_t ecs_get_thread_index(
     ecs_world_t *world);
 
+/** Iterate a query in parallel.
+ * This operation splits the tables matched by the query into chunks of at most
+ * chunk_size entities, and invokes the action for each chunk. Chunks are
+ * processed by the calling thread and the worker threads started with
+ * ecs_set_threads. The operation returns when all chunks have been processed.
+ * When no worker threads are running, chunks are processed on the calling
+ * thread.
+ *
+ * The action may be invoked concurrently for different chunks. Operations
+ * that modify the world are deferred, and merged before the operation returns.
+ * The ecs_iter_t::world field contains the thread-specific world, and should be
+ * used for any operation invoked from the action.
+ *
+ * This operation may not be called while the world is progressing.
+ *
+ * @param query The query to iterate.
+ * @param action The action to invoke for each chunk.
+ * @param chunk_size The maximum number of entities per chunk.
+ * @param param User data passed to the action in ecs_iter_t::param.
+ */
+FLECS_EXPORT
+void ecs_query_par_iter(
+    ecs_query_t *query,
+    ecs_iter_action_t action,
+    int32_t chunk_size,
+    void *param);
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //// Module
@@ -5922,6 +6549,7 @@ typedef struct EcsRateFilter {
     int32_t rate;
     int32_t tick_count;
     float time_elapsed;   /* Time elapsed since last tick */
+    ecs_ref_t src_ref;    /* Cached reference to tick source of src */
 } EcsRateFilter;
 
 
@@ -6027,6 +6655,25 @@ void ecs_stop_timer(
     ecs_world_t *world,
     ecs_entity_t timer);
 
+/** Enable timing wheel for timers.
+ * By default every timer is visited each frame to increment its time. When the
+ * timing wheel is enabled, timers are stored in a hierarchical timing wheel and
+ * are only visited when they fire. This makes the cost of a frame depend on the
+ * number of timers that fire, instead of on the number of timers that exist.
+ *
+ * The wheel advances in steps of the provided resolution, and timeouts are 
+ * rounded up to a multiple of the resolution. While the wheel is enabled, the
+ * time member of EcsTimer is only updated when the timer fires. The timing 
+ * wheel cannot be disabled once it has been enabled.
+ *
+ * @param world The world.
+ * @param resolution The duration of a single step of the wheel, in seconds.
+ */
+FLECS_EXPORT
+void ecs_enable_timer_wheel(
+    ecs_world_t *world,
+    float resolution);
+
 /** Set rate filter.
  * This operation sets the source and rate for a rate filter. A rate filter
  * samples another tick source (or frames, if none provided) and ticks when the
@@ -6263,12 +6910,47 @@ typedef struct ecs_memory_stat_t {
     int32_t used_bytes;              /* Memory in use */
 } ecs_memory_stat_t;
 
+/* Number of samples in the rolling window of a latency statistic */
+#ifndef ECS_STAT_WINDOW_SIZE
+#define ECS_STAT_WINDOW_SIZE (128)
+#endif
+
+/* Number of buckets in the histogram of a latency statistic */
+#define ECS_STAT_HISTOGRAM_BUCKETS (20)
+
+/* Type to keep track of latencies over the last ECS_STAT_WINDOW_SIZE frames.
+ * Bucket 0 of the histogram counts samples below 1 microsecond, bucket N 
+ * counts samples between 2^(N-1) and 2^N microseconds. The last bucket counts
+ * all samples that do not fit in the other buckets. */
+typedef struct ecs_latency_stat_t {
+    float window[ECS_STAT_WINDOW_SIZE];     /* Samples (ring buffer) */
+    float sorted[ECS_STAT_WINDOW_SIZE];     /* Samples in window, sorted */
+    int32_t window_index;                   /* Next sample in window */
+    int32_t samples_count;                  /* Number of samples in window */
+    float p50_seconds;                      /* 50th percentile of samples */
+    float p95_seconds;                      /* 95th percentile of samples */
+    float p99_seconds;                      /* 99th percentile of samples */
+    float max_seconds;                      /* Largest sample */
+    int32_t histogram[ECS_STAT_HISTOGRAM_BUCKETS]; /* Samples per bucket */
+} ecs_latency_stat_t;
+
+/* Statistics on memory allocated by a single subsystem */
+typedef struct ecs_alloc_tag_stat_t {
+    int64_t allocd_bytes;            /* Memory currently allocated */
+    int64_t alloc_count_total;       /* Total number of allocations */
+    int64_t realloc_count_total;     /* Total number of reallocations */
+    int64_t free_count_total;        /* Total number of frees */
+    float alloc_rate;                /* Allocations per second */
+    float free_rate;                 /* Frees per second */
+} ecs_alloc_tag_stat_t;
+
 /* Global statistics on memory allocations */
 typedef struct EcsAllocStats {
     int64_t malloc_count_total;      /* Total number of times malloc was invoked */
     int64_t realloc_count_total;     /* Total number of times realloc was invoked */
     int64_t calloc_count_total;      /* Total number of times calloc was invoked */
     int64_t free_count_total;        /* Total number of times free was invoked */
+    ecs_alloc_tag_stat_t tags[EcsAllocTagCount]; /* Statistics per subsystem */
 } EcsAllocStats;
 
 /* Memory statistics on row (reactive) systems */
@@ -6322,6 +7004,7 @@ typedef struct EcsSystemStats {
     int32_t entities_matched_count;         /* Number of entities matched */
     int64_t invoke_count_total;            /* Number of times system got invoked */
     float seconds_total;                    /* Total time spent in system */
+    ecs_latency_stat_t latency;             /* Time spent in system per frame */
     bool is_enabled;                        /* Is system enabled */
     bool is_active;                         /* Is system active */
     bool is_hidden;                         /* Is system hidden */
@@ -6372,6 +7055,22 @@ typedef struct EcsWorldStats {
     double merge_seconds_total;            /* Total time spent merging */
     double world_seconds_total;            /* Total time passed since simulation start */
     double fps_hz;                         /* Frames per second (current) */
+    int32_t table_create_count_total;      /* Total number of tables created */
+    int32_t table_delete_count_total;      /* Total number of tables deleted */
+    int64_t table_move_count_total;        /* Total number of entities moved between tables */
+    int64_t table_append_count_total;      /* Total number of rows appended to tables */
+    int64_t table_remove_count_total;      /* Total number of rows removed from tables */
+    int64_t defer_new_count_total;         /* Total number of deferred new/clone operations */
+    int64_t defer_add_count_total;         /* Total number of deferred add operations */
+    int64_t defer_remove_count_total;      /* Total number of deferred remove operations */
+    int64_t defer_set_count_total;         /* Total number of deferred set/mut/modified operations */
+    int64_t defer_delete_count_total;      /* Total number of deferred delete/clear operations */
+    int64_t defer_flush_count_total;       /* Total number of deferred operations executed */
+    int32_t rematch_count_total;           /* Total number of query rematches */
+    int64_t monitor_eval_count_total;      /* Total number of component monitor evaluations */
+    ecs_latency_stat_t frame_latency;      /* Time spent per frame */
+    ecs_latency_stat_t system_latency;     /* Time spent in systems per frame */
+    ecs_latency_stat_t merge_latency;      /* Time spent merging per frame */
 } EcsWorldStats;
 
 /* Stats module component */
@@ -6862,16 +7561,378 @@ bool ecs_snapshot_next(
     ecs_iter_t *iter);
 
 
-/** Free snapshot resources.
- * This frees resources associated with a snapshot without restoring it.
+/** Free snapshot resources.
+ * This frees resources associated with a snapshot without restoring it.
+ *
+ * @param world The world.
+ * @param snapshot The snapshot to free. 
+ */
+FLECS_EXPORT
+void ecs_snapshot_free(
+    ecs_snapshot_t *snapshot);
+    
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
+#endif
+#ifdef FLECS_DIRECT_ACCESS
+
+/** Direct access API.
+ *
+ * This API allows for low-level direct access to tables and their columns. The
+ * APIs primary intent is to provide fast primitives for new operations. It is
+ * not recommended to use the API directly in application code, as invoking the
+ * API in an incorrect way can lead to a corrupted datastore.
+ */
+
+#ifdef FLECS_DIRECT_ACCESS
+
+#ifndef FLECS_DIRECT_ACCESS_H_
+#define FLECS_DIRECT_ACCESS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Find or create table with specified component string. 
+ * The provided string must be a comma-separated list of fully qualified 
+ * component identifiers. The returned table will have the specified components.
+ * Two lists that are the same but specify components in a different order will
+ * return the same table.
+ *
+ * @param world The world.
+ * @param type The components.
+ * @return The new or existing table, or NULL if the string contains an error.
+ */
+FLECS_EXPORT
+ecs_table_t* ecs_table_from_str(
+    ecs_world_t *world,
+    const char *type);
+
+/** Find or create table from type.
+ * Same as ecs_table_from_str, but provides the type directly.
+ *
+ * @param world The world.
+ * @param type The type.
+ * @return The new or existing table.
+ */
+FLECS_EXPORT
+ecs_table_t* ecs_table_from_type(
+    ecs_world_t *world,
+    ecs_type_t type);
+
+/** Get type for table.
+ *
+ * @param table The table.
+ * @return The type of the table.
+ */
+FLECS_EXPORT
+ecs_type_t ecs_table_get_type(
+    ecs_table_t *table);
+
+/** Insert record into table.
+ * This will create a new record for the table, which inserts a value for each
+ * component. An optional entity and record can be provided.
+ *
+ * If a non-zero entity id is provided, a record must also be provided and vice
+ * versa. The record must be created by the entity index. If the provided record 
+ * is not created for the specified entity, the behavior will be undefined.
+ *
+ * If the provided record is not managed by the entity index, the behavior will
+ * be undefined.
+ *
+ * The returned record contains a reference to the table and the table row. The
+ * data pointed to by the record is guaranteed not to move unless one or more
+ * rows are removed from this table. A row can be removed as result of a delete,
+ * or by adding/removing components from an entity stored in the table.
+ *
+ * @param world The world.
+ * @param table The table.
+ * @param entity The entity.
+ * @param record The entity-index record for the specified entity.
+ * @return A record containing the table and table row.
+ */
+FLECS_EXPORT
+ecs_record_t ecs_table_insert(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_entity_t entity,
+    ecs_record_t *record);
+
+/** Returns the number of records in the table. 
+ * This operation returns the number of records that have been populated through
+ * the regular (entity) API as well as the number of records that have been
+ * inserted using the direct access API.
+ *
+ * @param world The world.
+ * @param table The table.
+ * @return The number of records in a table.
+ */
+FLECS_EXPORT
+int32_t ecs_table_count(
+    ecs_table_t *table);
+
+/** Find the index of a column in a table.
+ * Table columns are stored in the order of their respective component ids. As
+ * this is not trivial for an application to deduce, this operation returns the
+ * index of a column in a table for a given component. This index can be used
+ * in other table operations to identify a column.
+ *
+ * The returned index is determined separately for each table. Indices obtained
+ * for one table should not be used for another table.
+ *
+ * @param table The table.
+ * @param component The component for which to retrieve the column index.
+ * @return The column index, or -1 if the table does not have the component.
+ */
+FLECS_EXPORT
+int32_t ecs_table_find_column(
+    ecs_table_t *table,
+    ecs_entity_t component);
+
+/** Get table column.
+ * This operation returns the pointer to a column array. A column contains all
+ * the data for a component for the provided table in a contiguous array.
+ *
+ * The returned pointer is not stable, and may change when a table needs to
+ * resize its arrays, for example in order to accomodate for more records.
+ *
+ * @param table The table.
+ * @param column The column index.
+ * @return Vector that contains the column array.
+ */
+FLECS_EXPORT
+ecs_vector_t* ecs_table_get_column(
+    ecs_table_t *table,
+    int32_t column);
+
+/** Set table column.
+ * This operation enables an application to set a component column for a table.
+ * After the operation the column is owned by the table. Any operations that
+ * change the column after this operation can cause undefined behavior.
+ *
+ * Care must be taken that all columns in a table have the same number of
+ * elements. If one column has less elements than another, the behavior is
+ * undefined. The operation will not check if the assigned column is of the same
+ * size as other columns, as this would prevent an application from assigning
+ * a set of different columns to a table of a different size.
+ *
+ * Setting a column will not delete the previous column. It is the 
+ * responsibility of the application to ensure that the old column is deleted
+ * properly (using ecs_table_delete_column).
+ *
+ * The provided vector must have the same element size and alignment as the
+ * target column. If the size and/or alignment do not match, the behavior will
+ * be undefined. In debug mode the operation may assert.
+ *
+ * @param world The world.
+ * @param table The table.
+ * @param column The column index.
+ * @param vector The column data to assing.
+ */
+FLECS_EXPORT
+void ecs_table_set_column(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    int32_t column,
+    ecs_vector_t *vector);
+
+/** Get the vector containing entity ids for the table.
+ * This operation obtains the vector with entity ids for the current table. Each
+ * entity id is associated with one record, and ids are stored in the same order
+ * as the table records. The element type of the vector is ecs_entity_t.
+ *
+ * @param table The table.
+ * @return The vector containing the table's entities.
+ */
+FLECS_EXPORT
+ecs_vector_t* ecs_table_get_entities(
+    ecs_table_t *table);
+
+/** Get the vector containing pointers to entity records.
+ * A table stores cached pointers to entity records for fast access. This 
+ * operation provides direct access to the vector. The element type of the
+ * vector is ecs_record_t*.
+ *
+ * @param table The table.
+ * @return The vector containing the entity records.
+ */ 
+FLECS_EXPORT
+ecs_vector_t* ecs_table_get_records(
+    ecs_table_t *table);
+
+/** Set the vector containing entity ids for the table.
+ * This operation sets the vector with entity ids for a table. In addition the
+ * operation also requires setting a vector with pointers to records. The
+ * record pointers in the vector need to be managed by the entity index. If they
+ * are not, this can cause undefined behavior.
+ *
+ * The provided vectors must have the same number of elements as the number of
+ * records in the table. If the element count is not the same, this causes
+ * undefined behavior.
+ *
+ * A table must have an entity and record vector, even if the table does not
+ * contain entities. For each record that is not an entity, the entity vector
+ * should contain 0, and the record vector should contain NULL.
+ *
+ * @param table The table.
+ * @param entities The entity vector.
+ * @param records The record vector.
+ */
+FLECS_EXPORT
+void ecs_table_set_entities(
+    ecs_table_t *table,
+    ecs_vector_t *entities,
+    ecs_vector_t *records);
+
+/** Delete a column.
+ * This operation frees the memory of a table column and will invoke the
+ * component destructor if registered.
+ *
+ * The provided vector does not need to be the same as the vector in the table.
+ * The reason the table must be provided is so that the operation can retrieve
+ * the correct destructor for the component. If the component does not have a
+ * destructor, an application can alternatively delete the vector directly.
+ *
+ * If the specified vector is NULL, the column of the table will be removed and
+ * the table will be updated to no longer point at the column. If an explicit
+ * column is provided, the table is not modified. If a column is deleted that is
+ * still being pointed to by a table, behavior is undefined. It is the
+ * responsibility of the application to ensure that a table no longer points to
+ * a deleted column, by using ecs_table_set_column.
+ *
+ * Simultaneously, if this operation is used to delete a table column, the
+ * application should make sure that if the table contains other columns, they
+ * are either also deleted, or that the deleted column is replaced by a column
+ * of the same size. Note that this also goes for the entity and record vectors,
+ * they should have the same number of elements as the other columns.
+ *
+ * The vector must be of the same component as the specified column. If the
+ * vector is not of the same component, behavior will be undefined. In debug
+ * mode the API may assert, though it may not always be able to detect a
+ * mismatching vector/column.
+ *
+ * After this operation the vector should no longer be used by the application.
+ *
+ * @param table The table.
+ * @param column The column index.
+ * @param vector The column vector to delete.
+ */
+FLECS_EXPORT
+void ecs_table_delete_column(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    int32_t column,
+    ecs_vector_t *vector);
+
+/** Find a record for a given entity.
+ * This operation finds an existing record in the entity index for a given
+ * entity. The returned pointer is stable for the lifecycle of the world and can
+ * be used as argument for the ecs_record_update operation.
+ *
+ * The returned record (if found) points to the adminstration that relates an
+ * entity id to a table. Updating the value of the returned record will cause
+ * operations like ecs_get and ecs_has to look in the updated table.
+ *
+ * Updating this record to a table in which the entity is not stored causes
+ * undefined behavior.
+ *
+ * When the entity has never been created or is not alive this operation will
+ * return NULL.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @return The record that belongs to the entity, or NULL if not found.
+ */
+FLECS_EXPORT
+ecs_record_t* ecs_record_find(
+    ecs_world_t *world,
+    ecs_entity_t entity);
+
+/** Get value from record.
+ * This operation gets a component value from a record. The provided column
+ * index must match the table of the record.
+ *
+ * @param r The record.
+ * @param column The column index of the component to get.
+ */ 
+FLECS_EXPORT
+void* ecs_record_get_column(
+    ecs_record_t *r,
+    int32_t column,
+    size_t size);
+
+/** Copy value to a component for a record.
+ * This operation sets the component value of a single component for a record.
+ * If the component type has a copy action it will be used, otherwise the value
+ * be memcpyd into the component array.
+ *
+ * The provided record does not need to be managed by the entity index but does
+ * need to point to a valid record in the table. If the provided index is
+ * outside of the range indicating the number of records in the table, behavior
+ * is undefined. In debug mode it will cause the operation to assert.
+ *
+ * @param world The world.
+ * @param r The record to set.
+ * @param column The column index of the component to set.
+ * @param size The size of the component.
+ * @param value Pointer to the value to copy.
+ */
+FLECS_EXPORT
+void ecs_record_copy_to(
+    ecs_world_t *world,
+    ecs_record_t *r,
+    int32_t column,
+    size_t size,
+    const void *value,
+    int32_t count);
+
+/** Memcpy value to a component for a record.
+ * Same as ecs_record_copy_to, except that this operation will always use
+ * memcpy. This operation should only be used for components that can be safely
+ * memcpyd. If the operation is used for a component that has a copy or move
+ * action, the behavior is undefined. In debug mode the operation may assert.
+ *
+ * @param world The world.
+ * @param r The record to set.
+ * @param column The column index of the component to set.
+ * @param size The size of the component.
+ * @param value Pointer to the value to move. 
+ */
+FLECS_EXPORT
+void ecs_record_copy_pod_to(
+    ecs_world_t *world,
+    ecs_record_t *r,
+    int32_t column,
+    size_t size,
+    const void *value,
+    int32_t count);
+
+/** Move value to a component for a record.
+ * Same as ecs_record_copy_to, except that it uses the move action. If the 
+ * component has no move action the value will be memcpyd into the component 
+ * array. After this operation the application can no longer assume that the 
+ * value passed into the function is valid.
  *
  * @param world The world.
- * @param snapshot The snapshot to free. 
+ * @param r The record to set.
+ * @param column The column index of the component to set.
+ * @param size The size of the component.
+ * @param value Pointer to the value to move.
  */
 FLECS_EXPORT
-void ecs_snapshot_free(
-    ecs_snapshot_t *snapshot);
-    
+void ecs_record_move_to(
+    ecs_world_t *world,
+    ecs_record_t *r,
+    int32_t column,
+    size_t size,
+    void *value,
+    int32_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6880,359 +7941,493 @@ void ecs_snapshot_free(
 
 #endif
 #endif
-#ifdef FLECS_DIRECT_ACCESS
+#ifdef FLECS_PROFILER
+#ifdef FLECS_PROFILER
 
-/** Direct access API.
+/**
+ * @file profiler.h
+ * @brief Profiler API.
  *
- * This API allows for low-level direct access to tables and their columns. The
- * APIs primary intent is to provide fast primitives for new operations. It is
- * not recommended to use the API directly in application code, as invoking the
- * API in an incorrect way can lead to a corrupted datastore.
+ * The profiler records timestamped spans for frames, systems, merges, sync
+ * points, deferred flushes, pipeline rebuilds and table creation. Spans are
+ * written to a fixed-size ring buffer per thread, so recording does not
+ * require locks. Recorded spans can be exported in the Chrome trace event
+ * format, which can be loaded in chrome://tracing or ui.perfetto.dev.
+ *
+ * The profiler is disabled by default. When disabled, the cost of a span is a
+ * single pointer check.
  */
 
-#ifdef FLECS_DIRECT_ACCESS
-
-#ifndef FLECS_DIRECT_ACCESS_H_
-#define FLECS_DIRECT_ACCESS_H_
+#ifndef FLECS_PROFILER_H
+#define FLECS_PROFILER_H
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/** Find or create table with specified component string. 
- * The provided string must be a comma-separated list of fully qualified 
- * component identifiers. The returned table will have the specified components.
- * Two lists that are the same but specify components in a different order will
- * return the same table.
+/** Kinds of spans recorded by the profiler. */
+typedef enum ecs_span_kind_t {
+    EcsSpanFrame,               /**< Frame (ecs_frame_begin - ecs_frame_end) */
+    EcsSpanSystem,              /**< System invocation */
+    EcsSpanMerge,               /**< Merge of stages */
+    EcsSpanSync,                /**< Main thread waiting on worker threads */
+    EcsSpanDeferFlush,          /**< Flush of deferred operations */
+    EcsSpanPipelineBuild,       /**< Rebuild of pipeline */
+    EcsSpanTableCreate          /**< Creation of a new table */
+} ecs_span_kind_t;
+
+/** A single recorded span. */
+typedef struct ecs_span_t {
+    ecs_span_kind_t kind;       /**< Span kind */
+    int32_t thread;             /**< Thread index (0 is the main thread) */
+    ecs_entity_t id;            /**< System, pipeline or table id */
+    uint64_t start;             /**< Start in ns since profiler was enabled */
+    uint64_t duration;          /**< Duration in nanoseconds */
+} ecs_span_t;
+
+/** Enable or disable the profiler.
+ * When enabled, the profiler allocates a ring buffer per thread that can hold
+ * the specified number of spans. When a ring buffer is full, the oldest spans
+ * are overwritten. Passing 0 for span_count disables the profiler and frees
+ * all recorded spans.
+ *
+ * This operation may not be called while the world is progressing.
  *
  * @param world The world.
- * @param type The components.
- * @return The new or existing table, or NULL if the string contains an error.
+ * @param span_count The number of spans per thread (rounded up to power of 2).
  */
 FLECS_EXPORT
-ecs_table_t* ecs_table_from_str(
+void ecs_profiler_enable(
     ecs_world_t *world,
-    const char *type);
+    int32_t span_count);
 
-/** Find or create table from type.
- * Same as ecs_table_from_str, but provides the type directly.
+/** Test whether the profiler is enabled.
  *
  * @param world The world.
- * @param type The type.
- * @return The new or existing table.
+ * @return True if enabled, false if not.
  */
 FLECS_EXPORT
-ecs_table_t* ecs_table_from_type(
-    ecs_world_t *world,
-    ecs_type_t type);
+bool ecs_profiler_is_enabled(
+    ecs_world_t *world);
 
-/** Get type for table.
+/** Discard all recorded spans.
  *
- * @param table The table.
- * @return The type of the table.
+ * @param world The world.
  */
 FLECS_EXPORT
-ecs_type_t ecs_table_get_type(
-    ecs_table_t *table);
+void ecs_profiler_clear(
+    ecs_world_t *world);
 
-/** Insert record into table.
- * This will create a new record for the table, which inserts a value for each
- * component. An optional entity and record can be provided.
- *
- * If a non-zero entity id is provided, a record must also be provided and vice
- * versa. The record must be created by the entity index. If the provided record 
- * is not created for the specified entity, the behavior will be undefined.
- *
- * If the provided record is not managed by the entity index, the behavior will
- * be undefined.
- *
- * The returned record contains a reference to the table and the table row. The
- * data pointed to by the record is guaranteed not to move unless one or more
- * rows are removed from this table. A row can be removed as result of a delete,
- * or by adding/removing components from an entity stored in the table.
+/** Return number of threads for which spans are recorded.
+ * The main thread has index 0, worker threads start at index 1.
  *
  * @param world The world.
- * @param table The table.
- * @param entity The entity.
- * @param record The entity-index record for the specified entity.
- * @return A record containing the table and table row.
+ * @return The number of threads.
  */
 FLECS_EXPORT
-ecs_record_t ecs_table_insert(
-    ecs_world_t *world,
-    ecs_table_t *table,
-    ecs_entity_t entity,
-    ecs_record_t *record);
+int32_t ecs_profiler_thread_count(
+    ecs_world_t *world);
 
-/** Returns the number of records in the table. 
- * This operation returns the number of records that have been populated through
- * the regular (entity) API as well as the number of records that have been
- * inserted using the direct access API.
+/** Return number of spans currently stored for a thread.
  *
  * @param world The world.
- * @param table The table.
- * @return The number of records in a table.
+ * @param thread The thread index.
+ * @return The number of spans stored in the ring buffer of the thread.
  */
 FLECS_EXPORT
-int32_t ecs_table_count(
-    ecs_table_t *table);
+int32_t ecs_profiler_span_count(
+    ecs_world_t *world,
+    int32_t thread);
 
-/** Find the index of a column in a table.
- * Table columns are stored in the order of their respective component ids. As
- * this is not trivial for an application to deduce, this operation returns the
- * index of a column in a table for a given component. This index can be used
- * in other table operations to identify a column.
- *
- * The returned index is determined separately for each table. Indices obtained
- * for one table should not be used for another table.
+/** Get span for thread.
+ * Spans are returned in the order in which they were recorded, where index 0
+ * is the oldest span that is still in the ring buffer.
  *
- * @param table The table.
- * @param component The component for which to retrieve the column index.
- * @return The column index, or -1 if the table does not have the component.
+ * @param world The world.
+ * @param thread The thread index.
+ * @param index The index of the span.
+ * @return The span, or NULL if the index is out of range.
  */
 FLECS_EXPORT
-int32_t ecs_table_find_column(
-    ecs_table_t *table,
-    ecs_entity_t component);
+const ecs_span_t* ecs_profiler_get_span(
+    ecs_world_t *world,
+    int32_t thread,
+    int32_t index);
 
-/** Get table column.
- * This operation returns the pointer to a column array. A column contains all
- * the data for a component for the provided table in a contiguous array.
- *
- * The returned pointer is not stable, and may change when a table needs to
- * resize its arrays, for example in order to accomodate for more records.
+/** Export recorded spans as Chrome trace JSON.
+ * The returned string must be freed with ecs_os_free.
  *
- * @param table The table.
- * @param column The column index.
- * @return Vector that contains the column array.
+ * @param world The world.
+ * @return A JSON string in the Chrome trace event format.
  */
 FLECS_EXPORT
-ecs_vector_t* ecs_table_get_column(
-    ecs_table_t *table,
-    int32_t column);
+char* ecs_profiler_to_json(
+    ecs_world_t *world);
 
-/** Set table column.
- * This operation enables an application to set a component column for a table.
- * After the operation the column is owned by the table. Any operations that
- * change the column after this operation can cause undefined behavior.
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
+#endif
+#ifdef FLECS_COMMAND_QUEUE
+#ifdef FLECS_COMMAND_QUEUE
+
+/**
+ * @file command_queue.h
+ * @brief Command queue API.
  *
- * Care must be taken that all columns in a table have the same number of
- * elements. If one column has less elements than another, the behavior is
- * undefined. The operation will not check if the assigned column is of the same
- * size as other columns, as this would prevent an application from assigning
- * a set of different columns to a table of a different size.
+ * A command queue lets threads that do not own the world enqueue operations
+ * for the world, such as adding, removing and setting components. Enqueueing
+ * a command does not take a lock. Commands are stored in a fixed-size ring
+ * buffer, where each producer claims a slot with an atomic increment.
  *
- * Setting a column will not delete the previous column. It is the 
- * responsibility of the application to ensure that the old column is deleted
- * properly (using ecs_table_delete_column).
+ * Commands are applied to the world at the start of each frame, before the
+ * pipeline runs. They are applied in the order in which slots were claimed,
+ * using the same mechanism as deferred operations.
+ */
+
+#ifndef FLECS_COMMAND_QUEUE_H
+#define FLECS_COMMAND_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ecs_command_queue_t ecs_command_queue_t;
+
+/** Create a command queue.
+ * The queue can hold the specified number of commands, rounded up to a power
+ * of 2. When the queue is full, producers wait until the world has applied
+ * the pending commands.
  *
- * The provided vector must have the same element size and alignment as the
- * target column. If the size and/or alignment do not match, the behavior will
- * be undefined. In debug mode the operation may assert.
+ * This operation must be called from the thread that owns the world, and may
+ * not be called while the world is progressing.
  *
  * @param world The world.
- * @param table The table.
- * @param column The column index.
- * @param vector The column data to assing.
+ * @param capacity The number of commands the queue can hold.
+ * @return The new command queue.
  */
 FLECS_EXPORT
-void ecs_table_set_column(
+ecs_command_queue_t* ecs_command_queue_new(
     ecs_world_t *world,
-    ecs_table_t *table,
-    int32_t column,
-    ecs_vector_t *vector);
+    int32_t capacity);
 
-/** Get the vector containing entity ids for the table.
- * This operation obtains the vector with entity ids for the current table. Each
- * entity id is associated with one record, and ids are stored in the same order
- * as the table records. The element type of the vector is ecs_entity_t.
+/** Free a command queue.
+ * Commands that have not been applied to the world are discarded. Queues that
+ * are not freed by the application are freed when the world is deleted.
  *
- * @param table The table.
- * @return The vector containing the table's entities.
+ * @param queue The queue to free.
  */
 FLECS_EXPORT
-ecs_vector_t* ecs_table_get_entities(
-    ecs_table_t *table);
+void ecs_command_queue_free(
+    ecs_command_queue_t *queue);
 
-/** Get the vector containing pointers to entity records.
- * A table stores cached pointers to entity records for fast access. This 
- * operation provides direct access to the vector. The element type of the
- * vector is ecs_record_t*.
+/** Apply enqueued commands to the world.
+ * This operation is invoked at the start of each frame. Applications can use
+ * it to apply commands outside of the main loop.
  *
- * @param table The table.
- * @return The vector containing the entity records.
- */ 
+ * @param queue The queue to flush.
+ * @return The number of commands that were applied.
+ */
 FLECS_EXPORT
-ecs_vector_t* ecs_table_get_records(
-    ecs_table_t *table);
+int32_t ecs_command_queue_flush(
+    ecs_command_queue_t *queue);
 
-/** Set the vector containing entity ids for the table.
- * This operation sets the vector with entity ids for a table. In addition the
- * operation also requires setting a vector with pointers to records. The
- * record pointers in the vector need to be managed by the entity index. If they
- * are not, this can cause undefined behavior.
- *
- * The provided vectors must have the same number of elements as the number of
- * records in the table. If the element count is not the same, this causes
- * undefined behavior.
+/** Enqueue adding an entity to an entity.
+ * This operation can be called from any thread.
  *
- * A table must have an entity and record vector, even if the table does not
- * contain entities. For each record that is not an entity, the entity vector
- * should contain 0, and the record vector should contain NULL.
+ * @param queue The queue.
+ * @param entity The entity to add to.
+ * @param to_add The entity to add.
+ */
+FLECS_EXPORT
+void ecs_command_add_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t to_add);
+
+/** Enqueue removing an entity from an entity.
+ * This operation can be called from any thread.
  *
- * @param table The table.
- * @param entities The entity vector.
- * @param records The record vector.
+ * @param queue The queue.
+ * @param entity The entity to remove from.
+ * @param to_remove The entity to remove.
  */
 FLECS_EXPORT
-void ecs_table_set_entities(
-    ecs_table_t *table,
-    ecs_vector_t *entities,
-    ecs_vector_t *records);
+void ecs_command_remove_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t to_remove);
 
-/** Delete a column.
- * This operation frees the memory of a table column and will invoke the
- * component destructor if registered.
+/** Enqueue setting the value of a component.
+ * The value is copied into the queue with memcpy. This operation can be called
+ * from any thread.
  *
- * The provided vector does not need to be the same as the vector in the table.
- * The reason the table must be provided is so that the operation can retrieve
- * the correct destructor for the component. If the component does not have a
- * destructor, an application can alternatively delete the vector directly.
+ * @param queue The queue.
+ * @param entity The entity to set the component on.
+ * @param component The component to set.
+ * @param size The size of the component value.
+ * @param ptr Pointer to the component value.
+ */
+FLECS_EXPORT
+void ecs_command_set_ptr_w_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    size_t size,
+    const void *ptr);
+
+/** Enqueue deleting an entity.
+ * This operation can be called from any thread.
  *
- * If the specified vector is NULL, the column of the table will be removed and
- * the table will be updated to no longer point at the column. If an explicit
- * column is provided, the table is not modified. If a column is deleted that is
- * still being pointed to by a table, behavior is undefined. It is the
- * responsibility of the application to ensure that a table no longer points to
- * a deleted column, by using ecs_table_set_column.
+ * @param queue The queue.
+ * @param entity The entity to delete.
+ */
+FLECS_EXPORT
+void ecs_command_delete(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity);
+
+#define ecs_command_add(queue, entity, T)\
+    ecs_command_add_entity(queue, entity, ecs_typeid(T))
+
+#define ecs_command_remove(queue, entity, T)\
+    ecs_command_remove_entity(queue, entity, ecs_typeid(T))
+
+#define ecs_command_set(queue, entity, T, ...)\
+    ecs_command_set_ptr_w_entity(queue, entity, ecs_typeid(T), sizeof(T),\
+        &(T)__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
+#endif
+#ifdef FLECS_SPATIAL
+#ifdef FLECS_SPATIAL
+
+/**
+ * @file spatial.h
+ * @brief Spatial index API.
  *
- * Simultaneously, if this operation is used to delete a table column, the
- * application should make sure that if the table contains other columns, they
- * are either also deleted, or that the deleted column is replaced by a column
- * of the same size. Note that this also goes for the entity and record vectors,
- * they should have the same number of elements as the other columns.
+ * A spatial index stores the entities that have a component with a position in
+ * a uniform hash grid, so that box and radius queries only visit the cells that
+ * overlap with the queried region. The position is read from two or three float
+ * members of the component, which are specified by their offset.
  *
- * The vector must be of the same component as the specified column. If the
- * vector is not of the same component, behavior will be undefined. In debug
- * mode the API may assert, though it may not always be able to detect a
- * mismatching vector/column.
+ * The index is updated incrementally by an OnSet and an UnSet system for the
+ * component. An entity is inserted or moved when the component is set with
+ * ecs_set or when ecs_modified is called, and is removed when the component is
+ * removed or when the entity is deleted. Entities are only moved to another
+ * cell when their position crosses a cell boundary. Components that are added
+ * without being set, and components that are shared, are not indexed.
+ */
+
+#ifndef FLECS_SPATIAL_H
+#define FLECS_SPATIAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ecs_spatial_t ecs_spatial_t;
+
+/** Spatial query iterator.
+ * Each call to ecs_spatial_next yields the matching entities of a single cell.
+ * An iterator is invalidated when the index is updated.
+ */
+typedef struct ecs_spatial_iter_t {
+    const ecs_entity_t *entities; /* Entities in the current batch */
+    int32_t count;                /* Number of entities in the current batch */
+
+    /* Private */
+    ecs_spatial_t *index;
+    float min[3];                 /* Bounds of queried region */
+    float max[3];
+    float center[3];              /* Center of radius query */
+    float radius;                 /* Radius (0 for box query) */
+    int32_t cell_min[3];          /* Range of cells that overlap region */
+    int32_t cell_max[3];
+    int32_t cell[3];              /* Next cell to visit */
+    ecs_map_iter_t cells_iter;    /* Used when region has more cells than grid */
+    bool walk_cells;              /* Iterate grid instead of cell range */
+    ecs_vector_t *buffer;         /* Entities of partially overlapping cell */
+} ecs_spatial_iter_t;
+
+/** Create a spatial index.
+ * The index is populated with the entities for which the component has been
+ * set, and is kept up to date as the component is set, modified or removed.
+ * Position members must be of type float. For a 2D index, pass -1 for the
+ * z offset.
  *
- * After this operation the vector should no longer be used by the application.
+ * This operation may not be called while the world is progressing.
  *
- * @param table The table.
- * @param column The column index.
- * @param vector The column vector to delete.
+ * @param world The world.
+ * @param component The component that stores the position.
+ * @param x_offset The offset of the x member in the component.
+ * @param y_offset The offset of the y member in the component.
+ * @param z_offset The offset of the z member in the component, or -1.
+ * @param cell_size The size of a grid cell.
+ * @return The new spatial index.
  */
 FLECS_EXPORT
-void ecs_table_delete_column(
+ecs_spatial_t* ecs_spatial_new_w_entity(
     ecs_world_t *world,
-    ecs_table_t *table,
-    int32_t column,
-    ecs_vector_t *vector);
+    ecs_entity_t component,
+    ecs_size_t x_offset,
+    ecs_size_t y_offset,
+    ecs_size_t z_offset,
+    float cell_size);
 
-/** Find a record for a given entity.
- * This operation finds an existing record in the entity index for a given
- * entity. The returned pointer is stable for the lifecycle of the world and can
- * be used as argument for the ecs_record_update operation.
- *
- * The returned record (if found) points to the adminstration that relates an
- * entity id to a table. Updating the value of the returned record will cause
- * operations like ecs_get and ecs_has to look in the updated table.
- *
- * Updating this record to a table in which the entity is not stored causes
- * undefined behavior.
+#define ecs_spatial_new(world, T, x, y, cell_size)\
+    ecs_spatial_new_w_entity(world, ecs_typeid(T),\
+        ECS_OFFSETOF(T, x), ECS_OFFSETOF(T, y), -1, cell_size)
+
+#define ecs_spatial_new_3d(world, T, x, y, z, cell_size)\
+    ecs_spatial_new_w_entity(world, ecs_typeid(T),\
+        ECS_OFFSETOF(T, x), ECS_OFFSETOF(T, y), ECS_OFFSETOF(T, z), cell_size)
+
+/** Free a spatial index.
+ * This deletes the systems that keep the index up to date. Indices that are not
+ * freed by the application are freed when the world is deleted.
  *
- * When the entity has never been created or is not alive this operation will
- * return NULL.
+ * @param index The index to free.
+ */
+FLECS_EXPORT
+void ecs_spatial_free(
+    ecs_spatial_t *index);
+
+/** Return number of entities in a spatial index.
  *
- * @param world The world.
- * @param entity The entity.
- * @return The record that belongs to the entity, or NULL if not found.
+ * @param index The index.
+ * @return The number of indexed entities.
  */
 FLECS_EXPORT
-ecs_record_t* ecs_record_find(
-    ecs_world_t *world,
-    ecs_entity_t entity);
+int32_t ecs_spatial_count(
+    const ecs_spatial_t *index);
 
-/** Get value from record.
- * This operation gets a component value from a record. The provided column
- * index must match the table of the record.
+/** Find entities in a box.
+ * The min and max arrays contain 2 elements for a 2D index, and 3 elements for
+ * a 3D index. Entities on the boundary of the box are included.
  *
- * @param r The record.
- * @param column The column index of the component to get.
- */ 
+ * @param index The index.
+ * @param min The lower bounds of the box.
+ * @param max The upper bounds of the box.
+ * @return Iterator that yields the entities in the box.
+ */
 FLECS_EXPORT
-void* ecs_record_get_column(
-    ecs_record_t *r,
-    int32_t column,
-    size_t size);
+ecs_spatial_iter_t ecs_spatial_box(
+    ecs_spatial_t *index,
+    const float *min,
+    const float *max);
 
-/** Copy value to a component for a record.
- * This operation sets the component value of a single component for a record.
- * If the component type has a copy action it will be used, otherwise the value
- * be memcpyd into the component array.
+/** Find entities within a radius.
+ * The center array contains 2 elements for a 2D index, and 3 elements for a 3D
+ * index. Entities at exactly the radius are included.
  *
- * The provided record does not need to be managed by the entity index but does
- * need to point to a valid record in the table. If the provided index is
- * outside of the range indicating the number of records in the table, behavior
- * is undefined. In debug mode it will cause the operation to assert.
+ * @param index The index.
+ * @param center The center of the queried region.
+ * @param radius The radius of the queried region.
+ * @return Iterator that yields the entities within the radius.
+ */
+FLECS_EXPORT
+ecs_spatial_iter_t ecs_spatial_radius(
+    ecs_spatial_t *index,
+    const float *center,
+    float radius);
+
+/** Progress a spatial query iterator.
+ * Batches are never empty. Resources held by the iterator are released when
+ * this operation returns false.
  *
- * @param world The world.
- * @param r The record to set.
- * @param column The column index of the component to set.
- * @param size The size of the component.
- * @param value Pointer to the value to copy.
+ * @param it The iterator.
+ * @return True if more entities are available, false if not.
  */
 FLECS_EXPORT
-void ecs_record_copy_to(
-    ecs_world_t *world,
-    ecs_record_t *r,
-    int32_t column,
-    size_t size,
-    const void *value,
-    int32_t count);
+bool ecs_spatial_next(
+    ecs_spatial_iter_t *it);
 
-/** Memcpy value to a component for a record.
- * Same as ecs_record_copy_to, except that this operation will always use
- * memcpy. This operation should only be used for components that can be safely
- * memcpyd. If the operation is used for a component that has a copy or move
- * action, the behavior is undefined. In debug mode the operation may assert.
+/** Release resources of an iterator that did not run to completion.
  *
- * @param world The world.
- * @param r The record to set.
- * @param column The column index of the component to set.
- * @param size The size of the component.
- * @param value Pointer to the value to move. 
+ * @param it The iterator.
  */
 FLECS_EXPORT
-void ecs_record_copy_pod_to(
-    ecs_world_t *world,
-    ecs_record_t *r,
-    int32_t column,
-    size_t size,
-    const void *value,
-    int32_t count);
+void ecs_spatial_iter_fini(
+    ecs_spatial_iter_t *it);
 
-/** Move value to a component for a record.
- * Same as ecs_record_copy_to, except that it uses the move action. If the 
- * component has no move action the value will be memcpyd into the component 
- * array. After this operation the application can no longer assume that the 
- * value passed into the function is valid.
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
+#endif
+#ifdef FLECS_TEMPLATE
+#ifdef FLECS_TEMPLATE
+
+/**
+ * @file template.h
+ * @brief World template API.
  *
- * @param world The world.
- * @param r The record to set.
- * @param column The column index of the component to set.
- * @param size The size of the component.
- * @param value Pointer to the value to move.
+ * A template is a regular world that is used to create new worlds with the same
+ * contents. Applications that create many short-lived worlds can populate a
+ * template once with their components, modules, systems and entities, and then
+ * create independent copies of it.
+ *
+ * The tables of the template are copied in bulk. Entities that are owned by
+ * builtin components (components, types, triggers, systems and pipelines) are
+ * recreated in the new world, so that their queries are matched with the new
+ * world. Entity ids are preserved, so that component and system handles that
+ * were obtained from the template can be used with its copies.
+ */
+
+#ifndef FLECS_TEMPLATE_H
+#define FLECS_TEMPLATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Create a new world from a template.
+ * The new world contains the entities and component values of the template,
+ * including components, component actions, modules, triggers, systems and
+ * pipelines. Changes to the new world do not affect the template, and the
+ * other way around.
+ *
+ * Component values are copied with the copy action of the component. Pointer
+ * members of components, system contexts and the world context are copied by
+ * value, and are shared with the template.
+ *
+ * Entities are copied per table. After all entities are copied, OnSet systems
+ * are invoked once for the components of each copied entity. OnAdd triggers
+ * and monitors are not invoked. Entities with builtin components (components,
+ * types, triggers, systems and pipelines) and entities created by ecs_init are
+ * instead recreated by adding their components, which invokes OnAdd triggers
+ * and OnSet systems for each component, as when they were created.
+ *
+ * Types and signature expressions are copied, so the template may be deleted
+ * while the new world is in use. Type handles of the template are not valid
+ * for the new world, and should be looked up with ecs_type_from_entity.
+ * Queries, snapshots and command queues are not copied, and should be created
+ * for the new world. The template may not have spatial indices, as their
+ * systems update the index of the template. Worker threads are not copied, and
+ * should be set with ecs_set_threads.
+ *
+ * This operation may not be called while the template is progressing.
+ *
+ * @param world The template.
+ * @return A new world with the contents of the template.
  */
 FLECS_EXPORT
-void ecs_record_move_to(
-    ecs_world_t *world,
-    ecs_record_t *r,
-    int32_t column,
-    size_t size,
-    void *value,
-    int32_t count);
+ecs_world_t* ecs_init_w_template(
+    ecs_world_t *world);
 
 #ifdef __cplusplus
 }
@@ -7538,6 +8733,35 @@ public:
     }   
 };
 
+/** Unchecked column element accessor used by each_invoker. Unlike any_column,
+ * this does not test whether the column is shared or set for every element.
+ * Instead each_invoker selects the index once per table: the row for owned
+ * columns, and 0 for shared or unset columns. An unset (optional) column has
+ * a NULL array, for which element 0 evaluates to nullptr.
+ *
+ * @tparam T component type of the column.
+ */
+template <typename T, typename = void>
+struct each_column { };
+
+template <typename T>
+struct each_column<T, typename std::enable_if<std::is_pointer<T>::value == true>::type> {
+    using Base = typename std::remove_pointer<T>::type;
+
+    static T get(void *array, std::size_t index) {
+        return &static_cast<Base*>(array)[index];
+    }
+};
+
+template <typename T>
+struct each_column<T, typename std::enable_if<std::is_pointer<T>::value == false>::type> {
+    using Base = typename std::remove_reference<T>::type;
+
+    static Base& get(void *array, std::size_t index) {
+        return static_cast<Base*>(array)[index];
+    }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /** Iterate over an integer range (used to iterate over entity range).
@@ -7787,6 +9011,22 @@ public:
         return get_unsafe_column(col);
     }
 
+    /** Obtain field column.
+     * This operation obtains a typed view on a single field of a component 
+     * that is stored as a structure of arrays.
+     *
+     * @tparam Type of the field.
+     * @param col The column id.
+     * @param index The field index.
+     * @return The field column.
+     */
+    template <typename T>
+    flecs::column<T> field(int32_t col, int32_t index) const {
+        return flecs::column<T>(static_cast<T*>(
+            ecs_column_field_w_size(m_iter, sizeof(T), col, index)), 
+                static_cast<std::size_t>(m_iter->count), false);
+    }
+
     /** Obtain owned column.
      * Same as iter::column, but ensures that column is owned.
      *
@@ -8886,6 +10126,38 @@ public:
      */ 
     base_type& remove_case(const entity& sw_case) const;
 
+    /** Enable a component.
+     * This sets the enabled bit for this component. If this is the first time
+     * the component is enabled or disabled, the bitset is added.
+     *
+     * @tparam T The component to enable.
+     */   
+    template<typename T>
+    base_type& enable() const {
+        static_cast<base_type*>(this)->invoke(
+        [](world_t *world, entity_t id) {
+            ecs_enable_component_w_entity(
+                world, id, _::component_info<T>::id(world), true);
+        });
+        return *static_cast<base_type*>(this);  
+    }
+
+    /** Disable a component.
+     * This sets the enabled bit for this component. If this is the first time
+     * the component is enabled or disabled, the bitset is added.
+     *
+     * @tparam T The component to disable.
+     */   
+    template<typename T>
+    base_type& disable() const {
+        static_cast<base_type*>(this)->invoke(
+        [](world_t *world, entity_t id) {
+            ecs_enable_component_w_entity(
+                world, id, _::component_info<T>::id(world), false);
+        });
+        return *static_cast<base_type*>(this);  
+    }
+
     /** Set a component for an entity.
      * This operation overwrites the component value. If the entity did not yet
      * have the component, this operation will add it.
@@ -9890,6 +11162,17 @@ public:
      */
     flecs::entity get_case(flecs::type sw) const;
 
+    /** Test if component is enabled.
+     *
+     * @tparam T The component to test.
+     * @return True if the component is enabled, false if it has been disabled.
+     */
+    template<typename T>
+    bool is_enabled() const {
+        return ecs_is_component_enabled_w_entity(
+            m_world, m_id, _::component_info<T>::id(m_world));
+    }
+
     /** Get current delta time.
      * Convenience function so system implementations can get delta_time, even
      * if they are using the .each() function.
@@ -10763,19 +12046,15 @@ class each_invoker {
 public:
     explicit each_invoker(Func func) : m_func(func) { }
 
-    // Invoke system
+    // Invoke system. The loop is selected once per table, so that the inner
+    // loop does not test for shared or optional columns for each entity.
     template <typename... Targs,
         typename std::enable_if<sizeof...(Targs) == sizeof...(Components), void>::type* = nullptr>
     static void call_system(ecs_iter_t *iter, Func func, int index, Columns& columns, Targs... comps) {
-        flecs::iter iter_wrapper(iter);
         (void)index;
         (void)columns;
 
-        // Use any_column so we can transparently use shared components
-        for (auto row : iter_wrapper) {
-            func(iter_wrapper.entity(row), (_::any_column<typename std::remove_reference<Components>::type>(
-                 (typename std::remove_reference< typename std::remove_pointer<Components>::type >::type*)comps.ptr, iter->count, comps.is_shared))[row]...);
-        }
+        dispatch(owned_flags<>(), iter, func, comps...);
     }
 
     // Add components one by one to parameter pack
@@ -10787,14 +12066,84 @@ public:
 
     // Callback provided to flecs system
     static void run(ecs_iter_t *iter) {
-        const Context *ctx = ecs_get(iter->world, iter->system, EcsContext);
-        each_invoker *self = (each_invoker*)ctx->ctx;
+        each_invoker *self = (each_invoker*)iter->ctx;
+        ecs_assert(self != nullptr, ECS_INTERNAL_ERROR, NULL);
         Func func = self->m_func;        
         column_args<Components...> columns(iter);
         call_system(iter, func, 0, columns.m_columns);
     }   
 
+    // Callback provided to parallel query iteration
+    static void run_w_param(ecs_iter_t *iter) {
+        each_invoker *self = (each_invoker*)iter->param;
+        column_args<Components...> columns(iter);
+        call_system(iter, self->m_func, 0, columns.m_columns);
+    }
+
 private:
+    using Column = typename column_args<Components ...>::Column;
+
+    // Maximum number of components for which a loop is instantiated for each
+    // combination of owned and shared columns
+    static const std::size_t max_dispatch_columns = 4;
+
+    template <bool... Owned>
+    struct owned_flags { };
+
+    // Column with the index multiplier for rows, 1 if owned, 0 if shared
+    struct strided_column {
+        void *ptr;
+        std::size_t stride;
+    };
+
+    // Select at compile time whether the next column is indexed with the row
+    // (owned) or with 0 (shared or unset).
+    template <bool... Owned, typename... Targs,
+        typename std::enable_if<sizeof...(Owned) < sizeof...(Components) &&
+            sizeof...(Components) <= max_dispatch_columns, void>::type* = nullptr>
+    static void dispatch(owned_flags<Owned...>, ecs_iter_t *iter, Func& func, Targs... comps) {
+        const Column columns[] = {comps...};
+        const Column& column = columns[sizeof...(Owned)];
+
+        if (column.ptr && !column.is_shared) {
+            dispatch(owned_flags<Owned..., true>(), iter, func, comps...);
+        } else {
+            dispatch(owned_flags<Owned..., false>(), iter, func, comps...);
+        }
+    }
+
+    // All columns are selected, Owned is a constant for each column
+    template <bool... Owned, typename... Targs,
+        typename std::enable_if<sizeof...(Owned) == sizeof...(Components), void>::type* = nullptr>
+    static void dispatch(owned_flags<Owned...>, ecs_iter_t *iter, Func& func, Targs... comps) {
+        flecs::iter iter_wrapper(iter);
+
+        for (auto row : iter_wrapper) {
+            func(iter_wrapper.entity(row), _::each_column<Components>::get(
+                comps.ptr, Owned ? row : 0)...);
+        }
+    }
+
+    // Too many components to instantiate all combinations. The row multiplier
+    // of each column is computed once per table instead.
+    template <bool... Owned, typename... Targs,
+        typename std::enable_if<sizeof...(Owned) == 0 &&
+            (sizeof...(Components) > max_dispatch_columns), void>::type* = nullptr>
+    static void dispatch(owned_flags<Owned...>, ecs_iter_t *iter, Func& func, Targs... comps) {
+        call_strided(iter, func, strided_column{
+            comps.ptr, static_cast<std::size_t>(comps.ptr && !comps.is_shared)}...);
+    }
+
+    template <typename... Targs>
+    static void call_strided(ecs_iter_t *iter, Func& func, Targs... comps) {
+        flecs::iter iter_wrapper(iter);
+
+        for (auto row : iter_wrapper) {
+            func(iter_wrapper.entity(row), _::each_column<Components>::get(
+                comps.ptr, row * comps.stride)...);
+        }
+    }
+
     Func m_func;
 };
 
@@ -10833,8 +12182,8 @@ public:
 
     /** Callback provided to flecs */
     static void run(ecs_iter_t *iter) {
-        const Context *ctx = ecs_get(iter->world, iter->system, EcsContext);
-        action_invoker *self = (action_invoker*)ctx->ctx;        
+        action_invoker *self = (action_invoker*)iter->ctx;
+        ecs_assert(self != nullptr, ECS_INTERNAL_ERROR, NULL);
         Func func = self->m_func; 
         column_args<Components...> columns(iter);
         call_system(iter, func, 0, columns.m_columns);
@@ -10875,13 +12224,20 @@ public:
 
     /** Callback provided to flecs */
     static void run(ecs_iter_t *iter) {
-        const Context *ctx = ecs_get(iter->world, iter->system, EcsContext);
-        iter_invoker *self = (iter_invoker*)ctx->ctx;        
+        iter_invoker *self = (iter_invoker*)iter->ctx;
+        ecs_assert(self != nullptr, ECS_INTERNAL_ERROR, NULL);
         Func func = self->m_func; 
         column_args<Components...> columns(iter);
         call_system(iter, func, 0, columns.m_columns);
     }   
 
+    /** Callback provided to parallel query iteration */
+    static void run_w_param(ecs_iter_t *iter) {
+        iter_invoker *self = (iter_invoker*)iter->param;
+        column_args<Components...> columns(iter);
+        call_system(iter, self->m_func, 0, columns.m_columns);
+    }
+
 private:
     Func m_func;
 };
@@ -10928,7 +12284,7 @@ public:
         }
 
         m_query = ecs_subquery_new(world.c_ptr(), parent.c_ptr(), str.str().c_str());
-    }    
+    }
 
     explicit query(const world& world, const char *expr) {
         std::stringstream str;
@@ -10948,7 +12304,7 @@ public:
             str << "," << expr;
             m_query = ecs_subquery_new(world.c_ptr(), parent.c_ptr(), str.str().c_str());
         }
-    }    
+    }
 
     query_iterator<Components...> begin() const;
 
@@ -10960,11 +12316,12 @@ public:
 
         while (ecs_query_next(&iter)) {
             _::column_args<Components...> columns(&iter);
-            _::each_invoker<Func, Components...> ctx(func);
-            ctx.call_system(&iter, func, 0, columns.m_columns);
+            _::each_invoker<Func, Components...>::call_system(
+                &iter, func, 0, columns.m_columns);
         }
     }
 
+    /* DEPRECATED */
     template <typename Func>
     void action(Func func) const {
         ecs_iter_t iter = ecs_query_iter(m_query);
@@ -10974,7 +12331,37 @@ public:
             _::action_invoker<Func, Components...> ctx(func);
             ctx.call_system(&iter, func, 0, columns.m_columns);
         }
-    }    
+    }  
+
+    template <typename Func>
+    void iter(Func func) const {
+        ecs_iter_t iter = ecs_query_iter(m_query);
+
+        while (ecs_query_next(&iter)) {
+            _::column_args<Components...> columns(&iter);
+            _::iter_invoker<Func, Components...> ctx(func);
+            ctx.call_system(&iter, func, 0, columns.m_columns);
+        }
+    }
+
+    /** Iterate entities in parallel on the calling thread and worker threads.
+     * Matched tables are split into chunks of at most chunk_size entities. The
+     * function may be invoked concurrently, and should use the world of the
+     * entity for operations. Returns when all chunks have been processed. */
+    template <typename Func>
+    void par_each(Func func, std::int32_t chunk_size = 1024) const {
+        _::each_invoker<Func, Components...> ctx(func);
+        ecs_query_par_iter(m_query, 
+            _::each_invoker<Func, Components...>::run_w_param, chunk_size, &ctx);
+    }
+
+    /** Iterate chunks in parallel on the calling thread and worker threads. */
+    template <typename Func>
+    void par_iter(Func func, std::int32_t chunk_size = 1024) const {
+        _::iter_invoker<Func, Components...> ctx(func);
+        ecs_query_par_iter(m_query, 
+            _::iter_invoker<Func, Components...>::run_w_param, chunk_size, &ctx);
+    }
 };
 
 
@@ -11182,6 +12569,10 @@ public:
         ecs_set_interval(m_world, m_id, period);
     }
 
+    void set_budget(int32_t entity_budget, float time_budget = 0.0f) const {
+        ecs_set_system_budget(m_world, m_id, entity_budget, time_budget);
+    }
+
     void set_context(void *ctx) const {
         EcsContext ctx_value = { ctx };
         ecs_set_ptr(m_world, m_id, EcsContext, &ctx_value);
@@ -11200,33 +12591,35 @@ public:
         return system_runner_fluent(m_world, m_id, delta_time, param);
     }
 
-    /* Action (or each) is mandatory and always the last thing that is added in 
-     * the fluent method chain. Create system signature from both template 
-     * parameters and anything provided by the signature method. */
+    /* DEPRECATED. Use iter instead. */
     template <typename Func>
     system& action(Func func) {
         ecs_assert(!m_finalized, ECS_INVALID_PARAMETER, NULL);
         auto ctx = new _::action_invoker<Func, Components...>(func);
 
-        create_system(func, _::action_invoker<Func, Components...>::run, false);
-
         EcsContext ctx_value = {ctx};
         ecs_set_ptr(m_world, m_id, EcsContext, &ctx_value);
 
+        create_system(func, _::action_invoker<Func, Components...>::run, false);
+
         return *this;
     }
 
-    /* Iter is similar to action, and will ultimately replace it */
+     /* Iter (or each) is mandatory and always the last thing that 
+      * is added in the fluent method chain. Create system signature from both 
+      * template parameters and anything provided by the signature method. */
     template <typename Func>
     system& iter(Func func) {
         ecs_assert(!m_finalized, ECS_INVALID_PARAMETER, NULL);
         auto ctx = new _::iter_invoker<Func, Components...>(func);
 
-        create_system(func, _::iter_invoker<Func, Components...>::run, false);
-
+        // Set context before creating the system, so that the invoker can be
+        // obtained from the iterator without a lookup
         EcsContext ctx_value = {ctx};
         ecs_set_ptr(m_world, m_id, EcsContext, &ctx_value);
 
+        create_system(func, _::iter_invoker<Func, Components...>::run, false);
+
         return *this;
     }    
 
@@ -11236,11 +12629,11 @@ public:
     system& each(Func func) {
         auto ctx = new _::each_invoker<Func, Components...>(func);
 
-        create_system(func, _::each_invoker<Func, Components...>::run, true);
-
         EcsContext ctx_value = {ctx};
         ecs_set_ptr(m_world, m_id, EcsContext, &ctx_value);
 
+        create_system(func, _::each_invoker<Func, Components...>::run, true);
+
         return *this;
     }
 
@@ -26,15 +26,20 @@
 #define FLECS_READER_WRITER
 #define FLECS_SNAPSHOT
 #define FLECS_DIRECT_ACCESS
+#define FLECS_PROFILER
+#define FLECS_COMMAND_QUEUE
+#define FLECS_SPATIAL
+#define FLECS_TEMPLATE
 #endif
 
 #include "flecs/private/api_defines.h"
+#include "flecs/os_api.h"  /* Abstraction for operating system functions */
 #include "flecs/private/vector.h"        /* Vector datatype */
 #include "flecs/private/sparse.h"        /* Sparse set */
 #include "flecs/private/map.h"           /* Hashmap */
 #include "flecs/private/switch_list.h"   /* Switch list */
+#include "flecs/private/bitset.h"        /* Bitset */
 #include "flecs/private/strbuf.h"        /* Efficient string builder */
-#include "flecs/os_api.h"  /* Abstraction for operating system functions */
 
 #ifdef __cplusplus
 extern "C" {
@@ -83,6 +88,23 @@ typedef struct ecs_filter_t {
     ecs_match_kind_t exclude_kind;  /**< Match kind for exclude components */
 } ecs_filter_t;
 
+/** Describes a field of a component that is stored as a structure of arrays. */
+typedef struct ecs_field_t {
+    ecs_size_t offset;              /**< Offset of the field in the component */
+    ecs_size_t size;                /**< Size of the field */
+} ecs_field_t;
+
+/** Describes the type of a key that is used to sort a query. */
+typedef enum ecs_sort_key_kind_t {
+    EcsSortKeyNone = 0,
+    EcsSortKeyI32,                  /**< int32_t key */
+    EcsSortKeyU32,                  /**< uint32_t key */
+    EcsSortKeyF32,                  /**< float key */
+    EcsSortKeyI64,                  /**< int64_t key */
+    EcsSortKeyU64,                  /**< uint64_t key */
+    EcsSortKeyF64                   /**< double key */
+} ecs_sort_key_kind_t;
+
 /** Type that contains various statistics of a world. */
 typedef struct ecs_world_info_t {
     ecs_entity_t last_component_id;   /**< Last issued component entity id */
@@ -105,6 +127,22 @@ typedef struct ecs_world_info_t {
     int32_t merge_count_total;  /**< Total number of merges */
     int32_t pipeline_build_count_total; /**< Total number of pipeline builds */
     int32_t systems_ran_frame;  /**< Total number of systems ran in last frame */
+
+    int32_t table_create_count_total; /**< Total number of tables created */
+    int32_t table_delete_count_total; /**< Total number of tables deleted */
+    int64_t table_move_count_total;   /**< Total number of entities moved between tables */
+    int64_t table_append_count_total; /**< Total number of rows appended to tables */
+    int64_t table_remove_count_total; /**< Total number of rows removed from tables */
+
+    int64_t defer_new_count_total;    /**< Total number of deferred new/clone operations */
+    int64_t defer_add_count_total;    /**< Total number of deferred add operations */
+    int64_t defer_remove_count_total; /**< Total number of deferred remove operations */
+    int64_t defer_set_count_total;    /**< Total number of deferred set/mut/modified operations */
+    int64_t defer_delete_count_total; /**< Total number of deferred delete/clear operations */
+    int64_t defer_flush_count_total;  /**< Total number of deferred operations executed */
+
+    int32_t rematch_count_total;      /**< Total number of query rematches */
+    int64_t monitor_eval_count_total; /**< Total number of component monitor evaluations */
 } ecs_world_info_t;
 
 /** @} */
@@ -163,6 +201,16 @@ typedef struct EcsName {
     char *alloc_value;     /**< If set, value will be freed on destruction */
 } EcsName;
 
+/** Component that stores the parent of an entity as a value.
+ * Unlike a CHILDOF relationship, the parent is not part of the entity type, so
+ * children of different parents can be stored in the same table. Children are
+ * found through a separate child index, which is used by ecs_scope_iter, 
+ * ecs_get_child_count, ecs_lookup_child and when the parent is deleted. Use
+ * ecs_set_parent to assign the parent. */
+typedef struct EcsChildOf {
+    ecs_entity_t parent;   /**< Parent entity */
+} EcsChildOf;
+
 /** Component information. */
 typedef struct EcsComponent {
     ecs_size_t size;           /**< Component size */
@@ -260,6 +308,11 @@ typedef struct EcsTrigger {
 /** Enforce ownership of a component */
 #define ECS_OWNED (ECS_ROLE | ((ecs_entity_t)0x75 << 56))
 
+/** Track whether a component is enabled or disabled per entity. Tables with
+ * DISABLED | Component in their type store a bitset for the component. Queries
+ * skip entities for which the component is disabled. */
+#define ECS_DISABLED (ECS_ROLE | ((ecs_entity_t)0x74 << 56))
+
 /** @} */
 
 /**
@@ -628,6 +681,90 @@ void ecs_set_component_actions_w_entity(
     ecs_set_component_actions_w_entity(world, ecs_typeid(component), &(EcsComponentLifecycle)__VA_ARGS__)
 
 #endif
+
+/** Store component in a sparse set instead of in tables.
+ * Components with sparse storage are stored in a sparse set that is indexed by
+ * entity id. Adding or removing a sparse component does not move the entity to
+ * another table, which makes it cheaper to frequently add and remove them.
+ *
+ * Sparse components are not part of the entity type. Queries match them per
+ * entity while iterating, and return entities with a sparse component one at a
+ * time. Triggers and OnSet systems are not invoked for sparse components, and
+ * sparse components are not stored in snapshots.
+ *
+ * This operation must be called before the component is added to entities.
+ *
+ * @param world The world.
+ * @param component The component to store in a sparse set.
+ */
+FLECS_EXPORT
+void ecs_set_component_sparse_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component);
+
+#define ecs_set_component_sparse(world, component)\
+    ecs_set_component_sparse_w_entity(world, ecs_typeid(component))
+
+/** Store component as a structure of arrays.
+ * A component with fields is stored in tables with one array per field, instead
+ * of one array of component values. This lets systems that only access a few
+ * fields of a large component iterate over contiguous memory.
+ *
+ * The fields of a structure of arrays component can be set with ecs_set, and
+ * are accessed with ecs_get_field and ecs_column_field. Because the component
+ * values are not stored contiguously, ecs_get, ecs_get_mut and ecs_column
+ * cannot be used with the component. Memory that is not covered by a field is
+ * not stored. Components with fields cannot have lifecycle actions.
+ *
+ * This operation must be called before the component is added to entities.
+ *
+ * @param world The world.
+ * @param component The component to store as a structure of arrays.
+ * @param fields Array with the fields of the component.
+ * @param count The number of fields.
+ */
+FLECS_EXPORT
+void ecs_set_component_fields_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    const ecs_field_t *fields,
+    int32_t count);
+
+#ifndef FLECS_LEGACY
+#define ECS_FIELD(T, member)\
+    { ECS_OFFSETOF(T, member), ECS_SIZEOF(((T*)0)->member) }
+
+#define ecs_set_component_fields(world, component, ...)\
+    ecs_set_component_fields_w_entity(world, ecs_typeid(component),\
+        (ecs_field_t[])__VA_ARGS__,\
+        (int32_t)(sizeof((ecs_field_t[])__VA_ARGS__) / sizeof(ecs_field_t)))
+#endif
+
+/** Keep a copy of component values from the previous frame.
+ * Tables store a second buffer for a double buffered component. At the end of
+ * ecs_progress, the values of the current frame are copied to this buffer. 
+ * Systems can read the previous frame values by annotating a column with 
+ * [prev], as in "[prev] Position". Because the buffer does not change while
+ * the frame is running, [prev] columns are read-only and never require a merge
+ * or synchronization point in the pipeline.
+ *
+ * Entities that got the component after the end of the last frame have a zero
+ * initialized previous value. Double buffered components cannot have 
+ * lifecycle actions, sparse storage or fields.
+ *
+ * This operation must be called before the component is added to entities.
+ *
+ * @param world The world.
+ * @param component The component to double buffer.
+ */
+FLECS_EXPORT
+void ecs_set_component_double_buffered_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component);
+
+#define ecs_set_component_double_buffered(world, component)\
+    ecs_set_component_double_buffered_w_entity(world, ecs_typeid(component))
+
 /** Set a world context.
  * This operation allows an application to register custom data with a world
  * that can be accessed anywhere where the application has the world object.
@@ -690,6 +827,38 @@ void ecs_dim_type(
     ecs_type_t type,
     int32_t entity_count);
 
+/** Enable garbage collection of empty tables.
+ * Tables are created for every combination of components that is added to an
+ * entity, and are by default not deleted until the world is deleted. When 
+ * table garbage collection is enabled, tables that have been empty for at least
+ * the specified number of frames are deleted at the end of a frame. Deleted 
+ * tables are removed from queries and from the table graph, and are recreated
+ * when needed.
+ *
+ * Applications should not enable table garbage collection while they hold
+ * snapshots, as snapshots refer to tables that may be deleted.
+ *
+ * @param world The world.
+ * @param empty_frames Number of frames a table must be empty (0 disables).
+ */
+FLECS_EXPORT
+void ecs_set_table_gc(
+    ecs_world_t *world,
+    int32_t empty_frames);
+
+/** Delete empty tables.
+ * This operation deletes tables that have been empty for the number of frames
+ * configured with ecs_set_table_gc. If table garbage collection is disabled,
+ * all empty tables are deleted. This operation may not be called while the
+ * world is progressing.
+ *
+ * @param world The world.
+ * @return The number of deleted tables.
+ */
+FLECS_EXPORT
+int32_t ecs_gc(
+    ecs_world_t *world);
+
 /** Set a range for issueing new entity ids.
  * This function constrains the entity identifiers returned by ecs_new to the 
  * specified range. This operation can be used to ensure that multiple processes
@@ -787,6 +956,56 @@ void ecs_begin_wait(
 void ecs_end_wait(
     ecs_world_t *world);
 
+/** Begin reading the world from a thread that does not run the frame.
+ * When locking is enabled, threads can read the world while it is being
+ * progressed, without waiting for the frame to end. Readers are admitted
+ * while systems run, and are only excluded while the world is merged. If the
+ * world is not readable, this function blocks until the next read epoch.
+ *
+ * A merge waits until all readers have invoked ecs_read_end, so data that is
+ * read by a thread is not moved or freed before the thread releases it.
+ * Readers may use operations that do not modify the world, such as ecs_get
+ * and iterating a query that was created beforehand. Component values can be
+ * written by systems while they are read. Queries that are iterated by readers
+ * should not use ecs_query_order_by, as sorting moves data in the tables.
+ * Sorted queries that are iterated by the thread that progresses the world are
+ * not sorted while the world is readable. Instead, their tables are sorted
+ * before the next read epoch begins, so that entities do not move while they
+ * are read.
+ *
+ * Iterating a query from a reader does not update its change detection state
+ * (see ecs_query_changed), so that readers do not modify the query.
+ *
+ * The world is readable from the start of ecs_progress until the merge at the
+ * end of the frame (or at the first merge point of the pipeline). A reader 
+ * that calls this function while the world is not readable blocks until the
+ * next call to ecs_progress begins a frame. If the world is not progressed, 
+ * the reader blocks indefinitely. Likewise, the merge blocks the thread that
+ * progresses the world until all readers have called ecs_read_end, so readers
+ * should hold on to the world for a short time only.
+ *
+ * Locking must be enabled before this function can be used. This function
+ * must not be called from the thread that progresses the world. It requires 
+ * a compiler that supports thread local storage.
+ *
+ * @param world The world.
+ * @return The read epoch, which is incremented each time the world becomes
+ *         readable.
+ */
+FLECS_EXPORT
+int32_t ecs_read_begin(
+    ecs_world_t *world);
+
+/** Release world after calling ecs_read_begin.
+ * A thread must release the world before the next merge can happen, so that
+ * readers do not stall the thread that progresses the world.
+ *
+ * @param world The world.
+ */
+FLECS_EXPORT
+void ecs_read_end(
+    ecs_world_t *world);
+
 /** Enable or disable tracing.
  * This will enable builtin tracing. For tracing to work, it will have to be
  * compiled in which requires defining one of the following macro's:
@@ -1215,6 +1434,51 @@ ecs_entity_t ecs_get_case(
     ecs_entity_t e,
     ecs_entity_t sw);
 
+/** Enable or disable component.
+ * Enabling or disabling a component does not add or remove a component from an
+ * entity, but prevents it from being matched with queries. This operation can
+ * be useful when a component must be temporarily disabled without destroying
+ * its value.
+ *
+ * The first time a component is disabled for an entity, DISABLED | component
+ * is added to the entity, which moves the entity to a table that stores a
+ * bitset for the component. After that, enabling or disabling the component
+ * only writes a bit, and does not move the entity between tables.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param component The component.
+ * @param enable True to enable the component, false to disable.
+ */
+FLECS_EXPORT
+void ecs_enable_component_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    bool enable);
+
+#define ecs_enable_component(world, entity, T, enable)\
+    ecs_enable_component_w_entity(world, entity, ecs_typeid(T), enable)
+
+/** Test if component is enabled.
+ * Test whether a component is currently enabled or disabled. This operation
+ * will return true when the entity has the component and if it has not been
+ * disabled by ecs_enable_component.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param component The component.
+ * @return True if the component is enabled, otherwise false.
+ */
+FLECS_EXPORT
+bool ecs_is_component_enabled_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component);
+
+#define ecs_is_component_enabled(world, entity, T)\
+    ecs_is_component_enabled_w_entity(world, entity, ecs_typeid(T))
+
 /** @} */
 
 /**
@@ -1295,6 +1559,35 @@ const void* ecs_get_w_entity(
 #define ecs_get(world, entity, component)\
     ((const component*)ecs_get_w_entity(world, entity, ecs_typeid(component)))
 
+/** Get an immutable pointer to a field of a component.
+ * This operation obtains a const pointer to a field of a component that is
+ * stored as a structure of arrays. See ecs_set_component_fields_w_entity.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param component The entity id of the component.
+ * @param field The index of the field.
+ * @return The field pointer, NULL if the entity does not have the component.
+ */
+FLECS_EXPORT
+const void* ecs_get_field_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    int32_t field);
+
+/** Get an immutable pointer to a field of a component.
+ * Same as ecs_get_field_w_entity, but accepts the typename of a component.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param component The component.
+ * @param field The index of the field.
+ * @return The field pointer, NULL if the entity does not have the component.
+ */
+#define ecs_get_field(world, entity, component, field)\
+    ecs_get_field_w_entity(world, entity, ecs_typeid(component), field)
+
 /* -- Get cached pointer -- */
 
 /** Get an immutable reference to a component.
@@ -1624,7 +1917,8 @@ size_t ecs_entity_str(
 /** Get the parent of an entity.
  * This will return a parent of the entity that has the specified component. If
  * the component is 0, the operation will return the first parent that it finds
- * in the entity type (an entity with a CHILDOF role).
+ * in the entity type (an entity with a CHILDOF role). If the entity has no 
+ * CHILDOF parent, the parent stored in EcsChildOf is returned.
  *
  * @param world The world.
  * @param entity The entity.
@@ -2016,6 +2310,11 @@ ecs_iter_t ecs_scope_iter_w_filter(
  * must have been initialized with `ecs_scope_iter`. This operation must be
  * invoked at least once before interpreting the contents of the iterator.
  *
+ * After the child tables of the parent have been iterated, the iterator 
+ * returns the children that store their parent in EcsChildOf. These children
+ * are returned one at a time, where it->offset is the row of the child in its
+ * table. Use ecs_table_column_w_offset to access their component data.
+ *
  * @param it The iterator
  * @return True if more data is available, false if not.
  */
@@ -2039,6 +2338,35 @@ ecs_entity_t ecs_set_scope(
     ecs_world_t *world,
     ecs_entity_t scope);
 
+/** Set the parent of an entity without changing its type.
+ * This operation stores the parent in the EcsChildOf component of the entity
+ * instead of adding a CHILDOF role to the entity type. Children of different
+ * parents that have the same components are therefore stored in the same 
+ * table, which avoids creating a table per parent for hierarchies with many
+ * small families.
+ *
+ * Children are registered with a child index that is used by ecs_scope_iter,
+ * ecs_get_child_count, ecs_lookup_child, ecs_get_path and ecs_delete_children.
+ * When the parent is deleted, its children are deleted as well. Queries cannot
+ * match components of parents with the CONTAINER modifier for these children.
+ *
+ * When a prefab has children that are stored this way, the children of its
+ * instances are also stored with EcsChildOf. Instantiating the prefab for many
+ * entities (for example with ecs_bulk_new_w_entity) then creates the children
+ * of all instances with one bulk insert per child table.
+ *
+ * Passing 0 for the parent removes the EcsChildOf component.
+ *
+ * @param world The world.
+ * @param entity The entity.
+ * @param parent The parent, or 0 to remove the parent.
+ */
+FLECS_EXPORT
+void ecs_set_parent(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t parent);
+
 /** Get the current scope.
  * Get the scope set by ecs_set_scope. If no scope is set, this operation will
  * return 0.
@@ -2278,7 +2606,9 @@ bool ecs_query_next_worker(
  * This enables sorting of entities across matched tables. As a result of this
  * operation, the order of entities in the matched tables may be changed. 
  * Resorting happens when a query iterator is obtained, and only if the table
- * data has changed.
+ * data has changed. If locking is enabled, tables are not resorted while the
+ * world is readable by other threads (see ecs_read_begin), but when the next
+ * frame or merge point begins.
  *
  * If multiple queries that match the same (sub)set of tables specify different 
  * sorting functions, resorting is likely to happen every time an iterator is
@@ -2301,6 +2631,31 @@ void ecs_query_order_by(
     ecs_entity_t component,
     ecs_compare_action_t compare);
 
+/** Sort the output of a query by a key in a component.
+ * This operation is similar to ecs_query_order_by, but instead of a compare
+ * function it accepts the type and offset of a numeric member of the component.
+ * Tables are sorted with a radix sort on the key, which runs in linear time and
+ * moves each row of a table only once. Entities with equal keys keep their
+ * relative order.
+ *
+ * @param world The world.
+ * @param query The query.
+ * @param component The component used to sort.
+ * @param kind The type of the key.
+ * @param offset The offset of the key in the component.
+ */
+FLECS_EXPORT
+void ecs_query_order_by_key(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_entity_t component,
+    ecs_sort_key_kind_t kind,
+    ecs_size_t offset);
+
+#define ecs_query_order_by_member(world, query, T, member, kind)\
+    ecs_query_order_by_key(world, query, ecs_typeid(T), kind,\
+        ECS_OFFSETOF(T, member))
+
 /** Group and sort matched tables.
  * Similar yo ecs_query_order_by, but instead of sorting individual entities, this
  * operation only sorts matched tables. This can be useful of a query needs to
@@ -2327,6 +2682,39 @@ void ecs_query_group_by(
     ecs_entity_t component,
     ecs_rank_type_action_t rank_action);
 
+/** Iterate the tables of a single group.
+ * This operation returns an iterator that only iterates the tables that were
+ * assigned the provided rank by the rank action of ecs_query_group_by. The 
+ * query keeps track of where the tables of each rank are stored, so the cost 
+ * of iterating a group depends only on the size of the group.
+ *
+ * The query must have a rank action. If no tables have the rank, the iterator
+ * does not return any results. The iterator is advanced with ecs_query_next.
+ *
+ * @param query The query to iterate.
+ * @param rank The rank of the tables to iterate.
+ * @return The query iterator.
+ */
+FLECS_EXPORT
+ecs_iter_t ecs_query_iter_group(
+    ecs_query_t *query,
+    int32_t rank);
+
+/** Iterate the tables of a range of groups.
+ * Same as ecs_query_iter_group, but iterates all tables with a rank in the
+ * range [rank_min, rank_max]. Tables are iterated in order of rank.
+ *
+ * @param query The query to iterate.
+ * @param rank_min The lowest rank of the tables to iterate.
+ * @param rank_max The highest rank of the tables to iterate.
+ * @return The query iterator.
+ */
+FLECS_EXPORT
+ecs_iter_t ecs_query_iter_group_range(
+    ecs_query_t *query,
+    int32_t rank_min,
+    int32_t rank_max);
+
 /** Returns whether the query data changed since the last iteration.
  * This operation must be invoked before obtaining the iterator, as this will
  * reset the changed state. The operation will return true after:
@@ -2400,6 +2788,42 @@ void* ecs_column_w_size(
 #define ecs_column(it, type, column)\
     ((type*)ecs_column_w_size(it, sizeof(type), column))
 
+/** Obtain field data.
+ * This operation obtains the array for a single field of a component that is
+ * stored as a structure of arrays. The column must be owned by the iterated
+ * entities. See ecs_set_component_fields_w_entity.
+ *
+ * This operation may return NULL if the column is optional, and the current
+ * table does not have the component.
+ *
+ * The provided size must match the size of the field, otherwise the function
+ * may fail.
+ *
+ * @param it The iterator.
+ * @param size The size of the field.
+ * @param column The index identifying the column in a signature.
+ * @param field The index of the field.
+ * @return A pointer to the field data.
+ */
+FLECS_EXPORT
+void* ecs_column_field_w_size(
+    const ecs_iter_t *it,
+    size_t size,
+    int32_t column,
+    int32_t field);
+
+/** Obtain field data.
+ * Same as ecs_column_field_w_size, but accepts the typename of the field.
+ *
+ * @param it The iterator.
+ * @param type The typename of the field.
+ * @param column The index identifying the column in a signature.
+ * @param field The index of the field.
+ * @return A pointer to the field data.
+ */
+#define ecs_column_field(it, type, column, field)\
+    ((type*)ecs_column_field_w_size(it, sizeof(type), column, field))
+
 /** Get column index by name.
  * This function obtains a column index by name. This function can only be used
  * if a query signature contains names.
@@ -2553,6 +2977,9 @@ ecs_type_t ecs_iter_type(
  * scenario where this would be used is when using a filter iterator, where
  * there is no signature, and thus ecs_column cannot be used.
  *
+ * The returned array starts at the first row of the table, regardless of the
+ * offset of the iterator.
+ *
  * @param it The iterator.
  * @param column The index identifying the column in a table.
  * @return The component array corresponding to the column index.
@@ -2562,6 +2989,21 @@ void* ecs_table_column(
     const ecs_iter_t *it,
     int32_t column);
 
+/** Get component array from table, starting at the iterator offset.
+ * Same as ecs_table_column, except that the returned array starts at the first
+ * entity of the iterator (it->offset), so that element i corresponds with 
+ * it->entities[i]. Use this operation for iterators that do not start at the 
+ * first row of a table, like the scope iterator for EcsChildOf children.
+ *
+ * @param it The iterator.
+ * @param column The index identifying the column in a table.
+ * @return The component array corresponding to the column index.
+ */
+FLECS_EXPORT
+void* ecs_table_column_w_offset(
+    const ecs_iter_t *it,
+    int32_t column);
+
 /** Get the size of a table column.
  *
  * @param it The iterator.
@@ -2737,6 +3179,18 @@ void ecs_set_automerge(
 #ifdef FLECS_DIRECT_ACCESS
 #include "flecs/addons/direct_access.h"
 #endif
+#ifdef FLECS_PROFILER
+#include "flecs/addons/profiler.h"
+#endif
+#ifdef FLECS_COMMAND_QUEUE
+#include "flecs/addons/command_queue.h"
+#endif
+#ifdef FLECS_SPATIAL
+#include "flecs/addons/spatial.h"
+#endif
+#ifdef FLECS_TEMPLATE
+#include "flecs/addons/template.h"
+#endif
 
 #ifdef __cplusplus
 }
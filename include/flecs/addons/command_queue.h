@@ -0,0 +1,135 @@
+#ifdef FLECS_COMMAND_QUEUE
+
+/**
+ * @file command_queue.h
+ * @brief Command queue API.
+ *
+ * A command queue lets threads that do not own the world enqueue operations
+ * for the world, such as adding, removing and setting components. Enqueueing
+ * a command does not take a lock. Commands are stored in a fixed-size ring
+ * buffer, where each producer claims a slot with an atomic increment.
+ *
+ * Commands are applied to the world at the start of each frame, before the
+ * pipeline runs. They are applied in the order in which slots were claimed,
+ * using the same mechanism as deferred operations.
+ */
+
+#ifndef FLECS_COMMAND_QUEUE_H
+#define FLECS_COMMAND_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ecs_command_queue_t ecs_command_queue_t;
+
+/** Create a command queue.
+ * The queue can hold the specified number of commands, rounded up to a power
+ * of 2. When the queue is full, producers wait until the world has applied
+ * the pending commands.
+ *
+ * This operation must be called from the thread that owns the world, and may
+ * not be called while the world is progressing.
+ *
+ * @param world The world.
+ * @param capacity The number of commands the queue can hold.
+ * @return The new command queue.
+ */
+FLECS_EXPORT
+ecs_command_queue_t* ecs_command_queue_new(
+    ecs_world_t *world,
+    int32_t capacity);
+
+/** Free a command queue.
+ * Commands that have not been applied to the world are discarded. Queues that
+ * are not freed by the application are freed when the world is deleted.
+ *
+ * @param queue The queue to free.
+ */
+FLECS_EXPORT
+void ecs_command_queue_free(
+    ecs_command_queue_t *queue);
+
+/** Apply enqueued commands to the world.
+ * This operation is invoked at the start of each frame. Applications can use
+ * it to apply commands outside of the main loop.
+ *
+ * @param queue The queue to flush.
+ * @return The number of commands that were applied.
+ */
+FLECS_EXPORT
+int32_t ecs_command_queue_flush(
+    ecs_command_queue_t *queue);
+
+/** Enqueue adding an entity to an entity.
+ * This operation can be called from any thread.
+ *
+ * @param queue The queue.
+ * @param entity The entity to add to.
+ * @param to_add The entity to add.
+ */
+FLECS_EXPORT
+void ecs_command_add_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t to_add);
+
+/** Enqueue removing an entity from an entity.
+ * This operation can be called from any thread.
+ *
+ * @param queue The queue.
+ * @param entity The entity to remove from.
+ * @param to_remove The entity to remove.
+ */
+FLECS_EXPORT
+void ecs_command_remove_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t to_remove);
+
+/** Enqueue setting the value of a component.
+ * The value is copied into the queue with memcpy. This operation can be called
+ * from any thread.
+ *
+ * @param queue The queue.
+ * @param entity The entity to set the component on.
+ * @param component The component to set.
+ * @param size The size of the component value.
+ * @param ptr Pointer to the component value.
+ */
+FLECS_EXPORT
+void ecs_command_set_ptr_w_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    size_t size,
+    const void *ptr);
+
+/** Enqueue deleting an entity.
+ * This operation can be called from any thread.
+ *
+ * @param queue The queue.
+ * @param entity The entity to delete.
+ */
+FLECS_EXPORT
+void ecs_command_delete(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity);
+
+#define ecs_command_add(queue, entity, T)\
+    ecs_command_add_entity(queue, entity, ecs_typeid(T))
+
+#define ecs_command_remove(queue, entity, T)\
+    ecs_command_remove_entity(queue, entity, ecs_typeid(T))
+
+#define ecs_command_set(queue, entity, T, ...)\
+    ecs_command_set_ptr_w_entity(queue, entity, ecs_typeid(T), sizeof(T),\
+        &(T)__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+#ifdef FLECS_PROFILER
+
+/**
+ * @file profiler.h
+ * @brief Profiler API.
+ *
+ * The profiler records timestamped spans for frames, systems, merges, sync
+ * points, deferred flushes, pipeline rebuilds and table creation. Spans are
+ * written to a fixed-size ring buffer per thread, so recording does not
+ * require locks. Recorded spans can be exported in the Chrome trace event
+ * format, which can be loaded in chrome://tracing or ui.perfetto.dev.
+ *
+ * The profiler is disabled by default. When disabled, the cost of a span is a
+ * single pointer check.
+ */
+
+#ifndef FLECS_PROFILER_H
+#define FLECS_PROFILER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Kinds of spans recorded by the profiler. */
+typedef enum ecs_span_kind_t {
+    EcsSpanFrame,               /**< Frame (ecs_frame_begin - ecs_frame_end) */
+    EcsSpanSystem,              /**< System invocation */
+    EcsSpanMerge,               /**< Merge of stages */
+    EcsSpanSync,                /**< Main thread waiting on worker threads */
+    EcsSpanDeferFlush,          /**< Flush of deferred operations */
+    EcsSpanPipelineBuild,       /**< Rebuild of pipeline */
+    EcsSpanTableCreate          /**< Creation of a new table */
+} ecs_span_kind_t;
+
+/** A single recorded span. */
+typedef struct ecs_span_t {
+    ecs_span_kind_t kind;       /**< Span kind */
+    int32_t thread;             /**< Thread index (0 is the main thread) */
+    ecs_entity_t id;            /**< System, pipeline or table id */
+    uint64_t start;             /**< Start in ns since profiler was enabled */
+    uint64_t duration;          /**< Duration in nanoseconds */
+} ecs_span_t;
+
+/** Enable or disable the profiler.
+ * When enabled, the profiler allocates a ring buffer per thread that can hold
+ * the specified number of spans. When a ring buffer is full, the oldest spans
+ * are overwritten. Passing 0 for span_count disables the profiler and frees
+ * all recorded spans.
+ *
+ * This operation may not be called while the world is progressing.
+ *
+ * @param world The world.
+ * @param span_count The number of spans per thread (rounded up to power of 2).
+ */
+FLECS_EXPORT
+void ecs_profiler_enable(
+    ecs_world_t *world,
+    int32_t span_count);
+
+/** Test whether the profiler is enabled.
+ *
+ * @param world The world.
+ * @return True if enabled, false if not.
+ */
+FLECS_EXPORT
+bool ecs_profiler_is_enabled(
+    ecs_world_t *world);
+
+/** Discard all recorded spans.
+ *
+ * @param world The world.
+ */
+FLECS_EXPORT
+void ecs_profiler_clear(
+    ecs_world_t *world);
+
+/** Return number of threads for which spans are recorded.
+ * The main thread has index 0, worker threads start at index 1.
+ *
+ * @param world The world.
+ * @return The number of threads.
+ */
+FLECS_EXPORT
+int32_t ecs_profiler_thread_count(
+    ecs_world_t *world);
+
+/** Return number of spans currently stored for a thread.
+ *
+ * @param world The world.
+ * @param thread The thread index.
+ * @return The number of spans stored in the ring buffer of the thread.
+ */
+FLECS_EXPORT
+int32_t ecs_profiler_span_count(
+    ecs_world_t *world,
+    int32_t thread);
+
+/** Get span for thread.
+ * Spans are returned in the order in which they were recorded, where index 0
+ * is the oldest span that is still in the ring buffer.
+ *
+ * @param world The world.
+ * @param thread The thread index.
+ * @param index The index of the span.
+ * @return The span, or NULL if the index is out of range.
+ */
+FLECS_EXPORT
+const ecs_span_t* ecs_profiler_get_span(
+    ecs_world_t *world,
+    int32_t thread,
+    int32_t index);
+
+/** Export recorded spans as Chrome trace JSON.
+ * The returned string must be freed with ecs_os_free.
+ *
+ * @param world The world.
+ * @return A JSON string in the Chrome trace event format.
+ */
+FLECS_EXPORT
+char* ecs_profiler_to_json(
+    ecs_world_t *world);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,158 @@
+#ifdef FLECS_SPATIAL
+
+/**
+ * @file spatial.h
+ * @brief Spatial index API.
+ *
+ * A spatial index stores the entities that have a component with a position in
+ * a uniform hash grid, so that box and radius queries only visit the cells that
+ * overlap with the queried region. The position is read from two or three float
+ * members of the component, which are specified by their offset.
+ *
+ * The index is updated incrementally by an OnSet and an UnSet system for the
+ * component. An entity is inserted or moved when the component is set with
+ * ecs_set or when ecs_modified is called, and is removed when the component is
+ * removed or when the entity is deleted. Entities are only moved to another
+ * cell when their position crosses a cell boundary. Components that are added
+ * without being set, and components that are shared, are not indexed.
+ */
+
+#ifndef FLECS_SPATIAL_H
+#define FLECS_SPATIAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ecs_spatial_t ecs_spatial_t;
+
+/** Spatial query iterator.
+ * Each call to ecs_spatial_next yields the matching entities of a single cell.
+ * An iterator is invalidated when the index is updated.
+ */
+typedef struct ecs_spatial_iter_t {
+    const ecs_entity_t *entities; /* Entities in the current batch */
+    int32_t count;                /* Number of entities in the current batch */
+
+    /* Private */
+    ecs_spatial_t *index;
+    float min[3];                 /* Bounds of queried region */
+    float max[3];
+    float center[3];              /* Center of radius query */
+    float radius;                 /* Radius (0 for box query) */
+    int32_t cell_min[3];          /* Range of cells that overlap region */
+    int32_t cell_max[3];
+    int32_t cell[3];              /* Next cell to visit */
+    ecs_map_iter_t cells_iter;    /* Used when region has more cells than grid */
+    bool walk_cells;              /* Iterate grid instead of cell range */
+    ecs_vector_t *buffer;         /* Entities of partially overlapping cell */
+} ecs_spatial_iter_t;
+
+/** Create a spatial index.
+ * The index is populated with the entities for which the component has been
+ * set, and is kept up to date as the component is set, modified or removed.
+ * Position members must be of type float. For a 2D index, pass -1 for the
+ * z offset.
+ *
+ * This operation may not be called while the world is progressing.
+ *
+ * @param world The world.
+ * @param component The component that stores the position.
+ * @param x_offset The offset of the x member in the component.
+ * @param y_offset The offset of the y member in the component.
+ * @param z_offset The offset of the z member in the component, or -1.
+ * @param cell_size The size of a grid cell.
+ * @return The new spatial index.
+ */
+FLECS_EXPORT
+ecs_spatial_t* ecs_spatial_new_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    ecs_size_t x_offset,
+    ecs_size_t y_offset,
+    ecs_size_t z_offset,
+    float cell_size);
+
+#define ecs_spatial_new(world, T, x, y, cell_size)\
+    ecs_spatial_new_w_entity(world, ecs_typeid(T),\
+        ECS_OFFSETOF(T, x), ECS_OFFSETOF(T, y), -1, cell_size)
+
+#define ecs_spatial_new_3d(world, T, x, y, z, cell_size)\
+    ecs_spatial_new_w_entity(world, ecs_typeid(T),\
+        ECS_OFFSETOF(T, x), ECS_OFFSETOF(T, y), ECS_OFFSETOF(T, z), cell_size)
+
+/** Free a spatial index.
+ * This deletes the systems that keep the index up to date. Indices that are not
+ * freed by the application are freed when the world is deleted.
+ *
+ * @param index The index to free.
+ */
+FLECS_EXPORT
+void ecs_spatial_free(
+    ecs_spatial_t *index);
+
+/** Return number of entities in a spatial index.
+ *
+ * @param index The index.
+ * @return The number of indexed entities.
+ */
+FLECS_EXPORT
+int32_t ecs_spatial_count(
+    const ecs_spatial_t *index);
+
+/** Find entities in a box.
+ * The min and max arrays contain 2 elements for a 2D index, and 3 elements for
+ * a 3D index. Entities on the boundary of the box are included.
+ *
+ * @param index The index.
+ * @param min The lower bounds of the box.
+ * @param max The upper bounds of the box.
+ * @return Iterator that yields the entities in the box.
+ */
+FLECS_EXPORT
+ecs_spatial_iter_t ecs_spatial_box(
+    ecs_spatial_t *index,
+    const float *min,
+    const float *max);
+
+/** Find entities within a radius.
+ * The center array contains 2 elements for a 2D index, and 3 elements for a 3D
+ * index. Entities at exactly the radius are included.
+ *
+ * @param index The index.
+ * @param center The center of the queried region.
+ * @param radius The radius of the queried region.
+ * @return Iterator that yields the entities within the radius.
+ */
+FLECS_EXPORT
+ecs_spatial_iter_t ecs_spatial_radius(
+    ecs_spatial_t *index,
+    const float *center,
+    float radius);
+
+/** Progress a spatial query iterator.
+ * Batches are never empty. Resources held by the iterator are released when
+ * this operation returns false.
+ *
+ * @param it The iterator.
+ * @return True if more entities are available, false if not.
+ */
+FLECS_EXPORT
+bool ecs_spatial_next(
+    ecs_spatial_iter_t *it);
+
+/** Release resources of an iterator that did not run to completion.
+ *
+ * @param it The iterator.
+ */
+FLECS_EXPORT
+void ecs_spatial_iter_fini(
+    ecs_spatial_iter_t *it);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
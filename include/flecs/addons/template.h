@@ -0,0 +1,66 @@
+#ifdef FLECS_TEMPLATE
+
+/**
+ * @file template.h
+ * @brief World template API.
+ *
+ * A template is a regular world that is used to create new worlds with the same
+ * contents. Applications that create many short-lived worlds can populate a
+ * template once with their components, modules, systems and entities, and then
+ * create independent copies of it.
+ *
+ * The tables of the template are copied in bulk. Entities that are owned by
+ * builtin components (components, types, triggers, systems and pipelines) are
+ * recreated in the new world, so that their queries are matched with the new
+ * world. Entity ids are preserved, so that component and system handles that
+ * were obtained from the template can be used with its copies.
+ */
+
+#ifndef FLECS_TEMPLATE_H
+#define FLECS_TEMPLATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Create a new world from a template.
+ * The new world contains the entities and component values of the template,
+ * including components, component actions, modules, triggers, systems and
+ * pipelines. Changes to the new world do not affect the template, and the
+ * other way around.
+ *
+ * Component values are copied with the copy action of the component. Pointer
+ * members of components, system contexts and the world context are copied by
+ * value, and are shared with the template.
+ *
+ * Entities are copied per table. After all entities are copied, OnSet systems
+ * are invoked once for the components of each copied entity. OnAdd triggers
+ * and monitors are not invoked. Entities with builtin components (components,
+ * types, triggers, systems and pipelines) and entities created by ecs_init are
+ * instead recreated by adding their components, which invokes OnAdd triggers
+ * and OnSet systems for each component, as when they were created.
+ *
+ * Types and signature expressions are copied, so the template may be deleted
+ * while the new world is in use. Type handles of the template are not valid
+ * for the new world, and should be looked up with ecs_type_from_entity.
+ * Queries, snapshots and command queues are not copied, and should be created
+ * for the new world. The template may not have spatial indices, as their
+ * systems update the index of the template. Worker threads are not copied, and
+ * should be set with ecs_set_threads.
+ *
+ * This operation may not be called while the template is progressing.
+ *
+ * @param world The template.
+ * @return A new world with the contents of the template.
+ */
+FLECS_EXPORT
+ecs_world_t* ecs_init_w_template(
+    ecs_world_t *world);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
@@ -288,6 +288,35 @@ public:
     }   
 };
 
+/** Unchecked column element accessor used by each_invoker. Unlike any_column,
+ * this does not test whether the column is shared or set for every element.
+ * Instead each_invoker selects the index once per table: the row for owned
+ * columns, and 0 for shared or unset columns. An unset (optional) column has
+ * a NULL array, for which element 0 evaluates to nullptr.
+ *
+ * @tparam T component type of the column.
+ */
+template <typename T, typename = void>
+struct each_column { };
+
+template <typename T>
+struct each_column<T, typename std::enable_if<std::is_pointer<T>::value == true>::type> {
+    using Base = typename std::remove_pointer<T>::type;
+
+    static T get(void *array, std::size_t index) {
+        return &static_cast<Base*>(array)[index];
+    }
+};
+
+template <typename T>
+struct each_column<T, typename std::enable_if<std::is_pointer<T>::value == false>::type> {
+    using Base = typename std::remove_reference<T>::type;
+
+    static Base& get(void *array, std::size_t index) {
+        return static_cast<Base*>(array)[index];
+    }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /** Iterate over an integer range (used to iterate over entity range).
@@ -537,6 +566,22 @@ public:
         return get_unsafe_column(col);
     }
 
+    /** Obtain field column.
+     * This operation obtains a typed view on a single field of a component 
+     * that is stored as a structure of arrays.
+     *
+     * @tparam Type of the field.
+     * @param col The column id.
+     * @param index The field index.
+     * @return The field column.
+     */
+    template <typename T>
+    flecs::column<T> field(int32_t col, int32_t index) const {
+        return flecs::column<T>(static_cast<T*>(
+            ecs_column_field_w_size(m_iter, sizeof(T), col, index)), 
+                static_cast<std::size_t>(m_iter->count), false);
+    }
+
     /** Obtain owned column.
      * Same as iter::column, but ensures that column is owned.
      *
@@ -1636,6 +1681,38 @@ public:
      */ 
     base_type& remove_case(const entity& sw_case) const;
 
+    /** Enable a component.
+     * This sets the enabled bit for this component. If this is the first time
+     * the component is enabled or disabled, the bitset is added.
+     *
+     * @tparam T The component to enable.
+     */   
+    template<typename T>
+    base_type& enable() const {
+        static_cast<base_type*>(this)->invoke(
+        [](world_t *world, entity_t id) {
+            ecs_enable_component_w_entity(
+                world, id, _::component_info<T>::id(world), true);
+        });
+        return *static_cast<base_type*>(this);  
+    }
+
+    /** Disable a component.
+     * This sets the enabled bit for this component. If this is the first time
+     * the component is enabled or disabled, the bitset is added.
+     *
+     * @tparam T The component to disable.
+     */   
+    template<typename T>
+    base_type& disable() const {
+        static_cast<base_type*>(this)->invoke(
+        [](world_t *world, entity_t id) {
+            ecs_enable_component_w_entity(
+                world, id, _::component_info<T>::id(world), false);
+        });
+        return *static_cast<base_type*>(this);  
+    }
+
     /** Set a component for an entity.
      * This operation overwrites the component value. If the entity did not yet
      * have the component, this operation will add it.
@@ -2640,6 +2717,17 @@ public:
      */
     flecs::entity get_case(flecs::type sw) const;
 
+    /** Test if component is enabled.
+     *
+     * @tparam T The component to test.
+     * @return True if the component is enabled, false if it has been disabled.
+     */
+    template<typename T>
+    bool is_enabled() const {
+        return ecs_is_component_enabled_w_entity(
+            m_world, m_id, _::component_info<T>::id(m_world));
+    }
+
     /** Get current delta time.
      * Convenience function so system implementations can get delta_time, even
      * if they are using the .each() function.
@@ -3513,19 +3601,15 @@ class each_invoker {
 public:
     explicit each_invoker(Func func) : m_func(func) { }
 
-    // Invoke system
+    // Invoke system. The loop is selected once per table, so that the inner
+    // loop does not test for shared or optional columns for each entity.
     template <typename... Targs,
         typename std::enable_if<sizeof...(Targs) == sizeof...(Components), void>::type* = nullptr>
     static void call_system(ecs_iter_t *iter, Func func, int index, Columns& columns, Targs... comps) {
-        flecs::iter iter_wrapper(iter);
         (void)index;
         (void)columns;
 
-        // Use any_column so we can transparently use shared components
-        for (auto row : iter_wrapper) {
-            func(iter_wrapper.entity(row), (_::any_column<typename std::remove_reference<Components>::type>(
-                 (typename std::remove_reference< typename std::remove_pointer<Components>::type >::type*)comps.ptr, iter->count, comps.is_shared))[row]...);
-        }
+        dispatch(owned_flags<>(), iter, func, comps...);
     }
 
     // Add components one by one to parameter pack
@@ -3537,14 +3621,84 @@ public:
 
     // Callback provided to flecs system
     static void run(ecs_iter_t *iter) {
-        const Context *ctx = ecs_get(iter->world, iter->system, EcsContext);
-        each_invoker *self = (each_invoker*)ctx->ctx;
+        each_invoker *self = (each_invoker*)iter->ctx;
+        ecs_assert(self != nullptr, ECS_INTERNAL_ERROR, NULL);
         Func func = self->m_func;        
         column_args<Components...> columns(iter);
         call_system(iter, func, 0, columns.m_columns);
     }   
 
+    // Callback provided to parallel query iteration
+    static void run_w_param(ecs_iter_t *iter) {
+        each_invoker *self = (each_invoker*)iter->param;
+        column_args<Components...> columns(iter);
+        call_system(iter, self->m_func, 0, columns.m_columns);
+    }
+
 private:
+    using Column = typename column_args<Components ...>::Column;
+
+    // Maximum number of components for which a loop is instantiated for each
+    // combination of owned and shared columns
+    static const std::size_t max_dispatch_columns = 4;
+
+    template <bool... Owned>
+    struct owned_flags { };
+
+    // Column with the index multiplier for rows, 1 if owned, 0 if shared
+    struct strided_column {
+        void *ptr;
+        std::size_t stride;
+    };
+
+    // Select at compile time whether the next column is indexed with the row
+    // (owned) or with 0 (shared or unset).
+    template <bool... Owned, typename... Targs,
+        typename std::enable_if<sizeof...(Owned) < sizeof...(Components) &&
+            sizeof...(Components) <= max_dispatch_columns, void>::type* = nullptr>
+    static void dispatch(owned_flags<Owned...>, ecs_iter_t *iter, Func& func, Targs... comps) {
+        const Column columns[] = {comps...};
+        const Column& column = columns[sizeof...(Owned)];
+
+        if (column.ptr && !column.is_shared) {
+            dispatch(owned_flags<Owned..., true>(), iter, func, comps...);
+        } else {
+            dispatch(owned_flags<Owned..., false>(), iter, func, comps...);
+        }
+    }
+
+    // All columns are selected, Owned is a constant for each column
+    template <bool... Owned, typename... Targs,
+        typename std::enable_if<sizeof...(Owned) == sizeof...(Components), void>::type* = nullptr>
+    static void dispatch(owned_flags<Owned...>, ecs_iter_t *iter, Func& func, Targs... comps) {
+        flecs::iter iter_wrapper(iter);
+
+        for (auto row : iter_wrapper) {
+            func(iter_wrapper.entity(row), _::each_column<Components>::get(
+                comps.ptr, Owned ? row : 0)...);
+        }
+    }
+
+    // Too many components to instantiate all combinations. The row multiplier
+    // of each column is computed once per table instead.
+    template <bool... Owned, typename... Targs,
+        typename std::enable_if<sizeof...(Owned) == 0 &&
+            (sizeof...(Components) > max_dispatch_columns), void>::type* = nullptr>
+    static void dispatch(owned_flags<Owned...>, ecs_iter_t *iter, Func& func, Targs... comps) {
+        call_strided(iter, func, strided_column{
+            comps.ptr, static_cast<std::size_t>(comps.ptr && !comps.is_shared)}...);
+    }
+
+    template <typename... Targs>
+    static void call_strided(ecs_iter_t *iter, Func& func, Targs... comps) {
+        flecs::iter iter_wrapper(iter);
+
+        for (auto row : iter_wrapper) {
+            func(iter_wrapper.entity(row), _::each_column<Components>::get(
+                comps.ptr, row * comps.stride)...);
+        }
+    }
+
     Func m_func;
 };
 
@@ -3583,8 +3737,8 @@ public:
 
     /** Callback provided to flecs */
     static void run(ecs_iter_t *iter) {
-        const Context *ctx = ecs_get(iter->world, iter->system, EcsContext);
-        action_invoker *self = (action_invoker*)ctx->ctx;        
+        action_invoker *self = (action_invoker*)iter->ctx;
+        ecs_assert(self != nullptr, ECS_INTERNAL_ERROR, NULL);
         Func func = self->m_func; 
         column_args<Components...> columns(iter);
         call_system(iter, func, 0, columns.m_columns);
@@ -3625,13 +3779,20 @@ public:
 
     /** Callback provided to flecs */
     static void run(ecs_iter_t *iter) {
-        const Context *ctx = ecs_get(iter->world, iter->system, EcsContext);
-        iter_invoker *self = (iter_invoker*)ctx->ctx;        
+        iter_invoker *self = (iter_invoker*)iter->ctx;
+        ecs_assert(self != nullptr, ECS_INTERNAL_ERROR, NULL);
         Func func = self->m_func; 
         column_args<Components...> columns(iter);
         call_system(iter, func, 0, columns.m_columns);
     }   
 
+    /** Callback provided to parallel query iteration */
+    static void run_w_param(ecs_iter_t *iter) {
+        iter_invoker *self = (iter_invoker*)iter->param;
+        column_args<Components...> columns(iter);
+        call_system(iter, self->m_func, 0, columns.m_columns);
+    }
+
 private:
     Func m_func;
 };
@@ -3710,8 +3871,8 @@ public:
 
         while (ecs_query_next(&iter)) {
             _::column_args<Components...> columns(&iter);
-            _::each_invoker<Func, Components...> ctx(func);
-            ctx.call_system(&iter, func, 0, columns.m_columns);
+            _::each_invoker<Func, Components...>::call_system(
+                &iter, func, 0, columns.m_columns);
         }
     }
 
@@ -3736,7 +3897,26 @@ public:
             _::iter_invoker<Func, Components...> ctx(func);
             ctx.call_system(&iter, func, 0, columns.m_columns);
         }
-    }        
+    }
+
+    /** Iterate entities in parallel on the calling thread and worker threads.
+     * Matched tables are split into chunks of at most chunk_size entities. The
+     * function may be invoked concurrently, and should use the world of the
+     * entity for operations. Returns when all chunks have been processed. */
+    template <typename Func>
+    void par_each(Func func, std::int32_t chunk_size = 1024) const {
+        _::each_invoker<Func, Components...> ctx(func);
+        ecs_query_par_iter(m_query, 
+            _::each_invoker<Func, Components...>::run_w_param, chunk_size, &ctx);
+    }
+
+    /** Iterate chunks in parallel on the calling thread and worker threads. */
+    template <typename Func>
+    void par_iter(Func func, std::int32_t chunk_size = 1024) const {
+        _::iter_invoker<Func, Components...> ctx(func);
+        ecs_query_par_iter(m_query, 
+            _::iter_invoker<Func, Components...>::run_w_param, chunk_size, &ctx);
+    }
 };
 
 
@@ -3944,6 +4124,10 @@ public:
         ecs_set_interval(m_world, m_id, period);
     }
 
+    void set_budget(int32_t entity_budget, float time_budget = 0.0f) const {
+        ecs_set_system_budget(m_world, m_id, entity_budget, time_budget);
+    }
+
     void set_context(void *ctx) const {
         EcsContext ctx_value = { ctx };
         ecs_set_ptr(m_world, m_id, EcsContext, &ctx_value);
@@ -3968,11 +4152,11 @@ public:
         ecs_assert(!m_finalized, ECS_INVALID_PARAMETER, NULL);
         auto ctx = new _::action_invoker<Func, Components...>(func);
 
-        create_system(func, _::action_invoker<Func, Components...>::run, false);
-
         EcsContext ctx_value = {ctx};
         ecs_set_ptr(m_world, m_id, EcsContext, &ctx_value);
 
+        create_system(func, _::action_invoker<Func, Components...>::run, false);
+
         return *this;
     }
 
@@ -3984,11 +4168,13 @@ public:
         ecs_assert(!m_finalized, ECS_INVALID_PARAMETER, NULL);
         auto ctx = new _::iter_invoker<Func, Components...>(func);
 
-        create_system(func, _::iter_invoker<Func, Components...>::run, false);
-
+        // Set context before creating the system, so that the invoker can be
+        // obtained from the iterator without a lookup
         EcsContext ctx_value = {ctx};
         ecs_set_ptr(m_world, m_id, EcsContext, &ctx_value);
 
+        create_system(func, _::iter_invoker<Func, Components...>::run, false);
+
         return *this;
     }    
 
@@ -3998,11 +4184,11 @@ public:
     system& each(Func func) {
         auto ctx = new _::each_invoker<Func, Components...>(func);
 
-        create_system(func, _::each_invoker<Func, Components...>::run, true);
-
         EcsContext ctx_value = {ctx};
         ecs_set_ptr(m_world, m_id, EcsContext, &ctx_value);
 
+        create_system(func, _::each_invoker<Func, Components...>::run, true);
+
         return *this;
     }
 
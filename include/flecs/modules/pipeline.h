@@ -152,6 +152,33 @@ FLECS_EXPORT
 int32_t ecs_get_thread_index(
     ecs_world_t *world);
 
+/** Iterate a query in parallel.
+ * This operation splits the tables matched by the query into chunks of at most
+ * chunk_size entities, and invokes the action for each chunk. Chunks are
+ * processed by the calling thread and the worker threads started with
+ * ecs_set_threads. The operation returns when all chunks have been processed.
+ * When no worker threads are running, chunks are processed on the calling
+ * thread.
+ *
+ * The action may be invoked concurrently for different chunks. Operations
+ * that modify the world are deferred, and merged before the operation returns.
+ * The ecs_iter_t::world field contains the thread-specific world, and should be
+ * used for any operation invoked from the action.
+ *
+ * This operation may not be called while the world is progressing.
+ *
+ * @param query The query to iterate.
+ * @param action The action to invoke for each chunk.
+ * @param chunk_size The maximum number of entities per chunk.
+ * @param param User data passed to the action in ecs_iter_t::param.
+ */
+FLECS_EXPORT
+void ecs_query_par_iter(
+    ecs_query_t *query,
+    ecs_iter_action_t action,
+    int32_t chunk_size,
+    void *param);
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //// Module
@@ -32,12 +32,47 @@ typedef struct ecs_memory_stat_t {
     int32_t used_bytes;              /* Memory in use */
 } ecs_memory_stat_t;
 
+/* Number of samples in the rolling window of a latency statistic */
+#ifndef ECS_STAT_WINDOW_SIZE
+#define ECS_STAT_WINDOW_SIZE (128)
+#endif
+
+/* Number of buckets in the histogram of a latency statistic */
+#define ECS_STAT_HISTOGRAM_BUCKETS (20)
+
+/* Type to keep track of latencies over the last ECS_STAT_WINDOW_SIZE frames.
+ * Bucket 0 of the histogram counts samples below 1 microsecond, bucket N 
+ * counts samples between 2^(N-1) and 2^N microseconds. The last bucket counts
+ * all samples that do not fit in the other buckets. */
+typedef struct ecs_latency_stat_t {
+    float window[ECS_STAT_WINDOW_SIZE];     /* Samples (ring buffer) */
+    float sorted[ECS_STAT_WINDOW_SIZE];     /* Samples in window, sorted */
+    int32_t window_index;                   /* Next sample in window */
+    int32_t samples_count;                  /* Number of samples in window */
+    float p50_seconds;                      /* 50th percentile of samples */
+    float p95_seconds;                      /* 95th percentile of samples */
+    float p99_seconds;                      /* 99th percentile of samples */
+    float max_seconds;                      /* Largest sample */
+    int32_t histogram[ECS_STAT_HISTOGRAM_BUCKETS]; /* Samples per bucket */
+} ecs_latency_stat_t;
+
+/* Statistics on memory allocated by a single subsystem */
+typedef struct ecs_alloc_tag_stat_t {
+    int64_t allocd_bytes;            /* Memory currently allocated */
+    int64_t alloc_count_total;       /* Total number of allocations */
+    int64_t realloc_count_total;     /* Total number of reallocations */
+    int64_t free_count_total;        /* Total number of frees */
+    float alloc_rate;                /* Allocations per second */
+    float free_rate;                 /* Frees per second */
+} ecs_alloc_tag_stat_t;
+
 /* Global statistics on memory allocations */
 typedef struct EcsAllocStats {
     int64_t malloc_count_total;      /* Total number of times malloc was invoked */
     int64_t realloc_count_total;     /* Total number of times realloc was invoked */
     int64_t calloc_count_total;      /* Total number of times calloc was invoked */
     int64_t free_count_total;        /* Total number of times free was invoked */
+    ecs_alloc_tag_stat_t tags[EcsAllocTagCount]; /* Statistics per subsystem */
 } EcsAllocStats;
 
 /* Memory statistics on row (reactive) systems */
@@ -91,6 +126,7 @@ typedef struct EcsSystemStats {
     int32_t entities_matched_count;         /* Number of entities matched */
     int64_t invoke_count_total;            /* Number of times system got invoked */
     float seconds_total;                    /* Total time spent in system */
+    ecs_latency_stat_t latency;             /* Time spent in system per frame */
     bool is_enabled;                        /* Is system enabled */
     bool is_active;                         /* Is system active */
     bool is_hidden;                         /* Is system hidden */
@@ -141,6 +177,22 @@ typedef struct EcsWorldStats {
     double merge_seconds_total;            /* Total time spent merging */
     double world_seconds_total;            /* Total time passed since simulation start */
     double fps_hz;                         /* Frames per second (current) */
+    int32_t table_create_count_total;      /* Total number of tables created */
+    int32_t table_delete_count_total;      /* Total number of tables deleted */
+    int64_t table_move_count_total;        /* Total number of entities moved between tables */
+    int64_t table_append_count_total;      /* Total number of rows appended to tables */
+    int64_t table_remove_count_total;      /* Total number of rows removed from tables */
+    int64_t defer_new_count_total;         /* Total number of deferred new/clone operations */
+    int64_t defer_add_count_total;         /* Total number of deferred add operations */
+    int64_t defer_remove_count_total;      /* Total number of deferred remove operations */
+    int64_t defer_set_count_total;         /* Total number of deferred set/mut/modified operations */
+    int64_t defer_delete_count_total;      /* Total number of deferred delete/clear operations */
+    int64_t defer_flush_count_total;       /* Total number of deferred operations executed */
+    int32_t rematch_count_total;           /* Total number of query rematches */
+    int64_t monitor_eval_count_total;      /* Total number of component monitor evaluations */
+    ecs_latency_stat_t frame_latency;      /* Time spent per frame */
+    ecs_latency_stat_t system_latency;     /* Time spent in systems per frame */
+    ecs_latency_stat_t merge_latency;      /* Time spent merging per frame */
 } EcsWorldStats;
 
 /* Stats module component */
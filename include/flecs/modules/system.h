@@ -178,6 +178,36 @@ ecs_entity_t ecs_run_w_filter(
     const ecs_filter_t *filter,
     void *param);
 
+/** Set per-frame budget of a system.
+ * A system with a budget processes at most the specified number of entities, 
+ * or stops after the specified time has passed, when it is ran by the 
+ * pipeline. The next time the system runs, it resumes iterating at the entity 
+ * where the previous run stopped. When all matched entities have been 
+ * processed, the system starts again at the first entity. This spreads the work
+ * of expensive systems out over multiple frames.
+ *
+ * The time budget is evaluated after each batch of entities passed to the 
+ * system, so a single table may exceed it. Combine it with an entity budget to
+ * limit the size of a batch. Where the next run resumes is stored as an offset
+ * in the entities matched by the system, so entities may be skipped or visited 
+ * twice in a pass when entities are added or removed in the meantime.
+ *
+ * Budgets are not applied when the system is ran with ecs_run, or when it is
+ * ran on multiple threads. Setting a budget resets the system to the first 
+ * entity. Pass 0 for both budgets to remove the budget.
+ *
+ * @param world The world.
+ * @param system The system for which to set the budget.
+ * @param entity_budget The maximum number of entities per run, or 0.
+ * @param time_budget The maximum time in seconds per run, or 0.
+ */
+FLECS_EXPORT
+void ecs_set_system_budget(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    int32_t entity_budget,
+    float time_budget);
+
 /** System status change callback */
 typedef enum ecs_system_status_t {
     EcsSystemStatusNone = 0,
@@ -36,6 +36,7 @@ typedef struct EcsRateFilter {
     int32_t rate;
     int32_t tick_count;
     float time_elapsed;   /* Time elapsed since last tick */
+    ecs_ref_t src_ref;    /* Cached reference to tick source of src */
 } EcsRateFilter;
 
 
@@ -141,6 +142,25 @@ void ecs_stop_timer(
     ecs_world_t *world,
     ecs_entity_t timer);
 
+/** Enable timing wheel for timers.
+ * By default every timer is visited each frame to increment its time. When the
+ * timing wheel is enabled, timers are stored in a hierarchical timing wheel and
+ * are only visited when they fire. This makes the cost of a frame depend on the
+ * number of timers that fire, instead of on the number of timers that exist.
+ *
+ * The wheel advances in steps of the provided resolution, and timeouts are 
+ * rounded up to a multiple of the resolution. While the wheel is enabled, the
+ * time member of EcsTimer is only updated when the timer fires. The timing 
+ * wheel cannot be disabled once it has been enabled.
+ *
+ * @param world The world.
+ * @param resolution The duration of a single step of the wheel, in seconds.
+ */
+FLECS_EXPORT
+void ecs_enable_timer_wheel(
+    ecs_world_t *world,
+    float resolution);
+
 /** Set rate filter.
  * This operation sets the source and rate for a rate filter. A rate filter
  * samples another tick source (or frames, if none provided) and ticks when the
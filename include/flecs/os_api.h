@@ -36,6 +36,32 @@ extern int64_t ecs_os_api_realloc_count;
 extern int64_t ecs_os_api_calloc_count;
 extern int64_t ecs_os_api_free_count;
 
+/* Subsystems to which allocated memory is attributed */
+typedef enum ecs_alloc_tag_t {
+    EcsAllocOther,
+    EcsAllocColumns,            /* Table columns, entity and record arrays */
+    EcsAllocEdges,              /* Table graph edge arrays */
+    EcsAllocEntityIndex,        /* Entity index */
+    EcsAllocDefer,              /* Queues with deferred operations */
+    EcsAllocQuery,              /* Queries and their matched tables */
+    EcsAllocMap,                /* Maps */
+    EcsAllocName,               /* Entity names */
+    EcsAllocSnapshot,           /* Snapshots */
+    EcsAllocTagCount
+} ecs_alloc_tag_t;
+
+/* Allocation counters per subsystem. Counters of worker threads are added to
+ * the global counters when the worker stage is merged. Allocations made from
+ * threads not managed by flecs are not synchronized. */
+typedef struct ecs_alloc_tag_stats_t {
+    int64_t alloc_count;        /* Number of allocations */
+    int64_t realloc_count;      /* Number of reallocations */
+    int64_t free_count;         /* Number of frees */
+    int64_t bytes;              /* Bytes currently allocated */
+} ecs_alloc_tag_stats_t;
+
+extern ecs_alloc_tag_stats_t ecs_os_api_alloc_tags[EcsAllocTagCount];
+
 /* Use handle types that _at least_ can store pointers */
 typedef uintptr_t ecs_os_thread_t;
 typedef uintptr_t ecs_os_cond_t;
@@ -254,6 +280,14 @@ void ecs_os_set_api(
 FLECS_EXPORT
 void ecs_os_set_api_defaults(void);
 
+/* Attribute a change in allocated memory to a subsystem. An old_size of 0 
+ * records an allocation, a new_size of 0 records a free. */
+FLECS_EXPORT
+void ecs_os_track_alloc(
+    ecs_alloc_tag_t tag,
+    ecs_size_t old_size,
+    ecs_size_t new_size);
+
 /* Memory management */
 #define ecs_os_malloc(size) ecs_os_api.malloc_(size);
 #define ecs_os_free(ptr) ecs_os_api.free_(ptr);
@@ -272,6 +306,7 @@ void ecs_os_set_api_defaults(void);
 #define ecs_os_strncmp(str1, str2, num) strncmp(str1, str2, (size_t)(num))
 #define ecs_os_memcmp(ptr1, ptr2, num) memcmp(ptr1, ptr2, (size_t)(num))
 #define ecs_os_memcpy(ptr1, ptr2, num) memcpy(ptr1, ptr2, (size_t)(num))
+#define ecs_os_memmove(ptr1, ptr2, num) memmove(ptr1, ptr2, (size_t)(num))
 #define ecs_os_memset(ptr, value, num) memset(ptr, value, (size_t)(num))
 
 #if defined(_MSC_VER)
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <limits.h>
 #include <string.h>
+#include <stddef.h>
 
 /* Non-standard but required. If not provided by platform, add manually. */
 #include <stdint.h>
@@ -59,6 +60,7 @@ typedef uint64_t ecs_flags64_t;
 /* Keep unsigned integers out of the codebase as they do more harm than good */
 typedef int32_t ecs_size_t;
 #define ECS_SIZEOF(T) (ecs_size_t)sizeof(T)
+#define ECS_OFFSETOF(T, member) (ecs_size_t)offsetof(T, member)
 
 /* Use alignof in C++, or a trick in C. */
 #ifdef __cplusplus
@@ -92,6 +94,7 @@ typedef int32_t ecs_size_t;
 #define FLECS__EEcsComponentLifecycle (2)
 #define FLECS__EEcsType (3)
 #define FLECS__EEcsName (6)
+#define FLECS__EEcsChildOf (16)
 
 /** System module component ids */
 #define FLECS__EEcsTrigger (4)
@@ -29,7 +29,8 @@ extern ecs_type_t
     ecs_type(EcsComponent),
     ecs_type(EcsComponentLifecycle),
     ecs_type(EcsType),
-    ecs_type(EcsName);
+    ecs_type(EcsName),
+    ecs_type(EcsChildOf);
 
 /** This allows passing 0 as type to functions that accept types */
 #define FLECS__TNULL 0
@@ -118,7 +119,8 @@ bool ecs_component_has_actions(
 typedef enum ecs_sig_inout_kind_t {
     EcsInOut,
     EcsIn,
-    EcsOut
+    EcsOut,
+    EcsInPrev   /* Read value of double buffered component from last frame */
 } ecs_sig_inout_kind_t;
 
 /** Type that is used by systems to indicate where to fetch a component from */
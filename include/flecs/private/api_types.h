@@ -90,6 +90,8 @@ typedef struct ecs_scope_iter_t {
     ecs_vector_t *tables;
     int32_t index;
     ecs_iter_table_t table;
+    ecs_entity_t parent;
+    ecs_map_iter_t children;    /* Children that store parent in EcsChildOf */
 } ecs_scope_iter_t;
 
 /** Filter-iterator specific data */
@@ -107,6 +109,8 @@ typedef struct ecs_query_iter_t {
     int32_t index;
     int32_t sparse_smallest;
     int32_t sparse_first;
+    int32_t bitset_first;
+    int32_t lookup_first;
 } ecs_query_iter_t;  
 
 /** Query-iterator specific data */
@@ -137,6 +141,7 @@ struct ecs_iter_t {
     ecs_entity_t *entities;       /**< Entity identifiers */
 
     void *param;                  /**< User data (EcsContext or param argument) */
+    void *ctx;                    /**< System context (EcsContext) */
     float delta_time;             /**< Time elapsed since last frame */
     float delta_system_time;      /**< Time elapsed since last system invocation */
     float world_time;             /**< Time elapsed since start of simulation */
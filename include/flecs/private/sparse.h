@@ -2,6 +2,7 @@
 #define FLECS_SPARSE_H
 
 #include "api_defines.h"
+#include "../os_api.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,6 +22,18 @@ void ecs_sparse_set_id_source(
 #define ecs_sparse_new(type)\
     _ecs_sparse_new(sizeof(type))
 
+/** Set number of elements per chunk. Must be a power of two, and may only be
+ * set before the first element is added. */
+FLECS_EXPORT
+void ecs_sparse_set_chunk_size(
+    ecs_sparse_t *sparse,
+    int32_t elem_count);
+
+FLECS_EXPORT
+void ecs_sparse_set_alloc_tag(
+    ecs_sparse_t *sparse,
+    ecs_alloc_tag_t tag);
+
 FLECS_EXPORT
 void ecs_sparse_free(
     ecs_sparse_t *sparse);
@@ -0,0 +1,351 @@
+#include "flecs.h"
+
+#ifdef FLECS_COMMAND_QUEUE
+
+#include "../private_api.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* A slot can be written by the producer that claimed ticket t when its
+ * sequence number is t, and can be read by the world when it is t + 1. 
+ * Tickets are 64 bit unsigned integers so they cannot overflow in practice,
+ * and wrap around without undefined behavior if they do. */
+typedef struct ecs_command_slot_t {
+    uint64_t seq;
+    ecs_op_t op;
+} ecs_command_slot_t;
+
+struct ecs_command_queue_t {
+    ecs_world_t *world;
+    ecs_command_slot_t *slots;
+    uint64_t mask;              /* Number of slots - 1 */
+    uint64_t tail;              /* Next ticket, claimed by producers */
+    uint64_t head;              /* Next ticket to apply, owned by the world */
+};
+
+/* The OS API only provides 32 bit atomic increments, and no operations with
+ * acquire/release ordering. The queue relies on the following operations:
+ *  - a load-acquire of a sequence number, so that the command stored in a slot
+ *    is not read before the sequence number that publishes it
+ *  - a store-release of a sequence number, so that the sequence number is not
+ *    published before the command is written (or copied, for the world)
+ *  - a 64 bit fetch-and-increment to claim tickets */
+#if defined(__GNUC__) || defined(__clang__)
+static
+uint64_t command_load_acquire(
+    uint64_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static
+void command_store_release(
+    uint64_t *ptr,
+    uint64_t value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static
+uint64_t command_fetch_inc(
+    uint64_t *ptr)
+{
+    return __atomic_fetch_add(ptr, 1, __ATOMIC_RELAXED);
+}
+
+static
+void command_pause(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+#elif defined(_MSC_VER)
+static
+uint64_t command_load_acquire(
+    uint64_t *ptr)
+{
+    return (uint64_t)_InterlockedCompareExchange64((volatile __int64*)ptr, 0, 0);
+}
+
+static
+void command_store_release(
+    uint64_t *ptr,
+    uint64_t value)
+{
+    _InterlockedExchange64((volatile __int64*)ptr, (__int64)value);
+}
+
+static
+uint64_t command_fetch_inc(
+    uint64_t *ptr)
+{
+    return (uint64_t)_InterlockedExchangeAdd64((volatile __int64*)ptr, 1);
+}
+
+static
+void command_pause(void)
+{
+#if defined(_M_IX86) || defined(_M_X64)
+    _mm_pause();
+#endif
+}
+#else
+#error "command queue requires atomic operations for this compiler"
+#endif
+
+/* Wait until a slot has the expected sequence number. Spin first, as the
+ * world or another producer is typically about to release the slot, then
+ * back off to sleeping with an increasing interval so that a producer that
+ * waits for a full queue does not occupy a core until the next frame. */
+static
+void command_wait(
+    ecs_command_slot_t *slot,
+    uint64_t seq)
+{
+    int32_t spins = 0;
+    int32_t sleep_ns = 1000;
+
+    while (command_load_acquire(&slot->seq) != seq) {
+        if (spins < 1024) {
+            command_pause();
+            spins ++;
+        } else {
+            ecs_os_sleep(0, sleep_ns);
+            if (sleep_ns < 1000 * 1000) {
+                sleep_ns *= 2;
+            }
+        }
+    }
+}
+
+static
+void command_queue_free(
+    ecs_command_queue_t *queue)
+{
+    /* Discard commands that were not applied */
+    uint64_t head = queue->head;
+    ecs_command_slot_t *slot;
+    while (command_load_acquire(
+        &(slot = &queue->slots[head & queue->mask])->seq) == head + 1) 
+    {
+        ecs_os_free(slot->op.is._1.value);
+        head ++;
+    }
+
+    ecs_os_free(queue->slots);
+    ecs_os_free(queue);
+}
+
+static
+void command_queues_fini(
+    ecs_world_t *world,
+    void *ctx)
+{
+    (void)ctx;
+    ecs_vector_each(world->command_queues, ecs_command_queue_t*, q_ptr, {
+        command_queue_free(*q_ptr);
+    });
+
+    ecs_vector_free(world->command_queues);
+    world->command_queues = NULL;
+}
+
+/* Claim a slot in the queue. If the queue is full, wait until the world has
+ * applied the command that was stored in the slot during the previous lap. */
+static
+ecs_command_slot_t* command_begin(
+    ecs_command_queue_t *queue,
+    ecs_op_kind_t kind,
+    ecs_entity_t entity,
+    ecs_entity_t component)
+{
+    ecs_assert(queue != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
+
+    uint64_t ticket = command_fetch_inc(&queue->tail);
+    ecs_command_slot_t *slot = &queue->slots[ticket & queue->mask];
+
+    command_wait(slot, ticket);
+
+    ecs_op_t *op = &slot->op;
+    ecs_os_memset(op, 0, ECS_SIZEOF(ecs_op_t));
+    op->kind = kind;
+    op->is._1.entity = entity;
+
+    if (component) {
+        op->component = component;
+        op->components.count = 1;
+    }
+
+    return slot;
+}
+
+/* Publish the command to the world. Only the producer that claimed the slot
+ * writes the sequence number at this point, so it does not have to be read
+ * atomically. The release store publishes the command with it. */
+static
+void command_end(
+    ecs_command_slot_t *slot)
+{
+    command_store_release(&slot->seq, slot->seq + 1);
+}
+
+/* -- Private functions -- */
+
+void ecs_command_queues_flush(
+    ecs_world_t *world)
+{
+    ecs_vector_each(world->command_queues, ecs_command_queue_t*, q_ptr, {
+        ecs_command_queue_flush(*q_ptr);
+    });
+}
+
+/* -- Public functions -- */
+
+ecs_command_queue_t* ecs_command_queue_new(
+    ecs_world_t *world,
+    int32_t capacity)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(capacity > 0, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_command_queue_t *result = ecs_os_calloc(
+        ECS_SIZEOF(ecs_command_queue_t));
+    ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    /* At least two slots are needed to tell a full slot from an empty one */
+    int32_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    result->world = world;
+    result->mask = (uint64_t)(size - 1);
+    result->slots = ecs_os_malloc(ECS_SIZEOF(ecs_command_slot_t) * size);
+    ecs_assert(result->slots != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    int32_t i;
+    for (i = 0; i < size; i ++) {
+        result->slots[i].seq = (uint64_t)i;
+    }
+
+    /* Only register fini action for the first queue */
+    if (!world->command_queues) {
+        ecs_atfini(world, command_queues_fini, NULL);
+    }
+
+    ecs_command_queue_t **elem = ecs_vector_add(
+        &world->command_queues, ecs_command_queue_t*);
+    *elem = result;
+
+    return result;
+}
+
+void ecs_command_queue_free(
+    ecs_command_queue_t *queue)
+{
+    ecs_world_t *world = queue->world;
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+
+    ecs_vector_each(world->command_queues, ecs_command_queue_t*, q_ptr, {
+        if (*q_ptr == queue) {
+            ecs_vector_remove_index(
+                world->command_queues, ecs_command_queue_t*, q_ptr_i);
+            break;
+        }
+    });
+
+    command_queue_free(queue);
+}
+
+int32_t ecs_command_queue_flush(
+    ecs_command_queue_t *queue)
+{
+    ecs_world_t *world = queue->world;
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+
+    ecs_stage_t *stage = &world->stage;
+    uint64_t head = queue->head;
+    int32_t count = 0;
+    ecs_command_slot_t *slot;
+
+    ecs_defer_begin(world);
+
+    while (command_load_acquire(
+        &(slot = &queue->slots[head & queue->mask])->seq) == head + 1) 
+    {
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
+        *op = slot->op;
+
+        /* The value is owned by the defer queue from here on */
+        if (op->is._1.value) {
+            ecs_os_track_alloc(EcsAllocDefer, 0, op->is._1.size);
+        }
+
+        /* Release the slot to the producer of the next lap. The release
+         * store guarantees that the producer cannot see the slot as writable
+         * before the command has been copied. */
+        command_store_release(&slot->seq, head + queue->mask + 1);
+
+        head ++;
+        count ++;
+    }
+
+    queue->head = head;
+
+    ecs_defer_end(world);
+
+    return count;
+}
+
+void ecs_command_add_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t to_add)
+{
+    command_end(command_begin(queue, EcsOpAdd, entity, to_add));
+}
+
+void ecs_command_remove_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t to_remove)
+{
+    command_end(command_begin(queue, EcsOpRemove, entity, to_remove));
+}
+
+void ecs_command_set_ptr_w_entity(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    size_t size,
+    const void *ptr)
+{
+    ecs_assert(ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(size != 0, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_command_slot_t *slot = command_begin(
+        queue, EcsOpSet, entity, component);
+
+    ecs_size_t value_size = ecs_from_size_t(size);
+    slot->op.is._1.size = value_size;
+    slot->op.is._1.value = ecs_os_memdup(ptr, value_size);
+
+    command_end(slot);
+}
+
+void ecs_command_delete(
+    ecs_command_queue_t *queue,
+    ecs_entity_t entity)
+{
+    command_end(command_begin(queue, EcsOpDelete, entity, 0));
+}
+
+#endif
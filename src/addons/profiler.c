@@ -0,0 +1,336 @@
+#include "flecs.h"
+
+#ifdef FLECS_PROFILER
+
+#include "../private_api.h"
+
+/* Ring buffer with spans for a single thread. Only the thread that owns the
+ * ring buffer writes to it, so spans can be recorded without locking. */
+typedef struct ecs_span_ring_t {
+    ecs_span_t *spans;
+    uint64_t head;              /* Total number of spans written */
+} ecs_span_ring_t;
+
+struct ecs_profiler_t {
+    ecs_time_t start;           /* Time at which the profiler was enabled */
+    int32_t size;               /* Number of spans per ring (power of 2) */
+    int32_t ring_count;         /* Number of rings (main thread + workers) */
+    ecs_span_ring_t *rings;
+};
+
+static
+const char *span_kind_str[] = {
+    [EcsSpanFrame] = "frame",
+    [EcsSpanSystem] = "system",
+    [EcsSpanMerge] = "merge",
+    [EcsSpanSync] = "sync",
+    [EcsSpanDeferFlush] = "defer_flush",
+    [EcsSpanPipelineBuild] = "pipeline_build",
+    [EcsSpanTableCreate] = "table_create"
+};
+
+static
+void init_rings(
+    ecs_profiler_t *profiler,
+    int32_t count)
+{
+    if (count <= profiler->ring_count) {
+        return;
+    }
+
+    profiler->rings = ecs_os_realloc(
+        profiler->rings, ECS_SIZEOF(ecs_span_ring_t) * count);
+    ecs_assert(profiler->rings != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    int32_t i;
+    for (i = profiler->ring_count; i < count; i ++) {
+        ecs_span_ring_t *ring = &profiler->rings[i];
+        ring->spans = ecs_os_malloc(ECS_SIZEOF(ecs_span_t) * profiler->size);
+        ecs_assert(ring->spans != NULL, ECS_OUT_OF_MEMORY, NULL);
+        ring->head = 0;
+    }
+
+    profiler->ring_count = count;
+}
+
+static
+void profiler_free(
+    ecs_profiler_t *profiler)
+{
+    int32_t i;
+    for (i = 0; i < profiler->ring_count; i ++) {
+        ecs_os_free(profiler->rings[i].spans);
+    }
+
+    ecs_os_free(profiler->rings);
+    ecs_os_free(profiler);
+}
+
+static
+void profiler_fini(
+    ecs_world_t *world,
+    void *ctx)
+{
+    (void)ctx;
+    if (world->profiler) {
+        profiler_free(world->profiler);
+        world->profiler = NULL;
+    }
+}
+
+static
+uint64_t time_to_ns(
+    ecs_time_t t)
+{
+    return (uint64_t)t.sec * 1000000000 + t.nanosec;
+}
+
+static
+int32_t ring_count(
+    ecs_span_ring_t *ring,
+    int32_t size)
+{
+    if (ring->head > (uint64_t)size) {
+        return size;
+    } else {
+        return (int32_t)ring->head;
+    }
+}
+
+static
+void append_span_name(
+    ecs_world_t *world,
+    ecs_strbuf_t *buf,
+    const ecs_span_t *span)
+{
+    switch(span->kind) {
+    case EcsSpanSystem:
+    case EcsSpanPipelineBuild: {
+        const char *name = NULL;
+        if (ecs_is_alive(world, span->id)) {
+            name = ecs_get_name(world, span->id);
+        }
+        if (name) {
+            ecs_strbuf_appendstr(buf, name);
+        } else {
+            ecs_strbuf_append(buf, "%u", (uint32_t)span->id);
+        }
+        break;
+    }
+    case EcsSpanTableCreate: {
+        ecs_table_t *table = ecs_sparse_get_sparse(
+            world->store.tables, ecs_table_t, span->id);
+        if (table) {
+            char *type_str = ecs_type_str(world, table->type);
+            ecs_strbuf_append(buf, "[%s]", type_str);
+            ecs_os_free(type_str);
+        } else {
+            ecs_strbuf_append(buf, "table %u", (uint32_t)span->id);
+        }
+        break;
+    }
+    default:
+        ecs_strbuf_appendstr(buf, span_kind_str[span->kind]);
+        break;
+    }
+}
+
+/* -- Private functions -- */
+
+uint64_t ecs_profiler_now(
+    ecs_world_t *world)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (!profiler) {
+        return 0;
+    }
+
+    ecs_time_t t;
+    ecs_os_get_time(&t);
+
+    /* Offset by 1 so that a valid timestamp is never 0 */
+    return time_to_ns(t) - time_to_ns(profiler->start) + 1;
+}
+
+void ecs_profiler_record(
+    ecs_world_t *world,
+    ecs_stage_t *stage,
+    ecs_span_kind_t kind,
+    ecs_entity_t id,
+    uint64_t start)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (!profiler) {
+        return;
+    }
+
+    /* Stage 0 and 1 are used by the main thread, worker stages start at 2 */
+    int32_t thread = stage->id > 1 ? stage->id - 1 : 0;
+    if (thread >= profiler->ring_count) {
+        return;
+    }
+
+    uint64_t now = ecs_profiler_now(world);
+
+    ecs_span_ring_t *ring = &profiler->rings[thread];
+    uint64_t mask = (uint64_t)(profiler->size - 1);
+    ecs_span_t *span = &ring->spans[ring->head & mask];
+    span->kind = kind;
+    span->thread = thread;
+    span->id = id;
+    span->start = start - 1;
+    span->duration = now - start;
+    ring->head ++;
+}
+
+void ecs_profiler_set_threads(
+    ecs_world_t *world,
+    int32_t threads)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (profiler) {
+        init_rings(profiler, 1 + threads);
+    }
+}
+
+/* -- Public functions -- */
+
+void ecs_profiler_enable(
+    ecs_world_t *world,
+    int32_t span_count)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(span_count >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
+
+    if (world->profiler) {
+        profiler_free(world->profiler);
+        world->profiler = NULL;
+    }
+
+    /* Only register fini action the first time the profiler is enabled */
+    if (span_count && !world->profiler_fini_set) {
+        ecs_atfini(world, profiler_fini, NULL);
+        world->profiler_fini_set = true;
+    }
+
+    if (!span_count) {
+        return;
+    }
+
+    ecs_profiler_t *profiler = ecs_os_calloc(ECS_SIZEOF(ecs_profiler_t));
+    ecs_assert(profiler != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    profiler->size = 1;
+    while (profiler->size < span_count) {
+        profiler->size *= 2;
+    }
+
+    ecs_os_get_time(&profiler->start);
+    init_rings(profiler, 1 + ecs_vector_count(world->workers));
+
+    world->profiler = profiler;
+}
+
+bool ecs_profiler_is_enabled(
+    ecs_world_t *world)
+{
+    return world->profiler != NULL;
+}
+
+void ecs_profiler_clear(
+    ecs_world_t *world)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (profiler) {
+        int32_t i;
+        for (i = 0; i < profiler->ring_count; i ++) {
+            profiler->rings[i].head = 0;
+        }
+    }
+}
+
+int32_t ecs_profiler_thread_count(
+    ecs_world_t *world)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (profiler) {
+        return profiler->ring_count;
+    } else {
+        return 0;
+    }
+}
+
+int32_t ecs_profiler_span_count(
+    ecs_world_t *world,
+    int32_t thread)
+{
+    ecs_profiler_t *profiler = world->profiler;
+    if (!profiler || thread < 0 || thread >= profiler->ring_count) {
+        return 0;
+    }
+
+    return ring_count(&profiler->rings[thread], profiler->size);
+}
+
+const ecs_span_t* ecs_profiler_get_span(
+    ecs_world_t *world,
+    int32_t thread,
+    int32_t index)
+{
+    int32_t count = ecs_profiler_span_count(world, thread);
+    if (index < 0 || index >= count) {
+        return NULL;
+    }
+
+    ecs_profiler_t *profiler = world->profiler;
+    ecs_span_ring_t *ring = &profiler->rings[thread];
+    uint64_t mask = (uint64_t)(profiler->size - 1);
+    uint64_t first = ring->head - (uint64_t)count;
+
+    return &ring->spans[(first + (uint64_t)index) & mask];
+}
+
+char* ecs_profiler_to_json(
+    ecs_world_t *world)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+
+    ecs_strbuf_t buf = ECS_STRBUF_INIT;
+    ecs_strbuf_appendstr(&buf, "{\"traceEvents\":[");
+
+    int32_t t, thread_count = ecs_profiler_thread_count(world);
+    for (t = 0; t < thread_count; t ++) {
+        if (t) {
+            ecs_strbuf_appendstr(&buf, ",");
+            ecs_strbuf_append(&buf,
+                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+                "\"args\":{\"name\":\"worker %d\"}}", t, t - 1);
+        } else {
+            ecs_strbuf_appendstr(&buf,
+                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,"
+                "\"args\":{\"name\":\"main\"}}");
+        }
+
+        int32_t i, count = ecs_profiler_span_count(world, t);
+        for (i = 0; i < count; i ++) {
+            const ecs_span_t *span = ecs_profiler_get_span(world, t, i);
+            ecs_strbuf_appendstr(&buf, ",{\"name\":\"");
+            append_span_name(world, &buf, span);
+            ecs_strbuf_append(&buf,
+                "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":0,\"tid\":%d}",
+                span_kind_str[span->kind],
+                (double)span->start / 1000.0,
+                (double)span->duration / 1000.0,
+                span->thread);
+        }
+    }
+
+    ecs_strbuf_appendstr(&buf, "]}");
+
+    return ecs_strbuf_get(&buf);
+}
+
+#endif
@@ -11,6 +11,7 @@ struct ecs_snapshot_t {
     ecs_vector_t *tables;
     ecs_entity_t last_id;
     ecs_filter_t filter;
+    ecs_size_t alloc_bytes;
 };
 
 static
@@ -72,9 +73,87 @@ ecs_data_t* duplicate_data(
         }
     }
 
+    /* Copy bitset columns */
+    int32_t bs_column_count = table->bs_column_count;
+    if (bs_column_count) {
+        result->bs_columns = ecs_os_memdup(main_data->bs_columns, 
+            ECS_SIZEOF(ecs_bs_column_t) * bs_column_count);
+
+        for (i = 0; i < bs_column_count; i ++) {
+            ecs_bitset_t *bs = &result->bs_columns[i].data;
+            if (bs->size) {
+                bs->data = ecs_os_memdup(bs->data, bs->size / 8);
+            }
+        }
+    }
+
+    /* Copy field columns */
+    int32_t soa_column_count = table->soa_column_count;
+    if (soa_column_count) {
+        result->soa_columns = ecs_os_memdup(main_data->soa_columns, 
+            ECS_SIZEOF(ecs_column_t) * soa_column_count);
+
+        for (i = 0; i < soa_column_count; i ++) {
+            ecs_column_t *column = &result->soa_columns[i];
+            column->data = ecs_vector_copy_t(
+                column->data, column->size, column->alignment);
+        }
+    }
+
+    /* Copy double buffered columns */
+    if (main_data->prev_columns) {
+        result->prev_columns = ecs_os_memdup(main_data->prev_columns, 
+            ECS_SIZEOF(ecs_column_t) * column_count);
+
+        for (i = 0; i < column_count; i ++) {
+            ecs_column_t *column = &result->prev_columns[i];
+            if (column->size) {
+                column->data = ecs_vector_copy_t(
+                    column->data, column->size, column->alignment);
+            }
+        }
+    }
+
     return result;
 }
 
+static
+void free_data(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_data_t *data)
+{
+    int32_t i, column_count = table->column_count;
+    ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+
+    /* Destruct components that were copied into the snapshot. Columns of
+     * components without a copy action are shallow copies of the table data,
+     * which is still owned by the world. */
+    for (i = 0; i < column_count; i ++) {
+        ecs_entity_t component = components[i];
+        ecs_column_t *column = &data->columns[i];
+        int32_t count = ecs_vector_count(column->data);
+
+        if (component > ECS_HI_COMPONENT_ID || !count) {
+            continue;
+        }
+
+        ecs_c_info_t *cdata = ecs_get_c_info(world, component);
+        ecs_xtor_t dtor;
+        if (cdata && cdata->lifecycle.copy &&
+            (dtor = cdata->lifecycle.dtor))
+        {
+            void *ptr = ecs_vector_first_t(
+                column->data, column->size, column->alignment);
+            dtor(world, component, entities, ptr, ecs_to_size_t(column->size), 
+                count, cdata->lifecycle.ctx);
+        }
+    }
+
+    ecs_table_clear_data(table, data);
+}
+
 static
 ecs_snapshot_t* snapshot_create(
     ecs_world_t *world,
@@ -92,6 +171,7 @@ ecs_snapshot_t* snapshot_create(
      * entirely upon snapshote restore. */
     if (!iter && entity_index) {
         result->entity_index = ecs_sparse_copy(entity_index);
+        ecs_sparse_set_alloc_tag(result->entity_index, EcsAllocSnapshot);
         result->tables = ecs_vector_new(ecs_table_leaf_t, 0);
     }
 
@@ -127,8 +207,14 @@ ecs_snapshot_t* snapshot_create(
         l->table = t;
         l->type = t->type;
         l->data = duplicate_data(world, t, data);
+        result->alloc_bytes += ECS_SIZEOF(ecs_data_t) + 
+            ecs_table_data_alloc_bytes(t, l->data);
     }
 
+    result->alloc_bytes += ECS_SIZEOF(ecs_snapshot_t) + 
+        ecs_vector_size(result->tables) * ECS_SIZEOF(ecs_table_leaf_t);
+    ecs_os_track_alloc(EcsAllocSnapshot, 0, result->alloc_bytes);
+
     return result;
 }
 
@@ -173,6 +259,10 @@ void ecs_snapshot_restore(
 {
     bool is_filtered = true;
 
+    /* Table data is either moved to or merged with the world tables, which 
+     * report their own memory */
+    ecs_os_track_alloc(EcsAllocSnapshot, snapshot->alloc_bytes, 0);
+
     if (snapshot->entity_index) {
         ecs_sparse_restore(world->store.entity_index, snapshot->entity_index);
         ecs_sparse_free(snapshot->entity_index);
@@ -278,6 +368,13 @@ void ecs_snapshot_restore(
         }
     }
 
+    /* Table data was restored without invoking component actions, so the
+     * EcsChildOf index has to be rebuilt from the restored data */
+    ecs_childof_index_rebuild(world);
+
+    /* Restored entities could be bases */
+    world->base_cache_version ++;
+
     ecs_vector_free(snapshot->tables);   
 
     ecs_os_free(snapshot);
@@ -339,12 +436,13 @@ void ecs_snapshot_free(
     ecs_snapshot_t *snapshot)
 {
     ecs_sparse_free(snapshot->entity_index);
+    ecs_os_track_alloc(EcsAllocSnapshot, snapshot->alloc_bytes, 0);
 
     ecs_table_leaf_t *tables = ecs_vector_first(snapshot->tables, ecs_table_leaf_t);
     int32_t i, count = ecs_vector_count(snapshot->tables);
     for (i = 0; i < count; i ++) {
         ecs_table_leaf_t *leaf = &tables[i];
-        ecs_table_clear_data(leaf->table, leaf->data);
+        free_data(snapshot->world, leaf->table, leaf->data);
         ecs_os_free(leaf->data);
     }    
 
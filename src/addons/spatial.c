@@ -0,0 +1,632 @@
+#include "flecs.h"
+
+#ifdef FLECS_SPATIAL
+
+#include "../private_api.h"
+
+/* Cell coordinates are clamped to this range, so that they can be packed in a
+ * single map key. Entities outside of the range are stored in the edge cells */
+#define SPATIAL_CELL_LIMIT (1 << 20)
+#define SPATIAL_CELL_BITS (21)
+
+typedef struct ecs_spatial_point_t {
+    float v[3];
+} ecs_spatial_point_t;
+
+typedef struct ecs_spatial_cell_t {
+    int32_t coord[3];
+    ecs_vector_t *entities;     /* Entities in cell */
+    ecs_vector_t *points;       /* Positions of entities, same order */
+} ecs_spatial_cell_t;
+
+/* Location of an entity in the grid */
+typedef struct ecs_spatial_elem_t {
+    uint64_t cell;
+    int32_t index;
+} ecs_spatial_elem_t;
+
+struct ecs_spatial_t {
+    ecs_world_t *world;
+    ecs_entity_t component;
+    ecs_size_t offset[3];       /* Offsets of position members */
+    int32_t dim;                /* 2 or 3 */
+    float cell_size;
+    ecs_map_t *cells;           /* Cells by packed coordinates */
+    ecs_map_t *entities;        /* Location of entities in grid */
+    ecs_entity_t on_set;        /* System that inserts or moves entities */
+    ecs_entity_t un_set;        /* System that removes entities */
+    char *expr;                 /* Signature of systems */
+};
+
+/* Convert a position to a cell coordinate. Values outside of the range of the
+ * grid, including infinities, are clamped before they are converted to an
+ * integer, as the conversion is undefined for values that don't fit. NaN is
+ * mapped to the lower edge cell, though points with NaN coordinates are not
+ * stored in the index. */
+static
+int32_t spatial_coord(
+    float cell_size,
+    float value)
+{
+    float f = value / cell_size;
+    if (!(f >= (float)-SPATIAL_CELL_LIMIT)) {
+        return -SPATIAL_CELL_LIMIT;
+    }
+    if (f >= (float)(SPATIAL_CELL_LIMIT - 1)) {
+        return SPATIAL_CELL_LIMIT - 1;
+    }
+
+    int32_t result = (int32_t)f;
+    if ((float)result > f) {
+        result --;
+    }
+
+    return result;
+}
+
+static
+uint64_t spatial_key(
+    const int32_t *coord)
+{
+    uint64_t x = (uint64_t)(coord[0] + SPATIAL_CELL_LIMIT);
+    uint64_t y = (uint64_t)(coord[1] + SPATIAL_CELL_LIMIT);
+    uint64_t z = (uint64_t)(coord[2] + SPATIAL_CELL_LIMIT);
+    return (x << (SPATIAL_CELL_BITS * 2)) | (y << SPATIAL_CELL_BITS) | z;
+}
+
+static
+void spatial_remove(
+    ecs_spatial_t *index,
+    ecs_entity_t entity)
+{
+    ecs_spatial_elem_t *elem = ecs_map_get(
+        index->entities, ecs_spatial_elem_t, entity);
+    if (!elem) {
+        return;
+    }
+
+    uint64_t key = elem->cell;
+    int32_t row = elem->index;
+
+    ecs_spatial_cell_t *cell = ecs_map_get(
+        index->cells, ecs_spatial_cell_t, key);
+    ecs_assert(cell != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* The last entity in the cell is moved into the removed element */
+    int32_t count = ecs_vector_remove_index(
+        cell->entities, ecs_entity_t, row);
+    ecs_vector_remove_index(cell->points, ecs_spatial_point_t, row);
+
+    if (row != count) {
+        ecs_entity_t moved = *ecs_vector_get(cell->entities, ecs_entity_t, row);
+        ecs_spatial_elem_t *moved_elem = ecs_map_get(
+            index->entities, ecs_spatial_elem_t, moved);
+        ecs_assert(moved_elem != NULL, ECS_INTERNAL_ERROR, NULL);
+        moved_elem->index = row;
+    }
+
+    /* Remove empty cells, so that iterating the grid does not visit them */
+    if (!count) {
+        ecs_vector_free(cell->entities);
+        ecs_vector_free(cell->points);
+        ecs_map_remove(index->cells, key);
+    }
+
+    ecs_map_remove(index->entities, entity);
+}
+
+static
+void spatial_update(
+    ecs_spatial_t *index,
+    ecs_entity_t entity,
+    const ecs_spatial_point_t *point)
+{
+    int32_t coord[3] = {0};
+    int32_t i;
+    for (i = 0; i < index->dim; i ++) {
+        /* A point with a NaN coordinate is not in any region. Remove it from
+         * the index, as NaN fails every bounds check of a query. */
+        if (point->v[i] != point->v[i]) {
+            spatial_remove(index, entity);
+            return;
+        }
+
+        coord[i] = spatial_coord(index->cell_size, point->v[i]);
+    }
+
+    uint64_t key = spatial_key(coord);
+    ecs_spatial_cell_t *cell;
+
+    ecs_spatial_elem_t *elem = ecs_map_get(
+        index->entities, ecs_spatial_elem_t, entity);
+    if (elem) {
+        if (elem->cell == key) {
+            /* Entity did not leave its cell, only update the position */
+            cell = ecs_map_get(index->cells, ecs_spatial_cell_t, key);
+            ecs_assert(cell != NULL, ECS_INTERNAL_ERROR, NULL);
+            *ecs_vector_get(cell->points, ecs_spatial_point_t, elem->index) =
+                *point;
+            return;
+        }
+
+        spatial_remove(index, entity);
+    }
+
+    cell = ecs_map_get(index->cells, ecs_spatial_cell_t, key);
+    if (!cell) {
+        ecs_spatial_cell_t new_cell = {
+            .coord = {coord[0], coord[1], coord[2]}
+        };
+        ecs_map_set(index->cells, key, &new_cell);
+        cell = ecs_map_get(index->cells, ecs_spatial_cell_t, key);
+    }
+
+    ecs_entity_t *e_ptr = ecs_vector_add(&cell->entities, ecs_entity_t);
+    *e_ptr = entity;
+    ecs_spatial_point_t *p_ptr = ecs_vector_add(
+        &cell->points, ecs_spatial_point_t);
+    *p_ptr = *point;
+
+    ecs_map_set(index->entities, entity, &((ecs_spatial_elem_t){
+        .cell = key,
+        .index = ecs_vector_count(cell->entities) - 1
+    }));
+}
+
+static
+void spatial_update_column(
+    ecs_spatial_t *index,
+    const ecs_entity_t *entities,
+    void *base,
+    ecs_size_t size,
+    int32_t count)
+{
+    int32_t i, d;
+    for (i = 0; i < count; i ++) {
+        void *ptr = ECS_OFFSET(base, size * i);
+        ecs_spatial_point_t point = {{0}};
+        for (d = 0; d < index->dim; d ++) {
+            point.v[d] = *(float*)ECS_OFFSET(ptr, index->offset[d]);
+        }
+
+        spatial_update(index, entities[i], &point);
+    }
+}
+
+/* Insert entities for which the component was set before the index existed */
+static
+void spatial_populate(
+    ecs_spatial_t *index)
+{
+    ecs_world_t *world = index->world;
+    ecs_sparse_t *tables = world->store.tables;
+
+    int32_t i, count = ecs_sparse_count(tables);
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        if (table->flags & (EcsTableIsPrefab | EcsTableIsDisabled)) {
+            continue;
+        }
+
+        ecs_data_t *data = ecs_table_get_data(table);
+        int32_t column = ecs_type_index_of(table->type, index->component);
+        if (!data || column == -1 || column >= table->column_count ||
+            !ecs_table_data_count(data))
+        {
+            continue;
+        }
+
+        ecs_column_t *c = &data->columns[column];
+        spatial_update_column(index,
+            ecs_vector_first(data->entities, ecs_entity_t),
+            ecs_vector_first_t(c->data, c->size, c->alignment),
+            c->size, ecs_table_data_count(data));
+    }
+}
+
+/* Insert or move entities for which the component is set or modified */
+static
+void SpatialSet(
+    ecs_iter_t *it)
+{
+    ecs_spatial_t *index = it->ctx;
+    spatial_update_column(index, it->entities, ecs_column_w_size(it, 0, 1),
+        ecs_from_size_t(ecs_column_size(it, 1)), it->count);
+}
+
+/* Remove entities for which the component is removed or deleted */
+static
+void SpatialUnSet(
+    ecs_iter_t *it)
+{
+    ecs_spatial_t *index = it->ctx;
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        spatial_remove(index, it->entities[i]);
+    }
+}
+
+static
+ecs_entity_t spatial_new_system(
+    ecs_world_t *world,
+    ecs_spatial_t *index,
+    ecs_entity_t kind,
+    ecs_iter_action_t action)
+{
+    ecs_entity_t result = ecs_new(world, 0);
+    ecs_set(world, result, EcsContext, {index});
+    return ecs_new_system(world, result, NULL, kind, index->expr, action);
+}
+
+static
+void spatial_clear(
+    ecs_spatial_t *index)
+{
+    ecs_map_each(index->cells, ecs_spatial_cell_t, key, cell, {
+        ecs_vector_free(cell->entities);
+        ecs_vector_free(cell->points);
+    });
+
+    ecs_map_free(index->cells);
+    ecs_map_free(index->entities);
+    index->cells = NULL;
+    index->entities = NULL;
+}
+
+static
+void spatial_free(
+    ecs_spatial_t *index)
+{
+    spatial_clear(index);
+    ecs_os_free(index->expr);
+    ecs_os_free(index);
+}
+
+static
+void spatial_indices_fini(
+    ecs_world_t *world,
+    void *ctx)
+{
+    (void)ctx;
+    ecs_vector_each(world->spatial_indices, ecs_spatial_t*, i_ptr, {
+        spatial_free(*i_ptr);
+    });
+
+    ecs_vector_free(world->spatial_indices);
+    world->spatial_indices = NULL;
+}
+
+/* Find the next cell in the queried range that is not empty */
+static
+ecs_spatial_cell_t* spatial_next_cell(
+    ecs_spatial_iter_t *it)
+{
+    ecs_spatial_t *index = it->index;
+    ecs_spatial_cell_t *cell;
+
+    if (it->walk_cells) {
+        ecs_map_key_t key;
+        while ((cell = ecs_map_next(
+            &it->cells_iter, ecs_spatial_cell_t, &key)))
+        {
+            int32_t d;
+            for (d = 0; d < 3; d ++) {
+                if (cell->coord[d] < it->cell_min[d] ||
+                    cell->coord[d] > it->cell_max[d])
+                {
+                    break;
+                }
+            }
+
+            if (d == 3) {
+                return cell;
+            }
+        }
+
+        return NULL;
+    }
+
+    int32_t *cur = it->cell;
+    while (cur[2] <= it->cell_max[2]) {
+        uint64_t key = spatial_key(cur);
+
+        if (++ cur[0] > it->cell_max[0]) {
+            cur[0] = it->cell_min[0];
+            if (++ cur[1] > it->cell_max[1]) {
+                cur[1] = it->cell_min[1];
+                cur[2] ++;
+            }
+        }
+
+        cell = ecs_map_get(index->cells, ecs_spatial_cell_t, key);
+        if (cell) {
+            return cell;
+        }
+    }
+
+    return NULL;
+}
+
+/* Test if all points in a cell are in the queried region. Edge cells contain
+ * points outside of their bounds, and are always filtered. */
+static
+bool spatial_cell_inside(
+    const ecs_spatial_iter_t *it,
+    const ecs_spatial_cell_t *cell)
+{
+    float cell_size = it->index->cell_size;
+    float dist_sq = 0;
+
+    int32_t d;
+    for (d = 0; d < it->index->dim; d ++) {
+        int32_t coord = cell->coord[d];
+        if (coord == -SPATIAL_CELL_LIMIT || coord == SPATIAL_CELL_LIMIT - 1) {
+            return false;
+        }
+
+        float lo = (float)coord * cell_size;
+        float hi = (float)(coord + 1) * cell_size;
+
+        if (it->radius > 0) {
+            float d_lo = lo - it->center[d], d_hi = hi - it->center[d];
+            d_lo *= d_lo;
+            d_hi *= d_hi;
+            dist_sq += d_lo > d_hi ? d_lo : d_hi;
+        } else if (lo <= it->min[d] || hi >= it->max[d]) {
+            return false;
+        }
+    }
+
+    return it->radius == 0 || dist_sq < it->radius * it->radius;
+}
+
+static
+bool spatial_point_inside(
+    const ecs_spatial_iter_t *it,
+    const ecs_spatial_point_t *point)
+{
+    float dist_sq = 0;
+
+    int32_t d;
+    for (d = 0; d < it->index->dim; d ++) {
+        float v = point->v[d];
+        if (v < it->min[d] || v > it->max[d]) {
+            return false;
+        }
+
+        if (it->radius > 0) {
+            float delta = v - it->center[d];
+            dist_sq += delta * delta;
+        }
+    }
+
+    return it->radius == 0 || dist_sq <= it->radius * it->radius;
+}
+
+static
+ecs_spatial_iter_t spatial_iter(
+    ecs_spatial_t *index,
+    const float *min,
+    const float *max)
+{
+    ecs_assert(index != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_spatial_iter_t it = {
+        .index = index
+    };
+
+    /* Number of cells that overlap with the region */
+    double cell_count = 1;
+
+    int32_t d;
+    for (d = 0; d < index->dim; d ++) {
+        ecs_assert(min[d] <= max[d], ECS_INVALID_PARAMETER, NULL);
+        it.min[d] = min[d];
+        it.max[d] = max[d];
+        it.cell_min[d] = spatial_coord(index->cell_size, min[d]);
+        it.cell_max[d] = spatial_coord(index->cell_size, max[d]);
+        cell_count *= (double)(it.cell_max[d] - it.cell_min[d] + 1);
+    }
+
+    /* If the region is large compared to the number of occupied cells, it is
+     * cheaper to visit all cells than to look up each cell in the region */
+    if (cell_count > (double)ecs_map_count(index->cells)) {
+        it.walk_cells = true;
+        it.cells_iter = ecs_map_iter(index->cells);
+    } else {
+        it.cell[0] = it.cell_min[0];
+        it.cell[1] = it.cell_min[1];
+        it.cell[2] = it.cell_min[2];
+    }
+
+    return it;
+}
+
+/* -- Public functions -- */
+
+ecs_spatial_t* ecs_spatial_new_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    ecs_size_t x_offset,
+    ecs_size_t y_offset,
+    ecs_size_t z_offset,
+    float cell_size)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(cell_size > 0, ECS_INVALID_PARAMETER, NULL);
+
+    const EcsComponent *cptr = ecs_get(world, component, EcsComponent);
+    ecs_assert(cptr != NULL, ECS_INVALID_COMPONENT_ID, NULL);
+    ecs_assert(x_offset >= 0 && x_offset + ECS_SIZEOF(float) <= cptr->size,
+        ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(y_offset >= 0 && y_offset + ECS_SIZEOF(float) <= cptr->size,
+        ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(z_offset + ECS_SIZEOF(float) <= cptr->size,
+        ECS_INVALID_PARAMETER, NULL);
+    (void)cptr;
+
+    /* Positions are read from table columns */
+    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
+    ecs_assert(!c_info || (!c_info->sparse && !c_info->fields),
+        ECS_INVALID_COMPONENT_ID, NULL);
+    (void)c_info;
+
+    char *path = ecs_get_fullpath(world, component);
+    ecs_assert(path != NULL, ECS_INVALID_COMPONENT_ID, NULL);
+
+    ecs_strbuf_t buf = ECS_STRBUF_INIT;
+    ecs_strbuf_append(&buf, "OWNED:%s", path);
+    ecs_os_free(path);
+
+    ecs_spatial_t *result = ecs_os_calloc(ECS_SIZEOF(ecs_spatial_t));
+    ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    result->world = world;
+    result->component = component;
+    result->offset[0] = x_offset;
+    result->offset[1] = y_offset;
+    result->offset[2] = z_offset;
+    result->dim = z_offset < 0 ? 2 : 3;
+    result->cell_size = cell_size;
+    result->cells = ecs_map_new(ecs_spatial_cell_t, 0);
+    result->entities = ecs_map_new(ecs_spatial_elem_t, 0);
+    result->expr = ecs_strbuf_get(&buf);
+
+    /* Only register fini action for the first index */
+    if (!world->spatial_indices) {
+        ecs_atfini(world, spatial_indices_fini, NULL);
+    }
+
+    ecs_spatial_t **elem = ecs_vector_add(
+        &world->spatial_indices, ecs_spatial_t*);
+    *elem = result;
+
+    result->on_set = spatial_new_system(world, result, EcsOnSet, SpatialSet);
+    result->un_set = spatial_new_system(
+        world, result, EcsUnSet, SpatialUnSet);
+
+    spatial_populate(result);
+
+    return result;
+}
+
+void ecs_spatial_free(
+    ecs_spatial_t *index)
+{
+    ecs_assert(index != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!index->world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+
+    /* Delete the systems that update the index, so that they are no longer
+     * invoked when the component is set or removed */
+    ecs_world_t *world = index->world;
+    ecs_delete(world, index->on_set);
+    ecs_delete(world, index->un_set);
+
+    ecs_vector_each(world->spatial_indices, ecs_spatial_t*, i_ptr, {
+        if (*i_ptr == index) {
+            ecs_vector_remove_index(
+                world->spatial_indices, ecs_spatial_t*, i_ptr_i);
+            break;
+        }
+    });
+
+    spatial_free(index);
+}
+
+int32_t ecs_spatial_count(
+    const ecs_spatial_t *index)
+{
+    ecs_assert(index != NULL, ECS_INVALID_PARAMETER, NULL);
+    return ecs_map_count(index->entities);
+}
+
+ecs_spatial_iter_t ecs_spatial_box(
+    ecs_spatial_t *index,
+    const float *min,
+    const float *max)
+{
+    ecs_assert(min != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(max != NULL, ECS_INVALID_PARAMETER, NULL);
+    return spatial_iter(index, min, max);
+}
+
+ecs_spatial_iter_t ecs_spatial_radius(
+    ecs_spatial_t *index,
+    const float *center,
+    float radius)
+{
+    ecs_assert(index != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(center != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(radius > 0, ECS_INVALID_PARAMETER, NULL);
+
+    float min[3] = {0}, max[3] = {0};
+    int32_t d;
+    for (d = 0; d < index->dim; d ++) {
+        min[d] = center[d] - radius;
+        max[d] = center[d] + radius;
+    }
+
+    ecs_spatial_iter_t it = spatial_iter(index, min, max);
+    for (d = 0; d < index->dim; d ++) {
+        it.center[d] = center[d];
+    }
+    it.radius = radius;
+
+    return it;
+}
+
+bool ecs_spatial_next(
+    ecs_spatial_iter_t *it)
+{
+    ecs_assert(it != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_spatial_cell_t *cell;
+    while ((cell = spatial_next_cell(it))) {
+        /* Cells that are entirely in the region are returned without testing
+         * the individual entities */
+        if (spatial_cell_inside(it, cell)) {
+            it->entities = ecs_vector_first(cell->entities, ecs_entity_t);
+            it->count = ecs_vector_count(cell->entities);
+            return true;
+        }
+
+        ecs_entity_t *entities = ecs_vector_first(
+            cell->entities, ecs_entity_t);
+        ecs_spatial_point_t *points = ecs_vector_first(
+            cell->points, ecs_spatial_point_t);
+
+        ecs_vector_clear(it->buffer);
+
+        int32_t i, count = ecs_vector_count(cell->entities);
+        for (i = 0; i < count; i ++) {
+            if (spatial_point_inside(it, &points[i])) {
+                ecs_entity_t *e_ptr = ecs_vector_add(
+                    &it->buffer, ecs_entity_t);
+                *e_ptr = entities[i];
+            }
+        }
+
+        if (ecs_vector_count(it->buffer)) {
+            it->entities = ecs_vector_first(it->buffer, ecs_entity_t);
+            it->count = ecs_vector_count(it->buffer);
+            return true;
+        }
+    }
+
+    ecs_spatial_iter_fini(it);
+
+    return false;
+}
+
+void ecs_spatial_iter_fini(
+    ecs_spatial_iter_t *it)
+{
+    ecs_assert(it != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_vector_free(it->buffer);
+    it->buffer = NULL;
+    it->entities = NULL;
+    it->count = 0;
+}
+
+#endif
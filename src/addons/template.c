@@ -0,0 +1,730 @@
+#include "flecs.h"
+
+#ifdef FLECS_TEMPLATE
+
+#include "../private_api.h"
+
+#ifdef FLECS_SYSTEM
+#include "../modules/system/system.h"
+#endif
+
+/* State for creating a world from a template. Entities with ids up to the last
+ * ids created by ecs_init exist in both worlds, and are not copied. */
+typedef struct ecs_template_t {
+    ecs_world_t *world;              /* Template */
+    ecs_world_t *dst;                /* New world */
+    ecs_entity_t last_component_id;  /* Last component id created by ecs_init */
+    ecs_entity_t last_id;            /* Last entity id created by ecs_init */
+    ecs_vector_t *ranges;            /* Rows that were copied in bulk */
+} ecs_template_t;
+
+/* Rows that were appended to a table of the new world */
+typedef struct ecs_template_range_t {
+    ecs_table_t *table;
+    int32_t row;
+    int32_t count;
+} ecs_template_range_t;
+
+static
+bool template_is_bootstrap(
+    ecs_template_t *t,
+    ecs_entity_t e)
+{
+    ecs_entity_t id = ecs_entity_t_lo(e);
+    return id < t->last_component_id ||
+        (id > ECS_HI_COMPONENT_ID && id <= t->last_id);
+}
+
+/* Components that are added by systems when their owner is created */
+static
+bool template_is_derived(
+    ecs_entity_t component)
+{
+    if (component == EcsDisabledIntern || component == EcsInactive) {
+        return true;
+    }
+
+#ifdef FLECS_SYSTEM
+    if (component == ecs_typeid(EcsSystem) ||
+        component == ecs_typeid(EcsSignature) ||
+        component == ecs_typeid(EcsQuery))
+    {
+        return true;
+    }
+#endif
+
+#ifdef FLECS_PIPELINE
+    if (component == ecs_typeid(EcsPipelineQuery)) {
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+/* Components that can only be added after the values of the entity are set,
+ * like tags that are processed when a system or pipeline is created */
+static
+bool template_is_late(
+    ecs_entity_t component)
+{
+    return component == EcsDisabled || component == EcsPipeline ||
+        ECS_HAS_ROLE(component, DISABLED);
+}
+
+/* Entities that are owned by systems, triggers or pipelines, and that should
+ * be created after all other entities */
+static
+bool template_is_reactive(
+    ecs_table_t *table)
+{
+    ecs_type_t type = table->type;
+
+#ifdef FLECS_SYSTEM
+    if (ecs_type_index_of(type, ecs_typeid(EcsSystem)) != -1 ||
+        ecs_type_index_of(type, ecs_typeid(EcsTrigger)) != -1)
+    {
+        return true;
+    }
+#endif
+
+    return ecs_type_index_of(type, EcsPipeline) != -1;
+}
+
+/* Does the column store a value for the component. Columns of ids with a role
+ * can have a size, but do not store a value for the entity. */
+static
+bool template_has_value(
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t column)
+{
+    if (column >= table->column_count || !data->columns[column].size) {
+        return false;
+    }
+
+    ecs_entity_t c = ecs_vector_first(table->type, ecs_entity_t)[column];
+    return !(c & ECS_ROLE_MASK) || ECS_HAS_ROLE(c, TRAIT);
+}
+
+static
+int template_compare_ids(
+    const void *ptr1,
+    const void *ptr2)
+{
+    uint32_t e1 = ecs_entity_t_lo(*(ecs_entity_t*)ptr1);
+    uint32_t e2 = ecs_entity_t_lo(*(ecs_entity_t*)ptr2);
+    return (e1 > e2) - (e1 < e2);
+}
+
+/* Copy storage settings and lifecycle actions of a component */
+static
+void template_copy_c_info(
+    ecs_template_t *t,
+    ecs_entity_t component)
+{
+    ecs_c_info_t *c_info = ecs_get_c_info(t->world, component);
+    if (!c_info) {
+        return;
+    }
+
+    if (c_info->fields) {
+        ecs_set_component_fields_w_entity(t->dst, component,
+            ecs_vector_first(c_info->fields, ecs_field_t),
+            ecs_vector_count(c_info->fields));
+    }
+
+    if (c_info->double_buffered) {
+        ecs_set_component_double_buffered_w_entity(t->dst, component);
+    }
+
+    if (c_info->sparse) {
+        ecs_set_component_sparse_w_entity(t->dst, component);
+    }
+
+    /* If actions were set with the EcsComponentLifecycle component, they are
+     * registered when the component is copied */
+    if (c_info->lifecycle_set && !ecs_has_entity(t->world, component,
+        ecs_typeid(EcsComponentLifecycle)))
+    {
+        ecs_set_component_actions_w_entity(
+            t->dst, component, &c_info->lifecycle);
+    }
+}
+
+#ifdef FLECS_SYSTEM
+static
+void template_free_string(
+    ecs_world_t *world,
+    void *ctx)
+{
+    (void)world;
+    ecs_os_free(ctx);
+}
+
+/* Signature expressions are not owned by the template, and may be freed
+ * together with the template, as is the case for the spatial index. The new
+ * world owns a copy that is freed when it is deleted. */
+static
+const char* template_copy_string(
+    ecs_template_t *t,
+    const char *str)
+{
+    if (!str) {
+        return NULL;
+    }
+
+    char *result = ecs_os_strdup(str);
+    ecs_atfini(t->dst, template_free_string, result);
+    return result;
+}
+#endif
+
+static
+ecs_type_t template_copy_type(
+    ecs_template_t *t,
+    ecs_type_t type)
+{
+    if (!type) {
+        return NULL;
+    }
+
+    return ecs_table_from_type(t->dst, type)->type;
+}
+
+static
+void template_copy_value(
+    ecs_template_t *t,
+    ecs_entity_t e,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t row,
+    int32_t column_index)
+{
+    ecs_entity_t component = ecs_vector_first(
+        table->type, ecs_entity_t)[column_index];
+    ecs_column_t *column = &data->columns[column_index];
+    void *ptr = ecs_vector_get_t(
+        column->data, column->size, column->alignment, row);
+
+    if (component == ecs_typeid(EcsType)) {
+        /* Types are stored by the tables of the world that created them */
+        EcsType *src = ptr;
+        EcsType dst = {
+            .type = template_copy_type(t, src->type),
+            .normalized = template_copy_type(t, src->normalized)
+        };
+
+        ecs_set_ptr(t->dst, e, EcsType, &dst);
+
+        if (ecs_map_get(t->world->type_handles, ecs_entity_t,
+            (uintptr_t)src->type))
+        {
+            ecs_map_set(t->dst->type_handles, (uintptr_t)dst.type, &e);
+        }
+#ifdef FLECS_SYSTEM
+    } else if (component == ecs_typeid(EcsSignatureExpr)) {
+        EcsSignatureExpr *src = ptr;
+        ecs_set(t->dst, e, EcsSignatureExpr, {
+            .expr = template_copy_string(t, src->expr)
+        });
+#endif
+    } else {
+        ecs_set_ptr_w_entity(t->dst, e, component,
+            ecs_to_size_t(column->size), ptr);
+    }
+
+    if (component == ecs_typeid(EcsComponent)) {
+        template_copy_c_info(t, e);
+    }
+}
+
+/* Values that reference data owned by the template are replaced with values
+ * owned by the new world after the columns of a table are copied */
+static
+void template_remap_values(
+    ecs_template_t *t,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t row,
+    int32_t count)
+{
+    ecs_entity_t *entities = ecs_vector_get(data->entities, ecs_entity_t, row);
+    int32_t i, column;
+
+    column = ecs_type_index_of(table->type, ecs_typeid(EcsType));
+    if (column != -1 && column < table->column_count) {
+        EcsType *types = ecs_vector_get(
+            data->columns[column].data, EcsType, row);
+        for (i = 0; i < count; i ++) {
+            ecs_type_t src_type = types[i].type;
+            types[i].type = template_copy_type(t, src_type);
+            types[i].normalized = template_copy_type(t, types[i].normalized);
+
+            if (ecs_map_get(t->world->type_handles, ecs_entity_t,
+                (uintptr_t)src_type))
+            {
+                ecs_map_set(t->dst->type_handles,
+                    (uintptr_t)types[i].type, &entities[i]);
+            }
+        }
+    }
+
+#ifdef FLECS_SYSTEM
+    column = ecs_type_index_of(table->type, ecs_typeid(EcsSignatureExpr));
+    if (column != -1 && column < table->column_count) {
+        EcsSignatureExpr *exprs = ecs_vector_get(
+            data->columns[column].data, EcsSignatureExpr, row);
+        for (i = 0; i < count; i ++) {
+            exprs[i].expr = template_copy_string(t, exprs[i].expr);
+        }
+    }
+#else
+    (void)entities;
+#endif
+}
+
+/* Recreate an entity in the new world by adding its components one by one, so
+ * that systems, triggers and component actions are registered in the same way
+ * as they were for the template. */
+static
+void template_copy_entity(
+    ecs_template_t *t,
+    ecs_entity_t e)
+{
+    ecs_record_t *r = ecs_eis_get(t->world, e);
+    if (!r || !r->table) {
+        return;
+    }
+
+    ecs_table_t *table = r->table;
+    ecs_data_t *data = ecs_table_get_data(table);
+    bool is_watched;
+    int32_t row = ecs_record_to_row(r->row, &is_watched);
+    bool is_bootstrap = template_is_bootstrap(t, e);
+
+    ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
+    int32_t i, count = ecs_vector_count(table->type);
+    int32_t column_count = table->column_count;
+
+    /* Entities that are created by ecs_init only need the components that
+     * were added by the application, like singletons */
+    ecs_type_t dst_type = NULL;
+    if (is_bootstrap) {
+        dst_type = ecs_get_type(t->dst, e);
+    }
+
+    /* Names in signatures are resolved relative to the scope of the entity */
+    ecs_entity_t scope = 0;
+    for (i = 0; i < count; i ++) {
+        if (ECS_HAS_ROLE(components[i], CHILDOF)) {
+            scope = components[i] & ECS_COMPONENT_MASK;
+            break;
+        }
+    }
+
+    ecs_entity_t old_scope = ecs_set_scope(t->dst, scope);
+
+    /* Add tags first, so they are present when a system is created */
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t c = components[i];
+        if (template_is_derived(c) || template_is_late(c)) {
+            continue;
+        }
+
+        if (template_has_value(table, data, i)) {
+            continue;
+        }
+
+        if (dst_type && ecs_type_index_of(dst_type, c) != -1) {
+            continue;
+        }
+
+        ecs_add_entity(t->dst, e, c);
+
+        if (ECS_HAS_ROLE(c, SWITCH)) {
+            ecs_add_entity(t->dst, e, ECS_CASE |
+                ecs_get_case(t->world, e, c & ECS_COMPONENT_MASK));
+        }
+    }
+
+    /* The context is passed to a system when it is created, so it must be set
+     * before the system action */
+    int32_t ctx_column = -1;
+#ifdef FLECS_SYSTEM
+    ctx_column = ecs_type_index_of(table->type, ecs_typeid(EcsContext));
+    if (ctx_column != -1 && !(dst_type &&
+        ecs_type_index_of(dst_type, ecs_typeid(EcsContext)) != -1))
+    {
+        template_copy_value(t, e, table, data, row, ctx_column);
+    }
+#endif
+
+    for (i = 0; i < column_count; i ++) {
+        ecs_entity_t c = components[i];
+        if (i == ctx_column || !template_has_value(table, data, i)) {
+            continue;
+        }
+
+        if (template_is_derived(c)) {
+            continue;
+        }
+
+        if (dst_type && ecs_type_index_of(dst_type, c) != -1) {
+            continue;
+        }
+
+        template_copy_value(t, e, table, data, row, i);
+    }
+
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t c = components[i];
+        if (!template_is_late(c)) {
+            continue;
+        }
+
+        if (dst_type && ecs_type_index_of(dst_type, c) != -1) {
+            continue;
+        }
+
+        if (ECS_HAS_ROLE(c, DISABLED)) {
+            c &= ECS_COMPONENT_MASK;
+            ecs_enable_component_w_entity(t->dst, e, c,
+                ecs_is_component_enabled_w_entity(t->world, e, c));
+        } else {
+            ecs_add_entity(t->dst, e, c);
+        }
+    }
+
+    ecs_set_scope(t->dst, old_scope);
+}
+
+/* Copy a range of rows of a table to the new world without invoking systems.
+ * OnSet systems are invoked for the range after all entities are copied. */
+static
+void template_copy_rows(
+    ecs_template_t *t,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t first,
+    int32_t count)
+{
+    int32_t i, r;
+    ecs_entity_t *entities = ecs_vector_get(
+        data->entities, ecs_entity_t, first);
+    ecs_record_t **records = ecs_vector_get(
+        data->record_ptrs, ecs_record_t*, first);
+
+    ecs_table_t *dst_table = ecs_table_from_type(t->dst, table->type);
+    ecs_data_t *dst_data = ecs_table_get_or_create_data(dst_table);
+    int32_t row = ecs_table_appendn(t->dst, dst_table, dst_data, count, entities);
+    ecs_entity_t *dst_entities = ecs_vector_get(
+        dst_data->entities, ecs_entity_t, row);
+
+    /* Copy component columns. Tables are matched with the same component
+     * storage, as component info is copied before tables are created. */
+    ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
+    for (i = 0; i < table->column_count; i ++) {
+        ecs_column_t *column = &data->columns[i];
+        ecs_column_t *dst_column = &dst_data->columns[i];
+        int16_t size = column->size;
+        int16_t alignment = column->alignment;
+        if (!template_has_value(table, data, i)) {
+            continue;
+        }
+
+        ecs_assert(dst_column->size == size, ECS_INTERNAL_ERROR, NULL);
+
+        void *src_ptr = ecs_vector_get_t(column->data, size, alignment, first);
+        void *dst_ptr = ecs_vector_get_t(dst_column->data, size, alignment, row);
+
+        ecs_c_info_t *c_info = ecs_get_c_info(t->dst, components[i]);
+        ecs_copy_t copy;
+        if (c_info && (copy = c_info->lifecycle.copy)) {
+            copy(t->dst, components[i], dst_entities, entities, dst_ptr,
+                src_ptr, ecs_to_size_t(size), count, c_info->lifecycle.ctx);
+        } else {
+            ecs_os_memcpy(dst_ptr, src_ptr, size * count);
+        }
+
+        if (data->prev_columns && dst_data->prev_columns) {
+            column = &data->prev_columns[i];
+            dst_column = &dst_data->prev_columns[i];
+            ecs_os_memcpy(
+                ecs_vector_get_t(dst_column->data, size, alignment, row),
+                ecs_vector_get_t(column->data, size, alignment, first),
+                size * count);
+        }
+    }
+
+    for (i = 0; i < table->soa_column_count; i ++) {
+        ecs_column_t *column = &data->soa_columns[i];
+        ecs_column_t *dst_column = &dst_data->soa_columns[i];
+        ecs_os_memcpy(
+            ecs_vector_get_t(dst_column->data,
+                column->size, column->alignment, row),
+            ecs_vector_get_t(column->data,
+                column->size, column->alignment, first),
+            column->size * count);
+    }
+
+    for (i = 0; i < table->sw_column_count; i ++) {
+        ecs_switch_t *sw = data->sw_columns[i].data;
+        ecs_switch_t *dst_sw = dst_data->sw_columns[i].data;
+        for (r = 0; r < count; r ++) {
+            ecs_switch_set(dst_sw, row + r, ecs_switch_get(sw, first + r));
+        }
+    }
+
+    for (i = 0; i < table->bs_column_count; i ++) {
+        ecs_bitset_t *bs = &data->bs_columns[i].data;
+        ecs_bitset_t *dst_bs = &dst_data->bs_columns[i].data;
+        for (r = 0; r < count; r ++) {
+            ecs_bitset_set(dst_bs, row + r, ecs_bitset_get(bs, first + r));
+        }
+    }
+
+    template_remap_values(t, dst_table, dst_data, row, count);
+
+    /* Update entity index */
+    ecs_record_t **dst_records = ecs_vector_first(
+        dst_data->record_ptrs, ecs_record_t*);
+    for (r = 0; r < count; r ++) {
+        ecs_record_t *record = ecs_eis_get_or_create(t->dst, entities[r]);
+        record->table = dst_table;
+        record->row = ecs_row_to_record(row + r, records[r]->row < 0);
+        dst_records[row + r] = record;
+    }
+
+    ecs_template_range_t *range = ecs_vector_add(
+        &t->ranges, ecs_template_range_t);
+    range->table = dst_table;
+    range->row = row;
+    range->count = count;
+}
+
+/* Copy the tables that do not contain builtin components */
+static
+void template_copy_tables(
+    ecs_template_t *t)
+{
+    ecs_sparse_t *tables = t->world->store.tables;
+    int32_t i, count = ecs_sparse_count(tables);
+
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        if (table->flags & EcsTableHasBuiltins) {
+            continue;
+        }
+
+        ecs_data_t *data = ecs_table_get_data(table);
+        int32_t r, row_count = ecs_table_data_count(data);
+        if (!row_count) {
+            continue;
+        }
+
+        /* Entities created by ecs_init are already stored in the new world.
+         * Copy the ranges of rows in between them, so that all other entities
+         * are copied the same way. */
+        ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+        int32_t first = 0;
+        for (r = 0; r <= row_count; r ++) {
+            if (r == row_count || template_is_bootstrap(t, entities[r])) {
+                if (r > first) {
+                    template_copy_rows(t, table, data, first, r - first);
+                }
+                first = r + 1;
+            }
+        }
+    }
+}
+
+/* Copy values of components that are stored in sparse sets */
+static
+void template_copy_sparse(
+    ecs_template_t *t)
+{
+    ecs_vector_each(t->world->sparse_components, ecs_entity_t, c_ptr, {
+        ecs_c_info_t *c_info = ecs_get_c_info(t->world, *c_ptr);
+        const uint64_t *ids = ecs_sparse_ids(c_info->sparse);
+        int32_t i, count = ecs_sparse_count(c_info->sparse);
+
+        for (i = 0; i < count; i ++) {
+            ecs_set_ptr_w_entity(t->dst, ids[i], *c_ptr,
+                ecs_to_size_t(c_info->size),
+                _ecs_sparse_get(c_info->sparse, 0, i));
+        }
+    });
+}
+
+#ifdef FLECS_SYSTEM
+/* Copy settings of systems that are not stored in components */
+static
+void template_copy_system(
+    ecs_template_t *t,
+    ecs_entity_t e)
+{
+    const EcsSystem *src = ecs_get(t->world, e, EcsSystem);
+    if (!src) {
+        return;
+    }
+
+    EcsSystem *dst = ecs_get_mut(t->dst, e, EcsSystem, NULL);
+    ecs_assert(dst != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    dst->ctx = src->ctx;
+    dst->status_action = src->status_action;
+    dst->status_ctx = src->status_ctx;
+    dst->tick_source = src->tick_source;
+    dst->entity_budget = src->entity_budget;
+    dst->time_budget = src->time_budget;
+}
+#endif
+
+ecs_world_t* ecs_init_w_template(
+    ecs_world_t *world)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+
+    /* The systems of a spatial index update the index of the template, and
+     * cannot be copied to another world */
+    ecs_assert(!ecs_vector_count(world->spatial_indices),
+        ECS_INVALID_PARAMETER, "template may not have spatial indices");
+
+    ecs_template_t t = {
+        .world = world,
+        .dst = ecs_init()
+    };
+
+    ecs_world_t *dst = t.dst;
+    dst->context = world->context;
+    t.last_component_id = dst->stats.last_component_id;
+    t.last_id = dst->stats.last_id;
+
+    /* The template must have been created with the same builtin modules */
+    ecs_assert(world->stats.last_component_id >= t.last_component_id,
+        ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(world->stats.last_id >= t.last_id,
+        ECS_INVALID_PARAMETER, NULL);
+
+    /* Make all entity ids of the template alive, so entities can be copied
+     * before the entities they refer to */
+    const uint64_t *ids = ecs_sparse_ids(world->store.entity_index);
+    int32_t i, count = ecs_eis_count(world);
+    ecs_vector_t *entities = NULL;
+
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = ids[i];
+        if (template_is_bootstrap(&t, e)) {
+            continue;
+        }
+
+        ecs_eis_get_or_create(dst, e);
+
+        ecs_record_t *r = ecs_eis_get(world, e);
+        if (r->table && (r->table->flags & EcsTableHasBuiltins)) {
+            ecs_entity_t *elem = ecs_vector_add(&entities, ecs_entity_t);
+            *elem = e;
+        }
+    }
+
+    /* Copy entities with builtin components in the order they were created, so
+     * that a signature can only refer to entities that are already copied */
+    ecs_vector_sort(entities, ecs_entity_t, template_compare_ids);
+    ecs_entity_t *builtins = ecs_vector_first(entities, ecs_entity_t);
+    int32_t builtin_count = ecs_vector_count(entities);
+
+    /* Copy components and types, as tables depend on them */
+    for (i = 0; i < builtin_count; i ++) {
+        ecs_record_t *r = ecs_eis_get(world, builtins[i]);
+        if (!template_is_reactive(r->table)) {
+            template_copy_entity(&t, builtins[i]);
+        }
+    }
+
+    template_copy_tables(&t);
+
+    /* Copy components that were added to builtin entities, like singletons */
+    ecs_entity_t e;
+    for (e = 1; e <= t.last_id; e ++) {
+        if (e == t.last_component_id) {
+            e = ECS_HI_COMPONENT_ID + 1;
+        }
+
+        if (ecs_eis_is_alive(world, e)) {
+            template_copy_entity(&t, e);
+        }
+    }
+
+    /* Copy systems, triggers and pipelines */
+    for (i = 0; i < builtin_count; i ++) {
+        ecs_record_t *r = ecs_eis_get(world, builtins[i]);
+        if (template_is_reactive(r->table)) {
+            template_copy_entity(&t, builtins[i]);
+#ifdef FLECS_SYSTEM
+            template_copy_system(&t, builtins[i]);
+#endif
+        }
+    }
+
+    ecs_vector_free(entities);
+
+    template_copy_sparse(&t);
+
+    /* Run OnSet systems for the entities that were copied in bulk */
+    ecs_vector_each(t.ranges, ecs_template_range_t, range, {
+        ecs_table_t *table = range->table;
+        ecs_entities_t components = ecs_type_to_entities(table->type);
+        ecs_run_set_systems(dst, &components, table, ecs_table_get_data(table),
+            range->row, range->count, true);
+    });
+
+    ecs_vector_free(t.ranges);
+
+    /* Copy monitored flags, and generations of entities without components */
+    for (i = 0; i < count; i ++) {
+        e = ids[i];
+        if (template_is_bootstrap(&t, e)) {
+            continue;
+        }
+
+        ecs_record_t *r = ecs_eis_get(world, e);
+        ecs_record_t *dst_r = ecs_eis_get_or_create(dst, e);
+        if (r->row < 0 && dst_r->row > 0) {
+            dst_r->row = -dst_r->row;
+        }
+    }
+
+    ecs_vector_each(world->aliases, ecs_alias_t, al, {
+        ecs_use(dst, al->entity, al->name);
+    });
+
+#ifdef FLECS_PIPELINE
+    if (!template_is_bootstrap(&t, world->pipeline)) {
+        ecs_set_pipeline(dst, world->pipeline);
+    }
+#endif
+
+    dst->range_check_enabled = world->range_check_enabled;
+    dst->stats.last_component_id = world->stats.last_component_id;
+    if (world->stats.last_id > dst->stats.last_id) {
+        dst->stats.last_id = world->stats.last_id;
+    }
+    dst->stats.min_id = world->stats.min_id;
+    dst->stats.max_id = world->stats.max_id;
+    dst->stats.target_fps = world->stats.target_fps;
+    dst->stats.time_scale = world->stats.time_scale;
+
+    /* Table data was copied without invoking component actions, so the
+     * EcsChildOf index has to be rebuilt from the copied data */
+    ecs_childof_index_rebuild(dst);
+
+    /* Copied entities could be bases */
+    dst->base_cache_version ++;
+
+    return dst;
+}
+
+#endif
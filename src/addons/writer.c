@@ -66,6 +66,9 @@ void ecs_table_writer_register_table(
 
     ecs_data_t *data = ecs_table_get_or_create_data(writer->table);
     if (data->entities) {
+        /* Removed entities could be bases */
+        world->base_cache_version ++;
+
         /* Remove any existing entities from entity index */
         ecs_vector_each(data->entities, ecs_entity_t, e_ptr, {
             ecs_eis_delete(world, *e_ptr);
@@ -331,10 +334,12 @@ ecs_size_t ecs_table_writer(
             name_ptr->value = writer->name.name;
 
             if (name_ptr->alloc_value) {
+                ecs_track_name_free(name_ptr->alloc_value);
                 ecs_os_free(name_ptr->alloc_value);
             }
 
             name_ptr->alloc_value = writer->name.name;
+            ecs_track_name_alloc(name_ptr->alloc_value);
 
             /* Don't overwrite entity name */
             ecs_name_writer_reset(&writer->name);   
@@ -4,6 +4,7 @@
 ecs_type_t ecs_type(EcsComponent);
 ecs_type_t ecs_type(EcsType);
 ecs_type_t ecs_type(EcsName);
+ecs_type_t ecs_type(EcsChildOf);
 ecs_type_t ecs_type(EcsPrefab);
 
 /* Component lifecycle actions for EcsName */
@@ -14,6 +15,7 @@ ECS_CTOR(EcsName, ptr, {
 })
 
 ECS_DTOR(EcsName, ptr, {
+    ecs_track_name_free(ptr->alloc_value);
     ecs_os_free(ptr->alloc_value);
     ptr->value = NULL;
     ptr->alloc_value = NULL;
@@ -22,6 +24,7 @@ ECS_DTOR(EcsName, ptr, {
 
 ECS_COPY(EcsName, dst, src, {
     if (dst->alloc_value) {
+        ecs_track_name_free(dst->alloc_value);
         ecs_os_free(dst->alloc_value);
         dst->alloc_value = NULL;
     }
@@ -29,6 +32,7 @@ ECS_COPY(EcsName, dst, src, {
     if (src->alloc_value) {
         dst->alloc_value = ecs_os_strdup(src->alloc_value);
         dst->value = dst->alloc_value;
+        ecs_track_name_alloc(dst->alloc_value);
     } else {
         dst->alloc_value = NULL;
         dst->value = src->value;
@@ -46,6 +50,29 @@ ECS_MOVE(EcsName, dst, src, {
     src->symbol = NULL;
 })
 
+/* Component lifecycle actions for EcsChildOf. Copying or moving a parent into
+ * an element registers the entity with the child index of the parent. Entries
+ * that become stale when the parent changes are discarded when the index is
+ * read, which keeps the table moves that call these actions cheap. */
+ECS_CTOR(EcsChildOf, ptr, {
+    ptr->parent = 0;
+})
+
+ECS_COPY(EcsChildOf, dst, src, {
+    if (src->parent && src->parent != dst->parent) {
+        ecs_childof_register(world, src->parent, dst_entity);
+    }
+    dst->parent = src->parent;
+})
+
+ECS_MOVE(EcsChildOf, dst, src, {
+    if (src->parent && src->parent != dst->parent) {
+        ecs_childof_register(world, src->parent, dst_entity);
+    }
+    dst->parent = src->parent;
+    src->parent = 0;
+})
+
 
 /* -- Bootstrapping -- */
 
@@ -112,6 +139,7 @@ void bootstrap_types(
     ecs_type(EcsComponent) = ecs_bootstrap_type(world, ecs_typeid(EcsComponent));
     ecs_type(EcsType) = ecs_bootstrap_type(world, ecs_typeid(EcsType));
     ecs_type(EcsName) = ecs_bootstrap_type(world, ecs_typeid(EcsName));
+    ecs_type(EcsChildOf) = ecs_bootstrap_type(world, ecs_typeid(EcsChildOf));
 }
 
 /** Initialize component table. This table is manually constructed to bootstrap
@@ -167,6 +195,7 @@ void ecs_bootstrap(
     bootstrap_component(world, table, EcsComponent);
     bootstrap_component(world, table, EcsType);
     bootstrap_component(world, table, EcsName);
+    bootstrap_component(world, table, EcsChildOf);
 
     world->stats.last_component_id = EcsFirstUserComponentId;
     world->stats.last_id = EcsFirstUserEntityId;
@@ -189,6 +218,12 @@ void ecs_bootstrap(
         .move = ecs_move(EcsName)
     });
 
+    ecs_set_component_actions(world, EcsChildOf, {
+        .ctor = ecs_ctor(EcsChildOf),
+        .copy = ecs_copy(EcsChildOf),
+        .move = ecs_move(EcsChildOf)
+    });
+
     /* Initialize scopes */
     ecs_set(world, EcsFlecs, EcsName, {.value = "flecs"});
     ecs_add_entity(world, EcsFlecs, EcsModule);
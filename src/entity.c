@@ -249,6 +249,7 @@ void run_component_trigger_for_entities(
         for (i = 0; i < trigger_count; i ++) {
             it.system = triggers[i].self;
             it.param = triggers[i].ctx;
+            it.ctx = triggers[i].ctx;
             triggers[i].action(&it);
         }
     }
@@ -520,6 +521,144 @@ void instantiate_children(
     }    
 }
 
+/* Fill array with count copies of an element. Each memcpy doubles the number
+ * of initialized elements. */
+static
+void fill_repeated(
+    void * dst,
+    const void * src,
+    ecs_size_t size,
+    int32_t count)
+{
+    ecs_os_memcpy(dst, src, size);
+
+    int32_t filled = 1;
+    while (filled < count) {
+        int32_t n = count - filled;
+        if (n > filled) {
+            n = filled;
+        }
+
+        ecs_os_memcpy(ECS_OFFSET(dst, size * filled), dst, size * n);
+        filled += n;
+    }
+}
+
+/* Instantiate children of a base that store their parent in EcsChildOf. As the
+ * parent is not part of the type, the children of all instances are stored in
+ * the same table, which allows for creating them with a single new_w_data. 
+ * Children are created in child-major order, so that the instances of each
+ * base child occupy a contiguous range of rows. */
+static
+void instantiate_childof_children(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_data_t * data,
+    int32_t row,
+    int32_t count,
+    ecs_table_t * child_table,
+    ecs_entity_t * children,
+    int32_t child_count)
+{
+    ecs_type_t type = child_table->type;
+    ecs_data_t *child_data = ecs_table_get_data(child_table);
+    ecs_assert(child_data != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t column_count = child_table->column_count;
+    ecs_entity_t *type_array = ecs_vector_first(type, ecs_entity_t);
+    int32_t type_count = ecs_vector_count(type);
+    int32_t total = count * child_count;
+
+    ecs_entities_t components = {
+        .array = ecs_os_alloca(ECS_SIZEOF(ecs_entity_t) * (type_count + 1))
+    };
+
+    void **c_info = ecs_os_alloca(ECS_SIZEOF(void*) * (type_count + 1));
+    ecs_os_memset(c_info, 0, ECS_SIZEOF(void*) * (type_count + 1));
+
+    int32_t *child_rows = ecs_os_alloca(ECS_SIZEOF(int32_t) * child_count);
+    int32_t i, j, pos = 0;
+    for (j = 0; j < child_count; j ++) {
+        ecs_record_t *r = ecs_eis_get(world, children[j]);
+        ecs_assert(r != NULL, ECS_INTERNAL_ERROR, NULL);
+        ecs_assert(r->table == child_table, ECS_INTERNAL_ERROR, NULL);
+        bool is_watched;
+        child_rows[j] = ecs_record_to_row(r->row, &is_watched);
+    }
+
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+
+    for (i = 0; i < type_count; i ++) {
+        ecs_entity_t c = type_array[i];
+        
+        /* Make sure instances don't have EcsPrefab */
+        if (c == EcsPrefab) {
+            continue;
+        }
+
+        if (i < column_count) {
+            ecs_column_t *column = &child_data->columns[i];
+            ecs_size_t size = column->size;
+            if (size) {
+                void *src = ecs_vector_first_t(
+                    column->data, size, column->alignment);
+                void *buffer = ecs_os_malloc(size * total);
+                ecs_assert(buffer != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+                /* Component data is copied bitwise into the buffer, which is
+                 * only used as source for new_w_data and freed without
+                 * invoking destructors */
+                for (j = 0; j < child_count; j ++) {
+                    fill_repeated(ECS_OFFSET(buffer, size * j * count), 
+                        ECS_OFFSET(src, size * child_rows[j]), size, count);
+                }
+
+                /* Point children to the instances */
+                if (c == ecs_typeid(EcsChildOf)) {
+                    EcsChildOf *parents = buffer;
+                    for (j = 0; j < child_count; j ++) {
+                        int32_t k;
+                        for (k = 0; k < count; k ++) {
+                            parents[j * count + k].parent = entities[row + k];
+                        }
+                    }
+                }
+
+                c_info[pos] = buffer;
+            }
+        }
+
+        components.array[pos] = c;
+        pos ++;
+    }
+
+    /* If children are added to a prefab, make sure they are prefabs too */
+    if (table->flags & EcsTableIsPrefab) {
+        components.array[pos] = EcsPrefab;
+        pos ++;
+    }
+
+    components.count = pos;
+
+    ecs_table_t *i_table = ecs_table_find_or_create(world, &components);
+    ecs_assert(i_table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t child_row;
+    new_w_data(world, i_table, &components, total, c_info, &child_row);
+
+    for (i = 0; i < pos; i ++) {
+        ecs_os_free(c_info[i]);
+    }
+
+    /* If base children have children themselves, recursively instantiate. All
+     * instances of a base child are instantiated at once. */
+    ecs_data_t *i_data = ecs_table_get_data(i_table);
+    for (j = 0; j < child_count; j ++) {
+        instantiate(world, children[j], i_table, i_data, 
+            child_row + j * count, count);
+    }
+}
+
 static
 void instantiate(
     ecs_world_t * world,
@@ -539,6 +678,33 @@ void instantiate(
                 world, base, table, data, row, count, *child_table_ptr);
         });
     }
+
+    /* Instantiate children that store base in EcsChildOf, per child table */
+    ecs_vector_t *children = ecs_childof_get_children(world, base);
+    ecs_entity_t *child_array = ecs_vector_first(children, ecs_entity_t);
+    int32_t i, child_count = ecs_vector_count(children);
+
+    for (i = 0; i < child_count; i ++) {
+        ecs_table_t *child_table = ecs_eis_get(world, child_array[i])->table;
+
+        /* Move children in the same table to the front of the array */
+        int32_t j, table_count = 0;
+        for (j = i; j < child_count; j ++) {
+            ecs_entity_t child = child_array[j];
+            if (ecs_eis_get(world, child)->table == child_table) {
+                child_array[j] = child_array[i + table_count];
+                child_array[i + table_count] = child;
+                table_count ++;
+            }
+        }
+
+        instantiate_childof_children(world, table, data, row, count, 
+            child_table, &child_array[i], table_count);
+        
+        i += table_count - 1;
+    }
+
+    ecs_vector_free(children);
 }
 
 static
@@ -1099,6 +1265,18 @@ void commit(
     * component from, for example, a container. */
     if (info->is_watched) {
         update_component_monitors(world, entity, added, removed);
+
+        /* Keep track of which watched entities changed, so that queries only
+         * have to rematch the tables that depend on them */
+        if (added || removed) {
+            ecs_entity_t *elem = ecs_vector_add(
+                &world->watched_changed, ecs_entity_t);
+            *elem = entity;
+        }
+
+        /* The entity could be a base, so invalidate cached base components
+         * of the tables that inherit from it */
+        ecs_invalidate_base_cache(world, entity);
     }
 
     if ((!src_table || !src_table->type) && world->range_check_enabled) {
@@ -1112,7 +1290,8 @@ void* get_base_component(
     ecs_world_t * world,
     ecs_stage_t * stage,
     ecs_entity_info_t * info,
-    ecs_entity_t component)
+    ecs_entity_t component,
+    ecs_entity_t * base_out)
 {
     ecs_type_t type = info->table->type;
     ecs_entity_t *type_buffer = ecs_vector_first(type, ecs_entity_t);
@@ -1124,16 +1303,189 @@ void* get_base_component(
         ecs_entity_info_t prefab_info;
         if (ecs_get_info(world, prefab, &prefab_info) && prefab_info.table) {
             ptr = get_component(&prefab_info, component);
-            if (!ptr) {
+            if (ptr) {
+                *base_out = prefab;
+            } else {
                 ptr = get_base_component(
-                    world, stage, &prefab_info, component);
+                    world, stage, &prefab_info, component, base_out);
+            }
+        }
+    }
+
+    return ptr;
+}
+
+/* Test if a ref still points to the current location of its entity, without
+ * updating the ref */
+static
+bool ref_is_valid(
+    ecs_ref_t *ref)
+{
+    ecs_record_t *record = ref->record;
+    ecs_table_t *table = record->table;
+    return table && ref->table == table && ref->row == record->row && 
+        ref->alloc_count == table->alloc_count;
+}
+
+/* Get a component that a table inherits from a base. The table caches a ref
+ * to the base that provides the component, which avoids walking the prefab
+ * chain on every lookup. The cache is discarded when the type of a base 
+ * changes. While worker threads are running or while other threads may read
+ * the world the cache is only read. The read_enabled flag is only written by
+ * the thread that progresses the world, which is the only thread besides the
+ * readers that can get here while it is set. */
+static
+void* get_inherited_component(
+    ecs_world_t * world,
+    ecs_stage_t * stage,
+    ecs_entity_info_t * info,
+    ecs_entity_t component)
+{
+    ecs_table_t *table = info->table;
+    bool readonly = ecs_is_reader_thread() || (world->in_progress && 
+        (ecs_vector_count(world->workers) || world->read_enabled));
+
+    if (table->base_cache_version != world->base_cache_version) {
+        if (!readonly) {
+            if (table->base_cache) {
+                ecs_map_clear(table->base_cache);
+            }
+            table->base_cache_version = world->base_cache_version;
+        }
+    } else {
+        ecs_ref_t *ref = ecs_map_get(table->base_cache, ecs_ref_t, component);
+        if (ref) {
+            if (!ref->entity) {
+                /* None of the bases has the component */
+                return NULL;
+            }
+
+            if (ref_is_valid(ref)) {
+                return (void*)ref->ptr;
+            }
+
+            if (!readonly) {
+                return (void*)ecs_get_ref_w_entity(world, ref, 0, 0);
             }
         }
     }
 
+    ecs_entity_t base = 0;
+    void *ptr = get_base_component(world, stage, info, component, &base);
+
+    if (!readonly) {
+        if (!table->base_cache) {
+            table->base_cache = ecs_map_new(ecs_ref_t, 1);
+        }
+
+        ecs_ref_t ref = {0};
+        if (base) {
+            ecs_get_ref_w_entity(world, &ref, base, component);
+        }
+
+        ecs_map_set(table->base_cache, component, &ref);
+    }
+
+    return ptr;
+}
+
+static
+void* sparse_get_mut(
+    ecs_world_t * world,
+    ecs_entity_t entity,
+    ecs_c_info_t * c_info,
+    bool * is_added)
+{
+    void *ptr = _ecs_sparse_get_sparse(c_info->sparse, 0, entity);
+    bool added = false;
+
+    if (!ptr) {
+        ptr = _ecs_sparse_get_or_create(c_info->sparse, 0, entity);
+        ecs_assert(ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        /* Removing an element increases its generation in the sparse set.
+         * Make sure the element is alive for the current entity id. */
+        ecs_sparse_set_generation(c_info->sparse, entity);
+
+        ecs_xtor_t ctor = c_info->lifecycle.ctor;
+        if (ctor) {
+            ctor(world, c_info->component, &entity, ptr, 
+                ecs_to_size_t(c_info->size), 1, c_info->lifecycle.ctx);
+        }
+
+        added = true;
+    }
+
+    if (is_added) {
+        *is_added = added;
+    }
+
     return ptr;
 }
 
+static
+void sparse_remove(
+    ecs_world_t * world,
+    ecs_entity_t entity,
+    ecs_c_info_t * c_info)
+{
+    void *ptr = _ecs_sparse_get_sparse(c_info->sparse, 0, entity);
+    if (ptr) {
+        ecs_xtor_t dtor = c_info->lifecycle.dtor;
+        if (dtor) {
+            dtor(world, c_info->component, &entity, ptr, 
+                ecs_to_size_t(c_info->size), 1, c_info->lifecycle.ctx);
+        }
+
+        ecs_sparse_remove(c_info->sparse, entity);
+    }
+}
+
+/* Add or remove components with sparse storage. The components that are stored
+ * in tables are copied to the buffer and returned. */
+static
+ecs_entities_t sparse_add_remove(
+    ecs_world_t * world,
+    ecs_entity_t entity,
+    ecs_entities_t * components,
+    ecs_entity_t * buffer,
+    bool remove)
+{
+    if (!world->sparse_components) {
+        return *components;
+    }
+
+    ecs_assert(components->count < ECS_MAX_ADD_REMOVE, 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_entities_t result = { .array = buffer };
+    int32_t i, count = components->count;
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = components->array[i];
+        ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, e);
+        if (!c_info) {
+            buffer[result.count ++] = e;
+        } else if (remove) {
+            sparse_remove(world, entity, c_info);
+        } else {
+            sparse_get_mut(world, entity, c_info, NULL);
+        }
+    }
+
+    return result;
+}
+
+/* Remove entity from all sparse storages */
+static
+void sparse_clear(
+    ecs_world_t * world,
+    ecs_entity_t entity)
+{
+    ecs_vector_each(world->sparse_components, ecs_entity_t, c_ptr, {
+        sparse_remove(world, entity, ecs_get_c_info(world, *c_ptr));
+    });
+}
+
 static
 void new(
     ecs_world_t * world,
@@ -1141,9 +1493,20 @@ void new(
     ecs_entities_t * to_add)
 {
     ecs_entity_info_t info = {0};
+    ecs_entity_t buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entities_t components = sparse_add_remove(
+        world, entity, to_add, buffer, false);
+
     ecs_table_t *table = ecs_table_traverse_add(
-        world, world->stage.scope_table, to_add, NULL);
-    new_entity(world, entity, &info, table, to_add);
+        world, world->stage.scope_table, &components, NULL);
+
+    /* Entity may only have sparse components */
+    if (!table->type) {
+        ecs_eis_set(world, entity, &(ecs_record_t){ 0 });
+        return;
+    }
+
+    new_entity(world, entity, &info, table, &components);
 }
 
 static
@@ -1225,7 +1588,8 @@ const ecs_entity_t* new_w_data(
             ecs_c_info_t *cdata = get_c_info(world, c);
             ecs_copy_t copy;
             if (cdata && (copy = cdata->lifecycle.copy)) {
-                ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+                ecs_entity_t *entities = ecs_vector_get(
+                    data->entities, ecs_entity_t, row);
                 copy(world, c, entities, entities, ptr, src_ptr, 
                     ecs_to_size_t(size), count, cdata->lifecycle.ctx);
             } else {
@@ -1268,6 +1632,30 @@ bool has_type(
     }
 
     ecs_world_t *world_arg = world;
+    ecs_get_stage(&world);
+
+    /* Sparse components are not stored in the entity type, so if the type
+     * contains a sparse component, test each component separately */
+    if (world->sparse_components) {
+        bool has_sparse = false;
+        ecs_vector_each(type, ecs_entity_t, c_ptr, {
+            if (ecs_get_sparse_c_info(world, *c_ptr)) {
+                has_sparse = true;
+            }
+        });
+
+        if (has_sparse) {
+            ecs_vector_each(type, ecs_entity_t, c_ptr, {
+                bool has = ecs_has_entity(world_arg, entity, *c_ptr);
+                if (has == match_any) {
+                    return has;
+                }
+            });
+
+            return !match_any;
+        }
+    }
+
     ecs_type_t entity_type = ecs_get_type(world_arg, entity);
 
     return ecs_type_contains(
@@ -1293,13 +1681,20 @@ void add_remove(
     ecs_entities_t added = { .array = add_buffer };
     ecs_entities_t removed = { .array = remove_buffer };
 
+    ecs_entity_t sparse_add_buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entity_t sparse_remove_buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entities_t table_add = sparse_add_remove(
+        world, entity, to_add, sparse_add_buffer, false);
+    ecs_entities_t table_remove = sparse_add_remove(
+        world, entity, to_remove, sparse_remove_buffer, true);
+
     ecs_table_t *src_table = info.table;
 
     ecs_table_t *dst_table = ecs_table_traverse_remove(
-        world, src_table, to_remove, &removed);
+        world, src_table, &table_remove, &removed);
 
     dst_table = ecs_table_traverse_add(
-        world, dst_table, to_add, &added);    
+        world, dst_table, &table_add, &added);    
 
     commit(world, entity, &info, dst_table, &added, &removed);
 }
@@ -1354,6 +1749,10 @@ void add_entities(
         return;
     }
 
+    ecs_entity_t sparse_buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entities_t table_add = sparse_add_remove(
+        world, entity, components, sparse_buffer, false);
+
     ecs_entity_info_t info;
     ecs_get_info(world, entity, &info);
 
@@ -1362,7 +1761,7 @@ void add_entities(
 
     ecs_table_t *src_table = info.table;
     ecs_table_t *dst_table = ecs_table_traverse_add(
-        world, src_table, components, &added);
+        world, src_table, &table_add, &added);
 
     commit(world, entity, &info, dst_table, &added, NULL);
 
@@ -1383,6 +1782,10 @@ void remove_entities(
         return;
     }
 
+    ecs_entity_t sparse_buffer[ECS_MAX_ADD_REMOVE];
+    ecs_entities_t table_remove = sparse_add_remove(
+        world, entity, components, sparse_buffer, true);
+
     ecs_entity_info_t info;
     ecs_get_info(world, entity, &info);
 
@@ -1391,7 +1794,7 @@ void remove_entities(
 
     ecs_table_t *src_table = info.table;
     ecs_table_t *dst_table = ecs_table_traverse_remove(
-        world, src_table, components, &removed);
+        world, src_table, &table_remove, &removed);
 
     commit(world, entity, &info, dst_table, NULL, &removed);
 
@@ -1410,6 +1813,12 @@ void *get_mutable(
     ecs_assert(component != 0, ECS_INVALID_PARAMETER, NULL);
     ecs_assert((component & ECS_COMPONENT_MASK) == component || ECS_HAS_ROLE(component, TRAIT), ECS_INVALID_PARAMETER, NULL);
 
+    ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, component);
+    if (c_info) {
+        ecs_get_info(world, entity, info);
+        return sparse_get_mut(world, entity, c_info, is_added);
+    }
+
     void *dst = NULL;
     if (ecs_get_info(world, entity, info) && info->table) {
         dst = get_component(info, component);
@@ -1444,6 +1853,90 @@ void *get_mutable(
     }
 }
 
+/* Get component info if component is stored as a structure of arrays */
+static
+ecs_c_info_t* get_soa_c_info(
+    ecs_world_t * world,
+    ecs_entity_t component)
+{
+    if (!component || (component & ECS_ROLE_MASK)) {
+        return NULL;
+    }
+
+    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
+    if (c_info && c_info->fields) {
+        return c_info;
+    }
+
+    return NULL;
+}
+
+/* Get pointer to field of component stored as a structure of arrays */
+static
+void* get_soa_field(
+    ecs_entity_info_t * info,
+    ecs_entity_t component,
+    int32_t field)
+{
+    ecs_table_t *table = info->table;
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t column = ecs_type_index_of(table->type, component);
+    if (column == -1) {
+        return NULL;
+    }
+
+    int32_t soa_index = ecs_table_soa_column_index(table, column);
+    ecs_assert(soa_index != -1, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(field >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(field < ecs_vector_count(table->c_info[column]->fields), 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_column_t *soa_column = &info->data->soa_columns[soa_index + field];
+    int16_t size = soa_column->size;
+    void *ptr = ecs_vector_first_t(soa_column->data, size, soa_column->alignment);
+    ecs_assert(ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    return ECS_OFFSET(ptr, info->row * size);
+}
+
+/* Scatter component value to the fields of a structure of arrays component */
+static
+void set_soa_fields(
+    ecs_world_t * world,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    ecs_c_info_t * c_info,
+    ecs_entity_info_t * info,
+    const void * ptr)
+{
+    if (!ecs_get_info(world, entity, info) || !info->table ||
+        ecs_type_index_of(info->table->type, component) == -1)
+    {
+        ecs_entities_t to_add = {
+            .array = &component,
+            .count = 1
+        };
+
+        add_entities_w_info(world, entity, info, &to_add);
+        ecs_get_info(world, entity, info);
+    }
+
+    int32_t i, count = ecs_vector_count(c_info->fields);
+    ecs_field_t *fields = ecs_vector_first(c_info->fields, ecs_field_t);
+    for (i = 0; i < count; i ++) {
+        void *dst = get_soa_field(info, component, i);
+        ecs_assert(dst != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        if (ptr) {
+            ecs_os_memcpy(dst, ECS_OFFSET(ptr, fields[i].offset), 
+                fields[i].size);
+        } else {
+            ecs_os_memset(dst, 0, fields[i].size);
+        }
+    }
+}
+
 /* -- Private functions -- */
 
 int32_t ecs_record_to_row(
@@ -1693,6 +2186,10 @@ void ecs_clear(
         return;
     }
 
+    if (world->sparse_components) {
+        sparse_clear(world, entity);
+    }
+
     ecs_entity_info_t info;
     info.table = NULL;
 
@@ -1746,6 +2243,8 @@ void ecs_delete_children(
     }
 
     ecs_map_remove(world->child_tables, parent);
+
+    ecs_childof_delete_children(world, parent);
 }
 
 void ecs_delete(
@@ -1760,6 +2259,10 @@ void ecs_delete(
         return;
     }
 
+    if (world->sparse_components) {
+        sparse_clear(world, entity);
+    }
+
     ecs_record_t *r = ecs_sparse_remove_get(
         world->store.entity_index, ecs_record_t, entity);
     if (r) {
@@ -1767,11 +2270,17 @@ void ecs_delete(
         set_info_from_record(entity, &info, r);
         if (info.is_watched) {
             ecs_delete_children(world, entity);
+            ecs_invalidate_base_cache(world, entity);
+            ecs_instance_tables_delete(world, entity);
         }
 
         /* If entity has components, remove them */
         ecs_table_t *table = info.table;
         if (table) {
+            if (table->flags & EcsTableHasChildOf) {
+                ecs_childof_unregister(world, table, info.data, info.row);
+            }
+
             ecs_type_t type = table->type;
             ecs_entities_t to_remove = ecs_type_to_entities(type);
             delete_entity(world, table, info.data, info.row, &to_remove);
@@ -1900,6 +2409,11 @@ const void* ecs_get_w_entity(
 
     ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INTERNAL_ERROR, NULL);
 
+    ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, component);
+    if (c_info) {
+        return _ecs_sparse_get_sparse(c_info->sparse, 0, entity);
+    }
+
     bool found = ecs_get_info(world, entity, &info);
     if (found) {
         if (!info.table) {
@@ -1908,8 +2422,11 @@ const void* ecs_get_w_entity(
 
         ptr = get_component(&info, component);
         if (!ptr) {
-            if (component != ecs_typeid(EcsName) && component != EcsPrefab) {
-                ptr = get_base_component(
+            if (component != ecs_typeid(EcsName) && 
+                component != ecs_typeid(EcsChildOf) && 
+                component != EcsPrefab) 
+            {
+                ptr = get_inherited_component(
                     world, stage, &info, component);
             }
         }        
@@ -1918,6 +2435,27 @@ const void* ecs_get_w_entity(
     return ptr;
 }
 
+const void* ecs_get_field_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    int32_t field)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_get_stage(&world);
+
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(get_soa_c_info(world, component) != NULL, 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_entity_info_t info;
+    if (!ecs_get_info(world, entity, &info) || !info.table) {
+        return NULL;
+    }
+
+    return get_soa_field(&info, component, field);
+}
+
 const void* ecs_get_ref_w_entity(
     ecs_world_t * world,
     ecs_ref_t * ref,
@@ -2003,7 +2541,9 @@ void ecs_modified_w_entity(
     }
 
     ecs_entity_info_t info = {0};
-    if (ecs_get_info(world, entity, &info)) {
+    if (!ecs_get_sparse_c_info(world, component) && 
+        ecs_get_info(world, entity, &info)) 
+    {
         ecs_entities_t added = {
             .array = &component,
             .count = 1
@@ -2048,6 +2588,13 @@ ecs_entity_t assign_ptr_w_entity(
 
     ecs_entity_info_t info;
 
+    ecs_c_info_t *soa_info = get_soa_c_info(world, component);
+    if (soa_info) {
+        /* Components with fields have no lifecycle actions */
+        set_soa_fields(world, entity, component, soa_info, &info, ptr);
+        goto done;
+    }
+
     void *dst = get_mutable(world, entity, component, &info, NULL);
 
     /* This can no longer happen since we defer operations */
@@ -2081,11 +2628,15 @@ ecs_entity_t assign_ptr_w_entity(
         memset(dst, 0, size);
     }
 
-    ecs_table_mark_dirty(info.table, component);
+done:
+    /* OnSet systems are not invoked for components with sparse storage */
+    if (!ecs_get_sparse_c_info(world, component)) {
+        ecs_table_mark_dirty(info.table, component);
 
-    if (notify) {
-        ecs_run_set_systems(world, &added, 
-            info.table, info.data, info.row, 1, false);
+        if (notify) {
+            ecs_run_set_systems(world, &added, 
+                info.table, info.data, info.row, 1, false);
+        }
     }
 
     ecs_defer_flush(world, stage);
@@ -2133,6 +2684,95 @@ ecs_entity_t ecs_get_case(
     return ecs_switch_get(sw, info.row);  
 }
 
+void ecs_enable_component_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    bool enable)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component != 0, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_stage_t *stage = ecs_get_stage(&world);
+    if (ecs_defer_enable(world, stage, entity, component, enable)) {
+        return;
+    }
+
+    ecs_entity_t bs_id = (component & ECS_COMPONENT_MASK) | ECS_DISABLED;
+
+    ecs_entity_info_t info;
+    ecs_get_info(world, entity, &info);
+
+    ecs_table_t *table = info.table;
+    int32_t index = -1;
+    if (table) {
+        index = ecs_type_index_of(table->type, bs_id);
+    }
+
+    if (index == -1) {
+        /* Components are enabled by default, so if the entity doesn't have a
+         * bitset for the component yet, only add it when disabling. */
+        if (enable) {
+            goto done;
+        }
+
+        ecs_entities_t to_add = { .array = &bs_id, .count = 1 };
+        add_entities_w_info(world, entity, &info, &to_add);
+        
+        ecs_get_info(world, entity, &info);
+        table = info.table;
+        index = ecs_type_index_of(table->type, bs_id);
+        ecs_assert(index != -1, ECS_INTERNAL_ERROR, NULL);
+    }
+
+    index -= table->bs_column_offset;
+    ecs_assert(index >= 0, ECS_INTERNAL_ERROR, NULL);
+
+    /* Data cannot be NULL, since entity is stored in the table */
+    ecs_assert(info.data != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_bitset_t *bs = &info.data->bs_columns[index].data;
+    ecs_bitset_set(bs, info.row, enable);
+
+done:
+    ecs_defer_flush(world, stage);
+}
+
+bool ecs_is_component_enabled_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t component)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component != 0, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_entity_info_t info;
+    ecs_table_t *table;
+    if (!ecs_get_info(world, entity, &info) || !(table = info.table)) {
+        return false;
+    }
+
+    ecs_entity_t bs_id = (component & ECS_COMPONENT_MASK) | ECS_DISABLED;
+
+    ecs_type_t type = table->type;
+    int32_t index = ecs_type_index_of(type, bs_id);
+    if (index == -1) {
+        /* If table does not have DISABLED column for component, component is
+         * always enabled, if the entity has it */
+        return ecs_has_entity(world, entity, component);
+    }
+
+    index -= table->bs_column_offset;
+    ecs_assert(index >= 0, ECS_INTERNAL_ERROR, NULL);
+
+    /* Data cannot be NULL, since entity is stored in the table */
+    ecs_assert(info.data != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_bitset_t *bs = &info.data->bs_columns[index].data;
+
+    return ecs_bitset_get(bs, info.row);
+}
+
 bool ecs_has_entity(
     ecs_world_t *world,
     ecs_entity_t entity,
@@ -2154,6 +2794,12 @@ bool ecs_has_entity(
 
         return value == (component & ECS_COMPONENT_MASK);
     } else {
+        ecs_get_stage(&world);
+        ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, component);
+        if (c_info) {
+            return _ecs_sparse_get_sparse(c_info->sparse, 0, entity) != NULL;
+        }
+
         ecs_type_t type = ecs_get_type(world, entity);
         return ecs_type_has_entity(world, type, component);
     }
@@ -2174,6 +2820,13 @@ ecs_entity_t ecs_get_parent_w_entity(
 {
     ecs_type_t type = ecs_get_type(world, entity);    
     ecs_entity_t parent = ecs_find_in_type(world, type, component, ECS_CHILDOF);
+    if (!parent) {
+        const EcsChildOf *ptr = ecs_get(world, entity, EcsChildOf);
+        if (ptr && (!component || ecs_has_entity(world, ptr->parent, component))) {
+            parent = ptr->parent;
+        }
+    }
+
     return parent;
 }
 
@@ -2394,6 +3047,9 @@ const char* ecs_role_str(
     } else
     if (ECS_HAS_ROLE(entity, OWNED)) {
         return "OWNED";
+    } else
+    if (ECS_HAS_ROLE(entity, DISABLED)) {
+        return "DISABLED";
     } else {
         return "UNKNOWN";
     }
@@ -2437,6 +3093,15 @@ size_t ecs_entity_str(
     return required;
 }
 
+/* Allocations of deferred operations are recorded when the operation is added
+ * to the queue, and freed when the queue is flushed or the op is discarded */
+static
+void track_defer_free(
+    ecs_size_t size)
+{
+    ecs_os_track_alloc(EcsAllocDefer, size, 0);
+}
+
 static
 void flush_bulk_new(
     ecs_world_t * world,
@@ -2469,6 +3134,7 @@ void flush_bulk_new(
     }
 
     if (op->components.count > 1) {
+        track_defer_free(op->components.count * ECS_SIZEOF(ecs_entity_t));
         ecs_os_free(op->components.array);
     }
 
@@ -2483,11 +3149,13 @@ void discard_op(
 
     void *value = op->is._1.value;
     if (value) {
+        track_defer_free(op->is._1.size);
         ecs_os_free(value);
     }
 
     ecs_entity_t *components = op->components.array;
     if (components) {
+        track_defer_free(op->components.count * ECS_SIZEOF(ecs_entity_t));
         ecs_os_free(components);
     }
 }
@@ -2512,6 +3180,42 @@ bool valid_components(
 }
 
 /* Leave safe section. Run all deferred commands. */
+/* Deferred operations are counted when they are flushed, which always happens
+ * on the main thread. This prevents worker threads from having to update
+ * shared counters. */
+static
+void count_defer_op(
+    ecs_world_t *world,
+    ecs_op_t *op)
+{
+    ecs_world_info_t *stats = &world->stats;
+
+    switch(op->kind) {
+    case EcsOpNew:
+    case EcsOpClone:
+    case EcsOpBulkNew:
+        stats->defer_new_count_total ++;
+        break;
+    case EcsOpAdd:
+        stats->defer_add_count_total ++;
+        break;
+    case EcsOpRemove:
+        stats->defer_remove_count_total ++;
+        break;
+    case EcsOpSet:
+    case EcsOpMut:
+    case EcsOpModified:
+    case EcsOpEnable:
+    case EcsOpDisable:
+        stats->defer_set_count_total ++;
+        break;
+    case EcsOpDelete:
+    case EcsOpClear:
+        stats->defer_delete_count_total ++;
+        break;
+    }
+}
+
 void ecs_defer_flush(
     ecs_world_t * world,
     ecs_stage_t * stage)
@@ -2520,6 +3224,7 @@ void ecs_defer_flush(
         ecs_vector_t *defer_queue = stage->defer_queue;
         stage->defer_queue = NULL;
         if (defer_queue) {
+            uint64_t span = ecs_span_begin(world);
             ecs_op_t *ops = ecs_vector_first(defer_queue, ecs_op_t);
             int32_t i, count = ecs_vector_count(defer_queue);
             
@@ -2530,6 +3235,8 @@ void ecs_defer_flush(
                     e = 0;
                 }
 
+                count_defer_op(world, op);
+
                 /* If entity is no longer alive, this could be because the queue
                  * contained both a delete and a subsequent add/remove/set which
                  * should be ignored. */
@@ -2540,6 +3247,8 @@ void ecs_defer_flush(
                     continue;
                 }
 
+                world->stats.defer_flush_count_total ++;
+
                 if (op->components.count == 1) {
                     op->components.array = &op->component;
                 }
@@ -2576,6 +3285,12 @@ void ecs_defer_flush(
                 case EcsOpModified:
                     ecs_modified_w_entity(world, e, op->component);
                     break;
+                case EcsOpEnable:
+                    ecs_enable_component_w_entity(world, e, op->component, true);
+                    break;
+                case EcsOpDisable:
+                    ecs_enable_component_w_entity(world, e, op->component, false);
+                    break;
                 case EcsOpDelete: {
                     ecs_delete(world, e);
                     break;
@@ -2592,17 +3307,24 @@ void ecs_defer_flush(
                 }
 
                 if (op->components.count > 1) {
+                    track_defer_free(
+                        op->components.count * ECS_SIZEOF(ecs_entity_t));
                     ecs_os_free(op->components.array);
                 }
 
                 if (op->is._1.value) {
+                    track_defer_free(op->is._1.size);
                     ecs_os_free(op->is._1.value);
                 }
             };
 
             if (defer_queue != stage->defer_merge_queue) {
+                track_defer_free(
+                    ecs_vector_size(defer_queue) * ECS_SIZEOF(ecs_op_t));
                 ecs_vector_free(defer_queue);
             }
+
+            ecs_span_end(world, stage, EcsSpanDeferFlush, 0, span);
         }
     }
 }
@@ -1,6 +1,216 @@
 
 #include "private_api.h"
 
+/* -- EcsChildOf index -- */
+
+static
+ecs_map_t* get_children(
+    ecs_world_t *world,
+    ecs_entity_t parent)
+{
+    return ecs_map_get_ptr(world->childof_index, ecs_map_t*, parent);
+}
+
+static
+ecs_map_iter_t childof_iter(
+    ecs_world_t *world,
+    ecs_entity_t parent)
+{
+    ecs_map_t *children = get_children(world, parent);
+    if (children) {
+        return ecs_map_iter(children);
+    } else {
+        return (ecs_map_iter_t){ 0 };
+    }
+}
+
+/* Entries in the index are not removed when the parent of a child changes, so
+ * test if the entry is still valid before using it */
+static
+bool is_childof(
+    ecs_world_t *world,
+    ecs_entity_t child,
+    ecs_entity_t parent)
+{
+    if (!ecs_is_alive(world, child)) {
+        return false;
+    }
+
+    const EcsChildOf *ptr = ecs_get(world, child, EcsChildOf);
+    return ptr && ptr->parent == parent;
+}
+
+static
+int32_t count_children_in_index(
+    ecs_world_t *world,
+    ecs_entity_t parent)
+{
+    ecs_map_t *children = get_children(world, parent);
+    if (!children) {
+        return 0;
+    }
+
+    ecs_vector_t *stale = NULL;
+    int32_t count = 0;
+
+    ecs_map_iter_t it = ecs_map_iter(children);
+    ecs_map_key_t child;
+    while (ecs_map_next(&it, ecs_entity_t, &child)) {
+        if (is_childof(world, child, parent)) {
+            count ++;
+        } else {
+            ecs_entity_t *el = ecs_vector_add(&stale, ecs_entity_t);
+            *el = child;
+        }
+    }
+
+    /* Discard entries of children that moved to another parent. Don't do this
+     * while iterating, as a scope iterator may be iterating the index. */
+    if (!world->in_progress) {
+        ecs_vector_each(stale, ecs_entity_t, e_ptr, {
+            ecs_map_remove(children, *e_ptr);
+        });
+    }
+
+    ecs_vector_free(stale);
+
+    return count;
+}
+
+void ecs_childof_register(
+    ecs_world_t *world,
+    ecs_entity_t parent,
+    ecs_entity_t child)
+{
+    if (!world->childof_index) {
+        world->childof_index = ecs_map_new(ecs_map_t*, 1);
+    }
+
+    ecs_map_t *children = get_children(world, parent);
+    if (!children) {
+        children = ecs_map_new(ecs_entity_t, 1);
+        ecs_map_set(world->childof_index, parent, &children);
+
+        /* Ensure children are deleted when the parent is deleted */
+        ecs_set_watch(world, parent);
+    }
+
+    ecs_map_set(children, child, &child);
+}
+
+void ecs_childof_unregister(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t row)
+{
+    int32_t column = ecs_type_index_of(table->type, ecs_typeid(EcsChildOf));
+    ecs_assert(column != -1, ECS_INTERNAL_ERROR, NULL);
+
+    EcsChildOf *ptr = ecs_vector_get(
+        data->columns[column].data, EcsChildOf, row);
+    ecs_assert(ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_map_t *children = get_children(world, ptr->parent);
+    if (children) {
+        ecs_entity_t child = *ecs_vector_get(data->entities, ecs_entity_t, row);
+        ecs_map_remove(children, child);
+    }
+}
+
+ecs_vector_t* ecs_childof_get_children(
+    ecs_world_t *world,
+    ecs_entity_t parent)
+{
+    ecs_vector_t *result = NULL;
+
+    ecs_map_iter_t it = childof_iter(world, parent);
+    if (it.map) {
+        ecs_map_key_t child;
+        while (ecs_map_next(&it, ecs_entity_t, &child)) {
+            if (is_childof(world, child, parent)) {
+                ecs_entity_t *el = ecs_vector_add(&result, ecs_entity_t);
+                *el = child;
+            }
+        }
+    }
+
+    return result;
+}
+
+void ecs_childof_delete_children(
+    ecs_world_t *world,
+    ecs_entity_t parent)
+{
+    ecs_map_t *children = get_children(world, parent);
+    if (!children) {
+        return;
+    }
+
+    /* Collect children before deleting, as deleting them modifies the index */
+    ecs_vector_t *to_delete = ecs_childof_get_children(world, parent);
+
+    ecs_map_remove(world->childof_index, parent);
+    ecs_map_free(children);
+
+    ecs_vector_each(to_delete, ecs_entity_t, e_ptr, {
+        ecs_delete(world, *e_ptr);
+    });
+
+    ecs_vector_free(to_delete);
+}
+
+void ecs_childof_index_rebuild(
+    ecs_world_t *world)
+{
+    ecs_childof_index_free(world);
+
+    int32_t t, table_count = ecs_sparse_count(world->store.tables);
+    for (t = 0; t < table_count; t ++) {
+        ecs_table_t *table = ecs_sparse_get(world->store.tables, ecs_table_t, t);
+        if (!(table->flags & EcsTableHasChildOf)) {
+            continue;
+        }
+
+        ecs_data_t *data = ecs_table_get_data(table);
+        if (!data || !data->columns) {
+            continue;
+        }
+
+        int32_t column = ecs_type_index_of(
+            table->type, ecs_typeid(EcsChildOf));
+        ecs_assert(column != -1, ECS_INTERNAL_ERROR, NULL);
+
+        ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+        EcsChildOf *values = ecs_vector_first(
+            data->columns[column].data, EcsChildOf);
+
+        int32_t i, count = ecs_vector_count(data->entities);
+        for (i = 0; i < count; i ++) {
+            if (values[i].parent) {
+                ecs_childof_register(world, values[i].parent, entities[i]);
+            }
+        }
+    }
+}
+
+void ecs_childof_index_free(
+    ecs_world_t *world)
+{
+    if (!world->childof_index) {
+        return;
+    }
+
+    ecs_map_iter_t it = ecs_map_iter(world->childof_index);
+    ecs_map_t *children;
+    while ((children = ecs_map_next_ptr(&it, ecs_map_t*, NULL))) {
+        ecs_map_free(children);
+    }
+
+    ecs_map_free(world->childof_index);
+    world->childof_index = NULL;
+}
+
 static
 bool path_append(
     ecs_world_t *world, 
@@ -11,8 +221,7 @@ bool path_append(
     const char *prefix,
     ecs_strbuf_t *buf)
 {
-    ecs_type_t type = ecs_get_type(world, child);
-    ecs_entity_t cur = ecs_find_in_type(world, type, component, ECS_CHILDOF);
+    ecs_entity_t cur = ecs_get_parent_w_entity(world, child, component);
     
     if (cur) {
         if (cur != parent && cur != EcsFlecsCore) {
@@ -154,6 +363,39 @@ ecs_entity_t find_child(
     return 0;
 }
 
+static
+ecs_entity_t find_child_in_index(
+    ecs_world_t *world,
+    ecs_entity_t parent,
+    const char *name)
+{
+    ecs_map_iter_t it = childof_iter(world, parent);
+    if (!it.map) {
+        return 0;
+    }
+
+    ecs_entity_t *child_ptr;
+    while ((child_ptr = ecs_map_next(&it, ecs_entity_t, NULL))) {
+        ecs_entity_t child = *child_ptr;
+        if (!is_childof(world, child, parent)) {
+            continue;
+        }
+
+        const EcsName *ptr = ecs_get(world, child, EcsName);
+        if (!ptr) {
+            continue;
+        }
+
+        if ((ptr->value && !strcmp(ptr->value, name)) || 
+            (ptr->symbol && !strcmp(ptr->symbol, name))) 
+        {
+            return child;
+        }
+    }
+
+    return 0;
+}
+
 ecs_entity_t ecs_lookup_child(
     ecs_world_t *world,
     ecs_entity_t parent,
@@ -174,6 +416,10 @@ ecs_entity_t ecs_lookup_child(
         });
     }
 
+    if (parent) {
+        result = find_child_in_index(world, parent, name);
+    }
+
     return result;
 }
 
@@ -372,23 +618,41 @@ ecs_entity_t ecs_get_scope(
     return stage->scope;
 }
 
+void ecs_set_parent(
+    ecs_world_t *world,
+    ecs_entity_t entity,
+    ecs_entity_t parent)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(entity != parent, ECS_INVALID_PARAMETER, NULL);
+
+    if (parent) {
+        ecs_set(world, entity, EcsChildOf, { parent });
+    } else {
+        ecs_remove(world, entity, EcsChildOf);
+    }
+}
+
 int32_t ecs_get_child_count(
     ecs_world_t *world,
     ecs_entity_t entity)
 {
-    ecs_vector_t *tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, entity);
-    if (!tables) {
-        return 0;
-    } else {
-        int32_t count = 0;
+    int32_t count = 0;
 
+    ecs_vector_t *tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, entity);
+    if (tables) {
         ecs_vector_each(tables, ecs_table_t*, table_ptr, {
             ecs_table_t *table = *table_ptr;
             count += ecs_table_count(table);
         });
+    }
 
-        return count;
+    if (entity) {
+        count += count_children_in_index(world, entity);
     }
+
+    return count;
 }
 
 ecs_iter_t ecs_scope_iter(
@@ -397,7 +661,9 @@ ecs_iter_t ecs_scope_iter(
 {
     ecs_scope_iter_t iter = {
         .tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, parent),
-        .index = 0
+        .index = 0,
+        .parent = parent,
+        .children = childof_iter(world, parent)
     };
 
     return (ecs_iter_t) {
@@ -414,7 +680,9 @@ ecs_iter_t ecs_scope_iter_w_filter(
     ecs_scope_iter_t iter = {
         .filter = *filter,
         .tables = ecs_map_get_ptr(world->child_tables, ecs_vector_t*, parent),
-        .index = 0
+        .index = 0,
+        .parent = parent,
+        .children = childof_iter(world, parent)
     };
 
     return (ecs_iter_t) {
@@ -459,12 +727,54 @@ bool ecs_scope_next(
         it->table = &iter->table;
         it->table_columns = data->columns;
         it->count = ecs_table_count(table);
+        it->offset = 0;
         it->entities = ecs_vector_first(data->entities, ecs_entity_t);
         iter->index = i + 1;
 
         return true;
     }
 
+    iter->index = count;
+
+    /* Return children that store their parent in EcsChildOf one by one, as 
+     * they can be stored in any row of a table shared with other parents */
+    ecs_entity_t *child_ptr;
+    while (iter->children.map && 
+        (child_ptr = ecs_map_next(&iter->children, ecs_entity_t, NULL))) 
+    {
+        ecs_entity_t child = *child_ptr;
+        if (!is_childof(it->world, child, iter->parent)) {
+            continue;
+        }
+
+        ecs_record_t *r = ecs_eis_get(it->world, child);
+        ecs_assert(r != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        ecs_table_t *table = r->table;
+        ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        if (filter.include || filter.exclude) {
+            if (!ecs_table_match_filter(it->world, table, &filter)) {
+                continue;
+            }
+        }
+
+        ecs_data_t *data = ecs_table_get_data(table);
+        ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+
+        bool is_watched;
+        int32_t row = ecs_record_to_row(r->row, &is_watched);
+
+        iter->table.table = table;
+        it->table = &iter->table;
+        it->table_columns = data->columns;
+        it->count = 1;
+        it->offset = row;
+        it->entities = ecs_vector_get(data->entities, ecs_entity_t, row);
+
+        return true;
+    }
+
     return false;    
 }
 
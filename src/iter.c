@@ -17,6 +17,27 @@ void* get_owned_column_ptr(
     return ECS_OFFSET(buffer, column->size * (it->offset + row));
 }
 
+static
+void* get_prev_column_ptr(
+    const ecs_iter_t *it,
+    ecs_size_t size,
+    int32_t table_column,
+    int32_t row)
+{
+    ecs_data_t *data = ecs_table_get_data(it->table->table);
+    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+    (void)size;
+
+    /* The component must be double buffered to be read with [prev] */
+    ecs_assert(data->prev_columns != NULL, ECS_COLUMN_HAS_NO_DATA, NULL);
+
+    ecs_column_t *column = &data->prev_columns[table_column - 1];
+    ecs_assert(column->size != 0, ECS_COLUMN_HAS_NO_DATA, NULL);
+    ecs_assert(!size || column->size == size, ECS_COLUMN_TYPE_MISMATCH, NULL);
+    void *buffer = ecs_vector_first_t(column->data, column->size, column->alignment);
+    return ECS_OFFSET(buffer, column->size * (it->offset + row));
+}
+
 static
 const void* get_shared_column(
     const ecs_iter_t *it,
@@ -43,10 +64,45 @@ const void* get_shared_column(
 
     ecs_ref_t *ref = &refs[-table_column - 1];
 
+    /* Refs are cached in the query, which is shared between reader threads.
+     * Resolve into a local copy so that readers don't write to the query. */
+    if (ecs_is_reader_thread()) {
+        ecs_ref_t local = *ref;
+        return (void*)ecs_get_ref_w_entity(
+            it->world, &local, local.entity, local.component);
+    }
+
     return (void*)ecs_get_ref_w_entity(
         it->world, ref, ref->entity, ref->component);
 }
 
+static
+void* get_lookup_column(
+    const ecs_iter_t *it,
+    ecs_size_t size,
+    int32_t column,
+    int32_t row)
+{
+    ecs_entity_t *components = it->table->components;
+    if (!components || !it->entities) {
+        return NULL;
+    }
+
+    ecs_world_t *world = it->world;
+    ecs_get_stage(&world);
+
+    ecs_c_info_t *c_info = ecs_get_sparse_c_info(
+        world, components[column - 1]);
+    if (!c_info) {
+        return NULL;
+    }
+
+    ecs_assert(!size || c_info->size == size, ECS_COLUMN_TYPE_MISMATCH, NULL);
+    (void)size;
+
+    return _ecs_sparse_get_sparse(c_info->sparse, 0, it->entities[row]);
+}
+
 static
 bool get_table_column(
     const ecs_iter_t *it,
@@ -86,14 +142,24 @@ void* get_column(
     }
 
     if (!get_table_column(it, column, &table_column)) {
-        return NULL;
+        /* Column may be a component with sparse storage */
+        return get_lookup_column(it, size, column, row);
     }
 
     if (table_column < 0) {
         return (void*)get_shared_column(it, size, table_column);
-    } else {
-        return get_owned_column_ptr(it, size, table_column, row);
     }
+
+    ecs_query_t *query = it->query;
+    if (query && (query->flags & EcsQueryHasPrev)) {
+        ecs_sig_column_t *column_data = ecs_vector_get(
+            query->sig.columns, ecs_sig_column_t, column - 1);
+        if (column_data->inout_kind == EcsInPrev) {
+            return get_prev_column_ptr(it, size, table_column, row);
+        }
+    }
+
+    return get_owned_column_ptr(it, size, table_column, row);
 }
 
 
@@ -116,6 +182,44 @@ void* ecs_element_w_size(
     return get_column(it, ecs_from_size_t(size), column, row);
 }
 
+void* ecs_column_field_w_size(
+    const ecs_iter_t *it,
+    size_t size,
+    int32_t column,
+    int32_t field)
+{
+    ecs_assert(column > 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(field >= 0, ECS_INVALID_PARAMETER, NULL);
+
+    int32_t table_column;
+    if (!get_table_column(it, column, &table_column)) {
+        return NULL;
+    }
+
+    /* Fields can only be accessed as arrays for owned components */
+    ecs_assert(table_column > 0, ECS_COLUMN_IS_SHARED, NULL);
+
+    ecs_table_t *table = it->table->table;
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t soa_index = ecs_table_soa_column_index(table, table_column - 1);
+    ecs_assert(soa_index != -1, ECS_COLUMN_HAS_NO_DATA, NULL);
+    ecs_assert(field < ecs_vector_count(table->c_info[table_column - 1]->fields), 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_column_t *soa_column = &data->soa_columns[soa_index + field];
+    ecs_assert(!size || soa_column->size == ecs_from_size_t(size), 
+        ECS_COLUMN_TYPE_MISMATCH, NULL);
+    (void)size;
+
+    void *buffer = ecs_vector_first_t(
+        soa_column->data, soa_column->size, soa_column->alignment);
+    return ECS_OFFSET(buffer, soa_column->size * it->offset);
+}
+
 bool ecs_is_owned(
     const ecs_iter_t *it,
     int32_t column)
@@ -141,7 +245,8 @@ bool ecs_is_readonly(
     ecs_sig_column_t *column_data = ecs_vector_get(
         it->query->sig.columns, ecs_sig_column_t, column - 1);
 
-    return column_data->inout_kind == EcsIn;
+    ecs_sig_inout_kind_t inout = column_data->inout_kind;
+    return inout == EcsIn || inout == EcsInPrev;
 }
 
 ecs_entity_t ecs_column_source(
@@ -255,6 +360,20 @@ void* ecs_table_column(
     return ecs_vector_first_t(column->data, column->size, column->alignment);
 }
 
+void* ecs_table_column_w_offset(
+    const ecs_iter_t *it,
+    int32_t column_index)
+{
+    void *first = ecs_table_column(it, column_index);
+    if (!first) {
+        return NULL;
+    }
+
+    ecs_column_t *columns = it->table_columns;
+    ecs_column_t *column = &columns[column_index];
+    return ECS_OFFSET(first, column->size * it->offset);
+}
+
 size_t ecs_table_column_size(
     const ecs_iter_t *it,
     int32_t column_index)
@@ -3,6 +3,7 @@
 #define LOAD_FACTOR (1.5)
 #define KEY_SIZE (ECS_SIZEOF(ecs_map_key_t))
 #define BUCKET_COUNT (8)
+#define BUCKET_CHUNK_COUNT (64)
 #define ELEM_SIZE(elem_size) (KEY_SIZE + elem_size)
 #define BUCKET_SIZE(elem_size, offset)\
     (offset + BUCKET_COUNT * (ELEM_SIZE(elem_size)))
@@ -246,6 +247,13 @@ ecs_map_t* _ecs_map_new(
     result->bucket_count = bucket_count;
     result->buckets = _ecs_sparse_new(BUCKET_SIZE(elem_size, result->offset));
 
+    /* Bucket ids are lower than the bucket count, so most maps only use the
+     * first buckets of a chunk. Keep chunks small to reduce the cost of
+     * creating maps. */
+    ecs_sparse_set_chunk_size(result->buckets, BUCKET_CHUNK_COUNT);
+    ecs_sparse_set_alloc_tag(result->buckets, EcsAllocMap);
+    ecs_os_track_alloc(EcsAllocMap, 0, ECS_SIZEOF(ecs_map_t));
+
     return result;
 }
 
@@ -254,6 +262,7 @@ void ecs_map_free(
 {
     if (map) {
         ecs_sparse_free(map->buckets);
+        ecs_os_track_alloc(EcsAllocMap, ECS_SIZEOF(ecs_map_t), 0);
         ecs_os_free(map);
     }
 }
@@ -544,6 +553,7 @@ ecs_map_t* ecs_map_copy(
     ecs_map_t *dst = ecs_os_memdup(src, ECS_SIZEOF(ecs_map_t));
     
     dst->buckets = ecs_sparse_copy(src->buckets);
+    ecs_os_track_alloc(EcsAllocMap, 0, ECS_SIZEOF(ecs_map_t));
 
     return dst;
 }
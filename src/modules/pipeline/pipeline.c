@@ -10,7 +10,8 @@ typedef struct EcsPipelineQuery {
     ecs_query_t *query;
     ecs_query_t *build_query;
     int32_t match_count;
-    ecs_vector_t *ops;
+    ecs_vector_t *program;
+    int32_t sync_count;
 } EcsPipelineQuery;
 
 ECS_CTOR(EcsPipelineQuery, ptr, {
@@ -18,7 +19,7 @@ ECS_CTOR(EcsPipelineQuery, ptr, {
 })
 
 ECS_DTOR(EcsPipelineQuery, ptr, {
-    ecs_vector_free(ptr->ops);
+    ecs_vector_free(ptr->program);
 })
 
 static
@@ -125,6 +126,12 @@ bool check_column_component(
 {
     int32_t state = get_write_state(write_state->components, component);
 
+    /* Values of the previous frame are not modified while the frame is running,
+     * so reading them never requires a merge */
+    if (column->inout_kind == EcsInPrev) {
+        return false;
+    }
+
     if ((column->from_kind == EcsFromAny || column->from_kind == EcsFromOwned) 
       && column->oper_kind != EcsOperNot) 
     {
@@ -141,6 +148,9 @@ bool check_column_component(
             if (is_active && column->inout_kind != EcsIn) {
                 set_write_state(write_state, component, WriteToMain);
             }
+            break;
+        default:
+            break;
         };
     } else if (column->from_kind == EcsFromEmpty || 
                column->oper_kind == EcsOperNot) 
@@ -194,17 +204,20 @@ bool build_pipeline(
 
     world->stats.pipeline_build_count_total ++;
 
+    uint64_t span = ecs_span_begin(world);
+
     write_state_t ws = {
         .components = ecs_map_new(int32_t, ECS_HI_COMPONENT_ID),
         .wildcard = false
     };
 
-    ecs_pipeline_op_t *op = NULL;
-    ecs_vector_t *ops = NULL;
+    ecs_vector_t *program = NULL;
+    int32_t sync_count = 0;
+    bool system_since_merge = false;
     ecs_query_t *query = pq->build_query;
 
-    if (pq->ops) {
-        ecs_vector_free(pq->ops);
+    if (pq->program) {
+        ecs_vector_free(pq->program);
     }
 
     /* Iterate systems in pipeline, add ops for running / merging */
@@ -230,7 +243,17 @@ bool build_pipeline(
             if (needs_merge) {
                 /* After merge all components will be merged, so reset state */
                 reset_write_state(&ws);
-                op = NULL;
+
+                /* Also insert sync points after inactive systems, as they may
+                 * become active after a merge earlier in the same frame */
+                if (system_since_merge) {
+                    ecs_pipeline_op_t *op = ecs_vector_add(
+                        &program, ecs_pipeline_op_t);
+                    op->system = 0;
+                    op->system_data = NULL;
+                    sync_count ++;
+                    system_since_merge = false;
+                }
 
                 /* Re-evaluate columns to set write flags if system is active.
                  * If system is inactive, it can't write anything and so it
@@ -247,58 +270,69 @@ bool build_pipeline(
                 ecs_assert(needs_merge == false, ECS_INTERNAL_ERROR, NULL);        
             }
 
-            if (!op) {
-                op = ecs_vector_add(&ops, ecs_pipeline_op_t);
-                op->count = 0;
-            }
-
-            /* Don't increase count for inactive systems, as they are ignored by
-             * the query used to run the pipeline. */
+            /* Inactive systems are not added to the program, so that threads
+             * don't have to test for them while running the pipeline. */
             if (is_active) {
-                op->count ++;
+                ecs_pipeline_op_t *op = ecs_vector_add(
+                    &program, ecs_pipeline_op_t);
+                op->system = it.entities[i];
+                op->system_data = &sys[i];
             }
+
+            system_since_merge = true;
         }
     }
 
     ecs_map_free(ws.components);
 
+    /* Every thread synchronizes once more after the last system */
+    if (system_since_merge) {
+        sync_count ++;
+    }
+
     /* Force sort of query as this could increase the match_count */
     pq->match_count = pq->query->match_count;
-    pq->ops = ops;
+    pq->program = program;
+    pq->sync_count = sync_count;
+
+    ecs_span_end(world, &world->stage, EcsSpanPipelineBuild, pipeline, span);
 
     return true;
 }
 
+/* Find the position in a (rebuilt) program after a sync point. If a system ran
+ * before the sync point, the position is the sync point after that system. If
+ * no system ran yet, the position is the sync point with the provided index. */
 static
-int32_t iter_reset(
+int32_t program_find(
     const EcsPipelineQuery *pq,
-    ecs_iter_t *iter_out,
-    ecs_pipeline_op_t **op_out,
-    ecs_entity_t move_to)
+    ecs_entity_t system,
+    int32_t sync_index)
 {
-    ecs_pipeline_op_t *op = ecs_vector_first(pq->ops, ecs_pipeline_op_t);
-    int32_t ran_since_merge = 0;
-
-    ecs_iter_t it = ecs_query_iter(pq->query);
-    while (ecs_query_next(&it)) {
-        int32_t i;
-        for(i = 0; i < it.count; i ++) {
-            ecs_entity_t e = it.entities[i];
+    ecs_pipeline_op_t *ops = ecs_vector_first(pq->program, ecs_pipeline_op_t);
+    int32_t i, count = ecs_vector_count(pq->program);
 
-            ran_since_merge ++;
-            if (ran_since_merge == op->count) {
-                ran_since_merge = 0;
-                op ++;
+    for (i = 0; i < count; i ++) {
+        if (system) {
+            if (ops[i].system == system) {
+                if (i + 1 < count && !ops[i + 1].system) {
+                    i ++;
+                }
+                return i;
             }
-
-            if (e == move_to) {
-                *iter_out = it;
-                *op_out = op;
+        } else if (!ops[i].system) {
+            if (!sync_index) {
                 return i;
             }
+            sync_index --;
         }
     }
 
+    /* The rebuilt program has fewer sync points, continue at the end */
+    if (!system) {
+        return count;
+    }
+
     ecs_abort(ECS_UNSUPPORTED, NULL);
 
     return -1;
@@ -313,7 +347,7 @@ int32_t ecs_pipeline_update(
     ecs_assert(pq->query != NULL, ECS_INTERNAL_ERROR, NULL);
 
     if (build_pipeline(world, pipeline, pq)) {
-        return ecs_vector_count(pq->ops);
+        return pq->sync_count;
     } else {
         return 0;
     }
@@ -334,7 +368,7 @@ int32_t ecs_pipeline_begin(
 
     build_pipeline(world, pipeline, pq);
 
-    return ecs_vector_count(pq->ops);
+    return pq->sync_count;
 }
 
 void ecs_pipeline_end(
@@ -352,43 +386,34 @@ void ecs_pipeline_progress(
     ecs_assert(pq != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(pq->query != NULL, ECS_INTERNAL_ERROR, NULL);
 
-    ecs_vector_t *ops = pq->ops;
-    ecs_pipeline_op_t *op = ecs_vector_first(ops, ecs_pipeline_op_t);
-    ecs_pipeline_op_t *op_last = ecs_vector_last(ops, ecs_pipeline_op_t);
-    int32_t ran_since_merge = 0;
-
     ecs_worker_begin(world);
     ecs_stage_t *stage = ecs_get_stage(&world);
-    
-    ecs_iter_t it = ecs_query_iter(pq->query);
-    while (ecs_query_next(&it)) {
-        EcsSystem *sys = ecs_column(&it, EcsSystem, 1);
 
-        int32_t i;
-        for(i = 0; i < it.count; i ++) {
-            ecs_entity_t e = it.entities[i];
-            
-            ecs_run_intern(world, stage, e, &sys[i], delta_time, 0, 0, 
-                NULL, NULL, false);
+    ecs_pipeline_op_t *ops = ecs_vector_first(pq->program, ecs_pipeline_op_t);
+    int32_t i, count = ecs_vector_count(pq->program);
+    ecs_entity_t last_system = 0;
+    int32_t sync_index = 0;
 
-            ran_since_merge ++;
-            world->stats.systems_ran_frame ++;
+    for (i = 0; i < count; i ++) {
+        ecs_pipeline_op_t *op = &ops[i];
+        ecs_entity_t system = op->system;
 
-            if (op != op_last && ran_since_merge == op->count) {
-                ran_since_merge = 0;
-                op++;
-
-                /* If the set of matched systems changed as a result of the
-                 * merge, we have to reset the iterator and move it to our
-                 * current position (system). If there are a lot of systems
-                 * in the pipeline this can be an expensive operation, but
-                 * should happen infrequently. */
-                if (ecs_worker_sync(world)) {
-                    i = iter_reset(pq, &it, &op, e);
-                    op_last = ecs_vector_last(pq->ops, ecs_pipeline_op_t);
-                    sys = ecs_column(&it, EcsSystem, 1);
-                }
+        if (system) {
+            ecs_run_intern(world, stage, system, op->system_data, delta_time, 
+                0, 0, NULL, NULL, false);
+
+            world->stats.systems_ran_frame ++;
+            last_system = system;
+        } else {
+            /* If the set of matched systems changed as a result of the merge,
+             * the program has been rebuilt, and we have to move to our current
+             * position in the new program. This should happen infrequently. */
+            if (ecs_worker_sync(world)) {
+                ops = ecs_vector_first(pq->program, ecs_pipeline_op_t);
+                count = ecs_vector_count(pq->program);
+                i = program_find(pq, last_system, sync_index);
             }
+            sync_index ++;
         }
     }
 
@@ -478,7 +503,7 @@ void EcsOnAddPipeline(
         pq->query = query;
         pq->build_query = build_query;
         pq->match_count = -1;
-        pq->ops = NULL;
+        pq->program = NULL;
 
         ecs_log_pop();
     }
@@ -6,12 +6,35 @@
 #include "flecs/modules/pipeline.h"
 
 /** Instruction data for pipeline.
- * This type is the element type in the "ops" vector of a pipeline and contains
- * information about the set of systems that need to be ran before a merge. */
+ * This type is the element type of the flat program of a pipeline. The program
+ * contains the active systems of the pipeline in the order in which they are
+ * ran, and a sync point for every merge. Threads walk the program directly,
+ * without iterating the pipeline query. */
 typedef struct ecs_pipeline_op_t {
-    int32_t count;              /**< Number of systems to run before merge */
+    ecs_entity_t system;        /**< System to run, 0 for a sync point */
+    EcsSystem *system_data;     /**< System data of system */
 } ecs_pipeline_op_t;
 
+/** Row chunk of a parallel query job. */
+typedef struct ecs_par_chunk_t {
+    ecs_iter_table_t *table;    /**< Matched table */
+    void *table_columns;        /**< Table component data */
+    ecs_entity_t *entities;     /**< Entities of the chunk */
+    int32_t offset;             /**< Offset of the chunk in the table */
+    int32_t count;              /**< Number of entities in the chunk */
+    int32_t frame_offset;       /**< Offset relative to start of iteration */
+} ecs_par_chunk_t;
+
+/** Parallel query job.
+ * Chunks are claimed by the main thread and worker threads with an atomic
+ * increment, until all chunks have been processed. */
+typedef struct ecs_par_job_t {
+    ecs_iter_t it;              /**< Iterator template shared by all chunks */
+    ecs_iter_action_t action;   /**< Action invoked for each chunk */
+    ecs_vector_t *chunks;       /**< Row chunks (ecs_par_chunk_t) */
+    int32_t next_chunk;         /**< Number of claimed chunks */
+} ecs_par_job_t;
+
 ////////////////////////////////////////////////////////////////////////////////
 //// Pipeline API
 ////////////////////////////////////////////////////////////////////////////////
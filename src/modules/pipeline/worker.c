@@ -4,12 +4,113 @@
 
 #include "pipeline.h"
 
+/* Invoke action of parallel query job for a single chunk */
+static
+void par_chunk_run(
+    ecs_par_job_t *job,
+    ecs_iter_t *it,
+    int32_t index)
+{
+    ecs_par_chunk_t *chunk = ecs_vector_get(
+        job->chunks, ecs_par_chunk_t, index);
+    it->table = chunk->table;
+    it->table_columns = chunk->table_columns;
+    it->entities = chunk->entities;
+    it->offset = chunk->offset;
+    it->count = chunk->count;
+    it->total_count = chunk->count;
+    it->frame_offset = chunk->frame_offset;
+    job->action(it);
+}
+
+/* Process chunks of parallel query job until no chunks are left. When the job
+ * is shared with worker threads, chunks are claimed with an atomic increment */
+static
+void par_job_run(
+    ecs_world_t *world,
+    ecs_par_job_t *job,
+    bool shared)
+{
+    ecs_iter_t it = job->it;
+    it.world = world;
+
+    ecs_defer_begin(world);
+
+    int32_t i, count = ecs_vector_count(job->chunks);
+    if (shared) {
+        while ((i = ecs_os_ainc(&job->next_chunk) - 1) < count) {
+            par_chunk_run(job, &it, i);
+        }
+    } else {
+        for (i = 0; i < count; i ++) {
+            par_chunk_run(job, &it, i);
+        }
+    }
+
+    ecs_defer_end(world);
+}
+
+/* Split query results into chunks of at most chunk_size entities */
+static
+void par_job_init(
+    ecs_par_job_t *job,
+    ecs_query_t *query,
+    int32_t chunk_size)
+{
+    ecs_iter_t it = ecs_query_iter(query);
+
+    while (ecs_query_next(&it)) {
+        int32_t offset = 0;
+        do {
+            int32_t count = it.count - offset;
+            if (count > chunk_size) {
+                count = chunk_size;
+            }
+
+            ecs_par_chunk_t *chunk = ecs_vector_add(
+                &job->chunks, ecs_par_chunk_t);
+            chunk->table = it.table;
+            chunk->table_columns = it.table_columns;
+            chunk->entities = it.entities ? &it.entities[offset] : NULL;
+            chunk->offset = it.offset + offset;
+            chunk->count = count;
+            chunk->frame_offset = it.frame_offset + offset;
+
+            offset += count;
+        } while (offset < it.count);
+    }
+
+    job->it = it;
+}
+
+/* Synchronize worker threads */
+static
+void sync_worker(
+    ecs_world_t *world)
+{
+    int32_t thread_count = ecs_vector_count(world->workers);
+
+    /* Signal that thread is waiting */
+    ecs_os_mutex_lock(world->sync_mutex);
+    if (++ world->workers_waiting == thread_count) {
+        /* Only signal main thread when all threads are waiting */
+        ecs_os_cond_signal(world->sync_cond);
+    }
+
+    /* Wait until main thread signals that thread can continue */
+    ecs_os_cond_wait(world->worker_cond, world->sync_mutex);
+    ecs_os_mutex_unlock(world->sync_mutex);
+}
+
 /* Worker thread */
 static
 void* worker(void *arg) {
     ecs_thread_t *thread = arg;
     ecs_world_t *world = thread->world;
 
+    /* Record allocations of the thread in its stage until it is merged */
+    ecs_os_set_thread_alloc_tags(thread->stage->alloc_tags);
+
     /* Start worker thread, increase counter so main thread knows how many
      * workers are ready */
     ecs_os_mutex_lock(world->sync_mutex);
@@ -22,6 +123,15 @@ void* worker(void *arg) {
     ecs_os_mutex_unlock(world->sync_mutex);
 
     while (!world->quit_workers) {
+        /* If the workers were woken up for a parallel query job, process
+         * chunks until the job is done and wait for the next signal */
+        ecs_par_job_t *job = world->par_job;
+        if (job) {
+            par_job_run((ecs_world_t*)thread, job, true);
+            sync_worker(world);
+            continue;
+        }
+
         ecs_entity_t old_scope = ecs_set_scope((ecs_world_t*)thread, 0);
         ecs_pipeline_progress(
             (ecs_world_t*)thread, 
@@ -85,25 +195,6 @@ void wait_for_workers(
     } while (wait);
 }
 
-/* Synchronize worker threads */
-static
-void sync_worker(
-    ecs_world_t *world)
-{
-    int32_t thread_count = ecs_vector_count(world->workers);
-
-    /* Signal that thread is waiting */
-    ecs_os_mutex_lock(world->sync_mutex);
-    if (++ world->workers_waiting == thread_count) {
-        /* Only signal main thread when all threads are waiting */
-        ecs_os_cond_signal(world->sync_cond);
-    }
-
-    /* Wait until main thread signals that thread can continue */
-    ecs_os_cond_wait(world->worker_cond, world->sync_mutex);
-    ecs_os_mutex_unlock(world->sync_mutex);
-}
-
 /* Wait until all threads are waiting on sync point */
 static
 void wait_for_sync(
@@ -229,7 +320,9 @@ void ecs_workers_progress(
             signal_workers(world);
 
             /* Wait until all workers are waiting on sync point */
+            uint64_t span = ecs_span_begin(world);
             wait_for_sync(world);
+            ecs_span_end(world, &world->stage, EcsSpanSync, 0, span);
 
             /* Merge */
             ecs_staging_end(world);
@@ -253,6 +346,50 @@ void ecs_workers_progress(
 
 /* -- Public functions -- */
 
+void ecs_query_par_iter(
+    ecs_query_t *query,
+    ecs_iter_action_t action,
+    int32_t chunk_size,
+    void *param)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(action != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(chunk_size > 0, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_world_t *world = query->world;
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+
+    ecs_par_job_t job = { .action = action };
+    par_job_init(&job, query, chunk_size);
+    job.it.param = param;
+
+    /* Operations that modify the world are deferred while the job runs, and
+     * merged once all chunks have been processed */
+    ecs_staging_begin(world);
+
+    int32_t thread_count = ecs_vector_count(world->workers);
+    if (thread_count > 1) {
+        wait_for_workers(world);
+
+        world->par_job = &job;
+        world->workers_waiting = 0;
+        signal_workers(world);
+
+        /* The main thread processes chunks together with the workers */
+        par_job_run(world, &job, true);
+
+        wait_for_sync(world);
+        world->par_job = NULL;
+    } else {
+        par_job_run(world, &job, false);
+    }
+
+    ecs_staging_end(world);
+
+    ecs_vector_free(job.chunks);
+}
+
 void ecs_set_threads(
     ecs_world_t *world,
     int32_t threads)
@@ -276,6 +413,11 @@ void ecs_set_threads(
             world->sync_cond = ecs_os_cond_new();
             world->sync_mutex = ecs_os_mutex_new();
             world->stage_count = 2 + threads;
+#ifdef FLECS_PROFILER
+            /* Make sure there is a ring buffer for each worker before the
+             * workers start recording spans */
+            ecs_profiler_set_threads(world, threads);
+#endif
             start_workers(world, threads);
         }
 
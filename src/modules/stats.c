@@ -82,6 +82,99 @@ void StatsAddTypeStats(ecs_iter_t *it) {
     }
 }
 
+/* -- Latency statistics -- */
+
+/* Find first sample in sorted array that is not smaller than value */
+static
+int32_t find_sample(
+    const float *sorted,
+    int32_t count,
+    float value)
+{
+    int32_t lo = 0, hi = count;
+    while (lo < hi) {
+        int32_t mid = (lo + hi) / 2;
+        if (sorted[mid] < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static
+float get_percentile(
+    float *sorted,
+    int32_t count,
+    int32_t percentile)
+{
+    /* Nearest rank */
+    int32_t rank = (percentile * count + 99) / 100;
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+static
+int32_t get_histogram_bucket(
+    float sample)
+{
+    float us = sample * 1000000.0f;
+    float threshold = 1.0f;
+    int32_t bucket = 0;
+
+    while (us >= threshold && bucket < (ECS_STAT_HISTOGRAM_BUCKETS - 1)) {
+        threshold *= 2.0f;
+        bucket ++;
+    }
+
+    return bucket;
+}
+
+static
+void record_latency(
+    ecs_latency_stat_t *stat,
+    float sample)
+{
+    /* Also rejects NaN, which would break the order of the sorted samples */
+    if (!(sample >= 0)) {
+        sample = 0;
+    }
+
+    /* Keep the sorted samples and histogram up to date as samples enter and
+     * leave the window, so that recording a sample is O(window size). */
+    float *sorted = stat->sorted;
+    int32_t i, count = stat->samples_count;
+
+    if (count == ECS_STAT_WINDOW_SIZE) {
+        float evicted = stat->window[stat->window_index];
+        stat->histogram[get_histogram_bucket(evicted)] --;
+
+        i = find_sample(sorted, count, evicted);
+        ecs_assert(i < count, ECS_INTERNAL_ERROR, NULL);
+        count --;
+        memmove(&sorted[i], &sorted[i + 1],
+            ecs_to_size_t(count - i) * sizeof(float));
+    }
+
+    stat->window[stat->window_index] = sample;
+    stat->window_index = (stat->window_index + 1) % ECS_STAT_WINDOW_SIZE;
+    stat->histogram[get_histogram_bucket(sample)] ++;
+
+    i = find_sample(sorted, count, sample);
+    memmove(&sorted[i + 1], &sorted[i],
+        ecs_to_size_t(count - i) * sizeof(float));
+    sorted[i] = sample;
+    stat->samples_count = ++ count;
+
+    stat->p50_seconds = get_percentile(sorted, count, 50);
+    stat->p95_seconds = get_percentile(sorted, count, 95);
+    stat->p99_seconds = get_percentile(sorted, count, 99);
+    stat->max_seconds = sorted[count - 1];
+}
+
 /* -- Systems that collect metrics on interest -- */
 
 static
@@ -107,6 +200,20 @@ void StatsCollectWorldStats(ecs_iter_t *it) {
 
     ecs_world_t *world = it->world;
 
+    /* If a frame was processed since the last time stats were collected, add
+     * the time spent since then to the latency windows. Skip the first time
+     * stats are collected, as time was not measured before that. */
+    if (stats->frame_count_total &&
+        world->stats.frame_count_total > stats->frame_count_total)
+    {
+        record_latency(&stats->frame_latency, (float)(
+            world->stats.frame_time_total - stats->frame_seconds_total));
+        record_latency(&stats->system_latency, (float)(
+            world->stats.system_time_total - stats->system_seconds_total));
+        record_latency(&stats->merge_latency, (float)(
+            world->stats.merge_time_total - stats->merge_seconds_total));
+    }
+
     stats->entities_count = ecs_eis_count(world);
     stats->components_count = ecs_count(world, EcsComponent);
     stats->col_systems_count = ecs_count(world, EcsSystem);
@@ -119,16 +226,52 @@ void StatsCollectWorldStats(ecs_iter_t *it) {
     stats->world_seconds_total = world->stats.world_time_total;
     stats->target_fps_hz = world->stats.target_fps;
     stats->frame_count_total = world->stats.frame_count_total;
+
+    stats->table_create_count_total = world->stats.table_create_count_total;
+    stats->table_delete_count_total = world->stats.table_delete_count_total;
+    stats->table_move_count_total = world->stats.table_move_count_total;
+    stats->table_append_count_total = world->stats.table_append_count_total;
+    stats->table_remove_count_total = world->stats.table_remove_count_total;
+    stats->defer_new_count_total = world->stats.defer_new_count_total;
+    stats->defer_add_count_total = world->stats.defer_add_count_total;
+    stats->defer_remove_count_total = world->stats.defer_remove_count_total;
+    stats->defer_set_count_total = world->stats.defer_set_count_total;
+    stats->defer_delete_count_total = world->stats.defer_delete_count_total;
+    stats->defer_flush_count_total = world->stats.defer_flush_count_total;
+    stats->rematch_count_total = world->stats.rematch_count_total;
+    stats->monitor_eval_count_total = world->stats.monitor_eval_count_total;
 }
 
 static
 void StatsCollectAllocStats(ecs_iter_t *it) {
     ECS_COLUMN(it, EcsAllocStats, stats, 1);
 
+    /* Rates can only be computed once previous totals have been collected */
+    bool has_prev = stats->malloc_count_total != 0;
+    float delta_time = it->delta_time;
+
     stats->malloc_count_total = ecs_os_api_malloc_count;
     stats->calloc_count_total = ecs_os_api_calloc_count;
     stats->realloc_count_total = ecs_os_api_realloc_count;
     stats->free_count_total = ecs_os_api_free_count;
+
+    int32_t i;
+    for (i = 0; i < EcsAllocTagCount; i ++) {
+        ecs_alloc_tag_stats_t *src = &ecs_os_api_alloc_tags[i];
+        ecs_alloc_tag_stat_t *dst = &stats->tags[i];
+
+        if (has_prev && delta_time > 0) {
+            dst->alloc_rate = 
+                (float)(src->alloc_count - dst->alloc_count_total) / delta_time;
+            dst->free_rate = 
+                (float)(src->free_count - dst->free_count_total) / delta_time;
+        }
+
+        dst->allocd_bytes = src->bytes;
+        dst->alloc_count_total = src->alloc_count;
+        dst->realloc_count_total = src->realloc_count;
+        dst->free_count_total = src->free_count;
+    }
 }
 
 static
@@ -314,6 +457,16 @@ void StatsCollectSystemStats(ecs_iter_t *it) {
         stats[i].tables_matched_count = system_tables_matched(&system[i]);
         stats[i].entities_matched_count = system_entities_matched(&system[i]);
         stats[i].period_seconds = ecs_get_interval(it->world, system[i].tick_source);
+
+        /* Only add sample to latency window if system ran since the last time
+         * stats were collected, and stats were collected before */
+        if (stats[i].invoke_count_total &&
+            system[i].invoke_count > stats[i].invoke_count_total)
+        {
+            record_latency(&stats[i].latency, 
+                system[i].time_spent - stats[i].seconds_total);
+        }
+
         stats[i].seconds_total = system[i].time_spent;
         stats[i].invoke_count_total = system[i].invoke_count;
         stats[i].is_enabled = !ecs_has_entity(it->world, entity, EcsDisabled);
@@ -374,6 +527,25 @@ void StatsCollectColSystemMemoryStats(ecs_iter_t *it) {
     }
 }
 
+static
+void StatsCollectComponentStats_StatusAction(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    ecs_system_status_t status,
+    void *ctx)
+{
+    (void)system;
+    (void)ctx;
+
+    /* Tables maintain component statistics while the system is enabled, so
+     * that collecting them does not require walking all tables */
+    if (status == EcsSystemEnabled) {
+        ecs_track_component_stats(world, true);
+    } else if (status == EcsSystemDisabled) {
+        ecs_track_component_stats(world, false);
+    }
+}
+
 static
 void StatsCollectComponentStats(ecs_iter_t *it) {
     EcsComponent *component = ecs_column(it, EcsComponent, 1);
@@ -386,38 +558,17 @@ void StatsCollectComponentStats(ecs_iter_t *it) {
         stats[i].entity = entity;
         stats[i].name = ecs_get_name(it->world, entity);
         stats[i].size_bytes = component[i].size;
-        
-        /* Reset values */
         stats[i].tables_count = 0;
         stats[i].entities_count = 0;
         stats[i].memory = (ecs_memory_stat_t){0};
 
-        /* Walk tables to collect memory and entity stats per component */
-        ecs_sparse_t *tables = it->world->store.tables;
-        int32_t t, count = ecs_sparse_count(it->world->store.tables);
-
-        for (t = 0; t < count; t ++) {
-            ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, t);
-            ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
-            int32_t c, c_count = table->column_count;
-
-            /* Iterate over table columns until component is found */
-            ecs_data_t *data = ecs_table_get_data(table);
-            ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
-            ecs_column_t *columns = data->columns;
-            ecs_assert(columns != NULL, ECS_INTERNAL_ERROR, NULL);
-
-            for (c = 0; c < c_count; c ++) {
-                if (components[c] == entity) {
-                    ecs_vector_t *column = columns[c].data;
-                    stats[i].tables_count ++;
-                    stats[i].entities_count += ecs_vector_count(column);
-                    ecs_vector_memory_t(column, columns[c].size, columns[c].alignment, 
-                        &stats[i].memory.allocd_bytes, 
-                        &stats[i].memory.used_bytes);
-                    break;
-                }
-            }
+        const ecs_component_stats_t *cs = ecs_get_component_stats(
+            it->world, entity);
+        if (cs) {
+            stats[i].tables_count = cs->tables_count;
+            stats[i].entities_count = cs->entities_count;
+            stats[i].memory.used_bytes = cs->used_bytes;
+            stats[i].memory.allocd_bytes = cs->allocd_bytes;
         }
     }
 }
@@ -429,8 +580,11 @@ void StatsCollectTableStats_StatusAction(
     ecs_system_status_t status,
     void *ctx)
 {
-    ecs_type_t ecs_type(EcsTablePtr) = ctx;
-    ecs_entity_t ecs_typeid(EcsTablePtr) = ecs_type_to_entity(world, ecs_type(EcsTablePtr));
+    /* The context is the component id and not its type, so that it remains
+     * valid for worlds that are created from this world as a template */
+    ecs_entity_t ecs_typeid(EcsTablePtr) = (ecs_entity_t)(uintptr_t)ctx;
+    ecs_type_t ecs_type(EcsTablePtr) = ecs_type_from_entity(
+        world, ecs_typeid(EcsTablePtr));
 
     (void)system;
 
@@ -474,7 +628,7 @@ void collect_table_data_memory(
 
     for (c = 0; c < count; c ++) {
         ecs_column_t *column = &columns[c];
-        ecs_vector_memory_t(column->data, columns->size, columns->alignment,
+        ecs_vector_memory_t(column->data, column->size, column->alignment,
             &stats->component_memory.allocd_bytes, 
             &stats->component_memory.used_bytes);
     }
@@ -507,6 +661,10 @@ void StatsCollectTableStats(ecs_iter_t *it) {
     }
 }
 
+/* Type instance counts are not maintained incrementally. A table matches a
+ * type if it has the type's components, including components inherited from
+ * a base, which can change after the table is created. Instances are counted
+ * by matching all tables each time stats are collected. */
 static
 void StatsCollectTypeStats(ecs_iter_t *it) {
     EcsType *type_component = ecs_column(it, EcsType, 1);
@@ -672,6 +830,11 @@ void FlecsStatsImport(
         EcsComponent, [out] EcsComponentStats,
         SYSTEM:EcsOnDemand, SYSTEM:Hidden);
 
+    /* This handler enables tracking of component stats when system is enabled */
+    ecs_set_system_status_action(
+        world, StatsCollectComponentStats, 
+        StatsCollectComponentStats_StatusAction, NULL);
+
     ECS_SYSTEM(world, StatsCollectTableStats, EcsPostLoad,
         EcsTablePtr, [out] EcsTableStats,
         SYSTEM:EcsOnDemand, SYSTEM:Hidden);
@@ -679,7 +842,7 @@ void FlecsStatsImport(
     /* This handler creates entities for tables when system is enabled */
     ecs_set_system_status_action(
         world, StatsCollectTableStats, StatsCollectTableStats_StatusAction, 
-        ecs_type(EcsTablePtr));
+        (void*)(uintptr_t)ecs_typeid(EcsTablePtr));
 
     ECS_SYSTEM(world, StatsCollectTypeStats, EcsPostLoad,
         EcsType, [out] EcsTypeStats,
@@ -358,6 +358,96 @@ void ecs_set_system_status_action(
     }
 }
 
+void ecs_set_system_budget(
+    ecs_world_t *world,
+    ecs_entity_t system,
+    int32_t entity_budget,
+    float time_budget)
+{
+    ecs_assert(entity_budget >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(time_budget >= 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(time_budget == 0 || ecs_os_has_time(), ECS_MISSING_OS_API, NULL);
+
+    EcsSystem *system_data = ecs_get_mut(world, system, EcsSystem, NULL);
+    ecs_assert(system_data != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    system_data->entity_budget = entity_budget;
+    system_data->time_budget = time_budget;
+    system_data->cursor = 0;
+}
+
+/* Invoke system for batches until its budget is exhausted */
+static
+bool run_batches(
+    EcsSystem *system_data,
+    ecs_iter_t *it,
+    const ecs_filter_t *filter,
+    ecs_time_t *time_start,
+    int32_t *processed)
+{
+    ecs_iter_action_t action = system_data->action;
+    int32_t entity_budget = system_data->entity_budget;
+    float time_budget = system_data->time_budget;
+
+    while (ecs_query_next_w_filter(it, filter)) {
+        bool exhausted = false;
+        if (entity_budget && (*processed + it->count) >= entity_budget) {
+            it->count = entity_budget - *processed;
+            exhausted = true;
+        }
+
+        action(it);
+        (*processed) += it->count;
+
+        if (time_budget > 0) {
+            ecs_time_t t = *time_start;
+            if (ecs_time_measure(&t) >= time_budget) {
+                exhausted = true;
+            }
+        }
+
+        if (exhausted) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Run system with a budget, and store where the next run should resume */
+static
+void run_budgeted(
+    EcsSystem *system_data,
+    ecs_iter_t *it,
+    const ecs_filter_t *filter)
+{
+    ecs_time_t time_start = {0};
+    if (system_data->time_budget > 0) {
+        ecs_os_get_time(&time_start);
+    }
+
+    int32_t offset = system_data->cursor, processed = 0;
+    bool exhausted = run_batches(
+        system_data, it, filter, &time_start, &processed);
+
+    /* If the previous run stopped at the last entity there is nothing left to
+     * do, so start over instead of running the system for no entities */
+    if (!processed && offset) {
+        offset = 0;
+        it->iter = ecs_query_iter(system_data->query).iter;
+        it->frame_offset = 0;
+        it->total_count = 0;
+        exhausted = run_batches(
+            system_data, it, filter, &time_start, &processed);
+    }
+
+    if (exhausted) {
+        system_data->cursor = offset + processed;
+    } else {
+        system_data->cursor = 0;
+    }
+}
+
 ecs_entity_t ecs_run_intern(
     ecs_world_t *world,
     ecs_stage_t *stage,
@@ -404,6 +494,8 @@ ecs_entity_t ecs_run_intern(
         ecs_os_get_time(&time_start);
     }
 
+    uint64_t span = ecs_span_begin(world);
+
 #ifndef NDEBUG
     stage->system = system;
     stage->system_columns = system_data->query->sig.columns;
@@ -415,6 +507,13 @@ ecs_entity_t ecs_run_intern(
         defer = true;
     }
 
+    /* Systems with a budget resume where the previous run stopped */
+    bool budgeted = !ran_by_app && world == stage->world && 
+        (system_data->entity_budget || system_data->time_budget > 0);
+    if (budgeted) {
+        offset = system_data->cursor;
+    }
+
     /* Prepare the query iterator */
     ecs_iter_t it = ecs_query_iter_page(system_data->query, offset, limit);
     it.world = stage->world;
@@ -431,10 +530,14 @@ ecs_entity_t ecs_run_intern(
         it.param = system_data->ctx;
     }
 
+    it.ctx = system_data->ctx;
+
     ecs_iter_action_t action = system_data->action;
 
     /* If no filter is provided, just iterate tables & invoke action */
-    if (ran_by_app || world == stage->world) {
+    if (budgeted) {
+        run_budgeted(system_data, &it, filter);
+    } else if (ran_by_app || world == stage->world) {
         while (ecs_query_next_w_filter(&it, filter)) {
             action(&it);
         }
@@ -456,6 +559,8 @@ ecs_entity_t ecs_run_intern(
         system_data->time_spent += (float)ecs_time_measure(&time_start);
     }
 
+    ecs_span_end(world, stage, EcsSpanSystem, system, span);
+
 #ifndef NDEBUG
     stage->system = 0;
     stage->system_columns = NULL;
@@ -532,6 +637,7 @@ void ecs_run_monitor(
     it.world = world;
     it.triggered_by = components;
     it.param = system_data->ctx;
+    it.ctx = system_data->ctx;
 
     if (entities) {
         it.entities = entities;
@@ -594,6 +700,14 @@ void ecs_colsystem_dtor(
         }           
 
         ecs_os_free(cur->on_demand);
+
+        /* Free the query of a deleted system, so that it is no longer invoked
+         * for the tables it matched. When the world is deleted, queries are
+         * freed after the tables. */
+        if (cur->query && !world->is_fini) {
+            ecs_col_system_free(cur);
+            cur->query = NULL;
+        }
     }
 }
 
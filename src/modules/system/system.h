@@ -17,6 +17,10 @@ typedef struct EcsSystem {
     int32_t invoke_count;                 /* Number of times system is invoked */
     float time_spent;                     /* Time spent on running system */
     float time_passed;                    /* Time passed since last invocation */
+
+    int32_t entity_budget;                /* Max entities per run (0 = no limit) */
+    float time_budget;                    /* Max seconds per run (0 = no limit) */
+    int32_t cursor;                       /* Offset where next run resumes */
 } EcsSystem;
 
 /* Invoked when system becomes active / inactive */
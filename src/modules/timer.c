@@ -8,6 +8,239 @@
 ecs_type_t ecs_type(EcsTimer);
 ecs_type_t ecs_type(EcsRateFilter);
 
+/* A hierarchical timing wheel has multiple levels of slots. Level 0 has one
+ * slot per step, and each next level has slots that span all slots of the level
+ * below it. When the slots of a level wrap around, the timers in the next slot
+ * of the level above are moved down. */
+#define ECS_TIMER_WHEEL_BITS (6)
+#define ECS_TIMER_WHEEL_SLOTS (1 << ECS_TIMER_WHEEL_BITS)
+#define ECS_TIMER_WHEEL_MASK (ECS_TIMER_WHEEL_SLOTS - 1)
+#define ECS_TIMER_WHEEL_LEVELS (4)
+#define ECS_TIMER_WHEEL_RANGE\
+    ((uint64_t)1 << (ECS_TIMER_WHEEL_BITS * ECS_TIMER_WHEEL_LEVELS))
+
+/* Timer in a slot of the wheel */
+typedef struct ecs_timer_entry_t {
+    ecs_entity_t timer;
+    uint64_t expire;        /* Step at which the timer fires */
+} ecs_timer_entry_t;
+
+/* Current schedule of a timer. Entries in the wheel that do not match the
+ * schedule are stale, and are ignored when their slot is processed. */
+typedef struct ecs_timer_schedule_t {
+    uint64_t expire;        /* Step at which the timer fires */
+    double start;           /* Time at which the timer was (re)started */
+} ecs_timer_schedule_t;
+
+struct ecs_timer_wheel_t {
+    ecs_vector_t *slots[ECS_TIMER_WHEEL_LEVELS][ECS_TIMER_WHEEL_SLOTS];
+    ecs_map_t *schedule;    /* Map with ecs_timer_schedule_t per timer */
+    ecs_vector_t *fired;    /* Timers that ticked in the last frame */
+    ecs_vector_t *scratch;  /* Cached vector for processing slots */
+    ecs_entity_t module;    /* Module entity, has tag when wheel is enabled */
+    ecs_entity_t tag;       /* Tag that activates the system of the wheel */
+    uint64_t step;          /* Current step */
+    double time;            /* Time processed by the wheel */
+    float resolution;       /* Duration of a step (0 if wheel is disabled) */
+};
+
+static
+uint64_t timer_wheel_steps(
+    ecs_timer_wheel_t *wheel,
+    float delay)
+{
+    uint64_t steps = (uint64_t)(delay / wheel->resolution);
+    if ((float)steps * wheel->resolution < delay) {
+        steps ++;
+    }
+
+    if (!steps) {
+        steps = 1;
+    }
+
+    return steps;
+}
+
+static
+void timer_wheel_insert(
+    ecs_timer_wheel_t *wheel,
+    ecs_entity_t timer,
+    uint64_t expire)
+{
+    uint64_t delta = expire - wheel->step;
+
+    /* Timers beyond the range of the wheel are stored in the last slot that
+     * can be reached, and are inserted again when that slot is moved down. */
+    if (delta >= ECS_TIMER_WHEEL_RANGE) {
+        delta = ECS_TIMER_WHEEL_RANGE - 1;
+    }
+
+    int32_t level = 0;
+    while (delta >> (ECS_TIMER_WHEEL_BITS * (level + 1))) {
+        level ++;
+    }
+
+    uint64_t at = wheel->step + delta;
+    int32_t slot = (int32_t)(
+        (at >> (ECS_TIMER_WHEEL_BITS * level)) & ECS_TIMER_WHEEL_MASK);
+
+    ecs_timer_entry_t *entry = ecs_vector_add(
+        &wheel->slots[level][slot], ecs_timer_entry_t);
+    entry->timer = timer;
+    entry->expire = expire;
+}
+
+static
+void timer_wheel_schedule(
+    ecs_timer_wheel_t *wheel,
+    ecs_entity_t timer,
+    float delay,
+    double start)
+{
+    ecs_timer_schedule_t schedule = {
+        .expire = wheel->step + timer_wheel_steps(wheel, delay),
+        .start = start
+    };
+
+    ecs_map_set(wheel->schedule, timer, &schedule);
+    timer_wheel_insert(wheel, timer, schedule.expire);
+}
+
+static
+void timer_wheel_fire(
+    ecs_world_t *world,
+    ecs_timer_wheel_t *wheel,
+    ecs_timer_entry_t *entry)
+{
+    ecs_entity_t e = entry->timer;
+    ecs_timer_schedule_t *schedule = ecs_map_get(
+        wheel->schedule, ecs_timer_schedule_t, e);
+    if (!schedule || schedule->expire != entry->expire) {
+        return;
+    }
+
+    /* Write to the storage directly, so that firing a timer does not trigger
+     * OnSet systems, which would schedule the timer again. */
+    EcsTimer *timer = (EcsTimer*)ecs_get(world, e, EcsTimer);
+    if (!timer || !timer->active) {
+        ecs_map_remove(wheel->schedule, e);
+        return;
+    }
+
+    float time_elapsed = (float)(wheel->time - schedule->start);
+
+    EcsTickSource *tick_source = (EcsTickSource*)ecs_get(
+        world, e, EcsTickSource);
+    if (tick_source) {
+        tick_source->tick = true;
+        tick_source->time_elapsed = time_elapsed;
+
+        ecs_entity_t *elem = ecs_vector_add(&wheel->fired, ecs_entity_t);
+        *elem = e;
+    }
+
+    timer->time = 0;
+
+    if (timer->single_shot) {
+        timer->active = false;
+        ecs_map_remove(wheel->schedule, e);
+    } else {
+        /* Reschedule from the step the timer expired, so it doesn't drift */
+        schedule->expire = entry->expire + 
+            timer_wheel_steps(wheel, timer->timeout);
+        schedule->start = wheel->time;
+        timer_wheel_insert(wheel, e, schedule->expire);
+    }
+}
+
+/* Take entries from slot, so timers can be inserted while processing */
+static
+ecs_vector_t* timer_wheel_take_slot(
+    ecs_timer_wheel_t *wheel,
+    int32_t level,
+    int32_t slot)
+{
+    ecs_vector_t *entries = wheel->slots[level][slot];
+    wheel->slots[level][slot] = wheel->scratch;
+    wheel->scratch = NULL;
+    return entries;
+}
+
+static
+void timer_wheel_release_slot(
+    ecs_timer_wheel_t *wheel,
+    ecs_vector_t *entries)
+{
+    ecs_vector_clear(entries);
+    if (!wheel->scratch) {
+        wheel->scratch = entries;
+    } else {
+        ecs_vector_free(entries);
+    }
+}
+
+static
+void timer_wheel_step(
+    ecs_world_t *world,
+    ecs_timer_wheel_t *wheel)
+{
+    uint64_t step = ++ wheel->step;
+
+    /* Move timers of higher levels down when the level below wraps around */
+    int32_t level;
+    for (level = 1; level < ECS_TIMER_WHEEL_LEVELS; level ++) {
+        if (step & (((uint64_t)1 << (ECS_TIMER_WHEEL_BITS * level)) - 1)) {
+            break;
+        }
+
+        int32_t slot = (int32_t)(
+            (step >> (ECS_TIMER_WHEEL_BITS * level)) & ECS_TIMER_WHEEL_MASK);
+        ecs_vector_t *entries = timer_wheel_take_slot(wheel, level, slot);
+
+        ecs_vector_each(entries, ecs_timer_entry_t, entry, {
+            timer_wheel_insert(wheel, entry->timer, entry->expire);
+        });
+
+        timer_wheel_release_slot(wheel, entries);
+    }
+
+    int32_t slot = (int32_t)(step & ECS_TIMER_WHEEL_MASK);
+    ecs_vector_t *entries = timer_wheel_take_slot(wheel, 0, slot);
+
+    ecs_vector_each(entries, ecs_timer_entry_t, entry, {
+        if (entry->expire == step) {
+            timer_wheel_fire(world, wheel, entry);
+        } else {
+            /* Timer was clamped to the range of the wheel */
+            timer_wheel_insert(wheel, entry->timer, entry->expire);
+        }
+    });
+
+    timer_wheel_release_slot(wheel, entries);
+}
+
+static
+void timer_wheel_free(
+    ecs_world_t *world,
+    void *ctx)
+{
+    ecs_timer_wheel_t *wheel = ctx;
+
+    int32_t level, slot;
+    for (level = 0; level < ECS_TIMER_WHEEL_LEVELS; level ++) {
+        for (slot = 0; slot < ECS_TIMER_WHEEL_SLOTS; slot ++) {
+            ecs_vector_free(wheel->slots[level][slot]);
+        }
+    }
+
+    ecs_map_free(wheel->schedule);
+    ecs_vector_free(wheel->fired);
+    ecs_vector_free(wheel->scratch);
+    ecs_os_free(wheel);
+
+    world->timer_wheel = NULL;
+}
+
 static
 void AddTickSource(ecs_iter_t *it) {
     int32_t i;
@@ -23,6 +256,13 @@ void ProgressTimers(ecs_iter_t *it) {
 
     ecs_assert(timer != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    /* The system is not disabled when the timing wheel is enabled, so that the
+     * pipeline keeps the merge that makes new tick sources visible. */
+    ecs_timer_wheel_t *wheel = it->world->timer_wheel;
+    if (wheel && wheel->resolution) {
+        return;
+    }
+
     int i;
     for (i = 0; i < it->count; i ++) {
         tick_source[i].tick = false;
@@ -53,6 +293,54 @@ void ProgressTimers(ecs_iter_t *it) {
     }
 }
 
+static
+void ProgressTimerWheel(ecs_iter_t *it) {
+    ecs_world_t *world = it->world;
+    ecs_timer_wheel_t *wheel = world->timer_wheel;
+    if (!wheel || !wheel->resolution) {
+        return;
+    }
+
+    /* Reset tick sources of timers that fired in the last frame */
+    ecs_vector_each(wheel->fired, ecs_entity_t, e, {
+        EcsTickSource *tick_source = (EcsTickSource*)ecs_get(
+            world, *e, EcsTickSource);
+        if (tick_source) {
+            tick_source->tick = false;
+        }
+    });
+
+    ecs_vector_clear(wheel->fired);
+
+    wheel->time += (double)world->stats.delta_time_raw;
+
+    uint64_t target = (uint64_t)(wheel->time / (double)wheel->resolution);
+    while (wheel->step < target) {
+        timer_wheel_step(world, wheel);
+    }
+}
+
+static
+void ScheduleTimers(ecs_iter_t *it) {
+    ecs_timer_wheel_t *wheel = it->world->timer_wheel;
+    if (!wheel || !wheel->resolution) {
+        return;
+    }
+
+    EcsTimer *timer = ecs_column(it, EcsTimer, 1);
+
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_entity_t e = it->entities[i];
+        if (timer[i].active) {
+            timer_wheel_schedule(wheel, e, timer[i].timeout - timer[i].time,
+                wheel->time - (double)timer[i].time);
+        } else {
+            ecs_map_remove(wheel->schedule, e);
+        }
+    }
+}
+
 static
 void ProgressRateFilters(ecs_iter_t *it) {
     EcsRateFilter *filter = ecs_column(it, EcsRateFilter, 1);
@@ -66,7 +354,15 @@ void ProgressRateFilters(ecs_iter_t *it) {
         filter[i].time_elapsed += it->delta_time;
 
         if (src) {
-            const EcsTickSource *tick_src = ecs_get(it->world, src, EcsTickSource);
+            /* Cache the location of the source, so that resolving a chain
+             * of rate filters does not require an entity index lookup */
+            ecs_ref_t *ref = &filter[i].src_ref;
+            if (ref->entity != src) {
+                *ref = (ecs_ref_t){ 0 };
+            }
+
+            const EcsTickSource *tick_src = ecs_get_ref(
+                it->world, ref, src, EcsTickSource);
             if (tick_src) {
                 inc = tick_src->tick;
             }
@@ -172,6 +468,8 @@ void ecs_start_timer(
 
     ptr->active = true;
     ptr->time = 0;
+
+    ecs_modified(world, timer, EcsTimer);
 }
 
 void ecs_stop_timer(
@@ -182,6 +480,54 @@ void ecs_stop_timer(
     ecs_assert(ptr != NULL, ECS_INVALID_PARAMETER, NULL);
 
     ptr->active = false;
+
+    ecs_modified(world, timer, EcsTimer);
+}
+
+void ecs_enable_timer_wheel(
+    ecs_world_t *world,
+    float resolution)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(resolution > 0, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_timer_wheel_t *wheel = world->timer_wheel;
+    ecs_assert(wheel != NULL, ECS_INVALID_OPERATION, NULL);
+    ecs_assert(!wheel->resolution, ECS_INVALID_OPERATION, NULL);
+
+    wheel->resolution = resolution;
+    ecs_add_entity(world, wheel->module, wheel->tag);
+
+    /* Schedule existing timers, and reset ticks from the last frame */
+    ecs_iter_t it = ecs_filter_iter(world, &(ecs_filter_t){
+        .include = ecs_type_from_entity(world, ecs_typeid(EcsTimer))
+    });
+
+    while (ecs_filter_next(&it)) {
+        ecs_type_t type = ecs_iter_type(&it);
+        EcsTimer *timer = ecs_table_column(&it, 
+            ecs_type_index_of(type, ecs_typeid(EcsTimer)));
+        int32_t tick_column = ecs_type_index_of(
+            type, ecs_typeid(EcsTickSource));
+        EcsTickSource *tick_source = NULL;
+        if (tick_column != -1) {
+            tick_source = ecs_table_column(&it, tick_column);
+        }
+
+        int32_t i;
+        for (i = 0; i < it.count; i ++) {
+            if (tick_source) {
+                tick_source[i].tick = false;
+            }
+
+            if (timer[i].active) {
+                timer_wheel_schedule(wheel, it.entities[i], 
+                    timer[i].timeout - timer[i].time, 
+                    wheel->time - (double)timer[i].time);
+            }
+        }
+    }
 }
 
 ecs_entity_t ecs_set_rate_filter(
@@ -238,6 +584,20 @@ void FlecsTimerImport(
     /* Timer handling */
     ECS_SYSTEM(world, ProgressTimers, EcsPreFrame, Timer, flecs.system.TickSource);
 
+    /* Timing wheel handling. The system that advances the wheel matches the
+     * module entity, which only has the TimerWheel tag when the wheel is
+     * enabled. This keeps the system inactive until then. */
+    ECS_TAG(world, TimerWheel);
+    ECS_SYSTEM(world, ProgressTimerWheel, EcsPreFrame, [in] TimerWheel);
+    ECS_SYSTEM(world, ScheduleTimers, EcsOnSet, Timer);
+
+    ecs_timer_wheel_t *wheel = ecs_os_calloc(ECS_SIZEOF(ecs_timer_wheel_t));
+    wheel->schedule = ecs_map_new(ecs_timer_schedule_t, 0);
+    wheel->module = ecs_typeid(FlecsTimer);
+    wheel->tag = TimerWheel;
+    world->timer_wheel = wheel;
+    ecs_atfini(world, timer_wheel_free, wheel);
+
     /* Rate filter handling */
     ECS_SYSTEM(world, ProgressRateFilters, EcsPreFrame, [in] RateFilter, [out] flecs.system.TickSource);
 }
@@ -12,6 +12,15 @@ int64_t ecs_os_api_realloc_count = 0;
 int64_t ecs_os_api_calloc_count = 0;
 int64_t ecs_os_api_free_count = 0;
 
+ecs_alloc_tag_stats_t ecs_os_api_alloc_tags[EcsAllocTagCount];
+
+/* Worker threads record allocations in the counters of their stage, which are
+ * folded into the global counters when the stage is merged. Without support
+ * for thread local storage all threads write to the global counters. */
+#ifdef ECS_THREAD_LOCAL
+static ECS_THREAD_LOCAL ecs_alloc_tag_stats_t *ecs_os_thread_alloc_tags;
+#endif
+
 void ecs_os_set_api(
     ecs_os_api_t *os_api)
 {
@@ -42,6 +51,60 @@ void ecs_os_fini(void) {
     }
 }
 
+void ecs_os_track_alloc(
+    ecs_alloc_tag_t tag,
+    ecs_size_t old_size,
+    ecs_size_t new_size)
+{
+    ecs_assert(tag < EcsAllocTagCount, ECS_INVALID_PARAMETER, NULL);
+
+    if (old_size == new_size) {
+        return;
+    }
+
+    ecs_alloc_tag_stats_t *stats = &ecs_os_api_alloc_tags[tag];
+#ifdef ECS_THREAD_LOCAL
+    if (ecs_os_thread_alloc_tags) {
+        stats = &ecs_os_thread_alloc_tags[tag];
+    }
+#endif
+
+    if (!old_size) {
+        stats->alloc_count ++;
+    } else if (!new_size) {
+        stats->free_count ++;
+    } else {
+        stats->realloc_count ++;
+    }
+
+    stats->bytes += new_size - old_size;
+}
+
+void ecs_os_set_thread_alloc_tags(
+    ecs_alloc_tag_stats_t *tags)
+{
+#ifdef ECS_THREAD_LOCAL
+    ecs_os_thread_alloc_tags = tags;
+#else
+    (void)tags;
+#endif
+}
+
+void ecs_os_merge_alloc_tags(
+    ecs_alloc_tag_stats_t *tags)
+{
+    int32_t i;
+    for (i = 0; i < EcsAllocTagCount; i ++) {
+        ecs_alloc_tag_stats_t *dst = &ecs_os_api_alloc_tags[i];
+        dst->alloc_count += tags[i].alloc_count;
+        dst->realloc_count += tags[i].realloc_count;
+        dst->free_count += tags[i].free_count;
+        dst->bytes += tags[i].bytes;
+    }
+
+    ecs_os_memset(tags, 0, ECS_SIZEOF(ecs_alloc_tag_stats_t) * EcsAllocTagCount);
+}
+
 static
 void ecs_log(const char *fmt, va_list args) {
     vfprintf(stdout, fmt, args);
@@ -3,6 +3,13 @@
 
 #include "private_types.h"
 
+/* Storage class for thread local variables, if supported by the compiler */
+#if defined(_MSC_VER)
+#define ECS_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define ECS_THREAD_LOCAL __thread
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 //// Core bootstrap functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -29,6 +36,15 @@ ecs_type_t ecs_bootstrap_type(
     ecs_set(world, name, EcsName, {.value = &#name[ecs_os_strlen("Ecs")], .symbol = #name});\
     ecs_add_entity(world, name, ECS_CHILDOF | ecs_get_scope(world))
 
+/* Attribute (de)allocation of entity name to allocation tracking */
+#define ecs_track_name_alloc(name)\
+    ecs_os_track_alloc(EcsAllocName, 0, ecs_os_strlen(name) + 1)
+
+#define ecs_track_name_free(name)\
+    do { if (name) {\
+        ecs_os_track_alloc(EcsAllocName, ecs_os_strlen(name) + 1, 0);\
+    } } while (0)
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //// Entity API
@@ -62,6 +78,43 @@ void ecs_run_monitors(
     ecs_vector_t *v_src_monitors);
 
 
+////////////////////////////////////////////////////////////////////////////////
+//// Hierarchy API
+////////////////////////////////////////////////////////////////////////////////
+
+/* Add child to the EcsChildOf index of a parent */
+void ecs_childof_register(
+    ecs_world_t *world,
+    ecs_entity_t parent,
+    ecs_entity_t child);
+
+/* Remove entity in table row from the EcsChildOf index of its parent */
+void ecs_childof_unregister(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    int32_t row);
+
+/* Get children in the EcsChildOf index of a parent. The returned vector must
+ * be freed by the caller. */
+ecs_vector_t* ecs_childof_get_children(
+    ecs_world_t *world,
+    ecs_entity_t parent);
+
+/* Delete children that are stored in the EcsChildOf index of a parent */
+void ecs_childof_delete_children(
+    ecs_world_t *world,
+    ecs_entity_t parent);
+
+/* Rebuild the EcsChildOf index from the table data */
+void ecs_childof_index_rebuild(
+    ecs_world_t *world);
+
+/* Free the EcsChildOf index */
+void ecs_childof_index_free(
+    ecs_world_t *world);
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //// World API
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,6 +128,9 @@ void ecs_notify_queries_of_table(
 ecs_stage_t *ecs_get_stage(
     ecs_world_t **world_ptr);
 
+/* Test if the current thread is reading the world with ecs_read_begin */
+bool ecs_is_reader_thread(void);
+
 /* Get component callbacks */
 ecs_c_info_t *ecs_get_c_info(
     ecs_world_t *world,
@@ -85,6 +141,11 @@ ecs_c_info_t * ecs_get_or_create_c_info(
     ecs_world_t *world,
     ecs_entity_t component);
 
+/* Get component callbacks if component has sparse storage */
+ecs_c_info_t * ecs_get_sparse_c_info(
+    ecs_world_t *world,
+    ecs_entity_t component);
+
 void ecs_eval_component_monitors(
     ecs_world_t *world);
 
@@ -97,6 +158,10 @@ void ecs_component_monitor_register(
     ecs_entity_t component,
     ecs_query_t *query);
 
+void ecs_component_monitor_unregister(
+    ecs_component_monitor_t *mon,
+    ecs_query_t *query);
+
 bool ecs_defer_op_begin(
     ecs_world_t *world,
     ecs_stage_t *stage,
@@ -118,6 +183,16 @@ void ecs_measure_system_time(
     ecs_world_t *world,
     bool enable);
 
+/* Maintain component statistics while tables change */
+void ecs_track_component_stats(
+    ecs_world_t *world,
+    bool enable);
+
+/* Get statistics of component, or NULL if not tracked */
+const ecs_component_stats_t* ecs_get_component_stats(
+    ecs_world_t *world,
+    ecs_entity_t component);
+
 void ecs_notify_tables(
     ecs_world_t *world,
     ecs_table_event_t *event);
@@ -160,6 +235,19 @@ void ecs_stage_defer_end(
     ecs_world_t *world,
     ecs_stage_t *stage);    
 
+/* Add new operation to the defer queue of the stage */
+ecs_op_t* ecs_stage_new_defer_op(
+    ecs_stage_t *stage);
+
+/* Record allocations of the current thread in the specified counters. When
+ * NULL, allocations are recorded in the global counters. */
+void ecs_os_set_thread_alloc_tags(
+    ecs_alloc_tag_stats_t *tags);
+
+/* Add counters to the global counters and reset them */
+void ecs_os_merge_alloc_tags(
+    ecs_alloc_tag_stats_t *tags);
+
 /* Delete table from stage */
 void ecs_delete_table(
     ecs_world_t *world,
@@ -179,6 +267,13 @@ bool ecs_defer_modified(
     ecs_entity_t entity,
     ecs_entity_t component);
 
+bool ecs_defer_enable(
+    ecs_world_t *world,
+    ecs_stage_t *stage,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    bool enable);
+
 bool ecs_defer_new(
     ecs_world_t *world,
     ecs_stage_t *stage,
@@ -330,6 +425,16 @@ ecs_data_t *ecs_table_get_data(
 ecs_data_t *ecs_table_get_or_create_data(
     ecs_table_t *table);
 
+/* Get index of first field column of component column, or -1 if the column
+ * is not stored as a structure of arrays */
+int32_t ecs_table_soa_column_index(
+    ecs_table_t *table,
+    int32_t column);
+
+/* Copy current values of double buffered columns to previous frame buffers */
+void ecs_table_update_prev(
+    ecs_table_t *table);
+
 /* Initialize columns for data */
 ecs_data_t* ecs_init_data(
     ecs_world_t *world,
@@ -449,6 +554,28 @@ void ecs_table_free(
     ecs_world_t *world,
     ecs_table_t *table); 
 
+/* Report change in column memory of table to allocation tracking */
+void ecs_table_track_alloc(
+    ecs_table_t *table);
+
+/* Account table columns in component statistics, if they are tracked */
+void ecs_table_register_stats(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove table columns from component statistics */
+void ecs_table_unregister_stats(
+    ecs_table_t *table);
+
+/* Apply changes in column count and size to component statistics */
+void ecs_table_sync_stats(
+    ecs_table_t *table);
+
+/* Get number of bytes allocated for table data */
+ecs_size_t ecs_table_data_alloc_bytes(
+    ecs_table_t *table,
+    ecs_data_t *data);
+
 /* Merge table data */
 void ecs_table_merge_data(
     ecs_world_t *world,
@@ -476,6 +603,13 @@ void ecs_table_swap(
     int32_t row_1,
     int32_t row_2);
 
+/* Reorder rows so that row i contains the data of row perm[i] */
+void ecs_table_permute(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_data_t *data,
+    const int32_t *perm);
+
 ecs_table_t *ecs_table_traverse_add(
     ecs_world_t *world,
     ecs_table_t *table,
@@ -513,6 +647,41 @@ void ecs_table_notify(
 void ecs_table_clear_edges(
     ecs_table_t *table);
 
+/* Remove table from child tables of its parents */
+void ecs_table_unregister_child(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove table from the index used to find tables by type */
+void ecs_table_index_remove(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove table from instance tables of its base entities */
+void ecs_table_unregister_instance(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove instance table administration of a base entity */
+void ecs_instance_tables_delete(
+    ecs_world_t *world,
+    ecs_entity_t base);
+
+/* Invalidate cached inherited components of tables that inherit from base */
+void ecs_invalidate_base_cache(
+    ecs_world_t *world,
+    ecs_entity_t base);
+
+/* Invalidate cached inherited components of tables that inherit from entities
+ * in the specified table */
+void ecs_table_invalidate_base_cache(
+    ecs_world_t *world,
+    ecs_table_t *table);
+
+/* Remove edges to tables that are flagged as garbage */
+void ecs_table_clear_garbage_edges(
+    ecs_world_t *world);
+
 ////////////////////////////////////////////////////////////////////////////////
 //// Query API
 ////////////////////////////////////////////////////////////////////////////////
@@ -553,6 +722,11 @@ void ecs_query_notify(
     ecs_query_t *query,
     ecs_query_event_t *event);
 
+/* Sort tables of queries that were not sorted while other threads could read
+ * the world. Must be called before a read epoch begins. */
+void ecs_query_sort_postponed(
+    ecs_world_t *world);
+
 ////////////////////////////////////////////////////////////////////////////////
 //// Signature API
 ////////////////////////////////////////////////////////////////////////////////
@@ -580,6 +754,56 @@ FLECS_EXPORT
 void ecs_increase_timer_resolution(
     bool enable);
 
+////////////////////////////////////////////////////////////////////////////////
+//// Profiler API
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef FLECS_PROFILER
+
+/* Get start timestamp for a span. Returns 0 if the profiler is disabled. */
+uint64_t ecs_profiler_now(
+    ecs_world_t *world);
+
+/* Record span in ring buffer of the thread that owns the stage */
+void ecs_profiler_record(
+    ecs_world_t *world,
+    ecs_stage_t *stage,
+    ecs_span_kind_t kind,
+    ecs_entity_t id,
+    uint64_t start);
+
+/* Make sure there is a ring buffer for each worker thread */
+void ecs_profiler_set_threads(
+    ecs_world_t *world,
+    int32_t threads);
+
+#define ecs_span_begin(world)\
+    ((world)->profiler ? ecs_profiler_now(world) : 0)
+
+#define ecs_span_end(world, stage, kind, id, start)\
+    do {\
+        if (start) { ecs_profiler_record(world, stage, kind, id, start); }\
+    } while (0)
+
+#else
+
+#define ecs_span_begin(world) 0
+#define ecs_span_end(world, stage, kind, id, start) (void)(start)
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//// Command queue API
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef FLECS_COMMAND_QUEUE
+
+/* Apply commands of all command queues to the world */
+void ecs_command_queues_flush(
+    ecs_world_t *world);
+
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 //// Utilities
 ////////////////////////////////////////////////////////////////////////////////
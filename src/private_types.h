@@ -65,6 +65,10 @@ typedef struct ecs_c_info_t {
     ecs_vector_t *on_add;       /* Systems ran after adding this component */
     ecs_vector_t *on_remove;    /* Systems ran after removing this component */
     EcsComponentLifecycle lifecycle; /* Component lifecycle callbacks */
+    ecs_sparse_t *sparse;       /* Storage for sparse components */
+    ecs_size_t size;            /* Size of sparse component */
+    ecs_vector_t *fields;       /* Fields of structure of arrays component */
+    bool double_buffered;       /* Keep copy of values from previous frame */
     bool lifecycle_set;
 } ecs_c_info_t;
 
@@ -72,6 +76,7 @@ typedef struct ecs_c_info_t {
 typedef enum ecs_table_eventkind_t {
     EcsTableQueryMatch,
     EcsTableQueryUnmatch,
+    EcsTableQueryFree,
     EcsTableComponentInfo
 } ecs_table_eventkind_t;
 
@@ -103,12 +108,20 @@ typedef struct ecs_sw_column_t {
     ecs_type_t type;      /**< Switch type */
 } ecs_sw_column_t;
 
+/** A bitset column. */
+typedef struct ecs_bs_column_t {
+    ecs_bitset_t data;    /**< Column data */
+} ecs_bs_column_t;
+
 /** Stage-specific component data */
 struct ecs_data_t {
     ecs_vector_t *entities;      /**< Entity identifiers */
     ecs_vector_t *record_ptrs;   /**< Ptrs to records in main entity index */
     ecs_column_t *columns;       /**< Component columns */
     ecs_sw_column_t *sw_columns; /**< Switch columns */
+    ecs_bs_column_t *bs_columns; /**< Bitset columns */
+    ecs_column_t *soa_columns;   /**< Field columns */
+    ecs_column_t *prev_columns;  /**< Component values of previous frame */
     bool marked_dirty;           /**< Was table marked dirty by stage? */  
 };
 
@@ -137,10 +150,15 @@ typedef struct ecs_table_leaf_t {
 #define EcsTableHasUnSet            16384u
 #define EcsTableHasMonitors         32768u
 #define EcsTableHasSwitch           65536u
+#define EcsTableIsGarbage           131072u /**< Table is being collected */
+#define EcsTableHasChildOf          262144u /**< Does the table have EcsChildOf */
+#define EcsTableHasDisabled         524288u /**< Does the table type has DISABLED */
+#define EcsTableHasSoa              1048576u /**< Does the table have field columns */
+#define EcsTableHasPrev             2097152u /**< Does the table have double buffered columns */
 
 /* Composite constants */
 #define EcsTableHasLifecycle        (EcsTableHasCtors | EcsTableHasDtors)
-#define EcsTableIsComplex           (EcsTableHasLifecycle | EcsTableHasSwitch)
+#define EcsTableIsComplex           (EcsTableHasLifecycle | EcsTableHasSwitch | EcsTableHasDisabled | EcsTableHasSoa | EcsTableHasPrev)
 #define EcsTableHasAddActions       (EcsTableHasBase | EcsTableHasSwitch | EcsTableHasCtors | EcsTableHasOnAdd | EcsTableHasOnSet | EcsTableHasMonitors)
 #define EcsTableHasRemoveActions    (EcsTableHasBase | EcsTableHasDtors | EcsTableHasOnRemove | EcsTableHasUnSet | EcsTableHasMonitors)
 
@@ -161,6 +179,22 @@ typedef struct ecs_matched_query_t {
     int32_t matched_table_index;    /**< Table index in the query type */
 } ecs_matched_query_t;
 
+/** Statistics of a component, maintained incrementally by tables. */
+typedef struct ecs_component_stats_t {
+    int32_t tables_count;           /**< Tables that have the component */
+    int32_t entities_count;         /**< Elements in component columns */
+    int32_t used_bytes;             /**< Bytes used by column elements */
+    int32_t allocd_bytes;           /**< Bytes allocated for columns */
+} ecs_component_stats_t;
+
+/** Column values that are accounted for in the component statistics. */
+typedef struct ecs_column_stats_t {
+    ecs_component_stats_t *stats;   /**< Statistics of column component */
+    int32_t count;                  /**< Accounted number of elements */
+    int32_t used_bytes;             /**< Accounted bytes used by elements */
+    int32_t allocd_bytes;           /**< Accounted bytes allocated */
+} ecs_column_stats_t;
+
 /** A table is the Flecs equivalent of an archetype. Tables store all entities
  * with a specific set of components. Tables are automatically created when an
  * entity has a set of components not previously observed before. When a new
@@ -171,6 +205,7 @@ struct ecs_table_t {
 
     ecs_edge_t *lo_edges;            /**< Edges to low entity ids */
     ecs_map_t *hi_edges;             /**< Edges to high entity ids */
+    ecs_table_t *hash_next;          /**< Next table with same type hash */
 
     ecs_data_t *data;                /**< Data storage */
 
@@ -182,13 +217,21 @@ struct ecs_table_t {
     ecs_vector_t *un_set_all;        /**< All OnSet systems */
 
     int32_t *dirty_state;            /**< Keep track of changes in columns */
+    ecs_column_stats_t *column_stats; /**< Column statistics (if tracked) */
     int32_t alloc_count;             /**< Increases when columns are reallocd */
+    int32_t alloc_bytes;             /**< Column memory reported to OS API */
+    int32_t gc_frame;                /**< Frame (+1) since table is empty */
+    ecs_map_t *base_cache;           /**< Refs to components of base entities */
+    uint64_t base_cache_version;     /**< World version base cache is valid for */
     uint32_t id;                     /**< Table id in sparse set */
 
     ecs_flags32_t flags;             /**< Flags for testing table properties */
     int32_t column_count;            /**< Number of data columns in table */
     int32_t sw_column_count;
     int32_t sw_column_offset;
+    int32_t bs_column_count;
+    int32_t bs_column_offset;
+    int32_t soa_column_count;
 };
 
 /* Sparse query column */
@@ -198,12 +241,28 @@ typedef struct ecs_sparse_column_t {
     int32_t signature_column_index;
 } ecs_sparse_column_t;
 
+/* Bitset query column */
+typedef struct ecs_bitset_column_t {
+    int32_t bs_column_index;       /**< Index in bitset columns of table */
+    int32_t signature_column_index;
+} ecs_bitset_column_t;
+
+/* Lookup query column for component with sparse storage */
+typedef struct ecs_lookup_column_t {
+    ecs_sparse_t *sparse;          /**< Storage of the component */
+    int32_t signature_column_index;
+    bool is_not;                   /**< Entity must not have component */
+} ecs_lookup_column_t;
+
 /** Type containing data for a table matched with a query. */
 typedef struct ecs_matched_table_t {
     ecs_iter_table_t data;         /**< Precomputed data for iterators */
     ecs_vector_t *sparse_columns;  /**< Column ids of sparse columns */
+    ecs_vector_t *bitset_columns;  /**< Column ids with disabled bitsets */
+    ecs_vector_t *lookup_columns;  /**< Columns with sparse components */
     int32_t *monitor;              /**< Used to monitor table for changes */
     int32_t rank;                  /**< Rank used to sort tables */
+    bool sort_pending;             /**< Must table be sorted next read epoch */
 } ecs_matched_table_t;
 
 /** Type storing an entity range within a table.
@@ -229,6 +288,9 @@ typedef struct ecs_table_slice_t {
 #define EcsQueryIsOrphaned (512)     /* Is subquery orphaned */
 #define EcsQueryHasOutColumns (1024) /* Does query have out columns */
 #define EcsQueryHasOptional (2048)   /* Does query have optional columns */
+#define EcsQueryHasFromEntity (4096) /* Does query have FromEntity columns */
+#define EcsQueryHasPrev (8192)       /* Does query have [prev] columns */
+#define EcsQuerySortPending (16384u) /* Was sorting postponed for read epoch */
 
 #define EcsQueryNoActivation (EcsQueryMonitor | EcsQueryOnSet | EcsQueryUnSet)
 
@@ -246,8 +308,24 @@ typedef struct ecs_query_event_t {
     ecs_query_eventkind_t kind;
     ecs_table_t *table;
     ecs_query_t *parent_query;
+    ecs_vector_t *tables;       /* Tables affected by a rematch, if known */
+    ecs_vector_t *entities;     /* Watched entities that changed, if known */
 } ecs_query_event_t;
 
+/** Slot of a table in the matched tables of a query */
+typedef struct ecs_query_table_slot_t {
+    int32_t index;              /* Index in tables or empty_tables */
+    bool active;                /* Is table stored in tables (non-empty) */
+} ecs_query_table_slot_t;
+
+/** Range of active tables and table slices of a query with the same rank */
+typedef struct ecs_query_group_t {
+    int32_t first;              /* Index of first table in tables */
+    int32_t count;              /* Number of tables in group */
+    int32_t slice_first;        /* Index of first slice in table_slices */
+    int32_t slice_count;        /* Number of slices in group */
+} ecs_query_group_t;
+
 /** Query that is automatically matched against active tables */
 struct ecs_query_t {
     /* Signature of query */
@@ -260,18 +338,27 @@ struct ecs_query_t {
     ecs_vector_t *tables;
     ecs_vector_t *empty_tables;
 
+    /* Slots of matched tables by table id. Not used by queries with traits, as
+     * these can match the same table more than once. */
+    ecs_map_t *table_slots;
+
     /* Handle to system (optional) */
     ecs_entity_t system;   
 
     /* Used for sorting */
     ecs_entity_t sort_on_component;
     ecs_compare_action_t compare;   
+    ecs_sort_key_kind_t sort_key_kind; /* Sort on key instead of compare */
+    ecs_size_t sort_key_offset;
     ecs_vector_t *table_slices;     
 
     /* Used for table sorting */
     ecs_entity_t rank_on_component;
     ecs_rank_type_action_t group_table;
 
+    /* Ranges of active tables by rank, used to iterate a single group */
+    ecs_map_t *groups;
+
     /* Subqueries */
     ecs_query_t *parent;
     ecs_vector_t *subqueries;
@@ -282,6 +369,7 @@ struct ecs_query_t {
     int32_t cascade_by;         /* Identify CASCADE column */
     int32_t match_count;        /* How often have tables been (un)matched */
     int32_t prev_match_count;   /* Used to track if sorting is needed */
+    ecs_size_t alloc_bytes;     /* Memory reported to OS API */
 };
 
 /** Keep track of how many [in] columns are active for [out] columns of OnDemand
@@ -307,6 +395,8 @@ typedef enum ecs_op_kind_t {
     EcsOpSet,
     EcsOpMut,
     EcsOpModified,
+    EcsOpEnable,
+    EcsOpDisable,
     EcsOpDelete,
     EcsOpClear
 } ecs_op_kind_t;
@@ -358,6 +448,10 @@ struct ecs_stage_t {
     ecs_vector_t *defer_queue;
     ecs_vector_t *defer_merge_queue;
 
+    /* Allocations made by the thread of the stage, merged with the global
+     * counters when the stage is merged */
+    ecs_alloc_tag_stats_t alloc_tags[EcsAllocTagCount];
+
     /* One-shot actions to be executed after the merge */
     ecs_vector_t *post_frame_actions;
 
@@ -382,6 +476,9 @@ typedef struct ecs_store_t {
     /* Table graph */
     ecs_sparse_t *tables;
     ecs_table_t root;
+
+    /* Lookup table for finding tables by type hash */
+    ecs_map_t *table_index;
 } ecs_store_t;
 
 /** Supporting type to store looked up or derived entity data */
@@ -428,6 +525,12 @@ typedef struct ecs_action_elem_t {
     void *ctx;
 } ecs_action_elem_t;
 
+/* Span recorder, implemented by profiler addon */
+typedef struct ecs_profiler_t ecs_profiler_t;
+
+/* Timing wheel, implemented by timer module */
+typedef struct ecs_timer_wheel_t ecs_timer_wheel_t;
+
 /* Alias */
 typedef struct ecs_alias_t {
     char *name;
@@ -443,6 +546,8 @@ struct ecs_world_t {
 
     ecs_c_info_t c_info[ECS_HI_COMPONENT_ID]; /* Component callbacks & triggers */
     ecs_map_t *t_info;                        /* Tag triggers */
+    ecs_vector_t *sparse_components;          /* Components in sparse sets */
+    int32_t double_buffered_count;            /* Double buffered components */
 
     /* Is entity range checking enabled? */
     bool range_check_enabled;
@@ -483,6 +588,7 @@ struct ecs_world_t {
     ecs_map_t *on_activate_components; /* Trigger on activate of [in] column */
     ecs_map_t *on_enable_components;   /* Trigger on enable of [in] column */
     ecs_vector_t *fini_tasks;          /* Tasks to execute on ecs_fini */
+    ecs_timer_wheel_t *timer_wheel;    /* Timing wheel (NULL if no timers) */
 
 
     /* -- Lookup Indices -- */
@@ -506,6 +612,11 @@ struct ecs_world_t {
     /* -- Hierarchy administration -- */
 
     ecs_map_t *child_tables;        /* Child tables per parent entity */
+    ecs_map_t *childof_index;       /* EcsChildOf children per parent entity */
+    ecs_map_t *instance_tables;     /* Instance tables per base entity */
+    ecs_vector_t *watched_changed;  /* Watched entities that changed type */
+    uint64_t base_cache_version;    /* Increases when all base caches are invalid */
+    int32_t table_gc_frames;        /* Frames before empty table is deleted */
     const char *name_prefix;        /* Remove prefix from C names in modules */
 
 
@@ -518,6 +629,7 @@ struct ecs_world_t {
     ecs_os_mutex_t sync_mutex;       /* Mutex for job_cond */
     int32_t workers_running;         /* Number of threads running */
     int32_t workers_waiting;         /* Number of workers waiting on sync */
+    struct ecs_par_job_t *par_job;   /* Parallel query job for workers */
 
 
     /* -- Time management -- */
@@ -530,6 +642,12 @@ struct ecs_world_t {
     /* -- Metrics -- */
 
     ecs_world_info_t stats;
+    ecs_profiler_t *profiler;     /* Span recorder (NULL if not enabled) */
+    bool profiler_fini_set;       /* Is fini action of profiler registered */
+    ecs_vector_t *command_queues; /* Queues with commands from other threads */
+    ecs_vector_t *spatial_indices; /* Spatial indices, freed with world */
+    ecs_map_t *component_stats;   /* Component statistics (NULL if not tracked) */
+    uint64_t frame_span;          /* Start of the span of the current frame */
 
 
     /* -- Settings from command line arguments -- */
@@ -543,6 +661,11 @@ struct ecs_world_t {
     ecs_os_mutex_t mutex;         /* Locks the world if locking enabled */
     ecs_os_mutex_t thr_sync;      /* Used to signal threads at end of frame */
     ecs_os_cond_t thr_cond;       /* Used to signal threads at end of frame */
+    ecs_os_mutex_t read_mutex;    /* Protects read epoch administration */
+    ecs_os_cond_t read_cond;      /* Signals change in readers or epoch */
+    int32_t read_count;           /* Number of threads reading the world */
+    int32_t read_epoch;           /* Incremented when world becomes readable */
+    bool read_enabled;            /* Can other threads read the world */
 
 
     /* -- World state -- */
@@ -551,6 +674,7 @@ struct ecs_world_t {
     bool quit_workers;            /* Signals worker threads to quit */
     bool in_progress;             /* Is world being progressed */
     bool is_merging;              /* Is world currently being merged */
+    bool is_fini;                 /* Is world being deleted */
     bool auto_merge;              /* Are stages auto-merged by ecs_progress */
     bool measure_frame_time;      /* Time spent on each frame */
     bool measure_system_time;     /* Time spent by each system */
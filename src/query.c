@@ -126,13 +126,72 @@ int table_compare(
     return table_1->rank - table_2->rank;
 }
 
+/** Store the index of a matched table in the query table slots, so that the
+ * table can be found without searching the vector of matched tables. */
+static
+void set_table_slot(
+    ecs_query_t *query,
+    ecs_vector_t *tables,
+    int32_t index,
+    bool active)
+{
+    if (!query->table_slots || index >= ecs_vector_count(tables)) {
+        return;
+    }
+
+    ecs_matched_table_t *table_data = ecs_vector_get(
+        tables, ecs_matched_table_t, index);
+    ecs_table_t *table = table_data->data.table;
+    if (table) {
+        ecs_query_table_slot_t slot = { .index = index, .active = active };
+        ecs_map_set(query->table_slots, table->id, &slot);
+    }
+}
+
+/** Store the range of active tables for each rank. Tables are sorted by rank,
+ * so tables with the same rank are stored next to each other. */
+static
+void build_groups(
+    ecs_query_t *query)
+{
+    if (!query->groups) {
+        query->groups = ecs_map_new(ecs_query_group_t, 0);
+    } else {
+        ecs_map_clear(query->groups);
+    }
+
+    ecs_matched_table_t *tables = ecs_vector_first(
+        query->tables, ecs_matched_table_t);
+    int32_t i, count = ecs_vector_count(query->tables);
+    ecs_query_group_t *group = NULL;
+    int32_t rank = 0;
+
+    for (i = 0; i < count; i ++) {
+        if (!group || tables[i].rank != rank) {
+            rank = tables[i].rank;
+            ecs_query_group_t new_group = { .first = i };
+            ecs_map_set(query->groups, (uint32_t)rank, &new_group);
+            group = ecs_map_get(query->groups, ecs_query_group_t, (uint32_t)rank);
+        }
+
+        group->count ++;
+    }
+}
+
 static
 void order_ranked_tables(
     ecs_world_t *world,
     ecs_query_t *query)
 {
     if (query->group_table) {
-        ecs_vector_sort(query->tables, ecs_matched_table_t, table_compare);       
+        ecs_vector_sort(query->tables, ecs_matched_table_t, table_compare);
+
+        int32_t i, count = ecs_vector_count(query->tables);
+        for (i = 0; i < count; i ++) {
+            set_table_slot(query, query->tables, i, true);
+        }
+
+        build_groups(query);
     }
 
     /* Re-register monitors after tables have been reordered. This will update
@@ -603,6 +662,31 @@ ecs_type_t get_column_type(
 }
 
 /** Add table to system, compute offsets for system components in table it */
+/* Return storage if column is matched per entity with a sparse component */
+static
+ecs_sparse_t* get_lookup_sparse(
+    ecs_world_t *world,
+    ecs_sig_column_t *column)
+{
+    ecs_sig_oper_kind_t op = column->oper_kind;
+    ecs_sig_from_kind_t from = column->from_kind;
+
+    if (op != EcsOperAnd && op != EcsOperNot && op != EcsOperOptional) {
+        return NULL;
+    }
+
+    if (from != EcsFromAny && from != EcsFromOwned) {
+        return NULL;
+    }
+
+    ecs_c_info_t *c_info = ecs_get_sparse_c_info(world, column->is.component);
+    if (!c_info) {
+        return NULL;
+    }
+
+    return c_info->sparse;
+}
+
 static
 void add_table(
     ecs_world_t *world,
@@ -675,6 +759,24 @@ add_trait:
 
         table_data.data.columns[c] = 0;
 
+        /* Components with sparse storage are not stored in the table. Add a
+         * lookup column so that the component is tested for each entity */
+        ecs_sparse_t *sparse = get_lookup_sparse(world, column);
+        if (sparse) {
+            if (op != EcsOperOptional) {
+                ecs_lookup_column_t *lc = ecs_vector_add(
+                    &table_data.lookup_columns, ecs_lookup_column_t);
+                lc->sparse = sparse;
+                lc->signature_column_index = c;
+                lc->is_not = op == EcsOperNot;
+            }
+
+            component = column->is.component;
+            table_data.data.components[c] = component;
+            table_data.data.types[c] = get_column_type(world, op, component);
+            continue;
+        }
+
         /* Get actual component and component source for current column */
         get_comp_and_src(world, query, table_type, column, op, from, &component, 
             &entity);
@@ -707,6 +809,22 @@ add_trait:
                 sc->sw_case = component & ECS_COMPONENT_MASK;
                 sc->sw_column = NULL;
             }
+
+            /* If table has a DISABLED bitset for the component, add a bitset
+             * column so that disabled entities are skipped when iterating */
+            if (op == EcsOperAnd && index > 0 && 
+                !(component & ECS_ROLE_MASK) &&
+                table && (table->flags & EcsTableHasDisabled)) 
+            {
+                int32_t bs_index = ecs_type_index_of(
+                    table_type, component | ECS_DISABLED);
+                if (bs_index != -1) {
+                    ecs_bitset_column_t *bc = ecs_vector_add(
+                        &table_data.bitset_columns, ecs_bitset_column_t);
+                    bc->bs_column_index = bs_index - table->bs_column_offset;
+                    bc->signature_column_index = c;
+                }
+            }
         }
 
         /* Check if a the component is a reference. If 'entity' is set, the
@@ -739,9 +857,11 @@ add_trait:
      * activate signal to the system. */
 
     ecs_matched_table_t *table_elem;
+    bool table_elem_active;
     if (table && has_auto_activation(query)) {
         table_elem = ecs_vector_add(&query->empty_tables, 
             ecs_matched_table_t);
+        table_elem_active = false;
 
         #ifndef NDEBUG
         char *type_expr = ecs_type_str(world, table->type);
@@ -761,6 +881,7 @@ add_trait:
          * get the count to determine the current table index. */
         matched_table_index = ecs_vector_count(query->tables) - 1;
         ecs_assert(matched_table_index >= 0, ECS_INTERNAL_ERROR, NULL);
+        table_elem_active = true;
     }
 
     if (references) {
@@ -774,6 +895,14 @@ add_trait:
 
     *table_elem = table_data;
 
+    if (table_elem_active) {
+        set_table_slot(query, query->tables, 
+            ecs_vector_count(query->tables) - 1, true);
+    } else {
+        set_table_slot(query, query->empty_tables, 
+            ecs_vector_count(query->empty_tables) - 1, false);
+    }
+
     /* Use tail recursion when adding table for multiple traits */
     trait_cur ++;
     if (trait_cur < trait_count) {
@@ -884,6 +1013,11 @@ bool ecs_query_match(
 
         failure_info->column = i + 1;
 
+        /* Sparse components are matched per entity while iterating */
+        if (get_lookup_sparse(world, elem)) {
+            continue;
+        }
+
         if (oper_kind == EcsOperAnd) {
             if (!match_column(
                 world, table_type, from_kind, elem->is.component, 
@@ -974,10 +1108,22 @@ void match_tables(
 /** Get index of table in system's matched tables */
 static
 int32_t get_table_param_index(
+    ecs_query_t *query,
     ecs_table_t *table,
-    ecs_vector_t *tables,
+    bool active,
     int32_t start_index)
 {
+    /* A table can only be matched once if the query has table slots */
+    if (query->table_slots) {
+        ecs_query_table_slot_t *slot = ecs_map_get(
+            query->table_slots, ecs_query_table_slot_t, table->id);
+        if (slot && slot->active == active && slot->index >= start_index) {
+            return slot->index;
+        }
+        return -1;
+    }
+
+    ecs_vector_t *tables = active ? query->tables : query->empty_tables;
     int32_t i, count = ecs_vector_count(tables);
     ecs_matched_table_t *table_data = ecs_vector_first(
         tables, ecs_matched_table_t);
@@ -994,20 +1140,11 @@ int32_t get_table_param_index(
 /** Check if a table was matched with the system */
 static
 int32_t table_matched(
-    ecs_vector_t *tables,
-    ecs_table_t *table)
+    ecs_query_t *query,
+    ecs_table_t *table,
+    bool active)
 {
-    int32_t i, count = ecs_vector_count(tables);
-    ecs_matched_table_t *table_data = ecs_vector_first(
-        tables, ecs_matched_table_t);
-
-    for (i = 0; i < count; i ++) {
-        if (table_data[i].data.table == table) {
-            return i;
-        }
-    }
-
-    return -1;
+    return get_table_param_index(query, table, active, 0);
 }
 
 static
@@ -1153,6 +1290,179 @@ void sort_table(
     qsort_array(world, table, data, entities, ptr, size, 0, count - 1, compare);
 }
 
+/* Convert a key to an unsigned integer with the same ordering, so that keys of
+ * any kind can be sorted by their bytes */
+static
+uint64_t sort_key_from_ptr(
+    ecs_sort_key_kind_t kind,
+    const void *ptr)
+{
+    switch(kind) {
+    case EcsSortKeyI32: {
+        int32_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(int32_t));
+        return (uint32_t)v ^ 0x80000000u;
+    }
+    case EcsSortKeyU32: {
+        uint32_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(uint32_t));
+        return v;
+    }
+    case EcsSortKeyF32: {
+        /* Negative floats are ordered in reverse, so flip all of their bits */
+        uint32_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(float));
+        return (v & 0x80000000u) ? (uint32_t)~v : (v | 0x80000000u);
+    }
+    case EcsSortKeyI64: {
+        int64_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(int64_t));
+        return (uint64_t)v ^ 0x8000000000000000ull;
+    }
+    case EcsSortKeyU64: {
+        uint64_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(uint64_t));
+        return v;
+    }
+    case EcsSortKeyF64: {
+        uint64_t v;
+        ecs_os_memcpy(&v, ptr, ECS_SIZEOF(double));
+        return (v & 0x8000000000000000ull) ? ~v : (v | 0x8000000000000000ull);
+    }
+    default:
+        ecs_abort(ECS_INTERNAL_ERROR, NULL);
+    }
+
+    return 0;
+}
+
+static
+int32_t sort_key_size(
+    ecs_sort_key_kind_t kind)
+{
+    switch(kind) {
+    case EcsSortKeyI32:
+    case EcsSortKeyU32:
+    case EcsSortKeyF32:
+        return 4;
+    default:
+        return 8;
+    }
+}
+
+/* Sort table with an LSD radix sort on the key. The sort produces a permutation
+ * which is applied to the table in a single pass, instead of swapping rows. */
+static
+void radix_sort_table(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    int32_t column_index,
+    ecs_sort_key_kind_t kind,
+    ecs_size_t offset)
+{
+    ecs_data_t *data = ecs_table_get_data(table);
+    if (!data || !data->entities) {
+        /* Nothing to sort */
+        return;
+    }
+
+    int32_t count = ecs_table_data_count(data);
+    if (count < 2) {
+        return;
+    }
+
+    ecs_assert(column_index != -1, ECS_INTERNAL_ERROR, NULL);
+    ecs_column_t *column = &data->columns[column_index];
+    int16_t size = column->size;
+    void *ptr = ecs_vector_first_t(column->data, size, column->alignment);
+    int32_t key_size = sort_key_size(kind);
+    ecs_assert(offset + key_size <= size, ECS_INVALID_PARAMETER, NULL);
+
+    uint64_t *keys_buffer = ecs_os_malloc(ECS_SIZEOF(uint64_t) * count * 2);
+    int32_t *perm_buffer = ecs_os_malloc(ECS_SIZEOF(int32_t) * count * 2);
+    ecs_assert(keys_buffer != NULL, ECS_OUT_OF_MEMORY, NULL);
+    ecs_assert(perm_buffer != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    uint64_t *keys = keys_buffer, *keys_tmp = &keys_buffer[count];
+    int32_t *perm = perm_buffer, *perm_tmp = &perm_buffer[count];
+
+    /* Histograms for all digits are computed in the same pass that extracts
+     * the keys */
+    int32_t hist[8][256] = {{0}};
+    bool is_sorted = true;
+
+    int32_t i, b;
+    for (i = 0; i < count; i ++) {
+        uint64_t key = sort_key_from_ptr(
+            kind, ECS_OFFSET(ptr, size * i + offset));
+        keys[i] = key;
+        perm[i] = i;
+
+        if (i && key < keys[i - 1]) {
+            is_sorted = false;
+        }
+
+        for (b = 0; b < key_size; b ++) {
+            hist[b][(key >> (b * 8)) & 0xFF] ++;
+        }
+    }
+
+    /* Don't touch the table if the order did not change */
+    if (!is_sorted) {
+        for (b = 0; b < key_size; b ++) {
+            int32_t shift = b * 8;
+            int32_t *h = hist[b];
+
+            /* Skip digits that are the same for all keys */
+            if (h[(keys[0] >> shift) & 0xFF] == count) {
+                continue;
+            }
+
+            int32_t d, sum = 0;
+            for (d = 0; d < 256; d ++) {
+                int32_t n = h[d];
+                h[d] = sum;
+                sum += n;
+            }
+
+            for (i = 0; i < count; i ++) {
+                int32_t dst = h[(keys[i] >> shift) & 0xFF] ++;
+                keys_tmp[dst] = keys[i];
+                perm_tmp[dst] = perm[i];
+            }
+
+            uint64_t *k = keys; keys = keys_tmp; keys_tmp = k;
+            int32_t *p = perm; perm = perm_tmp; perm_tmp = p;
+        }
+
+        ecs_table_permute(world, table, data, perm);
+    }
+
+    ecs_os_free(keys_buffer);
+    ecs_os_free(perm_buffer);
+}
+
+/* Compare function used when merging tables sorted by key */
+static
+int compare_sort_key(
+    ecs_query_t *query,
+    ecs_entity_t e1,
+    const void *ptr1,
+    ecs_entity_t e2,
+    const void *ptr2)
+{
+    ecs_compare_action_t compare = query->compare;
+    if (compare) {
+        return compare(e1, (void*)ptr1, e2, (void*)ptr2);
+    }
+
+    ecs_sort_key_kind_t kind = query->sort_key_kind;
+    ecs_size_t offset = query->sort_key_offset;
+    uint64_t k1 = sort_key_from_ptr(kind, ECS_OFFSET(ptr1, offset));
+    uint64_t k2 = sort_key_from_ptr(kind, ECS_OFFSET(ptr2, offset));
+    return (k1 > k2) - (k1 < k2);
+}
+
 /* Helper struct for building sorted table ranges */
 typedef struct sort_helper_t {
     ecs_matched_table_t *table;
@@ -1191,7 +1501,6 @@ void build_sorted_table_range(
     int32_t end)
 {
     ecs_entity_t component = query->sort_on_component;
-    ecs_compare_action_t compare = query->compare;
 
     /* Fetch data from all matched tables */
     ecs_matched_table_t *tables = ecs_vector_first(query->tables, ecs_matched_table_t);
@@ -1255,7 +1564,7 @@ void build_sorted_table_range(
             void *ptr1 = ptr_from_helper(&helper[min]);
             void *ptr2 = ptr_from_helper(&helper[j]);
 
-            if (compare(e1, ptr1, e2, ptr2) > 0) {
+            if (compare_sort_key(query, e1, ptr1, e2, ptr2) > 0) {
                 min = j;
             }
         }
@@ -1278,6 +1587,51 @@ void build_sorted_table_range(
     ecs_os_free(helper);
 }
 
+/* Report change in memory of query and its matched tables */
+static
+void track_query_alloc(
+    ecs_query_t *query)
+{
+    int32_t column_count = ecs_vector_count(query->sig.columns);
+    int32_t table_count = ecs_vector_count(query->tables) + 
+        ecs_vector_count(query->empty_tables);
+
+    ecs_size_t bytes = ECS_SIZEOF(ecs_query_t) +
+        (ecs_vector_size(query->tables) + 
+            ecs_vector_size(query->empty_tables)) * 
+                ECS_SIZEOF(ecs_matched_table_t) +
+        ecs_vector_size(query->table_slices) * ECS_SIZEOF(ecs_table_slice_t) +
+        table_count * column_count * (ECS_SIZEOF(int32_t) + 
+            ECS_SIZEOF(ecs_entity_t) + ECS_SIZEOF(ecs_type_t));
+
+    ecs_os_track_alloc(EcsAllocQuery, query->alloc_bytes, bytes);
+    query->alloc_bytes = bytes;
+}
+
+/* Build slices for a range of tables with the same rank, and store the range
+ * of slices in the group so the group can be iterated directly */
+static
+void build_sorted_group(
+    ecs_query_t *query,
+    int32_t start,
+    int32_t end)
+{
+    int32_t slice_first = ecs_vector_count(query->table_slices);
+    build_sorted_table_range(query, start, end);
+
+    if (query->groups) {
+        ecs_matched_table_t *table = ecs_vector_get(
+            query->tables, ecs_matched_table_t, start);
+        ecs_query_group_t *group = ecs_map_get(
+            query->groups, ecs_query_group_t, (uint32_t)table->rank);
+        if (group) {
+            group->slice_first = slice_first;
+            group->slice_count = 
+                ecs_vector_count(query->table_slices) - slice_first;
+        }
+    }
+}
+
 static
 void build_sorted_tables(
     ecs_query_t *query)
@@ -1295,7 +1649,7 @@ void build_sorted_tables(
         table = &tables[i];
         if (rank != table->rank) {
             if (start != i) {
-                build_sorted_table_range(query, start, i);
+                build_sorted_group(query, start, i);
                 start = i;
             }
             rank = table->rank;
@@ -1303,8 +1657,10 @@ void build_sorted_tables(
     }
 
     if (start != i) {
-        build_sorted_table_range(query, start, i);
+        build_sorted_group(query, start, i);
     }
+
+    track_query_alloc(query);
 }
 
 static
@@ -1371,12 +1727,18 @@ void sort_tables(
     ecs_query_t *query)
 {
     ecs_compare_action_t compare = query->compare;
-    if (!compare) {
+    ecs_sort_key_kind_t sort_key_kind = query->sort_key_kind;
+    if (!compare && !sort_key_kind) {
         return;
     }
     
     ecs_entity_t sort_on_component = query->sort_on_component;
 
+    /* Sorting moves rows and updates entity records, which is not safe while
+     * other threads read the world. Remember which tables are dirty, and sort
+     * them when the read epoch has ended. */
+    bool postpone = world->read_enabled;
+
     /* Iterate over active tables. Don't bother with inactive tables, since
      * they're empty */
     int32_t i, count = ecs_vector_count(query->tables);
@@ -1399,7 +1761,8 @@ void sort_tables(
 
         int32_t *dirty_state = ecs_table_get_dirty_state(table);
 
-        is_dirty = is_dirty || (dirty_state[0] != table_data->monitor[0]);
+        is_dirty = is_dirty || table_data->sort_pending ||
+            (dirty_state[0] != table_data->monitor[0]);
 
         int32_t index = -1;
         if (sort_on_component) {
@@ -1413,14 +1776,37 @@ void sort_tables(
         
         /* Check both if entities have moved (element 0) or if the component
          * we're sorting on has changed (index + 1) */
-        if (is_dirty) {
+        if (is_dirty && postpone) {
+            table_data->sort_pending = true;
+            query->flags |= EcsQuerySortPending;
+        } else if (is_dirty) {
             /* Sort the table */
-            sort_table(world, table, index, compare);
+            if (sort_key_kind) {
+                radix_sort_table(world, table, index, sort_key_kind, 
+                    query->sort_key_offset);
+            } else {
+                sort_table(world, table, index, compare);
+            }
+            table_data->sort_pending = false;
             tables_sorted = true;
         }
     }
 
-    if (tables_sorted || query->match_count != query->prev_match_count) {
+    bool tables_changed = query->match_count != query->prev_match_count;
+
+    if (postpone) {
+        if (tables_changed) {
+            query->flags |= EcsQuerySortPending;
+        }
+        return;
+    }
+
+    if (query->flags & EcsQuerySortPending) {
+        query->flags &= ~EcsQuerySortPending;
+        tables_changed = true;
+    }
+
+    if (tables_sorted || tables_changed) {
         build_sorted_tables(query);
         query->match_count ++; /* Increase version if tables changed */
     }
@@ -1533,7 +1919,9 @@ void process_signature(
         ecs_sig_from_kind_t from = column->from_kind; 
         ecs_sig_inout_kind_t inout = column->inout_kind;
 
-        if (inout != EcsIn) {
+        if (inout == EcsInPrev) {
+            query->flags |= EcsQueryHasPrev;
+        } else if (inout != EcsIn) {
             query->flags |= EcsQueryHasOutColumns;
         }
 
@@ -1591,6 +1979,7 @@ void process_signature(
         if (from == EcsFromEntity) {
             ecs_assert(column->source != 0, ECS_INTERNAL_ERROR, NULL);
             ecs_set_watch(world, column->source);
+            query->flags |= EcsQueryHasFromEntity;
         }
     }
 
@@ -1633,12 +2022,18 @@ void activate_table(
     }
 
     int32_t i = 0, activated = 0;
-    while ((i = get_table_param_index(table, src_array, i)) != -1) {
+    while ((i = get_table_param_index(query, table, !active, i)) != -1) {
         activated ++;
 
         int32_t src_count = ecs_vector_move_index(
             &dst_array, src_array, ecs_matched_table_t, i);
 
+        /* The table is appended to the destination, and the last table of the
+         * source is moved into the slot of the table */
+        set_table_slot(query, dst_array, ecs_vector_count(dst_array) - 1, 
+            active);
+        set_table_slot(query, src_array, i, !active);
+
         if (active) {
             query->tables = dst_array;
         } else {
@@ -1731,19 +2126,85 @@ void free_matched_table(
     ecs_os_free((ecs_vector_t**)table->data.types);
     ecs_os_free(table->data.references);
     ecs_os_free(table->sparse_columns);
+    ecs_vector_free(table->bitset_columns);
+    ecs_vector_free(table->lookup_columns);
     ecs_os_free(table->monitor);
 }
 
 /* Remove table */
 static
 void remove_table(
-    ecs_vector_t *tables,
+    ecs_query_t *query,
+    bool active,
     int32_t index)
 {
+    ecs_vector_t *tables = active ? query->tables : query->empty_tables;
     ecs_matched_table_t *table = ecs_vector_get(
         tables, ecs_matched_table_t, index);
+
+    if (query->table_slots) {
+        ecs_map_remove(query->table_slots, table->data.table->id);
+    }
+
     free_matched_table(table);
     ecs_vector_remove_index(tables, ecs_matched_table_t, index);
+    set_table_slot(query, tables, index, active);
+}
+
+/* Remove active table of a ranked query. Unlike remove_table, this preserves
+ * the order of the remaining tables, so that groups remain contiguous without
+ * sorting all tables. Only the tables after the removed table are updated. */
+static
+void remove_ranked_table(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    int32_t index)
+{
+    ecs_matched_table_t *tables = ecs_vector_first(
+        query->tables, ecs_matched_table_t);
+    int32_t i, count = ecs_vector_count(query->tables);
+    int32_t rank = tables[index].rank;
+
+    if (query->table_slots) {
+        ecs_map_remove(query->table_slots, tables[index].data.table->id);
+    }
+
+    free_matched_table(&tables[index]);
+    ecs_os_memmove(&tables[index], &tables[index + 1],
+        ECS_SIZEOF(ecs_matched_table_t) * (count - index - 1));
+    ecs_vector_remove_last(query->tables);
+    count --;
+
+    for (i = index; i < count; i ++) {
+        set_table_slot(query, query->tables, i, true);
+
+        /* Update the matched table index registered with monitors */
+        if (query->flags & EcsQueryMonitor) {
+            ecs_table_notify(world, tables[i].data.table, &(ecs_table_event_t){
+                .kind = EcsTableQueryMatch,
+                .query = query,
+                .matched_table_index = i
+            });
+        }
+    }
+
+    if (query->groups) {
+        ecs_map_iter_t it = ecs_map_iter(query->groups);
+        ecs_query_group_t *group;
+        while ((group = ecs_map_next(&it, ecs_query_group_t, NULL))) {
+            if (group->first > index) {
+                group->first --;
+            }
+        }
+
+        group = ecs_map_get(query->groups, ecs_query_group_t, (uint32_t)rank);
+        ecs_assert(group != NULL, ECS_INTERNAL_ERROR, NULL);
+        if (!(-- group->count)) {
+            ecs_map_remove(query->groups, (uint32_t)rank);
+        }
+    }
+
+    query->match_count ++;
 }
 
 static
@@ -1754,13 +2215,16 @@ void unmatch_table_w_index(
 {
     /* If table no longer matches, remove it */
     if (match != -1) {
-        remove_table(query->tables, match);
+        if (query->group_table) {
+            remove_ranked_table(query->world, query, match);
+        } else {
+            remove_table(query, true, match);
+        }
     } else {
         /* Make sure the table is removed if it was inactive */
-        match = table_matched(
-            query->empty_tables, table);
+        match = table_matched(query, table, false);
         if (match != -1) {
-            remove_table(query->empty_tables, match);
+            remove_table(query, false, match);
         }
     }  
 }
@@ -1771,7 +2235,7 @@ void unmatch_table(
     ecs_table_t *table)
 {
     unmatch_table_w_index(
-        query, table, table_matched(query->tables, table));       
+        query, table, table_matched(query, table, true));       
 }
 
 static
@@ -1780,12 +2244,12 @@ void rematch_table(
     ecs_query_t *query,
     ecs_table_t *table)
 {
-    int32_t match = table_matched(query->tables, table);
+    int32_t match = table_matched(query, table, true);
 
     if (ecs_query_match(world, table, query, NULL)) {
         /* If the table matches, and it is not currently matched, add */
         if (match == -1) {
-            if (table_matched(query->empty_tables, table) == -1) {
+            if (table_matched(query, table, false) == -1) {
                 add_table(world, query, table);
             }
 
@@ -1827,13 +2291,44 @@ void rematch_table(
     }
 }
 
+/* Test if one of the entities that changed is the source of a column with an
+ * explicit source. A change to such an entity can change the match of any 
+ * table. If it is not known which entities changed, assume that one did. */
+static
+bool from_entity_changed(
+    ecs_query_t *query,
+    ecs_vector_t *changed)
+{
+    if (!changed) {
+        return true;
+    }
+
+    ecs_vector_each(query->sig.columns, ecs_sig_column_t, column, {
+        if (column->from_kind != EcsFromEntity) {
+            continue;
+        }
+
+        ecs_vector_each(changed, ecs_entity_t, e_ptr, {
+            if (*e_ptr == column->source) {
+                return true;
+            }
+        });
+    });
+
+    return false;
+}
+
 /* Rematch system with tables after a change happened to a watched entity */
 static
 void rematch_tables(
     ecs_world_t *world,
     ecs_query_t *query,
-    ecs_query_t *parent_query)
+    ecs_query_t *parent_query,
+    ecs_vector_t *affected,
+    ecs_vector_t *changed)
 {
+    world->stats.rematch_count_total ++;
+
     if (parent_query) {
         ecs_matched_table_t *tables = ecs_vector_first(parent_query->tables, ecs_matched_table_t);
         int32_t i, count = ecs_vector_count(parent_query->tables);
@@ -1848,6 +2343,16 @@ void rematch_tables(
             ecs_table_t *table = tables[i].data.table;
             rematch_table(world, query, table);
         }        
+    } else if (affected && (!(query->flags & EcsQueryHasFromEntity) || 
+        !from_entity_changed(query, changed))) 
+    {
+        /* Only tables with the changed entities as parent or base can change
+         * their match. When the source of a column with an explicit source
+         * changed, any table can change its match, so all tables are
+         * evaluated. */
+        ecs_vector_each(affected, ecs_table_t*, table_ptr, {
+            rematch_table(world, query, *table_ptr);
+        });
     } else {
         ecs_sparse_t *tables = world->store.tables;
         int32_t i, count = ecs_sparse_count(tables);
@@ -1919,7 +2424,8 @@ void ecs_query_notify(
         break;
     case EcsQueryTableRematch:
         /* Rematch tables of query */
-        rematch_tables(world, query, event->parent_query);
+        rematch_tables(world, query, event->parent_query, event->tables, 
+            event->entities);
         break;        
     case EcsQueryTableEmpty:
         /* Table is empty, deactivate */
@@ -1939,6 +2445,8 @@ void ecs_query_notify(
     if (notify) {
         notify_subqueries(world, query, event);
     }
+
+    track_query_alloc(query);
 }
 
 /* -- Public API -- */
@@ -1963,6 +2471,12 @@ ecs_query_t* ecs_query_new_w_sig_intern(
 
     process_signature(world, result);
 
+    /* Queries with traits can match the same table more than once, so a table
+     * does not map to a single slot */
+    if (!(result->flags & EcsQueryHasTraits)) {
+        result->table_slots = ecs_map_new(ecs_query_table_slot_t, 0);
+    }
+
     ecs_trace_2("query #[green]%s#[reset] created with expression #[red]%s", 
         query_name(world, result), result->sig.expr);
 
@@ -2003,6 +2517,8 @@ ecs_query_t* ecs_query_new_w_sig_intern(
     /* Make sure application can't try to free sig resources */
     *sig = (ecs_sig_t){ 0 };
 
+    track_query_alloc(result);
+
     return result;
 }
 
@@ -2051,6 +2567,26 @@ void ecs_query_free(
         .kind = EcsQueryOrphan
     });
 
+    /* Remove the query from the tables and monitors it is registered with. When
+     * the world is deleted the tables have already been freed. */
+    if (!(query->flags & EcsQueryIsSubquery) && !world->is_fini) {
+        ecs_table_event_t event = {
+            .kind = EcsTableQueryFree,
+            .query = query
+        };
+
+        ecs_vector_each(query->tables, ecs_matched_table_t, table, {
+            ecs_table_notify(world, table->data.table, &event);
+        });
+
+        ecs_vector_each(query->empty_tables, ecs_matched_table_t, table, {
+            ecs_table_notify(world, table->data.table, &event);
+        });
+
+        ecs_component_monitor_unregister(&world->component_monitors, query);
+        ecs_component_monitor_unregister(&world->parent_monitors, query);
+    }
+
     ecs_vector_each(query->empty_tables, ecs_matched_table_t, table, {
         free_matched_table(table);
     });
@@ -2062,8 +2598,11 @@ void ecs_query_free(
     ecs_vector_free(query->subqueries);
     ecs_vector_free(query->tables);
     ecs_vector_free(query->empty_tables);
+    ecs_map_free(query->table_slots);
+    ecs_map_free(query->groups);
     ecs_vector_free(query->table_slices);
     ecs_sig_deinit(&query->sig);
+    ecs_os_track_alloc(EcsAllocQuery, query->alloc_bytes, 0);
 
     /* Find query in vector */
     if (!(query->flags & EcsQueryIsSubquery) && world->queries) {
@@ -2090,9 +2629,12 @@ ecs_iter_t ecs_query_iter_page(
     ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
     ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);
 
-    sort_tables(query->world, query);
-
-    tables_reset_dirty(query);
+    /* Threads that read the world while it progresses must not modify the
+     * query, as the query may be iterated by other threads at the same time */
+    if (!ecs_is_reader_thread()) {
+        sort_tables(query->world, query);
+        tables_reset_dirty(query);
+    }
 
     int32_t table_count;
     if (query->table_slices) {
@@ -2127,6 +2669,86 @@ ecs_iter_t ecs_query_iter(
     return ecs_query_iter_page(query, 0, 0);
 }
 
+/* Find first table (or slice) with a rank that is not lower than the provided
+ * rank, or if upper is true, with a rank that is higher than the rank. */
+static
+int32_t group_bound(
+    ecs_query_t *query,
+    int32_t rank,
+    bool upper)
+{
+    ecs_table_slice_t *slices = ecs_vector_first(
+        query->table_slices, ecs_table_slice_t);
+    ecs_matched_table_t *tables = ecs_vector_first(
+        query->tables, ecs_matched_table_t);
+
+    int32_t lo = 0, hi;
+    if (slices) {
+        hi = ecs_vector_count(query->table_slices);
+    } else {
+        hi = ecs_vector_count(query->tables);
+    }
+
+    while (lo < hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        ecs_matched_table_t *table = slices ? slices[mid].table : &tables[mid];
+        if (table->rank < rank || (upper && table->rank == rank)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+ecs_iter_t ecs_query_iter_group(
+    ecs_query_t *query,
+    int32_t rank)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(query->group_table != NULL, ECS_INVALID_PARAMETER, NULL);
+
+    /* Obtain the iterator first, as this rebuilds the table slices of a
+     * sorted query, which updates the slice ranges of the groups */
+    ecs_iter_t it = ecs_query_iter(query);
+
+    ecs_query_group_t *group = NULL;
+    if (query->groups) {
+        group = ecs_map_get(query->groups, ecs_query_group_t, (uint32_t)rank);
+    }
+
+    if (!group) {
+        it.table_count = 0;
+    } else if (query->table_slices) {
+        it.iter.query.index = group->slice_first;
+        it.table_count = group->slice_first + group->slice_count;
+    } else {
+        it.iter.query.index = group->first;
+        it.table_count = group->first + group->count;
+    }
+
+    return it;
+}
+
+ecs_iter_t ecs_query_iter_group_range(
+    ecs_query_t *query,
+    int32_t rank_min,
+    int32_t rank_max)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(query->group_table != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(rank_min <= rank_max, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_iter_t it = ecs_query_iter(query);
+
+    /* Tables are sorted by rank, so the range can be found with a search */
+    it.iter.query.index = group_bound(query, rank_min, false);
+    it.table_count = group_bound(query, rank_max, true);
+
+    return it;
+}
+
 void ecs_query_set_iter(
     ecs_world_t *world,
     ecs_query_t *query,
@@ -2318,6 +2940,182 @@ done:
     return -1;
 }
 
+/* Return index of lowest set bit. Value must not be 0. */
+static
+int32_t lowest_bit(
+    uint64_t value)
+{
+    int32_t result = 0;
+    if (!(value & 0xFFFFFFFF)) { value >>= 32; result += 32; }
+    if (!(value & 0xFFFF)) { value >>= 16; result += 16; }
+    if (!(value & 0xFF)) { value >>= 8; result += 8; }
+    if (!(value & 0xF)) { value >>= 4; result += 4; }
+    if (!(value & 0x3)) { value >>= 2; result += 2; }
+    if (!(value & 0x1)) { result += 1; }
+    return result;
+}
+
+/* Return bits for 64 rows starting at word, for which all bitset columns are
+ * enabled. */
+static
+uint64_t bitset_word(
+    ecs_data_t *data,
+    ecs_bitset_column_t *columns,
+    int32_t count,
+    int32_t word)
+{
+    uint64_t result = ~(uint64_t)0;
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        ecs_bitset_t *bs = &data->bs_columns[columns[i].bs_column_index].data;
+        result &= bs->data[word];
+    }
+    return result;
+}
+
+static
+bool bitset_row_enabled(
+    ecs_table_t *table,
+    ecs_vector_t *bitset_columns,
+    int32_t row)
+{
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_bitset_column_t *columns = ecs_vector_first(
+        bitset_columns, ecs_bitset_column_t);
+    int32_t count = ecs_vector_count(bitset_columns);
+    uint64_t bits = bitset_word(data, columns, count, row >> 6);
+    return (bits >> (row & 0x3F)) & 1;
+}
+
+/* Find next range of rows for which all bitset columns are enabled. Bitsets
+ * are scanned a word (64 rows) at a time, so that words in which all rows are
+ * disabled or enabled are skipped without testing individual bits. */
+static
+int bitset_column_next(
+    ecs_table_t *table,
+    ecs_vector_t *bitset_columns,
+    ecs_query_iter_t *iter,
+    ecs_page_cursor_t *cur)
+{
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_bitset_column_t *columns = ecs_vector_first(
+        bitset_columns, ecs_bitset_column_t);
+    int32_t count = ecs_vector_count(bitset_columns);
+
+    int32_t last = cur->first + cur->count;
+    int32_t row = iter->bitset_first;
+    if (!row) {
+        row = cur->first;
+    }
+
+    /* Find first enabled row */
+    int32_t first = -1;
+    while (row < last) {
+        int32_t word = row >> 6;
+        uint64_t bits = bitset_word(data, columns, count, word);
+        bits &= ~(uint64_t)0 << (row & 0x3F);
+        if (bits) {
+            first = word * 64 + lowest_bit(bits);
+            break;
+        }
+        row = (word + 1) * 64;
+    }
+
+    if (first == -1 || first >= last) {
+        /* No more enabled rows, move to the next matched table. */
+        iter->bitset_first = 0;
+        return -1;
+    }
+
+    /* Find first disabled row after the enabled row */
+    row = first;
+    while (row < last) {
+        int32_t word = row >> 6;
+        uint64_t bits = ~bitset_word(data, columns, count, word);
+        bits &= ~(uint64_t)0 << (row & 0x3F);
+        if (bits) {
+            row = word * 64 + lowest_bit(bits);
+            break;
+        }
+        row = (word + 1) * 64;
+    }
+
+    if (row > last) {
+        row = last;
+    }
+
+    cur->first = first;
+    cur->count = row - first;
+    iter->bitset_first = row;
+
+    return 0;
+}
+
+/* Test if entity in row matches sparse components of lookup columns */
+static
+bool lookup_row_match(
+    ecs_data_t *data,
+    ecs_vector_t *lookup_columns,
+    int32_t row)
+{
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+    ecs_entity_t e = entities[row];
+
+    ecs_lookup_column_t *columns = ecs_vector_first(
+        lookup_columns, ecs_lookup_column_t);
+    int32_t i, count = ecs_vector_count(lookup_columns);
+
+    for (i = 0; i < count; i ++) {
+        bool has = _ecs_sparse_get_sparse(columns[i].sparse, 0, e) != NULL;
+        if (has == columns[i].is_not) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Find next row that matches the lookup columns. Matching rows are returned
+ * one at a time, so that a column of a sparse component can point to the
+ * component of the entity in the sparse set. */
+static
+int lookup_column_next(
+    ecs_table_t *table,
+    ecs_matched_table_t *matched_table,
+    ecs_query_iter_t *iter,
+    ecs_page_cursor_t *cur)
+{
+    ecs_data_t *data = ecs_table_get_data(table);
+    ecs_vector_t *lookup_columns = matched_table->lookup_columns;
+    ecs_vector_t *bitset_columns = matched_table->bitset_columns;
+
+    int32_t last = cur->first + cur->count;
+    int32_t row = iter->lookup_first;
+    if (!row) {
+        row = cur->first;
+    }
+
+    for (; row < last; row ++) {
+        if (bitset_columns && 
+            !bitset_row_enabled(table, bitset_columns, row)) 
+        {
+            continue;
+        }
+
+        if (lookup_row_match(data, lookup_columns, row)) {
+            cur->first = row;
+            cur->count = 1;
+            iter->lookup_first = row + 1;
+            return 0;
+        }
+    }
+
+    /* No more matching rows, move to the next matched table. */
+    iter->lookup_first = 0;
+
+    return -1;
+}
+
 static
 void mark_columns_dirty(
     ecs_query_t *query,
@@ -2331,7 +3129,8 @@ void mark_columns_dirty(
             query->sig.columns, ecs_sig_column_t);
 
         for (i = 0; i < count; i ++) {
-            if (columns[i].inout_kind != EcsIn) {
+            ecs_sig_inout_kind_t inout = columns[i].inout_kind;
+            if (inout != EcsIn && inout != EcsInPrev) {
                 int32_t table_column = table_data->data.columns[i];
                 if (table_column > 0) {
                     table->dirty_state[table_column] ++;
@@ -2357,7 +3156,8 @@ bool ecs_query_next(
     ecs_matched_table_t *tables = ecs_vector_first(
         query->tables, ecs_matched_table_t);
 
-    ecs_assert(!slice || query->compare, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(!slice || query->compare || query->sort_key_kind, 
+        ECS_INTERNAL_ERROR, NULL);
     
     ecs_page_cursor_t cur;
     int32_t table_count = it->table_count;
@@ -2373,6 +3173,8 @@ bool ecs_query_next(
         
         if (table) {
             ecs_vector_t *sparse_columns = table_data->sparse_columns;
+            ecs_vector_t *bitset_columns = table_data->bitset_columns;
+            ecs_vector_t *lookup_columns = table_data->lookup_columns;
             data = ecs_table_get_data(table);
             ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
             it->table_columns = data->columns;
@@ -2387,20 +3189,49 @@ bool ecs_query_next(
 
             if (cur.count) {
                 if (sparse_columns) {
-                    if (sparse_column_next(table, table_data,
-                        sparse_columns, iter, &cur) == -1)
-                    {
+                    int ret;
+                    do {
+                        ret = sparse_column_next(table, table_data,
+                            sparse_columns, iter, &cur);
+                    } while (!ret && ((bitset_columns && 
+                        !bitset_row_enabled(table, bitset_columns, cur.first)) ||
+                        (lookup_columns && 
+                        !lookup_row_match(data, lookup_columns, cur.first))));
+
+                    if (ret == -1) {
                         /* No more elements in sparse column */
                         continue;    
                     } else {
                         iter->index = i;
                     }
+                } else if (lookup_columns) {
+                    if (lookup_column_next(table, table_data, iter, &cur) == -1)
+                    {
+                        /* No more rows with sparse components */
+                        continue;
+                    } else {
+                        iter->index = i;
+                    }
+                } else if (bitset_columns) {
+                    if (bitset_column_next(table, bitset_columns, iter, 
+                        &cur) == -1) 
+                    {
+                        /* No more enabled rows in bitset columns */
+                        continue;
+                    } else {
+                        iter->index = i;
+                    }
                 }
 
                 int ret = ecs_page_iter_next(piter, &cur);
                 if (ret < 0) {
                     return false;
                 } else if (ret > 0) {
+                    /* If the table is iterated in multiple ranges, revisit the
+                     * table for the next range */
+                    if (iter->index == i) {
+                        i --;
+                    }
                     continue;
                 }
             } else {
@@ -2419,7 +3250,7 @@ bool ecs_query_next(
         it->frame_offset += prev_count;
 
         if (query->flags & EcsQueryHasOutColumns) {
-            if (table) {
+            if (table && !ecs_is_reader_thread()) {
                 mark_columns_dirty(query, table_data);
             }
         }
@@ -2503,6 +3334,36 @@ void ecs_query_order_by(
 
     query->sort_on_component = sort_component;
     query->compare = compare;
+    query->sort_key_kind = EcsSortKeyNone;
+
+    ecs_vector_free(query->table_slices);
+    query->table_slices = NULL;
+
+    sort_tables(world, query);    
+
+    if (!query->table_slices) {
+        build_sorted_tables(query);
+    }
+}
+
+void ecs_query_order_by_key(
+    ecs_world_t *world,
+    ecs_query_t *query,
+    ecs_entity_t sort_component,
+    ecs_sort_key_kind_t kind,
+    ecs_size_t offset)
+{
+    ecs_assert(query != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!(query->flags & EcsQueryIsOrphaned), ECS_INVALID_PARAMETER, NULL);    
+    ecs_assert(query->flags & EcsQueryNeedsTables, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(sort_component != 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(kind != EcsSortKeyNone, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(offset >= 0, ECS_INVALID_PARAMETER, NULL);
+
+    query->sort_on_component = sort_component;
+    query->compare = NULL;
+    query->sort_key_kind = kind;
+    query->sort_key_offset = offset;
 
     ecs_vector_free(query->table_slices);
     query->table_slices = NULL;
@@ -2514,6 +3375,30 @@ void ecs_query_order_by(
     }
 }
 
+static
+void query_sort_postponed(
+    ecs_world_t *world,
+    ecs_query_t *query)
+{
+    if (query->flags & EcsQuerySortPending) {
+        sort_tables(world, query);
+    }
+
+    ecs_vector_each(query->subqueries, ecs_query_t*, sq, {
+        query_sort_postponed(world, *sq);
+    });
+}
+
+void ecs_query_sort_postponed(
+    ecs_world_t *world)
+{
+    ecs_assert(!world->read_enabled, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_vector_each(world->queries, ecs_query_t*, q_ptr, {
+        query_sort_postponed(world, *q_ptr);
+    });
+}
+
 void ecs_query_group_by(
     ecs_world_t *world,
     ecs_query_t *query,
@@ -32,6 +32,7 @@
 #define TOK_ROLE_NOT "NOT"
 #define TOK_ROLE_SWITCH "SWITCH"
 #define TOK_ROLE_CASE "CASE"
+#define TOK_ROLE_DISABLED "DISABLED"
 
 #define TOK_IN "in"
 #define TOK_OUT "out"
@@ -156,6 +157,8 @@ ecs_entity_t parse_role(
         return ECS_SWITCH;
     } else if (!ecs_os_strcmp(token, TOK_ROLE_CASE)) {
         return ECS_CASE;
+    } else if (!ecs_os_strcmp(token, TOK_ROLE_DISABLED)) {
+        return ECS_DISABLED;
     } else if (!ecs_os_strcmp(token, TOK_OWNED)) {
         return ECS_OWNED;
     } else {
@@ -221,6 +224,9 @@ const char* parse_annotation(
     } else
     if (!strcmp(token, "inout")) {
         *inout_kind_out = EcsInOut;
+    } else
+    if (!strcmp(token, "prev")) {
+        *inout_kind_out = EcsInPrev;
     }
 
     ptr = skip_space(ptr);
@@ -455,6 +461,15 @@ parse_done:
         }
     }
 
+    /* Only owned components have a buffer with previous values */
+    if (elem.inout_kind == EcsInPrev) {
+        if (elem.from_kind != EcsFromOwned || elem.oper_kind == EcsOperNot) {
+            ecs_parser_error(name, sig, (ptr - sig), 
+                "invalid source modifier for [prev]"); 
+            return NULL;
+        }
+    }
+
     if (!explicit_inout) {
         if (elem.from_kind != EcsFromOwned) {
             elem.inout_kind = EcsIn;
@@ -704,6 +719,7 @@ int ecs_sig_add(
     /* OR columns store a type id instead of a single component */
     } else {
         ecs_assert(inout_kind != EcsOut, ECS_INVALID_SIGNATURE, NULL);
+        ecs_assert(inout_kind != EcsInPrev, ECS_INVALID_SIGNATURE, NULL);
         elem = ecs_vector_last(sig->columns, ecs_sig_column_t);
 
         if (elem->from_kind != from_kind) {
@@ -1,8 +1,9 @@
 #include "flecs.h"
 
-#define CHUNK_COUNT (4096)
-#define CHUNK(index) ((int32_t)index >> 12)
-#define OFFSET(index) ((int32_t)index & 0xFFF)
+#define CHUNK_SHIFT (12)
+#define CHUNK_COUNT(sparse) (1 << (sparse)->chunk_shift)
+#define CHUNK(sparse, index) ((int32_t)index >> (sparse)->chunk_shift)
+#define OFFSET(sparse, index) ((int32_t)index & (CHUNK_COUNT(sparse) - 1))
 #define DATA(array, size, offset) (ECS_OFFSET(array, size * offset))
 
 typedef struct chunk_t {
@@ -19,11 +20,35 @@ struct ecs_sparse_t {
 
     ecs_vector_t *chunks;       /* Chunks with sparse arrays & data */
     ecs_size_t size;            /* Element size */
+    int32_t chunk_shift;        /* Log2 of number of elements per chunk */
     int32_t count;              /* Number of alive entries */
     uint64_t max_id_local;      /* Local max index (if no global is set) */
     uint64_t *max_id;           /* Maximum issued sparse index */
+    ecs_alloc_tag_t alloc_tag;  /* Subsystem to which memory is attributed */
+    ecs_size_t alloc_bytes;     /* Memory reported to OS API, excl. chunks */
 };
 
+static
+ecs_size_t chunk_alloc_bytes(
+    ecs_sparse_t *sparse)
+{
+    return (ECS_SIZEOF(int32_t) + sparse->size) * CHUNK_COUNT(sparse);
+}
+
+/* Report changes in size of the sparse set and its arrays. Chunks are reported
+ * separately when they are allocated and freed. */
+static
+void track_alloc(
+    ecs_sparse_t *sparse)
+{
+    ecs_size_t bytes = ECS_SIZEOF(ecs_sparse_t) +
+        ecs_vector_size(sparse->dense) * ECS_SIZEOF(uint64_t) +
+        ecs_vector_size(sparse->chunks) * ECS_SIZEOF(chunk_t);
+
+    ecs_os_track_alloc(sparse->alloc_tag, sparse->alloc_bytes, bytes);
+    sparse->alloc_bytes = bytes;
+}
+
 static
 chunk_t* chunk_new(
     ecs_sparse_t *sparse,
@@ -50,23 +75,31 @@ chunk_t* chunk_new(
      * sparse element has not been paired with a dense element. Use zero
      * as this means we can take advantage of calloc having a possibly better 
      * performance than malloc + memset. */
-    result->sparse = ecs_os_calloc(ECS_SIZEOF(int32_t) * CHUNK_COUNT);
+    result->sparse = ecs_os_calloc(ECS_SIZEOF(int32_t) * CHUNK_COUNT(sparse));
 
     /* Initialize the data array with zero's to guarantee that data is 
      * always initialized. When an entry is removed, data is reset back to
      * zero. Initialize now, as this can take advantage of calloc. */
-    result->data = ecs_os_calloc(sparse->size * CHUNK_COUNT);
+    result->data = ecs_os_calloc(sparse->size * CHUNK_COUNT(sparse));
 
     ecs_assert(result->sparse != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(result->data != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    ecs_os_track_alloc(sparse->alloc_tag, 0, chunk_alloc_bytes(sparse));
+    track_alloc(sparse);
+
     return result;
 }
 
 static
 void chunk_free(
+    ecs_sparse_t *sparse,
     chunk_t *chunk)
 {
+    if (chunk->sparse) {
+        ecs_os_track_alloc(sparse->alloc_tag, chunk_alloc_bytes(sparse), 0);
+    }
+
     ecs_os_free(chunk->sparse);
     ecs_os_free(chunk->data);
 }
@@ -104,6 +137,7 @@ void grow_dense(
     ecs_sparse_t *sparse)
 {
     ecs_vector_add(&sparse->dense, uint64_t);
+    track_alloc(sparse);
 }
 
 static
@@ -118,12 +152,13 @@ uint64_t strip_generation(
 
 static
 void assign_index(
+    ecs_sparse_t * sparse,
     chunk_t * chunk, 
     uint64_t * dense_array, 
     uint64_t index, 
     int32_t dense)
 {
-    chunk->sparse[OFFSET(index)] = dense;
+    chunk->sparse[OFFSET(sparse, index)] = dense;
     dense_array[dense] = index;
 }
 
@@ -164,11 +199,11 @@ uint64_t create_id(
     uint64_t index = inc_id(sparse);
     grow_dense(sparse);
 
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
-    ecs_assert(chunk->sparse[OFFSET(index)] == 0, ECS_INTERNAL_ERROR, NULL);
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
+    ecs_assert(chunk->sparse[OFFSET(sparse, index)] == 0, ECS_INTERNAL_ERROR, NULL);
     
     uint64_t *dense_array = ecs_vector_first(sparse->dense, uint64_t);
-    assign_index(chunk, dense_array, index, dense);
+    assign_index(sparse, chunk, dense_array, index, dense);
     
     return index;
 }
@@ -199,12 +234,12 @@ void* try_sparse_any(
 {    
     strip_generation(&index);
 
-    chunk_t *chunk = get_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_chunk(sparse, CHUNK(sparse, index));
     if (!chunk) {
         return NULL;
     }
 
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
     bool in_use = dense && (dense < sparse->count);
     if (!in_use) {
@@ -220,12 +255,12 @@ void* try_sparse(
     const ecs_sparse_t *sparse,
     uint64_t index)
 {
-    chunk_t *chunk = get_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_chunk(sparse, CHUNK(sparse, index));
     if (!chunk) {
         return NULL;
     }
 
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
     bool in_use = dense && (dense < sparse->count);
     if (!in_use) {
@@ -251,8 +286,8 @@ void* get_sparse(
     uint64_t index)
 {
     strip_generation(&index);
-    chunk_t *chunk = get_chunk(sparse, CHUNK(index));
-    int32_t offset = OFFSET(index);
+    chunk_t *chunk = get_chunk(sparse, CHUNK(sparse, index));
+    int32_t offset = OFFSET(sparse, index);
     
     ecs_assert(chunk != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(dense == chunk->sparse[offset], ECS_INTERNAL_ERROR, NULL);
@@ -272,9 +307,9 @@ void swap_dense(
     uint64_t index_a = dense_array[a];
     uint64_t index_b = dense_array[b];
 
-    chunk_t *chunk_b = get_or_create_chunk(sparse, CHUNK(index_b));
-    assign_index(chunk_a, dense_array, index_a, b);
-    assign_index(chunk_b, dense_array, index_b, a);
+    chunk_t *chunk_b = get_or_create_chunk(sparse, CHUNK(sparse, index_b));
+    assign_index(sparse, chunk_a, dense_array, index_a, b);
+    assign_index(sparse, chunk_b, dense_array, index_b, a);
 }
 
 ecs_sparse_t* _ecs_sparse_new(
@@ -283,6 +318,7 @@ ecs_sparse_t* _ecs_sparse_new(
     ecs_sparse_t *result = ecs_os_calloc(ECS_SIZEOF(ecs_sparse_t));
     ecs_assert(result != NULL, ECS_OUT_OF_MEMORY, NULL);
     result->size = size;
+    result->chunk_shift = CHUNK_SHIFT;
     result->max_id_local = UINT64_MAX;
     result->max_id = &result->max_id_local;
 
@@ -291,6 +327,8 @@ ecs_sparse_t* _ecs_sparse_new(
     ecs_vector_add(&result->dense, uint64_t);
     result->count = 1;
 
+    track_alloc(result);
+
     return result;
 }
 
@@ -302,13 +340,56 @@ void ecs_sparse_set_id_source(
     sparse->max_id = id_source;
 }
 
+void ecs_sparse_set_chunk_size(
+    ecs_sparse_t *sparse,
+    int32_t elem_count)
+{
+    ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(elem_count > 0, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!(elem_count & (elem_count - 1)), ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(sparse->chunks == NULL, ECS_INVALID_OPERATION, NULL);
+
+    int32_t shift = 0;
+    while ((1 << shift) < elem_count) {
+        shift ++;
+    }
+
+    sparse->chunk_shift = shift;
+}
+
+void ecs_sparse_set_alloc_tag(
+    ecs_sparse_t *sparse,
+    ecs_alloc_tag_t tag)
+{
+    ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(tag < EcsAllocTagCount, ECS_INVALID_PARAMETER, NULL);
+
+    if (tag == sparse->alloc_tag) {
+        return;
+    }
+
+    /* Move memory that was already reported to the new subsystem */
+    ecs_size_t bytes = sparse->alloc_bytes;
+    int32_t i, count = ecs_vector_count(sparse->chunks);
+    chunk_t *chunks = ecs_vector_first(sparse->chunks, chunk_t);
+    for (i = 0; i < count; i ++) {
+        if (chunks[i].sparse) {
+            bytes += chunk_alloc_bytes(sparse);
+        }
+    }
+
+    ecs_os_track_alloc(sparse->alloc_tag, bytes, 0);
+    ecs_os_track_alloc(tag, 0, bytes);
+    sparse->alloc_tag = tag;
+}
+
 void ecs_sparse_clear(
     ecs_sparse_t *sparse)
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
 
     ecs_vector_each(sparse->chunks, chunk_t, chunk, {
-        chunk_free(chunk);
+        chunk_free(sparse, chunk);
     });
 
     ecs_vector_free(sparse->chunks);
@@ -317,6 +398,8 @@ void ecs_sparse_clear(
     sparse->chunks = NULL;   
     sparse->count = 1;
     sparse->max_id_local = 0;
+
+    track_alloc(sparse);
 }
 
 void ecs_sparse_free(
@@ -325,6 +408,7 @@ void ecs_sparse_free(
     if (sparse) {
         ecs_sparse_clear(sparse);
         ecs_vector_free(sparse->dense);
+        ecs_os_track_alloc(sparse->alloc_tag, sparse->alloc_bytes, 0);
         ecs_os_free(sparse);
     }
 }
@@ -368,9 +452,9 @@ void* _ecs_sparse_add(
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
     ecs_assert(!size || size == sparse->size, ECS_INVALID_PARAMETER, NULL);
     uint64_t index = new_index(sparse);
-    chunk_t *chunk = get_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_chunk(sparse, CHUNK(sparse, index));
     ecs_assert(chunk != NULL, ECS_INTERNAL_ERROR, NULL);
-    return DATA(chunk->data, size, OFFSET(index));
+    return DATA(chunk->data, size, OFFSET(sparse, index));
 }
 
 uint64_t ecs_sparse_last_id(
@@ -391,8 +475,8 @@ void* _ecs_sparse_get_or_create(
     ecs_assert(ecs_vector_count(sparse->dense) > 0, ECS_INTERNAL_ERROR, NULL);
 
     uint64_t gen = strip_generation(&index);
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
-    int32_t offset = OFFSET(index);
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
 
     if (dense) {
@@ -430,11 +514,11 @@ void* _ecs_sparse_get_or_create(
             /* If there are unused elements in the list, move the first unused
              * element to the end of the list */
             uint64_t unused = dense_array[count];
-            chunk_t *unused_chunk = get_or_create_chunk(sparse, CHUNK(unused));
-            assign_index(unused_chunk, dense_array, unused, dense_count);
+            chunk_t *unused_chunk = get_or_create_chunk(sparse, CHUNK(sparse, unused));
+            assign_index(sparse, unused_chunk, dense_array, unused, dense_count);
         }
 
-        assign_index(chunk, dense_array, index, count);
+        assign_index(sparse, chunk, dense_array, index, count);
         dense_array[count] |= gen;
     }
 
@@ -459,9 +543,9 @@ void* _ecs_sparse_remove_get(
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
     ecs_assert(!size || size == sparse->size, ECS_INVALID_PARAMETER, NULL);
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
     uint64_t gen = strip_generation(&index);
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
 
     if (dense) {
@@ -512,11 +596,11 @@ void ecs_sparse_set_generation(
     uint64_t index)
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
     
     uint64_t index_w_gen = index;
     strip_generation(&index);
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
 
     if (dense) {
@@ -533,10 +617,10 @@ bool ecs_sparse_exists(
     uint64_t index)
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
-    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(index));
+    chunk_t *chunk = get_or_create_chunk(sparse, CHUNK(sparse, index));
     
     strip_generation(&index);
-    int32_t offset = OFFSET(index);
+    int32_t offset = OFFSET(sparse, index);
     int32_t dense = chunk->sparse[offset];
 
     return dense != 0;
@@ -619,6 +703,7 @@ void ecs_sparse_set_size(
 {
     ecs_assert(sparse != NULL, ECS_INVALID_PARAMETER, NULL);
     ecs_vector_set_size(&sparse->dense, uint64_t, elem_count);
+    track_alloc(sparse);
 }
 
 static
@@ -653,6 +738,8 @@ ecs_sparse_t* ecs_sparse_copy(
     }
 
     ecs_sparse_t *dst = _ecs_sparse_new(src->size);
+    dst->chunk_shift = src->chunk_shift;
+    ecs_sparse_set_alloc_tag(dst, src->alloc_tag);
     sparse_copy(dst, src);
 
     return dst;
@@ -1,9 +1,15 @@
 #include "private_api.h"
 
-static
-ecs_op_t* new_defer_op(ecs_stage_t *stage) {
+ecs_op_t* ecs_stage_new_defer_op(
+    ecs_stage_t *stage) 
+{
+    ecs_size_t size = ecs_vector_size(stage->defer_queue);
     ecs_op_t *result = ecs_vector_add(&stage->defer_queue, ecs_op_t);
     ecs_os_memset(result, 0, ECS_SIZEOF(ecs_op_t));
+
+    ecs_os_track_alloc(EcsAllocDefer, size * ECS_SIZEOF(ecs_op_t), 
+        ecs_vector_size(stage->defer_queue) * ECS_SIZEOF(ecs_op_t));
+
     return result;
 }
 
@@ -23,6 +29,7 @@ void new_defer_component_ids(
     } else if (components_count) {
         ecs_size_t array_size = components_count * ECS_SIZEOF(ecs_entity_t);
         op->components.array = ecs_os_malloc(array_size);
+        ecs_os_track_alloc(EcsAllocDefer, 0, array_size);
         ecs_os_memcpy(op->components.array, components->array, array_size);
         op->components.count = components_count;
     } else {
@@ -46,7 +53,7 @@ bool defer_add_remove(
             }
         }
 
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = op_kind;
         op->scope = scope;
         op->is._1.entity = entity;
@@ -78,7 +85,7 @@ bool ecs_defer_modified(
 {
     (void)world;
     if (stage->defer) {
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpModified;
         op->component = component;
         op->is._1.entity = entity;
@@ -90,6 +97,27 @@ bool ecs_defer_modified(
     return false;
 }
 
+bool ecs_defer_enable(
+    ecs_world_t *world,
+    ecs_stage_t *stage,
+    ecs_entity_t entity,
+    ecs_entity_t component,
+    bool enable)
+{
+    (void)world;
+    if (stage->defer) {
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
+        op->kind = enable ? EcsOpEnable : EcsOpDisable;
+        op->component = component;
+        op->is._1.entity = entity;
+        return true;
+    } else {
+        stage->defer ++;
+    }
+    
+    return false;
+}
+
 bool ecs_defer_clone(
     ecs_world_t *world,
     ecs_stage_t *stage,
@@ -99,7 +127,7 @@ bool ecs_defer_clone(
 {   
     (void)world;
     if (stage->defer) {
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpClone;
         op->component = src;
         op->is._1.entity = entity;
@@ -119,7 +147,7 @@ bool ecs_defer_delete(
 {
     (void)world;
     if (stage->defer) {
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpDelete;
         op->is._1.entity = entity;
         return true;
@@ -136,7 +164,7 @@ bool ecs_defer_clear(
 {
     (void)world;
     if (stage->defer) {
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpClear;
         op->is._1.entity = entity;
         return true;
@@ -201,7 +229,7 @@ bool ecs_defer_bulk_new(
         }
 
         /* Store data in op */
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = EcsOpBulkNew;
         op->is._n.entities = ids;
         op->is._n.bulk_data = defer_data;
@@ -265,12 +293,13 @@ bool ecs_defer_set(
             size = cptr->size;
         }
 
-        ecs_op_t *op = new_defer_op(stage);
+        ecs_op_t *op = ecs_stage_new_defer_op(stage);
         op->kind = op_kind;
         op->component = component;
         op->is._1.entity = entity;
         op->is._1.size = size;
         op->is._1.value = ecs_os_malloc(size);
+        ecs_os_track_alloc(EcsAllocDefer, 0, size);
 
         if (!value) {
             value = ecs_get_w_entity(world, entity, component);
@@ -327,7 +356,9 @@ void ecs_stage_merge(
         ecs_defer_flush(world, stage);
         ecs_vector_clear(stage->defer_merge_queue);
         ecs_assert(stage->defer_queue == NULL, ECS_INVALID_PARAMETER, NULL);
-    }    
+    }
+
+    ecs_os_merge_alloc_tags(stage->alloc_tags);
 }
 
 void ecs_stage_defer_begin(
@@ -383,7 +414,11 @@ void ecs_stage_deinit(
     ecs_stage_t *stage)
 {
     (void)world;
+    ecs_os_track_alloc(EcsAllocDefer, ECS_SIZEOF(ecs_op_t) * (
+        ecs_vector_size(stage->defer_queue) + 
+        ecs_vector_size(stage->defer_merge_queue)), 0);
     ecs_vector_free(stage->defer_queue);
     ecs_vector_free(stage->defer_merge_queue);
+    ecs_os_merge_alloc_tags(stage->alloc_tags);
 }
 
@@ -1,5 +1,38 @@
 #include "private_api.h"
 
+/* Number of field columns for a component column */
+static
+int32_t soa_field_count(
+    ecs_table_t *table,
+    int32_t column)
+{
+    ecs_c_info_t *c_info;
+    if (!table->c_info || !(c_info = table->c_info[column])) {
+        return 0;
+    }
+
+    return ecs_vector_count(c_info->fields);
+}
+
+int32_t ecs_table_soa_column_index(
+    ecs_table_t *table,
+    int32_t column)
+{
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(column < table->column_count, ECS_INTERNAL_ERROR, NULL);
+
+    if (!table->soa_column_count || !soa_field_count(table, column)) {
+        return -1;
+    }
+
+    int32_t i, result = 0;
+    for (i = 0; i < column; i ++) {
+        result += soa_field_count(table, i);
+    }
+
+    return result;
+}
+
 ecs_data_t* ecs_init_data(
     ecs_world_t *world,
     ecs_table_t *table,
@@ -7,9 +40,10 @@ ecs_data_t* ecs_init_data(
 {
     ecs_type_t type = table->type; 
     int32_t i, count = table->column_count, sw_count = table->sw_column_count;
+    int32_t bs_count = table->bs_column_count;
 
     /* Root tables don't have columns */
-    if (!count && !sw_count) {
+    if (!count && !sw_count && !bs_count) {
         result->columns = NULL;
         return result;
     }
@@ -30,6 +64,11 @@ ecs_data_t* ecs_init_data(
         for (i = 0; i < count; i ++) {
             ecs_entity_t e = entities[i];
 
+            /* Is the column stored as a structure of arrays? */
+            if (soa_field_count(table, i)) {
+                continue;
+            }
+
             /* Is the column a component? */
             const EcsComponent *component = ecs_component_from_id(world, e);
             if (component) {
@@ -76,6 +115,56 @@ ecs_data_t* ecs_init_data(
         }
     }
 
+    if (bs_count) {
+        result->bs_columns = ecs_os_calloc(ECS_SIZEOF(ecs_bs_column_t) * bs_count);
+        for (i = 0; i < bs_count; i ++) {
+            ecs_bitset_init(&result->bs_columns[i].data);
+        }
+    }
+
+    int32_t soa_count = table->soa_column_count;
+    if (soa_count) {
+        result->soa_columns = ecs_os_calloc(ECS_SIZEOF(ecs_column_t) * soa_count);
+
+        int32_t soa_index = 0;
+        for (i = 0; i < count; i ++) {
+            if (!soa_field_count(table, i)) {
+                continue;
+            }
+
+            ecs_vector_each(table->c_info[i]->fields, ecs_field_t, field, {
+                ecs_column_t *column = &result->soa_columns[soa_index ++];
+                ecs_size_t size = field->size;
+
+                /* Fields have no type information, so derive the alignment
+                 * from the largest power of two that divides the size */
+                ecs_size_t alignment = size & -size;
+                if (alignment > 16) {
+                    alignment = 16;
+                }
+
+                column->size = ecs_to_i16(size);
+                column->alignment = ecs_to_i16(alignment);
+            });
+        }
+
+        ecs_assert(soa_index == soa_count, ECS_INTERNAL_ERROR, NULL);
+    }
+
+    /* Double buffered columns have a second column with the same layout. The
+     * array is indexed by column, other columns in the array stay empty. */
+    if (table->flags & EcsTableHasPrev) {
+        result->prev_columns = ecs_os_calloc(ECS_SIZEOF(ecs_column_t) * count);
+
+        for (i = 0; i < count; i ++) {
+            ecs_c_info_t *c_info = table->c_info[i];
+            if (c_info && c_info->double_buffered) {
+                result->prev_columns[i].size = result->columns[i].size;
+                result->prev_columns[i].alignment = result->columns[i].alignment;
+            }
+        }
+    }
+
     return result;
 }
 
@@ -147,7 +236,9 @@ void notify_component_info(
         }
 
         /* Reset lifecycle flags before recomputing */
-        table->flags &= ~EcsTableHasLifecycle;
+        ecs_flags32_t had_prev = table->flags & EcsTableHasPrev;
+        table->flags &= ~(EcsTableHasLifecycle | EcsTableHasSoa | EcsTableHasPrev);
+        int32_t soa_column_count = 0;
 
         /* Recompute lifecycle flags */
         ecs_entity_t *array = ecs_vector_first(table_type, ecs_entity_t);
@@ -166,7 +257,30 @@ void notify_component_info(
 
             /* Store pointer to c_info for fast access */
             table->c_info[i] = c_info;
-        }        
+
+            if (c_info && c_info->fields && i < table->column_count) {
+                soa_column_count += ecs_vector_count(c_info->fields);
+            }
+
+            if (c_info && c_info->double_buffered && i < table->column_count) {
+                table->flags |= EcsTableHasPrev;
+            }
+        }
+
+        if (soa_column_count) {
+            table->flags |= EcsTableHasSoa;
+        }
+
+        /* If a component got fields or was made double buffered after the 
+         * table was created, the table is empty and can be reinitialized with
+         * the new layout */
+        if (soa_column_count != table->soa_column_count || 
+            had_prev != (table->flags & EcsTableHasPrev)) 
+        {
+            ecs_assert(!ecs_table_count(table), ECS_INTERNAL_ERROR, NULL);
+            ecs_table_clear_data(table, table->data);
+            table->soa_column_count = soa_column_count;
+        }
     }
 }
 
@@ -378,6 +492,11 @@ void ecs_table_activate(
     ecs_query_t *query,
     bool activate)
 {
+    /* Table is no longer empty, reset garbage collection counter */
+    if (activate) {
+        table->gc_frame = 0;
+    }
+
     if (query) {
         ecs_query_notify(world, query, &(ecs_query_event_t) {
             .kind = activate ? EcsQueryTableNonEmpty : EcsQueryTableEmpty,
@@ -472,6 +591,57 @@ void unregister_query(
     }
 }
 
+/* Remove a query from a list of matched queries. The order of the remaining
+ * elements is preserved, as some lists are sorted. */
+static
+void remove_matched_query(
+    ecs_vector_t **array,
+    ecs_query_t *query)
+{
+    ecs_matched_query_t *elems = ecs_vector_first(*array, ecs_matched_query_t);
+    int32_t i, count = ecs_vector_count(*array), keep = 0;
+    for (i = 0; i < count; i ++) {
+        if (elems[i].query != query) {
+            elems[keep ++] = elems[i];
+        }
+    }
+
+    if (keep != count) {
+        ecs_vector_set_count(array, ecs_matched_query_t, keep);
+    }
+}
+
+/* This function is called when a query is freed. The query is removed from all
+ * lists of the table, including the lists of OnSet and UnSet systems. */
+static
+void free_query(
+    ecs_world_t *world,
+    ecs_table_t *table,
+    ecs_query_t *query)
+{
+    (void)world;
+
+    int32_t i, count = ecs_vector_count(table->queries);
+    ecs_query_t **queries = ecs_vector_first(table->queries, ecs_query_t*);
+    for (i = 0; i < count; i ++) {
+        if (queries[i] == query) {
+            ecs_vector_remove_index(table->queries, ecs_query_t*, i);
+            break;
+        }
+    }
+
+    remove_matched_query(&table->monitors, query);
+    remove_matched_query(&table->on_set_all, query);
+    remove_matched_query(&table->on_set_override, query);
+    remove_matched_query(&table->un_set_all, query);
+
+    if (table->on_set) {
+        for (i = 0; i < table->column_count; i ++) {
+            remove_matched_query(&table->on_set[i], query);
+        }
+    }
+}
+
 static
 ecs_data_t* get_data_intern(
     ecs_table_t *table,
@@ -615,11 +785,197 @@ void ecs_table_clear_data(
         data->sw_columns = NULL;
     }
 
+    ecs_bs_column_t *bs_columns = data->bs_columns;
+    if (bs_columns) {
+        int32_t c, column_count = table->bs_column_count;
+        for (c = 0; c < column_count; c ++) {
+            ecs_bitset_deinit(&bs_columns[c].data);
+        }
+        ecs_os_free(bs_columns);
+        data->bs_columns = NULL;
+    }
+
+    ecs_column_t *soa_columns = data->soa_columns;
+    if (soa_columns) {
+        int32_t c, column_count = table->soa_column_count;
+        for (c = 0; c < column_count; c ++) {
+            ecs_vector_free(soa_columns[c].data);
+        }
+        ecs_os_free(soa_columns);
+        data->soa_columns = NULL;
+    }
+
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (prev_columns) {
+        int32_t c, column_count = table->column_count;
+        for (c = 0; c < column_count; c ++) {
+            ecs_vector_free(prev_columns[c].data);
+        }
+        ecs_os_free(prev_columns);
+        data->prev_columns = NULL;
+    }
+
     ecs_vector_free(data->entities);
     ecs_vector_free(data->record_ptrs);
 
     data->entities = NULL;
     data->record_ptrs = NULL;
+
+    ecs_table_track_alloc(table);
+    ecs_table_sync_stats(table);
+}
+
+ecs_size_t ecs_table_data_alloc_bytes(
+    ecs_table_t *table,
+    ecs_data_t *data)
+{
+    ecs_size_t result = 
+        ecs_vector_size(data->entities) * ECS_SIZEOF(ecs_entity_t) +
+        ecs_vector_size(data->record_ptrs) * ECS_SIZEOF(ecs_record_t*);
+
+    ecs_column_t *columns = data->columns;
+    if (columns) {
+        int32_t c, column_count = table->column_count;
+        for (c = 0; c < column_count; c ++) {
+            result += ecs_vector_size(columns[c].data) * columns[c].size;
+        }
+
+        /* Tables with switch columns store the case values as columns */
+        if (table->sw_column_count) {
+            column_count = ecs_vector_count(table->type);
+        }
+
+        result += column_count * ECS_SIZEOF(ecs_column_t);
+    }
+
+    ecs_bs_column_t *bs_columns = data->bs_columns;
+    if (bs_columns) {
+        int32_t c, column_count = table->bs_column_count;
+        for (c = 0; c < column_count; c ++) {
+            result += bs_columns[c].data.size / 8;
+        }
+    }
+
+    ecs_column_t *soa_columns = data->soa_columns;
+    if (soa_columns) {
+        int32_t c, column_count = table->soa_column_count;
+        for (c = 0; c < column_count; c ++) {
+            result += ecs_vector_size(soa_columns[c].data) * soa_columns[c].size;
+        }
+
+        result += column_count * ECS_SIZEOF(ecs_column_t);
+    }
+
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (prev_columns) {
+        int32_t c, column_count = table->column_count;
+        for (c = 0; c < column_count; c ++) {
+            result += ecs_vector_size(prev_columns[c].data) * prev_columns[c].size;
+        }
+
+        result += column_count * ECS_SIZEOF(ecs_column_t);
+    }
+
+    return result;
+}
+
+void ecs_table_track_alloc(
+    ecs_table_t *table)
+{
+    ecs_size_t bytes = 0;
+    if (table->data) {
+        bytes = ecs_table_data_alloc_bytes(table, table->data);
+    }
+
+    ecs_os_track_alloc(EcsAllocColumns, table->alloc_bytes, bytes);
+    table->alloc_bytes = bytes;
+}
+
+void ecs_table_register_stats(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    ecs_map_t *component_stats = world->component_stats;
+    int32_t c, column_count = table->column_count;
+    if (!component_stats || !column_count || table->column_stats) {
+        return;
+    }
+
+    ecs_entity_t *components = ecs_vector_first(table->type, ecs_entity_t);
+    ecs_column_stats_t *column_stats = ecs_os_calloc(
+        ECS_SIZEOF(ecs_column_stats_t) * column_count);
+
+    for (c = 0; c < column_count; c ++) {
+        ecs_component_stats_t *stats = ecs_map_get_ptr(
+            component_stats, ecs_component_stats_t*, components[c]);
+        if (!stats) {
+            stats = ecs_os_calloc(ECS_SIZEOF(ecs_component_stats_t));
+            ecs_map_set(component_stats, components[c], &stats);
+        }
+
+        stats->tables_count ++;
+        column_stats[c].stats = stats;
+    }
+
+    table->column_stats = column_stats;
+
+    ecs_table_sync_stats(table);
+}
+
+void ecs_table_unregister_stats(
+    ecs_table_t *table)
+{
+    ecs_column_stats_t *column_stats = table->column_stats;
+    if (!column_stats) {
+        return;
+    }
+
+    int32_t c, column_count = table->column_count;
+    for (c = 0; c < column_count; c ++) {
+        ecs_component_stats_t *stats = column_stats[c].stats;
+        stats->tables_count --;
+        stats->entities_count -= column_stats[c].count;
+        stats->used_bytes -= column_stats[c].used_bytes;
+        stats->allocd_bytes -= column_stats[c].allocd_bytes;
+    }
+
+    ecs_os_free(column_stats);
+    table->column_stats = NULL;
+}
+
+void ecs_table_sync_stats(
+    ecs_table_t *table)
+{
+    ecs_column_stats_t *column_stats = table->column_stats;
+    if (!column_stats) {
+        return;
+    }
+
+    ecs_data_t *data = table->data;
+    ecs_column_t *columns = data ? data->columns : NULL;
+
+    /* Only apply the difference with the values that were accounted for the
+     * last time, so that the cost does not depend on the number of tables */
+    int32_t c, column_count = table->column_count;
+    for (c = 0; c < column_count; c ++) {
+        ecs_column_stats_t *cs = &column_stats[c];
+        int32_t count = 0, used_bytes = 0, allocd_bytes = 0;
+
+        if (columns) {
+            ecs_column_t *column = &columns[c];
+            count = ecs_vector_count(column->data);
+            ecs_vector_memory_t(column->data, column->size, column->alignment,
+                &allocd_bytes, &used_bytes);
+        }
+
+        ecs_component_stats_t *stats = cs->stats;
+        stats->entities_count += count - cs->count;
+        stats->used_bytes += used_bytes - cs->used_bytes;
+        stats->allocd_bytes += allocd_bytes - cs->allocd_bytes;
+        cs->count = count;
+        cs->used_bytes = used_bytes;
+        cs->allocd_bytes = allocd_bytes;
+    }
 }
 
 /* Clear columns. Deactivate table in systems if necessary, but do not invoke
@@ -635,6 +991,9 @@ void ecs_table_clear_silent(
     }
 
     int32_t count = ecs_vector_count(data->entities);
+
+    /* Entities in the table could be bases */
+    ecs_table_invalidate_base_cache(world, table);
     
     ecs_table_clear_data(table, table->data);
 
@@ -655,6 +1014,10 @@ void ecs_table_clear(
         run_remove_actions(
             world, table, data, 0, ecs_table_data_count(data), false);
 
+        /* Entities in the table could be bases, invalidate before the entities
+         * are removed from the entity index */
+        ecs_table_invalidate_base_cache(world, table);
+
         ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
         int32_t i, count = ecs_vector_count(data->entities);
         for(i = 0; i < count; i ++) {
@@ -691,11 +1054,18 @@ void ecs_table_free(
             world, table, data, 0, ecs_table_data_count(data), false);
     }
 
+    ecs_table_unregister_stats(table);
     ecs_table_clear_data(table, table->data);
     ecs_table_clear_edges(table);
+
+    if (table->lo_edges) {
+        ecs_os_track_alloc(EcsAllocEdges, 
+            ECS_SIZEOF(ecs_edge_t) * ECS_HI_COMPONENT_ID, 0);
+    }
     
     ecs_os_free(table->lo_edges);
     ecs_map_free(table->hi_edges);
+    ecs_map_free(table->base_cache);
     ecs_vector_free(table->queries);
     ecs_vector_free((ecs_vector_t*)table->type);
     ecs_os_free(table->dirty_state);
@@ -807,6 +1177,168 @@ void move_switch_columns(
     }
 }
 
+static
+void move_bitset_columns(
+    ecs_table_t * new_table, 
+    ecs_data_t * new_data, 
+    int32_t new_index,
+    ecs_table_t * old_table, 
+    ecs_data_t * old_data, 
+    int32_t old_index,
+    int32_t count)
+{
+    int32_t i_old = 0, old_column_count = old_table->bs_column_count;
+    int32_t i_new = 0, new_column_count = new_table->bs_column_count;
+
+    if (!old_column_count || !new_column_count) {
+        return;
+    }
+
+    ecs_bs_column_t *old_columns = old_data->bs_columns;
+    ecs_bs_column_t *new_columns = new_data->bs_columns;
+
+    ecs_type_t new_type = new_table->type;
+    ecs_type_t old_type = old_table->type;
+
+    int32_t offset_new = new_table->bs_column_offset;
+    int32_t offset_old = old_table->bs_column_offset;
+
+    ecs_entity_t *new_components = ecs_vector_first(new_type, ecs_entity_t);
+    ecs_entity_t *old_components = ecs_vector_first(old_type, ecs_entity_t);
+
+    for (; (i_new < new_column_count) && (i_old < old_column_count);) {
+        ecs_entity_t new_component = new_components[i_new + offset_new];
+        ecs_entity_t old_component = old_components[i_old + offset_old];
+
+        if (new_component == old_component) {
+            ecs_bitset_t *old_bs = &old_columns[i_old].data;
+            ecs_bitset_t *new_bs = &new_columns[i_new].data;
+
+            ecs_bitset_ensure(new_bs, new_index + count);
+
+            int i;
+            for (i = 0; i < count; i ++) {
+                bool value = ecs_bitset_get(old_bs, old_index + i);
+                ecs_bitset_set(new_bs, new_index + i, value);
+            }
+        }
+
+        i_new += new_component <= old_component;
+        i_old += new_component >= old_component;
+    }
+}
+
+static
+void move_soa_columns(
+    ecs_table_t * new_table, 
+    ecs_data_t * new_data, 
+    int32_t new_index,
+    ecs_table_t * old_table, 
+    ecs_data_t * old_data, 
+    int32_t old_index,
+    int32_t count)
+{
+    if (!old_table->soa_column_count || !new_table->soa_column_count) {
+        return;
+    }
+
+    ecs_column_t *old_columns = old_data->soa_columns;
+    ecs_column_t *new_columns = new_data->soa_columns;
+
+    ecs_entity_t *new_components = ecs_vector_first(new_table->type, ecs_entity_t);
+    ecs_entity_t *old_components = ecs_vector_first(old_table->type, ecs_entity_t);
+
+    int32_t i_new = 0, new_column_count = new_table->column_count;
+    int32_t i_old = 0, old_column_count = old_table->column_count;
+    int32_t soa_new = 0, soa_old = 0;
+
+    for (; (i_new < new_column_count) && (i_old < old_column_count);) {
+        ecs_entity_t new_component = new_components[i_new];
+        ecs_entity_t old_component = old_components[i_old];
+        int32_t new_fields = soa_field_count(new_table, i_new);
+        int32_t old_fields = soa_field_count(old_table, i_old);
+
+        if (new_component == old_component) {
+            ecs_assert(new_fields == old_fields, ECS_INTERNAL_ERROR, NULL);
+
+            int32_t f;
+            for (f = 0; f < new_fields; f ++) {
+                ecs_column_t *new_column = &new_columns[soa_new + f];
+                ecs_column_t *old_column = &old_columns[soa_old + f];
+                int16_t size = new_column->size;
+                int16_t alignment = new_column->alignment;
+
+                void *dst = ecs_vector_get_t(
+                    new_column->data, size, alignment, new_index);
+                void *src = ecs_vector_get_t(
+                    old_column->data, size, alignment, old_index);
+
+                ecs_assert(dst != NULL, ECS_INTERNAL_ERROR, NULL);
+                ecs_assert(src != NULL, ECS_INTERNAL_ERROR, NULL);
+                ecs_os_memcpy(dst, src, size * count);
+            }
+        }
+
+        if (new_component <= old_component) {
+            soa_new += new_fields;
+            i_new ++;
+        }
+        if (new_component >= old_component) {
+            soa_old += old_fields;
+            i_old ++;
+        }
+    }
+}
+
+static
+void move_prev_columns(
+    ecs_table_t * new_table, 
+    ecs_data_t * new_data, 
+    int32_t new_index,
+    ecs_table_t * old_table, 
+    ecs_data_t * old_data, 
+    int32_t old_index,
+    int32_t count)
+{
+    ecs_column_t *old_columns = old_data->prev_columns;
+    ecs_column_t *new_columns = new_data->prev_columns;
+    if (!old_columns || !new_columns) {
+        return;
+    }
+
+    ecs_entity_t *new_components = ecs_vector_first(new_table->type, ecs_entity_t);
+    ecs_entity_t *old_components = ecs_vector_first(old_table->type, ecs_entity_t);
+
+    int32_t i_new = 0, new_column_count = new_table->column_count;
+    int32_t i_old = 0, old_column_count = old_table->column_count;
+
+    for (; (i_new < new_column_count) && (i_old < old_column_count);) {
+        ecs_entity_t new_component = new_components[i_new];
+        ecs_entity_t old_component = old_components[i_old];
+
+        if (new_component == old_component) {
+            ecs_column_t *new_column = &new_columns[i_new];
+            ecs_column_t *old_column = &old_columns[i_old];
+            int16_t size = new_column->size;
+
+            if (size && old_column->size) {
+                int16_t alignment = new_column->alignment;
+                void *dst = ecs_vector_get_t(
+                    new_column->data, size, alignment, new_index);
+                void *src = ecs_vector_get_t(
+                    old_column->data, size, alignment, old_index);
+
+                ecs_assert(dst != NULL, ECS_INTERNAL_ERROR, NULL);
+                ecs_assert(src != NULL, ECS_INTERNAL_ERROR, NULL);
+                ecs_os_memcpy(dst, src, size * count);
+            }
+        }
+
+        i_new += new_component <= old_component;
+        i_old += new_component >= old_component;
+    }
+}
+
 static
 void ensure_data(
     ecs_world_t * world,
@@ -819,16 +1351,17 @@ void ensure_data(
 {
     int32_t column_count = table->column_count;
     int32_t sw_column_count = table->sw_column_count;
+    int32_t bs_column_count = table->bs_column_count;
     ecs_column_t *columns = NULL;
     ecs_sw_column_t *sw_columns = NULL;
 
     /* It is possible that the table data was created without content. 
      * Now that data is going to be written to the table, initialize */ 
-    if (column_count | sw_column_count) {
+    if (column_count | sw_column_count | bs_column_count) {
         columns = data->columns;
         sw_columns = data->sw_columns;
 
-        if (!columns && !sw_columns) {
+        if (!columns && !sw_columns && !data->bs_columns) {
             ecs_init_data(world, table, data);
             columns = data->columns;
             sw_columns = data->sw_columns;
@@ -915,6 +1448,41 @@ void grow_column(
         ECS_INTERNAL_ERROR, NULL);
 }
 
+/* Add elements to double buffered columns. Entities that are added to the
+ * table have no value for the previous frame, so new elements are zero'd. */
+static
+void grow_prev_columns(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_data_t * data,
+    int32_t to_add,
+    int32_t size)
+{
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (!prev_columns) {
+        return;
+    }
+
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+    int32_t i, column_count = table->column_count;
+    for (i = 0; i < column_count; i ++) {
+        ecs_column_t *column = &prev_columns[i];
+        int16_t size_elem = column->size;
+        if (!size_elem) {
+            continue;
+        }
+
+        grow_column(world, entities, column, NULL, to_add, size, false);
+
+        if (to_add) {
+            int32_t count = ecs_vector_count(column->data);
+            void *elem = ecs_vector_get_t(
+                column->data, size_elem, column->alignment, count - to_add);
+            ecs_os_memset(elem, 0, size_elem * to_add);
+        }
+    }
+}
+
 static
 int32_t grow_data(
     ecs_world_t * world,
@@ -985,6 +1553,22 @@ int32_t grow_data(
         ecs_switch_addn(sw, to_add);
     }
 
+    /* Add elements to each bitset column */
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_addn(&data->bs_columns[i].data, to_add);
+    }
+
+    /* Add elements to each field column */
+    int32_t soa_column_count = table->soa_column_count;
+    for (i = 0; i < soa_column_count; i ++) {
+        grow_column(world, entities, &data->soa_columns[i], NULL, to_add, 
+            size, false);
+    }
+
+    /* Add elements to each double buffered column */
+    grow_prev_columns(world, table, data, to_add, size);
+
     /* If the table is monitored indicate that there has been a change */
     mark_table_dirty(table, 0);
 
@@ -993,6 +1577,8 @@ int32_t grow_data(
     }
 
     table->alloc_count ++;
+    ecs_table_track_alloc(table);
+    ecs_table_sync_stats(table);
 
     /* Return index of first added entity */
     return cur_count;
@@ -1026,6 +1612,8 @@ int32_t ecs_table_append(
     ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    world->stats.table_append_count_total ++;
+
     /* Get count & size before growing entities array. This tells us whether the
      * arrays will realloc */
     int32_t count = ecs_vector_count(data->entities);
@@ -1045,7 +1633,8 @@ int32_t ecs_table_append(
 
     /* Keep track of alloc count. This allows references to check if cached
      * pointers need to be updated. */  
-    table->alloc_count += (count == size);
+    bool realloc = count == size;
+    table->alloc_count += realloc;
 
     /* Add record ptr to array with record ptrs */
     ecs_record_t **r = ecs_vector_add(&data->record_ptrs, ecs_record_t*);
@@ -1066,6 +1655,10 @@ int32_t ecs_table_append(
     /* Fast path: no switch columns, no lifecycle actions */
     if (!(table->flags & EcsTableIsComplex)) {
         fast_append(columns, column_count);
+        if (realloc) {
+            ecs_table_track_alloc(table);
+        }
+        ecs_table_sync_stats(table);
         return count;
     }
 
@@ -1109,6 +1702,28 @@ int32_t ecs_table_append(
         columns[i + table->sw_column_offset].data = ecs_switch_values(sw);
     }
 
+    /* Add element to each bitset column */
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_addn(&data->bs_columns[i].data, 1);
+    }
+
+    /* Add element to each field column */
+    int32_t soa_column_count = table->soa_column_count;
+    for (i = 0; i < soa_column_count; i ++) {
+        grow_column(world, entities, &data->soa_columns[i], NULL, 1, size, 
+            false);
+    }
+
+    /* Add element to each double buffered column */
+    grow_prev_columns(world, table, data, 1, size);
+
+    if (realloc) {
+        ecs_table_track_alloc(table);
+    }
+
+    ecs_table_sync_stats(table);
+
     return count;
 }
 
@@ -1152,6 +1767,8 @@ void ecs_table_delete(
     ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    world->stats.table_remove_count_total ++;
+
     ecs_vector_t *entity_column = data->entities;
     int32_t count = ecs_vector_count(entity_column);
 
@@ -1210,6 +1827,7 @@ void ecs_table_delete(
         } else {
             fast_delete(columns, column_count, index);
         }
+        ecs_table_sync_stats(table);
         return;
     }
 
@@ -1264,6 +1882,33 @@ void ecs_table_delete(
     for (i = 0; i < sw_column_count; i ++) {
         ecs_switch_remove(sw_columns[i].data, index);
     }
+
+    /* Remove elements from bitset columns */
+    ecs_bs_column_t *bs_columns = data->bs_columns;
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_remove(&bs_columns[i].data, index);
+    }
+
+    /* Move last element of field columns to index */
+    ecs_column_t *soa_columns = data->soa_columns;
+    int32_t soa_column_count = table->soa_column_count;
+    if (index == count) {
+        fast_delete_last(soa_columns, soa_column_count);
+    } else {
+        fast_delete(soa_columns, soa_column_count, index);
+    }
+
+    /* Move last element of double buffered columns to index */
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (prev_columns) {
+        if (index == count) {
+            fast_delete_last(prev_columns, column_count);
+        } else {
+            fast_delete(prev_columns, column_count, index);
+        }
+    }
+    ecs_table_sync_stats(table);
 }
 
 static
@@ -1325,6 +1970,8 @@ void ecs_table_move(
     ecs_assert(new_table != NULL, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(old_table != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    world->stats.table_move_count_total ++;
+
     ecs_assert(old_index >= 0, ECS_INTERNAL_ERROR, NULL);
     ecs_assert(new_index >= 0, ECS_INTERNAL_ERROR, NULL);
 
@@ -1339,6 +1986,15 @@ void ecs_table_move(
     move_switch_columns(
         new_table, new_data, new_index, old_table, old_data, old_index, 1);
 
+    move_bitset_columns(
+        new_table, new_data, new_index, old_table, old_data, old_index, 1);
+
+    move_soa_columns(
+        new_table, new_data, new_index, old_table, old_data, old_index, 1);
+
+    move_prev_columns(
+        new_table, new_data, new_index, old_table, old_data, old_index, 1);
+
     bool same_entity = dst_entity == src_entity;
 
     ecs_type_t new_type = new_table->type;
@@ -1438,6 +2094,7 @@ int32_t ecs_table_appendn(
     const ecs_entity_t *ids)
 {
     int32_t cur_count = ecs_table_data_count(data);
+    world->stats.table_append_count_total += to_add;
     return grow_data(world, table, data, to_add, cur_count + to_add, ids);
 }
 
@@ -1460,6 +2117,8 @@ void ecs_table_set_size(
         ecs_sw_column_t *sw_columns;
         ensure_data(world, table, data, &column_count, &sw_column_count, 
             &columns, &sw_columns);
+        ecs_table_track_alloc(table);
+        ecs_table_sync_stats(table);
     }
 }
 
@@ -1539,10 +2198,223 @@ void ecs_table_swap(
         }
     }
 
+    /* Swap bitset columns */
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_swap(&data->bs_columns[i].data, row_1, row_2);
+    }
+
+    /* Swap field columns */
+    int32_t soa_column_count = table->soa_column_count;
+    for (i = 0; i < soa_column_count; i ++) {
+        ecs_column_t *column = &data->soa_columns[i];
+        int16_t size = column->size;
+        void *ptr = ecs_vector_first_t(column->data, size, column->alignment);
+        void *tmp = ecs_os_alloca(size);
+
+        void *el_1 = ECS_OFFSET(ptr, size * row_1);
+        void *el_2 = ECS_OFFSET(ptr, size * row_2);
+
+        ecs_os_memcpy(tmp, el_1, size);
+        ecs_os_memcpy(el_1, el_2, size);
+        ecs_os_memcpy(el_2, tmp, size);
+    }
+
+    /* Swap double buffered columns */
+    ecs_column_t *prev_columns = data->prev_columns;
+    if (prev_columns) {
+        for (i = 0; i < column_count; i ++) {
+            ecs_column_t *column = &prev_columns[i];
+            int16_t size = column->size;
+            if (!size) {
+                continue;
+            }
+
+            void *ptr = ecs_vector_first_t(column->data, size, column->alignment);
+            void *tmp = ecs_os_alloca(size);
+
+            void *el_1 = ECS_OFFSET(ptr, size * row_1);
+            void *el_2 = ECS_OFFSET(ptr, size * row_2);
+
+            ecs_os_memcpy(tmp, el_1, size);
+            ecs_os_memcpy(el_1, el_2, size);
+            ecs_os_memcpy(el_2, tmp, size);
+        }
+    }
+
     /* If the table is monitored indicate that there has been a change */
     mark_table_dirty(table, 0);    
 }
 
+static
+void permute_column(
+    ecs_column_t *column,
+    const int32_t *perm,
+    int32_t count,
+    void *tmp)
+{
+    int16_t size = column->size;
+    if (!size) {
+        return;
+    }
+
+    void *ptr = ecs_vector_first_t(column->data, size, column->alignment);
+
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        ecs_os_memcpy(ECS_OFFSET(tmp, size * i), 
+            ECS_OFFSET(ptr, size * perm[i]), size);
+    }
+
+    ecs_os_memcpy(ptr, tmp, size * count);
+}
+
+void ecs_table_permute(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_data_t * data,
+    const int32_t *perm)
+{
+    (void)world;
+
+    ecs_assert(data != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(perm != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int32_t i, count = ecs_table_data_count(data);
+    if (count < 2) {
+        return;
+    }
+
+    /* Allocate a single buffer that fits each of the columns */
+    int32_t column_count = table->column_count;
+    ecs_column_t *columns = data->columns;
+    ecs_size_t max_size = ECS_SIZEOF(uint64_t);
+    for (i = 0; i < column_count; i ++) {
+        if (columns[i].size > max_size) {
+            max_size = columns[i].size;
+        }
+    }
+
+    int32_t soa_column_count = table->soa_column_count;
+    for (i = 0; i < soa_column_count; i ++) {
+        if (data->soa_columns[i].size > max_size) {
+            max_size = data->soa_columns[i].size;
+        }
+    }
+
+    void *tmp = ecs_os_malloc(max_size * count);
+    ecs_assert(tmp != NULL, ECS_OUT_OF_MEMORY, NULL);
+
+    /* Permute entities and update the rows stored in the entity index */
+    ecs_entity_t *entities = ecs_vector_first(data->entities, ecs_entity_t);
+    ecs_record_t **record_ptrs = ecs_vector_first(
+        data->record_ptrs, ecs_record_t*);
+
+    ecs_entity_t *tmp_entities = tmp;
+    for (i = 0; i < count; i ++) {
+        tmp_entities[i] = entities[perm[i]];
+    }
+    ecs_os_memcpy(entities, tmp, ECS_SIZEOF(ecs_entity_t) * count);
+
+    ecs_record_t **tmp_records = tmp;
+    for (i = 0; i < count; i ++) {
+        tmp_records[i] = record_ptrs[perm[i]];
+    }
+    ecs_os_memcpy(record_ptrs, tmp, ECS_SIZEOF(ecs_record_t*) * count);
+
+    for (i = 0; i < count; i ++) {
+        ecs_record_t *record = record_ptrs[i];
+        ecs_assert(record != NULL, ECS_INTERNAL_ERROR, NULL);
+        record->row = ecs_row_to_record(i, record->row < 0);
+    }
+
+    /* Permute columns. The values of switch columns are owned by the switch,
+     * which also maintains per-case lists, so they are set one by one. */
+    int32_t sw_offset = table->sw_column_offset;
+    int32_t sw_column_count = table->sw_column_count;
+
+    for (i = 0; i < column_count; i ++) {
+        if (i >= sw_offset && i < sw_offset + sw_column_count) {
+            continue;
+        }
+        permute_column(&columns[i], perm, count, tmp);
+    }
+
+    int32_t j;
+    for (i = 0; i < sw_column_count; i ++) {
+        ecs_switch_t *sw = data->sw_columns[i].data;
+        uint64_t *values = tmp;
+        for (j = 0; j < count; j ++) {
+            values[j] = ecs_switch_get(sw, perm[j]);
+        }
+        for (j = 0; j < count; j ++) {
+            ecs_switch_set(sw, j, values[j]);
+        }
+    }
+
+    int32_t bs_column_count = table->bs_column_count;
+    for (i = 0; i < bs_column_count; i ++) {
+        ecs_bitset_t *bs = &data->bs_columns[i].data;
+        bool *values = tmp;
+        for (j = 0; j < count; j ++) {
+            values[j] = ecs_bitset_get(bs, perm[j]);
+        }
+        for (j = 0; j < count; j ++) {
+            ecs_bitset_set(bs, j, values[j]);
+        }
+    }
+
+    for (i = 0; i < soa_column_count; i ++) {
+        permute_column(&data->soa_columns[i], perm, count, tmp);
+    }
+
+    if (data->prev_columns) {
+        for (i = 0; i < column_count; i ++) {
+            permute_column(&data->prev_columns[i], perm, count, tmp);
+        }
+    }
+
+    ecs_os_free(tmp);
+
+    /* If the table is monitored indicate that there has been a change */
+    mark_table_dirty(table, 0);
+}
+
+void ecs_table_update_prev(
+    ecs_table_t * table)
+{
+    ecs_assert(table != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_data_t *data = table->data;
+    if (!data || !data->prev_columns) {
+        return;
+    }
+
+    ecs_column_t *columns = data->columns;
+    ecs_column_t *prev_columns = data->prev_columns;
+    int32_t i, column_count = table->column_count;
+    int32_t count = ecs_vector_count(data->entities);
+
+    for (i = 0; i < column_count; i ++) {
+        ecs_column_t *column = &prev_columns[i];
+        int16_t size = column->size;
+        if (!size) {
+            continue;
+        }
+
+        /* Resize in case rows were written without going through the table
+         * operations, as is the case for deserialized tables */
+        int16_t alignment = column->alignment;
+        ecs_vector_set_count_t(&column->data, size, alignment, count);
+
+        if (count) {
+            void *dst = ecs_vector_first_t(column->data, size, alignment);
+            void *src = ecs_vector_first_t(columns[i].data, size, alignment);
+            ecs_os_memcpy(dst, src, size * count);
+        }
+    }
+}
+
 static
 void merge_vector(
     ecs_vector_t ** dst_out,
@@ -1689,6 +2561,34 @@ void merge_table_data(
     move_switch_columns(
         new_table, new_data, new_count, old_table, old_data, 0, old_count);
 
+    /* Grow bitset columns, new elements are enabled by default */
+    int32_t b, bs_column_count = new_table->bs_column_count;
+    for (b = 0; b < bs_column_count; b ++) {
+        ecs_bitset_ensure(
+            &new_data->bs_columns[b].data, old_count + new_count);
+    }
+
+    move_bitset_columns(
+        new_table, new_data, new_count, old_table, old_data, 0, old_count);
+
+    /* Grow field columns, new elements are not initialized */
+    int32_t f, soa_column_count = new_table->soa_column_count;
+    for (f = 0; f < soa_column_count; f ++) {
+        ecs_column_t *column = &new_data->soa_columns[f];
+        ecs_vector_set_count_t(&column->data, column->size, column->alignment, 
+            old_count + new_count);
+    }
+
+    move_soa_columns(
+        new_table, new_data, new_count, old_table, old_data, 0, old_count);
+
+    /* Grow double buffered columns, new elements have no previous value */
+    grow_prev_columns(world, new_table, new_data, old_count, 
+        ecs_vector_size(new_data->entities));
+
+    move_prev_columns(
+        new_table, new_data, new_count, old_table, old_data, 0, old_count);
+
     /* Initialize remaining columns */
     for (; i_new < new_component_count; i_new ++) {
         ecs_column_t *column = &new_columns[i_new];
@@ -1807,6 +2707,12 @@ ecs_data_t* ecs_table_merge(
     }
 
     new_table->alloc_count ++;
+    ecs_table_track_alloc(new_table);
+    ecs_table_sync_stats(new_table);
+    if (new_table != old_table) {
+        ecs_table_track_alloc(old_table);
+        ecs_table_sync_stats(old_table);
+    }
 
     if (!new_count && old_count) {
         ecs_table_activate(world, new_table, NULL, true);
@@ -1824,6 +2730,9 @@ void ecs_table_replace_data(
     ecs_data_t *table_data = table->data;
     ecs_assert(!data || data != table_data, ECS_INTERNAL_ERROR, NULL);
 
+    /* Entities in the table could be bases */
+    world->base_cache_version ++;
+
     if (table_data) {
         prev_count = ecs_vector_count(table_data->entities);
         run_remove_actions(
@@ -1834,6 +2743,8 @@ void ecs_table_replace_data(
     if (data) {
         table_data = ecs_table_get_or_create_data(table);
         *table_data = *data;
+        ecs_table_track_alloc(table);
+        ecs_table_sync_stats(table);
     } else {
         return;
     }
@@ -1925,6 +2836,10 @@ void ecs_table_notify(
         unregister_query(
             world, table, event->query);
         break;
+    case EcsTableQueryFree:
+        free_query(
+            world, table, event->query);
+        break;
     case EcsTableComponentInfo:
         notify_component_info(world, table, event->component);
         break;
@@ -57,10 +57,11 @@ int32_t data_column_count(
         /* Typically all components will be clustered together at the start of
          * the type as components are created from a separate id pool, and type
          * vectors are sorted. 
-         * Explicitly check for EcsComponent and EcsName since the ecs_has check
+         * Explicitly check for builtin components since the ecs_has check
          * doesn't work during bootstrap. */
         if ((component == ecs_typeid(EcsComponent)) || 
             (component == ecs_typeid(EcsName)) || 
+            (component == ecs_typeid(EcsChildOf)) || 
             ecs_component_from_id(world, component) != NULL) 
         {
             count = c_ptr_i + 1;
@@ -90,6 +91,26 @@ int32_t switch_column_count(
     return count;
 }
 
+/* Count number of bitset columns */
+static
+int32_t bitset_column_count(
+    ecs_table_t *table)
+{
+    int32_t count = 0;
+    ecs_vector_each(table->type, ecs_entity_t, c_ptr, {
+        ecs_entity_t component = *c_ptr;
+
+        if (ECS_HAS_ROLE(component, DISABLED)) {
+            if (!count) {
+                table->bs_column_offset = c_ptr_i;
+            }
+            count ++;
+        }
+    });
+
+    return count;
+}
+
 static
 ecs_type_t entities_to_type(
     ecs_entities_t *entities)
@@ -128,6 +149,83 @@ void register_child_table(
     ecs_map_set(world->child_tables, parent, &child_tables);
 }
 
+static
+void unregister_child_table(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entity_t parent)
+{
+    ecs_vector_t *child_tables = ecs_map_get_ptr(
+            world->child_tables, ecs_vector_t*, parent);
+
+    int32_t i, count = ecs_vector_count(child_tables);
+    ecs_table_t **tables = ecs_vector_first(child_tables, ecs_table_t*);
+    for (i = 0; i < count; i ++) {
+        if (tables[i] == table) {
+            break;
+        }
+    }
+
+    ecs_assert(i != count, ECS_INTERNAL_ERROR, NULL);
+    ecs_vector_remove_index(child_tables, ecs_table_t*, i);
+
+    if (!ecs_vector_count(child_tables)) {
+        ecs_vector_free(child_tables);
+        ecs_map_remove(world->child_tables, parent);
+    }
+}
+
+static
+void register_instance_table(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entity_t base)
+{
+    /* Register instance table with base, so that when the base changes only
+     * the tables of its instances need to be rematched */
+    if (!world->instance_tables) {
+        world->instance_tables = ecs_map_new(ecs_vector_t*, 1);
+    }
+
+    ecs_vector_t *instance_tables = ecs_map_get_ptr(
+            world->instance_tables, ecs_vector_t*, base);
+    
+    ecs_table_t **el = ecs_vector_add(&instance_tables, ecs_table_t*);
+    *el = table;
+
+    ecs_map_set(world->instance_tables, base, &instance_tables);
+}
+
+static
+void unregister_instance_table(
+    ecs_world_t * world,
+    ecs_table_t * table,
+    ecs_entity_t base)
+{
+    ecs_vector_t *instance_tables = ecs_map_get_ptr(
+            world->instance_tables, ecs_vector_t*, base);
+
+    /* Admin of base is removed when the base is deleted */
+    int32_t i, count = ecs_vector_count(instance_tables);
+    ecs_table_t **tables = ecs_vector_first(instance_tables, ecs_table_t*);
+    for (i = 0; i < count; i ++) {
+        if (tables[i] == table) {
+            break;
+        }
+    }
+
+    if (i == count) {
+        return;
+    }
+
+    ecs_vector_remove_index(instance_tables, ecs_table_t*, i);
+
+    if (!ecs_vector_count(instance_tables)) {
+        ecs_vector_free(instance_tables);
+        ecs_map_remove(world->instance_tables, base);
+    }
+}
+
 static
 void init_edges(
     ecs_world_t * world,
@@ -138,6 +236,8 @@ void init_edges(
 
     table->lo_edges = ecs_os_calloc(sizeof(ecs_edge_t) * ECS_HI_COMPONENT_ID);
     table->hi_edges = ecs_map_new(ecs_edge_t, 0);
+    ecs_os_track_alloc(EcsAllocEdges, 
+        0, ECS_SIZEOF(ecs_edge_t) * ECS_HI_COMPONENT_ID);
 
     table->lo_edges[0].add = table;
     
@@ -185,18 +285,27 @@ void init_edges(
             table->flags |= EcsTableHasComponentData;
         }
 
+        if (e == ecs_typeid(EcsChildOf)) {
+            table->flags |= EcsTableHasChildOf;
+        }
+
         if (ECS_HAS_ROLE(e, XOR)) {
             table->flags |= EcsTableHasXor;
         }
 
         if (ECS_HAS_ROLE(e, INSTANCEOF)) {
             table->flags |= EcsTableHasBase;
+            register_instance_table(world, table, e & ECS_COMPONENT_MASK);
         }
 
         if (ECS_HAS_ROLE(e, SWITCH)) {
             table->flags |= EcsTableHasSwitch;
         }
 
+        if (ECS_HAS_ROLE(e, DISABLED)) {
+            table->flags |= EcsTableHasDisabled;
+        }
+
         if (ECS_HAS_ROLE(e, CHILDOF)) {
             ecs_entity_t parent = e & ECS_COMPONENT_MASK;
             ecs_assert(!ecs_exists(world, parent) || ecs_is_alive(world, parent), ECS_INTERNAL_ERROR, NULL);
@@ -214,8 +323,9 @@ void init_edges(
         .kind = EcsTableComponentInfo
     });
     
-    /* Register as root table */
-    if (!(table->flags & EcsTableHasParent)) {
+    /* Register as root table. Tables with EcsChildOf store children, and are
+     * found through the EcsChildOf index of the parent. */
+    if (!(table->flags & (EcsTableHasParent | EcsTableHasChildOf))) {
         register_child_table(world, table, 0);
     }
 }
@@ -231,18 +341,94 @@ void init_table(
     table->data = NULL;
     table->flags = 0;
     table->dirty_state = NULL;
+    table->column_stats = NULL;
     table->monitors = NULL;
     table->on_set = NULL;
     table->on_set_all = NULL;
     table->on_set_override = NULL;
     table->un_set_all = NULL;
     table->alloc_count = 0;
+    table->alloc_bytes = 0;
+    table->gc_frame = 0;
 
     table->queries = NULL;
     table->column_count = data_column_count(world, table);
     table->sw_column_count = switch_column_count(table);
+    table->bs_column_count = bitset_column_count(table);
+    table->soa_column_count = 0;
 
     init_edges(world, table);
+
+    ecs_table_register_stats(world, table);
+}
+
+/* Compute hash for an ordered array of entities. The result is used to find
+ * tables by type without visiting all tables in the world. */
+static
+uint64_t hash_entities(
+    const ecs_entity_t *array,
+    int32_t count)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        hash ^= array[i];
+        hash *= 1099511628211ULL;
+    }
+
+    /* Mix in high bits, as the map uses the low bits to select a bucket */
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+static
+void index_table(
+    ecs_world_t * world,
+    ecs_table_t * table)
+{
+    if (!world->store.table_index) {
+        world->store.table_index = ecs_map_new(ecs_table_t*, 0);
+    }
+
+    uint64_t hash = hash_entities(
+        ecs_vector_first(table->type, ecs_entity_t),
+        ecs_vector_count(table->type));
+
+    ecs_table_t **head = ecs_map_get(
+        world->store.table_index, ecs_table_t*, hash);
+    if (head) {
+        table->hash_next = *head;
+        *head = table;
+    } else {
+        table->hash_next = NULL;
+        ecs_map_set(world->store.table_index, hash, &table);
+    }
+}
+
+void ecs_table_index_remove(
+    ecs_world_t * world,
+    ecs_table_t * table)
+{
+    uint64_t hash = hash_entities(
+        ecs_vector_first(table->type, ecs_entity_t),
+        ecs_vector_count(table->type));
+
+    ecs_table_t **head = ecs_map_get(
+        world->store.table_index, ecs_table_t*, hash);
+    ecs_assert(head != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    ecs_table_t **ptr = head;
+    while (*ptr != table) {
+        ecs_assert(*ptr != NULL, ECS_INTERNAL_ERROR, NULL);
+        ptr = &(*ptr)->hash_next;
+    }
+
+    *ptr = table->hash_next;
+
+    if (!*head) {
+        ecs_map_remove(world->store.table_index, hash);
+    }
 }
 
 static
@@ -250,11 +436,16 @@ ecs_table_t *create_table(
     ecs_world_t * world,
     ecs_entities_t * entities)
 {
+    uint64_t span = ecs_span_begin(world);
+
     ecs_table_t *result = ecs_sparse_add(world->store.tables, ecs_table_t);
     result->id = ecs_to_u32(ecs_sparse_last_id(world->store.tables));
 
     ecs_assert(result != NULL, ECS_INTERNAL_ERROR, NULL);
     init_table(world, result, entities);
+    index_table(world, result);
+
+    world->stats.table_create_count_total ++;
 
 #ifndef NDEBUG
     char *expr = ecs_type_str(world, result->type);
@@ -270,6 +461,12 @@ ecs_table_t *create_table(
 
     ecs_log_pop();
 
+    /* Only record span when not running on a worker thread, as the main thread
+     * ring buffer may not be written to from multiple threads. */
+    if (!world->in_progress || !ecs_vector_count(world->workers)) {
+        ecs_span_end(world, &world->stage, EcsSpanTableCreate, result->id, span);
+    }
+
     return result;
 }
 
@@ -898,11 +1095,11 @@ ecs_table_t *find_or_create(
         ordered = entities->array;
     }    
 
-    /* Iterate tables, look if a table matches the type */
-    ecs_sparse_t *tables = world->store.tables;
-    int32_t i, count = ecs_sparse_count(tables);
-    for (i = 0; i < count; i ++) {
-        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+    /* Look for a table with the same type hash that matches the type */
+    ecs_table_t **head = ecs_map_get(world->store.table_index, ecs_table_t*,
+        hash_entities(ordered, type_count));
+    ecs_table_t *table = head ? *head : NULL;
+    for (; table; table = table->hash_next) {
         ecs_type_t type = table->type;
         int32_t table_type_count = ecs_vector_count(type);
 
@@ -969,6 +1166,144 @@ void ecs_init_root_table(
     init_table(world, &world->store.root, &entities);
 }
 
+void ecs_table_unregister_child(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    if (!(table->flags & EcsTableHasParent)) {
+        if (!(table->flags & EcsTableHasChildOf)) {
+            unregister_child_table(world, table, 0);
+        }
+        return;
+    }
+
+    ecs_entity_t *entities = ecs_vector_first(table->type, ecs_entity_t);
+    int32_t i, count = ecs_vector_count(table->type);
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+        if (ECS_HAS_ROLE(e, CHILDOF)) {
+            unregister_child_table(world, table, e & ECS_COMPONENT_MASK);
+        }
+    }
+}
+
+void ecs_table_unregister_instance(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    if (!(table->flags & EcsTableHasBase)) {
+        return;
+    }
+
+    ecs_entity_t *entities = ecs_vector_first(table->type, ecs_entity_t);
+    int32_t i, count = ecs_vector_count(table->type);
+    for (i = 0; i < count; i ++) {
+        ecs_entity_t e = entities[i];
+        if (ECS_HAS_ROLE(e, INSTANCEOF)) {
+            unregister_instance_table(world, table, e & ECS_COMPONENT_MASK);
+        }
+    }
+}
+
+void ecs_instance_tables_delete(
+    ecs_world_t *world,
+    ecs_entity_t base)
+{
+    ecs_vector_t *instance_tables = ecs_map_get_ptr(
+            world->instance_tables, ecs_vector_t*, base);
+    if (instance_tables) {
+        ecs_vector_free(instance_tables);
+        ecs_map_remove(world->instance_tables, base);
+    }
+}
+
+static
+void invalidate_bases_in_table(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    ecs_map_iter_t it = ecs_map_iter(world->instance_tables);
+    ecs_map_key_t key;
+    while (ecs_map_next_ptr(&it, ecs_vector_t*, &key)) {
+        ecs_record_t *r = ecs_eis_get(world, key);
+        if (r && r->table == table) {
+            ecs_invalidate_base_cache(world, key);
+        }
+    }
+}
+
+void ecs_invalidate_base_cache(
+    ecs_world_t *world,
+    ecs_entity_t base)
+{
+    ecs_vector_t *instance_tables = ecs_map_get_ptr(
+            world->instance_tables, ecs_vector_t*, base);
+
+    ecs_vector_each(instance_tables, ecs_table_t*, t_ptr, {
+        ecs_table_t *table = *t_ptr;
+        if (table->base_cache) {
+            ecs_map_clear(table->base_cache);
+        }
+
+        /* Instances that are bases themselves pass on the change */
+        invalidate_bases_in_table(world, table);
+    });
+}
+
+void ecs_table_invalidate_base_cache(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    if (world->instance_tables) {
+        invalidate_bases_in_table(world, table);
+    }
+}
+
+static
+ecs_table_t* live_edge(
+    ecs_table_t *table)
+{
+    if (table && (table->flags & EcsTableIsGarbage)) {
+        return NULL;
+    } else {
+        return table;
+    }
+}
+
+static
+void clear_garbage_edges(
+    ecs_table_t *table)
+{
+    uint32_t i;
+    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
+        ecs_edge_t *e = &table->lo_edges[i];
+        e->add = live_edge(e->add);
+        e->remove = live_edge(e->remove);
+    }
+
+    ecs_map_iter_t it = ecs_map_iter(table->hi_edges);
+    ecs_edge_t *e;
+    while ((e = ecs_map_next(&it, ecs_edge_t, NULL))) {
+        e->add = live_edge(e->add);
+        e->remove = live_edge(e->remove);
+    }
+}
+
+void ecs_table_clear_garbage_edges(
+    ecs_world_t *world)
+{
+    /* Edges are not always symmetric, so a table that is about to be deleted
+     * may be referenced by tables that it does not reference itself. Visit all
+     * tables to make sure no edge points to a deleted table. */
+    clear_garbage_edges(&world->store.root);
+
+    int32_t i, count = ecs_sparse_count(world->store.tables);
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(world->store.tables, ecs_table_t, i);
+        clear_garbage_edges(table);
+    }
+}
+
 void ecs_table_clear_edges(
     ecs_table_t *table)
 {
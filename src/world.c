@@ -34,12 +34,16 @@ ecs_stage_t *ecs_get_stage(
 static
 void eval_component_monitor(
     ecs_world_t *world,
-    ecs_component_monitor_t *mon)
+    ecs_component_monitor_t *mon,
+    ecs_vector_t *tables,
+    ecs_vector_t *changed)
 {
     if (!mon->rematch) {
         return;
     }
 
+    world->stats.monitor_eval_count_total ++;
+
     ecs_vector_t *eval[ECS_HI_COMPONENT_ID];
     int32_t eval_count = 0;
 
@@ -54,7 +58,9 @@ void eval_component_monitor(
     for (i = 0; i < eval_count; i ++) {
         ecs_vector_each(eval[i], ecs_query_t*, q_ptr, {
             ecs_query_notify(world, *q_ptr, &(ecs_query_event_t) {
-                .kind = EcsQueryTableRematch
+                .kind = EcsQueryTableRematch,
+                .tables = tables,
+                .entities = changed
             });
         });
     }
@@ -91,6 +97,25 @@ void ecs_component_monitor_register(
     *q = query;
 }
 
+void ecs_component_monitor_unregister(
+    ecs_component_monitor_t *mon,
+    ecs_query_t *query)
+{
+    ecs_assert(mon != NULL, ECS_INTERNAL_ERROR, NULL);
+    ecs_assert(query != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    int i;
+    for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
+        ecs_vector_t *monitors = mon->monitors[i];
+        ecs_vector_each(monitors, ecs_query_t*, q_ptr, {
+            if (*q_ptr == query) {
+                ecs_vector_remove_index(monitors, ecs_query_t*, q_ptr_i);
+                break;
+            }
+        });
+    }
+}
+
 void ecs_component_monitor_free(
     ecs_component_monitor_t *mon)
 {
@@ -106,6 +131,7 @@ void init_store(ecs_world_t *world) {
     
     /* Initialize entity index */
     world->store.entity_index = ecs_sparse_new(ecs_record_t);
+    ecs_sparse_set_alloc_tag(world->store.entity_index, EcsAllocEntityIndex);
     ecs_sparse_set_id_source(world->store.entity_index, &world->stats.last_id);
 
     /* Initialize root table */
@@ -134,8 +160,10 @@ void clean_tables(
 
 static
 void fini_store(ecs_world_t *world) {
+    ecs_track_component_stats(world, false);
     clean_tables(world);
     ecs_sparse_free(world->store.tables);
+    ecs_map_free(world->store.table_index);
     ecs_table_free(world, &world->store.root);
     ecs_sparse_free(world->store.entity_index);
 }
@@ -198,7 +226,11 @@ ecs_world_t *ecs_mini(void) {
 
     world->queries = ecs_vector_new(ecs_query_t*, 0);
     world->fini_tasks = ecs_vector_new(ecs_entity_t, 0);
+    world->timer_wheel = NULL;
     world->child_tables = NULL;
+    world->childof_index = NULL;
+    world->instance_tables = NULL;
+    world->watched_changed = NULL;
     world->name_prefix = NULL;
 
     memset(&world->component_monitors, 0, sizeof(world->component_monitors));
@@ -244,6 +276,19 @@ ecs_world_t *ecs_mini(void) {
     world->stats.merge_count_total = 0;
     world->stats.systems_ran_frame = 0;
     world->stats.pipeline_build_count_total = 0;
+    world->stats.table_create_count_total = 0;
+    world->stats.table_delete_count_total = 0;
+    world->stats.table_move_count_total = 0;
+    world->stats.table_append_count_total = 0;
+    world->stats.table_remove_count_total = 0;
+    world->stats.defer_new_count_total = 0;
+    world->stats.defer_add_count_total = 0;
+    world->stats.defer_remove_count_total = 0;
+    world->stats.defer_set_count_total = 0;
+    world->stats.defer_delete_count_total = 0;
+    world->stats.defer_flush_count_total = 0;
+    world->stats.rematch_count_total = 0;
+    world->stats.monitor_eval_count_total = 0;
     
     world->range_check_enabled = true;
 
@@ -254,6 +299,21 @@ ecs_world_t *ecs_mini(void) {
     world->arg_fps = 0;
     world->arg_threads = 0;
 
+    world->profiler = NULL;
+    world->profiler_fini_set = false;
+    world->frame_span = 0;
+    world->table_gc_frames = 0;
+    world->par_job = NULL;
+    world->base_cache_version = 0;
+    world->sparse_components = NULL;
+    world->read_count = 0;
+    world->read_epoch = 0;
+    world->read_enabled = false;
+    world->command_queues = NULL;
+    world->double_buffered_count = 0;
+    world->spatial_indices = NULL;
+    world->component_stats = NULL;
+
     ecs_stage_init(world, &world->stage);
     ecs_stage_init(world, &world->temp_stage);
     init_store(world);
@@ -377,6 +437,12 @@ void ecs_set_component_actions_w_entity(
     ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, component);
     ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL);
 
+    /* Components with fields cannot have lifecycle actions */
+    ecs_assert(c_info->fields == NULL, ECS_INVALID_PARAMETER, NULL);
+
+    /* Double buffered components are copied with memcpy */
+    ecs_assert(!c_info->double_buffered, ECS_INVALID_PARAMETER, NULL);
+
     if (c_info->lifecycle_set) {
         ecs_assert(c_info->component == component, ECS_INTERNAL_ERROR, NULL);
         ecs_assert(c_info->lifecycle.ctor == lifecycle->ctor, 
@@ -407,6 +473,136 @@ void ecs_set_component_actions_w_entity(
     }
 }
 
+void ecs_set_component_sparse_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+
+    const EcsComponent *component_ptr = ecs_get(world, component, EcsComponent);
+
+    /* Only components with data can be stored in a sparse set */
+    ecs_assert(component_ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component_ptr->size != 0, ECS_INVALID_PARAMETER, NULL);
+
+    /* Entities that already have the component are stored in tables */
+    ecs_assert(ecs_count_entity(world, component) == 0, 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, component);
+    ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* Components with fields are stored in tables */
+    ecs_assert(c_info->fields == NULL, ECS_INVALID_PARAMETER, NULL);
+
+    /* Double buffered components are stored in tables */
+    ecs_assert(!c_info->double_buffered, ECS_INVALID_PARAMETER, NULL);
+
+    if (!c_info->sparse) {
+        c_info->sparse = _ecs_sparse_new(component_ptr->size);
+        c_info->size = component_ptr->size;
+        c_info->component = component;
+
+        ecs_entity_t *elem = ecs_vector_add(
+            &world->sparse_components, ecs_entity_t);
+        *elem = component;
+    }
+}
+
+void ecs_set_component_fields_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    const ecs_field_t *fields,
+    int32_t count)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+    ecs_assert(fields != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(count > 0, ECS_INVALID_PARAMETER, NULL);
+
+    const EcsComponent *component_ptr = ecs_get(world, component, EcsComponent);
+
+    /* Only components with data can be split up in fields */
+    ecs_assert(component_ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component_ptr->size != 0, ECS_INVALID_PARAMETER, NULL);
+
+    /* Entities that already have the component store it as a single value */
+    ecs_assert(ecs_count_entity(world, component) == 0, 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, component);
+    ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* Fields are copied with memcpy, and are not stored in a sparse set */
+    ecs_assert(!c_info->lifecycle_set, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(c_info->sparse == NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!c_info->double_buffered, ECS_INVALID_PARAMETER, NULL);
+
+    if (c_info->fields) {
+        return;
+    }
+
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        ecs_assert(fields[i].offset >= 0, ECS_INVALID_PARAMETER, NULL);
+        ecs_assert(fields[i].size > 0, ECS_INVALID_PARAMETER, NULL);
+        ecs_assert(fields[i].offset + fields[i].size <= component_ptr->size, 
+            ECS_INVALID_PARAMETER, NULL);
+    }
+
+    c_info->component = component;
+    c_info->fields = ecs_vector_new(ecs_field_t, count);
+    ecs_field_t *elem = ecs_vector_addn(&c_info->fields, ecs_field_t, count);
+    ecs_os_memcpy(elem, fields, ECS_SIZEOF(ecs_field_t) * count);
+
+    /* Empty tables with the component may already exist */
+    ecs_notify_tables(world, &(ecs_table_event_t) {
+        .kind = EcsTableComponentInfo,
+        .component = component
+    });
+}
+
+void ecs_set_component_double_buffered_w_entity(
+    ecs_world_t *world,
+    ecs_entity_t component)
+{
+    ecs_assert(world != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+
+    const EcsComponent *component_ptr = ecs_get(world, component, EcsComponent);
+
+    /* Only components with data can be double buffered */
+    ecs_assert(component_ptr != NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(component_ptr->size != 0, ECS_INVALID_PARAMETER, NULL);
+
+    /* Entities that already have the component have no second buffer */
+    ecs_assert(ecs_count_entity(world, component) == 0, 
+        ECS_INVALID_PARAMETER, NULL);
+
+    ecs_c_info_t *c_info = ecs_get_or_create_c_info(world, component);
+    ecs_assert(c_info != NULL, ECS_INTERNAL_ERROR, NULL);
+
+    /* Values are copied with memcpy, and must be stored in a table column */
+    ecs_assert(!c_info->lifecycle_set, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(c_info->sparse == NULL, ECS_INVALID_PARAMETER, NULL);
+    ecs_assert(c_info->fields == NULL, ECS_INVALID_PARAMETER, NULL);
+
+    if (c_info->double_buffered) {
+        return;
+    }
+
+    c_info->component = component;
+    c_info->double_buffered = true;
+    world->double_buffered_count ++;
+
+    /* Empty tables with the component may already exist */
+    ecs_notify_tables(world, &(ecs_table_event_t) {
+        .kind = EcsTableComponentInfo,
+        .component = component
+    });
+}
+
 bool ecs_component_has_actions(
     ecs_world_t *world,
     ecs_entity_t component)
@@ -458,6 +654,26 @@ void fini_unset_tables(
     }
 }
 
+/* Destruct components in sparse storage */
+static
+void fini_unset_sparse(
+    ecs_world_t *world)
+{
+    ecs_vector_each(world->sparse_components, ecs_entity_t, c_ptr, {
+        ecs_c_info_t *c_info = ecs_get_c_info(world, *c_ptr);
+        ecs_xtor_t dtor = c_info->lifecycle.dtor;
+        int32_t i, count = ecs_sparse_count(c_info->sparse);
+        if (dtor && count) {
+            const uint64_t *ids = ecs_sparse_ids(c_info->sparse);
+            for (i = 0; i < count; i ++) {
+                void *ptr = _ecs_sparse_get(c_info->sparse, 0, i);
+                dtor(world, *c_ptr, &ids[i], ptr, 
+                    ecs_to_size_t(c_info->size), 1, c_info->lifecycle.ctx);
+            }
+        }
+    });
+}
+
 /* Invoke fini actions */
 static
 void fini_actions(
@@ -479,6 +695,8 @@ void fini_component_lifecycle(
     for (i = 0; i < ECS_HI_COMPONENT_ID; i ++) {
         ecs_vector_free(world->c_info[i].on_add);
         ecs_vector_free(world->c_info[i].on_remove);
+        ecs_sparse_free(world->c_info[i].sparse);
+        ecs_vector_free(world->c_info[i].fields);
     }
 
     ecs_map_iter_t it = ecs_map_iter(world->t_info);
@@ -486,8 +704,12 @@ void fini_component_lifecycle(
     while ((c_info = ecs_map_next(&it, ecs_c_info_t, NULL))) {
         ecs_vector_free(c_info->on_add);
         ecs_vector_free(c_info->on_remove);
+        ecs_sparse_free(c_info->sparse);
+        ecs_vector_free(c_info->fields);
     }    
 
+    ecs_vector_free(world->sparse_components);
+
     ecs_map_free(world->t_info);
 }
 
@@ -531,6 +753,18 @@ void fini_child_tables(
     }
 
     ecs_map_free(world->child_tables);
+    ecs_childof_index_free(world);
+
+    if (world->instance_tables) {
+        it = ecs_map_iter(world->instance_tables);
+        while ((tables = ecs_map_next_ptr(&it, ecs_vector_t*, NULL))) {
+            ecs_vector_free(tables);
+        }
+
+        ecs_map_free(world->instance_tables);
+    }
+
+    ecs_vector_free(world->watched_changed);
 }
 
 /* Cleanup aliases */
@@ -569,12 +803,20 @@ int ecs_fini(
     assert(!world->in_progress);
     assert(!world->is_merging);
 
+    world->is_fini = true;
+
     fini_unset_tables(world);
 
+    fini_unset_sparse(world);
+
     fini_actions(world);    
 
     if (world->locking_enabled) {
         ecs_os_mutex_free(world->mutex);
+        ecs_os_mutex_free(world->thr_sync);
+        ecs_os_cond_free(world->thr_cond);
+        ecs_os_mutex_free(world->read_mutex);
+        ecs_os_cond_free(world->read_cond);
     }
 
     fini_stages(world);
@@ -628,11 +870,147 @@ void ecs_dim_type(
     }
 }
 
+/* Index the entities that have dependent tables (parents and bases) by the
+ * table they are stored in */
+static
+void index_watched_by_table(
+    ecs_world_t *world,
+    ecs_map_t *dependents,
+    ecs_map_t *index)
+{
+    if (!dependents) {
+        return;
+    }
+
+    ecs_map_iter_t it = ecs_map_iter(dependents);
+    ecs_map_key_t key;
+    while (ecs_map_next(&it, ecs_vector_t*, &key)) {
+        if (!key) {
+            /* Root tables */
+            continue;
+        }
+
+        ecs_record_t *r = ecs_eis_get(world, key);
+        if (!r || !r->table) {
+            continue;
+        }
+
+        ecs_vector_t *entities = ecs_map_get_ptr(
+            index, ecs_vector_t*, r->table->id);
+        ecs_entity_t *elem = ecs_vector_add(&entities, ecs_entity_t);
+        *elem = key;
+        ecs_map_set(index, r->table->id, &entities);
+    }
+}
+
+static
+void add_watched_dependent(
+    ecs_table_t *table,
+    ecs_map_t *visited,
+    ecs_map_t *index,
+    ecs_vector_t **tables,
+    ecs_vector_t **entities)
+{
+    if (ecs_map_get(visited, bool, table->id)) {
+        return;
+    }
+
+    ecs_map_set(visited, table->id, &(bool){true});
+
+    ecs_table_t **elem = ecs_vector_add(tables, ecs_table_t*);
+    *elem = table;
+
+    /* Parents and bases in the table can change the tables of their children
+     * and instances in turn */
+    ecs_vector_t *watched = ecs_map_get_ptr(index, ecs_vector_t*, table->id);
+    ecs_vector_each(watched, ecs_entity_t, e_ptr, {
+        ecs_entity_t *e = ecs_vector_add(entities, ecs_entity_t);
+        *e = *e_ptr;
+    });
+}
+
+static
+void add_watched_dependents(
+    ecs_vector_t *dependents,
+    ecs_map_t *visited,
+    ecs_map_t *index,
+    ecs_vector_t **tables,
+    ecs_vector_t **entities)
+{
+    ecs_vector_each(dependents, ecs_table_t*, table_ptr, {
+        add_watched_dependent(*table_ptr, visited, index, tables, entities);
+    });
+}
+
+/* Find the tables that depend on the watched entities that changed. These are
+ * the tables that have the entity as parent or as base, and recursively the
+ * tables that depend on parents and bases in those tables. */
+static
+ecs_vector_t* collect_watched_tables(
+    ecs_world_t *world,
+    ecs_vector_t *changed)
+{
+    ecs_vector_t *result = ecs_vector_new(ecs_table_t*, 0);
+    ecs_vector_t *entities = ecs_vector_copy(changed, ecs_entity_t);
+    ecs_map_t *visited = ecs_map_new(bool, 0);
+    ecs_map_t *visited_entities = ecs_map_new(bool, 0);
+
+    /* Find parents and bases per table once, so that visiting a dependent
+     * table does not require testing each of its entities */
+    ecs_map_t *index = ecs_map_new(ecs_vector_t*, 0);
+    if (ecs_vector_count(changed)) {
+        index_watched_by_table(world, world->child_tables, index);
+        index_watched_by_table(world, world->instance_tables, index);
+    }
+
+    int32_t i;
+    for (i = 0; i < ecs_vector_count(entities); i ++) {
+        ecs_entity_t e = *ecs_vector_get(entities, ecs_entity_t, i);
+        if (ecs_map_get(visited_entities, bool, e)) {
+            continue;
+        }
+
+        ecs_map_set(visited_entities, e, &(bool){true});
+
+        add_watched_dependents(
+            ecs_map_get_ptr(world->child_tables, ecs_vector_t*, e),
+            visited, index, &result, &entities);
+
+        add_watched_dependents(
+            ecs_map_get_ptr(world->instance_tables, ecs_vector_t*, e),
+            visited, index, &result, &entities);
+    }
+
+    ecs_map_iter_t it = ecs_map_iter(index);
+    ecs_vector_t **v_ptr;
+    while ((v_ptr = ecs_map_next(&it, ecs_vector_t*, NULL))) {
+        ecs_vector_free(*v_ptr);
+    }
+
+    ecs_map_free(index);
+    ecs_map_free(visited_entities);
+    ecs_map_free(visited);
+    ecs_vector_free(entities);
+
+    return result;
+}
+
 void ecs_eval_component_monitors(
     ecs_world_t *world)
 {
-    eval_component_monitor(world, &world->component_monitors);
-    eval_component_monitor(world, &world->parent_monitors);
+    ecs_vector_t *changed = world->watched_changed;
+    world->watched_changed = NULL;
+
+    ecs_vector_t *tables = NULL;
+    if (world->component_monitors.rematch || world->parent_monitors.rematch) {
+        tables = collect_watched_tables(world, changed);
+    }
+
+    eval_component_monitor(world, &world->component_monitors, tables, changed);
+    eval_component_monitor(world, &world->parent_monitors, tables, changed);
+
+    ecs_vector_free(tables);
+    ecs_vector_free(changed);
 }
 
 void ecs_merge(
@@ -650,6 +1028,8 @@ void ecs_merge(
         ecs_os_get_time(&t_start);
     }
 
+    uint64_t span = ecs_span_begin(world);
+
     ecs_stage_merge(world, &world->temp_stage);
 
     ecs_vector_each(world->worker_stages, ecs_stage_t, stage, {
@@ -664,6 +1044,8 @@ void ecs_merge(
         world->stats.merge_time_total += (float)ecs_time_measure(&t_start);
     }
 
+    ecs_span_end(world, &world->stage, EcsSpanMerge, 0, span);
+
     world->stats.merge_count_total ++;
 }
 
@@ -696,6 +1078,55 @@ void ecs_measure_system_time(
     world->measure_system_time = enable;
 }
 
+void ecs_track_component_stats(
+    ecs_world_t *world,
+    bool enable)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+
+    if (enable == (world->component_stats != NULL)) {
+        return;
+    }
+
+    if (enable) {
+        world->component_stats = ecs_map_new(ecs_component_stats_t*, 0);
+    }
+
+    ecs_sparse_t *tables = world->store.tables;
+    int32_t i, count = ecs_sparse_count(tables);
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        if (enable) {
+            ecs_table_register_stats(world, table);
+        } else {
+            ecs_table_unregister_stats(table);
+        }
+    }
+
+    if (!enable) {
+        ecs_map_iter_t it = ecs_map_iter(world->component_stats);
+        ecs_component_stats_t *stats;
+        while ((stats = ecs_map_next_ptr(&it, ecs_component_stats_t*, NULL))) {
+            ecs_os_free(stats);
+        }
+
+        ecs_map_free(world->component_stats);
+        world->component_stats = NULL;
+    }
+}
+
+const ecs_component_stats_t* ecs_get_component_stats(
+    ecs_world_t *world,
+    ecs_entity_t component)
+{
+    if (!world->component_stats) {
+        return NULL;
+    }
+
+    return ecs_map_get_ptr(
+        world->component_stats, ecs_component_stats_t*, component);
+}
+
 /* Increase timer resolution based on target fps */
 static void set_timer_resolution(float fps)
 {
@@ -786,12 +1217,17 @@ bool ecs_enable_locking(
             world->mutex = ecs_os_mutex_new();
             world->thr_sync = ecs_os_mutex_new();
             world->thr_cond = ecs_os_cond_new();
+            world->read_mutex = ecs_os_mutex_new();
+            world->read_cond = ecs_os_cond_new();
         }
     } else {
         if (world->locking_enabled) {
+            ecs_assert(!world->read_count, ECS_INVALID_OPERATION, NULL);
             ecs_os_mutex_free(world->mutex);
             ecs_os_mutex_free(world->thr_sync);
             ecs_os_cond_free(world->thr_cond);
+            ecs_os_mutex_free(world->read_mutex);
+            ecs_os_cond_free(world->read_cond);
         }
     }
 
@@ -829,6 +1265,94 @@ void ecs_end_wait(
     ecs_os_mutex_unlock(world->thr_sync);
 }
 
+#ifdef ECS_THREAD_LOCAL
+/* Number of read epochs entered by the current thread. Operations use this to
+ * avoid modifying the world from a reader thread. */
+static ECS_THREAD_LOCAL int32_t ecs_thread_read_count;
+#endif
+
+bool ecs_is_reader_thread(void)
+{
+#ifdef ECS_THREAD_LOCAL
+    return ecs_thread_read_count != 0;
+#else
+    return false;
+#endif
+}
+
+int32_t ecs_read_begin(
+    ecs_world_t *world)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
+
+#ifdef ECS_THREAD_LOCAL
+    ecs_thread_read_count ++;
+#else
+    /* Readers can only be detected with thread local storage */
+    ecs_abort(ECS_UNSUPPORTED, NULL);
+#endif
+
+    ecs_os_mutex_lock(world->read_mutex);
+    while (!world->read_enabled) {
+        ecs_os_cond_wait(world->read_cond, world->read_mutex);
+    }
+
+    world->read_count ++;
+    int32_t epoch = world->read_epoch;
+    ecs_os_mutex_unlock(world->read_mutex);
+
+    return epoch;
+}
+
+void ecs_read_end(
+    ecs_world_t *world)
+{
+    ecs_assert(world->locking_enabled, ECS_INVALID_PARAMETER, NULL);
+
+    ecs_os_mutex_lock(world->read_mutex);
+    ecs_assert(world->read_count > 0, ECS_INVALID_OPERATION, NULL);
+    if (!(-- world->read_count)) {
+        ecs_os_cond_broadcast(world->read_cond);
+    }
+    ecs_os_mutex_unlock(world->read_mutex);
+
+#ifdef ECS_THREAD_LOCAL
+    ecs_thread_read_count --;
+#endif
+}
+
+/* Start a new read epoch. While the world is staged, the main storage does not
+ * change structurally, which allows other threads to read from it. */
+static
+void read_epoch_begin(
+    ecs_world_t *world)
+{
+    if (world->locking_enabled) {
+        ecs_os_mutex_lock(world->read_mutex);
+        world->read_epoch ++;
+        world->read_enabled = true;
+        ecs_os_cond_broadcast(world->read_cond);
+        ecs_os_mutex_unlock(world->read_mutex);
+    }
+}
+
+/* End the read epoch, and wait until all readers have released the world
+ * before it is modified by a merge. */
+static
+void read_epoch_end(
+    ecs_world_t *world)
+{
+    if (world->locking_enabled) {
+        ecs_os_mutex_lock(world->read_mutex);
+        world->read_enabled = false;
+        while (world->read_count) {
+            ecs_os_cond_wait(world->read_cond, world->read_mutex);
+        }
+        ecs_os_mutex_unlock(world->read_mutex);
+    }
+}
+
 ecs_c_info_t * ecs_get_c_info(
     ecs_world_t *world,
     ecs_entity_t component)
@@ -870,11 +1394,38 @@ ecs_c_info_t * ecs_get_or_create_c_info(
     return c_info;
 }
 
+ecs_c_info_t * ecs_get_sparse_c_info(
+    ecs_world_t *world,
+    ecs_entity_t component)
+{
+    if (!world->sparse_components || !component ||
+        (component & ECS_ROLE_MASK))
+    {
+        return NULL;
+    }
+
+    ecs_c_info_t *c_info = ecs_get_c_info(world, component);
+    if (c_info && c_info->sparse) {
+        return c_info;
+    }
+
+    return NULL;
+}
+
 bool ecs_staging_begin(
     ecs_world_t *world)
 {
     bool in_progress = world->in_progress;
     world->in_progress = true;
+
+    if (!in_progress) {
+        if (world->locking_enabled) {
+            ecs_query_sort_postponed(world);
+        }
+
+        read_epoch_begin(world);
+    }
+
     return in_progress;
 }
 
@@ -883,6 +1434,8 @@ void ecs_staging_end(
 {
     ecs_assert(world->in_progress == true, ECS_INVALID_OPERATION, NULL);
 
+    read_epoch_end(world);
+
     world->in_progress = false;
     if (world->auto_merge) {
         ecs_merge(world);
@@ -1028,6 +1581,8 @@ float ecs_frame_begin(
         ecs_lock(world);
     }
 
+    world->frame_span = ecs_span_begin(world);
+
     /* Start measuring total frame time */
     float delta_time = start_measure_frame(world, user_delta_time);
     if (user_delta_time == 0) {
@@ -1040,6 +1595,11 @@ float ecs_frame_begin(
     /* Keep track of total scaled time passed in world */
     world->stats.world_time_total += world->stats.delta_time;
 
+#ifdef FLECS_COMMAND_QUEUE
+    /* Apply commands from other threads before the pipeline runs */
+    ecs_command_queues_flush(world);
+#endif
+
     return user_delta_time;
 }
 
@@ -1057,6 +1617,22 @@ void ecs_frame_end(
         ecs_stage_merge_post_frame(world, stage);
     });        
 
+    /* Values written in this frame become the previous frame values */
+    if (world->double_buffered_count) {
+        ecs_sparse_t *tables = world->store.tables;
+        int32_t i, count = ecs_sparse_count(tables);
+        for (i = 0; i < count; i ++) {
+            ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+            if (table->flags & EcsTableHasPrev) {
+                ecs_table_update_prev(table);
+            }
+        }
+    }
+
+    if (world->table_gc_frames) {
+        ecs_gc(world);
+    }
+
     if (world->locking_enabled) {
         ecs_unlock(world);
 
@@ -1066,6 +1642,9 @@ void ecs_frame_end(
     }
 
     stop_measure_frame(world);
+
+    ecs_span_end(world, &world->stage, EcsSpanFrame, 0, world->frame_span);
+    world->frame_span = 0;
 }
 
 const ecs_world_info_t* ecs_get_world_info(
@@ -1086,6 +1665,93 @@ void ecs_notify_queries(
     }    
 }
 
+static
+bool is_scope_table(
+    ecs_world_t *world,
+    ecs_table_t *table)
+{
+    if (world->stage.scope_table == table || 
+        world->temp_stage.scope_table == table) 
+    {
+        return true;
+    }
+
+    ecs_vector_each(world->worker_stages, ecs_stage_t, stage, {
+        if (stage->scope_table == table) {
+            return true;
+        }
+    });
+
+    return false;
+}
+
+void ecs_set_table_gc(
+    ecs_world_t *world,
+    int32_t empty_frames)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(empty_frames >= 0, ECS_INVALID_PARAMETER, NULL);
+    world->table_gc_frames = empty_frames;
+}
+
+int32_t ecs_gc(
+    ecs_world_t *world)
+{
+    ecs_assert(world->magic == ECS_WORLD_MAGIC, ECS_INVALID_FROM_WORKER, NULL);
+    ecs_assert(!world->in_progress, ECS_INVALID_WHILE_ITERATING, NULL);
+
+    /* Store frame + 1, so that 0 can be used for tables that are not empty */
+    int32_t frame = world->stats.frame_count_total + 1;
+    ecs_vector_t *garbage = NULL;
+
+    ecs_sparse_t *tables = world->store.tables;
+    int32_t i, count = ecs_sparse_count(tables);
+    for (i = 0; i < count; i ++) {
+        ecs_table_t *table = ecs_sparse_get(tables, ecs_table_t, i);
+        if (table->flags & EcsTableHasBuiltins) {
+            continue;
+        }
+
+        if (ecs_table_count(table)) {
+            table->gc_frame = 0;
+            continue;
+        }
+
+        if (!table->gc_frame) {
+            table->gc_frame = frame;
+        }
+
+        if (frame - table->gc_frame < world->table_gc_frames) {
+            continue;
+        }
+
+        if (is_scope_table(world, table)) {
+            continue;
+        }
+
+        table->flags |= EcsTableIsGarbage;
+        ecs_table_t **elem = ecs_vector_add(&garbage, ecs_table_t*);
+        *elem = table;
+    }
+
+    if (!garbage) {
+        return 0;
+    }
+
+    ecs_table_clear_garbage_edges(world);
+
+    ecs_table_t **buffer = ecs_vector_first(garbage, ecs_table_t*);
+    count = ecs_vector_count(garbage);
+    for (i = 0; i < count; i ++) {
+        ecs_table_unregister_child(world, buffer[i]);
+        ecs_delete_table(world, buffer[i]);
+    }
+
+    ecs_vector_free(garbage);
+
+    return count;
+}
+
 void ecs_delete_table(
     ecs_world_t *world,
     ecs_table_t *table)
@@ -1099,6 +1765,11 @@ void ecs_delete_table(
 
     uint32_t id = table->id;
 
+    world->stats.table_delete_count_total ++;
+
+    ecs_table_unregister_instance(world, table);
+    ecs_table_index_remove(world, table);
+
     /* Free resources associated with table */
     ecs_table_free(world, table);
 
@@ -0,0 +1,245 @@
+#include <api.h>
+
+void CommandQueue_setup() {
+    bake_set_os_api();
+    ecs_tracing_enable(-3);
+}
+
+void CommandQueue_add_remove() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Position);
+
+    ecs_command_queue_t *q = ecs_command_queue_new(world, 16);
+    test_assert(q != NULL);
+
+    ecs_command_add(q, e, Velocity);
+    ecs_command_remove(q, e, Position);
+    test_assert(ecs_has(world, e, Position));
+    test_assert(!ecs_has(world, e, Velocity));
+
+    test_int(ecs_command_queue_flush(q), 2);
+    test_assert(!ecs_has(world, e, Position));
+    test_assert(ecs_has(world, e, Velocity));
+
+    test_int(ecs_command_queue_flush(q), 0);
+
+    ecs_fini(world);
+}
+
+void CommandQueue_set() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_new(world, 0);
+
+    ecs_command_queue_t *q = ecs_command_queue_new(world, 16);
+    ecs_command_set(q, e, Position, {10, 20});
+    ecs_command_set(q, e, Position, {30, 40});
+    test_assert(!ecs_has(world, e, Position));
+
+    test_int(ecs_command_queue_flush(q), 2);
+
+    const Position *p = ecs_get(world, e, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    ecs_fini(world);
+}
+
+void CommandQueue_delete() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_new(world, Position);
+
+    ecs_command_queue_t *q = ecs_command_queue_new(world, 16);
+    ecs_command_delete(q, e);
+    ecs_command_set(q, e, Position, {10, 20});
+    test_assert(ecs_is_alive(world, e));
+
+    /* Set after delete is discarded */
+    ecs_command_queue_flush(q);
+    test_assert(!ecs_is_alive(world, e));
+    test_assert(!ecs_has(world, e, Position));
+
+    ecs_fini(world);
+}
+
+void CommandQueue_flush_in_progress() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_new(world, 0);
+
+    ecs_command_queue_t *q = ecs_command_queue_new(world, 16);
+    ecs_command_set(q, e, Position, {10, 20});
+
+    ecs_progress(world, 1);
+
+    const Position *p = ecs_get(world, e, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(world);
+}
+
+static
+void Count(ecs_iter_t *it) {
+    int32_t *count = ecs_get_context(it->world);
+    *count += it->count;
+}
+
+void CommandQueue_flush_before_systems() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Count, EcsOnUpdate, Position);
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+
+    ecs_command_queue_t *q = ecs_command_queue_new(world, 16);
+    ecs_command_add(q, ecs_new(world, 0), Position);
+    ecs_command_add(q, ecs_new(world, 0), Position);
+
+    ecs_progress(world, 1);
+    test_int(count, 2);
+
+    ecs_fini(world);
+}
+
+void CommandQueue_wrap() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_new(world, 0);
+
+    ecs_command_queue_t *q = ecs_command_queue_new(world, 2);
+
+    int32_t i;
+    for (i = 0; i < 10; i ++) {
+        ecs_command_set(q, e, Position, {(float)i, (float)i * 2});
+        ecs_command_set(q, e, Position, {(float)i * 2, (float)i});
+        test_int(ecs_command_queue_flush(q), 2);
+
+        const Position *p = ecs_get(world, e, Position);
+        test_int(p->x, i * 2);
+        test_int(p->y, i);
+    }
+
+    ecs_fini(world);
+}
+
+void CommandQueue_free_w_pending() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_new(world, 0);
+
+    ecs_command_queue_t *q = ecs_command_queue_new(world, 16);
+    ecs_command_set(q, e, Position, {10, 20});
+    ecs_command_queue_free(q);
+
+    ecs_progress(world, 1);
+    test_assert(!ecs_has(world, e, Position));
+
+    /* Queues that are not freed are freed by the world */
+    q = ecs_command_queue_new(world, 16);
+    ecs_command_set(q, e, Position, {10, 20});
+
+    ecs_fini(world);
+}
+
+#define PRODUCER_COUNT (4)
+#define PRODUCER_ENTITIES (100)
+#define PRODUCER_SETS (10)
+
+typedef struct Producer {
+    ecs_command_queue_t *queue;
+    ecs_entity_t component;
+    ecs_entity_t *entities;
+    int32_t *done;
+} Producer;
+
+static
+void* produce(void *arg) {
+    Producer *p = arg;
+
+    int32_t i, j;
+    for (j = 0; j < PRODUCER_SETS; j ++) {
+        for (i = 0; i < PRODUCER_ENTITIES; i ++) {
+            Position value = {(float)j, (float)i};
+            ecs_command_set_ptr_w_entity(p->queue, p->entities[i], 
+                p->component, sizeof(Position), &value);
+        }
+    }
+
+    ecs_os_ainc(p->done);
+
+    return NULL;
+}
+
+void CommandQueue_multiple_producers() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t entities[PRODUCER_COUNT][PRODUCER_ENTITIES];
+    int32_t i, j;
+    for (i = 0; i < PRODUCER_COUNT; i ++) {
+        for (j = 0; j < PRODUCER_ENTITIES; j ++) {
+            entities[i][j] = ecs_new(world, 0);
+        }
+    }
+
+    /* Use a small queue, so that producers have to wait for the world */
+    ecs_command_queue_t *q = ecs_command_queue_new(world, 64);
+
+    int32_t done = 0;
+    Producer producers[PRODUCER_COUNT];
+    ecs_os_thread_t threads[PRODUCER_COUNT];
+    for (i = 0; i < PRODUCER_COUNT; i ++) {
+        producers[i] = (Producer){
+            .queue = q,
+            .component = ecs_typeid(Position),
+            .entities = entities[i],
+            .done = &done
+        };
+        threads[i] = ecs_os_thread_new(produce, &producers[i]);
+    }
+
+    int32_t count = 0;
+    while (*(volatile int32_t*)&done != PRODUCER_COUNT) {
+        count += ecs_command_queue_flush(q);
+    }
+
+    for (i = 0; i < PRODUCER_COUNT; i ++) {
+        ecs_os_thread_join(threads[i]);
+    }
+
+    count += ecs_command_queue_flush(q);
+    test_int(count, PRODUCER_COUNT * PRODUCER_ENTITIES * PRODUCER_SETS);
+
+    /* Commands of a single producer are applied in order */
+    for (i = 0; i < PRODUCER_COUNT; i ++) {
+        for (j = 0; j < PRODUCER_ENTITIES; j ++) {
+            const Position *p = ecs_get(world, entities[i][j], Position);
+            test_assert(p != NULL);
+            test_int(p->x, PRODUCER_SETS - 1);
+            test_int(p->y, j);
+        }
+    }
+
+    ecs_fini(world);
+}
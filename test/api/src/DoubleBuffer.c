@@ -0,0 +1,292 @@
+#include <api.h>
+
+void DoubleBuffer_setup() {
+    ecs_tracing_enable(-3);
+}
+
+static
+const Position* get_prev(
+    ecs_query_t *q,
+    ecs_entity_t e)
+{
+    ecs_iter_t it = ecs_query_iter(q);
+    while (ecs_query_next(&it)) {
+        Position *p = ecs_column(&it, Position, 1);
+
+        int32_t i;
+        for (i = 0; i < it.count; i ++) {
+            if (it.entities[i] == e) {
+                return &p[i];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void DoubleBuffer_prev_zero_before_progress() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ecs_set_component_double_buffered(world, Position);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+
+    ecs_query_t *q = ecs_query_new(world, "[prev] Position");
+    const Position *p = get_prev(q, e);
+    test_assert(p != NULL);
+    test_int(p->x, 0);
+    test_int(p->y, 0);
+
+    ecs_fini(world);
+}
+
+void DoubleBuffer_prev_after_progress() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ecs_set_component_double_buffered(world, Position);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+
+    ecs_progress(world, 1);
+
+    ecs_set(world, e, Position, {30, 40});
+
+    ecs_query_t *q = ecs_query_new(world, "[prev] Position");
+    const Position *p = get_prev(q, e);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    /* Regular column still returns the current value */
+    p = ecs_get(world, e, Position);
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    ecs_progress(world, 1);
+
+    p = get_prev(q, e);
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    ecs_fini(world);
+}
+
+void DoubleBuffer_prev_is_readonly() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ecs_set_component_double_buffered(world, Position);
+
+    ecs_set(world, 0, Position, {10, 20});
+
+    ecs_query_t *q = ecs_query_new(world, "Position, [prev] Position");
+    ecs_iter_t it = ecs_query_iter(q);
+    test_assert(ecs_query_next(&it));
+    test_assert(!ecs_is_readonly(&it, 1));
+    test_assert(ecs_is_readonly(&it, 2));
+
+    /* Columns for the same component point to different buffers */
+    test_assert(ecs_column(&it, Position, 1) != ecs_column(&it, Position, 2));
+
+    ecs_fini(world);
+}
+
+void DoubleBuffer_prev_after_add() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ecs_set_component_double_buffered(world, Position);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_progress(world, 1);
+
+    /* Previous value is moved with the entity to the new table */
+    ecs_set(world, e, Position, {30, 40});
+    ecs_add(world, e, Velocity);
+
+    ecs_query_t *q = ecs_query_new(world, "[prev] Position");
+    const Position *p = get_prev(q, e);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_remove(world, e, Velocity);
+
+    p = get_prev(q, e);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(world);
+}
+
+void DoubleBuffer_prev_after_delete() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ecs_set_component_double_buffered(world, Position);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {30, 40});
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {50, 60});
+    ecs_progress(world, 1);
+
+    /* e3 is moved to the row of e1 */
+    ecs_delete(world, e1);
+
+    ecs_query_t *q = ecs_query_new(world, "[prev] Position");
+    const Position *p = get_prev(q, e3);
+    test_assert(p != NULL);
+    test_int(p->x, 50);
+    test_int(p->y, 60);
+
+    p = get_prev(q, e2);
+    test_assert(p != NULL);
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    ecs_fini(world);
+}
+
+void DoubleBuffer_prev_bulk_new() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ecs_set_component_double_buffered(world, Position);
+
+    const ecs_entity_t *ids = ecs_bulk_new(world, Position, 10);
+    test_assert(ids != NULL);
+
+    ecs_entity_t entities[10];
+    ecs_os_memcpy(entities, ids, ECS_SIZEOF(ecs_entity_t) * 10);
+
+    int32_t i;
+    for (i = 0; i < 10; i ++) {
+        ecs_set(world, entities[i], Position, {i, i * 2});
+    }
+
+    ecs_progress(world, 1);
+
+    ecs_query_t *q = ecs_query_new(world, "[prev] Position");
+    for (i = 0; i < 10; i ++) {
+        const Position *p = get_prev(q, entities[i]);
+        test_assert(p != NULL);
+        test_int(p->x, i);
+        test_int(p->y, i * 2);
+    }
+
+    ecs_fini(world);
+}
+
+static
+void Move(ecs_iter_t *it) {
+    Position *p = ecs_column(it, Position, 1);
+    Position *p_prev = ecs_column(it, Position, 2);
+    Velocity *v = ecs_column(it, Velocity, 3);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        p[i].x += 1;
+        p[i].y += 2;
+
+        /* Velocity is the distance travelled since the previous frame */
+        v[i].x = p[i].x - p_prev[i].x;
+        v[i].y = p[i].y - p_prev[i].y;
+    }
+}
+
+void DoubleBuffer_system_prev() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ecs_set_component_double_buffered(world, Position);
+
+    ECS_SYSTEM(world, Move, EcsOnUpdate, Position, [prev] Position, Velocity);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, e, Velocity, {0, 0});
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+
+    const Velocity *v = ecs_get(world, e, Velocity);
+    test_int(v->x, 1);
+    test_int(v->y, 2);
+
+    const Position *p = ecs_get(world, e, Position);
+    test_int(p->x, 12);
+    test_int(p->y, 24);
+
+    ecs_fini(world);
+}
+
+static
+void SetPosition(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, Position, 2);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_set(it->world, it->entities[i], Position, {1, 2});
+    }
+}
+
+static
+void ReadPosition(ecs_iter_t *it) {
+    int32_t *count = ecs_get_context(it->world);
+    (*count) += it->count;
+}
+
+void DoubleBuffer_prev_no_merge() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ecs_set_component_double_buffered(world, Position);
+
+    ECS_SYSTEM(world, SetPosition, EcsOnUpdate, Velocity, [out] :Position);
+    ECS_SYSTEM(world, ReadPosition, EcsOnUpdate, Velocity, [prev] Position);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, e, Velocity, {1, 2});
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+
+    /* Reading [prev] does not depend on the values written by the first
+     * system, so the pipeline does not insert a merge between the systems */
+    int32_t merge_count = ecs_get_world_info(world)->merge_count_total;
+    ecs_progress(world, 1);
+    test_int(ecs_get_world_info(world)->merge_count_total, merge_count + 1);
+    test_int(count, 1);
+
+    ecs_fini(world);
+}
+
+void DoubleBuffer_snapshot_restore() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ecs_set_component_double_buffered(world, Position);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_progress(world, 1);
+
+    ecs_snapshot_t *s = ecs_snapshot_take(world);
+
+    ecs_set(world, e, Position, {30, 40});
+    ecs_progress(world, 1);
+
+    ecs_snapshot_restore(world, s);
+
+    ecs_query_t *q = ecs_query_new(world, "[prev] Position");
+    const Position *p = get_prev(q, e);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(world);
+}
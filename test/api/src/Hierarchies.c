@@ -1254,3 +1254,266 @@ void Hierarchies_add_child_after_delete_tree() {
 
     ecs_fini(world);
 }
+
+void Hierarchies_childof_value_shares_table() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent_1 = ecs_new(world, 0);
+    ecs_entity_t parent_2 = ecs_new(world, 0);
+
+    ecs_entity_t child_1 = ecs_new(world, Position);
+    ecs_entity_t child_2 = ecs_new(world, Position);
+    ecs_set_parent(world, child_1, parent_1);
+    ecs_set_parent(world, child_2, parent_2);
+
+    test_assert(ecs_get_type(world, child_1) == ecs_get_type(world, child_2));
+    test_int(ecs_get_parent_w_entity(world, child_1, 0), parent_1);
+    test_int(ecs_get_parent_w_entity(world, child_2, 0), parent_2);
+
+    test_int(ecs_get_child_count(world, parent_1), 1);
+    test_int(ecs_get_child_count(world, parent_2), 1);
+
+    ecs_fini(world);
+}
+
+void Hierarchies_childof_value_scope_iter() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t other = ecs_new(world, 0);
+
+    ecs_entity_t child_1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t child_2 = ecs_set(world, 0, Position, {30, 40});
+    ecs_entity_t child_3 = ecs_set(world, 0, Position, {50, 60});
+    ecs_entity_t child_4 = ecs_new_w_entity(world, ECS_CHILDOF | parent);
+    ecs_set_parent(world, child_1, other);
+    ecs_set_parent(world, child_2, parent);
+    ecs_set_parent(world, child_3, parent);
+
+    test_int(ecs_get_child_count(world, parent), 3);
+
+    int32_t count = 0;
+    bool found_2 = false, found_3 = false, found_4 = false;
+
+    ecs_iter_t it = ecs_scope_iter(world, parent);
+    while (ecs_scope_next(&it)) {
+        int32_t index = ecs_table_component_index(&it, ecs_typeid(Position));
+        Position *p = NULL;
+        if (index != -1) {
+            p = ecs_table_column_w_offset(&it, index);
+        }
+
+        int32_t i;
+        for (i = 0; i < it.count; i ++) {
+            ecs_entity_t e = it.entities[i];
+            if (e == child_2) {
+                test_assert(p != NULL);
+                test_int(p[i].x, 30);
+                test_int(p[i].y, 40);
+                found_2 = true;
+            } else if (e == child_3) {
+                test_assert(p != NULL);
+                test_int(p[i].x, 50);
+                test_int(p[i].y, 60);
+                found_3 = true;
+            } else if (e == child_4) {
+                found_4 = true;
+            }
+            count ++;
+        }
+    }
+
+    test_int(count, 3);
+    test_assert(found_2);
+    test_assert(found_3);
+    test_assert(found_4);
+
+    ecs_fini(world);
+}
+
+void Hierarchies_childof_value_reparent() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent_1 = ecs_new(world, 0);
+    ecs_entity_t parent_2 = ecs_new(world, 0);
+    ecs_entity_t child = ecs_new(world, Position);
+
+    ecs_set_parent(world, child, parent_1);
+    test_int(ecs_get_child_count(world, parent_1), 1);
+
+    ecs_set_parent(world, child, parent_2);
+    test_int(ecs_get_child_count(world, parent_1), 0);
+    test_int(ecs_get_child_count(world, parent_2), 1);
+    test_int(ecs_get_parent_w_entity(world, child, 0), parent_2);
+
+    ecs_iter_t it = ecs_scope_iter(world, parent_1);
+    test_assert(!ecs_scope_next(&it));
+
+    ecs_set_parent(world, child, 0);
+    test_assert(!ecs_has(world, child, EcsChildOf));
+    test_int(ecs_get_child_count(world, parent_2), 0);
+    test_int(ecs_get_parent_w_entity(world, child, 0), 0);
+
+    /* Deleting a former parent does not delete the child */
+    ecs_delete(world, parent_1);
+    ecs_delete(world, parent_2);
+    test_assert(ecs_is_alive(world, child));
+
+    ecs_fini(world);
+}
+
+void Hierarchies_childof_value_delete_parent() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t child_1 = ecs_new(world, Position);
+    ecs_entity_t child_2 = ecs_new(world, Position);
+    ecs_entity_t grand_child = ecs_new(world, Position);
+    ecs_entity_t other = ecs_new(world, Position);
+    ecs_set_parent(world, child_1, parent);
+    ecs_set_parent(world, child_2, parent);
+    ecs_set_parent(world, grand_child, child_1);
+
+    ecs_delete(world, parent);
+
+    test_assert(!ecs_is_alive(world, parent));
+    test_assert(!ecs_is_alive(world, child_1));
+    test_assert(!ecs_is_alive(world, child_2));
+    test_assert(!ecs_is_alive(world, grand_child));
+    test_assert(ecs_is_alive(world, other));
+
+    ecs_fini(world);
+}
+
+void Hierarchies_childof_value_delete_child() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t child_1 = ecs_new(world, Position);
+    ecs_entity_t child_2 = ecs_new(world, Position);
+    ecs_set_parent(world, child_1, parent);
+    ecs_set_parent(world, child_2, parent);
+
+    ecs_delete(world, child_1);
+    test_int(ecs_get_child_count(world, parent), 1);
+
+    ecs_iter_t it = ecs_scope_iter(world, parent);
+    test_assert(ecs_scope_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], child_2);
+    test_assert(!ecs_scope_next(&it));
+
+    ecs_delete_children(world, parent);
+    test_assert(!ecs_is_alive(world, child_2));
+    test_int(ecs_get_child_count(world, parent), 0);
+
+    ecs_fini(world);
+}
+
+void Hierarchies_childof_value_lookup_path() {
+    ecs_world_t *world = ecs_init();
+
+    ecs_entity_t parent = ecs_set(world, 0, EcsName, {"Parent"});
+    ecs_entity_t child = ecs_set(world, 0, EcsName, {"Child"});
+    ecs_set_parent(world, child, parent);
+
+    test_int(ecs_lookup_child(world, parent, "Child"), child);
+    test_int(ecs_lookup_path(world, 0, "Parent.Child"), child);
+    test_int(ecs_lookup(world, "Child"), 0);
+
+    char *path = ecs_get_fullpath(world, child);
+    test_str(path, "Parent.Child");
+    ecs_os_free(path);
+
+    ecs_fini(world);
+}
+
+void Hierarchies_childof_value_snapshot_restore() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent_1 = ecs_new(world, 0);
+    ecs_entity_t parent_2 = ecs_new(world, 0);
+    ecs_entity_t child = ecs_new(world, Position);
+    ecs_set_parent(world, child, parent_1);
+
+    ecs_snapshot_t *s = ecs_snapshot_take(world);
+
+    ecs_set_parent(world, child, parent_2);
+    test_int(ecs_get_child_count(world, parent_1), 0);
+    test_int(ecs_get_child_count(world, parent_2), 1);
+
+    ecs_snapshot_restore(world, s);
+
+    test_int(ecs_get_child_count(world, parent_1), 1);
+    test_int(ecs_get_child_count(world, parent_2), 0);
+
+    ecs_delete(world, parent_1);
+    test_assert(!ecs_is_alive(world, child));
+
+    ecs_fini(world);
+}
+
+void Hierarchies_childof_value_table_column_w_offset() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t other = ecs_new(world, 0);
+    ecs_entity_t child_1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t child_2 = ecs_set(world, 0, Position, {30, 40});
+    ecs_set_parent(world, child_1, other);
+    ecs_set_parent(world, child_2, parent);
+
+    ecs_iter_t it = ecs_scope_iter(world, parent);
+    test_assert(ecs_scope_next(&it));
+    test_int(it.count, 1);
+    test_int(it.offset, 1);
+    test_int(it.entities[0], child_2);
+
+    int32_t index = ecs_table_component_index(&it, ecs_typeid(Position));
+    test_assert(index != -1);
+
+    /* ecs_table_column starts at the first row of the table */
+    Position *p = ecs_table_column(&it, index);
+    test_int(p[it.offset].x, 30);
+    test_int(p[it.offset].y, 40);
+
+    p = ecs_table_column_w_offset(&it, index);
+    test_int(p[0].x, 30);
+    test_int(p[0].y, 40);
+
+    test_assert(!ecs_scope_next(&it));
+
+    ecs_fini(world);
+}
+
+void Hierarchies_childof_value_not_inherited() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t base = ecs_new(world, Position);
+    ecs_set_parent(world, base, parent);
+
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | base);
+    test_assert(ecs_has(world, e, Position));
+    test_assert(ecs_get(world, e, EcsChildOf) == NULL);
+    test_int(ecs_get_parent_w_entity(world, e, 0), 0);
+    test_int(ecs_get_child_count(world, parent), 1);
+
+    ecs_fini(world);
+}
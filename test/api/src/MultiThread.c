@@ -876,3 +876,407 @@ void MultiThread_reactive_system() {
     ecs_fini(world);
 }
 
+
+static
+void ParIncrement(ecs_iter_t *it) {
+    ECS_COLUMN(it, Position, p, 1);
+    int32_t *chunk_size = it->param;
+
+    test_assert(it->count <= *chunk_size);
+
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        p[i].x ++;
+    }
+}
+
+static
+void par_iter_w_threads(
+    int32_t threads) 
+{
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t e[100];
+    int i;
+    for (i = 0; i < 100; i ++) {
+        e[i] = ecs_set(world, 0, Position, {0});
+
+        /* Second table */
+        if (i < 50) {
+            ecs_add(world, e[i], Velocity);
+        }
+    }
+
+    if (threads) {
+        ecs_set_threads(world, threads);
+    }
+
+    ecs_query_t *q = ecs_query_new(world, "Position");
+
+    int32_t chunk_size = 7;
+    ecs_query_par_iter(q, ParIncrement, chunk_size, &chunk_size);
+
+    for (i = 0; i < 100; i ++) {
+        test_int(ecs_get(world, e[i], Position)->x, 1);
+    }
+
+    ecs_query_par_iter(q, ParIncrement, chunk_size, &chunk_size);
+
+    for (i = 0; i < 100; i ++) {
+        test_int(ecs_get(world, e[i], Position)->x, 2);
+    }
+
+    ecs_fini(world);
+}
+
+void MultiThread_par_iter_no_threads() {
+    par_iter_w_threads(0);
+}
+
+void MultiThread_par_iter_2_threads() {
+    par_iter_w_threads(2);
+}
+
+void MultiThread_par_iter_4_threads() {
+    par_iter_w_threads(4);
+}
+
+static
+void ParAddVelocity(ecs_iter_t *it) {
+    ecs_entity_t ecs_typeid(Velocity) = *(ecs_entity_t*)it->param;
+
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_set(it->world, it->entities[i], Velocity, {1, 2});
+    }
+}
+
+void MultiThread_par_iter_deferred() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_bulk_new(world, Position, 20);
+    ecs_set_threads(world, 3);
+
+    ecs_query_t *q = ecs_query_new(world, "Position, !Velocity");
+    ecs_query_par_iter(q, ParAddVelocity, 4, &ecs_typeid(Velocity));
+
+    /* Deferred operations are merged before the operation returns */
+    ecs_iter_t it = ecs_query_iter(q);
+    test_assert(!ecs_query_next(&it));
+
+    q = ecs_query_new(world, "Position, Velocity");
+    it = ecs_query_iter(q);
+    int32_t count = 0;
+    while (ecs_query_next(&it)) {
+        Velocity *v = ecs_column(&it, Velocity, 2);
+        int i;
+        for (i = 0; i < it.count; i ++) {
+            test_int(v[i].x, 1);
+            test_int(v[i].y, 2);
+        }
+        count += it.count;
+    }
+    test_int(count, 20);
+
+    ecs_fini(world);
+}
+
+void MultiThread_par_iter_progress() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Progress, EcsOnUpdate, Position);
+
+    ecs_entity_t e[10];
+    int i;
+    for (i = 0; i < 10; i ++) {
+        e[i] = ecs_set(world, 0, Position, {0});
+    }
+
+    ecs_set_threads(world, 2);
+    ecs_progress(world, 0);
+
+    /* Parallel query in between frames uses the same workers */
+    int32_t chunk_size = 3;
+    ecs_query_t *q = ecs_query_new(world, "Position");
+    ecs_query_par_iter(q, ParIncrement, chunk_size, &chunk_size);
+
+    ecs_progress(world, 0);
+
+    for (i = 0; i < 10; i ++) {
+        test_int(ecs_get(world, e[i], Position)->x, 3);
+    }
+
+    ecs_fini(world);
+}
+
+typedef struct ReadCtx {
+    ecs_world_t *world;
+    ecs_entity_t entity;
+    ecs_entity_t component;
+    ecs_query_t *query;
+    int32_t epoch;
+    int32_t count;
+    float x;
+} ReadCtx;
+
+static
+void* read_thread(void *arg) {
+    ReadCtx *ctx = arg;
+    ecs_world_t *world = ctx->world;
+
+    ctx->epoch = ecs_read_begin(world);
+
+    const Position *p = ecs_get_w_entity(world, ctx->entity, ctx->component);
+    if (p) {
+        ctx->x = p->x;
+    }
+
+    if (ctx->query) {
+        ecs_iter_t it = ecs_query_iter(ctx->query);
+        while (ecs_query_next(&it)) {
+            ctx->count += it.count;
+        }
+    }
+
+    ecs_read_end(world);
+
+    return NULL;
+}
+
+/* Start reader from within a system. The reader would never be able to read
+ * the world if it had to wait for the frame to end. */
+static
+void StartReader(ecs_iter_t *it) {
+    ReadCtx *ctx = ecs_get_context(it->world);
+    ecs_os_thread_t thr = ecs_os_thread_new(read_thread, ctx);
+    ecs_os_thread_join(thr);
+}
+
+void MultiThread_read_in_progress() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, StartReader, EcsOnUpdate, :Position);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, 0, Position, {30, 40});
+
+    ecs_enable_locking(world, true);
+
+    ReadCtx ctx = {
+        .world = world,
+        .entity = e,
+        .component = ecs_typeid(Position),
+        .query = ecs_query_new(world, "Position")
+    };
+    ecs_set_context(world, &ctx);
+
+    ecs_progress(world, 1);
+
+    test_assert(ctx.epoch != 0);
+    test_flt(ctx.x, 10);
+    test_int(ctx.count, 2);
+
+    ecs_fini(world);
+}
+
+void MultiThread_read_epoch_per_merge() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, StartReader, EcsOnUpdate, :Position);
+
+    ecs_enable_locking(world, true);
+
+    ReadCtx ctx = { .world = world, .component = ecs_typeid(Position) };
+    ecs_set_context(world, &ctx);
+
+    ecs_progress(world, 1);
+    int32_t epoch = ctx.epoch;
+    test_assert(epoch != 0);
+
+    ecs_progress(world, 1);
+    test_assert(ctx.epoch > epoch);
+
+    ecs_fini(world);
+}
+
+void MultiThread_read_wait_for_progress() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+
+    ecs_enable_locking(world, true);
+
+    ReadCtx ctx = {
+        .world = world,
+        .entity = e,
+        .component = ecs_typeid(Position)
+    };
+
+    /* The world is not readable between frames, so the reader waits until
+     * the world is progressed */
+    ecs_os_thread_t thr = ecs_os_thread_new(read_thread, &ctx);
+
+    ecs_set(world, e, Position, {30, 40});
+
+    while (!*(volatile int32_t*)&ctx.epoch) {
+        ecs_progress(world, 1);
+    }
+
+    ecs_os_thread_join(thr);
+
+    test_flt(ctx.x, 30);
+
+    ecs_fini(world);
+}
+
+static
+void AllocAddVelocity(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, Velocity, 2);
+
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_set(it->world, it->entities[i], Velocity, {1, 2});
+    }
+}
+
+void MultiThread_alloc_tags_balanced() {
+    ecs_alloc_tag_stats_t before[EcsAllocTagCount];
+    ecs_os_memcpy(before, ecs_os_api_alloc_tags, ECS_SIZEOF(before));
+
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ECS_SYSTEM(world, AllocAddVelocity, EcsOnUpdate, Position, :Velocity);
+
+    ecs_bulk_new(world, Position, 1000);
+
+    ecs_set_threads(world, 4);
+
+    ecs_progress(world, 1);
+    test_int(ecs_count(world, Velocity), 1000);
+
+    /* Allocations of worker threads are added to the counters on merge */
+    test_assert(ecs_os_api_alloc_tags[EcsAllocDefer].alloc_count > 
+        before[EcsAllocDefer].alloc_count);
+
+    ecs_fini(world);
+
+    int i;
+    for (i = 0; i < EcsAllocTagCount; i ++) {
+        test_int(ecs_os_api_alloc_tags[i].bytes, before[i].bytes);
+    }
+}
+
+void MultiThread_read_query_no_side_effects() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, StartReader, EcsOnUpdate, :Position);
+
+    ecs_set(world, 0, Position, {10, 20});
+
+    ecs_enable_locking(world, true);
+
+    ReadCtx ctx = {
+        .world = world,
+        .component = ecs_typeid(Position),
+        .query = ecs_query_new(world, "Position")
+    };
+    ecs_set_context(world, &ctx);
+
+    test_assert(ecs_query_changed(ctx.query) == true);
+
+    ecs_progress(world, 1);
+    test_int(ctx.count, 1);
+
+    /* The reader iterated the query, which must not reset its change state */
+    test_assert(ecs_query_changed(ctx.query) == true);
+
+    ecs_fini(world);
+}
+
+static
+int compare_position_x(
+    ecs_entity_t e1,
+    void *ptr1,
+    ecs_entity_t e2,
+    void *ptr2)
+{
+    Position *p1 = ptr1;
+    Position *p2 = ptr2;
+    return (p1->x > p2->x) - (p1->x < p2->x);
+}
+
+typedef struct {
+    ecs_query_t *query;
+    ecs_entity_t entities[3];
+    int32_t count;
+} SortCtx;
+
+static
+void IterSorted(ecs_iter_t *it) {
+    SortCtx *ctx = ecs_get_context(it->world);
+    ctx->count = 0;
+
+    ecs_iter_t qit = ecs_query_iter(ctx->query);
+    while (ecs_query_next(&qit)) {
+        int32_t i;
+        for (i = 0; i < qit.count; i ++) {
+            test_assert(ctx->count < 3);
+            ctx->entities[ctx->count ++] = qit.entities[i];
+        }
+    }
+}
+
+void MultiThread_sort_postponed_while_readable() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, IterSorted, EcsOnUpdate, :Position);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {3, 0});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {1, 0});
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {2, 0});
+
+    SortCtx ctx = { .query = ecs_query_new(world, "Position") };
+    ecs_query_order_by(world, ctx.query, ecs_typeid(Position),
+        compare_position_x);
+    ecs_set_context(world, &ctx);
+
+    ecs_enable_locking(world, true);
+
+    ecs_set(world, e2, Position, {4, 0});
+
+    /* Tables are not sorted while other threads may read the world */
+    ecs_progress(world, 1);
+    test_int(ctx.count, 3);
+    test_int(ctx.entities[0], e2);
+    test_int(ctx.entities[1], e3);
+    test_int(ctx.entities[2], e1);
+    test_int(ecs_get(world, e2, Position)->x, 4);
+
+    /* Tables are sorted before the next frame becomes readable */
+    ecs_progress(world, 1);
+    test_int(ctx.count, 3);
+    test_int(ctx.entities[0], e3);
+    test_int(ctx.entities[1], e1);
+    test_int(ctx.entities[2], e2);
+    test_int(ecs_get(world, e1, Position)->x, 3);
+    test_int(ecs_get(world, e2, Position)->x, 4);
+    test_int(ecs_get(world, e3, Position)->x, 2);
+
+    ecs_fini(world);
+}
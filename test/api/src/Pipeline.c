@@ -546,3 +546,84 @@ void Pipeline_switch_pipeline() {
 
     ecs_fini(world);
 }
+
+static ecs_entity_t run_order[200];
+static int32_t run_count;
+
+static
+void SysRecord(ecs_iter_t *it) {
+    run_order[run_count ++] = it->system;
+}
+
+void Pipeline_many_systems_in_order() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_ENTITY(world, E, Position);
+
+    /* Alternate between phases, so systems are not created in run order */
+    ecs_entity_t systems[200];
+    int32_t i;
+    for (i = 0; i < 200; i ++) {
+        ecs_entity_t phase = i % 2 ? EcsOnUpdate : EcsPreUpdate;
+        systems[i] = ecs_new_system(
+            world, 0, NULL, phase, "Position", SysRecord);
+        test_assert(systems[i] != 0);
+    }
+
+    const ecs_world_info_t *stats = ecs_get_world_info(world);
+
+    ecs_progress(world, 1);
+    test_int(stats->systems_ran_frame, 200);
+    test_int(stats->merge_count_total, 1);
+    test_int(run_count, 200);
+
+    for (i = 0; i < 100; i ++) {
+        test_int(run_order[i], systems[i * 2]);
+        test_int(run_order[i + 100], systems[i * 2 + 1]);
+    }
+
+    run_count = 0;
+    ecs_progress(world, 1);
+    test_int(run_count, 200);
+    test_int(stats->pipeline_build_count_total, 1);
+
+    ecs_fini(world);
+}
+
+static ecs_entity_t disable_other;
+
+static
+void SysDisableOther(ecs_iter_t *it) {
+    ecs_enable(it->world, disable_other, false);
+    sys_a_invoked ++;
+}
+
+void Pipeline_disable_system_in_system() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_ENTITY(world, E, Position);
+
+    ECS_SYSTEM(world, SysDisableOther, EcsOnUpdate, Position);
+    ECS_SYSTEM(world, SysB, EcsOnUpdate, Position);
+    ECS_SYSTEM(world, SysC, EcsOnUpdate, Position);
+
+    disable_other = SysC;
+
+    ecs_progress(world, 1);
+    test_int(sys_a_invoked, 1);
+    test_int(sys_b_invoked, 1);
+
+    /* System is disabled when the frame is merged */
+    test_int(sys_c_invoked, 1);
+
+    ecs_progress(world, 1);
+    test_int(sys_a_invoked, 2);
+    test_int(sys_b_invoked, 2);
+    test_int(sys_c_invoked, 1);
+
+    ecs_fini(world);
+}
@@ -2886,3 +2886,339 @@ void Prefab_override_2_prefabs() {
 
     ecs_fini(world);
 }
+
+void Prefab_get_inherited_after_base_move() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t base = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | base);
+
+    const Position *p = ecs_get(world, e, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    /* Move base to another table */
+    ecs_add(world, base, Velocity);
+    ecs_set(world, base, Position, {30, 40});
+
+    p = ecs_get(world, e, Position);
+    test_assert(p != NULL);
+    test_assert(p == ecs_get(world, base, Position));
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    ecs_fini(world);
+}
+
+void Prefab_get_inherited_after_base_override() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t base_of_base = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t base = ecs_new_w_entity(world, ECS_INSTANCEOF | base_of_base);
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | base);
+
+    const Position *p = ecs_get(world, e, Position);
+    test_assert(p != NULL);
+    test_assert(p == ecs_get(world, base_of_base, Position));
+
+    /* Base now provides its own component */
+    ecs_set(world, base, Position, {30, 40});
+
+    p = ecs_get(world, e, Position);
+    test_assert(p != NULL);
+    test_assert(p == ecs_get(world, base, Position));
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    ecs_fini(world);
+}
+
+void Prefab_get_inherited_after_base_remove() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t base = ecs_new(world, 0);
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | base);
+
+    test_assert(ecs_get(world, e, Position) == NULL);
+
+    ecs_set(world, base, Position, {10, 20});
+
+    const Position *p = ecs_get(world, e, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_remove(world, base, Position);
+    test_assert(ecs_get(world, e, Position) == NULL);
+
+    ecs_fini(world);
+}
+
+void Prefab_get_inherited_after_base_delete() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t base = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | base);
+
+    test_assert(ecs_get(world, e, Position) != NULL);
+
+    ecs_delete(world, base);
+
+    /* Recycle id of base with different components */
+    ecs_entity_t other = ecs_set(world, 0, Position, {30, 40});
+    test_assert(other != 0);
+
+    test_assert(ecs_get(world, e, Position) == NULL);
+
+    ecs_fini(world);
+}
+
+static
+void GetInherited(ecs_iter_t *it) {
+    ecs_entity_t ecs_typeid(Position) = ecs_column_entity(it, 1);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        const Position *p = ecs_get(it->world, it->entities[i], Position);
+        test_assert(p != NULL);
+        test_int(p->x, 10);
+        test_int(p->y, 20);
+    }
+}
+
+void Prefab_get_inherited_from_system() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, GetInherited, EcsOnUpdate, SHARED:Position);
+
+    ecs_entity_t base = ecs_set(world, 0, Position, {10, 20});
+    ecs_bulk_new_w_entity(world, ECS_INSTANCEOF | base, 10);
+
+    ecs_progress(world, 1);
+
+    ecs_set(world, base, Position, {30, 40});
+    ecs_set(world, base, Position, {10, 20});
+
+    ecs_progress(world, 1);
+
+    ecs_fini(world);
+}
+
+static
+ecs_entity_t new_childof_prefab(
+    ecs_world_t *world,
+    ecs_entity_t parent,
+    ecs_entity_t ecs_typeid(Position),
+    float x)
+{
+    ecs_entity_t e = ecs_new_w_entity(world, EcsPrefab);
+    ecs_set(world, e, Position, {x, x + 1});
+    ecs_set_parent(world, e, parent);
+    return e;
+}
+
+void Prefab_instantiate_childof_children() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_PREFAB(world, Base, 0);
+    new_childof_prefab(world, Base, ecs_typeid(Position), 10);
+    new_childof_prefab(world, Base, ecs_typeid(Position), 20);
+
+    const ecs_entity_t *ids = ecs_bulk_new_w_entity(
+        world, ECS_INSTANCEOF | Base, 3);
+    test_assert(ids != NULL);
+
+    ecs_entity_t instances[3];
+    ecs_os_memcpy(instances, ids, ECS_SIZEOF(ecs_entity_t) * 3);
+
+    ecs_type_t child_type = NULL;
+
+    int32_t i;
+    for (i = 0; i < 3; i ++) {
+        ecs_entity_t inst = instances[i];
+        test_int(ecs_get_child_count(world, inst), 2);
+
+        float sum = 0;
+        ecs_iter_t it = ecs_scope_iter(world, inst);
+        while (ecs_scope_next(&it)) {
+            int32_t j;
+            for (j = 0; j < it.count; j ++) {
+                ecs_entity_t child = it.entities[j];
+                test_assert(!ecs_has_entity(world, child, EcsPrefab));
+                test_int(ecs_get_parent_w_entity(world, child, 0), inst);
+
+                /* Children of all instances share the same table */
+                if (!child_type) {
+                    child_type = ecs_get_type(world, child);
+                }
+                test_assert(ecs_get_type(world, child) == child_type);
+
+                const Position *p = ecs_get(world, child, Position);
+                test_assert(p != NULL);
+                test_int(p->y, p->x + 1);
+                sum += p->x;
+            }
+        }
+
+        test_int(sum, 30);
+    }
+
+    ecs_fini(world);
+}
+
+void Prefab_instantiate_childof_nested() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_PREFAB(world, Base, 0);
+    ecs_entity_t child = new_childof_prefab(world, Base, ecs_typeid(Position), 10);
+    new_childof_prefab(world, child, ecs_typeid(Position), 20);
+
+    const ecs_entity_t *ids = ecs_bulk_new_w_entity(
+        world, ECS_INSTANCEOF | Base, 2);
+    test_assert(ids != NULL);
+
+    ecs_entity_t instances[2];
+    ecs_os_memcpy(instances, ids, ECS_SIZEOF(ecs_entity_t) * 2);
+
+    int32_t i;
+    for (i = 0; i < 2; i ++) {
+        ecs_iter_t it = ecs_scope_iter(world, instances[i]);
+        test_assert(ecs_scope_next(&it));
+        test_int(it.count, 1);
+        ecs_entity_t inst_child = it.entities[0];
+        test_assert(!ecs_scope_next(&it));
+
+        const Position *p = ecs_get(world, inst_child, Position);
+        test_assert(p != NULL);
+        test_int(p->x, 10);
+
+        it = ecs_scope_iter(world, inst_child);
+        test_assert(ecs_scope_next(&it));
+        test_int(it.count, 1);
+        ecs_entity_t inst_grand_child = it.entities[0];
+        test_assert(!ecs_scope_next(&it));
+
+        test_int(ecs_get_parent_w_entity(world, inst_grand_child, 0), 
+            inst_child);
+
+        p = ecs_get(world, inst_grand_child, Position);
+        test_assert(p != NULL);
+        test_int(p->x, 20);
+    }
+
+    ecs_fini(world);
+}
+
+void Prefab_instantiate_childof_mixed() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_PREFAB(world, Base, 0);
+    ECS_ENTITY(world, Child, CHILDOF | Base, Position);
+    new_childof_prefab(world, Base, ecs_typeid(Position), 10);
+
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | Base);
+    test_int(ecs_get_child_count(world, e), 2);
+
+    ecs_fini(world);
+}
+
+void Prefab_instantiate_childof_delete_instance() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_PREFAB(world, Base, 0);
+    new_childof_prefab(world, Base, ecs_typeid(Position), 10);
+
+    ecs_entity_t e_1 = ecs_new_w_entity(world, ECS_INSTANCEOF | Base);
+    ecs_entity_t e_2 = ecs_new_w_entity(world, ECS_INSTANCEOF | Base);
+
+    ecs_iter_t it = ecs_scope_iter(world, e_1);
+    test_assert(ecs_scope_next(&it));
+    ecs_entity_t child_1 = it.entities[0];
+
+    it = ecs_scope_iter(world, e_2);
+    test_assert(ecs_scope_next(&it));
+    ecs_entity_t child_2 = it.entities[0];
+
+    ecs_delete(world, e_1);
+    test_assert(!ecs_is_alive(world, child_1));
+    test_assert(ecs_is_alive(world, child_2));
+
+    const Position *p = ecs_get(world, child_2, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+
+    ecs_fini(world);
+}
+
+void Prefab_get_inherited_after_nested_base_add() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t base_1 = ecs_new(world, Velocity);
+    ecs_entity_t base_2 = ecs_new_w_entity(world, ECS_INSTANCEOF | base_1);
+    ecs_entity_t other = ecs_set(world, 0, Position, {50, 60});
+    ecs_entity_t e_1 = ecs_new_w_entity(world, ECS_INSTANCEOF | base_2);
+    ecs_entity_t e_2 = ecs_new_w_entity(world, ECS_INSTANCEOF | other);
+
+    /* Cache a miss for the instance of the nested base */
+    test_assert(ecs_get(world, e_1, Position) == NULL);
+    test_assert(ecs_get(world, e_2, Position) != NULL);
+
+    ecs_set(world, base_1, Position, {10, 20});
+
+    const Position *p = ecs_get(world, e_1, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    p = ecs_get(world, e_2, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 50);
+    test_int(p->y, 60);
+
+    ecs_fini(world);
+}
+
+void Prefab_get_inherited_after_base_bulk_delete() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_TAG(world, Tag);
+
+    ecs_entity_t base = ecs_set(world, 0, Position, {10, 20});
+    ecs_add(world, base, Tag);
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | base);
+
+    test_assert(ecs_get(world, e, Position) != NULL);
+
+    ecs_bulk_delete(world, &(ecs_filter_t){
+        .include = ecs_type(Tag)
+    });
+
+    test_assert(!ecs_is_alive(world, base));
+    test_assert(ecs_get(world, e, Position) == NULL);
+
+    ecs_fini(world);
+}
@@ -0,0 +1,378 @@
+#include <api.h>
+
+void Profiler_setup() {
+    bake_set_os_api();
+    ecs_tracing_enable(-3);
+}
+
+static
+void Dummy(ecs_iter_t *it) {
+    ECS_COLUMN(it, Position, p, 1);
+
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        p[i].x ++;
+    }
+}
+
+static
+int32_t count_spans(
+    ecs_world_t *world,
+    int32_t thread,
+    ecs_span_kind_t kind,
+    ecs_entity_t id)
+{
+    int32_t i, count = ecs_profiler_span_count(world, thread);
+    int32_t result = 0;
+    for (i = 0; i < count; i ++) {
+        const ecs_span_t *span = ecs_profiler_get_span(world, thread, i);
+        test_assert(span != NULL);
+        if (span->kind == kind && (!id || span->id == id)) {
+            test_int(span->thread, thread);
+            result ++;
+        }
+    }
+    return result;
+}
+
+void Profiler_disabled_by_default() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+    ecs_progress(world, 1);
+
+    test_bool(ecs_profiler_is_enabled(world), false);
+    test_int(ecs_profiler_thread_count(world), 0);
+    test_int(ecs_profiler_span_count(world, 0), 0);
+
+    ecs_fini(world);
+}
+
+void Profiler_enable_disable() {
+    ecs_world_t *world = ecs_init();
+
+    ecs_profiler_enable(world, 100);
+    test_bool(ecs_profiler_is_enabled(world), true);
+    test_int(ecs_profiler_thread_count(world), 1);
+    test_int(ecs_profiler_span_count(world, 0), 0);
+
+    ecs_profiler_enable(world, 0);
+    test_bool(ecs_profiler_is_enabled(world), false);
+    test_int(ecs_profiler_thread_count(world), 0);
+
+    /* Enable again, profiler should be cleaned up by ecs_fini */
+    ecs_profiler_enable(world, 100);
+    test_bool(ecs_profiler_is_enabled(world), true);
+
+    ecs_fini(world);
+}
+
+void Profiler_enable_disable_n_times() {
+    ecs_world_t *world = ecs_init();
+
+    int i;
+    for (i = 0; i < 10; i ++) {
+        ecs_profiler_enable(world, 100);
+        test_bool(ecs_profiler_is_enabled(world), true);
+
+        ecs_progress(world, 1);
+        test_assert(ecs_profiler_span_count(world, 0) != 0);
+
+        ecs_profiler_enable(world, 0);
+        test_bool(ecs_profiler_is_enabled(world), false);
+    }
+
+    ecs_profiler_enable(world, 100);
+    test_bool(ecs_profiler_is_enabled(world), true);
+
+    ecs_fini(world);
+}
+
+void Profiler_record_frame() {
+    ecs_world_t *world = ecs_init();
+
+    ecs_profiler_enable(world, 100);
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+
+    test_int(count_spans(world, 0, EcsSpanFrame, 0), 2);
+
+    const ecs_span_t *first = NULL, *second = NULL;
+    int32_t i, count = ecs_profiler_span_count(world, 0);
+    for (i = 0; i < count; i ++) {
+        const ecs_span_t *span = ecs_profiler_get_span(world, 0, i);
+        if (span->kind == EcsSpanFrame) {
+            if (!first) {
+                first = span;
+            } else {
+                second = span;
+            }
+        }
+    }
+
+    test_assert(first != NULL);
+    test_assert(second != NULL);
+    test_assert(second->start >= first->start + first->duration);
+
+    ecs_fini(world);
+}
+
+void Profiler_record_system() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_profiler_enable(world, 100);
+
+    ecs_progress(world, 1);
+    test_int(count_spans(world, 0, EcsSpanSystem, Dummy), 1);
+
+    ecs_progress(world, 1);
+    test_int(count_spans(world, 0, EcsSpanSystem, Dummy), 2);
+
+    ecs_run(world, Dummy, 1, NULL);
+    test_int(count_spans(world, 0, EcsSpanSystem, Dummy), 3);
+
+    ecs_fini(world);
+}
+
+void Profiler_record_merge() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_profiler_enable(world, 100);
+
+    ecs_progress(world, 1);
+    test_assert(count_spans(world, 0, EcsSpanMerge, 0) >= 1);
+
+    ecs_fini(world);
+}
+
+static
+void AddVelocity(ecs_iter_t *it) {
+    ECS_COLUMN_COMPONENT(it, Velocity, 2);
+
+    int i;
+    for (i = 0; i < it->count; i ++) {
+        ecs_add(it->world, it->entities[i], Velocity);
+    }
+}
+
+void Profiler_record_defer_flush() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_profiler_enable(world, 100);
+
+    ecs_entity_t e = ecs_new(world, 0);
+
+    /* Empty defer queue should not record a span */
+    ecs_defer_begin(world);
+    ecs_defer_end(world);
+    test_int(count_spans(world, 0, EcsSpanDeferFlush, 0), 0);
+
+    ecs_defer_begin(world);
+    ecs_add(world, e, Position);
+    ecs_add(world, e, Velocity);
+    ecs_defer_end(world);
+
+    test_int(count_spans(world, 0, EcsSpanDeferFlush, 0), 1);
+    test_assert(ecs_has(world, e, Position));
+    test_assert(ecs_has(world, e, Velocity));
+
+    ecs_fini(world);
+}
+
+void Profiler_record_pipeline_build() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_profiler_enable(world, 100);
+
+    ecs_progress(world, 1);
+    test_int(count_spans(world, 0, EcsSpanPipelineBuild, 0), 1);
+
+    /* Pipeline is not rebuilt if no systems were added */
+    ecs_progress(world, 1);
+    test_int(count_spans(world, 0, EcsSpanPipelineBuild, 0), 1);
+
+    ECS_SYSTEM(world, AddVelocity, EcsOnUpdate, Position, :Velocity);
+
+    ecs_progress(world, 1);
+    test_int(count_spans(world, 0, EcsSpanPipelineBuild, 0), 2);
+
+    ecs_fini(world);
+}
+
+void Profiler_record_table_create() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_profiler_enable(world, 100);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    test_assert(e != 0);
+
+    test_int(count_spans(world, 0, EcsSpanTableCreate, 0), 1);
+
+    ecs_table_t *table = ecs_table_from_str(world, "Position");
+    test_assert(table != NULL);
+
+    int32_t i, count = ecs_profiler_span_count(world, 0);
+    for (i = 0; i < count; i ++) {
+        const ecs_span_t *span = ecs_profiler_get_span(world, 0, i);
+        if (span->kind == EcsSpanTableCreate) {
+            test_assert(span->id != 0);
+        }
+    }
+
+    /* Table already exists */
+    ecs_new(world, Position);
+    test_int(count_spans(world, 0, EcsSpanTableCreate, 0), 1);
+
+    ecs_add(world, e, Velocity);
+    test_int(count_spans(world, 0, EcsSpanTableCreate, 0), 2);
+
+    ecs_fini(world);
+}
+
+void Profiler_ring_buffer_wraps() {
+    ecs_world_t *world = ecs_init();
+
+    /* Rounded up to 4 */
+    ecs_profiler_enable(world, 3);
+
+    int i;
+    for (i = 0; i < 10; i ++) {
+        ecs_progress(world, 1);
+    }
+
+    test_int(ecs_profiler_span_count(world, 0), 4);
+
+    /* Spans are recorded when they end, so end times should be in order */
+    const ecs_span_t *prev = ecs_profiler_get_span(world, 0, 0);
+    test_assert(prev != NULL);
+    for (i = 1; i < 4; i ++) {
+        const ecs_span_t *span = ecs_profiler_get_span(world, 0, i);
+        test_assert(span != NULL);
+        test_assert(span->start + span->duration >=
+            prev->start + prev->duration);
+        prev = span;
+    }
+
+    ecs_fini(world);
+}
+
+void Profiler_clear() {
+    ecs_world_t *world = ecs_init();
+
+    ecs_profiler_enable(world, 100);
+
+    ecs_progress(world, 1);
+    test_assert(ecs_profiler_span_count(world, 0) != 0);
+
+    ecs_profiler_clear(world);
+    test_int(ecs_profiler_span_count(world, 0), 0);
+    test_bool(ecs_profiler_is_enabled(world), true);
+
+    ecs_progress(world, 1);
+    test_int(count_spans(world, 0, EcsSpanFrame, 0), 1);
+
+    ecs_fini(world);
+}
+
+void Profiler_get_span_out_of_range() {
+    ecs_world_t *world = ecs_init();
+
+    test_assert(ecs_profiler_get_span(world, 0, 0) == NULL);
+
+    ecs_profiler_enable(world, 100);
+    ecs_progress(world, 1);
+
+    int32_t count = ecs_profiler_span_count(world, 0);
+    test_assert(count != 0);
+    test_assert(ecs_profiler_get_span(world, 0, count) == NULL);
+    test_assert(ecs_profiler_get_span(world, 0, -1) == NULL);
+    test_assert(ecs_profiler_get_span(world, 1, 0) == NULL);
+    test_assert(ecs_profiler_get_span(world, -1, 0) == NULL);
+
+    ecs_fini(world);
+}
+
+void Profiler_record_worker_threads() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, Position);
+
+    ecs_bulk_new(world, Position, 100);
+
+    ecs_profiler_enable(world, 100);
+    ecs_set_threads(world, 2);
+    test_int(ecs_profiler_thread_count(world), 3);
+
+    ecs_progress(world, 1);
+
+    test_int(count_spans(world, 0, EcsSpanFrame, 0), 1);
+    test_assert(count_spans(world, 0, EcsSpanSync, 0) >= 1);
+    test_int(count_spans(world, 1, EcsSpanSystem, Dummy), 1);
+    test_int(count_spans(world, 2, EcsSpanSystem, Dummy), 1);
+
+    ecs_fini(world);
+}
+
+void Profiler_to_json() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_profiler_enable(world, 100);
+    ecs_progress(world, 1);
+
+    char *json = ecs_profiler_to_json(world);
+    test_assert(json != NULL);
+
+    test_assert(!strncmp(json, "{\"traceEvents\":[", 16));
+    test_assert(json[strlen(json) - 1] == '}');
+    test_assert(strstr(json, "\"name\":\"thread_name\"") != NULL);
+    test_assert(strstr(json, "\"name\":\"Dummy\",\"cat\":\"system\"") != NULL);
+    test_assert(strstr(json, "\"cat\":\"frame\"") != NULL);
+    test_assert(strstr(json, "\"ph\":\"X\"") != NULL);
+
+    ecs_os_free(json);
+
+    ecs_fini(world);
+}
+
+void Profiler_to_json_disabled() {
+    ecs_world_t *world = ecs_init();
+
+    char *json = ecs_profiler_to_json(world);
+    test_str(json, "{\"traceEvents\":[]}");
+    ecs_os_free(json);
+
+    ecs_fini(world);
+}
@@ -1120,3 +1120,544 @@ void Queries_invalid_access_orphaned_query() {
 
     ecs_query_iter(sq);  
 }
+
+static
+int32_t query_count(
+    ecs_query_t *q)
+{
+    int32_t count = 0;
+    ecs_iter_t it = ecs_query_iter(q);
+    while (ecs_query_next(&it)) {
+        count += it.count;
+    }
+    return count;
+}
+
+void Queries_rematch_after_parent_add() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t parent_1 = ecs_new(world, 0);
+    ecs_entity_t parent_2 = ecs_new(world, 0);
+    ecs_entity_t child_1 = ecs_new_w_entity(world, ECS_CHILDOF | parent_1);
+    ecs_entity_t child_2 = ecs_new_w_entity(world, ECS_CHILDOF | parent_2);
+    ecs_add(world, child_1, Position);
+    ecs_add(world, child_2, Position);
+
+    ecs_query_t *q = ecs_query_new(world, "Position, PARENT:Velocity");
+    test_int(query_count(q), 0);
+
+    ecs_add(world, parent_1, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 1);
+
+    ecs_add(world, parent_2, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 2);
+
+    ecs_remove(world, parent_1, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 1);
+
+    ecs_iter_t it = ecs_query_iter(q);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], child_2);
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Queries_rematch_after_base_add() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ECS_PREFAB(world, Base, Position);
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | Base);
+    test_assert(e != 0);
+
+    ecs_query_t *q = ecs_query_new(world, "ANY:Position, SHARED:Velocity");
+    test_int(query_count(q), 0);
+
+    ecs_add(world, Base, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 1);
+
+    ecs_remove(world, Base, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 0);
+
+    ecs_fini(world);
+}
+
+void Queries_rematch_after_nested_base_add() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ECS_PREFAB(world, Base, Position);
+    ECS_PREFAB(world, SubBase, INSTANCEOF | Base);
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | SubBase);
+    test_assert(e != 0);
+
+    ecs_query_t *q = ecs_query_new(world, "ANY:Position, SHARED:Velocity");
+    test_int(query_count(q), 0);
+
+    ecs_add(world, Base, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 1);
+
+    ecs_remove(world, Base, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 0);
+
+    ecs_fini(world);
+}
+
+void Queries_rematch_after_grandparent_add() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t grandparent = ecs_new(world, 0);
+    ecs_entity_t parent = ecs_new_w_entity(world, ECS_CHILDOF | grandparent);
+    ecs_entity_t child = ecs_new_w_entity(world, ECS_CHILDOF | parent);
+    ecs_add(world, parent, Position);
+    ecs_add(world, child, Position);
+
+    ecs_query_t *q = ecs_query_new(world, "Position, CASCADE:Velocity");
+    test_int(query_count(q), 2);
+
+    /* Adding a component to the grandparent changes the depth of the child */
+    ecs_add(world, grandparent, Velocity);
+    ecs_add(world, parent, Velocity);
+    ecs_progress(world, 1);
+
+    ecs_iter_t it = ecs_query_iter(q);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], parent);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], child);
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Queries_rematch_after_source_add() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ECS_ENTITY(world, Source, 0);
+    ecs_new(world, Position);
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_add(world, e, Velocity);
+
+    ecs_query_t *q = ecs_query_new(world, "Position, Source:Velocity");
+    test_int(query_count(q), 0);
+
+    ecs_add(world, Source, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 2);
+
+    ecs_remove(world, Source, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 0);
+
+    ecs_fini(world);
+}
+
+void Queries_rematch_w_source_after_parent_add() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ECS_ENTITY(world, Source, Velocity);
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t child = ecs_new_w_entity(world, ECS_CHILDOF | parent);
+    ecs_add(world, child, Position);
+    ecs_new(world, Position);
+
+    ecs_query_t *q = ecs_query_new(world, 
+        "Position, Source:Velocity, PARENT:Velocity");
+    test_int(query_count(q), 0);
+
+    /* Source did not change, only tables of parent are rematched */
+    ecs_add(world, parent, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 1);
+
+    ecs_remove(world, Source, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 0);
+
+    ecs_add(world, Source, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 1);
+
+    ecs_fini(world);
+}
+
+void Queries_rematch_after_activate() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t child = ecs_new_w_entity(world, ECS_CHILDOF | parent);
+    ecs_add(world, child, Position);
+    ecs_entity_t e = ecs_new(world, Position);
+
+    ecs_query_t *q = ecs_query_new(world, "Position, ?PARENT:Velocity");
+    test_int(query_count(q), 2);
+
+    /* Move tables between active and inactive before rematching */
+    ecs_delete(world, e);
+    test_int(query_count(q), 1);
+    e = ecs_new(world, Position);
+    test_int(query_count(q), 2);
+
+    ecs_add(world, parent, Velocity);
+    ecs_progress(world, 1);
+    test_int(query_count(q), 2);
+
+    ecs_delete(world, child);
+    test_int(query_count(q), 1);
+
+    ecs_fini(world);
+}
+
+static ecs_entity_t group_cells[3];
+
+static
+int32_t rank_by_cell(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    ecs_type_t type)
+{
+    (void)component;
+
+    int32_t i;
+    for (i = 0; i < 3; i ++) {
+        if (ecs_type_has_entity(world, type, group_cells[i])) {
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+static
+int32_t iter_count(
+    ecs_iter_t *it)
+{
+    int32_t count = 0;
+    while (ecs_query_next(it)) {
+        count += it->count;
+    }
+    return count;
+}
+
+static
+ecs_query_t* new_grouped_query(
+    ecs_world_t *world)
+{
+    int32_t i;
+    for (i = 0; i < 3; i ++) {
+        group_cells[i] = ecs_new(world, 0);
+    }
+
+    ecs_query_t *q = ecs_query_new(world, "Position");
+    ecs_query_group_by(world, q, 0, rank_by_cell);
+    return q;
+}
+
+void Queries_group_iter() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_query_t *q = new_grouped_query(world);
+
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_add_entity(world, e1, group_cells[0]);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_add_entity(world, e2, group_cells[1]);
+    ecs_entity_t e3 = ecs_new(world, Position);
+    ecs_add_entity(world, e3, group_cells[1]);
+    ecs_add(world, e3, Velocity);
+    ecs_entity_t e4 = ecs_new(world, Position);
+    ecs_add_entity(world, e4, group_cells[2]);
+
+    /* Group spans two tables */
+    ecs_iter_t it = ecs_query_iter_group(q, 2);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e2);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e3);
+    test_assert(!ecs_query_next(&it));
+
+    it = ecs_query_iter_group(q, 1);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e1);
+    test_assert(!ecs_query_next(&it));
+
+    it = ecs_query_iter_group(q, 3);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e4);
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Queries_group_iter_no_tables() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_query_t *q = new_grouped_query(world);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_add_entity(world, e, group_cells[0]);
+
+    ecs_iter_t it = ecs_query_iter_group(q, 2);
+    test_assert(!ecs_query_next(&it));
+
+    it = ecs_query_iter_group(q, 10);
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Queries_group_iter_range() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_query_t *q = new_grouped_query(world);
+
+    ecs_new(world, Position);
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_add_entity(world, e1, group_cells[0]);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_add_entity(world, e2, group_cells[1]);
+    ecs_entity_t e3 = ecs_new(world, Position);
+    ecs_add_entity(world, e3, group_cells[2]);
+
+    ecs_iter_t it = ecs_query_iter_group_range(q, 2, 3);
+    test_assert(ecs_query_next(&it));
+    test_int(it.entities[0], e2);
+    test_assert(ecs_query_next(&it));
+    test_int(it.entities[0], e3);
+    test_assert(!ecs_query_next(&it));
+
+    it = ecs_query_iter_group_range(q, 0, 1);
+    test_int(iter_count(&it), 2);
+
+    it = ecs_query_iter_group_range(q, 4, 10);
+    test_int(iter_count(&it), 0);
+
+    it = ecs_query_iter_group_range(q, INT_MIN, INT_MAX);
+    test_int(iter_count(&it), 4);
+
+    ecs_fini(world);
+}
+
+void Queries_group_iter_after_match() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_query_t *q = new_grouped_query(world);
+
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_add_entity(world, e1, group_cells[0]);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_add_entity(world, e2, group_cells[1]);
+
+    ecs_iter_t it = ecs_query_iter_group(q, 1);
+    test_int(iter_count(&it), 1);
+
+    /* New table is added to existing group */
+    ecs_entity_t e3 = ecs_new(world, Position);
+    ecs_add_entity(world, e3, group_cells[0]);
+    ecs_add(world, e3, Velocity);
+
+    it = ecs_query_iter_group(q, 1);
+    test_int(iter_count(&it), 2);
+
+    it = ecs_query_iter_group(q, 2);
+    test_int(iter_count(&it), 1);
+
+    ecs_fini(world);
+}
+
+void Queries_group_iter_after_unmatch() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_query_t *q = new_grouped_query(world);
+
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_add_entity(world, e1, group_cells[0]);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_add_entity(world, e2, group_cells[0]);
+    ecs_add(world, e2, Velocity);
+    ecs_entity_t e3 = ecs_new(world, Position);
+    ecs_add_entity(world, e3, group_cells[1]);
+
+    ecs_iter_t it = ecs_query_iter_group(q, 1);
+    test_int(iter_count(&it), 2);
+
+    /* Table becomes empty, and is no longer iterated */
+    ecs_delete(world, e1);
+
+    it = ecs_query_iter_group(q, 1);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e2);
+    test_assert(!ecs_query_next(&it));
+
+    it = ecs_query_iter_group(q, 2);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e3);
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Queries_group_iter_after_unmatch_active() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    int32_t i;
+    for (i = 0; i < 3; i ++) {
+        group_cells[i] = ecs_new(world, 0);
+    }
+
+    ecs_query_t *q = ecs_query_new(world, "Position, PARENT:Velocity");
+    ecs_query_group_by(world, q, 0, rank_by_cell);
+
+    ecs_entity_t p1 = ecs_new(world, Velocity);
+    ecs_entity_t p2 = ecs_new(world, Velocity);
+
+    ecs_entity_t e[5];
+    for (i = 0; i < 5; i ++) {
+        e[i] = ecs_new(world, Position);
+        ecs_add_entity(world, e[i], ECS_CHILDOF | (i < 2 ? p1 : p2));
+        ecs_add_entity(world, e[i], group_cells[i < 2 ? i : i - 2]);
+    }
+
+    ecs_iter_t it = ecs_query_iter_group(q, 1);
+    test_int(iter_count(&it), 2);
+    it = ecs_query_iter_group(q, 2);
+    test_int(iter_count(&it), 2);
+
+    /* Non-empty tables with children of p1 no longer match */
+    ecs_remove(world, p1, Velocity);
+    ecs_progress(world, 1);
+
+    it = ecs_query_iter_group(q, 1);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e[2]);
+    test_assert(!ecs_query_next(&it));
+
+    it = ecs_query_iter_group(q, 2);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e[3]);
+    test_assert(!ecs_query_next(&it));
+
+    it = ecs_query_iter_group(q, 3);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e[4]);
+    test_assert(!ecs_query_next(&it));
+
+    it = ecs_query_iter_group_range(q, 1, 2);
+    test_int(iter_count(&it), 2);
+
+    it = ecs_query_iter(q);
+    test_int(iter_count(&it), 3);
+
+    ecs_fini(world);
+}
+
+static
+int compare_position_x(
+    ecs_entity_t e1,
+    void *ptr1,
+    ecs_entity_t e2,
+    void *ptr2)
+{
+    (void)e1;
+    (void)e2;
+    const Position *p1 = ptr1;
+    const Position *p2 = ptr2;
+    return (p1->x > p2->x) - (p1->x < p2->x);
+}
+
+void Queries_group_iter_sorted() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_query_t *q = new_grouped_query(world);
+    ecs_query_order_by(world, q, ecs_typeid(Position), compare_position_x);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {3, 0});
+    ecs_add_entity(world, e1, group_cells[1]);
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {1, 0});
+    ecs_add_entity(world, e2, group_cells[1]);
+    ecs_add(world, e2, Velocity);
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {2, 0});
+    ecs_add_entity(world, e3, group_cells[1]);
+    ecs_entity_t e4 = ecs_set(world, 0, Position, {0, 0});
+    ecs_add_entity(world, e4, group_cells[0]);
+
+    /* Entities in group are sorted across tables */
+    ecs_iter_t it = ecs_query_iter_group(q, 2);
+    ecs_entity_t expect[] = {e2, e3, e1};
+    int32_t count = 0;
+    while (ecs_query_next(&it)) {
+        int32_t i;
+        for (i = 0; i < it.count; i ++) {
+            test_assert(count < 3);
+            test_int(it.entities[i], expect[count]);
+            count ++;
+        }
+    }
+    test_int(count, 3);
+
+    it = ecs_query_iter_group(q, 1);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e4);
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
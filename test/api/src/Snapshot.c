@@ -426,6 +426,58 @@ void Snapshot_snapshot_free() {
     ecs_fini(world);
 }
 
+typedef struct Buffer {
+    int32_t *values;
+} Buffer;
+
+static int buffer_dtor_invoked = 0;
+
+static
+ECS_CTOR(Buffer, ptr, {
+    ptr->values = ecs_os_calloc(ECS_SIZEOF(int32_t) * 4);
+});
+
+static
+ECS_DTOR(Buffer, ptr, {
+    ecs_os_free(ptr->values);
+    ptr->values = NULL;
+    buffer_dtor_invoked ++;
+});
+
+void Snapshot_snapshot_free_w_dtor_wo_copy() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Buffer);
+
+    ecs_set_component_actions(world, Buffer, {
+        .ctor = ecs_ctor(Buffer),
+        .dtor = ecs_dtor(Buffer)
+    });
+
+    ecs_entity_t e = ecs_new(world, Buffer);
+    test_assert(e != 0);
+
+    Buffer *b = ecs_get_mut(world, e, Buffer, NULL);
+    test_assert(b != NULL);
+    test_assert(b->values != NULL);
+    b->values[0] = 10;
+
+    ecs_snapshot_t *s = ecs_snapshot_take(world);
+    test_assert(s != NULL);
+
+    /* Snapshot doesn't own the values, as Buffer has no copy action */
+    ecs_snapshot_free(s);
+    test_int(buffer_dtor_invoked, 0);
+
+    const Buffer *ptr = ecs_get(world, e, Buffer);
+    test_assert(ptr != NULL);
+    test_assert(ptr->values != NULL);
+    test_int(ptr->values[0], 10);
+
+    ecs_fini(world);
+    test_int(buffer_dtor_invoked, 1);
+}
+
 void Snapshot_snapshot_free_filtered() {
     ecs_world_t *world = ecs_init();
 
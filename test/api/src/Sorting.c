@@ -1071,3 +1071,266 @@ void Sorting_sort_1000_entities_add_type_after_sort() {
 
     ecs_fini(world);
 }
+
+typedef struct Depth {
+    int32_t value;
+} Depth;
+
+typedef struct Timestamp {
+    uint64_t value;
+} Timestamp;
+
+void Sorting_sort_by_key_float() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {3.5f, 0});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {-1.5f, 0});
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {0, 0});
+    ecs_entity_t e4 = ecs_set(world, 0, Position, {-20, 0});
+    ecs_entity_t e5 = ecs_set(world, 0, Position, {2, 0});
+
+    ecs_query_t *q = ecs_query_new(world, "Position");
+    ecs_query_order_by_member(world, q, Position, x, EcsSortKeyF32);
+
+    ecs_iter_t it = ecs_query_iter(q);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 5);
+
+    test_assert(it.entities[0] == e4);
+    test_assert(it.entities[1] == e2);
+    test_assert(it.entities[2] == e3);
+    test_assert(it.entities[3] == e5);
+    test_assert(it.entities[4] == e1);
+
+    test_assert(!ecs_query_next(&it));
+
+    /* Entity index points to the sorted rows */
+    const Position *p = ecs_get(world, e4, Position);
+    test_flt(p->x, -20);
+    p = ecs_get(world, e1, Position);
+    test_flt(p->x, 3.5f);
+
+    ecs_fini(world);
+}
+
+void Sorting_sort_by_key_int32() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Depth);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Depth, {300});
+    ecs_entity_t e2 = ecs_set(world, 0, Depth, {-70000});
+    ecs_entity_t e3 = ecs_set(world, 0, Depth, {5});
+    ecs_entity_t e4 = ecs_set(world, 0, Depth, {-1});
+
+    ecs_query_t *q = ecs_query_new(world, "Depth");
+    ecs_query_order_by_member(world, q, Depth, value, EcsSortKeyI32);
+
+    ecs_iter_t it = ecs_query_iter(q);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 4);
+
+    test_assert(it.entities[0] == e2);
+    test_assert(it.entities[1] == e4);
+    test_assert(it.entities[2] == e3);
+    test_assert(it.entities[3] == e1);
+
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Sorting_sort_by_key_uint64() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Timestamp);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Timestamp, {0xFFFFFFFF00000000ull});
+    ecs_entity_t e2 = ecs_set(world, 0, Timestamp, {10});
+    ecs_entity_t e3 = ecs_set(world, 0, Timestamp, {0x100000000ull});
+
+    ecs_query_t *q = ecs_query_new(world, "Timestamp");
+    ecs_query_order_by_member(world, q, Timestamp, value, EcsSortKeyU64);
+
+    ecs_iter_t it = ecs_query_iter(q);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 3);
+
+    test_assert(it.entities[0] == e2);
+    test_assert(it.entities[1] == e3);
+    test_assert(it.entities[2] == e1);
+
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Sorting_sort_by_key_stable() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Depth);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Depth, {2});
+    ecs_entity_t e2 = ecs_set(world, 0, Depth, {1});
+    ecs_entity_t e3 = ecs_set(world, 0, Depth, {2});
+    ecs_entity_t e4 = ecs_set(world, 0, Depth, {1});
+
+    ecs_query_t *q = ecs_query_new(world, "Depth");
+    ecs_query_order_by_member(world, q, Depth, value, EcsSortKeyI32);
+
+    /* Entities with the same key keep their order in the table */
+    ecs_iter_t it = ecs_query_iter(q);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 4);
+
+    test_assert(it.entities[0] == e2);
+    test_assert(it.entities[1] == e4);
+    test_assert(it.entities[2] == e1);
+    test_assert(it.entities[3] == e3);
+
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Sorting_sort_by_key_2_tables() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Depth);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Depth, {3});
+    ecs_entity_t e2 = ecs_set(world, 0, Depth, {1});
+    ecs_entity_t e3 = ecs_set(world, 0, Depth, {2});
+    ecs_entity_t e4 = ecs_set(world, 0, Depth, {4});
+    ecs_add(world, e3, Velocity);
+    ecs_add(world, e4, Velocity);
+
+    ecs_query_t *q = ecs_query_new(world, "Depth");
+    ecs_query_order_by_member(world, q, Depth, value, EcsSortKeyI32);
+
+    ecs_iter_t it = ecs_query_iter(q);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_assert(it.entities[0] == e2);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_assert(it.entities[0] == e3);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_assert(it.entities[0] == e1);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_assert(it.entities[0] == e4);
+
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Sorting_sort_by_key_after_set() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Depth);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Depth, {1});
+    ecs_entity_t e2 = ecs_set(world, 0, Depth, {2});
+    ecs_entity_t e3 = ecs_set(world, 0, Depth, {3});
+
+    ecs_query_t *q = ecs_query_new(world, "Depth");
+    ecs_query_order_by_member(world, q, Depth, value, EcsSortKeyI32);
+
+    ecs_set(world, e1, Depth, {5});
+
+    ecs_iter_t it = ecs_query_iter(q);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 3);
+
+    test_assert(it.entities[0] == e2);
+    test_assert(it.entities[1] == e3);
+    test_assert(it.entities[2] == e1);
+
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Sorting_sort_by_key_w_disabled() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Depth);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Depth, {3});
+    ecs_entity_t e2 = ecs_set(world, 0, Depth, {2});
+    ecs_entity_t e3 = ecs_set(world, 0, Depth, {1});
+
+    /* Store all entities in the table with the bitset */
+    ecs_enable_component(world, e1, Depth, false);
+    ecs_enable_component(world, e2, Depth, false);
+    ecs_enable_component(world, e3, Depth, false);
+    ecs_enable_component(world, e1, Depth, true);
+    ecs_enable_component(world, e3, Depth, true);
+
+    ecs_query_t *q = ecs_query_new(world, "Depth");
+    ecs_query_order_by_member(world, q, Depth, value, EcsSortKeyI32);
+
+    /* Enabled state is moved with the entity */
+    test_assert(ecs_is_component_enabled(world, e1, Depth));
+    test_assert(!ecs_is_component_enabled(world, e2, Depth));
+    test_assert(ecs_is_component_enabled(world, e3, Depth));
+
+    ecs_fini(world);
+}
+
+void Sorting_sort_by_key_1000_entities() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Depth);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_query_t *q = ecs_query_new(world, "Depth");
+    ecs_query_order_by_member(world, q, Depth, value, EcsSortKeyI32);
+
+    int32_t i;
+    for (i = 0; i < 1000; i ++) {
+        int32_t v = rand() - RAND_MAX / 2;
+        ecs_entity_t e = ecs_set(world, 0, Depth, {v});
+        if (i % 3 == 0) {
+            ecs_set(world, e, Velocity, {(float)v, 0});
+        }
+    }
+
+    ecs_iter_t it = ecs_query_iter(q);
+    int32_t count = 0, prev = INT32_MIN;
+    while (ecs_query_next(&it)) {
+        Depth *d = ecs_column(&it, Depth, 1);
+
+        for (i = 0; i < it.count; i ++) {
+            test_assert(prev <= d[i].value);
+            prev = d[i].value;
+
+            /* Other columns are moved with the key */
+            const Velocity *v = ecs_get(world, it.entities[i], Velocity);
+            if (v) {
+                test_flt(v->x, (float)d[i].value);
+            }
+        }
+
+        count += it.count;
+    }
+
+    test_int(count, 1000);
+
+    ecs_fini(world);
+}
@@ -0,0 +1,431 @@
+#include <api.h>
+
+void SparseStorage_setup() {
+    ecs_tracing_enable(-3);
+}
+
+void SparseStorage_add_has_get() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    test_assert(!ecs_has(world, e, Velocity));
+    test_assert(ecs_get(world, e, Velocity) == NULL);
+
+    ecs_add(world, e, Velocity);
+    test_assert(ecs_has(world, e, Velocity));
+    test_assert(ecs_has(world, e, Position));
+
+    const Velocity *v = ecs_get(world, e, Velocity);
+    test_assert(v != NULL);
+    test_int(v->x, 0);
+    test_int(v->y, 0);
+
+    /* Sparse component is not part of the entity type */
+    ecs_type_t type = ecs_get_type(world, e);
+    test_int(ecs_vector_count(type), 1);
+    test_assert(ecs_type_has_entity(world, type, ecs_typeid(Position)));
+
+    ecs_fini(world);
+}
+
+void SparseStorage_set_no_table_move() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    const Position *p = ecs_get(world, e, Position);
+
+    ecs_set(world, e, Velocity, {1, 2});
+    test_assert(ecs_get(world, e, Position) == p);
+
+    const Velocity *v = ecs_get(world, e, Velocity);
+    test_assert(v != NULL);
+    test_int(v->x, 1);
+    test_int(v->y, 2);
+
+    ecs_set(world, e, Velocity, {3, 4});
+    test_assert(ecs_get(world, e, Velocity) == v);
+    test_int(v->x, 3);
+    test_int(v->y, 4);
+
+    ecs_remove(world, e, Velocity);
+    test_assert(ecs_get(world, e, Position) == p);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(world);
+}
+
+void SparseStorage_remove() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_set(world, e, Velocity, {1, 2});
+    test_assert(ecs_has(world, e, Velocity));
+
+    ecs_remove(world, e, Velocity);
+    test_assert(!ecs_has(world, e, Velocity));
+    test_assert(ecs_get(world, e, Velocity) == NULL);
+    test_assert(ecs_has(world, e, Position));
+
+    /* Add again after remove */
+    ecs_add(world, e, Velocity);
+    const Velocity *v = ecs_get(world, e, Velocity);
+    test_assert(v != NULL);
+    test_int(v->x, 0);
+    test_int(v->y, 0);
+
+    ecs_fini(world);
+}
+
+void SparseStorage_new_w_sparse() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Velocity);
+    test_assert(e != 0);
+    test_assert(ecs_is_alive(world, e));
+    test_assert(ecs_has(world, e, Velocity));
+    test_assert(ecs_get_type(world, e) == NULL);
+
+    e = ecs_set(world, 0, Velocity, {1, 2});
+    test_assert(e != 0);
+    const Velocity *v = ecs_get(world, e, Velocity);
+    test_assert(v != NULL);
+    test_int(v->x, 1);
+    test_int(v->y, 2);
+
+    ecs_fini(world);
+}
+
+void SparseStorage_delete() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_set(world, e, Velocity, {1, 2});
+
+    ecs_delete(world, e);
+    test_assert(!ecs_has(world, e, Velocity));
+
+    /* Recycled id does not inherit the sparse component */
+    ecs_entity_t e2 = ecs_new(world, 0);
+    test_assert((uint32_t)e2 == (uint32_t)e);
+    test_assert(!ecs_has(world, e2, Velocity));
+    test_assert(ecs_get(world, e2, Velocity) == NULL);
+
+    ecs_fini(world);
+}
+
+void SparseStorage_clear() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_add(world, e, Velocity);
+
+    ecs_clear(world, e);
+    test_assert(!ecs_has(world, e, Position));
+    test_assert(!ecs_has(world, e, Velocity));
+
+    ecs_fini(world);
+}
+
+static int ctor_invoked = 0;
+static int dtor_invoked = 0;
+
+static
+void ctor_velocity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    const ecs_entity_t *entities,
+    void *ptr,
+    size_t size,
+    int32_t count,
+    void *ctx)
+{
+    Velocity *v = ptr;
+    v->x = 10;
+    v->y = 20;
+    ctor_invoked ++;
+}
+
+static
+void dtor_velocity(
+    ecs_world_t *world,
+    ecs_entity_t component,
+    const ecs_entity_t *entities,
+    void *ptr,
+    size_t size,
+    int32_t count,
+    void *ctx)
+{
+    dtor_invoked ++;
+}
+
+void SparseStorage_ctor_dtor() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_actions(world, Velocity, {
+        .ctor = ctor_velocity,
+        .dtor = dtor_velocity
+    });
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ctor_invoked = 0;
+    dtor_invoked = 0;
+
+    ecs_entity_t e1 = ecs_new(world, 0);
+    ecs_add(world, e1, Velocity);
+    test_int(ctor_invoked, 1);
+
+    const Velocity *v = ecs_get(world, e1, Velocity);
+    test_assert(v != NULL);
+    test_int(v->x, 10);
+    test_int(v->y, 20);
+
+    /* Adding a component the entity already has does not construct it */
+    ecs_add(world, e1, Velocity);
+    test_int(ctor_invoked, 1);
+
+    ecs_remove(world, e1, Velocity);
+    test_int(dtor_invoked, 1);
+
+    ecs_entity_t e2 = ecs_new(world, Velocity);
+    test_assert(e2 != 0);
+    test_int(ctor_invoked, 2);
+
+    ecs_delete(world, e2);
+    test_int(dtor_invoked, 2);
+
+    ecs_add(world, e1, Velocity);
+    test_int(ctor_invoked, 3);
+
+    ecs_fini(world);
+    test_int(dtor_invoked, 3);
+}
+
+void SparseStorage_defer_add() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Position);
+
+    ecs_defer_begin(world);
+    ecs_add(world, e, Velocity);
+    test_assert(!ecs_has(world, e, Velocity));
+    ecs_defer_end(world);
+    test_assert(ecs_has(world, e, Velocity));
+
+    ecs_defer_begin(world);
+    ecs_set(world, e, Velocity, {1, 2});
+    ecs_defer_end(world);
+
+    const Velocity *v = ecs_get(world, e, Velocity);
+    test_assert(v != NULL);
+    test_int(v->x, 1);
+    test_int(v->y, 2);
+
+    ecs_defer_begin(world);
+    ecs_remove(world, e, Velocity);
+    test_assert(ecs_has(world, e, Velocity));
+    ecs_defer_end(world);
+    test_assert(!ecs_has(world, e, Velocity));
+
+    ecs_fini(world);
+}
+
+void SparseStorage_query_sparse() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_query_t *q = ecs_query_new(world, "Position, Velocity");
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {30, 40});
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {50, 60});
+    ecs_set(world, e1, Velocity, {1, 2});
+    ecs_set(world, e3, Velocity, {3, 4});
+
+    ecs_iter_t it = ecs_query_iter(q);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e1);
+    Position *p = ecs_column(&it, Position, 1);
+    Velocity *v = ecs_column(&it, Velocity, 2);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+    test_int(v->x, 1);
+    test_int(v->y, 2);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e3);
+    p = ecs_column(&it, Position, 1);
+    v = ecs_column(&it, Velocity, 2);
+    test_int(p->x, 50);
+    test_int(p->y, 60);
+    test_int(v->x, 3);
+    test_int(v->y, 4);
+
+    test_assert(!ecs_query_next(&it));
+
+    /* Removing the component does not move the entity */
+    ecs_remove(world, e1, Velocity);
+    ecs_add(world, e2, Velocity);
+
+    it = ecs_query_iter(q);
+    int32_t count = 0;
+    while (ecs_query_next(&it)) {
+        test_int(it.count, 1);
+        test_assert(it.entities[0] != e1);
+        count ++;
+    }
+    test_int(count, 2);
+
+    ecs_fini(world);
+}
+
+void SparseStorage_query_not_sparse() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_add(world, e1, Velocity);
+
+    ecs_query_t *q = ecs_query_new(world, "Position, !Velocity");
+    ecs_iter_t it = ecs_query_iter(q);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e2);
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void SparseStorage_query_optional_sparse() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_set(world, e2, Velocity, {1, 2});
+
+    ecs_query_t *q = ecs_query_new(world, "Position, ?Velocity");
+    ecs_iter_t it = ecs_query_iter(q);
+
+    int32_t count = 0;
+    while (ecs_query_next(&it)) {
+        int32_t i;
+        for (i = 0; i < it.count; i ++) {
+            const Velocity *v = ecs_element(&it, Velocity, 2, i);
+            if (it.entities[i] == e1) {
+                test_assert(v == NULL);
+            } else {
+                test_assert(it.entities[i] == e2);
+                test_assert(v != NULL);
+                test_int(v->x, 1);
+                test_int(v->y, 2);
+            }
+        }
+        count += it.count;
+    }
+
+    test_int(count, 2);
+
+    ecs_fini(world);
+}
+
+static
+void Move(ecs_iter_t *it) {
+    ECS_COLUMN(it, Position, p, 1);
+    ECS_COLUMN(it, Velocity, v, 2);
+
+    probe_system(it);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        p[i].x += v[i].x;
+        p[i].y += v[i].y;
+    }
+}
+
+void SparseStorage_system_sparse() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_set_component_sparse(world, Velocity);
+
+    ECS_SYSTEM(world, Move, EcsOnUpdate, Position, Velocity);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {30, 40});
+    ecs_set(world, e2, Velocity, {1, 2});
+
+    Probe ctx = {0};
+    ecs_set_context(world, &ctx);
+
+    ecs_progress(world, 1);
+
+    test_int(ctx.count, 1);
+    test_int(ctx.e[0], e2);
+
+    const Position *p = ecs_get(world, e1, Position);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    p = ecs_get(world, e2, Position);
+    test_int(p->x, 31);
+    test_int(p->y, 42);
+
+    ecs_fini(world);
+}
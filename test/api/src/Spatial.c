@@ -0,0 +1,389 @@
+#include <api.h>
+
+void Spatial_setup() {
+    ecs_tracing_enable(-3);
+}
+
+typedef struct Position3 {
+    float x;
+    float y;
+    float z;
+} Position3;
+
+/* Returns the number of entities yielded by the iterator, and tests if the
+ * expected entity is one of them */
+static
+int32_t iter_count(
+    ecs_spatial_iter_t it,
+    ecs_entity_t expect,
+    bool *found)
+{
+    int32_t count = 0;
+    if (found) {
+        *found = false;
+    }
+
+    while (ecs_spatial_next(&it)) {
+        test_assert(it.count > 0);
+
+        int32_t i;
+        for (i = 0; i < it.count; i ++) {
+            if (found && it.entities[i] == expect) {
+                *found = true;
+            }
+        }
+        count += it.count;
+    }
+
+    return count;
+}
+
+static
+int32_t box_count(
+    ecs_spatial_t *index,
+    float x1, float y1, float x2, float y2)
+{
+    return iter_count(ecs_spatial_box(index,
+        (float[]){x1, y1}, (float[]){x2, y2}), 0, NULL);
+}
+
+static
+bool box_has(
+    ecs_spatial_t *index,
+    ecs_entity_t e,
+    float x1, float y1, float x2, float y2)
+{
+    bool found;
+    iter_count(ecs_spatial_box(index,
+        (float[]){x1, y1}, (float[]){x2, y2}), e, &found);
+    return found;
+}
+
+void Spatial_box_query() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {5, 5});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {15, 5});
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {55, 55});
+    test_int(ecs_spatial_count(index), 3);
+
+    test_assert(box_has(index, e1, 0, 0, 20, 20));
+    test_assert(box_has(index, e2, 0, 0, 20, 20));
+    test_assert(!box_has(index, e3, 0, 0, 20, 20));
+    test_int(box_count(index, 0, 0, 20, 20), 2);
+
+    /* Entities on the boundary are included */
+    test_int(box_count(index, 5, 5, 15, 5), 2);
+    test_int(box_count(index, 6, 0, 14, 20), 0);
+    test_int(box_count(index, -100, -100, 100, 100), 3);
+
+    ecs_fini(world);
+}
+
+void Spatial_radius_query() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 4);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {0, 0});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {3, 4});
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {4, 4});
+
+    bool found;
+    test_int(iter_count(ecs_spatial_radius(index,
+        (float[]){0, 0}, 5), e1, &found), 2);
+    test_assert(found);
+    test_int(iter_count(ecs_spatial_radius(index,
+        (float[]){0, 0}, 5), e2, &found), 2);
+    test_assert(found);
+    test_int(iter_count(ecs_spatial_radius(index,
+        (float[]){0, 0}, 5), e3, &found), 2);
+    test_assert(!found);
+
+    test_int(iter_count(ecs_spatial_radius(index,
+        (float[]){4.5f, 4.5f}, 1), e3, &found), 1);
+    test_assert(found);
+
+    ecs_fini(world);
+}
+
+void Spatial_set_moves_entity() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {5, 5});
+    test_assert(box_has(index, e, 0, 0, 9, 9));
+
+    /* Move within the same cell */
+    ecs_set(world, e, Position, {7, 7});
+    test_assert(!box_has(index, e, 0, 0, 6, 6));
+    test_assert(box_has(index, e, 6, 6, 9, 9));
+
+    /* Move to another cell */
+    ecs_set(world, e, Position, {25, 35});
+    test_assert(!box_has(index, e, 0, 0, 9, 9));
+    test_assert(box_has(index, e, 20, 30, 29, 39));
+    test_int(ecs_spatial_count(index), 1);
+
+    ecs_fini(world);
+}
+
+void Spatial_modified_moves_entity() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {5, 5});
+
+    Position *p = ecs_get_mut(world, e, Position, NULL);
+    p->x = 45;
+    test_assert(box_has(index, e, 0, 0, 9, 9));
+
+    ecs_modified(world, e, Position);
+    test_assert(!box_has(index, e, 0, 0, 9, 9));
+    test_assert(box_has(index, e, 40, 0, 49, 9));
+
+    ecs_fini(world);
+}
+
+void Spatial_remove_component() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {5, 5});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {6, 6});
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {7, 7});
+
+    /* Moving the entity to another table does not change the index */
+    ecs_add(world, e2, Velocity);
+    test_int(ecs_spatial_count(index), 3);
+
+    /* e3 is moved to the element of e1 in the cell */
+    ecs_remove(world, e1, Position);
+    test_int(ecs_spatial_count(index), 2);
+    test_assert(!box_has(index, e1, 0, 0, 9, 9));
+    test_assert(box_has(index, e2, 0, 0, 9, 9));
+    test_assert(box_has(index, e3, 0, 0, 9, 9));
+
+    ecs_set(world, e3, Position, {25, 25});
+    test_assert(box_has(index, e3, 20, 20, 29, 29));
+    test_int(box_count(index, 0, 0, 9, 9), 1);
+
+    ecs_fini(world);
+}
+
+void Spatial_delete_entity() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {5, 5});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {15, 15});
+
+    ecs_delete(world, e1);
+    test_int(ecs_spatial_count(index), 1);
+    test_int(box_count(index, 0, 0, 9, 9), 0);
+    test_assert(box_has(index, e2, 10, 10, 19, 19));
+
+    ecs_fini(world);
+}
+
+void Spatial_existing_entities() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_PREFAB(world, Base, Position);
+
+    ecs_set(world, 0, Position, {5, 5});
+    ecs_set(world, 0, Position, {15, 15});
+
+    /* Shared components are not indexed */
+    ecs_set(world, Base, Position, {5, 5});
+    ecs_new_w_entity(world, ECS_INSTANCEOF | Base);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+    test_int(ecs_spatial_count(index), 2);
+    test_int(box_count(index, 0, 0, 20, 20), 2);
+
+    ecs_fini(world);
+}
+
+void Spatial_cell_batches() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+
+    int32_t i;
+    for (i = 0; i < 100; i ++) {
+        ecs_set(world, 0, Position, {(float)(i % 10) + 0.5f, (float)(i / 10) + 20.5f});
+        ecs_set(world, 0, Position, {(float)(i % 10) + 10.5f, (float)(i / 10) + 20.5f});
+    }
+
+    /* Each batch contains the entities of a single cell */
+    ecs_spatial_iter_t it = ecs_spatial_box(
+        index, (float[]){-10, -10}, (float[]){50, 50});
+    int32_t batches = 0;
+    while (ecs_spatial_next(&it)) {
+        test_int(it.count, 100);
+        batches ++;
+    }
+    test_int(batches, 2);
+
+    /* Batches of partially overlapping cells are filtered */
+    it = ecs_spatial_box(index, (float[]){0, 20}, (float[]){4.9f, 29.9f});
+    test_assert(ecs_spatial_next(&it));
+    test_int(it.count, 50);
+    test_assert(!ecs_spatial_next(&it));
+
+    /* Stop iterating early */
+    it = ecs_spatial_box(index, (float[]){0, 20}, (float[]){19, 29});
+    test_assert(ecs_spatial_next(&it));
+    ecs_spatial_iter_fini(&it);
+
+    ecs_fini(world);
+}
+
+void Spatial_negative_coords() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {-5, -5});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {5, 5});
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {-1e12f, 1e12f});
+
+    test_assert(box_has(index, e1, -9, -9, -1, -1));
+    test_assert(!box_has(index, e2, -9, -9, -1, -1));
+    test_int(box_count(index, -9, -9, -1, -1), 1);
+
+    /* Entities outside of the grid range are still found */
+    test_assert(box_has(index, e3, -2e12f, 0, 0, 2e12f));
+    test_int(box_count(index, -2e12f, 0, 0, 2e12f), 1);
+
+    ecs_fini(world);
+}
+
+void Spatial_index_3d() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position3);
+
+    ecs_spatial_t *index = ecs_spatial_new_3d(world, Position3, x, y, z, 10);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position3, {5, 5, 5});
+    ecs_entity_t e2 = ecs_set(world, 0, Position3, {5, 5, 25});
+
+    bool found;
+    test_int(iter_count(ecs_spatial_box(index,
+        (float[]){0, 0, 0}, (float[]){9, 9, 9}), e1, &found), 1);
+    test_assert(found);
+
+    test_int(iter_count(ecs_spatial_radius(index,
+        (float[]){5, 5, 20}, 5), e2, &found), 1);
+    test_assert(found);
+
+    ecs_fini(world);
+}
+
+void Spatial_free_index() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+    ecs_entity_t e = ecs_set(world, 0, Position, {5, 5});
+    ecs_spatial_free(index);
+
+    /* Updating the component after the index is freed is a no-op */
+    ecs_set(world, e, Position, {15, 15});
+    ecs_delete(world, e);
+
+    index = ecs_spatial_new(world, Position, x, y, 10);
+    ecs_set(world, 0, Position, {5, 5});
+    test_int(ecs_spatial_count(index), 1);
+
+    ecs_fini(world);
+}
+
+void Spatial_free_deletes_systems() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    int32_t system_count = ecs_count_entity(world, ecs_typeid(EcsContext));
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+    test_int(ecs_count_entity(world, ecs_typeid(EcsContext)), 
+        system_count + 2);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {5, 5});
+    ecs_spatial_free(index);
+    test_int(ecs_count_entity(world, ecs_typeid(EcsContext)), system_count);
+
+    /* The deleted systems are no longer invoked for the freed index */
+    ecs_set(world, e, Position, {15, 15});
+    ecs_remove(world, e, Position);
+    ecs_set(world, e, Position, {5, 5});
+    ecs_delete(world, e);
+
+    ecs_fini(world);
+}
+
+void Spatial_nan_position() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+    ecs_entity_t e = ecs_set(world, 0, Position, {5, 5});
+    test_int(ecs_spatial_count(index), 1);
+
+    float nan = 0.0f / 0.0f;
+    ecs_set(world, e, Position, {nan, 5});
+    test_int(ecs_spatial_count(index), 0);
+    test_int(box_count(index, -1e30f, -1e30f, 1e30f, 1e30f), 0);
+
+    ecs_set(world, e, Position, {5, 5});
+    test_int(ecs_spatial_count(index), 1);
+    test_bool(box_has(index, e, 0, 0, 10, 10), true);
+
+    ecs_fini(world);
+}
+
+void Spatial_out_of_range_position() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_spatial_t *index = ecs_spatial_new(world, Position, x, y, 10);
+    float inf = 1.0f / 0.0f;
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {1e30f, -1e30f});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {inf, -inf});
+    test_int(ecs_spatial_count(index), 2);
+
+    test_bool(box_has(index, e1, 1e29f, -1e31f, 1e31f, -1e29f), true);
+    test_bool(box_has(index, e2, 1e29f, -inf, inf, -1e29f), true);
+    test_int(box_count(index, 0, 0, 10, 10), 0);
+
+    ecs_fini(world);
+}
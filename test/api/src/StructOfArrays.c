@@ -0,0 +1,340 @@
+#include <api.h>
+
+void StructOfArrays_setup() {
+    ecs_tracing_enable(-3);
+}
+
+#define SET_POSITION_FIELDS(world)\
+    ecs_set_component_fields(world, Position, {\
+        ECS_FIELD(Position, x),\
+        ECS_FIELD(Position, y)\
+    })
+
+void StructOfArrays_set_get_field() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    test_assert(e != 0);
+    test_assert(ecs_has(world, e, Position));
+
+    const float *x = ecs_get_field(world, e, Position, 0);
+    const float *y = ecs_get_field(world, e, Position, 1);
+    test_assert(x != NULL);
+    test_assert(y != NULL);
+    test_flt(*x, 10);
+    test_flt(*y, 20);
+
+    ecs_set(world, e, Position, {30, 40});
+    test_assert(ecs_get_field(world, e, Position, 0) == x);
+    test_flt(*x, 30);
+    test_flt(*y, 40);
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_get_field_not_owned() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e = ecs_new(world, 0);
+    test_assert(ecs_get_field(world, e, Position, 0) == NULL);
+
+    ecs_add(world, e, Velocity);
+    test_assert(ecs_get_field(world, e, Position, 0) == NULL);
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_fields_are_contiguous() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {30, 40});
+
+    const float *x1 = ecs_get_field(world, e1, Position, 0);
+    const float *x2 = ecs_get_field(world, e2, Position, 0);
+    const float *y1 = ecs_get_field(world, e1, Position, 1);
+    const float *y2 = ecs_get_field(world, e2, Position, 1);
+
+    test_assert(x2 == x1 + 1);
+    test_assert(y2 == y1 + 1);
+    test_flt(x1[1], 30);
+    test_flt(y1[1], 40);
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_add_remove_other() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, e, Velocity, {1, 2});
+
+    const float *x = ecs_get_field(world, e, Position, 0);
+    const float *y = ecs_get_field(world, e, Position, 1);
+    test_flt(*x, 10);
+    test_flt(*y, 20);
+
+    const Velocity *v = ecs_get(world, e, Velocity);
+    test_assert(v != NULL);
+    test_int(v->x, 1);
+    test_int(v->y, 2);
+
+    ecs_remove(world, e, Velocity);
+    x = ecs_get_field(world, e, Position, 0);
+    y = ecs_get_field(world, e, Position, 1);
+    test_flt(*x, 10);
+    test_flt(*y, 20);
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_remove() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, e, Velocity, {1, 2});
+
+    ecs_remove(world, e, Position);
+    test_assert(!ecs_has(world, e, Position));
+    test_assert(ecs_get_field(world, e, Position, 0) == NULL);
+
+    const Velocity *v = ecs_get(world, e, Velocity);
+    test_assert(v != NULL);
+    test_int(v->x, 1);
+    test_int(v->y, 2);
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_delete_moves_last() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {30, 40});
+    ecs_entity_t e3 = ecs_set(world, 0, Position, {50, 60});
+
+    ecs_delete(world, e1);
+
+    const float *x = ecs_get_field(world, e3, Position, 0);
+    const float *y = ecs_get_field(world, e3, Position, 1);
+    test_flt(*x, 50);
+    test_flt(*y, 60);
+
+    x = ecs_get_field(world, e2, Position, 0);
+    y = ecs_get_field(world, e2, Position, 1);
+    test_flt(*x, 30);
+    test_flt(*y, 40);
+
+    ecs_delete(world, e2);
+
+    x = ecs_get_field(world, e3, Position, 0);
+    y = ecs_get_field(world, e3, Position, 1);
+    test_flt(*x, 50);
+    test_flt(*y, 60);
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_bulk_new() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    SET_POSITION_FIELDS(world);
+
+    const ecs_entity_t *ids = ecs_bulk_new(world, Position, 10);
+    test_assert(ids != NULL);
+
+    ecs_entity_t entities[10];
+    ecs_os_memcpy(entities, ids, ECS_SIZEOF(ecs_entity_t) * 10);
+
+    int32_t i;
+    for (i = 0; i < 10; i ++) {
+        test_assert(ecs_has(world, entities[i], Position));
+        ecs_set(world, entities[i], Position, {(float)i, (float)(i * 2)});
+    }
+
+    for (i = 0; i < 10; i ++) {
+        const float *x = ecs_get_field(world, entities[i], Position, 0);
+        const float *y = ecs_get_field(world, entities[i], Position, 1);
+        test_flt(*x, i);
+        test_flt(*y, i * 2);
+    }
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_defer_set() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e = ecs_new(world, 0);
+
+    ecs_defer_begin(world);
+    ecs_set(world, e, Position, {10, 20});
+    test_assert(!ecs_has(world, e, Position));
+    ecs_defer_end(world);
+
+    test_assert(ecs_has(world, e, Position));
+    const float *x = ecs_get_field(world, e, Position, 0);
+    const float *y = ecs_get_field(world, e, Position, 1);
+    test_flt(*x, 10);
+    test_flt(*y, 20);
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_query_field() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {30, 40});
+    ecs_set(world, e2, Velocity, {1, 2});
+
+    ecs_query_t *q = ecs_query_new(world, "Position");
+    ecs_iter_t it = ecs_query_iter(q);
+
+    int32_t count = 0;
+    while (ecs_query_next(&it)) {
+        float *x = ecs_column_field(&it, float, 1, 0);
+        float *y = ecs_column_field(&it, float, 1, 1);
+        test_assert(x != NULL);
+        test_assert(y != NULL);
+
+        int32_t i;
+        for (i = 0; i < it.count; i ++) {
+            if (it.entities[i] == e1) {
+                test_flt(x[i], 10);
+                test_flt(y[i], 20);
+            } else {
+                test_int(it.entities[i], e2);
+                test_flt(x[i], 30);
+                test_flt(y[i], 40);
+            }
+            count ++;
+        }
+    }
+
+    test_int(count, 2);
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_query_optional_field() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Velocity, {1, 2});
+    ecs_entity_t e2 = ecs_set(world, 0, Velocity, {3, 4});
+    ecs_set(world, e2, Position, {30, 40});
+
+    ecs_query_t *q = ecs_query_new(world, "Velocity, ?Position");
+    ecs_iter_t it = ecs_query_iter(q);
+
+    int32_t count = 0;
+    while (ecs_query_next(&it)) {
+        float *x = ecs_column_field(&it, float, 2, 0);
+        test_int(it.count, 1);
+
+        if (it.entities[0] == e1) {
+            test_assert(x == NULL);
+        } else {
+            test_int(it.entities[0], e2);
+            test_assert(x != NULL);
+            test_flt(x[0], 30);
+        }
+        count ++;
+    }
+
+    test_int(count, 2);
+
+    ecs_fini(world);
+}
+
+static
+void Move(ecs_iter_t *it) {
+    float *x = ecs_column_field(it, float, 1, 0);
+    float *y = ecs_column_field(it, float, 1, 1);
+    Velocity *v = ecs_column(it, Velocity, 2);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        x[i] += v[i].x;
+        y[i] += v[i].y;
+    }
+}
+
+void StructOfArrays_system_field() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    SET_POSITION_FIELDS(world);
+
+    ECS_SYSTEM(world, Move, EcsOnUpdate, Position, Velocity);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, e, Velocity, {1, 2});
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+
+    const float *x = ecs_get_field(world, e, Position, 0);
+    const float *y = ecs_get_field(world, e, Position, 1);
+    test_flt(*x, 12);
+    test_flt(*y, 24);
+
+    ecs_fini(world);
+}
+
+void StructOfArrays_snapshot_restore() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    SET_POSITION_FIELDS(world);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+
+    ecs_snapshot_t *s = ecs_snapshot_take(world);
+
+    ecs_set(world, e, Position, {30, 40});
+
+    ecs_snapshot_restore(world, s);
+
+    test_assert(ecs_has(world, e, Position));
+    const float *x = ecs_get_field(world, e, Position, 0);
+    const float *y = ecs_get_field(world, e, Position, 1);
+    test_flt(*x, 10);
+    test_flt(*y, 20);
+
+    ecs_fini(world);
+}
@@ -0,0 +1,262 @@
+#include <api.h>
+
+void SystemBudget_setup() {
+    ecs_tracing_enable(-3);
+}
+
+static
+void Increment(ecs_iter_t *it) {
+    Position *p = ecs_column(it, Position, 1);
+    int32_t *count = ecs_get_context(it->world);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        p[i].x ++;
+    }
+
+    if (count) {
+        (*count) += it->count;
+    }
+}
+
+static
+void SlowIncrement(ecs_iter_t *it) {
+    Increment(it);
+    ecs_os_sleep(0, 1000000);
+}
+
+static
+void create_entities(
+    ecs_world_t *world,
+    ecs_entity_t *entities,
+    int32_t count,
+    ecs_entity_t component)
+{
+    ecs_entity_t position = ecs_lookup(world, "Position");
+
+    int32_t i;
+    for (i = 0; i < count; i ++) {
+        entities[i] = ecs_set_ptr_w_entity(world, 0, position, 
+            sizeof(Position), &(Position){0, 0});
+        if (component) {
+            ecs_add_entity(world, entities[i], component);
+        }
+    }
+}
+
+static
+int32_t x_total(
+    ecs_world_t *world,
+    ecs_entity_t *entities,
+    int32_t count)
+{
+    ecs_entity_t position = ecs_lookup(world, "Position");
+
+    int32_t i, result = 0;
+    for (i = 0; i < count; i ++) {
+        const Position *p = ecs_get_w_entity(world, entities[i], position);
+        result += (int32_t)p->x;
+    }
+    return result;
+}
+
+void SystemBudget_entity_budget() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ECS_SYSTEM(world, Increment, EcsOnUpdate, Position);
+
+    ecs_entity_t entities[10];
+    create_entities(world, entities, 5, 0);
+    create_entities(world, &entities[5], 5, ecs_typeid(Velocity));
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+    ecs_set_system_budget(world, Increment, 3, 0);
+
+    ecs_progress(world, 1);
+    test_int(count, 3);
+    test_int(x_total(world, entities, 3), 3);
+    test_int(x_total(world, entities, 10), 3);
+
+    /* Iteration crosses the boundary between tables */
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+    test_int(count, 9);
+    test_int(x_total(world, entities, 9), 9);
+
+    /* Last run processes the remaining entity */
+    ecs_progress(world, 1);
+    test_int(count, 10);
+    test_int(x_total(world, entities, 10), 10);
+
+    /* Start over from the first entity */
+    ecs_progress(world, 1);
+    test_int(count, 13);
+    test_int(x_total(world, entities, 3), 6);
+    test_int(x_total(world, entities, 10), 13);
+
+    ecs_fini(world);
+}
+
+void SystemBudget_entity_budget_ends_at_last_entity() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Increment, EcsOnUpdate, Position);
+
+    ecs_entity_t entities[6];
+    create_entities(world, entities, 6, 0);
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+    ecs_set_system_budget(world, Increment, 3, 0);
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+    test_int(count, 6);
+
+    /* No run is wasted on an empty range after the last entity */
+    ecs_progress(world, 1);
+    test_int(count, 9);
+    test_int(x_total(world, entities, 3), 6);
+    test_int(x_total(world, entities, 6), 9);
+
+    ecs_fini(world);
+}
+
+void SystemBudget_time_budget() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ECS_COMPONENT(world, Mass);
+    ECS_SYSTEM(world, SlowIncrement, EcsOnUpdate, Position);
+
+    ecs_entity_t entities[6];
+    create_entities(world, entities, 2, 0);
+    create_entities(world, &entities[2], 2, ecs_typeid(Velocity));
+    create_entities(world, &entities[4], 2, ecs_typeid(Mass));
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+
+    /* Each batch takes longer than the budget, so one table is processed per
+     * run */
+    ecs_set_system_budget(world, SlowIncrement, 0, 0.0005f);
+
+    ecs_progress(world, 1);
+    test_int(count, 2);
+    test_int(x_total(world, entities, 2), 2);
+
+    ecs_progress(world, 1);
+    test_int(count, 4);
+    test_int(x_total(world, entities, 4), 4);
+
+    ecs_progress(world, 1);
+    test_int(count, 6);
+    test_int(x_total(world, entities, 6), 6);
+
+    ecs_progress(world, 1);
+    test_int(count, 8);
+    test_int(x_total(world, entities, 2), 4);
+
+    ecs_fini(world);
+}
+
+void SystemBudget_entity_and_time_budget() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, SlowIncrement, EcsOnUpdate, Position);
+
+    ecs_entity_t entities[6];
+    create_entities(world, entities, 6, 0);
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+
+    /* Entity budget limits the size of the batch that exceeds the time */
+    ecs_set_system_budget(world, SlowIncrement, 4, 0.0005f);
+
+    ecs_progress(world, 1);
+    test_int(count, 4);
+
+    ecs_progress(world, 1);
+    test_int(count, 6);
+    test_int(x_total(world, entities, 6), 6);
+
+    ecs_fini(world);
+}
+
+void SystemBudget_run_ignores_budget() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Increment, EcsOnUpdate, Position);
+
+    ecs_entity_t entities[10];
+    create_entities(world, entities, 10, 0);
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+    ecs_set_system_budget(world, Increment, 3, 0);
+
+    ecs_run(world, Increment, 1, NULL);
+    test_int(count, 10);
+
+    /* Running the system manually does not move the cursor */
+    ecs_progress(world, 1);
+    test_int(count, 13);
+    test_int(x_total(world, entities, 3), 6);
+
+    ecs_fini(world);
+}
+
+void SystemBudget_remove_budget() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Increment, EcsOnUpdate, Position);
+
+    ecs_entity_t entities[10];
+    create_entities(world, entities, 10, 0);
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+    ecs_set_system_budget(world, Increment, 3, 0);
+
+    ecs_progress(world, 1);
+    test_int(count, 3);
+
+    ecs_set_system_budget(world, Increment, 0, 0);
+
+    ecs_progress(world, 1);
+    test_int(count, 13);
+    test_int(x_total(world, entities, 3), 6);
+    test_int(x_total(world, entities, 10), 13);
+
+    ecs_fini(world);
+}
+
+void SystemBudget_set_budget_resets_cursor() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, Increment, EcsOnUpdate, Position);
+
+    ecs_entity_t entities[10];
+    create_entities(world, entities, 10, 0);
+
+    ecs_set_system_budget(world, Increment, 3, 0);
+    ecs_progress(world, 1);
+    test_int(x_total(world, entities, 3), 3);
+
+    ecs_set_system_budget(world, Increment, 2, 0);
+    ecs_progress(world, 1);
+    test_int(x_total(world, entities, 2), 4);
+    test_int(x_total(world, entities, 10), 5);
+
+    ecs_fini(world);
+}
@@ -1156,3 +1156,33 @@ void SystemOnSet_on_set_prefab() {
 
     ecs_fini(world);
 }
+
+void SystemOnSet_delete_system() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ECS_SYSTEM(world, OnPosition, EcsOnSet, Position);
+
+    Probe ctx = { 0 };
+    ecs_set_context(world, &ctx);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    test_int(ctx.invoked, 1);
+
+    ecs_delete(world, OnPosition);
+
+    ctx = (Probe){ 0 };
+
+    ecs_set(world, e, Position, {10, 20});
+    test_int(ctx.invoked, 0);
+
+    ecs_add(world, e, Velocity);
+    ecs_set(world, e, Position, {10, 20});
+    test_int(ctx.invoked, 0);
+
+    ecs_set(world, 0, Position, {10, 20});
+    test_int(ctx.invoked, 0);
+
+    ecs_fini(world);
+}
@@ -0,0 +1,297 @@
+#include <api.h>
+
+void TableGc_setup() {
+    ecs_tracing_enable(-3);
+}
+
+static
+int32_t deleted_tables(
+    ecs_world_t *world)
+{
+    return ecs_get_world_info(world)->table_delete_count_total;
+}
+
+void TableGc_disabled_by_default() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_add(world, e, Velocity);
+    ecs_delete(world, e);
+
+    int32_t deleted = deleted_tables(world);
+
+    int i;
+    for (i = 0; i < 10; i ++) {
+        ecs_progress(world, 1);
+    }
+
+    test_int(deleted_tables(world), deleted);
+
+    ecs_fini(world);
+}
+
+void TableGc_collect_empty_table() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    /* Collect empty tables created while bootstrapping the world */
+    ecs_gc(world);
+
+    ecs_set_table_gc(world, 2);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_add(world, e, Velocity);
+    ecs_delete(world, e);
+
+    int32_t deleted = deleted_tables(world);
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+    test_int(deleted_tables(world), deleted);
+
+    /* [Position] and [Position, Velocity] are collected */
+    ecs_progress(world, 1);
+    test_int(deleted_tables(world), deleted + 2);
+
+    /* Tables are recreated when needed */
+    e = ecs_new(world, Position);
+    ecs_add(world, e, Velocity);
+    test_assert(ecs_has(world, e, Position));
+    test_assert(ecs_has(world, e, Velocity));
+
+    ecs_fini(world);
+}
+
+void TableGc_skip_non_empty_table() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    /* Collect empty tables created while bootstrapping the world */
+    ecs_gc(world);
+
+    ecs_set_table_gc(world, 1);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+
+    int32_t deleted = deleted_tables(world);
+
+    int i;
+    for (i = 0; i < 5; i ++) {
+        ecs_progress(world, 1);
+    }
+
+    test_int(deleted_tables(world), deleted);
+
+    const Position *p = ecs_get(world, e, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(world);
+}
+
+void TableGc_refill_resets_counter() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    /* Collect empty tables created while bootstrapping the world */
+    ecs_gc(world);
+
+    ecs_set_table_gc(world, 3);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_delete(world, e);
+    ecs_delete(world, e2);
+
+    int32_t deleted = deleted_tables(world);
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+
+    /* Table is filled and emptied between two frames */
+    e = ecs_new(world, Position);
+    ecs_delete(world, e);
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+    test_int(deleted_tables(world), deleted);
+
+    ecs_progress(world, 1);
+    test_int(deleted_tables(world), deleted + 1);
+
+    ecs_fini(world);
+}
+
+void TableGc_manual_gc() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    /* Collect empty tables created while bootstrapping the world */
+    ecs_gc(world);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_add(world, e, Velocity);
+    ecs_delete(world, e);
+
+    int32_t deleted = deleted_tables(world);
+    test_int(ecs_gc(world), 2);
+    test_int(deleted_tables(world), deleted + 2);
+
+    /* Nothing left to collect */
+    test_int(ecs_gc(world), 0);
+
+    ecs_fini(world);
+}
+
+static
+void Dummy(ecs_iter_t *it) {
+    probe_system(it);
+}
+
+void TableGc_unmatch_query() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, Position);
+
+    ecs_query_t *q = ecs_query_new(world, "Position");
+
+    /* Collect empty tables created while bootstrapping the world */
+    ecs_gc(world);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_add(world, e, Velocity);
+    ecs_delete(world, e);
+
+    test_int(ecs_gc(world), 2);
+
+    /* Query no longer returns collected tables */
+    ecs_iter_t it = ecs_query_iter(q);
+    test_assert(!ecs_query_next(&it));
+
+    /* Recreated table is matched again */
+    e = ecs_new(world, Position);
+    ecs_add(world, e, Velocity);
+
+    it = ecs_query_iter(q);
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e);
+    test_assert(!ecs_query_next(&it));
+
+    Probe ctx = {0};
+    ecs_set_context(world, &ctx);
+
+    ecs_progress(world, 1);
+    test_int(ctx.count, 1);
+    test_int(ctx.e[0], e);
+
+    ecs_fini(world);
+}
+
+void TableGc_asymmetric_edges() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    /* Collect empty tables created while bootstrapping the world */
+    ecs_gc(world);
+
+    /* Create [Position, Velocity] from [Position] and from [Velocity], so that
+     * only one of the tables has a back link from [Position, Velocity] */
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_add(world, e1, Velocity);
+
+    ecs_entity_t e2 = ecs_new(world, Velocity);
+    ecs_add(world, e2, Position);
+
+    ecs_entity_t e3 = ecs_new(world, Velocity);
+
+    ecs_delete(world, e1);
+    ecs_delete(world, e2);
+
+    /* [Velocity] is not empty, so only [Position] and [Position, Velocity] are
+     * collected. The add edge of [Velocity] must no longer point to the
+     * deleted table. */
+    test_int(ecs_gc(world), 2);
+
+    ecs_add(world, e3, Position);
+    test_assert(ecs_has(world, e3, Position));
+    test_assert(ecs_has(world, e3, Velocity));
+
+    ecs_remove(world, e3, Velocity);
+    test_assert(ecs_has(world, e3, Position));
+    test_assert(!ecs_has(world, e3, Velocity));
+
+    ecs_fini(world);
+}
+
+void TableGc_child_table() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t child = ecs_new_w_entity(world, ECS_CHILDOF | parent);
+    ecs_add(world, child, Position);
+    ecs_delete(world, child);
+
+    test_assert(ecs_gc(world) != 0);
+
+    /* Collected tables are no longer in the scope of the parent */
+    ecs_iter_t it = ecs_scope_iter(world, parent);
+    while (ecs_scope_next(&it)) {
+        test_int(it.count, 0);
+    }
+
+    child = ecs_new_w_entity(world, ECS_CHILDOF | parent);
+    ecs_add(world, child, Position);
+
+    it = ecs_scope_iter(world, parent);
+    int32_t count = 0;
+    while (ecs_scope_next(&it)) {
+        count += it.count;
+    }
+    test_int(count, 1);
+
+    ecs_delete(world, parent);
+    test_assert(!ecs_is_alive(world, child));
+
+    ecs_fini(world);
+}
+
+void TableGc_skip_scope_table() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_set_scope(world, parent);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_delete(world, e);
+
+    ecs_gc(world);
+
+    /* Scope table is still valid */
+    e = ecs_new(world, 0);
+    test_assert(ecs_has_entity(world, e, ECS_CHILDOF | parent));
+
+    ecs_set_scope(world, 0);
+
+    ecs_fini(world);
+}
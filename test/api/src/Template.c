@@ -0,0 +1,557 @@
+#include <api.h>
+
+void Template_setup() {
+    ecs_tracing_enable(-3);
+}
+
+void Template_new_world() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ECS_TAG(world, Tag);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {30, 40});
+    ecs_set(world, e2, Velocity, {1, 2});
+    ecs_add(world, e2, Tag);
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+    test_assert(clone != NULL);
+    test_assert(clone != world);
+
+    test_assert(ecs_is_alive(clone, e1));
+    test_assert(ecs_is_alive(clone, e2));
+    test_assert(ecs_has(clone, e1, Position));
+    test_assert(!ecs_has(clone, e1, Velocity));
+    test_assert(ecs_has(clone, e2, Tag));
+
+    const Position *p = ecs_get(clone, e1, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    p = ecs_get(clone, e2, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    const Velocity *v = ecs_get(clone, e2, Velocity);
+    test_assert(v != NULL);
+    test_int(v->x, 1);
+    test_int(v->y, 2);
+
+    test_int(ecs_count(clone, Position), 2);
+    test_str(ecs_get_name(clone, ecs_typeid(Position)), "Position");
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+void Template_worlds_are_independent() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+
+    ecs_world_t *clone_1 = ecs_init_w_template(world);
+    ecs_world_t *clone_2 = ecs_init_w_template(world);
+
+    ecs_set(clone_1, e, Position, {30, 40});
+    ecs_delete(clone_2, e);
+    ecs_set(world, e, Position, {50, 60});
+
+    const Position *p = ecs_get(clone_1, e, Position);
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    test_assert(!ecs_is_alive(clone_2, e));
+    test_assert(ecs_is_alive(clone_1, e));
+
+    p = ecs_get(world, e, Position);
+    test_int(p->x, 50);
+    test_int(p->y, 60);
+
+    /* Deleting the template does not affect the new worlds */
+    ecs_fini(world);
+
+    p = ecs_get(clone_1, e, Position);
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    ecs_fini(clone_1);
+    ecs_fini(clone_2);
+}
+
+void Template_new_entity_after_clone() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+
+    ecs_entity_t e2 = ecs_set(clone, 0, Position, {30, 40});
+    test_assert(e2 != e1);
+    test_assert(e2 > e1);
+    test_int(ecs_count(clone, Position), 2);
+
+    ECS_COMPONENT(clone, Velocity);
+    test_assert(ecs_typeid(Velocity) != ecs_typeid(Position));
+
+    const Position *p = ecs_get(clone, e1, Position);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+static
+void Move(ecs_iter_t *it) {
+    Position *p = ecs_column(it, Position, 1);
+    Velocity *v = ecs_column(it, Velocity, 2);
+
+    int32_t i;
+    for (i = 0; i < it->count; i ++) {
+        p[i].x += v[i].x;
+        p[i].y += v[i].y;
+    }
+}
+
+void Template_system() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ECS_SYSTEM(world, Move, EcsOnUpdate, Position, Velocity);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, e, Velocity, {1, 2});
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+    test_assert(ecs_has_entity(clone, Move, EcsOnUpdate));
+
+    ecs_progress(clone, 1);
+
+    const Position *p = ecs_get(clone, e, Position);
+    test_int(p->x, 11);
+    test_int(p->y, 22);
+
+    /* Entities created after cloning are matched */
+    ecs_entity_t e2 = ecs_set(clone, 0, Position, {0, 0});
+    ecs_set(clone, e2, Velocity, {3, 4});
+
+    ecs_progress(clone, 1);
+
+    p = ecs_get(clone, e, Position);
+    test_int(p->x, 12);
+    test_int(p->y, 24);
+
+    p = ecs_get(clone, e2, Position);
+    test_int(p->x, 3);
+    test_int(p->y, 4);
+
+    /* Template is not progressed */
+    p = ecs_get(world, e, Position);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+static
+void CountSystem(ecs_iter_t *it) {
+    int32_t *count = ecs_get_context(it->world);
+    (*count) += it->count;
+}
+
+void Template_disabled_system() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, CountSystem, EcsOnUpdate, Position);
+    ecs_enable(world, CountSystem, false);
+
+    ecs_set(world, 0, Position, {10, 20});
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+
+    int32_t count = 0;
+    ecs_set_context(clone, &count);
+
+    ecs_progress(clone, 1);
+    test_int(count, 0);
+
+    ecs_enable(clone, CountSystem, true);
+    ecs_progress(clone, 1);
+    test_int(count, 1);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+void Template_system_interval() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, CountSystem, EcsOnUpdate, Position);
+    ecs_set_interval(world, CountSystem, 2.0);
+
+    ecs_set(world, 0, Position, {10, 20});
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+    test_flt(ecs_get_interval(clone, CountSystem), 2.0);
+
+    int32_t count = 0;
+    ecs_set_context(clone, &count);
+
+    ecs_progress(clone, 1);
+    test_int(count, 0);
+
+    ecs_progress(clone, 1);
+    test_int(count, 1);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+static
+void OnSetPosition(ecs_iter_t *it) {
+    int32_t *count = ecs_get_context(it->world);
+    (*count) += it->count;
+}
+
+void Template_on_set_system() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, OnSetPosition, EcsOnSet, Position);
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+
+    ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, 0, Position, {30, 40});
+    test_int(count, 2);
+
+    /* Copied components are set in the new world */
+    ecs_world_t *clone = ecs_init_w_template(world);
+    test_assert(ecs_get_context(clone) == &count);
+    test_int(count, 4);
+
+    ecs_set(clone, 0, Position, {50, 60});
+    test_int(count, 5);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+static
+void OnAddPosition(ecs_iter_t *it) {
+    int32_t *count = ecs_get_context(it->world);
+    (*count) += it->count;
+}
+
+void Template_trigger() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_TRIGGER(world, OnAddPosition, EcsOnAdd, Position);
+
+    int32_t count = 0;
+    ecs_set_context(world, &count);
+
+    ecs_add(world, 0, Position);
+    test_int(count, 1);
+
+    /* Triggers are not invoked for copied components */
+    ecs_world_t *clone = ecs_init_w_template(world);
+    test_int(count, 1);
+
+    ecs_add(clone, 0, Position);
+    test_int(count, 2);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+typedef struct String {
+    char *value;
+} String;
+
+ECS_CTOR(String, ptr, {
+    ptr->value = NULL;
+})
+
+ECS_DTOR(String, ptr, {
+    ecs_os_free(ptr->value);
+})
+
+ECS_COPY(String, dst, src, {
+    ecs_os_free(dst->value);
+    dst->value = ecs_os_strdup(src->value);
+})
+
+ECS_MOVE(String, dst, src, {
+    ecs_os_free(dst->value);
+    dst->value = src->value;
+    src->value = NULL;
+})
+
+void Template_component_lifecycle() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, String);
+
+    ecs_set_component_actions(world, String, {
+        .ctor = ecs_ctor(String),
+        .dtor = ecs_dtor(String),
+        .copy = ecs_copy(String),
+        .move = ecs_move(String)
+    });
+
+    ecs_entity_t e = ecs_new(world, 0);
+    String *s = ecs_get_mut(world, e, String, NULL);
+    s->value = ecs_os_strdup("Hello");
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+
+    const String *s_clone = ecs_get(clone, e, String);
+    test_assert(s_clone != NULL);
+    test_str(s_clone->value, "Hello");
+    test_assert(s_clone->value != s->value);
+
+    /* Values are moved with the component actions of the new world */
+    ECS_COMPONENT(clone, Position);
+    ecs_add(clone, e, Position);
+    s_clone = ecs_get(clone, e, String);
+    test_str(s_clone->value, "Hello");
+
+    ecs_fini(world);
+    ecs_fini(clone);
+}
+
+void Template_lookup_and_hierarchy() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t parent = ecs_new_entity(world, 0, "Parent", "Position");
+    ecs_entity_t child = ecs_new_w_entity(world, ECS_CHILDOF | parent);
+    ecs_set(world, child, EcsName, {"Child"});
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+
+    test_assert(ecs_lookup(clone, "Parent") == parent);
+    test_assert(ecs_lookup_fullpath(clone, "Parent.Child") == child);
+    test_assert(ecs_get_parent_w_entity(clone, child, 0) == parent);
+    test_int(ecs_get_child_count(clone, parent), 1);
+
+    /* Deleting a parent in the new world deletes its children */
+    ecs_delete(clone, parent);
+    test_assert(!ecs_is_alive(clone, child));
+    test_assert(ecs_is_alive(world, child));
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+void Template_prefab() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ECS_PREFAB(world, Base, Position, Velocity);
+    ecs_set(world, Base, Position, {10, 20});
+    ecs_set(world, Base, Velocity, {1, 2});
+
+    ecs_entity_t e = ecs_new_w_entity(world, ECS_INSTANCEOF | Base);
+    ecs_set(world, e, Velocity, {3, 4});
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+
+    /* Shared component is read from the base in the new world */
+    const Position *p = ecs_get(clone, e, Position);
+    test_assert(p != NULL);
+    test_assert(p == ecs_get(clone, Base, Position));
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    const Velocity *v = ecs_get(clone, e, Velocity);
+    test_assert(v != ecs_get(clone, Base, Velocity));
+    test_int(v->x, 3);
+    test_int(v->y, 4);
+
+    ecs_set(clone, Base, Position, {30, 40});
+    p = ecs_get(clone, e, Position);
+    test_int(p->x, 30);
+    test_int(p->y, 40);
+
+    p = ecs_get(world, e, Position);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+void Template_type() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ECS_TYPE(world, Movable, Position, Velocity);
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+
+    ecs_entity_t e = ecs_new(clone, Movable);
+    test_assert(ecs_has(clone, e, Position));
+    test_assert(ecs_has(clone, e, Velocity));
+
+    const EcsType *type = ecs_get(clone, Movable, EcsType);
+    test_assert(type != NULL);
+    test_assert(type->normalized == ecs_get_type(clone, e));
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+void Template_singleton() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_singleton_set(world, Position, {10, 20});
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+
+    const Position *p = ecs_singleton_get(clone, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+void Template_sparse_component() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ecs_set_component_sparse(world, Velocity);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, e, Velocity, {1, 2});
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+
+    const Velocity *v = ecs_get(clone, e, Velocity);
+    test_assert(v != NULL);
+    test_assert(v != ecs_get(world, e, Velocity));
+    test_int(v->x, 1);
+    test_int(v->y, 2);
+
+    /* Component is stored in a sparse set in the new world */
+    test_int(ecs_vector_count(ecs_get_type(clone, e)), 1);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
+
+void Template_template_deleted() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ECS_TYPE(world, Movable, Position, Velocity);
+
+    char *signature = ecs_os_strdup("Position, Velocity");
+    ecs_entity_t move = ecs_new_system(
+        world, 0, "Move", EcsOnUpdate, signature, Move);
+
+    ecs_entity_t e = ecs_new(world, Movable);
+    ecs_set(world, e, Position, {10, 20});
+    ecs_set(world, e, Velocity, {1, 2});
+
+    ecs_world_t *clone = ecs_init_w_template(world);
+
+    /* The new world does not use memory of the template */
+    ecs_fini(world);
+    ecs_os_free(signature);
+
+    ecs_progress(clone, 1);
+
+    const Position *p = ecs_get(clone, e, Position);
+    test_int(p->x, 11);
+    test_int(p->y, 22);
+
+    /* Redeclaring the system compares the signature with the copy */
+    test_assert(ecs_new_system(clone, 0, "Move", EcsOnUpdate,
+        "Position, Velocity", Move) == move);
+
+    /* Type handles of the template are not valid for the new world */
+    ecs_type_t movable = ecs_type_from_entity(clone, Movable);
+    test_assert(movable != NULL);
+    ecs_entity_t e2 = ecs_new_w_type(clone, movable);
+    test_assert(ecs_has(clone, e2, Position));
+    test_assert(ecs_has(clone, e2, Velocity));
+
+    ecs_fini(clone);
+}
+
+typedef struct {
+    int32_t on_add;
+    int32_t on_set;
+} CallbackCount;
+
+static
+void CountOnAdd(ecs_iter_t *it) {
+    CallbackCount *count = ecs_get_context(it->world);
+    count->on_add += it->count;
+}
+
+static
+void CountOnSet(ecs_iter_t *it) {
+    CallbackCount *count = ecs_get_context(it->world);
+    count->on_set += it->count;
+}
+
+void Template_on_set_system_w_multiple_components() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    CallbackCount count = {0};
+    ecs_set_context(world, &count);
+
+    ECS_SYSTEM(world, CountOnSet, EcsOnSet, Position, Velocity);
+    ECS_TRIGGER(world, CountOnAdd, EcsOnAdd, Position);
+
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, e1, Velocity, {1, 2});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {30, 40});
+    ecs_set(world, e2, Velocity, {3, 4});
+    test_int(count.on_add, 2);
+    test_int(count.on_set, 2);
+
+    /* The system is invoked once for each copied entity, the trigger is not
+     * invoked */
+    ecs_world_t *clone = ecs_init_w_template(world);
+    test_int(count.on_add, 2);
+    test_int(count.on_set, 4);
+
+    ecs_fini(clone);
+    ecs_fini(world);
+}
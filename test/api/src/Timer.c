@@ -393,3 +393,296 @@ void Timer_rate_filter_w_timer_src() {
 
     ecs_fini(world);
 }
+
+void Timer_wheel_timeout() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, SystemA, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_enable_timer_wheel(world, 1.0);
+
+    ecs_entity_t timer = ecs_set_timeout(world, SystemA, 3.0);
+    test_assert(timer != 0);
+    test_assert(timer == SystemA);
+
+    test_bool(system_a_invoked, false);
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, true);
+
+    system_a_invoked = false;
+
+    /* Make sure this was a one-shot timer */
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);    
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+
+    const EcsTimer *ptr = ecs_get(world, timer, EcsTimer);
+    test_assert(ptr != NULL);
+    test_bool(ptr->active, false);
+
+    ecs_fini(world);
+}
+
+void Timer_wheel_interval() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, SystemA, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_enable_timer_wheel(world, 1.0);
+
+    ecs_entity_t timer = ecs_set_interval(world, SystemA, 3.0);
+    test_assert(timer != 0);
+    test_assert(timer == SystemA);
+
+    int i;
+    for (i = 0; i < 3; i ++) {
+        test_bool(system_a_invoked, false);
+        ecs_progress(world, 1.0);
+        test_bool(system_a_invoked, false);
+        ecs_progress(world, 1.0);
+        test_bool(system_a_invoked, false);
+        ecs_progress(world, 1.0);
+        test_bool(system_a_invoked, true);
+
+        system_a_invoked = false;
+    }
+
+    ecs_fini(world);
+}
+
+void Timer_wheel_start_stop() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, SystemA, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_enable_timer_wheel(world, 1.0);
+
+    ecs_entity_t timer = ecs_set_interval(world, SystemA, 3.0);
+    test_assert(timer != 0);
+
+    ecs_progress(world, 1.0);
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+
+    /* Stop timer */
+    ecs_stop_timer(world, timer);
+
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+
+    /* Start timer, this should reset timer */
+    ecs_start_timer(world, timer);
+
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);    
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, true);
+
+    ecs_fini(world);
+}
+
+static int system_d_invoked;
+
+static
+void SystemD(ecs_iter_t *it) {
+    system_d_invoked ++;
+}
+
+void Timer_wheel_long_timeout() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, SystemD, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_enable_timer_wheel(world, 1.0);
+
+    /* Timeout spans multiple levels of the wheel */
+    ecs_entity_t timer = ecs_set_timeout(world, SystemD, 5000.0);
+    test_assert(timer != 0);
+
+    int i;
+    for (i = 0; i < 4999; i ++) {
+        ecs_progress(world, 1.0);
+    }
+
+    test_int(system_d_invoked, 0);
+
+    ecs_progress(world, 1.0);
+    test_int(system_d_invoked, 1);
+
+    ecs_progress(world, 1.0);
+    test_int(system_d_invoked, 1);
+
+    ecs_fini(world);
+}
+
+void Timer_wheel_large_delta_time() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, SystemD, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_enable_timer_wheel(world, 0.5);
+
+    ecs_entity_t timer = ecs_set_interval(world, SystemD, 100.0);
+    test_assert(timer != 0);
+
+    ecs_progress(world, 99.0);
+    test_int(system_d_invoked, 0);
+
+    /* Frame that crosses the timeout ticks the timer once */
+    ecs_progress(world, 2.0);
+    test_int(system_d_invoked, 1);
+
+    ecs_progress(world, 98.0);
+    test_int(system_d_invoked, 1);
+
+    ecs_progress(world, 1.0);
+    test_int(system_d_invoked, 2);
+
+    ecs_fini(world);
+}
+
+void Timer_wheel_many_timers() {
+    ecs_world_t *world = ecs_init();
+
+    ecs_enable_timer_wheel(world, 1.0);
+
+    ecs_entity_t timers[100];
+    int i;
+    for (i = 0; i < 100; i ++) {
+        timers[i] = ecs_set_timeout(world, 0, (float)(i + 1));
+    }
+
+    /* Make sure tick sources are added */
+    ecs_progress(world, 0);
+
+    int32_t frame;
+    for (frame = 1; frame <= 100; frame ++) {
+        ecs_progress(world, 1.0);
+
+        for (i = 0; i < 100; i ++) {
+            const EcsTickSource *src = ecs_get(
+                world, timers[i], EcsTickSource);
+            test_assert(src != NULL);
+            test_bool(src->tick, i + 1 == frame);
+        }
+    }
+
+    ecs_fini(world);
+}
+
+void Timer_wheel_enable_w_existing_timer() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, SystemA, EcsOnUpdate, Position);
+
+    ecs_new(world, Position);
+
+    ecs_entity_t timer = ecs_set_timeout(world, SystemA, 3.0);
+    test_assert(timer != 0);
+
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+
+    /* Time that already passed is preserved */
+    ecs_enable_timer_wheel(world, 1.0);
+
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, false);
+    ecs_progress(world, 1.0);
+    test_bool(system_a_invoked, true);
+
+    ecs_fini(world);
+}
+
+void Timer_wheel_rate_filter_w_timer_src() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_SYSTEM(world, SystemC, EcsOnUpdate, Position);
+    ECS_ENTITY(world, E1, Position);
+
+    ecs_enable_timer_wheel(world, 1.0);
+
+    ecs_entity_t timer = ecs_set_interval(world, 0, 2.0);
+    test_assert(timer != 0);
+
+    ecs_entity_t filter = ecs_set_rate_filter(world, SystemC, 3, timer);
+    test_assert(filter != 0);
+    test_assert(filter == SystemC);
+
+    int i;
+    for (i = 0; i < 5; i ++) {
+        ecs_progress(world, 1.0);
+        test_bool(system_c_invoked, false);
+    }
+
+    ecs_progress(world, 1.0);
+    test_bool(system_c_invoked, true);
+
+    system_c_invoked = false;
+
+    for (i = 0; i < 5; i ++) {
+        ecs_progress(world, 1.0);
+        test_bool(system_c_invoked, false);
+    }
+
+    ecs_progress(world, 1.0);
+    test_bool(system_c_invoked, true);
+
+    ecs_fini(world);
+}
+
+void Timer_wheel_delete_timer() {
+    ecs_world_t *world = ecs_init();
+
+    ecs_enable_timer_wheel(world, 1.0);
+
+    ecs_entity_t timer_1 = ecs_set_interval(world, 0, 2.0);
+    ecs_entity_t timer_2 = ecs_set_interval(world, 0, 2.0);
+
+    ecs_progress(world, 1.0);
+    ecs_delete(world, timer_1);
+
+    ecs_progress(world, 1.0);
+    test_assert(!ecs_is_alive(world, timer_1));
+
+    const EcsTickSource *src = ecs_get(world, timer_2, EcsTickSource);
+    test_assert(src != NULL);
+    test_bool(src->tick, true);
+
+    ecs_fini(world);
+}
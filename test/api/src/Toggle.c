@@ -0,0 +1,326 @@
+#include <api.h>
+
+void Toggle_setup() {
+    ecs_tracing_enable(-3);
+}
+
+void Toggle_is_enabled_default() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    test_assert(ecs_is_component_enabled(world, e, Position));
+    test_assert(!ecs_is_component_enabled(world, e, Velocity));
+
+    ecs_fini(world);
+}
+
+void Toggle_disable_component() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_set(world, 0, Position, {10, 20});
+
+    ecs_enable_component(world, e, Position, false);
+    test_assert(!ecs_is_component_enabled(world, e, Position));
+    test_assert(ecs_has_entity(world, e, ECS_DISABLED | ecs_typeid(Position)));
+
+    /* Disabled component is still owned by the entity */
+    test_assert(ecs_has(world, e, Position));
+    const Position *p = ecs_get(world, e, Position);
+    test_assert(p != NULL);
+    test_int(p->x, 10);
+    test_int(p->y, 20);
+
+    ecs_fini(world);
+}
+
+void Toggle_enable_disable_no_move() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_enable_component(world, e, Position, false);
+
+    /* After the first disable, toggling only writes a bit */
+    ecs_type_t type = ecs_get_type(world, e);
+    const Position *p = ecs_get(world, e, Position);
+
+    ecs_enable_component(world, e, Position, true);
+    test_assert(ecs_is_component_enabled(world, e, Position));
+    test_assert(ecs_get_type(world, e) == type);
+    test_assert(ecs_get(world, e, Position) == p);
+
+    ecs_enable_component(world, e, Position, false);
+    test_assert(!ecs_is_component_enabled(world, e, Position));
+    test_assert(ecs_get_type(world, e) == type);
+    test_assert(ecs_get(world, e, Position) == p);
+
+    ecs_fini(world);
+}
+
+void Toggle_enable_without_bitset() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_type_t type = ecs_get_type(world, e);
+
+    /* Enabling a component that was never disabled does not add a bitset */
+    ecs_enable_component(world, e, Position, true);
+    test_assert(ecs_get_type(world, e) == type);
+    test_assert(ecs_is_component_enabled(world, e, Position));
+
+    ecs_fini(world);
+}
+
+void Toggle_query_skip_disabled() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_entity_t e3 = ecs_new(world, Position);
+
+    ecs_enable_component(world, e1, Position, false);
+    ecs_enable_component(world, e2, Position, false);
+    ecs_enable_component(world, e3, Position, false);
+    ecs_enable_component(world, e1, Position, true);
+    ecs_enable_component(world, e3, Position, true);
+
+    ecs_query_t *q = ecs_query_new(world, "Position");
+    ecs_iter_t it = ecs_query_iter(q);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e1);
+
+    test_assert(ecs_query_next(&it));
+    test_int(it.count, 1);
+    test_int(it.entities[0], e3);
+
+    test_assert(!ecs_query_next(&it));
+
+    ecs_fini(world);
+}
+
+void Toggle_query_ranges() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    const ecs_entity_t *ids = ecs_bulk_new(world, Position, 200);
+    test_assert(ids != NULL);
+
+    ecs_entity_t entities[200];
+    ecs_os_memcpy(entities, ids, ECS_SIZEOF(ecs_entity_t) * 200);
+
+    /* Disable all entities first, so they are stored in the same table */
+    int32_t i;
+    for (i = 0; i < 200; i ++) {
+        ecs_enable_component(world, entities[i], Position, false);
+    }
+
+    /* Disable ranges that cross 64 bit word boundaries */
+    for (i = 0; i < 200; i ++) {
+        bool enable = !((i >= 10 && i < 70) || (i >= 127 && i < 129) || i == 199);
+        ecs_enable_component(world, entities[i], Position, enable);
+    }
+
+    ecs_query_t *q = ecs_query_new(world, "Position");
+    ecs_iter_t it = ecs_query_iter(q);
+
+    int32_t ranges = 0, count = 0;
+    while (ecs_query_next(&it)) {
+        for (i = 0; i < it.count; i ++) {
+            int32_t row = it.offset + i;
+            test_assert(it.entities[i] == entities[row]);
+            test_assert(ecs_is_component_enabled(
+                world, it.entities[i], Position));
+        }
+        count += it.count;
+        ranges ++;
+    }
+
+    test_int(ranges, 3);
+    test_int(count, 200 - 60 - 2 - 1);
+
+    ecs_fini(world);
+}
+
+void Toggle_query_two_components() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t e1 = ecs_new(world, 0);
+    ecs_add(world, e1, Position);
+    ecs_add(world, e1, Velocity);
+    ecs_entity_t e2 = ecs_new(world, 0);
+    ecs_add(world, e2, Position);
+    ecs_add(world, e2, Velocity);
+    ecs_entity_t e3 = ecs_new(world, 0);
+    ecs_add(world, e3, Position);
+    ecs_add(world, e3, Velocity);
+
+    /* Disable both components first, so that all entities are stored in the
+     * table with both bitsets */
+    ecs_entity_t entities[] = {e1, e2, e3};
+    int32_t i;
+    for (i = 0; i < 3; i ++) {
+        ecs_enable_component(world, entities[i], Position, false);
+        ecs_enable_component(world, entities[i], Velocity, false);
+    }
+
+    ecs_enable_component(world, e1, Velocity, true);
+    ecs_enable_component(world, e2, Position, true);
+    ecs_enable_component(world, e3, Position, true);
+    ecs_enable_component(world, e3, Velocity, true);
+
+    ecs_query_t *q = ecs_query_new(world, "Position, Velocity");
+    ecs_iter_t it = ecs_query_iter(q);
+    int32_t count = 0;
+    while (ecs_query_next(&it)) {
+        test_int(it.count, 1);
+        test_int(it.entities[0], e3);
+        count ++;
+    }
+    test_int(count, 1);
+
+    /* Bitset for Velocity is ignored when Velocity is not queried for */
+    q = ecs_query_new(world, "Position");
+    it = ecs_query_iter(q);
+    count = 0;
+    while (ecs_query_next(&it)) {
+        for (i = 0; i < it.count; i ++) {
+            test_assert(it.entities[i] != e1);
+        }
+        count += it.count;
+    }
+    test_int(count, 2);
+
+    ecs_fini(world);
+}
+
+void Toggle_delete_preserves_bits() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_entity_t e3 = ecs_new(world, Position);
+
+    ecs_enable_component(world, e1, Position, false);
+    ecs_enable_component(world, e2, Position, false);
+    ecs_enable_component(world, e3, Position, false);
+    ecs_enable_component(world, e2, Position, true);
+
+    /* e3 is moved to the row of e1 */
+    ecs_delete(world, e1);
+
+    test_assert(ecs_is_component_enabled(world, e2, Position));
+    test_assert(!ecs_is_component_enabled(world, e3, Position));
+
+    ecs_fini(world);
+}
+
+void Toggle_add_preserves_bits() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, Position);
+    ecs_enable_component(world, e, Position, false);
+
+    ecs_add(world, e, Velocity);
+    test_assert(!ecs_is_component_enabled(world, e, Position));
+    test_assert(ecs_is_component_enabled(world, e, Velocity));
+
+    ecs_remove(world, e, Velocity);
+    test_assert(!ecs_is_component_enabled(world, e, Position));
+
+    ecs_fini(world);
+}
+
+void Toggle_defer_disable() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e = ecs_new(world, Position);
+
+    ecs_defer_begin(world);
+    ecs_enable_component(world, e, Position, false);
+    test_assert(ecs_is_component_enabled(world, e, Position));
+    ecs_defer_end(world);
+
+    test_assert(!ecs_is_component_enabled(world, e, Position));
+
+    ecs_defer_begin(world);
+    ecs_enable_component(world, e, Position, true);
+    test_assert(!ecs_is_component_enabled(world, e, Position));
+    ecs_defer_end(world);
+
+    test_assert(ecs_is_component_enabled(world, e, Position));
+
+    ecs_fini(world);
+}
+
+static
+void Dummy(ecs_iter_t *it) {
+    probe_system(it);
+}
+
+void Toggle_system_skip_disabled() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, Position);
+
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_enable_component(world, e1, Position, false);
+    ecs_enable_component(world, e2, Position, true);
+
+    Probe ctx = {0};
+    ecs_set_context(world, &ctx);
+
+    ecs_progress(world, 1);
+    test_int(ctx.count, 1);
+    test_int(ctx.e[0], e2);
+
+    ecs_fini(world);
+}
+
+void Toggle_snapshot_restore() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ecs_entity_t e1 = ecs_new(world, Position);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_enable_component(world, e1, Position, false);
+    ecs_enable_component(world, e2, Position, true);
+
+    ecs_snapshot_t *s = ecs_snapshot_take(world);
+
+    ecs_enable_component(world, e1, Position, true);
+    ecs_enable_component(world, e2, Position, false);
+
+    ecs_snapshot_restore(world, s);
+
+    test_assert(!ecs_is_component_enabled(world, e1, Position));
+    test_assert(ecs_is_component_enabled(world, e2, Position));
+
+    ecs_fini(world);
+}
@@ -978,10 +978,375 @@ void World_world_stats() {
 
     test_assert(stats.system_seconds_total != 0);
     test_assert(stats.frame_seconds_total != 0);
+    test_assert(stats.table_create_count_total != 0);
+    test_assert(stats.table_append_count_total != 0);
 
     ecs_fini(world);
 }
 
+static
+void test_latency_stat(
+    ecs_latency_stat_t *stat,
+    int32_t expect_count)
+{
+    test_int(stat->samples_count, expect_count);
+
+    test_assert(stat->p50_seconds >= 0);
+    test_assert(stat->p50_seconds <= stat->p95_seconds);
+    test_assert(stat->p95_seconds <= stat->p99_seconds);
+    test_assert(stat->p99_seconds <= stat->max_seconds);
+
+    int32_t i, count = 0;
+    for (i = 0; i < ECS_STAT_HISTOGRAM_BUCKETS; i ++) {
+        count += stat->histogram[i];
+    }
+    test_int(count, expect_count);
+
+    /* Sorted samples must contain the samples of the window in order */
+    float window_sum = 0, sorted_sum = 0;
+    for (i = 0; i < expect_count; i ++) {
+        if (i) {
+            test_assert(stat->sorted[i - 1] <= stat->sorted[i]);
+        }
+        window_sum += stat->window[i];
+        sorted_sum += stat->sorted[i];
+    }
+    test_assert(stat->sorted[expect_count - 1] == stat->max_seconds);
+    test_assert(window_sum - sorted_sum < 0.0001f);
+    test_assert(sorted_sum - window_sum < 0.0001f);
+}
+
+void World_world_stats_latency() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_IMPORT(world, FlecsStats);
+
+    ecs_new_system(world, 0, "CollectWorldStats", 0, "[in] flecs.stats.EcsWorldStats", NULL);
+
+    ecs_progress(world, 0);
+    ecs_progress(world, 0);
+
+    const EcsWorldStats *stats = ecs_get(world, EcsWorld, EcsWorldStats);
+    test_assert(stats != NULL);
+    int32_t count = stats->frame_latency.samples_count;
+
+    int i;
+    for (i = 0; i < 10; i ++) {
+        ecs_progress(world, 0);
+    }
+
+    stats = ecs_get(world, EcsWorld, EcsWorldStats);
+    test_latency_stat((ecs_latency_stat_t*)&stats->frame_latency, count + 10);
+    test_latency_stat((ecs_latency_stat_t*)&stats->system_latency, count + 10);
+    test_latency_stat((ecs_latency_stat_t*)&stats->merge_latency, count + 10);
+    test_assert(stats->frame_latency.max_seconds > 0);
+
+    /* Window should not grow beyond its size */
+    for (i = 0; i < ECS_STAT_WINDOW_SIZE; i ++) {
+        ecs_progress(world, 0);
+    }
+
+    stats = ecs_get(world, EcsWorld, EcsWorldStats);
+    test_latency_stat((ecs_latency_stat_t*)&stats->frame_latency, ECS_STAT_WINDOW_SIZE);
+
+    ecs_fini(world);
+}
+
+static
+void Busy(ecs_iter_t *it) {
+    ecs_os_sleep(0, 1000000);
+}
+
+void World_system_stats_latency() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_IMPORT(world, FlecsStats);
+
+    ECS_SYSTEM(world, Busy, EcsOnUpdate, 0);
+
+    ecs_new_system(world, 0, "CollectSystemStats", 0, "[in] flecs.stats.EcsSystemStats", NULL);
+
+    int i;
+    for (i = 0; i < 5; i ++) {
+        ecs_progress(world, 0);
+    }
+
+    const EcsSystemStats *stats = ecs_get(world, Busy, EcsSystemStats);
+    test_assert(stats != NULL);
+    int32_t count = stats->latency.samples_count;
+    test_assert(count != 0);
+
+    for (i = 0; i < 5; i ++) {
+        ecs_progress(world, 0);
+    }
+
+    stats = ecs_get(world, Busy, EcsSystemStats);
+    test_latency_stat((ecs_latency_stat_t*)&stats->latency, count + 5);
+
+    /* System sleeps for at least 1ms */
+    test_assert(stats->latency.p50_seconds >= 0.001f);
+    test_assert(stats->latency.max_seconds >= 0.001f);
+    test_assert(stats->latency.histogram[0] == 0);
+
+    ecs_fini(world);
+}
+
+void World_table_counters() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_world_info_t before = *ecs_get_world_info(world);
+
+    /* Creates table [Position] */
+    ecs_entity_t e = ecs_new(world, Position);
+
+    const ecs_world_info_t *info = ecs_get_world_info(world);
+    test_int(info->table_create_count_total - before.table_create_count_total, 1);
+    test_int(info->table_append_count_total - before.table_append_count_total, 1);
+    test_int(info->table_move_count_total - before.table_move_count_total, 0);
+
+    /* Creates table [Position, Velocity], moves entity */
+    ecs_add(world, e, Velocity);
+    test_int(info->table_create_count_total - before.table_create_count_total, 2);
+    test_int(info->table_append_count_total - before.table_append_count_total, 2);
+    test_int(info->table_move_count_total - before.table_move_count_total, 1);
+    test_int(info->table_remove_count_total - before.table_remove_count_total, 1);
+
+    /* Moves entity back to existing table */
+    ecs_remove(world, e, Velocity);
+    test_int(info->table_create_count_total - before.table_create_count_total, 2);
+    test_int(info->table_append_count_total - before.table_append_count_total, 3);
+    test_int(info->table_move_count_total - before.table_move_count_total, 2);
+    test_int(info->table_remove_count_total - before.table_remove_count_total, 2);
+
+    ecs_delete(world, e);
+    test_int(info->table_remove_count_total - before.table_remove_count_total, 3);
+
+    ecs_bulk_new(world, Position, 10);
+    test_int(info->table_append_count_total - before.table_append_count_total, 13);
+
+    /* Deleting parent deletes child tables */
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t child = ecs_new_w_entity(world, ECS_CHILDOF | parent);
+    test_assert(child != 0);
+    test_int(info->table_delete_count_total - before.table_delete_count_total, 0);
+
+    ecs_delete(world, parent);
+    test_int(info->table_delete_count_total - before.table_delete_count_total, 1);
+
+    ecs_fini(world);
+}
+
+void World_defer_counters() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t e = ecs_new(world, 0);
+
+    ecs_world_info_t before = *ecs_get_world_info(world);
+
+    ecs_defer_begin(world);
+    ecs_entity_t e2 = ecs_new(world, Position);
+    ecs_add(world, e, Position);
+    ecs_add(world, e, Velocity);
+    ecs_remove(world, e, Velocity);
+    ecs_set(world, e, Position, {10, 20});
+    ecs_delete(world, e2);
+
+    /* Operations are counted when flushed */
+    const ecs_world_info_t *info = ecs_get_world_info(world);
+    test_int(info->defer_add_count_total - before.defer_add_count_total, 0);
+
+    ecs_defer_end(world);
+
+    test_int(info->defer_new_count_total - before.defer_new_count_total, 1);
+    test_int(info->defer_add_count_total - before.defer_add_count_total, 2);
+    test_int(info->defer_remove_count_total - before.defer_remove_count_total, 1);
+    test_int(info->defer_set_count_total - before.defer_set_count_total, 1);
+    test_int(info->defer_delete_count_total - before.defer_delete_count_total, 1);
+    test_int(info->defer_flush_count_total - before.defer_flush_count_total, 6);
+
+    ecs_fini(world);
+}
+
+void World_rematch_counters() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Mass);
+
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, PARENT:Mass, Position);
+
+    ecs_entity_t parent = ecs_new(world, 0);
+    ecs_entity_t child = ecs_new(world, Position);
+    ecs_add_entity(world, child, ECS_CHILDOF | parent);
+
+    ecs_progress(world, 1);
+
+    ecs_world_info_t before = *ecs_get_world_info(world);
+
+    /* Adding Mass to parent should trigger rematch of system */
+    ecs_set(world, parent, Mass, {2});
+    ecs_progress(world, 1);
+
+    const ecs_world_info_t *info = ecs_get_world_info(world);
+    test_assert(info->monitor_eval_count_total > before.monitor_eval_count_total);
+    test_assert(info->rematch_count_total > before.rematch_count_total);
+
+    /* No structural changes, no rematch */
+    before = *info;
+    ecs_progress(world, 1);
+    test_int(info->monitor_eval_count_total, before.monitor_eval_count_total);
+    test_int(info->rematch_count_total, before.rematch_count_total);
+
+    ecs_fini(world);
+}
+
+void World_alloc_tags_balanced() {
+    ecs_alloc_tag_stats_t before[EcsAllocTagCount];
+    ecs_os_memcpy(before, ecs_os_api_alloc_tags, ECS_SIZEOF(before));
+
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    ECS_SYSTEM(world, Dummy, EcsOnUpdate, Position);
+
+    ecs_query_t *q = ecs_query_new(world, "Position");
+
+    ecs_bulk_new(world, Position, 1000);
+    ecs_entity_t e = ecs_new_from_path(world, 0, "Foo.Bar");
+    test_assert(e != 0);
+
+    ecs_defer_begin(world);
+    ecs_add(world, e, Position);
+    ecs_set(world, e, Position, {10, 20});
+    ecs_defer_end(world);
+
+    ecs_snapshot_t *s = ecs_snapshot_take(world);
+    ecs_snapshot_free(s);
+
+    ecs_progress(world, 1);
+
+    test_assert(ecs_os_api_alloc_tags[EcsAllocColumns].bytes > 
+        before[EcsAllocColumns].bytes);
+    test_assert(ecs_os_api_alloc_tags[EcsAllocEdges].bytes > 
+        before[EcsAllocEdges].bytes);
+    test_assert(ecs_os_api_alloc_tags[EcsAllocEntityIndex].bytes > 
+        before[EcsAllocEntityIndex].bytes);
+    test_assert(ecs_os_api_alloc_tags[EcsAllocQuery].bytes > 
+        before[EcsAllocQuery].bytes);
+    test_assert(ecs_os_api_alloc_tags[EcsAllocMap].bytes > 
+        before[EcsAllocMap].bytes);
+    test_assert(ecs_os_api_alloc_tags[EcsAllocName].bytes > 
+        before[EcsAllocName].bytes);
+    test_assert(ecs_os_api_alloc_tags[EcsAllocDefer].alloc_count > 
+        before[EcsAllocDefer].alloc_count);
+    test_assert(ecs_os_api_alloc_tags[EcsAllocSnapshot].alloc_count > 
+        before[EcsAllocSnapshot].alloc_count);
+
+    ecs_query_free(q);
+
+    ecs_fini(world);
+
+    /* All memory attributed to subsystems must be released by ecs_fini */
+    int i;
+    for (i = 0; i < EcsAllocTagCount; i ++) {
+        test_int(ecs_os_api_alloc_tags[i].bytes, before[i].bytes);
+    }
+}
+
+void World_alloc_tags_defer() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ECS_TYPE(world, Type, Position, Velocity);
+
+    ecs_entity_t e = ecs_new(world, 0);
+    int64_t bytes = ecs_os_api_alloc_tags[EcsAllocDefer].bytes;
+
+    /* Queued operations are attributed to the defer queue until flushed */
+    ecs_defer_begin(world);
+    ecs_set(world, e, Position, {10, 20});
+    ecs_add(world, e, Type);
+    test_assert(ecs_os_api_alloc_tags[EcsAllocDefer].bytes > bytes);
+    ecs_defer_end(world);
+
+    test_int(ecs_os_api_alloc_tags[EcsAllocDefer].bytes, bytes);
+
+    ecs_fini(world);
+}
+
+void World_alloc_tags_columns() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_COMPONENT(world, Position);
+
+    int64_t bytes = ecs_os_api_alloc_tags[EcsAllocColumns].bytes;
+
+    const ecs_entity_t *ids = ecs_bulk_new(world, Position, 1000);
+    test_assert(ids != NULL);
+
+    /* At least the component data, entity ids and record pointers */
+    int64_t min_size = 1000 * (ECS_SIZEOF(Position) + 
+        ECS_SIZEOF(ecs_entity_t) + ECS_SIZEOF(void*));
+    test_assert(ecs_os_api_alloc_tags[EcsAllocColumns].bytes - bytes >= min_size);
+
+    bytes = ecs_os_api_alloc_tags[EcsAllocColumns].bytes;
+
+    /* Bulk deleting entities releases the table columns */
+    ecs_bulk_delete(world, &(ecs_filter_t){
+        .include = ecs_type(Position)
+    });
+    test_assert(ecs_os_api_alloc_tags[EcsAllocColumns].bytes < bytes);
+
+    ecs_fini(world);
+}
+
+void World_alloc_stats_tags() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_IMPORT(world, FlecsStats);
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    /* Make sure that stats are collected by requiring EcsAllocStats */
+    ecs_new_system(world, 0, "CollectAllocStats", 0, "[in] flecs.stats.EcsAllocStats", NULL);
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+
+    const EcsAllocStats *stats = ecs_get(world, EcsWorld, EcsAllocStats);
+    test_assert(stats != NULL);
+
+    int i;
+    for (i = 0; i < EcsAllocTagCount; i ++) {
+        test_int(stats->tags[i].allocd_bytes, ecs_os_api_alloc_tags[i].bytes);
+        test_int(stats->tags[i].alloc_count_total, 
+            ecs_os_api_alloc_tags[i].alloc_count);
+    }
+
+    int64_t columns_bytes = stats->tags[EcsAllocColumns].allocd_bytes;
+    int64_t columns_allocs = stats->tags[EcsAllocColumns].alloc_count_total;
+
+    /* Creating new tables allocates new columns */
+    ecs_new(world, Position);
+    ecs_add(world, ecs_new(world, Position), Velocity);
+    ecs_progress(world, 1);
+
+    stats = ecs_get(world, EcsWorld, EcsAllocStats);
+    test_assert(stats->tags[EcsAllocColumns].allocd_bytes > columns_bytes);
+    test_assert(stats->tags[EcsAllocColumns].alloc_count_total > columns_allocs);
+    test_assert(stats->tags[EcsAllocColumns].alloc_rate > 0);
+
+    ecs_fini(world);
+}
 
 void World_quit() {
     ecs_world_t *world = ecs_init();
@@ -1088,3 +1453,157 @@ void World_is_entity_enabled() {
 
     ecs_fini(world);
 }
+
+void World_component_stats() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_IMPORT(world, FlecsStats);
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+    ECS_COMPONENT(world, Mass);
+
+    /* Entities that exist before stats are collected are accounted for */
+    ecs_entity_t e1 = ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e2 = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, 0, Position, {10, 20});
+    ecs_entity_t e4 = ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, e4, Velocity, {1, 2});
+
+    ecs_new_system(world, 0, "CollectComponentStats", 0, 
+        "[in] flecs.stats.EcsComponentStats", NULL);
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+
+    const EcsComponentStats *stats = ecs_get(
+        world, ecs_typeid(Position), EcsComponentStats);
+    test_assert(stats != NULL);
+    test_int(stats->entity, ecs_typeid(Position));
+    test_int(stats->size_bytes, ECS_SIZEOF(Position));
+    test_int(stats->tables_count, 2);
+    test_int(stats->entities_count, 4);
+    test_int(stats->memory.used_bytes, 4 * ECS_SIZEOF(Position));
+    test_assert(stats->memory.allocd_bytes >= stats->memory.used_bytes);
+
+    stats = ecs_get(world, ecs_typeid(Velocity), EcsComponentStats);
+    test_assert(stats != NULL);
+    test_int(stats->tables_count, 1);
+    test_int(stats->entities_count, 1);
+
+    /* Stats are updated as entities are created, moved and deleted */
+    ecs_delete(world, e1);
+    ecs_add(world, e2, Velocity);
+    ecs_add(world, e4, Mass);
+
+    ecs_progress(world, 1);
+
+    stats = ecs_get(world, ecs_typeid(Position), EcsComponentStats);
+    test_int(stats->tables_count, 3);
+    test_int(stats->entities_count, 3);
+    test_int(stats->memory.used_bytes, 3 * ECS_SIZEOF(Position));
+
+    stats = ecs_get(world, ecs_typeid(Velocity), EcsComponentStats);
+    test_int(stats->tables_count, 2);
+    test_int(stats->entities_count, 2);
+
+    stats = ecs_get(world, ecs_typeid(Mass), EcsComponentStats);
+    test_int(stats->tables_count, 1);
+    test_int(stats->entities_count, 1);
+
+    ecs_fini(world);
+}
+
+void World_component_stats_memory() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_IMPORT(world, FlecsStats);
+
+    ECS_COMPONENT(world, Position);
+    ECS_COMPONENT(world, Velocity);
+
+    ecs_entity_t collect = ecs_new_system(world, 0, "CollectComponentStats", 0, 
+        "[in] flecs.stats.EcsComponentStats", NULL);
+
+    ecs_progress(world, 1);
+
+    /* Create, move and delete entities while stats are tracked */
+    const ecs_entity_t *ids = ecs_bulk_new(world, Position, 10);
+    ecs_entity_t first = ids[0], last = ids[9];
+    ecs_set(world, 0, Position, {10, 20});
+    ecs_set(world, first, Velocity, {1, 2});
+    ecs_delete(world, last);
+    ecs_bulk_new(world, Velocity, 5);
+
+    ecs_progress(world, 1);
+
+    const EcsComponentStats *stats = ecs_get(
+        world, ecs_typeid(Position), EcsComponentStats);
+    test_assert(stats != NULL);
+    test_int(stats->entities_count, 10);
+    test_int(stats->memory.used_bytes, 10 * ECS_SIZEOF(Position));
+
+    /* Allocated memory includes the column headers */
+    test_assert(stats->memory.allocd_bytes > stats->memory.used_bytes);
+    EcsComponentStats p_stats = *stats;
+    EcsComponentStats v_stats = *ecs_get(
+        world, ecs_typeid(Velocity), EcsComponentStats);
+
+    /* Disabling the system stops tracking. When it is enabled again, stats
+     * are computed from the tables, which must match the incremental result */
+    ecs_enable(world, collect, false);
+    ecs_progress(world, 1);
+    ecs_enable(world, collect, true);
+    ecs_progress(world, 1);
+
+    stats = ecs_get(world, ecs_typeid(Position), EcsComponentStats);
+    test_int(stats->tables_count, p_stats.tables_count);
+    test_int(stats->entities_count, p_stats.entities_count);
+    test_int(stats->memory.used_bytes, p_stats.memory.used_bytes);
+    test_int(stats->memory.allocd_bytes, p_stats.memory.allocd_bytes);
+
+    stats = ecs_get(world, ecs_typeid(Velocity), EcsComponentStats);
+    test_int(stats->tables_count, v_stats.tables_count);
+    test_int(stats->entities_count, v_stats.entities_count);
+    test_int(stats->memory.used_bytes, v_stats.memory.used_bytes);
+    test_int(stats->memory.allocd_bytes, v_stats.memory.allocd_bytes);
+
+    ecs_fini(world);
+}
+
+void World_component_stats_bulk() {
+    ecs_world_t *world = ecs_init();
+
+    ECS_IMPORT(world, FlecsStats);
+
+    ECS_COMPONENT(world, Position);
+    ECS_TYPE(world, Type, Position);
+
+    ecs_new_system(world, 0, "CollectComponentStats", 0, 
+        "[in] flecs.stats.EcsComponentStats", NULL);
+
+    ecs_bulk_new(world, Position, 100);
+
+    ecs_progress(world, 1);
+    ecs_progress(world, 1);
+
+    const EcsComponentStats *stats = ecs_get(
+        world, ecs_typeid(Position), EcsComponentStats);
+    test_assert(stats != NULL);
+    test_int(stats->entities_count, 100);
+    test_assert(stats->memory.allocd_bytes >= 100 * ECS_SIZEOF(Position));
+
+    ecs_bulk_delete(world, &(ecs_filter_t){
+        .include = ecs_type(Type)
+    });
+
+    ecs_progress(world, 1);
+
+    /* Memory of cleared table is released */
+    stats = ecs_get(world, ecs_typeid(Position), EcsComponentStats);
+    test_int(stats->entities_count, 0);
+    test_int(stats->memory.used_bytes, 0);
+    test_int(stats->memory.allocd_bytes, 0);
+
+    ecs_fini(world);
+}
@@ -224,6 +224,15 @@ void Hierarchies_get_child_count_2_tables(void);
 void Hierarchies_get_child_count_no_children(void);
 void Hierarchies_scope_iter_after_delete_tree(void);
 void Hierarchies_add_child_after_delete_tree(void);
+void Hierarchies_childof_value_shares_table(void);
+void Hierarchies_childof_value_scope_iter(void);
+void Hierarchies_childof_value_reparent(void);
+void Hierarchies_childof_value_delete_parent(void);
+void Hierarchies_childof_value_delete_child(void);
+void Hierarchies_childof_value_lookup_path(void);
+void Hierarchies_childof_value_snapshot_restore(void);
+void Hierarchies_childof_value_table_column_w_offset(void);
+void Hierarchies_childof_value_not_inherited(void);
 
 // Testsuite 'Add_bulk'
 void Add_bulk_add_comp_from_comp_to_empty(void);
@@ -487,6 +496,8 @@ void Pipeline_no_merge_after_main_out(void);
 void Pipeline_no_merge_after_staged_in_out(void);
 void Pipeline_merge_after_staged_out_before_owned(void);
 void Pipeline_switch_pipeline(void);
+void Pipeline_many_systems_in_order(void);
+void Pipeline_disable_system_in_system(void);
 
 // Testsuite 'SystemMisc'
 void SystemMisc_setup(void);
@@ -593,6 +604,14 @@ void Sorting_sort_1000_entities_again(void);
 void Sorting_sort_1000_entities_2_types(void);
 void Sorting_sort_1000_entities_2_types_again(void);
 void Sorting_sort_1000_entities_add_type_after_sort(void);
+void Sorting_sort_by_key_float(void);
+void Sorting_sort_by_key_int32(void);
+void Sorting_sort_by_key_uint64(void);
+void Sorting_sort_by_key_stable(void);
+void Sorting_sort_by_key_2_tables(void);
+void Sorting_sort_by_key_after_set(void);
+void Sorting_sort_by_key_w_disabled(void);
+void Sorting_sort_by_key_1000_entities(void);
 
 // Testsuite 'Queries'
 void Queries_query_changed_after_new(void);
@@ -625,6 +644,20 @@ void Queries_get_column_size(void);
 void Queries_orphaned_query(void);
 void Queries_nested_orphaned_query(void);
 void Queries_invalid_access_orphaned_query(void);
+void Queries_rematch_after_parent_add(void);
+void Queries_rematch_after_base_add(void);
+void Queries_rematch_after_nested_base_add(void);
+void Queries_rematch_after_grandparent_add(void);
+void Queries_rematch_after_source_add(void);
+void Queries_rematch_w_source_after_parent_add(void);
+void Queries_rematch_after_activate(void);
+void Queries_group_iter(void);
+void Queries_group_iter_no_tables(void);
+void Queries_group_iter_range(void);
+void Queries_group_iter_after_match(void);
+void Queries_group_iter_after_unmatch(void);
+void Queries_group_iter_after_unmatch_active(void);
+void Queries_group_iter_sorted(void);
 
 // Testsuite 'Traits'
 void Traits_type_w_one_trait(void);
@@ -743,6 +776,7 @@ void SystemOnSet_set_from_nothing(void);
 void SystemOnSet_add_null_type_in_on_set(void);
 void SystemOnSet_add_0_entity_in_on_set(void);
 void SystemOnSet_on_set_prefab(void);
+void SystemOnSet_delete_system(void);
 
 // Testsuite 'SystemPeriodic'
 void SystemPeriodic_1_type_1_component(void);
@@ -809,6 +843,15 @@ void Timer_start_stop_interval(void);
 void Timer_rate_filter(void);
 void Timer_rate_filter_w_rate_filter_src(void);
 void Timer_rate_filter_w_timer_src(void);
+void Timer_wheel_timeout(void);
+void Timer_wheel_interval(void);
+void Timer_wheel_start_stop(void);
+void Timer_wheel_long_timeout(void);
+void Timer_wheel_large_delta_time(void);
+void Timer_wheel_many_timers(void);
+void Timer_wheel_enable_w_existing_timer(void);
+void Timer_wheel_rate_filter_w_timer_src(void);
+void Timer_wheel_delete_timer(void);
 
 // Testsuite 'SystemOnDemand'
 void SystemOnDemand_enable_out_after_in(void);
@@ -932,6 +975,17 @@ void Prefab_instanceof_0(void);
 void Prefab_instantiate_empty_child_table(void);
 void Prefab_instantiate_emptied_child_table(void);
 void Prefab_override_2_prefabs(void);
+void Prefab_get_inherited_after_base_move(void);
+void Prefab_get_inherited_after_base_override(void);
+void Prefab_get_inherited_after_base_remove(void);
+void Prefab_get_inherited_after_base_delete(void);
+void Prefab_get_inherited_from_system(void);
+void Prefab_get_inherited_after_nested_base_add(void);
+void Prefab_get_inherited_after_base_bulk_delete(void);
+void Prefab_instantiate_childof_children(void);
+void Prefab_instantiate_childof_nested(void);
+void Prefab_instantiate_childof_mixed(void);
+void Prefab_instantiate_childof_delete_instance(void);
 
 // Testsuite 'System_w_FromContainer'
 void System_w_FromContainer_setup(void);
@@ -997,6 +1051,15 @@ void World_control_fps_random_app(void);
 void World_measure_fps_vs_actual(void);
 void World_measure_delta_time_vs_actual(void);
 void World_world_stats(void);
+void World_world_stats_latency(void);
+void World_system_stats_latency(void);
+void World_table_counters(void);
+void World_defer_counters(void);
+void World_rematch_counters(void);
+void World_alloc_tags_balanced(void);
+void World_alloc_tags_defer(void);
+void World_alloc_tags_columns(void);
+void World_alloc_stats_tags(void);
 void World_quit(void);
 void World_get_delta_time(void);
 void World_get_delta_time_auto(void);
@@ -1005,6 +1068,9 @@ void World_recreate_world_w_component(void);
 void World_no_threading(void);
 void World_no_time(void);
 void World_is_entity_enabled(void);
+void World_component_stats(void);
+void World_component_stats_memory(void);
+void World_component_stats_bulk(void);
 
 // Testsuite 'Type'
 void Type_setup(void);
@@ -1160,6 +1226,17 @@ void MultiThread_change_thread_count(void);
 void MultiThread_multithread_quit(void);
 void MultiThread_schedule_w_tasks(void);
 void MultiThread_reactive_system(void);
+void MultiThread_par_iter_no_threads(void);
+void MultiThread_par_iter_2_threads(void);
+void MultiThread_par_iter_4_threads(void);
+void MultiThread_par_iter_deferred(void);
+void MultiThread_par_iter_progress(void);
+void MultiThread_read_in_progress(void);
+void MultiThread_read_epoch_per_merge(void);
+void MultiThread_read_query_no_side_effects(void);
+void MultiThread_read_wait_for_progress(void);
+void MultiThread_alloc_tags_balanced(void);
+void MultiThread_sort_postponed_while_readable(void);
 
 // Testsuite 'DeferredActions'
 void DeferredActions_defer_new(void);
@@ -1299,6 +1376,7 @@ void Snapshot_snapshot_w_filter_after_new(void);
 void Snapshot_snapshot_w_filter_after_delete(void);
 void Snapshot_snapshot_free_empty(void);
 void Snapshot_snapshot_free(void);
+void Snapshot_snapshot_free_w_dtor_wo_copy(void);
 void Snapshot_snapshot_free_filtered(void);
 void Snapshot_snapshot_activate_table_w_filter(void);
 void Snapshot_snapshot_copy(void);
@@ -1397,6 +1475,150 @@ void DirectAccess_get_column_empty_table(void);
 void DirectAccess_delete_column_empty_table(void);
 void DirectAccess_get_record_column_empty_table(void);
 
+// Testsuite 'Profiler'
+void Profiler_setup(void);
+void Profiler_disabled_by_default(void);
+void Profiler_enable_disable(void);
+void Profiler_enable_disable_n_times(void);
+void Profiler_record_frame(void);
+void Profiler_record_system(void);
+void Profiler_record_merge(void);
+void Profiler_record_defer_flush(void);
+void Profiler_record_pipeline_build(void);
+void Profiler_record_table_create(void);
+void Profiler_ring_buffer_wraps(void);
+void Profiler_clear(void);
+void Profiler_get_span_out_of_range(void);
+void Profiler_record_worker_threads(void);
+void Profiler_to_json(void);
+void Profiler_to_json_disabled(void);
+
+// Testsuite 'TableGc'
+void TableGc_setup(void);
+void TableGc_disabled_by_default(void);
+void TableGc_collect_empty_table(void);
+void TableGc_skip_non_empty_table(void);
+void TableGc_refill_resets_counter(void);
+void TableGc_manual_gc(void);
+void TableGc_unmatch_query(void);
+void TableGc_asymmetric_edges(void);
+void TableGc_child_table(void);
+void TableGc_skip_scope_table(void);
+
+// Testsuite 'Toggle'
+void Toggle_setup(void);
+void Toggle_is_enabled_default(void);
+void Toggle_disable_component(void);
+void Toggle_enable_disable_no_move(void);
+void Toggle_enable_without_bitset(void);
+void Toggle_query_skip_disabled(void);
+void Toggle_query_ranges(void);
+void Toggle_query_two_components(void);
+void Toggle_delete_preserves_bits(void);
+void Toggle_add_preserves_bits(void);
+void Toggle_defer_disable(void);
+void Toggle_system_skip_disabled(void);
+void Toggle_snapshot_restore(void);
+
+// Testsuite 'SparseStorage'
+void SparseStorage_setup(void);
+void SparseStorage_add_has_get(void);
+void SparseStorage_set_no_table_move(void);
+void SparseStorage_remove(void);
+void SparseStorage_new_w_sparse(void);
+void SparseStorage_delete(void);
+void SparseStorage_clear(void);
+void SparseStorage_ctor_dtor(void);
+void SparseStorage_defer_add(void);
+void SparseStorage_query_sparse(void);
+void SparseStorage_query_not_sparse(void);
+void SparseStorage_query_optional_sparse(void);
+void SparseStorage_system_sparse(void);
+
+// Testsuite 'StructOfArrays'
+void StructOfArrays_setup(void);
+void StructOfArrays_set_get_field(void);
+void StructOfArrays_get_field_not_owned(void);
+void StructOfArrays_fields_are_contiguous(void);
+void StructOfArrays_add_remove_other(void);
+void StructOfArrays_remove(void);
+void StructOfArrays_delete_moves_last(void);
+void StructOfArrays_bulk_new(void);
+void StructOfArrays_defer_set(void);
+void StructOfArrays_query_field(void);
+void StructOfArrays_query_optional_field(void);
+void StructOfArrays_system_field(void);
+void StructOfArrays_snapshot_restore(void);
+
+// Testsuite 'CommandQueue'
+void CommandQueue_setup(void);
+void CommandQueue_add_remove(void);
+void CommandQueue_set(void);
+void CommandQueue_delete(void);
+void CommandQueue_flush_in_progress(void);
+void CommandQueue_flush_before_systems(void);
+void CommandQueue_wrap(void);
+void CommandQueue_free_w_pending(void);
+void CommandQueue_multiple_producers(void);
+
+// Testsuite 'DoubleBuffer'
+void DoubleBuffer_setup(void);
+void DoubleBuffer_prev_zero_before_progress(void);
+void DoubleBuffer_prev_after_progress(void);
+void DoubleBuffer_prev_is_readonly(void);
+void DoubleBuffer_prev_after_add(void);
+void DoubleBuffer_prev_after_delete(void);
+void DoubleBuffer_prev_bulk_new(void);
+void DoubleBuffer_system_prev(void);
+void DoubleBuffer_prev_no_merge(void);
+void DoubleBuffer_snapshot_restore(void);
+
+// Testsuite 'Spatial'
+void Spatial_setup(void);
+void Spatial_box_query(void);
+void Spatial_radius_query(void);
+void Spatial_set_moves_entity(void);
+void Spatial_modified_moves_entity(void);
+void Spatial_remove_component(void);
+void Spatial_delete_entity(void);
+void Spatial_existing_entities(void);
+void Spatial_cell_batches(void);
+void Spatial_negative_coords(void);
+void Spatial_index_3d(void);
+void Spatial_free_index(void);
+void Spatial_free_deletes_systems(void);
+void Spatial_nan_position(void);
+void Spatial_out_of_range_position(void);
+
+// Testsuite 'SystemBudget'
+void SystemBudget_setup(void);
+void SystemBudget_entity_budget(void);
+void SystemBudget_entity_budget_ends_at_last_entity(void);
+void SystemBudget_time_budget(void);
+void SystemBudget_entity_and_time_budget(void);
+void SystemBudget_run_ignores_budget(void);
+void SystemBudget_remove_budget(void);
+void SystemBudget_set_budget_resets_cursor(void);
+
+// Testsuite 'Template'
+void Template_setup(void);
+void Template_new_world(void);
+void Template_worlds_are_independent(void);
+void Template_new_entity_after_clone(void);
+void Template_system(void);
+void Template_disabled_system(void);
+void Template_system_interval(void);
+void Template_on_set_system(void);
+void Template_trigger(void);
+void Template_component_lifecycle(void);
+void Template_lookup_and_hierarchy(void);
+void Template_prefab(void);
+void Template_type(void);
+void Template_singleton(void);
+void Template_sparse_component(void);
+void Template_template_deleted(void);
+void Template_on_set_system_w_multiple_components(void);
+
 // Testsuite 'Internals'
 void Internals_setup(void);
 void Internals_deactivate_table(void);
@@ -2239,6 +2461,42 @@ bake_test_case Hierarchies_testcases[] = {
     {
         "add_child_after_delete_tree",
         Hierarchies_add_child_after_delete_tree
+    },
+    {
+        "childof_value_shares_table",
+        Hierarchies_childof_value_shares_table
+    },
+    {
+        "childof_value_scope_iter",
+        Hierarchies_childof_value_scope_iter
+    },
+    {
+        "childof_value_reparent",
+        Hierarchies_childof_value_reparent
+    },
+    {
+        "childof_value_delete_parent",
+        Hierarchies_childof_value_delete_parent
+    },
+    {
+        "childof_value_delete_child",
+        Hierarchies_childof_value_delete_child
+    },
+    {
+        "childof_value_lookup_path",
+        Hierarchies_childof_value_lookup_path
+    },
+    {
+        "childof_value_snapshot_restore",
+        Hierarchies_childof_value_snapshot_restore
+    },
+    {
+        "childof_value_table_column_w_offset",
+        Hierarchies_childof_value_table_column_w_offset
+    },
+    {
+        "childof_value_not_inherited",
+        Hierarchies_childof_value_not_inherited
     }
 };
 
@@ -3192,6 +3450,14 @@ bake_test_case Pipeline_testcases[] = {
     {
         "switch_pipeline",
         Pipeline_switch_pipeline
+    },
+    {
+        "many_systems_in_order",
+        Pipeline_many_systems_in_order
+    },
+    {
+        "disable_system_in_system",
+        Pipeline_disable_system_in_system
     }
 };
 
@@ -3602,6 +3868,38 @@ bake_test_case Sorting_testcases[] = {
     {
         "sort_1000_entities_add_type_after_sort",
         Sorting_sort_1000_entities_add_type_after_sort
+    },
+    {
+        "sort_by_key_float",
+        Sorting_sort_by_key_float
+    },
+    {
+        "sort_by_key_int32",
+        Sorting_sort_by_key_int32
+    },
+    {
+        "sort_by_key_uint64",
+        Sorting_sort_by_key_uint64
+    },
+    {
+        "sort_by_key_stable",
+        Sorting_sort_by_key_stable
+    },
+    {
+        "sort_by_key_2_tables",
+        Sorting_sort_by_key_2_tables
+    },
+    {
+        "sort_by_key_after_set",
+        Sorting_sort_by_key_after_set
+    },
+    {
+        "sort_by_key_w_disabled",
+        Sorting_sort_by_key_w_disabled
+    },
+    {
+        "sort_by_key_1000_entities",
+        Sorting_sort_by_key_1000_entities
     }
 };
 
@@ -3725,6 +4023,62 @@ bake_test_case Queries_testcases[] = {
     {
         "invalid_access_orphaned_query",
         Queries_invalid_access_orphaned_query
+    },
+    {
+        "rematch_after_parent_add",
+        Queries_rematch_after_parent_add
+    },
+    {
+        "rematch_after_base_add",
+        Queries_rematch_after_base_add
+    },
+    {
+        "rematch_after_nested_base_add",
+        Queries_rematch_after_nested_base_add
+    },
+    {
+        "rematch_after_grandparent_add",
+        Queries_rematch_after_grandparent_add
+    },
+    {
+        "rematch_after_source_add",
+        Queries_rematch_after_source_add
+    },
+    {
+        "rematch_w_source_after_parent_add",
+        Queries_rematch_w_source_after_parent_add
+    },
+    {
+        "rematch_after_activate",
+        Queries_rematch_after_activate
+    },
+    {
+        "group_iter",
+        Queries_group_iter
+    },
+    {
+        "group_iter_no_tables",
+        Queries_group_iter_no_tables
+    },
+    {
+        "group_iter_range",
+        Queries_group_iter_range
+    },
+    {
+        "group_iter_after_match",
+        Queries_group_iter_after_match
+    },
+    {
+        "group_iter_after_unmatch",
+        Queries_group_iter_after_unmatch
+    },
+    {
+        "group_iter_after_unmatch_active",
+        Queries_group_iter_after_unmatch_active
+    },
+    {
+        "group_iter_sorted",
+        Queries_group_iter_sorted
     }
 };
 
@@ -4163,6 +4517,10 @@ bake_test_case SystemOnSet_testcases[] = {
     {
         "on_set_prefab",
         SystemOnSet_on_set_prefab
+    },
+    {
+        "delete_system",
+        SystemOnSet_delete_system
     }
 };
 
@@ -4417,6 +4775,42 @@ bake_test_case Timer_testcases[] = {
     {
         "rate_filter_w_timer_src",
         Timer_rate_filter_w_timer_src
+    },
+    {
+        "wheel_timeout",
+        Timer_wheel_timeout
+    },
+    {
+        "wheel_interval",
+        Timer_wheel_interval
+    },
+    {
+        "wheel_start_stop",
+        Timer_wheel_start_stop
+    },
+    {
+        "wheel_long_timeout",
+        Timer_wheel_long_timeout
+    },
+    {
+        "wheel_large_delta_time",
+        Timer_wheel_large_delta_time
+    },
+    {
+        "wheel_many_timers",
+        Timer_wheel_many_timers
+    },
+    {
+        "wheel_enable_w_existing_timer",
+        Timer_wheel_enable_w_existing_timer
+    },
+    {
+        "wheel_rate_filter_w_timer_src",
+        Timer_wheel_rate_filter_w_timer_src
+    },
+    {
+        "wheel_delete_timer",
+        Timer_wheel_delete_timer
     }
 };
 
@@ -4872,6 +5266,50 @@ bake_test_case Prefab_testcases[] = {
     {
         "override_2_prefabs",
         Prefab_override_2_prefabs
+    },
+    {
+        "get_inherited_after_base_move",
+        Prefab_get_inherited_after_base_move
+    },
+    {
+        "get_inherited_after_base_override",
+        Prefab_get_inherited_after_base_override
+    },
+    {
+        "get_inherited_after_base_remove",
+        Prefab_get_inherited_after_base_remove
+    },
+    {
+        "get_inherited_after_base_delete",
+        Prefab_get_inherited_after_base_delete
+    },
+    {
+        "get_inherited_from_system",
+        Prefab_get_inherited_from_system
+    },
+    {
+        "get_inherited_after_nested_base_add",
+        Prefab_get_inherited_after_nested_base_add
+    },
+    {
+        "get_inherited_after_base_bulk_delete",
+        Prefab_get_inherited_after_base_bulk_delete
+    },
+    {
+        "instantiate_childof_children",
+        Prefab_instantiate_childof_children
+    },
+    {
+        "instantiate_childof_nested",
+        Prefab_instantiate_childof_nested
+    },
+    {
+        "instantiate_childof_mixed",
+        Prefab_instantiate_childof_mixed
+    },
+    {
+        "instantiate_childof_delete_instance",
+        Prefab_instantiate_childof_delete_instance
     }
 };
 
@@ -5100,6 +5538,42 @@ bake_test_case World_testcases[] = {
         "world_stats",
         World_world_stats
     },
+    {
+        "world_stats_latency",
+        World_world_stats_latency
+    },
+    {
+        "system_stats_latency",
+        World_system_stats_latency
+    },
+    {
+        "table_counters",
+        World_table_counters
+    },
+    {
+        "defer_counters",
+        World_defer_counters
+    },
+    {
+        "rematch_counters",
+        World_rematch_counters
+    },
+    {
+        "alloc_tags_balanced",
+        World_alloc_tags_balanced
+    },
+    {
+        "alloc_tags_defer",
+        World_alloc_tags_defer
+    },
+    {
+        "alloc_tags_columns",
+        World_alloc_tags_columns
+    },
+    {
+        "alloc_stats_tags",
+        World_alloc_stats_tags
+    },
     {
         "quit",
         World_quit
@@ -5131,6 +5605,18 @@ bake_test_case World_testcases[] = {
     {
         "is_entity_enabled",
         World_is_entity_enabled
+    },
+    {
+        "component_stats",
+        World_component_stats
+    },
+    {
+        "component_stats_memory",
+        World_component_stats_memory
+    },
+    {
+        "component_stats_bulk",
+        World_component_stats_bulk
     }
 };
 
@@ -5724,6 +6210,50 @@ bake_test_case MultiThread_testcases[] = {
     {
         "reactive_system",
         MultiThread_reactive_system
+    },
+    {
+        "par_iter_no_threads",
+        MultiThread_par_iter_no_threads
+    },
+    {
+        "par_iter_2_threads",
+        MultiThread_par_iter_2_threads
+    },
+    {
+        "par_iter_4_threads",
+        MultiThread_par_iter_4_threads
+    },
+    {
+        "par_iter_deferred",
+        MultiThread_par_iter_deferred
+    },
+    {
+        "par_iter_progress",
+        MultiThread_par_iter_progress
+    },
+    {
+        "read_in_progress",
+        MultiThread_read_in_progress
+    },
+    {
+        "read_epoch_per_merge",
+        MultiThread_read_epoch_per_merge
+    },
+    {
+        "read_query_no_side_effects",
+        MultiThread_read_query_no_side_effects
+    },
+    {
+        "read_wait_for_progress",
+        MultiThread_read_wait_for_progress
+    },
+    {
+        "alloc_tags_balanced",
+        MultiThread_alloc_tags_balanced
+    },
+    {
+        "sort_postponed_while_readable",
+        MultiThread_sort_postponed_while_readable
     }
 };
 
@@ -6244,6 +6774,10 @@ bake_test_case Snapshot_testcases[] = {
         "snapshot_free",
         Snapshot_snapshot_free
     },
+    {
+        "snapshot_free_w_dtor_wo_copy",
+        Snapshot_snapshot_free_w_dtor_wo_copy
+    },
     {
         "snapshot_free_filtered",
         Snapshot_snapshot_free_filtered
@@ -6610,6 +7144,492 @@ bake_test_case DirectAccess_testcases[] = {
     }
 };
 
+bake_test_case Profiler_testcases[] = {
+    {
+        "disabled_by_default",
+        Profiler_disabled_by_default
+    },
+    {
+        "enable_disable",
+        Profiler_enable_disable
+    },
+    {
+        "enable_disable_n_times",
+        Profiler_enable_disable_n_times
+    },
+    {
+        "record_frame",
+        Profiler_record_frame
+    },
+    {
+        "record_system",
+        Profiler_record_system
+    },
+    {
+        "record_merge",
+        Profiler_record_merge
+    },
+    {
+        "record_defer_flush",
+        Profiler_record_defer_flush
+    },
+    {
+        "record_pipeline_build",
+        Profiler_record_pipeline_build
+    },
+    {
+        "record_table_create",
+        Profiler_record_table_create
+    },
+    {
+        "ring_buffer_wraps",
+        Profiler_ring_buffer_wraps
+    },
+    {
+        "clear",
+        Profiler_clear
+    },
+    {
+        "get_span_out_of_range",
+        Profiler_get_span_out_of_range
+    },
+    {
+        "record_worker_threads",
+        Profiler_record_worker_threads
+    },
+    {
+        "to_json",
+        Profiler_to_json
+    },
+    {
+        "to_json_disabled",
+        Profiler_to_json_disabled
+    }
+};
+
+bake_test_case TableGc_testcases[] = {
+    {
+        "disabled_by_default",
+        TableGc_disabled_by_default
+    },
+    {
+        "collect_empty_table",
+        TableGc_collect_empty_table
+    },
+    {
+        "skip_non_empty_table",
+        TableGc_skip_non_empty_table
+    },
+    {
+        "refill_resets_counter",
+        TableGc_refill_resets_counter
+    },
+    {
+        "manual_gc",
+        TableGc_manual_gc
+    },
+    {
+        "unmatch_query",
+        TableGc_unmatch_query
+    },
+    {
+        "asymmetric_edges",
+        TableGc_asymmetric_edges
+    },
+    {
+        "child_table",
+        TableGc_child_table
+    },
+    {
+        "skip_scope_table",
+        TableGc_skip_scope_table
+    }
+};
+
+bake_test_case Toggle_testcases[] = {
+    {
+        "is_enabled_default",
+        Toggle_is_enabled_default
+    },
+    {
+        "disable_component",
+        Toggle_disable_component
+    },
+    {
+        "enable_disable_no_move",
+        Toggle_enable_disable_no_move
+    },
+    {
+        "enable_without_bitset",
+        Toggle_enable_without_bitset
+    },
+    {
+        "query_skip_disabled",
+        Toggle_query_skip_disabled
+    },
+    {
+        "query_ranges",
+        Toggle_query_ranges
+    },
+    {
+        "query_two_components",
+        Toggle_query_two_components
+    },
+    {
+        "delete_preserves_bits",
+        Toggle_delete_preserves_bits
+    },
+    {
+        "add_preserves_bits",
+        Toggle_add_preserves_bits
+    },
+    {
+        "defer_disable",
+        Toggle_defer_disable
+    },
+    {
+        "system_skip_disabled",
+        Toggle_system_skip_disabled
+    },
+    {
+        "snapshot_restore",
+        Toggle_snapshot_restore
+    }
+};
+
+bake_test_case SparseStorage_testcases[] = {
+    {
+        "add_has_get",
+        SparseStorage_add_has_get
+    },
+    {
+        "set_no_table_move",
+        SparseStorage_set_no_table_move
+    },
+    {
+        "remove",
+        SparseStorage_remove
+    },
+    {
+        "new_w_sparse",
+        SparseStorage_new_w_sparse
+    },
+    {
+        "delete",
+        SparseStorage_delete
+    },
+    {
+        "clear",
+        SparseStorage_clear
+    },
+    {
+        "ctor_dtor",
+        SparseStorage_ctor_dtor
+    },
+    {
+        "defer_add",
+        SparseStorage_defer_add
+    },
+    {
+        "query_sparse",
+        SparseStorage_query_sparse
+    },
+    {
+        "query_not_sparse",
+        SparseStorage_query_not_sparse
+    },
+    {
+        "query_optional_sparse",
+        SparseStorage_query_optional_sparse
+    },
+    {
+        "system_sparse",
+        SparseStorage_system_sparse
+    }
+};
+
+bake_test_case StructOfArrays_testcases[] = {
+    {
+        "set_get_field",
+        StructOfArrays_set_get_field
+    },
+    {
+        "get_field_not_owned",
+        StructOfArrays_get_field_not_owned
+    },
+    {
+        "fields_are_contiguous",
+        StructOfArrays_fields_are_contiguous
+    },
+    {
+        "add_remove_other",
+        StructOfArrays_add_remove_other
+    },
+    {
+        "remove",
+        StructOfArrays_remove
+    },
+    {
+        "delete_moves_last",
+        StructOfArrays_delete_moves_last
+    },
+    {
+        "bulk_new",
+        StructOfArrays_bulk_new
+    },
+    {
+        "defer_set",
+        StructOfArrays_defer_set
+    },
+    {
+        "query_field",
+        StructOfArrays_query_field
+    },
+    {
+        "query_optional_field",
+        StructOfArrays_query_optional_field
+    },
+    {
+        "system_field",
+        StructOfArrays_system_field
+    },
+    {
+        "snapshot_restore",
+        StructOfArrays_snapshot_restore
+    }
+};
+
+bake_test_case CommandQueue_testcases[] = {
+    {
+        "add_remove",
+        CommandQueue_add_remove
+    },
+    {
+        "set",
+        CommandQueue_set
+    },
+    {
+        "delete",
+        CommandQueue_delete
+    },
+    {
+        "flush_in_progress",
+        CommandQueue_flush_in_progress
+    },
+    {
+        "flush_before_systems",
+        CommandQueue_flush_before_systems
+    },
+    {
+        "wrap",
+        CommandQueue_wrap
+    },
+    {
+        "free_w_pending",
+        CommandQueue_free_w_pending
+    },
+    {
+        "multiple_producers",
+        CommandQueue_multiple_producers
+    }
+};
+
+bake_test_case DoubleBuffer_testcases[] = {
+    {
+        "prev_zero_before_progress",
+        DoubleBuffer_prev_zero_before_progress
+    },
+    {
+        "prev_after_progress",
+        DoubleBuffer_prev_after_progress
+    },
+    {
+        "prev_is_readonly",
+        DoubleBuffer_prev_is_readonly
+    },
+    {
+        "prev_after_add",
+        DoubleBuffer_prev_after_add
+    },
+    {
+        "prev_after_delete",
+        DoubleBuffer_prev_after_delete
+    },
+    {
+        "prev_bulk_new",
+        DoubleBuffer_prev_bulk_new
+    },
+    {
+        "system_prev",
+        DoubleBuffer_system_prev
+    },
+    {
+        "prev_no_merge",
+        DoubleBuffer_prev_no_merge
+    },
+    {
+        "snapshot_restore",
+        DoubleBuffer_snapshot_restore
+    }
+};
+
+bake_test_case Spatial_testcases[] = {
+    {
+        "box_query",
+        Spatial_box_query
+    },
+    {
+        "radius_query",
+        Spatial_radius_query
+    },
+    {
+        "set_moves_entity",
+        Spatial_set_moves_entity
+    },
+    {
+        "modified_moves_entity",
+        Spatial_modified_moves_entity
+    },
+    {
+        "remove_component",
+        Spatial_remove_component
+    },
+    {
+        "delete_entity",
+        Spatial_delete_entity
+    },
+    {
+        "existing_entities",
+        Spatial_existing_entities
+    },
+    {
+        "cell_batches",
+        Spatial_cell_batches
+    },
+    {
+        "negative_coords",
+        Spatial_negative_coords
+    },
+    {
+        "index_3d",
+        Spatial_index_3d
+    },
+    {
+        "free_index",
+        Spatial_free_index
+    },
+    {
+        "free_deletes_systems",
+        Spatial_free_deletes_systems
+    },
+    {
+        "nan_position",
+        Spatial_nan_position
+    },
+    {
+        "out_of_range_position",
+        Spatial_out_of_range_position
+    }
+};
+
+bake_test_case SystemBudget_testcases[] = {
+    {
+        "entity_budget",
+        SystemBudget_entity_budget
+    },
+    {
+        "entity_budget_ends_at_last_entity",
+        SystemBudget_entity_budget_ends_at_last_entity
+    },
+    {
+        "time_budget",
+        SystemBudget_time_budget
+    },
+    {
+        "entity_and_time_budget",
+        SystemBudget_entity_and_time_budget
+    },
+    {
+        "run_ignores_budget",
+        SystemBudget_run_ignores_budget
+    },
+    {
+        "remove_budget",
+        SystemBudget_remove_budget
+    },
+    {
+        "set_budget_resets_cursor",
+        SystemBudget_set_budget_resets_cursor
+    }
+};
+
+bake_test_case Template_testcases[] = {
+    {
+        "new_world",
+        Template_new_world
+    },
+    {
+        "worlds_are_independent",
+        Template_worlds_are_independent
+    },
+    {
+        "new_entity_after_clone",
+        Template_new_entity_after_clone
+    },
+    {
+        "system",
+        Template_system
+    },
+    {
+        "disabled_system",
+        Template_disabled_system
+    },
+    {
+        "system_interval",
+        Template_system_interval
+    },
+    {
+        "on_set_system",
+        Template_on_set_system
+    },
+    {
+        "trigger",
+        Template_trigger
+    },
+    {
+        "component_lifecycle",
+        Template_component_lifecycle
+    },
+    {
+        "lookup_and_hierarchy",
+        Template_lookup_and_hierarchy
+    },
+    {
+        "prefab",
+        Template_prefab
+    },
+    {
+        "type",
+        Template_type
+    },
+    {
+        "singleton",
+        Template_singleton
+    },
+    {
+        "sparse_component",
+        Template_sparse_component
+    },
+    {
+        "template_deleted",
+        Template_template_deleted
+    },
+    {
+        "on_set_system_w_multiple_components",
+        Template_on_set_system_w_multiple_components
+    }
+};
+
 bake_test_case Internals_testcases[] = {
     {
         "deactivate_table",
@@ -6735,7 +7755,7 @@ static bake_test_suite suites[] = {
         "Hierarchies",
         Hierarchies_setup,
         NULL,
-        73,
+        82,
         Hierarchies_testcases
     },
     {
@@ -6840,7 +7860,7 @@ static bake_test_suite suites[] = {
         "Pipeline",
         Pipeline_setup,
         NULL,
-        15,
+        17,
         Pipeline_testcases
     },
     {
@@ -6854,14 +7874,14 @@ static bake_test_suite suites[] = {
         "Sorting",
         NULL,
         NULL,
-        19,
+        27,
         Sorting_testcases
     },
     {
         "Queries",
         NULL,
         NULL,
-        30,
+        44,
         Queries_testcases
     },
     {
@@ -6903,7 +7923,7 @@ static bake_test_suite suites[] = {
         "SystemOnSet",
         NULL,
         NULL,
-        28,
+        29,
         SystemOnSet_testcases
     },
     {
@@ -6917,7 +7937,7 @@ static bake_test_suite suites[] = {
         "Timer",
         NULL,
         NULL,
-        9,
+        18,
         Timer_testcases
     },
     {
@@ -6952,7 +7972,7 @@ static bake_test_suite suites[] = {
         "Prefab",
         Prefab_setup,
         NULL,
-        72,
+        83,
         Prefab_testcases
     },
     {
@@ -6987,7 +8007,7 @@ static bake_test_suite suites[] = {
         "World",
         World_setup,
         NULL,
-        32,
+        44,
         World_testcases
     },
     {
@@ -7008,7 +8028,7 @@ static bake_test_suite suites[] = {
         "MultiThread",
         MultiThread_setup,
         NULL,
-        34,
+        45,
         MultiThread_testcases
     },
     {
@@ -7043,7 +8063,7 @@ static bake_test_suite suites[] = {
         "Snapshot",
         NULL,
         NULL,
-        26,
+        27,
         Snapshot_testcases
     },
     {
@@ -7074,6 +8094,76 @@ static bake_test_suite suites[] = {
         23,
         DirectAccess_testcases
     },
+    {
+        "Profiler",
+        Profiler_setup,
+        NULL,
+        15,
+        Profiler_testcases
+    },
+    {
+        "TableGc",
+        TableGc_setup,
+        NULL,
+        9,
+        TableGc_testcases
+    },
+    {
+        "Toggle",
+        Toggle_setup,
+        NULL,
+        12,
+        Toggle_testcases
+    },
+    {
+        "SparseStorage",
+        SparseStorage_setup,
+        NULL,
+        12,
+        SparseStorage_testcases
+    },
+    {
+        "StructOfArrays",
+        StructOfArrays_setup,
+        NULL,
+        12,
+        StructOfArrays_testcases
+    },
+    {
+        "CommandQueue",
+        CommandQueue_setup,
+        NULL,
+        8,
+        CommandQueue_testcases
+    },
+    {
+        "DoubleBuffer",
+        DoubleBuffer_setup,
+        NULL,
+        9,
+        DoubleBuffer_testcases
+    },
+    {
+        "Spatial",
+        Spatial_setup,
+        NULL,
+        14,
+        Spatial_testcases
+    },
+    {
+        "SystemBudget",
+        SystemBudget_setup,
+        NULL,
+        7,
+        SystemBudget_testcases
+    },
+    {
+        "Template",
+        Template_setup,
+        NULL,
+        16,
+        Template_testcases
+    },
     {
         "Internals",
         Internals_setup,
@@ -7092,5 +8182,5 @@ static bake_test_suite suites[] = {
 
 int main(int argc, char *argv[]) {
     ut_init(argv[0]);
-    return bake_test_run("api", argc, argv, suites, 57);
+    return bake_test_run("api", argc, argv, suites, 67);
 }
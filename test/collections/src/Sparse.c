@@ -398,3 +398,52 @@ void Sparse_size_of_null() {
 void Sparse_copy_null() {
     test_assert(ecs_sparse_copy(NULL) == NULL);
 }
+
+void Sparse_set_chunk_size() {
+    ecs_sparse_t *sp = ecs_sparse_new(int);
+    test_assert(sp != NULL);
+    ecs_sparse_set_chunk_size(sp, 4);
+
+    populate(sp, 128);
+    test_int(ecs_sparse_count(sp), 128);
+
+    int *first = ecs_sparse_get_sparse(sp, int, 0);
+    test_assert(first != NULL);
+    test_int(*first, 0);
+
+    int *elem = ecs_sparse_get_or_create(sp, int, 1000);
+    test_assert(elem != NULL);
+    *elem = 1000;
+    test_int(ecs_sparse_count(sp), 129);
+
+    /* Elements in other chunks must not move when chunks are added */
+    test_assert(ecs_sparse_get_sparse(sp, int, 0) == first);
+
+    int i;
+    for (i = 0; i < 128; i ++) {
+        test_int(*ecs_sparse_get_sparse(sp, int, i), i);
+    }
+    test_int(*ecs_sparse_get_sparse(sp, int, 1000), 1000);
+
+    ecs_sparse_free(sp);
+}
+
+void Sparse_copy_chunk_size() {
+    ecs_sparse_t *sp = ecs_sparse_new(int);
+    test_assert(sp != NULL);
+    ecs_sparse_set_chunk_size(sp, 4);
+
+    populate(sp, 128);
+    test_int(ecs_sparse_count(sp), 128);
+
+    ecs_sparse_t *sp2 = ecs_sparse_copy(sp);
+    ecs_sparse_free(sp);
+    test_int(ecs_sparse_count(sp2), 128);
+
+    int i;
+    for (i = 0; i < 128; i ++) {
+        test_int(*ecs_sparse_get_sparse(sp2, int, i), i);
+    }
+
+    ecs_sparse_free(sp2);
+}
@@ -94,6 +94,8 @@ void Sparse_create_delete_2(void);
 void Sparse_count_of_null(void);
 void Sparse_size_of_null(void);
 void Sparse_copy_null(void);
+void Sparse_set_chunk_size(void);
+void Sparse_copy_chunk_size(void);
 
 // Testsuite 'Strbuf'
 void Strbuf_setup(void);
@@ -421,6 +423,14 @@ bake_test_case Sparse_testcases[] = {
     {
         "copy_null",
         Sparse_copy_null
+    },
+    {
+        "set_chunk_size",
+        Sparse_set_chunk_size
+    },
+    {
+        "copy_chunk_size",
+        Sparse_copy_chunk_size
     }
 };
 
@@ -509,7 +519,7 @@ static bake_test_suite suites[] = {
         "Sparse",
         Sparse_setup,
         NULL,
-        23,
+        25,
         Sparse_testcases
     },
     {
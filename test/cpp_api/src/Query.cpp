@@ -550,3 +550,61 @@ void Query_shared_tag_w_each() {
         test_assert(qe == e);
     });
 }
+
+void Query_par_each() {
+    flecs::world world;
+
+    flecs::component<Position>(world, "Position");
+    flecs::component<Velocity>(world, "Velocity");
+
+    auto e1 = flecs::entity(world)
+        .set<Position>({10, 20})
+        .set<Velocity>({1, 2});
+
+    auto e2 = flecs::entity(world)
+        .set<Position>({30, 40})
+        .set<Velocity>({3, 4});
+
+    auto e3 = flecs::entity(world)
+        .set<Position>({50, 60})
+        .set<Velocity>({5, 6});
+
+    flecs::query<Position, const Velocity> q(world);
+
+    q.par_each([](flecs::entity e, Position& p, const Velocity& v) {
+        p.x += v.x;
+        p.y += v.y;
+    }, 2);
+
+    const Position *p = e1.get<Position>();
+    test_int(p->x, 11);
+    test_int(p->y, 22);
+
+    p = e2.get<Position>();
+    test_int(p->x, 33);
+    test_int(p->y, 44);
+
+    p = e3.get<Position>();
+    test_int(p->x, 55);
+    test_int(p->y, 66);
+}
+
+void Query_par_iter() {
+    flecs::world world;
+
+    flecs::component<Position>(world, "Position");
+
+    for (int i = 0; i < 10; i ++) {
+        flecs::entity(world).set<Position>({10, 20});
+    }
+
+    flecs::query<Position> q(world);
+
+    int count = 0;
+    q.par_iter([&](flecs::iter& it, Position *p) {
+        test_assert(it.count() <= 3);
+        count += it.count();
+    }, 3);
+
+    test_int(count, 10);
+}
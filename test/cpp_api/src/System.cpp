@@ -569,3 +569,150 @@ void System_each_tag() {
 
     test_int(invoked, 1);
 }
+
+void System_each_optional_shared() {
+    flecs::world world;
+
+    flecs::component<Position>(world, "Position");
+    flecs::component<Velocity>(world, "Velocity");
+
+    auto base = flecs::entity(world)
+        .set<Velocity>({1, 2});
+
+    auto e1 = flecs::entity(world)
+        .set<Position>({10, 20})
+        .add_instanceof(base);
+
+    auto e2 = flecs::entity(world)
+        .set<Position>({30, 40})
+        .add_instanceof(base);
+
+    auto e3 = flecs::entity(world)
+        .set<Position>({50, 60})
+        .set<Velocity>({3, 4});
+
+    auto e4 = flecs::entity(world)
+        .set<Position>({70, 80});
+
+    flecs::system<Position, const Velocity*>(world)
+        .each([](flecs::entity e, Position& p, const Velocity* v) {
+            if (v) {
+                p.x += v->x;
+                p.y += v->y;
+            } else {
+                p.x ++;
+                p.y ++;
+            }
+        });
+
+    world.progress();
+
+    const Position *p = e1.get<Position>();
+    test_int(p->x, 11);
+    test_int(p->y, 22);
+
+    p = e2.get<Position>();
+    test_int(p->x, 31);
+    test_int(p->y, 42);
+
+    p = e3.get<Position>();
+    test_int(p->x, 53);
+    test_int(p->y, 64);
+
+    p = e4.get<Position>();
+    test_int(p->x, 71);
+    test_int(p->y, 81);
+}
+
+void System_each_run_w_param() {
+    flecs::world world;
+
+    flecs::component<Position>(world, "Position");
+
+    auto e = flecs::entity(world)
+        .set<Position>({10, 20});
+
+    int param = 5;
+
+    auto s = flecs::system<Position>(world, nullptr)
+        .kind(0)
+        .iter([](flecs::iter it, Position *p) {
+            int *value = static_cast<int*>(it.param());
+            for (auto row : it) {
+                p[row].x += *value;
+                p[row].y += *value;
+            }
+        });
+
+    s.run(0, &param);
+
+    const Position *p = e.get<Position>();
+    test_int(p->x, 15);
+    test_int(p->y, 25);
+}
+
+struct Scale {
+    float value;
+};
+
+void System_each_5_components_shared() {
+    flecs::world world;
+
+    flecs::component<Position>(world, "Position");
+    flecs::component<Velocity>(world, "Velocity");
+    flecs::component<Mass>(world, "Mass");
+    flecs::component<Rotation>(world, "Rotation");
+    flecs::component<Scale>(world, "Scale");
+
+    auto base = flecs::entity(world)
+        .set<Mass>({2});
+
+    auto e1 = flecs::entity(world)
+        .set<Position>({10, 20})
+        .set<Velocity>({1, 2})
+        .set<Rotation>({3})
+        .set<Scale>({4})
+        .add_instanceof(base);
+
+    auto e2 = flecs::entity(world)
+        .set<Position>({30, 40})
+        .set<Velocity>({1, 2})
+        .set<Rotation>({5})
+        .set<Scale>({6})
+        .add_instanceof(base);
+
+    auto e3 = flecs::entity(world)
+        .set<Position>({50, 60})
+        .set<Mass>({3})
+        .set<Rotation>({7});
+
+    flecs::system<Position, const Velocity*, const Mass, const Rotation, const Scale*>(world)
+        .each([](flecs::entity e, Position& p, const Velocity* v, const Mass& m, 
+            const Rotation& r, const Scale *s) 
+        {
+            p.x += m.value * r.value;
+            p.y += m.value * r.value;
+            if (v) {
+                p.x += v->x;
+                p.y += v->y;
+            }
+            if (s) {
+                p.x += s->value;
+                p.y += s->value;
+            }
+        });
+
+    world.progress();
+
+    const Position *p = e1.get<Position>();
+    test_int(p->x, 21);
+    test_int(p->y, 32);
+
+    p = e2.get<Position>();
+    test_int(p->x, 47);
+    test_int(p->y, 58);
+
+    p = e3.get<Position>();
+    test_int(p->x, 71);
+    test_int(p->y, 81);
+}
@@ -126,6 +126,9 @@ void System_empty_signature(void);
 void System_action_tag(void);
 void System_iter_tag(void);
 void System_each_tag(void);
+void System_each_optional_shared(void);
+void System_each_run_w_param(void);
+void System_each_5_components_shared(void);
 
 // Testsuite 'Trigger'
 void Trigger_on_add(void);
@@ -152,6 +155,8 @@ void Query_subquery_w_expr(void);
 void Query_query_single_trait(void);
 void Query_tag_w_each(void);
 void Query_shared_tag_w_each(void);
+void Query_par_each(void);
+void Query_par_iter(void);
 
 // Testsuite 'ComponentLifecycle'
 void ComponentLifecycle_ctor_on_add(void);
@@ -677,6 +682,18 @@ bake_test_case System_testcases[] = {
     {
         "each_tag",
         System_each_tag
+    },
+    {
+        "each_optional_shared",
+        System_each_optional_shared
+    },
+    {
+        "each_run_w_param",
+        System_each_run_w_param
+    },
+    {
+        "each_5_components_shared",
+        System_each_5_components_shared
     }
 };
 
@@ -771,6 +788,14 @@ bake_test_case Query_testcases[] = {
     {
         "shared_tag_w_each",
         Query_shared_tag_w_each
+    },
+    {
+        "par_each",
+        Query_par_each
+    },
+    {
+        "par_iter",
+        Query_par_iter
     }
 };
 
@@ -1098,7 +1123,7 @@ static bake_test_suite suites[] = {
         "System",
         NULL,
         NULL,
-        18,
+        21,
         System_testcases
     },
     {
@@ -1112,7 +1137,7 @@ static bake_test_suite suites[] = {
         "Query",
         NULL,
         NULL,
-        17,
+        19,
         Query_testcases
     },
     {